@@ -0,0 +1,45 @@
+#!/bin/sh
+# Ripples benchmark. Starts ripples with bench/bench_zone.txt zone on a local
+# port, drives it with ripples_bench over UDP and then TCP, and appends
+# results (JSON lines, labeled with current commit) to
+# build/bench/results.jsonl. Any arguments are passed to ripples_bench, e.g.
+#
+#     make bench BENCH_ARGS="--threads 4 --rate 200000 --mix 6,3,1 --edns 50"
+#
+# Environment variables BENCH_PORT and BENCH_SERVER_THREADS set ripples
+# listener port and number of vectorloop threads. BENCH_ATTACKS lists
+# adversarial scenarios (churn, slowloris, flood) to also benchmark under,
+# one run per protocol and scenario, e.g.
+#
+#     make bench BENCH_ATTACKS="churn slowloris flood"
+#
+# Attack options (--attack_rate, --attack_conns, ...) can be passed in
+# BENCH_ARGS.
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+RUN_DIR="$ROOT/build/bench"
+PORT=${BENCH_PORT:-15353}
+SERVER_THREADS=${BENCH_SERVER_THREADS:-2}
+LABEL=$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+mkdir -p "$RUN_DIR/logs"
+cp "$ROOT/bench/bench_zone.txt" "$RUN_DIR/"
+cd "$RUN_DIR"
+
+"$ROOT/build/bin/ripples" --zone_file bench_zone.txt \
+    --udp_listener_port "$PORT" --tcp_listener_port "$PORT" \
+    --process_thread_count "$SERVER_THREADS" > ripples.out 2>&1 &
+PID=$!
+trap 'kill $PID 2>/dev/null; wait $PID 2>/dev/null' EXIT
+sleep 1
+
+for ATTACK in none ${BENCH_ATTACKS:-}; do
+    for PROTOCOL in udp tcp; do
+        "$ROOT/build/bin/ripples_bench" --server 127.0.0.1 --port "$PORT" \
+            --protocol "$PROTOCOL" --label "$LABEL" \
+            --qname www.example.com --qname api.example.com \
+            --attack "$ATTACK" --output "$RUN_DIR/results.jsonl" "$@"
+    done
+done
+echo "Results appended to $RUN_DIR/results.jsonl"
@@ -0,0 +1,1377 @@
+/**
+ * @file ripples_bench.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup bench Benchmark
+ *
+ * @brief Multi threaded DNS load generator used to benchmark ripples.
+ *
+ *        Each thread sends queries over its own UDP socket (sendmmsg() and
+ *        recvmmsg()) or TCP connection. Sending is open loop: query n of a
+ *        thread is scheduled at start + n / rate, independent of responses,
+ *        and latency is measured from scheduled time, so a slow server is not
+ *        hidden by sender slowing down with it. Results are printed and
+ *        appended as a JSON line to output file, so they can be tracked per
+ *        commit.
+ *
+ *        Optionally attack threads run an adversarial scenario alongside
+ *        sending threads for same duration, see @ref bench_attacks, so
+ *        latency and throughput of legitimate queries are measured while
+ *        server is under attack.
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Maximum number of queries sent or received with a single system call. */
+#define BENCH_BATCH 64
+
+/** Maximum DNS message size sent or received over UDP. */
+#define BENCH_MSG_LEN 1232
+
+/** Number of DNS message IDs, query ID indexes outstanding queries. */
+#define BENCH_IDS 65536
+
+/** Number of latency histogram buckets, see @ref bench_hist_index(). */
+#define BENCH_HIST_LEN (64 * 64)
+
+/** Maximum number of query names queries are sent for. */
+#define BENCH_QNAMES_MAX 16
+
+/** TCP connection buffer size. */
+#define BENCH_TCP_BUF_LEN (1 << 16)
+
+/** Query types of query mix. */
+enum bench_qtypes {
+    /** Query for A record. */
+    BENCH_Q_A = 0,
+
+    /** Query for AAAA record. */
+    BENCH_Q_AAAA,
+
+    /** Query with opcode server does not implement (STATUS). */
+    BENCH_Q_NOTIMPL,
+
+    /** Number of query types. */
+    BENCH_Q_COUNT,
+};
+
+/** Adversarial scenarios attack threads run. */
+enum bench_attacks {
+    /** No attack. */
+    BENCH_ATTACK_NONE = 0,
+
+    /** TCP connection storm, connect, send a query and close at once,
+     * without reading response.
+     */
+    BENCH_ATTACK_CHURN,
+
+    /** Slow clients, hold many TCP connections open, each trickling a byte
+     * of a query every interval, reconnecting when server closes it.
+     */
+    BENCH_ATTACK_SLOWLORIS,
+
+    /** UDP junk flood, datagrams of random bytes and length. */
+    BENCH_ATTACK_FLOOD,
+
+    /** Number of scenarios. */
+    BENCH_ATTACK_COUNT,
+};
+
+/** Names of adversarial scenarios, indexed by @ref bench_attacks. */
+static const char *bench_attack_names[BENCH_ATTACK_COUNT] = {
+    "none", "churn", "slowloris", "flood",
+};
+
+/** Benchmark settings. */
+typedef struct bench_cfg_s {
+    /** Server address. */
+    struct sockaddr_storage server;
+
+    /** Length of server address. */
+    socklen_t server_len;
+
+    /** Send queries over TCP instead of UDP. */
+    bool tcp;
+
+    /** Number of sending threads. */
+    int threads;
+
+    /** Sending duration in seconds. */
+    double duration;
+
+    /** Target queries per second, over all threads. 0 sends as fast as
+     * window allows (closed loop).
+     */
+    double rate;
+
+    /** Maximum number of outstanding queries per thread. */
+    int window;
+
+    /** Time in seconds after which query without response is lost. */
+    double timeout;
+
+    /** Adversarial scenario, see @ref bench_attacks. */
+    int attack;
+
+    /** Number of attack threads. */
+    int attack_threads;
+
+    /** Attack operations per second over all attack threads, connections
+     * for churn and datagrams for flood. 0 runs as fast as possible.
+     */
+    double attack_rate;
+
+    /** Number of TCP connections each slowloris attack thread holds. */
+    int attack_conns;
+
+    /** Interval in seconds between bytes of a slowloris connection. */
+    double attack_interval;
+
+    /** Relative weights of query types, see @ref bench_qtypes. */
+    int mix[BENCH_Q_COUNT];
+
+    /** Percent of queries sent with EDNS OPT record. */
+    int edns_pct;
+
+    /** Percent of EDNS queries sent with client subnet option. */
+    int ecs_pct;
+
+    /** Query names in wire format. */
+    uint8_t qnames[BENCH_QNAMES_MAX][256];
+
+    /** Length of query names. */
+    int qname_lens[BENCH_QNAMES_MAX];
+
+    /** Number of query names. */
+    int qname_count;
+
+    /** Label identifying run in results, such as commit ID. */
+    const char *label;
+
+    /** File JSON results are appended to, NULL for none. */
+    const char *output;
+} bench_cfg_t;
+
+/** Sending thread state and statistics. */
+typedef struct bench_thread_s {
+    /** Benchmark settings. */
+    bench_cfg_t *cfg;
+
+    /** Thread ID. */
+    pthread_t thread;
+
+    /** Random number generator state. */
+    uint64_t rand;
+
+    /** Scheduled send time of outstanding queries indexed by query ID, 0 if
+     * no query with ID is outstanding.
+     */
+    uint64_t *sched_ns;
+
+    /** Query IDs in order they were sent, ring of BENCH_IDS entries. */
+    uint16_t *order;
+
+    /** Number of queries sent, next query ID is sent & 0xffff. */
+    uint64_t sent;
+
+    /** Number of queries removed from order ring, answered or lost. */
+    uint64_t done;
+
+    /** Number of responses received. */
+    uint64_t received;
+
+    /** Number of queries with no response within timeout. */
+    uint64_t lost;
+
+    /** Number of failed sends. */
+    uint64_t send_errors;
+
+    /** Number of responses with TC flag set. */
+    uint64_t truncated;
+
+    /** Number of responses per RCODE. */
+    uint64_t rcodes[16];
+
+    /** Latency histogram, see @ref bench_hist_index(). */
+    uint64_t *hist;
+
+    /** Sum of latencies in nanoseconds. */
+    uint64_t lat_sum_ns;
+
+    /** Maximum latency in nanoseconds. */
+    uint64_t lat_max_ns;
+
+    /** Set if thread runs attack scenario instead of sending queries. */
+    bool attacker;
+
+    /** Number of attack operations, connections opened for churn and
+     * slowloris, datagrams sent for flood.
+     */
+    uint64_t attack_ops;
+
+    /** Number of failed attack operations. */
+    uint64_t attack_errors;
+
+    /** Number of slowloris connections server closed. */
+    uint64_t attack_closed;
+} bench_thread_t;
+
+/** Get monotonic clock time in nanoseconds.
+ *
+ * @return Returns current time in nanoseconds.
+ */
+static uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** Get next pseudo random number (xorshift64).
+ *
+ * @param t Thread random number is for.
+ *
+ * @return  Returns random number.
+ */
+static uint64_t
+bench_rand(bench_thread_t *t)
+{
+    t->rand ^= t->rand << 13;
+    t->rand ^= t->rand >> 7;
+    t->rand ^= t->rand << 17;
+    return t->rand;
+}
+
+/** Get latency histogram bucket of a value. Values below 128 have a bucket
+ * each, larger values have 64 buckets per power of 2, so bucket value is
+ * within 1.6% of values in it.
+ *
+ * @param v Value.
+ *
+ * @return  Returns histogram bucket index.
+ */
+static int
+bench_hist_index(uint64_t v)
+{
+    int shift;
+
+    if (v < 128) {
+        return v;
+    }
+    shift = 63 - __builtin_clzll(v) - 6;
+    return (shift + 1) * 64 + (int)((v >> shift) - 64);
+}
+
+/** Get lowest value of latency histogram bucket.
+ *
+ * @param i Histogram bucket index.
+ *
+ * @return  Returns lowest value of bucket.
+ */
+static uint64_t
+bench_hist_value(int i)
+{
+    if (i < 128) {
+        return i;
+    }
+    return (uint64_t)(i % 64 + 64) << (i / 64 - 1);
+}
+
+/** Build a query for next query ID.
+ *
+ * @param t   Thread building query.
+ * @param id  Query ID.
+ * @param buf Buffer to build query in, at least BENCH_MSG_LEN long.
+ *
+ * @return    Returns length of query.
+ */
+static size_t
+bench_query_build(bench_thread_t *t, uint16_t id, uint8_t *buf)
+{
+    bench_cfg_t *cfg    = t->cfg;
+    uint64_t     r      = bench_rand(t);
+    int          total  = cfg->mix[BENCH_Q_A] + cfg->mix[BENCH_Q_AAAA] + cfg->mix[BENCH_Q_NOTIMPL];
+    int          pick   = r % total;
+    int          qname  = (r >> 16) % cfg->qname_count;
+    bool         edns   = (int)((r >> 24) % 100) < cfg->edns_pct;
+    bool         ecs    = edns && (int)((r >> 32) % 100) < cfg->ecs_pct;
+    uint16_t     qtype  = 1;
+    uint8_t      opcode = 0;
+    size_t       len    = 0;
+
+    if (pick >= cfg->mix[BENCH_Q_A] + cfg->mix[BENCH_Q_AAAA]) {
+        opcode = 2;
+    } else if (pick >= cfg->mix[BENCH_Q_A]) {
+        qtype = 28;
+    }
+
+    /* Header. */
+    buf[0]  = id >> 8;
+    buf[1]  = id & 0xff;
+    buf[2]  = opcode << 3;
+    buf[3]  = 0;
+    buf[4]  = 0;
+    buf[5]  = 1;
+    memset(buf + 6, 0, 6);
+    buf[11] = edns ? 1 : 0;
+    len = 12;
+
+    /* Question. */
+    memcpy(buf + len, cfg->qnames[qname], cfg->qname_lens[qname]);
+    len += cfg->qname_lens[qname];
+    buf[len++] = qtype >> 8;
+    buf[len++] = qtype & 0xff;
+    buf[len++] = 0;
+    buf[len++] = 1;
+
+    if (edns) {
+        /* OPT record: root owner, type 41, payload size, no extended
+         * RCODE or flags.
+         */
+        buf[len++] = 0;
+        buf[len++] = 0;
+        buf[len++] = 41;
+        buf[len++] = BENCH_MSG_LEN >> 8;
+        buf[len++] = BENCH_MSG_LEN & 0xff;
+        memset(buf + len, 0, 4);
+        len += 4;
+        buf[len++] = 0;
+        buf[len++] = ecs ? 11 : 0;
+        if (ecs) {
+            /* Client subnet option, random 10.x.y.0/24. */
+            buf[len++] = 0;
+            buf[len++] = 8;
+            buf[len++] = 0;
+            buf[len++] = 7;
+            buf[len++] = 0;
+            buf[len++] = 1;
+            buf[len++] = 24;
+            buf[len++] = 0;
+            buf[len++] = 10;
+            buf[len++] = (r >> 40) & 0xff;
+            buf[len++] = (r >> 48) & 0xff;
+        }
+    }
+    return len;
+}
+
+/** Record a response received.
+ *
+ * @param t   Thread query was sent by.
+ * @param buf Response.
+ * @param len Length of response.
+ * @param now Time response was received.
+ */
+static void
+bench_response(bench_thread_t *t, const uint8_t *buf, size_t len, uint64_t now)
+{
+    uint16_t id;
+    uint64_t lat;
+
+    if (len < 12) {
+        return;
+    }
+    id = (uint16_t)(buf[0] << 8 | buf[1]);
+    if (t->sched_ns[id] == 0) {
+        /* Duplicate or late response. */
+        return;
+    }
+    lat = now > t->sched_ns[id] ? now - t->sched_ns[id] : 0;
+    t->sched_ns[id] = 0;
+
+    t->received++;
+    t->rcodes[buf[3] & 0x0f]++;
+    if (buf[2] & 0x02) {
+        t->truncated++;
+    }
+    t->hist[bench_hist_index(lat)]++;
+    t->lat_sum_ns += lat;
+    if (lat > t->lat_max_ns) {
+        t->lat_max_ns = lat;
+    }
+}
+
+/** Remove answered and timed out queries from head of order ring.
+ *
+ * @param t       Thread to check queries of.
+ * @param now     Current time.
+ * @param timeout Timeout in nanoseconds, 0 to remove all remaining queries.
+ */
+static void
+bench_expire(bench_thread_t *t, uint64_t now, uint64_t timeout)
+{
+    while (t->done < t->sent) {
+        uint16_t id = t->order[t->done % BENCH_IDS];
+
+        if (t->sched_ns[id] != 0) {
+            if (timeout != 0 && now - t->sched_ns[id] < timeout) {
+                break;
+            }
+            t->sched_ns[id] = 0;
+            t->lost++;
+        }
+        t->done++;
+    }
+}
+
+/** Get number of queries thread should send now.
+ *
+ * @param t     Thread sending queries.
+ * @param start Start time of sending.
+ * @param now   Current time.
+ * @param next  Set to scheduled time of next query, when query is not
+ *              due yet.
+ *
+ * @return      Returns number of queries to send, at most BENCH_BATCH.
+ */
+static uint64_t
+bench_due(bench_thread_t *t, uint64_t start, uint64_t now, uint64_t *next)
+{
+    bench_cfg_t *cfg  = t->cfg;
+    double       rate = cfg->rate / cfg->threads;
+    uint64_t     room = cfg->window - (t->sent - t->done);
+    uint64_t     due  = room;
+
+    if (rate > 0) {
+        due = (uint64_t)((now - start) * rate / 1e9) + 1;
+        due = due > t->sent ? due - t->sent : 0;
+        *next = start + (uint64_t)((t->sent + 1) * 1e9 / rate);
+        if (due > room) {
+            /* Window is full, wait for responses. */
+            due   = room;
+            *next = now + 1000000;
+        }
+    } else {
+        *next = now + 1000000;
+    }
+    return due > BENCH_BATCH ? BENCH_BATCH : due;
+}
+
+/** Get scheduled send time of a query.
+ *
+ * @param t     Thread sending query.
+ * @param n     Number of query, counting from 0 at start of sending.
+ * @param start Start time of sending.
+ * @param now   Current time.
+ *
+ * @return      Returns scheduled time of query, current time if sending is
+ *              not rate controlled.
+ */
+static uint64_t
+bench_sched(bench_thread_t *t, uint64_t n, uint64_t start, uint64_t now)
+{
+    double rate = t->cfg->rate / t->cfg->threads;
+
+    return rate > 0 ? start + (uint64_t)(n * 1e9 / rate) : now;
+}
+
+/** Mark query as sent.
+ *
+ * @param t     Thread that sent query.
+ * @param sched Scheduled send time of query.
+ */
+static void
+bench_sent(bench_thread_t *t, uint64_t sched)
+{
+    uint16_t id = t->sent & 0xffff;
+
+    t->sched_ns[id] = sched == 0 ? 1 : sched;
+    t->order[t->sent % BENCH_IDS] = id;
+    t->sent++;
+}
+
+/** Wait until socket is readable or next query is due.
+ *
+ * @param fd     Socket to wait on.
+ * @param events Events to wait for.
+ * @param now    Current time.
+ * @param next   Time next query is due.
+ */
+static void
+bench_wait(int fd, short events, uint64_t now, uint64_t next)
+{
+    struct pollfd   pfd = { .fd = fd, .events = events };
+    struct timespec ts  = { .tv_sec = 0, .tv_nsec = 0 };
+
+    if (next > now) {
+        ts.tv_sec  = (next - now) / 1000000000ULL;
+        ts.tv_nsec = (next - now) % 1000000000ULL;
+    }
+    ppoll(&pfd, 1, &ts, NULL);
+}
+
+/** Open socket connected to server.
+ *
+ * @param cfg Benchmark settings.
+ *
+ * @return    Returns socket, exits on error.
+ */
+static int
+bench_connect(bench_cfg_t *cfg)
+{
+    int fd  = socket(cfg->server.ss_family, cfg->tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+    int one = 1;
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&cfg->server, cfg->server_len) != 0) {
+        fprintf(stderr, "Could not connect to server, error message: %s\n", strerror(errno));
+        exit(1);
+    }
+    if (cfg->tcp) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+/** Send queries over UDP and receive responses until sending duration
+ * passes and all queries are answered or lost.
+ *
+ * @param t Thread sending queries.
+ */
+static void
+bench_udp(bench_thread_t *t)
+{
+    bench_cfg_t    *cfg     = t->cfg;
+    int             fd      = bench_connect(cfg);
+    uint64_t        timeout = cfg->timeout * 1e9;
+    uint64_t        start   = bench_now_ns();
+    uint64_t        end     = start + (uint64_t)(cfg->duration * 1e9);
+    uint64_t        now     = start;
+    uint64_t        next    = start;
+    uint64_t        sched[BENCH_BATCH];
+    uint8_t         bufs[BENCH_BATCH][BENCH_MSG_LEN];
+    struct iovec    iov[BENCH_BATCH];
+    struct mmsghdr  msgs[BENCH_BATCH];
+    uint64_t        count;
+    int             ret;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        iov[i].iov_base             = bufs[i];
+        msgs[i].msg_hdr.msg_iov     = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    while (now < end || (t->done < t->sent && now < end + timeout)) {
+        /* Send queries that are due. */
+        count = now < end ? bench_due(t, start, now, &next) : 0;
+        for (uint64_t i = 0; i < count; i++) {
+            sched[i]       = bench_sched(t, t->sent + i, start, now);
+            iov[i].iov_len = bench_query_build(t, (t->sent + i) & 0xffff, bufs[i]);
+        }
+        if (count > 0) {
+            ret = sendmmsg(fd, msgs, count, MSG_DONTWAIT);
+            if (ret < 0) {
+                t->send_errors++;
+                ret = 0;
+            }
+            for (int i = 0; i < ret; i++) {
+                bench_sent(t, sched[i]);
+            }
+        }
+
+        /* Receive responses. */
+        for (int i = 0; i < BENCH_BATCH; i++) {
+            iov[i].iov_len = BENCH_MSG_LEN;
+        }
+        ret = recvmmsg(fd, msgs, BENCH_BATCH, MSG_DONTWAIT, NULL);
+        now = bench_now_ns();
+        for (int i = 0; i < ret; i++) {
+            bench_response(t, bufs[i], msgs[i].msg_len, now);
+        }
+        bench_expire(t, now, timeout);
+
+        if (ret <= 0 && (count == 0 || now >= end)) {
+            bench_wait(fd, POLLIN, now, now < end ? next : now + 1000000);
+            now = bench_now_ns();
+        }
+    }
+    bench_expire(t, now, 0);
+    close(fd);
+}
+
+/** Send queries over TCP connection and receive responses until sending
+ * duration passes and all queries are answered or lost.
+ *
+ * @param t Thread sending queries.
+ */
+static void
+bench_tcp(bench_thread_t *t)
+{
+    bench_cfg_t *cfg     = t->cfg;
+    int          fd      = bench_connect(cfg);
+    uint64_t     timeout = cfg->timeout * 1e9;
+    uint64_t     start   = bench_now_ns();
+    uint64_t     end     = start + (uint64_t)(cfg->duration * 1e9);
+    uint64_t     now     = start;
+    uint64_t     next    = start;
+    uint8_t     *out     = malloc(BENCH_TCP_BUF_LEN);
+    uint8_t     *in      = malloc(BENCH_TCP_BUF_LEN);
+    size_t       out_len = 0;
+    size_t       in_len  = 0;
+    uint64_t     count;
+    ssize_t      ret;
+    size_t       pos;
+
+    if (out == NULL || in == NULL) {
+        fprintf(stderr, "Could not allocate TCP buffers\n");
+        exit(1);
+    }
+
+    while (now < end || (t->done < t->sent && now < end + timeout)) {
+        /* Queue queries that are due, if there is room for them. */
+        count = now < end ? bench_due(t, start, now, &next) : 0;
+        for (uint64_t i = 0; i < count &&
+                             out_len + BENCH_MSG_LEN + 2 <= BENCH_TCP_BUF_LEN; i++) {
+            size_t len = bench_query_build(t, t->sent & 0xffff, out + out_len + 2);
+
+            out[out_len]     = len >> 8;
+            out[out_len + 1] = len & 0xff;
+            out_len += len + 2;
+            bench_sent(t, bench_sched(t, t->sent, start, now));
+        }
+
+        /* Send queued queries. */
+        if (out_len > 0) {
+            ret = send(fd, out, out_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (ret > 0) {
+                memmove(out, out + ret, out_len - ret);
+                out_len -= ret;
+            } else if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                t->send_errors++;
+                break;
+            }
+        }
+
+        /* Receive responses. */
+        ret = recv(fd, in + in_len, BENCH_TCP_BUF_LEN - in_len, MSG_DONTWAIT);
+        if (ret == 0) {
+            /* Server closed connection. */
+            break;
+        }
+        now = bench_now_ns();
+        if (ret > 0) {
+            in_len += ret;
+            pos = 0;
+            while (in_len - pos >= 2 && in_len - pos >= 2 + (size_t)(in[pos] << 8 | in[pos + 1])) {
+                size_t len = in[pos] << 8 | in[pos + 1];
+
+                bench_response(t, in + pos + 2, len, now);
+                pos += len + 2;
+            }
+            memmove(in, in + pos, in_len - pos);
+            in_len -= pos;
+        }
+        bench_expire(t, now, timeout);
+
+        if (ret <= 0 && (count == 0 || now >= end)) {
+            bench_wait(fd, POLLIN | (out_len > 0 ? POLLOUT : 0), now,
+                       now < end ? next : now + 1000000);
+            now = bench_now_ns();
+        }
+    }
+    bench_expire(t, now, 0);
+    free(out);
+    free(in);
+    close(fd);
+}
+
+/** Sleep until a time.
+ *
+ * @param ns Monotonic clock time in nanoseconds to sleep until.
+ */
+static void
+bench_sleep_until(uint64_t ns)
+{
+    struct timespec ts = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+/** Get number of attack operations thread should run now, operations are
+ * paced at attack rate share of thread.
+ *
+ * @param t     Attack thread.
+ * @param start Start time of attack.
+ * @param now   Current time.
+ * @param next  Set to time of next operation, when none is due.
+ *
+ * @return      Returns number of operations to run, at most BENCH_BATCH.
+ */
+static uint64_t
+bench_attack_due(bench_thread_t *t, uint64_t start, uint64_t now, uint64_t *next)
+{
+    double   rate = t->cfg->attack_rate / t->cfg->attack_threads;
+    uint64_t done = t->attack_ops + t->attack_errors;
+    uint64_t due;
+
+    if (rate <= 0) {
+        return BENCH_BATCH;
+    }
+    due   = (uint64_t)((now - start) * rate / 1e9) + 1;
+    due   = due > done ? due - done : 0;
+    *next = start + (uint64_t)((done + 1) * 1e9 / rate);
+    return due > BENCH_BATCH ? BENCH_BATCH : due;
+}
+
+/** Open attack socket connected to server. Unlike @ref bench_connect
+ * failure is not fatal, as server is expected to refuse attackers. Connect
+ * gives up after a second, so a full listen backlog does not stall attack.
+ *
+ * @param cfg  Benchmark settings.
+ * @param type Socket type, SOCK_STREAM or SOCK_DGRAM.
+ *
+ * @return     Returns socket, -1 on error.
+ */
+static int
+bench_attack_connect(bench_cfg_t *cfg, int type)
+{
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    int            fd = socket(cfg->server.ss_family, type, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd, (struct sockaddr *)&cfg->server, cfg->server_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** Run TCP connection churn attack: connect, send a query and close at once,
+ * without reading response. Connection is reset on close (zero linger), so
+ * attacker does not run out of local ports in TIME_WAIT.
+ *
+ * @param t Attack thread.
+ */
+static void
+bench_churn(bench_thread_t *t)
+{
+    bench_cfg_t  *cfg   = t->cfg;
+    uint64_t      start = bench_now_ns();
+    uint64_t      end   = start + (uint64_t)(cfg->duration * 1e9);
+    uint64_t      now   = start;
+    uint64_t      next  = start;
+    struct linger lin   = { .l_onoff = 1, .l_linger = 0 };
+    uint8_t       buf[BENCH_MSG_LEN + 2];
+    uint64_t      count;
+
+    while (now < end) {
+        count = bench_attack_due(t, start, now, &next);
+        for (uint64_t i = 0; i < count; i++) {
+            int    fd = bench_attack_connect(cfg, SOCK_STREAM);
+            size_t len;
+
+            if (fd < 0) {
+                t->attack_errors++;
+                continue;
+            }
+            len    = bench_query_build(t, t->attack_ops & 0xffff, buf + 2);
+            buf[0] = len >> 8;
+            buf[1] = len & 0xff;
+            if (send(fd, buf, len + 2, MSG_NOSIGNAL) == (ssize_t)(len + 2)) {
+                t->attack_ops++;
+            } else {
+                t->attack_errors++;
+            }
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+            close(fd);
+        }
+        if (count == 0) {
+            bench_sleep_until(next < end ? next : end);
+        }
+        now = bench_now_ns();
+    }
+}
+
+/** Run slowloris attack: hold attack_conns TCP connections, each sending
+ * one byte of a query every attack_interval, draining responses. Connection
+ * server closes, such as on TCP idle timeout, is counted and reopened.
+ *
+ * @param t Attack thread.
+ */
+static void
+bench_slowloris(bench_thread_t *t)
+{
+    bench_cfg_t *cfg      = t->cfg;
+    uint64_t     interval = cfg->attack_interval * 1e9;
+    uint64_t     start    = bench_now_ns();
+    uint64_t     end      = start + (uint64_t)(cfg->duration * 1e9);
+    uint64_t     now      = start;
+    int         *fds      = malloc(cfg->attack_conns * sizeof(int));
+    size_t      *pos      = calloc(cfg->attack_conns, sizeof(size_t));
+    uint8_t      query[BENCH_MSG_LEN + 2];
+    uint8_t      discard[BENCH_MSG_LEN];
+    size_t       len;
+    ssize_t      ret;
+
+    if (fds == NULL || pos == NULL) {
+        fprintf(stderr, "Could not allocate slowloris connections\n");
+        exit(1);
+    }
+    len      = bench_query_build(t, 0, query + 2) + 2;
+    query[0] = (len - 2) >> 8;
+    query[1] = (len - 2) & 0xff;
+    for (int i = 0; i < cfg->attack_conns; i++) {
+        fds[i] = -1;
+    }
+
+    while (now < end) {
+        for (int i = 0; i < cfg->attack_conns; i++) {
+            if (fds[i] < 0) {
+                fds[i] = bench_attack_connect(cfg, SOCK_STREAM);
+                if (fds[i] < 0) {
+                    t->attack_errors++;
+                    continue;
+                }
+                t->attack_ops++;
+                pos[i] = 0;
+            }
+
+            /* Drain responses, and notice server closing connection. */
+            ret = recv(fds[i], discard, sizeof(discard), MSG_DONTWAIT);
+            if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                t->attack_closed++;
+                close(fds[i]);
+                fds[i] = -1;
+                continue;
+            }
+            if (send(fds[i], query + pos[i], 1, MSG_DONTWAIT | MSG_NOSIGNAL) == 1) {
+                pos[i] = (pos[i] + 1) % len;
+            }
+        }
+        bench_sleep_until(now + interval < end ? now + interval : end);
+        now = bench_now_ns();
+    }
+
+    for (int i = 0; i < cfg->attack_conns; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    free(fds);
+    free(pos);
+}
+
+/** Run UDP junk flood attack: datagrams of random bytes, 1 to 512 long,
+ * responses are not read.
+ *
+ * @param t Attack thread.
+ */
+static void
+bench_flood(bench_thread_t *t)
+{
+    bench_cfg_t    *cfg   = t->cfg;
+    int             fd    = bench_attack_connect(cfg, SOCK_DGRAM);
+    uint64_t        start = bench_now_ns();
+    uint64_t        end   = start + (uint64_t)(cfg->duration * 1e9);
+    uint64_t        now   = start;
+    uint64_t        next  = start;
+    uint64_t        bufs[BENCH_BATCH][512 / sizeof(uint64_t)];
+    struct iovec    iov[BENCH_BATCH];
+    struct mmsghdr  msgs[BENCH_BATCH];
+    uint64_t        count;
+    int             ret;
+
+    if (fd < 0) {
+        fprintf(stderr, "Could not open flood socket, error message: %s\n", strerror(errno));
+        exit(1);
+    }
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        iov[i].iov_base            = bufs[i];
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (now < end) {
+        count = bench_attack_due(t, start, now, &next);
+        for (uint64_t i = 0; i < count; i++) {
+            iov[i].iov_len = 1 + bench_rand(t) % sizeof(bufs[i]);
+            for (size_t j = 0; j < (iov[i].iov_len + 7) / 8; j++) {
+                bufs[i][j] = bench_rand(t);
+            }
+        }
+        if (count > 0) {
+            ret = sendmmsg(fd, msgs, count, MSG_DONTWAIT);
+            if (ret < 0) {
+                /* Socket buffer is full, wait for room. */
+                t->attack_errors += count;
+                bench_wait(fd, POLLOUT, now, now + 1000000);
+            } else {
+                t->attack_ops += ret;
+            }
+        } else {
+            bench_sleep_until(next < end ? next : end);
+        }
+        now = bench_now_ns();
+    }
+    close(fd);
+}
+
+/** Sending thread function.
+ *
+ * @param arg Thread state, see @ref bench_thread_t.
+ *
+ * @return    Always returns NULL.
+ */
+static void *
+bench_thread(void *arg)
+{
+    bench_thread_t *t = (bench_thread_t *)arg;
+
+    if (t->attacker) {
+        switch (t->cfg->attack) {
+        case BENCH_ATTACK_CHURN:     bench_churn(t); break;
+        case BENCH_ATTACK_SLOWLORIS: bench_slowloris(t); break;
+        case BENCH_ATTACK_FLOOD:     bench_flood(t); break;
+        }
+    } else if (t->cfg->tcp) {
+        bench_tcp(t);
+    } else {
+        bench_udp(t);
+    }
+    return NULL;
+}
+
+/** Get latency at percentile from histogram.
+ *
+ * @param hist  Latency histogram.
+ * @param total Number of values in histogram.
+ * @param pct   Percentile, 0 - 100.
+ *
+ * @return      Returns latency in microseconds.
+ */
+static double
+bench_percentile(uint64_t *hist, uint64_t total, double pct)
+{
+    uint64_t rank = (uint64_t)(total * pct / 100.0);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < BENCH_HIST_LEN; i++) {
+        seen += hist[i];
+        if (seen > rank) {
+            return bench_hist_value(i) / 1000.0;
+        }
+    }
+    return 0;
+}
+
+/** Convert query name to wire format.
+ *
+ * @param cfg  Benchmark settings to add query name to.
+ * @param name Query name, in presentation format.
+ *
+ * @return     Returns 0 on success, -1 if name is not valid.
+ */
+static int
+bench_qname_add(bench_cfg_t *cfg, const char *name)
+{
+    uint8_t    *wire = cfg->qnames[cfg->qname_count];
+    int         len  = 0;
+    const char *label = name;
+
+    if (cfg->qname_count == BENCH_QNAMES_MAX) {
+        return -1;
+    }
+    while (*label != '\0') {
+        const char *dot = strchr(label, '.');
+        int         n   = dot == NULL ? strlen(label) : dot - label;
+
+        if (n == 0 || n > 63 || len + n + 2 > 255) {
+            return -1;
+        }
+        wire[len++] = n;
+        memcpy(wire + len, label, n);
+        len += n;
+        label += n + (dot == NULL ? 0 : 1);
+    }
+    wire[len++] = 0;
+    cfg->qname_lens[cfg->qname_count++] = len;
+    return 0;
+}
+
+/** Print usage. */
+static void
+bench_usage(void)
+{
+    printf("Usage: ripples_bench [options]\n\n"
+           "  --server <ip>          Server IP address (default 127.0.0.1).\n"
+           "  --port <port>          Server port (default 53).\n"
+           "  --protocol <udp|tcp>   Protocol to send queries over (default udp).\n"
+           "  --threads <n>          Number of sending threads (default 1).\n"
+           "  --duration <s>         Sending duration in seconds (default 10).\n"
+           "  --rate <qps>           Target queries per second over all threads, 0\n"
+           "                         sends as fast as window allows (default 0).\n"
+           "  --window <n>           Maximum outstanding queries per thread (default 64).\n"
+           "  --timeout <s>          Query timeout in seconds (default 1).\n"
+           "  --mix <a,aaaa,notimpl> Relative weights of A, AAAA and not implemented\n"
+           "                         (opcode STATUS) queries (default 1,0,0).\n"
+           "  --edns <pct>           Percent of queries with EDNS (default 0).\n"
+           "  --ecs <pct>            Percent of EDNS queries with client subnet (default 0).\n"
+           "  --qname <name>         Query name, repeat for more names (default\n"
+           "                         www.example.com).\n"
+           "  --label <label>        Label of run in results, such as commit ID.\n"
+           "  --output <file>        Append results as a JSON line to file.\n"
+           "  --attack <scenario>    Run adversarial scenario alongside queries for same\n"
+           "                         duration (default none):\n"
+           "                           churn     TCP connections opened, sent a query and\n"
+           "                                     reset at once,\n"
+           "                           slowloris TCP connections trickling a byte of a\n"
+           "                                     query every interval,\n"
+           "                           flood     UDP datagrams of random bytes.\n"
+           "  --attack_threads <n>   Number of attack threads (default 1).\n"
+           "  --attack_rate <n>      Churn connections or flood datagrams per second over\n"
+           "                         all attack threads, 0 as fast as possible (default 0).\n"
+           "  --attack_conns <n>     Slowloris connections per attack thread (default 128).\n"
+           "  --attack_interval <s>  Slowloris interval between bytes (default 1).\n");
+}
+
+/** Parse command line options.
+ *
+ * @param cfg  Benchmark settings to set.
+ * @param argc Number of CLI arguments
+ * @param argv Array of CLI arguments.
+ */
+static void
+bench_options(bench_cfg_t *cfg, int argc, char *argv[])
+{
+    const char *server = "127.0.0.1";
+    int         port   = 53;
+    int         c;
+    struct option options[] = {
+        {"server",          required_argument, 0, 's'},
+        {"port",            required_argument, 0, 'p'},
+        {"protocol",        required_argument, 0, 'P'},
+        {"threads",         required_argument, 0, 't'},
+        {"duration",        required_argument, 0, 'd'},
+        {"rate",            required_argument, 0, 'r'},
+        {"window",          required_argument, 0, 'w'},
+        {"timeout",         required_argument, 0, 'T'},
+        {"mix",             required_argument, 0, 'm'},
+        {"edns",            required_argument, 0, 'e'},
+        {"ecs",             required_argument, 0, 'c'},
+        {"qname",           required_argument, 0, 'q'},
+        {"label",           required_argument, 0, 'l'},
+        {"output",          required_argument, 0, 'o'},
+        {"attack",          required_argument, 0, 'A'},
+        {"attack_threads",  required_argument, 0, 'a'},
+        {"attack_rate",     required_argument, 0, 'R'},
+        {"attack_conns",    required_argument, 0, 'C'},
+        {"attack_interval", required_argument, 0, 'I'},
+        {"help",            no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    *cfg = (bench_cfg_t) {
+        .threads  = 1,
+        .duration = 10,
+        .window   = 64,
+        .timeout  = 1,
+        .mix      = {1, 0, 0},
+        .label    = "",
+
+        .attack_threads  = 1,
+        .attack_conns    = 128,
+        .attack_interval = 1,
+    };
+
+    while ((c = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (c) {
+        case 's': server = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'P': cfg->tcp = strcmp(optarg, "tcp") == 0; break;
+        case 't': cfg->threads = atoi(optarg); break;
+        case 'd': cfg->duration = atof(optarg); break;
+        case 'r': cfg->rate = atof(optarg); break;
+        case 'w': cfg->window = atoi(optarg); break;
+        case 'T': cfg->timeout = atof(optarg); break;
+        case 'm':
+            if (sscanf(optarg, "%d,%d,%d", &cfg->mix[BENCH_Q_A], &cfg->mix[BENCH_Q_AAAA],
+                       &cfg->mix[BENCH_Q_NOTIMPL]) != 3) {
+                fprintf(stderr, "Invalid query mix \"%s\"\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'e': cfg->edns_pct = atoi(optarg); break;
+        case 'c': cfg->ecs_pct = atoi(optarg); break;
+        case 'q':
+            if (bench_qname_add(cfg, optarg) != 0) {
+                fprintf(stderr, "Invalid query name \"%s\"\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'l': cfg->label = optarg; break;
+        case 'o': cfg->output = optarg; break;
+        case 'A':
+            for (c = 0; c < BENCH_ATTACK_COUNT; c++) {
+                if (strcmp(optarg, bench_attack_names[c]) == 0) {
+                    break;
+                }
+            }
+            if (c == BENCH_ATTACK_COUNT) {
+                fprintf(stderr, "Invalid attack scenario \"%s\"\n", optarg);
+                exit(1);
+            }
+            cfg->attack = c;
+            break;
+        case 'a': cfg->attack_threads = atoi(optarg); break;
+        case 'R': cfg->attack_rate = atof(optarg); break;
+        case 'C': cfg->attack_conns = atoi(optarg); break;
+        case 'I': cfg->attack_interval = atof(optarg); break;
+        default:
+            bench_usage();
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (cfg->qname_count == 0) {
+        bench_qname_add(cfg, "www.example.com");
+    }
+    if (cfg->threads < 1 || cfg->duration <= 0 || cfg->window < 1 || cfg->window >= BENCH_IDS ||
+        cfg->timeout <= 0 || cfg->mix[BENCH_Q_A] < 0 || cfg->mix[BENCH_Q_AAAA] < 0 ||
+        cfg->mix[BENCH_Q_NOTIMPL] < 0 ||
+        cfg->mix[BENCH_Q_A] + cfg->mix[BENCH_Q_AAAA] + cfg->mix[BENCH_Q_NOTIMPL] <= 0 ||
+        cfg->attack_threads < 1 || cfg->attack_rate < 0 || cfg->attack_conns < 1 ||
+        cfg->attack_interval <= 0) {
+        fprintf(stderr, "Invalid options, see --help\n");
+        exit(1);
+    }
+
+    if (inet_pton(AF_INET, server, &((struct sockaddr_in *)&cfg->server)->sin_addr) == 1) {
+        cfg->server.ss_family = AF_INET;
+        ((struct sockaddr_in *)&cfg->server)->sin_port = htons(port);
+        cfg->server_len = sizeof(struct sockaddr_in);
+    } else if (inet_pton(AF_INET6, server, &((struct sockaddr_in6 *)&cfg->server)->sin6_addr) == 1) {
+        cfg->server.ss_family = AF_INET6;
+        ((struct sockaddr_in6 *)&cfg->server)->sin6_port = htons(port);
+        cfg->server_len = sizeof(struct sockaddr_in6);
+    } else {
+        fprintf(stderr, "Invalid server IP address \"%s\"\n", server);
+        exit(1);
+    }
+}
+
+/** Main function of benchmark, runs sending threads and reports results.
+ *
+ * @param argc Number of CLI arguments
+ * @param argv Array of CLI arguments.
+ *
+ * @return     Returns 0 on success.
+ */
+int
+main(int argc, char *argv[])
+{
+    static const char *rcode_names[] = {
+        "noerror", "formerr", "servfail", "nxdomain", "notimpl", "refused",
+    };
+    bench_cfg_t     cfg;
+    bench_thread_t *threads;
+    bench_thread_t *attackers = NULL;
+    bench_thread_t  total;
+    uint64_t       *hist;
+    uint64_t        start;
+    double          elapsed;
+    double          pct[] = {50, 90, 99, 99.9};
+    const char     *pct_names[] = {"p50", "p90", "p99", "p999"};
+    char            json[2048];
+    int             len;
+
+    bench_options(&cfg, argc, argv);
+
+    threads = calloc(cfg.threads, sizeof(bench_thread_t));
+    hist    = calloc(BENCH_HIST_LEN, sizeof(uint64_t));
+    if (threads == NULL || hist == NULL) {
+        fprintf(stderr, "Could not allocate memory\n");
+        return 1;
+    }
+
+    start = bench_now_ns();
+    if (cfg.attack != BENCH_ATTACK_NONE) {
+        attackers = calloc(cfg.attack_threads, sizeof(bench_thread_t));
+        if (attackers == NULL) {
+            fprintf(stderr, "Could not allocate memory\n");
+            return 1;
+        }
+        for (int i = 0; i < cfg.attack_threads; i++) {
+            bench_thread_t *t = &attackers[i];
+
+            t->cfg      = &cfg;
+            t->rand     = 0xc2b2ae3d27d4eb4fULL * (i + 1);
+            t->attacker = true;
+            if (pthread_create(&t->thread, NULL, bench_thread, t) != 0) {
+                fprintf(stderr, "Could not start attack thread\n");
+                return 1;
+            }
+        }
+    }
+    for (int i = 0; i < cfg.threads; i++) {
+        bench_thread_t *t = &threads[i];
+
+        t->cfg      = &cfg;
+        t->rand     = 0x9e3779b97f4a7c15ULL * (i + 1);
+        t->sched_ns = calloc(BENCH_IDS, sizeof(uint64_t));
+        t->order    = calloc(BENCH_IDS, sizeof(uint16_t));
+        t->hist     = calloc(BENCH_HIST_LEN, sizeof(uint64_t));
+        if (t->sched_ns == NULL || t->order == NULL || t->hist == NULL ||
+            pthread_create(&t->thread, NULL, bench_thread, t) != 0) {
+            fprintf(stderr, "Could not start sending thread\n");
+            return 1;
+        }
+    }
+
+    /* Sum up results of all threads. */
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < cfg.threads; i++) {
+        bench_thread_t *t = &threads[i];
+
+        pthread_join(t->thread, NULL);
+        total.sent        += t->sent;
+        total.received    += t->received;
+        total.lost        += t->lost;
+        total.send_errors += t->send_errors;
+        total.truncated   += t->truncated;
+        total.lat_sum_ns  += t->lat_sum_ns;
+        if (t->lat_max_ns > total.lat_max_ns) {
+            total.lat_max_ns = t->lat_max_ns;
+        }
+        for (int j = 0; j < 16; j++) {
+            total.rcodes[j] += t->rcodes[j];
+        }
+        for (int j = 0; j < BENCH_HIST_LEN; j++) {
+            hist[j] += t->hist[j];
+        }
+        free(t->sched_ns);
+        free(t->order);
+        free(t->hist);
+    }
+    for (int i = 0; attackers != NULL && i < cfg.attack_threads; i++) {
+        bench_thread_t *t = &attackers[i];
+
+        pthread_join(t->thread, NULL);
+        total.attack_ops    += t->attack_ops;
+        total.attack_errors += t->attack_errors;
+        total.attack_closed += t->attack_closed;
+    }
+    elapsed = (bench_now_ns() - start) / 1e9;
+    if (elapsed > cfg.duration) {
+        /* Responses are only counted during sending, and for up to timeout
+         * after it, so rate is over sending duration.
+         */
+        elapsed = cfg.duration;
+    }
+
+    /* Format results as a JSON line. */
+    len = snprintf(json, sizeof(json),
+                   "{\"label\":\"%s\",\"protocol\":\"%s\",\"threads\":%d,\"duration_s\":%.3f,"
+                   "\"rate_target\":%.0f,\"mix\":[%d,%d,%d],\"edns_pct\":%d,\"ecs_pct\":%d,"
+                   "\"sent\":%lu,\"received\":%lu,\"lost\":%lu,\"send_errors\":%lu,"
+                   "\"truncated\":%lu,\"qps\":%.1f,\"latency_us\":{\"mean\":%.1f",
+                   cfg.label, cfg.tcp ? "tcp" : "udp", cfg.threads, cfg.duration,
+                   cfg.rate, cfg.mix[BENCH_Q_A], cfg.mix[BENCH_Q_AAAA],
+                   cfg.mix[BENCH_Q_NOTIMPL], cfg.edns_pct, cfg.ecs_pct,
+                   total.sent, total.received, total.lost, total.send_errors,
+                   total.truncated, total.received / elapsed,
+                   total.received > 0 ? total.lat_sum_ns / 1000.0 / total.received : 0);
+    for (int i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+        len += snprintf(json + len, sizeof(json) - len, ",\"%s\":%.1f", pct_names[i],
+                        bench_percentile(hist, total.received, pct[i]));
+    }
+    len += snprintf(json + len, sizeof(json) - len, ",\"max\":%.1f},\"rcodes\":{",
+                    total.lat_max_ns / 1000.0);
+    for (int i = 0; i < 16; i++) {
+        if (total.rcodes[i] == 0) {
+            continue;
+        }
+        if (i < sizeof(rcode_names) / sizeof(rcode_names[0])) {
+            len += snprintf(json + len, sizeof(json) - len, "\"%s\":%lu,", rcode_names[i],
+                            total.rcodes[i]);
+        } else {
+            len += snprintf(json + len, sizeof(json) - len, "\"%d\":%lu,", i, total.rcodes[i]);
+        }
+    }
+    if (json[len - 1] == ',') {
+        len--;
+    }
+    len += snprintf(json + len, sizeof(json) - len, "}");
+    if (cfg.attack != BENCH_ATTACK_NONE) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        ",\"attack\":{\"scenario\":\"%s\",\"threads\":%d,\"rate_target\":%.0f,"
+                        "\"ops\":%lu,\"errors\":%lu,\"closed\":%lu}",
+                        bench_attack_names[cfg.attack], cfg.attack_threads, cfg.attack_rate,
+                        total.attack_ops, total.attack_errors, total.attack_closed);
+    }
+    snprintf(json + len, sizeof(json) - len, "}");
+
+    printf("%s: sent %lu, received %lu, lost %lu, %.1f qps\n"
+           "latency (us): p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+           cfg.tcp ? "tcp" : "udp", total.sent, total.received, total.lost,
+           total.received / elapsed,
+           bench_percentile(hist, total.received, 50), bench_percentile(hist, total.received, 90),
+           bench_percentile(hist, total.received, 99),
+           bench_percentile(hist, total.received, 99.9), total.lat_max_ns / 1000.0);
+    if (cfg.attack != BENCH_ATTACK_NONE) {
+        printf("attack %s: ops %lu, errors %lu, closed by server %lu\n",
+               bench_attack_names[cfg.attack], total.attack_ops, total.attack_errors,
+               total.attack_closed);
+    }
+
+    if (cfg.output != NULL) {
+        FILE *f = fopen(cfg.output, "a");
+
+        if (f == NULL) {
+            fprintf(stderr, "Could not open output file \"%s\", error message: %s\n",
+                    cfg.output, strerror(errno));
+            return 1;
+        }
+        fprintf(f, "%s\n", json);
+        fclose(f);
+    } else {
+        printf("%s\n", json);
+    }
+
+    free(threads);
+    free(attackers);
+    free(hist);
+    return 0;
+}
+
+/** @}*/
@@ -0,0 +1,124 @@
+/**
+ * @file acl.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup acl Client ACL
+ *
+ * @brief Client access control list decides, by query source address,
+ *        whether a query is answered, refused or dropped. It is checked
+ *        before query is parsed, so refused and dropped queries cost no
+ *        parsing work.
+ *
+ *        ACL is built by resource thread from an ACL file and is never
+ *        modified once built. Prefixes are compiled into an ECS map table,
+ *        see @ref ecs_map, a multibit trie with a 16 bit root stride
+ *        followed by 8 bit strides, so a check is a single longest prefix
+ *        match lookup, one memory access for prefixes up to /16.
+ *
+ *        ACL file format is one prefix per line:
+ *
+ *            <prefix>/<length> <action>
+ *
+ *        Action is one of "allow", "refuse" or "drop". Longest matching
+ *        prefix decides, addresses no prefix matches are allowed. Text
+ *        following a ';' character is a comment.
+ *
+ *  @{
+ */
+#ifndef ACL_H
+#define ACL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "ecs_map.h"
+
+/** Enumerated ACL actions. */
+typedef enum acl_action_e {
+    /** Query is parsed and answered. */
+    ACL_ACTION_ALLOW = 0,
+
+    /** Query is answered with REFUSED without being parsed. */
+    ACL_ACTION_REFUSE,
+
+    /** Query is dropped without being parsed, no response is sent. */
+    ACL_ACTION_DROP,
+
+    /** Number of ACL actions. */
+    ACL_ACTION_COUNT
+} acl_action_t;
+
+/** Structure describes client ACL. Once created it is read only. */
+typedef struct acl_s {
+    /** Generation number of ACL, assigned at creation. */
+    uint64_t generation;
+
+    /** Prefix table, table view labels are action names. */
+    ecs_map_t *table;
+
+    /** Action of each table view, indexed by table view number, entry 0 is
+     * action of addresses no prefix matches.
+     */
+    uint8_t actions[ACL_ACTION_COUNT + 1];
+} acl_t;
+
+acl_t * acl_create(const char *buf, size_t buf_len, uint64_t generation,
+                   char *err, size_t err_len);
+void acl_release(acl_t *acl);
+
+/** Check client address against ACL.
+ *
+ * @param acl ACL to check address against.
+ * @param ip  Client address.
+ *
+ * @return    Returns action to take on query from address.
+ */
+static inline acl_action_t
+acl_check(acl_t *acl, const struct sockaddr_storage *ip)
+{
+    return (acl_action_t)acl->actions[ecs_map_lookup_sockaddr(acl->table, ip)];
+}
+
+/** Check client address against ACL, and whether it is allowlisted, i.e.
+ * matches a prefix with "allow" action rather than being allowed because no
+ * prefix matches it.
+ *
+ * @param acl         ACL to check address against.
+ * @param ip          Client address.
+ * @param allowlisted Where to store whether address is allowlisted.
+ *
+ * @return            Returns action to take on query from address.
+ */
+static inline acl_action_t
+acl_check_allowlisted(acl_t *acl, const struct sockaddr_storage *ip, bool *allowlisted)
+{
+    uint16_t view = ecs_map_lookup_sockaddr(acl->table, ip);
+
+    *allowlisted = view != 0 && acl->actions[view] == ACL_ACTION_ALLOW;
+    return (acl_action_t)acl->actions[view];
+}
+
+#endif /* End of ACL_H */
+
+/** @}*/
@@ -0,0 +1,198 @@
+/**
+ * @file admin.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup admin Admin socket
+ *
+ * @brief These are functions that serve live vectorloop state over a Unix
+ *        socket, for introspection of a running process.
+ *
+ *        Each vectorloop publishes a snapshot of its state (@ref
+ *        admin_vl_state_t) once per iteration: queue lengths, active TCP
+ *        connections, query log fill, resource generations and loop timing.
+ *        Snapshots are published without locks, under a sequence counter
+ *        (seqlock): vectorloop makes the counter odd, stores the values and
+ *        makes it even again, and a reader retries while the counter is odd
+ *        or changed under it. Vectorloop never waits on a reader.
+ *
+ *        Admin thread listens on Unix socket set with "admin_socket", and
+ *        writes state of each vectorloop as text to every client that
+ *        connects, then closes the connection, e.g. "socat - UNIX:<path>".
+ *  @{
+ */
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+
+/** Values of vectorloop state snapshot. */
+typedef enum admin_vl_field_e {
+    /** Number of iterations vectorloop ran. */
+    ADMIN_VL_ITERATIONS = 0,
+
+    /** Loop coarse monotonic time in milliseconds of last iteration. */
+    ADMIN_VL_LOOP_TIME_MS,
+
+    /** CPU cycles between last two iterations, idle time included. */
+    ADMIN_VL_ITERATION_CYCLES,
+
+    /** Number of consecutive idle iterations. */
+    ADMIN_VL_IDLE_COUNT,
+
+    /** Overload level, see @ref vl_overload_level_t. */
+    ADMIN_VL_OVERLOAD_LEVEL,
+
+    /** Set once vectorloop started draining. */
+    ADMIN_VL_DRAINING,
+
+    /** Number of active TCP connections. */
+    ADMIN_VL_CONNS_TCP_ACTIVE,
+
+    /** Maximum number of active TCP connections. */
+    ADMIN_VL_CONNS_TCP_MAX,
+
+    /** Queue lengths, of UDP batches or TCP connections queued, at end of
+     * iteration.
+     */
+    ADMIN_VL_UDP_READ_QUEUE,
+    ADMIN_VL_UDP_WRITE_QUEUE,
+    ADMIN_VL_TCP_READ_QUEUE,
+    ADMIN_VL_TCP_WRITE_QUEUE,
+    ADMIN_VL_QUERY_PARSE_QUEUE,
+    ADMIN_VL_QUERY_RESOLVE_QUEUE,
+    ADMIN_VL_RESPONSE_PACK_QUEUE,
+    ADMIN_VL_QUERY_LOG_QUEUE,
+
+    /** Length of data in active query log chunk. */
+    ADMIN_VL_QUERY_LOG_BUF_LEN,
+
+    /** Size of query log chunk. */
+    ADMIN_VL_QUERY_LOG_BUF_SIZE,
+
+    /** Number of query log chunks published and not yet written out. */
+    ADMIN_VL_QUERY_LOG_CHUNKS_PENDING,
+
+    /** Number of chunks in query log ring. */
+    ADMIN_VL_QUERY_LOG_CHUNK_COUNT,
+
+    /** Generation of zone database vectorloop reads, 0 if there is none. */
+    ADMIN_VL_ZONE_DB_GENERATION,
+
+    /** Generation of configuration vectorloop runs with. */
+    ADMIN_VL_CONFIG_GENERATION,
+
+    /** Number of values. */
+    ADMIN_VL_FIELDS
+} admin_vl_field_t;
+
+/** State snapshot vectorloop publishes once per iteration, on a cache line
+ * of its own. Only vectorloop writes it.
+ */
+typedef struct admin_vl_state_s {
+    /** Sequence counter, odd while vectorloop is storing values. */
+    _Alignas(CACHE_LINE_SIZE) atomic_uint seq;
+
+    /** Snapshot values, indexed by @ref admin_vl_field_t. */
+    atomic_ullong values[ADMIN_VL_FIELDS];
+} admin_vl_state_t;
+
+/** Structure holds arguments passed to @ref admin_loop function. */
+typedef struct admin_loop_args_s {
+    /** Configuration settings to use. */
+    config_t *cfg;
+
+    /** State snapshots of vectorloops, indexed by vectorloop ID. */
+    admin_vl_state_t *vl_states;
+
+    /** Number of vectorloops. */
+    size_t vl_count;
+
+    /** Application log channel. */
+    channel_log_t *app_log_channel;
+} admin_loop_args_t;
+
+/** Start publishing state snapshot, marks it as being written.
+ *
+ * @param s State snapshot of vectorloop.
+ */
+static inline void
+admin_vl_publish_begin(admin_vl_state_t *s)
+{
+    atomic_store_explicit(&s->seq,
+                          atomic_load_explicit(&s->seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/** Store a value of state snapshot being published.
+ *
+ * @param s     State snapshot of vectorloop.
+ * @param field Value to store.
+ * @param value Value.
+ */
+static inline void
+admin_vl_set(admin_vl_state_t *s, admin_vl_field_t field, uint64_t value)
+{
+    atomic_store_explicit(&s->values[field], value, memory_order_relaxed);
+}
+
+/** Get a value of state snapshot, only meant for vectorloop publishing it.
+ *
+ * @param s     State snapshot of vectorloop.
+ * @param field Value to get.
+ *
+ * @return      Returns value last stored.
+ */
+static inline uint64_t
+admin_vl_get(admin_vl_state_t *s, admin_vl_field_t field)
+{
+    return atomic_load_explicit(&s->values[field], memory_order_relaxed);
+}
+
+/** End publishing state snapshot, readers see new values from now on.
+ *
+ * @param s State snapshot of vectorloop.
+ */
+static inline void
+admin_vl_publish_end(admin_vl_state_t *s)
+{
+    atomic_store_explicit(&s->seq,
+                          atomic_load_explicit(&s->seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+admin_vl_state_t * admin_vl_states_new(size_t count);
+int                admin_vl_read(admin_vl_state_t *s, uint64_t *values);
+size_t             admin_vl_format(admin_vl_state_t *states, size_t count,
+                                   char *buf, size_t buf_len);
+void             * admin_loop(void *args);
+
+#endif /* End of ADMIN_H */
+
+/** @}*/
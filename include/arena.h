@@ -0,0 +1,90 @@
+/**
+ * @file arena.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup arena Memory Arena
+ *
+ * @brief Memory arena is a single contiguous memory mapping that objects are
+ *        carved out of with a bump allocator. Objects are never freed one by
+ *        one, whole arena is released at once. Vectorloop carves per listener
+ *        vector state (read and write vectors, queries and their buffers) out
+ *        of its arena, so that state is laid out next to each other on as few
+ *        pages as possible rather than scattered over thousands of small heap
+ *        allocations, which lowers TLB misses.
+ *
+ *        Arena may be backed by explicit huge pages (MAP_HUGETLB), falling
+ *        back to regular pages if no huge pages are available, advised to be
+ *        backed by transparent huge pages, and prefaulted at creation so no
+ *        page is first touched while serving queries.
+ *  @{
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "constants.h"
+
+/** Arena flag, back arena with explicit huge pages (MAP_HUGETLB). */
+#define ARENA_HUGETLB  0x1
+
+/** Arena flag, advise arena to be backed by transparent huge pages. */
+#define ARENA_THP      0x2
+
+/** Arena flag, prefault arena pages at creation. */
+#define ARENA_PREFAULT 0x4
+
+/** Size of explicit huge page, arena backed by huge pages is rounded up to
+ * multiple of it.
+ */
+#define ARENA_HUGETLB_SIZE (2 * 1024 * 1024)
+
+/** Size of arena space object of given size takes. Every object is cache line
+ * aligned, so objects do not share cache lines.
+ */
+#define ARENA_OBJ_SIZE(size) \
+    (((size) + CACHE_LINE_SIZE - 1) & ~((size_t)CACHE_LINE_SIZE - 1))
+
+/** Structure describes a memory arena. */
+typedef struct arena_s {
+    /** Start of arena memory, NULL if arena is not initialized. */
+    unsigned char *base;
+
+    /** Size of arena memory. */
+    size_t size;
+
+    /** Number of bytes allocated from arena. */
+    size_t used;
+
+    /** Set if arena is backed by explicit huge pages. */
+    bool hugetlb;
+} arena_t;
+
+int   arena_init(arena_t *arena, size_t size, int flags);
+void  arena_clean(arena_t *arena);
+void *arena_alloc(arena_t *arena, size_t size);
+
+#endif /* End of ARENA_H */
+
+/** @}*/
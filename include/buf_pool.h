@@ -0,0 +1,88 @@
+/**
+ * @file buf_pool.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup buf_pool Buffer Pool
+ *
+ * @brief Buffer pool hands out buffers of a few size classes and keeps
+ *        returned buffers in per size class free lists for reuse.
+ *
+ *        Size classes are powers of two multiples of minimum class size, with
+ *        largest class capped to maximum buffer size. A buffer is requested
+ *        by minimum size it must hold and smallest size class that holds it
+ *        is handed out. Free buffers are linked via their first bytes, and a
+ *        size class keeps at most a set number of them, any above that are
+ *        freed when returned.
+ *
+ *        Vectorloop uses it for TCP query responses that do not fit into
+ *        response buffer query owns, so growing a response buffer takes a
+ *        buffer off a free list rather than calling realloc(). Pool is owned
+ *        by a single vectorloop thread so no locking is done.
+ *  @{
+ */
+#ifndef BUF_POOL_H
+#define BUF_POOL_H
+
+#include <stddef.h>
+
+#include "mem.h"
+
+/** Maximum number of buffer pool size classes. */
+#define BUF_POOL_CLASSES_MAX 8
+
+/** Structure describes a buffer pool size class. */
+typedef struct buf_pool_class_s {
+    /** Size of buffers in size class. */
+    size_t size;
+
+    /** First free buffer, free buffers are linked via their first bytes. */
+    void *free_head;
+
+    /** Number of buffers in free list. */
+    size_t free_count;
+} buf_pool_class_t;
+
+/** Structure describes a buffer pool. */
+typedef struct buf_pool_s {
+    /** Size classes, smallest first. */
+    buf_pool_class_t classes[BUF_POOL_CLASSES_MAX];
+
+    /** Number of size classes. */
+    int classes_count;
+
+    /** Maximum number of free buffers a size class keeps. */
+    size_t free_max;
+
+    /** Memory tag buffers are accounted to. */
+    mem_tag_t tag;
+} buf_pool_t;
+
+void   buf_pool_init(buf_pool_t *pool, size_t size_min, size_t size_max, size_t free_max,
+                     mem_tag_t tag);
+void   buf_pool_clean(buf_pool_t *pool);
+void * buf_pool_get(buf_pool_t *pool, size_t size, size_t *buf_size);
+void   buf_pool_put(buf_pool_t *pool, void *buf, size_t buf_size);
+
+#endif /* End of BUF_POOL_H */
+
+/** @}*/
@@ -25,136 +25,165 @@
 /** \defgroup channels Channels
  * 
  * @brief Channels are ways of exchanging data between threads. 
- *        libfsds (Lock Free Data Structures) are used to form channels and
- *        exchange transactions or uni-directional messages.
- * 
- *        Resource channel(s) are used to notify DNS query processing threads
- *        when a resource has changed. Messages are transactional in nature
- *        (request-response).
- * 
- *        Query log channel is used to notify DNS query aprocessing threads when
- *        to flip query log buffers.
  * 
  *        Log channel is used to send uni-directional log messages to application
  *        logging thread which in turn logs messages to file (disk).
+ * 
+ *        Log channel is a single producer single consumer ring of fixed size
+ *        message slots. Messages are formatted directly into a slot, so sending
+ *        a message does not allocate memory. Sender can write several messages
+ *        and publish them all at once with @ref channel_log_flush(), and
+ *        logging thread receives all published messages in a single call and
+ *        releases their slots once they are written to disk. Sender wakes up
+ *        logging thread through an eventfd only when channel goes from empty
+ *        to non-empty, so logging thread sleeps while there is nothing to log
+ *        and drains bursts right away.
+ * 
+ *        Errors that can occur at a high rate, such as socket errors, are
+ *        only counted in log channel and logging thread logs a summary of
+ *        them periodically, see @ref channel_log_error().
+ *
+ *        Connection channel is used to hand off TCP connections from one
+ *        vectorloop to another. It is a single producer single consumer ring
+ *        of fixed size slots, same as log channel, each slot carrying a
+ *        connection socket and state connection carries across vectorloops.
  *  @{
  */
 #ifndef CHANNEL_H
 #define CHANNEL_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-
-#include <liblfds711.h>
+#include <time.h>
 
 #include "constants.h"
 
-/** Enumerated bss channel operation codes. */
-typedef enum channel_bss_ops_e {
-    /** Op code for resource 1. */
-    CH_OP_RES_SET_RESOURCE1 = 0,
-
-    /** Op code for resource 2. */
-    CH_OP_RES_SET_RESOURCE2,
-
-    /** Op code for query log flip. */
-    CH_OP_QUERY_LOG_FLIP
-} channel_bss_ops_t;
-
-/** Structure describes an bss channel message. */
-typedef struct channel_bss_msg_s {
-    /** Message ID. */
-    uint64_t id;
-
-    /** Operation this message is for. */
-    channel_bss_ops_t op;
-
-    /** Pointer to data relating to specific operation.
-     * For resource messages sender sets this to point to new data.
-     * For query log flip messages responder sets this to buffer that has data
-     * to be logged.
-    */
-    void *p;
-
-    /** Result of the operation.
-     * For resource messages sender (bss) sets this to 0, and
-     * responder sets this to: 0 - error, 1 - success.
-     * For query log flip messages responder sets this to length of data in
-     * query log buffer.
-     */
-    size_t result;
-} channel_bss_msg_t;
-
-/** Structure describes an bss bonded channel queue. */
-typedef struct channel_bss_queue_s {
-    /** Channel queue. */
-    struct lfds711_queue_bss_element qbsse[CHANNEL_BSS_QUEUE_LEN];
-
-    /** Channel state*/
-    struct lfds711_queue_bss_state qbsss;
-} channel_bss_queue_t;
-
-/** Structure describes an bss channel, Channel has two queues. Each queue is
- * unidirectional.
- */
-typedef struct channel_bss_s {
-    /** Admin queue, used by admin to send messages to vectorloop. 
-     * Vectorloop reads messages from this queue.
-     */
-    channel_bss_queue_t bss;
- 
-    /** Vectorloop queue, used by vectorloop to send messages to bss.
-     * Admin reads messages from this queue.
-     */
-    channel_bss_queue_t vl;
-} channel_bss_t;
-
-
-channel_bss_msg_t * channel_bss_msg_create(uint64_t id,
-                                               channel_bss_ops_t op,
-                                               void *p);
-void     channel_bss_msg_release(channel_bss_msg_t *msg);
-int      channel_bss_send(channel_bss_t *ch, channel_bss_msg_t *msg);
-int      channel_bss_recv(channel_bss_t *ch, channel_bss_msg_t **msg);
-int      channel_bssvl_send(channel_bss_t *ch, channel_bss_msg_t *msg);
-int      channel_bssvl_recv(channel_bss_t *ch, channel_bss_msg_t **msg);
-uint64_t channel_bss_assign_msg_id(uint64_t *id_base);
-
-
-/** Structure describes a log channel message. */
+/** Structure describes a log channel message slot. */
 typedef struct channel_log_msg_s {
     /** ID of one of the predefined log messages. If set (!= 0)
-     * then the predefined message is logged. Otherwise string pointed to by
-     * log_msg is logged.
+     * then the predefined message is logged. Otherwise string in log_msg is
+     * logged.
     */
     uint32_t log_msg_id;
 
-    /** Pointer to data that is to be logged. This must be a continuous buffer
-     * which is freed once logged to disk. Can be NULL.
+    /** Parameter of predefined message, errno of error message reports or 0
+     * if it has none. Logging thread formats it, so sender does not format
+     * strings.
      */
-    char *log_msg;
+    int32_t log_msg_param;
+
+    /** Length of string in log_msg. */
+    uint16_t log_msg_len;
 
     /** Indicates if this is fatal error which indicates that once logged
      * program should exit.
      */
     bool exit;
+
+    /** Message string, truncated to fit slot. Not used if log_msg_id is set. */
+    char log_msg[CHANNEL_LOG_MSG_LEN];
 } channel_log_msg_t;
 
 /** Structure describes a log channel.  */
 typedef struct channel_log_s {
-   /** Channel queue. */
-    struct lfds711_queue_bss_element qbsse[CHANNEL_LOG_QUEUE_LEN];
+    /** Ring of message slots, message n is in slot n % CHANNEL_LOG_QUEUE_LEN. */
+    channel_log_msg_t msgs[CHANNEL_LOG_QUEUE_LEN];
+
+    /** Number of messages written but not yet published by sender, only
+     * sender uses it.
+     */
+    uint64_t pending;
+
+    /** Number of messages dropped as channel was full, only sender writes
+     * it.
+     */
+    atomic_ullong dropped;
+
+    /** Number of rate limited errors counted so far per error ID, see
+     * @ref app_log_err_id_t. Errors are not sent as messages, only sender
+     * writes counters and logging thread periodically logs how much they
+     * increased.
+     */
+    atomic_ullong errors[CHANNEL_LOG_ERR_COUNT];
+
+    /** errno of last error counted per error ID. */
+    atomic_int errors_errno[CHANNEL_LOG_ERR_COUNT];
+
+    /** Eventfd written to when channel goes from empty to non-empty, to wake
+     * up logging thread. Logging thread shares one eventfd for all channels,
+     * -1 if logging thread polls channels.
+     */
+    int wake_fd;
+
+    /** Number of messages published, only sender writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong head;
 
-    /** Channel state*/
-    struct lfds711_queue_bss_state qbsss;
+    /** Number of messages received and released, only logging thread writes
+     * it.
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong tail;
 } channel_log_t;
 
-channel_log_msg_t * channel_log_msg_create(uint32_t log_msg_id, char *log_msg,
-                                           bool exit);
-void channel_log_msg_release(channel_log_msg_t *msg);
-int  channel_log_send(channel_log_t *ch, channel_log_msg_t *msg);
-int  channel_log_recv(channel_log_t *ch, channel_log_msg_t **msg);
+/** Structure describes a connection channel message slot, a TCP connection
+ * handed off from one vectorloop to another.
+ */
+typedef struct channel_conn_msg_s {
+    /** Connection socket, ownership passes to receiver. */
+    int fd;
+
+    /** Connection IP version, 0 for IPv4 and 1 for IPv6. */
+    int ip_version;
+
+    /** Indicates if connection is a DoT connection, with kernel TLS
+     * installed on socket.
+     */
+    bool tls;
+
+    /** TCP keepalive as advertised in EDNS tcp-keepalive, 0 if none. */
+    size_t tcp_keepalive;
+
+    /** Number of queries received and processed over connection so far. */
+    size_t queries_total_count;
+
+    /** Number of bytes read from and written to connection so far. */
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+
+    /** Time connection was established. */
+    struct timespec start_time;
+} channel_conn_msg_t;
+
+/** Structure describes a connection channel. */
+typedef struct channel_conn_s {
+    /** Ring of message slots, message n is in slot n % CHANNEL_CONN_QUEUE_LEN. */
+    channel_conn_msg_t msgs[CHANNEL_CONN_QUEUE_LEN];
+
+    /** Number of messages sent, only sender writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong head;
+
+    /** Number of messages received, only receiver writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong tail;
+} channel_conn_t;
+
+void   channel_log_init(channel_log_t *ch, int wake_fd);
+int    channel_log_write(channel_log_t *ch, uint32_t log_msg_id, bool exit,
+                         const char *fmt, ...)
+                         __attribute__((format(printf, 4, 5)));
+int    channel_log_write_id(channel_log_t *ch, uint32_t log_msg_id, int32_t param, bool exit);
+void   channel_log_error(channel_log_t *ch, uint32_t err_id, int err_no);
+void   channel_log_flush(channel_log_t *ch);
+int    channel_log_send(channel_log_t *ch, uint32_t log_msg_id, bool exit,
+                        const char *fmt, ...)
+                        __attribute__((format(printf, 4, 5)));
+size_t channel_log_recv(channel_log_t *ch, channel_log_msg_t **msgs, size_t msgs_len);
+void   channel_log_release(channel_log_t *ch, size_t count);
+bool   channel_log_empty(channel_log_t *ch);
+
+void   channel_conn_init(channel_conn_t *ch);
+bool   channel_conn_send(channel_conn_t *ch, const channel_conn_msg_t *msg);
+bool   channel_conn_recv(channel_conn_t *ch, channel_conn_msg_t *msg);
 
 #endif /* End of  CHANNEL_H */
 
@@ -31,6 +31,13 @@
  * 
  *        Default settings are stored as constants in @ref constants.h file.
  *        Not all settings have CLI option equivalent.
+ * 
+ *        Settings vectorloops read as they go, such as loop budgets and TCP
+ *        timeouts, can also be set in configuration file which is reloaded
+ *        without restart, see @ref config_reload(). Reloaded configuration
+ *        is a copy of configuration object application was started with,
+ *        with settings from configuration file applied on top, and is
+ *        published to vectorloops as a resource.
  *  @{
  */
 #ifndef CONFIG_H
@@ -41,6 +48,7 @@
 #include <stdint.h>
 
 #include "constants.h"
+#include "utils.h"
 
 /** Structure describes application configuration object. */
 typedef struct config_s {
@@ -56,11 +64,111 @@ typedef struct config_s {
     /** UDP socket send buffer size. */
     size_t udp_socket_sendbuff_size;
 
+    /** UDP socket SO_BUSY_POLL time in microseconds, 0 leaves it unset. */
+    size_t udp_socket_busy_poll;
+
+    /** Size UDP listener receive buffer is raised up to when kernel drops
+     * datagrams because it is full, 0 disables raising it.
+     */
+    size_t udp_socket_recvbuff_autotune_max;
+
+    /** IP address of shadow server received UDP queries are mirrored to,
+     * NULL if queries are not mirrored, see @ref vlmirror.
+     */
+    char *udp_mirror_ip;
+
+    /** UDP port of shadow server queries are mirrored to. */
+    uint16_t udp_mirror_port;
+
+    /** Mirror one in this many received UDP queries. */
+    uint32_t udp_mirror_sample_rate;
+
+    /** Take query receive time from kernel receive timestamp (SO_TIMESTAMPNS)
+     * of UDP and TCP listeners.
+     */
+    bool listener_rx_timestamps;
+
     /** Number of entries in UDP receive vector. This setting
      * is also used to size UDP write vector and UDP queries vector.
      */
     size_t udp_conn_vector_len;
 
+    /** Minimum vector length UDP listener adapts length of its receive vector
+     * down to, 0 disables adapting.
+     */
+    size_t udp_conn_vector_len_min;
+
+    /** Number of batches (read, query and write vectors) each UDP listener
+     * receives into, see @ref conn_udp_t.
+     */
+    size_t udp_listener_batches;
+
+    /** Number of UDP queries run through parse, resolve and response pack
+     * together before next batch of connection's vector, 0 runs each step
+     * over all connections before next step.
+     */
+    size_t udp_pipeline_batch_len;
+
+    /** Send consecutive responses to same client as one UDP GSO message. */
+    bool udp_gso;
+
+    /** Receive UDP queries of both IP versions on a single dual stack IPv6
+     * listener per vectorloop.
+     */
+    bool udp_dual_stack;
+
+    /** Addresses UDP listeners are bound to, one listener socket per address
+     * (prefix length is that of a single address), NULL if UDP listeners are
+     * bound to any address.
+     */
+    utl_net_t *udp_listener_addresses;
+
+    /** Number of entries in udp_listener_addresses array. */
+    size_t udp_listener_addresses_count;
+
+    /** Listener tuning profiles of configuration option
+     * "listener_profiles_file", NULL if there are none. Profile is referred
+     * to by its index + 1, 0 is no profile.
+     */
+    struct config_listener_profile_s *listener_profiles;
+
+    /** Number of entries in listener_profiles array. */
+    size_t listener_profiles_count;
+
+    /** Profile of each address of udp_listener_addresses, NULL if there are
+     * no profiles.
+     */
+    uint8_t *udp_listener_addresses_profile;
+
+    /** Profile of UDP listeners bound to any address. */
+    uint8_t listener_profile_udp;
+
+    /** Profile of TCP listeners. */
+    uint8_t listener_profile_tcp;
+
+    /** Profile of DNS over TLS listeners. */
+    uint8_t listener_profile_dot;
+
+    /** Network interface UDP queries are received and sent on via AF_XDP
+     * sockets, NULL if AF_XDP is not used.
+     */
+    char *xdp_interface;
+
+    /** Time in microseconds AF_XDP sockets busy poll network device for,
+     * 0 if sockets are interrupt driven.
+     */
+    size_t xdp_busy_poll;
+
+    /** Number of responses in-kernel responder map of XDP program holds, 0
+     * if XDP program does not answer queries itself, see @ref vlxdp.
+     */
+    size_t xdp_responder_size;
+
+    /** Number of response cache hits after which vectorloop adds response
+     * to in-kernel responder map, again.
+     */
+    size_t xdp_responder_hits;
+
     /** Flag to indicate if receiving DNS queries over TCP should be enabled. */
     bool tcp_enable;
  
@@ -69,6 +177,22 @@ typedef struct config_s {
      */
     int tcp_listener_pending_conns_max;
 
+    /** Maximum number of pending TCP Fast Open connections, passed as
+     * socket option TCP_FASTOPEN to TCP listeners. 0 leaves option unset.
+     */
+    int tcp_listener_fastopen;
+
+    /** Seconds passed as socket option TCP_DEFER_ACCEPT to TCP listeners,
+     * connections are accepted only once they have data. 0 leaves option unset.
+     */
+    int tcp_listener_defer_accept;
+
+    /** Bytes passed as socket option TCP_NOTSENT_LOWAT to TCP listeners, and
+     * inherited by accepted connections. Connection socket is reported
+     * writable only once unsent data is below it. 0 leaves option unset.
+     */
+    int tcp_listener_notsent_lowat;
+
     /** TCP listener port. */
     uint16_t tcp_listener_port;
 
@@ -117,6 +241,11 @@ typedef struct config_s {
      */
     size_t tcp_keepalive;
 
+    /** Percent of tcp_conns_per_vl_max from which TCP idle timeout advertised
+     * in EDNS tcp-keepalive shrinks, 100 if it does not.
+     */
+    size_t tcp_keepalive_shrink_start;
+
     /**  Number of miliseconds TCP connection will wait to receive a full query.
      * This timeout applies when connection is first created, and also when
      * a subsequent partial query is received. 
@@ -129,12 +258,101 @@ typedef struct config_s {
      */
     size_t tcp_query_send_timeout;
 
+    /** Hand off idle TCP connections from busy vectorloops to least loaded
+     * vectorloop.
+     */
+    bool tcp_handoff;
+
+    /** Percent by which vectorloop load must exceed load of least loaded
+     * vectorloop for TCP connections to be handed off.
+     */
+    size_t tcp_handoff_threshold;
+
+    /** Maximum number of TCP connections per client network per vectorloop,
+     * 0 if not limited.
+     */
+    size_t tcp_conns_per_client_max;
+
+    /** Prefix length IPv4 clients are grouped by for TCP connection limit. */
+    unsigned int tcp_conns_client_ipv4_prefix_len;
+
+    /** Prefix length IPv6 clients are grouped by for TCP connection limit. */
+    unsigned int tcp_conns_client_ipv6_prefix_len;
+
+    /** Close oldest idle TCP connection to make room for a new one once
+     * vectorloop holds tcp_conns_per_vl_max connections.
+     */
+    bool tcp_conns_idle_evict;
+
+    /** Flag to indicate if receiving DNS queries over TLS should be enabled. */
+    bool dot_enable;
+
+    /** DNS over TLS listener port. */
+    uint16_t dot_listener_port;
+
+    /** Path to PEM file with certificate chain DoT listeners present. */
+    char *dot_cert_file;
+
+    /** Path to PEM file with private key of DoT server certificate. */
+    char *dot_key_file;
+
+    /** Number of TLS handshake threads per vectorloop. */
+    size_t dot_handshake_threads;
+
+    /** Number of miliseconds TLS handshake of a DoT connection has to
+     * complete in.
+     */
+    size_t dot_handshake_timeout;
+
+    /** Number of worker threads per vectorloop, deferred queries wait for. */
+    size_t worker_threads;
+
+    /** Path to PEM file with private key answers are signed with online,
+     * NULL if answers are not signed online.
+     */
+    char *dnssec_key_file;
+
+    /** Zone (apex name) online signing key belongs to. */
+    char *dnssec_signer_name;
+
+    /** Number of RRSIG records in signature cache of each vectorloop. */
+    size_t dnssec_sig_cache_size;
+
+    /** Number of seconds online signatures are valid for. */
+    size_t dnssec_sig_validity;
+
+    /** Number of NSEC3 hashes in NSEC3 hash cache of each vectorloop. */
+    size_t dnssec_nsec3_cache_size;
+
     /** Maximum number of TCP events epoll will return in a vectorloop iteration.*/
     int epoll_num_events_tcp;
 
     /** Maximum number of UDP events epoll will return in a vectorloop iteration.*/
     int epoll_num_events_udp;
 
+    /** Maximum number of UDP datagrams read in per vectorloop iteration,
+     * 0 means no limit.
+     */
+    size_t loop_budget_udp_datagrams;
+
+    /** Maximum number of TCP connections read from per vectorloop iteration,
+     * 0 means no limit.
+     */
+    size_t loop_budget_tcp_reads;
+
+    /** Maximum number of new TCP connections accepted per vectorloop
+     * iteration, 0 means no limit.
+     */
+    size_t loop_budget_tcp_accepts;
+
+    /** Maximum number of zone transfer bytes sent per vectorloop iteration,
+     * across TCP connections, 0 means no limit.
+     */
+    size_t loop_budget_xfr_bytes;
+
+    /** Send query responses via io_uring instead of sendmmsg() and sendmsg(). */
+    bool io_uring_enable;
+
     /** Number of vectorloop (DNS query processing) threads to start. */
     size_t process_thread_count;
 
@@ -143,24 +361,275 @@ typedef struct config_s {
     */
     size_t *process_thread_masks;
 
-    /** Sleep time in microseconds for loop slowdown stage one. */
-    size_t loop_slowdown_one;
+    /** Array of vectorloop roles, one for each thread, mask of VL_ROLE_* flags
+     * selecting listeners thread runs.
+     */
+    uint8_t *process_thread_roles;
+
+    /** Steer queries to listeners of vectorloop bound to CPU that received
+     * them, via reuseport BPF program.
+     */
+    bool process_thread_cpu_steering;
+
+    /** Steer queries to listeners of vectorloop picked by hash of client
+     * address prefix, via reuseport BPF program.
+     */
+    bool process_thread_client_steering;
+
+    /** Bind vectorloops not bound by process_thread_masks to CPUs picked
+     * from CPU topology, see @ref topology_vl_place.
+     */
+    bool process_thread_auto_pin;
+
+    /** Network interface auto pinning places vectorloops near, NULL for
+     * xdp_interface.
+     */
+    char *process_thread_auto_pin_interface;
+
+    /** CPU list support threads are bound to, NULL for no binding. */
+    char *process_housekeeping_cpus;
+
+    /** Scheduling policy of vectorloop threads, SCHED_OTHER, SCHED_FIFO or
+     * SCHED_RR.
+     */
+    int process_thread_sched_policy;
 
-    /** Sleep time in microseconds for loop slowdown stage two. */
-    size_t loop_slowdown_two;
+    /** Real-time priority of vectorloop threads with SCHED_FIFO or SCHED_RR
+     * policy.
+     */
+    int process_thread_sched_priority;
+
+    /** Milliseconds a real-time vectorloop runs without blocking before it
+     * sleeps for @ref VL_RT_YIELD_US.
+     */
+    size_t process_thread_rt_run_max;
 
-    /** Sleep time in microseconds for loop slowdown stage three. */
-    size_t loop_slowdown_three;
+    /** Lock all process memory with mlockall(). */
+    bool process_mlockall;
 
-    /** Name of resource 1. */
+    /** Number of worker processes, each running process_thread_count
+     * vectorloops, 0 runs vectorloops as threads of a single process. See
+     * @ref prefork.
+     */
+    size_t process_workers;
+
+    /** Index of worker process this is, 0 when not running worker
+     * processes. Set by master process when it starts worker, not an option.
+     */
+    size_t process_worker_id;
+
+    /** Time in microseconds an idle vectorloop spins before it blocks in
+     * epoll_wait(), 0 disables spinning.
+     */
+    size_t loop_idle_spin;
+
+    /** Maximum time in milliseconds an idle vectorloop blocks in epoll_wait(). */
+    size_t loop_idle_wait_max;
+
+    /** Tune udp_conn_vector_len, epoll_num_events_udp, epoll_num_events_tcp
+     * and loop_idle_spin at startup, see @ref vlcalibrate.
+     */
+    bool loop_calibrate;
+
+    /** Vectorloop iteration time in microseconds calibration keeps 99th
+     * percentile under while maximizing throughput.
+     */
+    size_t loop_calibrate_latency;
+
+    /** Advise transparent huge pages for large vectorloop buffers. */
+    bool loop_hugepages;
+
+    /** Back UDP listener arena with explicit huge pages. */
+    bool loop_hugetlb;
+
+    /** Prefault UDP listener arena and large vectorloop buffers when they
+     * are allocated.
+     */
+    bool loop_prefault;
+
+    /** Lock UDP listener arena and large vectorloop buffers in memory. */
+    bool loop_mlock;
+
+    /** Time vectorloop stages with CPU cycle counter, see
+     * @ref metrics_vl_stage_t.
+     */
+    bool loop_stage_metrics;
+
+    /** Memory budget in megabytes, 0 if none. */
+    size_t memory_budget;
+
+    /** Name of resource 1, zone database. */
     char  *resource_1_name;
 
-    /** Full file path for resource 1. */
+    /** Full file path for resource 1, zone file. */
     char  *resource_1_filepath;
 
     /** Frequency at which to check for updated resource 1. */
     size_t resource_1_update_freq;
 
+    /** Full file path for resource 1 delta file, zone delta file applied on
+     * top of zone file. Empty string means there is no zone delta file.
+     */
+    char  *resource_1_delta_filepath;
+
+    /** Full file path of zone image to compile zone file into. When set
+     * application compiles zone file into zone image and exits. Empty string
+     * means application runs as usual.
+     */
+    char  *zone_image_compile_filepath;
+
+    /** Fault in zone database once loaded, before it is published. */
+    bool zone_prefault;
+
+    /** Lock zone database in memory once loaded. */
+    bool zone_mlock;
+
+    /** Number of threads zone file is parsed and compiled on, resource
+     * thread and helper threads it starts for each load.
+     */
+    unsigned int zone_compile_threads;
+
+    /** Networks clients allowed to transfer zones (AXFR, IXFR) are in. */
+    utl_net_t *zone_transfer_allow;
+
+    /** Number of entries in zone_transfer_allow array, 0 means zone
+     * transfers are refused.
+     */
+    size_t zone_transfer_allow_count;
+
+    /** Comma separated names of zones served as secondary, transferred from
+     * zone primary. Empty string means there are no secondary zones.
+     */
+    char  *zone_secondary;
+
+    /** Address of zone primary secondary zones are transferred from, family
+     * 0 means there is none.
+     */
+    utl_net_t zone_primary;
+
+    /** TCP port of zone primary. */
+    size_t zone_primary_port;
+
+    /** Name of resource 2, ECS map. */
+    char  *resource_2_name;
+
+    /** Full file path for resource 2, ECS map file. Empty string means ECS
+     * map is not loaded.
+     */
+    char  *resource_2_filepath;
+
+    /** Frequency at which to check for updated resource 2. */
+    size_t resource_2_update_freq;
+
+    /** Name of resource 3, configuration file. */
+    char  *resource_3_name;
+
+    /** Full file path for resource 3, configuration file with reloadable
+     * settings. Empty string means there is no configuration file.
+     */
+    char  *resource_3_filepath;
+
+    /** Frequency at which to check for updated resource 3. */
+    size_t resource_3_update_freq;
+
+    /** Name of resource 4, view set. */
+    char  *resource_4_name;
+
+    /** Full file path for resource 4, view file. Empty string means there
+     * are no views.
+     */
+    char  *resource_4_filepath;
+
+    /** Frequency at which to check for updated resource 4. */
+    size_t resource_4_update_freq;
+
+    /** Name of resource 5, client ACL. */
+    char  *resource_5_name;
+
+    /** Full file path for resource 5, ACL file. Empty string means there is
+     * no client ACL.
+     */
+    char  *resource_5_filepath;
+
+    /** Frequency at which to check for updated resource 5. */
+    size_t resource_5_update_freq;
+
+    /** Name of resource 6, response policy. */
+    char  *resource_6_name;
+
+    /** Full file path for resource 6, policy file. Empty string means there
+     * is no response policy.
+     */
+    char  *resource_6_filepath;
+
+    /** Frequency at which to check for updated resource 6. */
+    size_t resource_6_update_freq;
+
+    /** Name of resource 7, GeoIP database. */
+    char  *resource_7_name;
+
+    /** Full file path for resource 7, MaxMind DB file. Empty string means
+     * there is no GeoIP database.
+     */
+    char  *resource_7_filepath;
+
+    /** Frequency at which to check for updated resource 7. */
+    size_t resource_7_update_freq;
+
+    /** Name of resource 8, load balancing candidate sets. */
+    char  *resource_8_name;
+
+    /** Full file path for resource 8, load balancing file. Empty string
+     * means there are no load balanced names.
+     */
+    char  *resource_8_filepath;
+
+    /** Frequency at which to check for updated resource 8. */
+    size_t resource_8_update_freq;
+
+    /** Interval in seconds health checker probes load balancing endpoints
+     * at, see @ref lb.
+     */
+    size_t lb_check_interval;
+
+    /** Time in milliseconds load balancing endpoint probe waits for TCP
+     * connect to complete.
+     */
+    size_t lb_check_timeout;
+
+    /** Name of resource 9, zone catalog. */
+    char  *resource_9_name;
+
+    /** Full file path for resource 9, zone catalog file. Empty string means
+     * there is no zone catalog.
+     */
+    char  *resource_9_filepath;
+
+    /** Frequency at which to check for updated resource 9, catalog file and
+     * zone files of its zones.
+     */
+    size_t resource_9_update_freq;
+
+    /** Generation of configuration, 0 for configuration application was
+     * started with, incremented each time configuration file is reloaded.
+     */
+    uint64_t generation;
+
+    /** Path of Unix socket listener sockets are handed over to new process
+     * on upgrade. Empty string means upgrades are disabled.
+     */
+    char  *upgrade_socket;
+
+    /** Path of Unix socket admin thread serves vectorloop state on, see
+     * @ref admin. Empty string means admin socket is disabled.
+     */
+    char  *admin_socket;
+
+    /** Maximum time in seconds application drains for before it exits, see
+     * @ref vldrain.
+     */
+    size_t drain_time;
+
     /** Name to use for application log.  */
     char *application_log_name;
 
@@ -173,6 +642,9 @@ typedef struct config_s {
     /** Query log buffer size. */
     size_t query_log_buffer_size;
 
+    /** Number of query log buffers per vectorloop. */
+    size_t query_log_buffer_count;
+
     /** Query log base name. */
     char *query_log_base_name;
 
@@ -185,12 +657,225 @@ typedef struct config_s {
     /** Size at which to rotate query log. */
     size_t query_log_rotate_size;
 
+    /** Log one in this many queries that pass query log filters. */
+    uint32_t query_log_sample_rate;
+
+    /** Mask of rcodes to log queries for, bit N set logs rcode N, and
+     * @ref QUERY_LOG_RCODE_NORESPONSE logs queries no response was sent for.
+     */
+    uint32_t query_log_rcodes;
+
+    /** Mask of question types to log queries for, bit N set logs type N.
+     * @ref QUERY_LOG_QTYPES_ALL logs all types.
+     */
+    uint64_t query_log_qtypes;
+
+    /** Do not log NOERROR queries, unless slower than query_log_latency_min. */
+    bool query_log_errors_only;
+
+    /** Only log NOERROR queries with latency of at least this many
+     * microseconds, 0 if disabled.
+     */
+    uint32_t query_log_latency_min;
+
+    /** Write query log files with O_DIRECT. */
+    bool query_log_direct_io;
+
+    /** Write query log files with vmsplice and splice instead of write. */
+    bool query_log_splice;
+
+    /** Compress query log with gzip. */
+    bool query_log_compress;
+
+    /** IP address of remote collector to stream query log to, NULL if query
+     * log is written to files.
+     */
+    char *query_log_remote_ip;
+
+    /** TCP port of remote query log collector. */
+    uint16_t query_log_remote_port;
+
+    /** Path of Unix socket of remote collector to stream query log to, NULL
+     * if not set.
+     */
+    char *query_log_remote_unix;
+
+    /** Query log format, QUERY_LOG_FORMAT_TEXT, QUERY_LOG_FORMAT_DNSTAP or
+     * QUERY_LOG_FORMAT_ARROW.
+     */
+    uint8_t query_log_format;
+
+    /** Path prefix of shared memory files query log buffers are mapped from,
+     * NULL if not set.
+     */
+    char *query_log_shm_path;
+
+    /** Upper bound on age of logged queries not yet handed to disk, in
+     * milliseconds, 0 if not bounded.
+     */
+    uint32_t query_log_age_max;
+
+    /** What vectorloop does when query log ring is full, one of
+     * QUERY_LOG_FULL_DROP, QUERY_LOG_FULL_SPILL or QUERY_LOG_FULL_SAMPLE.
+     */
+    uint8_t query_log_full_policy;
+
+    /** Size of per vectorloop query log spill buffer. */
+    size_t query_log_spill_size;
+
+    /** Log one in this many queries while query log ring is full. */
+    uint32_t query_log_full_sample_rate;
+
+    /** Write sparse index next to each query log file. */
+    bool query_log_index;
+
+    /** Maximum number of queries in an indexed query log block. */
+    uint32_t query_log_index_records;
+
+    /** Number of entries in per vectorloop response cache, 0 if disabled. */
+    size_t response_cache_size;
+
+    /** Number of entries in response cache shared by all vectorloops, 0 if
+     * disabled.
+     */
+    size_t response_cache_shared_size;
+
+    /** Path response cache snapshot of each vectorloop is written to on
+     * drain, and warmed from on start, followed by ".<vectorloop ID>". NULL
+     * if not set.
+     */
+    char *response_cache_snapshot_path;
+
+    /** Responses per second allowed to a client network per response class,
+     * 0 if response rate limiting is disabled.
+     */
+    unsigned int rrl_responses_per_second;
+
+    /** Every rrl_slip-th response over the rate limit is sent truncated, 0
+     * to drop them all.
+     */
+    unsigned int rrl_slip;
+
+    /** Prefix length IPv4 clients are grouped by for rate limiting. */
+    unsigned int rrl_ipv4_prefix_len;
+
+    /** Prefix length IPv6 clients are grouped by for rate limiting. */
+    unsigned int rrl_ipv6_prefix_len;
+
+    /** Number of entries in per vectorloop rate limiting table. */
+    size_t rrl_table_size;
+
+    /** Mean busy vectorloop iteration time in microseconds above which
+     * vectorloop is overloaded and sheds work, 0 if overload shedding is
+     * disabled.
+     */
+    size_t overload_iteration_max;
+
+    /** Every overload_slip-th UDP query shed by client is answered with a
+     * truncated response, 0 to drop them all.
+     */
+    unsigned int overload_slip;
+
+    /** Objective of median query latency of each vectorloop in
+     * microseconds, 0 if there is none.
+     */
+    size_t slo_latency_p50;
+
+    /** Objective of 99th percentile query latency of each vectorloop in
+     * microseconds, 0 if there is none.
+     */
+    size_t slo_latency_p99;
+
+    /** Objective of 99.9th percentile query latency of each vectorloop in
+     * microseconds, 0 if there is none.
+     */
+    size_t slo_latency_p999;
+
+    /** Number of seconds in rolling window latency SLO is evaluated over. */
+    unsigned int slo_window;
+
+    /** Answer EDNS cookie option. */
+    bool dns_cookies;
+
+    /** Secret server cookies are generated with. */
+    uint8_t dns_cookie_secret[DNS_COOKIE_SECRET_LEN];
+
+    /** Start metrics thread serving metrics over HTTP. */
+    bool metrics_enable;
+
+    /** IP address metrics thread listens on. */
+    char *metrics_listener_ip;
+
+    /** TCP port metrics thread listens on. */
+    uint16_t metrics_listener_port;
+
+    /** Sketch top question names, top client networks and distinct clients
+     * of queries, see @ref metrics_sketch_t.
+     */
+    bool metrics_sketches;
+
+    /** Count queries of each zone by response code and question type, see
+     * @ref metrics_zone_counters_t.
+     */
+    bool metrics_zones;
+
+    /** Time 1 in this many queries through parse, resolve and pack stages,
+     * see @ref metrics_cost_t. 0 disables.
+     */
+    uint32_t metrics_query_cost;
+
 } config_t;
 
+/** Structure holds a listener tuning profile, a named set of listener
+ * settings that listeners it is assigned to are provisioned with instead of
+ * application wide ones, see configuration option "listener_profiles_file".
+ */
+typedef struct config_listener_profile_s {
+    /** Profile name. */
+    char name[LISTENER_PROFILE_NAME_MAX + 1];
+
+    /** Configuration listeners of profile are provisioned with: copy of
+     * application configuration, as it was at startup, with profile
+     * settings applied. Shares strings and arrays with it.
+     */
+    config_t *cfg;
+
+    /** Setting "tcp_listener_max_accept_new_conn" of profile, 0 if profile
+     * does not set it and application wide setting applies.
+     */
+    size_t tcp_listener_max_accept_new_conn;
+
+    /** Whether profile sets UDP vector length, listeners of profile then
+     * keep theirs when configuration file is reloaded.
+     */
+    bool udp_conn_vector_len_set;
+} config_listener_profile_t;
+
 void config_init(config_t *cfg);
 int  config_parse_opts(config_t *cfg, int argc, char *argv[]);
 void config_clean(config_t *cfg);
 
+config_t *config_reload(const config_t *base, const char *buf, size_t buf_len,
+                        uint64_t generation, char *err, size_t err_len);
+
+int config_listener_profiles_parse(config_t *cfg, const char *buf, size_t buf_len,
+                                   char *err, size_t err_len);
+
+/** Get configuration listener with given profile is provisioned with.
+ *
+ * @param cfg     Application configuration.
+ * @param profile Listener profile, index + 1 in listener_profiles, 0 if
+ *                listener has none.
+ *
+ * @return        Returns profile configuration, or cfg if listener has no
+ *                profile.
+ */
+static inline config_t *
+config_listener_cfg(config_t *cfg, uint8_t profile)
+{
+    return profile == 0 ? cfg : cfg->listener_profiles[profile - 1].cfg;
+}
+
 #endif /* End of CONFIG_H */
 
 /** @}*/
\ No newline at end of file
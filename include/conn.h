@@ -30,13 +30,15 @@
  *        - TCP listener
  *        - TCP connection.
  * 
- *        TCP (established) connections are tracked in a Least Recently Used
- *        cache. LRU cache is used to check for various timeout conditions.
- *        Each TCP connection has a unique Id (connection ID) associated with it.
- *        The only purpose of this ID is to provide a unique key for LRU cache.
- *        LRU cache implementation uses UT HASH.
+ *        TCP (established) connections have a timer embedded in them, which
+ *        is armed in vectorloop timer wheel for timeout that applies to
+ *        connection state (keepalive, query receive, or query send).
+ *        Each TCP connection has a unique Id (connection ID) associated with it,
+ *        assigned by vectorloop connection table (see @ref conn_table). The ID
+ *        is what TCP connection is registered with epoll under.
  * 
- *        Listener connections are not tracked in LRU cache.
+ *        Listener connections do not have timers armed, nor are they tracked
+ *        in connection table.
  * 
  *        UDP listener and TCP connection objects have DNS query objects
  *        associated with them.
@@ -45,14 +47,18 @@
 #ifndef CONN_H
 #define CONN_H
 
+#include <netinet/in.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
 #include <time.h>
 
-#include <uthash/uthash.h>
-
+#include "arena.h"
+#include "coroutine.h"
 #include "query.h"
+#include "timer_wheel.h"
+#include "zone_xfr.h"
 
 /** Marco that returns true if conn (conn_t struct) is a UDP listener */
 #define CONN_IS_UDP_LISTENER(conn) \
@@ -66,6 +72,16 @@
 #define CONN_IS_TCP_CONN(conn) \
     conn->lc == 1 && conn->proto == 1
 
+/** Protocol passed to @ref conn_listener_provision() to provision a DNS over
+ * TLS listener, a TCP listener on port "dot_listener_port".
+ */
+#define LISTENER_PROTO_DOT (IPPROTO_MAX + 1)
+
+/** Protocol passed to @ref conn_listener_provision() to provision a dual
+ * stack UDP listener, an IPv6 UDP listener that receives IPv4 datagrams too.
+ */
+#define LISTENER_PROTO_UDP_DUAL (IPPROTO_MAX + 2)
+
 /** Enumerated error returned by listener_start() function. */
 typedef enum listener_start_error_e {
     /** Socket create error. */
@@ -97,6 +113,24 @@ typedef enum listener_start_error_e {
 
     /** Error setting socket option IPV6_RECVPKTINFO. */
     LISTENER_ERR_SOCKET_OPT_SNDBUF           = -10,
+
+    /** Error setting socket option SO_BUSY_POLL. */
+    LISTENER_ERR_SOCKET_OPT_BUSY_POLL        = -11,
+
+    /** Error setting socket option TCP_FASTOPEN. */
+    LISTENER_ERR_SOCKET_OPT_TCP_FASTOPEN     = -12,
+
+    /** Error setting socket option TCP_DEFER_ACCEPT. */
+    LISTENER_ERR_SOCKET_OPT_TCP_DEFER_ACCEPT = -13,
+
+    /** Error setting socket option TCP_NOTSENT_LOWAT. */
+    LISTENER_ERR_SOCKET_OPT_TCP_NOTSENT_LOWAT = -14,
+
+    /** Error setting socket option SO_RXQ_OVFL. */
+    LISTENER_ERR_SOCKET_OPT_RXQ_OVFL         = -15,
+
+    /** Error setting socket option SO_TIMESTAMPNS. */
+    LISTENER_ERR_SOCKET_OPT_TIMESTAMPNS      = -16,
 } listener_start_error_t;
 
 /** Enumerated TCP connection states. */
@@ -136,65 +170,211 @@ typedef enum conn_tcp_state_e {
     /** Query size received over TCP connection exceeds RIP_NS_PACKETSZ. */
     TCP_CONN_ST_QUERY_SIZE_TOOLARGE,
 
-} conn_tcp_state_t;
+    /** DoT connection is with a handshake thread doing TLS handshake, it is
+     * neither registered with epoll nor has a timer armed.
+     */
+    TCP_CONN_ST_TLS_HANDSHAKE,
 
-/** Structure holds data specific to TCP listener connection. */
-typedef struct conn_tcp_s {   
-    /** TCP connection client IP. */
-    struct sockaddr_storage client_ip;
+    /** DoT connection could not be handed to a handshake thread as all of
+     * their queues are full.
+     */
+    TCP_CONN_ST_TLS_HANDSHAKE_BUSY,
 
-    /** TCP connection local IP. */
-    struct sockaddr_storage local_ip;
+    /** TLS handshake of DoT connection failed or timed out. */
+    TCP_CONN_ST_TLS_HANDSHAKE_ERR,
+
+    /** Kernel TLS could not be installed on DoT connection. */
+    TCP_CONN_ST_TLS_KTLS_ERR,
+
+    /** Connection socket was handed off to another vectorloop, connection
+     * object is released without closing socket.
+     */
+    TCP_CONN_ST_HANDED_OFF,
+
+    /** Idle connection was closed by vectorloop draining after listeners
+     * were handed over to new process on upgrade.
+     */
+    TCP_CONN_ST_DRAINED,
+
+    /** Zone transfer is being sent, waiting for socket to become writable
+     * or for its turn within vectorloop zone transfer budget.
+     */
+    TCP_CONN_ST_XFR,
+
+    /** Idle connection was closed to make room for a new connection, as
+     * vectorloop holds maximum number of TCP connections.
+     */
+    TCP_CONN_ST_EVICTED,
+
+} conn_tcp_state_t;
+
+/** Structure holds buffers TCP connection reads, parses and answers queries
+ * with: read buffer, queries array with a response buffer per query, and
+ * write I/O vector. Connection holds a buffer set only while it has data to
+ * process, idle connection hands it back to connection pool, see
+ * @ref conn_pool_bufs_get() and @ref conn_pool_bufs_put().
+ */
+typedef struct conn_tcp_bufs_s {
+    /** @private Next buffer set in connection pool free list. */
+    struct conn_tcp_bufs_s *next;
 
     /** Read buffer. */
     unsigned char *read_buffer;
 
     /** Read buffer size. */
     size_t read_buffer_size;
- 
-    /** Length of data in read buffer. */
+
+    /** Array queries are parsed into. */
+    query_t *queries;
+
+    /** Number of elements in queries array. */
+    size_t queries_size;
+
+    /** I/O vector query responses are gathered into for write, it has
+     * queries_size elements.
+     */
+    struct iovec *write_iov;
+} conn_tcp_bufs_t;
+
+/** Structure holds data specific to TCP listener connection.
+ *
+ * Structure is cache line aligned. Read buffer, parse and query state read on
+ * every TCP event fill first cache line, write state follows, and addresses
+ * and timestamps used only when connection starts, ends or is logged are at
+ * the end.
+ */
+typedef struct conn_tcp_s {   
+    /*** HOT: first cache line, read and parse of every TCP event. ***/
+    /** State of this TCP connection. */
+    _Alignas(CACHE_LINE_SIZE) conn_tcp_state_t state;
+
+    /** Number of active entries in query_index column. */
+    unsigned int query_index_count;
+
+    /** Read buffer, NULL while connection holds no buffer set. */
+    unsigned char *read_buffer;
+
+    /** Offset in read buffer of data not yet consumed by queries. */
+    size_t read_buffer_offset;
+
+    /** Length of data in read buffer, starting at read_buffer_offset. */
     size_t read_buffer_len;
 
+    /** Array where queries are parsed into. */
+    query_t *queries;
+
+    /** Column of indexes into queries array of the queries next vectorloop
+     * stage is to process, in query order. Query parse fills it with queries
+     * left to resolve, and response pack refills it with queries a response
+     * is sent for, which is what UDP write then sends. Stages thus do not
+     * touch the (large) queries they skip.
+     */
+    uint16_t *query_index;
+
+    /** Number of populated elements in queries array. */
+    size_t queries_count;
+
     /** Element in query array to start write from. */
     size_t query_write_index;
 
+    /** Resume point of read coroutine, see vl_tcp_read_co(). */
+    co_t read_co;
+
+    /*** Write state, response write and zone transfer. ***/
     /** Index in query element write buffer where to start write from.
      * This is used in case multiple write() calls are needed to write all data
      * in buffer.
      */
     size_t write_index;
 
-    /** Array where queries are parsed into. */
-    query_t *queries;
-
     /** Number of elements in queries array. */
     size_t queries_size;
- 
-    /** Number of populated elements in queries array. */
-    size_t queries_count;
+
+    /** Read buffer size. */
+    size_t read_buffer_size;
+
+    /** I/O vector query responses are gathered into for write, it has
+     * queries_size elements.
+     */
+    struct iovec *write_iov;
+
+    /** Message write I/O vector is sent with. */
+    struct msghdr write_msg;
+
+    /** Zone transfer being sent once responses of other queries are, NULL
+     * if there is none.
+     */
+    zone_xfr_stream_t *xfr;
+
+    /** Buffer set read buffer, queries and write I/O vector above are taken
+     * from, NULL while connection is idle and holds none.
+     */
+    conn_tcp_bufs_t *bufs;
+
+    /** SO_RCVLOWAT set on connection socket, bytes rest of a partially
+     * received query needs. 0 if option is at its default of 1 byte.
+     */
+    int rcvlowat;
+
+    /** @private handle for idle queue. */
+    struct conn_s *idle_q_handle;
+
+    /** @private previous handle for idle queue, allows O(1) removal. */
+    struct conn_s *idle_q_prev;
+
+    /*** COLD: connection lifetime data. ***/
+    /** Key connection is counted under in vectorloop connection limit table,
+     * 0 if it is not counted, see @ref conn_limit_acquire().
+     */
+    uint64_t client_key;
 
     /** Number of queries received and processed over this TCP connection. */
     size_t queries_total_count;
 
+    /** Number of bytes read from connection socket. */
+    uint64_t bytes_read;
+
+    /** Number of bytes written to connection socket, zone transfers
+     * included.
+     */
+    uint64_t bytes_written;
+
     /** TCP keepalive as advertised in EDNS tcp-keepalive. */
     size_t tcp_keepalive;
 
-    /** State of this TCP connection. */
-    conn_tcp_state_t state;
+    /** Query zone transfer is the response of. */
+    query_t *xfr_query;
 
     /** Time TCP connection was established. */
     struct timespec start_time;
 
-    /** Time when this connection will time out. Which timeout is in effect
-     * is governed by connection state.
+    /** Kernel receive timestamp of data last read, queries framed take it
+     * as their receive time. Not set unless "listener_rx_timestamps" is.
      */
-    struct timespec timeout;
+    struct timespec rx_time;
 
-    /** Time TCP connection was established. */
+    /** Time TCP connection was closed. */
     struct timespec end_time;
+
+    /** TCP connection client IP. */
+    struct sockaddr_storage client_ip;
+
+    /** TCP connection local IP. */
+    struct sockaddr_storage local_ip;
 } conn_tcp_t;
 
-/** Structure holds data specific to UDP listener connection. */
+_Static_assert(offsetof(conn_tcp_t, query_write_index) + sizeof(size_t) <= CACHE_LINE_SIZE,
+               "conn_tcp_t read and parse fields do not fit first cache line");
+
+/** Structure holds data specific to UDP listener connection.
+ *
+ * UDP listener receives into a set of batches, each a connection object of
+ * its own sharing listener socket, with listener being its first batch. Batch
+ * received into travels through vectorloop stages on its own and is free to
+ * receive into again once its queries are logged, so listener keeps receiving
+ * while previous batch waits for socket to become writable. Listener read
+ * state is held by listener, write state by each batch.
+ */
 typedef struct conn_udp_s {
     /** Size (length) of arrays: read_vector, queries, write_vector.
      *
@@ -202,6 +382,27 @@ typedef struct conn_udp_s {
      */
     unsigned int vector_len;
 
+    /** Number of read vector entries read into per recvmmsg() call, adapted
+     * between vector_len_min and vector_len_max to how full recent reads were,
+     * see @ref conn_udp_vector_len_adapt().
+     */
+    unsigned int vector_len_active;
+
+    /** Maximum vector_len_active is adapted up to, at most vector_len. Lowered
+     * by configuration reload, see @ref conn_udp_vector_len_set().
+     */
+    unsigned int vector_len_max;
+
+    /** Minimum vector_len_active is adapted down to, equals vector_len if
+     * adapting is disabled.
+     */
+    unsigned int vector_len_min;
+
+    /** Number of consecutive reads that filled less than half of
+     * vector_len_active.
+     */
+    unsigned int vector_low_reads;
+
     /** Vector (array) of mmsg to read data into.  */
     struct mmsghdr *read_vector;
 
@@ -211,11 +412,46 @@ typedef struct conn_udp_s {
     /** Array where queries are parsed into. */
     query_t *queries;
 
+    /** Column of indexes into queries array of the queries next vectorloop
+     * stage is to process, in query order. Query parse fills it with queries
+     * left to resolve, and response pack refills it with queries a response
+     * is sent for, which is what UDP write then sends. Stages thus do not
+     * touch the (large) queries they skip.
+     */
+    uint16_t *query_index;
+
+    /** Number of active entries in query_index column. */
+    unsigned int query_index_count;
+
+    /** Number of priority lane queries in batch, see @ref query_t.priority.
+     * Write moves them ahead of rest of batch when there are any.
+     */
+    unsigned int priority_count;
+
     /** Vector (array) of mmsg to send data from. This is also vector where
      * query responses are packed into.
      */
     struct mmsghdr *write_vector;
 
+    /** Array of vector_len I/O vectors write vector messages send responses
+     * from. With UDP GSO a message spans consecutive entries, one per
+     * response (segment).
+     */
+    struct iovec *write_iov;
+
+    /** Position in query_index column of first query each write vector
+     * message sends response of, has write_vector_count + 1 entries so
+     * message k sends responses of positions write_query_start[k] up to
+     * write_query_start[k+1].
+     */
+    uint16_t *write_query_start;
+
+    /** Control message buffers, UDP_GSO_CONTROL_LEN bytes for each write
+     * vector message, that carry source IP along with UDP GSO segment size.
+     * NULL if UDP GSO is not enabled.
+     */
+    unsigned char *write_control;
+
     /** Index where to start writing (sending UDP datagrams) from. At first this
      * value is 0, then if not all data was written via call to sendmmsg(), 
      * it is updated and connection is queued back into udp write queue
@@ -230,18 +466,78 @@ typedef struct conn_udp_s {
      */
     unsigned int write_vector_count;
 
-} conn_udp_t;
+    /** Number of messages sent, starting with write_vector_write_index. Used
+     * to collect results of messages sent via io_uring.
+     */
+    unsigned int write_vector_sent;
 
-/** Structure holds data common to TCP and UDP connections. */
-typedef struct conn_s {
-    /** @private LRU cache handle. Only used for TCP connections. */
-    UT_hash_handle hh;
+    /** Error (errno) of first message that failed to send via io_uring, 0 if
+     * there was none.
+     */
+    int write_errno;
 
-    /** Connection ID. While it is set for all connections, it is only used for
-     * TCP connections.
-    */
-    uint64_t cid;
+    /** UDP listener this batch belongs to, listener is its own first batch.
+     */
+    struct conn_s *listener;
+
+    /** Array of listener batches, first being listener itself. Only set on
+     * listener.
+     */
+    struct conn_s **batches;
+
+    /** Number of listener batches. Only set on listener. */
+    unsigned int batches_count;
+
+    /** Number of listener batches free to receive into. Only set on
+     * listener.
+     */
+    unsigned int batches_free;
+
+    /** Flag indicating if batch holds received queries, it is not free to
+     * receive into until they are logged.
+     */
+    uint8_t busy;
+
+    /** Flag indicating if listener is waiting for a batch to become free.
+     * Only set on listener.
+     */
+    uint8_t waiting_for_batch;
+
+    /** Kernel count of datagrams socket dropped, as last received with
+     * SO_RXQ_OVFL control message. Only set on listener.
+     */
+    uint32_t rxq_drops;
+
+    /** Socket receive buffer size last set. Only set on listener. */
+    size_t recvbuff_size;
+
+    /** Time in milliseconds receive buffer size was last raised, see
+     * @ref conn_udp_recvbuff_autotune(). Only set on listener.
+     */
+    uint64_t recvbuff_tuned_ms;
 
+    /** Listener socket each read vector entry was received on, batch of a
+     * listener bound to an address of "udp_listener_addresses" is filled from
+     * sockets of all addresses of its IP family. NULL if batch is only
+     * received into by its listener.
+     */
+    struct conn_s **read_socket;
+
+    /** Index in "udp_listener_addresses" of address listener socket is
+     * bound to, its per address metrics are counted under. Only set on
+     * listener sockets bound to an address.
+     */
+    unsigned int addr_index;
+
+} conn_udp_t;
+
+/** Structure holds data common to TCP and UDP connections.
+ *
+ * Flags, socket descriptor, queue handles and connection ID every vectorloop
+ * stage reads are kept in first 64 bytes, timer only armed and disarmed on
+ * TCP state changes is after them.
+ */
+typedef struct conn_s {
     /** Flag indicating if 0=listener, or 1=connection(only applies to TCP). */
     uint8_t lc: 1;
 
@@ -272,26 +568,70 @@ typedef struct conn_s {
      */
     uint8_t in_release_queue: 1;
 
+    /** Flag indicating if connection object is in idle queue. Only applies
+     * to TCP connections.
+     */
+    uint8_t in_idle_queue: 1;
+
+    /** Flag indicating if this UDP listener is an AF_XDP socket, see
+     * @ref vl_xdp_recv() and @ref vl_xdp_send().
+     */
+    uint8_t xdp: 1;
+
+    /** Flag indicating if this UDP listener replays queries of a pcap file,
+     * see @ref vl_replay_recv() and @ref vl_replay_send().
+     */
+    uint8_t replay: 1;
+
+    /** Flag indicating if this TCP listener or connection is DNS over TLS,
+     * connection socket has kernel TLS installed once its handshake is done.
+     */
+    uint8_t tls: 1;
+
+    /** Listener tuning profile listener was provisioned with, index + 1 in
+     * configuration setting listener_profiles, 0 if none. Only used for
+     * listeners.
+     */
+    uint8_t profile;
+
+    /** Socket descriptor this connection is associated with. */
+    int fd;
+
     /** @private handle for read queue. */
     struct conn_s *read_q_handle;
 
+    /** @private previous handle for read queue, allows O(1) removal. */
+    struct conn_s *read_q_prev;
+
     /** @private handle for write queue. */
     struct conn_s *write_q_handle;
 
+    /** @private previous handle for write queue, allows O(1) removal. */
+    struct conn_s *write_q_prev;
+
     /** @private handle for general queues: parse, resolve, log. */
     struct conn_s *gen_q_handle;
 
-    /** Socket descriptor this connection is associated with. */
-    int fd;
-
     /** Holds either TCP or UDP specific data depending on connection protocol. */
     union {
         conn_udp_t *udp;
         conn_tcp_t *tcp;
     } conn;
 
+    /** Connection ID, assigned by connection table. Only used for TCP
+     * connections, 0 if connection is not in connection table.
+    */
+    uint64_t cid;
+
+    /** @private Timeout timer. Only used for TCP connections, which timeout
+     * is in effect is governed by connection state.
+     */
+    timer_wheel_node_t timer;
 } conn_t;
 
+_Static_assert(offsetof(conn_t, cid) + sizeof(uint64_t) <= CACHE_LINE_SIZE,
+               "conn_t flags, queue handles and cid do not fit first cache line");
+
 /** Connection object FIFO queue. New objects are enqueued (added) to the tail
  *  of the queue, and objects are dequeued (removed) from head of the queue.
  */
@@ -302,6 +642,9 @@ typedef struct conn_fifo_queue_s {
     /** Pointer to queue tail. */
     conn_t *tail;
 
+    /** Number of entries in queue. */
+    uint32_t len;
+
 } conn_fifo_queue_t;
 
 
@@ -315,24 +658,45 @@ void     conn_fifo_remove_from_read_queue(conn_fifo_queue_t *queue, conn_t *conn
 void     conn_fifo_remove_from_write_queue(conn_fifo_queue_t *queue, conn_t *conn_rm);
 void     conn_fifo_enqueue_release(conn_fifo_queue_t *queue, conn_t *conn);
 conn_t * conn_fifo_dequeue_release(conn_fifo_queue_t *queue);
+void     conn_fifo_enqueue_idle(conn_fifo_queue_t *queue, conn_t *conn);
+conn_t * conn_fifo_dequeue_idle(conn_fifo_queue_t *queue);
+void     conn_fifo_remove_from_idle_queue(conn_fifo_queue_t *queue, conn_t *conn_rm);
 
 void         conn_tcp_release(conn_tcp_t *conn_tcp);
 void         conn_udp_release(conn_udp_t *conn_udp);
 void         conn_release(conn_t *conn);
 void         conn_udp_vectors_reset(conn_udp_t *conn_udp);
-conn_udp_t * conn_udp_new(config_t *cfg, int family);
-conn_t     * conn_new_tcp(int fd, config_t *cfg, int ip_version,
-                          struct sockaddr_storage *client_ip,
+unsigned int conn_udp_priority_first(query_t *queries, uint16_t *index, unsigned int count);
+size_t       conn_udp_recvbuff_autotune(conn_t *listener, size_t max, uint64_t now_ms);
+void         conn_udp_vector_len_adapt(conn_udp_t *conn_udp, unsigned int vlen,
+                                       unsigned int received);
+void         conn_udp_vector_len_set(conn_udp_t *conn_udp, unsigned int len,
+                                     unsigned int len_min);
+size_t       conn_udp_arena_size(config_t *cfg);
+conn_udp_t * conn_udp_new(config_t *cfg, int family, arena_t *arena);
+void         conn_udp_batches_new(conn_t *listener, config_t *cfg, unsigned int count,
+                                  arena_t *arena);
+conn_t     * conn_udp_batch_free(conn_t *listener);
+void         conn_udp_batch_hold(conn_t *batch);
+conn_t     * conn_udp_batch_release(conn_t *batch);
+conn_t     * conn_new_tcp(int fd, int ip_version, struct sockaddr_storage *client_ip,
                           struct sockaddr_storage *local_ip);
+conn_tcp_bufs_t * conn_tcp_bufs_new(config_t *cfg, buf_pool_t *response_pool);
+void              conn_tcp_bufs_free(conn_tcp_bufs_t *bufs);
+void              conn_tcp_bufs_attach(conn_tcp_t *conn_tcp, conn_tcp_bufs_t *bufs);
+conn_tcp_bufs_t * conn_tcp_bufs_detach(conn_tcp_t *conn_tcp);
+size_t            conn_tcp_keepalive_scale(size_t keepalive, size_t conns_active,
+                                           size_t conns_max, size_t shrink_start);
+void         conn_tcp_reuse(conn_t *conn, int fd, int ip_version,
+                            struct sockaddr_storage *client_ip,
+                            struct sockaddr_storage *local_ip);
 
 conn_t * conn_listener_provision(config_t *cfg, int family, int protocol,
-                                 char *err_buf, size_t err_buf_len);
-
-conn_t * conn_lru_cache_get(conn_t **lru, uint64_t id);
-
-bool conn_tcp_id_assign(uint64_t *id, conn_t **lru, uint64_t *base);
+                                 arena_t *arena, int fd, char *err_buf, size_t err_buf_len);
+conn_t * conn_listener_provision_addr(config_t *cfg, size_t addr_index, conn_t *listener,
+                                      arena_t *arena, char *err_buf, size_t err_buf_len);
 
-void conn_tcp_report_metrics(conn_tcp_t *conn_tcp, metrics_t *metrics);
+void conn_tcp_report_metrics(conn_tcp_t *conn_tcp, metrics_vl_t *metrics);
 
 #endif /* End of CONN_H */
 
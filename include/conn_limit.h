@@ -0,0 +1,102 @@
+/**
+ * @file conn_limit.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup conn_limit TCP Connection Limit
+ *
+ * @brief Per client TCP connection limit. Counts TCP connections vectorloop
+ *        holds per client network (address masked to configured IPv4 or IPv6
+ *        prefix length), so a single client can not take up all TCP
+ *        connections vectorloop allows. Each vectorloop owns its table hence
+ *        no locking is needed.
+ *
+ *        Table is fixed in size and allocated once. It is made of cache line
+ *        sized buckets of @ref CONN_LIMIT_BUCKET_ENTRIES entries each, and a
+ *        client network is looked up only in the bucket its key hashes to.
+ *        Entry is freed once its count drops to 0. Client network that finds
+ *        its bucket full is not counted (nor limited), table is sized to twice
+ *        the number of connections vectorloop allows so this is rare.
+ *  @{
+ */
+#ifndef CONN_LIMIT_H
+#define CONN_LIMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+
+/** Structure describes a connection limit table entry. */
+typedef struct conn_limit_entry_s {
+    /** Entry key, client network and address family. 0 means entry is not
+     * used.
+     */
+    uint64_t key;
+
+    /** Number of connections client network holds. */
+    uint64_t count;
+} conn_limit_entry_t;
+
+/** Number of entries in connection limit table bucket, bucket fills a cache
+ * line.
+ */
+#define CONN_LIMIT_BUCKET_ENTRIES (CACHE_LINE_SIZE / sizeof(conn_limit_entry_t))
+
+/** Structure describes a connection limit table bucket. */
+typedef struct conn_limit_bucket_s {
+    /** Bucket entries. */
+    _Alignas(CACHE_LINE_SIZE) conn_limit_entry_t entries[CONN_LIMIT_BUCKET_ENTRIES];
+} conn_limit_bucket_t;
+
+/** Structure describes a connection limit table. */
+typedef struct conn_limit_s {
+    /** Table buckets, NULL if limit is disabled. */
+    conn_limit_bucket_t *buckets;
+
+    /** Number of buckets minus 1, used to map hash to bucket. */
+    uint64_t mask;
+
+    /** Maximum number of connections per client network. */
+    uint64_t per_client_max;
+
+    /** IPv4 address mask, in network byte order. */
+    uint32_t ipv4_mask;
+
+    /** Number of IPv6 address bytes kept. */
+    uint8_t ipv6_bytes;
+
+    /** Mask applied to the last IPv6 address byte kept. */
+    uint8_t ipv6_last_mask;
+} conn_limit_t;
+
+void conn_limit_init(conn_limit_t *limit, size_t size, size_t per_client_max,
+                     unsigned int ipv4_prefix_len, unsigned int ipv6_prefix_len);
+void conn_limit_clean(conn_limit_t *limit);
+bool conn_limit_acquire(conn_limit_t *limit, struct sockaddr_storage *client_ip,
+                        bool force, uint64_t *key);
+void conn_limit_release(conn_limit_t *limit, uint64_t key);
+
+#endif /* End of CONN_LIMIT_H */
+
+/** @}*/
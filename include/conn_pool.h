@@ -0,0 +1,113 @@
+/**
+ * @file conn_pool.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** \defgroup conn_pool Connection Pool
+ *
+ * @brief Connection pool keeps released TCP connection objects of a
+ *        vectorloop so they can be reused for new TCP connections.
+ *
+ *        TCP connection object owns a read buffer, queries array and a
+ *        response buffer per query. Allocating and freeing these for every
+ *        accepted connection puts allocator on connection accept/release
+ *        path. Pool instead keeps released connection objects in a free
+ *        list (linked via connection general queue handle), and hands them
+ *        out again with their state reset and buffers kept.
+ *
+ *        Buffers a connection reads and answers queries with are kept apart
+ *        from connection object, in a buffer set (see @ref conn_tcp_bufs_t)
+ *        pool also keeps. Connection takes a buffer set when it has data to
+ *        read and hands it back when it goes idle, so memory of idle
+ *        connections is only that of their connection object, and number of
+ *        buffer sets follows number of connections with queries in flight.
+ *
+ *        Pool is preloaded with @ref CONN_POOL_TCP_PREALLOC objects (or fewer
+ *        if maximum is lower), and grows on demand up to maximum number of
+ *        connections it is created for. Free list of buffer sets is kept up
+ *        to @ref CONN_POOL_TCP_BUFS_FREE_MAX, buffer sets above it are freed.
+ *        It is owned by a single vectorloop thread so no locking is done.
+ *  @{
+ */
+#ifndef CONN_POOL_H
+#define CONN_POOL_H
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+#include "config.h"
+#include "conn.h"
+
+/** Number of TCP connection objects pool is preloaded with. */
+#define CONN_POOL_TCP_PREALLOC 1024
+
+/** Maximum number of free TCP connection buffer sets pool keeps, it is also
+ * number of buffer sets pool is preloaded with.
+ */
+#define CONN_POOL_TCP_BUFS_FREE_MAX 256
+
+/** Structure describes a TCP connection object pool. */
+typedef struct conn_pool_s {
+    /** Configuration used to allocate new connection objects. */
+    config_t *cfg;
+
+    /** Pool larger query response buffers of connection objects are taken
+     * from, NULL if none.
+     */
+    buf_pool_t *response_pool;
+
+    /** First free connection object. */
+    conn_t *free_head;
+
+    /** Number of connection objects in free list. */
+    size_t free_count;
+
+    /** Number of connection objects allocated, free and in use. */
+    size_t count;
+
+    /** Maximum number of connection objects pool keeps. */
+    size_t size_max;
+
+    /** First free buffer set. */
+    conn_tcp_bufs_t *bufs_free_head;
+
+    /** Number of buffer sets in free list. */
+    size_t bufs_free_count;
+
+    /** Number of buffer sets allocated, free and attached to connections. */
+    size_t bufs_count;
+} conn_pool_t;
+
+void     conn_pool_init(conn_pool_t *pool, config_t *cfg, buf_pool_t *response_pool,
+                        size_t size_max);
+void     conn_pool_clean(conn_pool_t *pool);
+conn_t * conn_pool_get_tcp(conn_pool_t *pool, int fd, int ip_version,
+                           struct sockaddr_storage *client_ip,
+                           struct sockaddr_storage *local_ip);
+void     conn_pool_put(conn_pool_t *pool, conn_t *conn);
+void     conn_pool_bufs_get(conn_pool_t *pool, conn_t *conn);
+void     conn_pool_bufs_put(conn_pool_t *pool, conn_t *conn);
+
+#endif /* End of CONN_POOL_H */
+
+/** @}*/
@@ -0,0 +1,117 @@
+/**
+ * @file conn_table.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup conn_table Connection Table
+ *
+ * @brief Connection table tracks active TCP connections of a vectorloop and
+ *        assigns their connection IDs.
+ *
+ *        Table is a slab (array) of slots, free slots are linked into a free
+ *        list, so adding and removing a connection is O(1). Connection ID
+ *        packs slot index and slot generation, generation is incremented each
+ *        time slot is freed. Looking up a stale ID (one of a connection that
+ *        was since released, even if its slot got reused) hence does not
+ *        return a connection.
+ *
+ *        Connection ID has bit @ref CONN_TABLE_CID_F set, which is never set
+ *        in a user space pointer. This allows epoll event data to carry either
+ *        a connection ID (TCP connections), or a pointer (listeners).
+ *
+ *        Table grows (doubles) as needed up to maximum number of connections
+ *        it is created for.
+ *  @{
+ */
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "conn.h"
+
+/** Flag set in every connection ID. */
+#define CONN_TABLE_CID_F ((uint64_t)1 << 63)
+
+/** Macro returns true if value (epoll event data) is a connection ID. */
+#define CONN_TABLE_IS_CID(v) (((v) & CONN_TABLE_CID_F) != 0)
+
+/** Structure describes a connection table slot. */
+typedef struct conn_table_slot_s {
+    /** Connection occupying slot, NULL if slot is free. */
+    conn_t *conn;
+
+    /** Slot generation, incremented each time slot is freed. */
+    uint32_t generation;
+
+    /** Index of next free slot, valid only if slot is free. */
+    uint32_t next_free;
+} conn_table_slot_t;
+
+/** Structure describes a connection table. */
+typedef struct conn_table_s {
+    /** Table slots. */
+    conn_table_slot_t *slots;
+
+    /** Number of slots allocated. */
+    uint32_t size;
+
+    /** Maximum number of slots table can grow to. */
+    uint32_t size_max;
+
+    /** Number of slots in use. */
+    uint32_t count;
+
+    /** Index of first free slot, equal to size if there are no free slots. */
+    uint32_t free_head;
+} conn_table_t;
+
+/** Lookup connection by connection ID.
+ *
+ * @param table Connection table.
+ * @param cid   Connection ID.
+ *
+ * @return      Returns connection, or NULL if connection ID is stale or
+ *              invalid.
+ */
+static inline conn_t *
+conn_table_get(conn_table_t *table, uint64_t cid)
+{
+    uint32_t index = (uint32_t)cid;
+
+    if (!CONN_TABLE_IS_CID(cid) || index >= table->size ||
+        table->slots[index].generation != (uint32_t)((cid & ~CONN_TABLE_CID_F) >> 32)) {
+        return NULL;
+    }
+    return table->slots[index].conn;
+}
+
+void conn_table_init(conn_table_t *table, size_t size_max);
+void conn_table_clean(conn_table_t *table);
+bool conn_table_add(conn_table_t *table, conn_t *conn);
+void conn_table_remove(conn_table_t *table, conn_t *conn);
+
+#endif /* End of CONN_TABLE_H */
+
+/** @}*/
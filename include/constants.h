@@ -46,6 +46,27 @@
 /** Default setting for udp_conn_vector_len configuration parameter. */
 #define CFG_DEFAULT_UDP_CONN_VECTOR_LEN 8
 
+/** Default setting for udp_conn_vector_len_min configuration parameter. */
+#define CFG_DEFAULT_UDP_CONN_VECTOR_LEN_MIN 0
+
+/** Default setting for udp_listener_batches configuration parameter. */
+#define CFG_DEFAULT_UDP_LISTENER_BATCHES 2
+
+/** Default setting for udp_pipeline_batch_len configuration parameter. */
+#define CFG_DEFAULT_UDP_PIPELINE_BATCH_LEN 0
+
+/** Default setting for udp_gso configuration parameter. */
+#define CFG_DEFAULT_UDP_GSO false
+
+/** Default setting for udp_dual_stack configuration parameter. */
+#define CFG_DEFAULT_UDP_DUAL_STACK false
+
+/** Default setting for xdp_busy_poll configuration parameter. */
+#define CFG_DEFAULT_XDP_BUSY_POLL 0
+
+/** Default setting for xdp_responder_hits configuration parameter. */
+#define CFG_DEFAULT_XDP_RESPONDER_HITS 64
+
 /** Default setting for udp_socket_recvbuff_size configuration parameter. */
 #define CFG_DEFAULT_UDP_SOCK_RECVBUFF_SIZE 0xfffff
 
@@ -58,6 +79,15 @@
 /** Default setting for tcp_listener_pending_conns_max configuration parameter. */
 #define CFG_DEFAULT_TCP_LIST_PEND_CONNS_MAX 1024
 
+/** Default setting for tcp_listener_fastopen configuration parameter. */
+#define CFG_DEFAULT_TCP_LISTENER_FASTOPEN 0
+
+/** Default setting for tcp_listener_defer_accept configuration parameter. */
+#define CFG_DEFAULT_TCP_LISTENER_DEFER_ACCEPT 0
+
+/** Default setting for tcp_listener_notsent_lowat configuration parameter. */
+#define CFG_DEFAULT_TCP_LISTENER_NOTSENT_LOWAT 0
+
 /** Default setting for tcp_listener_port configuration parameter. */
 #define CFG_DEFAULT_TCP_LISTENER_PORT 53
 
@@ -79,29 +109,187 @@
 /** Default setting for tcp_keepalive configuration parameter. */
 #define CFG_DEFAULT_TCP_KEEPALIVE 10000
 
+/** Default setting for tcp_keepalive_shrink_start configuration parameter. */
+#define CFG_DEFAULT_TCP_KEEPALIVE_SHRINK_START 50
+
 /** Default setting for tcp_query_recv_timeout configuration parameter. */
 #define CFG_DEFAULT_TCP_QUERY_RECV_TIMEOUT 2000
 
 /** Default setting for tcp_query_send_timeout configuration parameter. */
 #define CFG_DEFAULT_TCP_QUERY_SEND_TIMEOUT 2000
 
+/** Default setting for tcp_handoff configuration parameter. */
+#define CFG_DEFAULT_TCP_HANDOFF false
+
+/** Default setting for tcp_handoff_threshold configuration parameter. */
+#define CFG_DEFAULT_TCP_HANDOFF_THRESHOLD 25
+
+/** Default setting for tcp_conns_per_client_max configuration parameter. */
+#define CFG_DEFAULT_TCP_CONNS_PER_CLIENT_MAX 0
+
+/** Default setting for tcp_conns_client_ipv4_prefix_len configuration
+ * parameter.
+ */
+#define CFG_DEFAULT_TCP_CONNS_CLIENT_IPV4_PREFIX_LEN 32
+
+/** Default setting for tcp_conns_client_ipv6_prefix_len configuration
+ * parameter.
+ */
+#define CFG_DEFAULT_TCP_CONNS_CLIENT_IPV6_PREFIX_LEN 56
+
+/** Default setting for tcp_conns_idle_evict configuration parameter. */
+#define CFG_DEFAULT_TCP_CONNS_IDLE_EVICT true
+
+/** Default setting for dot_enable configuration parameter. */
+#define CFG_DEFAULT_DOT_ENABLE false
+
+/** Default setting for dot_listener_port configuration parameter. */
+#define CFG_DEFAULT_DOT_LISTENER_PORT 853
+
+/** Default setting for dot_handshake_threads configuration parameter. */
+#define CFG_DEFAULT_DOT_HANDSHAKE_THREADS 2
+
+/** Default setting for dot_handshake_timeout configuration parameter. */
+#define CFG_DEFAULT_DOT_HANDSHAKE_TIMEOUT 3000
+
+/** Default setting for worker_threads configuration parameter. */
+#define CFG_DEFAULT_WORKER_THREADS 1
+
+/** Default setting for dnssec_sig_cache_size configuration parameter. */
+#define CFG_DEFAULT_DNSSEC_SIG_CACHE_SIZE 4096
+
+/** Default setting for dnssec_sig_validity configuration parameter. */
+#define CFG_DEFAULT_DNSSEC_SIG_VALIDITY 604800
+
+/** Default setting for dnssec_nsec3_cache_size configuration parameter. */
+#define CFG_DEFAULT_DNSSEC_NSEC3_CACHE_SIZE 256
+
 /** Default setting for UDP epoll_num_events configuration parameter. */
 #define CFG_DEFAULT_EPOLL_NUM_EVENTS_UDP 8
 
+/** Default setting for loop_budget_udp_datagrams configuration parameter. */
+#define CFG_DEFAULT_LOOP_BUDGET_UDP_DATAGRAMS 0
+
+/** Default setting for loop_budget_tcp_reads configuration parameter. */
+#define CFG_DEFAULT_LOOP_BUDGET_TCP_READS 0
+
+/** Default setting for loop_budget_tcp_accepts configuration parameter. */
+#define CFG_DEFAULT_LOOP_BUDGET_TCP_ACCEPTS 0
+
+/** Default setting for loop_budget_xfr_bytes configuration parameter. */
+#define CFG_DEFAULT_LOOP_BUDGET_XFR_BYTES 262144
+
+/** Default setting for io_uring_enable configuration parameter. */
+#define CFG_DEFAULT_IO_URING_ENABLE false
+
 /** Default setting for TCP epoll_num_events configuration parameter. */
 #define CFG_DEFAULT_EPOLL_NUM_EVENTS_TCP 8
 
 /** Default setting for process_thread_count configuration parameter. */
 #define CFG_DEFAULT_VL_THREAD_COUNT 1
 
-/** Default setting for loop_slowdown_one configuration parameter. */
-#define CFG_DEFAULT_VL_SLOWDOWN_ONE 1
+/** Default setting for process_thread_cpu_steering configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_CPU_STEERING false
+
+/** Default setting for process_thread_client_steering configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_CLIENT_STEERING false
+
+/** Default setting for process_thread_auto_pin configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_AUTO_PIN false
+
+/** Default setting for process_thread_sched_policy configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_SCHED_POLICY SCHED_OTHER
+
+/** Default setting for process_thread_sched_priority configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_SCHED_PRIORITY 1
+
+/** Default setting for process_thread_rt_run_max configuration parameter. */
+#define CFG_DEFAULT_VL_THREAD_RT_RUN_MAX 100
+
+/** Default setting for process_mlockall configuration parameter. */
+#define CFG_DEFAULT_PROCESS_MLOCKALL false
+
+/** Default setting for process_workers configuration parameter, 0 runs
+ * vectorloops as threads of a single process.
+ */
+#define CFG_DEFAULT_PROCESS_WORKERS 0
+
+/** Microseconds a real-time vectorloop sleeps once it has run for
+ * "process_thread_rt_run_max" without blocking.
+ */
+#define VL_RT_YIELD_US 50
+
+/** Vectorloop role: vectorloop runs IPv4 UDP listener. */
+#define VL_ROLE_UDP_IPV4 0x01
 
-/** Default setting for loop_slowdown_two configuration parameter. */
-#define CFG_DEFAULT_VL_SLOWDOWN_TWO 50
+/** Vectorloop role: vectorloop runs IPv6 UDP listener (and AF_XDP listener
+ * if AF_XDP is used).
+ */
+#define VL_ROLE_UDP_IPV6 0x02
+
+/** Vectorloop role: vectorloop runs IPv4 TCP (and DoT) listener. */
+#define VL_ROLE_TCP_IPV4 0x04
+
+/** Vectorloop role: vectorloop runs IPv6 TCP (and DoT) listener. */
+#define VL_ROLE_TCP_IPV6 0x08
+
+/** Vectorloop roles mask with all roles, default for each vectorloop in
+ * process_thread_roles configuration parameter.
+ */
+#define VL_ROLES_ALL (VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6 | VL_ROLE_TCP_IPV4 | \
+                      VL_ROLE_TCP_IPV6)
+
+/** Default setting for loop_idle_spin configuration parameter. */
+#define CFG_DEFAULT_VL_IDLE_SPIN 50
+
+/** Default setting for loop_idle_wait_max configuration parameter. */
+#define CFG_DEFAULT_VL_IDLE_WAIT_MAX 100
+
+/** Default setting for loop_calibrate configuration parameter. */
+#define CFG_DEFAULT_VL_CALIBRATE false
+
+/** Default setting for loop_calibrate_latency configuration parameter. */
+#define CFG_DEFAULT_VL_CALIBRATE_LATENCY 200
+
+/** Default setting for loop_hugepages configuration parameter. */
+#define CFG_DEFAULT_VL_HUGEPAGES false
+
+/** Default setting for loop_hugetlb configuration parameter. */
+#define CFG_DEFAULT_VL_HUGETLB false
 
-/** Default setting for loop_slowdown_three configuration parameter. */
-#define CFG_DEFAULT_VL_SLOWDOWN_THREE 100
+/** Default setting for loop_prefault configuration parameter. */
+#define CFG_DEFAULT_VL_PREFAULT false
+
+/** Default setting for loop_mlock configuration parameter. */
+#define CFG_DEFAULT_VL_MLOCK false
+
+/** Default setting for loop_stage_metrics configuration parameter. */
+#define CFG_DEFAULT_VL_STAGE_METRICS false
+
+/** Default setting for memory_budget configuration parameter. */
+#define CFG_DEFAULT_MEMORY_BUDGET 0
+
+/** Default setting for udp_socket_busy_poll configuration parameter. */
+#define CFG_DEFAULT_UDP_SOCK_BUSY_POLL 0
+
+/** Default setting for udp_socket_recvbuff_autotune_max configuration
+ * parameter.
+ */
+#define CFG_DEFAULT_UDP_SOCK_RECVBUFF_AUTOTUNE_MAX 0
+
+/** Default setting for udp_mirror_port configuration parameter. */
+#define CFG_DEFAULT_UDP_MIRROR_PORT 53
+
+/** Default setting for udp_mirror_sample_rate configuration parameter. */
+#define CFG_DEFAULT_UDP_MIRROR_SAMPLE_RATE 1
+
+/** Default setting for listener_rx_timestamps configuration parameter. */
+#define CFG_DEFAULT_LISTENER_RX_TIMESTAMPS false
+
+/** Minimum time in milliseconds between two UDP listener receive buffer
+ * size raises.
+ */
+#define UDP_CONN_RECVBUFF_AUTOTUNE_INTERVAL_MS 1000
 
 /** Default setting for application_log_name configuration parameter. */
 #define CFG_DEFAULT_APP_LOG_NAME "ripples.log"
@@ -110,7 +298,10 @@
 #define CFG_DEFAULT_APP_LOG_FILEPATH "."
 
 /** Default setting for query_log_buffer_size configuration parameter. */
-#define CFG_DEFAULT_QUERY_LOG_BUF_SIZE 6553500
+#define CFG_DEFAULT_QUERY_LOG_BUF_SIZE 3276750
+
+/** Default setting for query_log_buffer_count configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_BUF_COUNT 4
 
 /** Default setting for query_log_base_name configuration parameter. */
 #define CFG_DEFAULT_QUERY_LOG_BASE_NAME "dns_query_log"
@@ -118,19 +309,291 @@
 /** Default setting for query_log_path configuration parameter. */
 #define CFG_DEFAULT_QUERY_LOG_PATH "logs"
 
+/** Default setting for query_log_sample_rate configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_SAMPLE_RATE 1
+
+/** Default setting for query_log_errors_only configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_ERRORS_ONLY false
+
+/** Default setting for query_log_latency_min configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_LATENCY_MIN 0
+
+/** Query log rcode mask bit for queries no response was sent for. */
+#define QUERY_LOG_RCODE_NORESPONSE (1U << 31)
+
+/** Query log rcode mask logging all queries, default for query_log_rcodes
+ * configuration parameter.
+ */
+#define QUERY_LOG_RCODES_ALL UINT32_MAX
+
+/** Query log question type mask logging all queries, default for
+ * query_log_qtypes configuration parameter.
+ */
+#define QUERY_LOG_QTYPES_ALL UINT64_MAX
+
 /** Default setting for query_log_rotate_size configuration parameter. */
 #define CFG_DEFAULT_QUERY_LOG_ROTATE_SIZE 50000000
 
+/** Default setting for writing query log files with O_DIRECT. */
+#define CFG_DEFAULT_QUERY_LOG_DIRECT_IO false
+
+/** Default setting for writing query log files with vmsplice and splice. */
+#define CFG_DEFAULT_QUERY_LOG_SPLICE false
+
+/** Default setting for query_log_compress configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_COMPRESS false
+
+/** Default setting for query_log_remote_port configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_REMOTE_PORT 9154
+
+/** Query log written as text, one JSON object per line. */
+#define QUERY_LOG_FORMAT_TEXT 0
+
+/** Query log written as dnstap Frame Streams. */
+#define QUERY_LOG_FORMAT_DNSTAP 1
+
+/** Query log written as Arrow IPC stream. */
+#define QUERY_LOG_FORMAT_ARROW 2
+
+/** Default setting for query_log_format configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_FORMAT QUERY_LOG_FORMAT_TEXT
+
+/** Default setting for query_log_age_max configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_AGE_MAX 0
+
+/** Queries are not logged while query log ring is full. */
+#define QUERY_LOG_FULL_DROP 0
+
+/** Queries are logged to spill buffer while query log ring is full. */
+#define QUERY_LOG_FULL_SPILL 1
+
+/** Queries are sampled while query log ring is full. */
+#define QUERY_LOG_FULL_SAMPLE 2
+
+/** Default setting for query_log_full_policy configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_FULL_POLICY QUERY_LOG_FULL_DROP
+
+/** Default setting for query_log_spill_size configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_SPILL_SIZE 3276750
+
+/** Default setting for query_log_full_sample_rate configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_FULL_SAMPLE_RATE 10
+
+/** Default setting for query_log_index configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_INDEX false
+
+/** Default setting for query_log_index_records configuration parameter. */
+#define CFG_DEFAULT_QUERY_LOG_INDEX_RECORDS 4096
+
+
+/** Default setting for response_cache_size configuration parameter. */
+#define CFG_DEFAULT_RESPONSE_CACHE_SIZE 4096
+
+/** Default setting for response_cache_shared_size configuration parameter. */
+#define CFG_DEFAULT_RESPONSE_CACHE_SHARED_SIZE 0
+
+/** Default setting for rrl_responses_per_second configuration parameter. */
+#define CFG_DEFAULT_RRL_RESPONSES_PER_SECOND 0
+
+/** Default setting for rrl_slip configuration parameter. */
+#define CFG_DEFAULT_RRL_SLIP 2
+
+/** Default setting for rrl_ipv4_prefix_len configuration parameter. */
+#define CFG_DEFAULT_RRL_IPV4_PREFIX_LEN 24
+
+/** Default setting for rrl_ipv6_prefix_len configuration parameter. */
+#define CFG_DEFAULT_RRL_IPV6_PREFIX_LEN 56
+
+/** Default setting for rrl_table_size configuration parameter. */
+#define CFG_DEFAULT_RRL_TABLE_SIZE 65536
+
+/** Default setting for overload_iteration_max configuration parameter. */
+#define CFG_DEFAULT_OVERLOAD_ITERATION_MAX 0
+
+/** Default setting for overload_slip configuration parameter. */
+#define CFG_DEFAULT_OVERLOAD_SLIP 2
+
+/** Default setting for slo_latency_p50 configuration parameter. */
+#define CFG_DEFAULT_SLO_LATENCY_P50 0
+
+/** Default setting for slo_latency_p99 configuration parameter. */
+#define CFG_DEFAULT_SLO_LATENCY_P99 0
+
+/** Default setting for slo_latency_p999 configuration parameter. */
+#define CFG_DEFAULT_SLO_LATENCY_P999 0
+
+/** Default setting for slo_window configuration parameter. */
+#define CFG_DEFAULT_SLO_WINDOW 10
+
+/** Default setting for dns_cookies configuration parameter. */
+#define CFG_DEFAULT_DNS_COOKIES true
+
+/** Default setting for metrics_enable configuration parameter. */
+#define CFG_DEFAULT_METRICS_ENABLE false
+
+/** Default setting for metrics_listener_ip configuration parameter. */
+#define CFG_DEFAULT_METRICS_LISTENER_IP "127.0.0.1"
+
+/** Default setting for metrics_listener_port configuration parameter. */
+#define CFG_DEFAULT_METRICS_LISTENER_PORT 9153
+
+/** Default setting for metrics_sketches configuration parameter. */
+#define CFG_DEFAULT_METRICS_SKETCHES false
+
+/** Default setting for metrics_zones configuration parameter. */
+#define CFG_DEFAULT_METRICS_ZONES false
+
+/** Default setting for metrics_query_cost configuration parameter. */
+#define CFG_DEFAULT_METRICS_QUERY_COST 0
+
 
 /** Default setting for resource_1_name configuration parameter. */
-#define CFG_DEFAULT_RESOURCE_1_NAME "Resource_1"
+#define CFG_DEFAULT_RESOURCE_1_NAME "zone_db"
 
 /** Default setting for resource_1_filepath configuration parameter. */
-#define CFG_DEFAULT_RESOURCE_1_FILEPATH "resource1.txt"
+#define CFG_DEFAULT_RESOURCE_1_FILEPATH "zone.txt"
 
 /** Default setting for resource_1_update_freq configuration parameter. */
 #define CFG_DEFAULT_RESOURCE_1_UPDATE_FREQ 5
 
+/** Default setting for resource_1_delta_filepath configuration parameter,
+ * empty string means there is no zone delta file.
+ */
+#define CFG_DEFAULT_RESOURCE_1_DELTA_FILEPATH ""
+
+/** Default setting for zone_image_compile_filepath configuration parameter,
+ * empty string means zone file is not compiled into zone image.
+ */
+#define CFG_DEFAULT_ZONE_IMAGE_COMPILE_FILEPATH ""
+
+/** Default setting for zone_prefault configuration parameter. */
+#define CFG_DEFAULT_ZONE_PREFAULT false
+
+/** Default setting for zone_mlock configuration parameter. */
+#define CFG_DEFAULT_ZONE_MLOCK false
+
+/** Default setting for zone_compile_threads configuration parameter, zone
+ * file is parsed and compiled on resource thread alone.
+ */
+#define CFG_DEFAULT_ZONE_COMPILE_THREADS 1
+
+/** Default setting for zone_secondary configuration parameter, empty string
+ * means there are no secondary zones.
+ */
+#define CFG_DEFAULT_ZONE_SECONDARY ""
+
+/** Default setting for zone_primary_port configuration parameter. */
+#define CFG_DEFAULT_ZONE_PRIMARY_PORT 53
+
+/** Default setting for resource_2_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_2_NAME "ecs_map"
+
+/** Default setting for resource_2_filepath configuration parameter, empty
+ * string means ECS map is not loaded.
+ */
+#define CFG_DEFAULT_RESOURCE_2_FILEPATH ""
+
+/** Default setting for resource_2_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_2_UPDATE_FREQ 5
+
+/** Default setting for resource_3_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_3_NAME "config"
+
+/** Default setting for resource_3_filepath configuration parameter, empty
+ * string means there is no configuration file.
+ */
+#define CFG_DEFAULT_RESOURCE_3_FILEPATH ""
+
+/** Default setting for resource_3_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_3_UPDATE_FREQ 5
+
+/** Default setting for resource_4_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_4_NAME "views"
+
+/** Default setting for resource_4_filepath configuration parameter, empty
+ * string means there are no views.
+ */
+#define CFG_DEFAULT_RESOURCE_4_FILEPATH ""
+
+/** Default setting for resource_4_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_4_UPDATE_FREQ 5
+
+/** Default setting for resource_5_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_5_NAME "acl"
+
+/** Default setting for resource_5_filepath configuration parameter, empty
+ * string means there is no client ACL.
+ */
+#define CFG_DEFAULT_RESOURCE_5_FILEPATH ""
+
+/** Default setting for resource_5_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_5_UPDATE_FREQ 5
+
+/** Default setting for resource_6_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_6_NAME "policy"
+
+/** Default setting for resource_6_filepath configuration parameter, empty
+ * string means there is no response policy.
+ */
+#define CFG_DEFAULT_RESOURCE_6_FILEPATH ""
+
+/** Default setting for resource_6_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_6_UPDATE_FREQ 5
+
+/** Default setting for resource_7_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_7_NAME "geoip"
+
+/** Default setting for resource_7_filepath configuration parameter, empty
+ * string means there is no GeoIP database.
+ */
+#define CFG_DEFAULT_RESOURCE_7_FILEPATH ""
+
+/** Default setting for resource_7_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_7_UPDATE_FREQ 60
+
+/** Default setting for resource_8_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_8_NAME "lb"
+
+/** Default setting for resource_8_filepath configuration parameter, empty
+ * string means there are no load balanced names.
+ */
+#define CFG_DEFAULT_RESOURCE_8_FILEPATH ""
+
+/** Default setting for resource_8_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_8_UPDATE_FREQ 5
+
+/** Default setting for resource_9_name configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_9_NAME "zone_catalog"
+
+/** Default setting for resource_9_filepath configuration parameter, empty
+ * string means there is no zone catalog.
+ */
+#define CFG_DEFAULT_RESOURCE_9_FILEPATH ""
+
+/** Default setting for resource_9_update_freq configuration parameter. */
+#define CFG_DEFAULT_RESOURCE_9_UPDATE_FREQ 5
+
+/** Default setting for lb_check_interval configuration parameter, seconds. */
+#define CFG_DEFAULT_LB_CHECK_INTERVAL 5
+
+/** Default setting for lb_check_timeout configuration parameter,
+ * milliseconds.
+ */
+#define CFG_DEFAULT_LB_CHECK_TIMEOUT 1000
+
+/** Default setting for upgrade_socket configuration parameter, empty string
+ * means upgrades are disabled.
+ */
+#define CFG_DEFAULT_UPGRADE_SOCKET ""
+
+/** Default setting for admin_socket configuration parameter, empty string
+ * means admin socket is disabled.
+ */
+#define CFG_DEFAULT_ADMIN_SOCKET ""
+
+/** Default setting for drain_time configuration parameter, seconds. */
+#define CFG_DEFAULT_DRAIN_TIME 30
+
 
 /* MIN & MAX bound settings for CLI options*/
 /** MIN bound for configuration setting "tcp_keepalive" */
@@ -138,6 +601,78 @@
 /** MAX bound for configuration setting "tcp_keepalive" */
 #define TCP_KEEPALIVE_MAX 600000
 
+/** MIN bound for configuration setting "tcp_keepalive_shrink_start" */
+#define TCP_KEEPALIVE_SHRINK_START_MIN 0
+/** MAX bound for configuration setting "tcp_keepalive_shrink_start" */
+#define TCP_KEEPALIVE_SHRINK_START_MAX 100
+
+/** MIN bound for configuration setting "tcp_handoff_threshold" */
+#define TCP_HANDOFF_THRESHOLD_MIN 5
+/** MAX bound for configuration setting "tcp_handoff_threshold" */
+#define TCP_HANDOFF_THRESHOLD_MAX 1000
+
+/** MIN bound for configuration setting "memory_budget" */
+#define MEMORY_BUDGET_MIN 0
+/** MAX bound for configuration setting "memory_budget" */
+#define MEMORY_BUDGET_MAX 16777216
+
+/** MIN bound for configuration setting "tcp_conns_per_client_max" */
+#define TCP_CONNS_PER_CLIENT_MAX_MIN 0
+/** MAX bound for configuration setting "tcp_conns_per_client_max" */
+#define TCP_CONNS_PER_CLIENT_MAX_MAX 1000000
+
+/** MIN bound for configuration setting "tcp_conns_client_ipv4_prefix_len" */
+#define TCP_CONNS_CLIENT_IPV4_PREFIX_LEN_MIN 0
+/** MAX bound for configuration setting "tcp_conns_client_ipv4_prefix_len" */
+#define TCP_CONNS_CLIENT_IPV4_PREFIX_LEN_MAX 32
+
+/** MIN bound for configuration setting "tcp_conns_client_ipv6_prefix_len" */
+#define TCP_CONNS_CLIENT_IPV6_PREFIX_LEN_MIN 0
+/** MAX bound for configuration setting "tcp_conns_client_ipv6_prefix_len",
+ * IPv6 network has to fit 56 bits of connection limit entry key.
+ */
+#define TCP_CONNS_CLIENT_IPV6_PREFIX_LEN_MAX 56
+
+/** Maximum number of entries of per vectorloop TCP connection limit table,
+ * see @ref conn_limit_init().
+ */
+#define TCP_CONNS_CLIENT_TABLE_SIZE_MAX 0x100000
+
+/** Maximum number of vectorloops TCP connection handoff can be used with,
+ * there is a handoff channel for each pair of vectorloops.
+ */
+#define TCP_HANDOFF_VL_MAX 128
+
+/** MIN bound for configuration setting "drain_time" */
+#define DRAIN_TIME_MIN 1
+/** MAX bound for configuration setting "drain_time" */
+#define DRAIN_TIME_MAX 3600
+
+/** MIN bound for configuration setting "lb_check_interval" */
+#define LB_CHECK_INTERVAL_MIN 1
+/** MAX bound for configuration setting "lb_check_interval" */
+#define LB_CHECK_INTERVAL_MAX 3600
+
+/** MIN bound for configuration setting "lb_check_timeout" */
+#define LB_CHECK_TIMEOUT_MIN 10
+/** MAX bound for configuration setting "lb_check_timeout" */
+#define LB_CHECK_TIMEOUT_MAX 60000
+
+/** Number of failed health probes in a row that take load balancing
+ * endpoint down.
+ */
+#define LB_CHECK_FALL 2
+
+/** Number of passed health probes in a row that bring load balancing
+ * endpoint back up.
+ */
+#define LB_CHECK_RISE 2
+
+/** Maximum number of load balancing endpoints health checker probes at
+ * once.
+ */
+#define LB_CHECK_BATCH 256
+
 /** MIN bound for configuration setting "dns_query_request_max_len" */
 #define DNS_QUERY_REQUEST_MAX_LEN_MIN 512
 /** MAX bound for configuration setting "dns_query_request_max_len" */
@@ -148,11 +683,131 @@
 /** MAX bound for configuration setting "dns_query_response_max_len" */
 #define DNS_QUERY_RESPONSE_MAX_LEN_MAX 0x10000
 
+/** MIN bound for configuration setting "zone_file_update_freq" */
+#define RESOURCE_UPDATE_FREQ_MIN 1
+/** MAX bound for configuration setting "zone_file_update_freq" */
+#define RESOURCE_UPDATE_FREQ_MAX 86400
+
+/** MIN bound for configuration setting "zone_compile_threads" */
+#define ZONE_COMPILE_THREADS_MIN 1
+/** MAX bound for configuration setting "zone_compile_threads" */
+#define ZONE_COMPILE_THREADS_MAX 64
+
+/** MIN bound for configuration setting "response_cache_size" */
+#define RESPONSE_CACHE_SIZE_MIN 0
+/** MAX bound for configuration setting "response_cache_size" */
+#define RESPONSE_CACHE_SIZE_MAX 0x1000000
+
+/** MIN bound for configuration setting "response_cache_shared_size" */
+#define RESPONSE_CACHE_SHARED_SIZE_MIN 0
+/** MAX bound for configuration setting "response_cache_shared_size" */
+#define RESPONSE_CACHE_SHARED_SIZE_MAX 0x1000000
+
+/** MIN bound for configuration setting "rrl_responses_per_second" */
+#define RRL_RESPONSES_PER_SECOND_MIN 0
+/** MAX bound for configuration setting "rrl_responses_per_second" */
+#define RRL_RESPONSES_PER_SECOND_MAX 1000000
+
+/** MIN bound for configuration setting "rrl_slip" */
+#define RRL_SLIP_MIN 0
+/** MAX bound for configuration setting "rrl_slip" */
+#define RRL_SLIP_MAX 10
+
+/** MIN bound for configuration setting "rrl_ipv4_prefix_len" */
+#define RRL_IPV4_PREFIX_LEN_MIN 0
+/** MAX bound for configuration setting "rrl_ipv4_prefix_len" */
+#define RRL_IPV4_PREFIX_LEN_MAX 32
+
+/** MIN bound for configuration setting "rrl_ipv6_prefix_len" */
+#define RRL_IPV6_PREFIX_LEN_MIN 0
+/** MAX bound for configuration setting "rrl_ipv6_prefix_len", IPv6 network
+ * has to fit 56 bits of RRL entry key.
+ */
+#define RRL_IPV6_PREFIX_LEN_MAX 56
+
+/** MIN bound for configuration setting "rrl_table_size" */
+#define RRL_TABLE_SIZE_MIN 4
+/** MAX bound for configuration setting "rrl_table_size" */
+#define RRL_TABLE_SIZE_MAX 0x1000000
+
+/** MIN bound for configuration setting "overload_iteration_max" */
+#define OVERLOAD_ITERATION_MAX_MIN 0
+/** MAX bound for configuration setting "overload_iteration_max" */
+#define OVERLOAD_ITERATION_MAX_MAX 1000000
+
+/** MIN bound for configuration setting "overload_slip" */
+#define OVERLOAD_SLIP_MIN 0
+/** MAX bound for configuration setting "overload_slip" */
+#define OVERLOAD_SLIP_MAX 10
+
+/** MIN bound for configuration settings "slo_latency_p50", "slo_latency_p99"
+ * and "slo_latency_p999"
+ */
+#define SLO_LATENCY_MIN 0
+/** MAX bound for configuration settings "slo_latency_p50", "slo_latency_p99"
+ * and "slo_latency_p999"
+ */
+#define SLO_LATENCY_MAX 60000000
+
+/** MIN bound for configuration setting "slo_window" */
+#define SLO_WINDOW_MIN 1
+/** MAX bound for configuration setting "slo_window" */
+#define SLO_WINDOW_MAX 60
+
+/** MIN bound for configuration setting "query_log_sample_rate" */
+#define QUERY_LOG_SAMPLE_RATE_MIN 1
+/** MAX bound for configuration setting "query_log_sample_rate" */
+#define QUERY_LOG_SAMPLE_RATE_MAX 1000000
+
+/** MIN bound for configuration setting "udp_mirror_sample_rate" */
+#define UDP_MIRROR_SAMPLE_RATE_MIN 1
+/** MAX bound for configuration setting "udp_mirror_sample_rate" */
+#define UDP_MIRROR_SAMPLE_RATE_MAX 1000000
+
+/** MIN bound for configuration setting "metrics_query_cost" */
+#define METRICS_QUERY_COST_MIN 0
+/** MAX bound for configuration setting "metrics_query_cost" */
+#define METRICS_QUERY_COST_MAX 1000000
+
+/** MIN bound for configuration setting "query_log_latency_min" */
+#define QUERY_LOG_LATENCY_MIN_MIN 0
+/** MAX bound for configuration setting "query_log_latency_min" */
+#define QUERY_LOG_LATENCY_MIN_MAX 60000000
+
+/** MIN bound for configuration setting "query_log_age_max" */
+#define QUERY_LOG_AGE_MAX_MIN 0
+/** MAX bound for configuration setting "query_log_age_max" */
+#define QUERY_LOG_AGE_MAX_MAX 3600000
+
+/** MIN bound for configuration setting "query_log_index_records" */
+#define QUERY_LOG_INDEX_RECORDS_MIN 1
+/** MAX bound for configuration setting "query_log_index_records" */
+#define QUERY_LOG_INDEX_RECORDS_MAX 1000000
+
+/** MIN bound for configuration setting "query_log_buffer_count" */
+#define QUERY_LOG_BUF_COUNT_MIN 2
+/** MAX bound for configuration setting "query_log_buffer_count" */
+#define QUERY_LOG_BUF_COUNT_MAX 64
+
 /** MIN bound for configuration setting "epoll_num_events" */
 #define EPOLL_NUM_EVENTS_MIN 3
 /** MAX bound for configuration setting "epoll_num_events" */
 #define EPOLL_NUM_EVENTS_MAX 1024
 
+/** MIN bound for configuration settings "loop_budget_udp_datagrams",
+ * "loop_budget_tcp_reads" and "loop_budget_tcp_accepts".
+ */
+#define LOOP_BUDGET_MIN 0
+/** MAX bound for configuration settings "loop_budget_udp_datagrams",
+ * "loop_budget_tcp_reads" and "loop_budget_tcp_accepts".
+ */
+#define LOOP_BUDGET_MAX 0xffff
+
+/** MIN bound for configuration setting "loop_budget_xfr_bytes" */
+#define LOOP_BUDGET_XFR_BYTES_MIN 0
+/** MAX bound for configuration setting "loop_budget_xfr_bytes" */
+#define LOOP_BUDGET_XFR_BYTES_MAX 0x40000000
+
 /** MIN bound for configuration setting "process_thread_count" */
 #define PROCESS_THREAD_COUNT_MIN 1
 /** MAX bound for configuration setting "process_thread_count".
@@ -161,6 +816,11 @@
 */
 #define PROCESS_THREAD_COUNT_MAX 1024
 
+/** MIN bound for configuration setting "process_workers" */
+#define PROCESS_WORKERS_MIN 0
+/** MAX bound for configuration setting "process_workers" */
+#define PROCESS_WORKERS_MAX 64
+
 /** MIN bound for configuration settings "tcp_listener_port" and
  * "udp_listener_port".
 */
@@ -175,6 +835,51 @@
 /** MAX bound for configuration setting "tcp_listener_pending_conns_max" */
 #define TCP_LIST_PENDING_CONNS_MAX_MAX 0xffff
 
+/** MIN bound for configuration setting "tcp_listener_fastopen" */
+#define TCP_LISTENER_FASTOPEN_MIN 0
+/** MAX bound for configuration setting "tcp_listener_fastopen" */
+#define TCP_LISTENER_FASTOPEN_MAX 0xffff
+
+/** MIN bound for configuration setting "tcp_listener_defer_accept" */
+#define TCP_LISTENER_DEFER_ACCEPT_MIN 0
+/** MAX bound for configuration setting "tcp_listener_defer_accept" */
+#define TCP_LISTENER_DEFER_ACCEPT_MAX 3600
+
+/** MIN bound for configuration setting "tcp_listener_notsent_lowat" */
+#define TCP_LISTENER_NOTSENT_LOWAT_MIN 0
+/** MAX bound for configuration setting "tcp_listener_notsent_lowat" */
+#define TCP_LISTENER_NOTSENT_LOWAT_MAX (16 * 1024 * 1024)
+
+/** MIN bound for configuration setting "dot_handshake_threads" */
+#define DOT_HANDSHAKE_THREADS_MIN 1
+/** MAX bound for configuration setting "dot_handshake_threads" */
+#define DOT_HANDSHAKE_THREADS_MAX 64
+
+/** MIN bound for configuration setting "dot_handshake_timeout" */
+#define DOT_HANDSHAKE_TIMEOUT_MIN 1
+/** MAX bound for configuration setting "dot_handshake_timeout" */
+#define DOT_HANDSHAKE_TIMEOUT_MAX 60000
+
+/** MIN bound for configuration setting "worker_threads" */
+#define WORKER_THREADS_MIN 1
+/** MAX bound for configuration setting "worker_threads" */
+#define WORKER_THREADS_MAX 64
+
+/** MIN bound for configuration setting "dnssec_sig_cache_size" */
+#define DNSSEC_SIG_CACHE_SIZE_MIN 16
+/** MAX bound for configuration setting "dnssec_sig_cache_size" */
+#define DNSSEC_SIG_CACHE_SIZE_MAX 1048576
+
+/** MIN bound for configuration setting "dnssec_sig_validity" */
+#define DNSSEC_SIG_VALIDITY_MIN 3600
+/** MAX bound for configuration setting "dnssec_sig_validity" */
+#define DNSSEC_SIG_VALIDITY_MAX 31536000
+
+/** MIN bound for configuration setting "dnssec_nsec3_cache_size" */
+#define DNSSEC_NSEC3_CACHE_SIZE_MIN 0
+/** MAX bound for configuration setting "dnssec_nsec3_cache_size" */
+#define DNSSEC_NSEC3_CACHE_SIZE_MAX 1048576
+
 /** MIN bound for configuration setting "tcp_listener_max_accept_new_conn" */
 #define TCP_LIST_MAX_ACCEPT_NEW_CONN_MIN 1
 /** MAX bound for configuration setting "tcp_listener_max_accept_new_conn" */
@@ -200,6 +905,41 @@
 /** MAX bound for configuration setting "udp_conn_vector_len" */
 #define UDP_CONN_VECTOR_LEN_MAX 0xffff
 
+/** MIN bound for configuration setting "udp_conn_vector_len_min" */
+#define UDP_CONN_VECTOR_LEN_MIN_MIN 0
+/** MAX bound for configuration setting "udp_conn_vector_len_min" */
+#define UDP_CONN_VECTOR_LEN_MIN_MAX 0xffff
+
+/** MIN bound for configuration setting "udp_listener_batches" */
+#define UDP_LISTENER_BATCHES_MIN 1
+/** MAX bound for configuration setting "udp_listener_batches" */
+#define UDP_LISTENER_BATCHES_MAX 16
+
+/** Number of consecutive UDP reads filling less than half of active vector
+ * length after which listener halves it, see "udp_conn_vector_len_min".
+ */
+#define UDP_CONN_VECTOR_SHRINK_READS 16
+
+/** MIN bound for configuration setting "udp_pipeline_batch_len" */
+#define UDP_PIPELINE_BATCH_LEN_MIN 0
+/** MAX bound for configuration setting "udp_pipeline_batch_len" */
+#define UDP_PIPELINE_BATCH_LEN_MAX 0xffff
+
+/** MIN bound for configuration setting "xdp_busy_poll". */
+#define XDP_BUSY_POLL_MIN 0
+/** MAX bound for configuration setting "xdp_busy_poll". */
+#define XDP_BUSY_POLL_MAX 1000
+
+/** MIN bound for configuration setting "xdp_responder_size". */
+#define XDP_RESPONDER_SIZE_MIN 0
+/** MAX bound for configuration setting "xdp_responder_size". */
+#define XDP_RESPONDER_SIZE_MAX 1048576
+
+/** MIN bound for configuration setting "xdp_responder_hits". */
+#define XDP_RESPONDER_HITS_MIN 1
+/** MAX bound for configuration setting "xdp_responder_hits". */
+#define XDP_RESPONDER_HITS_MAX 1000000
+
 /** MIN bound for configuration setting "udp_conn_socket_recvbuff_size" */
 #define UDP_CONN_SO_RECVBUFF_MIN 518
 /** MAX bound for configuration setting "udp_conn_socket_recvbuff_size" */
@@ -210,14 +950,35 @@
 /** MAX bound for configuration setting "udp_conn_socket_sendbuff_size" */
 #define UDP_CONN_SO_SENDBUFF_MAX 0xffffff
 
-/** MIN bound for configuration setting "loop_slowdown_one", "loop_slowdown_two"
- *  and "loop_slowdown_three".
-*/
-#define VL_SLOWDOWN_MIN 1
-/** MAX bound for configuration setting "loop_slowdown_one", "loop_slowdown_two"
- *  and "loop_slowdown_three".
- */
-#define VL_SLOWDOWN_MAX 10000
+/** MIN bound for configuration setting "loop_idle_spin". */
+#define VL_IDLE_SPIN_MIN 0
+/** MAX bound for configuration setting "loop_idle_spin". */
+#define VL_IDLE_SPIN_MAX 10000
+
+/** MIN bound for configuration setting "process_thread_sched_priority". */
+#define VL_THREAD_SCHED_PRIORITY_MIN 1
+/** MAX bound for configuration setting "process_thread_sched_priority". */
+#define VL_THREAD_SCHED_PRIORITY_MAX 99
+
+/** MIN bound for configuration setting "process_thread_rt_run_max". */
+#define VL_THREAD_RT_RUN_MAX_MIN 1
+/** MAX bound for configuration setting "process_thread_rt_run_max". */
+#define VL_THREAD_RT_RUN_MAX_MAX 1000
+
+/** MIN bound for configuration setting "loop_idle_wait_max". */
+#define VL_IDLE_WAIT_MAX_MIN 1
+/** MAX bound for configuration setting "loop_idle_wait_max". */
+#define VL_IDLE_WAIT_MAX_MAX 1000
+
+/** MIN bound for configuration setting "loop_calibrate_latency". */
+#define VL_CALIBRATE_LATENCY_MIN 1
+/** MAX bound for configuration setting "loop_calibrate_latency". */
+#define VL_CALIBRATE_LATENCY_MAX 1000000
+
+/** MIN bound for configuration setting "udp_socket_busy_poll". */
+#define UDP_CONN_SO_BUSY_POLL_MIN 0
+/** MAX bound for configuration setting "udp_socket_busy_poll". */
+#define UDP_CONN_SO_BUSY_POLL_MAX 10000
 
 /** Size of buffer to store error messages in. Code generates error
  * messages that are logged in application log. This governs the size of buffer
@@ -227,15 +988,33 @@
  */
 #define ERR_MSG_LENGTH 1024
 
-/** Maximum number of unique names that we allow to be compressed in a DNS
- * response. When packing names into DNS response an array is used to keep track
- * of names already packed in the response so if the same name is being packed
- * compression could be used. This setting sets the size of such array.
- * 
- * This does not limit number of unique names in response, just number of unique
- * names that are compressed in response.
+/** Maximum length of EDNS OPT RR packed into response by response packing,
+ * OPT RR fixed part (11 bytes) and client subnet option for an IPv6 /128
+ * (24 bytes). Cookie option is added after response is packed, only if it
+ * fits, so it is not included.
+ */
+#define DNS_RESPONSE_EDNS_LEN_MAX (1 + RIP_NS_RRFIXEDSZ + 4 + 4 + 16)
+
+/** EDNS UDP payload size that avoids IP fragmentation on common paths (DNS
+ * flag day 2020). One of response size classes precompiled RRsets are
+ * flagged to fit into, see @ref ZONE_RRSET_FITS_EDNS.
+ */
+#define DNS_RESPONSE_SIZE_EDNS 1232
+
+/** Maximum number of free TCP response buffers, per size class, vectorloop
+ * TCP response buffer pool keeps.
+ */
+#define VL_TCP_RESPONSE_POOL_FREE_MAX 64
+
+/** Period in milliseconds at which vectorloop checks memory in use against
+ * memory budget, see @ref vl_mem_budget_update().
+ */
+#define VL_MEM_BUDGET_CHECK_MS 100
+
+/** Response cache and DNSSEC signature cache of a vectorloop are each sized
+ * to fit in its share of memory budget divided by this value.
  */
-#define DNS_RESPONSE_COMPRESSED_NAMES_MAX 64
+#define VL_MEM_BUDGET_CACHE_DIV 4
 
 /** Length of UDP IP_PKTINFO control message. Control message is used to
  * get destination IP information on received packets.
@@ -246,14 +1025,209 @@
  * is received via IP socket option IP_PKTINFO control message.
  * 
  * This setting MUSt be large enough to accommodate both IPv4 and IPv6 packet
- * info.
+ * info, along with SO_RXQ_OVFL drop count (24 bytes) and SO_TIMESTAMPNS
+ * receive timestamp (32 bytes) control messages.
+ */
+#define UDP_MSG_CONTROL_LEN 96
+
+/** Maximum number of deferred UDP queries each vectorloop holds while they
+ * wait for worker threads. Once reached, queries are not deferred and are
+ * answered with what is available, e.g. DNSSEC answers not signed yet are
+ * answered unsigned.
+ */
+#define VL_PENDING_UDP_MAX 256
+
+/** Number of queries ahead of the one being resolved, or packed, whose
+ * response cache entry, zone name filter entries or response fragment are
+ * prefetched, so their cache misses overlap across a UDP batch.
+ */
+#define VL_PREFETCH_DISTANCE 4
+
+/** Number of slots of table duplicate queries of a batch are found in, see
+ * @ref vl_query_coalesce(). Must be a power of 2.
+ */
+#define VL_COALESCE_SLOTS 256
+
+/** Period in milliseconds at which vectorloop publishes its load and picks
+ * vectorloop to hand off TCP connections to, see @ref vl_handoff_t.
+ */
+#define VL_HANDOFF_PERIOD_MS 100
+
+/** Period in milliseconds at which vectorloop evaluates overload signals
+ * and moves its overload level, see @ref vl_overload_t.
+ */
+#define VL_OVERLOAD_PERIOD_MS 100
+
+/** Number of consecutive periods vectorloop must not be overloaded for its
+ * overload level to be lowered by one, so shedding does not flap as load
+ * falls once work is shed.
+ */
+#define VL_OVERLOAD_CALM_PERIODS 10
+
+/** Period in milliseconds at which vectorloop takes a latency histogram
+ * snapshot and evaluates latency SLO over its rolling window, see
+ * @ref vl_slo_t.
+ */
+#define VL_SLO_PERIOD_MS 1000
+
+/** Minimum number of queries in latency SLO window for its quantiles to be
+ * evaluated, fewer do not say much about p99 and p999.
+ */
+#define VL_SLO_QUERIES_MIN 100
+
+/** Maximum number of listener tuning profiles, see configuration option
+ * "listener_profiles_file".
+ */
+#define LISTENER_PROFILES_MAX 16
+
+/** Maximum length of listener tuning profile name. */
+#define LISTENER_PROFILE_NAME_MAX 31
+
+/** Maximum number of TCP connections vectorloop hands off per period. */
+#define VL_HANDOFF_CONNS_MAX 8
+
+/** Minimum number of queries per period vectorloop must process above least
+ * loaded vectorloop to hand off TCP connections, so light imbalance does not
+ * move connections around.
+ */
+#define VL_HANDOFF_LOAD_MIN 100
+
+/** Maximum number of listener sockets in a single upgrade message, kernel
+ * limits number of file descriptors passed in one message to 253.
+ */
+#define UPGRADE_FDS_PER_MSG 64
+
+/** Magic number upgrade messages start with ("RIPU"). */
+#define UPGRADE_MSG_MAGIC 0x52495055
+
+/** Timeout in seconds of connecting to zone primary, and of each send and
+ * receive of a secondary zone transfer.
+ */
+#define ZONE_SECONDARY_IO_TIMEOUT 10
+
+/** Bounds in seconds of secondary zone refresh and retry intervals, SOA
+ * refresh and retry values are clamped to them. Zone not yet transferred is
+ * retried after the minimum.
+ */
+#define ZONE_SECONDARY_REFRESH_MIN 5
+#define ZONE_SECONDARY_REFRESH_MAX 86400
+
+/** Size of blocks secondary zone update records are stored in, fits the
+ * largest owner name and RDATA.
+ */
+#define ZONE_SECONDARY_BLOCK_SIZE (128 * 1024)
+
+/** Length of zone database generation chain (generations applied on top of
+ * each other) after which resource thread rebuilds database from scratch, so
+ * base generations of secondary zone updates are released.
+ */
+#define ZONE_SECONDARY_DEPTH_MAX 16
+
+/** Byte new process sends to process being upgraded once it is ready to
+ * serve.
+ */
+#define UPGRADE_MSG_READY 'R'
+
+/** Time in seconds new process has to become ready to serve, after it
+ * received listener sockets, before process being upgraded gives up on it.
+ */
+#define UPGRADE_READY_WAIT_MAX 300
+
+/** Interval in milliseconds upgrade thread checks on vectorloops at. */
+#define UPGRADE_POLL_MS 10
+
+/** Number of times admin thread retries reading a vectorloop state snapshot
+ * vectorloop is publishing, before it settles for a torn copy.
+ */
+#define ADMIN_VL_READ_RETRIES 64
+
+/** Maximum number of entries vectorloop counts in each of its queues when
+ * it publishes its state snapshot, so a long queue does not slow it down.
  */
-#define UDP_MSG_CONTROL_LEN 64
+#define ADMIN_VL_QUEUE_WALK_MAX 1024
 
-/** Number of resources that we load and update periodically.
- * Currently this is set to 1 as a demonstration of application capabilities.
+/** Size of text buffer admin thread formats state of each vectorloop into,
+ * fits a line of all snapshot values.
  */
-#define RESOURCE_COUNT 1
+#define ADMIN_VL_LINE_MAX 1024
+
+/** Length of admin socket listen queue. */
+#define ADMIN_LISTEN_BACKLOG 8
+
+/** Time in seconds admin thread waits to write vectorloop state to a client
+ * before closing the connection.
+ */
+#define ADMIN_CLIENT_TIMEOUT 2
+
+/** Interval in milliseconds main thread checks on draining vectorloops at. */
+#define DRAIN_POLL_MS 10
+
+/** Interval in milliseconds master process checks on worker processes at. */
+#define PREFORK_POLL_MS 100
+
+/** Worker process that exits within this many milliseconds of being started
+ * is restarted only after as many milliseconds, so a worker failing on start
+ * is not restarted in a tight loop.
+ */
+#define PREFORK_RESTART_BACKOFF_MS 1000
+
+/** Size of control message buffer of UDP write vector message when UDP GSO
+ * is enabled. It holds packet info header copied from read vector followed
+ * by UDP_SEGMENT header, which takes CMSG_SPACE(sizeof(uint16_t)) of at most
+ * 32 bytes.
+ */
+#define UDP_GSO_CONTROL_LEN (UDP_MSG_CONTROL_LEN + 32)
+
+/** Maximum number of responses (segments) sent in single UDP GSO message,
+ * kernel limit UDP_MAX_SEGMENTS of older kernels.
+ */
+#define UDP_GSO_SEGMENTS_MAX 64
+
+/** Maximum length of response sent as UDP GSO segment. Each segment is sent
+ * as its own datagram which must fit link MTU, kernel rejects GSO message
+ * otherwise. This is the DNS flag day 2020 recommended EDNS buffer size
+ * which fits 1280 bytes IPv6 minimum MTU.
+ */
+#define UDP_GSO_SEGMENT_LEN_MAX 1232
+
+/** Maximum length of all responses sent in single UDP GSO message, which
+ * is sent by kernel as one UDP datagram before it is segmented. Maximum IP
+ * packet length less IPv6 and UDP headers.
+ */
+#define UDP_GSO_BYTES_MAX (0xffff - 48)
+
+/** Maximum number of CNAME records followed (chased) within zone database
+ * when resolving a query.
+ */
+#define QUERY_RESOLVE_CNAME_CHAIN_MAX 8
+
+/** Maximum number of answer section records logged per query. */
+#define QUERY_LOG_ANSWER_MAX 10
+
+/** Maximum length of response that is stored in response cache. */
+#define RESPONSE_CACHE_RESPONSE_MAX 512
+
+/** Maximum length of request kept when its response cache entry turns hot,
+ * see @ref response_cache_t.hot_hits.
+ */
+#define RESPONSE_CACHE_HOT_REQUEST_MAX 128
+
+/** Number of answer section records kept with cached response, these are
+ * only needed for query logging.
+ */
+#define RESPONSE_CACHE_ANSWER_MAX QUERY_LOG_ANSWER_MAX
+
+/** Number of entries (ways) in a set of shared response cache, a response is
+ * stored in any entry of set its key hashes to.
+ */
+#define RESPONSE_CACHE_SHARED_WAYS 4
+
+/** Number of resources registered with resource loop, zone database, ECS
+ * map, configuration file, view set, client ACL, response policy, GeoIP
+ * database, load balancing candidate sets and zone catalog. Resources with
+ * no file configured are not loaded.
+ */
+#define RESOURCE_COUNT 9
 
 /** Minimum time that resource loop will sleep. Before waking up and performing
  * an action.
@@ -264,34 +1238,67 @@
  */
 #define RESOURCE_LOOP_TOP_DELTA_TIME -10
 
-/** Number of elements in liblfds bonded single producer single consumer queue.
- * Per liblfds: number_elements must be a positive integer power of 2.
- * 
- * This should NOT be changed application uses BSS queues to process single
- * transaction at at time.
- * 
- * This constant is used by resource and query log channels
+/** Maximum time resource loop sleeps while a retired resource waits for all
+ * vectorloops to pass a quiescent state. Unit is nanoseconds.
+ * This is set to 1 millisecond.
+ */
+#define RESOURCE_LOOP_RECLAIM_WAIT 1000000
+
+/** Interval at which resource watched for change with inotify is still
+ * checked for change, as a fallback in case a change event is missed, or if
+ * it is longer, resource update frequency. Unit is seconds.
  */
-#define CHANNEL_BSS_QUEUE_LEN 2
+#define RESOURCE_LOOP_WATCH_POLL_INTERVAL 300
 
-/** Size of liblfds bonded single producer single consumer queue used
- * for application log messages. We allow more than one message to be in a log
- * queue as application log messages are not treated as transactions (not a
- * request-response model). Instead these are fire and forget messages sent to
- * application log thread that reads the messages from channels and writes then
- * to application log file. As such we allow multiple messages to be queued up
- * in a log channel.
+/** Size of buffer inotify change events of watched resources are read into.
+ * Events not read in one go are read on next wake up.
+ */
+#define RESOURCE_LOOP_WATCH_BUFFER_LEN 4096
+
+/** Number of message slots in application log channel. We allow more than one
+ * message to be in a log channel as application log messages are not treated
+ * as transactions (not a request-response model). Instead these are fire and
+ * forget messages sent to application log thread that reads the messages from
+ * channels and writes then to application log file. Application log thread
+ * is woken up as soon as a channel goes non-empty and drains it in batches,
+ * so this only needs to hold a burst written while log thread writes to
+ * disk. MUST be a power of 2.
  */
 #define CHANNEL_LOG_QUEUE_LEN 1024
 
+/** Maximum length of application log message string carried in a log channel
+ * message slot, longer messages are truncated. Set so message slot is 512
+ * bytes.
+ */
+#define CHANNEL_LOG_MSG_LEN 500
+
+/** Number of rate limited error counters in application log channel, MUST be
+ * no less than number of error IDs, see @ref app_log_err_id_t.
+ */
+#define CHANNEL_LOG_ERR_COUNT 8
+
+/** Number of message slots in TCP connection handoff channel, see
+ * @ref channel_conn_t. Vectorloop hands off at most @ref VL_HANDOFF_CONNS_MAX
+ * connections per period. MUST be a power of 2.
+ */
+#define CHANNEL_CONN_QUEUE_LEN 16
+
+/** Maximum number of messages application log thread writes with a single
+ * writev() call, each message takes 5 io vectors so this MUST be no more than
+ * a fifth of IOV_MAX.
+ */
+#define APP_LOG_WRITE_MSGS_MAX 256
+
 /** Time in seconds to re-attempt opening application log file.  */
 #define APP_LOG_OPEN_WAIT_TIME 5
 
-/** Application thread loop sleep time. Unit is in nanoseconds. 
- * Maximum value is 999,999,999 which is "1 second - 1 nanosecond".
- * The value here is set to 1 millisecond.
+/** Time in seconds between summaries of rate limited errors application log
+ * thread logs, such as "N errors of type X in last second". 
  */
-#define APP_LOG_LOOP_SLEEP_TIME 1000000
+#define APP_LOG_ERR_SUMMARY_TIME 1
+
+/** Maximum length of rate limited error summary log line. */
+#define APP_LOG_ERR_SUMMARY_LEN 256
 
 /** Maximum length of file realpath. Several configuration settings
  * are specified as path (directory) + name (filename). realpath() is then
@@ -299,24 +1306,82 @@
  */
 #define FILE_REALPATH_MAX 4096
 
-/** Maximum time resource loop will wait for all vectorloops to send notifications
- * that resource was updated (pointer flip). If a vectorloop thread takes more than
- * 10s to run a single loop it means that something is wrong and it is blocked.
- * There SHOULD be no blocking operations in vectorloop.
- * Unit is nanoseconds.
- * This is set to 1 seconds.
+/** Maximum time resource loop will wait for all vectorloops to pass a
+ * quiescent state after resource was updated (pointer flip). If a vectorloop
+ * thread takes more than 10s to run a single loop it means that something is
+ * wrong and it is blocked. There SHOULD be no blocking operations in
+ * vectorloop, other than idle wait it does offline.
+ * Unit is microseconds.
+ * This is set to 10 seconds.
+ */
+#define VL_RESOURCE_NOTIFY_WAIT_TIME_MAX 10000000
+
+/** Number of CPU pause instructions an idle vectorloop executes per loop
+ * iteration while spinning, see configuration setting "loop_idle_spin".
  */
-#define VL_RESOURCE_NOTIFY_WAIT_TIME_MAX 1000000000
+#define VL_IDLE_SPIN_PAUSES 16
+
+/** CPU cache line size in bytes. Data written by different threads is
+ * aligned to this so threads do not share (false share) cache lines.
+ */
+#define CACHE_LINE_SIZE 64
+
+/** Number of pending connections metrics thread listening socket queues. */
+#define METRICS_LOOP_LISTEN_BACKLOG 16
+
+/** Time in seconds metrics thread waits to read a request from, or to write a
+ * response to, a client before closing the connection.
+ */
+#define METRICS_LOOP_CLIENT_TIMEOUT 2
+
+/** Size of buffer metrics thread reads HTTP request into. */
+#define METRICS_LOOP_REQUEST_MAX 1024
+
+/** Lowest exported latency histogram bucket bound is 2^this nanoseconds
+ * (~1 microsecond). Exported buckets are at power of two boundaries from here
+ * up to @ref HISTOGRAM_EXPONENT_MAX.
+ */
+#define METRICS_EXPORT_HISTOGRAM_EXPONENT_MIN 10
+
+/** Lowest exported vectorloop stage cycles histogram bucket bound is 2^this
+ * CPU cycles.
+ */
+#define METRICS_EXPORT_CYCLES_EXPONENT_MIN 6
+
+/** Length in seconds of query sketch windows, metrics thread merges
+ * vectorloop sketches this often.
+ */
+#define METRICS_SKETCH_INTERVAL 10
+
+/** Time in milliseconds metrics thread waits between attempts to collect
+ * query sketch windows vectorloops have not yet acknowledged leaving.
+ */
+#define METRICS_SKETCH_COLLECT_WAIT 10
+
+/** Number of question names and client networks each query sketch window
+ * counts, power of two.
+ */
+#define METRICS_SKETCH_TOPK_CAPACITY 256
+
+/** Number of top question names and client networks exported. */
+#define METRICS_SKETCH_TOPK_EXPORT 20
+
+/** Number of zones, of main zone database and of views, counted per zone.
+ * Queries of zones registered past it are counted together in an overflow
+ * slot, see @ref metrics_zones_register().
+ */
+#define METRICS_ZONES_MAX 256
 
 /** Time in microseconds query log loop slows down (sleeps) for if in a single
  * iteration no data was written to query log.
  */
 #define QUERY_LOG_LOOP_SLOWDOWN 1000
 
-/** Time in microseconds query log loop waits to get channel message response
- * from vectorloop thread.
+/** Maximum time in microseconds query log loop slows down (sleeps) for. Each
+ * consecutive iteration in which no data was written to query log doubles the
+ * sleep time, starting at @ref QUERY_LOG_LOOP_SLOWDOWN, up to this value.
  */
-#define QUERY_LOG_LOOP_MSG_WAIT_TIME 10
+#define QUERY_LOG_LOOP_SLOWDOWN_MAX 100000
 
 /** Maximum character length of query log filename. This includes
  * base (directory), '/', and filename.
@@ -328,12 +1393,75 @@
  */
 #define QUERY_LOG_FILE_OPEN_RETRY_TIME 1000000
 
-/** Minimum space (in bytes) that must be available in query log buffer for a
- * query to be logged. This should be set to maximum expected length of a 
- * single query log entry.
+/** Minimum space (in bytes) that must be available in text buffer for a
+ * binary query log record to be converted to text. This should be set to
+ * maximum expected length of a single query log text entry.
  */
 #define QUERY_LOG_BUF_MIN_SPACE 0xffff
 
+/** Size (in bytes) of buffer query log thread converts binary query log
+ * records to text in before writing text to query log file. MUST be larger
+ * than @ref QUERY_LOG_BUF_MIN_SPACE.
+ */
+#define QUERY_LOG_TEXT_BUF_SIZE 1048576
+
+/** Number of text buffers query log thread can hand to query log writer
+ * thread before it has to wait for writer thread to write them to disk.
+ */
+#define QUERY_LOG_WRITER_BUF_COUNT 4
+
+/** Alignment (in bytes) of query log text buffers and of writes to file
+ * with O_DIRECT. MUST be a multiple of file system block size and divide
+ * @ref QUERY_LOG_TEXT_BUF_SIZE.
+ */
+#define QUERY_LOG_DIRECT_IO_ALIGN 4096
+
+/** Compression level of compressed query log, fastest since query log is
+ * compressed at full query rate.
+ */
+#define QUERY_LOG_GZIP_LEVEL 1
+
+/** Suffix appended to names of compressed query log files. */
+#define QUERY_LOG_GZIP_SUFFIX ".gz"
+
+/** Time in seconds to wait for remote query log collector to accept Frame
+ * Streams content type.
+ */
+#define QUERY_LOG_REMOTE_HANDSHAKE_TIMEOUT 2
+
+/** Length of DNS client cookie (RFC 7873). */
+#define DNS_COOKIE_CLIENT_LEN 8
+
+/** Minimum length of DNS server cookie, as received from client. */
+#define DNS_COOKIE_SERVER_LEN_MIN 8
+
+/** Maximum length of DNS server cookie, as received from client. */
+#define DNS_COOKIE_SERVER_LEN_MAX 32
+
+/** Length of DNS server cookie this server generates (RFC 9018): version,
+ * reserved, timestamp, and hash.
+ */
+#define DNS_COOKIE_SERVER_LEN 16
+
+/** Length of secret DNS server cookie hash is keyed with. */
+#define DNS_COOKIE_SECRET_LEN 16
+
+/** Server cookie version generated and accepted (RFC 9018). */
+#define DNS_COOKIE_VERSION 1
+
+/** Seconds after it was generated server cookie is accepted for. */
+#define DNS_COOKIE_LIFETIME 3600
+
+/** Seconds server cookie timestamp is allowed to be in the future, to allow
+ * for clock skew between anycast servers sharing a secret.
+ */
+#define DNS_COOKIE_CLOCK_SKEW 300
+
+/** Seconds after which a valid server cookie is replaced by a newly generated
+ * one in response, rather than echoed back.
+ */
+#define DNS_COOKIE_REFRESH 1800
+
 #endif /* End of CONSTANTS_H */
 
 /** @}*/
@@ -0,0 +1,92 @@
+/**
+ * @file coroutine.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup coroutine Stackless coroutines
+ *
+ * @brief These are macros that write a per connection state machine as a
+ *        stackless (protothread style) coroutine: a function that reads top
+ *        to bottom, yields where it has to wait, and on next call resumes
+ *        right after the yield it returned from.
+ *
+ *        Coroutine state is a single @ref co_t, the resume point, kept in
+ *        object coroutine runs for, such as TCP connection. Resuming is a
+ *        jump through a switch statement on it, there is no stack and no
+ *        allocation. Vectorloop stage calls coroutine of each object it
+ *        dequeues, and moves object to next queue depending on what
+ *        coroutine returned, so objects keep flowing through stages in
+ *        batches.
+ *
+ *        Since there is no stack, local variables are not kept across a
+ *        yield, anything needed after it is stored in the object. Coroutine
+ *        body must not use switch statements that span a yield.
+ *  @{
+ */
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <stdint.h>
+
+/** Coroutine resume point, source line of yield coroutine returned from, 0
+ * if coroutine is to start from its beginning.
+ */
+typedef uint16_t co_t;
+
+/** Start coroutine body, jumping to resume point.
+ *
+ * @param co Pointer to coroutine resume point.
+ */
+#define CO_BEGIN(co) switch (*(co)) { case 0:
+
+/** Return from coroutine, resuming right after it on next call.
+ *
+ * @param co  Pointer to coroutine resume point.
+ * @param ret Value to return.
+ */
+#define CO_YIELD(co, ret) do {                                          \
+        _Static_assert(__LINE__ <= UINT16_MAX, "co_t can not hold line"); \
+        *(co) = __LINE__;                                               \
+        return (ret);                                                   \
+        case __LINE__:;                                                 \
+    } while (0)
+
+/** Return from coroutine, starting it from its beginning on next call.
+ *
+ * @param co  Pointer to coroutine resume point.
+ * @param ret Value to return.
+ */
+#define CO_RETURN(co, ret) do { \
+        *(co) = 0;              \
+        return (ret);           \
+    } while (0)
+
+/** End coroutine body, coroutine falling off its end starts from its
+ * beginning on next call.
+ *
+ * @param co Pointer to coroutine resume point.
+ */
+#define CO_END(co) } *(co) = 0
+
+#endif /* End of COROUTINE_H */
+
+/** @}*/
@@ -0,0 +1,62 @@
+/**
+ * @file dns_cookie.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup dns_cookie DNS Cookies
+ *
+ * @brief DNS cookies (RFC 7873) let a client prove it can receive responses
+ *        sent to the address it queries from. Server cookie is generated as
+ *        defined in RFC 9018: version, reserved bytes, timestamp, and a
+ *        SipHash-2-4 of client cookie, version, reserved bytes, timestamp, and
+ *        client IP address, keyed by a secret. Cookie is verified by
+ *        recomputing the hash, so no per client state is kept.
+ *
+ *        Every vectorloop (and every server of an anycast set) uses the same
+ *        secret, so a cookie generated by one is valid on the others.
+ *
+ *        Cookies are verified in the parse stage. Query with a valid server
+ *        cookie is from a client whose address is not spoofed, its response
+ *        is not subject to response rate limiting.
+ *  @{
+ */
+#ifndef DNS_COOKIE_H
+#define DNS_COOKIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "query.h"
+
+uint64_t dns_cookie_siphash(const uint8_t *key, const uint8_t *data, size_t len);
+void     dns_cookie_server_cookie(uint8_t *server_cookie, const uint8_t *secret,
+                                  const uint8_t *client_cookie,
+                                  struct sockaddr_storage *client_ip,
+                                  uint32_t timestamp);
+void     dns_cookie_verify(edns_cookie_t *cookie, const uint8_t *secret,
+                           struct sockaddr_storage *client_ip, uint32_t now);
+
+#endif /* End of DNS_COOKIE_H */
+
+/** @}*/
@@ -0,0 +1,247 @@
+/**
+ * @file dnssec.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup dnssec DNSSEC Online Signing
+ *
+ * @brief These are functions that sign RRsets of answers vectorloop
+ *        synthesizes, or zone does not have presigned RRSIG records for, as
+ *        they are served (online signing).
+ *
+ *        Signing key is an ECDSA P-256 (algorithm 13) or Ed25519 (algorithm
+ *        15) private key, a combined signing key (flags 257) of a single
+ *        zone. Its DNSKEY record, printed at startup, has to be added to the
+ *        zone.
+ *
+ *        Vectorloop never signs itself. Each vectorloop has an LRU cache of
+ *        RRSIG records it got signed, keyed by zone database generation and
+ *        RRset. On a cache miss vectorloop builds data to be signed (RRSIG
+ *        rdata and RRset in canonical form, RFC 4034 section 3.1.8.1), adds
+ *        a pending entry to cache and hands it to a worker thread as a job,
+ *        see @ref worker. Queries waiting for a signature are deferred, and
+ *        resumed once worker thread signed it. When worker queues or cache
+ *        are full, answer is sent unsigned rather than wait.
+ *  @{
+ */
+#ifndef DNSSEC_H
+#define DNSSEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <openssl/evp.h>
+
+#include "config.h"
+#include "rip_ns_utils.h"
+#include "rr_record.h"
+#include "worker.h"
+
+/** DNSSEC algorithm number of ECDSA P-256 with SHA-256 (RFC 6605). */
+#define DNSSEC_ALG_ECDSAP256SHA256 13
+
+/** DNSSEC algorithm number of Ed25519 (RFC 8080). */
+#define DNSSEC_ALG_ED25519 15
+
+/** DNSKEY flags of signing key, zone key with secure entry point bit set, as
+ * single key signs both DNSKEY RRset and zone data.
+ */
+#define DNSSEC_DNSKEY_FLAGS 257
+
+/** TTL of DNSKEY record printed for signing key. */
+#define DNSSEC_DNSKEY_TTL 3600
+
+/** DNSKEY protocol field, always 3 (RFC 4034 section 2.1.2). */
+#define DNSSEC_DNSKEY_PROTOCOL 3
+
+/** Length of signature of both supported algorithms. */
+#define DNSSEC_SIG_LEN 64
+
+/** Maximum length of public key of supported algorithms. */
+#define DNSSEC_PUBKEY_LEN_MAX 64
+
+/** Length of RRSIG rdata fields before signer name. */
+#define DNSSEC_RRSIG_FIXED_LEN 18
+
+/** Maximum length of RRSIG rdata. */
+#define DNSSEC_RRSIG_RDATA_MAX (DNSSEC_RRSIG_FIXED_LEN + RIP_NS_MAXCDNAME + 1 + \
+                                DNSSEC_SIG_LEN)
+
+/** Maximum length of data to be signed, RRsets larger than this are not
+ * signed.
+ */
+#define DNSSEC_SIGN_DATA_MAX RIP_NS_MAXMSG
+
+/** Signatures are made valid from this many seconds in the past, so
+ * validators with clocks behind do not reject them.
+ */
+#define DNSSEC_SIG_INCEPTION_SKEW 3600
+
+/** Structure holds signing key, shared by all vectorloops and worker threads,
+ * read only once loaded.
+ */
+typedef struct dnssec_key_s {
+    /** Private key. */
+    EVP_PKEY *pkey;
+
+    /** DNSSEC algorithm number, one of DNSSEC_ALG_* constants. */
+    uint8_t algorithm;
+
+    /** Key tag of DNSKEY record (RFC 4034 appendix B). */
+    uint16_t key_tag;
+
+    /** Signer name, zone apex, wire format lower cased. */
+    unsigned char signer[RIP_NS_MAXCDNAME + 1];
+
+    /** Length of signer name. */
+    uint16_t signer_len;
+
+    /** DNSKEY record rdata. */
+    uint8_t dnskey[4 + DNSSEC_PUBKEY_LEN_MAX];
+
+    /** Length of DNSKEY record rdata. */
+    uint16_t dnskey_len;
+
+    /** Number of seconds signatures are valid for. */
+    uint32_t validity;
+} dnssec_key_t;
+
+/** State of an RRSIG record in signature cache. */
+typedef enum dnssec_sig_state_e {
+    /** Entry is not in use. */
+    DNSSEC_SIG_ST_FREE = 0,
+
+    /** Entry is queued to a worker thread, or being signed. */
+    DNSSEC_SIG_ST_PENDING,
+
+    /** RRSIG record is signed. */
+    DNSSEC_SIG_ST_READY,
+
+    /** Signing failed, RRset is answered unsigned until entry is evicted. */
+    DNSSEC_SIG_ST_FAILED,
+} dnssec_sig_state_t;
+
+/** Structure describes an RRSIG record in signature cache. While entry is
+ * pending only the worker thread it is queued to touches it.
+ */
+typedef struct dnssec_sig_s {
+    /** Worker thread job signing entry, MUST be first member. */
+    worker_job_t job;
+
+    /** Key entry is signed with. */
+    dnssec_key_t *key;
+
+    /** Zone database generation RRset belongs to, part of key. */
+    uint64_t generation;
+
+    /** First record of signed RRset, part of key. */
+    const rr_record_t *rrs;
+
+    /** Next entry in hash table chain, or in free list. */
+    struct dnssec_sig_s *hash_next;
+
+    /** Previous (more recently used) entry in LRU list. */
+    struct dnssec_sig_s *lru_prev;
+
+    /** Next (less recently used) entry in LRU list. */
+    struct dnssec_sig_s *lru_next;
+
+    /** Cache epoch entry was last used in, entry used in current epoch is
+     * not evicted as queries resolved with it might not be packed yet.
+     */
+    uint64_t used_epoch;
+
+    /** Time (seconds since epoch) after which entry is signed again, half
+     * way through signature validity.
+     */
+    uint32_t refresh;
+
+    /** Entry state. */
+    dnssec_sig_state_t state;
+
+    /** Data to be signed, while entry is pending. */
+    uint8_t *data;
+
+    /** Length of data to be signed. */
+    size_t data_len;
+
+    /** RRSIG record, name and rdata point into entry. */
+    rr_record_t rr;
+
+    /** RRSIG record owner name, presentation format. */
+    unsigned char name[RIP_NS_MAXCDNAME * 4 + 1];
+
+    /** RRSIG record rdata. */
+    uint8_t rdata[DNSSEC_RRSIG_RDATA_MAX];
+} dnssec_sig_t;
+
+/** Structure holds LRU cache of RRSIG records of a vectorloop. */
+typedef struct dnssec_sig_cache_s {
+    /** Array of entries. */
+    dnssec_sig_t *entries;
+
+    /** Number of entries. */
+    size_t size;
+
+    /** Hash table of signed and pending entries. */
+    dnssec_sig_t **table;
+
+    /** Hash table mask, table size is (mask + 1) which is a power of 2. */
+    uint32_t mask;
+
+    /** Most recently used signed (or failed) entry. */
+    dnssec_sig_t *lru_head;
+
+    /** Least recently used signed (or failed) entry, evicted first. */
+    dnssec_sig_t *lru_tail;
+
+    /** Free entries, linked through hash_next. */
+    dnssec_sig_t *free;
+
+    /** Current epoch, advanced by vectorloop each iteration. */
+    uint64_t epoch;
+} dnssec_sig_cache_t;
+
+int            dnssec_key_load(dnssec_key_t *key, config_t *cfg, char *err_buf,
+                               size_t err_buf_len);
+void           dnssec_key_clean(dnssec_key_t *key);
+int            dnssec_key_dnskey_text(dnssec_key_t *key, char *buf, size_t buf_len);
+uint16_t       dnssec_key_tag(const uint8_t *rdata, uint16_t rdata_len);
+int            dnssec_sig_prepare(dnssec_key_t *key, dnssec_sig_t *sig,
+                                  const unsigned char *owner, uint16_t owner_len,
+                                  const rr_record_t *rrs, uint16_t rr_count,
+                                  uint32_t now);
+int            dnssec_sig_sign(dnssec_key_t *key, dnssec_sig_t *sig, EVP_MD_CTX *md_ctx);
+
+void           dnssec_sig_cache_init(dnssec_sig_cache_t *cache, size_t size);
+void           dnssec_sig_cache_clean(dnssec_sig_cache_t *cache);
+dnssec_sig_t * dnssec_sig_cache_get(dnssec_sig_cache_t *cache, uint64_t generation,
+                                    const rr_record_t *rrs, uint32_t now);
+dnssec_sig_t * dnssec_sig_cache_add(dnssec_sig_cache_t *cache, uint64_t generation,
+                                    const rr_record_t *rrs);
+void           dnssec_sig_cache_done(dnssec_sig_cache_t *cache, dnssec_sig_t *sig);
+void           dnssec_sig_cache_drop(dnssec_sig_cache_t *cache, dnssec_sig_t *sig);
+
+#endif /* End of DNSSEC_H */
+
+/** @}*/
@@ -0,0 +1,84 @@
+/**
+ * @file dnstap.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup dnstap Dnstap
+ *
+ * @brief Dnstap encoding of query log records.
+ *
+ *        Binary query log records are encoded on query log thread as dnstap
+ *        protobuf messages, AUTH_QUERY and (if response was sent)
+ *        AUTH_RESPONSE, each in a Frame Streams data frame. Query and response
+ *        DNS messages are rebuilt from logged query data, since vectorloop
+ *        does not copy raw messages. Rebuilt response holds answer section
+ *        and EDNS options only. Answer record data is only logged for address
+ *        and domain name records, other answer records have empty data.
+ *
+ *        See https://dnstap.info and
+ *        https://github.com/farsightsec/fstrm for formats.
+ *  @{
+ */
+#ifndef DNSTAP_H
+#define DNSTAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Frame Streams content type of dnstap. */
+#define DNSTAP_CONTENT_TYPE "protobuf:dnstap.Dnstap"
+
+/** Value of dnstap "version" field. */
+#define DNSTAP_VERSION "ripples"
+
+/** Frame Streams control frame types. */
+typedef enum dnstap_fstrm_control_e {
+    DNSTAP_FSTRM_CONTROL_ACCEPT = 0x01,
+    DNSTAP_FSTRM_CONTROL_START  = 0x02,
+    DNSTAP_FSTRM_CONTROL_STOP   = 0x03,
+    DNSTAP_FSTRM_CONTROL_READY  = 0x04,
+    DNSTAP_FSTRM_CONTROL_FINISH = 0x05,
+} dnstap_fstrm_control_t;
+
+/** Frame Streams control frame field type holding content type. */
+#define DNSTAP_FSTRM_FIELD_CONTENT_TYPE 0x01
+
+/** Maximum length of Frame Streams control frame this application sends or
+ * receives.
+ */
+#define DNSTAP_FSTRM_CONTROL_MAX 512
+
+/** Dnstap message types logged. */
+typedef enum dnstap_message_type_e {
+    DNSTAP_MESSAGE_AUTH_QUERY    = 1,
+    DNSTAP_MESSAGE_AUTH_RESPONSE = 2,
+} dnstap_message_type_t;
+
+size_t dnstap_control_frame(char *buf, dnstap_fstrm_control_t type,
+                            bool content_type);
+int    dnstap_control_frame_type(const char *buf, size_t len);
+int    query_log_record_to_dnstap(const char *rec, char *buf, size_t buf_len);
+
+#endif /* End of DNSTAP_H */
+
+/** @}*/
@@ -0,0 +1,162 @@
+/**
+ * @file dot.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup dot DNS over TLS
+ *
+ * @brief These are functions that provide DNS over TLS (DoT, RFC 7858)
+ *        listeners with TLS handshake and kernel TLS.
+ *
+ *        New DoT connection is accepted by vectorloop same as a TCP
+ *        connection, then handed to one of vectorloop handshake threads which
+ *        does TLS handshake (OpenSSL), so vectorloop never blocks on it. Once
+ *        handshake is done traffic keys are installed into the kernel (kTLS,
+ *        socket options TLS_TX and TLS_RX), and connection is handed back to
+ *        vectorloop where it is served by same read and write functions as a
+ *        plain TCP connection, kernel encrypts and decrypts records.
+ *
+ *        Only TLS 1.3 is used, with cipher suites kernel TLS supports. Traffic
+ *        secrets are taken from OpenSSL key log callback, and session tickets
+ *        are not sent so nothing is written on connection by OpenSSL once
+ *        handshake is done.
+ *  @{
+ */
+#ifndef DOT_H
+#define DOT_H
+
+#include <linux/tls.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <liblfds711.h>
+#include <openssl/ssl.h>
+
+#include "config.h"
+#include "conn.h"
+
+/** Number of elements in handshake thread request and result queues. MUST be
+ * a power of 2, queue holds one less connection than this.
+ */
+#define DOT_HANDSHAKE_QUEUE_LEN 256
+
+/** TLS 1.3 cipher suites DoT listeners offer, those kernel TLS supports. */
+#define DOT_TLS_CIPHERSUITES "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:" \
+                             "TLS_CHACHA20_POLY1305_SHA256"
+
+/** Maximum length of TLS 1.3 traffic secret (SHA384 digest length). */
+#define DOT_TLS_SECRET_MAX 48
+
+/** Length of TLS 1.3 record IV (nonce). */
+#define DOT_TLS_IV_LEN 12
+
+/** Structure holds TLS context shared by all handshake threads. */
+typedef struct dot_ctx_s {
+    /** OpenSSL context with DoT certificate and key loaded. */
+    SSL_CTX *ssl_ctx;
+
+    /** Time in miliseconds a TLS handshake has to complete in. */
+    size_t timeout_ms;
+} dot_ctx_t;
+
+/** Structure holds kernel TLS crypto info for one direction of a
+ * connection, as passed to socket option TLS_TX or TLS_RX.
+ */
+typedef struct dot_ktls_info_s {
+    /** Crypto info, which member is used depends on cipher. */
+    union {
+        struct tls_crypto_info                    info;
+        struct tls12_crypto_info_aes_gcm_128      aes_gcm_128;
+        struct tls12_crypto_info_aes_gcm_256      aes_gcm_256;
+        struct tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+    } crypto;
+
+    /** Length of crypto info. */
+    size_t len;
+} dot_ktls_info_t;
+
+/** Structure describes a TLS handshake thread of a vectorloop. Vectorloop
+ * is the only producer of request queue and consumer of result queue, and
+ * handshake thread the only consumer of request and producer of result queue.
+ */
+typedef struct dot_worker_s {
+    /** Request queue, connections to do handshake on. */
+    struct lfds711_queue_bss_element req_qbsse[DOT_HANDSHAKE_QUEUE_LEN];
+
+    /** Request queue state. */
+    struct lfds711_queue_bss_state req_qbsss;
+
+    /** Result queue, connections handshake was done on. */
+    struct lfds711_queue_bss_element res_qbsse[DOT_HANDSHAKE_QUEUE_LEN];
+
+    /** Result queue state. */
+    struct lfds711_queue_bss_state res_qbsss;
+
+    /** Eventfd handshake thread blocks on, written to by vectorloop each time
+     * it queues a request.
+     */
+    int req_fd;
+
+    /** Eventfd of vectorloop, written to each time a result is queued. */
+    int wake_fd;
+
+    /** Number of connections in request and result queues, only used by
+     * vectorloop.
+     */
+    size_t in_flight;
+
+    /** TLS context. */
+    dot_ctx_t *ctx;
+
+    /** Handshake thread. */
+    pthread_t thread;
+} dot_worker_t;
+
+/** Structure holds TLS handshake threads of a vectorloop. */
+typedef struct dot_pool_s {
+    /** Array of handshake threads. */
+    dot_worker_t *workers;
+
+    /** Number of handshake threads. */
+    size_t count;
+
+    /** Number of connections handed to handshake threads and not
+     * collected back yet.
+     */
+    size_t in_flight;
+} dot_pool_t;
+
+int      dot_ctx_load(dot_ctx_t *ctx, config_t *cfg, char *err_buf,
+                      size_t err_buf_len);
+bool     dot_ktls_available(void);
+int      dot_ktls_info(dot_ktls_info_t *info, uint16_t cipher,
+                       const unsigned char *secret, size_t secret_len);
+void     dot_pool_start(dot_pool_t *pool, dot_ctx_t *ctx, size_t count,
+                        int wake_fd);
+bool     dot_pool_submit(dot_pool_t *pool, conn_t *conn);
+conn_t * dot_pool_done(dot_pool_t *pool);
+
+#endif /* End of DOT_H */
+
+/** @}*/
@@ -0,0 +1,116 @@
+/**
+ * @file ecs_map.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup ecs_map ECS Map
+ *
+ * @brief ECS map assigns EDNS client subnets (RFC 7871) to views, so
+ *        queries can be answered with view specific RRset variants.
+ *
+ *        Map is built by resource thread from an ECS map file, and once
+ *        built it is never modified. Like zone database each reload produces
+ *        a new map object which is handed over to vectorloop threads via
+ *        resource channel.
+ *
+ *        Prefixes from map file are first inserted into a binary trie which
+ *        is walked once to split address space into disjoint regions. Each
+ *        region carries its view and the scope prefix length, the shortest
+ *        prefix length for which all addresses in region resolve to the same
+ *        view. Regions are then expanded into a multibit trie with a 16 bit
+ *        root stride followed by 8 bit strides (DIR-16-8-8 style), shared by
+ *        IPv4 and IPv6. Lookup is one memory access for prefixes up to /16 and
+ *        one more per additional byte of prefix, there is no backtracking.
+ *
+ *        ECS map file format is one prefix per line:
+ *
+ *            <prefix>/<length> <view>
+ *
+ *        View is a single DNS label. Text following a ';' character is a
+ *        comment. Records of a view are kept in zone file under owner name
+ *        prefixed by view label, e.g. records for "www.example.com" in view
+ *        "_eu" are owned by "_eu.www.example.com".
+ *
+ *  @{
+ */
+#ifndef ECS_MAP_H
+#define ECS_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "rip_ns_utils.h"
+
+/** Maximum number of views ECS map can hold. */
+#define ECS_MAP_VIEWS_MAX 4096
+
+/** Number of entries in ECS map table root, root stride is 16 bits. */
+#define ECS_MAP_ROOT_SIZE 65536
+
+/** Number of entries in ECS map table chunk, chunk stride is 8 bits. */
+#define ECS_MAP_CHUNK_SIZE 256
+
+/** ECS map table entry flag, entry holds index of child chunk instead of a
+ * leaf (view and scope).
+ */
+#define ECS_MAP_F_CHILD 0x80000000U
+
+/** Structure describes ECS map. Once created it is read only. */
+typedef struct ecs_map_s {
+    /** Generation number of map, assigned at creation. */
+    uint64_t generation;
+
+    /** IPv4 table root, indexed by first 2 bytes of address. */
+    uint32_t *v4_root;
+
+    /** IPv6 table root, indexed by first 2 bytes of address. */
+    uint32_t *v6_root;
+
+    /** Table chunks of both address families, each chunk has
+     * ECS_MAP_CHUNK_SIZE entries indexed by next byte of address.
+     */
+    uint32_t *chunks;
+
+    /** Number of chunks. */
+    uint32_t chunks_count;
+
+    /** Wire format (lower cased) view labels, length byte followed by label,
+     * indexed by (view - 1).
+     */
+    unsigned char (*views)[RIP_NS_MAXLABEL + 1];
+
+    /** Number of views. */
+    uint16_t views_count;
+} ecs_map_t;
+
+ecs_map_t * ecs_map_create(const char *buf, size_t buf_len, uint64_t generation,
+                           char *err, size_t err_len);
+void ecs_map_release(ecs_map_t *map);
+
+uint16_t ecs_map_lookup(ecs_map_t *map, uint16_t family, const uint8_t *addr,
+                        uint8_t *scope);
+uint16_t ecs_map_lookup_sockaddr(ecs_map_t *map, const struct sockaddr_storage *ip);
+
+#endif /* End of ECS_MAP_H */
+
+/** @}*/
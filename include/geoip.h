@@ -0,0 +1,244 @@
+/**
+ * @file geoip.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup geoip GeoIP
+ *
+ * @brief GeoIP database maps client address, or EDNS client subnet address,
+ *        to country and continent, so queries can be answered with geo
+ *        specific RRset variants.
+ *
+ *        Database is a MaxMind DB (mmdb) file, as GeoLite2 or GeoIP2
+ *        Country and City databases are. File is memory mapped read only by
+ *        resource thread and is never modified, each reload maps a new file
+ *        into a new database object. Lookup walks the database binary search
+ *        tree one address bit per node and then decodes "country.iso_code"
+ *        ("registered_country.iso_code" if there is none) and
+ *        "continent.code" from data section.
+ *
+ *        Tree walk and decoding take a few hundred nanoseconds, so each
+ *        vectorloop keeps a direct mapped cache of results by IPv4 /24 and
+ *        IPv6 /48 prefix, see @ref geoip_cache_lookup(). Only results of
+ *        database networks no longer than those prefixes are cached, as only
+ *        they hold for whole prefix.
+ *
+ *        Records of a geo variant are kept in zone file under owner name
+ *        prefixed by "_cc-<country>" or "_ct-<continent>" label, e.g.
+ *        records for "www.example.com" for clients in Germany are owned by
+ *        "_cc-de.www.example.com", and for clients in Europe by
+ *        "_ct-eu.www.example.com". Country variant takes precedence.
+ *
+ *  @{
+ */
+#ifndef GEOIP_H
+#define GEOIP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/** Number of entries in per vectorloop GeoIP result cache. Must be a power
+ * of 2.
+ */
+#define GEOIP_CACHE_SLOTS 4096
+
+/** Longest IPv4 database network whose result is cached for its /24. */
+#define GEOIP_CACHE_V4_PREFIX 24
+
+/** Longest IPv6 database network whose result is cached for its /48. */
+#define GEOIP_CACHE_V6_PREFIX 48
+
+/** Structure describes a GeoIP database. Once created it is read only. */
+typedef struct geoip_s {
+    /** Generation number of database, assigned at creation. */
+    uint64_t generation;
+
+    /** Memory mapped database file. */
+    const uint8_t *map;
+
+    /** Length of database file. */
+    size_t map_len;
+
+    /** Search tree, node_count nodes of two records each. */
+    const uint8_t *tree;
+
+    /** Number of search tree nodes. */
+    uint32_t node_count;
+
+    /** Size of search tree record in bits, 24, 28 or 32. */
+    uint16_t record_size;
+
+    /** IP version of search tree, 4 or 6. */
+    uint16_t ip_version;
+
+    /** Data section. */
+    const uint8_t *data;
+
+    /** Length of data section. */
+    uint32_t data_len;
+
+    /** Node IPv4 addresses are looked up from, node reached by 96 zero bits
+     * in IPv6 tree, 0 in IPv4 tree.
+     */
+    uint32_t ipv4_start;
+} geoip_t;
+
+/** Structure describes a GeoIP result cache entry. */
+typedef struct geoip_cache_entry_s {
+    /** Cache key, address family in top 2 bits followed by address /24 or
+     * /48 prefix, 0 if entry is not used.
+     */
+    uint64_t key;
+
+    /** Geo of prefix, see @ref geoip_lookup(). */
+    uint32_t geo;
+
+    /** Prefix length of database network prefix is in. */
+    uint8_t scope;
+} geoip_cache_entry_t;
+
+/** Structure describes a per vectorloop GeoIP result cache. */
+typedef struct geoip_cache_s {
+    /** Generation of database entries were looked up in. */
+    uint64_t generation;
+
+    /** Entries, indexed by hash of key. */
+    geoip_cache_entry_t entries[GEOIP_CACHE_SLOTS];
+} geoip_cache_t;
+
+geoip_t * geoip_open(int fd, size_t len, uint64_t generation, char *err, size_t err_len);
+void geoip_release(geoip_t *geoip);
+
+uint32_t geoip_lookup_addr(const geoip_t *geoip, uint16_t family, const uint8_t *addr,
+                           uint8_t *scope);
+
+/** Get address family (1 for IPv4 and 2 for IPv6, as in EDNS client subnet)
+ * and address bytes of socket address. IPv4 mapped IPv6 address is IPv4.
+ *
+ * @param ip   Socket address.
+ * @param addr Where to store pointer to address bytes.
+ *
+ * @return     Returns address family, 0 if it is neither IPv4 nor IPv6.
+ */
+static inline uint16_t
+geoip_sockaddr(const struct sockaddr_storage *ip, const uint8_t **addr)
+{
+    const struct in6_addr *a6;
+
+    if (ip->ss_family == AF_INET) {
+        *addr = (const uint8_t *)&((const struct sockaddr_in *)ip)->sin_addr;
+        return 1;
+    }
+    if (ip->ss_family != AF_INET6) {
+        return 0;
+    }
+    a6 = &((const struct sockaddr_in6 *)ip)->sin6_addr;
+    if (IN6_IS_ADDR_V4MAPPED(a6)) {
+        *addr = a6->s6_addr + 12;
+        return 1;
+    }
+    *addr = a6->s6_addr;
+    return 2;
+}
+
+/** Look up geo of address in database.
+ *
+ * Geo is country ISO code in upper 16 bits and continent code in lower 16
+ * bits, two lower cased ASCII characters each, first character in high
+ * byte. Code database has no value for is 0.
+ *
+ * @param geoip Database to look address up in.
+ * @param ip    Address to look up.
+ * @param scope Where to store prefix length of database network address is
+ *              in.
+ *
+ * @return      Returns geo of address, 0 if database has none.
+ */
+static inline uint32_t
+geoip_lookup(const geoip_t *geoip, const struct sockaddr_storage *ip, uint8_t *scope)
+{
+    const uint8_t *addr   = NULL;
+    uint16_t       family = geoip_sockaddr(ip, &addr);
+
+    *scope = 0;
+    return family == 0 ? 0 : geoip_lookup_addr(geoip, family, addr, scope);
+}
+
+/** Look up geo of address through per vectorloop result cache, see
+ * @ref geoip_lookup(). Cache is emptied when database generation changes.
+ *
+ * @param cache Result cache.
+ * @param geoip Database to look address up in on cache miss.
+ * @param ip    Address to look up.
+ * @param geo   Where to store geo of address.
+ * @param scope Where to store prefix length of database network address is
+ *              in.
+ *
+ * @return      Returns true if result was found in cache, false if it was
+ *              looked up in database.
+ */
+static inline bool
+geoip_cache_lookup(geoip_cache_t *cache, const geoip_t *geoip,
+                   const struct sockaddr_storage *ip, uint32_t *geo, uint8_t *scope)
+{
+    const uint8_t       *addr   = NULL;
+    uint16_t             family = geoip_sockaddr(ip, &addr);
+    uint64_t             key;
+    geoip_cache_entry_t *entry;
+
+    if (family == 0) {
+        *geo   = 0;
+        *scope = 0;
+        return true;
+    }
+    if (cache->generation != geoip->generation) {
+        memset(cache->entries, 0, sizeof(cache->entries));
+        cache->generation = geoip->generation;
+    }
+    if (family == 1) {
+        key = 1ULL << 62 | (uint64_t)addr[0] << 16 | (uint64_t)addr[1] << 8 | addr[2];
+    } else {
+        key = 2ULL << 62;
+        for (int i = 0; i < GEOIP_CACHE_V6_PREFIX / 8; i++) {
+            key |= (uint64_t)addr[i] << (40 - 8 * i);
+        }
+    }
+    entry = &cache->entries[(key * 0x9e3779b97f4a7c15ULL) >> (64 - __builtin_ctz(GEOIP_CACHE_SLOTS))];
+    if (entry->key == key) {
+        *geo   = entry->geo;
+        *scope = entry->scope;
+        return true;
+    }
+    *geo = geoip_lookup_addr(geoip, family, addr, scope);
+    if (*scope <= (family == 1 ? GEOIP_CACHE_V4_PREFIX : GEOIP_CACHE_V6_PREFIX)) {
+        *entry = (geoip_cache_entry_t) { .key = key, .geo = *geo, .scope = *scope };
+    }
+    return false;
+}
+
+#endif /* End of GEOIP_H */
+
+/** @}*/
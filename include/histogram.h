@@ -0,0 +1,126 @@
+/**
+ * @file histogram.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup histogram Histogram
+ *
+ * @brief Log-linear (HDR style) histogram of 64 bit values, used to track
+ *        query latencies in nanoseconds.
+ *
+ *        Values below @ref HISTOGRAM_SUB_BUCKETS are counted exactly. Larger
+ *        values are grouped by their highest set bit (power of two), and each
+ *        power of two range is split into @ref HISTOGRAM_SUB_BUCKETS linear
+ *        sub buckets, so a bucket's width is at most 1/16 (6.25%) of the
+ *        values it holds. Values of 2^36 (~68 seconds) and above are counted
+ *        in last bucket.
+ *
+ *        Histogram is made of atomic_ullong counters only, and is written by
+ *        a single thread with plain (non locked) increments. Histograms are
+ *        merged by adding them counter by counter, so they can be embedded in
+ *        vectorloop metrics, see @ref metrics_vl_sum.
+ *  @{
+ */
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/** Number of bits of value precision kept within a power of two range. */
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+
+/** Number of linear sub buckets per power of two range. */
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+/** Highest power of two tracked, values with a higher set bit are counted in
+ * last bucket.
+ */
+#define HISTOGRAM_EXPONENT_MAX 35
+
+/** Number of histogram buckets. */
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_EXPONENT_MAX - HISTOGRAM_SUB_BUCKET_BITS + 2) * \
+                           HISTOGRAM_SUB_BUCKETS)
+
+/** Structure describes a histogram. */
+typedef struct histogram_s {
+    /** Number of values recorded. */
+    atomic_ullong count;
+
+    /** Sum of values recorded. */
+    atomic_ullong sum;
+
+    /** Number of values recorded per bucket. */
+    atomic_ullong buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+/** Get index of histogram bucket a value is counted in.
+ *
+ * @param value Value to get bucket index for.
+ *
+ * @return      Returns bucket index.
+ */
+static inline unsigned int
+histogram_bucket_index(uint64_t value)
+{
+    unsigned int exponent;
+    unsigned int shift;
+
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+    exponent = 63 - __builtin_clzll(value);
+    if (exponent > HISTOGRAM_EXPONENT_MAX) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+           ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/** Record a value in histogram. Only one thread may record values in a
+ * histogram, other threads may read it at any time.
+ *
+ * @param h     Histogram to record value in.
+ * @param value Value to record.
+ */
+static inline void
+histogram_record(histogram_t *h, uint64_t value)
+{
+    atomic_ullong *bucket = &h->buckets[histogram_bucket_index(value)];
+
+    atomic_store_explicit(&h->count,
+        atomic_load_explicit(&h->count, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&h->sum,
+        atomic_load_explicit(&h->sum, memory_order_relaxed) + value, memory_order_relaxed);
+    atomic_store_explicit(bucket,
+        atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+uint64_t histogram_bucket_value_max(unsigned int index);
+void     histogram_merge(histogram_t *dst, histogram_t *src);
+uint64_t histogram_quantile(histogram_t *h, double quantile);
+
+#endif /* End of HISTOGRAM_H */
+
+/** @}*/
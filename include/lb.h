@@ -0,0 +1,298 @@
+/**
+ * @file lb.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup lb Load Balancing
+ *
+ * @brief Load balanced names are answered with a record picked, by weight,
+ *        from a set of candidate records whose endpoints are healthy.
+ *
+ *        Candidate sets are built by resource thread from a load balancing
+ *        file and are never modified once built, except for health bitmap.
+ *        Each candidate is a precompiled A or AAAA record of an endpoint,
+ *        and endpoints shared by candidates are checked once. Query resolve
+ *        looks set up by query name and type in a small open addressing
+ *        table, and picks a record with no locks and no allocations, see
+ *        @ref lb_pick().
+ *
+ *        Health checker thread (see @ref lb_check_loop()) probes endpoints
+ *        with TCP connect, all of them at once, every "lb_check_interval"
+ *        seconds. Endpoint goes down after @ref LB_CHECK_FALL failed probes
+ *        in a row and up after @ref LB_CHECK_RISE passed ones. Checker
+ *        publishes health as a bitmap of one bit per endpoint, stored word
+ *        by word with atomic stores, so vectorloops see a change within one
+ *        loop iteration. Checker is a QSBR reader of resource set, see
+ *        @ref qsbr, so candidate sets it probes stay valid during a round.
+ *        Candidate sets built from a changed file take health of endpoints
+ *        they share with sets they replace.
+ *
+ *        Load balancing file format is one candidate record per line:
+ *
+ *            <name> <ttl> <A|AAAA> <address> <weight> [port]
+ *
+ *        Weight is 1-65535. Port is TCP port endpoint is probed on, endpoint
+ *        with no port is not probed and is always healthy. Candidates of
+ *        the same name and type form a set. If every endpoint of a set is
+ *        down, record is picked as if all were healthy. Text following a
+ *        ';' character is a comment.
+ *
+ *  @{
+ */
+#ifndef LB_H
+#define LB_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "metrics.h"
+#include "rip_ns_utils.h"
+#include "rr_record.h"
+
+struct resource_set_s;
+
+/** Structure describes an endpoint candidate records point to. */
+typedef struct lb_endpoint_s {
+    /** Address endpoint is probed at, port included. */
+    struct sockaddr_storage addr;
+
+    /** Length of addr. */
+    socklen_t addr_len;
+
+    /** TCP port endpoint is probed on, 0 if endpoint is not probed. */
+    uint16_t port;
+} lb_endpoint_t;
+
+/** Structure describes a candidate record of a set. */
+typedef struct lb_candidate_s {
+    /** Record, packed with query name as owner name. Its rdata points to
+     * rdata of this candidate.
+     */
+    rr_record_t rr;
+
+    /** Index of endpoint in endpoints array and health bitmap. */
+    uint32_t endpoint;
+
+    /** Weight of candidate, 1-65535. */
+    uint32_t weight;
+
+    /** Record data, IPv4 or IPv6 address in network order. */
+    uint8_t rdata[16];
+} lb_candidate_t;
+
+/** Structure describes a set of candidate records of a name and type. */
+typedef struct lb_set_s {
+    /** Hash of name, see @ref rip_ns_name_hash. */
+    uint64_t hash;
+
+    /** Index of first candidate of set in candidates array. */
+    uint32_t first;
+
+    /** Number of candidates of set. */
+    uint16_t count;
+
+    /** Record type, A or AAAA. */
+    uint16_t type;
+
+    /** Length of name, including root label. */
+    uint16_t name_len;
+
+    /** Lower cased wire format name. */
+    unsigned char name[RIP_NS_MAXCDNAME + 1];
+
+    /** Name in presentation format, owner name of candidate records. */
+    char text[RIP_NS_MAXCDNAME * 4 + 1];
+} lb_set_t;
+
+/** Structure describes load balancing candidate sets and health of their
+ * endpoints. Once created only health bitmap changes.
+ */
+typedef struct lb_s {
+    /** Generation number of candidate sets, assigned at creation. */
+    uint64_t generation;
+
+    /** Candidate sets. */
+    lb_set_t *sets;
+
+    /** Number of candidate sets. */
+    uint32_t sets_count;
+
+    /** Open addressing table of set indexes plus one, 0 is an empty slot. */
+    uint32_t *slots;
+
+    /** Number of slots minus one, number of slots is a power of two. */
+    uint32_t slots_mask;
+
+    /** Candidate records, those of a set are adjacent. */
+    lb_candidate_t *candidates;
+
+    /** Number of candidate records. */
+    uint32_t candidates_count;
+
+    /** Endpoints, unique by address and port. */
+    lb_endpoint_t *endpoints;
+
+    /** Number of endpoints. */
+    uint32_t endpoints_count;
+
+    /** Health bitmap, bit set if endpoint of same index is healthy. Only
+     * health checker thread writes it, once sets are published.
+     */
+    atomic_ullong *health;
+
+    /** Number of words in health bitmap. */
+    uint32_t health_words;
+} lb_t;
+
+/** Structure holds arguments passed to @ref lb_check_loop function. */
+typedef struct lb_check_loop_args_s {
+    /** Configuration settings to use. */
+    config_t *cfg;
+
+    /** Resource set candidate sets are published in. */
+    struct resource_set_s *resources;
+
+    /** QSBR reader ID of health checker thread in resource set. */
+    size_t reader_id;
+
+    /** Application log channel. */
+    channel_log_t *app_log_channel;
+
+    /** Metrics endpoint health is reported to. */
+    metrics_t *metrics;
+} lb_check_loop_args_t;
+
+lb_t * lb_create(const char *buf, size_t buf_len, uint64_t generation,
+                 const lb_t *current, char *err, size_t err_len);
+void   lb_release(lb_t *lb);
+void * lb_check_loop(void *args);
+
+/** Check if endpoint is healthy.
+ *
+ * @param lb       Candidate sets endpoint belongs to.
+ * @param endpoint Index of endpoint.
+ *
+ * @return         Returns true if endpoint is healthy.
+ */
+static inline bool
+lb_healthy(const lb_t *lb, uint32_t endpoint)
+{
+    return atomic_load_explicit(&lb->health[endpoint >> 6], memory_order_relaxed) >>
+           (endpoint & 63) & 1;
+}
+
+/** Find candidate set of name and type.
+ *
+ * @param lb       Candidate sets to search.
+ * @param name     Lower cased wire format name.
+ * @param name_len Length of name, including root label.
+ * @param hash     Hash of name, see @ref rip_ns_name_hash.
+ * @param type     Record type.
+ *
+ * @return         Returns candidate set, NULL if there is none.
+ */
+static inline const lb_set_t *
+lb_set_find(const lb_t *lb, const unsigned char *name, uint16_t name_len,
+            uint64_t hash, uint16_t type)
+{
+    uint32_t i;
+
+    if (lb->sets_count == 0) {
+        return NULL;
+    }
+    for (uint32_t s = (uint32_t)(hash ^ type) & lb->slots_mask;
+         (i = lb->slots[s]) != 0; s = (s + 1) & lb->slots_mask) {
+        const lb_set_t *set = &lb->sets[i - 1];
+
+        if (set->hash == hash && set->type == type && set->name_len == name_len &&
+            memcmp(set->name, name, name_len) == 0) {
+            return set;
+        }
+    }
+    return NULL;
+}
+
+/** Pick a candidate record of name and type, by weight, among candidates
+ * whose endpoint is healthy. If no endpoint of set is healthy, candidate is
+ * picked among all of them.
+ *
+ * @param lb       Candidate sets to pick from.
+ * @param name     Lower cased wire format name.
+ * @param name_len Length of name, including root label.
+ * @param hash     Hash of name, see @ref rip_ns_name_hash.
+ * @param type     Record type.
+ * @param seed     Random value candidate is picked with.
+ * @param all_down Set to true if no endpoint of set is healthy.
+ *
+ * @return         Returns picked record, NULL if name and type have no set.
+ */
+static inline const rr_record_t *
+lb_pick(const lb_t *lb, const unsigned char *name, uint16_t name_len, uint64_t hash,
+        uint16_t type, uint64_t seed, bool *all_down)
+{
+    const lb_set_t       *set = lb_set_find(lb, name, name_len, hash, type);
+    const lb_candidate_t *c;
+    const lb_candidate_t *last  = NULL;
+    uint64_t              total = 0;
+    uint64_t              r;
+
+    if (set == NULL) {
+        return NULL;
+    }
+    c = &lb->candidates[set->first];
+    for (uint16_t i = 0; i < set->count; i++) {
+        total += lb_healthy(lb, c[i].endpoint) ? c[i].weight : 0;
+    }
+    *all_down = total == 0;
+    if (*all_down) {
+        for (uint16_t i = 0; i < set->count; i++) {
+            total += c[i].weight;
+        }
+    }
+
+    /* Seed is mixed (murmur3 finalizer) and scaled to [0, total). */
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdULL;
+    seed ^= seed >> 33;
+    r = (seed >> 32) * total >> 32;
+    for (uint16_t i = 0; i < set->count; i++) {
+        uint64_t w = (*all_down || lb_healthy(lb, c[i].endpoint)) ? c[i].weight : 0;
+
+        if (r < w) {
+            return &c[i].rr;
+        }
+        r -= w;
+        last = w > 0 ? &c[i] : last;
+    }
+    /* Endpoint went down while picking. */
+    return &(last != NULL ? last : c)->rr;
+}
+
+#endif /* End of LB_H */
+
+/** @}*/
@@ -34,6 +34,8 @@
 #ifndef LOG_APP_H
 #define LOG_APP_H
 
+#include <stdatomic.h>
+
 #include "config.h"
 #include "channel.h"
 #include "metrics.h"
@@ -46,10 +48,34 @@ typedef enum app_log_msg_id_e {
     APP_LOG_MSG_VL_FN_EPOLL,
     APP_LOG_MSG_VL_FN_TCP_CONN_CLIENT_IP_FAM,
     APP_LOG_MSG_VL_FN_TCP_CONN_LOCAL_IP_FAM,
-    APP_LOG_MSG_VL_FN_TCP_CONN_GETSOCKNAME,
     APP_LOG_MSG_VL_RUN_CPU_AFFINITY,
+    APP_LOG_MSG_VL_RUN_SCHED_POLICY,
+    APP_LOG_MSG_VL_SLO_P50_BREACHED,
+    APP_LOG_MSG_VL_SLO_P99_BREACHED,
+    APP_LOG_MSG_VL_SLO_P999_BREACHED,
+    APP_LOG_MSG_VL_SLO_P50_MET,
+    APP_LOG_MSG_VL_SLO_P99_MET,
+    APP_LOG_MSG_VL_SLO_P999_MET,
+    APP_LOG_MSG_VL_OVERLOAD_RAISED,
+    APP_LOG_MSG_VL_OVERLOAD_LOWERED,
+
+    /** Number of predefined message IDs. */
+    APP_LOG_MSG_COUNT,
 } app_log_msg_id_t;
 
+/** Enumerated rate limited errors, counted on log channel with
+ * @ref channel_log_error() and logged as periodic summaries.
+ * Order matters and MUST match one for @ref app_log_err_id_txt.
+ */
+typedef enum app_log_err_id_e {
+    APP_LOG_ERR_VL_FN_UDP_READ = 0,
+    APP_LOG_ERR_VL_FN_UDP_WRITE,
+    APP_LOG_ERR_VL_FN_TCP_CONN_GETSOCKNAME,
+
+    /** Number of error IDs, MUST be no more than CHANNEL_LOG_ERR_COUNT. */
+    APP_LOG_ERR_COUNT,
+} app_log_err_id_t;
+
 /** Structure holds arguments for @ref log_app_loop() function. As
  * log_app_loop function is started via a pthread it can only handle a single
  * argument hence having a structure to hold all the different arguments
@@ -59,11 +85,26 @@ typedef struct app_log_loop_args_s {
     /** Configuration with settings to use. */
     config_t *cfg;
 
-    /** Application log channels log messages are received on. */
+    /** Application log channels log messages are received on. Channels of
+     * vectorloops come first, channel index is vectorloop ID.
+     */
     channel_log_t *app_log_channels;
 
+    /** Number of entries in app_log_channels array. */
+    size_t app_log_channel_count;
+
+    /** Eventfd application log channels wake up application log thread
+     * with, see @ref channel_log_init().
+     */
+    int wake_fd;
+
     /** Metrics object to record statistics. */
     metrics_t *metrics;
+
+    /** Set to have application log thread write out messages sent and
+     * exit, wake_fd is written to wake it up.
+     */
+    atomic_bool stop;
 } app_log_loop_args_t;
 
 void * log_app_loop(void *args);
@@ -0,0 +1,102 @@
+/**
+ * @file mem.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup mem Memory Accounting
+ *
+ * @brief Memory accounting counts bytes allocated by each subsystem of a
+ *        thread, so resident memory of vectorloops can be told apart and
+ *        kept within "memory_budget".
+ *
+ *        Allocations go through tagged allocators, which add size of
+ *        allocated block, as reported by malloc_usable_size(), to counter of
+ *        their tag in memory account of calling thread, and subtract it when
+ *        block is freed. Vectorloop sets its metrics as memory account of its
+ *        thread before it allocates its buffers, so counters are exported
+ *        per vectorloop. Memory is allocated and freed by thread owning it,
+ *        so counters only owning thread writes to are updated with plain
+ *        stores. Threads with no memory account, i.e. resource and support
+ *        threads, allocate memory uncounted.
+ *  @{
+ */
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/** Enumerated subsystems memory is accounted to. */
+typedef enum mem_tag_e {
+    /** UDP listener arena, batches and queries. */
+    MEM_TAG_UDP = 0,
+
+    /** TCP connection objects, connection table and client limit table. */
+    MEM_TAG_TCP_CONNS,
+
+    /** TCP connection buffer sets, their queries and response buffers. */
+    MEM_TAG_TCP_BUFS,
+
+    /** Query log buffers. */
+    MEM_TAG_QUERY_LOG,
+
+    /** Response cache. */
+    MEM_TAG_RESPONSE_CACHE,
+
+    /** Response rate limiting table. */
+    MEM_TAG_RRL,
+
+    /** DNSSEC signature cache. */
+    MEM_TAG_DNSSEC,
+
+    /** Anything else, i.e. epoll events and deferred query slots. */
+    MEM_TAG_OTHER,
+
+    /** Number of memory tags. */
+    MEM_TAGS
+} mem_tag_t;
+
+/** Structure holds memory account of a thread, bytes allocated by each
+ * subsystem. Only thread owning account writes to it.
+ */
+typedef struct mem_account_s {
+    /** Bytes allocated, indexed by @ref mem_tag_t. */
+    atomic_ullong bytes[MEM_TAGS];
+} mem_account_t;
+
+extern const char *mem_tag_txt[MEM_TAGS];
+
+void               mem_account_set(mem_account_t *account);
+mem_account_t *    mem_account_get(void);
+void               mem_account_update(mem_tag_t tag, ssize_t bytes);
+unsigned long long mem_account_total(mem_account_t *account);
+
+void * mem_malloc(mem_tag_t tag, size_t size);
+void * mem_calloc(mem_tag_t tag, size_t count, size_t size);
+void * mem_aligned_alloc(mem_tag_t tag, size_t alignment, size_t size);
+void * mem_realloc(mem_tag_t tag, void *ptr, size_t size);
+void   mem_free(mem_tag_t tag, void *ptr);
+
+#endif /* End of MEM_H */
+
+/** @}*/
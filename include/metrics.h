@@ -24,21 +24,185 @@
  */
 /** \defgroup metrics Metrics
  * 
- * @brief Metrics is a single structure composed of atomic variables used a
- *        counters. Atomic operations on numbers is quite quick hence no
- *        need to have per thread metrics that would then need to be
- *        colleted and aggregated into one.
+ * @brief Metrics are counters application collects.
+ *
+ *        Counters updated per query are sharded, each vectorloop has its own
+ *        cache line aligned block of counters (@ref metrics_vl_t) it updates
+ *        with plain (non locked) increments. No other thread writes to the
+ *        block, so there is no contention between vectorloops. Readers sum
+ *        the blocks on demand, see @ref metrics_vl_sum.
+ *
+ *        Counters updated by support threads (application log, query log and
+ *        resource threads) are rare and are kept as shared atomic counters.
+ *
+ *        With "metrics_sketches" configured each vectorloop also sketches
+ *        question names and client networks of queries it answers, see
+ *        @ref metrics_sketch_vl_t. Metrics thread merges them periodically.
+ *
+ *        With "metrics_zones" configured each vectorloop counts queries
+ *        answered from each zone, by rcode and question type, in a row of
+ *        counters of its own, see @ref metrics_zone_counters_t.
+ *
+ *        With "metrics_query_cost" configured each vectorloop times 1 in N
+ *        queries with CPU cycle counter through parse, resolve and pack
+ *        stages, and sums their cycles by protocol, path, rcode and question
+ *        type, see @ref metrics_cost_t.
  *  @{
  */
 #ifndef METRICS_H
 #define METRICS_H
 
 #include <stdatomic.h>
+#include <stddef.h>
 
-/** Structure holds global metrics application collects.
- * Metrics are atomic variables treated as counters.
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "histogram.h"
+#include "mem.h"
+#include "rip_ns_utils.h"
+#include "sketch.h"
+#include "vectorloop_overload.h"
+#include "zone.h"
+
+/** Macro to add to a counter only one thread writes to, such as a vectorloop
+ * metrics counter. Compiles to a plain load and store (no locked instruction),
+ * while readers on other threads still see a consistent value.
  */
-typedef struct metrics_s {
+#define METRICS_ADD(a, n) atomic_store_explicit(&(a), \
+    atomic_load_explicit(&(a), memory_order_relaxed) + (n), memory_order_relaxed)
+
+/** Macro to increment by one a counter only one thread writes to. */
+#define METRICS_INC(a) METRICS_ADD(a, 1)
+
+/** Enumerated query processing stages latency is tracked for. Each stage
+ * spans time from query entering one vectorloop step to entering next one.
+ */
+typedef enum metrics_latency_stage_e {
+    /** From query read from socket to query parse. */
+    METRICS_LATENCY_RECV_PARSE = 0,
+
+    /** From query parse to query resolve. */
+    METRICS_LATENCY_PARSE_RESOLVE,
+
+    /** From query resolve to response pack. */
+    METRICS_LATENCY_RESOLVE_PACK,
+
+    /** From response pack to response written to socket. */
+    METRICS_LATENCY_PACK_SEND,
+
+    /** Number of stages. */
+    METRICS_LATENCY_STAGES
+} metrics_latency_stage_t;
+
+/** Number of protocols latency is tracked for, 0 is UDP and 1 is TCP. */
+#define METRICS_LATENCY_PROTOCOLS 2
+
+/** Number of rcodes end to end latency is tracked for. Rcodes NOERROR (0) to
+ * REFUSED (5) each have their own histogram, other rcodes share last one.
+ */
+#define METRICS_LATENCY_RCODES 7
+
+/** Enumerated vectorloop stages, one for each step of vectorloop iteration
+ * (vl_fn_* function). Stages are timed when "loop_stage_metrics" is
+ * configured.
+ */
+typedef enum metrics_vl_stage_e {
+    /** Read resources published by resource thread. */
+    METRICS_VL_STAGE_RESOURCES = 0,
+
+    /** Check epoll for events, items are events. Blocking wait of an idle
+     * vectorloop is counted in @ref METRICS_VL_STAGE_IDLE instead.
+     */
+    METRICS_VL_STAGE_EPOLL,
+
+    /** Read UDP sockets, items are datagrams read. */
+    METRICS_VL_STAGE_UDP_READ,
+
+    /** Accept TCP connections, items are connections accepted. */
+    METRICS_VL_STAGE_TCP_ACCEPT,
+
+    /** Collect DoT connections, items are handshakes collected. */
+    METRICS_VL_STAGE_DOT_HANDSHAKES,
+
+    /** Publish load and adopt TCP connections handed off from other
+     * vectorloops, items are connections adopted.
+     */
+    METRICS_VL_STAGE_TCP_HANDOFF,
+
+    /** Collect jobs worker threads are done with and resume deferred
+     * queries, items are jobs collected.
+     */
+    METRICS_VL_STAGE_QUERY_RESUME,
+
+    /** Read TCP connections, items are connections read. */
+    METRICS_VL_STAGE_TCP_READ,
+
+    /** Parse queries, items are queries parsed. */
+    METRICS_VL_STAGE_QUERY_PARSE,
+
+    /** Resolve queries, items are queries resolved. */
+    METRICS_VL_STAGE_QUERY_RESOLVE,
+
+    /** Pack responses, items are responses packed. */
+    METRICS_VL_STAGE_RESPONSE_PACK,
+
+    /** Write responses (UDP and TCP, or io_uring), items are responses sent. */
+    METRICS_VL_STAGE_WRITE,
+
+    /** Log queries, items are query log bytes written. */
+    METRICS_VL_STAGE_QUERY_LOG,
+
+    /** Check TCP connection timers. */
+    METRICS_VL_STAGE_TCP_TIMEOUTS,
+
+    /** Release TCP connections. */
+    METRICS_VL_STAGE_TCP_RELEASE,
+
+    /** Idle backoff of an iteration that processed nothing and blocking
+     * epoll wait that follows it.
+     */
+    METRICS_VL_STAGE_IDLE,
+
+    /** Number of stages. */
+    METRICS_VL_STAGES
+} metrics_vl_stage_t;
+
+/** Enumerated vectorloop pipeline queues, depth and dwell time of each are
+ * tracked when "loop_stage_metrics" is configured.
+ */
+typedef enum metrics_vl_queue_e {
+    /** Connections with data to parse into queries. */
+    METRICS_VL_QUEUE_QUERY_PARSE = 0,
+
+    /** Connections with queries to resolve. */
+    METRICS_VL_QUEUE_QUERY_RESOLVE,
+
+    /** Connections with responses to pack. */
+    METRICS_VL_QUEUE_RESPONSE_PACK,
+
+    /** Connections with queries to log. */
+    METRICS_VL_QUEUE_QUERY_LOG,
+
+    /** TCP connections to read. */
+    METRICS_VL_QUEUE_TCP_READ,
+
+    /** TCP connections with responses to write. */
+    METRICS_VL_QUEUE_TCP_WRITE,
+
+    /** TCP connections to release. */
+    METRICS_VL_QUEUE_TCP_RELEASE,
+
+    /** Number of queues. */
+    METRICS_VL_QUEUES
+} metrics_vl_queue_t;
+
+/** Structure holds metrics a vectorloop collects. 
+ * All members MUST be made of atomic_ullong counters only, @ref metrics_vl_sum
+ * sums structures as arrays of counters. New members go at end of structure,
+ * see @ref METRICS_SNAPSHOT_VERSION.
+ */
+typedef struct metrics_vl_s {
 
     /** Structure holds TCP related metrics. */
     struct {
@@ -73,6 +237,11 @@ typedef struct metrics_s {
         /** Number of times we received a query with datagram size larger than 512. */
         atomic_ullong query_len_toolarge;
 
+        /** Number of TCP connections closed once accepted, as client network
+         * already held tcp_conns_per_client_max connections.
+         */
+        atomic_ullong client_conns_max;
+
         /** Number of queries that were partially received and then timed
          * out receiving the full query.
          * Any deviation from steady state could be an indication of DOS.
@@ -117,14 +286,117 @@ typedef struct metrics_s {
          * was closed for write.
          */
         atomic_ullong sock_closed_for_write;
+
+        /** Number of idle connections closed to make room for a new
+         * connection, as vectorloop held tcp_conns_per_vl_max connections.
+         */
+        atomic_ullong idle_evicted;
+
+        /** Number of connections handed off to another vectorloop. */
+        atomic_ullong handoffs_out;
+
+        /** Number of connections handed off from another vectorloop. */
+        atomic_ullong handoffs_in;
+
+        /** Queries each connection received over its lifetime. */
+        histogram_t conn_queries;
+
+        /** Lifetime of each connection, from accept to close, in
+         * nanoseconds.
+         */
+        histogram_t conn_duration;
+
+        /** Bytes read from each connection over its lifetime. */
+        histogram_t conn_bytes_read;
+
+        /** Bytes written to each connection over its lifetime. */
+        histogram_t conn_bytes_written;
     } tcp;
 
     /** Structure holds UDP IPv4 related metrics. */
     struct {
         /** Number of queries received */
         atomic_ullong queries;
+
+        /** Number of messages (packet descriptors) sent via sendmmsg() or
+         * io_uring, a UDP GSO message counts once.
+         */
+        atomic_ullong send_msgs;
+
+        /** Number of responses sent as segment of a UDP GSO message. */
+        atomic_ullong responses_gso;
+
+        /** Number of times UDP write would block while listener had no
+         * free batch left to receive into, listener stops receiving until
+         * responses are sent.
+         */
+        atomic_ullong batches_full;
+
+        /** Number of datagrams kernel dropped because listener receive
+         * buffer was full, per listener IP version (0=IPv4, 1=IPv6), as
+         * reported by SO_RXQ_OVFL.
+         */
+        atomic_ullong rxq_drops[2];
+
+        /** Number of times listener receive buffer size was raised after
+         * drops, see "udp_socket_recvbuff_autotune_max".
+         */
+        atomic_ullong recvbuff_raises;
+
+        /** Number of received datagrams mirrored to shadow server, see
+         * "udp_mirror_ip".
+         */
+        atomic_ullong mirrored;
+
+        /** Number of datagrams not mirrored because mirroring socket could
+         * not take them right away.
+         */
+        atomic_ullong mirror_dropped;
+
+        /** Datagrams each recvmmsg() (or AF_XDP, replay) read returned. */
+        histogram_t recv_batch;
     } udp;
 
+    /** Structure holds DNS over TLS related metrics. */
+    struct {
+        /** Number of TLS handshakes done, connection switched to kernel TLS. */
+        atomic_ullong handshakes;
+
+        /** Number of DoT connections closed because TLS handshake failed,
+         * timed out or kernel TLS could not be installed.
+         */
+        atomic_ullong handshake_errors;
+
+        /** Number of DoT connections closed because all handshake threads
+         * were busy.
+         */
+        atomic_ullong handshake_busy;
+    } dot;
+
+    /** Structure holds DNSSEC online signing related metrics. */
+    struct {
+        /** Number of RRsets signed by signer threads. */
+        atomic_ullong signatures;
+
+        /** Number of RRsets signer threads failed to sign, or that could not
+         * be signed (not in signer zone, or too large).
+         */
+        atomic_ullong sign_errors;
+
+        /** Number of RRSIG records found in signature cache. */
+        atomic_ullong sig_cache_hits;
+
+        /** Number of RRSIG records not found in signature cache, queued to
+         * be signed.
+         */
+        atomic_ullong sig_cache_misses;
+
+        /** Number of responses sent with unsigned answers because worker
+         * threads, pending queries table or signature cache were full.
+         */
+        atomic_ullong responses_unsigned;
+    } dnssec;
+
     /** Structure holds DNS related metrics. */
     struct {
         /** Number of queries received. */
@@ -159,57 +431,126 @@ typedef struct metrics_s {
          */
         atomic_ullong queries_rcode_badversion;
 
-        /** Number of query request received with question type being invalid. */
-        atomic_ullong queries_type_invalid;
+        /** Number of query request received per question type, indexed by
+         * query type dispatch table index, see @ref rip_ns_qtype_idx_t.
+         */
+        atomic_ullong queries_type[RIP_NS_QTYPE_IDX_COUNT];
 
-        /** Number of query request received with question of type A. */
-        atomic_ullong queries_type_A;
+        atomic_ullong queries_edns_present;
+        
+        atomic_ullong queries_edns_valid;
 
-        /** Number of query request received with question of type AAAA. */
-        atomic_ullong queries_type_AAAA;
+        atomic_ullong queries_edns_dobit;
 
-        /** Number of query request received with question of type CNAME. */
-        atomic_ullong queries_type_CNAME;
+        atomic_ullong queries_clientsubnet;
 
-        /** Number of query request received with question of type MX. */
-        atomic_ullong queries_type_MX;
+        /** Number of queries with EDNS cookie option. */
+        atomic_ullong queries_cookie;
 
-        /** Number of query request received with question of type NS. */
-        atomic_ullong queries_type_NS;
+        /** Number of queries with valid server cookie. */
+        atomic_ullong queries_cookie_valid;
 
-        /** Number of query request received with question of type PTR. */
-        atomic_ullong queries_type_PTR;
+        /** Number of queries answered from response cache. */
+        atomic_ullong response_cache_hits;
 
-        /** Number of query request received with question of type SRV. */
-        atomic_ullong queries_type_SRV;
+        /** Number of cacheable queries not found in response cache. */
+        atomic_ullong response_cache_misses;
 
-        /** Number of query request received with question of type SOA. */
-        atomic_ullong queries_type_SOA;
+        /** Number of queries that missed response cache, but were answered
+         * with response packed for same query earlier in same batch.
+         */
+        atomic_ullong response_cache_coalesced;
 
-        /** Number of query request received with question of type TXT. */
-        atomic_ullong queries_type_TXT;
+        /** Number of queries that missed response cache of vectorloop, but
+         * were answered from shared response cache.
+         */
+        atomic_ullong response_cache_shared_hits;
 
-        /** Number of query request received with question of unsupported type. */
-        atomic_ullong queries_type_unsupported;
+        /** Number of UDP responses dropped by response rate limiting. */
+        atomic_ullong rrl_dropped;
 
-        atomic_ullong queries_edns_present;
-        
-        atomic_ullong queries_edns_valid;
+        /** Number of UDP responses replaced by a truncated response by
+         * response rate limiting.
+         */
+        atomic_ullong rrl_slipped;
 
-        atomic_ullong queries_edns_dobit;
+        /** Number of times queries were deferred, waiting for worker
+         * threads.
+         */
+        atomic_ullong queries_deferred;
 
-        atomic_ullong queries_clientsubnet;
+        /** Number of queries answered with REFUSED by client ACL. */
+        atomic_ullong acl_refused;
+
+        /** Number of queries, and TCP connections, dropped by client ACL. */
+        atomic_ullong acl_dropped;
+
+        /** Number of queries answered with NXDOMAIN by response policy. */
+        atomic_ullong policy_nxdomain;
+
+        /** Number of queries answered with NODATA by response policy. */
+        atomic_ullong policy_nodata;
+
+        /** Number of queries answered with REFUSED by response policy. */
+        atomic_ullong policy_refused;
+
+        /** Number of queries dropped by response policy. */
+        atomic_ullong policy_dropped;
+
+        /** Number of queries resolved because their name matched a passthru
+         * response policy entry.
+         */
+        atomic_ullong policy_passthru;
+
+        /** Number of GeoIP lookups answered from vectorloop result cache. */
+        atomic_ullong geoip_cache_hits;
+
+        /** Number of GeoIP lookups done in GeoIP database. */
+        atomic_ullong geoip_cache_misses;
+
+        /** Number of queries answered from a load balancing candidate set,
+         * with record picked among healthy candidates, see @ref lb.
+         */
+        atomic_ullong lb_answers;
+
+        /** Number of load balancing answers picked among all candidates, as
+         * no endpoint of candidate set was healthy.
+         */
+        atomic_ullong lb_all_down;
+
+        /** Number of responses added to in-kernel responder map of XDP
+         * program, see @ref vlxdp.
+         */
+        atomic_ullong xdp_responder_puts;
 
     } dns;
 
-    /** Structure holds application related metrics.  */
+    /** Structure holds overload shedding metrics, see @ref vloverload. */
     struct {
-        /** Number of times opening application lgo file resulted in error. */
-        atomic_ullong app_log_open_error;
+        /** Number of overload periods vectorloop spent at each overload
+         * level, indexed by @ref vl_overload_level_t.
+         */
+        atomic_ullong periods[VL_OVERLOAD_LEVELS];
 
-        /** Number of times writing to application lgo file resulted in error. */
-        atomic_ullong app_log_write_error;
+        /** Number of queries not logged under overload. */
+        atomic_ullong log_skipped;
 
+        /** Number of UDP queries of junk types dropped under overload. */
+        atomic_ullong qtype_dropped;
+
+        /** Number of UDP queries of clients not allowlisted dropped under
+         * overload.
+         */
+        atomic_ullong client_dropped;
+
+        /** Number of UDP queries of clients not allowlisted answered with
+         * truncated response under overload.
+         */
+        atomic_ullong client_slipped;
+    } overload;
+
+    /** Structure holds application related metrics. */
+    struct {
         /** Number of times writing to query log buffer resulted in not having
          * enough space to log the query. It is OK to have this happen under
          * extrem load such as an intense DOS attack. 
@@ -218,6 +559,399 @@ typedef struct metrics_s {
          */
         atomic_ullong query_log_buf_no_space;
 
+        /** Number of times vectorloop filled up its active query log chunk
+         * and could not publish it because all other chunks were waiting to be
+         * written to disk (backpressure). Query is then not logged, and is
+         * counted in query_log_buf_no_space as well.
+         */
+        atomic_ullong query_log_ring_full;
+
+        /** Number of queries not logged because of query log filters or
+         * sampling.
+         */
+        atomic_ullong query_log_filtered;
+
+        /** Number of queries logged to spill buffer as query log ring was
+         * full, see configuration setting query_log_full_policy.
+         */
+        atomic_ullong query_log_spilled;
+
+        /** Number of spilled queries dropped as they were not moved to query
+         * log ring within query_log_age_max.
+         */
+        atomic_ullong query_log_aged;
+
+        /** Number of queries not logged because of sampling while query log
+         * ring was full.
+         */
+        atomic_ullong query_log_sampled_out;
+    } app;
+
+    /** Structure holds query latency histograms, values are in nanoseconds.
+     * Only queries a response was sent for are tracked.
+     */
+    struct {
+        /** End to end latency, from query read from socket to response
+         * written to socket, by protocol and rcode.
+         */
+        histogram_t total[METRICS_LATENCY_PROTOCOLS][METRICS_LATENCY_RCODES];
+
+        /** Latency of each query processing stage, by stage and protocol. */
+        histogram_t stage[METRICS_LATENCY_STAGES][METRICS_LATENCY_PROTOCOLS];
+    } latency;
+
+    /** Structure holds vectorloop stage metrics, collected only when
+     * "loop_stage_metrics" is configured. Values are in CPU cycles, see
+     * @ref utl_cycles.
+     */
+    struct {
+        /** Number of iterations that processed something. */
+        atomic_ullong iterations_busy;
+
+        /** Number of iterations that processed nothing. */
+        atomic_ullong iterations_idle;
+
+        /** Cycles spent processing. */
+        atomic_ullong cycles_busy;
+
+        /** Cycles spent idle, spinning or blocked in epoll_wait(). */
+        atomic_ullong cycles_idle;
+
+        /** Cycles of iterations that processed something, idle time
+         * excluded.
+         */
+        histogram_t iteration;
+
+        /** Cycles of each stage, recorded every iteration. */
+        histogram_t cycles[METRICS_VL_STAGES];
+
+        /** Items each stage processed, recorded when stage processed
+         * any.
+         */
+        histogram_t items[METRICS_VL_STAGES];
+
+        /** High-water mark of each queue length in an iteration, sampled at
+         * stage ends and recorded when queue held any entries.
+         */
+        histogram_t queue_depth[METRICS_VL_QUEUES];
+
+        /** Mean cycles entries spent in each queue in an iteration, queue
+         * occupancy over entries queued (Little's law), recorded when
+         * entries were queued.
+         */
+        histogram_t queue_dwell[METRICS_VL_QUEUES];
+    } loop;
+
+    /** Bytes of memory vectorloop allocated by subsystem, vectorloop sets it
+     * as memory account of its thread, see @ref mem. Values are gauges.
+     */
+    mem_account_t mem;
+
+} metrics_vl_t;
+
+/** Number of counters in @ref metrics_vl_t. */
+#define METRICS_VL_COUNTERS (sizeof(metrics_vl_t) / sizeof(atomic_ullong))
+
+/** Structure holds one vectorloop metrics in its own cache line(s), so
+ * vectorloops do not share cache lines among each other.
+ */
+typedef struct metrics_vl_shard_s {
+    /** Vectorloop metrics. */
+    _Alignas(CACHE_LINE_SIZE) metrics_vl_t vl;
+} metrics_vl_shard_t;
+
+/** Enumerated query end codes counted per batch, see
+ * @ref metrics_query_batch_t.
+ */
+typedef enum metrics_rcode_idx_e {
+    METRICS_RCODE_NOERROR = 0,
+    METRICS_RCODE_FORMERR,
+    METRICS_RCODE_SERVFAIL,
+    METRICS_RCODE_NXDOMAIN,
+    METRICS_RCODE_NOTIMPL,
+    METRICS_RCODE_REFUSED,
+    METRICS_RCODE_BADVERSION,
+    METRICS_RCODE_SHORTHEADER,
+    METRICS_RCODE_TOOLARGE,
+    METRICS_RCODE_OTHER,
+    METRICS_RCODE_COUNT
+} metrics_rcode_idx_t;
+
+/** Structure accumulates query counters of one batch of queries, a UDP
+ * read vector or a TCP connection batch, in plain integers on the stack of
+ * vectorloop. It is published to vectorloop metrics with a handful of
+ * stores once per batch, see @ref query_report_metrics_flush.
+ */
+typedef struct metrics_query_batch_s {
+    /** Number of queries, indexed by protocol, 0 UDP and 1 TCP. */
+    uint64_t queries[2];
+
+    /** Number of queries per end code, see @ref metrics_rcode_idx_t. */
+    uint64_t rcode[METRICS_RCODE_COUNT];
+
+    /** Number of queries per question type dispatch table index. */
+    uint64_t type[RIP_NS_QTYPE_IDX_COUNT];
+
+    /** Number of queries with EDNS OPT RR present. */
+    uint64_t edns_present;
+
+    /** Number of queries with valid EDNS OPT RR. */
+    uint64_t edns_valid;
+
+    /** Number of queries with EDNS DO bit set. */
+    uint64_t edns_dobit;
+
+    /** Number of queries with valid EDNS client subnet option. */
+    uint64_t clientsubnet;
+
+    /** Number of queries with valid EDNS cookie option. */
+    uint64_t cookie;
+
+    /** Number of queries with valid server cookie. */
+    uint64_t cookie_valid;
+} metrics_query_batch_t;
+
+/** Structure holds metrics of a UDP listener address one vectorloop
+ * counts, see "udp_listener_addresses".
+ */
+typedef struct metrics_udp_addr_s {
+    /** Number of datagrams received on address. */
+    atomic_ullong datagrams;
+
+    /** Number of datagrams kernel dropped because receive buffer of address
+     * listener was full, as reported by SO_RXQ_OVFL.
+     */
+    atomic_ullong rxq_drops;
+} metrics_udp_addr_t;
+
+/** Structure holds per zone query counters of one vectorloop, a counter
+ * for each response end code and question type pair, so a query is a single
+ * increment.
+ */
+typedef struct metrics_zone_counters_s {
+    /** Number of queries, indexed by @ref metrics_rcode_idx_t and question
+     * type dispatch table index.
+     */
+    atomic_ullong queries[METRICS_RCODE_COUNT][RIP_NS_QTYPE_IDX_COUNT];
+} metrics_zone_counters_t;
+
+/** Path sampled query took, cost of queries is summed per path. A query that
+ * fits several is counted in first of truncated, cached and ecs.
+ */
+typedef enum metrics_cost_path_e {
+    /** Resolved from zone and packed, without EDNS client subnet. */
+    METRICS_COST_PLAIN = 0,
+
+    /** Response copied from response cache, resolve and pack skipped. */
+    METRICS_COST_CACHED,
+
+    /** Query with valid EDNS client subnet option. */
+    METRICS_COST_ECS,
+
+    /** Response truncated, as it did not fit or query was shed. */
+    METRICS_COST_TRUNCATED,
+
+    METRICS_COST_PATHS
+} metrics_cost_path_t;
+
+/** Structure holds sampled query cost of one vectorloop, number of sampled
+ * queries and CPU cycles they took in parse, resolve and pack stages, indexed
+ * by protocol (0 UDP, 1 TCP), @ref metrics_cost_path_t,
+ * @ref metrics_rcode_idx_t and question type dispatch table index. Cycles
+ * over queries of a cell is mean cost of such query.
+ */
+typedef struct metrics_cost_s {
+    /** Number of sampled queries. */
+    atomic_ullong queries[2][METRICS_COST_PATHS][METRICS_RCODE_COUNT][RIP_NS_QTYPE_IDX_COUNT];
+
+    /** CPU cycles sampled queries took. */
+    atomic_ullong cycles[2][METRICS_COST_PATHS][METRICS_RCODE_COUNT][RIP_NS_QTYPE_IDX_COUNT];
+} metrics_cost_t;
+
+/** Structure describes a per zone metrics slot, zone of main zone database
+ * or of a view. Slot is claimed by setting its key, then names are written
+ * and it is marked ready. Zone keeps its slot across zone database
+ * generations, and across worker processes.
+ */
+typedef struct metrics_zone_s {
+    /** Hash of view label and zone name, 0 if slot is free. */
+    atomic_ullong key;
+
+    /** Set once view label and zone name are written. */
+    atomic_bool ready;
+
+    /** Length of zone name. */
+    uint16_t name_len;
+
+    /** View label, length prefixed, 0 length for main zone database. */
+    unsigned char view[RIP_NS_MAXLABEL + 2];
+
+    /** Zone apex name, in wire format. */
+    unsigned char name[RIP_NS_MAXCDNAME];
+} metrics_zone_t;
+
+/** Structure holds sketches of queries one vectorloop answered in one
+ * window of @ref METRICS_SKETCH_INTERVAL seconds.
+ */
+typedef struct metrics_sketch_window_s {
+    /** Top question names, key is name hash, data is wire format name. */
+    sketch_topk_t qnames;
+
+    /** Top client networks, key is @ref METRICS_SKETCH_CLIENT_V4 or
+     * @ref METRICS_SKETCH_CLIENT_V6 in top byte and /24 or /56 prefix in
+     * rest.
+     */
+    sketch_topk_t clients;
+
+    /** Distinct client addresses. */
+    sketch_hll_t clients_hll;
+
+    /** Number of queries sketched. */
+    uint64_t queries;
+} metrics_sketch_window_t;
+
+/** Client network key tag of IPv4 /24 networks. */
+#define METRICS_SKETCH_CLIENT_V4 4ULL
+
+/** Client network key tag of IPv6 /56 networks. */
+#define METRICS_SKETCH_CLIENT_V6 6ULL
+
+/** Structure holds sketches of one vectorloop. Vectorloop sketches queries
+ * into current window while metrics thread reads the other one. Metrics
+ * thread moves vectorloop to the other window by incrementing epoch, and
+ * vectorloop acknowledges once per loop iteration, see
+ * @ref metrics_sketch_vl_sync. Window vectorloop left is read only once it
+ * acknowledged, so no sketch is ever read while it is written. See
+ * @ref metrics_sketch_flip and @ref metrics_sketch_merge.
+ */
+typedef struct metrics_sketch_vl_s {
+    /** Window epoch, written by metrics thread. Vectorloop sketches into
+     * windows[epoch % 2].
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_uint epoch;
+
+    /** Last epoch window vectorloop left was collected for, private to
+     * metrics thread.
+     */
+    unsigned int collected;
+
+    /** Last epoch vectorloop moved to, written by vectorloop. */
+    _Alignas(CACHE_LINE_SIZE) atomic_uint acked;
+
+    /** Last epoch vectorloop read, private to vectorloop. */
+    unsigned int seen;
+
+    /** Window vectorloop sketches into, private to vectorloop. */
+    metrics_sketch_window_t *current;
+
+    /** Two windows vectorloop alternates between. */
+    metrics_sketch_window_t windows[2];
+} metrics_sketch_vl_t;
+
+/** Structure holds sketches of all vectorloops, and their merge. Only
+ * metrics thread uses it besides vectorloops.
+ */
+typedef struct metrics_sketch_s {
+    /** Array of per vectorloop sketches, one for each vectorloop. */
+    metrics_sketch_vl_t *vls;
+
+    /** Last complete window of each vectorloop. */
+    metrics_sketch_window_t *last;
+
+    /** Merge of last complete windows of all vectorloops. */
+    metrics_sketch_window_t merged;
+} metrics_sketch_t;
+
+/** Structure holds global metrics application collects.
+ * Metrics are atomic variables treated as counters.
+ */
+typedef struct metrics_s {
+
+    /** Array of per vectorloop metrics, one for each vectorloop. */
+    metrics_vl_shard_t *vl_shards;
+
+    /** Number of elements in vl_shards array. */
+    size_t vl_shards_count;
+
+    /** Query sketches, NULL if "metrics_sketches" is not configured. */
+    metrics_sketch_t *sketch;
+
+    /** Per UDP listener address metrics, udp_addrs_count of them for each
+     * vectorloop, NULL if "udp_listener_addresses" is not configured.
+     */
+    metrics_udp_addr_t *udp_addrs;
+
+    /** Number of UDP listener addresses of each vectorloop in udp_addrs. */
+    size_t udp_addrs_count;
+
+    /** UDP listener addresses, udp_addrs_count of them, exported metrics are
+     * labeled with.
+     */
+    utl_net_t *udp_addr_nets;
+
+    /** Per zone metrics slots, METRICS_ZONES_MAX of them, NULL if
+     * "metrics_zones" is not configured.
+     */
+    metrics_zone_t *zones;
+
+    /** Per zone query counters, (METRICS_ZONES_MAX + 1) rows for each
+     * vectorloop, last row of each counts zones past METRICS_ZONES_MAX.
+     */
+    metrics_zone_counters_t *zone_counters;
+
+    /** Sampled query cost, one for each vectorloop, NULL if
+     * "metrics_query_cost" is not configured.
+     */
+    metrics_cost_t *cost;
+
+    /** Frequency of CPU cycle counter sampled queries are timed with, set
+     * with cost.
+     */
+    uint64_t cost_cycles_per_sec;
+
+    /** Frequency of CPU cycle counter vectorloop stages are timed with, 0 if
+     * "loop_stage_metrics" is not configured.
+     */
+    atomic_ullong cycles_per_sec;
+
+    /** Structure holds memory metrics, values are gauges. */
+    struct {
+        /** Bytes of memory zone database vectorloops use holds, set by
+         * resource thread when zone database is published.
+         */
+        atomic_ullong zone_bytes;
+
+        /** Memory budget in bytes, 0 if none, see "memory_budget". */
+        atomic_ullong budget;
+    } mem;
+
+    /** Structure holds load balancing metrics, values are gauges set by
+     * health checker thread after each round of probes, see @ref lb.
+     */
+    struct {
+        /** Number of probed endpoints that are healthy. */
+        atomic_ullong endpoints_up;
+
+        /** Number of probed endpoints that are down. */
+        atomic_ullong endpoints_down;
+    } lb;
+
+    /** Number of queries in-kernel responder of XDP program answered, read
+     * from its per CPU counter by metrics thread before each export, see
+     * @ref vlxdp.
+     */
+    atomic_ullong xdp_responder_answers;
+
+    /** Structure holds application related metrics.  */
+    struct {
+        /** Number of times opening application lgo file resulted in error. */
+        atomic_ullong app_log_open_error;
+
+        /** Number of application log messages not written to application log
+         * file, due to write error or application log channel being full.
+         */
+        atomic_ullong app_log_write_error;
+
         /**  Number of times checking (and if changed reloading) a resource
          * failed. Increase in this counter indicate that something happened to
          * the resource and we might be serving stale responses.
@@ -226,10 +960,119 @@ typedef struct metrics_s {
 
         /* Number of times opening query log file failed.*/
         atomic_ullong query_log_open_error;
+
+        /** Number of times a worker process exited unexpectedly and was
+         * restarted by master process, see "process_workers".
+         */
+        atomic_ullong worker_exit;
     } app;
 
 } metrics_t;
 
+/** Magic number at start of binary metrics snapshot, "RPMS" in ASCII. */
+#define METRICS_SNAPSHOT_MAGIC 0x524d5053
+
+/** Version of binary metrics snapshot layout. Snapshot copies app and
+ * @ref metrics_vl_t counters in structure order, so readers locate counters
+ * by offset. New counters are added only at end of their structure, and any
+ * other change of either structure (adding a counter in the middle, or
+ * removing, reordering or resizing one) must increment this version.
+ */
+#define METRICS_SNAPSHOT_VERSION 18
+
+/** Number of counters in @ref metrics_t app structure. */
+#define METRICS_APP_COUNTERS 5
+
+/** Structure describes header of binary metrics snapshot. Header is followed
+ * by counter_count 64 bit counters: the sum of all vectorloop metrics in
+ * @ref metrics_vl_t member order (histograms included), then counters of
+ * @ref metrics_t app structure in member order. All values are in host byte
+ * order.
+ */
+typedef struct metrics_snapshot_header_s {
+    /** Set to @ref METRICS_SNAPSHOT_MAGIC. */
+    uint32_t magic;
+
+    /** Set to @ref METRICS_SNAPSHOT_VERSION. */
+    uint16_t version;
+
+    /** Size of this header in bytes. */
+    uint16_t header_len;
+
+    /** Time snapshot was taken, nanoseconds since epoch. */
+    uint64_t timestamp_ns;
+
+    /** Number of vectorloops counters were summed over. */
+    uint32_t vl_count;
+
+    /** Number of counters following header. */
+    uint32_t counter_count;
+} metrics_snapshot_header_t;
+
+/** Structure holds arguments passed to @ref metrics_loop function. */
+typedef struct metrics_loop_args_s {
+    /** Configuration settings to use. */
+    config_t *cfg;
+
+    /** Metrics object to export. */
+    metrics_t *metrics;
+
+    /** Application log channel. */
+    channel_log_t *app_log_channel;
+
+    /** XDP program whose in-kernel responder answers are exported, NULL if
+     * AF_XDP is not used.
+     */
+    struct vl_xdp_prog_s *xdp_prog;
+} metrics_loop_args_t;
+
+void           metrics_init(metrics_t *metrics, size_t vl_count);
+metrics_t *    metrics_new_shared(size_t vl_count);
+void           metrics_clean(metrics_t *metrics);
+metrics_vl_t * metrics_vl_get(metrics_t *metrics, size_t vl_id);
+void           metrics_vl_sum(metrics_t *metrics, metrics_vl_t *sum);
+
+void                 metrics_udp_addrs_init(metrics_t *metrics, const utl_net_t *addrs,
+                                            size_t count);
+metrics_udp_addr_t * metrics_udp_addrs_get(metrics_t *metrics, size_t vl_id);
+
+void                      metrics_zones_init(metrics_t *metrics);
+metrics_zone_counters_t * metrics_zones_vl_get(metrics_t *metrics, size_t vl_id);
+void                      metrics_zones_register(metrics_t *metrics,
+                                                 const unsigned char *view,
+                                                 zone_db_t *db);
+
+void             metrics_cost_init(metrics_t *metrics);
+metrics_cost_t * metrics_cost_vl_get(metrics_t *metrics, size_t vl_id);
+
+void                  metrics_sketch_init(metrics_t *metrics);
+metrics_sketch_vl_t * metrics_sketch_vl_get(metrics_t *metrics, size_t vl_id);
+void                  metrics_sketch_flip(metrics_t *metrics);
+size_t                metrics_sketch_merge(metrics_t *metrics);
+
+/** Move vectorloop to window metrics thread switched it to, if any, and
+ * acknowledge it. Called by vectorloop once per loop iteration, before
+ * queries are sketched.
+ *
+ * @param s Vectorloop sketches.
+ */
+static inline void
+metrics_sketch_vl_sync(metrics_sketch_vl_t *s)
+{
+    unsigned int epoch = atomic_load_explicit(&s->epoch, memory_order_acquire);
+
+    if (epoch != s->seen) {
+        s->seen    = epoch;
+        s->current = &s->windows[epoch & 1];
+        atomic_store_explicit(&s->acked, epoch, memory_order_release);
+    }
+}
+
+size_t metrics_export_prometheus(metrics_t *metrics, char **buf);
+size_t metrics_export_snapshot(metrics_t *metrics, char **buf);
+
+void * metrics_loop(void *args);
+
 #endif /* End of METRICS_H */
 
-/** @}*/
\ No newline at end of file
+/** @}*/
@@ -0,0 +1,171 @@
+/**
+ * @file mphf.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup mphf Minimal Perfect Hash
+ *
+ * @brief Minimal perfect hash function maps each key of a static set of n
+ *        64 bit keys to a distinct slot in [0, n), PTHash style (Pibiri and
+ *        Trani, "PTHash: Revisiting FCH Minimal Perfect Hashing").
+ *
+ *        Keys are split into buckets, 60% of keys into 30% of buckets so
+ *        that large buckets are placed first, while table is still empty.
+ *        Each bucket has a 16 bit pilot, chosen at build time so that
+ *        position hash of each bucket key mixed with pilot lands on a free
+ *        slot of a table slightly larger than n. Keys that land past n are
+ *        remapped to free slots below n by a small array. Pilot per
+ *        @ref MPHF_BUCKET_KEYS keys and remap entries take about 4 bits per
+ *        key, and lookup is a pilot read and, for a few percent of keys, a
+ *        remap entry read.
+ *
+ *        Key not in set maps to an arbitrary slot, so caller must verify
+ *        slot holds key. Pilot and remap arrays are provided by caller, so
+ *        they can point into a memory mapped file.
+ *  @{
+ */
+#ifndef MPHF_H
+#define MPHF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Average number of keys per bucket. */
+#define MPHF_BUCKET_KEYS 5
+
+/** Maximum number of seeds build tries before giving up. */
+#define MPHF_SEEDS_MAX 16
+
+/** Keys whose mixed low 32 bits are below this threshold, 60% of them, go to
+ * dense buckets.
+ */
+#define MPHF_DENSE_KEYS_THRESHOLD 2576980377U
+
+/** Structure describes a minimal perfect hash function. */
+typedef struct mphf_s {
+    /** Seed keys are mixed with. */
+    uint64_t seed;
+
+    /** Number of keys, slots keys map to are [0, keys_count). */
+    uint32_t keys_count;
+
+    /** Number of slots position hash maps to, slots past keys_count are
+     * remapped.
+     */
+    uint32_t slots_count;
+
+    /** Number of buckets. */
+    uint32_t buckets_count;
+
+    /** Number of dense buckets, first buckets 60% of keys go to. */
+    uint32_t dense_count;
+
+    /** Pilot of each bucket, buckets_count entries. */
+    const uint16_t *pilots;
+
+    /** Slot below keys_count each slot past it is remapped to,
+     * (slots_count - keys_count) entries.
+     */
+    const uint32_t *remap;
+} mphf_t;
+
+/** Mix key with seed (murmur3 64 bit finalizer).
+ *
+ * @param key  Key to mix.
+ * @param seed Seed.
+ *
+ * @return     Returns mixed key.
+ */
+static inline uint64_t
+mphf_mix(uint64_t key, uint64_t seed)
+{
+    uint64_t h = key + seed;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/** Get bucket of mixed key.
+ *
+ * @param f Minimal perfect hash function.
+ * @param h Mixed key.
+ *
+ * @return  Returns bucket index.
+ */
+static inline uint32_t
+mphf_bucket(const mphf_t *f, uint64_t h)
+{
+    uint32_t r = (uint32_t)(h >> 32);
+
+    if ((uint32_t)h < MPHF_DENSE_KEYS_THRESHOLD) {
+        return (uint32_t)(((uint64_t)r * f->dense_count) >> 32);
+    }
+    return f->dense_count +
+           (uint32_t)(((uint64_t)r * (f->buckets_count - f->dense_count)) >> 32);
+}
+
+/** Get slot mixed key lands on with a pilot, before remapping.
+ *
+ * @param f     Minimal perfect hash function.
+ * @param h     Mixed key.
+ * @param pilot Pilot of key bucket.
+ *
+ * @return      Returns slot in [0, slots_count).
+ */
+static inline uint32_t
+mphf_position(const mphf_t *f, uint64_t h, uint16_t pilot)
+{
+    uint64_t p = mphf_mix(h ^ ((uint64_t)pilot * 0x9e3779b97f4a7c15ULL), 0);
+
+    return (uint32_t)(((p >> 32) * f->slots_count) >> 32);
+}
+
+/** Get slot of key. Function MUST have at least one key.
+ *
+ * @param f   Minimal perfect hash function.
+ * @param key Key to get slot of.
+ *
+ * @return    Returns slot in [0, keys_count), distinct for each key of set.
+ */
+static inline uint32_t
+mphf_lookup(const mphf_t *f, uint64_t key)
+{
+    uint64_t h = mphf_mix(key, f->seed);
+    uint32_t p = mphf_position(f, h, f->pilots[mphf_bucket(f, h)]);
+
+    return p < f->keys_count ? p : f->remap[p - f->keys_count];
+}
+
+void   mphf_init(mphf_t *f, uint32_t count, uint64_t seed,
+                 const uint16_t *pilots, const uint32_t *remap);
+size_t mphf_pilots_count(uint32_t count);
+size_t mphf_remap_count(uint32_t count);
+int    mphf_build(mphf_t *f, uint16_t *pilots, uint32_t *remap, const uint64_t *keys,
+                  uint32_t count);
+
+#endif /* End of MPHF_H */
+
+/** @}*/
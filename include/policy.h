@@ -0,0 +1,210 @@
+/**
+ * @file policy.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup policy Response Policy
+ *
+ * @brief Response policy (blocklist) decides, by query name, whether a query
+ *        is answered from zone database or rewritten to NXDOMAIN, NODATA or
+ *        REFUSED, or dropped. It is checked at resolve stage, before
+ *        response cache and zone lookup, so a policy hit costs no zone work.
+ *
+ *        Policy is built by resource thread from a policy file and is never
+ *        modified once built. Names are compiled into a minimal perfect hash
+ *        (see @ref mphf) over name hashes (see @ref rip_ns_name_hash), and
+ *        an entry array holding hash tag and action of each name, 8 bytes
+ *        per name. Checking a name is a pilot read and an entry read, two
+ *        cache misses even at tens of millions of names. Wildcard names are
+ *        kept in the same table, under a hash distinct from exact name
+ *        hash, and only suffixes with a label count some policy name has
+ *        are checked, so most queries check one or two names.
+ *
+ *        Policy file format is one name per line:
+ *
+ *            <name> [action]
+ *
+ *        Name "*.example.com" matches names strictly below example.com, and
+ *        name "example.com" matches example.com only. Action is one of
+ *        "nxdomain" (default), "nodata", "refuse", "drop" or "passthru".
+ *        Exact name match decides, otherwise longest matching wildcard
+ *        does. If a name is listed more than once its first action is used.
+ *        Text following a ';' character is a comment.
+ *
+ *  @{
+ */
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mphf.h"
+#include "rip_ns_utils.h"
+
+/** Value wildcard name hash is xored with, so that "*.example.com" and
+ * "example.com" have distinct keys.
+ */
+#define POLICY_WILDCARD_KEY 0x9e3779b97f4a7c15ULL
+
+/** Mask of entry bits holding action, remaining bits are name hash tag. */
+#define POLICY_ENTRY_ACTION_MASK 0x7ULL
+
+/** Maximum number of labels of a wire format name, excluding root label. */
+#define POLICY_LABELS_MAX ((RIP_NS_MAXCDNAME + 1) / 2)
+
+/** Enumerated policy actions. */
+typedef enum policy_action_e {
+    /** Query is resolved, overriding a shorter wildcard. */
+    POLICY_ACTION_PASSTHRU = 0,
+
+    /** Query is answered with NXDOMAIN. */
+    POLICY_ACTION_NXDOMAIN,
+
+    /** Query is answered with NOERROR and no records. */
+    POLICY_ACTION_NODATA,
+
+    /** Query is answered with REFUSED. */
+    POLICY_ACTION_REFUSE,
+
+    /** Query is dropped, no response is sent. */
+    POLICY_ACTION_DROP,
+
+    /** Number of policy actions. */
+    POLICY_ACTION_COUNT
+} policy_action_t;
+
+/** Structure describes response policy. Once created it is read only. */
+typedef struct policy_s {
+    /** Generation number of policy, assigned at creation. */
+    uint64_t generation;
+
+    /** Number of names, exact and wildcard. */
+    uint32_t entries_count;
+
+    /** Bit N is set if an exact name of N labels (N capped at 63) is
+     * listed.
+     */
+    uint64_t exact_labels;
+
+    /** Bit N is set if a wildcard name whose suffix (name following "*.")
+     * has N labels (N capped at 63) is listed.
+     */
+    uint64_t wild_labels;
+
+    /** Minimal perfect hash function, maps name key to entry. */
+    mphf_t mphf;
+
+    /** Entries indexed by mphf slot, name key with low bits replaced by
+     * action, see @ref POLICY_ENTRY_ACTION_MASK.
+     */
+    uint64_t *entries;
+} policy_t;
+
+policy_t * policy_create(const char *buf, size_t buf_len, uint64_t generation,
+                         char *err, size_t err_len);
+void policy_release(policy_t *policy);
+
+/** Look up name key in policy.
+ *
+ * @param policy Policy to look key up in, MUST have at least one entry.
+ * @param key    Name hash, xored with @ref POLICY_WILDCARD_KEY for wildcard.
+ * @param action Where to store action if key is found.
+ *
+ * @return       Returns true if key is found, otherwise false.
+ */
+static inline bool
+policy_lookup(const policy_t *policy, uint64_t key, policy_action_t *action)
+{
+    uint64_t e = policy->entries[mphf_lookup(&policy->mphf, key)];
+
+    if (((e ^ key) & ~POLICY_ENTRY_ACTION_MASK) != 0) {
+        return false;
+    }
+    *action = (policy_action_t)(e & POLICY_ENTRY_ACTION_MASK);
+    return true;
+}
+
+/** Prefetch pilot checking exact name reads first, so that a batch of
+ * queries has their policy cache misses overlap.
+ *
+ * @param policy Policy to be checked.
+ * @param hash   Hash of name to be checked.
+ */
+static inline void
+policy_prefetch(const policy_t *policy, uint64_t hash)
+{
+    if (policy->entries_count > 0) {
+        const mphf_t *f = &policy->mphf;
+
+        __builtin_prefetch(&f->pilots[mphf_bucket(f, mphf_mix(hash, f->seed))]);
+    }
+}
+
+/** Check name against policy. Exact name is checked first, then wildcards
+ * from longest to shortest suffix.
+ *
+ * @param policy   Policy to check name against.
+ * @param name     Lower cased wire format name.
+ * @param name_len Length of name, including root label.
+ * @param hash     Hash of name, see @ref rip_ns_name_hash.
+ * @param action   Where to store action to take on query for name, if name
+ *                 matches.
+ *
+ * @return         Returns true if name matches a policy entry, otherwise
+ *                 false.
+ */
+static inline bool
+policy_check(const policy_t *policy, const unsigned char *name, uint16_t name_len,
+             uint64_t hash, policy_action_t *action)
+{
+    uint8_t  offsets[POLICY_LABELS_MAX];
+    unsigned labels = 0;
+
+    if (policy->entries_count == 0 || name_len == 0) {
+        return false;
+    }
+    for (uint16_t i = 0; name[i] != 0 && labels < POLICY_LABELS_MAX; i += name[i] + 1) {
+        offsets[labels++] = (uint8_t)i;
+    }
+    if ((policy->exact_labels >> (labels < 63 ? labels : 63) & 1) &&
+        policy_lookup(policy, hash, action)) {
+        return true;
+    }
+    for (unsigned l = 1; l < labels; l++) {
+        unsigned n = labels - l;
+        uint16_t off = offsets[l];
+
+        if ((policy->wild_labels >> (n < 63 ? n : 63) & 1) == 0) {
+            continue;
+        }
+        if (policy_lookup(policy, rip_ns_name_hash(name + off, name_len - off) ^
+                          POLICY_WILDCARD_KEY, action)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif /* End of POLICY_H */
+
+/** @}*/
@@ -0,0 +1,110 @@
+/**
+ * @file prefork.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup prefork Worker processes
+ *
+ * @brief These are functions that run vectorloops in worker processes,
+ *        supervised by a master process, when "process_workers" is
+ *        configured.
+ *
+ *        Master process parses configuration, creates metrics in shared
+ *        memory (see @ref metrics_new_shared) and forks worker processes.
+ *        Each worker runs "process_thread_count" vectorloops and its own
+ *        support threads, exactly as single process application does, so a
+ *        crash or memory corruption takes down one worker only. Workers open
+ *        their own listeners on same ports (SO_REUSEPORT) and load zone
+ *        database on their own, zone image is mapped read only so its pages
+ *        are shared by all workers.
+ *
+ *        Master only waits for signals and worker exits. It forwards
+ *        termination and reload (SIGHUP) signals to workers, and restarts a
+ *        worker that exited while application was not terminating, after
+ *        @ref PREFORK_RESTART_BACKOFF_MS if worker exited right after start.
+ *  @{
+ */
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "config.h"
+#include "metrics.h"
+
+/** Structure describes a worker process. */
+typedef struct prefork_worker_s {
+    /** Process ID, -1 if worker is not running. */
+    pid_t pid;
+
+    /** Monotonic time in milliseconds worker was started at. */
+    uint64_t started_ms;
+
+    /** Monotonic time in milliseconds worker is to be restarted at, 0 if
+     * no restart is pending.
+     */
+    uint64_t restart_ms;
+} prefork_worker_t;
+
+/** Structure holds master process state. */
+typedef struct prefork_s {
+    /** Configuration, workers get a copy of it when forked. */
+    config_t *cfg;
+
+    /** Metrics shared by all workers. */
+    metrics_t *metrics;
+
+    /** Master process ID. */
+    pid_t master_pid;
+
+    /** Number of workers. */
+    size_t count;
+
+    /** Array of workers, indexed by worker ID. */
+    prefork_worker_t *workers;
+
+    /** Signals master waits for, blocked in master. */
+    sigset_t signals;
+
+    /** Signal mask master was started with, workers restore it. */
+    sigset_t mask_orig;
+
+    /** Set once application is terminating, workers are no longer
+     * restarted.
+     */
+    bool stopping;
+} prefork_t;
+
+void   prefork_init(prefork_t *p, config_t *cfg, metrics_t *metrics);
+void   prefork_clean(prefork_t *p);
+void   prefork_worker_config(config_t *cfg, size_t id);
+pid_t  prefork_spawn(prefork_t *p, size_t id, uint64_t now_ms);
+size_t prefork_reap(prefork_t *p, uint64_t now_ms);
+bool   prefork_run(prefork_t *p);
+
+#endif /* End of PREFORK_H */
+
+/** @}*/
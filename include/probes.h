@@ -0,0 +1,112 @@
+/**
+ * @file probes.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup probes Probes
+ *
+ * @brief USDT (user statically defined tracing) probes on query and TCP
+ *        connection lifecycle, provider "ripples".
+ *
+ *        Probes let tools such as bpftrace attach to running application,
+ *        i.e. to investigate latency outliers, without restarting or
+ *        rebuilding it. A probe not attached to is a single NOP instruction,
+ *        its arguments are values vectorloop already has at hand. Probes are
+ *        compiled in when <sys/sdt.h> (systemtap-sdt-dev package) is present
+ *        at build time, unless RIPPLES_NO_USDT is defined.
+ *
+ *        Query probes, arguments: vectorloop ID, connection ID (0 for UDP),
+ *        protocol (0 UDP, 1 TCP), question type, end code, timestamp of
+ *        stage in nanoseconds since epoch, and query pointer which identifies
+ *        query across probes:
+ *        - query__receive: query read from socket, timestamp is read time.
+ *        - query__parse: query parsed, timestamp is parse time.
+ *        - query__resolve: query resolved, timestamp is resolve time.
+ *        - query__pack: response packed, timestamp is pack time.
+ *        - query__send: response written to socket, timestamp is send time.
+ *        - query__log: query done, before it is logged (or filtered out),
+ *          timestamp is send time, valid only if end code is not negative.
+ *
+ *        TCP connection probes, arguments: vectorloop ID, connection ID,
+ *        connection state (see @ref conn_tcp_state_t) and connection accept
+ *        time in nanoseconds since epoch:
+ *        - tcp__accept: connection accepted.
+ *        - tcp__timeout: connection timer expired.
+ *        - tcp__release: connection released.
+ *
+ *        I.e. to print queries that took more than 1ms from read to send:
+ *
+ *            bpftrace -e '
+ *              usdt:build/bin/ripples:ripples:query__receive { @start[arg6] = arg5; }
+ *              usdt:build/bin/ripples:ripples:query__send /arg5 - @start[arg6] > 1000000/ {
+ *                  printf("vl %d cid %d qtype %d rcode %d %d us\n", arg0, arg1,
+ *                         arg3, arg4, (arg5 - @start[arg6]) / 1000); }'
+ *  @{
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+#if !defined(RIPPLES_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+/** Defined when USDT probes are compiled in. */
+#define PROBES_ENABLED 1
+#endif
+#endif
+
+/** Macro converts timespec to nanoseconds since epoch. */
+#define PROBE_TS_NS(ts) ((uint64_t)(ts).tv_sec * 1000000000 + (ts).tv_nsec)
+
+#ifdef PROBES_ENABLED
+
+/** Macro fires a query probe.
+ *
+ * @param name  Probe name, i.e. query__parse.
+ * @param vl_id Vectorloop ID.
+ * @param cid   Connection ID, 0 for UDP.
+ * @param q     Query.
+ * @param ts    Timestamp (timespec) of stage.
+ */
+#define PROBE_QUERY(name, vl_id, cid, q, ts) \
+    DTRACE_PROBE7(ripples, name, (vl_id), (cid), (q)->protocol, \
+                  (q)->query_q_type, (q)->end_code, PROBE_TS_NS(ts), (q))
+
+/** Macro fires a TCP connection probe.
+ *
+ * @param name  Probe name, i.e. tcp__accept.
+ * @param vl_id Vectorloop ID.
+ * @param c     TCP connection (conn_t).
+ */
+#define PROBE_TCP_CONN(name, vl_id, c) \
+    DTRACE_PROBE4(ripples, name, (vl_id), (c)->cid, (c)->conn.tcp->state, \
+                  PROBE_TS_NS((c)->conn.tcp->start_time))
+
+#else
+
+#define PROBE_QUERY(name, vl_id, cid, q, ts) do { } while (0)
+#define PROBE_TCP_CONN(name, vl_id, c) do { } while (0)
+
+#endif
+
+#endif /* End of PROBES_H */
+
+/** @}*/
@@ -0,0 +1,130 @@
+/**
+ * @file qsbr.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup qsbr Quiescent State Based Reclamation
+ *
+ * @brief Quiescent state based reclamation (QSBR) of objects shared with
+ *        vectorloops, such as resources.
+ *
+ *        Writer publishes a new object with an atomic pointer store, and
+ *        retires old one with @ref qsbr_retire() which advances global epoch.
+ *        Each reader (vectorloop) announces a quiescent state once per loop
+ *        iteration, at a point where it holds no references to shared
+ *        objects, by copying global epoch into its own epoch. Once every
+ *        reader's epoch has reached epoch returned by @ref qsbr_retire(),
+ *        none of them can still reference retired object and it is released.
+ *        See @ref qsbr_passed().
+ *
+ *        A reader about to block (vectorloop idle in epoll_wait()) goes
+ *        offline, so it does not hold back reclamation, and online again
+ *        before it reads shared pointers. Readers never wait on writer, and
+ *        there is no message exchange between them.
+ *  @{
+ */
+#ifndef QSBR_H
+#define QSBR_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+
+/** Epoch of a reader that is offline, holds no references. */
+#define QSBR_OFFLINE 0
+
+/** Structure describes a QSBR reader, on its own cache line so readers do
+ * not share a cache line when updating their epoch.
+ */
+typedef struct qsbr_reader_s {
+    /** Global epoch reader observed at its last quiescent state, or
+     * @ref QSBR_OFFLINE. Only reader writes it.
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong epoch;
+} qsbr_reader_t;
+
+/** Structure describes QSBR domain, writer and readers sharing objects. */
+typedef struct qsbr_s {
+    /** Global epoch, advanced by writer on each retire. Starts at 1. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong epoch;
+
+    /** Array of readers. */
+    qsbr_reader_t *readers;
+
+    /** Number of readers. */
+    size_t readers_count;
+} qsbr_t;
+
+/** Announce quiescent state of reader, reader holds no references to shared
+ * objects it read before this call.
+ *
+ * @param qsbr QSBR domain.
+ * @param id   Reader ID.
+ */
+static inline void
+qsbr_quiescent(qsbr_t *qsbr, size_t id)
+{
+    atomic_store_explicit(&qsbr->readers[id].epoch,
+                          atomic_load_explicit(&qsbr->epoch, memory_order_acquire),
+                          memory_order_release);
+}
+
+/** Take reader offline, reader holds no references to shared objects until
+ * it is back online.
+ *
+ * @param qsbr QSBR domain.
+ * @param id   Reader ID.
+ */
+static inline void
+qsbr_offline(qsbr_t *qsbr, size_t id)
+{
+    atomic_store_explicit(&qsbr->readers[id].epoch, QSBR_OFFLINE, memory_order_release);
+}
+
+/** Bring reader back online, reader MUST read shared pointers again after
+ * this call.
+ *
+ * @param qsbr QSBR domain.
+ * @param id   Reader ID.
+ */
+static inline void
+qsbr_online(qsbr_t *qsbr, size_t id)
+{
+    /* Epoch store MUST be visible to writer before reader loads shared
+     * pointers, otherwise writer could skip this reader and release an object
+     * reader is about to use.
+     */
+    qsbr_quiescent(qsbr, id);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void     qsbr_init(qsbr_t *qsbr, size_t readers_count);
+void     qsbr_clean(qsbr_t *qsbr);
+uint64_t qsbr_retire(qsbr_t *qsbr);
+bool     qsbr_passed(qsbr_t *qsbr, uint64_t epoch);
+
+#endif /* End of QSBR_H */
+
+/** @}*/
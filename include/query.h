@@ -31,7 +31,7 @@
  *        beyond the scope of purpose for this project.
  * 
  *        Parsing EDNS opt RR is supported along with EDNS client subnet
- *        extension.
+ *        and cookie extensions.
  * 
  *        A single structure is used to hold query request and query response.
  *        Depending if query arrived over UDP or TCP, appropriate buffers are
@@ -42,16 +42,24 @@
 #ifndef QUERY_H
 #define QUERY_H
 
+#include <netinet/in.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <sys/socket.h>
 #include <time.h>
 
+#include "arena.h"
+#include "buf_pool.h"
 #include "channel.h"
 #include "config.h"
 #include "constants.h"
+#include "ecs_map.h"
+#include "lb.h"
 #include "metrics.h"
 #include "rip_ns_utils.h"
 #include "rr_record.h"
+#include "zone.h"
 
 
 /** Structure for EDNS client subnet option. */
@@ -72,9 +80,14 @@ typedef struct edns_client_subnet_s {
     /** Client subnet IP family, 1 = IPv4, 2 = IPv6. */
     uint16_t family;
 
-    /** Client subnet IP. */
+    /** Client subnet IP, valid only once decoded, see
+     * @ref query_edns_cs_ip.
+     */
     struct sockaddr_storage ip;
 
+    /** Set once client subnet IP is decoded from request buffer. */
+    bool ip_decoded;
+
     /** Client subnet source mask. This is the mask requested. 
      * Set by query, response mirrors what was in query. (RFC 7871)
      */
@@ -87,6 +100,38 @@ typedef struct edns_client_subnet_s {
     uint8_t scope_mask;
 } edns_client_subnet_t;
 
+/** Structure for EDNS cookie option (RFC 7873). */
+typedef struct edns_cookie_s {
+    /** Pointer in request_buffer where EDNS cookie opt begins. */
+    unsigned char *edns_cookie_raw_buf;
+
+    /** Length of data in raw buffer for EDNS cookie opt.
+     * A length of 0 means that EDNS cookie is not present in query request.
+     */
+    uint16_t edns_cookie_raw_buf_len;
+
+    /** Flag to indicate if EDNS cookie is present & valid, in which case
+     * response echoes client cookie along with a server cookie.
+     */
+    bool edns_cookie_valid;
+
+    /** Set if request carried a server cookie this server generated for the
+     * client, and it has not expired.
+     */
+    bool server_cookie_valid;
+
+    /** Client cookie. */
+    uint8_t client_cookie[DNS_COOKIE_CLIENT_LEN];
+
+    /** Length of server cookie in request, 0 if request only had client
+     * cookie.
+     */
+    uint8_t server_cookie_len;
+
+    /** Server cookie to send in response. */
+    uint8_t server_cookie[DNS_COOKIE_SERVER_LEN];
+} edns_cookie_t;
+
 /** Structure for EDNS optional resource record. */
 typedef struct edns_s {
     /**  Pointer in request_buffere where EDNS rr begins.*/
@@ -116,25 +161,140 @@ typedef struct edns_s {
 
     /** EDNS client subnet */
     edns_client_subnet_t client_subnet; 
+
+    /** EDNS cookie */
+    edns_cookie_t cookie;
+
+    /** Set if request carried EDNS TCP keepalive option (RFC 7828), only then
+     * may response carry it.
+     */
+    bool tcp_keepalive;
 } edns_t;
 
-/** Structure describes a DNS query.  */
+/** Reasons request failed parsing. Values index static string table used
+ * for logging, see @ref query_error_str.
+ */
+typedef enum query_error_e {
+    QUERY_ERR_NONE = 0,         /**< No error */
+    QUERY_ERR_QNAME,            /**< Question name is invalid */
+    QUERY_ERR_QUESTION_SHORT,   /**< Request too short to hold question */
+    QUERY_ERR_QTYPE,            /**< Question type not supported */
+    QUERY_ERR_QCLASS,           /**< Question class not supported */
+    QUERY_ERR_ADDITIONAL,       /**< Additional section is malformed */
+    QUERY_ERR_EDNS_VERSION,     /**< EDNS version not supported */
+    QUERY_ERR_EDNS_OPTION,      /**< EDNS option is malformed */
+    QUERY_ERR_COUNT             /**< Number of errors, not an error */
+} query_error_t;
+
+/** Structure describes a DNS query.
+ *
+ * Structure is cache line aligned and laid out hot to cold. Fields stages of
+ * vectorloop scan for every query of a vector (end code, header pointers,
+ * question hash, type and lengths) fill first cache line, response fields
+ * resolve and pack work with fill second one. Timestamps and buffer ownership
+ * follow, EDNS, section arrays and large buffers only some queries touch are
+ * at the end. Layout is checked by static asserts below the structure.
+ */
 typedef struct query_s {
+    /*** HOT: first cache line, read by every stage for every query. ***/
+    /** Query End code.
+     * Positive codes >=0 correspond to RCODE and it also means that response
+     * should be sent. RCODEs are enumerated in type @ref rip_ns_rcode_t. 
+     * 
+     * Code -1 means application is still processing the request. This is used
+     * by intermediary vectorloop functions as request is being processed to
+     * indicate if request processing is complete or not. I.e. if parsing
+     * the request indicated an error such that the end_code was set and answer
+     * packed, it indicates to next vectorloop step, which is resolve_query,
+     * that it should not handle this query in vector.
+     * 
+     * Negative codes <-1 correspond to other error where response is not sent.
+     * These are rare as most errors have a corresponding DNS message response
+     * code such as "BAD FORMAT" or "NOT IMPLEMENTED", "REFUSED", or "SERVFAIL".
+     * 
+     * ns_r_badvers
+     * ns_r_notzone
+     * ns_r_notauth
+     * ns_r_nxrrset
+     * ns_r_yxrrset
+     * ns_r_yxdomain
+     * ns_r_refused
+     * ns_r_notimpl
+     * ns_r_nxdomain
+     * ns_r_servfail
+     *  1 - ns_r_formerr
+     *  0 - ns_r_noerror
+     * -1 - decision not made, keep processing request as it traverses vectorloop functions.
+     * -2 - invalid format (incomplete header)
+     * -3 - invalid format datagram > RIP_NS_PACKETSZ
+    */
+    _Alignas(CACHE_LINE_SIZE) int end_code;
+
     /** Transport protocol this query uses: 0 - UDP, 1 - TCP. */
     uint8_t protocol;
 
-    /** Request client IP */
-    struct sockaddr_storage *client_ip;
+    /** Reason request failed parsing, one of @ref query_error_t values. It
+     * is an index into static string table, see @ref query_error_str.
+     */
+    uint8_t error;
 
-    /** Request local IP */
-    struct sockaddr_storage *local_ip;
+    /** Set by parse if request is a NOTIFY (RFC 1996) rather than a query,
+     * see @ref zone_secondary_notify().
+     */
+    bool notify;
 
-    /*** REQUEST ***/
-    /** Request buffer with raw DNS request. */
-    unsigned char *request_buffer;
+    /** Set if response was copied from response cache, in which case resolve
+     * and pack are skipped.
+     */
+    bool response_cached : 1;
 
-    /** Request buffer size. */
-    size_t request_buffer_size;
+    /** Set if query was not resolved as query with same response cache key
+     * was resolved earlier in same batch. Its response is copied from
+     * response cache once that query's response is packed.
+     */
+    bool response_coalesced : 1;
+
+    /** Set if query was shed under overload before it was resolved, and is
+     * answered with truncated response, see @ref vloverload.
+     */
+    bool response_slipped : 1;
+
+    /** Set if client is allowlisted by client ACL, query is then in priority
+     * lane, resolved and sent ahead of rest of its batch and exempt from
+     * overload shedding and response rate limiting.
+     */
+    bool priority : 1;
+
+    /** Set if query is timed through parse, resolve and pack stages, see
+     * "metrics_query_cost". Cycles it took are summed in cost_cycles.
+     */
+    bool cost_sampled : 1;
+
+    /** Set if query was answered from a load balancing candidate set, see
+     * @ref lb.
+     */
+    bool lb_answer : 1;
+
+    /** Set if load balanced answer was picked among all candidates, as no
+     * endpoint of candidate set was healthy.
+     */
+    bool lb_all_down : 1;
+
+    /** Set if response was copied from response cache entry that turned
+     * hot, see @ref response_cache_t.hot_hits.
+     */
+    bool response_hot : 1;
+
+    /** Hash of query_qname, see @ref rip_ns_name_hash. Computed once by
+     * parse and used by zone lookup and response cache.
+     */
+    uint64_t query_qname_hash;
+
+    /** Request buffer with raw DNS request. For UDP listener queries this is
+     * response buffer, response is packed in place over request, see
+     * @ref query_response_in_place().
+     */
+    unsigned char *request_buffer;
 
     /** Length of request data in buffer.
      * 
@@ -161,6 +321,11 @@ typedef struct query_s {
     /** Length of query_label string not including string '\0' terminator. */
     uint16_t query_label_len;
 
+    /** Length of query_qname including root label, 0 if question is not
+     * parsed.
+     */
+    uint16_t query_qname_len;
+
     /** Query question type, is one of values in enum @ref rip_ns_type_t.
      * When parsing this from a query it MUST be one of the supported values as
      * identified by function @ref rip_ns_rr_type_supported.
@@ -173,10 +338,17 @@ typedef struct query_s {
      */
     uint16_t query_q_class;
 
-    /** Parsed EDNS(0) if present and valid. */
-    edns_t edns;
+    /** Length of question section in request (name, type, and class) as it
+     * appears on the wire. 0 if question is not parsed.
+     */
+    uint16_t query_question_len;
+
+    /** Hash of response cache key, set when query missed response cache and
+     * its response can be added to cache once packed. 0 otherwise.
+     */
+    uint32_t response_cache_hash;
 
-    /*** RESPONSE ***/
+    /*** HOT: second cache line, response being resolved and packed. ***/
     /** Response buffer to pack response into.
      *
      * @note If protocol is TCP then packing the response needs to account for
@@ -185,16 +357,13 @@ typedef struct query_s {
      */
     unsigned char *response_buffer;
 
-    /** Response buffer size. */
-    size_t response_buffer_size;
-
     /** Length of data in response buffer.
      *
      * @note If protocol is TCP then packing the response needs to account for
      * this and populate the 2 byte prefix and include it in response length.
      */
     size_t response_buffer_len;
-    
+
     /** Response DNS message HEADER. This points to place in response buffer
      * where DNS message begins.
      * 
@@ -203,161 +372,593 @@ typedef struct query_s {
      */
     rip_ns_header_t *response_hdr;
 
-    /** Array to put response answer section resource records. */
-    rr_record_t *answer_section[RIP_NS_RESP_MAX_ANSW];
+    /** RRset whose precompiled response fragment answers query, set by
+     * resolve when answer is exact match of question name and type. NULL if
+     * response is to be packed record by record.
+     */
+    zone_rrset_t *response_rrset;
+
+    /** Zone SOA RRset whose precompiled negative response fragment is
+     * authority section of response, set by resolve for NXDOMAIN and NODATA
+     * responses with no other records. NULL if response is to be packed
+     * record by record.
+     */
+    zone_rrset_t *response_soa;
+
+    /** Zone transfer to send, set by resolve for an AXFR or IXFR query over
+     * TCP for a zone that has a precompiled zone transfer. NULL otherwise.
+     */
+    const zone_xfr_t *xfr;
+
+    /** Offset of EDNS OPT RR from start of response DNS header, 0 if
+     * response has no OPT RR.
+     */
+    uint16_t response_edns_offset;
 
     /** Number of entries in answer_section array. */
     uint8_t answer_section_count;
 
-    /** Array to put response authority section resource records. These are then
-     * packed into response buffer.
+    /** Number of leading answer_section entries packed with query name as
+     * owner name. Set by resolve when answer is an ECS view RRset variant,
+     * whose records are owned by view prefixed name, or is synthesized from
+     * a wildcard.
      */
-    rr_record_t *authority_section[RIP_NS_RESP_MAX_NS];
+    uint8_t answer_qname_count;
+
+    /** Answer is synthesized from a wildcard, leading answer_section entries
+     * are owned by wildcard name.
+     */
+    bool answer_wildcard;
 
     /** Number of entries in authority_section array. */
     uint8_t authority_section_count;
 
-    /** Array to put response additional section resource records. This excludes
-     * EDNS. These are then packed into response buffer.
-     */
-    rr_record_t *additional_section[RIP_NS_RESP_MAX_ADDL];
- 
     /** Number of entries in additional_section array. */
     uint8_t additional_section_count;
 
+    /** Set if response is authoritative (AA bit). Cleared by resolve when
+     * response is a referral to a delegated zone.
+     */
+    bool authoritative;
+
+    /*** WARM: stage timestamps, addresses and buffer ownership. ***/
     /** Timestamp when query request was read in from socket. */
     struct timespec start_time;
 
+    /** Timestamp when query entered parse step, used for latency metrics. */
+    struct timespec parse_time;
+
+    /** Timestamp when query entered resolve step, used for latency metrics.
+     * Not set if query did not pass parse.
+     */
+    struct timespec resolve_time;
+
+    /** Timestamp when query entered response pack step, used for latency
+     * metrics. Not set if no response is to be sent.
+     */
+    struct timespec pack_time;
+
     /** Timestamp when query response was written to socket. */
     struct timespec end_time;
 
-    /** Query End code.
-     * Positive codes >=0 correspond to RCODE and it also means that response
-     * should be sent. RCODEs are enumerated in type @ref rip_ns_rcode_t. 
-     * 
-     * Code -1 means application is still processing the request. This is used
-     * by intermediary vectorloop functions as request is being processed to
-     * indicate if request processing is complete or not. I.e. if parsing
-     * the request indicated an error such that the end_code was set and answer
-     * packed, it indicates to next vectorloop step, which is resolve_query,
-     * that it should not handle this query in vector.
-     * 
-     * Negative codes <-1 correspond to other error where response is not sent.
-     * These are rare as most errors have a corresponding DNS message response
-     * code such as "BAD FORMAT" or "NOT IMPLEMENTED", "REFUSED", or "SERVFAIL".
-     * 
-     * ns_r_badvers
-     * ns_r_notzone
-     * ns_r_notauth
-     * ns_r_nxrrset
-     * ns_r_yxrrset
-     * ns_r_yxdomain
-     * ns_r_refused
-     * ns_r_notimpl
-     * ns_r_nxdomain
-     * ns_r_servfail
-     *  1 - ns_r_formerr
-     *  0 - ns_r_noerror
-     * -1 - decision not made, keep processing request as it traverses vectorloop functions.
-     * -2 - invalid format (incomplete header)
-     * -3 - invalid format datagram > RIP_NS_PACKETSZ
-    */
-    int end_code;
+    /** Request client IP */
+    struct sockaddr_storage *client_ip;
+
+    /** Request local IP */
+    struct sockaddr_storage *local_ip;
+
+    /** View query is answered from, see @ref views_select(), 0 if it is
+     * answered from main zone database. Selected once query is parsed.
+     */
+    uint16_t view;
+
+    /** Zone catalog zone query is answered from plus 1, see
+     * @ref zone_catalog_find(), 0 if it is not answered from a catalog zone.
+     * Selected along with view, only if query has no view.
+     */
+    uint32_t catalog_zone;
+
+    /** Prefix length of GeoIP database network geo was found in. */
+    uint8_t geo_scope;
+
+    /** Geo of query client subnet address, or of client address if query
+     * has no client subnet, see @ref geoip_lookup(), 0 if there is no GeoIP
+     * database or it has no geo of address. Selected along with view.
+     */
+    uint32_t geo;
+
+    /** Per zone metrics slot of zone query is answered from plus 1, see
+     * @ref metrics_zones_register(), 0 if zone is not counted. Set when
+     * query is resolved.
+     */
+    uint16_t zone_slot;
+
+    /** CPU cycles query took in parse, resolve and pack stages, if
+     * cost_sampled is set.
+     */
+    uint64_t cost_cycles;
+
+    /** Request buffer size. */
+    size_t request_buffer_size;
+
+    /** Response buffer size. */
+    size_t response_buffer_size;
+
+    /** Response buffer query owns. Response buffer is this one unless a
+     * larger TCP response buffer was taken from response buffer pool.
+     */
+    unsigned char *response_buffer_own;
+
+    /** Size of response buffer query owns. */
+    size_t response_buffer_own_size;
+
+    /** Pool larger TCP response buffers are taken from, NULL if response
+     * buffer can not be increased.
+     */
+    buf_pool_t *response_pool;
+
+    /*** COLD: EDNS, section arrays and large buffers. ***/
+    /** Parsed EDNS(0) if present and valid. */
+    edns_t edns;
+
+    /** Array to put response answer section resource records. */
+    rr_record_t *answer_section[RIP_NS_RESP_MAX_ANSW];
 
-    /** If applicable holds an error message useful for logging purpose. Any
-     * string populated MUST end with '\0' terminator.
+    /** Array to put response authority section resource records. These are then
+     * packed into response buffer.
+     */
+    rr_record_t *authority_section[RIP_NS_RESP_MAX_NS];
+
+    /** Array to put response additional section resource records. This excludes
+     * EDNS. These are then packed into response buffer.
+     */
+    rr_record_t *additional_section[RIP_NS_RESP_MAX_ADDL];
+
+    /** Record synthesized by resolve from a zone synthesis rule, see
+     * @ref zone_db_synth(). Answer section entry points to it, owned by
+     * query name.
      */
-    char error_message[ERR_MSG_LENGTH];
+    rr_record_t synth_rr;
+
+    /** Rdata of synthesized record. */
+    uint8_t synth_rdata[RIP_NS_MAXCDNAME + 1];
 
-    /** Array of pointers used when packing RR records into response. */
-    const unsigned char *dnptrs[DNS_RESPONSE_COMPRESSED_NAMES_MAX];
+    /** Query question name in canonical form, uncompressed wire format and
+     * lower cased. Used as lookup key so later stages need not convert or
+     * case fold name again.
+     */
+    unsigned char query_qname[RIP_NS_MAXCDNAME + 1];
+
+    /** Name compression table used when packing RR records into response. */
+    rip_ns_comp_t comp;
 } query_t;
 
+_Static_assert(offsetof(query_t, response_cache_hash) + sizeof(uint32_t) <= CACHE_LINE_SIZE,
+               "query_t per query stage fields do not fit first cache line");
+_Static_assert(offsetof(query_t, response_buffer) == CACHE_LINE_SIZE &&
+               offsetof(query_t, authoritative) < 2 * CACHE_LINE_SIZE,
+               "query_t response fields do not fit second cache line");
+
 
 void query_init(query_t *q, config_t *cfg, uint8_t protocol);
+size_t query_arena_size(void);
+void query_init_arena(query_t *q, arena_t *arena);
 void query_reset(query_t *q);
+void query_resolve_reset(query_t *q);
 void query_clean(query_t *q);
+const char * query_error_str(query_error_t error);
 int  query_tcp_response_buffer_increase(query_t *q);
+void query_tcp_response_buffer_release(query_t *q);
+
+/** Get maximum length of DNS response message for query. For TCP it is size
+ * of response buffer less 2 byte length prefix. For UDP it is EDNS UDP
+ * payload size client advertised, or @ref RIP_NS_PACKETSZ if request has no
+ * EDNS, limited to size of response buffer.
+ *
+ * @param q Query to get maximum response length for.
+ *
+ * @return  Returns maximum response length in bytes.
+ */
+static inline size_t
+query_response_size_max(const query_t *q)
+{
+    size_t size;
+
+    if (q->protocol == 1) {
+        /* TCP */
+        return q->response_buffer_size - 2;
+    }
+    size = q->edns.edns_valid ? q->edns.udp_resp_len : RIP_NS_PACKETSZ;
+    return size < q->response_buffer_size ? size : q->response_buffer_size;
+}
+
+/** Check if query response is packed in place over its request, see
+ * @ref query_init_arena(). Request header is then overwritten by response
+ * header, which keeps its ID and RD bit, and request question is left in
+ * place as response question.
+ *
+ * @param q Query to check.
+ *
+ * @return  Returns true if request and response share buffer.
+ */
+static inline bool
+query_response_in_place(const query_t *q)
+{
+    return q->response_hdr == q->request_hdr;
+}
+
+/** Check whether request header has the shape @ref query_parse_fast
+ * handles: not truncated, a standard query, not a response, a single
+ * question, no answer or authority records and at most one additional
+ * record.
+ *
+ * @param q Query to check DNS request header of.
+ *
+ * @return  Returns true if header has fast path shape, false otherwise.
+ */
+static inline bool
+query_parse_fast_header(const query_t *q)
+{
+    const rip_ns_header_t *header = q->request_hdr;
+
+    return q->request_buffer_len >= sizeof(rip_ns_header_t) + 1 + RIP_NS_QFIXEDSZ &&
+           header->tc == 0 && header->opcode == rip_ns_o_query && header->qr == 0 &&
+           header->qdcount == htons(1) && header->ancount == 0 && header->nscount == 0 &&
+           ntohs(header->arcount) <= 1;
+}
 
 int  query_parse_edns_ext_cs(edns_client_subnet_t *cs);
+const struct sockaddr_storage * query_edns_cs_ip(edns_client_subnet_t *cs);
+int  query_parse_edns_ext_cookie(edns_cookie_t *cookie);
 int  query_parse_edns_ext(query_t *q, unsigned char *buf, unsigned char *eobuf);
 int  query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr);
 int  query_parse_request_rr_question(query_t *q);
+uint64_t query_parse_fast_headers(const query_t *queries, const struct mmsghdr *read_vector,
+                                  unsigned int count);
+bool query_parse_fast(query_t *q);
+bool query_parse_fast_question(query_t *q);
 void query_parse(query_t *q);
 
-void query_resolve(query_t *q);
+void query_resolve(query_t *q, zone_db_t *db, ecs_map_t *ecs_map, const lb_t *lb,
+                   zone_nsec3_cache_t *nsec3_cache);
 
 int  query_pack_edns(uint8_t *buf, uint16_t buf_len, edns_t *edns);
 int  query_pack_rr(const unsigned char *name, rr_record_t *rr, unsigned char *buf, uint16_t buf_len,
-                   const unsigned char **dnptrs, const unsigned char **lastdnptr);
+                   rip_ns_comp_t *comp);
 int  query_response_pack(query_t *q);
+int  query_response_pack_cookie(query_t *q);
+void query_response_pack_truncated(query_t *q);
+int  query_response_pack_keepalive(query_t *q, uint16_t timeout);
+
+/** Structure describes a query log chunk, a buffer of binary query log
+ * records.
+ */
+typedef struct query_log_chunk_s {
+    /** Buffer with binary query log records. */
+    char *buf;
+
+    /** Length of data in buffer, set by vectorloop before chunk is published. */
+    size_t len;
+} query_log_chunk_t;
+
+/** Magic number at start of shared memory query log ring, "RQLS". */
+#define QUERY_LOG_SHM_MAGIC 0x52514c53
+
+/** Version of shared memory query log ring layout. */
+#define QUERY_LOG_SHM_VERSION 1
+
+/** Structure describes a chunk of shared memory query log ring. */
+typedef struct query_log_shm_chunk_s {
+    /** Sequence number, 2 * p + 1 while vectorloop writes chunk as p-th
+     * chunk to be published, 2 * p + 2 once it is published.
+     */
+    atomic_ullong seq;
+
+    /** Length of records in chunk, valid once chunk is published. */
+    uint64_t len;
+} query_log_shm_chunk_t;
+
+/** Structure describes header of shared memory query log ring, a file
+ * (usually in /dev/shm) each vectorloop maps its query log chunks into, so
+ * external processes read binary query log records (@ref query_log_record_t)
+ * right where vectorloop wrote them.
+ *
+ * Vectorloop never waits on external reader. Reader reads published chunks
+ * in order: p-th chunk published is at index p % chunk_count, its records
+ * at data_offset + index * buf_size. Reader checks chunk seq is 2 * p + 2,
+ * copies len bytes out, then checks seq again: if it changed vectorloop
+ * reused chunk while it was being copied (reader fell chunk_count chunks
+ * behind) and copy MUST be discarded. Reader stores number of chunks it
+ * consumed in reader, so vectorloop counts overruns, 0 means no reader is
+ * attached.
+ */
+typedef struct query_log_shm_s {
+    /** Set to @ref QUERY_LOG_SHM_MAGIC. */
+    uint32_t magic;
+
+    /** Set to @ref QUERY_LOG_SHM_VERSION. */
+    uint32_t version;
+
+    /** ID of vectorloop ring belongs to. */
+    uint32_t vl_id;
+
+    /** Set to 1 once vectorloop exited, no more chunks are published. */
+    atomic_uint closed;
+
+    /** Number of chunks in ring. */
+    uint64_t chunk_count;
+
+    /** Size (capacity) of each chunk. */
+    uint64_t buf_size;
+
+    /** Offset of first chunk from start of ring, page aligned. */
+    uint64_t data_offset;
+
+    /** Number of chunks published, only vectorloop writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong head;
+
+    /** Number of queries not logged for lack of buffer space. */
+    atomic_ullong drops;
+
+    /** Number of chunks reused by vectorloop before reader consumed them. */
+    atomic_ullong overruns;
+
+    /** Number of chunks reader consumed, only reader writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong reader;
+
+    /** Chunks of ring. */
+    _Alignas(CACHE_LINE_SIZE) query_log_shm_chunk_t chunks[];
+} query_log_shm_t;
 
 /** Stucture describes a query log object.
  *
- * Queries are logged into a buffer. There are two buffers, one is active,
- * while the other one (inactive buffer) is having its data written to disk.
- * This enables us to have no blocking operations (such as writing to disk)
- * in the vectorloop.
+ * Queries are logged into a fixed size ring of chunks (buffers), shared by a
+ * single producer, the vectorloop, and a single consumer, the query logging
+ * thread. Vectorloop logs queries into its active chunk and publishes it to
+ * the ring, then moves on to next chunk. Query logging thread writes published
+ * chunks to disk and hands them back. Neither side waits on the other, which
+ * keeps blocking operations (such as writing to disk) out of the vectorloop.
  * 
- * Query logging thread uses channels to notify vectorloop thread when it should
- * swap log buffers. Once VL thread swaps buffers, it sends a message back to
- * query logging thread indicating so, which in turn signals the query logging
- * thread that it should log data from VL inactive buffer to disk. Once data
- * is written to disk the process repeats.
+ * If query logging thread falls behind, the ring fills up and vectorloop keeps
+ * logging into its active chunk until no room is left, after which queries
+ * are not logged. Both are counted in vectorloop metrics. Optional spill
+ * buffer (see @ref query_log_spill_init) holds queries that did not fit
+ * until chunks free up, configuration setting query_log_full_policy.
  * 
- * Each vectorloop thread has its own set of query log buffers.
+ * Each vectorloop thread has its own query log ring.
  * 
- * Size of each buffer is set by configuration setting
- * query_log_buffer_size.
+ * Size of each chunk is set by configuration setting query_log_buffer_size,
+ * number of chunks by query_log_buffer_count.
+ * 
+ * With configuration setting query_log_shm_path chunks are mapped from a
+ * shared memory file (see @ref query_log_shm_t), and external processes
+ * read them as a second consumer, which is never waited on.
  */
 typedef struct query_log_s {
-    /** Size (capacity) of buffers. */
+    /** Size (capacity) of each chunk buffer. */
     size_t buf_size;
 
-    /** Buffer A */
-    char *a_buf;
-
-    /** Length of data in buffer A. */
-    size_t a_buf_len;
+    /** Number of chunks in ring. */
+    size_t chunk_count;
 
-    /** Buffer B */
-    char *b_buf;
-    /** Length of data in buffer B. */
-    size_t b_buf_len;
+    /** Ring of chunks. */
+    query_log_chunk_t *chunks;
 
-    /** Pointer to active buffer. */
+    /** Pointer to active chunk buffer, owned by vectorloop. */
     char *buf;
 
-    /** Length of data in active buffer. */
+    /** Length of data in active chunk buffer. */
     size_t buf_len;
+
+    /** Shared memory ring chunks are mapped from, NULL if there is none. */
+    query_log_shm_t *shm;
+
+    /** Length of shared memory ring mapping. */
+    size_t shm_len;
+
+    /** Spill buffer records that did not fit into ring are logged to, owned
+     * by vectorloop, NULL if there is none.
+     */
+    char *spill;
+
+    /** Size (capacity) of spill buffer. */
+    size_t spill_size;
+
+    /** Length of data in spill buffer. */
+    size_t spill_len;
+
+    /** Offset of oldest record in spill buffer not yet moved to ring. */
+    size_t spill_offset;
+
+    /** Time oldest record in spill buffer was logged, in nanoseconds. */
+    uint64_t spill_time;
+
+    /** Number of chunks published, only vectorloop writes it. Vectorloop's
+     * active chunk is chunks[head % chunk_count].
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong head;
+
+    /** Number of chunks written to disk, only query logging thread writes it.
+     * Chunks from tail up to head are published and owned by query logging
+     * thread.
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong tail;
 } query_log_t;
 
+/** Union holds a socket address logged in query log record, large enough for
+ * both IPv4 and IPv6 addresses.
+ */
+typedef union query_log_sockaddr_u {
+    /** Generic socket address, sa_family identifies address family. */
+    struct sockaddr     sa;
+
+    /** IPv4 socket address. */
+    struct sockaddr_in  sin;
+
+    /** IPv6 socket address. */
+    struct sockaddr_in6 sin6;
+} query_log_sockaddr_t;
+
+/** Query log record flag: request RD bit is set. */
+#define QUERY_LOG_REC_F_RD       0x01
+
+/** Query log record flag: request TC bit is set. */
+#define QUERY_LOG_REC_F_TC       0x02
+
+/** Query log record flag: request EDNS is valid. */
+#define QUERY_LOG_REC_F_EDNS     0x04
+
+/** Query log record flag: request EDNS DO bit is set. */
+#define QUERY_LOG_REC_F_DO       0x08
+
+/** Query log record flag: request EDNS client subnet is valid. */
+#define QUERY_LOG_REC_F_CS       0x10
+
+/** Query log record flag: response has answer, authority or additional
+ * records.
+ */
+#define QUERY_LOG_REC_F_RESPONSE 0x20
+
+/** Structure describes fixed size part of a binary query log record.
+ *
+ * Vectorloop logs queries in binary records, made by copying query data,
+ * leaving conversion to text to query log thread. Record is followed by
+ * q_name_len bytes of question name, then answer_count answer records
+ * (@ref query_log_record_rr_t). Records are written one after another with no
+ * padding, so they MUST be copied out of log buffer before they are accessed.
+ */
+typedef struct query_log_record_s {
+    /** Length of record in bytes, including variable length data. */
+    uint32_t len;
+
+    /** Query end code, see @ref query_t. */
+    int32_t end_code;
+
+    /** Timestamp when query request was read in from socket. */
+    struct timespec start_time;
+
+    /** Timestamp when query response was written to socket. */
+    struct timespec end_time;
+
+    /** Client socket address. */
+    query_log_sockaddr_t client_ip;
+
+    /** Local socket address. */
+    query_log_sockaddr_t local_ip;
+
+    /** EDNS client subnet address, only set when QUERY_LOG_REC_F_CS is set. */
+    query_log_sockaddr_t cs_ip;
+
+    /** EDNS advertized UDP response length. */
+    uint16_t udp_resp_len;
+
+    /** EDNS client subnet family, 1 = IPv4, 2 = IPv6. */
+    uint16_t cs_family;
+
+    /** Question type. */
+    uint16_t q_type;
+
+    /** Question class. */
+    uint16_t q_class;
+
+    /** Length of question name following record. */
+    uint16_t q_name_len;
+
+    /** Query ID. */
+    uint16_t id;
+
+    /** QUERY_LOG_REC_F_* flags. */
+    uint8_t flags;
+
+    /** Transport protocol, 0 - UDP, 1 - TCP. */
+    uint8_t protocol;
+
+    /** EDNS version. */
+    uint8_t edns_version;
+
+    /** EDNS client subnet source mask. */
+    uint8_t cs_source_mask;
+
+    /** EDNS client subnet scope mask. */
+    uint8_t cs_scope_mask;
+
+    /** Number of answer records following question name. */
+    uint8_t answer_count;
+} query_log_record_t;
+
+/** Structure describes fixed size part of an answer record logged in a binary
+ * query log record. It is followed by name_len bytes of record name, then
+ * rdata_len bytes of record data. Record data is only logged for address and
+ * domain name records, and is in network order.
+ */
+typedef struct query_log_record_rr_s {
+    /** Record TTL. */
+    uint32_t ttl;
+
+    /** Record type. */
+    uint16_t type;
+
+    /** Record class. */
+    uint16_t class;
+
+    /** Length of record name. */
+    uint16_t name_len;
+
+    /** Length of record data, 0 if not logged. */
+    uint16_t rdata_len;
+} query_log_record_rr_t;
+
 /** Structure holds arguments passed to @ref query_log_loop function. */
 typedef struct query_log_loop_args_s {
     /** Configuration where settings are taken from. */
     config_t *cfg;
 
-    /** Array of query log channels used to exchange messages with vectorloop. */
-    channel_bss_t *query_log_channels;
+    /** Array of query logs, one for each vectorloop. */
+    query_log_t **query_logs;
 
-    /** Number of entries in query_log_channels array. */
-    size_t query_log_channel_count;
+    /** Number of entries in query_logs array. */
+    size_t query_log_count;
 
     /** Channel used to send application log messages. */
     channel_log_t *app_log_channel;
 
+    /** Channel query log writer thread uses to send application log messages. */
+    channel_log_t *writer_app_log_channel;
+
     /** Structure to report metrics. */
     metrics_t *metrics;
 
+    /** Set to have query log thread write out all published chunks, stop
+     * query log writer thread, and exit.
+     */
+    atomic_bool stop;
 } query_log_loop_args_t;
 
+bool query_log_filter(const config_t *cfg, query_t *q, uint32_t *sample_count);
 int  query_log(char *buf, size_t buf_len, query_t *q);
-void query_log_rotate(query_log_t *query_log);
+int  query_log_record_to_text(const char *rec, char *buf, size_t buf_len);
+void query_log_init(query_log_t *query_log, size_t buf_size, size_t chunk_count);
+int  query_log_init_shm(query_log_t *query_log, const char *path, uint32_t vl_id,
+                        size_t buf_size, size_t chunk_count, char *err,
+                        size_t err_len);
+void query_log_close(query_log_t *query_log);
+void query_log_drop(query_log_t *query_log);
+bool query_log_publish(query_log_t *query_log);
+void query_log_spill_init(query_log_t *query_log, size_t spill_size);
+int  query_log_spill(query_log_t *ql, query_t *q, uint64_t now);
+size_t query_log_spill_drain(query_log_t *query_log, uint64_t now,
+                             uint64_t age_max, size_t *aged);
+bool query_log_backlogged(query_log_t *query_log);
+query_log_chunk_t * query_log_peek(query_log_t *query_log);
+void query_log_consume(query_log_t *query_log);
 
 void * query_log_loop(void *args);
 
 
-void query_report_metrics(query_t *, metrics_t *metrics);
+void query_report_metrics(query_t *, metrics_query_batch_t *batch,
+                          metrics_vl_t *metrics, metrics_sketch_vl_t *sketch,
+                          metrics_zone_counters_t *zones, metrics_cost_t *cost);
+void query_report_metrics_flush(metrics_query_batch_t *batch, metrics_vl_t *metrics);
 
 #endif /* End of QUERY_H */
 
@@ -0,0 +1,177 @@
+/**
+ * @file dnstap.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup query_log_arrow Query Log Arrow
+ *
+ * @brief Arrow IPC encoding of query log records.
+ *
+ *        Query log thread accumulates binary query log records column by
+ *        column into a batch of at most @ref QUERY_LOG_ARROW_BATCH_ROWS rows,
+ *        and encodes full batches, or batches held when query log is flushed,
+ *        as Arrow IPC streaming format messages. Client and local address,
+ *        question type and rcode columns are dictionary encoded. Each batch
+ *        is written as a replacement DictionaryBatch for each dictionary
+ *        followed by a RecordBatch, so dictionaries only hold values of their
+ *        batch and any batch can be decoded with the schema alone.
+ *
+ *        Writer thread starts each query log file, or connection to remote
+ *        collector, with Schema message and ends it with end-of-stream
+ *        marker, so each file is a complete Arrow IPC stream.
+ *
+ *        Message metadata are FlatBuffers, built front to back by a minimal
+ *        builder here, so no FlatBuffers nor Arrow library is needed.
+ *
+ *        See https://arrow.apache.org/docs/format/Columnar.html for format.
+ *  @{
+ */
+#ifndef QUERY_LOG_ARROW_H
+#define QUERY_LOG_ARROW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum number of rows in a batch. */
+#define QUERY_LOG_ARROW_BATCH_ROWS 2048
+
+/** Maximum length of question names in a batch, MUST be larger than longest
+ * question name logged.
+ */
+#define QUERY_LOG_ARROW_NAME_DATA_MAX 262144
+
+/** Number of dictionary encoded columns. */
+#define QUERY_LOG_ARROW_DICT_COUNT 4
+
+/** Number of hash table slots of a dictionary, power of 2 larger than
+ * @ref QUERY_LOG_ARROW_BATCH_ROWS.
+ */
+#define QUERY_LOG_ARROW_DICT_SLOTS 4096
+
+/** Maximum length of dictionary key: address family followed by address. */
+#define QUERY_LOG_ARROW_DICT_KEY_MAX 17
+
+/** Maximum length of dictionary value: IPv6 address as text. */
+#define QUERY_LOG_ARROW_DICT_VALUE_MAX 46
+
+/** Maximum length of FlatBuffer metadata of a message. */
+#define QUERY_LOG_ARROW_META_MAX 4096
+
+/** Maximum length of Schema message. */
+#define QUERY_LOG_ARROW_SCHEMA_MAX (QUERY_LOG_ARROW_META_MAX + 8)
+
+/** Length of end-of-stream marker. */
+#define QUERY_LOG_ARROW_EOS_LEN 8
+
+/** Structure describes a dictionary of a dictionary encoded column. Values
+ * are looked up by key (raw value from query log record), so a value is
+ * formatted once per batch no matter how many rows hold it.
+ */
+typedef struct query_log_arrow_dict_s {
+    /** Open addressed (linear probing) hash table, entry index + 1 of each
+     * key, 0 if slot is empty.
+     */
+    uint32_t slots[QUERY_LOG_ARROW_DICT_SLOTS];
+
+    /** Keys of entries. */
+    unsigned char keys[QUERY_LOG_ARROW_BATCH_ROWS][QUERY_LOG_ARROW_DICT_KEY_MAX];
+
+    /** Number of entries. */
+    uint32_t count;
+
+    /** Arrow offsets of entry values in data. */
+    int32_t offsets[QUERY_LOG_ARROW_BATCH_ROWS + 1];
+
+    /** Entry values. */
+    char data[QUERY_LOG_ARROW_BATCH_ROWS * QUERY_LOG_ARROW_DICT_VALUE_MAX];
+} query_log_arrow_dict_t;
+
+/** Structure describes a batch of query log records being accumulated in
+ * columns. Dictionary encoded columns hold dictionary indices.
+ */
+typedef struct query_log_arrow_s {
+    /** Number of rows in batch. */
+    uint32_t rows;
+
+    /** Time query was received, nanoseconds since epoch. */
+    int64_t time[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Nanoseconds from query received to response sent, 0 if response was
+     * not sent.
+     */
+    int64_t duration[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Client address. */
+    int32_t client_ip[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Client port. */
+    uint16_t client_port[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Local address. */
+    int32_t local_ip[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Local port. */
+    uint16_t local_port[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Transport protocol, 0 - UDP, 1 - TCP. */
+    uint8_t protocol[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Query ID. */
+    uint16_t id[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** QUERY_LOG_REC_F_* flags. */
+    uint8_t flags[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** EDNS advertized UDP response length. */
+    uint16_t edns_udp_size[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Arrow offsets of question names in qname_data. */
+    int32_t qname[QUERY_LOG_ARROW_BATCH_ROWS + 1];
+
+    /** Question names. */
+    char qname_data[QUERY_LOG_ARROW_NAME_DATA_MAX];
+
+    /** Question class. */
+    uint16_t qclass[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Question type. */
+    int32_t qtype[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Response code, or reason response was not sent. */
+    int32_t rcode[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Number of answer records. */
+    uint8_t answer_count[QUERY_LOG_ARROW_BATCH_ROWS];
+
+    /** Dictionaries of dictionary encoded columns, by dictionary ID. */
+    query_log_arrow_dict_t dicts[QUERY_LOG_ARROW_DICT_COUNT];
+} query_log_arrow_t;
+
+void   query_log_arrow_reset(query_log_arrow_t *a);
+int    query_log_arrow_add(query_log_arrow_t *a, const char *rec);
+size_t query_log_arrow_batch(query_log_arrow_t *a, char *buf, size_t buf_len);
+size_t query_log_arrow_schema(char *buf, size_t buf_len);
+size_t query_log_arrow_eos(char *buf);
+
+#endif /* End of QUERY_LOG_ARROW_H */
+
+/** @}*/
@@ -0,0 +1,176 @@
+/**
+ * @file xor_filter.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup query_log_index Query Log Index
+ *
+ * @brief Query log index is a sparse sidecar index of a query log file, so
+ *        offline tools find queries of a time window or question name
+ *        without decoding whole file.
+ *
+ *        Query log file is indexed in blocks, one block per query log writer
+ *        buffer, of at most "query_log_index_records" records. Index file,
+ *        named after query log file with @ref QUERY_LOG_INDEX_SUFFIX, is a
+ *        header (@ref query_log_index_header_t) followed by one entry per
+ *        block (@ref query_log_index_entry_t), appended as blocks are
+ *        written. Entry holds file offset and length of block, its oldest and
+ *        newest query receive time, and a Bloom filter of its question name
+ *        hashes. Uncompressed block is text of its queries, whole lines even
+ *        when part of it was carried over to next buffer with O_DIRECT.
+ *        Compressed block is a whole gzip member, so it can be decompressed
+ *        on its own.
+ *
+ *        Records of different vectorloops are interleaved, so receive times
+ *        are not ordered across blocks. Entries are small, tools read all of
+ *        them and decode blocks whose time range overlaps window and whose
+ *        filter may contain question name.
+ *
+ *        Module has no dependencies on rest of ripples, so it is built into
+ *        offline tools as is.
+ *  @{
+ */
+#ifndef QUERY_LOG_INDEX_H
+#define QUERY_LOG_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/** Suffix appended to query log file name to name its index file. */
+#define QUERY_LOG_INDEX_SUFFIX ".idx"
+
+/** Magic number at start of index file, "RQLX" in little endian. */
+#define QUERY_LOG_INDEX_MAGIC 0x584c5152
+
+/** Version of index file layout, bumped when it changes. */
+#define QUERY_LOG_INDEX_VERSION 1
+
+/** Index header flag: query log file is compressed, blocks are gzip members. */
+#define QUERY_LOG_INDEX_F_COMPRESSED 0x01
+
+/** Number of bits of block Bloom filter, about 8 bits per name for blocks of
+ * default 4096 records, about 2% false positives with unique names.
+ */
+#define QUERY_LOG_INDEX_BLOOM_BITS 32768
+
+/** Number of bits set per question name in block Bloom filter. */
+#define QUERY_LOG_INDEX_BLOOM_HASHES 4
+
+/** Structure describes index file header. */
+typedef struct query_log_index_header_s {
+    /** Set to @ref QUERY_LOG_INDEX_MAGIC. */
+    uint32_t magic;
+
+    /** Set to @ref QUERY_LOG_INDEX_VERSION. */
+    uint16_t version;
+
+    /** QUERY_LOG_INDEX_F_* flags. */
+    uint16_t flags;
+
+    /** Size of each entry following header. */
+    uint32_t entry_size;
+
+    /** Number of bits of block Bloom filter. */
+    uint32_t bloom_bits;
+
+    /** Number of bits set per question name in block Bloom filter. */
+    uint32_t bloom_hashes;
+
+    /** Reserved, set to 0. */
+    uint32_t reserved;
+} query_log_index_header_t;
+
+/** Structure describes index entry of a query log file block. */
+typedef struct query_log_index_entry_s {
+    /** Offset of block in query log file. */
+    uint64_t offset;
+
+    /** Length of block in query log file. */
+    uint64_t len;
+
+    /** Oldest receive time of a query in block, nanoseconds since epoch. */
+    uint64_t time_first;
+
+    /** Newest receive time of a query in block, nanoseconds since epoch. */
+    uint64_t time_last;
+
+    /** Number of queries in block. */
+    uint32_t records;
+
+    /** Reserved, set to 0. */
+    uint32_t reserved;
+
+    /** Bloom filter of question name hashes, see
+     * @ref query_log_index_name_hash.
+     */
+    uint8_t bloom[QUERY_LOG_INDEX_BLOOM_BITS / 8];
+} query_log_index_entry_t;
+
+/** Get bit of block Bloom filter a question name hash sets.
+ *
+ * @param hash Question name hash.
+ * @param i    Number of bit, 0 to @ref QUERY_LOG_INDEX_BLOOM_HASHES - 1.
+ *
+ * @return     Returns bit index in Bloom filter.
+ */
+static inline uint32_t
+query_log_index_bloom_bit(uint64_t hash, uint32_t i)
+{
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+
+    return (h1 + i * h2) % QUERY_LOG_INDEX_BLOOM_BITS;
+}
+
+/** Test if block may have a query for question name.
+ *
+ * @param e    Index entry of block.
+ * @param hash Question name hash, see @ref query_log_index_name_hash.
+ *
+ * @return     Returns false if block definitely has no query for name, true
+ *             if it may have.
+ */
+static inline bool
+query_log_index_contain(const query_log_index_entry_t *e, uint64_t hash)
+{
+    for (uint32_t i = 0; i < QUERY_LOG_INDEX_BLOOM_HASHES; i++) {
+        uint32_t bit = query_log_index_bloom_bit(hash, i);
+
+        if ((e->bloom[bit / 8] & (1 << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t query_log_index_name_hash(const char *name, size_t name_len);
+void     query_log_index_header_init(query_log_index_header_t *h, bool compressed);
+int      query_log_index_header_check(const query_log_index_header_t *h);
+void     query_log_index_entry_reset(query_log_index_entry_t *e);
+void     query_log_index_entry_add(query_log_index_entry_t *e, const char *name,
+                                   size_t name_len, const struct timespec *ts);
+
+#endif /* End of QUERY_LOG_INDEX_H */
+
+/** @}*/
@@ -0,0 +1,221 @@
+/**
+ * @file query_log_writer.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup query_log_writer Query Log Writer
+ *
+ * @brief Query log writer writes query log text to disk on its own thread.
+ *
+ *        Query log thread converts binary query log records to text into
+ *        writer buffers and hands them to writer thread through a single
+ *        producer, single consumer ring. Writer thread writes buffers to file
+ *        and rotates files, so a slow disk or a file rotation never holds up
+ *        draining of vectorloop query logs. Next query log file is opened
+ *        ahead of time, so rotation only swaps file descriptors.
+ *
+ *        Buffers are aligned so files can optionally be written with
+ *        O_DIRECT, see configuration setting "query_log_direct_io". With
+ *        O_DIRECT only whole blocks are written, text after last whole block
+ *        is carried over to next buffer. When there is no more text to write
+ *        last block is padded with new lines, which shows up as empty lines
+ *        in query log.
+ *
+ *        With "query_log_splice" files are written by mapping each buffer
+ *        into a pipe with vmsplice and splicing pipe to file. Pipe is drained
+ *        before write returns, so buffer can be handed back to query log
+ *        thread as it is with write. If kernel or file system refuses splice
+ *        writer falls back to write for good.
+ *
+ *        With "query_log_compress" each buffer is compressed on writer
+ *        thread into its own gzip member. Concatenated members are a valid
+ *        gzip file, and decompression can start at any member boundary.
+ *        With "query_log_remote_ip" or "query_log_remote_unix" query log is
+ *        streamed over TCP or Unix socket to a remote collector instead of
+ *        written to files.
+ *
+ *        With "query_log_format" set to "dnstap" each file, or connection to
+ *        collector, is a Frame Streams stream: writer thread writes START
+ *        control frame when file is opened (after READY/ACCEPT handshake
+ *        with collector) and STOP control frame before file is rotated.
+ *        With "arrow" each is an Arrow IPC stream: writer thread writes
+ *        Schema message when file is opened and end-of-stream marker before
+ *        file is rotated, see @ref query_log_arrow.
+ *
+ *        With "query_log_index" each text query log file gets a sparse
+ *        index (see @ref query_log_index), one entry per buffer. Query log
+ *        thread adds each record it converts to its buffer's index entry,
+ *        writer thread appends entry to index file once buffer is written.
+ *  @{
+ */
+#ifndef QUERY_LOG_WRITER_H
+#define QUERY_LOG_WRITER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "metrics.h"
+#include "query_log_index.h"
+
+/** Structure describes a query log writer buffer. */
+typedef struct query_log_writer_buf_s {
+    /** Buffer with query log text, aligned to @ref QUERY_LOG_DIRECT_IO_ALIGN. */
+    char *buf;
+
+    /** Length of text in buffer. */
+    size_t len;
+
+    /** Set if query log file is to be rotated after buffer is written. */
+    bool rotate;
+
+    /** Index entry of queries in buffer, used if writer indexes files. */
+    query_log_index_entry_t index;
+} query_log_writer_buf_t;
+
+/** Structure describes a query log writer. */
+typedef struct query_log_writer_s {
+    /** Configuration with settings to use. */
+    config_t *cfg;
+
+    /** Channel used to send application log messages. */
+    channel_log_t *app_log_channel;
+
+    /** Metrics object to report metrics to. */
+    metrics_t *metrics;
+
+    /** Ring of buffers. */
+    query_log_writer_buf_t bufs[QUERY_LOG_WRITER_BUF_COUNT];
+
+    /** Size (capacity) of each buffer. */
+    size_t buf_size;
+
+    /** Set if files are written with O_DIRECT. */
+    bool direct_io;
+
+    /** Set if files are written with vmsplice and splice. */
+    bool splice;
+
+    /** Set if buffers are compressed before they are written. */
+    bool compress;
+
+    /** Set if query log is streamed to remote collector instead of files. */
+    bool remote;
+
+    /** Set if query log is written as dnstap Frame Streams. */
+    bool dnstap;
+
+    /** Set if query log is written as Arrow IPC stream. */
+    bool arrow;
+
+    /** Set if query log files are indexed. */
+    bool index;
+
+    /** Eventfd writer thread waits on for buffers to be submitted. */
+    int wake_fd;
+
+    /** Set by query log thread, once it submitted its last buffer, to have
+     * writer thread write out submitted buffers and exit.
+     */
+    atomic_bool stop;
+
+    /*** Owned by producer (query log thread). ***/
+
+    /** Set if buffer at head is being filled. */
+    bool cur_open;
+
+    /** Text carried over to next buffer with O_DIRECT. */
+    char carry[QUERY_LOG_DIRECT_IO_ALIGN];
+
+    /** Length of text in carry buffer. */
+    size_t carry_len;
+
+    /** Number of bytes submitted since last rotation was requested. */
+    size_t submitted;
+
+    /*** Owned by consumer (writer thread). ***/
+
+    /** Compression stream, used if compress is set. */
+    z_stream zs;
+
+    /** Buffer buffers are compressed to, large enough for any buffer. */
+    char *zbuf;
+
+    /** Size of zbuf. */
+    size_t zbuf_size;
+
+    /** Pipe buffers are spliced to file through, read end first, -1 if not
+     * open.
+     */
+    int pipe_fds[2];
+
+    /** File descriptor of query log file being written, or socket connected
+     * to remote collector, -1 if not open.
+     */
+    int fd;
+
+    /** File descriptor of query log file opened ahead for next rotation, -1
+     * if not open.
+     */
+    int next_fd;
+
+    /** Name of query log file opened ahead for next rotation. */
+    char next_filename[QUERY_LOG_FILENAME_MAX_LEN];
+
+    /** File descriptor of index file of query log file being written, -1 if
+     * not open.
+     */
+    int index_fd;
+
+    /** Offset in query log file being written next buffer is written at. */
+    uint64_t offset;
+
+    /** Number of buffers submitted, only query log thread writes it. Buffer
+     * being filled is bufs[head % QUERY_LOG_WRITER_BUF_COUNT].
+     */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong head;
+
+    /** Number of buffers written to disk, only writer thread writes it. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong tail;
+} query_log_writer_t;
+
+void                     query_log_writer_init(query_log_writer_t *w, config_t *cfg,
+                                               channel_log_t *app_log_channel,
+                                               metrics_t *metrics);
+void                     query_log_writer_clean(query_log_writer_t *w);
+query_log_writer_buf_t * query_log_writer_buf_get(query_log_writer_t *w);
+void                     query_log_writer_buf_submit(query_log_writer_t *w, bool flush);
+bool                     query_log_writer_buf_pending(query_log_writer_t *w);
+size_t                   query_log_writer_compress(query_log_writer_t *w,
+                                                   const char *data, size_t data_len);
+int                      query_log_writer_splice(query_log_writer_t *w, int fd,
+                                                 char *data, size_t data_len,
+                                                 char *err_msg, size_t err_msg_len);
+void *                   query_log_writer_loop(void *args);
+
+#endif /* End of QUERY_LOG_WRITER_H */
+
+/** @}*/
@@ -31,26 +31,96 @@
  *        Resources are loaded, and reloaded in a dedicated thread to avoid
  *        blocking and time consuming operations in DNS query processing
  *        threads. Once loaded into memory resources are treated as read only
- *        and shared amongst query processing threads. For data validity purpose
- *        each thread keeps a reference to the shared object. When a resource
- *        changes, processing thread is notified and updates the reference (pointer)
- *        to such a resource. This update is done once all pending queries have
- *        us been processed which ensures data validity (data does not change
- *        under in the middle of resolving a query).
+ *        and shared amongst query processing threads. When a resource
+ *        changes, resource thread publishes it with an atomic pointer store
+ *        into @ref resource_set_t. Processing threads read resource pointers
+ *        at start of each loop iteration, after all pending queries have been
+ *        processed, which ensures data validity (data does not change in the
+ *        middle of resolving a query).
  * 
- *        When all processing threads have updated their resource reference, the
- *        old resource data can safely be disposed of.
+ *        Old resource data is retired and disposed of once every processing
+ *        thread has passed a quiescent state, see @ref qsbr. Processing
+ *        threads never wait on resource thread, and are not notified of
+ *        changes.
  * 
  *  @{
  */
 #ifndef RESOURCE_H
 #define RESOURCE_H
 
+#include <stdint.h>
 #include <time.h>
 
 #include "channel.h"
 #include "config.h"
 #include "metrics.h"
+#include "qsbr.h"
+
+/** Enumerated resource IDs, index of resource in @ref resource_set_t. */
+typedef enum resource_id_e {
+    /** Zone database, resource 1. */
+    RESOURCE_ID_ZONE_DB = 0,
+
+    /** ECS map, resource 2. */
+    RESOURCE_ID_ECS_MAP,
+
+    /** Reloaded configuration, resource 3, see @ref config_reload(). */
+    RESOURCE_ID_CONFIG,
+
+    /** View set, resource 4, see @ref views. */
+    RESOURCE_ID_VIEWS,
+
+    /** Client ACL, resource 5, see @ref acl. */
+    RESOURCE_ID_ACL,
+
+    /** Response policy, resource 6, see @ref policy. */
+    RESOURCE_ID_POLICY,
+
+    /** GeoIP database, resource 7, see @ref geoip. */
+    RESOURCE_ID_GEOIP,
+
+    /** Load balancing candidate sets, resource 8, see @ref lb. */
+    RESOURCE_ID_LB,
+
+    /** Zone catalog, resource 9, see @ref zone_catalog. */
+    RESOURCE_ID_CATALOG
+} resource_id_t;
+
+/** Structure holds resources published to vectorloops. */
+typedef struct resource_set_s {
+    /** Current resource objects, indexed by resource ID. NULL if resource is
+     * not loaded. Only resource thread writes them.
+     */
+    _Atomic(void *) resources[RESOURCE_COUNT];
+
+    /** QSBR domain resources are retired in, vectorloops are its readers and
+     * reader ID is vectorloop ID.
+     */
+    qsbr_t qsbr;
+
+    /** Eventfd that wakes resource thread to check all resources for change
+     * right away, see @ref resource_set_reload().
+     */
+    int reload_fd;
+
+    /** Inotify instance resource files are watched for change with, wakes
+     * resource thread to check changed resource right away. -1 if inotify
+     * is not available, resources are then only polled for change.
+     */
+    int watch_fd;
+
+    /** Secondary zones, NULL if there are none. Set before threads are
+     * started, vectorloops hand NOTIFY to it and resource thread applies its
+     * updates to zone database.
+     */
+    struct zone_secondary_s *secondary;
+
+    /** Response cache shared by vectorloops, NULL if disabled. Set before
+     * threads are started, entries are tagged with generation of resources
+     * responses were resolved against.
+     */
+    struct response_cache_shared_s *response_cache;
+} resource_set_t;
 
 typedef struct resource_s resource_t;
 
@@ -70,6 +140,24 @@ typedef int (*resource_check_load_fn)(resource_t *resource,
                                       void **buf, size_t *buf_len,
                                       char *err, size_t err_len);
 
+/** Function definition for custom function used to compile raw resource file
+ * contents into the object vectorloops consume.
+ * 
+ * @param resource   Resource object this resource data is for.
+ * @param buf        Raw resource file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to compiled object.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ * 
+ * @returns On success returns pointer to compiled object, otherwise NULL is
+ *          returned and err is populated.
+ */
+typedef void * (*resource_compile_fn)(resource_t *resource,
+                                      const char *buf, size_t buf_len,
+                                      uint64_t generation,
+                                      char *err, size_t err_len);
+
 /** Function definition for custom function used to release resource data.
  * 
  * @param resource Resource object this resource data is for.
@@ -95,8 +183,8 @@ typedef struct resource_s {
      */
     size_t update_frequency;
 
-    /** Channel OP for this resource. */
-    channel_bss_ops_t channel_op;
+    /** ID of resource, index of resource in @ref resource_set_t. */
+    resource_id_t id;
 
     /** Create time for resource currently loaded into application. This
      * is compared to file on filesystem change time to detect if resource
@@ -114,14 +202,72 @@ typedef struct resource_s {
      */
     resource_check_load_fn check_load_fn;
 
+    /** Pointer to function that compiles loaded resource file, used by
+     * @ref resource_check_load_compiled().
+     */
+    resource_compile_fn compile_fn;
+
     /** Pointer to function that releases the resource. */
     resource_release_fn release_fn;
 
-    /** Pointer to current resource object. */
+    /** Full path on disk for resource delta file, changes applied on top of
+     * resource file. NULL or empty string if resource has no delta file.
+     */
+    char *delta_filepath;
+
+    /** Create time for resource delta file last loaded, zero if there is
+     * none.
+     */
+    struct timespec delta_create_time;
+
+    /** Resource object built from resource file that delta file is applied
+     * on top of, held for as long as resource file does not change.
+     */
+    void *base_resource;
+
+    /** Pointer to current (published) resource object. */
     void *current_resource;
 
-    /** Pointer to incoming (updated) resource. */
-    void *incoming_resource;
+    /** Pointer to resource object replaced by current one, released once all
+     * vectorloops passed a quiescent state. NULL if there is none.
+     */
+    void *retired_resource;
+
+    /** QSBR epoch retired resource can be released at. */
+    uint64_t retire_epoch;
+
+    /** Monotonic time in microseconds resource was retired at. */
+    uint64_t retire_time_us;
+
+    /** Generation number of resource data, incremented each time updated
+     * resource data is successfully loaded.
+     */
+    uint64_t generation;
+
+    /** Configuration application was started with. Configuration file
+     * resource compiles reloaded settings on top of it.
+     */
+    config_t *cfg;
+
+    /** Secondary zones whose updates are applied on top of zone file, NULL
+     * if there are none.
+     */
+    struct zone_secondary_s *secondary;
+
+    /** Helper threads zone database is built on along with resource thread,
+     * NULL if it is built on resource thread alone.
+     */
+    struct worker_pool_s *workers;
+
+    /** Inotify watch descriptor of directory holding resource file, -1 if
+     * resource file is not watched and is only polled for change.
+     */
+    int watch_wd;
+
+    /** Inotify watch descriptor of directory holding resource delta file, -1
+     * if resource has no delta file or it is not watched.
+     */
+    int delta_watch_wd;
 
 } resource_t;
 
@@ -133,8 +279,8 @@ typedef struct resource_loop_args_s {
     /** Configuration settings to use. */
     config_t *cfg;
 
-    /** Resource channels used to communicate with Vectorloop threads. */
-    channel_bss_t *resource_channels;
+    /** Resources published to Vectorloop threads. */
+    resource_set_t *resources;
 
     /** Application log channel. */
     channel_log_t *app_log_channel;
@@ -145,12 +291,56 @@ typedef struct resource_loop_args_s {
 
 
 void * resource_loop(void *args);
+void   resource_set_init(resource_set_t *set, size_t vl_count);
+void   resource_set_clean(resource_set_t *set);
+void   resource_set_reload(resource_set_t *set);
 
 
 void resource_release_raw_file(resource_t *resource, void *buf);
 int  resource_check_load_raw_file(resource_t *resource, void **buf, size_t *buf_len,
                                   char *err, size_t err_len);
 
+int  resource_check_load_compiled(resource_t *resource, void **buf, size_t *buf_len,
+                                  char *err, size_t err_len);
+
+void   resource_release_zone_db(resource_t *resource, void *buf);
+int    resource_check_load_zone_db(resource_t *resource, void **buf, size_t *buf_len,
+                                   char *err, size_t err_len);
+int    resource_zone_image_compile(const char *zone_filepath, const char *image_filepath,
+                                   char *err, size_t err_len);
+
+void   resource_release_ecs_map(resource_t *resource, void *buf);
+void * resource_compile_ecs_map(resource_t *resource, const char *buf, size_t buf_len,
+                                uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_config(resource_t *resource, void *buf);
+void * resource_compile_config(resource_t *resource, const char *buf, size_t buf_len,
+                               uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_views(resource_t *resource, void *buf);
+void * resource_compile_views(resource_t *resource, const char *buf, size_t buf_len,
+                              uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_acl(resource_t *resource, void *buf);
+void * resource_compile_acl(resource_t *resource, const char *buf, size_t buf_len,
+                            uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_policy(resource_t *resource, void *buf);
+void * resource_compile_policy(resource_t *resource, const char *buf, size_t buf_len,
+                               uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_geoip(resource_t *resource, void *buf);
+int    resource_check_load_geoip(resource_t *resource, void **buf, size_t *buf_len,
+                                 char *err, size_t err_len);
+
+void   resource_release_lb(resource_t *resource, void *buf);
+void * resource_compile_lb(resource_t *resource, const char *buf, size_t buf_len,
+                           uint64_t generation, char *err, size_t err_len);
+
+void   resource_release_catalog(resource_t *resource, void *buf);
+int    resource_check_load_catalog(resource_t *resource, void **buf, size_t *buf_len,
+                                   char *err, size_t err_len);
+
 #endif /* RESOURCE_H */
 
 /** @}*/
\ No newline at end of file
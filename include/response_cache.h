@@ -0,0 +1,276 @@
+/**
+ * @file response_cache.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup response_cache Response Cache
+ *
+ * @brief Response cache holds fully packed responses to recently resolved
+ *        queries. Each vectorloop owns its cache hence no locking is needed.
+ *
+ *        Cache is a direct mapped table, power of 2 in size, indexed by hash
+ *        of the lower cased question name, type, class, DNSSEC OK bit, and
+ *        EDNS UDP payload size. A new entry replaces whatever occupies its
+ *        slot. On a hit the cached response is copied into query response
+ *        buffer, and only the message ID, RD bit, and question (to preserve
+ *        case of the request) are rewritten. Resolve and pack are skipped.
+ *
+ *        Entries are tagged with zone database generation they were resolved
+ *        against. When vectorloop receives a new zone database the cache
+ *        generation is updated, which invalidates all entries without having
+ *        to walk the table.
+ *
+ *        Only responses that fit @ref RESPONSE_CACHE_RESPONSE_MAX bytes and are
+ *        not truncated are cached. Queries with EDNS client subnet option are
+ *        not cached as response echoes the option. Responses to queries with
+ *        EDNS cookie option are cached without it, cookie is appended to
+ *        response after it is packed or copied from cache.
+ *
+ *        Optional second level cache is shared by all vectorloops, so a
+ *        response packed by one vectorloop is found by others, for names too
+ *        rarely queried to stay in cache of each. It is set associative, with
+ *        @ref RESPONSE_CACHE_SHARED_WAYS entries per set, and each entry is
+ *        guarded by a sequence number (seqlock). Readers copy entry and check
+ *        its sequence number is even and unchanged, they never write shared
+ *        memory. Writer claims entry by making its sequence number odd, a
+ *        vectorloop that finds entry claimed by another skips filling it.
+ *
+ *        Draining vectorloop writes questions of its cached responses, most
+ *        hit first, to a snapshot file. Vectorloop of next process maps the
+ *        file and, once first zone database is published, resolves and packs
+ *        each question into its cache, so it does not start cold. Questions,
+ *        not packed responses, are kept, as records cached responses point
+ *        to belong to zone database of previous process.
+ *  @{
+ */
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "query.h"
+#include "rip_ns_utils.h"
+#include "rr_record.h"
+
+/** Structure describes a response cache entry. */
+typedef struct response_cache_entry_s {
+    /** Zone database generation entry was resolved against. 0 means entry is
+     * not used.
+     */
+    uint64_t generation;
+
+    /** Hash of entry key. */
+    uint32_t hash;
+
+    /** Question type. */
+    uint16_t q_type;
+
+    /** Question class. */
+    uint16_t q_class;
+
+    /** EDNS UDP payload size, 0 if request did not have EDNS. */
+    uint16_t edns_udp_size;
+
+    /** Set if DNSSEC OK bit was set in request. */
+    bool dnssec;
+
+    /** View response was resolved in, 0 for main zone database. */
+    uint16_t view;
+
+    /** Geo response was resolved for, see @ref query_t.geo. */
+    uint32_t geo;
+
+    /** Per zone metrics slot of response plus 1, 0 if zone is not counted. */
+    uint16_t zone_slot;
+
+    /** Length of question in response (name, type, and class). */
+    uint16_t question_len;
+
+    /** Query end code response was packed with. */
+    int end_code;
+
+    /** Set if response is authoritative. */
+    bool authoritative;
+
+    /** Number of answer section records in response. */
+    uint8_t answer_section_count;
+
+    /** Answer section records, kept so query log can log answers. Only first
+     * @ref RESPONSE_CACHE_ANSWER_MAX are kept.
+     */
+    rr_record_t *answer_section[RESPONSE_CACHE_ANSWER_MAX];
+
+    /** Offset of EDNS OPT RR in packed response, 0 if response has none. */
+    uint16_t edns_offset;
+
+    /** Length of packed response. */
+    uint16_t response_len;
+
+    /** Number of times response was copied from this entry. */
+    uint32_t hits;
+
+    /** Packed response, starting with DNS header (no TCP length prefix). */
+    uint8_t response[RESPONSE_CACHE_RESPONSE_MAX];
+} response_cache_entry_t;
+
+/** Structure describes a response cache. */
+typedef struct response_cache_s {
+    /** Cache entries, NULL if cache is disabled. */
+    response_cache_entry_t *entries;
+
+    /** Number of entries minus 1, used to map hash to entry. */
+    uint32_t mask;
+
+    /** Zone database generation current entries must match, combined with
+     * view set generation when there are views.
+     */
+    uint64_t generation;
+
+    /** Number of hits after which entry is hot again, 0 if entries are never
+     * hot. Query that makes entry hot is marked, see
+     * @ref query_t.response_hot, and its request is kept in hot_request.
+     */
+    uint32_t hot_hits;
+
+    /** Length of hot_request. */
+    uint16_t hot_request_len;
+
+    /** Request of last query that made an entry hot, as received, kept until
+     * next lookup as response is copied over it.
+     */
+    uint8_t hot_request[RESPONSE_CACHE_HOT_REQUEST_MAX];
+} response_cache_t;
+
+/** Structure describes an entry of shared response cache. */
+typedef struct response_cache_shared_entry_s {
+    /** Sequence number, odd while entry is being written, incremented at
+     * start and end of each write.
+     */
+    atomic_uint seq;
+
+    /** Cached response. */
+    response_cache_entry_t entry;
+} __attribute__((aligned(CACHE_LINE_SIZE))) response_cache_shared_entry_t;
+
+/** Structure describes a response cache shared by all vectorloops. */
+typedef struct response_cache_shared_s {
+    /** Cache entries, @ref RESPONSE_CACHE_SHARED_WAYS per set. */
+    response_cache_shared_entry_t *entries;
+
+    /** Number of sets minus 1, used to map hash to set. */
+    uint32_t mask;
+} response_cache_shared_t;
+
+/** Magic number at start of response cache snapshot file, "RPCS" in ASCII. */
+#define RESPONSE_CACHE_SNAPSHOT_MAGIC 0x52504353
+
+/** Version of response cache snapshot file layout. */
+#define RESPONSE_CACHE_SNAPSHOT_VERSION 1
+
+/** Structure describes header of response cache snapshot file. Header is
+ * followed by count entries, see @ref response_cache_snapshot_entry_t, in
+ * host byte order.
+ */
+typedef struct response_cache_snapshot_header_s {
+    /** Set to @ref RESPONSE_CACHE_SNAPSHOT_MAGIC. */
+    uint32_t magic;
+
+    /** Set to @ref RESPONSE_CACHE_SNAPSHOT_VERSION. */
+    uint16_t version;
+
+    /** Size of this header in bytes. */
+    uint16_t header_len;
+
+    /** Number of entries following header. */
+    uint32_t count;
+
+    /** Size of entry in bytes. */
+    uint32_t entry_len;
+} response_cache_snapshot_header_t;
+
+/** Structure describes question of a cached response in snapshot file. */
+typedef struct response_cache_snapshot_entry_s {
+    /** Number of times cached response was hit. */
+    uint32_t hits;
+
+    /** Question type. */
+    uint16_t q_type;
+
+    /** Question class. */
+    uint16_t q_class;
+
+    /** EDNS UDP payload size, 0 if request did not have EDNS. */
+    uint16_t edns_udp_size;
+
+    /** View response was resolved in, 0 for main zone database. */
+    uint16_t view;
+
+    /** Set if DNSSEC OK bit was set in request. */
+    uint8_t dnssec;
+
+    /** Length of question name. */
+    uint8_t qname_len;
+
+    /** Question name, in wire format, as first requested. */
+    uint8_t qname[RIP_NS_MAXCDNAME];
+} response_cache_snapshot_entry_t;
+
+/** Structure describes a response cache snapshot file mapped into memory. */
+typedef struct response_cache_snapshot_s {
+    /** Entries, most hit first, NULL if no snapshot is mapped. */
+    const response_cache_snapshot_entry_t *entries;
+
+    /** Number of entries. */
+    uint32_t count;
+
+    /** Mapped file. */
+    void *map;
+
+    /** Length of mapped file. */
+    size_t map_len;
+} response_cache_snapshot_t;
+
+void response_cache_init(response_cache_t *cache, size_t size);
+void response_cache_clean(response_cache_t *cache);
+void response_cache_generation_set(response_cache_t *cache, uint64_t generation);
+bool response_cache_get(response_cache_t *cache, query_t *q);
+void response_cache_prefetch(response_cache_t *cache, query_t *q);
+void response_cache_put(response_cache_t *cache, query_t *q);
+int  response_cache_snapshot_write(response_cache_t *cache, const char *filepath,
+                                   char *err, size_t err_len);
+int  response_cache_snapshot_open(response_cache_snapshot_t *snap, const char *filepath,
+                                  char *err, size_t err_len);
+void response_cache_snapshot_close(response_cache_snapshot_t *snap);
+bool response_cache_snapshot_query(const response_cache_snapshot_entry_t *entry, query_t *q);
+void response_cache_shared_init(response_cache_shared_t *shared, size_t size);
+void response_cache_shared_clean(response_cache_shared_t *shared);
+bool response_cache_shared_get(response_cache_shared_t *shared, response_cache_t *cache,
+                               query_t *q);
+void response_cache_shared_put(response_cache_shared_t *shared, response_cache_t *cache,
+                               query_t *q);
+
+#endif /* End of RESPONSE_CACHE_H */
+
+/** @}*/
@@ -50,6 +50,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 /** Define constants based on RFC 883, RFC 1034, RFC 1035 */
 #define RIP_NS_PACKETSZ     512     /**< default UDP packet size */
@@ -136,6 +137,12 @@ typedef enum rip_ns_rcode_e {
     rip_ns_r_rip_pack_rr_err = -5,
     rip_ns_r_rip_tcp_write_err = -6,   /**< TCP connection write error, query response not sent */
     rip_ns_r_rip_tcp_write_close = -7, /**< TCP connection closed for write, query response not sent */
+    rip_ns_r_rip_rrl_drop = -8,        /**< Response over response rate limit, query response not sent */
+    rip_ns_r_rip_deferred = -9,       /**< Query is deferred waiting for worker thread, query response not sent yet */
+    rip_ns_r_rip_xfr = -10,           /**< Zone transfer, response is sent by zone transfer stream of TCP connection */
+    rip_ns_r_rip_acl_drop = -11,      /**< Client dropped by client ACL, query is not parsed and response not sent */
+    rip_ns_r_rip_overload_drop = -12, /**< Query shed under overload, query is not resolved and response not sent */
+    rip_ns_r_rip_policy_drop = -13,   /**< Query name dropped by response policy, response not sent */
 } rip_ns_rcode_t;
 
 /** Currently defined type values for DNS resources and queries. */
@@ -244,7 +251,9 @@ typedef enum rip_ns_class_e {
 
 /** EDNS extension option codes */
 typedef enum rip_ns_ext_opt_code_e {
-    rip_ns_ext_opt_c_cs = 8,
+    rip_ns_ext_opt_c_cs        = 8,
+    rip_ns_ext_opt_c_cookie    = 10,
+    rip_ns_ext_opt_c_keepalive = 11,
 } rip_ns_ext_opt_code_t;
 
 /** Structure for DNS query header.  The order of the fields is machine- and
@@ -346,6 +355,134 @@ typedef struct rip_ns_header_s {
     (cp) += RIP_NS_INT32SZ; \
 } while (0)
 
+/** Number of slots in name compression table, power of two. */
+#define RIP_NS_COMP_SLOTS       128
+
+/** Maximum number of name suffixes recorded in name compression table, half of
+ * its slots so probe sequences stay short. Suffixes packed once table is full
+ * are not compressed against.
+ *
+ * This does not limit number of names in message, just number of name
+ * suffixes later names can be compressed against.
+ */
+#define RIP_NS_COMP_NAMES_MAX   (RIP_NS_COMP_SLOTS / 2)
+
+/** Name compression table slot, a name suffix already packed into message. */
+typedef struct rip_ns_comp_slot_s {
+    uint32_t hash;      /**< Hash of suffix, see @ref rip_ns_name_pack(). */
+    uint16_t offset;    /**< Offset of suffix from message start. */
+    uint16_t gen;       /**< Generation slot was set in, slot is empty unless
+                             it matches table generation. */
+} rip_ns_comp_slot_t;
+
+/** Name compression table, an open addressed (linear probing) hash table of
+ * name suffixes packed into a message, keyed by suffix hash. It replaces
+ * array of pointers to packed names glibc ns_name_pack() walks, so a suffix
+ * is looked up in constant time rather than by comparing it against every
+ * name packed so far.
+ *
+ * Table is emptied by @ref rip_ns_comp_reset() bumping generation, not by
+ * clearing slots.
+ */
+typedef struct rip_ns_comp_s {
+    const unsigned char *msg;    /**< Start of message names are packed into. */
+    uint16_t             gen;    /**< Current generation, never 0. */
+    uint16_t             count;  /**< Suffixes recorded in current generation. */
+    rip_ns_comp_slot_t   slots[RIP_NS_COMP_SLOTS];  /**< Table slots. */
+} rip_ns_comp_t;
+
+/** Initialize name compression table, it is empty.
+ *
+ * @param comp Compression table to initialize.
+ * @param msg  Start of message names are packed into.
+ */
+static inline void
+rip_ns_comp_init(rip_ns_comp_t *comp, const unsigned char *msg)
+{
+    memset(comp->slots, 0, sizeof(comp->slots));
+    comp->msg   = msg;
+    comp->gen   = 1;
+    comp->count = 0;
+}
+
+/** Empty name compression table, when a new message is packed. Slots are
+ * cleared only when generation wraps around.
+ *
+ * @param comp Compression table to empty.
+ */
+static inline void
+rip_ns_comp_reset(rip_ns_comp_t *comp)
+{
+    if (++comp->gen == 0) {
+        memset(comp->slots, 0, sizeof(comp->slots));
+        comp->gen = 1;
+    }
+    comp->count = 0;
+}
+
+/** Query type dispatch table flag, query type is supported. */
+#define RIP_NS_QTYPE_F_SUPPORTED 0x01
+
+/** Query type dispatch table flag, query type is a zone transfer. */
+#define RIP_NS_QTYPE_F_XFR 0x02
+
+/** Query type dispatch table flag, query type is ANY and is answered with a
+ * minimal response (RFC 8482).
+ */
+#define RIP_NS_QTYPE_F_ANY 0x04
+
+/** Number of entries in query type dispatch table. Every supported query
+ * type is below 256, types above have no entry and are unsupported.
+ */
+#define RIP_NS_QTYPE_TABLE_SIZE 256
+
+/** Query type index, used to count queries per question type in metrics. */
+typedef enum rip_ns_qtype_idx_e {
+    RIP_NS_QTYPE_IDX_UNSUPPORTED = 0,
+    RIP_NS_QTYPE_IDX_INVALID,
+    RIP_NS_QTYPE_IDX_A,
+    RIP_NS_QTYPE_IDX_AAAA,
+    RIP_NS_QTYPE_IDX_CNAME,
+    RIP_NS_QTYPE_IDX_MX,
+    RIP_NS_QTYPE_IDX_NS,
+    RIP_NS_QTYPE_IDX_PTR,
+    RIP_NS_QTYPE_IDX_SRV,
+    RIP_NS_QTYPE_IDX_SOA,
+    RIP_NS_QTYPE_IDX_TXT,
+    RIP_NS_QTYPE_IDX_ANY,
+    RIP_NS_QTYPE_IDX_AXFR,
+    RIP_NS_QTYPE_IDX_IXFR,
+
+    /** Number of query type indexes. */
+    RIP_NS_QTYPE_IDX_COUNT
+} rip_ns_qtype_idx_t;
+
+/** Structure describes query type dispatch table entry, what parse, resolve
+ * and metrics do with a query of type.
+ */
+typedef struct rip_ns_qtype_s {
+    /** Flags, RIP_NS_QTYPE_F_*. */
+    uint8_t flags;
+
+    /** Query type index, see @ref rip_ns_qtype_idx_t. */
+    uint8_t idx;
+} rip_ns_qtype_t;
+
+extern const rip_ns_qtype_t rip_ns_qtypes[RIP_NS_QTYPE_TABLE_SIZE];
+
+/** Lookup query type in query type dispatch table.
+ *
+ * @param type Query type.
+ *
+ * @return     Returns dispatch table entry of type.
+ */
+static inline rip_ns_qtype_t
+rip_ns_qtype_get(uint16_t type)
+{
+    return type < RIP_NS_QTYPE_TABLE_SIZE ? rip_ns_qtypes[type] :
+           (rip_ns_qtype_t){ 0, RIP_NS_QTYPE_IDX_UNSUPPORTED };
+}
+
 const char * rip_ns_class_to_str(rip_ns_class_t class);
 const char * rip_ns_rr_type_to_str(rip_ns_type_t type);
 
@@ -360,8 +497,10 @@ int rip_ns_name_unpack(const unsigned char *msg, const unsigned char *eom,
                        size_t dstsiz);
 
 int rip_ns_name_pack(const unsigned char *src, unsigned char *dst, int dstsiz,
-                     const unsigned char **dnptrs,
-                     const unsigned char **lastdnptr);
+                     rip_ns_comp_t *comp);
+
+uint16_t rip_ns_name_lc(unsigned char *name);
+uint64_t rip_ns_name_hash(const unsigned char *name, uint16_t name_len);
 
 int rip_ns_name_pton(const unsigned char *src, unsigned char *dst, size_t dstsiz);
 int rip_ns_name_ntop(const unsigned char *src, char *dst, size_t dstsiz);
@@ -371,8 +510,7 @@ int rip_rr_name_get(const unsigned char *msg, const unsigned char *eom,
                        size_t dstsiz, uint16_t *query_label_len);
 
 int rip_ns_name_put(const unsigned char *src, unsigned char *dst, int dstsiz,
-                     const unsigned char **dnptrs,
-                     const unsigned char **lastdnptr);
+                    rip_ns_comp_t *comp);
 
 #endif /* End of CONNS_UTILS_HN_H */
 
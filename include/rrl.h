@@ -0,0 +1,143 @@
+/**
+ * @file rrl.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup rrl Response Rate Limiting
+ *
+ * @brief Response rate limiting (RRL) limits rate of UDP responses sent to a
+ *        client network, so server can not be used to reflect and amplify a
+ *        flood of spoofed queries. Each vectorloop owns its table hence no
+ *        locking is needed.
+ *
+ *        Responses are accounted by client network (address masked to
+ *        configured IPv4 or IPv6 prefix length) and response class (answer,
+ *        no data, name error, error). Each account is a token bucket
+ *        implemented as generic cell rate algorithm, which only needs the
+ *        theoretical arrival time of next response to be stored. Bucket
+ *        refills at configured responses per second and holds up to one
+ *        second worth of responses.
+ *
+ *        Table is fixed in size and allocated once, so it keeps working
+ *        without allocations at attack level packets per second. It is made of
+ *        cache line sized buckets of @ref RRL_BUCKET_ENTRIES entries each,
+ *        and an account is looked up only in the bucket its key hashes to.
+ *        When account is not found it replaces the bucket entry which was
+ *        least recently over its limit, which is the entry with the oldest
+ *        theoretical arrival time.
+ *
+ *        Response over the limit is either dropped or, every slip-th time,
+ *        replaced by a truncated (TC=1) response, so legitimate clients whose
+ *        address is being spoofed can retry over TCP.
+ *  @{
+ */
+#ifndef RRL_H
+#define RRL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "query.h"
+
+/** Response class responses are accounted by. */
+typedef enum rrl_class_e {
+    rrl_class_answer   = 0, /**< NOERROR response with answers */
+    rrl_class_nodata   = 1, /**< NOERROR response without answers */
+    rrl_class_nxdomain = 2, /**< NXDOMAIN response */
+    rrl_class_error    = 3, /**< Any other rcode */
+} rrl_class_t;
+
+/** Action to take on a response. */
+typedef enum rrl_action_e {
+    rrl_action_send = 0, /**< Response is within limit, send it */
+    rrl_action_slip = 1, /**< Response is over limit, send truncated response */
+    rrl_action_drop = 2, /**< Response is over limit, do not send response */
+} rrl_action_t;
+
+/** Structure describes an RRL table entry. */
+typedef struct rrl_entry_s {
+    /** Entry key, client network, address family, and response class. 0 means
+     * entry is not used.
+     */
+    uint64_t key;
+
+    /** Theoretical arrival time of next response, in microseconds. */
+    uint64_t tat;
+} rrl_entry_t;
+
+/** Number of entries in RRL table bucket, bucket fills a cache line. */
+#define RRL_BUCKET_ENTRIES (CACHE_LINE_SIZE / sizeof(rrl_entry_t))
+
+/** Structure describes an RRL table bucket. */
+typedef struct rrl_bucket_s {
+    /** Bucket entries. */
+    _Alignas(CACHE_LINE_SIZE) rrl_entry_t entries[RRL_BUCKET_ENTRIES];
+} rrl_bucket_t;
+
+/** Structure describes an RRL table. */
+typedef struct rrl_s {
+    /** Table buckets, NULL if RRL is disabled. */
+    rrl_bucket_t *buckets;
+
+    /** Number of buckets minus 1, used to map hash to bucket. */
+    uint64_t mask;
+
+    /** Interval between responses allowed to an account, in microseconds. */
+    uint64_t interval;
+
+    /** Burst tolerance, how far ahead of now theoretical arrival time may be
+     * for response to still be allowed, in microseconds.
+     */
+    uint64_t burst;
+
+    /** IPv4 address mask, in network byte order. */
+    uint32_t ipv4_mask;
+
+    /** Number of IPv6 address bytes kept. */
+    uint8_t ipv6_bytes;
+
+    /** Mask applied to the last IPv6 address byte kept. */
+    uint8_t ipv6_last_mask;
+
+    /** Every slip-th response over the limit is slipped, rest are dropped. 0
+     * means all are dropped.
+     */
+    uint8_t slip;
+
+    /** Number of responses over the limit since last slip. */
+    uint8_t slip_count;
+} rrl_t;
+
+void         rrl_init(rrl_t *rrl, size_t size, unsigned int responses_per_second,
+                      unsigned int slip, unsigned int ipv4_prefix_len,
+                      unsigned int ipv6_prefix_len);
+void         rrl_clean(rrl_t *rrl);
+rrl_class_t  rrl_class(query_t *q);
+rrl_action_t rrl_check(rrl_t *rrl, struct sockaddr_storage *client_ip,
+                       rrl_class_t class, uint64_t now);
+void         rrl_slip(query_t *q);
+
+#endif /* End of RRL_H */
+
+/** @}*/
@@ -0,0 +1,175 @@
+/**
+ * @file sketch.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup sketch Streaming Sketches
+ *
+ * @brief Streaming sketches summarize a stream of keys in fixed memory with
+ *        constant work per key.
+ *
+ *        Top-K sketch is Space-Saving (Metwally, Agrawal and El Abbadi,
+ *        "Efficient Computation of Frequent and Top-k Elements in Data
+ *        Streams"). It counts up to capacity keys exactly. A key not counted
+ *        replaces the key with the smallest count and inherits that count,
+ *        which is kept as the key error. Count of a key is never
+ *        underestimated, and is overestimated by at most its error. Any key
+ *        seen more than stream length / capacity times is counted. Keys are
+ *        found through an open addressing index, and the smallest count is
+ *        the root of a min-heap, so an update is an index probe and a short
+ *        heap sift.
+ *
+ *        HyperLogLog sketch (Flajolet, Fusy, Gandouet and Meunier) estimates
+ *        the number of distinct keys with about 1.6% standard error. An update
+ *        is one register compare. Sketches merge by taking register maximums.
+ *
+ *        Sketches are not thread safe, each has one writer.
+ *  @{
+ */
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** HyperLogLog precision, sketch has 2^this one byte registers. */
+#define SKETCH_HLL_PRECISION 12
+
+/** Number of HyperLogLog registers. */
+#define SKETCH_HLL_REGISTERS (1 << SKETCH_HLL_PRECISION)
+
+/** Structure describes a key counted by top-K sketch. */
+typedef struct sketch_topk_entry_s {
+    /** Key. */
+    uint64_t key;
+
+    /** Estimated count of key, never less than true count. */
+    uint64_t count;
+
+    /** Maximum overestimation of count. */
+    uint64_t error;
+
+    /** Position of entry in heap. */
+    uint32_t heap_pos;
+
+    /** Length of data stored with key. */
+    uint16_t data_len;
+} sketch_topk_entry_t;
+
+/** Structure describes a Space-Saving top-K sketch. */
+typedef struct sketch_topk_s {
+    /** Maximum number of keys counted, power of two. */
+    uint32_t capacity;
+
+    /** Number of keys counted. */
+    uint32_t used;
+
+    /** Size of data stored with each key, 0 if none. */
+    uint32_t data_size;
+
+    /** Array of capacity entries. */
+    sketch_topk_entry_t *entries;
+
+    /** Min-heap of entry indices ordered by count, used entries long. */
+    uint32_t *heap;
+
+    /** Open addressing index of 2 * capacity slots, entry index + 1 or 0 if
+     * slot is empty.
+     */
+    uint32_t *index;
+
+    /** Array of capacity * data_size bytes, data stored with each key. */
+    uint8_t *data;
+} sketch_topk_t;
+
+/** Structure describes a HyperLogLog sketch. */
+typedef struct sketch_hll_s {
+    /** Registers, each is position of the first set bit in hash suffix,
+     * maximum seen over keys hashed to register.
+     */
+    uint8_t registers[SKETCH_HLL_REGISTERS];
+} sketch_hll_t;
+
+/** Mix a key (murmur3 64 bit finalizer), so keys that are not hashes, such
+ * as IP prefixes, can be used as hashes.
+ *
+ * @param key Key to mix.
+ *
+ * @return    Returns mixed key.
+ */
+static inline uint64_t
+sketch_mix(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/** Get data stored with a top-K sketch entry.
+ *
+ * @param t Sketch.
+ * @param i Entry index.
+ *
+ * @return  Returns pointer to data, entries[i].data_len bytes long.
+ */
+static inline const uint8_t *
+sketch_topk_data(const sketch_topk_t *t, uint32_t i)
+{
+    return t->data + (size_t)i * t->data_size;
+}
+
+/** Add a hashed key to HyperLogLog sketch. Top bits of hash select register,
+ * remaining bits give register value.
+ *
+ * @param h    Sketch.
+ * @param hash 64 bit hash of key.
+ */
+static inline void
+sketch_hll_add(sketch_hll_t *h, uint64_t hash)
+{
+    uint32_t reg  = (uint32_t)(hash >> (64 - SKETCH_HLL_PRECISION));
+    uint8_t  rank = (uint8_t)__builtin_clzll((hash << SKETCH_HLL_PRECISION) |
+                                             (1ULL << (SKETCH_HLL_PRECISION - 1))) + 1;
+
+    if (rank > h->registers[reg]) {
+        h->registers[reg] = rank;
+    }
+}
+
+void     sketch_topk_init(sketch_topk_t *t, uint32_t capacity, uint32_t data_size);
+void     sketch_topk_clean(sketch_topk_t *t);
+void     sketch_topk_reset(sketch_topk_t *t);
+void     sketch_topk_add(sketch_topk_t *t, uint64_t key, const void *data,
+                         uint16_t data_len, uint64_t weight);
+void     sketch_topk_merge(sketch_topk_t *dst, const sketch_topk_t *src);
+uint32_t sketch_topk_sorted(const sketch_topk_t *t, uint32_t *idx, uint32_t n);
+
+void   sketch_hll_reset(sketch_hll_t *h);
+void   sketch_hll_merge(sketch_hll_t *dst, const sketch_hll_t *src);
+double sketch_hll_estimate(const sketch_hll_t *h);
+
+#endif /* End of SKETCH_H */
+
+/** @}*/
@@ -0,0 +1,110 @@
+/**
+ * @file timer_wheel.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup timer_wheel Timer Wheel
+ *
+ * @brief Hierarchical timer wheel used to track TCP connection timeouts.
+ *
+ *        Timer nodes are embedded (intrusive) in objects they time, so arming
+ *        and disarming a timer does not allocate memory, and is O(1). Time
+ *        is measured in ticks of 1 millisecond.
+ *
+ *        Wheel has @ref TIMER_WHEEL_LEVELS levels of @ref TIMER_WHEEL_SLOTS
+ *        slots. Level 0 slots are 1 tick apart, each next level slot spans
+ *        all slots of level below it. A timer is placed into the lowest level
+ *        whose span covers time left until it expires. As wheel advances, each
+ *        time level 0 wraps around, slot of next level is cascaded (its
+ *        timers are placed into lower levels). Advancing the wheel costs a
+ *        slot check per tick plus the number of expired (or cascaded) timers,
+ *        and is independent of the number of armed timers.
+ *
+ *        Timers that expire further out than wheel span are placed into last
+ *        slot of top level, and are cascaded until they do expire.
+ *  @{
+ */
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of bits of time covered by one wheel level. */
+#define TIMER_WHEEL_SLOT_BITS 6
+
+/** Number of slots per wheel level. */
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+/** Number of wheel levels. With 64 slots per level 4 levels cover ~4.6 hours. */
+#define TIMER_WHEEL_LEVELS 4
+
+/** Macro returns pointer to structure a timer node is embedded in. */
+#define TIMER_WHEEL_ENTRY(node, type, member) \
+    ((type *)((char *)(node) - offsetof(type, member)))
+
+/** Structure describes a timer node, embedded in object being timed. */
+typedef struct timer_wheel_node_s {
+    /** @private Next node in slot, or in expired list. */
+    struct timer_wheel_node_s *next;
+
+    /** @private Pointer to pointer pointing to this node, NULL if timer is
+     * not armed.
+     */
+    struct timer_wheel_node_s **pprev;
+
+    /** Tick at which timer expires. */
+    uint64_t expires;
+} timer_wheel_node_t;
+
+/** Structure describes a timer wheel. */
+typedef struct timer_wheel_s {
+    /** Next tick to be processed. */
+    uint64_t current;
+
+    /** Wheel slots, each a list of timer nodes. */
+    timer_wheel_node_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
+/** Check if timer node is armed.
+ *
+ * @param node Timer node to check.
+ *
+ * @return     Returns true if timer is armed.
+ */
+static inline bool
+timer_wheel_node_armed(timer_wheel_node_t *node)
+{
+    return node->pprev != NULL;
+}
+
+void                 timer_wheel_init(timer_wheel_t *tw, uint64_t now);
+void                 timer_wheel_arm(timer_wheel_t *tw, timer_wheel_node_t *node,
+                                     uint64_t expires);
+void                 timer_wheel_disarm(timer_wheel_node_t *node);
+timer_wheel_node_t * timer_wheel_advance(timer_wheel_t *tw, uint64_t now);
+uint64_t             timer_wheel_next_expiry(timer_wheel_t *tw);
+
+#endif /* End of TIMER_WHEEL_H */
+
+/** @}*/
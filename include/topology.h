@@ -0,0 +1,100 @@
+/**
+ * @file topology.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup topology CPU topology
+ *
+ * @brief These are functions that discover CPU topology from sysfs, and
+ *        place vectorloop threads on it.
+ *
+ *        Each CPU's package (socket), physical core and NUMA node are read
+ *        from sysfs, as are the NUMA node of network interface and CPUs
+ *        its interrupts are delivered to (IRQ affinity). Vectorloops not
+ *        bound to a CPU by hand are then bound one per physical core, so
+ *        no two share a core through SMT siblings, preferring cores on
+ *        network interface NUMA node and CPUs that process its interrupts.
+ *        Support threads are kept off vectorloop cores by binding them to a
+ *        housekeeping set of CPUs.
+ *  @{
+ */
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/** Path sysfs is mounted on. */
+#define TOPOLOGY_SYSFS_PATH "/sys"
+
+/** Path procfs is mounted on, IRQ affinity is read from it. */
+#define TOPOLOGY_PROCFS_PATH "/proc"
+
+/** Topology of a single CPU (hardware thread). */
+typedef struct topology_cpu_s {
+    /** CPU is online, offline CPUs are never placed on. */
+    bool online;
+
+    /** CPU receives interrupts of network interface. */
+    bool nic_irq;
+
+    /** Physical package (socket) ID, -1 if unknown. */
+    int package;
+
+    /** Physical core ID within package, -1 if unknown. SMT siblings have
+     * same package and core ID.
+     */
+    int core;
+
+    /** NUMA node, -1 if unknown. */
+    int node;
+} topology_cpu_t;
+
+/** CPU topology of the machine. */
+typedef struct topology_s {
+    /** Number of CPUs in cpus array, indexed by CPU number. */
+    unsigned int cpus_count;
+
+    /** NUMA node of network interface, -1 if unknown or no interface. */
+    int nic_node;
+
+    /** Topology of each CPU. */
+    topology_cpu_t *cpus;
+} topology_t;
+
+int    topology_cpu_list_parse(const char *str, unsigned char *cpus,
+                               unsigned int cpus_count);
+int    topology_load(topology_t *topo, const char *sysfs_path,
+                     unsigned int cpus_count);
+int    topology_nic_load(topology_t *topo, const char *sysfs_path,
+                         const char *procfs_path, const char *ifname);
+size_t topology_vl_place(topology_t *topo, const unsigned char *housekeeping,
+                         size_t *masks, size_t masks_count);
+void   topology_release(topology_t *topo);
+int    topology_isolation_check(const char *sysfs_path, const size_t *masks,
+                                size_t masks_count, unsigned int cpus_count,
+                                FILE *out);
+
+#endif /* End of TOPOLOGY_H */
+
+/** @}*/
@@ -0,0 +1,170 @@
+/**
+ * @file upgrade.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup upgrade Zero downtime upgrade
+ *
+ * @brief These are functions that hand listener sockets of running process
+ *        over to a new process, e.g. one running an upgraded binary, so it
+ *        can be started and take over without queries being lost.
+ *
+ *        Running process listens on Unix socket set with "upgrade_socket".
+ *        New process started with the same setting connects to it and
+ *        receives listener sockets of each vectorloop (SCM_RIGHTS), which
+ *        its vectorloops with the same ID use instead of starting new ones.
+ *        Sockets, and datagrams and connections queued on them, are shared
+ *        by both processes. Once its listeners are registered and zone
+ *        database is loaded new process tells running process it is ready.
+ *        Running process then shuts down: its vectorloops stop reading from
+ *        listeners and drain, see @ref vldrain. New process takes over Unix
+ *        socket for next upgrade.
+ *
+ *        Established TCP connections are not handed over, they are drained
+ *        by running process. Listener sockets of vectorloops new process
+ *        does not have, with the same roles, are closed.
+ *  @{
+ */
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "channel.h"
+#include "config.h"
+
+/** Kinds of vectorloop listener sockets handed over. */
+typedef enum upgrade_fd_kind_e {
+    /** UDP IPv4 listener. */
+    UPGRADE_FD_UDP_IPV4 = 0,
+
+    /** UDP IPv6 listener. */
+    UPGRADE_FD_UDP_IPV6,
+
+    /** TCP IPv4 listener. */
+    UPGRADE_FD_TCP_IPV4,
+
+    /** TCP IPv6 listener. */
+    UPGRADE_FD_TCP_IPV6,
+
+    /** DNS over TLS IPv4 listener. */
+    UPGRADE_FD_DOT_IPV4,
+
+    /** DNS over TLS IPv6 listener. */
+    UPGRADE_FD_DOT_IPV6,
+
+    /** UDP dual stack listener, see configuration setting "udp_dual_stack". */
+    UPGRADE_FD_UDP_DUAL,
+
+    /** Number of listener kinds. */
+    UPGRADE_FD_KINDS
+} upgrade_fd_kind_t;
+
+/** Structure describes a listener socket in message handing listener sockets
+ * over, socket itself is passed in message ancillary data.
+ */
+typedef struct upgrade_msg_fd_s {
+    /** ID of vectorloop listener belongs to. */
+    uint32_t vl_id;
+
+    /** Kind of listener, see @ref upgrade_fd_kind_t. */
+    uint32_t kind;
+} upgrade_msg_fd_t;
+
+/** Structure of message handing listener sockets over. Listener sockets are
+ * sent in as many messages as needed, last one having flag last set.
+ */
+typedef struct upgrade_msg_s {
+    /** Message magic number, @ref UPGRADE_MSG_MAGIC. */
+    uint32_t magic;
+
+    /** Number of listener sockets in message. */
+    uint32_t count;
+
+    /** Set on last message. */
+    uint32_t last;
+
+    /** Listener sockets in message, in order of sockets in ancillary data. */
+    upgrade_msg_fd_t fds[UPGRADE_FDS_PER_MSG];
+} upgrade_msg_t;
+
+/** Upgrade state, shared by vectorloops and upgrade thread. */
+typedef struct upgrade_s {
+    /** Path of Unix socket upgrades are done over. */
+    const char *path;
+
+    /** Number of vectorloops. */
+    size_t vl_count;
+
+    /** Listener sockets received from process being upgraded, indexed by
+     * vectorloop ID * @ref UPGRADE_FD_KINDS + kind. -1 if none, or vectorloop
+     * took it.
+     */
+    int *inherited;
+
+    /** Number of listener sockets received from process being upgraded,
+     * including ones of vectorloops this process does not have.
+     */
+    size_t inherited_count;
+
+    /** Number of inherited listener sockets vectorloops took. */
+    atomic_size_t inherited_taken;
+
+    /** Listener sockets vectorloops registered, indexed same as inherited.
+     * -1 if none.
+     */
+    int *listeners;
+
+    /** Connection to process being upgraded, -1 if there was none running. */
+    int sock;
+
+    /** Number of vectorloops that registered their listeners. */
+    atomic_size_t ready;
+} upgrade_t;
+
+/** Structure holds arguments passed to @ref upgrade_loop function. */
+typedef struct upgrade_loop_args_s {
+    /** Configuration settings to use. */
+    config_t *cfg;
+
+    /** Upgrade state. */
+    upgrade_t *upgrade;
+
+    /** Application log channel. */
+    channel_log_t *app_log_channel;
+} upgrade_loop_args_t;
+
+void   upgrade_init(upgrade_t *u, config_t *cfg);
+void   upgrade_clean(upgrade_t *u);
+int    upgrade_connect(upgrade_t *u, char *err, size_t err_len);
+int    upgrade_fds_send(upgrade_t *u, int sock, char *err, size_t err_len);
+int    upgrade_fds_recv(upgrade_t *u, int sock, char *err, size_t err_len);
+int    upgrade_fd_take(upgrade_t *u, int vl_id, upgrade_fd_kind_t kind);
+void   upgrade_listener_set(upgrade_t *u, int vl_id, upgrade_fd_kind_t kind, int fd);
+void   upgrade_vl_ready(upgrade_t *u, int vl_id);
+void * upgrade_loop(void *args);
+
+#endif /* End of UPGRADE_H */
+
+/** @}*/
@@ -106,6 +106,102 @@
 /** Macro to decrement a variable by one. */
 #define DECREMENT(a) a -= 1
 
+/** Macro to hint CPU that caller is in a spin wait loop. */
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_PAUSE() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define CPU_PAUSE() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/** Read CPU cycle counter: time stamp counter on x86, virtual counter on
+ * ARM64. Elsewhere monotonic clock in nanoseconds is used. Counter does not
+ * serialize execution, it is cheap enough to read around each vectorloop
+ * stage. See @ref utl_cycles_per_sec for counter frequency.
+ *
+ * @return Returns current cycle count.
+ */
+static inline uint64_t
+utl_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t cycles;
+
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (cycles));
+    return cycles;
+#else
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000000000 + tp.tv_nsec;
+#endif
+}
+
+/** Structure describes a clock that derives wall clock time from CPU cycle
+ * counter. Clock is synced with system clock once, i.e. per vectorloop
+ * iteration with @ref utl_clock_sync, and in between @ref utl_clock_now
+ * extrapolates wall clock time from cycles elapsed since sync, which costs a
+ * cycle counter read and a multiplication instead of a clock_gettime() call.
+ * Only thread that owns clock may use it.
+ */
+typedef struct utl_clock_s {
+    /** Wall clock time at last sync, nanoseconds since epoch. */
+    uint64_t base_ns;
+
+    /** Cycle counter at last sync. */
+    uint64_t base_cycles;
+
+    /** Nanoseconds per cycle, 32.32 fixed point. */
+    uint64_t mult;
+
+    /** Coarse monotonic time at last sync, in milliseconds. */
+    uint64_t mono_ms;
+} utl_clock_t;
+
+/** Structure caches rfc3339nano date and time prefix of the last second
+ * formatted with @ref utl_time_fmt_rfc3339nano. Records logged in the same
+ * second only have their fractional part formatted. Only thread that owns
+ * cache may use it, initialize it with @ref utl_time_fmt_init.
+ */
+typedef struct utl_time_fmt_s {
+    /** Second prefix was formatted for, -1 if none. */
+    time_t sec;
+
+    /** Formatted "YYYY-MM-DDTHH:MM:SS." prefix, not NUL terminated. */
+    char   prefix[20];
+} utl_time_fmt_t;
+
+/** Structure describes an IP network, an address prefix. */
+typedef struct utl_net_s {
+    /** Address family, AF_INET or AF_INET6. */
+    uint8_t family;
+
+    /** Prefix length in bits. */
+    uint8_t prefix_len;
+
+    /** Network address, 4 (IPv4) or 16 (IPv6) bytes. */
+    uint8_t addr[16];
+} utl_net_t;
+
+/** Get current wall clock time from clock, extrapolated from cycle counter
+ * since last sync.
+ *
+ * @param clk Clock.
+ * @param ts  Where to store current time.
+ */
+static inline void
+utl_clock_now(utl_clock_t *clk, struct timespec *ts)
+{
+    uint64_t ns = clk->base_ns +
+        (uint64_t)(((unsigned __int128)(utl_cycles() - clk->base_cycles) * clk->mult) >> 32);
+
+    ts->tv_sec  = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
 
 int  utl_ip_port_from_ss(char *ip, size_t ip_len, uint16_t *port, struct sockaddr_storage *ss);
 
@@ -123,14 +219,35 @@ int str_to_bool(bool *dst, char *str);
 
 int parse_csv_to_ul_array(size_t *ul_array, size_t ul_array_len, char *str);
 
+int str_hex_to_bin(uint8_t *dst, size_t dst_len, char *str);
+
 int sockaddr_storage_to_string(char *buf, size_t buf_len, struct sockaddr_storage *ss);
 
 int utl_readall(int fd, size_t size, void **buf, char *err, size_t err_len);
 int utl_writeall(int fd, void *buf, size_t buf_len, char *err, size_t err_len);
 
 int utl_timespec_to_rfc3339nano(struct timespec *ts, char *buf);
-
-void utl_clock_gettime_rt_fatal(struct timespec *tp);
+void utl_time_fmt_init(utl_time_fmt_t *fmt);
+int  utl_time_fmt_rfc3339nano(utl_time_fmt_t *fmt, const struct timespec *ts, char *buf);
+
+size_t utl_u32_to_dec(uint32_t v, char *buf);
+size_t utl_ipv4_to_str(const void *addr, char *buf);
+size_t utl_ipv6_to_str(const void *addr, char *buf);
+
+void     utl_clock_gettime_rt_fatal(struct timespec *tp);
+uint64_t utl_clock_monotonic_ms_fatal(void);
+uint64_t utl_clock_monotonic_us_fatal(void);
+uint64_t utl_timespec_to_ns(struct timespec *ts);
+uint64_t utl_cycles_per_sec(void);
+void     utl_clock_init(utl_clock_t *clk);
+void     utl_clock_sync(utl_clock_t *clk, struct timespec *now);
+
+size_t utl_madvise_hugepages(void *ptr, size_t len);
+size_t utl_mem_prefault(void *ptr, size_t len, bool writable);
+
+int  utl_net_parse(utl_net_t *net, const char *str);
+void utl_sockaddr_unmap(struct sockaddr_storage *ss);
+bool utl_net_match(const utl_net_t *net, const struct sockaddr_storage *ss);
 
 #endif /* UTILS_H */
 
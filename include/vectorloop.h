@@ -34,6 +34,7 @@
 #ifndef VECTORLOOP_H
 #define VECTORLOOP_H
 
+#include <pthread.h>
 #include <stdint.h>
 #include <sys/epoll.h>
 #include <time.h>
@@ -43,12 +44,88 @@
 //EofDebug
 
 
+#include "acl.h"
+#include "geoip.h"
+#include "lb.h"
+#include "policy.h"
+#include "admin.h"
+#include "arena.h"
+#include "buf_pool.h"
 #include "channel.h"
 #include "constants.h"
 #include "conn.h"
+#include "conn_limit.h"
+#include "conn_pool.h"
+#include "conn_table.h"
+#include "dnssec.h"
+#include "dot.h"
+#include "ecs_map.h"
 #include "metrics.h"
 #include "query.h"
+#include "resource.h"
+#include "response_cache.h"
+#include "rrl.h"
+#include "upgrade.h"
+#include "vectorloop_drain.h"
+#include "vectorloop_handoff.h"
+#include "vectorloop_overload.h"
+#include "vectorloop_mirror.h"
+#include "vectorloop_slo.h"
+#include "vectorloop_replay.h"
+#include "vectorloop_reuseport.h"
+#include "vectorloop_uring.h"
+#include "vectorloop_xdp.h"
+#include "views.h"
+#include "worker.h"
+#include "zone.h"
+#include "zone_catalog.h"
+
+
+/** Structure holds a deferred UDP query, detached from listener batch. Query
+ * is copied out of listener vector, which is reused for next datagrams read,
+ * and its response is sent on its own once worker threads are done with jobs
+ * it waits for.
+ */
+typedef struct vl_pending_udp_s {
+    /** Query, with its own buffers. */
+    query_t q;
+
+    /** UDP listener query was received on, NULL if slot is free. */
+    conn_t *listener;
+
+    /** Length of client address in query client_ip. */
+    socklen_t client_ip_len;
+
+    /** Packet info control message query was received with, response is
+     * sent from address query was sent to.
+     */
+    unsigned char control[UDP_MSG_CONTROL_LEN];
 
+    /** Length of control message. */
+    size_t control_len;
+} vl_pending_udp_t;
+
+/** Structure holds samples of a vectorloop pipeline queue taken at stage ends
+ * of current iteration, see @ref metrics_vl_queue_t. Used only with
+ * "loop_stage_metrics".
+ */
+typedef struct vl_queue_sample_s {
+    /** Queue length at last stage end. */
+    uint32_t len;
+
+    /** Highest queue length sampled this iteration. */
+    uint32_t len_max;
+
+    /** Entries queued this iteration, sum of queue length increases over
+     * stages.
+     */
+    uint64_t queued;
+
+    /** Queue occupancy this iteration, queue length integrated over stage
+     * cycles.
+     */
+    uint64_t occupancy;
+} vl_queue_sample_t;
 
 /** Structure represents a VectorLoop. */
 typedef struct vectorloop_s
@@ -59,54 +136,373 @@ typedef struct vectorloop_s
     /** Vectorloop ID, should be unique per application thread. */
     uint16_t id;
 
-    /** Resource channel. */
-    channel_bss_t *resource_channel;
+    /** Resources published by resource thread, vectorloop is reader ID
+     * vectorloop ID in its QSBR domain.
+     */
+    resource_set_t *resources;
 
     /** Application log  channel. */
     channel_log_t *app_log_channel;
 
-    /** Application log  channel. */
-    channel_bss_t *query_log_channel;
-
     /** Metrics object where to report statistics. */
     metrics_t *metrics;
 
-    /** Loop timestamp, taken each iteration and used to check for timeouts
-     * in LRU cache.
+    /** Barrier vectorloop waits on once it has allocated its buffers, so
+     * thread that started it knows they are ready. NULL if none.
+     */
+    pthread_barrier_t *start_barrier;
+
+    /** This vectorloop's metrics within metrics object, updated without
+     * atomic read-modify-write operations as only this vectorloop writes them.
+     */
+    metrics_vl_t *metrics_vl;
+
+    /** This vectorloop's query sketches, NULL if queries are not sketched. */
+    metrics_sketch_vl_t *metrics_sketch;
+
+    /** This vectorloop's per zone query counters, NULL if zones are not
+     * counted.
+     */
+    metrics_zone_counters_t *metrics_zones;
+
+    /** This vectorloop's sampled query cost, NULL if query cost is not
+     * sampled.
+     */
+    metrics_cost_t *metrics_cost;
+
+    /** This vectorloop's per UDP listener address metrics, NULL if UDP
+     * listeners are not bound to addresses.
+     */
+    metrics_udp_addr_t *metrics_udp_addrs;
+
+    /** Zone database (resource 1) queries are resolved against. Read from
+     * resource set each loop iteration, NULL until first zone database is
+     * loaded.
+     */
+    zone_db_t *zone_db;
+
+    /** ECS map (resource 2) answers are tailored to client subnet with. Read
+     * from resource set each loop iteration, NULL if ECS map is not loaded.
+     */
+    ecs_map_t *ecs_map;
+
+    /** View set (resource 4) queries are answered from when their address
+     * selects a view. Read from resource set each loop iteration, NULL if
+     * there are no views.
+     */
+    views_t *views;
+
+    /** Client ACL (resource 5) queries are checked against before they are
+     * parsed. Read from resource set each loop iteration, NULL if there is
+     * no client ACL.
+     */
+    acl_t *acl;
+
+    /** Response policy (resource 6) query names are checked against before
+     * response cache and zone lookup. Read from resource set each loop
+     * iteration, NULL if there is no response policy.
+     */
+    policy_t *policy;
+
+    /** GeoIP database (resource 7) geo of queries is looked up in, see
+     * @ref vl_query_view(). Read from resource set each loop iteration, NULL
+     * if there is no GeoIP database.
+     */
+    geoip_t *geoip;
+
+    /** Cache of recent GeoIP lookup results, by /24 and /48 prefix. */
+    geoip_cache_t geoip_cache;
+
+    /** Load balancing candidate sets (resource 8) queries are answered from,
+     * see @ref lb. Read from resource set each loop iteration, NULL if there
+     * are none.
+     */
+    lb_t *lb;
+
+    /** Zone catalog (resource 9) queries for names in its zones are answered
+     * from, see @ref zone_catalog. Read from resource set each loop
+     * iteration, NULL if there is no zone catalog.
+     */
+    zone_catalog_t *catalog;
+
+    /** Cache of packed responses, invalidated when zone_db, views or catalog
+     * are updated.
+     */
+    response_cache_t response_cache;
+
+    /** Response cache shared by all vectorloops, looked up when
+     * response_cache misses, NULL if disabled.
+     */
+    response_cache_shared_t *response_cache_shared;
+
+    /** Response cache snapshot of previous process, resolved into
+     * response_cache once first zone database is published and then
+     * unmapped, see @ref response_cache_snapshot_query().
+     */
+    response_cache_snapshot_t response_cache_snapshot;
+
+    /** Response cache hashes of queries resolved in current batch, each
+     * tagged with batch number in upper 32 bits, see @ref vl_query_coalesce().
+     */
+    uint64_t coalesce[VL_COALESCE_SLOTS];
+
+    /** Number of current batch, slots of earlier batches do not match. */
+    uint32_t coalesce_batch;
+
+    /** Response rate limiting table, applied to UDP responses. */
+    rrl_t rrl;
+
+    /** Overload state, deciding how much work vectorloop sheds. Used only
+     * with "overload_iteration_max" configured.
+     */
+    vl_overload_t overload;
+
+    /** Latency SLO state, tracking latency quantiles against objectives.
+     * Used only with any of "slo_latency_p50", "slo_latency_p99" or
+     * "slo_latency_p999" configured.
+     */
+    vl_slo_t slo;
+
+    /** UDP query mirroring state, see @ref vlmirror. Its socket is -1
+     * unless "udp_mirror_ip" is configured.
      */
+    vl_mirror_t mirror;
+
+    /** Vectorloop clock, synced with system clock each iteration. Stage
+     * and response end timestamps are taken from it, see @ref utl_clock_t.
+     */
+    utl_clock_t clock;
+
+    /** Loop timestamp, taken each iteration. */
     struct timespec loop_timestamp;
 
-    /** epoll file descriptor for UDP connections. */
-    int ep_fd_udp;
+    /** Loop coarse monotonic time in milliseconds, taken each iteration and
+     * used to arm and advance TCP connection timers.
+     */
+    uint64_t loop_time_ms;
+
+    /** epoll file descriptor for UDP and TCP connections. */
+    int ep_fd;
 
-    /** epoll file descriptor for TCP connections. */
-    int ep_fd_tcp;
+    /** Eventfd registered with ep_fd, used by other threads to wake up
+     * vectorloop blocked in epoll_wait() when they have work for it.
+     */
+    int wake_fd;
+
+    /** Timeout in milliseconds for next epoll_wait(), set when vectorloop is
+     * idle and reset to 0 (non blocking) once waited on.
+     */
+    int ep_timeout_ms;
+
+    /** Vectorloop runs with real-time scheduling policy, see
+     * "process_thread_sched_policy".
+     */
+    bool rt_sched;
+
+    /** Loop time in milliseconds vectorloop last blocked (or slept) at, used
+     * with real-time scheduling to bound time it runs without letting other
+     * tasks of its CPU run.
+     */
+    uint64_t rt_block_ms;
 
     /** Number of active TCP connections this vectorloop has.
      * This count includes both IPv4 and IPv6.
      */
     uint64_t conns_tcp_active;
 
+    /** Maximum number of active TCP connections, "tcp_conns_per_vl_max"
+     * lowered to what fits in memory budget, see @ref vl_mem_budget_update().
+     */
+    uint64_t conns_tcp_max;
+
+    /** Bytes of memory a TCP connection with its buffer set takes, measured
+     * when connection pool is preloaded.
+     */
+    uint64_t conn_tcp_bytes;
+
+    /** Loop time in milliseconds conns_tcp_max was last updated at. */
+    uint64_t mem_budget_check_ms;
+
+    /** io_uring query responses are sent via, ring_fd is -1 if io_uring is
+     * not used.
+     */
+    vl_uring_t uring;
+
+    /** XDP program redirecting UDP DNS datagrams to AF_XDP sockets, NULL if
+     * AF_XDP is not used. Program is shared by all vectorloops.
+     */
+    vl_xdp_prog_t *xdp_prog;
+
+    /** AF_XDP socket UDP queries are received and sent on, fd is -1 if
+     * AF_XDP is not used.
+     */
+    vl_xdp_t xdp;
+
+    /** Generation vectorloop last published to in-kernel responder of XDP
+     * program, 0 if responder stands aside or is disabled, see @ref vlxdp.
+     */
+    uint64_t xdp_resp_generation;
+
+    /** Reuseport steering programs listeners join, NULL if steering is not
+     * used. Programs are shared by all vectorloops.
+     */
+    vl_reuseport_t *reuseport;
+
+    /** TLS context of DoT listeners, NULL if DoT is not used. */
+    dot_ctx_t *dot_ctx;
+
+    /** TCP connection handoff state, NULL if connections are not handed
+     * off. Shared by all vectorloops.
+     */
+    vl_handoff_t *handoff;
+
+    /** Vectorloop TCP connections are handed off to this period, -1 if
+     * none.
+     */
+    int handoff_target;
+
+    /** Number of connections left to hand off this period. */
+    unsigned int handoff_budget;
+
+    /** Load (queries per period) left to move to handoff_target this period,
+     * a connection is handed off only if its load does not exceed it.
+     */
+    uint64_t handoff_excess;
+
+    /** Loop time in milliseconds current handoff period started at. */
+    uint64_t handoff_start_ms;
+
+    /** Number of queries vectorloop processed when current handoff period
+     * started.
+     */
+    uint64_t handoff_queries;
+
+    /** Upgrade state, NULL if upgrades are disabled. Shared by all
+     * vectorloops.
+     */
+    upgrade_t *upgrade;
+
+    /** Drain state shared by all vectorloops. */
+    vl_drain_t *drain;
+
+    /** Indicates if vectorloop stopped reading from listeners, and closes
+     * its TCP connections as they become idle.
+     */
+    bool draining;
+
+    /** State snapshot vectorloop publishes each iteration for admin thread,
+     * NULL if "admin_socket" is not configured.
+     */
+    admin_vl_state_t *admin_state;
+
+    /** CPU cycle count admin state snapshot was last published at. */
+    uint64_t admin_cycles;
+
+    /** TLS handshake threads DoT connections are handed to. */
+    dot_pool_t dot_pool;
+
+    /** DNSSEC online signing key, NULL if answers are not signed online. */
+    dnssec_key_t *dnssec_key;
+
+    /** Worker threads jobs too slow to run in vectorloop are handed to,
+     * started only if a feature that defers queries is enabled.
+     */
+    worker_pool_t workers;
+
+    /** Cache of RRSIG records worker threads signed. */
+    dnssec_sig_cache_t dnssec_sig_cache;
+
+    /** Cache of NSEC3 hashes of names denial of existence proofs need. */
+    zone_nsec3_cache_t nsec3_cache;
+
+    /** Array of @ref VL_PENDING_UDP_MAX slots for deferred UDP queries,
+     * allocated only if worker threads are started.
+     */
+    vl_pending_udp_t *pending_udp;
+
+    /** Number of deferred UDP queries. */
+    size_t pending_udp_count;
+
+    /** TCP connections with deferred queries. */
+    conn_fifo_queue_t pending_tcp_queue;
+
     /** Array of epoll events submitted to epoll_wait(). */
     struct epoll_event *ep_events;
 
-    /** Pointer to UDP IPv4 listener connection. */
+    /** Number of elements in ep_events array. */
+    int ep_events_size;
+
+    /** Arena UDP listeners, with their vectors and queries, are allocated
+     * from.
+     */
+    arena_t arena;
+
+    /** Pointer to UDP IPv4 listener connection, NULL if IPv4 queries are
+     * received on dual stack IPv6 listener.
+     */
     conn_t *listener_udp_ipv4;
 
-    /** Pointer to UDP IPv6 listener connection. */
+    /** Pointer to UDP IPv6 listener connection, dual stack listener if
+     * configuration setting "udp_dual_stack" is set.
+     */
     conn_t *listener_udp_ipv6;
 
+    /** Array of UDP listeners bound to addresses of configuration setting
+     * "udp_listener_addresses", NULL if listeners are bound to any address.
+     * First listener of each IP family is listener_udp_ipv4 or
+     * listener_udp_ipv6, rest receive into its batches.
+     */
+    conn_t **listeners_udp_addr;
+
+    /** Number of elements in listeners_udp_addr array. */
+    size_t listeners_udp_addr_count;
+
+    /** UDP listeners bound to addresses waiting for a batch of their IP
+     * family to become free, queued on generic queue handle.
+     */
+    conn_fifo_queue_t conn_udp_batch_wait_queue;
+
+    /** Pointer to UDP AF_XDP listener connection. */
+    conn_t *listener_xdp;
+
+    /** Queries replayed by replay listener, NULL if vectorloop does not
+     * replay queries, see @ref vl_replay_run().
+     */
+    vl_replay_t *replay;
+
+    /** Pointer to UDP replay listener connection. */
+    conn_t *listener_replay;
+
     /** Pointer to TCP IPv4 listener connection. */
     conn_t *listener_tcp_ipv4;
 
     /** Pointer to TCP IPv6 listener connection. */
     conn_t *listener_tcp_ipv6;
 
-    /** TCP connection LRU cache. */
-    conn_t *conn_tcp_lru_cache;
+    /** Pointer to DoT IPv4 listener connection. */
+    conn_t *listener_dot_ipv4;
+
+    /** Pointer to DoT IPv6 listener connection. */
+    conn_t *listener_dot_ipv6;
+
+    /** Table of active TCP connections, assigns connection IDs. */
+    conn_table_t conn_tcp_table;
+
+    /** Pool of TCP connection objects, reused across TCP connections. */
+    conn_pool_t conn_tcp_pool;
+
+    /** Count of TCP connections per client network, limits connections a
+     * single client may hold.
+     */
+    conn_limit_t conn_tcp_limit;
+
+    /** Pool of TCP query response buffers, for responses that do not fit
+     * into response buffer query owns.
+     */
+    buf_pool_t tcp_response_pool;
 
-    /** TCP connection base ID. */
-    uint64_t conn_tcp_id_base;
+    /** Timer wheel TCP connection timeouts are tracked in. */
+    timer_wheel_t conn_tcp_timers;
 
     /** Read queue */
     conn_fifo_queue_t conn_udp_read_queue;
@@ -123,9 +519,20 @@ typedef struct vectorloop_s
     /** TCP connections write queue */
     conn_fifo_queue_t conn_tcp_write_queue;
 
+    /** TCP connections zone transfer queue, uses write queue link as a
+     * connection is never in both.
+     */
+    conn_fifo_queue_t conn_tcp_xfr_queue;
+
     /** TCP connections release queue */
     conn_fifo_queue_t conn_tcp_release_queue;
 
+    /** TCP connections idle queue, connections waiting for a query ordered
+     * by time they became idle. Head is evicted first once vectorloop holds
+     * maximum number of TCP connections.
+     */
+    conn_fifo_queue_t conn_tcp_idle_queue;
+
     /** Parse DNS queries queue */
     conn_fifo_queue_t query_parse_queue;
 
@@ -141,17 +548,56 @@ typedef struct vectorloop_s
     /** Query log object */
     query_log_t query_log;
 
+    /** Number of queries that passed query log filters since last sampled
+     * (logged) query, see configuration setting "query_log_sample_rate".
+     */
+    uint32_t query_log_sample_count;
+
+    /** Number of queries since last sampled (logged) query while query log
+     * ring is full, see configuration setting "query_log_full_policy".
+     */
+    uint32_t query_log_full_sample_count;
+
+    /** Set while query log ring is full and queries are sampled, see
+     * configuration setting "query_log_full_policy".
+     */
+    bool query_log_backlog;
+
+    /** Number of queries parsed since last query timed, see configuration
+     * setting "metrics_query_cost".
+     */
+    uint32_t cost_sample_count;
+
     /** Counter used to track when loop was idle (processed nothing) so the
      * loop could slow it self down and not burn CPU cycles needlessly.
      */
     uint32_t idle_count;
+
+    /** Monotonic time in microseconds when loop became idle, used to end
+     * idle spinning once "loop_idle_spin" time has elapsed.
+     */
+    uint64_t idle_start_us;
+
+    /** CPU cycles current iteration spent idle, in blocking epoll_wait(), see
+     * @ref metrics_vl_stage_t. Used only with "loop_stage_metrics".
+     */
+    uint64_t loop_idle_cycles;
+
+    /** Samples of pipeline queues this iteration, indexed by
+     * @ref metrics_vl_queue_t. Used only with "loop_stage_metrics".
+     */
+    vl_queue_sample_t queue_samples[METRICS_VL_QUEUES];
 } vectorloop_t;
 
-vectorloop_t * vl_new(config_t *cfg, int id, channel_bss_t *res_ch,
+vectorloop_t * vl_new(config_t *cfg, int id, resource_set_t *resources,
                       channel_log_t *app_log_channel,
-                      channel_bss_t *query_log_channel,
-                      metrics_t *metrics);
+                      metrics_t *metrics, vl_xdp_prog_t *xdp_prog,
+                      vl_reuseport_t *reuseport, dot_ctx_t *dot_ctx,
+                      dnssec_key_t *dnssec_key, vl_handoff_t *handoff,
+                      upgrade_t *upgrade, vl_drain_t *drain);
+unsigned int   vl_xdp_queue_id(config_t *cfg, int id);
 void         * vl_run(void *arg);
+void           vl_replay_run(vectorloop_t *vl, vl_replay_t *replay);
 
 #endif /* End of VECTORLOOP_H */
 
@@ -1,4 +1,5 @@
 /**
+ * @file vectorloop_bpf.h
  * @author Faruk Grozdanic
  * @copyright Released under MIT license.
  *
@@ -21,30 +22,41 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-/** \defgroup lrucache LRU Cache
+/** \defgroup vlbpf Vectorloop BPF
  *
- * @brief Least Recently Used (LRU) cache is implemented using UT HASH.
- *        Instead of implementing complex timer framework with callbacks, 
- *        LRU cache is used to check for various timeouts. LRU cache is walked
- *        backwards and entries checked if timeout occurred. For efficiency
- *        number of entries walked per vectorloop iteration is limited. Walk
- *        stops when either the limit is reached, or an entry encountered that
- *        has not timed out.
+ * @brief These are helpers for building and loading BPF programs and maps
+ *        via raw bpf() system calls, shared by AF_XDP and reuseport
+ *        steering programs.
  *  @{
  */
-#ifndef LRU_CACHE_H
-#define LRU_CACHE_H
+#ifndef VECTORLOOP_BPF_H
+#define VECTORLOOP_BPF_H
 
-#include <uthash/uthash.h>
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-/** Macro to add entry to TCP connection LRU cache. */
-#define LRU_CACHE_ADD(head, add) \
-    HASH_ADD(hh, head, cid, sizeof(uint64_t), add)
+/** Instruction of BPF program. */
+#define VL_BPF_INSN(c, d, s, o, i)                                       \
+    ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s),     \
+                        .off = (o), .imm = (i) })
 
-/** Macro to remove entry from TCP connection LRU cache. */
-#define LRU_CACHE_DEL(head, del) \
-    HASH_DELETE(hh, head, del)
+/** License BPF programs are loaded with, helpers used are GPL only. */
+#define VL_BPF_LICENSE "Dual MIT/GPL"
 
-#endif /* End of LRU_CACHE_H */
+/** Call bpf() system call.
+ *
+ * @param cmd  BPF command.
+ * @param attr Command attributes.
+ *
+ * @return     Returns result of system call, -1 on error with errno set.
+ */
+static inline int
+vl_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(union bpf_attr));
+}
+
+#endif /* End of VECTORLOOP_BPF_H */
 
 /** @}*/
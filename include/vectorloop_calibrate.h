@@ -0,0 +1,157 @@
+/**
+ * @file vectorloop_calibrate.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlcalibrate Vectorloop calibration
+ *
+ * @brief These are functions that tune vectorloop settings depending on
+ *        CPU, memory and kernel a server runs on, "udp_conn_vector_len",
+ *        "epoll_num_events_udp", "epoll_num_events_tcp" and
+ *        "loop_idle_spin", see configuration setting "loop_calibrate".
+ *
+ *        Synthetic UDP queries, for names of a small zone and names not in
+ *        it, from many clients, are replayed through a vectorloop of its own
+ *        (see @ref vl_replay_run) once per candidate vector length, powers
+ *        of two up to @ref VL_CALIBRATE_VECTOR_LEN_MAX. Throughput and 99th
+ *        percentile iteration time are measured for each, and the vector
+ *        length of highest throughput whose iteration time is within
+ *        "loop_calibrate_latency" is chosen. TCP events per epoll_wait() are
+ *        set to how many queries fit in rest of that time. A ready UDP
+ *        listener is a single event whatever number of datagrams it holds,
+ *        so UDP events are set to listeners vectorloop may have and its
+ *        wake up eventfd. Spin time is set to how long blocking in
+ *        epoll_wait() and being woken up through eventfd takes, spinning for
+ *        as long as blocking costs wastes at most as much as it saves.
+ *
+ *        Calibration vectorloop is kept, so calibration can run again on
+ *        demand with buffers already allocated.
+ *  @{
+ */
+#ifndef VECTORLOOP_CALIBRATE_H
+#define VECTORLOOP_CALIBRATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channel.h"
+#include "config.h"
+#include "metrics.h"
+#include "resource.h"
+#include "vectorloop.h"
+#include "vectorloop_drain.h"
+#include "vectorloop_replay.h"
+#include "zone.h"
+
+/** Largest vector length calibration tries. */
+#define VL_CALIBRATE_VECTOR_LEN_MAX 512
+
+/** Number of vector lengths calibration tries, powers of two from 1 to
+ * @ref VL_CALIBRATE_VECTOR_LEN_MAX.
+ */
+#define VL_CALIBRATE_VECTOR_LENS 10
+
+/** Structure describes settings calibration chose and measurements they
+ * were chosen from.
+ */
+typedef struct vl_calibrate_result_s {
+    /** Chosen "udp_conn_vector_len". */
+    size_t udp_conn_vector_len;
+
+    /** Chosen "epoll_num_events_udp". */
+    int epoll_num_events_udp;
+
+    /** Chosen "epoll_num_events_tcp". */
+    int epoll_num_events_tcp;
+
+    /** Chosen "loop_idle_spin", microseconds. */
+    size_t loop_idle_spin;
+
+    /** Queries per second measured for each vector length tried. */
+    uint64_t qps[VL_CALIBRATE_VECTOR_LENS];
+
+    /** 99th percentile iteration time in nanoseconds measured for each
+     * vector length tried.
+     */
+    uint64_t iteration_ns[VL_CALIBRATE_VECTOR_LENS];
+
+    /** Median time in nanoseconds from eventfd write to blocked
+     * epoll_wait() returning.
+     */
+    uint64_t wake_ns;
+} vl_calibrate_result_t;
+
+/** Structure describes calibration vectorloop and what it replays. */
+typedef struct vl_calibrate_s {
+    /** Configuration of each vector length tried, copies of configuration
+     * calibrated with vectorloop settings of its own. Vectorloop is
+     * switched between them as resource thread switches configuration on
+     * reload.
+     */
+    config_t cfgs[VL_CALIBRATE_VECTOR_LENS];
+
+    /** Role of calibration vectorloop, UDP over IPv4 and IPv6. */
+    uint8_t roles[1];
+
+    /** CPU mask of calibration vectorloop, not bound. */
+    size_t masks[1];
+
+    /** Iteration time in nanoseconds calibration keeps 99th percentile
+     * within.
+     */
+    uint64_t latency_ns;
+
+    /** Batch of TCP reads per iteration, 0 if not limited, see
+     * "loop_budget_tcp_reads".
+     */
+    size_t budget_tcp_reads;
+
+    /** Zone queries are resolved against. */
+    zone_db_t *db;
+
+    /** Queries replayed. */
+    vl_replay_t replay;
+
+    /** Metrics of calibration vectorloop. */
+    metrics_t *metrics;
+
+    /** Resources calibration vectorloop reads. */
+    resource_set_t *resources;
+
+    /** Application log channel of calibration vectorloop, not read. */
+    channel_log_t *app_log_channel;
+
+    /** Drain state of calibration vectorloop, never drained. */
+    vl_drain_t drain;
+
+    /** Calibration vectorloop. */
+    vectorloop_t *vl;
+} vl_calibrate_t;
+
+int  vl_calibrate_init(vl_calibrate_t *cal, const config_t *cfg, char *err, size_t err_len);
+void vl_calibrate_run(vl_calibrate_t *cal, vl_calibrate_result_t *result);
+void vl_calibrate_apply(const vl_calibrate_result_t *result, config_t *cfg);
+int  vl_calibrate_format(const vl_calibrate_result_t *result, char *buf, size_t buf_len);
+
+#endif /* End of VECTORLOOP_CALIBRATE_H */
+
+/** @}*/
@@ -0,0 +1,82 @@
+/**
+ * @file vectorloop_drain.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vldrain Vectorloop drain
+ *
+ * @brief These are functions that have vectorloops drain before application
+ *        exits, on termination signal or once listeners were handed over to
+ *        new process on upgrade (see @ref upgrade).
+ *
+ *        Draining vectorloop stops reading from its listeners, closes idle
+ *        TCP connections and finishes queries in progress. Once it has no
+ *        queries left and its query log is published to query log thread,
+ *        vectorloop reports it is drained and its thread exits.
+ *  @{
+ */
+#ifndef VECTORLOOP_DRAIN_H
+#define VECTORLOOP_DRAIN_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Drain state, shared by all vectorloops. */
+typedef struct vl_drain_s {
+    /** Number of vectorloops. */
+    size_t count;
+
+    /** Vectorloop eventfds, indexed by vectorloop ID, -1 until vectorloop
+     * registers.
+     */
+    int *wake_fds;
+
+    /** Set once vectorloops are to drain. */
+    atomic_bool draining;
+
+    /** Number of vectorloops drained. */
+    atomic_size_t drained;
+} vl_drain_t;
+
+void   vl_drain_init(vl_drain_t *d, size_t count);
+void   vl_drain_clean(vl_drain_t *d);
+void   vl_drain_register(vl_drain_t *d, int id, int wake_fd);
+void   vl_drain_start(vl_drain_t *d);
+void   vl_drain_done(vl_drain_t *d);
+size_t vl_drain_count(vl_drain_t *d);
+
+/** Check if vectorloops are to drain.
+ *
+ * @param d Drain state.
+ *
+ * @return  Returns true if drain was started.
+ */
+static inline bool
+vl_drain_started(vl_drain_t *d)
+{
+    return atomic_load_explicit(&d->draining, memory_order_relaxed);
+}
+
+#endif /* End of VECTORLOOP_DRAIN_H */
+
+/** @}*/
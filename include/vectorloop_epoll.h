@@ -36,8 +36,16 @@
 #include <stdint.h>
 #include <sys/epoll.h>
 
+/** Epoll event ID of vectorloop wake up eventfd. Connections are registered
+ * with either their address or connection ID, neither of which can be 0.
+ */
+#define VL_EPOLL_ID_WAKE 0
+
 int      vl_epoll_create(void);
-uint32_t vl_epoll_wait(int ep_fd, struct epoll_event *ep_events, int num_max_events);
+uint32_t vl_epoll_wait(int ep_fd, struct epoll_event *ep_events, int num_max_events,
+                       int timeout);
+int      vl_epoll_wake_create(int ep_fd);
+void     vl_epoll_wake_drain(int wake_fd);
 void     vl_epoll_ctl_reg_for_read_et(int ep_fd, int fd, uint64_t id);
 void     vl_epoll_ctl_reg_for_readwrite_et(int ep_fd, int fd, uint64_t id);
 void     vl_epoll_ctl_del(int ep_fd, int fd);
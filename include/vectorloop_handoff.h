@@ -0,0 +1,110 @@
+/**
+ * @file vectorloop_handoff.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlhandoff Vectorloop TCP connection handoff
+ *
+ * @brief These are functions that hand off TCP connections between
+ *        vectorloops, so few heavy TCP clients do not overload vectorloop
+ *        that accepted their connections while others are idle.
+ *
+ *        Each vectorloop periodically publishes its load, number of queries
+ *        it processed per @ref VL_HANDOFF_PERIOD_MS, and picks least loaded
+ *        vectorloop running TCP listeners as target. Vectorloop whose load
+ *        exceeds target load by "tcp_handoff_threshold" percent sends some
+ *        of its idle connections to target, over connection channel of
+ *        that pair of vectorloops, and wakes target up. Connection is sent as
+ *        its socket and state it carries (see @ref channel_conn_msg_t),
+ *        target adopts socket into a connection object of its own.
+ *  @{
+ */
+#ifndef VECTORLOOP_HANDOFF_H
+#define VECTORLOOP_HANDOFF_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+
+/** Structure holds state vectorloop publishes for TCP connection handoff. */
+typedef struct vl_handoff_vl_s {
+    /** Number of queries vectorloop processed in last period. */
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong load;
+
+    /** Loop time in milliseconds load was published at. Vectorloop blocked
+     * waiting for events does not publish, so its stale load is taken as 0.
+     */
+    atomic_ullong load_time_ms;
+
+    /** Number of TCP connections vectorloop has. */
+    atomic_ullong conns;
+
+    /** Set when connections were sent to vectorloop, cleared by vectorloop
+     * before it receives them.
+     */
+    atomic_bool pending;
+
+    /** Eventfd to wake vectorloop up with once connections are sent to it,
+     * -1 until vectorloop registers.
+     */
+    int wake_fd;
+
+    /** Indicates if vectorloop runs TCP listeners, connections are only
+     * handed off to such vectorloops.
+     */
+    bool tcp;
+} vl_handoff_vl_t;
+
+/** TCP connection handoff state, shared by all vectorloops. */
+typedef struct vl_handoff_s {
+    /** Number of vectorloops. */
+    size_t count;
+
+    /** Published state of each vectorloop, indexed by vectorloop ID. */
+    vl_handoff_vl_t *vls;
+
+    /** Connection channels, one for each pair of vectorloops, channel from
+     * vectorloop src to vectorloop dst is at index src * count + dst.
+     */
+    channel_conn_t *channels;
+} vl_handoff_t;
+
+void   vl_handoff_init(vl_handoff_t *h, config_t *cfg);
+void   vl_handoff_clean(vl_handoff_t *h);
+void   vl_handoff_register(vl_handoff_t *h, int id, int wake_fd);
+void   vl_handoff_publish(vl_handoff_t *h, int id, uint64_t load, uint64_t conns,
+                          uint64_t now_ms);
+int    vl_handoff_target(vl_handoff_t *h, int id, uint64_t conns_max, uint64_t now_ms,
+                         uint64_t *target_load);
+bool   vl_handoff_send(vl_handoff_t *h, int src, int dst, const channel_conn_msg_t *msg);
+void   vl_handoff_wake(vl_handoff_t *h, int dst);
+size_t vl_handoff_recv(vl_handoff_t *h, int dst, channel_conn_msg_t *msgs,
+                       size_t msgs_len);
+
+#endif /* End of VECTORLOOP_HANDOFF_H */
+
+/** @}*/
@@ -0,0 +1,126 @@
+/**
+ * @file vectorloop_mirror.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlmirror Vectorloop UDP query mirroring
+ *
+ * @brief These are functions that mirror received UDP queries to a shadow
+ *        server, e.g. a new build being validated against production
+ *        traffic, without affecting clients.
+ *
+ *        Each vectorloop has a UDP socket of its own connected to shadow
+ *        server address. As queries are read in their datagrams are
+ *        appended, sampled one in "udp_mirror_sample_rate", to a send
+ *        vector whose I/O vectors point straight at request buffers, so
+ *        nothing is copied. Send vector is sent with a single sendmmsg()
+ *        call once vectorloop is done reading, before queries are parsed,
+ *        so mirroring costs one batched system call per iteration.
+ *
+ *        Mirroring never waits. Datagrams socket can not take right away
+ *        are dropped and counted, and responses of shadow server are never
+ *        read, socket has smallest receive buffer kernel allows.
+ *  @{
+ */
+#ifndef VECTORLOOP_MIRROR_H
+#define VECTORLOOP_MIRROR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/** Number of datagrams mirror send vector holds, sendmmsg() sends at most
+ * UIO_MAXIOV messages per call. Vector that fills up is sent right away.
+ */
+#define VL_MIRROR_VECTOR_LEN 1024
+
+/** Structure holds UDP query mirroring state of a vectorloop. Only
+ * vectorloop that owns it uses it.
+ */
+typedef struct vl_mirror_s {
+    /** UDP socket connected to shadow server, -1 if queries are not
+     * mirrored.
+     */
+    int fd;
+
+    /** Send vector, @ref VL_MIRROR_VECTOR_LEN messages. */
+    struct mmsghdr *msgs;
+
+    /** I/O vectors of send vector messages, one per message pointing at
+     * request buffer of mirrored query.
+     */
+    struct iovec *iovs;
+
+    /** Number of messages in send vector. */
+    unsigned int count;
+
+    /** Mirror one in this many received datagrams. */
+    uint32_t sample_rate;
+
+    /** Datagrams received since last mirrored one. */
+    uint32_t sample_count;
+
+    /** Number of datagrams handed to kernel since vectorloop last added it
+     * to its metrics.
+     */
+    uint64_t sent;
+
+    /** Number of datagrams dropped because socket could not take them,
+     * since vectorloop last added it to its metrics.
+     */
+    uint64_t dropped;
+} vl_mirror_t;
+
+int  vl_mirror_init(vl_mirror_t *m, const char *ip, uint16_t port, uint32_t sample_rate,
+                    char *err, size_t err_len);
+void vl_mirror_clean(vl_mirror_t *m);
+int  vl_mirror_flush(vl_mirror_t *m);
+
+/** Append received datagrams to mirror send vector, sampled one in
+ * sample_rate. Send vector that fills up is sent right away.
+ *
+ * @param m     Mirror state, MUST be initialized.
+ * @param msgs  Receive vector entries datagrams were read into, as
+ *              recvmmsg() fills them.
+ * @param count Number of entries.
+ */
+static inline void
+vl_mirror_add(vl_mirror_t *m, const struct mmsghdr *msgs, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        if (m->sample_rate > 1 && ++m->sample_count < m->sample_rate) {
+            continue;
+        }
+        m->sample_count = 0;
+        if (m->count == VL_MIRROR_VECTOR_LEN) {
+            vl_mirror_flush(m);
+        }
+        m->iovs[m->count].iov_base = msgs[i].msg_hdr.msg_iov[0].iov_base;
+        m->iovs[m->count].iov_len  = msgs[i].msg_len;
+        m->count++;
+    }
+}
+
+#endif /* End of VECTORLOOP_MIRROR_H */
+
+/** @}*/
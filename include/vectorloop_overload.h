@@ -0,0 +1,168 @@
+/**
+ * @file vectorloop_overload.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vloverload Vectorloop overload control
+ *
+ * @brief These are functions that detect vectorloop overload and decide how
+ *        much work vectorloop sheds, so that a vectorloop that falls behind
+ *        does not take every query through full parse, resolve, pack and log
+ *        path while its latency grows without bound.
+ *
+ *        Vectorloop feeds overload signals as it runs: time of each busy
+ *        loop iteration, UDP listener reads that came back full (datagrams
+ *        are left queued in socket) and datagrams kernel dropped because
+ *        listener receive buffer was full. Every @ref VL_OVERLOAD_PERIOD_MS
+ *        signals are evaluated, vectorloop is overloaded in period if kernel
+ *        dropped datagrams, mean busy iteration took longer than
+ *        "overload_iteration_max" or most reads came back full.
+ *
+ *        Overloaded period raises overload level by one, and level is
+ *        lowered by one after @ref VL_OVERLOAD_CALM_PERIODS periods in a row
+ *        that were not overloaded. Each level sheds work of levels below it
+ *        as well, in order of cost to clients:
+ *        - @ref VL_OVERLOAD_SHED_LOG, queries are not logged.
+ *        - @ref VL_OVERLOAD_SHED_QTYPES, UDP queries of types zone database
+ *          does not hold, and ANY queries, are dropped once parsed.
+ *        - @ref VL_OVERLOAD_SHED_CLIENTS, UDP queries of clients not
+ *          allowlisted by client ACL, nor with a valid server cookie, are
+ *          dropped once parsed, every "overload_slip"-th is answered with a
+ *          truncated response instead so clients can retry over TCP.
+ *  @{
+ */
+#ifndef VECTORLOOP_OVERLOAD_H
+#define VECTORLOOP_OVERLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+
+/** Enumerated overload levels. */
+typedef enum vl_overload_level_e {
+    /** Vectorloop is not overloaded, nothing is shed. */
+    VL_OVERLOAD_NONE = 0,
+
+    /** Query logging is skipped. */
+    VL_OVERLOAD_SHED_LOG,
+
+    /** UDP queries of junk types are dropped at parse. */
+    VL_OVERLOAD_SHED_QTYPES,
+
+    /** UDP queries of clients not allowlisted are dropped, or slipped, at
+     * parse.
+     */
+    VL_OVERLOAD_SHED_CLIENTS,
+
+    /** Number of overload levels. */
+    VL_OVERLOAD_LEVELS
+} vl_overload_level_t;
+
+/** Structure holds overload state of a vectorloop. Only vectorloop that
+ * owns it uses it.
+ */
+typedef struct vl_overload_s {
+    /** Current overload level. */
+    vl_overload_level_t level;
+
+    /** Mean busy iteration time in nanoseconds above which vectorloop is
+     * overloaded, see "overload_iteration_max".
+     */
+    uint64_t iteration_ns_max;
+
+    /** Loop time in milliseconds current period started at. */
+    uint64_t period_start_ms;
+
+    /** Number of busy iterations in current period. */
+    uint64_t iterations;
+
+    /** Nanoseconds busy iterations of current period took. */
+    uint64_t iterations_ns;
+
+    /** Number of UDP listener reads in current period. */
+    uint32_t reads;
+
+    /** Number of UDP listener reads in current period that came back full,
+     * see @ref vl_overload_read().
+     */
+    uint32_t reads_full;
+
+    /** Number of datagrams kernel dropped in current period. */
+    uint32_t drops;
+
+    /** Number of periods in a row vectorloop was not overloaded. */
+    uint32_t calm_periods;
+
+    /** Every slip-th query shed by client is slipped, 0 to drop all. */
+    uint32_t slip;
+
+    /** Number of queries shed by client since last slipped one. */
+    uint32_t slip_count;
+} vl_overload_t;
+
+void vl_overload_init(vl_overload_t *o, uint64_t iteration_us_max,
+                      uint32_t slip, uint64_t now_ms);
+bool vl_overload_update(vl_overload_t *o, uint64_t now_ms);
+bool vl_overload_slip(vl_overload_t *o);
+
+/** Record time of a loop iteration that processed something.
+ *
+ * @param o  Overload state.
+ * @param ns Iteration time in nanoseconds, idle time excluded.
+ */
+static inline void
+vl_overload_iteration(vl_overload_t *o, uint64_t ns)
+{
+    o->iterations++;
+    o->iterations_ns += ns;
+}
+
+/** Record an UDP listener read. Read is full if it filled vector of largest
+ * length listener reads with (or length left of read budget), as datagrams
+ * are likely left queued in socket, or if listener had no free batch to read
+ * into.
+ *
+ * @param o    Overload state.
+ * @param full Whether read came back full.
+ */
+static inline void
+vl_overload_read(vl_overload_t *o, bool full)
+{
+    o->reads++;
+    o->reads_full += full;
+}
+
+/** Record datagrams kernel dropped on an UDP listener.
+ *
+ * @param o     Overload state.
+ * @param drops Number of datagrams dropped.
+ */
+static inline void
+vl_overload_drops(vl_overload_t *o, uint32_t drops)
+{
+    o->drops += drops;
+}
+
+#endif /* End of VECTORLOOP_OVERLOAD_H */
+
+/** @}*/
@@ -0,0 +1,124 @@
+/**
+ * @file vectorloop_replay.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlreplay Vectorloop replay
+ *
+ * @brief These are functions that replay UDP DNS queries recorded in a pcap
+ *        file through vectorloop, for benchmarking its stages without kernel
+ *        network stack involved.
+ *
+ *        Frames of a pcap file are loaded into memory once. A replay listener
+ *        reads them into UDP connection read vector entries, in same form
+ *        recvmmsg() fills them in (see @ref vl_xdp_frame_parse), so queries
+ *        go through same parse, resolve, pack and log stages as received
+ *        ones. Responses in write vector are counted instead of sent. Frames
+ *        are replayed in a loop, until requested number of queries was read.
+ *        Queries can also be built in memory, see @ref vl_replay_query_add.
+ *        See @ref vl_replay_run.
+ *  @{
+ */
+#ifndef VECTORLOOP_REPLAY_H
+#define VECTORLOOP_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "conn.h"
+
+/** Bytes of each captured response kept, see @ref vl_replay_capture(). */
+#define VL_REPLAY_CAPTURE_LEN 512
+
+/** Frame of a replayed pcap file. */
+typedef struct vl_replay_frame_s {
+    /** Offset of Ethernet frame in frames buffer. */
+    uint32_t offset;
+
+    /** Length of Ethernet frame. */
+    uint32_t len;
+} vl_replay_frame_t;
+
+/** Structure describes queries replayed, and responses to them. */
+typedef struct vl_replay_s {
+    /** Frames buffer, frames of pcap file rewritten as Ethernet frames. */
+    unsigned char *buf;
+
+    /** Length of frames buffer. */
+    size_t buf_len;
+
+    /** Frames, only UDP datagrams to port are kept. */
+    vl_replay_frame_t *frames;
+
+    /** Number of frames. */
+    size_t frame_count;
+
+    /** Number of frames replay has room for, when queries are added with
+     * @ref vl_replay_query_add().
+     */
+    size_t frames_max;
+
+    /** UDP destination port of replayed queries. */
+    uint16_t port;
+
+    /** Index of next frame to replay. */
+    size_t next;
+
+    /** Number of queries to replay. */
+    uint64_t queries_max;
+
+    /** Number of queries replayed so far. */
+    uint64_t queries;
+
+    /** Number of responses captured from write vectors. */
+    uint64_t responses;
+
+    /** Number of response bytes captured from write vectors. */
+    uint64_t response_bytes;
+
+    /** Responses kept, each in a slot of VL_REPLAY_CAPTURE_LEN bytes and
+     * truncated to it, NULL if responses are only counted, see
+     * @ref vl_replay_capture().
+     */
+    unsigned char *capture;
+
+    /** Number of response slots in capture buffer. */
+    size_t capture_max;
+
+    /** Number of responses kept in capture buffer. */
+    size_t captured;
+} vl_replay_t;
+
+int  vl_replay_load(vl_replay_t *replay, const char *filepath, uint16_t port,
+                    char *err_buf, size_t err_buf_len);
+void vl_replay_init(vl_replay_t *replay, uint16_t port, size_t frames_max);
+int  vl_replay_query_add(vl_replay_t *replay, uint32_t client, const char *name,
+                         uint16_t type);
+void vl_replay_capture(vl_replay_t *replay, size_t responses_max);
+void vl_replay_clean(vl_replay_t *replay);
+void vl_replay_reset(vl_replay_t *replay, uint64_t queries_max);
+int  vl_replay_recv(vl_replay_t *replay, conn_udp_t *conn_udp, unsigned int vlen);
+int  vl_replay_send(vl_replay_t *replay, conn_udp_t *conn_udp);
+
+#endif /* End of VECTORLOOP_REPLAY_H */
+
+/** @}*/
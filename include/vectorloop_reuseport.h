@@ -0,0 +1,109 @@
+/**
+ * @file vectorloop_reuseport.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlreuseport Vectorloop reuseport steering
+ *
+ * @brief These are functions that steer queries to vectorloop listener
+ *        sockets by CPU that received them.
+ *
+ *        All vectorloops bind their listeners to same port with
+ *        SO_REUSEPORT, and by default kernel picks socket of a reuseport
+ *        group by hash of packet addresses, regardless of which CPU handled
+ *        the receive interrupt. With steering enabled, a BPF program is
+ *        attached to each reuseport group which selects socket of the
+ *        vectorloop bound to the CPU packet is being processed on, from a
+ *        socket array map indexed by CPU. Packets processed on CPUs no
+ *        vectorloop is bound to fall back to default hash.
+ *        Alternatively steering is by client: program hashes client
+ *        address prefix (of RRL prefix length) to a slot in socket array
+ *        map, each vectorloop running group listeners has a slot, so all
+ *        queries of a client prefix are read by same vectorloop and its
+ *        RRL buckets and sketches see whole clients.
+ *  @{
+ */
+#ifndef VECTORLOOP_REUSEPORT_H
+#define VECTORLOOP_REUSEPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "config.h"
+
+/** Path of file with per CPU softirq counters, used to find CPUs that
+ * process network receive interrupts.
+ */
+#define VL_REUSEPORT_SOFTIRQS_PATH "/proc/softirqs"
+
+/** Listener reuseport groups, each has its own socket map and program. */
+typedef enum vl_reuseport_group_e {
+    VL_REUSEPORT_UDP_IPV4 = 0,
+    VL_REUSEPORT_UDP_IPV6,
+    VL_REUSEPORT_TCP_IPV4,
+    VL_REUSEPORT_TCP_IPV6,
+    VL_REUSEPORT_GROUPS
+} vl_reuseport_group_t;
+
+/** Reuseport steering programs and socket maps, shared by all vectorloops. */
+typedef struct vl_reuseport_s {
+    /** Set if steering is by client address prefix, otherwise it is by
+     * CPU.
+     */
+    bool client;
+
+    /** Client prefix length of IPv4 and IPv6 groups, when steering by
+     * client.
+     */
+    unsigned int prefix_len[2];
+
+    /** Number of entries in socket map of each reuseport group, number of
+     * CPUs, or number of vectorloops running group listeners when steering
+     * by client.
+     */
+    unsigned int entries[VL_REUSEPORT_GROUPS];
+
+    /** Socket map of each reuseport group, indexed by CPU. */
+    int map_fd[VL_REUSEPORT_GROUPS];
+
+    /** Steering program of each reuseport group. */
+    int prog_fd[VL_REUSEPORT_GROUPS];
+} vl_reuseport_t;
+
+int  vl_reuseport_load(vl_reuseport_t *rp, unsigned int cpus, char *err_buf,
+                       size_t err_buf_len);
+int  vl_reuseport_load_client(vl_reuseport_t *rp, config_t *cfg,
+                              unsigned int ipv4_prefix_len, unsigned int ipv6_prefix_len,
+                              char *err_buf, size_t err_buf_len);
+unsigned int vl_reuseport_client_slot(config_t *cfg, vl_reuseport_group_t group, size_t id);
+void vl_reuseport_clean(vl_reuseport_t *rp);
+int  vl_reuseport_join(vl_reuseport_t *rp, vl_reuseport_group_t group, int fd,
+                       unsigned int index);
+int  vl_reuseport_rx_cpus(const char *path, unsigned char *rx_cpus,
+                          unsigned int cpus);
+int  vl_reuseport_config_check(config_t *cfg, unsigned int cpus,
+                               const char *softirqs_path, FILE *out);
+
+#endif /* End of VECTORLOOP_REUSEPORT_H */
+
+/** @}*/
@@ -0,0 +1,138 @@
+/**
+ * @file vectorloop_slo.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlslo Vectorloop latency SLO
+ *
+ * @brief These are functions that track query latency quantiles of a
+ *        vectorloop over a rolling window, and tell when a configured
+ *        latency objective (SLO) is breached or met again.
+ *
+ *        Vectorloop already records end to end latency of every query into
+ *        its latency histograms, which only ever grow. Every
+ *        @ref VL_SLO_PERIOD_MS bucket counts of all of them are summed and
+ *        stored as a snapshot, in a ring of "slo_window" snapshots. Window
+ *        histogram is then difference between newest and oldest snapshot,
+ *        and p50, p99 and p999 are found in a single pass over its buckets.
+ *        So tracking costs a pass over histogram buckets per period, and
+ *        nothing per query.
+ *
+ *        A quantile is breached when its latency is above its objective, and
+ *        vectorloop logs a predefined application log message, with latency
+ *        as parameter, when a quantile enters or leaves breach. Window with
+ *        fewer than @ref VL_SLO_QUERIES_MIN queries is not evaluated.
+ *  @{
+ */
+#ifndef VECTORLOOP_SLO_H
+#define VECTORLOOP_SLO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "histogram.h"
+
+/** Enumerated latency quantiles objectives are set for. */
+typedef enum vl_slo_quantile_e {
+    /** Median latency. */
+    VL_SLO_P50 = 0,
+
+    /** 99th percentile latency. */
+    VL_SLO_P99,
+
+    /** 99.9th percentile latency. */
+    VL_SLO_P999,
+
+    /** Number of quantiles. */
+    VL_SLO_QUANTILES
+} vl_slo_quantile_t;
+
+/** Structure holds latency SLO state of a vectorloop. Only vectorloop that
+ * owns it uses it.
+ */
+typedef struct vl_slo_s {
+    /** Latency objective of each quantile in nanoseconds, 0 if quantile has
+     * none.
+     */
+    uint64_t objective_ns[VL_SLO_QUANTILES];
+
+    /** Latency of each quantile in nanoseconds over last evaluated window,
+     * upper bound of histogram bucket quantile falls in.
+     */
+    uint64_t latency_ns[VL_SLO_QUANTILES];
+
+    /** Number of queries in last evaluated window. */
+    uint64_t queries;
+
+    /** Loop time in milliseconds current period started at. */
+    uint64_t period_start_ms;
+
+    /** Ring of window cumulative histogram snapshots, window entries of
+     * @ref HISTOGRAM_BUCKETS counters each.
+     */
+    uint64_t *snapshots;
+
+    /** Window histogram bucket counts, difference of newest and oldest
+     * snapshot.
+     */
+    uint64_t counts[HISTOGRAM_BUCKETS];
+
+    /** Number of periods in window, and of snapshots in ring. */
+    uint32_t window;
+
+    /** Index of oldest snapshot in ring, replaced by next one. */
+    uint32_t oldest;
+
+    /** Bit mask of quantiles in breach, bit of quantile is
+     * (1 << @ref vl_slo_quantile_t).
+     */
+    uint8_t breached;
+} vl_slo_t;
+
+int  vl_slo_init(vl_slo_t *s, const uint64_t objective_us[VL_SLO_QUANTILES], uint32_t window,
+                 histogram_t *hists, size_t hists_count, uint64_t now_ms);
+void vl_slo_clean(vl_slo_t *s);
+bool vl_slo_update(vl_slo_t *s, histogram_t *hists, size_t hists_count, uint64_t now_ms,
+                   uint8_t *changed);
+
+/** Check whether any latency objective is set.
+ *
+ * @param objective_us Latency objective of each quantile in microseconds.
+ *
+ * @return             Returns true if at least one quantile has one.
+ */
+static inline bool
+vl_slo_enabled(const uint64_t objective_us[VL_SLO_QUANTILES])
+{
+    for (int i = 0; i < VL_SLO_QUANTILES; i++) {
+        if (objective_us[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif /* End of VECTORLOOP_SLO_H */
+
+/** @}*/
@@ -0,0 +1,132 @@
+/**
+ * @file vectorloop_uring.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vluring Vectorloop io_uring
+ *
+ * @brief These are functions that wrap io_uring (via raw system calls) to
+ *        provide functionality suited for application purpose.
+ *
+ *        Vectorloop uses io_uring to batch all socket writes of a vectorloop
+ *        iteration, UDP datagrams and TCP responses, into a single
+ *        io_uring_enter() system call. Messages are sent with MSG_DONTWAIT
+ *        so submissions complete inline, and results (including EAGAIN) are
+ *        the same as those of corresponding sendmsg() calls.
+ *  @{
+ */
+#ifndef VECTORLOOP_URING_H
+#define VECTORLOOP_URING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/** Minimum number of submission queue entries of vectorloop io_uring. */
+#define VL_URING_ENTRIES_MIN 256
+
+/** Maximum number of submission queue entries of vectorloop io_uring. */
+#define VL_URING_ENTRIES_MAX 32768
+
+/** Structure describes an io_uring instance and its mapped rings. */
+typedef struct vl_uring_s {
+    /** io_uring file descriptor, -1 if not created. */
+    int ring_fd;
+
+    /** Number of submission queue entries. */
+    unsigned int sq_entries;
+
+    /** Number of entries prepared and not yet submitted. */
+    unsigned int sq_pending;
+
+    /** Submission queue head, moved by kernel. */
+    unsigned int *sq_head;
+
+    /** Submission queue tail, moved by application. */
+    unsigned int *sq_tail;
+
+    /** Submission queue ring mask. */
+    unsigned int *sq_mask;
+
+    /** Submission queue index array. */
+    unsigned int *sq_array;
+
+    /** Submission queue entries. */
+    struct io_uring_sqe *sqes;
+
+    /** Completion queue head, moved by application. */
+    unsigned int *cq_head;
+
+    /** Completion queue tail, moved by kernel. */
+    unsigned int *cq_tail;
+
+    /** Completion queue ring mask. */
+    unsigned int *cq_mask;
+
+    /** Completion queue entries. */
+    struct io_uring_cqe *cqes;
+
+    /** Mapped submission queue ring (and completion queue ring). */
+    void *sq_ring;
+
+    /** Size of mapped submission queue ring. */
+    size_t sq_ring_size;
+
+    /** Mapped completion queue ring, same as sq_ring if kernel maps both
+     * rings with a single mmap.
+     */
+    void *cq_ring;
+
+    /** Size of mapped completion queue ring. */
+    size_t cq_ring_size;
+
+    /** Size of mapped submission queue entries. */
+    size_t sqes_size;
+} vl_uring_t;
+
+/** Get number of free submission queue entries.
+ *
+ * @param ring io_uring instance.
+ *
+ * @return     Returns number of entries that can be prepared before submit.
+ */
+static inline unsigned int
+vl_uring_sq_space(vl_uring_t *ring)
+{
+    return ring->sq_entries - ring->sq_pending;
+}
+
+int                   vl_uring_init(vl_uring_t *ring, unsigned int entries);
+void                  vl_uring_clean(vl_uring_t *ring);
+struct io_uring_sqe * vl_uring_get_sqe(vl_uring_t *ring);
+void                  vl_uring_prep_sendmsg(struct io_uring_sqe *sqe, int fd,
+                                            struct msghdr *msg, int flags,
+                                            uint64_t user_data);
+unsigned int          vl_uring_submit_and_wait(vl_uring_t *ring);
+struct io_uring_cqe * vl_uring_peek_cqe(vl_uring_t *ring);
+void                  vl_uring_cqe_seen(vl_uring_t *ring);
+
+#endif /* End of VECTORLOOP_URING_H */
+
+/** @}*/
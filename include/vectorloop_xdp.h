@@ -0,0 +1,269 @@
+/**
+ * @file vectorloop_xdp.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup vlxdp Vectorloop AF_XDP
+ *
+ * @brief These are functions that wrap AF_XDP sockets (via raw system calls)
+ *        to provide functionality suited for application purpose.
+ *
+ *        When enabled, an XDP program is attached to network interface which
+ *        redirects UDP datagrams to DNS port into the AF_XDP socket bound to
+ *        receive queue datagram arrived on, all other traffic is passed on to
+ *        kernel network stack. Each vectorloop has its own AF_XDP socket and
+ *        UMEM (frame buffer area shared with kernel), bound to the receive
+ *        queue that matches its CPU.
+ *
+ *        Ethernet, IP and UDP headers of received frames are parsed directly
+ *        into UDP connection read vector entries, in same form recvmmsg()
+ *        fills them in, so queries go through same parse, resolve and pack
+ *        steps as those received via UDP listener sockets. Responses are
+ *        then built into UMEM frames and put onto transmit ring.
+ *        Optionally the XDP program answers hottest cached queries itself
+ *        (in-kernel responder). Vectorloops offer responses copied from
+ *        response cache for the Nth time, see "xdp_responder_hits", to a BPF
+ *        LRU hash map keyed by exact bytes of request following its message
+ *        ID. IPv4 queries that match an entry of current generation are
+ *        answered in place: response is copied after message ID, Ethernet
+ *        and IP addresses and UDP ports are swapped, lengths and IPv4 header
+ *        checksum are fixed (UDP checksum is left 0) and frame is sent back
+ *        out with XDP_TX. All other packets go on to AF_XDP sockets as
+ *        before. Generation is published by vectorloops in a separate map,
+ *        it follows response cache generation and is 0 (responder stands
+ *        aside) while anything that makes response depend on client is
+ *        loaded: views, client ACL, response policy, GeoIP, ECS map or
+ *        response rate limiting.
+ *  @{
+ */
+#ifndef VECTORLOOP_XDP_H
+#define VECTORLOOP_XDP_H
+
+#include <linux/if_xdp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "conn.h"
+
+/** Size of UMEM frame, each frame holds a single received or sent packet. */
+#define VL_XDP_FRAME_SIZE 4096
+
+/** Number of descriptors in each of AF_XDP socket rings (fill, completion,
+ * receive and transmit). MUST be a power of 2.
+ */
+#define VL_XDP_RING_SIZE 2048
+
+/** Number of UMEM frames, half are given to kernel to receive packets into
+ * and other half is used to send packets from.
+ */
+#define VL_XDP_FRAME_COUNT (VL_XDP_RING_SIZE * 2)
+
+/** Length of Ethernet header, VLAN tagged frames are passed on to kernel. */
+#define VL_XDP_ETH_HLEN 14
+
+/** Length of MAC addresses kept per received frame: destination followed by
+ * source MAC address.
+ */
+#define VL_XDP_MACS_LEN 12
+
+/** Largest request, following message ID, in-kernel responder answers. */
+#define VL_XDP_RESP_QUERY_MAX 126
+
+/** Largest response, following message ID, in-kernel responder answers. */
+#define VL_XDP_RESP_RESPONSE_MAX 496
+
+/** Structure describes key of in-kernel responder map, shared with XDP
+ * program, which copies request into it as is.
+ */
+typedef struct vl_xdp_resp_key_s {
+    /** Length of request following message ID, in host byte order. */
+    uint16_t len;
+
+    /** Request following message ID, zero padded. */
+    uint8_t query[VL_XDP_RESP_QUERY_MAX];
+} vl_xdp_resp_key_t;
+
+/** Structure describes value of in-kernel responder map, shared with XDP
+ * program.
+ */
+typedef struct vl_xdp_resp_value_s {
+    /** Response cache generation response was resolved against, only
+     * entries of generation published in generation map are answered.
+     */
+    uint64_t generation;
+
+    /** Length of response following message ID, in host byte order. */
+    uint16_t len;
+
+    /** Padding, response starts at 16 bytes into value. */
+    uint8_t pad[6];
+
+    /** Response following message ID. */
+    uint8_t response[VL_XDP_RESP_RESPONSE_MAX];
+} vl_xdp_resp_value_t;
+
+/** Structure describes XDP program attached to network interface, and map of
+ * AF_XDP sockets it redirects packets to, indexed by receive queue.
+ */
+typedef struct vl_xdp_prog_s {
+    /** Network interface index program is attached to, 0 if not loaded. */
+    unsigned int ifindex;
+
+    /** Interface MTU, limits size of response that is sent. */
+    unsigned int mtu;
+
+    /** AF_XDP socket map (BPF_MAP_TYPE_XSKMAP) file descriptor. */
+    int map_fd;
+
+    /** XDP program file descriptor. */
+    int prog_fd;
+
+    /** In-kernel responder map (BPF_MAP_TYPE_LRU_HASH) file descriptor, -1
+     * if responder is disabled.
+     */
+    int resp_map_fd;
+
+    /** In-kernel responder generation map (BPF_MAP_TYPE_ARRAY, single
+     * entry) file descriptor, -1 if responder is disabled.
+     */
+    int resp_gen_fd;
+
+    /** In-kernel responder per CPU answer counter map
+     * (BPF_MAP_TYPE_PERCPU_ARRAY, single entry) file descriptor, -1 if
+     * responder is disabled.
+     */
+    int resp_stat_fd;
+
+    /** Number of possible CPUs, values of per CPU maps are read for each. */
+    unsigned int cpus;
+
+    /** BPF link file descriptor attaching program to interface, program
+     * is detached when it is closed (including on process exit).
+     */
+    int link_fd;
+} vl_xdp_prog_t;
+
+/** Structure describes one of AF_XDP socket rings mapped from kernel. */
+typedef struct vl_xdp_ring_s {
+    /** Producer index. */
+    uint32_t *producer;
+
+    /** Consumer index. */
+    uint32_t *consumer;
+
+    /** Ring flags, XDP_RING_NEED_WAKEUP. */
+    uint32_t *flags;
+
+    /** Ring descriptors, uint64_t addresses for fill and completion rings,
+     * struct xdp_desc for receive and transmit rings.
+     */
+    void *descs;
+
+    /** Ring mask, number of descriptors - 1. */
+    uint32_t mask;
+
+    /** Mapped ring. */
+    void *map;
+
+    /** Size of mapped ring. */
+    size_t map_size;
+} vl_xdp_ring_t;
+
+/** Structure describes AF_XDP socket of a vectorloop along with its UMEM. */
+typedef struct vl_xdp_s {
+    /** AF_XDP socket file descriptor, -1 if not created. */
+    int fd;
+
+    /** Receive queue socket is bound to. */
+    unsigned int queue_id;
+
+    /** Set if socket is bound in zero copy mode, otherwise in copy mode. */
+    bool zero_copy;
+
+    /** Set if socket busy polls network device, which vectorloop drives on
+     * each receive and send, see configuration setting "xdp_busy_poll".
+     */
+    bool busy_poll;
+
+    /** Largest UDP payload (response) that fits in a single packet. */
+    unsigned int payload_max;
+
+    /** UMEM area, VL_XDP_FRAME_COUNT frames of VL_XDP_FRAME_SIZE bytes. */
+    unsigned char *umem;
+
+    /** Size of UMEM area. */
+    size_t umem_size;
+
+    /** Fill ring, frames given to kernel to receive packets into. */
+    vl_xdp_ring_t fill;
+
+    /** Completion ring, frames kernel is done sending. */
+    vl_xdp_ring_t comp;
+
+    /** Receive ring. */
+    vl_xdp_ring_t rx;
+
+    /** Transmit ring. */
+    vl_xdp_ring_t tx;
+
+    /** Stack of UMEM frame addresses free to send packets from. */
+    uint64_t *tx_free;
+
+    /** Number of entries in tx_free stack. */
+    unsigned int tx_free_count;
+
+    /** MAC addresses of received frames, one per UDP connection read vector
+     * entry, responses are sent back with them swapped.
+     */
+    unsigned char (*macs)[VL_XDP_MACS_LEN];
+} vl_xdp_t;
+
+int  vl_xdp_prog_load(vl_xdp_prog_t *prog, const char *ifname, uint16_t port,
+                      unsigned int queues, unsigned int resp_size, char *err_buf,
+                      size_t err_buf_len);
+void vl_xdp_prog_clean(vl_xdp_prog_t *prog);
+bool vl_xdp_resp_entry_build(vl_xdp_resp_key_t *key, vl_xdp_resp_value_t *value,
+                             uint64_t generation, const unsigned char *query,
+                             size_t query_len, const unsigned char *response,
+                             size_t response_len, unsigned int mtu);
+int  vl_xdp_resp_put(vl_xdp_prog_t *prog, const vl_xdp_resp_key_t *key,
+                     const vl_xdp_resp_value_t *value);
+int  vl_xdp_resp_generation_set(vl_xdp_prog_t *prog, uint64_t generation);
+uint64_t vl_xdp_resp_answers(vl_xdp_prog_t *prog);
+int  vl_xdp_init(vl_xdp_t *xdp, vl_xdp_prog_t *prog, unsigned int queue_id,
+                 unsigned int vector_len, unsigned int busy_poll);
+void vl_xdp_clean(vl_xdp_t *xdp);
+int  vl_xdp_frame_parse(const unsigned char *frame, size_t len, uint16_t port,
+                        struct msghdr *msg_hdr, unsigned char *payload,
+                        size_t payload_size, unsigned char *macs);
+int  vl_xdp_frame_build(unsigned char *frame, size_t frame_size, uint16_t port,
+                        const struct msghdr *msg_hdr, const unsigned char *macs,
+                        const unsigned char *payload, size_t len);
+int  vl_xdp_recv(vl_xdp_t *xdp, conn_udp_t *conn_udp, unsigned int vlen,
+                 uint16_t port);
+int  vl_xdp_send(vl_xdp_t *xdp, conn_udp_t *conn_udp, uint16_t port);
+
+#endif /* End of VECTORLOOP_XDP_H */
+
+/** @}*/
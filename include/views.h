@@ -0,0 +1,118 @@
+/**
+ * @file views.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup views Views
+ *
+ * @brief Views serve split-horizon DNS, different answers for same name
+ *        depending on where query was sent to or came from. Each view is a
+ *        zone database of its own, with a generation of its own, selected by
+ *        query destination (local) address or, failing that, by query source
+ *        (client) address. Queries no view is selected for are answered from
+ *        main zone database.
+ *
+ *        View set is built by resource thread from a view file and, like
+ *        zone database, is never modified once built. Destination and source
+ *        prefixes are compiled into an ECS map table each, see @ref ecs_map,
+ *        so selecting a view is a single longest prefix match lookup for
+ *        each table that has prefixes, one memory access for prefixes up to
+ *        /16.
+ *
+ *        View file format is one directive per line:
+ *
+ *            view <view> <zone file>
+ *            dst <prefix>/<length> <view>
+ *            src <prefix>/<length> <view>
+ *
+ *        View is a single DNS label and MUST be declared with a view
+ *        directive before it is referenced. Zone file is a zone file or zone
+ *        image. Text following a ';' character is a comment.
+ *
+ *  @{
+ */
+#ifndef VIEWS_H
+#define VIEWS_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "ecs_map.h"
+#include "rip_ns_utils.h"
+#include "zone.h"
+
+/** Maximum number of views view file can declare. */
+#define VIEWS_MAX 256
+
+/** Function loads zone database of a view from zone file.
+ *
+ * @param filepath   Path of zone file.
+ * @param generation Generation number to assign to zone database.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns zone database, or NULL on error.
+ */
+typedef zone_db_t *(*views_zone_load_fn)(const char *filepath, uint64_t generation,
+                                         char *err, size_t err_len);
+
+/** Structure describes a set of views. Once created it is read only. */
+typedef struct views_s {
+    /** Generation number of view set, assigned at creation. */
+    uint64_t generation;
+
+    /** Destination address table, NULL if no dst directive. */
+    ecs_map_t *dst;
+
+    /** Source address table, NULL if no src directive. */
+    ecs_map_t *src;
+
+    /** View number of each destination table view, indexed by table view
+     * number - 1.
+     */
+    uint16_t *dst_views;
+
+    /** View number of each source table view, indexed by table view
+     * number - 1.
+     */
+    uint16_t *src_views;
+
+    /** Zone database of each view, indexed by view number - 1. */
+    zone_db_t **zone_dbs;
+
+    /** Wire format (lower cased) view labels, indexed by view number - 1. */
+    unsigned char (*labels)[RIP_NS_MAXLABEL + 1];
+
+    /** Number of views. */
+    uint16_t count;
+} views_t;
+
+views_t * views_create(const char *buf, size_t buf_len, uint64_t generation,
+                       views_zone_load_fn zone_load, char *err, size_t err_len);
+void views_release(views_t *views);
+
+uint16_t views_select(views_t *views, const struct sockaddr_storage *local_ip,
+                      const struct sockaddr_storage *client_ip);
+
+#endif /* End of VIEWS_H */
+
+/** @}*/
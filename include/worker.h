@@ -0,0 +1,129 @@
+/**
+ * @file worker.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup worker Worker Threads
+ *
+ * @brief These are functions that run work too slow for vectorloop to do
+ *        inline, on worker threads of a vectorloop.
+ *
+ *        Work is a job, @ref worker_job_t, embedded into object it works on.
+ *        Vectorloop hands job to least busy of its worker threads via a
+ *        single producer single consumer queue, and MUST not touch object
+ *        until job is returned. Worker thread runs all jobs queued since it
+ *        last woke up as one batch, queues them back and wakes vectorloop up
+ *        once per batch. Vectorloop completes returned jobs by their type,
+ *        and resumes queries that were deferred waiting for them.
+ *
+ *        Worker threads are not bound to vectorloop CPU, so they do not take
+ *        CPU time from it.
+ *  @{
+ */
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <liblfds711.h>
+
+/** Number of elements in worker thread request and result queues. MUST be a
+ * power of 2, queue holds one less entry than this.
+ */
+#define WORKER_QUEUE_LEN 256
+
+/** Types of jobs, tells vectorloop how to complete a returned job. */
+typedef enum worker_job_type_e {
+    /** Sign RRset, job is embedded into @ref dnssec_sig_t. */
+    WORKER_JOB_DNSSEC_SIGN = 0,
+
+    /** Parse, sort or compile shard of a zone database, see
+     * @ref zone_db_create_workers(). Run by @ref worker_pool_run().
+     */
+    WORKER_JOB_ZONE_SHARD,
+} worker_job_type_t;
+
+/** Structure describes a job run on worker thread. */
+typedef struct worker_job_s {
+    /** Function worker thread runs job with. */
+    void (*run)(struct worker_job_s *job);
+
+    /** Job type. */
+    worker_job_type_t type;
+} worker_job_t;
+
+/** Structure describes a worker thread of a vectorloop. Vectorloop is the
+ * only producer of request queue and consumer of result queue, and worker
+ * thread the only consumer of request and producer of result queue.
+ */
+typedef struct worker_s {
+    /** Request queue, jobs to run. */
+    struct lfds711_queue_bss_element req_qbsse[WORKER_QUEUE_LEN];
+
+    /** Request queue state. */
+    struct lfds711_queue_bss_state req_qbsss;
+
+    /** Result queue, jobs that were run. */
+    struct lfds711_queue_bss_element res_qbsse[WORKER_QUEUE_LEN];
+
+    /** Result queue state. */
+    struct lfds711_queue_bss_state res_qbsss;
+
+    /** Eventfd worker thread blocks on, written to by vectorloop each time
+     * it queues a request.
+     */
+    int req_fd;
+
+    /** Eventfd of vectorloop, written to once per batch of jobs run. */
+    int wake_fd;
+
+    /** Number of jobs in request and result queues, only used by
+     * vectorloop.
+     */
+    size_t in_flight;
+
+    /** Worker thread. */
+    pthread_t thread;
+} worker_t;
+
+/** Structure holds worker threads of a vectorloop. */
+typedef struct worker_pool_s {
+    /** Array of worker threads. */
+    worker_t *workers;
+
+    /** Number of worker threads, 0 if pool is not started. */
+    size_t count;
+
+    /** Number of jobs handed to worker threads and not collected back yet. */
+    size_t in_flight;
+} worker_pool_t;
+
+void           worker_pool_start(worker_pool_t *pool, size_t count, int wake_fd);
+bool           worker_pool_submit(worker_pool_t *pool, worker_job_t *job);
+worker_job_t * worker_pool_done(worker_pool_t *pool);
+void           worker_pool_run(worker_pool_t *pool, worker_job_t **jobs, size_t count);
+
+#endif /* WORKER_H */
+
+/** @}*/
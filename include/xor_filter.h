@@ -0,0 +1,145 @@
+/**
+ * @file xor_filter.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup xor_filter Xor Filter
+ *
+ * @brief Xor filter is a static, approximate, set membership structure of
+ *        64 bit keys (Graf and Lemire, "Xor Filters: Faster and Smaller Than
+ *        Bloom and Cuckoo Filters"). Membership test of a key in set is
+ *        always positive, test of a key not in set is positive with
+ *        probability of about 1/256, so a negative test is a definite miss.
+ *
+ *        Filter is an array of 8 bit fingerprints, about 1.23 bytes per key,
+ *        split into three blocks. A key hashes to one slot in each block, and
+ *        is in set if xor of those three fingerprints equals key fingerprint.
+ *        Test is three memory reads, no matter the number of keys, and unlike
+ *        a Bloom filter, there is no loop.
+ *
+ *        Filter is built once, from all keys, and never modified. Fingerprint
+ *        array is provided by caller, so it can be carved out of an arena.
+ *  @{
+ */
+#ifndef XOR_FILTER_H
+#define XOR_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum number of seeds filter build tries before giving up. Build with
+ * a seed fails with probability of a few percent.
+ */
+#define XOR_FILTER_SEEDS_MAX 64
+
+/** Structure describes an xor filter. */
+typedef struct xor_filter_s {
+    /** Seed keys are mixed with before they are hashed into slots. */
+    uint64_t seed;
+
+    /** Number of fingerprints in each of three blocks. */
+    uint32_t block_len;
+
+    /** Fingerprints array of 3 * block_len entries. */
+    uint8_t *fingerprints;
+} xor_filter_t;
+
+/** Mix key with filter seed (murmur3 64 bit finalizer).
+ *
+ * @param key  Key to mix.
+ * @param seed Filter seed.
+ *
+ * @return     Returns mixed key.
+ */
+static inline uint64_t
+xor_filter_mix(uint64_t key, uint64_t seed)
+{
+    uint64_t h = key + seed;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/** Get slot of mixed key in a filter block.
+ *
+ * @param f     Filter.
+ * @param h     Mixed key.
+ * @param block Block index, 0 to 2.
+ *
+ * @return      Returns index of slot in fingerprints array.
+ */
+static inline uint32_t
+xor_filter_slot(const xor_filter_t *f, uint64_t h, int block)
+{
+    uint32_t r = (uint32_t)(block == 0 ? h : (h << (21 * block)) | (h >> (64 - 21 * block)));
+
+    return (uint32_t)(((uint64_t)r * f->block_len) >> 32) + block * f->block_len;
+}
+
+/** Test if key is in filter set.
+ *
+ * @param f   Filter.
+ * @param key Key to test.
+ *
+ * @return    Returns false if key is definitely not in set, true if it is
+ *            (or, with probability of about 1/256, is not).
+ */
+static inline bool
+xor_filter_contain(const xor_filter_t *f, uint64_t key)
+{
+    uint64_t h  = xor_filter_mix(key, f->seed);
+    uint8_t  fp = (uint8_t)(h ^ (h >> 32));
+
+    fp ^= f->fingerprints[xor_filter_slot(f, h, 0)] ^
+          f->fingerprints[xor_filter_slot(f, h, 1)] ^
+          f->fingerprints[xor_filter_slot(f, h, 2)];
+    return fp == 0;
+}
+
+/** Prefetch fingerprints @ref xor_filter_contain reads for key, so a batch
+ * of keys can have their filter cache misses overlap.
+ *
+ * @param f   Filter.
+ * @param key Key to be tested.
+ */
+static inline void
+xor_filter_prefetch(const xor_filter_t *f, uint64_t key)
+{
+    uint64_t h = xor_filter_mix(key, f->seed);
+
+    __builtin_prefetch(&f->fingerprints[xor_filter_slot(f, h, 0)]);
+    __builtin_prefetch(&f->fingerprints[xor_filter_slot(f, h, 1)]);
+    __builtin_prefetch(&f->fingerprints[xor_filter_slot(f, h, 2)]);
+}
+
+size_t xor_filter_size(uint32_t count);
+int    xor_filter_build(xor_filter_t *f, uint8_t *fingerprints, uint64_t *keys,
+                        uint32_t count);
+
+#endif /* End of XOR_FILTER_H */
+
+/** @}*/
@@ -0,0 +1,836 @@
+/**
+ * @file zone.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup zone Zone Database
+ *
+ * @brief Zone database is an in-memory, read only, store of DNS resource
+ *        records ripples answers queries from.
+ *
+ *        Database is built by resource thread from a zone file, and once built
+ *        it is never modified. Each reload produces a new database object
+ *        (generation) which is handed over to vectorloop threads via resource
+ *        channel. This allows vectorloop threads to do lookups without any
+ *        locking, and without allocating memory on the query processing path.
+ *
+ *        Nodes are kept in a single array and indexed by an open addressing
+ *        hash table keyed on lower cased, wire format, owner name. Lookup cost
+ *        is one hash of query name plus (on average) one or two probes
+ *        regardless of number of names in database. Resource records (and
+ *        RRsets) of each node are stored contiguously and sorted by type.
+ *
+ *        Query resolution needs more than an exact match, it needs closest
+ *        zone apex, zone cut and closest encloser of query name, and a hash
+ *        table can only answer that with a probe per label. Nodes are
+ *        therefore also linked into a reverse label tree, labels stored right
+ *        to left in canonical (lower cased) wire form, so a single descent
+ *        from the root finds them all. Children of a tree node are stored
+ *        next to each other, sorted in canonical order and searched with a
+ *        binary search, and tree nodes are laid out breadth first in an array
+ *        allocated from database arena, two per cache line with leading label
+ *        bytes held inline. Every ancestor of an owner name is a node (empty
+ *        non-terminal), so no tree node needs more than a label of its own.
+ *
+ *        Names of all nodes are also added to an xor filter, which query
+ *        name hash is tested against before descent. A name the filter misses
+ *        is not in database, and its leftmost label is not searched for
+ *        among children of its parent, which for random subdomain names is
+ *        every name of a zone.
+ *
+ *        Wildcard owner names ("*" leftmost label) synthesize answers for
+ *        names that do not exist below their parent, the closest encloser,
+ *        as described by RFC 4592.
+ *
+ *        Records of whole address blocks, forward (A/AAAA of
+ *        "ip-10-1-2-3.pool.example.com." style names) and reverse (PTR), are
+ *        described by synthesis rules ("$SYNTH" zone file lines) instead of
+ *        being stored. A name that does not exist is matched against rules,
+ *        its address parsed out of name and its record generated into query
+ *        owned storage, so a block takes a rule regardless of its size.
+ *
+ *        At build time each RRset is also precompiled into a wire format
+ *        response fragment, answer records followed by additional section
+ *        address records, with name compression resolved against a question
+ *        for RRset owner name. Packing a response for such a query is then a
+ *        header patch, a copy of request question, and a copy of the
+ *        fragment.
+ *
+ *        Zone SOA RRset is also precompiled into a negative response
+ *        fragment, authority section SOA record with negative TTL (lower of
+ *        SOA TTL and SOA minimum, RFC 2308), shared by NXDOMAIN and NODATA
+ *        responses for any name in zone. Its compression pointers are moved
+ *        by difference in length of query name and zone apex name when
+ *        packed, so negative response is a copy and at most three two byte
+ *        patches.
+ *
+ *        Zone file format is one resource record per line:
+ *
+ *            <owner> <ttl> <class> <type> <rdata>
+ *
+ *        Owner and domain names in rdata are fully qualified, the trailing
+ *        "." is optional. Text following a ';' character is a comment. Only
+ *        class IN is supported. Supported types are A, AAAA, NS, CNAME, PTR,
+ *        MX, TXT, SRV, SOA, DS, DNSKEY, RRSIG, NSEC, NSEC3 and NSEC3PARAM.
+ *        Zone apex is any node that has a SOA record.
+ *
+ *        A presigned zone (one signed offline, e.g. by dnssec-signzone) is
+ *        loaded as is, RRSIG records of a node are a single RRSIG RRset and
+ *        are added after RRsets they cover to responses for queries with
+ *        DNSSEC OK bit set.
+ *
+ *        Denial of existence records of a presigned zone, NSEC (RFC 4034) or
+ *        NSEC3 (RFC 5155, zone apex has a NSEC3PARAM record), are also
+ *        precomputed into a per zone chain when database is built. Chain is
+ *        sorted, NSEC owner names in canonical order (reverse label tree
+ *        already holds them so), NSEC3 entries by hash decoded from owner
+ *        name, and laid out in Eytzinger (breadth first binary tree) order,
+ *        so the NSEC or NSEC3 record that matches or covers a name or hash
+ *        is found with a branch free binary search whose first levels share
+ *        a few cache lines. Iterated SHA-1 hashes of names NSEC3 proofs need
+ *        are kept in a small per vectorloop cache, see
+ *        @ref zone_nsec3_cache_t.
+ *
+ *        Small changes to a large zone are applied incrementally from a zone
+ *        delta file, in the same format as zone file plus deletion lines:
+ *
+ *            -<owner> <type|ANY>
+ *
+ *        Records in delta replace RRset of their owner name and type, a
+ *        deletion line removes RRset (or all RRsets of ANY) of owner name.
+ *        Applying a delta produces a new generation that shares all unchanged
+ *        RRsets, records and precompiled fragments with its base, only node
+ *        array and hash table are rebuilt, and only changed RRsets (and RRsets
+ *        whose additional section addresses changed) are compiled.
+ *
+ *        For large zones startup and reload time is dominated by parsing and
+ *        compiling zone file. Zone file can instead be compiled offline into
+ *        a zone image (see --zone_image_compile) which is memory mapped read
+ *        only. Image stores offsets instead of pointers, hash table, names,
+ *        rdata and precompiled fragments are used in place and only node,
+ *        RRset and record arrays are rebuilt, in a single pass. Zone image is
+ *        detected by its magic bytes, so zone file can be either.
+ *
+ *        Image nodes are ordered by a minimal perfect hash function of their
+ *        names (see @ref mphf), so an exact match lookup is a slot
+ *        computation and a single node compare instead of a probe sequence,
+ *        and image carries about 4 bits per name instead of a hash table of
+ *        at least 64 bits per name. Node 32 bit name hash acts as fingerprint
+ *        that rejects most names not in database before name compare.
+ *
+ *        Owner names, wire and presentation format, are stored in image as
+ *        pools where a name that is a suffix of another name (every ancestor
+ *        of a name, and a name repeated by each of its records) is the tail
+ *        of it, so in a large zone only leaf names take space. Names stay
+ *        contiguous, lookups compare and pack copy them in place.
+ *
+ *        Zone image also holds every zone of database precompiled into zone
+ *        transfer (AXFR, RFC 5936) messages, answer sections of up to
+ *        @ref ZONE_XFR_MSG_LEN bytes each compressed against a question for
+ *        zone apex name. A transfer is then a header and a copy of request
+ *        question per message, followed by message answer section sent
+ *        straight from image file with sendfile().
+ *
+ *  @{
+ */
+#ifndef ZONE_H
+#define ZONE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "mphf.h"
+#include "rip_ns_utils.h"
+#include "rr_record.h"
+#include "worker.h"
+#include "xor_filter.h"
+
+/** Zone image magic bytes, found at start of zone image file. */
+#define ZONE_IMAGE_MAGIC "RIPZIMG\0"
+
+/** Length of zone image magic bytes. */
+#define ZONE_IMAGE_MAGIC_LEN 8
+
+/** Node flag indicating node is a zone apex (node has a SOA record). */
+#define ZONE_NODE_F_APEX 0x01
+
+/** Node flag indicating node is a zone cut (delegation), node has NS records
+ * and is not a zone apex.
+ */
+#define ZONE_NODE_F_CUT  0x02
+
+/** Number of leading label bytes a reverse label tree node holds inline, so
+ * tree node is 32 bytes.
+ */
+#define ZONE_TREE_LABEL_INLINE 19
+
+/** Target length of answer section of a precompiled zone transfer message,
+ * records are added to a message until next one would not fit. A record
+ * larger than that is sent in a message of its own.
+ */
+#define ZONE_XFR_MSG_LEN 16384
+
+/** RRset wire fits flag, response with precompiled response fragment fits
+ * into @ref RIP_NS_PACKETSZ bytes. Response length is counted with question
+ * for RRset owner name and EDNS OPT RR of @ref DNS_RESPONSE_EDNS_LEN_MAX.
+ */
+#define ZONE_RRSET_FITS_PACKETSZ   0x01
+
+/** RRset wire fits flag, as @ref ZONE_RRSET_FITS_PACKETSZ but for
+ * @ref DNS_RESPONSE_SIZE_EDNS bytes.
+ */
+#define ZONE_RRSET_FITS_EDNS       0x02
+
+/** RRset wire fits flag, as @ref ZONE_RRSET_FITS_PACKETSZ but for
+ * @ref RIP_NS_UDP_MAXMSG bytes.
+ */
+#define ZONE_RRSET_FITS_UDP_MAXMSG 0x04
+
+/** Maximum number of record synthesis rules of a zone database. */
+#define ZONE_SYNTH_RULES_MAX 64
+
+/** Minimum length of zone file data parsed on a thread of its own, see
+ * @ref zone_db_create_workers(). Smaller zone files are parsed on fewer
+ * threads, as handing out a shard would cost more than it saves.
+ */
+#define ZONE_PARSE_SHARD_LEN_MIN (64 * 1024)
+
+/** Minimum number of records sorted on a thread of its own, see
+ * @ref zone_db_create_workers().
+ */
+#define ZONE_SORT_RUN_MIN 4096
+
+/** Minimum number of nodes whose RRsets are precompiled on a thread of its
+ * own, see @ref zone_db_create_workers().
+ */
+#define ZONE_COMPILE_SHARD_NODES_MIN 1024
+
+/** Maximum length of synthesis rule label prefix, so prefix followed by
+ * longest IPv6 address text fits into a label.
+ */
+#define ZONE_SYNTH_PREFIX_MAX 24
+
+/** Synthesis rule type, A or AAAA records of names formed from address of
+ * block, "<prefix><address>.<origin>" with '.' and ':' of address replaced
+ * by '-'.
+ */
+#define ZONE_SYNTH_FORWARD 1
+
+/** Synthesis rule type, PTR records of reverse names (in-addr.arpa or
+ * ip6.arpa) of addresses of block, pointing at forward names.
+ */
+#define ZONE_SYNTH_REVERSE 2
+
+/** Structure describes a set of resource records of same owner name and type. */
+typedef struct zone_rrset_s {
+    /** RRset type. Valid types are defined as @ref rip_ns_type_t. */
+    uint16_t type;
+
+    /** Number of resource records in RRset. */
+    uint16_t rr_count;
+
+    /** First resource record of RRset, records of an RRset are stored
+     * contiguously.
+     */
+    rr_record_t *rrs;
+
+    /** Precompiled response fragment (answer followed by additional section
+     * records) for a query whose question is RRset owner name and type. NULL
+     * if RRset does not have one.
+     */
+    const uint8_t *wire;
+
+    /** Precompiled negative response fragment (authority section SOA record
+     * with negative TTL) of zone SOA RRset. NULL if RRset does not have one.
+     */
+    const uint8_t *neg_wire;
+
+    /** Offset of precompiled response fragment in wire buffer of database
+     * generation that compiled it, used while database is built.
+     */
+    uint32_t wire_offset;
+
+    /** Offset of precompiled negative response fragment in wire buffer of
+     * database generation that compiled it.
+     */
+    uint32_t neg_wire_offset;
+
+    /** Length of precompiled response fragment. 0 means RRset does not have
+     * one and response needs to be packed record by record.
+     */
+    uint16_t wire_len;
+
+    /** Number of answer section records in precompiled response fragment. */
+    uint16_t wire_ancount;
+
+    /** Number of additional section records in precompiled response fragment. */
+    uint16_t wire_arcount;
+
+    /** Length of answer section records at start of precompiled response
+     * fragment. Fragment cut to this length is a response with additional
+     * section records dropped.
+     */
+    uint16_t wire_an_len;
+
+    /** Length of precompiled negative response fragment, 0 if RRset does not
+     * have one.
+     */
+    uint16_t neg_wire_len;
+
+    /** Response offset negative response fragment was compiled at, past
+     * question for zone apex name. Compression pointers in fragment are
+     * moved by difference between actual fragment offset and this one.
+     */
+    uint16_t neg_wire_base;
+
+    /** Response size classes precompiled response fragment fits into, see
+     * ZONE_RRSET_FITS_* constants.
+     */
+    uint8_t wire_fits;
+} zone_rrset_t;
+
+/** Structure describes a zone database node (owner name). */
+typedef struct zone_node_s {
+    /** Hash of node wire format name. */
+    uint32_t hash;
+
+    /** Node wire format (lower cased) name. */
+    const unsigned char *name;
+
+    /** Length of node wire format name, including terminating root label. */
+    uint16_t name_len;
+
+    /** Number of RRsets node has. Empty non-terminal nodes have a count
+     * of 0.
+     */
+    uint16_t rrset_count;
+
+    /** First RRset of node, RRsets of a node are stored contiguously and
+     * sorted by type.
+     */
+    zone_rrset_t *rrsets;
+
+    /** Node flags, see ZONE_NODE_F_* constants. */
+    uint8_t  flags;
+
+    /** Dense index of zone, in zones array of database, set on zone apex
+     * nodes only. Zones past UINT16_MAX share last index.
+     */
+    uint16_t zone;
+} zone_node_t;
+
+/** Structure describes a reverse label tree node, tree node is a database
+ * node keyed by its leftmost label.
+ */
+typedef struct zone_tree_node_s {
+    /** Index of first child in tree nodes array. Children are stored
+     * contiguously and sorted in canonical label order.
+     */
+    uint32_t children;
+
+    /** Number of children. */
+    uint32_t children_count;
+
+    /** Index + 1 of database node in nodes array. Only tree root, when root
+     * name is not in database, has 0.
+     */
+    uint32_t node;
+
+    /** Length of label. */
+    uint8_t label_len;
+
+    /** Leading label bytes, rest of a longer label is read from database
+     * node name.
+     */
+    unsigned char label[ZONE_TREE_LABEL_INLINE];
+} zone_tree_node_t;
+
+/** Structure describes result of a closest encloser search of zone database,
+ * see @ref zone_db_match.
+ */
+typedef struct zone_match_s {
+    /** Node of searched name, NULL if name does not exist. */
+    zone_node_t *node;
+
+    /** Closest encloser, node of longest existing ancestor (or name itself)
+     * of searched name. NULL if not even root is in database.
+     */
+    zone_node_t *encloser;
+
+    /** Closest zone apex at or above searched name, NULL if there is none. */
+    zone_node_t *apex;
+
+    /** Highest zone cut below apex, at or above searched name, NULL if there
+     * is none.
+     */
+    zone_node_t *cut;
+
+    /** Wildcard node ("*" child of closest encloser) answers are synthesized
+     * from, NULL if name exists or there is no wildcard.
+     */
+    zone_node_t *wildcard;
+} zone_match_t;
+
+/** Structure describes a precompiled zone transfer message. */
+typedef struct zone_xfr_msg_s {
+    /** Offset of message answer section in database xfr_data buffer. */
+    uint32_t offset;
+
+    /** Length of message answer section. */
+    uint16_t len;
+
+    /** Number of records in message answer section. */
+    uint16_t ancount;
+} zone_xfr_msg_t;
+
+/** Structure describes a precompiled zone transfer, messages of a zone
+ * starting and ending with zone SOA record.
+ */
+typedef struct zone_xfr_s {
+    /** Index of zone apex node in database nodes array. */
+    uint32_t apex;
+
+    /** Zone SOA serial. */
+    uint32_t serial;
+
+    /** Index of first message of transfer in database xfr_msgs array. */
+    uint32_t msg_index;
+
+    /** Number of messages of transfer. */
+    uint32_t msg_count;
+} zone_xfr_t;
+
+/** Structure describes a record synthesis rule, records of every address of
+ * an address block answered from a template instead of being stored, see
+ * @ref zone_db_synth(). Rule holds no pointers, so zone image stores it as
+ * is.
+ */
+typedef struct zone_synth_s {
+    /** Wire format (lower cased) name forward names are under. */
+    unsigned char origin[RIP_NS_MAXCDNAME + 1];
+
+    /** Network address of block, IPv4 or IPv6 in network order, bits past
+     * prefix length are 0.
+     */
+    uint8_t network[16];
+
+    /** TTL of synthesized records. */
+    uint32_t ttl;
+
+    /** Length of origin name. */
+    uint16_t origin_len;
+
+    /** Rule type, ZONE_SYNTH_FORWARD or ZONE_SYNTH_REVERSE. */
+    uint8_t type;
+
+    /** Length of address, 4 (IPv4) or 16 (IPv6). */
+    uint8_t addr_len;
+
+    /** Network prefix length of block, in bits. */
+    uint8_t prefix_len;
+
+    /** Length of label prefix. */
+    uint8_t label_prefix_len;
+
+    /** Lower cased prefix of first label of forward names. */
+    char label_prefix[ZONE_SYNTH_PREFIX_MAX];
+} zone_synth_t;
+
+/** Zone has no denial of existence chain. */
+#define ZONE_DENIAL_NONE 0
+
+/** Zone denies existence with NSEC records. */
+#define ZONE_DENIAL_NSEC 1
+
+/** Zone denies existence with NSEC3 records. */
+#define ZONE_DENIAL_NSEC3 2
+
+/** Length of NSEC3 hash, SHA-1 is the only hash algorithm defined. */
+#define ZONE_NSEC3_HASH_LEN 20
+
+/** NSEC3 hash algorithm SHA-1 (RFC 5155). */
+#define ZONE_NSEC3_ALG_SHA1 1
+
+/** Maximum NSEC3 hash iterations a chain is built for, RFC 5155 limit for
+ * largest (4096 bit) zone signing keys.
+ */
+#define ZONE_NSEC3_ITERATIONS_MAX 2500
+
+/** Structure describes an entry of zone denial of existence chain. */
+typedef struct zone_denial_entry_s {
+    /** NSEC3 hash decoded from first label of owner name, unused by NSEC
+     * chain.
+     */
+    uint8_t hash[ZONE_NSEC3_HASH_LEN];
+
+    /** Index of node owning NSEC or NSEC3 RRset in nodes array. */
+    uint32_t node;
+
+    /** Position of entry in sorted chain, its predecessor is at rank - 1
+     * (chain wraps around).
+     */
+    uint32_t rank;
+} zone_denial_entry_t;
+
+/** Structure describes denial of existence chain of a zone. */
+typedef struct zone_denial_s {
+    /** First entry of chain in denial_chain and denial_tree arrays of
+     * database.
+     */
+    uint32_t first;
+
+    /** Number of entries in chain. */
+    uint32_t count;
+
+    /** NSEC3 hash iterations, from NSEC3PARAM record of zone apex. */
+    uint16_t iterations;
+
+    /** Chain kind, see ZONE_DENIAL_* constants. */
+    uint8_t kind;
+
+    /** Length of NSEC3 salt. */
+    uint8_t salt_len;
+
+    /** NSEC3 salt. */
+    uint8_t salt[UINT8_MAX];
+} zone_denial_t;
+
+/** Structure describes an entry of NSEC3 hash cache. */
+typedef struct zone_nsec3_cache_entry_s {
+    /** Generation of database hash was computed for. */
+    uint64_t generation;
+
+    /** Denial of existence chain whose NSEC3 parameters hash was computed
+     * with.
+     */
+    const zone_denial_t *denial;
+
+    /** NSEC3 hash of name. */
+    uint8_t hash[ZONE_NSEC3_HASH_LEN];
+
+    /** Length of name, 0 marks an empty entry. */
+    uint16_t name_len;
+
+    /** Wire format (lower cased) name. */
+    unsigned char name[RIP_NS_MAXCDNAME + 1];
+} zone_nsec3_cache_entry_t;
+
+/** Structure describes a direct mapped cache of NSEC3 hashes, owned by a
+ * single vectorloop thread. A miss costs (iterations + 1) SHA-1 digests,
+ * names a negative answer for a zone repeatedly needs hashed (closest
+ * encloser, wildcard at it) hit.
+ */
+typedef struct zone_nsec3_cache_s {
+    /** Array of cache entries, NULL if cache is disabled. */
+    zone_nsec3_cache_entry_t *entries;
+
+    /** Entries array mask, size is (mask + 1) which is a power of 2. */
+    uint32_t mask;
+
+    /** Digest context hashes are computed with, reused so computing one
+     * does not allocate memory.
+     */
+    struct evp_md_ctx_st *md_ctx;
+} zone_nsec3_cache_t;
+
+/** Structure describes zone database. Once created it is read only. */
+typedef struct zone_db_s {
+    /** Generation number of database, assigned at creation. Each newly
+     * loaded database has a higher generation number than the previous one.
+     */
+    uint64_t generation;
+
+    /** Database generation this one was derived from by applying a delta,
+     * NULL for a database built from a zone file. Nodes, RRsets and records
+     * that delta did not change are shared with base and referenced in place.
+     */
+    struct zone_db_s *base;
+
+    /** Reference count. Database is created with a single reference, and
+     * each database derived from it holds one more. Only resource thread
+     * takes and drops references.
+     */
+    uint32_t refs;
+
+    /** Array of database nodes. */
+    zone_node_t *nodes;
+
+    /** Number of entries in nodes array. */
+    uint32_t nodes_count;
+
+    /** Hash table. Each entry holds (index + 1) of node in nodes array, 0
+     * marks an empty slot. NULL if database was loaded from a zone image
+     * with a minimal perfect hash function of node names.
+     */
+    uint32_t *table;
+
+    /** Hash table mask, table size is (table_mask + 1) which is a power of 2. */
+    uint32_t table_mask;
+
+    /** Minimal perfect hash function of node names, keyed by name hash (see
+     * @ref rip_ns_name_hash), used instead of hash table. Node index is slot
+     * of its name, pilots and remap arrays point into zone image.
+     */
+    mphf_t mphf;
+
+    /** Reverse label tree nodes array, root is the first entry. */
+    zone_tree_node_t *tree;
+
+    /** Number of entries in tree nodes array. */
+    uint32_t tree_count;
+
+    /** Filter of database node names, keyed by name hash (see
+     * @ref rip_ns_name_hash), for a definite miss of a name not in database.
+     */
+    xor_filter_t filter;
+
+    /** Arena tree nodes array, zones array, name filter fingerprints and
+     * denial of existence chains are allocated from.
+     */
+    arena_t arena;
+
+    /** Array of zones, node index of each zone apex, in nodes array order.
+     * Zone apex node holds its index in this array, see @ref zone_node_t.
+     */
+    uint32_t *zones;
+
+    /** Number of entries in zones array. */
+    uint32_t zones_count;
+
+    /** Denial of existence chain (index + 1) of each zone in denials
+     * array, indexed by zone index, 0 if zone has none.
+     */
+    uint32_t *zone_denials;
+
+    /** Array of denial of existence chains. */
+    zone_denial_t *denials;
+
+    /** Number of entries in denials array. */
+    uint32_t denials_count;
+
+    /** Entries of all denial of existence chains, entries of a chain are
+     * stored contiguously in sorted order.
+     */
+    zone_denial_entry_t *denial_chain;
+
+    /** Entries of all denial of existence chains, entries of a chain are
+     * stored contiguously in Eytzinger order, entry k (counting from 1) of
+     * a chain is at (first + k - 1).
+     */
+    zone_denial_entry_t *denial_tree;
+
+    /** Number of entries in denial_chain and denial_tree arrays. */
+    uint32_t denial_entries_count;
+
+    /** Per zone metrics slot + 1 of each zone, indexed by zone index, set by
+     * resource thread before database is published, see
+     * @ref metrics_zones_register(). NULL if per zone metrics are not
+     * configured.
+     */
+    uint16_t *zone_slots;
+
+    /** Array of RRsets this generation built, RRsets of a node are stored
+     * contiguously.
+     */
+    zone_rrset_t *rrsets;
+
+    /** Number of entries in rrsets array. */
+    uint32_t rrsets_count;
+
+    /** Array of resource records this generation built, records of an RRset
+     * are stored contiguously.
+     */
+    rr_record_t *rrs;
+
+    /** Number of entries in rrs array. */
+    uint32_t rrs_count;
+
+    /** Buffer holding wire format (lower cased) node names. */
+    unsigned char *names;
+
+    /** Buffer holding presentation format owner names referenced by
+     * resource records.
+     */
+    unsigned char *texts;
+
+    /** Buffer holding resource record rdata. */
+    uint8_t *rdata;
+
+    /** Buffer holding precompiled RRset response fragments. */
+    uint8_t *wire;
+
+    /** Length of data in names buffer. */
+    size_t names_len;
+
+    /** Length of data in texts buffer. */
+    size_t texts_len;
+
+    /** Length of data in rdata buffer. */
+    size_t rdata_len;
+
+    /** Length of data in wire buffer. */
+    size_t wire_len;
+
+    /** Memory mapped zone image database was loaded from, NULL if it was
+     * built from zone file. Hash table and names, texts, rdata and wire
+     * buffers point into image.
+     */
+    void *image;
+
+    /** Length of memory mapped zone image. */
+    size_t image_len;
+
+    /** Array of precompiled zone transfers, sorted by apex node index. */
+    zone_xfr_t *xfrs;
+
+    /** Number of entries in xfrs array. */
+    uint32_t xfrs_count;
+
+    /** Array of precompiled zone transfer messages, messages of a transfer
+     * are stored contiguously.
+     */
+    zone_xfr_msg_t *xfr_msgs;
+
+    /** Number of entries in xfr_msgs array. */
+    uint32_t xfr_msgs_count;
+
+    /** Buffer holding answer sections of precompiled zone transfer messages. */
+    uint8_t *xfr_data;
+
+    /** Length of data in xfr_data buffer. */
+    size_t xfr_data_len;
+
+    /** Zone image file descriptor transfers are sent from, -1 if database
+     * was not loaded from a zone image, or image has no transfers.
+     */
+    int image_fd;
+
+    /** Offset of xfr_data buffer in zone image file. */
+    uint64_t xfr_data_file_offset;
+
+    /** Array of record synthesis rules, points into zone image if database
+     * was loaded from one.
+     */
+    zone_synth_t *synths;
+
+    /** Number of entries in synths array. */
+    uint32_t synths_count;
+
+    /** Set if database memory is locked, see @ref zone_db_mlock(). */
+    bool locked;
+} zone_db_t;
+
+uint32_t zone_name_hash(const unsigned char *name, uint16_t name_len);
+bool     zone_type_supported(uint16_t type);
+
+zone_db_t * zone_db_create(const char *buf, size_t buf_len, uint64_t generation,
+                           char *err, size_t err_len);
+zone_db_t * zone_db_create_workers(const char *buf, size_t buf_len, uint64_t generation,
+                                   worker_pool_t *workers, char *err, size_t err_len);
+zone_db_t * zone_db_apply(zone_db_t *base, const char *buf, size_t buf_len,
+                          uint64_t generation, char *err, size_t err_len);
+zone_db_t * zone_db_create_rrs(const rr_record_t *rrs, size_t rrs_count,
+                               uint64_t generation, char *err, size_t err_len);
+zone_db_t * zone_db_apply_rrs(zone_db_t *base, const rr_record_t *rrs, size_t rrs_count,
+                              uint64_t generation, char *err, size_t err_len);
+zone_db_t * zone_db_ref(zone_db_t *db);
+zone_db_t * zone_db_image_load(int fd, size_t len, uint64_t generation,
+                               char *err, size_t err_len);
+int         zone_db_image_write(zone_db_t *db, const char *filepath,
+                                char *err, size_t err_len);
+bool        zone_image_is(const void *buf, size_t buf_len);
+void zone_db_release(zone_db_t *db);
+size_t zone_db_prefault(zone_db_t *db);
+size_t zone_db_memory(zone_db_t *db);
+int    zone_db_mlock(zone_db_t *db, size_t *locked);
+
+zone_node_t  * zone_db_lookup(zone_db_t *db, const unsigned char *name,
+                              uint16_t name_len);
+zone_node_t  * zone_db_lookup_hash(zone_db_t *db, const unsigned char *name,
+                                   uint16_t name_len, uint64_t name_hash);
+int            zone_db_tree_build(zone_db_t *db, char *err, size_t err_len);
+void           zone_db_match(zone_db_t *db, const unsigned char *name,
+                             uint16_t name_len, zone_match_t *match);
+void           zone_db_match_hash(zone_db_t *db, const unsigned char *name,
+                                  uint16_t name_len, uint64_t name_hash,
+                                  zone_match_t *match);
+zone_rrset_t * zone_node_rrset_get(zone_db_t *db, zone_node_t *node, uint16_t type);
+int            zone_db_xfr_compile(zone_db_t *db, char *err, size_t err_len);
+const zone_xfr_t * zone_db_xfr_find(zone_db_t *db, const zone_node_t *apex);
+const zone_synth_t * zone_db_synth(zone_db_t *db, const unsigned char *name,
+                                   uint16_t name_len, rr_record_t *rr, uint8_t *rdata);
+bool zone_synth_valid(const zone_synth_t *rule);
+
+size_t zone_db_denial_size(zone_db_t *db);
+void   zone_db_denial_build(zone_db_t *db);
+const zone_denial_t * zone_db_denial(zone_db_t *db, const zone_node_t *apex);
+zone_node_t * zone_db_nsec_cover(zone_db_t *db, const zone_node_t *apex,
+                                 const unsigned char *name, uint16_t name_len);
+zone_node_t * zone_db_nsec3_cover(zone_db_t *db, const zone_node_t *apex,
+                                  const uint8_t *hash, bool *match);
+int  zone_name_canonical_cmp(const unsigned char *a, uint16_t a_len,
+                             const unsigned char *b, uint16_t b_len);
+int  zone_base32hex_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_len);
+void zone_nsec3_hash(const zone_denial_t *denial, const unsigned char *name,
+                     uint16_t name_len, uint8_t *hash);
+int  zone_nsec3_cache_init(zone_nsec3_cache_t *cache, uint32_t size);
+void zone_nsec3_cache_clean(zone_nsec3_cache_t *cache);
+void zone_nsec3_hash_cached(zone_nsec3_cache_t *cache, zone_db_t *db,
+                            const zone_denial_t *denial, const unsigned char *name,
+                            uint16_t name_len, uint8_t *hash);
+
+const unsigned char * zone_rr_rdata_target(rr_record_t *rr);
+
+/** Get negative TTL of SOA record, TTL of SOA record in negative responses,
+ * which is lower of SOA record TTL and SOA minimum field (RFC 2308).
+ *
+ * @param rr SOA resource record.
+ *
+ * @return   Returns negative TTL.
+ */
+static inline uint32_t
+zone_soa_negative_ttl(const rr_record_t *rr)
+{
+    const uint8_t *p       = rr->rdata + rr->rdata_len - sizeof(uint32_t);
+    uint32_t       minimum = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                             ((uint32_t)p[2] << 8) | p[3];
+
+    return rr->ttl < minimum ? rr->ttl : minimum;
+}
+
+/** Prefetch zone database name filter entries @ref zone_db_match_hash tests
+ * name hash against first.
+ *
+ * @param db        Zone database to be searched.
+ * @param name_hash Hash of name, as returned by @ref rip_ns_name_hash.
+ */
+static inline void
+zone_db_prefetch(zone_db_t *db, uint64_t name_hash)
+{
+    xor_filter_prefetch(&db->filter, name_hash);
+}
+
+#endif /* End of ZONE_H */
+
+/** @}*/
@@ -0,0 +1,212 @@
+/**
+ * @file zone_catalog.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup zone_catalog Zone Catalog
+ *
+ * @brief Zone catalog serves many independently updated zones, e.g. hosted
+ *        customer zones, without a change to one zone rebuilding all of them.
+ *        Each zone is a zone database of its own (see @ref zone), built from
+ *        its own zone file or zone image, with a generation of its own.
+ *
+ *        Catalog has two levels. Apex index, a hash table of zone apex names
+ *        mapping each to its zone number, is rebuilt only when catalog file,
+ *        and so set of zones, changes. Zone databases are held in pages of
+ *        @ref ZONE_CATALOG_PAGE_ZONES pointers. A catalog generation
+ *        references apex index and pages, and everything it did not change
+ *        is shared with generation it was derived from by reference count.
+ *        Reload of a changed zone file builds zone database of that zone,
+ *        a copy of its page and a copy of page array, so reload CPU and
+ *        memory churn stay proportional to change, not to number of zones.
+ *
+ *        Like zone database, a catalog generation is never modified once
+ *        built, it is published to vectorloops through resource set. Query
+ *        name is matched to its zone by probing apex index with name and
+ *        each of its ancestors, longest first, skipping names with more
+ *        labels than longest apex name has. Zone found is answered from its
+ *        zone database, names outside all catalog zones are answered from
+ *        main zone database.
+ *
+ *        Catalog file format is one zone per line:
+ *
+ *            <apex> <zone file>
+ *
+ *        Zone file is a zone file or zone image and MUST have a SOA record
+ *        at apex. Text following a ';' character is a comment.
+ *
+ *  @{
+ */
+#ifndef ZONE_CATALOG_H
+#define ZONE_CATALOG_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "rip_ns_utils.h"
+#include "zone.h"
+
+/** Number of zone database pointers in a zone catalog page. */
+#define ZONE_CATALOG_PAGE_ZONES 256
+
+/** Maximum number of zones catalog file can declare. */
+#define ZONE_CATALOG_ZONES_MAX (1 << 24)
+
+/** Bit set in generation of each catalog zone database, so it never equals
+ * generation of main zone database or of a view zone database. Catalog
+ * generation is in bits above 32 and zone number in lower ones.
+ */
+#define ZONE_CATALOG_GENERATION_BIT (1ULL << 63)
+
+/** Function checks zone file of a catalog zone for change and if changed
+ * loads its zone database.
+ *
+ * @param ctx         Context passed to catalog function along with load
+ *                    function.
+ * @param filepath    Path of zone file.
+ * @param create_time Change time of zone file last loaded, zero if zone was
+ *                    not loaded, updated on change.
+ * @param generation  Generation number to assign to zone database.
+ * @param db          Where to store loaded zone database, on change.
+ * @param err         Where to store error message.
+ * @param err_len     Length of err buffer.
+ *
+ * @return            1 - Zone file changed and zone database was loaded.
+ *                    0 - Zone file has not changed.
+ *                   -1 - Error, err is populated.
+ */
+typedef int (*zone_catalog_zone_load_fn)(void *ctx, const char *filepath,
+                                         struct timespec *create_time,
+                                         uint64_t generation, zone_db_t **db,
+                                         char *err, size_t err_len);
+
+/** Structure describes a zone of zone catalog apex index. */
+typedef struct zone_catalog_zone_s {
+    /** Hash of zone apex name, see @ref zone_name_hash. */
+    uint32_t hash;
+
+    /** Offset of wire format (lower cased) apex name in index names buffer. */
+    uint32_t name_offset;
+
+    /** Offset of zone file path in index paths buffer. */
+    uint32_t path_offset;
+
+    /** Length of apex name, including terminating root label. */
+    uint16_t name_len;
+} zone_catalog_zone_t;
+
+/** Structure describes zone catalog apex index, built when catalog file
+ * changes and shared by catalog generations derived from it.
+ */
+typedef struct zone_catalog_index_s {
+    /** Hash table. Each entry holds (zone number + 1), 0 marks an empty
+     * slot.
+     */
+    uint32_t *table;
+
+    /** Hash table mask, table size is (table_mask + 1) which is a power of 2. */
+    uint32_t table_mask;
+
+    /** Array of zones, indexed by zone number, in catalog file order. */
+    zone_catalog_zone_t *zones;
+
+    /** Number of entries in zones array. */
+    uint32_t zones_count;
+
+    /** Largest number of labels of an apex name, not counting root label. */
+    uint8_t labels_max;
+
+    /** Smallest number of labels of an apex name, not counting root label. */
+    uint8_t labels_min;
+
+    /** Reference count, only resource thread takes and drops references. */
+    uint32_t refs;
+
+    /** Buffer holding wire format (lower cased) apex names. */
+    unsigned char *names;
+
+    /** Buffer holding '\0' terminated zone file paths. */
+    char *paths;
+} zone_catalog_index_t;
+
+/** Structure describes a zone catalog page, zone databases of
+ * @ref ZONE_CATALOG_PAGE_ZONES consecutive zone numbers.
+ */
+typedef struct zone_catalog_page_s {
+    /** Zone database of each zone, NULL if zone could not be loaded yet. */
+    zone_db_t *dbs[ZONE_CATALOG_PAGE_ZONES];
+
+    /** Change time of zone file each zone database was loaded from. */
+    struct timespec create_times[ZONE_CATALOG_PAGE_ZONES];
+
+    /** Reference count, only resource thread takes and drops references. */
+    uint32_t refs;
+} zone_catalog_page_t;
+
+/** Structure describes a zone catalog generation. Once created it is read
+ * only.
+ */
+typedef struct zone_catalog_s {
+    /** Generation number of catalog, assigned at creation. */
+    uint64_t generation;
+
+    /** Apex index. */
+    zone_catalog_index_t *index;
+
+    /** Array of pages, page k holds zones from k * ZONE_CATALOG_PAGE_ZONES. */
+    zone_catalog_page_t **pages;
+
+    /** Number of entries in pages array. */
+    uint32_t pages_count;
+
+    /** Number of zone databases this generation loaded. */
+    uint32_t loaded;
+} zone_catalog_t;
+
+zone_catalog_t * zone_catalog_create(const char *buf, size_t buf_len,
+                                     const zone_catalog_t *prev, uint64_t generation,
+                                     zone_catalog_zone_load_fn zone_load, void *ctx,
+                                     char *err, size_t err_len);
+zone_catalog_t * zone_catalog_refresh(const zone_catalog_t *catalog, uint64_t generation,
+                                      zone_catalog_zone_load_fn zone_load, void *ctx,
+                                      char *err, size_t err_len);
+void             zone_catalog_release(zone_catalog_t *catalog);
+uint32_t         zone_catalog_find(const zone_catalog_t *catalog,
+                                   const unsigned char *name, uint16_t name_len);
+
+/** Get zone database of a catalog zone.
+ *
+ * @param catalog Zone catalog.
+ * @param zone    Zone number + 1, as returned by @ref zone_catalog_find.
+ *
+ * @return        Returns zone database, NULL if zone was not loaded.
+ */
+static inline zone_db_t *
+zone_catalog_db(const zone_catalog_t *catalog, uint32_t zone)
+{
+    zone -= 1;
+    return catalog->pages[zone / ZONE_CATALOG_PAGE_ZONES]->dbs[zone % ZONE_CATALOG_PAGE_ZONES];
+}
+
+#endif /* End of ZONE_CATALOG_H */
+
+/** @}*/
@@ -0,0 +1,250 @@
+/**
+ * @file zone_secondary.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup zone_secondary Secondary zones
+ *
+ * @brief These are functions that keep secondary zones, zones transferred
+ *        (AXFR, IXFR) from zone primary rather than loaded from zone file,
+ *        up to date.
+ *
+ *        Transfers are done by a dedicated transfer thread, see
+ *        @ref zone_secondary_loop(). It transfers each zone at startup, and
+ *        again once its SOA refresh interval elapses, or right away when
+ *        primary sends NOTIFY for it (RFC 1996). Vectorloops only flag the
+ *        zone and wake transfer thread, see @ref zone_secondary_notify(),
+ *        they never wait on it.
+ *
+ *        Transferred records are handed to resource thread as updates. It
+ *        applies them on top of zone database it last published, compiling
+ *        only nodes they change (see @ref zone_db_apply_rrs()), and
+ *        publishes new zone database generation to vectorloops, see
+ *        @ref zone_secondary_db_update(). Incremental transfer that does not
+ *        apply to published zone makes transfer thread fall back to full
+ *        zone transfer.
+ *  @{
+ */
+#ifndef ZONE_SECONDARY_H
+#define ZONE_SECONDARY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "resource.h"
+#include "rip_ns_utils.h"
+#include "rr_record.h"
+#include "zone.h"
+
+/** Structure describes a block secondary zone update records are stored
+ * in, records point into blocks so they do not move as update grows.
+ */
+typedef struct zone_secondary_block_s {
+    /** Next block, NULL if there is none. */
+    struct zone_secondary_block_s *next;
+
+    /** Length of data in block. */
+    size_t len;
+
+    /** Block data, owner names and RDATA of records. */
+    uint8_t data[ZONE_SECONDARY_BLOCK_SIZE];
+} zone_secondary_block_t;
+
+/** Structure describes records of a secondary zone transfer, handed from
+ * transfer thread to resource thread.
+ */
+typedef struct zone_secondary_update_s {
+    /** Next update, updates are queued as a stack. */
+    struct zone_secondary_update_s *next;
+
+    /** Index of zone update is for. */
+    size_t zone;
+
+    /** Set if records are full zone (AXFR), otherwise records are changes
+     * (IXFR) in transfer order, class NONE record deletes record.
+     */
+    bool full;
+
+    /** Zone serial after update. */
+    uint32_t serial;
+
+    /** Records, owner names in presentation format. */
+    rr_record_t *rrs;
+
+    /** Number of entries in rrs array. */
+    size_t rrs_count;
+
+    /** Size of rrs array. */
+    size_t rrs_size;
+
+    /** Blocks records point into, last one added is first. */
+    zone_secondary_block_t *blocks;
+} zone_secondary_update_t;
+
+/** Structure describes a secondary zone. */
+typedef struct zone_secondary_zone_s {
+    /** Zone wire format (lower cased) name. */
+    unsigned char name[RIP_NS_MAXCDNAME];
+
+    /** Length of zone wire format name. */
+    uint16_t name_len;
+
+    /** Zone name in presentation format, for log messages. */
+    char text[RIP_NS_MAXCDNAME * 4 + 1];
+
+    /** Set once zone was transferred, serial is valid and next transfer is
+     * incremental. Transfer thread only.
+     */
+    bool loaded;
+
+    /** Zone serial last transferred. Transfer thread only. */
+    uint32_t serial;
+
+    /** Monotonic time in microseconds zone is refreshed at. Transfer thread
+     * only.
+     */
+    uint64_t refresh_us;
+
+    /** Seconds to wait before retrying failed transfer, SOA retry value.
+     * Transfer thread only.
+     */
+    uint32_t retry;
+
+    /** Set once zone records are in published zone database. Resource
+     * thread only.
+     */
+    bool applied;
+
+    /** Set when an update did not apply, incremental updates are skipped
+     * until a full one. Resource thread only.
+     */
+    bool broken;
+
+    /** Set by vectorloop that received NOTIFY for zone. */
+    atomic_bool notified;
+
+    /** Set by resource thread when an update did not apply, so transfer
+     * thread does full zone transfer.
+     */
+    atomic_bool failed;
+} zone_secondary_zone_t;
+
+/** Secondary zones state, shared by vectorloops, transfer and resource
+ * threads.
+ */
+typedef struct zone_secondary_s {
+    /** Secondary zones. */
+    zone_secondary_zone_t *zones;
+
+    /** Number of entries in zones array. */
+    size_t zones_count;
+
+    /** Zone primary NOTIFY is accepted from. */
+    utl_net_t primary_net;
+
+    /** Zone primary socket address zones are transferred from. */
+    struct sockaddr_storage primary;
+
+    /** Length of primary socket address. */
+    socklen_t primary_len;
+
+    /** Eventfd that wakes transfer thread, see @ref zone_secondary_notify(). */
+    int notify_fd;
+
+    /** Resource set zone database is published to, its resource thread is
+     * woken when there are updates.
+     */
+    resource_set_t *resources;
+
+    /** Updates resource thread has yet to apply, newest first. */
+    _Atomic(zone_secondary_update_t *) updates;
+} zone_secondary_t;
+
+/** Structure holds state of a zone transfer response being parsed, see
+ * @ref zone_secondary_xfr_parse().
+ */
+typedef struct zone_secondary_xfr_s {
+    /** Update transferred records are added to. */
+    zone_secondary_update_t *update;
+
+    /** Set if transfer was requested as IXFR. */
+    bool ixfr;
+
+    /** Zone serial secondary has, IXFR is requested from. */
+    uint32_t serial;
+
+    /** Number of answer records parsed so far. */
+    size_t rr_count;
+
+    /** Set once response is known to be incremental. */
+    bool incremental;
+
+    /** Set while parsing deleted records of an incremental response. */
+    bool del;
+
+    /** Set if response is a single SOA record, zone is up to date. */
+    bool current;
+
+    /** SOA refresh value of transferred zone. */
+    uint32_t refresh;
+
+    /** SOA retry value of transferred zone. */
+    uint32_t retry;
+} zone_secondary_xfr_t;
+
+/** Structure holds arguments passed to @ref zone_secondary_loop function. */
+typedef struct zone_secondary_loop_args_s {
+    /** Secondary zones state. */
+    zone_secondary_t *secondary;
+
+    /** Application log channel. */
+    channel_log_t *app_log_channel;
+} zone_secondary_loop_args_t;
+
+int    zone_secondary_init(zone_secondary_t *zs, config_t *cfg, resource_set_t *resources,
+                           char *err, size_t err_len);
+void   zone_secondary_clean(zone_secondary_t *zs);
+bool   zone_secondary_notify(zone_secondary_t *zs, const unsigned char *name,
+                             uint16_t name_len, const struct sockaddr_storage *client_ip);
+void * zone_secondary_loop(void *args);
+
+zone_secondary_update_t * zone_secondary_update_new(size_t zone, bool full);
+void   zone_secondary_update_free(zone_secondary_update_t *update);
+void   zone_secondary_update_add(zone_secondary_update_t *update, const char *name,
+                                 uint16_t type, uint16_t class, uint32_t ttl,
+                                 const uint8_t *rdata, uint16_t rdata_len);
+void   zone_secondary_update_push(zone_secondary_t *zs, zone_secondary_update_t *update);
+int    zone_secondary_xfr_parse(zone_secondary_t *zs, zone_secondary_xfr_t *xfr,
+                                const uint8_t *msg, size_t msg_len,
+                                char *err, size_t err_len);
+
+zone_db_t * zone_secondary_db_update(zone_secondary_t *zs, zone_db_t *current,
+                                     zone_db_t *db, uint64_t *generation);
+
+#endif /* End of ZONE_SECONDARY_H */
+
+/** @}*/
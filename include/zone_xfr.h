@@ -0,0 +1,114 @@
+/**
+ * @file zone_xfr.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup zone_xfr Zone Transfer
+ *
+ * @brief Zone transfer stream sends a zone, precompiled into zone transfer
+ *        messages when zone image was compiled (see @ref zone_db_xfr_compile),
+ *        to a TCP connection.
+ *
+ *        Stream is independent of zone database generation it was started
+ *        from, it holds a duplicate of zone image file descriptor and a copy
+ *        of zone transfer message table, so vectorloop does not hold zone
+ *        database across loop iterations and a reload does not cut transfers
+ *        in progress short. Each message is its length prefix, header and a
+ *        copy of request question sent from stream buffer with send(), and
+ *        message answer section sent from zone image file with sendfile(),
+ *        which kernel copies from page cache without it passing through user
+ *        space (and encrypts if connection is DoT with kernel TLS).
+ *
+ *        Stream is sent in steps, each step sends at most a budget of bytes
+ *        and never blocks, so a large transfer is spread over many vectorloop
+ *        iterations.
+ *  @{
+ */
+#ifndef ZONE_XFR_H
+#define ZONE_XFR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "rip_ns_utils.h"
+#include "zone.h"
+
+/** Maximum length of zone transfer message head, TCP length prefix, header
+ * and question.
+ */
+#define ZONE_XFR_HEAD_MAX (RIP_NS_INT16SZ + sizeof(rip_ns_header_t) + RIP_NS_MAXCDNAME + \
+                           RIP_NS_QFIXEDSZ)
+
+/** Structure describes a zone transfer in progress. */
+typedef struct zone_xfr_stream_s {
+    /** Zone image file descriptor (duplicate) messages are sent from. */
+    int fd;
+
+    /** Offset of zone transfer data in zone image file. */
+    uint64_t data_offset;
+
+    /** Copy of zone transfer message table. */
+    zone_xfr_msg_t *msgs;
+
+    /** Number of messages. */
+    uint32_t msg_count;
+
+    /** Index of message being sent. */
+    uint32_t msg_next;
+
+    /** Number of bytes of message being sent already sent, head first, then
+     * answer section.
+     */
+    uint32_t msg_pos;
+
+    /** Length of message head. */
+    uint16_t head_len;
+
+    /** Length of question in head. */
+    uint16_t question_len;
+
+    /** Message head of message being sent, header is patched per message. */
+    uint8_t head[ZONE_XFR_HEAD_MAX];
+} zone_xfr_stream_t;
+
+zone_xfr_stream_t * zone_xfr_stream_new(zone_db_t *db, const zone_xfr_t *xfr,
+                                        const uint8_t *request, uint16_t question_len);
+ssize_t             zone_xfr_stream_send(zone_xfr_stream_t *s, int sock_fd, size_t budget);
+void                zone_xfr_stream_free(zone_xfr_stream_t *s);
+
+/** Check whether all messages of zone transfer stream were sent.
+ *
+ * @param s Zone transfer stream.
+ *
+ * @return  Returns true if stream is done.
+ */
+static inline bool
+zone_xfr_stream_done(const zone_xfr_stream_t *s)
+{
+    return s->msg_next == s->msg_count;
+}
+
+#endif /* End of ZONE_XFR_H */
+
+/** @}*/
@@ -0,0 +1,106 @@
+/**
+ * @file acl.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup acl
+ *  @{
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acl.h"
+#include "utils.h"
+
+/** ACL action names, wire format labels (length byte followed by label),
+ * indexed by action.
+ */
+static const char *acl_action_names[ACL_ACTION_COUNT] = {
+    [ACL_ACTION_ALLOW]  = "\005allow",
+    [ACL_ACTION_REFUSE] = "\006refuse",
+    [ACL_ACTION_DROP]   = "\004drop",
+};
+
+/** Create client ACL from ACL file contents.
+ *
+ * @param buf        ACL file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to ACL.
+ * @param err        Where to store error message if ACL can not be created.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to ACL on success, otherwise NULL is
+ *                   returned and err is populated.
+ */
+acl_t *
+acl_create(const char *buf, size_t buf_len, uint64_t generation, char *err, size_t err_len)
+{
+    acl_t   *acl = NULL;
+    uint16_t i;
+    int      a;
+
+    acl = calloc(1, sizeof(acl_t));
+    CHECK_MALLOC(acl);
+    acl->generation = generation;
+    acl->actions[0] = ACL_ACTION_ALLOW;
+
+    if ((acl->table = ecs_map_create(buf, buf_len, generation, err, err_len)) == NULL) {
+        goto ERR_END;
+    }
+    /* Table numbers actions (views) in order they first appear in file. */
+    for (i = 0; i < acl->table->views_count; i++) {
+        const unsigned char *label = acl->table->views[i];
+
+        for (a = 0; a < ACL_ACTION_COUNT; a++) {
+            if (memcmp(label, acl_action_names[a], label[0] + 1) == 0) {
+                break;
+            }
+        }
+        if (a == ACL_ACTION_COUNT) {
+            snprintf(err, err_len, "invalid action \"%.*s\"", label[0], label + 1);
+            goto ERR_END;
+        }
+        acl->actions[i + 1] = a;
+    }
+    return acl;
+
+ERR_END:
+    acl_release(acl);
+    return NULL;
+}
+
+/** Release client ACL.
+ *
+ * @param acl ACL to release.
+ */
+void
+acl_release(acl_t *acl)
+{
+    if (acl == NULL) {
+        return;
+    }
+    ecs_map_release(acl->table);
+    free(acl);
+}
+
+/** @}*/
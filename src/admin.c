@@ -0,0 +1,219 @@
+/**
+ * @file admin.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup admin
+ *  @{
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "admin.h"
+#include "utils.h"
+
+/** Names of vectorloop state snapshot values, indexed by
+ * @ref admin_vl_field_t.
+ */
+static const char *admin_vl_field_names[ADMIN_VL_FIELDS] = {
+    [ADMIN_VL_ITERATIONS]               = "iterations",
+    [ADMIN_VL_LOOP_TIME_MS]             = "loop_time_ms",
+    [ADMIN_VL_ITERATION_CYCLES]         = "iteration_cycles",
+    [ADMIN_VL_IDLE_COUNT]               = "idle_count",
+    [ADMIN_VL_OVERLOAD_LEVEL]           = "overload_level",
+    [ADMIN_VL_DRAINING]                 = "draining",
+    [ADMIN_VL_CONNS_TCP_ACTIVE]         = "conns_tcp_active",
+    [ADMIN_VL_CONNS_TCP_MAX]            = "conns_tcp_max",
+    [ADMIN_VL_UDP_READ_QUEUE]           = "udp_read_queue",
+    [ADMIN_VL_UDP_WRITE_QUEUE]          = "udp_write_queue",
+    [ADMIN_VL_TCP_READ_QUEUE]           = "tcp_read_queue",
+    [ADMIN_VL_TCP_WRITE_QUEUE]          = "tcp_write_queue",
+    [ADMIN_VL_QUERY_PARSE_QUEUE]        = "query_parse_queue",
+    [ADMIN_VL_QUERY_RESOLVE_QUEUE]      = "query_resolve_queue",
+    [ADMIN_VL_RESPONSE_PACK_QUEUE]      = "response_pack_queue",
+    [ADMIN_VL_QUERY_LOG_QUEUE]          = "query_log_queue",
+    [ADMIN_VL_QUERY_LOG_BUF_LEN]        = "query_log_buf_len",
+    [ADMIN_VL_QUERY_LOG_BUF_SIZE]       = "query_log_buf_size",
+    [ADMIN_VL_QUERY_LOG_CHUNKS_PENDING] = "query_log_chunks_pending",
+    [ADMIN_VL_QUERY_LOG_CHUNK_COUNT]    = "query_log_chunk_count",
+    [ADMIN_VL_ZONE_DB_GENERATION]       = "zone_db_generation",
+    [ADMIN_VL_CONFIG_GENERATION]        = "config_generation",
+};
+
+/** Allocate zeroed state snapshots for vectorloops, each on cache lines of
+ * its own.
+ *
+ * @param count Number of vectorloops.
+ *
+ * @return      Returns array of state snapshots, indexed by vectorloop ID.
+ */
+admin_vl_state_t *
+admin_vl_states_new(size_t count)
+{
+    admin_vl_state_t *states;
+
+    states = aligned_alloc(CACHE_LINE_SIZE, sizeof(admin_vl_state_t) * count);
+    CHECK_MALLOC(states);
+    for (size_t i = 0; i < count; i++) {
+        atomic_init(&states[i].seq, 0);
+        for (size_t j = 0; j < ADMIN_VL_FIELDS; j++) {
+            atomic_init(&states[i].values[j], 0);
+        }
+    }
+    return states;
+}
+
+/** Read a consistent copy of vectorloop state snapshot. Read is retried
+ * while vectorloop is publishing, at most @ref ADMIN_VL_READ_RETRIES times.
+ *
+ * @param s      State snapshot of vectorloop.
+ * @param values Where to store ADMIN_VL_FIELDS values.
+ *
+ * @return       Returns 0 on success, -1 if no consistent copy was read, in
+ *               which case values hold a torn copy.
+ */
+int
+admin_vl_read(admin_vl_state_t *s, uint64_t *values)
+{
+    unsigned int seq;
+
+    for (int i = 0; i < ADMIN_VL_READ_RETRIES; i++) {
+        seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        for (size_t j = 0; j < ADMIN_VL_FIELDS; j++) {
+            values[j] = atomic_load_explicit(&s->values[j], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if ((seq & 1) == 0 &&
+            atomic_load_explicit(&s->seq, memory_order_relaxed) == seq) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/** Format state of vectorloops as text, a line per vectorloop of its ID
+ * followed by "name=value" pairs. Vectorloop whose snapshot could not be
+ * read consistently has "torn=1" appended.
+ *
+ * @param states  State snapshots of vectorloops.
+ * @param count   Number of vectorloops.
+ * @param buf     Buffer to format into.
+ * @param buf_len Length of buffer.
+ *
+ * @return        Returns length of text, text is truncated (and terminated)
+ *                if it does not fit buffer.
+ */
+size_t
+admin_vl_format(admin_vl_state_t *states, size_t count, char *buf, size_t buf_len)
+{
+    uint64_t values[ADMIN_VL_FIELDS];
+    size_t   len = 0;
+    bool     torn;
+
+    for (size_t i = 0; i < count && len < buf_len; i++) {
+        torn = admin_vl_read(&states[i], values) != 0;
+        len += snprintf(buf + len, buf_len - len, "vl=%zu", i);
+        for (size_t j = 0; j < ADMIN_VL_FIELDS && len < buf_len; j++) {
+            len += snprintf(buf + len, buf_len - len, " %s=%" PRIu64,
+                            admin_vl_field_names[j], values[j]);
+        }
+        if (len < buf_len) {
+            len += snprintf(buf + len, buf_len - len, "%s\n", torn ? " torn=1" : "");
+        }
+    }
+    return len < buf_len ? len : buf_len - 1;
+}
+
+/** Admin loop function. It listens on Unix socket set with "admin_socket"
+ * and writes state of vectorloops to each client that connects, one client
+ * at a time. It only reads state snapshots, vectorloops are never blocked by
+ * it.
+ *
+ * @note This loop runs indefinitely and is meant to be run on its own thread.
+ *
+ * @param args Object with arguments passed to admin loop.
+ *
+ * @return     Returns a NULL pointer only because it needs to abide by
+ *             pthread API.
+ */
+void *
+admin_loop(void *args)
+{
+    admin_loop_args_t  *a_args          = (admin_loop_args_t *)args;
+    channel_log_t      *app_log_channel = a_args->app_log_channel;
+    const char         *path            = a_args->cfg->admin_socket;
+    struct timeval      tv              = { .tv_sec = ADMIN_CLIENT_TIMEOUT };
+    struct sockaddr_un  sun             = { .sun_family = AF_UNIX };
+    size_t              buf_size        = a_args->vl_count * ADMIN_VL_LINE_MAX;
+    char               *buf;
+    size_t              len;
+    char                err[ERR_MSG_LENGTH];
+    int                 listen_fd       = -1;
+    int                 fd;
+
+    buf = malloc(buf_size);
+    CHECK_MALLOC(buf);
+
+    /* Socket left by a process that exited is replaced. */
+    if (strlen(path) < sizeof(sun.sun_path)) {
+        strcpy(sun.sun_path, path);
+        unlink(path);
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    } else {
+        errno = ENAMETOOLONG;
+    }
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&sun, sizeof(sun)) != 0 ||
+        listen(listen_fd, ADMIN_LISTEN_BACKLOG) != 0) {
+        channel_log_send(app_log_channel, 0, false,
+                         "Admin, error listening on admin socket \"%s\": %s",
+                         path, strerror(errno));
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        free(buf);
+        return NULL;
+    }
+
+    while (1) {
+        fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        len = admin_vl_format(a_args->vl_states, a_args->vl_count, buf, buf_size);
+        utl_writeall(fd, buf, len, err, ERR_MSG_LENGTH);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/** @}*/
@@ -0,0 +1,131 @@
+/**
+ * @file arena.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup arena
+ *  @{
+ */
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "utils.h"
+
+/** Initialize an arena, map its memory.
+ *
+ * @param arena Arena to initialize.
+ * @param size  Size of arena in bytes.
+ * @param flags Bitwise OR of @ref ARENA_HUGETLB, @ref ARENA_THP and
+ *              @ref ARENA_PREFAULT. If explicit huge pages are requested but
+ *              none are available arena is backed by regular pages, which is
+ *              reflected in arena hugetlb field.
+ *
+ * @return      Returns 0 on success, otherwise -errno of failed mmap().
+ */
+int
+arena_init(arena_t *arena, size_t size, int flags)
+{
+    void  *base = MAP_FAILED;
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    *arena = (arena_t) { };
+
+    if (flags & ARENA_HUGETLB) {
+        size_t hsize = (size + ARENA_HUGETLB_SIZE - 1) & ~((size_t)ARENA_HUGETLB_SIZE - 1);
+
+        base = mmap(NULL, hsize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            size           = hsize;
+            page           = ARENA_HUGETLB_SIZE;
+            arena->hugetlb = true;
+        }
+    }
+    if (base == MAP_FAILED) {
+        size = (size + page - 1) & ~(page - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return -errno;
+        }
+        if (flags & ARENA_THP) {
+            utl_madvise_hugepages(base, size);
+        }
+    }
+
+    /* Touch every page, after advise so transparent huge pages are faulted
+     * in if available.
+     */
+    if (flags & ARENA_PREFAULT) {
+        for (size_t offset = 0; offset < size; offset += page) {
+            ((volatile unsigned char *)base)[offset] = 0;
+        }
+    }
+
+    arena->base = base;
+    arena->size = size;
+
+    return 0;
+}
+
+/** Release arena memory, all objects allocated from it are released. Arena
+ * object it self is not freed.
+ *
+ * @param arena Arena to clean.
+ */
+void
+arena_clean(arena_t *arena)
+{
+    if (arena->base != NULL) {
+        munmap(arena->base, arena->size);
+    }
+    *arena = (arena_t) { };
+}
+
+/** Allocate object from arena. Object is cache line aligned and zero filled,
+ * it takes @ref ARENA_OBJ_SIZE of arena space.
+ *
+ * @param arena Arena to allocate from.
+ * @param size  Size of object.
+ *
+ * @return      Returns pointer to object, NULL if arena does not have enough
+ *              space left.
+ */
+void *
+arena_alloc(arena_t *arena, size_t size)
+{
+    size_t obj_size = ARENA_OBJ_SIZE(size);
+    void  *obj      = NULL;
+
+    if (arena->base == NULL || obj_size > arena->size - arena->used) {
+        return NULL;
+    }
+    obj          = arena->base + arena->used;
+    arena->used += obj_size;
+
+    return obj;
+}
+
+/** @}*/
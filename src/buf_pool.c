@@ -0,0 +1,147 @@
+/**
+ * @file buf_pool.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup buf_pool
+ *  @{
+ */
+#include <stdlib.h>
+
+#include "buf_pool.h"
+#include "utils.h"
+
+/** Initialize buffer pool. Size classes start at size_min and double up to
+ * size_max, last size class is size_max in size. No buffers are allocated
+ * until first requested.
+ *
+ * @param pool     Buffer pool to initialize.
+ * @param size_min Size of smallest size class buffers, at least size of a
+ *                 pointer.
+ * @param size_max Size of largest size class buffers.
+ * @param free_max Maximum number of free buffers a size class keeps.
+ * @param tag      Memory tag buffers are accounted to, see @ref mem.
+ */
+void
+buf_pool_init(buf_pool_t *pool, size_t size_min, size_t size_max, size_t free_max,
+              mem_tag_t tag)
+{
+    size_t size = size_min;
+
+    *pool = (buf_pool_t) {
+        .free_max = free_max,
+        .tag      = tag,
+    };
+
+    while (pool->classes_count < BUF_POOL_CLASSES_MAX) {
+        if (size >= size_max || pool->classes_count == BUF_POOL_CLASSES_MAX - 1) {
+            size = size_max;
+        }
+        pool->classes[pool->classes_count++].size = size;
+        if (size == size_max) {
+            break;
+        }
+        size <<= 1;
+    }
+}
+
+/** Clean buffer pool. This frees all buffers in pool free lists, buffers
+ * handed out are not freed.
+ *
+ * @param pool Buffer pool to clean.
+ */
+void
+buf_pool_clean(buf_pool_t *pool)
+{
+    for (int i = 0; i < pool->classes_count; i++) {
+        void *buf;
+
+        while ((buf = pool->classes[i].free_head) != NULL) {
+            pool->classes[i].free_head = *(void **)buf;
+            mem_free(pool->tag, buf);
+        }
+    }
+    *pool = (buf_pool_t) {};
+}
+
+/** Get a buffer from buffer pool. Buffer is of smallest size class that holds
+ * size bytes, taken from size class free list or newly allocated if free list
+ * is empty.
+ *
+ * @param pool     Buffer pool to get buffer from.
+ * @param size     Minimum size of buffer.
+ * @param buf_size Set to size of returned buffer, which is to be passed to
+ *                 @ref buf_pool_put() when buffer is returned.
+ *
+ * @return         Returns buffer, or NULL if size exceeds largest size class.
+ */
+void *
+buf_pool_get(buf_pool_t *pool, size_t size, size_t *buf_size)
+{
+    for (int i = 0; i < pool->classes_count; i++) {
+        buf_pool_class_t *class = &pool->classes[i];
+        void             *buf   = class->free_head;
+
+        if (class->size < size) {
+            continue;
+        }
+        if (buf != NULL) {
+            class->free_head = *(void **)buf;
+            class->free_count--;
+        } else {
+            buf = mem_malloc(pool->tag, class->size);
+            CHECK_MALLOC(buf);
+        }
+        *buf_size = class->size;
+        return buf;
+    }
+    return NULL;
+}
+
+/** Return buffer to buffer pool. If its size class free list is full buffer
+ * is freed instead.
+ *
+ * @param pool     Buffer pool buffer was taken from.
+ * @param buf      Buffer to return.
+ * @param buf_size Size of buffer, as set by @ref buf_pool_get().
+ */
+void
+buf_pool_put(buf_pool_t *pool, void *buf, size_t buf_size)
+{
+    for (int i = 0; i < pool->classes_count; i++) {
+        buf_pool_class_t *class = &pool->classes[i];
+
+        if (class->size != buf_size) {
+            continue;
+        }
+        if (class->free_count >= pool->free_max) {
+            break;
+        }
+        *(void **)buf    = class->free_head;
+        class->free_head = buf;
+        class->free_count++;
+        return;
+    }
+    mem_free(pool->tag, buf);
+}
+
+/** @}*/
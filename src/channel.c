@@ -22,203 +22,367 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-#include <assert.h>
-
-#include <liblfds711.h>
+/** \ingroup channels
+ *  @{
+ */
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
 
 #include "channel.h"
-#include "utils.h"
 
-/** Create a bss channel message object.
- * 
- * @param id Message ID
- * @param op Message operation, see @ref channel_bss_ops_t.
- * @param p  Pointer to data this message applies to.
+/** Initialize a log channel, channel starts empty.
  * 
- * @return   On success returns pointer to newly created message. Caller
- *           is responsible for releasing the message via @ref
- *           channel_bss_msg_release once message is no longer needed.
+ * @param ch      Channel to initialize.
+ * @param wake_fd Eventfd to wake up logging thread with, or -1 if logging
+ *                thread polls channel.
  */
-channel_bss_msg_t *
-channel_bss_msg_create(uint64_t id, channel_bss_ops_t op, void *p)
+void
+channel_log_init(channel_log_t *ch, int wake_fd)
 {
-    channel_bss_msg_t *msg = malloc(sizeof(channel_bss_msg_t));
-
-    CHECK_MALLOC(msg);
-    *msg = (channel_bss_msg_t) {
-        .id = id,
-        .op = op,
-        .p = p,
-    };
-    return msg;
+    ch->pending = 0;
+    ch->wake_fd = wake_fd;
+    atomic_init(&ch->dropped, 0);
+    for (int i = 0; i < CHANNEL_LOG_ERR_COUNT; i++) {
+        atomic_init(&ch->errors[i], 0);
+        atomic_init(&ch->errors_errno[i], 0);
+    }
+    atomic_init(&ch->head, 0);
+    atomic_init(&ch->tail, 0);
 }
 
-/** Release (free memory) a bss message object.
+/** Get next free slot of log channel to write a message into.
+ * 
+ * Fatal (exit) messages are published right away, and if channel is full
+ * sender waits for log thread to free a slot, as application is about to
+ * exit anyway. Other messages are dropped when channel is full.
+ * 
+ * @param ch         Channel to write message to.
+ * @param log_msg_id Log message ID, see @ref app_log_msg_id_t.
+ * @param param      Parameter of log message ID.
+ * @param exit       Is this a fatal message, meaning should the application
+ *                   exit once message is logged.
  * 
- * @param msg Message to release.
+ * @return           Returns message slot, or NULL if message was dropped due
+ *                   channel being full.
  */
-void
-channel_bss_msg_release(channel_bss_msg_t *msg)
+static channel_log_msg_t *
+channel_log_slot(channel_log_t *ch, uint32_t log_msg_id, int32_t param, bool exit)
 {
-    if (msg != NULL) {
-        if (msg->p != NULL) {
-            free(msg->p);
+    uint64_t           head = atomic_load_explicit(&ch->head, memory_order_relaxed) + ch->pending;
+    channel_log_msg_t *msg;
+
+    while (head - atomic_load_explicit(&ch->tail, memory_order_acquire) >= CHANNEL_LOG_QUEUE_LEN) {
+        if (!exit) {
+            atomic_fetch_add_explicit(&ch->dropped, 1, memory_order_relaxed);
+            return NULL;
         }
-        free(msg);
+        channel_log_flush(ch);
+        sched_yield();
     }
+
+    msg = &ch->msgs[head % CHANNEL_LOG_QUEUE_LEN];
+    msg->log_msg_id    = log_msg_id;
+    msg->log_msg_param = param;
+    msg->exit          = exit;
+    msg->log_msg[0]    = '\0';
+    msg->log_msg_len   = 0;
+    return msg;
 }
 
-/** Send a message on bss part of the channel.
- * 
- * This is used by support (bss) threads to send message to vectorloop thread.
+/** Mark message written into slot returned by @ref channel_log_slot(),
+ * fatal messages are published right away.
  * 
- * @param ch  Channel to send message on.
- * @param msg Message to send.
+ * @param ch  Channel message was written to.
+ * @param msg Message written.
+ */
+static void
+channel_log_commit(channel_log_t *ch, channel_log_msg_t *msg)
+{
+    ch->pending += 1;
+    if (msg->exit) {
+        channel_log_flush(ch);
+    }
+}
+
+/** Write a message into next free slot of log channel, without publishing it.
  * 
+ * @param ch         Channel to write message to.
+ * @param log_msg_id Log message ID, see @ref app_log_msg_id_t. If set (!= 0)
+ *                   fmt is not used and can be NULL.
+ * @param exit       Is this a fatal message, meaning should the application
+ *                   exit once message is logged.
+ * @param fmt        printf style format of message string.
+ * @param ap         Format arguments.
  * 
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if message could not be enqueued due channel being full.
+ * @return           On success returns 1, otherwise returns 0. 0 could only be
+ *                   returned if message was dropped due channel being full.
  */
-int
-channel_bss_send(channel_bss_t *ch, channel_bss_msg_t *msg)
+static int
+channel_log_vwrite(channel_log_t *ch, uint32_t log_msg_id, bool exit, const char *fmt,
+                   va_list ap)
 {
-    return lfds711_queue_bss_enqueue(&ch->bss.qbsss, NULL, (void *)msg);
+    channel_log_msg_t *msg = channel_log_slot(ch, log_msg_id, 0, exit);
+    int                len = 0;
 
+    if (msg == NULL) {
+        return 0;
+    }
+    if (log_msg_id == 0 && fmt != NULL) {
+        len = vsnprintf(msg->log_msg, CHANNEL_LOG_MSG_LEN, fmt, ap);
+        if (len < 0) {
+            len = 0;
+        } else if (len >= CHANNEL_LOG_MSG_LEN) {
+            len = CHANNEL_LOG_MSG_LEN - 1;
+        }
+    }
+    msg->log_msg[len] = '\0';
+    msg->log_msg_len  = len;
+    channel_log_commit(ch, msg);
+    return 1;
 }
 
-/** Receive a message from support (bss) part of the channel.
- * 
- * This is used by vectorloop threads to receive message from support thread.
+/** Write a message into next free slot of log channel, without publishing it.
  * 
- * @param ch  Channel to receive message on.
- * @param msg Pointer where to place the received message.
+ * This is used by threads to batch messages sent to log thread, messages
+ * written are received by log thread once @ref channel_log_flush() is called.
+ * Fatal (exit) messages are published right away. Other messages are dropped
+ * when channel is full.
  * 
+ * @param ch         Channel to write message to.
+ * @param log_msg_id Log message ID, see @ref app_log_msg_id_t. If set (!= 0)
+ *                   fmt is not used and can be NULL.
+ * @param exit       Is this a fatal message, meaning should the application
+ *                   exit once message is logged.
+ * @param fmt        printf style format of message string.
  * 
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if there are no messages in the channel.
+ * @return           On success returns 1, otherwise returns 0. 0 could only be
+ *                   returned if message was dropped due channel being full.
  */
 int
-channel_bss_recv(channel_bss_t *ch, channel_bss_msg_t **msg)
+channel_log_write(channel_log_t *ch, uint32_t log_msg_id, bool exit, const char *fmt, ...)
 {
-    return lfds711_queue_bss_dequeue(&ch->bss.qbsss, NULL, (void **)msg);
+    va_list ap;
+    int     ret;
+
+    va_start(ap, fmt);
+    ret = channel_log_vwrite(ch, log_msg_id, exit, fmt, ap);
+    va_end(ap);
+    return ret;
 }
 
-/** Send a message on vectorloop part of the channel.
+/** Write a predefined message with a parameter into next free slot of log
+ * channel, without publishing it. Message string is formatted by log thread,
+ * so sender does no string formatting.
  * 
- * This is used by vectorloop thread to send message to support (bss) thread.
+ * @param ch         Channel to write message to.
+ * @param log_msg_id Log message ID, see @ref app_log_msg_id_t.
+ * @param param      Parameter of message, errno of error message reports or 0
+ *                   if it has none.
+ * @param exit       Is this a fatal message, meaning should the application
+ *                   exit once message is logged.
  * 
- * @param ch  Channel to send message on.
- * @param msg Message to send.
- *
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if message could not be enqueued due channel being full.
+ * @return           On success returns 1, otherwise returns 0. 0 could only be
+ *                   returned if message was dropped due channel being full.
  */
 int
-channel_bssvl_send(channel_bss_t *ch, channel_bss_msg_t *msg)
+channel_log_write_id(channel_log_t *ch, uint32_t log_msg_id, int32_t param, bool exit)
 {
-    return lfds711_queue_bss_enqueue(&ch->vl.qbsss, NULL, (void *)msg);
+    channel_log_msg_t *msg = channel_log_slot(ch, log_msg_id, param, exit);
+
+    if (msg == NULL) {
+        return 0;
+    }
+    channel_log_commit(ch, msg);
+    return 1;
 }
 
-/** Receive a message from vectorloop part of the channel.
- * 
- * This is used by support (bss) thread to receive message from vectorloop thread.
+/** Count a rate limited error on log channel. Error is not sent as a message,
+ * log thread periodically logs a summary of errors counted, so an error storm
+ * (e.g. EHOSTUNREACH on every UDP write) does not flood log channel.
  * 
- * @param ch  Channel to receive message on.
- * @param msg Pointer where to place the received message.
- *
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if there are no messages in the channel.
+ * @param ch     Channel to count error on.
+ * @param err_id Error ID, see @ref app_log_err_id_t.
+ * @param err_no errno of error.
  */
-int
-channel_bssvl_recv(channel_bss_t *ch, channel_bss_msg_t **msg)
+void
+channel_log_error(channel_log_t *ch, uint32_t err_id, int err_no)
 {
-    return lfds711_queue_bss_dequeue(&ch->vl.qbsss, NULL, (void **)msg);
+    /* Only sender writes counter, so no atomic read-modify-write is needed. */
+    atomic_store_explicit(&ch->errors[err_id],
+                          atomic_load_explicit(&ch->errors[err_id], memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_store_explicit(&ch->errors_errno[err_id], err_no, memory_order_relaxed);
 }
 
-/** Assign a new channel message ID from given base.
+/** Publish all messages written to log channel to log thread. If channel
+ * was empty log thread is woken up.
  * 
- * Base is incremented and value returned.
- *
- * @param id_base 
- * @return uint64_t 
+ * @param ch Channel to publish messages of.
  */
-uint64_t
-channel_bss_assign_msg_id(uint64_t *id_base)
+void
+channel_log_flush(channel_log_t *ch)
 {
-    *id_base += 1;
-    return *id_base;
+    uint64_t head;
+
+    if (ch->pending == 0) {
+        return;
+    }
+    head = atomic_load_explicit(&ch->head, memory_order_relaxed);
+    atomic_store_explicit(&ch->head, head + ch->pending, memory_order_release);
+    ch->pending = 0;
+
+    /* Pairs with fence in channel_log_empty(), either log thread sees
+     * published messages before it goes to sleep, or sender sees channel was
+     * drained and wakes log thread up.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (ch->wake_fd > -1 && atomic_load_explicit(&ch->tail, memory_order_relaxed) == head) {
+        eventfd_write(ch->wake_fd, 1);
+    }
 }
 
-/** Create a new log channel message object.
+/** Send a message on log channel, message is written and published along
+ * with any messages written before it.
  * 
- * @param log_msg_id Log message ID, see @ref app_log_msg_id_t.
- * @param log_msg    Log message string, can be NULL.
+ * This is used by threads to send message to log thread.
+ * 
+ * @param ch         Channel to send message on.
+ * @param log_msg_id Log message ID, see @ref app_log_msg_id_t. If set (!= 0)
+ *                   fmt is not used and can be NULL.
  * @param exit       Is this a fatal message, meaning should the application
  *                   exit once message is logged.
- * @return           On success returns pointer to newly created message. Caller
- *                   is responsible for releasing the message via @ref
- *                   channel_log_msg_release once message is no longer needed. 
+ * @param fmt        printf style format of message string.
+ * 
+ * @return           On success returns 1, otherwise returns 0. 0 could only be
+ *                   returned if message was dropped due channel being full.
  */
-channel_log_msg_t *
-channel_log_msg_create(uint32_t log_msg_id, char *log_msg, bool exit)
+int
+channel_log_send(channel_log_t *ch, uint32_t log_msg_id, bool exit, const char *fmt, ...)
 {
-    channel_log_msg_t *msg = malloc(sizeof(channel_log_msg_t));
-
-    CHECK_MALLOC(msg);
-    *msg = (channel_log_msg_t) {
-        .log_msg_id = log_msg_id,
-        .log_msg = log_msg,
-        .exit = exit,
-    };
-    return msg;
+    va_list ap;
+    int     ret;
+
+    va_start(ap, fmt);
+    ret = channel_log_vwrite(ch, log_msg_id, exit, fmt, ap);
+    va_end(ap);
+    channel_log_flush(ch);
+    return ret;
 }
 
-/** Release (free memory) a log channel message object.
+/** Receive all messages published on log channel, up to msgs_len.
+ * 
+ * This is used by log thread to receive messages. Messages are received in
+ * place, their slots are not reused until they are released with
+ * @ref channel_log_release().
  * 
- * @param msg Message object to release.
+ * @param ch       Channel to receive messages on.
+ * @param msgs     Array where to place pointers to received messages.
+ * @param msgs_len Size of msgs array.
+ * 
+ * @return         Returns number of messages received, 0 if there are no
+ *                 messages in the channel.
  */
-void
-channel_log_msg_release(channel_log_msg_t *msg)
+size_t
+channel_log_recv(channel_log_t *ch, channel_log_msg_t **msgs, size_t msgs_len)
 {
-    if (msg != NULL) {
-        if (msg->log_msg != NULL) {
-            free(msg->log_msg);
-        }
-        free(msg);
+    uint64_t tail  = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+    uint64_t count = atomic_load_explicit(&ch->head, memory_order_acquire) - tail;
+
+    if (count > msgs_len) {
+        count = msgs_len;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        msgs[i] = &ch->msgs[(tail + i) % CHANNEL_LOG_QUEUE_LEN];
     }
+    return count;
 }
 
-/** Send a message on log channel.
+/** Release slots of messages received from log channel, so sender can reuse
+ * them.
  * 
- * This is used by threads threads to send message to log thread.
- * 
- * @param ch  Channel to send message on.
- * @param msg Message to send.
+ * @param ch    Channel messages were received on.
+ * @param count Number of messages to release, oldest first.
+ */
+void
+channel_log_release(channel_log_t *ch, size_t count)
+{
+    atomic_store_explicit(&ch->tail,
+                          atomic_load_explicit(&ch->tail, memory_order_relaxed) + count,
+                          memory_order_release);
+}
+
+/** Check if log channel is empty, used by log thread before it goes to sleep
+ * waiting to be woken up by sender.
  * 
+ * @param ch Channel to check.
  * 
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if message could not be enqueued due channel being full.
+ * @return   Returns true if there are no published messages in channel
+ *           that were not released.
  */
-int
-channel_log_send(channel_log_t *ch, channel_log_msg_t *msg)
+bool
+channel_log_empty(channel_log_t *ch)
 {
-    return lfds711_queue_bss_enqueue(&ch->qbsss, NULL, (void *)msg);
+    /* Pairs with fence in channel_log_flush(). */
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&ch->head, memory_order_relaxed) ==
+           atomic_load_explicit(&ch->tail, memory_order_relaxed);
+}
 
+/** Initialize a connection channel, channel starts empty.
+ * 
+ * @param ch Channel to initialize.
+ */
+void
+channel_conn_init(channel_conn_t *ch)
+{
+    atomic_init(&ch->head, 0);
+    atomic_init(&ch->tail, 0);
 }
 
-/** Receive a message from log channel.
+/** Send a connection over connection channel.
  * 
- * This is used by log thread to receive message from other thread.
+ * @param ch  Channel to send on.
+ * @param msg Connection to send, copied into channel.
  * 
- * @param ch  Channel to receive message on.
- * @param msg Pointer where to place the received message.
+ * @return    Returns true if connection was sent, false if channel is full in
+ *            which case sender keeps connection.
+ */
+bool
+channel_conn_send(channel_conn_t *ch, const channel_conn_msg_t *msg)
+{
+    uint64_t head = atomic_load_explicit(&ch->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&ch->tail, memory_order_acquire) >=
+        CHANNEL_CONN_QUEUE_LEN) {
+        return false;
+    }
+    ch->msgs[head % CHANNEL_CONN_QUEUE_LEN] = *msg;
+    atomic_store_explicit(&ch->head, head + 1, memory_order_release);
+    return true;
+}
+
+/** Receive a connection from connection channel.
  * 
+ * @param ch  Channel to receive from.
+ * @param msg Where to copy connection received to.
  * 
- * @return    On success returns 1, otherwise returns 0. 0 could only be
- *            returned if there are no messages in the channel.
+ * @return    Returns true if a connection was received, false if channel is
+ *            empty.
  */
-int
-channel_log_recv(channel_log_t *ch, channel_log_msg_t **msg)
+bool
+channel_conn_recv(channel_conn_t *ch, channel_conn_msg_t *msg)
 {
-    return lfds711_queue_bss_dequeue(&ch->qbsss, NULL, (void **)msg);
+    uint64_t tail = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+
+    if (atomic_load_explicit(&ch->head, memory_order_acquire) == tail) {
+        return false;
+    }
+    *msg = ch->msgs[tail % CHANNEL_CONN_QUEUE_LEN];
+    atomic_store_explicit(&ch->tail, tail + 1, memory_order_release);
+    return true;
 }
+
+/** @}*/
@@ -22,17 +22,26 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <arpa/inet.h>
+#include <assert.h>
 #include <errno.h>
 #include <getopt.h>
 #include <limits.h>
+#include <net/if.h>
+#include <sched.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/random.h>
+#include <sys/sysinfo.h>
+#include <sys/un.h>
 
 #include "config.h"
 #include "constants.h"
 #include "rip_ns_utils.h"
+#include "topology.h"
 #include "utils.h"
 
 /** Enumerated CLI option indexes. */
@@ -44,10 +53,30 @@ typedef enum cfg_opt_long_index_e {
     OPT_UDP_LISTENER_PORT,
     OPT_UDP_SOCK_RECV_BUFF_SIZE,
     OPT_UDP_SOCK_SEND_BUFF_SIZE,
+    OPT_UDP_SOCK_BUSY_POLL,
+    OPT_UDP_SOCK_RECV_BUFF_AUTOTUNE_MAX,
+    OPT_UDP_MIRROR_IP,
+    OPT_UDP_MIRROR_PORT,
+    OPT_UDP_MIRROR_SAMPLE_RATE,
+    OPT_LISTENER_RX_TIMESTAMPS,
     OPT_UDP_CONN_VECTOR_LEN,
+    OPT_UDP_CONN_VECTOR_LEN_MIN,
+    OPT_UDP_LISTENER_BATCHES,
+    OPT_UDP_PIPELINE_BATCH_LEN,
+    OPT_UDP_GSO,
+    OPT_UDP_DUAL_STACK,
+    OPT_UDP_LISTENER_ADDRESSES,
+    OPT_LISTENER_PROFILES_FILE,
+    OPT_XDP_INTERFACE,
+    OPT_XDP_BUSY_POLL,
+    OPT_XDP_RESPONDER_SIZE,
+    OPT_XDP_RESPONDER_HITS,
 
     OPT_TCP_ENABLE,
     OPT_TCP_LIST_PENDING_CONNS_MAX,
+    OPT_TCP_LISTENER_FASTOPEN,
+    OPT_TCP_LISTENER_DEFER_ACCEPT,
+    OPT_TCP_LISTENER_NOTSENT_LOWAT,
     OPT_TCP_LISTENER_PORT,
     OPT_TCP_CONN_PER_VL_MAX,
     OPT_TCP_LIST_MAX_ACCEPT_NEW_CONNS,
@@ -55,25 +84,147 @@ typedef enum cfg_opt_long_index_e {
     OPT_TCP_CONN_SOCKET_SEND_BUFF_SIZE,
     OPT_TCP_CONN_SIMULTANEOUS_QUERY_COUNT,
     OPT_TCP_KEEPALIVE,
+    OPT_TCP_KEEPALIVE_SHRINK_START,
     OPT_TCP_QUERY_RECV_TIMEOUT,
     OPT_TCP_QUERY_SEND_TIMEOUT,
+    OPT_TCP_HANDOFF,
+    OPT_TCP_HANDOFF_THRESHOLD,
+    OPT_TCP_CONNS_PER_CLIENT_MAX,
+    OPT_TCP_CONNS_CLIENT_IPV4_PREFIX_LEN,
+    OPT_TCP_CONNS_CLIENT_IPV6_PREFIX_LEN,
+    OPT_TCP_CONNS_IDLE_EVICT,
+    OPT_DOT_ENABLE,
+    OPT_DOT_LISTENER_PORT,
+    OPT_DOT_CERT_FILE,
+    OPT_DOT_KEY_FILE,
+    OPT_DOT_HANDSHAKE_THREADS,
+    OPT_DOT_HANDSHAKE_TIMEOUT,
+    OPT_DNSSEC_KEY_FILE,
+    OPT_DNSSEC_SIGNER_NAME,
+    OPT_WORKER_THREADS,
+    OPT_DNSSEC_SIG_CACHE_SIZE,
+    OPT_DNSSEC_SIG_VALIDITY,
+    OPT_DNSSEC_NSEC3_CACHE_SIZE,
 
     OPT_EPOLL_NUM_EVENTS_TCP,
     OPT_EPOLL_NUM_EVENTS_UDP,
+    OPT_LOOP_BUDGET_UDP_DATAGRAMS,
+    OPT_LOOP_BUDGET_TCP_READS,
+    OPT_LOOP_BUDGET_TCP_ACCEPTS,
+    OPT_LOOP_BUDGET_XFR_BYTES,
+    OPT_IO_URING_ENABLE,
     OPT_PROCESS_THREAD_COUNT,
     OPT_PROCESS_THREAD_MASKS,
+    OPT_PROCESS_THREAD_ROLES,
+    OPT_PROCESS_THREAD_CPU_STEERING,
+    OPT_PROCESS_THREAD_CLIENT_STEERING,
+    OPT_PROCESS_THREAD_AUTO_PIN,
+    OPT_PROCESS_THREAD_AUTO_PIN_INTERFACE,
+    OPT_PROCESS_HOUSEKEEPING_CPUS,
+    OPT_PROCESS_THREAD_SCHED_POLICY,
+    OPT_PROCESS_THREAD_SCHED_PRIORITY,
+    OPT_PROCESS_THREAD_RT_RUN_MAX,
+    OPT_PROCESS_MLOCKALL,
+    OPT_PROCESS_WORKERS,
 
-    OPT_LOOP_SLOWDOWN_ONE,
-    OPT_LOOP_SLOWDOWN_TWO,
-    OPT_LOOP_SLOWDOWN_THREE,
+    OPT_LOOP_IDLE_SPIN,
+    OPT_LOOP_IDLE_WAIT_MAX,
+    OPT_LOOP_CALIBRATE,
+    OPT_LOOP_CALIBRATE_LATENCY,
+    OPT_LOOP_HUGEPAGES,
+    OPT_LOOP_HUGETLB,
+    OPT_LOOP_PREFAULT,
+    OPT_LOOP_MLOCK,
+    OPT_LOOP_STAGE_METRICS,
+    OPT_MEMORY_BUDGET,
 
     OPT_APP_LOG_NAME,
     OPT_APP_LOG_PATH,
 
     OPT_QUERY_LOG_BUFFER_SIZE,
+    OPT_QUERY_LOG_BUFFER_COUNT,
     OPT_QUERY_LOG_BASE_NAME,
     OPT_QUERY_LOG_PATH,
     OPT_QUERY_LOG_ROTATE_SIZE,
+    OPT_QUERY_LOG_SAMPLE_RATE,
+    OPT_QUERY_LOG_RCODES,
+    OPT_QUERY_LOG_QTYPES,
+    OPT_QUERY_LOG_ERRORS_ONLY,
+    OPT_QUERY_LOG_LATENCY_MIN,
+    OPT_QUERY_LOG_DIRECT_IO,
+    OPT_QUERY_LOG_SPLICE,
+    OPT_QUERY_LOG_COMPRESS,
+    OPT_QUERY_LOG_REMOTE_IP,
+    OPT_QUERY_LOG_REMOTE_PORT,
+    OPT_QUERY_LOG_REMOTE_UNIX,
+    OPT_QUERY_LOG_FORMAT,
+    OPT_QUERY_LOG_SHM_PATH,
+    OPT_QUERY_LOG_AGE_MAX,
+    OPT_QUERY_LOG_FULL_POLICY,
+    OPT_QUERY_LOG_SPILL_SIZE,
+    OPT_QUERY_LOG_FULL_SAMPLE_RATE,
+    OPT_QUERY_LOG_INDEX,
+    OPT_QUERY_LOG_INDEX_RECORDS,
+
+    OPT_ZONE_FILE,
+    OPT_ZONE_FILE_UPDATE_FREQ,
+    OPT_ZONE_DELTA_FILE,
+    OPT_ZONE_IMAGE_COMPILE,
+    OPT_ZONE_PREFAULT,
+    OPT_ZONE_MLOCK,
+    OPT_ZONE_COMPILE_THREADS,
+    OPT_ZONE_TRANSFER_ALLOW,
+    OPT_ZONE_SECONDARY,
+    OPT_ZONE_PRIMARY,
+    OPT_ZONE_PRIMARY_PORT,
+    OPT_ECS_MAP_FILE,
+    OPT_ECS_MAP_FILE_UPDATE_FREQ,
+    OPT_VIEWS_FILE,
+    OPT_VIEWS_FILE_UPDATE_FREQ,
+    OPT_ZONE_CATALOG_FILE,
+    OPT_ZONE_CATALOG_FILE_UPDATE_FREQ,
+    OPT_ACL_FILE,
+    OPT_ACL_FILE_UPDATE_FREQ,
+    OPT_POLICY_FILE,
+    OPT_POLICY_FILE_UPDATE_FREQ,
+    OPT_GEOIP_FILE,
+    OPT_GEOIP_FILE_UPDATE_FREQ,
+    OPT_LB_FILE,
+    OPT_LB_FILE_UPDATE_FREQ,
+    OPT_LB_CHECK_INTERVAL,
+    OPT_LB_CHECK_TIMEOUT,
+    OPT_CONFIG_FILE,
+    OPT_CONFIG_FILE_UPDATE_FREQ,
+    OPT_UPGRADE_SOCKET,
+    OPT_ADMIN_SOCKET,
+    OPT_DRAIN_TIME,
+
+    OPT_RESPONSE_CACHE_SIZE,
+    OPT_RESPONSE_CACHE_SHARED_SIZE,
+    OPT_RESPONSE_CACHE_SNAPSHOT_PATH,
+
+    OPT_RRL_RESPONSES_PER_SECOND,
+    OPT_RRL_SLIP,
+    OPT_RRL_IPV4_PREFIX_LEN,
+    OPT_RRL_IPV6_PREFIX_LEN,
+    OPT_RRL_TABLE_SIZE,
+
+    OPT_OVERLOAD_ITERATION_MAX,
+    OPT_OVERLOAD_SLIP,
+    OPT_SLO_LATENCY_P50,
+    OPT_SLO_LATENCY_P99,
+    OPT_SLO_LATENCY_P999,
+    OPT_SLO_WINDOW,
+
+    OPT_DNS_COOKIES,
+    OPT_DNS_COOKIE_SECRET,
+
+    OPT_METRICS_ENABLE,
+    OPT_METRICS_LISTENER_IP,
+    OPT_METRICS_LISTENER_PORT,
+    OPT_METRICS_SKETCHES,
+    OPT_METRICS_ZONES,
+    OPT_METRICS_QUERY_COST,
 
 } cfg_opt_long_index_t;
 
@@ -112,11 +263,175 @@ usage(void)
                    "\tthe maximum requestable buffer size. Importantly, this value must be\n"
                    "\tgreater than net.core.rmem_default.\n\n");    
 
+    fprintf(stdout,"--udp_socket_busy_poll (microseconds 0-10000)\n"
+                   "\tSet socket option SO_BUSY_POLL on UDP listeners. When set, the kernel\n"
+                   "\tbusy polls the network device receive queue for up to this long when\n"
+                   "\treading from a socket that has no data, lowering receive latency at\n"
+                   "\tthe cost of CPU cycles. Value of 0 leaves the socket option unset.\n"
+                   "\tNOTE: values above 0 require CAP_NET_ADMIN capability.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--udp_socket_recvbuff_autotune_max (number 0-16777215)\n"
+                   "\tWhen kernel drops UDP datagrams because a listener receive buffer is\n"
+                   "\tfull, double listener receive buffer size, at most once a second, up\n"
+                   "\tto this size. Value of 0 disables receive buffer auto-tuning, drops\n"
+                   "\tare still counted.\n"
+                   "\tNOTE: Linux kernel setting net.core.rmem_max caps the size.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--udp_mirror_ip (IPv4 or IPv6 address)\n"
+                   "\tMirror received UDP queries to shadow server at this IP address, e.g.\n"
+                   "\ta new build under test, without affecting clients. Each vectorloop\n"
+                   "\tsends queries it read in an iteration with a single sendmmsg() call\n"
+                   "\tfrom a socket of its own, straight from request buffers. Shadow server\n"
+                   "\tsees mirroring socket as client, its responses are discarded. Queries\n"
+                   "\tthat can not be sent right away are dropped and counted.\n"
+                   "\tDefault is not set (queries are not mirrored).\n\n");
+
+    fprintf(stdout,"--udp_mirror_port (number 1-65535)\n"
+                   "\tUDP port of shadow server queries are mirrored to.\n"
+                   "\tDefault is 53.\n\n");
+
+    fprintf(stdout,"--udp_mirror_sample_rate (number 1-1000000)\n"
+                   "\tMirror one in this many received UDP queries. Sampling is done per\n"
+                   "\tvectorloop.\n"
+                   "\tDefault is 1 (mirror all queries).\n\n");
+
+    fprintf(stdout,"--listener_rx_timestamps (True|False)\n"
+                   "\tSet socket option SO_TIMESTAMPNS on UDP and TCP listeners, and take\n"
+                   "\tquery receive time from kernel receive timestamp of datagram (or TCP\n"
+                   "\tdata) rather than from vectorloop iteration start. Query latency in\n"
+                   "\tmetrics and query logs then includes time spent queued in socket\n"
+                   "\treceive buffer. DNS over TLS queries keep iteration start time.\n"
+                   "\tDefault is False.\n\n");
+
     fprintf(stdout,"--udp_conn_vector_len (number 1-65535)\n"
                    "\tSpecify vector length for recvmmsg() call. This sets the maximum\n"
                    "\tnumber of UDP packets to read process per vectorloop\n"
                    "\tDefault is 8.\n\n");
 
+    fprintf(stdout,"--udp_conn_vector_len_min (number 0-65535)\n"
+                   "\tLet each UDP listener adapt vector length it passes to recvmmsg()\n"
+                   "\tbetween this value and \"--udp_conn_vector_len\", based on how full\n"
+                   "\trecent reads were. Length is doubled after a read fills the vector, and\n"
+                   "\thalved after a run of reads that fill less than half of it. Value of 0\n"
+                   "\tdisables adapting, vector length is then \"--udp_conn_vector_len\". Must\n"
+                   "\tnot be larger than \"--udp_conn_vector_len\".\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--udp_listener_batches (number 1-16)\n"
+                   "\tNumber of batches, each with its own read, query and write vectors,\n"
+                   "\teach UDP listener receives into. While a batch waits for its responses\n"
+                   "\tto be sent, listener keeps receiving into next free batch, so bursts\n"
+                   "\tare absorbed instead of dropped in socket buffer. AF_XDP listener has\n"
+                   "\ta single batch.\n"
+                   "\tDefault is 2.\n\n");
+
+    fprintf(stdout,"--udp_pipeline_batch_len (number 0-65535)\n"
+                   "\tRun UDP queries of a vector through parse, resolve and response pack\n"
+                   "\tin batches of this many queries, so a batch stays in CPU cache from\n"
+                   "\tone step to the next. Value of 0 runs every step over all queries of\n"
+                   "\tall connections before next step starts.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--udp_gso (True|False)\n"
+                   "\tSend consecutive responses of a UDP vector, that go to the same client\n"
+                   "\tand are of same length, as one UDP segmentation offload (GSO) message\n"
+                   "\twhich kernel splits into datagrams. This lowers per packet cost when\n"
+                   "\tmany queries arrive from same client. Only responses up to 1232 bytes\n"
+                   "\tlong are sent this way.\n"
+                   "\tNOTE: requires Linux 4.18 or later, and network device with checksum\n"
+                   "\toffload.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--udp_dual_stack (True|False)\n"
+                   "\tReceive IPv4 and IPv6 UDP queries on a single dual stack IPv6 listener\n"
+                   "\tper vectorloop, instead of one listener per IP version. IPv4 queries\n"
+                   "\tarrive as IPv4-mapped IPv6 addresses and are handled as IPv4 queries,\n"
+                   "\tresponses are sent from address query was sent to. Under mostly IPv4\n"
+                   "\tload this saves the empty receive system call on IPv6 listener every\n"
+                   "\titeration. Applies to vectorloops with both \"udp4\" and \"udp6\"\n"
+                   "\troles, see \"--process_thread_roles\". Listeners of other setting are\n"
+                   "\tnot taken over on upgrade, new ones are started instead.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--udp_listener_addresses (comma separated IP addresses)\n"
+                   "\tBind UDP listeners to these IPv4 and IPv6 addresses, a socket per\n"
+                   "\taddress on \"--udp_listener_port\", instead of one socket bound to any\n"
+                   "\taddress. Vectorloop with \"udp4\" role listens on IPv4 addresses, one\n"
+                   "\twith \"udp6\" role on IPv6 addresses. Sockets of all addresses of an IP\n"
+                   "\tfamily receive into same listener batches, a batch is filled from as\n"
+                   "\tmany readable sockets as it takes, so many addresses cost a socket each\n"
+                   "\tand not more memory nor smaller batches. Datagrams received and dropped\n"
+                   "\tare counted per address. \"--udp_dual_stack\" does not apply, and\n"
+                   "\tlisteners are not steered by reuseport programs nor taken over on\n"
+                   "\tupgrade, new ones are started instead.\n"
+                   "\tExample: --udp_listener_addresses=192.0.2.1,192.0.2.2,2001:db8::53\n"
+                   "\tDefault is \"\", UDP listeners are bound to any address.\n\n");
+
+    fprintf(stdout,"--listener_profiles_file (file path)\n"
+                   "\tFull path of file with listener tuning profiles, so listeners are sized\n"
+                   "\tfor traffic they get instead of application wide settings. File is in\n"
+                   "\tconfiguration file format. Line \"profile <name>\" starts a profile, lines\n"
+                   "\tthat follow set its settings, and \"listener <listener>\" assigns it to\n"
+                   "\tlisteners: an address of udp_listener_addresses, \"udp\" for UDP\n"
+                   "\tlisteners bound to any address, \"tcp\" or \"dot\". Listener has at most\n"
+                   "\tone profile, settings it does not set are application wide ones.\n"
+                   "\tAddresses of an IP family with same profile share listener batches.\n"
+                   "\tProfiles are applied at startup. Settings that can be set in profile:\n"
+                   "\tudp_conn_vector_len, udp_conn_vector_len_min, udp_listener_batches,\n"
+                   "\tudp_socket_recvbuff_size, udp_socket_sendbuff_size,\n"
+                   "\ttcp_listener_pending_conns_max, tcp_listener_max_accept_new_conn,\n"
+                   "\ttcp_listener_fastopen and tcp_listener_defer_accept. Profile that sets\n"
+                   "\tUDP vector length or TCP accept limit is not changed by config_file.\n"
+                   "\tDefault is \"\", there are no profiles.\n\n");
+
+    fprintf(stdout,"--xdp_interface (string)\n"
+                   "\tReceive and send UDP DNS queries arriving on this network interface\n"
+                   "\tvia AF_XDP sockets, bypassing kernel UDP stack. An XDP program is\n"
+                   "\tattached to interface which redirects UDP datagrams to\n"
+                   "\t\"--udp_listener_port\" to vectorloops, other traffic is passed on to\n"
+                   "\tkernel. Each vectorloop binds its AF_XDP socket to receive queue number\n"
+                   "\tof CPU it is bound to by \"--process_thread_masks\", or to its thread\n"
+                   "\tnumber (starting with 0) if it is not bound to a CPU. Receive queue\n"
+                   "\tinterrupts should be steered to same CPUs (RSS and IRQ affinity).\n"
+                   "\tIP fragments, IPv4 options, IPv6 extension headers and VLAN tagged\n"
+                   "\tframes are passed on to kernel UDP listeners.\n"
+                   "\tNOTE: requires Linux 5.9 or later and CAP_NET_ADMIN, CAP_BPF and\n"
+                   "\tCAP_NET_RAW capabilities.\n"
+                   "\tDefault is not set.\n\n");
+
+    fprintf(stdout,"--xdp_busy_poll (microseconds 0-1000)\n"
+                   "\tPoll AF_XDP sockets of \"--xdp_interface\" instead of waiting for\n"
+                   "\treceive queue interrupts. Vectorloop drives network device driver\n"
+                   "\t(NAPI) itself every iteration, polling for up to this long per system\n"
+                   "\tcall, and keeps polling while it is busy, with interrupts staying off.\n"
+                   "\tOnce idle for \"loop_idle_spin\" it waits in epoll_wait() as usual.\n"
+                   "\tSet \"napi_defer_hard_irqs\" and \"gro_flush_timeout\" of interface in\n"
+                   "\tsysfs so that interrupts stay off while polling. If kernel does not\n"
+                   "\tsupport preferred busy polling sockets stay interrupt driven.\n"
+                   "\tValue 0 disables busy polling.\n"
+                   "\tNOTE: requires Linux 5.11 or later.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--xdp_responder_size (number 0-1048576)\n"
+                   "\tAnswer hottest cached queries arriving on \"--xdp_interface\" over IPv4\n"
+                   "\tin XDP program itself, from a BPF map holding up to this many\n"
+                   "\tresponses, least recently used are evicted. Vectorloops add responses\n"
+                   "\tthey copy from response cache, see \"--xdp_responder_hits\". Request must\n"
+                   "\tmatch byte for byte (following message ID), and be without EDNS\n"
+                   "\tcookie. Answered queries are not seen by vectorloops, so they are not\n"
+                   "\tlogged nor counted in query metrics. Responder stands aside while\n"
+                   "\tviews, client ACL, response policy, GeoIP, ECS map or response rate\n"
+                   "\tlimiting are in use. Value 0 disables responder.\n"
+                   "\tNOTE: requires Linux 5.18 or later.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--xdp_responder_hits (number 1-1000000)\n"
+                   "\tVectorloop adds response to \"--xdp_responder_size\" map each time its\n"
+                   "\tresponse cache entry is hit this many times.\n"
+                   "\tDefault is %d.\n\n", CFG_DEFAULT_XDP_RESPONDER_HITS);
+
 
     fprintf(stdout,"--tcp_enable (True|False)\n"
                    "\tEnable receiving DNS queries over TCP transport protocol.\n"
@@ -129,6 +444,29 @@ usage(void)
                    "\tto system call listen().\n"
                    "\tDefault is 1024.\n\n");
 
+    fprintf(stdout,"--tcp_listener_fastopen (number 0-65535)\n"
+                   "\tSet socket option TCP_FASTOPEN on TCP listeners with this value as the\n"
+                   "\tmaximum number of pending TFO connections. With TCP Fast Open the client\n"
+                   "\tsends the DNS query in the SYN packet, saving a round trip on repeat\n"
+                   "\tconnections. Kernel setting net.ipv4.tcp_fastopen must have server\n"
+                   "\tsupport enabled (bit 0x2). Value 0 leaves the option unset.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--tcp_listener_defer_accept (number 0-3600)\n"
+                   "\tSet socket option TCP_DEFER_ACCEPT on TCP listeners, in seconds. A new\n"
+                   "\tconnection is handed to accept() only once client data has arrived, so\n"
+                   "\tvectorloop does not carry connections that have not sent a query yet.\n"
+                   "\tValue 0 leaves the option unset.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--tcp_listener_notsent_lowat (number 0-16777216)\n"
+                   "\tSet socket option TCP_NOTSENT_LOWAT on TCP listeners, in bytes, which\n"
+                   "\taccepted connections inherit. Connection is reported writable only once\n"
+                   "\tdata not yet sent is below this, so a write that blocked resumes when\n"
+                   "\tthere is real room, and less data waits in socket send buffer. Value 0\n"
+                   "\tleaves the option unset.\n"
+                   "\tDefault is 0.\n\n");
+
     fprintf(stdout,"--tcp_listener_port (number 1-65535)\n"
                    "\tSpecify port to receive DNS queries over TCP transport protocol.\n"
                    "\tDefault port is 53.\n\n");
@@ -169,6 +507,14 @@ usage(void)
                    "\tis closed.\n"
                    "\tDefault is 10000 (10 seconds).\n\n"); 
 
+    fprintf(stdout,"--tcp_keepalive_shrink_start (percent 0-100)\n"
+                   "\tPercent of \"tcp_conns_per_vl_max\" TCP connections from which idle\n"
+                   "\ttimeout advertised to clients in EDNS tcp-keepalive option (RFC 7828)\n"
+                   "\tshrinks, linearly from \"tcp_keepalive\" down to 1 second once vector\n"
+                   "\tloop holds maximum number of connections. Connection is then closed\n"
+                   "\tafter timeout it was last told. 100 means timeout does not shrink.\n"
+                   "\tDefault is 50.\n\n");
+
     fprintf(stdout,"--tcp_query_recv_timeout (miliseconds 1-UINTMAX_MAX)\n"
                    "\tTime to wait for query to be received. This timer applies when a\n"
                    "\tconnection is first established, as well as when a partial query\n"
@@ -183,15 +529,126 @@ usage(void)
                    "\tWhen this timer is reached TCP connection is closed.\n"
                    "\tDefault is 2000 (2 seconds).\n\n");
 
+    fprintf(stdout,"--tcp_handoff (True|False)\n"
+                   "\tHand off TCP connections from busy vectorloops to least loaded one.\n"
+                   "\tEach vectorloop publishes number of queries it processed every 100ms,\n"
+                   "\tand one whose load exceeds load of least loaded vectorloop by\n"
+                   "\t\"tcp_handoff_threshold\" percent hands off some of its idle TCP\n"
+                   "\tconnections (no query in progress) to it, so few heavy clients do not\n"
+                   "\toverload vectorloop that accepted them. Connections are only handed off\n"
+                   "\tto vectorloops running TCP listeners, see \"--process_thread_roles\".\n"
+                   "\tRequires at most 128 vectorloops.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--tcp_handoff_threshold (percent 5-1000)\n"
+                   "\tPercent by which vectorloop load must exceed load of least loaded\n"
+                   "\tvectorloop for its TCP connections to be handed off, see\n"
+                   "\t\"--tcp_handoff\".\n"
+                   "\tDefault is 25.\n\n");
+
    fprintf(stdout,"--tcp_conns_per_vl_max (number 1-UINTMAX_MAX)\n"
                    "\tMaximum number of simultaneous TCP connections per vector loop\n"
-                   "\tWhen this maximum is reached new TCP connections are rejected\n"
+                   "\tWhen this maximum is reached oldest idle TCP connection is closed\n"
+                   "\tto make room for a new one, see \"--tcp_conns_idle_evict\", or if\n"
+                   "\tthere is none new TCP connections are rejected\n"
                    "\tDefault is 100000.\n\n"); 
 
+    fprintf(stdout,"--tcp_conns_per_client_max (number 0-1000000)\n"
+                   "\tMaximum number of simultaneous TCP connections per client network per\n"
+                   "\tvector loop. New TCP connections of client network over the limit are\n"
+                   "\tclosed once accepted. 0 means not limited.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--tcp_conns_client_ipv4_prefix_len (number 0-32)\n"
+                   "\tPrefix length IPv4 client addresses are grouped into networks by for\n"
+                   "\tTCP connection limit, see \"--tcp_conns_per_client_max\".\n"
+                   "\tDefault is 32.\n\n");
+
+    fprintf(stdout,"--tcp_conns_client_ipv6_prefix_len (number 0-56)\n"
+                   "\tPrefix length IPv6 client addresses are grouped into networks by for\n"
+                   "\tTCP connection limit, see \"--tcp_conns_per_client_max\".\n"
+                   "\tDefault is 56.\n\n");
+
+    fprintf(stdout,"--tcp_conns_idle_evict (True|False)\n"
+                   "\tOnce vector loop holds \"tcp_conns_per_vl_max\" TCP connections and\n"
+                   "\tmore are waiting to be accepted, close TCP connection idle (waiting\n"
+                   "\tfor a query) for longest time to make room for a new one. Otherwise\n"
+                   "\tnew connections wait until some connection ends.\n"
+                   "\tDefault is True.\n\n");
+
+    fprintf(stdout,"--dot_enable (True|False)\n"
+                   "\tEnable receiving DNS queries over TLS (DoT, RFC 7858). TLS handshake is\n"
+                   "\tdone by handshake threads, after which connection is switched to kernel\n"
+                   "\tTLS and served by vectorloop same as a TCP connection. Only TLS 1.3 is\n"
+                   "\tsupported. Requires kernel TLS (tls kernel module), and options\n"
+                   "\t\"--dot_cert_file\" and \"--dot_key_file\" to be set.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--dot_listener_port (number 1-65535)\n"
+                   "\tSpecify port to receive DNS queries over TLS.\n"
+                   "\tDefault port is 853.\n\n");
+
+    fprintf(stdout,"--dot_cert_file (string)\n"
+                   "\tPath to PEM file with certificate chain DoT listeners present, server\n"
+                   "\tcertificate first.\n"
+                   "\tNo default.\n\n");
+
+    fprintf(stdout,"--dot_key_file (string)\n"
+                   "\tPath to PEM file with private key of DoT server certificate.\n"
+                   "\tNo default.\n\n");
+
+    fprintf(stdout,"--dot_handshake_threads (number 1-64)\n"
+                   "\tNumber of TLS handshake threads each vectorloop hands new DoT\n"
+                   "\tconnections to. Each thread does one handshake at a time.\n"
+                   "\tDefault is 2.\n\n");
+
+    fprintf(stdout,"--dot_handshake_timeout (miliseconds 1-60000)\n"
+                   "\tTime TLS handshake of a new DoT connection has to complete, once a\n"
+                   "\thandshake thread starts on it. Connection is closed if it does not.\n"
+                   "\tDefault is 3000 (3 seconds).\n\n");
+
+    fprintf(stdout,"--worker_threads (number 1-64)\n"
+                   "\tNumber of worker threads each vectorloop hands work too slow to do\n"
+                   "\tinline to, such as online DNSSEC signing. Queries waiting for it are\n"
+                   "\tdeferred, vectorloop never blocks. Started only if a feature that\n"
+                   "\tneeds them is enabled.\n"
+                   "\tDefault is 1.\n\n");
+
+    fprintf(stdout,"--dnssec_key_file (string)\n"
+                   "\tPath to PEM file with ECDSA P-256 or Ed25519 private key answers are\n"
+                   "\tsigned with online, for queries with DNSSEC OK bit set, when zone has\n"
+                   "\tno presigned RRSIG records for them (e.g. ECS view variants). DNSKEY\n"
+                   "\trecord of key is printed at startup and has to be added to zone.\n"
+                   "\tRequires option \"--dnssec_signer_name\" to be set.\n"
+                   "\tNo default, answers are not signed online.\n\n");
+
+    fprintf(stdout,"--dnssec_signer_name (string)\n"
+                   "\tZone (apex name) signing key of \"--dnssec_key_file\" belongs to. Only\n"
+                   "\tanswers within this zone are signed online.\n"
+                   "\tNo default.\n\n");
+
+    fprintf(stdout,"--dnssec_sig_cache_size (number 16-1048576)\n"
+                   "\tNumber of RRSIG records each vectorloop keeps in its signature\n"
+                   "\tcache, least recently used is evicted first.\n"
+                   "\tDefault is 4096.\n\n");
+
+    fprintf(stdout,"--dnssec_sig_validity (seconds 3600-31536000)\n"
+                   "\tValidity period of online signatures. Cached signatures are signed\n"
+                   "\tagain half way through it.\n"
+                   "\tDefault is 604800 (7 days).\n\n");
+
+    fprintf(stdout,"--dnssec_nsec3_cache_size (number 0-1048576)\n"
+                   "\tNumber of NSEC3 hashes of names each vectorloop keeps in its cache,\n"
+                   "\tfor denial of existence proofs of presigned NSEC3 zones. Rounded up\n"
+                   "\tto a power of 2, 0 disables cache.\n"
+                   "\tDefault is 256.\n\n");
+
 
     fprintf(stdout,"--epoll_num_events_tcp (number 3-1024\n"
                    "\tMaximum number of events to have reported in a single call to epoll.\n"
-                   "\tThis settings includes TCP listeners and connections.\n"
+                   "\tThis settings includes TCP listeners and connections. Vectorloop has a\n"
+                   "\tsingle epoll instance for UDP and TCP, a call to epoll reports up to\n"
+                   "\tsum of \"--epoll_num_events_tcp\" and \"--epoll_num_events_udp\" events.\n"
                    "\tDefault is 8.\n\n");                  
 
     fprintf(stdout,"--epoll_num_events_udp (number 3-1024\n"
@@ -199,6 +656,39 @@ usage(void)
                    "\tThis settings includes UDP listeners.\n"
                    "\tDefault is 8.\n\n");  
 
+    fprintf(stdout,"--loop_budget_udp_datagrams (number 0-65535)\n"
+                   "\tMaximum number of UDP datagrams read in per vectorloop iteration, across\n"
+                   "\tboth UDP listeners. Together with \"--loop_budget_tcp_reads\" and\n"
+                   "\t\"--loop_budget_tcp_accepts\" this ensures that a flood of queries over\n"
+                   "\tone protocol does not starve clients of the other. 0 means no limit\n"
+                   "\tother than \"--udp_conn_vector_len\" per listener.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--loop_budget_tcp_reads (number 0-65535)\n"
+                   "\tMaximum number of TCP connections read from per vectorloop iteration.\n"
+                   "\tConnections not read from are read from in next iteration. 0 means\n"
+                   "\tno limit.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--loop_budget_tcp_accepts (number 0-65535)\n"
+                   "\tMaximum number of new TCP connections accepted per vectorloop iteration,\n"
+                   "\tacross both TCP listeners. 0 means no limit other than\n"
+                   "\t\"--tcp_listener_max_accept_new_conn\" per listener.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--loop_budget_xfr_bytes (number 0-1073741824)\n"
+                   "\tMaximum number of zone transfer (AXFR, IXFR) bytes sent per vectorloop\n"
+                   "\titeration, across TCP connections. Transfer is spread over as many\n"
+                   "\titerations as it takes, so it does not hold up queries of other\n"
+                   "\tconnections. 0 means no limit.\n"
+                   "\tDefault is 262144.\n\n");
+
+    fprintf(stdout,"--io_uring_enable (True|False)\n"
+                   "\tSend UDP and TCP responses via io_uring. All responses of a vectorloop\n"
+                   "\titeration are submitted with a single system call. If io_uring is not\n"
+                   "\tavailable, responses are sent via sendmmsg() and sendmsg().\n"
+                   "\tDefault is False.\n\n");
+
     fprintf(stdout,"--process_thread_count (number 1-1024)\n"
                    "\tSet number of query processing (vectorloop) theads to start. This does\n"
                    "\tot include application support threads such as logging threads nor\n"
@@ -224,26 +714,208 @@ usage(void)
                    "\tNote that on Linux first CPU has ID of 0 (zero), where as this\n"
                    "\toption starts numbering at 1\n\n");
 
-    fprintf(stdout,"--loop_slowdown_one (microseconds 1-10000)\n"
-                   "\tVectorloop is a continuously running loop. If there are no queries to\n"
-                   "\tprocess the loop would needlessly consume CPU cycles. To avoid unnecessary\n"
-                   "\tconsumption of CPU cycles vectorloop implements a slowdown policy where if\n"
-                   "\tno queries were processed in a cycle it sleeps for a specified time before\n"
-                   "\tcontinuing execution. The sleep time increases with each \"idle\" loop. The \n"
-                   "\tpolicy is to sleep \"loop_slowdown_one\" time for 8 cycles, followed by\n"
-                   "\t\"loop_slowdown_two\" time for next 8 cycles, followed by \"loop_slowdown_three\"\n"
-                   "\ttime until a query arrives. Policy is reset (start from the begining) each time\n"
-                   "\tvectorloop processed a query.\n"
+    fprintf(stdout,"--process_thread_roles (all)\n"
+                   "\tSelect listeners each vectorloop thread runs, so UDP traffic can be\n"
+                   "\tprocessed on cores TCP connections are not. Format of this option value\n"
+                   "\tis a comma separated list of roles for each thread, index in value\n"
+                   "\tcorresponds to thread number as in \"--process_thread_masks\". Roles\n"
+                   "\tof a thread are joined with '+', recognized roles are:\n"
+                   "\t  udp4, udp6, udp (both), tcp4, tcp6, tcp (both), all\n"
+                   "\tTCP roles include DoT listeners, and AF_XDP listener follows udp6.\n"
+                   "\tI.E:\n"
+                   "\t--process_thread_roles=udp,udp,udp,tcp\n"
+                   "\truns UDP listeners on first three threads and TCP listeners on fourth.\n"
+                   "\tThreads with no roles provided (or an empty entry) run all listeners.\n"
+                   "\tEach enabled listener must be run by at least one thread.\n"
+                   "\tDefault is all listeners on every thread.\n\n");
+
+    fprintf(stdout,"--process_thread_cpu_steering (True|False)\n"
+                   "\tSteer each UDP datagram and TCP connection to listener of the vectorloop\n"
+                   "\tbound to CPU that processed its network receive interrupt, instead of\n"
+                   "\tkernel picking listener by hash of addresses, so query is processed on\n"
+                   "\tCPU whose cache already holds it. Vectorloop threads should all be bound\n"
+                   "\tto CPUs with \"--process_thread_masks\", and network receive queue\n"
+                   "\tinterrupts steered to same CPUs (RSS and IRQ affinity), a warning is\n"
+                   "\twritten on start for each vectorloop or CPU that is not. Traffic handled\n"
+                   "\ton CPUs no vectorloop is bound to is spread by hash as before.\n"
+                   "\tNOTE: requires Linux 4.19 or later and CAP_BPF capability.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--process_thread_client_steering (True|False)\n"
+                   "\tSteer each UDP datagram and TCP connection to listener of a vectorloop\n"
+                   "\tpicked by hash of client address prefix (of \"--rrl_ipv4_prefix_len\" and\n"
+                   "\t\"--rrl_ipv6_prefix_len\" bits), instead of kernel picking listener by\n"
+                   "\thash of addresses and ports, so all queries of a client prefix are read\n"
+                   "\tby same vectorloop. Per vectorloop response rate limiting buckets, query\n"
+                   "\tsketches and caches then see whole clients, and rate limits hold however\n"
+                   "\tmany source ports a client uses.\n"
+                   "\tCan not be used with \"--process_thread_cpu_steering\".\n"
+                   "\tNOTE: requires Linux 4.19 or later and CAP_BPF capability.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--process_thread_auto_pin (True|False)\n"
+                   "\tBind vectorloop threads not bound by \"--process_thread_masks\" to CPUs\n"
+                   "\tpicked from CPU topology read from sysfs: one vectorloop per physical\n"
+                   "\tcore (SMT siblings are used only once free cores run out), preferring\n"
+                   "\tcores on NUMA node of network interface and CPUs its interrupts are\n"
+                   "\tdelivered to. CPUs of \"--process_housekeeping_cpus\" are not used, and\n"
+                   "\tif that option is not set support threads are bound to CPUs left\n"
+                   "\twithout a vectorloop. Chosen bindings are written on start.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--process_thread_auto_pin_interface (string)\n"
+                   "\tNetwork interface whose NUMA node and interrupt affinity\n"
+                   "\t\"--process_thread_auto_pin\" places vectorloops by.\n"
+                   "\tDefault is \"--xdp_interface\", if set.\n\n");
+
+    fprintf(stdout,"--process_housekeeping_cpus (CPU list)\n"
+                   "\tBind support threads (application log, resource, query log, metrics,\n"
+                   "\tupgrade and zone transfer threads) to these CPUs, keeping them from\n"
+                   "\tpreempting vectorloops. Format is kernel CPU list of 0 based CPU\n"
+                   "\tnumbers, I.E: \"0-1,8\".\n"
+                   "\tDefault is no binding.\n\n");
+
+    fprintf(stdout,"--process_thread_sched_policy (other|fifo|rr)\n"
+                   "\tScheduling policy of vectorloop threads. With real-time policies\n"
+                   "\t(SCHED_FIFO, SCHED_RR) vectorloops are not preempted by normal tasks\n"
+                   "\tand kernel threads, and a warning is written on start for each\n"
+                   "\tvectorloop not bound to a CPU, or bound to a CPU that is not isolated\n"
+                   "\t(isolcpus) or not tickless (nohz_full). A real-time vectorloop that has\n"
+                   "\tnot blocked for \"--process_thread_rt_run_max\" sleeps briefly so kernel\n"
+                   "\tthreads of its CPU are not starved.\n"
+                   "\tNOTE: real-time policies require CAP_SYS_NICE capability, if policy\n"
+                   "\tcan not be set it is logged and vectorloop runs with default policy.\n"
+                   "\tDefault is other.\n\n");
+
+    fprintf(stdout,"--process_thread_sched_priority (number 1-99)\n"
+                   "\tReal-time priority of vectorloop threads, used with\n"
+                   "\t\"--process_thread_sched_policy\" fifo or rr. Threaded interrupt\n"
+                   "\thandlers run at 50, priority above that delays network interrupts.\n"
                    "\tDefault is 1.\n\n");
 
-    fprintf(stdout,"--loop_slowdown_two (microseconds 1-10000)\n"
-                   "\tSee description for option \"loop_slowdown_one\"\n"
-                   "\tDefault is 100.\n\n");
+    fprintf(stdout,"--process_thread_rt_run_max (milliseconds 1-1000)\n"
+                   "\tLongest time a real-time vectorloop runs (busy or idle spinning)\n"
+                   "\twithout blocking, after which it sleeps for %d microseconds so other\n"
+                   "\ttasks of its CPU get to run.\n"
+                   "\tDefault is 100.\n\n", VL_RT_YIELD_US);
+
+    fprintf(stdout,"--process_mlockall (True|False)\n"
+                   "\tLock all current and future process memory with mlockall(), so no\n"
+                   "\tpage is swapped out or faulted in while serving queries. If memory\n"
+                   "\tcan not be locked (see RLIMIT_MEMLOCK and CAP_IPC_LOCK) a warning is\n"
+                   "\twritten and application runs with memory unlocked.\n"
+                   "\tDefault is False.\n\n");
 
-    fprintf(stdout,"--loop_slowdown_three (microseconds 1-10000)\n"
-                   "\tSee description for option \"loop_slowdown_one\"\n"
+    fprintf(stdout,"--process_workers (number 0-64)\n"
+                   "\tRun vectorloops in this many worker processes, each running\n"
+                   "\t\"--process_thread_count\" vectorloops and its own support threads,\n"
+                   "\tso a crash takes down a single worker rather than every vectorloop.\n"
+                   "\tMaster process supervises workers and restarts one that exits, and\n"
+                   "\tforwards termination and reload (SIGHUP) signals to them. Workers\n"
+                   "\tshare listener ports (SO_REUSEPORT), pages of a zone image (see\n"
+                   "\t\"--zone_image_compile\") and a shared memory metrics segment, which\n"
+                   "\tworker 0 exports. \"--process_thread_masks\" then lists CPUs of all\n"
+                   "\tvectorloops, worker by worker, and query log file names and shared\n"
+                   "\tmemory paths get a \"_w<worker>\" suffix.\n"
+                   "\tCan not be used with \"--upgrade_socket\", \"--xdp_interface\",\n"
+                   "\t\"--process_thread_cpu_steering\", \"--process_thread_client_steering\",\n"
+                   "\t\"--process_thread_auto_pin\" and \"--metrics_sketches\".\n"
+                   "\tDefault is 0, vectorloops are threads of a single process.\n\n");
+
+    fprintf(stdout,"--loop_idle_spin (microseconds 0-10000)\n"
+                   "\tVectorloop is a continuously running loop. If there are no queries to\n"
+                   "\tprocess the loop would needlessly consume CPU cycles. When a loop\n"
+                   "\titeration processed nothing, vectorloop first spins (busy waits using a\n"
+                   "\tCPU pause instruction) for up to \"loop_idle_spin\" time so that a query\n"
+                   "\tarriving shortly after is picked up without delay. Once the spin window\n"
+                   "\thas elapsed vectorloop blocks in epoll_wait() until a socket becomes\n"
+                   "\treadable, a message arrives on a channel, the nearest TCP connection\n"
+                   "\ttimeout is due or \"loop_idle_wait_max\" time has passed. Value of 0\n"
+                   "\tdisables spinning and vectorloop blocks as soon as it is idle.\n"
                    "\tDefault is 50.\n\n");
-        
+
+    fprintf(stdout,"--loop_idle_wait_max (milliseconds 1-1000)\n"
+                   "\tMaximum time an idle vectorloop blocks in epoll_wait(). See\n"
+                   "\tdescription for option \"loop_idle_spin\".\n"
+                   "\tDefault is 100.\n\n");
+
+    fprintf(stdout,"--loop_calibrate (True|False)\n"
+                   "\tAt startup, before vectorloops start, replay synthetic UDP queries\n"
+                   "\tthrough vectorloop stages in memory and set \"udp_conn_vector_len\",\n"
+                   "\t\"epoll_num_events_udp\", \"epoll_num_events_tcp\" and \"loop_idle_spin\"\n"
+                   "\tfrom measurements, replacing values given for them. Vector length of\n"
+                   "\thighest throughput whose 99th percentile iteration time is within\n"
+                   "\t\"loop_calibrate_latency\" is picked, TCP events fill what is left of\n"
+                   "\tthat time, and spin time is set to what blocking in epoll_wait() and\n"
+                   "\tbeing woken up costs. Chosen settings are printed. SIGUSR1 runs\n"
+                   "\tcalibration again and logs settings it would choose, in configuration\n"
+                   "\tfile format.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--loop_calibrate_latency (microseconds 1-1000000)\n"
+                   "\tVectorloop iteration time calibration keeps 99th percentile within,\n"
+                   "\tsee \"loop_calibrate\".\n"
+                   "\tDefault is 200.\n\n");
+
+    fprintf(stdout,"--loop_hugepages (True|False)\n"
+                   "\tAdvise kernel to back large vectorloop buffers (response cache, RRL\n"
+                   "\ttable, query log buffers and UDP listener arena) with transparent huge\n"
+                   "\tpages, which lowers TLB misses when they are accessed at random. Buffers\n"
+                   "\tare allocated by each vectorloop thread after it is bound to its CPU, so\n"
+                   "\tthey are placed on memory node of that CPU either way.\n"
+                   "\tNOTE: requires transparent huge pages set to \"madvise\" or \"always\" in\n"
+                   "\t/sys/kernel/mm/transparent_hugepage/enabled.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--loop_hugetlb (True|False)\n"
+                   "\tBack memory UDP listener vectors and queries are allocated from with\n"
+                   "\texplicit huge pages (MAP_HUGETLB), which lowers TLB misses when vectors\n"
+                   "\tare walked. Each vectorloop allocates this memory as one contiguous arena.\n"
+                   "\tIf no huge pages are available regular pages are used and this is logged\n"
+                   "\tto application log.\n"
+                   "\tNOTE: requires huge pages reserved in /proc/sys/vm/nr_hugepages.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--loop_prefault (True|False)\n"
+                   "\tTouch every page of memory UDP listener vectors and queries are allocated\n"
+                   "\tfrom, and of response cache, RRL table, query log buffers and TCP connection\n"
+                   "\ttable, when vectorloop starts, so no page is first touched, and faulted in,\n"
+                   "\twhile queries are served. Vectorloop logs memory it warmed up to application\n"
+                   "\tlog before it starts listening.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--loop_mlock (True|False)\n"
+                   "\tLock vectorloop buffers listed for option \"loop_prefault\" in memory with\n"
+                   "\tmlock(), which also faults them in, so they are never reclaimed or swapped\n"
+                   "\tout. If buffers can not be locked, e.g. RLIMIT_MEMLOCK (ulimit -l) is too\n"
+                   "\tlow and process lacks CAP_IPC_LOCK, it is logged to application log and\n"
+                   "\tbuffers are used unlocked.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--loop_stage_metrics (True|False)\n"
+                   "\tTime each vectorloop stage with CPU cycle counter, and count items (datagrams,\n"
+                   "\tqueries, responses, log bytes) each stage processed. Per vectorloop histograms\n"
+                   "\tof stage cycles and items, loop iteration cycles and busy/idle cycle counts\n"
+                   "\tare exported with metrics, together with depth (highest length) and mean\n"
+                   "\tdwell cycles of pipeline queues (query parse, resolve, response pack, query\n"
+                   "\tlog, TCP read, write and release) per iteration, sampled at stage ends.\n"
+                   "\tCost is a cycle counter read and a histogram update per stage per loop\n"
+                   "\titeration.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--memory_budget (number 0-16777216)\n"
+                   "\tMemory budget in megabytes vectorloop buffers and zone database are kept\n"
+                   "\twithin. Memory each vectorloop allocates is accounted by subsystem (UDP, TCP\n"
+                   "\tconnections, TCP buffers, query log, response cache, RRL, DNSSEC) and exported\n"
+                   "\twith metrics, whether budget is set or not. With a budget set, response cache\n"
+                   "\tand DNSSEC signature cache of each vectorloop are shrunk to fit in a quarter\n"
+                   "\tof vectorloop share of budget, and vectorloops stop taking on new TCP\n"
+                   "\tconnections, other than in place of idle ones (see \"tcp_conns_idle_evict\"),\n"
+                   "\tonce memory in use nears budget. Memory zone database holds counts against\n"
+                   "\tbudget.\n"
+                   "\t0 means there is no budget.\n"
+                   "\tDefault is 0.\n\n");
+
     fprintf(stdout,"--app_log_name (string)\n"
                    "\tName of application log file. See related optin \"app_log_path\".\n"
                    "\tMaximum length of application log path plus name is 4096 which includes\n"
@@ -255,9 +927,18 @@ usage(void)
                    "\tDefault is \".\" (directory where application is started in).\n\n");
 
     fprintf(stdout,"--query_log_buffer_size (number 1-UINTMAX_MAX)\n"
-                   "\tSize in bytes for query log buffer. Each vectorloop allocates two\n"
-                   "\tbuffers of this size used to write query logs to.\n"
-                   "\tDefault is 6553500.\n\n");
+                   "\tSize in bytes for query log buffer. Each vectorloop allocates\n"
+                   "\t\"query_log_buffer_count\" buffers of this size used to write query\n"
+                   "\tlogs to.\n"
+                   "\tDefault is 3276750.\n\n");
+
+    fprintf(stdout,"--query_log_buffer_count (number 2-64)\n"
+                   "\tNumber of query log buffers each vectorloop allocates. Vectorloop hands\n"
+                   "\tbuffers with logged queries to query log thread and continues logging\n"
+                   "\tinto next free buffer. If query log thread falls behind and no buffer\n"
+                   "\tis free, vectorloop keeps logging into its current buffer until it is\n"
+                   "\tfull, after which queries are not logged.\n"
+                   "\tDefault is 4.\n\n");
 
     fprintf(stdout,"--query_log_base_name (string)\n"
                    "\tBase name for query log file. actual file name used is base name with\n"
@@ -270,10 +951,533 @@ usage(void)
 
     fprintf(stdout,"--query_log_rotate_size (number 1-UINTMAX_MAX)\n"
                    "\tSize in bytes when exceeded a new query log file is opened. Note that this\n"
-                   "\tsize limit is checked after each write (one write per vectorloop buffer)\n"
-                   "\thence the actual file size would always exceed it.\n"
+                   "\tsize limit is checked after each write (one write per text buffer of up\n"
+                   "\tto 1048576 bytes) hence the actual file size would always exceed it.\n"
                    "\tDefault is 50000000.\n\n");
 
+    fprintf(stdout,"--query_log_sample_rate (number 1-1000000)\n"
+                   "\tLog one in this many queries that pass query log filters. Sampling is\n"
+                   "\tdone per vectorloop.\n"
+                   "\tDefault is 1 (log all queries).\n\n");
+
+    fprintf(stdout,"--query_log_rcodes (comma separated rcode names, or \"all\")\n"
+                   "\tOnly log queries responded to with one of listed rcodes. Recognized\n"
+                   "\trcodes are NOERROR, FORMERR, SERVFAIL, NXDOMAIN, NOTIMPL, REFUSED,\n"
+                   "\tBADVERS, and NORESPONSE for queries no response was sent for.\n"
+                   "\tExample: --query_log_rcodes=SERVFAIL,REFUSED\n"
+                   "\tDefault is \"all\".\n\n");
+
+    fprintf(stdout,"--query_log_qtypes (comma separated query type names, or \"all\")\n"
+                   "\tOnly log queries with one of listed question types.\n"
+                   "\tExample: --query_log_qtypes=A,AAAA\n"
+                   "\tDefault is \"all\".\n\n");
+
+    fprintf(stdout,"--query_log_errors_only (True|False)\n"
+                   "\tDo not log queries responded to with rcode NOERROR, unless they are\n"
+                   "\tslower than \"query_log_latency_min\".\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--query_log_latency_min (number 0-60000000)\n"
+                   "\tOnly log queries responded to with rcode NOERROR if time from query\n"
+                   "\tread to response written is at least this many microseconds. Queries\n"
+                   "\twith other rcodes are not affected. 0 disables the threshold.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--query_log_direct_io (True|False)\n"
+                   "\tWrite query log files with O_DIRECT, bypassing page cache. Writes are\n"
+                   "\tmade in whole 4096 byte blocks, when there are no more queries to log\n"
+                   "\tlast block is padded with new lines. If file system does not support\n"
+                   "\tO_DIRECT files are written without it. Ignored when query log is\n"
+                   "\tcompressed or streamed to remote collector.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--query_log_splice (True|False)\n"
+                   "\tWrite query log files by mapping buffers into a pipe with vmsplice\n"
+                   "\tand splicing pipe to file, instead of with write. If kernel or file\n"
+                   "\tsystem does not support it files are written with write. Ignored\n"
+                   "\twith \"query_log_direct_io\" and when query log is streamed to\n"
+                   "\tremote collector.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--query_log_compress (True|False)\n"
+                   "\tCompress query log with gzip. Each text buffer (up to 1048576 bytes) is\n"
+                   "\tcompressed into its own gzip member, so decompression can start at any\n"
+                   "\tmember. Files are named with \".gz\" suffix. \"query_log_rotate_size\"\n"
+                   "\tcounts uncompressed bytes.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--query_log_remote_ip (IPv4 or IPv6 address)\n"
+                   "\tStream query log over TCP to remote collector at this IP address\n"
+                   "\tinstead of writing it to files. Stream has same content files would,\n"
+                   "\tand is compressed if \"query_log_compress\" is set. If connection\n"
+                   "\tfails it is retried once a second.\n"
+                   "\tDefault is not set (write query log to files).\n\n");
+
+    fprintf(stdout,"--query_log_remote_port (number 1-65535)\n"
+                   "\tTCP port of remote query log collector.\n"
+                   "\tDefault is 9154.\n\n");
+
+    fprintf(stdout,"--query_log_remote_unix (string)\n"
+                   "\tStream query log to remote collector listening on Unix socket at\n"
+                   "\tthis path instead of writing it to files. Can not be used together\n"
+                   "\twith \"query_log_remote_ip\".\n"
+                   "\tDefault is not set.\n\n");
+
+    fprintf(stdout,"--query_log_format (text|dnstap|arrow)\n"
+                   "\tFormat of query log. \"text\" writes one JSON object per query per line.\n"
+                   "\t\"dnstap\" writes dnstap AUTH_QUERY and AUTH_RESPONSE messages in Frame\n"
+                   "\tStreams format, each query log file is a complete stream. When streamed\n"
+                   "\tto remote collector Frame Streams bidirectional handshake is done and\n"
+                   "\t\"query_log_compress\" is ignored. DNS messages in dnstap are rebuilt from\n"
+                   "\tlogged data and hold question, answer section and EDNS options.\n"
+                   "\t\"arrow\" writes Arrow IPC streaming format for analytics ingestion, each\n"
+                   "\tquery log file is a complete stream of record batches of up to 2048\n"
+                   "\tqueries, with columns time, duration, client_ip, client_port, local_ip,\n"
+                   "\tlocal_port, protocol, id, flags, edns_udp_size, qname, qclass, qtype,\n"
+                   "\trcode and answer_count. Addresses, qtype and rcode are dictionary\n"
+                   "\tencoded. Answer records are not logged.\n"
+                   "\tDefault is \"text\".\n\n");
+
+    fprintf(stdout,"--query_log_shm_path (string)\n"
+                   "\tMap query log buffers of each vectorloop from shared memory file at\n"
+                   "\tthis path followed by \".<vectorloop ID>\" (I.E: /dev/shm/ripples_qlog\n"
+                   "\tmaps /dev/shm/ripples_qlog.0, /dev/shm/ripples_qlog.1, ..), so external\n"
+                   "\tprocesses read binary query log records right where vectorloop wrote\n"
+                   "\tthem, alongside query log writer. Readers are never waited on, falling\n"
+                   "\tbehind by more than \"query_log_buffer_count\" buffers is counted as\n"
+                   "\toverrun in file header. Existing files are replaced.\n"
+                   "\tDefault is not set.\n\n");
+
+    fprintf(stdout,"--query_log_age_max (milliseconds 0-3600000)\n"
+                   "\tUpper bound on how long a logged query may wait before it is handed\n"
+                   "\tto disk. Query log thread never sleeps longer than this, hands text it\n"
+                   "\tholds to writer at least this often (padding last block with new lines\n"
+                   "\twith \"query_log_direct_io\"), and queries spilled with\n"
+                   "\t\"query_log_full_policy\" \"spill\" for longer are dropped.\n"
+                   "\tDefault is 0 (not bounded).\n\n");
+
+    fprintf(stdout,"--query_log_full_policy (drop|spill|sample)\n"
+                   "\tWhat vectorloop does when query log thread falls behind and all query\n"
+                   "\tlog buffers are in use. Vectorloop never waits on query log thread.\n"
+                   "\t\"drop\" keeps logging into active buffer until it is full, then does\n"
+                   "\tnot log queries. \"spill\" logs queries that do not fit into a spill\n"
+                   "\tbuffer of \"query_log_spill_size\" bytes, moved to query log buffers\n"
+                   "\tas they free up. \"sample\" logs one in \"query_log_full_sample_rate\"\n"
+                   "\tqueries while all buffers are in use, so active buffer lasts longer.\n"
+                   "\tDefault is \"drop\".\n\n");
+
+    fprintf(stdout,"--query_log_spill_size (number 1-UINTMAX_MAX)\n"
+                   "\tSize of each vectorloop spill buffer in bytes, see\n"
+                   "\t\"query_log_full_policy\".\n"
+                   "\tDefault is 3276750.\n\n");
+
+    fprintf(stdout,"--query_log_full_sample_rate (number 1-1000000)\n"
+                   "\tLog one in this many queries while all query log buffers are in use,\n"
+                   "\tsee \"query_log_full_policy\".\n"
+                   "\tDefault is 10.\n\n");
+
+    fprintf(stdout,"--query_log_index (True|False)\n"
+                   "\tWrite a sparse index next to each query log file, named after it with\n"
+                   "\t\".idx\" appended. Index has an entry per block of at most\n"
+                   "\t\"query_log_index_records\" queries, with block offset, receive time\n"
+                   "\trange and a filter of question names, so ripples_qlog tool decodes\n"
+                   "\tonly blocks of a time window or question name. Only text query log\n"
+                   "\tfiles are indexed, not dnstap, arrow nor remote collectors.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--query_log_index_records (number 1-1000000)\n"
+                   "\tMaximum number of queries in an indexed query log block, see\n"
+                   "\t\"query_log_index\".\n"
+                   "\tDefault is 4096.\n\n");
+
+    fprintf(stdout,"--zone_file (string)\n"
+                   "\tPath to zone file DNS queries are answered from. Zone file has one\n"
+                   "\tresource record per line in format \"<owner> <ttl> IN <type> <rdata>\".\n"
+                   "\tSupported types are A, AAAA, NS, CNAME, PTR, MX, TXT, SRV and SOA.\n"
+                   "\tZone file is loaded into zone database at startup and reloaded when it\n"
+                   "\tchanges on disk. Until zone database is loaded queries are answered\n"
+                   "\twith rcode SERVFAIL.\n"
+                   "\tDefault is \"zone.txt\", relative to directory application is started from.\n\n");
+
+    fprintf(stdout,"--zone_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which zone file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--zone_delta_file (string)\n"
+                   "\tPath to zone delta file applied on top of zone file, so small changes to a\n"
+                   "\tlarge zone do not require zone file to be reloaded. Zone delta file has same\n"
+                   "\tformat as zone file, records in it replace RRset of their owner name and\n"
+                   "\ttype. A line \"-<owner> <type|ANY>\" deletes RRset (or all RRsets) of owner\n"
+                   "\tname. Zone delta holds all changes since zone file, it is applied again when\n"
+                   "\tzone file is reloaded. Zone delta file not existing is an empty delta.\n"
+                   "\tDefault is \"\", there is no zone delta file.\n\n");
+
+    fprintf(stdout,"--zone_image_compile (string)\n"
+                   "\tCompile zone file into zone image at given path and exit. Zone image is a\n"
+                   "\tprecompiled zone database, when zone file is a zone image it is memory\n"
+                   "\tmapped instead of parsed, so large zones load in a fraction of the time.\n"
+                   "\tZone image is specific to machine architecture it was compiled on.\n"
+                   "\tDefault is \"\", zone file is not compiled.\n\n");
+
+    fprintf(stdout,"--zone_prefault (True|False)\n"
+                   "\tFault in every page of zone database once it is loaded, before it is\n"
+                   "\tpublished to vectorloops, on start and on every reload. Zone image is read\n"
+                   "\tinto page cache and mapped up front, so first lookups after a reload do not\n"
+                   "\twait on disk reads and page faults. Vectorloops start listening once zone\n"
+                   "\tdatabase is loaded. Warm up of each zone database is logged to application\n"
+                   "\tlog.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--zone_mlock (True|False)\n"
+                   "\tLock zone database memory (zone image and database buffers) with mlock()\n"
+                   "\tonce it is loaded, so it is never reclaimed or swapped out. Memory is\n"
+                   "\tunlocked when zone database is released after a reload. If it can not be\n"
+                   "\tlocked, see option \"loop_mlock\", it is logged to application log and\n"
+                   "\tzone database is used unlocked.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--zone_compile_threads (number 1-64)\n"
+                   "\tNumber of threads zone file is parsed and compiled on. Resource thread\n"
+                   "\tis one of them, it starts others at startup and they share its CPU binding,\n"
+                   "\tsee option \"process_housekeeping_cpus\". Vectorloops keep answering from\n"
+                   "\tprevious zone database generation meanwhile.\n"
+                   "\tDefault is 1.\n\n");
+
+    fprintf(stdout,"--zone_transfer_allow (comma separated IP networks)\n"
+                   "\tClients allowed to transfer zones (AXFR, IXFR over TCP), as IPv4 or IPv6\n"
+                   "\taddresses with optional prefix length. Zone transfers are sent from zone\n"
+                   "\timage, so zone file has to be a zone image. IXFR is answered with full\n"
+                   "\tzone. Queries of other clients are refused.\n"
+                   "\tExample: --zone_transfer_allow=192.0.2.0/24,2001:db8::53\n"
+                   "\tDefault is \"\", zone transfers are refused.\n\n");
+
+    fprintf(stdout,"--zone_secondary (comma separated zone names)\n"
+                   "\tZones served as secondary, transferred (AXFR, IXFR) from zone primary\n"
+                   "\tinstead of loaded from zone file. Zone is transferred at startup, and\n"
+                   "\tagain once SOA refresh interval elapses, or right away when primary\n"
+                   "\tsends NOTIFY for it. Zone file is optional (\"--zone_file=\"), secondary\n"
+                   "\tzones take precedence over zone file records of the same zone.\n"
+                   "\tRequires option \"zone_primary\".\n"
+                   "\tExample: --zone_secondary=example.com,example.net\n"
+                   "\tDefault is \"\", there are no secondary zones.\n\n");
+
+    fprintf(stdout,"--zone_primary (IP address)\n"
+                   "\tIPv4 or IPv6 address of primary server secondary zones are transferred\n"
+                   "\tfrom. NOTIFY is accepted only from this address.\n"
+                   "\tDefault is \"\", there is no zone primary.\n\n");
+
+    fprintf(stdout,"--zone_primary_port (number 1-65535)\n"
+                   "\tTCP port of zone primary.\n"
+                   "\tDefault is 53.\n\n");
+
+    fprintf(stdout,"--ecs_map_file (string)\n"
+                   "\tPath to ECS map file used to tailor answers to EDNS client subnet\n"
+                   "\t(RFC 7871). ECS map file has one prefix per line in format\n"
+                   "\t\"<prefix>/<length> <view>\" where view is a single DNS label. A query\n"
+                   "\twhose client subnet maps to a view is answered from RRset owned by\n"
+                   "\tquery name prefixed with view label, e.g. \"_eu.www.example.com\", if\n"
+                   "\tthere is one. Responses to queries for names in zone database carry\n"
+                   "\tscope prefix length of matched map region.\n"
+                   "\tDefault is \"\", ECS map is not loaded.\n\n");
+
+    fprintf(stdout,"--ecs_map_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which ECS map file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--views_file (string)\n"
+                   "\tPath to view file declaring split-horizon views. Each view is answered\n"
+                   "\tfrom a zone file of its own and is selected by query destination\n"
+                   "\taddress, or failing that by query source address. View file has one\n"
+                   "\tdirective per line, \"view <view> <zone file>\" declares a view,\n"
+                   "\t\"dst <prefix>/<length> <view>\" and \"src <prefix>/<length> <view>\"\n"
+                   "\tselect it by destination and source address. Queries no view is\n"
+                   "\tselected for are answered from zone file. View zone files are loaded\n"
+                   "\tagain when view file changes.\n"
+                   "\tDefault is \"\", there are no views.\n\n");
+
+    fprintf(stdout,"--views_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which view file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--zone_catalog_file (string)\n"
+                   "\tPath to zone catalog file listing zones that are each loaded from a\n"
+                   "\tzone file of their own, e.g. hosted customer zones. File has one zone\n"
+                   "\tper line in format \"<apex> <zone file>\". Zone file changes are\n"
+                   "\tpicked up zone by zone, a changed zone file is loaded again without\n"
+                   "\tany other zone being loaded again. Queries for names in a catalog zone\n"
+                   "\tare answered from it, other queries from zone file. Zone that fails to\n"
+                   "\tload keeps zone data it had, and its error is logged.\n"
+                   "\tDefault is \"\", there is no zone catalog.\n\n");
+
+    fprintf(stdout,"--zone_catalog_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which zone catalog file, and zone files of its zones,\n"
+                   "\tare checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--acl_file (string)\n"
+                   "\tPath to client ACL file. ACL file has one prefix per line in format\n"
+                   "\t\"<prefix>/<length> <action>\" where action is \"allow\", \"refuse\" or\n"
+                   "\t\"drop\". Longest prefix matching query source address decides, before\n"
+                   "\tquery is parsed. Refused queries are answered with REFUSED, dropped\n"
+                   "\tones get no response and TCP connections from dropped addresses are\n"
+                   "\tclosed once accepted. Addresses no prefix matches are allowed.\n"
+                   "\tDefault is \"\", there is no client ACL.\n\n");
+
+    fprintf(stdout,"--acl_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which ACL file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--policy_file (string)\n"
+                   "\tPath to response policy (blocklist) file. Policy file has one name per\n"
+                   "\tline in format \"<name> [action]\" where action is \"nxdomain\" (default),\n"
+                   "\t\"nodata\", \"refuse\", \"drop\" or \"passthru\". Name \"*.example.com\"\n"
+                   "\tmatches names below example.com. Exact name decides, otherwise longest\n"
+                   "\tmatching wildcard does. Query name is checked before response cache and\n"
+                   "\tzone lookup, names no entry matches are resolved.\n"
+                   "\tDefault is \"\", there is no response policy.\n\n");
+
+    fprintf(stdout,"--policy_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which policy file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--geoip_file (string)\n"
+                   "\tPath to GeoIP database, a MaxMind DB (mmdb) file such as GeoLite2\n"
+                   "\tCountry. Database is memory mapped. Country and continent of EDNS client\n"
+                   "\tsubnet address, or of client address, select answer variant owned by\n"
+                   "\tquery name prefixed with \"_cc-<country>\" or \"_ct-<continent>\" label,\n"
+                   "\te.g. \"_cc-de.www.example.com\" or \"_ct-eu.www.example.com\".\n"
+                   "\tDefault is \"\", there is no GeoIP database.\n\n");
+
+    fprintf(stdout,"--geoip_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which GeoIP database file is checked for change.\n"
+                   "\tDefault is 60.\n\n");
+
+    fprintf(stdout,"--lb_file (string)\n"
+                   "\tPath to load balancing file. File has one candidate record per line in\n"
+                   "\tformat \"<name> <ttl> <A|AAAA> <address> <weight> [port]\". Query for\n"
+                   "\tname and type is answered with one record of its candidates, picked by\n"
+                   "\tweight among those whose endpoint is healthy, or among all of them if\n"
+                   "\tnone is. Endpoint is probed with TCP connect to port, endpoint with no\n"
+                   "\tport is always healthy. Name MUST be in a zone served, candidates\n"
+                   "\treplace its records of that type. Answers are not cached.\n"
+                   "\tDefault is \"\", there are no load balanced names.\n\n");
+
+    fprintf(stdout,"--lb_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which load balancing file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--lb_check_interval (seconds %d-%d)\n"
+                   "\tInterval at which load balancing endpoints are probed. Endpoint goes\n"
+                   "\tdown after %d failed probes in a row and up after %d passed ones.\n"
+                   "\tDefault is %d.\n\n",
+                   LB_CHECK_INTERVAL_MIN, LB_CHECK_INTERVAL_MAX,
+                   LB_CHECK_FALL, LB_CHECK_RISE,
+                   CFG_DEFAULT_LB_CHECK_INTERVAL);
+
+    fprintf(stdout,"--lb_check_timeout (milliseconds %d-%d)\n"
+                   "\tTime load balancing endpoint probe waits for TCP connect to complete\n"
+                   "\tbefore it fails.\n"
+                   "\tDefault is %d.\n\n",
+                   LB_CHECK_TIMEOUT_MIN, LB_CHECK_TIMEOUT_MAX,
+                   CFG_DEFAULT_LB_CHECK_TIMEOUT);
+
+    fprintf(stdout,"--config_file (file path)\n"
+                   "\tFull path of configuration file with settings that are applied without\n"
+                   "\trestart. File has one setting per line in format \"<option> <value>\",\n"
+                   "\twhere option is name of command line option, lines starting with '#'\n"
+                   "\tare comments. Settings in file are applied on top of command line\n"
+                   "\toptions, once at startup and each time file changes, or SIGHUP is\n"
+                   "\treceived. Setting removed from file reverts to its command line value.\n"
+                   "\tFile with an error is not applied. Settings that can be set in file:\n"
+                   "\tloop_budget_udp_datagrams, loop_budget_tcp_reads,\n"
+                   "\tloop_budget_tcp_accepts, loop_budget_xfr_bytes, loop_idle_spin,\n"
+                   "\tloop_idle_wait_max,\n"
+                   "\tudp_conn_vector_len, udp_conn_vector_len_min, udp_pipeline_batch_len,\n"
+                   "\ttcp_listener_max_accept_new_conn, tcp_keepalive,\n"
+                   "\ttcp_keepalive_shrink_start,\n"
+                   "\ttcp_query_recv_timeout, tcp_query_send_timeout, tcp_handoff_threshold,\n"
+                   "\ttcp_conns_idle_evict, udp_socket_recvbuff_autotune_max,\n"
+                   "\tquery_log_sample_rate, query_log_errors_only and query_log_latency_min.\n"
+                   "\tUDP vectors are allocated at startup, so udp_conn_vector_len can not\n"
+                   "\tbe raised above its startup value.\n"
+                   "\tDefault is \"\", there is no configuration file.\n\n");
+
+    fprintf(stdout,"--config_file_update_freq (seconds 1-86400)\n"
+                   "\tFrequency at which configuration file is checked for change.\n"
+                   "\tDefault is 5.\n\n");
+
+    fprintf(stdout,"--upgrade_socket (file path)\n"
+                   "\tPath of Unix socket used to upgrade application without downtime.\n"
+                   "\tApplication listens on it for a new process, e.g. one running an\n"
+                   "\tupgraded binary, and hands its listener sockets over to it. New\n"
+                   "\tprocess is started with the same option, and the same\n"
+                   "\tprocess_thread_count and process_thread_roles, it takes listener\n"
+                   "\tsockets over instead of starting its own. Once new process loaded\n"
+                   "\tzone and is serving, running process shuts down as on SIGTERM,\n"
+                   "\tsee drain_time.\n"
+                   "\tCan not be used with xdp_interface.\n"
+                   "\tDefault is \"\", upgrades are disabled.\n\n");
+
+    fprintf(stdout,"--admin_socket (file path)\n"
+                   "\tPath of Unix socket admin thread serves live vectorloop state on.\n"
+                   "\tEach client connecting to it, e.g. \"socat - UNIX:<path>\", gets a\n"
+                   "\tline per vectorloop of its queue lengths, active TCP connections,\n"
+                   "\tquery log fill, resource generations and loop timing, as of its\n"
+                   "\tlast iteration. With process_workers each worker serves its own\n"
+                   "\tvectorloops, on path with \"_w<worker>\" suffix.\n"
+                   "\tDefault is \"\", admin socket is disabled.\n\n");
+
+    fprintf(stdout,"--drain_time (seconds %d-%d)\n"
+                   "\tMaximum time application drains for before it exits, on SIGTERM\n"
+                   "\tor SIGINT, or once it handed its listener sockets over on upgrade.\n"
+                   "\tDraining vectorloops stop reading from listeners, close idle TCP\n"
+                   "\tconnections and finish queries in progress, then query log is\n"
+                   "\tflushed. Second SIGTERM or SIGINT stops waiting for vectorloops.\n"
+                   "\tDefault is %d.\n\n",
+                   DRAIN_TIME_MIN, DRAIN_TIME_MAX,
+                   CFG_DEFAULT_DRAIN_TIME);
+
+    fprintf(stdout,"--response_cache_size (number 0-16777216)\n"
+                   "\tNumber of entries in response cache each vectorloop keeps. Cache holds\n"
+                   "\tpacked responses to recent queries and is invalidated when zone\n"
+                   "\tdatabase is reloaded. Value is rounded up to a power of 2. Each entry\n"
+                   "\ttakes about 600 bytes. Setting it to 0 disables response cache.\n"
+                   "\tDefault is 4096.\n\n");
+
+    fprintf(stdout,"--response_cache_shared_size (number 0-16777216)\n"
+                   "\tNumber of entries in second level response cache shared by all\n"
+                   "\tvectorloops. It is looked up when response cache of vectorloop misses,\n"
+                   "\tso a response packed by one vectorloop is found by others, and it is\n"
+                   "\tread without locks. Value is rounded up to a power of 2, entries are\n"
+                   "\tgrouped in sets of 4. Each entry takes about 600 bytes. Setting it to 0\n"
+                   "\tdisables shared response cache.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--response_cache_snapshot_path (string)\n"
+                   "\tWarm restart response caches. Draining vectorloop writes questions of\n"
+                   "\tits cached responses, most hit first, to file at this path followed by\n"
+                   "\t\".<vectorloop ID>\" (I.E: /var/lib/ripples/cache maps to\n"
+                   "\t/var/lib/ripples/cache.0, ..). Vectorloop maps its file on start and,\n"
+                   "\tonce first zone database is loaded, resolves questions into its\n"
+                   "\tresponse cache before it answers queries. Existing files are replaced.\n"
+                   "\tDefault is not set.\n\n");
+
+    fprintf(stdout,"--rrl_responses_per_second (number 0-1000000)\n"
+                   "\tNumber of UDP responses per second each vectorloop sends to a client\n"
+                   "\tnetwork with same response class (answer, no data, name error, error),\n"
+                   "\twith a burst of up to one second worth of responses. Responses over the\n"
+                   "\tlimit are dropped or slipped, see rrl_slip. TCP responses are not\n"
+                   "\tlimited. Setting it to 0 disables response rate limiting.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--rrl_slip (number 0-10)\n"
+                   "\tEvery slip-th response over the rate limit is replaced by a truncated\n"
+                   "\t(TC=1) response, so legitimate clients can retry over TCP. Rest are\n"
+                   "\tdropped. Setting it to 0 drops all responses over the limit, 1 slips all.\n"
+                   "\tDefault is 2.\n\n");
+
+    fprintf(stdout,"--rrl_ipv4_prefix_len (number 0-32)\n"
+                   "\tPrefix length IPv4 client addresses are grouped into networks by for\n"
+                   "\tresponse rate limiting.\n"
+                   "\tDefault is 24.\n\n");
+
+    fprintf(stdout,"--rrl_ipv6_prefix_len (number 0-56)\n"
+                   "\tPrefix length IPv6 client addresses are grouped into networks by for\n"
+                   "\tresponse rate limiting.\n"
+                   "\tDefault is 56.\n\n");
+
+    fprintf(stdout,"--rrl_table_size (number 4-16777216)\n"
+                   "\tNumber of client network and response class entries in response rate\n"
+                   "\tlimiting table each vectorloop keeps. Value is rounded up to a power of\n"
+                   "\t2. Each entry takes 16 bytes. When table is full, entry least recently\n"
+                   "\tover its limit is replaced.\n"
+                   "\tDefault is 65536.\n\n");
+
+    fprintf(stdout,"--overload_iteration_max (number 0-1000000)\n"
+                   "\tMean time in microseconds of busy vectorloop iterations above which\n"
+                   "\tvectorloop is overloaded. Vectorloop is also overloaded when kernel\n"
+                   "\tdrops datagrams on its UDP listeners, or most of its listener reads\n"
+                   "\tcome back full. Every 100 milliseconds overloaded vectorloop sheds more\n"
+                   "\twork, in order: query logging is skipped, UDP queries of types zone\n"
+                   "\tdatabase does not hold (and ANY) are dropped, UDP queries of clients not\n"
+                   "\tallowlisted by client ACL, nor with a valid server cookie, are dropped\n"
+                   "\tor slipped, see overload_slip.\n"
+                   "\tShedding is undone step by step once vectorloop is not overloaded for\n"
+                   "\ta second. Setting it to 0 disables overload shedding.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--overload_slip (number 0-10)\n"
+                   "\tEvery slip-th UDP query shed by client under overload is answered with a\n"
+                   "\ttruncated (TC=1) response, so legitimate clients can retry over TCP.\n"
+                   "\tRest are dropped. Setting it to 0 drops all, 1 slips all.\n"
+                   "\tDefault is 2.\n\n");
+
+    fprintf(stdout,"--slo_latency_p50 (microseconds 0-60000000)\n"
+                   "\tObjective of median end to end query latency of each vectorloop, over\n"
+                   "\trolling window of slo_window seconds. Vectorloop logs an application log\n"
+                   "\tmessage when latency goes above objective, and when it is back within.\n"
+                   "\tSetting it to 0 sets no objective.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--slo_latency_p99 (microseconds 0-60000000)\n"
+                   "\tObjective of 99th percentile query latency, see slo_latency_p50.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--slo_latency_p999 (microseconds 0-60000000)\n"
+                   "\tObjective of 99.9th percentile query latency, see slo_latency_p50.\n"
+                   "\tDefault is 0.\n\n");
+
+    fprintf(stdout,"--slo_window (seconds 1-60)\n"
+                   "\tLength of rolling window latency objectives are evaluated over, every\n"
+                   "\tsecond. Window with fewer than 100 queries is not evaluated.\n"
+                   "\tDefault is 10.\n\n");
+
+    fprintf(stdout,"--dns_cookies (True|False)\n"
+                   "\tAnswer EDNS cookie option (RFC 7873) with client and server cookie.\n"
+                   "\tResponses to queries with a valid server cookie are not subject to\n"
+                   "\tresponse rate limiting, as client address is known not to be spoofed.\n"
+                   "\tDefault is True.\n\n");
+
+    fprintf(stdout,"--dns_cookie_secret (32 hex digits)\n"
+                   "\tSecret server cookies are generated with. All servers answering for the\n"
+                   "\tsame addresses (anycast) should use the same secret.\n"
+                   "\tDefault is a random secret generated at startup.\n\n");
+
+    fprintf(stdout,"--metrics_enable (True|False)\n"
+                   "\tStart metrics thread which serves application metrics over HTTP. Path\n"
+                   "\t\"/metrics\" returns metrics in Prometheus text format, path\n"
+                   "\t\"/metrics.bin\" returns a compact binary snapshot of all counters.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--metrics_listener_ip (IPv4 or IPv6 address)\n"
+                   "\tIP address metrics thread listens on for HTTP requests.\n"
+                   "\tDefault is \"127.0.0.1\".\n\n");
+
+    fprintf(stdout,"--metrics_listener_port (number 1-65535)\n"
+                   "\tTCP port metrics thread listens on for HTTP requests.\n"
+                   "\tDefault is 9153.\n\n");
+
+    fprintf(stdout,"--metrics_sketches (True|False)\n"
+                   "\tSketch question names and client networks (IPv4 /24, IPv6 /56) of queries\n"
+                   "\twith Space-Saving top-K sketches, and distinct client addresses with\n"
+                   "\tHyperLogLog, in windows of 10 seconds. Metrics export top 20 names and\n"
+                   "\tnetworks and estimated distinct clients of last window. Requires\n"
+                   "\tmetrics_enable.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--metrics_zones (True|False)\n"
+                   "\tCount queries of each zone, of main zone database and of views, by response\n"
+                   "\tcode and question type. First 256 zones get counters of their own, queries\n"
+                   "\tof zones past them are counted together. Requires metrics_enable.\n"
+                   "\tDefault is False.\n\n");
+
+    fprintf(stdout,"--metrics_query_cost (number 0-1000000)\n"
+                   "\tTime 1 in N queries with CPU cycle counter through parse, resolve and\n"
+                   "\tpack stages and sum their cycles by protocol, path (plain, cached, ecs,\n"
+                   "\ttruncated), response code and question type. 0 disables sampling.\n"
+                   "\tRequires metrics_enable.\n"
+                   "\tDefault is 0.\n\n");
+
     fprintf(stdout,"Example:\n"
                    "\tripples --udp_listener_port=9053 --tcp_enable=false\n\n");
 }
@@ -309,6 +1513,318 @@ config_parse_unsigned_long_opt(const char *name, const char *str, size_t min, si
     return tmp_ul;
 }
 
+/** Query log rcode names recognized by "query_log_rcodes" option, and the
+ * bit each sets in query log rcode mask.
+ */
+static const struct {
+    const char *name;
+    uint32_t    bit;
+} config_query_log_rcodes[] = {
+    { "NOERROR",    1U << rip_ns_r_noerror },
+    { "FORMERR",    1U << rip_ns_r_formerr },
+    { "SERVFAIL",   1U << rip_ns_r_servfail },
+    { "NXDOMAIN",   1U << rip_ns_r_nxdomain },
+    { "NOTIMPL",    1U << rip_ns_r_notimpl },
+    { "REFUSED",    1U << rip_ns_r_refused },
+    { "BADVERS",    1U << rip_ns_r_badvers },
+    { "NORESPONSE", QUERY_LOG_RCODE_NORESPONSE },
+};
+
+/** Parse comma separated list of rcode names into query log rcode mask.
+ * 
+ * @param str  String to parse, "all" selects all rcodes.
+ * @param mask Where to store parsed mask.
+ * 
+ * @return     Returns 0 on success. Otherwise an error message is printed to
+ *             stderr, and -1 is returned.
+ */
+static int
+config_parse_query_log_rcodes(const char *str, uint32_t *mask)
+{
+    char *list;
+    char *tok;
+    char *saveptr;
+    bool  found;
+
+    if (strcasecmp(str, "all") == 0) {
+        *mask = QUERY_LOG_RCODES_ALL;
+        return 0;
+    }
+    list = strdup(str);
+    CHECK_MALLOC(list);
+    *mask = 0;
+    for (tok = strtok_r(list, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        found = false;
+        for (size_t i = 0; i < sizeof(config_query_log_rcodes) / sizeof(config_query_log_rcodes[0]); i++) {
+            if (strcasecmp(tok, config_query_log_rcodes[i].name) == 0) {
+                *mask |= config_query_log_rcodes[i].bit;
+                found = true;
+                break;
+            }
+        }
+        if (found == false) {
+            fprintf(stderr,"Error parsing option \"query_log_rcodes\", '%s' is "
+                           "not a recognized rcode\n", tok);
+            free(list);
+            return -1;
+        }
+    }
+    free(list);
+    return 0;
+}
+
+/** Vectorloop role names recognized by "process_thread_roles" option, and
+ * the roles each sets in vectorloop roles mask.
+ */
+static const struct {
+    const char *name;
+    uint8_t     roles;
+} config_process_thread_roles[] = {
+    { "udp4", VL_ROLE_UDP_IPV4 },
+    { "udp6", VL_ROLE_UDP_IPV6 },
+    { "udp",  VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6 },
+    { "tcp4", VL_ROLE_TCP_IPV4 },
+    { "tcp6", VL_ROLE_TCP_IPV6 },
+    { "tcp",  VL_ROLE_TCP_IPV4 | VL_ROLE_TCP_IPV6 },
+    { "all",  VL_ROLES_ALL },
+};
+
+/** Check that option value is a CPU list (see @ref topology_cpu_list_parse)
+ * with at least one CPU of this machine.
+ *
+ * @param name Option name, for error message.
+ * @param str  Option value.
+ *
+ * @return     Returns 0 on success. Otherwise an error message is printed to
+ *             stderr, and -1 is returned.
+ */
+static int
+config_check_cpu_list(const char *name, const char *str)
+{
+    unsigned int   cpus  = get_nprocs_conf();
+    unsigned char *flags = malloc(cpus);
+    int            count = 0;
+
+    CHECK_MALLOC(flags);
+    count = topology_cpu_list_parse(str, flags, cpus);
+    free(flags);
+    if (count <= 0) {
+        fprintf(stderr,"Error parsing option \"%s\", '%s' is not a list of "
+                       "CPUs of this machine (0-%u)\n", name, str, cpus - 1);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Parse comma separated list of vectorloop roles, one entry for each
+ * vectorloop with its role names joined by '+'. Vectorloops with no entry, or
+ * an empty one, are left with roles they have.
+ * 
+ * @param str   String to parse.
+ * @param roles Array of vectorloop roles masks to store parsed roles into.
+ * @param count Number of vectorloops, entries past it are ignored.
+ * 
+ * @return      Returns 0 on success. Otherwise an error message is printed to
+ *              stderr, and -1 is returned.
+ */
+static int
+config_parse_process_thread_roles(const char *str, uint8_t *roles, size_t count)
+{
+    const char *entry = str;
+    const char *end   = NULL;
+    const char *name  = NULL;
+    size_t      len   = 0;
+    bool        found;
+
+    for (size_t i = 0; i < count && entry != NULL; i++) {
+        end = strchr(entry, ',');
+        if (end == NULL) {
+            end = entry + strlen(entry);
+        }
+        if (end > entry) {
+            roles[i] = 0;
+        }
+        for (name = entry; name < end; name += len + 1) {
+            len = strcspn(name, "+,");
+            found = false;
+            for (size_t r = 0; r < sizeof(config_process_thread_roles) / sizeof(config_process_thread_roles[0]); r++) {
+                if (strlen(config_process_thread_roles[r].name) == len &&
+                    strncasecmp(name, config_process_thread_roles[r].name, len) == 0) {
+                    roles[i] |= config_process_thread_roles[r].roles;
+                    found = true;
+                    break;
+                }
+            }
+            if (found == false) {
+                fprintf(stderr,"Error parsing option \"process_thread_roles\", '%.*s' "
+                               "is not a recognized role\n", (int)len, name);
+                return -1;
+            }
+            if (name + len == end) {
+                break;
+            }
+        }
+        entry = *end == ',' ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+/** Check that each enabled listener is run by at least one vectorloop.
+ * 
+ * @param cfg Configuration to check.
+ * 
+ * @return    Returns 0 on success. Otherwise an error message is printed to
+ *            stderr, and -1 is returned.
+ */
+static int
+config_check_process_thread_roles(const config_t *cfg)
+{
+    uint8_t roles    = 0;
+    uint8_t required = 0;
+
+    for (size_t i = 0; i < cfg->process_thread_count; i++) {
+        roles |= cfg->process_thread_roles[i];
+    }
+    if (cfg->udp_enable) {
+        required |= VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6;
+    }
+    if (cfg->tcp_enable || cfg->dot_enable) {
+        required |= VL_ROLE_TCP_IPV4 | VL_ROLE_TCP_IPV6;
+    }
+    if ((roles & required) != required) {
+        fprintf(stderr,"Error parsing option \"process_thread_roles\", no "
+                       "vectorloop runs%s%s%s%s listener\n",
+                       (required & ~roles & VL_ROLE_UDP_IPV4) ? " udp4" : "",
+                       (required & ~roles & VL_ROLE_UDP_IPV6) ? " udp6" : "",
+                       (required & ~roles & VL_ROLE_TCP_IPV4) ? " tcp4" : "",
+                       (required & ~roles & VL_ROLE_TCP_IPV6) ? " tcp6" : "");
+        return -1;
+    }
+    return 0;
+}
+
+/** Parse comma separated list of query type names into query log qtype mask.
+ * 
+ * @param str  String to parse, "all" selects all query types.
+ * @param mask Where to store parsed mask.
+ * 
+ * @return     Returns 0 on success. Otherwise an error message is printed to
+ *             stderr, and -1 is returned.
+ */
+static int
+config_parse_query_log_qtypes(const char *str, uint64_t *mask)
+{
+    char *list;
+    char *tok;
+    char *saveptr;
+    bool  found;
+
+    if (strcasecmp(str, "all") == 0) {
+        *mask = QUERY_LOG_QTYPES_ALL;
+        return 0;
+    }
+    list = strdup(str);
+    CHECK_MALLOC(list);
+    *mask = 0;
+    for (tok = strtok_r(list, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        found = false;
+        for (uint16_t t = 1; t <= rip_ns_t_opt && t < 64; t++) {
+            if (strcasecmp(tok, rip_ns_rr_type_to_str(t)) == 0) {
+                *mask |= (uint64_t)1 << t;
+                found = true;
+                break;
+            }
+        }
+        if (found == false) {
+            fprintf(stderr,"Error parsing option \"query_log_qtypes\", '%s' is "
+                           "not a recognized query type\n", tok);
+            free(list);
+            return -1;
+        }
+    }
+    free(list);
+    return 0;
+}
+
+/** Parse comma separated list of IP networks zone transfers are allowed to.
+ *
+ * @param str   String to parse.
+ * @param nets  Where to store allocated array of networks, NULL if list is
+ *              empty.
+ * @param count Where to store number of networks.
+ *
+ * @return      Returns 0 on success. Otherwise an error message is printed to
+ *              stderr, and -1 is returned.
+ */
+static int
+config_parse_zone_transfer_allow(const char *str, utl_net_t **nets, size_t *count)
+{
+    char *list;
+    char *tok;
+    char *saveptr;
+
+    free(*nets);
+    *nets  = NULL;
+    *count = 0;
+    list = strdup(str);
+    CHECK_MALLOC(list);
+    for (tok = strtok_r(list, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        *nets = realloc(*nets, sizeof(utl_net_t) * (*count + 1));
+        CHECK_MALLOC(*nets);
+        if (utl_net_parse(&(*nets)[*count], tok) != 0) {
+            fprintf(stderr,"Error parsing option \"zone_transfer_allow\", '%s' is "
+                           "not a valid IP network\n", tok);
+            free(list);
+            return -1;
+        }
+        INCREMENT(*count);
+    }
+    free(list);
+    return 0;
+}
+
+/** Parse comma separated list of IP addresses UDP listeners are bound to.
+ *
+ * @param str   String to parse.
+ * @param addrs Where to store allocated array of addresses, NULL if list is
+ *              empty.
+ * @param count Where to store number of addresses.
+ *
+ * @return      Returns 0 on success. Otherwise an error message is printed to
+ *              stderr, and -1 is returned.
+ */
+static int
+config_parse_udp_listener_addresses(const char *str, utl_net_t **addrs, size_t *count)
+{
+    char *list;
+    char *tok;
+    char *saveptr;
+
+    free(*addrs);
+    *addrs = NULL;
+    *count = 0;
+    list = strdup(str);
+    CHECK_MALLOC(list);
+    for (tok = strtok_r(list, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        *addrs = realloc(*addrs, sizeof(utl_net_t) * (*count + 1));
+        CHECK_MALLOC(*addrs);
+        if (strchr(tok, '/') != NULL || utl_net_parse(&(*addrs)[*count], tok) != 0) {
+            fprintf(stderr,"Error parsing option \"udp_listener_addresses\", '%s' is "
+                           "not a valid IP address\n", tok);
+            free(list);
+            return -1;
+        }
+        INCREMENT(*count);
+    }
+    free(list);
+    return 0;
+}
+
 /** Initialize configuration object to defaults.
  * 
  * @param cfg Configuration object to initialize.
@@ -321,50 +1837,199 @@ void config_init(config_t *cfg)
         .udp_listener_port                   = CFG_DEFAULT_UDP_LISTENER_PORT,
         .udp_socket_recvbuff_size            = CFG_DEFAULT_UDP_SOCK_RECVBUFF_SIZE,
         .udp_socket_sendbuff_size            = CFG_DEFAULT_UDP_SOCK_SENDBUFF_SIZE,
+        .udp_socket_busy_poll                = CFG_DEFAULT_UDP_SOCK_BUSY_POLL,
+        .udp_socket_recvbuff_autotune_max    = CFG_DEFAULT_UDP_SOCK_RECVBUFF_AUTOTUNE_MAX,
+        .udp_mirror_ip                       = NULL,
+        .udp_mirror_port                     = CFG_DEFAULT_UDP_MIRROR_PORT,
+        .udp_mirror_sample_rate              = CFG_DEFAULT_UDP_MIRROR_SAMPLE_RATE,
+        .listener_rx_timestamps              = CFG_DEFAULT_LISTENER_RX_TIMESTAMPS,
         .udp_conn_vector_len                 = CFG_DEFAULT_UDP_CONN_VECTOR_LEN,
+        .udp_conn_vector_len_min             = CFG_DEFAULT_UDP_CONN_VECTOR_LEN_MIN,
+        .udp_listener_batches                = CFG_DEFAULT_UDP_LISTENER_BATCHES,
+        .udp_pipeline_batch_len              = CFG_DEFAULT_UDP_PIPELINE_BATCH_LEN,
+        .udp_gso                             = CFG_DEFAULT_UDP_GSO,
+        .udp_dual_stack                      = CFG_DEFAULT_UDP_DUAL_STACK,
+        .xdp_interface                       = NULL,
+        .xdp_busy_poll                       = CFG_DEFAULT_XDP_BUSY_POLL,
+        .xdp_responder_size                  = 0,
+        .xdp_responder_hits                  = CFG_DEFAULT_XDP_RESPONDER_HITS,
 
         .tcp_enable                          = CFG_DEFAULT_TCP_ENABLE,
         .tcp_listener_pending_conns_max      = CFG_DEFAULT_TCP_LIST_PEND_CONNS_MAX,
+        .tcp_listener_fastopen               = CFG_DEFAULT_TCP_LISTENER_FASTOPEN,
+        .tcp_listener_defer_accept           = CFG_DEFAULT_TCP_LISTENER_DEFER_ACCEPT,
+        .tcp_listener_notsent_lowat          = CFG_DEFAULT_TCP_LISTENER_NOTSENT_LOWAT,
         .tcp_listener_port                   = CFG_DEFAULT_TCP_LISTENER_PORT,
         .tcp_listener_max_accept_new_conn    = CFG_DEFAULT_TCP_LIST_ACCEPT_NEW_CONNS_MAX,
         .tcp_conn_socket_recvbuff_size       = CFG_DEFAULT_TCP_SOCK_RECVBUFF_SIZE,
         .tcp_conn_socket_sendbuff_size       = CFG_DEFAULT_TCP_SOCK_SENDBUFF_SIZE,
         .tcp_conn_simultaneous_queries_count = CFG_DEFAULT_TCP_SIM_QUERY_COUNT,
         .tcp_keepalive                       = CFG_DEFAULT_TCP_KEEPALIVE,
+        .tcp_keepalive_shrink_start          = CFG_DEFAULT_TCP_KEEPALIVE_SHRINK_START,
         .tcp_query_recv_timeout              = CFG_DEFAULT_TCP_QUERY_RECV_TIMEOUT,
         .tcp_query_send_timeout              = CFG_DEFAULT_TCP_QUERY_SEND_TIMEOUT,
+        .tcp_handoff                         = CFG_DEFAULT_TCP_HANDOFF,
+        .tcp_handoff_threshold               = CFG_DEFAULT_TCP_HANDOFF_THRESHOLD,
+        .tcp_conns_per_client_max            = CFG_DEFAULT_TCP_CONNS_PER_CLIENT_MAX,
+        .tcp_conns_client_ipv4_prefix_len    = CFG_DEFAULT_TCP_CONNS_CLIENT_IPV4_PREFIX_LEN,
+        .tcp_conns_client_ipv6_prefix_len    = CFG_DEFAULT_TCP_CONNS_CLIENT_IPV6_PREFIX_LEN,
+        .tcp_conns_idle_evict                = CFG_DEFAULT_TCP_CONNS_IDLE_EVICT,
         .tcp_conns_per_vl_max                = CFG_DEFAULT_TCP_CONN_PER_VL_MAX,
+        .dot_enable                          = CFG_DEFAULT_DOT_ENABLE,
+        .dot_listener_port                   = CFG_DEFAULT_DOT_LISTENER_PORT,
+        .dot_cert_file                       = NULL,
+        .dot_key_file                        = NULL,
+        .dot_handshake_threads               = CFG_DEFAULT_DOT_HANDSHAKE_THREADS,
+        .dot_handshake_timeout               = CFG_DEFAULT_DOT_HANDSHAKE_TIMEOUT,
+        .dnssec_key_file                     = NULL,
+        .dnssec_signer_name                  = NULL,
+        .worker_threads               = CFG_DEFAULT_WORKER_THREADS,
+        .dnssec_sig_cache_size               = CFG_DEFAULT_DNSSEC_SIG_CACHE_SIZE,
+        .dnssec_sig_validity                 = CFG_DEFAULT_DNSSEC_SIG_VALIDITY,
+        .dnssec_nsec3_cache_size             = CFG_DEFAULT_DNSSEC_NSEC3_CACHE_SIZE,
     
         .epoll_num_events_tcp                = CFG_DEFAULT_EPOLL_NUM_EVENTS_TCP,
         .epoll_num_events_udp                = CFG_DEFAULT_EPOLL_NUM_EVENTS_UDP,
+        .loop_budget_udp_datagrams           = CFG_DEFAULT_LOOP_BUDGET_UDP_DATAGRAMS,
+        .loop_budget_tcp_reads               = CFG_DEFAULT_LOOP_BUDGET_TCP_READS,
+        .loop_budget_tcp_accepts             = CFG_DEFAULT_LOOP_BUDGET_TCP_ACCEPTS,
+        .loop_budget_xfr_bytes               = CFG_DEFAULT_LOOP_BUDGET_XFR_BYTES,
+        .io_uring_enable                     = CFG_DEFAULT_IO_URING_ENABLE,
         .process_thread_count                = CFG_DEFAULT_VL_THREAD_COUNT,
+        .process_thread_cpu_steering         = CFG_DEFAULT_VL_THREAD_CPU_STEERING,
+        .process_thread_client_steering      = CFG_DEFAULT_VL_THREAD_CLIENT_STEERING,
+        .process_thread_auto_pin             = CFG_DEFAULT_VL_THREAD_AUTO_PIN,
+        .process_thread_auto_pin_interface   = NULL,
+        .process_housekeeping_cpus           = NULL,
+        .process_thread_sched_policy         = CFG_DEFAULT_VL_THREAD_SCHED_POLICY,
+        .process_thread_sched_priority       = CFG_DEFAULT_VL_THREAD_SCHED_PRIORITY,
+        .process_thread_rt_run_max           = CFG_DEFAULT_VL_THREAD_RT_RUN_MAX,
+        .process_mlockall                    = CFG_DEFAULT_PROCESS_MLOCKALL,
+        .process_workers                     = CFG_DEFAULT_PROCESS_WORKERS,
     
-        .loop_slowdown_one                   = CFG_DEFAULT_VL_SLOWDOWN_ONE,
-        .loop_slowdown_two                   = CFG_DEFAULT_VL_SLOWDOWN_TWO,
-        .loop_slowdown_three                 = CFG_DEFAULT_VL_SLOWDOWN_THREE,
+        .loop_idle_spin                      = CFG_DEFAULT_VL_IDLE_SPIN,
+        .loop_idle_wait_max                  = CFG_DEFAULT_VL_IDLE_WAIT_MAX,
+        .loop_calibrate                      = CFG_DEFAULT_VL_CALIBRATE,
+        .loop_calibrate_latency              = CFG_DEFAULT_VL_CALIBRATE_LATENCY,
+        .loop_hugepages                      = CFG_DEFAULT_VL_HUGEPAGES,
+        .loop_hugetlb                        = CFG_DEFAULT_VL_HUGETLB,
+        .loop_prefault                       = CFG_DEFAULT_VL_PREFAULT,
+        .loop_mlock                          = CFG_DEFAULT_VL_MLOCK,
+        .loop_stage_metrics                  = CFG_DEFAULT_VL_STAGE_METRICS,
+        .memory_budget                       = CFG_DEFAULT_MEMORY_BUDGET,
     
         .resource_1_name                     = strdup(CFG_DEFAULT_RESOURCE_1_NAME),
         .resource_1_filepath                 = strdup(CFG_DEFAULT_RESOURCE_1_FILEPATH),
         .resource_1_update_freq              = CFG_DEFAULT_RESOURCE_1_UPDATE_FREQ,
+        .resource_1_delta_filepath           = strdup(CFG_DEFAULT_RESOURCE_1_DELTA_FILEPATH),
+        .zone_image_compile_filepath         = strdup(CFG_DEFAULT_ZONE_IMAGE_COMPILE_FILEPATH),
+        .zone_prefault                       = CFG_DEFAULT_ZONE_PREFAULT,
+        .zone_mlock                          = CFG_DEFAULT_ZONE_MLOCK,
+        .zone_compile_threads                = CFG_DEFAULT_ZONE_COMPILE_THREADS,
+        .zone_secondary                      = strdup(CFG_DEFAULT_ZONE_SECONDARY),
+        .zone_primary_port                   = CFG_DEFAULT_ZONE_PRIMARY_PORT,
+        .resource_2_name                     = strdup(CFG_DEFAULT_RESOURCE_2_NAME),
+        .resource_2_filepath                 = strdup(CFG_DEFAULT_RESOURCE_2_FILEPATH),
+        .resource_2_update_freq              = CFG_DEFAULT_RESOURCE_2_UPDATE_FREQ,
+        .resource_3_name                     = strdup(CFG_DEFAULT_RESOURCE_3_NAME),
+        .resource_3_filepath                 = strdup(CFG_DEFAULT_RESOURCE_3_FILEPATH),
+        .resource_3_update_freq              = CFG_DEFAULT_RESOURCE_3_UPDATE_FREQ,
+        .resource_4_name                     = strdup(CFG_DEFAULT_RESOURCE_4_NAME),
+        .resource_4_filepath                 = strdup(CFG_DEFAULT_RESOURCE_4_FILEPATH),
+        .resource_4_update_freq              = CFG_DEFAULT_RESOURCE_4_UPDATE_FREQ,
+        .resource_5_name                     = strdup(CFG_DEFAULT_RESOURCE_5_NAME),
+        .resource_5_filepath                 = strdup(CFG_DEFAULT_RESOURCE_5_FILEPATH),
+        .resource_5_update_freq              = CFG_DEFAULT_RESOURCE_5_UPDATE_FREQ,
+        .resource_6_name                     = strdup(CFG_DEFAULT_RESOURCE_6_NAME),
+        .resource_6_filepath                 = strdup(CFG_DEFAULT_RESOURCE_6_FILEPATH),
+        .resource_6_update_freq              = CFG_DEFAULT_RESOURCE_6_UPDATE_FREQ,
+        .resource_7_name                     = strdup(CFG_DEFAULT_RESOURCE_7_NAME),
+        .resource_7_filepath                 = strdup(CFG_DEFAULT_RESOURCE_7_FILEPATH),
+        .resource_7_update_freq              = CFG_DEFAULT_RESOURCE_7_UPDATE_FREQ,
+        .resource_8_name                     = strdup(CFG_DEFAULT_RESOURCE_8_NAME),
+        .resource_8_filepath                 = strdup(CFG_DEFAULT_RESOURCE_8_FILEPATH),
+        .resource_8_update_freq              = CFG_DEFAULT_RESOURCE_8_UPDATE_FREQ,
+        .resource_9_name                     = strdup(CFG_DEFAULT_RESOURCE_9_NAME),
+        .resource_9_filepath                 = strdup(CFG_DEFAULT_RESOURCE_9_FILEPATH),
+        .resource_9_update_freq              = CFG_DEFAULT_RESOURCE_9_UPDATE_FREQ,
+        .lb_check_interval                   = CFG_DEFAULT_LB_CHECK_INTERVAL,
+        .lb_check_timeout                    = CFG_DEFAULT_LB_CHECK_TIMEOUT,
+        .upgrade_socket                      = strdup(CFG_DEFAULT_UPGRADE_SOCKET),
+        .admin_socket                        = strdup(CFG_DEFAULT_ADMIN_SOCKET),
+        .drain_time                          = CFG_DEFAULT_DRAIN_TIME,
 
         .application_log_name                = strdup(CFG_DEFAULT_APP_LOG_NAME),
         .application_log_path                = strdup(CFG_DEFAULT_APP_LOG_FILEPATH),
 
         .query_log_buffer_size               = CFG_DEFAULT_QUERY_LOG_BUF_SIZE,
+        .query_log_buffer_count              = CFG_DEFAULT_QUERY_LOG_BUF_COUNT,
         .query_log_base_name                 = strdup(CFG_DEFAULT_QUERY_LOG_BASE_NAME),
         .query_log_path                      = strdup(CFG_DEFAULT_QUERY_LOG_PATH),
         .query_log_rotate_size               = CFG_DEFAULT_QUERY_LOG_ROTATE_SIZE,
+        .query_log_sample_rate               = CFG_DEFAULT_QUERY_LOG_SAMPLE_RATE,
+        .query_log_rcodes                    = QUERY_LOG_RCODES_ALL,
+        .query_log_qtypes                    = QUERY_LOG_QTYPES_ALL,
+        .query_log_errors_only               = CFG_DEFAULT_QUERY_LOG_ERRORS_ONLY,
+        .query_log_latency_min               = CFG_DEFAULT_QUERY_LOG_LATENCY_MIN,
+        .query_log_direct_io                 = CFG_DEFAULT_QUERY_LOG_DIRECT_IO,
+        .query_log_splice                    = CFG_DEFAULT_QUERY_LOG_SPLICE,
+        .query_log_compress                  = CFG_DEFAULT_QUERY_LOG_COMPRESS,
+        .query_log_remote_ip                 = NULL,
+        .query_log_remote_port               = CFG_DEFAULT_QUERY_LOG_REMOTE_PORT,
+        .query_log_remote_unix               = NULL,
+        .query_log_format                    = CFG_DEFAULT_QUERY_LOG_FORMAT,
+        .query_log_shm_path                  = NULL,
+        .query_log_age_max                   = CFG_DEFAULT_QUERY_LOG_AGE_MAX,
+        .query_log_full_policy               = CFG_DEFAULT_QUERY_LOG_FULL_POLICY,
+        .query_log_spill_size                = CFG_DEFAULT_QUERY_LOG_SPILL_SIZE,
+        .query_log_full_sample_rate          = CFG_DEFAULT_QUERY_LOG_FULL_SAMPLE_RATE,
+        .query_log_index                     = CFG_DEFAULT_QUERY_LOG_INDEX,
+        .query_log_index_records             = CFG_DEFAULT_QUERY_LOG_INDEX_RECORDS,
+
+        .response_cache_size                 = CFG_DEFAULT_RESPONSE_CACHE_SIZE,
+        .response_cache_shared_size          = CFG_DEFAULT_RESPONSE_CACHE_SHARED_SIZE,
+        .response_cache_snapshot_path        = NULL,
+
+        .rrl_responses_per_second            = CFG_DEFAULT_RRL_RESPONSES_PER_SECOND,
+        .rrl_slip                            = CFG_DEFAULT_RRL_SLIP,
+        .rrl_ipv4_prefix_len                 = CFG_DEFAULT_RRL_IPV4_PREFIX_LEN,
+        .rrl_ipv6_prefix_len                 = CFG_DEFAULT_RRL_IPV6_PREFIX_LEN,
+        .rrl_table_size                      = CFG_DEFAULT_RRL_TABLE_SIZE,
+
+        .overload_iteration_max              = CFG_DEFAULT_OVERLOAD_ITERATION_MAX,
+        .overload_slip                       = CFG_DEFAULT_OVERLOAD_SLIP,
+        .slo_latency_p50                     = CFG_DEFAULT_SLO_LATENCY_P50,
+        .slo_latency_p99                     = CFG_DEFAULT_SLO_LATENCY_P99,
+        .slo_latency_p999                    = CFG_DEFAULT_SLO_LATENCY_P999,
+        .slo_window                          = CFG_DEFAULT_SLO_WINDOW,
+
+        .dns_cookies                         = CFG_DEFAULT_DNS_COOKIES,
+
+        .metrics_enable                      = CFG_DEFAULT_METRICS_ENABLE,
+        .metrics_listener_ip                 = strdup(CFG_DEFAULT_METRICS_LISTENER_IP),
+        .metrics_listener_port               = CFG_DEFAULT_METRICS_LISTENER_PORT,
+        .metrics_sketches                    = CFG_DEFAULT_METRICS_SKETCHES,
+        .metrics_zones                       = CFG_DEFAULT_METRICS_ZONES,
+        .metrics_query_cost                  = CFG_DEFAULT_METRICS_QUERY_COST,
 
     };
 
     cfg->process_thread_masks = malloc(sizeof(size_t) * cfg->process_thread_count);
     CHECK_MALLOC(cfg->process_thread_masks);
     cfg->process_thread_masks[0] = 0;
+    cfg->process_thread_roles = malloc(sizeof(uint8_t) * cfg->process_thread_count);
+    CHECK_MALLOC(cfg->process_thread_roles);
+    cfg->process_thread_roles[0] = VL_ROLES_ALL;
 
     cfg->tcp_readbuff_size = cfg->tcp_conn_simultaneous_queries_count * 
                              (2 + RIP_NS_PACKETSZ);
     cfg->tcp_writebuff_size = cfg->tcp_conn_simultaneous_queries_count * 
                              (2 + RIP_NS_PACKETSZ);
+
+    if (getrandom(cfg->dns_cookie_secret, DNS_COOKIE_SECRET_LEN, 0) != DNS_COOKIE_SECRET_LEN) {
+        fprintf(stderr, "Error generating DNS cookie secret: %s\n", strerror(errno));
+        assert(0);
+    }
 }
 
 /** Parse command line options into configuration object.
@@ -381,6 +2046,8 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
     int     c;
     ssize_t tmp_ul                           = 0;
     char    opt_process_thread_masks[0x1400] = {'\0'};
+    char   *opt_process_thread_roles = NULL;
+    char   *opt_listener_profiles_file = NULL;
     int     entry_visited[512]               = {0};
 
     while (1) {
@@ -393,10 +2060,30 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             {"udp_listener_port",                   required_argument, NULL, OPT_UDP_LISTENER_PORT},
             {"udp_socket_recvbuff_size",            required_argument, NULL, OPT_UDP_SOCK_RECV_BUFF_SIZE},
             {"udp_socket_sendbuff_size",            required_argument, NULL, OPT_UDP_SOCK_SEND_BUFF_SIZE},
+            {"udp_socket_busy_poll",                required_argument, NULL, OPT_UDP_SOCK_BUSY_POLL},
+            {"udp_socket_recvbuff_autotune_max",    required_argument, NULL, OPT_UDP_SOCK_RECV_BUFF_AUTOTUNE_MAX},
+            {"udp_mirror_ip",                       required_argument, NULL, OPT_UDP_MIRROR_IP},
+            {"udp_mirror_port",                     required_argument, NULL, OPT_UDP_MIRROR_PORT},
+            {"udp_mirror_sample_rate",              required_argument, NULL, OPT_UDP_MIRROR_SAMPLE_RATE},
+            {"listener_rx_timestamps",              required_argument, NULL, OPT_LISTENER_RX_TIMESTAMPS},
             {"udp_conn_vector_len",                 required_argument, NULL, OPT_UDP_CONN_VECTOR_LEN},
+            {"udp_conn_vector_len_min",             required_argument, NULL, OPT_UDP_CONN_VECTOR_LEN_MIN},
+            {"udp_listener_batches",                required_argument, NULL, OPT_UDP_LISTENER_BATCHES},
+            {"udp_pipeline_batch_len",              required_argument, NULL, OPT_UDP_PIPELINE_BATCH_LEN},
+            {"udp_gso",                             required_argument, NULL, OPT_UDP_GSO},
+            {"udp_dual_stack",                      required_argument, NULL, OPT_UDP_DUAL_STACK},
+            {"udp_listener_addresses",              required_argument, NULL, OPT_UDP_LISTENER_ADDRESSES},
+            {"listener_profiles_file",              required_argument, NULL, OPT_LISTENER_PROFILES_FILE},
+            {"xdp_interface",                       required_argument, NULL, OPT_XDP_INTERFACE},
+            {"xdp_busy_poll",                       required_argument, NULL, OPT_XDP_BUSY_POLL},
+            {"xdp_responder_size",                  required_argument, NULL, OPT_XDP_RESPONDER_SIZE},
+            {"xdp_responder_hits",                  required_argument, NULL, OPT_XDP_RESPONDER_HITS},
             
             {"tcp_enable",                          required_argument, NULL, OPT_TCP_ENABLE},
             {"tcp_listener_pending_conns_max",      required_argument, NULL, OPT_TCP_LIST_PENDING_CONNS_MAX},
+            {"tcp_listener_fastopen",               required_argument, NULL, OPT_TCP_LISTENER_FASTOPEN},
+            {"tcp_listener_defer_accept",           required_argument, NULL, OPT_TCP_LISTENER_DEFER_ACCEPT},
+            {"tcp_listener_notsent_lowat",          required_argument, NULL, OPT_TCP_LISTENER_NOTSENT_LOWAT},
             {"tcp_listener_port",                   required_argument, NULL, OPT_TCP_LISTENER_PORT},
             {"tcp_conns_per_vl_max",                required_argument, NULL, OPT_TCP_CONN_PER_VL_MAX},
             {"tcp_listener_max_accept_new_conn",    required_argument, NULL, OPT_TCP_LIST_MAX_ACCEPT_NEW_CONNS},
@@ -404,26 +2091,143 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             {"tcp_conn_socket_sendbuff_size",       required_argument, NULL, OPT_TCP_CONN_SOCKET_SEND_BUFF_SIZE},
             {"tcp_conn_simultaneous_queries_count", required_argument, NULL, OPT_TCP_CONN_SIMULTANEOUS_QUERY_COUNT},
             {"tcp_keepalive",                       required_argument, NULL, OPT_TCP_KEEPALIVE},
+            {"tcp_keepalive_shrink_start",          required_argument, NULL, OPT_TCP_KEEPALIVE_SHRINK_START},
             {"tcp_query_recv_timeout",              required_argument, NULL, OPT_TCP_QUERY_RECV_TIMEOUT},
             {"tcp_query_send_timeout",              required_argument, NULL, OPT_TCP_QUERY_SEND_TIMEOUT},
+            {"tcp_handoff",                         required_argument, NULL, OPT_TCP_HANDOFF},
+            {"tcp_handoff_threshold",               required_argument, NULL, OPT_TCP_HANDOFF_THRESHOLD},
+            {"tcp_conns_per_client_max",            required_argument, NULL, OPT_TCP_CONNS_PER_CLIENT_MAX},
+            {"tcp_conns_client_ipv4_prefix_len",    required_argument, NULL, OPT_TCP_CONNS_CLIENT_IPV4_PREFIX_LEN},
+            {"tcp_conns_client_ipv6_prefix_len",    required_argument, NULL, OPT_TCP_CONNS_CLIENT_IPV6_PREFIX_LEN},
+            {"tcp_conns_idle_evict",                required_argument, NULL, OPT_TCP_CONNS_IDLE_EVICT},
+            {"dot_enable",                          required_argument, NULL, OPT_DOT_ENABLE},
+            {"dot_listener_port",                   required_argument, NULL, OPT_DOT_LISTENER_PORT},
+            {"dot_cert_file",                       required_argument, NULL, OPT_DOT_CERT_FILE},
+            {"dot_key_file",                        required_argument, NULL, OPT_DOT_KEY_FILE},
+            {"dot_handshake_threads",               required_argument, NULL, OPT_DOT_HANDSHAKE_THREADS},
+            {"dot_handshake_timeout",               required_argument, NULL, OPT_DOT_HANDSHAKE_TIMEOUT},
+            {"dnssec_key_file",                     required_argument, NULL, OPT_DNSSEC_KEY_FILE},
+            {"dnssec_signer_name",                  required_argument, NULL, OPT_DNSSEC_SIGNER_NAME},
+            {"worker_threads",               required_argument, NULL, OPT_WORKER_THREADS},
+            {"dnssec_sig_cache_size",               required_argument, NULL, OPT_DNSSEC_SIG_CACHE_SIZE},
+            {"dnssec_sig_validity",                 required_argument, NULL, OPT_DNSSEC_SIG_VALIDITY},
+            {"dnssec_nsec3_cache_size",             required_argument, NULL, OPT_DNSSEC_NSEC3_CACHE_SIZE},
 
             {"epoll_num_events_tcp",                required_argument, NULL, OPT_EPOLL_NUM_EVENTS_TCP},
             {"epoll_num_events_udp",                required_argument, NULL, OPT_EPOLL_NUM_EVENTS_UDP},
+            {"loop_budget_udp_datagrams",           required_argument, NULL, OPT_LOOP_BUDGET_UDP_DATAGRAMS},
+            {"loop_budget_tcp_reads",               required_argument, NULL, OPT_LOOP_BUDGET_TCP_READS},
+            {"loop_budget_tcp_accepts",             required_argument, NULL, OPT_LOOP_BUDGET_TCP_ACCEPTS},
+            {"loop_budget_xfr_bytes",               required_argument, NULL, OPT_LOOP_BUDGET_XFR_BYTES},
+            {"io_uring_enable",                     required_argument, NULL, OPT_IO_URING_ENABLE},
             {"process_thread_count",                required_argument, NULL, OPT_PROCESS_THREAD_COUNT},
             {"process_thread_masks",                required_argument, NULL, OPT_PROCESS_THREAD_MASKS},
+            {"process_thread_roles",                required_argument, NULL, OPT_PROCESS_THREAD_ROLES},
+            {"process_thread_cpu_steering",         required_argument, NULL, OPT_PROCESS_THREAD_CPU_STEERING},
+            {"process_thread_client_steering",      required_argument, NULL, OPT_PROCESS_THREAD_CLIENT_STEERING},
+            {"process_thread_auto_pin",             required_argument, NULL, OPT_PROCESS_THREAD_AUTO_PIN},
+            {"process_thread_auto_pin_interface",   required_argument, NULL, OPT_PROCESS_THREAD_AUTO_PIN_INTERFACE},
+            {"process_housekeeping_cpus",           required_argument, NULL, OPT_PROCESS_HOUSEKEEPING_CPUS},
+            {"process_thread_sched_policy",         required_argument, NULL, OPT_PROCESS_THREAD_SCHED_POLICY},
+            {"process_thread_sched_priority",       required_argument, NULL, OPT_PROCESS_THREAD_SCHED_PRIORITY},
+            {"process_thread_rt_run_max",           required_argument, NULL, OPT_PROCESS_THREAD_RT_RUN_MAX},
+            {"process_mlockall",                    required_argument, NULL, OPT_PROCESS_MLOCKALL},
+            {"process_workers",                     required_argument, NULL, OPT_PROCESS_WORKERS},
             
-            {"loop_slowdown_one",                   required_argument, NULL, OPT_LOOP_SLOWDOWN_ONE},
-            {"loop_slowdown_two",                   required_argument, NULL, OPT_LOOP_SLOWDOWN_TWO},
-            {"loop_slowdown_three",                 required_argument, NULL, OPT_LOOP_SLOWDOWN_THREE},
+            {"loop_idle_spin",                      required_argument, NULL, OPT_LOOP_IDLE_SPIN},
+            {"loop_idle_wait_max",                  required_argument, NULL, OPT_LOOP_IDLE_WAIT_MAX},
+            {"loop_calibrate",                      required_argument, NULL, OPT_LOOP_CALIBRATE},
+            {"loop_calibrate_latency",              required_argument, NULL, OPT_LOOP_CALIBRATE_LATENCY},
+            {"loop_hugepages",                      required_argument, NULL, OPT_LOOP_HUGEPAGES},
+            {"loop_hugetlb",                        required_argument, NULL, OPT_LOOP_HUGETLB},
+            {"loop_prefault",                       required_argument, NULL, OPT_LOOP_PREFAULT},
+            {"loop_mlock",                          required_argument, NULL, OPT_LOOP_MLOCK},
+            {"loop_stage_metrics",                  required_argument, NULL, OPT_LOOP_STAGE_METRICS},
+            {"memory_budget",                       required_argument, NULL, OPT_MEMORY_BUDGET},
 
 
             {"app_log_name",                        required_argument, NULL, OPT_APP_LOG_NAME},
             {"app_log_path",                        required_argument, NULL, OPT_APP_LOG_PATH},
 
             {"query_log_buffer_size",               required_argument, NULL, OPT_QUERY_LOG_BUFFER_SIZE},
+            {"query_log_buffer_count",              required_argument, NULL, OPT_QUERY_LOG_BUFFER_COUNT},
             {"query_log_base_name",                 required_argument, NULL, OPT_QUERY_LOG_BASE_NAME},
             {"query_log_path",                      required_argument, NULL, OPT_QUERY_LOG_PATH},
             {"query_log_rotate_size",               required_argument, NULL, OPT_QUERY_LOG_ROTATE_SIZE},
+            {"query_log_sample_rate",               required_argument, NULL, OPT_QUERY_LOG_SAMPLE_RATE},
+            {"query_log_rcodes",                    required_argument, NULL, OPT_QUERY_LOG_RCODES},
+            {"query_log_qtypes",                    required_argument, NULL, OPT_QUERY_LOG_QTYPES},
+            {"query_log_errors_only",               required_argument, NULL, OPT_QUERY_LOG_ERRORS_ONLY},
+            {"query_log_latency_min",               required_argument, NULL, OPT_QUERY_LOG_LATENCY_MIN},
+            {"query_log_direct_io",                 required_argument, NULL, OPT_QUERY_LOG_DIRECT_IO},
+            {"query_log_splice",                    required_argument, NULL, OPT_QUERY_LOG_SPLICE},
+            {"query_log_compress",                  required_argument, NULL, OPT_QUERY_LOG_COMPRESS},
+            {"query_log_remote_ip",                 required_argument, NULL, OPT_QUERY_LOG_REMOTE_IP},
+            {"query_log_remote_port",               required_argument, NULL, OPT_QUERY_LOG_REMOTE_PORT},
+            {"query_log_remote_unix",               required_argument, NULL, OPT_QUERY_LOG_REMOTE_UNIX},
+            {"query_log_format",                    required_argument, NULL, OPT_QUERY_LOG_FORMAT},
+            {"query_log_shm_path",                  required_argument, NULL, OPT_QUERY_LOG_SHM_PATH},
+            {"query_log_age_max",                   required_argument, NULL, OPT_QUERY_LOG_AGE_MAX},
+            {"query_log_full_policy",               required_argument, NULL, OPT_QUERY_LOG_FULL_POLICY},
+            {"query_log_spill_size",                required_argument, NULL, OPT_QUERY_LOG_SPILL_SIZE},
+            {"query_log_full_sample_rate",          required_argument, NULL, OPT_QUERY_LOG_FULL_SAMPLE_RATE},
+            {"query_log_index",                     required_argument, NULL, OPT_QUERY_LOG_INDEX},
+            {"query_log_index_records",             required_argument, NULL, OPT_QUERY_LOG_INDEX_RECORDS},
+
+            {"zone_file",                           required_argument, NULL, OPT_ZONE_FILE},
+            {"zone_file_update_freq",               required_argument, NULL, OPT_ZONE_FILE_UPDATE_FREQ},
+            {"zone_delta_file",                     required_argument, NULL, OPT_ZONE_DELTA_FILE},
+            {"zone_image_compile",                  required_argument, NULL, OPT_ZONE_IMAGE_COMPILE},
+            {"zone_prefault",                       required_argument, NULL, OPT_ZONE_PREFAULT},
+            {"zone_mlock",                          required_argument, NULL, OPT_ZONE_MLOCK},
+            {"zone_compile_threads",                required_argument, NULL, OPT_ZONE_COMPILE_THREADS},
+            {"zone_transfer_allow",                 required_argument, NULL, OPT_ZONE_TRANSFER_ALLOW},
+            {"zone_secondary",                      required_argument, NULL, OPT_ZONE_SECONDARY},
+            {"zone_primary",                        required_argument, NULL, OPT_ZONE_PRIMARY},
+            {"zone_primary_port",                   required_argument, NULL, OPT_ZONE_PRIMARY_PORT},
+            {"ecs_map_file",                        required_argument, NULL, OPT_ECS_MAP_FILE},
+            {"ecs_map_file_update_freq",            required_argument, NULL, OPT_ECS_MAP_FILE_UPDATE_FREQ},
+            {"views_file",                          required_argument, NULL, OPT_VIEWS_FILE},
+            {"views_file_update_freq",              required_argument, NULL, OPT_VIEWS_FILE_UPDATE_FREQ},
+            {"zone_catalog_file",                   required_argument, NULL, OPT_ZONE_CATALOG_FILE},
+            {"zone_catalog_file_update_freq",       required_argument, NULL, OPT_ZONE_CATALOG_FILE_UPDATE_FREQ},
+            {"acl_file",                            required_argument, NULL, OPT_ACL_FILE},
+            {"acl_file_update_freq",                required_argument, NULL, OPT_ACL_FILE_UPDATE_FREQ},
+            {"policy_file",                         required_argument, NULL, OPT_POLICY_FILE},
+            {"policy_file_update_freq",             required_argument, NULL, OPT_POLICY_FILE_UPDATE_FREQ},
+            {"geoip_file",                          required_argument, NULL, OPT_GEOIP_FILE},
+            {"geoip_file_update_freq",              required_argument, NULL, OPT_GEOIP_FILE_UPDATE_FREQ},
+            {"lb_file",                             required_argument, NULL, OPT_LB_FILE},
+            {"lb_file_update_freq",                 required_argument, NULL, OPT_LB_FILE_UPDATE_FREQ},
+            {"lb_check_interval",                   required_argument, NULL, OPT_LB_CHECK_INTERVAL},
+            {"lb_check_timeout",                    required_argument, NULL, OPT_LB_CHECK_TIMEOUT},
+            {"config_file",                         required_argument, NULL, OPT_CONFIG_FILE},
+            {"config_file_update_freq",             required_argument, NULL, OPT_CONFIG_FILE_UPDATE_FREQ},
+            {"upgrade_socket",                      required_argument, NULL, OPT_UPGRADE_SOCKET},
+            {"admin_socket",                        required_argument, NULL, OPT_ADMIN_SOCKET},
+            {"drain_time",                          required_argument, NULL, OPT_DRAIN_TIME},
+            {"response_cache_size",                 required_argument, NULL, OPT_RESPONSE_CACHE_SIZE},
+            {"response_cache_shared_size",          required_argument, NULL, OPT_RESPONSE_CACHE_SHARED_SIZE},
+            {"response_cache_snapshot_path",        required_argument, NULL, OPT_RESPONSE_CACHE_SNAPSHOT_PATH},
+            {"rrl_responses_per_second",              required_argument, NULL, OPT_RRL_RESPONSES_PER_SECOND},
+            {"rrl_slip",                              required_argument, NULL, OPT_RRL_SLIP},
+            {"rrl_ipv4_prefix_len",                   required_argument, NULL, OPT_RRL_IPV4_PREFIX_LEN},
+            {"rrl_ipv6_prefix_len",                   required_argument, NULL, OPT_RRL_IPV6_PREFIX_LEN},
+            {"rrl_table_size",                        required_argument, NULL, OPT_RRL_TABLE_SIZE},
+            {"overload_iteration_max",                required_argument, NULL, OPT_OVERLOAD_ITERATION_MAX},
+            {"overload_slip",                         required_argument, NULL, OPT_OVERLOAD_SLIP},
+            {"slo_latency_p50",                       required_argument, NULL, OPT_SLO_LATENCY_P50},
+            {"slo_latency_p99",                       required_argument, NULL, OPT_SLO_LATENCY_P99},
+            {"slo_latency_p999",                      required_argument, NULL, OPT_SLO_LATENCY_P999},
+            {"slo_window",                            required_argument, NULL, OPT_SLO_WINDOW},
+            {"dns_cookies",                           required_argument, NULL, OPT_DNS_COOKIES},
+            {"dns_cookie_secret",                     required_argument, NULL, OPT_DNS_COOKIE_SECRET},
+            {"metrics_enable",                      required_argument, NULL, OPT_METRICS_ENABLE},
+            {"metrics_listener_ip",                 required_argument, NULL, OPT_METRICS_LISTENER_IP},
+            {"metrics_listener_port",               required_argument, NULL, OPT_METRICS_LISTENER_PORT},
+            {"metrics_sketches",                    required_argument, NULL, OPT_METRICS_SKETCHES},
+            {"metrics_zones",                       required_argument, NULL, OPT_METRICS_ZONES},
+            {"metrics_query_cost",                  required_argument, NULL, OPT_METRICS_QUERY_COST},
         
             {0, 0, 0,0} /* last entry MUST be all zeros per getopt_long() API. */
         };
@@ -494,6 +2298,84 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             cfg->udp_socket_sendbuff_size = tmp_ul;
             break;
 
+        case OPT_UDP_SOCK_BUSY_POLL:
+            /* udp_socket_busy_poll */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         UDP_CONN_SO_BUSY_POLL_MIN,
+                         UDP_CONN_SO_BUSY_POLL_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_socket_busy_poll = tmp_ul;
+            break;
+
+        case OPT_UDP_SOCK_RECV_BUFF_AUTOTUNE_MAX:
+            /* udp_socket_recvbuff_autotune_max */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         0,
+                         UDP_CONN_SO_RECVBUFF_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_socket_recvbuff_autotune_max = tmp_ul;
+            break;
+
+        case OPT_UDP_MIRROR_IP:
+            /* udp_mirror_ip */
+            {
+                struct in6_addr addr;
+                if (inet_pton(AF_INET, optarg, &addr) != 1 &&
+                    inet_pton(AF_INET6, optarg, &addr) != 1) {
+                    fprintf(stderr,"Error parsing option \"udp_mirror_ip\","
+                                   "'%s' is not a valid IPv4 or IPv6 address\n",
+                                   optarg);
+                    return -1;
+                }
+            }
+            free(cfg->udp_mirror_ip);
+            cfg->udp_mirror_ip = strdup(optarg);
+            if (cfg->udp_mirror_ip == NULL) {
+                fprintf(stderr,"Error allocating string for option \"udp_mirror_ip\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_UDP_MIRROR_PORT:
+            /* udp_mirror_port */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_UDP_PORT_MIN,
+                         TCP_UDP_PORT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_mirror_port = tmp_ul;
+            break;
+
+        case OPT_UDP_MIRROR_SAMPLE_RATE:
+            /* udp_mirror_sample_rate */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         UDP_MIRROR_SAMPLE_RATE_MIN,
+                         UDP_MIRROR_SAMPLE_RATE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_mirror_sample_rate = tmp_ul;
+            break;
+
+        case OPT_LISTENER_RX_TIMESTAMPS:
+            /* listener_rx_timestamps */
+            if (str_to_bool(&cfg->listener_rx_timestamps, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"listener_rx_timestamps\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
         case OPT_UDP_CONN_VECTOR_LEN:
             /* udp_conn_vector_len */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
@@ -506,6 +2388,133 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             cfg->udp_conn_vector_len = tmp_ul;
             break;
 
+        case OPT_UDP_CONN_VECTOR_LEN_MIN:
+            /* udp_conn_vector_len_min */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         UDP_CONN_VECTOR_LEN_MIN_MIN,
+                         UDP_CONN_VECTOR_LEN_MIN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_conn_vector_len_min = tmp_ul;
+            break;
+
+        case OPT_UDP_LISTENER_BATCHES:
+            /* udp_listener_batches */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         UDP_LISTENER_BATCHES_MIN,
+                         UDP_LISTENER_BATCHES_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_listener_batches = tmp_ul;
+            break;
+
+        case OPT_UDP_PIPELINE_BATCH_LEN:
+            /* udp_pipeline_batch_len */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         UDP_PIPELINE_BATCH_LEN_MIN,
+                         UDP_PIPELINE_BATCH_LEN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->udp_pipeline_batch_len = tmp_ul;
+            break;
+
+        case OPT_UDP_GSO:
+            /* udp_gso */
+            if (str_to_bool(&cfg->udp_gso, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"udp_gso\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_UDP_DUAL_STACK:
+            /* udp_dual_stack */
+            if (str_to_bool(&cfg->udp_dual_stack, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"udp_dual_stack\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_UDP_LISTENER_ADDRESSES:
+            /* udp_listener_addresses */
+            if (config_parse_udp_listener_addresses(optarg, &cfg->udp_listener_addresses,
+                                                    &cfg->udp_listener_addresses_count) != 0) {
+                return -1;
+            }
+            break;
+
+        case OPT_LISTENER_PROFILES_FILE:
+            /* listener_profiles_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"listener_profiles_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            opt_listener_profiles_file = optarg;
+            break;
+
+        case OPT_XDP_INTERFACE:
+            /* xdp_interface */
+            if (strlen(optarg) == 0 || strlen(optarg) >= IFNAMSIZ) {
+                fprintf(stderr,"Error parsing option \"xdp_interface\","
+                               "'%s' is not a valid network interface name\n",
+                               optarg);
+                return -1;
+            }
+            free(cfg->xdp_interface);
+            cfg->xdp_interface = strdup(optarg);
+            if (cfg->xdp_interface == NULL) {
+                fprintf(stderr,"Error allocating string for option \"xdp_interface\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_XDP_BUSY_POLL:
+            /* xdp_busy_poll */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         XDP_BUSY_POLL_MIN,
+                         XDP_BUSY_POLL_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->xdp_busy_poll = tmp_ul;
+            break;
+
+        case OPT_XDP_RESPONDER_SIZE:
+            /* xdp_responder_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         XDP_RESPONDER_SIZE_MIN,
+                         XDP_RESPONDER_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->xdp_responder_size = tmp_ul;
+            break;
+
+        case OPT_XDP_RESPONDER_HITS:
+            /* xdp_responder_hits */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         XDP_RESPONDER_HITS_MIN,
+                         XDP_RESPONDER_HITS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->xdp_responder_hits = tmp_ul;
+            break;
+
         case OPT_TCP_ENABLE:
             /* tcp_enable */
             if (str_to_bool(&cfg->tcp_enable, optarg) != 0) {
@@ -528,6 +2537,42 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             cfg->tcp_listener_pending_conns_max = tmp_ul;
             break;
 
+        case OPT_TCP_LISTENER_FASTOPEN:
+            /* tcp_listener_fastopen */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_LISTENER_FASTOPEN_MIN,
+                         TCP_LISTENER_FASTOPEN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->tcp_listener_fastopen = tmp_ul;
+            break;
+
+        case OPT_TCP_LISTENER_DEFER_ACCEPT:
+            /* tcp_listener_defer_accept */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_LISTENER_DEFER_ACCEPT_MIN,
+                         TCP_LISTENER_DEFER_ACCEPT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->tcp_listener_defer_accept = tmp_ul;
+            break;
+
+        case OPT_TCP_LISTENER_NOTSENT_LOWAT:
+            /* tcp_listener_notsent_lowat */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_LISTENER_NOTSENT_LOWAT_MIN,
+                         TCP_LISTENER_NOTSENT_LOWAT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->tcp_listener_notsent_lowat = tmp_ul;
+            break;
+
         case OPT_TCP_LISTENER_PORT:
             /* tcp_listener_port */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
@@ -561,7 +2606,7 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->tcp_listener_max_accept_new_conn = tmp_ul;
+            cfg->tcp_conns_per_vl_max = tmp_ul;
             break;
 
         case OPT_TCP_CONN_SOCKET_RECV_BUFF_SIZE:
@@ -573,7 +2618,7 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->tcp_conns_per_vl_max = tmp_ul;
+            cfg->tcp_conn_socket_recvbuff_size = tmp_ul;
             break;
 
         case OPT_TCP_CONN_SOCKET_SEND_BUFF_SIZE:
@@ -612,6 +2657,18 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             cfg->tcp_keepalive = tmp_ul;
             break;
 
+        case OPT_TCP_KEEPALIVE_SHRINK_START:
+            /* tcp_keepalive_shrink_start */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         TCP_KEEPALIVE_SHRINK_START_MIN,
+                         TCP_KEEPALIVE_SHRINK_START_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->tcp_keepalive_shrink_start = tmp_ul;
+            break;
+
         case OPT_TCP_QUERY_RECV_TIMEOUT:
             /* tcp_query_recv_timeout */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
@@ -636,187 +2693,1592 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
             cfg->tcp_query_send_timeout = tmp_ul;
             break;
 
-        case OPT_EPOLL_NUM_EVENTS_TCP:
-            /* epoll_num_events_tcp */
-            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
-                         optarg, 
-                         EPOLL_NUM_EVENTS_MIN,
-                         EPOLL_NUM_EVENTS_MAX);
-            if (tmp_ul < 0) {
+        case OPT_TCP_HANDOFF:
+            /* tcp_handoff */
+            if (str_to_bool(&cfg->tcp_handoff, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"tcp_handoff\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
                 return -1;
             }
-            cfg->epoll_num_events_tcp = tmp_ul;
             break;
 
-                case OPT_EPOLL_NUM_EVENTS_UDP:
-            /* epoll_num_events_udp */
+        case OPT_TCP_HANDOFF_THRESHOLD:
+            /* tcp_handoff_threshold */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
-                         optarg, 
-                         EPOLL_NUM_EVENTS_MIN,
-                         EPOLL_NUM_EVENTS_MAX);
+                         optarg,
+                         TCP_HANDOFF_THRESHOLD_MIN,
+                         TCP_HANDOFF_THRESHOLD_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->epoll_num_events_udp = tmp_ul;
+            cfg->tcp_handoff_threshold = tmp_ul;
             break;
-        
-        case OPT_PROCESS_THREAD_COUNT:
-            /* process_thread_count */
+
+        case OPT_TCP_CONNS_PER_CLIENT_MAX:
+            /* tcp_conns_per_client_max */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
-                         optarg, 
-                         PROCESS_THREAD_COUNT_MIN,
-                         PROCESS_THREAD_COUNT_MAX);
+                         optarg,
+                         TCP_CONNS_PER_CLIENT_MAX_MIN,
+                         TCP_CONNS_PER_CLIENT_MAX_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-
-            /* reallocate cfg->process_thread_masks if it increased. */
-            if (cfg->process_thread_count > tmp_ul) {
-                cfg->process_thread_masks = realloc(cfg->process_thread_masks,
-                                                    sizeof(size_t) * tmp_ul);
-                CHECK_MALLOC(cfg->process_thread_masks);
-                for (size_t i=cfg->process_thread_count; i < tmp_ul; i++) {
-                    cfg->process_thread_masks[i] = 0;
-                }
-            }
-            cfg->process_thread_count = tmp_ul;
-            break;
-
-        case OPT_PROCESS_THREAD_MASKS:
-            /* process_thread_masks
-             * Processing this option depends on having option "process_thread_count"
-             * being set. We store the option string and process it last once
-             * all the other options are parsed.
-             */
-            memcpy(&opt_process_thread_masks, optarg, 0x13FF);
+            cfg->tcp_conns_per_client_max = tmp_ul;
             break;
 
-
-
-        case OPT_LOOP_SLOWDOWN_ONE:
-            /* loop_slowdown_one */
+        case OPT_TCP_CONNS_CLIENT_IPV4_PREFIX_LEN:
+            /* tcp_conns_client_ipv4_prefix_len */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
-                         optarg, 
-                         VL_SLOWDOWN_MIN,
-                         VL_SLOWDOWN_MAX);
+                         optarg,
+                         TCP_CONNS_CLIENT_IPV4_PREFIX_LEN_MIN,
+                         TCP_CONNS_CLIENT_IPV4_PREFIX_LEN_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->loop_slowdown_one = tmp_ul;
+            cfg->tcp_conns_client_ipv4_prefix_len = tmp_ul;
             break;
 
-        case OPT_LOOP_SLOWDOWN_TWO:
-            /* loop_slowdown_two */
+        case OPT_TCP_CONNS_CLIENT_IPV6_PREFIX_LEN:
+            /* tcp_conns_client_ipv6_prefix_len */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
-                         optarg, 
-                         VL_SLOWDOWN_MIN,
-                         VL_SLOWDOWN_MAX);
+                         optarg,
+                         TCP_CONNS_CLIENT_IPV6_PREFIX_LEN_MIN,
+                         TCP_CONNS_CLIENT_IPV6_PREFIX_LEN_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->loop_slowdown_two = tmp_ul;
+            cfg->tcp_conns_client_ipv6_prefix_len = tmp_ul;
+            break;
+
+        case OPT_TCP_CONNS_IDLE_EVICT:
+            /* tcp_conns_idle_evict */
+            if (str_to_bool(&cfg->tcp_conns_idle_evict, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"tcp_conns_idle_evict\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_DOT_ENABLE:
+            /* dot_enable */
+            if (str_to_bool(&cfg->dot_enable, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"dot_enable\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
             break;
 
-        case OPT_LOOP_SLOWDOWN_THREE:
-            /* loop_slowdown_three */
+        case OPT_DOT_LISTENER_PORT:
+            /* dot_listener_port */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
                          optarg, 
-                         VL_SLOWDOWN_MIN,
-                         VL_SLOWDOWN_MAX);
+                         TCP_UDP_PORT_MIN,
+                         TCP_UDP_PORT_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->loop_slowdown_three = tmp_ul;
+            cfg->dot_listener_port = tmp_ul;
             break;
 
-        case OPT_APP_LOG_NAME:
-            /* app_log_name */
-            if (strlen(optarg) > FILE_REALPATH_MAX) {
-                fprintf(stderr,"Error parsing option \"app_log_name\","
-                               "'%s' length is greater than %d\n",
+        case OPT_DOT_CERT_FILE:
+            /* dot_cert_file */
+            if (strlen(optarg) == 0 || strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"dot_cert_file\","
+                               "'%s' length is 0 or greater than %d\n",
                                optarg, FILE_REALPATH_MAX);
                 return -1;
             }
-            cfg->application_log_name = strdup(optarg);
-            if (cfg->application_log_name == NULL) {
-                fprintf(stderr,"Error allocating string for option \"app_log_name\"\n");
+            free(cfg->dot_cert_file);
+            cfg->dot_cert_file = strdup(optarg);
+            if (cfg->dot_cert_file == NULL) {
+                fprintf(stderr,"Error allocating string for option \"dot_cert_file\"\n");
                 return -1;
             }
             break;
 
-        case OPT_APP_LOG_PATH:
-            /* app_log_path */
-            if (strlen(optarg) > FILE_REALPATH_MAX) {
-                fprintf(stderr,"Error parsing option \"app_log_path\","
-                               "'%s' length is greater than %d\n",
+        case OPT_DOT_KEY_FILE:
+            /* dot_key_file */
+            if (strlen(optarg) == 0 || strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"dot_key_file\","
+                               "'%s' length is 0 or greater than %d\n",
                                optarg, FILE_REALPATH_MAX);
                 return -1;
             }
-            cfg->application_log_path = strdup(optarg);
-            if (cfg->application_log_path == NULL) {
-                fprintf(stderr,"Error allocating string for option \"app_log_path\"\n");
+            free(cfg->dot_key_file);
+            cfg->dot_key_file = strdup(optarg);
+            if (cfg->dot_key_file == NULL) {
+                fprintf(stderr,"Error allocating string for option \"dot_key_file\"\n");
                 return -1;
             }
             break;
 
-        case OPT_QUERY_LOG_BUFFER_SIZE:
-            /* query_log_buffer_size */
+        case OPT_DOT_HANDSHAKE_THREADS:
+            /* dot_handshake_threads */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
                          optarg, 
-                         1,
-                         UINTMAX_MAX);
+                         DOT_HANDSHAKE_THREADS_MIN,
+                         DOT_HANDSHAKE_THREADS_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->query_log_buffer_size = tmp_ul;
+            cfg->dot_handshake_threads = tmp_ul;
             break;
 
-        case OPT_QUERY_LOG_BASE_NAME:
-            /* query_log_base_name */
-            if (strlen(optarg) > FILE_REALPATH_MAX) {
-                fprintf(stderr,"Error parsing option \"query_log_base_name\","
-                               "'%s' length is greater than %d\n",
+        case OPT_DOT_HANDSHAKE_TIMEOUT:
+            /* dot_handshake_timeout */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         DOT_HANDSHAKE_TIMEOUT_MIN,
+                         DOT_HANDSHAKE_TIMEOUT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->dot_handshake_timeout = tmp_ul;
+            break;
+
+        case OPT_DNSSEC_KEY_FILE:
+            /* dnssec_key_file */
+            if (strlen(optarg) == 0 || strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"dnssec_key_file\","
+                               "'%s' length is 0 or greater than %d\n",
                                optarg, FILE_REALPATH_MAX);
                 return -1;
             }
-            cfg->query_log_base_name = strdup(optarg);
-            if (cfg->query_log_base_name == NULL) {
-                fprintf(stderr,"Error allocating string for option \"query_log_base_name\"\n");
+            free(cfg->dnssec_key_file);
+            cfg->dnssec_key_file = strdup(optarg);
+            if (cfg->dnssec_key_file == NULL) {
+                fprintf(stderr,"Error allocating string for option \"dnssec_key_file\"\n");
                 return -1;
             }
             break;
 
-        case OPT_QUERY_LOG_PATH:
-            /* query_log_path */
-            if (strlen(optarg) > FILE_REALPATH_MAX) {
-                fprintf(stderr,"Error parsing option \"query_log_path\","
-                               "'%s' length is greater than %d\n",
-                               optarg, FILE_REALPATH_MAX);
+        case OPT_DNSSEC_SIGNER_NAME:
+            /* dnssec_signer_name */
+            if (strlen(optarg) == 0 || strlen(optarg) > RIP_NS_MAXCDNAME * 4) {
+                fprintf(stderr,"Error parsing option \"dnssec_signer_name\","
+                               "'%s' length is 0 or greater than %d\n",
+                               optarg, RIP_NS_MAXCDNAME * 4);
                 return -1;
             }
-            cfg->query_log_path = strdup(optarg);
-            if (cfg->query_log_path == NULL) {
-                fprintf(stderr,"Error allocating string for option \"query_log_path\"\n");
+            free(cfg->dnssec_signer_name);
+            cfg->dnssec_signer_name = strdup(optarg);
+            if (cfg->dnssec_signer_name == NULL) {
+                fprintf(stderr,"Error allocating string for option \"dnssec_signer_name\"\n");
                 return -1;
             }
             break;
 
-        case OPT_QUERY_LOG_ROTATE_SIZE:
-            /* query_log_rotate_size */
+        case OPT_WORKER_THREADS:
+            /* worker_threads */
             tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
                          optarg, 
-                         1,
-                         UINTMAX_MAX);
+                         WORKER_THREADS_MIN,
+                         WORKER_THREADS_MAX);
             if (tmp_ul < 0) {
                 return -1;
             }
-            cfg->query_log_rotate_size = tmp_ul;
+            cfg->worker_threads = tmp_ul;
             break;
-        
-        default:
-            printf("Unrecognized option: %s\n", argv[optind++]);
-            return -1;
-        }
+
+        case OPT_DNSSEC_SIG_CACHE_SIZE:
+            /* dnssec_sig_cache_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         DNSSEC_SIG_CACHE_SIZE_MIN,
+                         DNSSEC_SIG_CACHE_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->dnssec_sig_cache_size = tmp_ul;
+            break;
+
+        case OPT_DNSSEC_NSEC3_CACHE_SIZE:
+            /* dnssec_nsec3_cache_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         DNSSEC_NSEC3_CACHE_SIZE_MIN,
+                         DNSSEC_NSEC3_CACHE_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->dnssec_nsec3_cache_size = tmp_ul;
+            break;
+
+        case OPT_DNSSEC_SIG_VALIDITY:
+            /* dnssec_sig_validity */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         DNSSEC_SIG_VALIDITY_MIN,
+                         DNSSEC_SIG_VALIDITY_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->dnssec_sig_validity = tmp_ul;
+            break;
+
+        case OPT_EPOLL_NUM_EVENTS_TCP:
+            /* epoll_num_events_tcp */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         EPOLL_NUM_EVENTS_MIN,
+                         EPOLL_NUM_EVENTS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->epoll_num_events_tcp = tmp_ul;
+            break;
+
+                case OPT_EPOLL_NUM_EVENTS_UDP:
+            /* epoll_num_events_udp */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         EPOLL_NUM_EVENTS_MIN,
+                         EPOLL_NUM_EVENTS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->epoll_num_events_udp = tmp_ul;
+            break;
+
+        case OPT_LOOP_BUDGET_UDP_DATAGRAMS:
+            /* loop_budget_udp_datagrams */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LOOP_BUDGET_MIN,
+                         LOOP_BUDGET_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_budget_udp_datagrams = tmp_ul;
+            break;
+
+        case OPT_LOOP_BUDGET_TCP_READS:
+            /* loop_budget_tcp_reads */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LOOP_BUDGET_MIN,
+                         LOOP_BUDGET_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_budget_tcp_reads = tmp_ul;
+            break;
+
+        case OPT_LOOP_BUDGET_TCP_ACCEPTS:
+            /* loop_budget_tcp_accepts */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LOOP_BUDGET_MIN,
+                         LOOP_BUDGET_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_budget_tcp_accepts = tmp_ul;
+            break;
+
+        case OPT_LOOP_BUDGET_XFR_BYTES:
+            /* loop_budget_xfr_bytes */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LOOP_BUDGET_XFR_BYTES_MIN,
+                         LOOP_BUDGET_XFR_BYTES_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_budget_xfr_bytes = tmp_ul;
+            break;
+
+        case OPT_IO_URING_ENABLE:
+            /* io_uring_enable */
+            if (str_to_bool(&cfg->io_uring_enable, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"io_uring_enable\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+        
+        case OPT_PROCESS_THREAD_COUNT:
+            /* process_thread_count */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         PROCESS_THREAD_COUNT_MIN,
+                         PROCESS_THREAD_COUNT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+
+            /* reallocate cfg->process_thread_masks and roles if it increased. */
+            if (cfg->process_thread_count < tmp_ul) {
+                cfg->process_thread_masks = realloc(cfg->process_thread_masks,
+                                                    sizeof(size_t) * tmp_ul);
+                CHECK_MALLOC(cfg->process_thread_masks);
+                cfg->process_thread_roles = realloc(cfg->process_thread_roles,
+                                                    sizeof(uint8_t) * tmp_ul);
+                CHECK_MALLOC(cfg->process_thread_roles);
+                for (size_t i=cfg->process_thread_count; i < tmp_ul; i++) {
+                    cfg->process_thread_masks[i] = 0;
+                    cfg->process_thread_roles[i] = VL_ROLES_ALL;
+                }
+            }
+            cfg->process_thread_count = tmp_ul;
+            break;
+
+        case OPT_PROCESS_THREAD_MASKS:
+            /* process_thread_masks
+             * Processing this option depends on having option "process_thread_count"
+             * being set. We store the option string and process it last once
+             * all the other options are parsed.
+             */
+            strncpy(opt_process_thread_masks, optarg, sizeof(opt_process_thread_masks) - 1);
+            break;
+
+        case OPT_PROCESS_THREAD_ROLES:
+            /* process_thread_roles
+             * As with "process_thread_masks" option string is processed last.
+             */
+            free(opt_process_thread_roles);
+            opt_process_thread_roles = strdup(optarg);
+            CHECK_MALLOC(opt_process_thread_roles);
+            break;
+
+        case OPT_PROCESS_THREAD_CPU_STEERING:
+            /* process_thread_cpu_steering */
+            if (str_to_bool(&cfg->process_thread_cpu_steering, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"process_thread_cpu_steering\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_PROCESS_THREAD_CLIENT_STEERING:
+            /* process_thread_client_steering */
+            if (str_to_bool(&cfg->process_thread_client_steering, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"process_thread_client_steering\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_PROCESS_THREAD_AUTO_PIN:
+            /* process_thread_auto_pin */
+            if (str_to_bool(&cfg->process_thread_auto_pin, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"process_thread_auto_pin\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_PROCESS_THREAD_AUTO_PIN_INTERFACE:
+            /* process_thread_auto_pin_interface */
+            if (strlen(optarg) == 0 || strlen(optarg) >= IFNAMSIZ ||
+                strchr(optarg, '/') != NULL) {
+                fprintf(stderr,"Error parsing option \"process_thread_auto_pin_interface\","
+                               "'%s' is not a valid network interface name\n",
+                               optarg);
+                return -1;
+            }
+            free(cfg->process_thread_auto_pin_interface);
+            cfg->process_thread_auto_pin_interface = strdup(optarg);
+            CHECK_MALLOC(cfg->process_thread_auto_pin_interface);
+            break;
+
+        case OPT_PROCESS_HOUSEKEEPING_CPUS:
+            /* process_housekeeping_cpus */
+            if (config_check_cpu_list(long_options[option_index].name, optarg) != 0) {
+                return -1;
+            }
+            free(cfg->process_housekeeping_cpus);
+            cfg->process_housekeeping_cpus = strdup(optarg);
+            CHECK_MALLOC(cfg->process_housekeeping_cpus);
+            break;
+
+        case OPT_PROCESS_THREAD_SCHED_POLICY:
+            /* process_thread_sched_policy */
+            if (strcasecmp(optarg, "other") == 0) {
+                cfg->process_thread_sched_policy = SCHED_OTHER;
+            } else if (strcasecmp(optarg, "fifo") == 0) {
+                cfg->process_thread_sched_policy = SCHED_FIFO;
+            } else if (strcasecmp(optarg, "rr") == 0) {
+                cfg->process_thread_sched_policy = SCHED_RR;
+            } else {
+                fprintf(stderr,"Error parsing option \"process_thread_sched_policy\","
+                               "'%s' is not a recognized argument (other|fifo|rr)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_PROCESS_THREAD_SCHED_PRIORITY:
+            /* process_thread_sched_priority */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         VL_THREAD_SCHED_PRIORITY_MIN,
+                         VL_THREAD_SCHED_PRIORITY_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->process_thread_sched_priority = tmp_ul;
+            break;
+
+        case OPT_PROCESS_THREAD_RT_RUN_MAX:
+            /* process_thread_rt_run_max */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         VL_THREAD_RT_RUN_MAX_MIN,
+                         VL_THREAD_RT_RUN_MAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->process_thread_rt_run_max = tmp_ul;
+            break;
+
+        case OPT_PROCESS_MLOCKALL:
+            /* process_mlockall */
+            if (str_to_bool(&cfg->process_mlockall, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"process_mlockall\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_PROCESS_WORKERS:
+            /* process_workers */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         PROCESS_WORKERS_MIN,
+                         PROCESS_WORKERS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->process_workers = tmp_ul;
+            break;
+
+
+
+        case OPT_LOOP_IDLE_SPIN:
+            /* loop_idle_spin */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         VL_IDLE_SPIN_MIN,
+                         VL_IDLE_SPIN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_idle_spin = tmp_ul;
+            break;
+
+        case OPT_LOOP_IDLE_WAIT_MAX:
+            /* loop_idle_wait_max */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         VL_IDLE_WAIT_MAX_MIN,
+                         VL_IDLE_WAIT_MAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_idle_wait_max = tmp_ul;
+            break;
+
+        case OPT_LOOP_CALIBRATE:
+            /* loop_calibrate */
+            if (str_to_bool(&cfg->loop_calibrate, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_calibrate\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_LOOP_CALIBRATE_LATENCY:
+            /* loop_calibrate_latency */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         VL_CALIBRATE_LATENCY_MIN,
+                         VL_CALIBRATE_LATENCY_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->loop_calibrate_latency = tmp_ul;
+            break;
+
+        case OPT_LOOP_HUGEPAGES:
+            /* loop_hugepages */
+            if (str_to_bool(&cfg->loop_hugepages, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_hugepages\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_LOOP_HUGETLB:
+            /* loop_hugetlb */
+            if (str_to_bool(&cfg->loop_hugetlb, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_hugetlb\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_LOOP_PREFAULT:
+            /* loop_prefault */
+            if (str_to_bool(&cfg->loop_prefault, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_prefault\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_LOOP_MLOCK:
+            /* loop_mlock */
+            if (str_to_bool(&cfg->loop_mlock, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_mlock\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_LOOP_STAGE_METRICS:
+            /* loop_stage_metrics */
+            if (str_to_bool(&cfg->loop_stage_metrics, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"loop_stage_metrics\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_MEMORY_BUDGET:
+            /* memory_budget */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         MEMORY_BUDGET_MIN,
+                         MEMORY_BUDGET_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->memory_budget = tmp_ul;
+            break;
+
+        case OPT_APP_LOG_NAME:
+            /* app_log_name */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"app_log_name\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            cfg->application_log_name = strdup(optarg);
+            if (cfg->application_log_name == NULL) {
+                fprintf(stderr,"Error allocating string for option \"app_log_name\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_APP_LOG_PATH:
+            /* app_log_path */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"app_log_path\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            cfg->application_log_path = strdup(optarg);
+            if (cfg->application_log_path == NULL) {
+                fprintf(stderr,"Error allocating string for option \"app_log_path\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_BUFFER_SIZE:
+            /* query_log_buffer_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         1,
+                         UINTMAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_buffer_size = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_BUFFER_COUNT:
+            /* query_log_buffer_count */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         QUERY_LOG_BUF_COUNT_MIN,
+                         QUERY_LOG_BUF_COUNT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_buffer_count = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_BASE_NAME:
+            /* query_log_base_name */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"query_log_base_name\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            cfg->query_log_base_name = strdup(optarg);
+            if (cfg->query_log_base_name == NULL) {
+                fprintf(stderr,"Error allocating string for option \"query_log_base_name\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_PATH:
+            /* query_log_path */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"query_log_path\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            cfg->query_log_path = strdup(optarg);
+            if (cfg->query_log_path == NULL) {
+                fprintf(stderr,"Error allocating string for option \"query_log_path\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_ROTATE_SIZE:
+            /* query_log_rotate_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         1,
+                         UINTMAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_rotate_size = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_SAMPLE_RATE:
+            /* query_log_sample_rate */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         QUERY_LOG_SAMPLE_RATE_MIN,
+                         QUERY_LOG_SAMPLE_RATE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_sample_rate = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_RCODES:
+            /* query_log_rcodes */
+            if (config_parse_query_log_rcodes(optarg, &cfg->query_log_rcodes) != 0) {
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_QTYPES:
+            /* query_log_qtypes */
+            if (config_parse_query_log_qtypes(optarg, &cfg->query_log_qtypes) != 0) {
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_ERRORS_ONLY:
+            /* query_log_errors_only */
+            if (str_to_bool(&cfg->query_log_errors_only, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"query_log_errors_only\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_LATENCY_MIN:
+            /* query_log_latency_min */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         QUERY_LOG_LATENCY_MIN_MIN,
+                         QUERY_LOG_LATENCY_MIN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_latency_min = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_DIRECT_IO:
+            /* query_log_direct_io */
+            if (str_to_bool(&cfg->query_log_direct_io, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"query_log_direct_io\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_SPLICE:
+            /* query_log_splice */
+            if (str_to_bool(&cfg->query_log_splice, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"query_log_splice\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_COMPRESS:
+            /* query_log_compress */
+            if (str_to_bool(&cfg->query_log_compress, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"query_log_compress\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_REMOTE_IP:
+            /* query_log_remote_ip */
+            {
+                struct in6_addr addr;
+                if (inet_pton(AF_INET, optarg, &addr) != 1 &&
+                    inet_pton(AF_INET6, optarg, &addr) != 1) {
+                    fprintf(stderr,"Error parsing option \"query_log_remote_ip\","
+                                   "'%s' is not a valid IPv4 or IPv6 address\n",
+                                   optarg);
+                    return -1;
+                }
+            }
+            free(cfg->query_log_remote_ip);
+            cfg->query_log_remote_ip = strdup(optarg);
+            if (cfg->query_log_remote_ip == NULL) {
+                fprintf(stderr,"Error allocating string for option \"query_log_remote_ip\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_REMOTE_PORT:
+            /* query_log_remote_port */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_UDP_PORT_MIN,
+                         TCP_UDP_PORT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_remote_port = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_REMOTE_UNIX:
+            /* query_log_remote_unix */
+            if (strlen(optarg) == 0 ||
+                strlen(optarg) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+                fprintf(stderr,"Error parsing option \"query_log_remote_unix\","
+                               "'%s' is not a valid Unix socket path\n",
+                               optarg);
+                return -1;
+            }
+            free(cfg->query_log_remote_unix);
+            cfg->query_log_remote_unix = strdup(optarg);
+            if (cfg->query_log_remote_unix == NULL) {
+                fprintf(stderr,"Error allocating string for option \"query_log_remote_unix\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_SHM_PATH:
+            /* query_log_shm_path */
+            if (strlen(optarg) == 0 || strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"query_log_shm_path\","
+                               "'%s' is not a valid path\n",
+                               optarg);
+                return -1;
+            }
+            free(cfg->query_log_shm_path);
+            cfg->query_log_shm_path = strdup(optarg);
+            if (cfg->query_log_shm_path == NULL) {
+                fprintf(stderr,"Error allocating string for option \"query_log_shm_path\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_FORMAT:
+            /* query_log_format */
+            if (strcasecmp(optarg, "text") == 0) {
+                cfg->query_log_format = QUERY_LOG_FORMAT_TEXT;
+            } else if (strcasecmp(optarg, "dnstap") == 0) {
+                cfg->query_log_format = QUERY_LOG_FORMAT_DNSTAP;
+            } else if (strcasecmp(optarg, "arrow") == 0) {
+                cfg->query_log_format = QUERY_LOG_FORMAT_ARROW;
+            } else {
+                fprintf(stderr,"Error parsing option \"query_log_format\","
+                               "'%s' is not a recognized argument (text|dnstap|arrow)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_AGE_MAX:
+            /* query_log_age_max */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         QUERY_LOG_AGE_MAX_MIN,
+                         QUERY_LOG_AGE_MAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_age_max = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_FULL_POLICY:
+            /* query_log_full_policy */
+            if (strcasecmp(optarg, "drop") == 0) {
+                cfg->query_log_full_policy = QUERY_LOG_FULL_DROP;
+            } else if (strcasecmp(optarg, "spill") == 0) {
+                cfg->query_log_full_policy = QUERY_LOG_FULL_SPILL;
+            } else if (strcasecmp(optarg, "sample") == 0) {
+                cfg->query_log_full_policy = QUERY_LOG_FULL_SAMPLE;
+            } else {
+                fprintf(stderr,"Error parsing option \"query_log_full_policy\","
+                               "'%s' is not a recognized argument (drop|spill|sample)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_SPILL_SIZE:
+            /* query_log_spill_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         1,
+                         UINTMAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_spill_size = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_FULL_SAMPLE_RATE:
+            /* query_log_full_sample_rate */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         QUERY_LOG_SAMPLE_RATE_MIN,
+                         QUERY_LOG_SAMPLE_RATE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_full_sample_rate = tmp_ul;
+            break;
+
+        case OPT_QUERY_LOG_INDEX:
+            /* query_log_index */
+            if (str_to_bool(&cfg->query_log_index, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"query_log_index\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_QUERY_LOG_INDEX_RECORDS:
+            /* query_log_index_records */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         QUERY_LOG_INDEX_RECORDS_MIN,
+                         QUERY_LOG_INDEX_RECORDS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->query_log_index_records = tmp_ul;
+            break;
+
+        case OPT_ZONE_FILE:
+            /* zone_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"zone_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_1_filepath);
+            cfg->resource_1_filepath = strdup(optarg);
+            if (cfg->resource_1_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"zone_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_FILE_UPDATE_FREQ:
+            /* zone_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_1_update_freq = tmp_ul;
+            break;
+
+        case OPT_ZONE_DELTA_FILE:
+            /* zone_delta_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"zone_delta_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_1_delta_filepath);
+            cfg->resource_1_delta_filepath = strdup(optarg);
+            if (cfg->resource_1_delta_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"zone_delta_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_IMAGE_COMPILE:
+            /* zone_image_compile */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"zone_image_compile\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->zone_image_compile_filepath);
+            cfg->zone_image_compile_filepath = strdup(optarg);
+            if (cfg->zone_image_compile_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"zone_image_compile\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_PREFAULT:
+            /* zone_prefault */
+            if (str_to_bool(&cfg->zone_prefault, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"zone_prefault\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_MLOCK:
+            /* zone_mlock */
+            if (str_to_bool(&cfg->zone_mlock, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"zone_mlock\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_COMPILE_THREADS:
+            /* zone_compile_threads */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         ZONE_COMPILE_THREADS_MIN,
+                         ZONE_COMPILE_THREADS_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->zone_compile_threads = tmp_ul;
+            break;
+
+        case OPT_ZONE_TRANSFER_ALLOW:
+            /* zone_transfer_allow */
+            if (config_parse_zone_transfer_allow(optarg, &cfg->zone_transfer_allow,
+                                                 &cfg->zone_transfer_allow_count) != 0) {
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_SECONDARY:
+            /* zone_secondary */
+            free(cfg->zone_secondary);
+            cfg->zone_secondary = strdup(optarg);
+            if (cfg->zone_secondary == NULL) {
+                fprintf(stderr,"Error allocating string for option \"zone_secondary\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_PRIMARY:
+            /* zone_primary */
+            if (strchr(optarg, '/') != NULL ||
+                utl_net_parse(&cfg->zone_primary, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"zone_primary\", '%s' is "
+                               "not a valid IP address\n", optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_PRIMARY_PORT:
+            /* zone_primary_port */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         TCP_UDP_PORT_MIN,
+                         TCP_UDP_PORT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->zone_primary_port = tmp_ul;
+            break;
+
+        case OPT_ECS_MAP_FILE:
+            /* ecs_map_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"ecs_map_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_2_filepath);
+            cfg->resource_2_filepath = strdup(optarg);
+            if (cfg->resource_2_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"ecs_map_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ECS_MAP_FILE_UPDATE_FREQ:
+            /* ecs_map_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_2_update_freq = tmp_ul;
+            break;
+
+        case OPT_VIEWS_FILE:
+            /* views_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"views_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_4_filepath);
+            cfg->resource_4_filepath = strdup(optarg);
+            if (cfg->resource_4_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"views_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_VIEWS_FILE_UPDATE_FREQ:
+            /* views_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_4_update_freq = tmp_ul;
+            break;
+
+        case OPT_ZONE_CATALOG_FILE:
+            /* zone_catalog_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"zone_catalog_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_9_filepath);
+            cfg->resource_9_filepath = strdup(optarg);
+            if (cfg->resource_9_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"zone_catalog_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ZONE_CATALOG_FILE_UPDATE_FREQ:
+            /* zone_catalog_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_9_update_freq = tmp_ul;
+            break;
+
+        case OPT_ACL_FILE:
+            /* acl_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"acl_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_5_filepath);
+            cfg->resource_5_filepath = strdup(optarg);
+            if (cfg->resource_5_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"acl_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ACL_FILE_UPDATE_FREQ:
+            /* acl_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_5_update_freq = tmp_ul;
+            break;
+
+        case OPT_POLICY_FILE:
+            /* policy_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"policy_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_6_filepath);
+            cfg->resource_6_filepath = strdup(optarg);
+            if (cfg->resource_6_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"policy_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_POLICY_FILE_UPDATE_FREQ:
+            /* policy_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_6_update_freq = tmp_ul;
+            break;
+
+        case OPT_GEOIP_FILE:
+            /* geoip_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"geoip_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_7_filepath);
+            cfg->resource_7_filepath = strdup(optarg);
+            if (cfg->resource_7_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"geoip_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_GEOIP_FILE_UPDATE_FREQ:
+            /* geoip_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_7_update_freq = tmp_ul;
+            break;
+
+        case OPT_LB_FILE:
+            /* lb_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"lb_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_8_filepath);
+            cfg->resource_8_filepath = strdup(optarg);
+            if (cfg->resource_8_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"lb_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_LB_FILE_UPDATE_FREQ:
+            /* lb_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_8_update_freq = tmp_ul;
+            break;
+
+        case OPT_LB_CHECK_INTERVAL:
+            /* lb_check_interval */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LB_CHECK_INTERVAL_MIN,
+                         LB_CHECK_INTERVAL_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->lb_check_interval = tmp_ul;
+            break;
+
+        case OPT_LB_CHECK_TIMEOUT:
+            /* lb_check_timeout */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         LB_CHECK_TIMEOUT_MIN,
+                         LB_CHECK_TIMEOUT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->lb_check_timeout = tmp_ul;
+            break;
+
+        case OPT_CONFIG_FILE:
+            /* config_file */
+            if (strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"config_file\","
+                               "'%s' length is greater than %d\n",
+                               optarg, FILE_REALPATH_MAX);
+                return -1;
+            }
+            free(cfg->resource_3_filepath);
+            cfg->resource_3_filepath = strdup(optarg);
+            if (cfg->resource_3_filepath == NULL) {
+                fprintf(stderr,"Error allocating string for option \"config_file\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_CONFIG_FILE_UPDATE_FREQ:
+            /* config_file_update_freq */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESOURCE_UPDATE_FREQ_MIN,
+                         RESOURCE_UPDATE_FREQ_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->resource_3_update_freq = tmp_ul;
+            break;
+
+        case OPT_UPGRADE_SOCKET:
+            /* upgrade_socket */
+            if (strlen(optarg) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+                fprintf(stderr,"Error parsing option \"upgrade_socket\","
+                               "'%s' length is greater than %zu\n", optarg,
+                               sizeof(((struct sockaddr_un *)NULL)->sun_path) - 1);
+                return -1;
+            }
+            free(cfg->upgrade_socket);
+            cfg->upgrade_socket = strdup(optarg);
+            if (cfg->upgrade_socket == NULL) {
+                fprintf(stderr,"Error allocating string for option \"upgrade_socket\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_ADMIN_SOCKET:
+            /* admin_socket */
+            if (strlen(optarg) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+                fprintf(stderr,"Error parsing option \"admin_socket\","
+                               "'%s' length is greater than %zu\n", optarg,
+                               sizeof(((struct sockaddr_un *)NULL)->sun_path) - 1);
+                return -1;
+            }
+            free(cfg->admin_socket);
+            cfg->admin_socket = strdup(optarg);
+            if (cfg->admin_socket == NULL) {
+                fprintf(stderr,"Error allocating string for option \"admin_socket\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_DRAIN_TIME:
+            /* drain_time */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         DRAIN_TIME_MIN,
+                         DRAIN_TIME_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->drain_time = tmp_ul;
+            break;
+
+        case OPT_RESPONSE_CACHE_SIZE:
+            /* response_cache_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESPONSE_CACHE_SIZE_MIN,
+                         RESPONSE_CACHE_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->response_cache_size = tmp_ul;
+            break;
+
+        case OPT_RESPONSE_CACHE_SHARED_SIZE:
+            /* response_cache_shared_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RESPONSE_CACHE_SHARED_SIZE_MIN,
+                         RESPONSE_CACHE_SHARED_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->response_cache_shared_size = tmp_ul;
+            break;
+
+        case OPT_RESPONSE_CACHE_SNAPSHOT_PATH:
+            /* response_cache_snapshot_path */
+            if (strlen(optarg) == 0 || strlen(optarg) > FILE_REALPATH_MAX) {
+                fprintf(stderr,"Error parsing option \"response_cache_snapshot_path\","
+                               "'%s' is not a valid path\n",
+                               optarg);
+                return -1;
+            }
+            free(cfg->response_cache_snapshot_path);
+            cfg->response_cache_snapshot_path = strdup(optarg);
+            if (cfg->response_cache_snapshot_path == NULL) {
+                fprintf(stderr,"Error allocating string for option "
+                               "\"response_cache_snapshot_path\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_RRL_RESPONSES_PER_SECOND:
+            /* rrl_responses_per_second */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RRL_RESPONSES_PER_SECOND_MIN,
+                         RRL_RESPONSES_PER_SECOND_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->rrl_responses_per_second = tmp_ul;
+            break;
+
+        case OPT_RRL_SLIP:
+            /* rrl_slip */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RRL_SLIP_MIN,
+                         RRL_SLIP_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->rrl_slip = tmp_ul;
+            break;
+
+        case OPT_RRL_IPV4_PREFIX_LEN:
+            /* rrl_ipv4_prefix_len */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RRL_IPV4_PREFIX_LEN_MIN,
+                         RRL_IPV4_PREFIX_LEN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->rrl_ipv4_prefix_len = tmp_ul;
+            break;
+
+        case OPT_RRL_IPV6_PREFIX_LEN:
+            /* rrl_ipv6_prefix_len */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RRL_IPV6_PREFIX_LEN_MIN,
+                         RRL_IPV6_PREFIX_LEN_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->rrl_ipv6_prefix_len = tmp_ul;
+            break;
+
+        case OPT_RRL_TABLE_SIZE:
+            /* rrl_table_size */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         RRL_TABLE_SIZE_MIN,
+                         RRL_TABLE_SIZE_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->rrl_table_size = tmp_ul;
+            break;
+
+        case OPT_OVERLOAD_ITERATION_MAX:
+            /* overload_iteration_max */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         OVERLOAD_ITERATION_MAX_MIN,
+                         OVERLOAD_ITERATION_MAX_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->overload_iteration_max = tmp_ul;
+            break;
+
+        case OPT_OVERLOAD_SLIP:
+            /* overload_slip */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         OVERLOAD_SLIP_MIN,
+                         OVERLOAD_SLIP_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->overload_slip = tmp_ul;
+            break;
+
+        case OPT_SLO_LATENCY_P50:
+        case OPT_SLO_LATENCY_P99:
+        case OPT_SLO_LATENCY_P999:
+            /* slo_latency_p50, slo_latency_p99, slo_latency_p999 */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         SLO_LATENCY_MIN,
+                         SLO_LATENCY_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            if (c == OPT_SLO_LATENCY_P50) {
+                cfg->slo_latency_p50 = tmp_ul;
+            } else if (c == OPT_SLO_LATENCY_P99) {
+                cfg->slo_latency_p99 = tmp_ul;
+            } else {
+                cfg->slo_latency_p999 = tmp_ul;
+            }
+            break;
+
+        case OPT_SLO_WINDOW:
+            /* slo_window */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         SLO_WINDOW_MIN,
+                         SLO_WINDOW_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->slo_window = tmp_ul;
+            break;
+
+        case OPT_DNS_COOKIES:
+            /* dns_cookies */
+            if (str_to_bool(&cfg->dns_cookies, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"dns_cookies\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_DNS_COOKIE_SECRET:
+            /* dns_cookie_secret */
+            if (str_hex_to_bin(cfg->dns_cookie_secret, DNS_COOKIE_SECRET_LEN, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"dns_cookie_secret\","
+                               "'%s' is not %d hex digits\n",
+                               optarg, DNS_COOKIE_SECRET_LEN * 2);
+                return -1;
+            }
+            break;
+
+        case OPT_METRICS_ENABLE:
+            /* metrics_enable */
+            if (str_to_bool(&cfg->metrics_enable, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"metrics_enable\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_METRICS_LISTENER_IP:
+            /* metrics_listener_ip */
+            {
+                struct in6_addr addr;
+                if (inet_pton(AF_INET, optarg, &addr) != 1 &&
+                    inet_pton(AF_INET6, optarg, &addr) != 1) {
+                    fprintf(stderr,"Error parsing option \"metrics_listener_ip\","
+                                   "'%s' is not a valid IPv4 or IPv6 address\n",
+                                   optarg);
+                    return -1;
+                }
+            }
+            free(cfg->metrics_listener_ip);
+            cfg->metrics_listener_ip = strdup(optarg);
+            if (cfg->metrics_listener_ip == NULL) {
+                fprintf(stderr,"Error allocating string for option \"metrics_listener_ip\"\n");
+                return -1;
+            }
+            break;
+
+        case OPT_METRICS_LISTENER_PORT:
+            /* metrics_listener_port */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg, 
+                         TCP_UDP_PORT_MIN,
+                         TCP_UDP_PORT_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->metrics_listener_port = tmp_ul;
+            break;
+
+        case OPT_METRICS_SKETCHES:
+            /* metrics_sketches */
+            if (str_to_bool(&cfg->metrics_sketches, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"metrics_sketches\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_METRICS_ZONES:
+            /* metrics_zones */
+            if (str_to_bool(&cfg->metrics_zones, optarg) != 0) {
+                fprintf(stderr,"Error parsing option \"metrics_zones\","
+                               "'%s' is not a recognized argument (True|False)\n",
+                               optarg);
+                return -1;
+            }
+            break;
+
+        case OPT_METRICS_QUERY_COST:
+            /* metrics_query_cost */
+            tmp_ul = config_parse_unsigned_long_opt(long_options[option_index].name,
+                         optarg,
+                         METRICS_QUERY_COST_MIN,
+                         METRICS_QUERY_COST_MAX);
+            if (tmp_ul < 0) {
+                return -1;
+            }
+            cfg->metrics_query_cost = tmp_ul;
+            break;
+        
+        default:
+            printf("Unrecognized option: %s\n", argv[optind++]);
+            return -1;
+        }
     }
 
     if (optind < argc) {
@@ -828,10 +4290,108 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
         return -1;
     }
 
-    /* Handle process_thread_masks */
+    if (cfg->query_log_remote_ip != NULL && cfg->query_log_remote_unix != NULL) {
+        fprintf(stderr, "Options \"query_log_remote_ip\" and "
+                "\"query_log_remote_unix\" can not be used together\n");
+        return -1;
+    }
+
+    if (cfg->dot_enable && (cfg->dot_cert_file == NULL || cfg->dot_key_file == NULL)) {
+        fprintf(stderr, "Option \"dot_enable\" requires options \"dot_cert_file\" "
+                "and \"dot_key_file\" to be set\n");
+        return -1;
+    }
+
+    if (cfg->dnssec_key_file != NULL && cfg->dnssec_signer_name == NULL) {
+        fprintf(stderr, "Option \"dnssec_key_file\" requires option "
+                "\"dnssec_signer_name\" to be set\n");
+        return -1;
+    }
+
+    /* TCP read buffer holds as many full size queries as a TCP connection
+     * processes at once.
+     */
+    cfg->tcp_readbuff_size = cfg->tcp_conn_simultaneous_queries_count *
+                             (2 + RIP_NS_PACKETSZ);
+
+    if (cfg->udp_conn_vector_len_min > cfg->udp_conn_vector_len) {
+        fprintf(stderr, "Option \"udp_conn_vector_len_min\" (%zu) can not be larger "
+                "than \"udp_conn_vector_len\" (%zu)\n", cfg->udp_conn_vector_len_min,
+                cfg->udp_conn_vector_len);
+        return -1;
+    }
+
+    /* Handle process_thread_masks, with worker processes masks list CPUs of
+     * vectorloops of all workers, worker takes its own out, see
+     * @ref prefork_worker_config.
+     */
+    if (cfg->process_workers > 0) {
+        size_t count = cfg->process_thread_count * cfg->process_workers;
+
+        cfg->process_thread_masks = realloc(cfg->process_thread_masks,
+                                            sizeof(size_t) * count);
+        CHECK_MALLOC(cfg->process_thread_masks);
+        memset(cfg->process_thread_masks, 0, sizeof(size_t) * count);
+    }
     if (parse_csv_to_ul_array(cfg->process_thread_masks, 
-                              cfg->process_thread_count,
+                              cfg->process_thread_count *
+                              (cfg->process_workers > 0 ? cfg->process_workers : 1),
                               opt_process_thread_masks) != 0) {
+        free(opt_process_thread_roles);
+        return -1;
+    }
+
+    /* Handle process_thread_roles */
+    if (opt_process_thread_roles != NULL &&
+        config_parse_process_thread_roles(opt_process_thread_roles,
+                                          cfg->process_thread_roles,
+                                          cfg->process_thread_count) != 0) {
+        free(opt_process_thread_roles);
+        return -1;
+    }
+    free(opt_process_thread_roles);
+    if (config_check_process_thread_roles(cfg) != 0) {
+        return -1;
+    }
+
+    if (cfg->tcp_handoff && cfg->process_thread_count > TCP_HANDOFF_VL_MAX) {
+        fprintf(stderr, "Option \"tcp_handoff\" requires \"process_thread_count\" "
+                "of at most %d\n", TCP_HANDOFF_VL_MAX);
+        return -1;
+    }
+
+    if (cfg->xdp_responder_size > 0 && cfg->xdp_interface == NULL) {
+        fprintf(stderr, "Option \"xdp_responder_size\" requires option "
+                "\"xdp_interface\" to be set\n");
+        return -1;
+    }
+
+    if (cfg->upgrade_socket[0] != '\0' && cfg->xdp_interface != NULL) {
+        fprintf(stderr, "Option \"upgrade_socket\" can not be used with "
+                "\"xdp_interface\", AF_XDP sockets can not be handed over\n");
+        return -1;
+    }
+
+    if (cfg->process_workers > 0 &&
+        (cfg->upgrade_socket[0] != '\0' || cfg->xdp_interface != NULL ||
+         cfg->process_thread_cpu_steering || cfg->process_thread_client_steering ||
+         cfg->process_thread_auto_pin || cfg->metrics_sketches)) {
+        fprintf(stderr, "Option \"process_workers\" can not be used with "
+                "\"upgrade_socket\", \"xdp_interface\", \"process_thread_cpu_steering\", "
+                "\"process_thread_client_steering\", \"process_thread_auto_pin\" or "
+                "\"metrics_sketches\"\n");
+        return -1;
+    }
+
+    if (cfg->process_thread_cpu_steering && cfg->process_thread_client_steering) {
+        fprintf(stderr, "Option \"process_thread_cpu_steering\" can not be used with "
+                "\"process_thread_client_steering\"\n");
+        return -1;
+    }
+
+    if (cfg->zone_secondary[0] != '\0' && cfg->zone_primary.family == 0) {
+        fprintf(stderr, "Option \"zone_secondary\" requires option "
+                "\"zone_primary\" to be set\n");
         return -1;
     }
 
@@ -861,7 +4421,549 @@ config_parse_opts(config_t *cfg, int argc, char *argv[])
         return -1;
     }
 
+    /* Listener profiles are copies of configuration, so they are parsed once
+     * all of it is in place.
+     */
+    if (opt_listener_profiles_file != NULL) {
+        char   err[ERR_MSG_LENGTH];
+        char  *buf = NULL;
+        long   len = 0;
+        FILE  *f   = fopen(opt_listener_profiles_file, "r");
+
+        if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0 ||
+            fseek(f, 0, SEEK_SET) != 0) {
+            fprintf(stderr, "Error reading listener profiles file %s, %s\n",
+                    opt_listener_profiles_file, strerror(errno));
+            if (f != NULL) {
+                fclose(f);
+            }
+            return -1;
+        }
+        buf = malloc(len + 1);
+        CHECK_MALLOC(buf);
+        if (fread(buf, 1, len, f) != (size_t)len) {
+            fprintf(stderr, "Error reading listener profiles file %s\n",
+                    opt_listener_profiles_file);
+            fclose(f);
+            free(buf);
+            return -1;
+        }
+        fclose(f);
+        if (config_listener_profiles_parse(cfg, buf, len, err, sizeof(err)) != 0) {
+            fprintf(stderr, "Error parsing listener profiles file %s, %s\n",
+                    opt_listener_profiles_file, err);
+            free(buf);
+            return -1;
+        }
+        free(buf);
+    }
+
+    return 0;
+}
+
+/** Types of settings that can be reloaded from configuration file. */
+typedef enum config_reload_type_e {
+    /** Number stored as size_t. */
+    CONFIG_RELOAD_SIZE = 0,
+
+    /** Number stored as uint32_t. */
+    CONFIG_RELOAD_U32,
+
+    /** Boolean (True|False). */
+    CONFIG_RELOAD_BOOL,
+
+    /** Number stored as int. */
+    CONFIG_RELOAD_INT,
+} config_reload_type_t;
+
+/** Shorthand to describe a setting that can be reloaded. */
+#define CONFIG_RELOAD_OPT(name, type, min, max) \
+    { #name, offsetof(config_t, name), type, min, max }
+
+/** Structure describes a setting that can be set in a file, by its command
+ * line option name.
+ */
+typedef struct config_file_opt_s {
+    /** Command line option name. */
+    const char          *name;
+
+    /** Offset of setting in configuration object. */
+    size_t               offset;
+
+    /** How setting is stored. */
+    config_reload_type_t type;
+
+    /** MIN bound of setting. */
+    size_t               min;
+
+    /** MAX bound of setting. */
+    size_t               max;
+} config_file_opt_t;
+
+/** Settings that can be set in configuration file, see @ref config_reload().
+ * These are settings vectorloops read as they go, so a new value takes effect
+ * from next vectorloop iteration (or next TCP connection timer armed). Bounds
+ * are same as of command line option.
+ */
+static const config_file_opt_t config_reload_opts[] = {
+    CONFIG_RELOAD_OPT(loop_budget_udp_datagrams, CONFIG_RELOAD_SIZE,
+                      LOOP_BUDGET_MIN, LOOP_BUDGET_MAX),
+    CONFIG_RELOAD_OPT(loop_budget_tcp_reads, CONFIG_RELOAD_SIZE,
+                      LOOP_BUDGET_MIN, LOOP_BUDGET_MAX),
+    CONFIG_RELOAD_OPT(loop_budget_tcp_accepts, CONFIG_RELOAD_SIZE,
+                      LOOP_BUDGET_MIN, LOOP_BUDGET_MAX),
+    CONFIG_RELOAD_OPT(loop_budget_xfr_bytes, CONFIG_RELOAD_SIZE,
+                      LOOP_BUDGET_XFR_BYTES_MIN, LOOP_BUDGET_XFR_BYTES_MAX),
+    CONFIG_RELOAD_OPT(loop_idle_spin, CONFIG_RELOAD_SIZE,
+                      VL_IDLE_SPIN_MIN, VL_IDLE_SPIN_MAX),
+    CONFIG_RELOAD_OPT(loop_idle_wait_max, CONFIG_RELOAD_SIZE,
+                      VL_IDLE_WAIT_MAX_MIN, VL_IDLE_WAIT_MAX_MAX),
+    CONFIG_RELOAD_OPT(udp_conn_vector_len, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_VECTOR_LEN_MIN, UDP_CONN_VECTOR_LEN_MAX),
+    CONFIG_RELOAD_OPT(udp_conn_vector_len_min, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_VECTOR_LEN_MIN_MIN, UDP_CONN_VECTOR_LEN_MIN_MAX),
+    CONFIG_RELOAD_OPT(udp_pipeline_batch_len, CONFIG_RELOAD_SIZE,
+                      UDP_PIPELINE_BATCH_LEN_MIN, UDP_PIPELINE_BATCH_LEN_MAX),
+    CONFIG_RELOAD_OPT(tcp_listener_max_accept_new_conn, CONFIG_RELOAD_SIZE,
+                      TCP_LIST_MAX_ACCEPT_NEW_CONN_MIN, TCP_LIST_MAX_ACCEPT_NEW_CONN_MAX),
+    CONFIG_RELOAD_OPT(tcp_keepalive, CONFIG_RELOAD_SIZE,
+                      TCP_KEEPALIVE_MIN, TCP_KEEPALIVE_MAX),
+    CONFIG_RELOAD_OPT(tcp_keepalive_shrink_start, CONFIG_RELOAD_SIZE,
+                      TCP_KEEPALIVE_SHRINK_START_MIN, TCP_KEEPALIVE_SHRINK_START_MAX),
+    CONFIG_RELOAD_OPT(tcp_query_recv_timeout, CONFIG_RELOAD_SIZE,
+                      1, UINTMAX_MAX),
+    CONFIG_RELOAD_OPT(tcp_query_send_timeout, CONFIG_RELOAD_SIZE,
+                      1, UINTMAX_MAX),
+    CONFIG_RELOAD_OPT(tcp_handoff_threshold, CONFIG_RELOAD_SIZE,
+                      TCP_HANDOFF_THRESHOLD_MIN, TCP_HANDOFF_THRESHOLD_MAX),
+    CONFIG_RELOAD_OPT(tcp_conns_idle_evict, CONFIG_RELOAD_BOOL, 0, 1),
+    CONFIG_RELOAD_OPT(udp_socket_recvbuff_autotune_max, CONFIG_RELOAD_SIZE,
+                      0, UDP_CONN_SO_RECVBUFF_MAX),
+    CONFIG_RELOAD_OPT(query_log_sample_rate, CONFIG_RELOAD_U32,
+                      QUERY_LOG_SAMPLE_RATE_MIN, QUERY_LOG_SAMPLE_RATE_MAX),
+    CONFIG_RELOAD_OPT(query_log_errors_only, CONFIG_RELOAD_BOOL, 0, 1),
+    CONFIG_RELOAD_OPT(query_log_latency_min, CONFIG_RELOAD_U32,
+                      QUERY_LOG_LATENCY_MIN_MIN, QUERY_LOG_LATENCY_MIN_MAX),
+};
+
+/** Settings that can be set in a listener tuning profile, see
+ * @ref config_listener_profiles_parse(). These are settings listeners are
+ * provisioned with, so they are applied once at startup. Bounds are same as
+ * of command line option.
+ */
+static const config_file_opt_t config_profile_opts[] = {
+    CONFIG_RELOAD_OPT(udp_conn_vector_len, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_VECTOR_LEN_MIN, UDP_CONN_VECTOR_LEN_MAX),
+    CONFIG_RELOAD_OPT(udp_conn_vector_len_min, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_VECTOR_LEN_MIN_MIN, UDP_CONN_VECTOR_LEN_MIN_MAX),
+    CONFIG_RELOAD_OPT(udp_listener_batches, CONFIG_RELOAD_SIZE,
+                      UDP_LISTENER_BATCHES_MIN, UDP_LISTENER_BATCHES_MAX),
+    CONFIG_RELOAD_OPT(udp_socket_recvbuff_size, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_SO_RECVBUFF_MIN, UDP_CONN_SO_RECVBUFF_MAX),
+    CONFIG_RELOAD_OPT(udp_socket_sendbuff_size, CONFIG_RELOAD_SIZE,
+                      UDP_CONN_SO_SENDBUFF_MIN, UDP_CONN_SO_SENDBUFF_MAX),
+    CONFIG_RELOAD_OPT(tcp_listener_pending_conns_max, CONFIG_RELOAD_INT,
+                      TCP_LIST_PENDING_CONNS_MAX_MIN, TCP_LIST_PENDING_CONNS_MAX_MAX),
+    CONFIG_RELOAD_OPT(tcp_listener_max_accept_new_conn, CONFIG_RELOAD_SIZE,
+                      TCP_LIST_MAX_ACCEPT_NEW_CONN_MIN, TCP_LIST_MAX_ACCEPT_NEW_CONN_MAX),
+    CONFIG_RELOAD_OPT(tcp_listener_fastopen, CONFIG_RELOAD_INT,
+                      TCP_LISTENER_FASTOPEN_MIN, TCP_LISTENER_FASTOPEN_MAX),
+    CONFIG_RELOAD_OPT(tcp_listener_defer_accept, CONFIG_RELOAD_INT,
+                      TCP_LISTENER_DEFER_ACCEPT_MIN, TCP_LISTENER_DEFER_ACCEPT_MAX),
+};
+
+/** Apply a configuration file setting to configuration object.
+ * 
+ * @note This is a helper function for @ref config_reload() and
+ *       @ref config_listener_profiles_parse().
+ * 
+ * @param cfg        Configuration object to apply setting to.
+ * @param opts       Settings that can be set.
+ * @param opts_count Number of entries in opts.
+ * @param name       Setting (command line option) name.
+ * @param value      Setting value.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns 0 on success, -1 if setting is not recognized or
+ *                   value is not valid.
+ */
+static int
+config_reload_opt(config_t *cfg, const config_file_opt_t *opts, size_t opts_count,
+                  char *name, char *value, char *err, size_t err_len)
+{
+    unsigned long tmp_ul = 0;
+    bool          tmp_b  = false;
+
+    for (size_t i = 0; i < opts_count; i++) {
+        if (strcmp(name, opts[i].name) != 0) {
+            continue;
+        }
+        void *field = (char *)cfg + opts[i].offset;
+
+        if (opts[i].type == CONFIG_RELOAD_BOOL) {
+            if (str_to_bool(&tmp_b, value) != 0) {
+                snprintf(err, err_len, "option \"%s\", '%s' is not a recognized "
+                         "argument (True|False)", name, value);
+                return -1;
+            }
+            *(bool *)field = tmp_b;
+            return 0;
+        }
+        if (str_to_unsigned_long(&tmp_ul, value) != 0) {
+            snprintf(err, err_len, "option \"%s\", '%s' is not a recognized number",
+                     name, value);
+            return -1;
+        }
+        if (tmp_ul < opts[i].min || tmp_ul > opts[i].max) {
+            snprintf(err, err_len, "option \"%s\", '%s' is not within allowed "
+                     "bounds of %zu - %zu", name, value, opts[i].min, opts[i].max);
+            return -1;
+        }
+        if (opts[i].type == CONFIG_RELOAD_U32) {
+            *(uint32_t *)field = tmp_ul;
+        } else if (opts[i].type == CONFIG_RELOAD_INT) {
+            *(int *)field = tmp_ul;
+        } else {
+            *(size_t *)field = tmp_ul;
+        }
+        return 0;
+    }
+
+    snprintf(err, err_len, "option \"%s\" can not be set in %s", name,
+             opts == config_profile_opts ? "listener profile" : "configuration file");
+    return -1;
+}
+
+/** Split next line of a configuration file into option name and value, see
+ * @ref config_reload() for format.
+ *
+ * @note This is a helper function for @ref config_reload() and
+ *       @ref config_listener_profiles_parse().
+ *
+ * @param line    Line, it is modified.
+ * @param name    Where to store option name, NULL if line is empty or a
+ *                comment.
+ * @param value   Where to store option value.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 if option has no value.
+ */
+static int
+config_file_line_split(char *line, char **name, char **value, char *err, size_t err_len)
+{
+    *name = line + strspn(line, " \t\r");
+    if (**name == '\0' || **name == '#') {
+        *name = NULL;
+        return 0;
+    }
+    if (strncmp(*name, "--", 2) == 0) {
+        *name += 2;
+    }
+    *value = *name + strcspn(*name, " \t\r=");
+    if (**value != '\0') {
+        *(*value)++ = '\0';
+        *value += strspn(*value, " \t\r=");
+    }
+    (*value)[strcspn(*value, " \t\r")] = '\0';
+    if (**value == '\0') {
+        snprintf(err, err_len, "option \"%s\" has no value", *name);
+        return -1;
+    }
+    return 0;
+}
+
+/** Build reloaded configuration from configuration file contents.
+ * 
+ * Configuration file has one setting per line in format "<option> <value>"
+ * (or "<option>=<value>"), where option is command line option name with or
+ * without leading "--". Empty lines and lines starting with '#' are skipped.
+ * Only settings in @ref config_reload_opts can be set. Settings are applied
+ * on top of a copy of base configuration, so setting removed from file
+ * reverts to its base value. Copy shares strings and arrays with base
+ * configuration, and is released with free().
+ * 
+ * @param base       Configuration application was started with.
+ * @param buf        Configuration file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to reloaded configuration.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns reloaded configuration, or NULL if file has an
+ *                   error in which case err is populated.
+ */
+config_t *
+config_reload(const config_t *base, const char *buf, size_t buf_len,
+              uint64_t generation, char *err, size_t err_len)
+{
+    config_t *cfg     = NULL;
+    char     *text    = NULL;
+    char     *line    = NULL;
+    char     *next    = NULL;
+    char     *name    = NULL;
+    char     *value   = NULL;
+    int       line_no = 0;
+
+    cfg = malloc(sizeof(config_t));
+    CHECK_MALLOC(cfg);
+    *cfg = *base;
+    cfg->generation = generation;
+
+    text = malloc(buf_len + 1);
+    CHECK_MALLOC(text);
+    memcpy(text, buf, buf_len);
+    text[buf_len] = '\0';
+
+    for (line = text; line != NULL; line = next) {
+        INCREMENT(line_no);
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+
+        /* Split line into option name and value. */
+        char opt_err[ERR_MSG_LENGTH];
+        if (config_file_line_split(line, &name, &value, opt_err, sizeof(opt_err)) != 0) {
+            snprintf(err, err_len, "line %d, %s", line_no, opt_err);
+            goto error;
+        }
+        if (name == NULL) {
+            continue;
+        }
+
+        if (config_reload_opt(cfg, config_reload_opts,
+                              sizeof(config_reload_opts) / sizeof(config_reload_opts[0]),
+                              name, value, opt_err, sizeof(opt_err)) != 0) {
+            snprintf(err, err_len, "line %d, %s", line_no, opt_err);
+            goto error;
+        }
+    }
+
+    if (cfg->udp_conn_vector_len_min > cfg->udp_conn_vector_len) {
+        snprintf(err, err_len, "option \"udp_conn_vector_len_min\" (%zu) can not be "
+                 "larger than \"udp_conn_vector_len\" (%zu)",
+                 cfg->udp_conn_vector_len_min, cfg->udp_conn_vector_len);
+        goto error;
+    }
+
+    free(text);
+    return cfg;
+
+error:
+    free(text);
+    free(cfg);
+    return NULL;
+}
+
+/** Assign a listener to a listener tuning profile.
+ *
+ * @note This is a helper function for @ref config_listener_profiles_parse().
+ *
+ * @param cfg     Application configuration.
+ * @param profile Profile, index + 1 in listener_profiles.
+ * @param value   Listener: "udp", "tcp", "dot" or an address of
+ *                "udp_listener_addresses".
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 if listener is not valid or
+ *                already has a profile.
+ */
+static int
+config_listener_profile_assign(config_t *cfg, uint8_t profile, const char *value,
+                               char *err, size_t err_len)
+{
+    utl_net_t  addr;
+    uint8_t   *slot = NULL;
+
+    if (strcmp(value, "udp") == 0) {
+        if (cfg->udp_listener_addresses_count > 0) {
+            snprintf(err, err_len, "listener \"udp\", UDP listeners are bound to "
+                     "addresses of \"udp_listener_addresses\", assign those instead");
+            return -1;
+        }
+        slot = &cfg->listener_profile_udp;
+    } else if (strcmp(value, "tcp") == 0) {
+        slot = &cfg->listener_profile_tcp;
+    } else if (strcmp(value, "dot") == 0) {
+        slot = &cfg->listener_profile_dot;
+    } else {
+        if (strchr(value, '/') != NULL || utl_net_parse(&addr, value) != 0) {
+            snprintf(err, err_len, "listener '%s' is not one of (udp|tcp|dot) nor "
+                     "an IP address", value);
+            return -1;
+        }
+        for (size_t i = 0; i < cfg->udp_listener_addresses_count; i++) {
+            if (cfg->udp_listener_addresses[i].family == addr.family &&
+                memcmp(cfg->udp_listener_addresses[i].addr, addr.addr,
+                       addr.family == AF_INET ? 4 : 16) == 0) {
+                slot = &cfg->udp_listener_addresses_profile[i];
+                break;
+            }
+        }
+        if (slot == NULL) {
+            snprintf(err, err_len, "listener '%s' is not an address of "
+                     "\"udp_listener_addresses\"", value);
+            return -1;
+        }
+    }
+    if (*slot != 0) {
+        snprintf(err, err_len, "listener '%s' already has profile \"%s\"", value,
+                 cfg->listener_profiles[*slot - 1].name);
+        return -1;
+    }
+    *slot = profile;
+    return 0;
+}
+
+/** Parse listener tuning profiles, see configuration option
+ * "listener_profiles_file".
+ *
+ * File has one setting per line in same format as configuration file, see
+ * @ref config_reload(). Line "profile <name>" starts a new profile, and
+ * settings that follow, up to next profile, are its own: "listener
+ * <listener>" assigns a listener to it, see
+ * @ref config_listener_profile_assign(), and rest are settings of
+ * @ref config_profile_opts. Each profile gets a copy of application
+ * configuration, as parsed from command line, with its settings applied,
+ * which listeners of profile are provisioned with.
+ *
+ * @param cfg     Application configuration, with command line options
+ *                parsed.
+ * @param buf     Profiles file contents.
+ * @param buf_len Length of buf.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 if file has an error in which case
+ *                err is populated. Profiles parsed are released by
+ *                @ref config_clean() either way.
+ */
+int
+config_listener_profiles_parse(config_t *cfg, const char *buf, size_t buf_len,
+                               char *err, size_t err_len)
+{
+    config_listener_profile_t *profile = NULL;
+    char                      *text    = NULL;
+    char                      *line    = NULL;
+    char                      *next    = NULL;
+    char                      *name    = NULL;
+    char                      *value   = NULL;
+    char                       opt_err[ERR_MSG_LENGTH];
+    int                        line_no = 0;
+
+    if (cfg->udp_listener_addresses_count > 0) {
+        cfg->udp_listener_addresses_profile = calloc(cfg->udp_listener_addresses_count,
+                                                     sizeof(uint8_t));
+        CHECK_MALLOC(cfg->udp_listener_addresses_profile);
+    }
+
+    text = malloc(buf_len + 1);
+    CHECK_MALLOC(text);
+    memcpy(text, buf, buf_len);
+    text[buf_len] = '\0';
+
+    for (line = text; line != NULL; line = next) {
+        INCREMENT(line_no);
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+
+        if (config_file_line_split(line, &name, &value, opt_err, sizeof(opt_err)) != 0) {
+            snprintf(err, err_len, "line %d, %s", line_no, opt_err);
+            goto error;
+        }
+        if (name == NULL) {
+            continue;
+        }
+
+        /* Start a new profile. */
+        if (strcmp(name, "profile") == 0) {
+            if (cfg->listener_profiles_count == LISTENER_PROFILES_MAX) {
+                snprintf(err, err_len, "line %d, more than %d profiles", line_no,
+                         LISTENER_PROFILES_MAX);
+                goto error;
+            }
+            if (strlen(value) > LISTENER_PROFILE_NAME_MAX) {
+                snprintf(err, err_len, "line %d, profile name '%s' is longer than %d",
+                         line_no, value, LISTENER_PROFILE_NAME_MAX);
+                goto error;
+            }
+            for (size_t i = 0; i < cfg->listener_profiles_count; i++) {
+                if (strcmp(cfg->listener_profiles[i].name, value) == 0) {
+                    snprintf(err, err_len, "line %d, profile \"%s\" is already defined",
+                             line_no, value);
+                    goto error;
+                }
+            }
+            cfg->listener_profiles = realloc(cfg->listener_profiles,
+                                             sizeof(config_listener_profile_t) *
+                                             (cfg->listener_profiles_count + 1));
+            CHECK_MALLOC(cfg->listener_profiles);
+            profile  = &cfg->listener_profiles[cfg->listener_profiles_count++];
+            *profile = (config_listener_profile_t) { };
+            strcpy(profile->name, value);
+            profile->cfg = malloc(sizeof(config_t));
+            CHECK_MALLOC(profile->cfg);
+            *profile->cfg = *cfg;
+            continue;
+        }
+
+        if (profile == NULL) {
+            snprintf(err, err_len, "line %d, option \"%s\" is not in a profile",
+                     line_no, name);
+            goto error;
+        }
+        if (strcmp(name, "listener") == 0) {
+            if (config_listener_profile_assign(cfg, cfg->listener_profiles_count, value,
+                                               opt_err, sizeof(opt_err)) != 0) {
+                snprintf(err, err_len, "line %d, %s", line_no, opt_err);
+                goto error;
+            }
+            continue;
+        }
+        if (config_reload_opt(profile->cfg, config_profile_opts,
+                              sizeof(config_profile_opts) / sizeof(config_profile_opts[0]),
+                              name, value, opt_err, sizeof(opt_err)) != 0) {
+            snprintf(err, err_len, "line %d, %s", line_no, opt_err);
+            goto error;
+        }
+        if (strcmp(name, "tcp_listener_max_accept_new_conn") == 0) {
+            profile->tcp_listener_max_accept_new_conn =
+                profile->cfg->tcp_listener_max_accept_new_conn;
+        } else if (strncmp(name, "udp_conn_vector_len", 19) == 0) {
+            profile->udp_conn_vector_len_set = true;
+        }
+    }
+
+    /* Profile configurations see all profiles, as application one does. */
+    for (size_t i = 0; i < cfg->listener_profiles_count; i++) {
+        config_t *pcfg = cfg->listener_profiles[i].cfg;
+
+        if (pcfg->udp_conn_vector_len_min > pcfg->udp_conn_vector_len) {
+            snprintf(err, err_len, "profile \"%s\", option \"udp_conn_vector_len_min\" "
+                     "(%zu) can not be larger than \"udp_conn_vector_len\" (%zu)",
+                     cfg->listener_profiles[i].name, pcfg->udp_conn_vector_len_min,
+                     pcfg->udp_conn_vector_len);
+            goto error;
+        }
+        pcfg->listener_profiles              = cfg->listener_profiles;
+        pcfg->listener_profiles_count        = cfg->listener_profiles_count;
+        pcfg->udp_listener_addresses_profile = cfg->udp_listener_addresses_profile;
+        pcfg->listener_profile_udp           = cfg->listener_profile_udp;
+        pcfg->listener_profile_tcp           = cfg->listener_profile_tcp;
+        pcfg->listener_profile_dot           = cfg->listener_profile_dot;
+    }
+
+    free(text);
     return 0;
+
+error:
+    free(text);
+    return -1;
 }
 
 /** Clean configuration object. This will release memory assigned to object
@@ -873,13 +4975,57 @@ void
 config_clean(config_t *cfg)
 {
     free(cfg->process_thread_masks);
+    free(cfg->process_thread_roles);
     free(cfg->application_log_name);
     free(cfg->application_log_path);
     free(cfg->query_log_base_name);
     free(cfg->query_log_path);
+    free(cfg->query_log_remote_ip);
+    free(cfg->query_log_remote_unix);
+    free(cfg->udp_mirror_ip);
+    free(cfg->query_log_shm_path);
+    free(cfg->response_cache_snapshot_path);
+    free(cfg->dot_cert_file);
+    free(cfg->dot_key_file);
+    free(cfg->dnssec_key_file);
+    free(cfg->dnssec_signer_name);
+
+    free(cfg->xdp_interface);
+    free(cfg->process_thread_auto_pin_interface);
+    free(cfg->process_housekeeping_cpus);
 
     free(cfg->resource_1_name);
     free(cfg->resource_1_filepath);
+    free(cfg->resource_1_delta_filepath);
+    free(cfg->zone_image_compile_filepath);
+    free(cfg->zone_transfer_allow);
+    free(cfg->udp_listener_addresses);
+    for (size_t i = 0; i < cfg->listener_profiles_count; i++) {
+        free(cfg->listener_profiles[i].cfg);
+    }
+    free(cfg->listener_profiles);
+    free(cfg->udp_listener_addresses_profile);
+    free(cfg->zone_secondary);
+    free(cfg->resource_2_name);
+    free(cfg->resource_2_filepath);
+    free(cfg->resource_3_name);
+    free(cfg->resource_3_filepath);
+    free(cfg->resource_4_name);
+    free(cfg->resource_4_filepath);
+    free(cfg->resource_5_name);
+    free(cfg->resource_5_filepath);
+    free(cfg->resource_6_name);
+    free(cfg->resource_6_filepath);
+    free(cfg->resource_7_name);
+    free(cfg->resource_7_filepath);
+    free(cfg->resource_8_name);
+    free(cfg->resource_8_filepath);
+    free(cfg->resource_9_name);
+    free(cfg->resource_9_filepath);
+    free(cfg->upgrade_socket);
+    free(cfg->admin_socket);
+
+    free(cfg->metrics_listener_ip);
 
 }
 
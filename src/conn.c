@@ -26,16 +26,18 @@
 #include <assert.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include "config.h"
 #include "conn.h"
 #include "constants.h"
-#include "lru_cache.h"
+#include "mem.h"
 #include "query.h"
 #include "utils.h"
 
@@ -90,6 +92,30 @@ listener_err_to_str(int err)
         return "Error setting socket option SO_SNDBUF";
         break;  
 
+    case -11:
+        return "Error setting socket option SO_BUSY_POLL";
+        break;
+
+    case -12:
+        return "Error setting socket option TCP_FASTOPEN";
+        break;
+
+    case -13:
+        return "Error setting socket option TCP_DEFER_ACCEPT";
+        break;
+
+    case -14:
+        return "Error setting socket option TCP_NOTSENT_LOWAT";
+        break;
+
+    case -15:
+        return "Error setting socket option SO_RXQ_OVFL";
+        break;
+
+    case -16:
+        return "Error setting socket option SO_TIMESTAMPNS";
+        break;
+
     default:
         return "Unknown";
     }
@@ -104,39 +130,21 @@ listener_err_to_str(int err)
 void
 conn_tcp_release(conn_tcp_t *conn_tcp)
 {
-    free(conn_tcp->read_buffer);
-    for (int i = 0; i < conn_tcp->queries_size; i++) {
-        query_clean(&conn_tcp->queries[i]);
-    }
-    free(conn_tcp->queries);
-    free(conn_tcp);
+    conn_tcp_bufs_free(conn_tcp_bufs_detach(conn_tcp));
+    zone_xfr_stream_free(conn_tcp->xfr);
+    mem_free(MEM_TAG_TCP_CONNS, conn_tcp);
 }
 
-/** Free memory associated with conn_udp_t object and free object it self.
+/** Release UDP connection object. UDP connection object and all its vectors
+ * and queries are allocated from vectorloop arena, see @ref conn_udp_new(),
+ * and their memory is released with that arena, so nothing is freed here.
  * 
  * @param conn_udp UDP connection object to release.
  */
 void
 conn_udp_release(conn_udp_t *conn_udp)
 {
-    for (int i = 0; i < conn_udp->read_vector_count; i++) {
-        struct msghdr *mh;
-
-        /* Read vector. */
-        mh = &conn_udp->read_vector[i].msg_hdr;
-        free(mh->msg_iov);
-        free(mh->msg_name);
-        free(mh->msg_control);
-        /* Query. */
-        query_clean(&conn_udp->queries[i]);
-        /* Write vector. */
-        mh = &conn_udp->write_vector[i].msg_hdr;
-        free(mh->msg_iov);
-    }
-    free(conn_udp->read_vector);
-    free(conn_udp->queries);
-    free(conn_udp->write_vector);
-    free(conn_udp);
+    (void)conn_udp;
 }
 
 /** Free memory associated with conn_t object and free object it self.
@@ -151,8 +159,23 @@ conn_release(conn_t *conn)
         conn->fd = -1;
     }
     
-    if (conn->proto == 0) {
-        /* UDP */
+    if (conn->proto == 0 && conn->conn.udp->batches == NULL &&
+        conn->conn.udp->listener != NULL && conn->conn.udp->listener != conn) {
+        /* UDP listener socket receiving into batches of another listener,
+         * its UDP connection object is not allocated from arena.
+         */
+        mem_free(MEM_TAG_UDP, conn->conn.udp);
+    } else if (conn->proto == 0) {
+        /* UDP, batches share listener socket and arena. */
+        if (conn->conn.udp->batches != NULL) {
+            for (unsigned int i = 0; i < conn->conn.udp->batches_count; i++) {
+                mem_free(MEM_TAG_UDP, conn->conn.udp->batches[i]->conn.udp->read_socket);
+            }
+            for (unsigned int i = 1; i < conn->conn.udp->batches_count; i++) {
+                mem_free(MEM_TAG_UDP, conn->conn.udp->batches[i]);
+            }
+            mem_free(MEM_TAG_UDP, conn->conn.udp->batches);
+        }
         conn_udp_release(conn->conn.udp);
     } else {
         /* TCP */
@@ -162,23 +185,23 @@ conn_release(conn_t *conn)
         }
         
     }
-    free(conn);
+    mem_free(conn->proto == 0 ? MEM_TAG_UDP : MEM_TAG_TCP_CONNS, conn);
 }
 
 /** Create a new TCP connection object for an established TCP connection.
+ * Connection object holds no buffer set, one is attached once there is data
+ * to read, see @ref conn_tcp_bufs_attach().
  * 
  * @param fd         Socket for TCP connection.
- * @param cfg        Application configuration to get various settings from.
  * @param ip_version IP version this connection is for, 0=IPv4, 1=IPv6.
  * @param client_ip  Client IP address.
  * @param local_ip   Local IP address.
  * 
  * @return           Returns a newly allocated and initialized TCP connection
- *                   object. 
+ *                   object.
  */
 conn_t *
-conn_new_tcp(int fd, config_t *cfg, int ip_version,
-             struct sockaddr_storage *client_ip,
+conn_new_tcp(int fd, int ip_version, struct sockaddr_storage *client_ip,
              struct sockaddr_storage *local_ip)
 {
     conn_t     *conn     = NULL;
@@ -191,26 +214,55 @@ conn_new_tcp(int fd, config_t *cfg, int ip_version,
         socklen = sizeof(struct sockaddr_in6);
     }
 
-    conn_tcp = malloc(sizeof(conn_tcp_t));
+    conn_tcp = mem_aligned_alloc(MEM_TAG_TCP_CONNS, CACHE_LINE_SIZE, sizeof(conn_tcp_t));
     CHECK_MALLOC(conn_tcp);
 
     *conn_tcp = (conn_tcp_t) { };
     memcpy(&conn_tcp->client_ip, client_ip, socklen);
     memcpy(&conn_tcp->local_ip, local_ip, socklen);
 
-    conn_tcp->read_buffer = malloc(sizeof(unsigned char) * cfg->tcp_readbuff_size);
-    CHECK_MALLOC(conn_tcp->read_buffer);
-    conn_tcp->read_buffer_size = cfg->tcp_readbuff_size;
+    conn = mem_malloc(MEM_TAG_TCP_CONNS, sizeof(conn_t));
+    CHECK_MALLOC(conn);
+    *conn = (conn_t) {
+        .lc         = 1,
+        .proto      = 1,
+        .ip_version = ip_version,
+        .conn.tcp   = conn_tcp,
+        .fd         = fd,
+    };
+
+    return conn;
+}
+
+/** Reinitialize a released TCP connection object so it can be reused for a
+ * newly established TCP connection.
+ * 
+ * @param conn       TCP connection object to reuse, it must have been closed,
+ *                   removed from all queues, had its timer disarmed and its
+ *                   buffer set detached.
+ * @param fd         Socket for TCP connection.
+ * @param ip_version IP version this connection is for, 0=IPv4, 1=IPv6.
+ * @param client_ip  Client IP address.
+ * @param local_ip   Local IP address.
+ */
+void
+conn_tcp_reuse(conn_t *conn, int fd, int ip_version,
+               struct sockaddr_storage *client_ip,
+               struct sockaddr_storage *local_ip)
+{
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
 
-    conn_tcp->queries = malloc(sizeof(query_t) * cfg->tcp_conn_simultaneous_queries_count);
-    CHECK_MALLOC(conn_tcp->queries);
-    conn_tcp->queries_size = cfg->tcp_conn_simultaneous_queries_count;
-    for (int i = 0; i < conn_tcp->queries_size; i++) {
-        query_init(&conn_tcp->queries[i], cfg, 1);
+    socklen_t socklen = sizeof(struct sockaddr_in);
+
+
+    if (ip_version == 1) {
+        socklen = sizeof(struct sockaddr_in6);
     }
 
-    conn = malloc(sizeof(conn_t));
-    CHECK_MALLOC(conn);
+    *conn_tcp = (conn_tcp_t) { };
+    memcpy(&conn_tcp->client_ip, client_ip, socklen);
+    memcpy(&conn_tcp->local_ip, local_ip, socklen);
+
     *conn = (conn_t) {
         .lc         = 1,
         .proto      = 1,
@@ -218,97 +270,523 @@ conn_new_tcp(int fd, config_t *cfg, int ip_version,
         .conn.tcp   = conn_tcp,
         .fd         = fd,
     };
+}
 
-    return conn;
+/** Allocate a TCP connection buffer set: read buffer, queries with their
+ * response buffers and write I/O vector.
+ *
+ * @param cfg           Application configuration to get various settings from.
+ * @param response_pool Pool larger query response buffers are taken from, NULL
+ *                      if query response buffers are not to be increased.
+ *
+ * @return              Returns newly allocated buffer set.
+ */
+conn_tcp_bufs_t *
+conn_tcp_bufs_new(config_t *cfg, buf_pool_t *response_pool)
+{
+    conn_tcp_bufs_t *bufs = mem_malloc(MEM_TAG_TCP_BUFS, sizeof(conn_tcp_bufs_t));
+
+    CHECK_MALLOC(bufs);
+    *bufs = (conn_tcp_bufs_t) { };
+
+    bufs->read_buffer = mem_malloc(MEM_TAG_TCP_BUFS,
+                                   sizeof(unsigned char) * cfg->tcp_readbuff_size);
+    CHECK_MALLOC(bufs->read_buffer);
+    bufs->read_buffer_size = cfg->tcp_readbuff_size;
+
+    bufs->queries = mem_aligned_alloc(MEM_TAG_TCP_BUFS, CACHE_LINE_SIZE,
+                                      sizeof(query_t) * cfg->tcp_conn_simultaneous_queries_count);
+    CHECK_MALLOC(bufs->queries);
+    bufs->queries_size = cfg->tcp_conn_simultaneous_queries_count;
+    for (size_t i = 0; i < bufs->queries_size; i++) {
+        query_init(&bufs->queries[i], cfg, 1);
+        bufs->queries[i].response_pool = response_pool;
+    }
+    bufs->write_iov = mem_malloc(MEM_TAG_TCP_BUFS, sizeof(struct iovec) * bufs->queries_size);
+    CHECK_MALLOC(bufs->write_iov);
+
+    return bufs;
+}
+
+/** Free TCP connection buffer set.
+ *
+ * @param bufs Buffer set to free, may be NULL.
+ */
+void
+conn_tcp_bufs_free(conn_tcp_bufs_t *bufs)
+{
+    if (bufs == NULL) {
+        return;
+    }
+    mem_free(MEM_TAG_TCP_BUFS, bufs->read_buffer);
+    for (size_t i = 0; i < bufs->queries_size; i++) {
+        query_clean(&bufs->queries[i]);
+    }
+    mem_free(MEM_TAG_TCP_BUFS, bufs->queries);
+    mem_free(MEM_TAG_TCP_BUFS, bufs->write_iov);
+    mem_free(MEM_TAG_TCP_BUFS, bufs);
+}
+
+/** Attach buffer set to TCP connection which holds none.
+ *
+ * @param conn_tcp TCP connection.
+ * @param bufs     Buffer set, its queries must be reset.
+ */
+void
+conn_tcp_bufs_attach(conn_tcp_t *conn_tcp, conn_tcp_bufs_t *bufs)
+{
+    conn_tcp->bufs               = bufs;
+    conn_tcp->read_buffer        = bufs->read_buffer;
+    conn_tcp->read_buffer_size   = bufs->read_buffer_size;
+    conn_tcp->read_buffer_offset = 0;
+    conn_tcp->read_buffer_len    = 0;
+    conn_tcp->queries            = bufs->queries;
+    conn_tcp->queries_size       = bufs->queries_size;
+    conn_tcp->queries_count      = 0;
+    conn_tcp->write_iov          = bufs->write_iov;
+}
+
+/** Detach buffer set from TCP connection. Queries connection has in flight
+ * are reset, and larger response buffers they hold are returned to their
+ * pool, so buffer set can be attached to any connection. Data buffered in
+ * read buffer is discarded.
+ *
+ * @param conn_tcp TCP connection.
+ *
+ * @return         Returns detached buffer set, NULL if connection held none.
+ */
+conn_tcp_bufs_t *
+conn_tcp_bufs_detach(conn_tcp_t *conn_tcp)
+{
+    conn_tcp_bufs_t *bufs = conn_tcp->bufs;
+
+    if (bufs == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < conn_tcp->queries_count; i++) {
+        query_tcp_response_buffer_release(&bufs->queries[i]);
+        query_reset(&bufs->queries[i]);
+    }
+
+    conn_tcp->bufs               = NULL;
+    conn_tcp->read_buffer        = NULL;
+    conn_tcp->read_buffer_offset = 0;
+    conn_tcp->read_buffer_len    = 0;
+    conn_tcp->queries            = NULL;
+    conn_tcp->queries_count      = 0;
+    conn_tcp->write_iov          = NULL;
+
+    return bufs;
+}
+
+/** Scale TCP idle (keepalive) timeout down as vectorloop fills up with TCP
+ * connections. Timeout is kept as is until number of connections reaches
+ * shrink_start percent of maximum, from there it drops linearly down to
+ * @ref TCP_KEEPALIVE_MIN once maximum is reached. Clients told a shorter
+ * timeout (EDNS tcp-keepalive, RFC 7828) close idle connections sooner when
+ * server is busy, and keep them open for reuse when it is not.
+ *
+ * @param keepalive    Configured idle timeout, in milliseconds.
+ * @param conns_active Number of active TCP connections.
+ * @param conns_max    Maximum number of TCP connections.
+ * @param shrink_start Percent of maximum from which timeout shrinks, 100
+ *                     keeps timeout as is.
+ *
+ * @return             Returns idle timeout, in milliseconds.
+ */
+size_t
+conn_tcp_keepalive_scale(size_t keepalive, size_t conns_active, size_t conns_max,
+                         size_t shrink_start)
+{
+    size_t start = conns_max / 100 * shrink_start + conns_max % 100 * shrink_start / 100;
+
+    if (conns_active <= start || start >= conns_max || keepalive <= TCP_KEEPALIVE_MIN) {
+        return keepalive;
+    }
+    if (conns_active >= conns_max) {
+        return TCP_KEEPALIVE_MIN;
+    }
+    return TCP_KEEPALIVE_MIN + (size_t)((double)(keepalive - TCP_KEEPALIVE_MIN) *
+                                        (conns_max - conns_active) / (conns_max - start));
 }
 
-/** Create a new UDP connection object
+/** Size of arena space @ref conn_udp_new() allocates for a UDP connection
+ * object.
+ *
+ * @param cfg Application configuration to get various settings from.
+ *
+ * @return    Returns number of bytes.
+ */
+size_t
+conn_udp_arena_size(config_t *cfg)
+{
+    size_t len  = cfg->udp_conn_vector_len;
+    size_t size = 0;
+
+    size += ARENA_OBJ_SIZE(sizeof(conn_udp_t));
+    size += ARENA_OBJ_SIZE(sizeof(struct mmsghdr) * len) * 2;
+    size += ARENA_OBJ_SIZE(sizeof(uint16_t) * len);
+    size += ARENA_OBJ_SIZE(sizeof(uint16_t) * (len + 1));
+    size += ARENA_OBJ_SIZE(sizeof(struct iovec) * len) * 2;
+    size += ARENA_OBJ_SIZE(sizeof(struct sockaddr_storage) * len);
+    size += ARENA_OBJ_SIZE(sizeof(unsigned char) * UDP_MSG_CONTROL_LEN * len);
+    if (cfg->udp_gso) {
+        size += ARENA_OBJ_SIZE(sizeof(unsigned char) * UDP_GSO_CONTROL_LEN * len);
+    }
+    size += ARENA_OBJ_SIZE(sizeof(query_t) * len);
+    size += query_arena_size() * len;
+
+    return size;
+}
+
+/** Create a new UDP connection object. Object, with its vectors and queries,
+ * is allocated from an arena in one contiguous layout: vectors vectorloop
+ * walks on every batch first, followed by queries and then query buffers.
  *
  * @param cfg    Application configuration to get various settings from.
  * @param family IP family: AF_INET or AF_INET6.
+ * @param arena  Arena to allocate from, it must have at least
+ *               @ref conn_udp_arena_size() bytes left.
  * 
  * @return       Returns a newly allocated and initialized UDP connection
  *               object.
  */
 conn_udp_t *
-conn_udp_new(config_t *cfg, int family)
+conn_udp_new(config_t *cfg, int family, arena_t *arena)
 {
-    conn_udp_t *conn_udp = NULL;
+    conn_udp_t    *conn_udp    = NULL;
+    struct iovec  *read_iov    = NULL;
+    unsigned char *msg_name    = NULL;
+    unsigned char *msg_control = NULL;
+    size_t         len         = cfg->udp_conn_vector_len;
 
     /* Allocate connection UDP object. */
-    conn_udp = malloc(sizeof(conn_udp_t));
+    conn_udp = arena_alloc(arena, sizeof(conn_udp_t));
     CHECK_MALLOC(conn_udp);
 
     /* Initialize connection UDP object. */
     *conn_udp = (conn_udp_t) {
-        .vector_len = cfg->udp_conn_vector_len,
+        .vector_len        = cfg->udp_conn_vector_len,
+        .vector_len_active = cfg->udp_conn_vector_len,
+        .vector_len_max    = cfg->udp_conn_vector_len,
+        .vector_len_min    = cfg->udp_conn_vector_len,
     };
+    if (cfg->udp_conn_vector_len_min > 0) {
+        conn_udp->vector_len_min = cfg->udp_conn_vector_len_min;
+    }
 
     /* Allocate read & write vectors. */
-    conn_udp->read_vector = malloc(sizeof(struct mmsghdr) * cfg->udp_conn_vector_len);
+    conn_udp->read_vector = arena_alloc(arena, sizeof(struct mmsghdr) * len);
     CHECK_MALLOC(conn_udp->read_vector);
-    conn_udp->queries = malloc(sizeof(query_t) * cfg->udp_conn_vector_len);
-    CHECK_MALLOC(conn_udp->queries);
-    conn_udp->write_vector = malloc(sizeof(struct mmsghdr) * cfg->udp_conn_vector_len);
+    conn_udp->write_vector = arena_alloc(arena, sizeof(struct mmsghdr) * len);
     CHECK_MALLOC(conn_udp->write_vector);
+    conn_udp->query_index = arena_alloc(arena, sizeof(uint16_t) * len);
+    CHECK_MALLOC(conn_udp->query_index);
+    conn_udp->write_query_start = arena_alloc(arena, sizeof(uint16_t) * (len + 1));
+    CHECK_MALLOC(conn_udp->write_query_start);
+    read_iov = arena_alloc(arena, sizeof(struct iovec) * len);
+    CHECK_MALLOC(read_iov);
+    conn_udp->write_iov = arena_alloc(arena, sizeof(struct iovec) * len);
+    CHECK_MALLOC(conn_udp->write_iov);
+    msg_name = arena_alloc(arena, sizeof(struct sockaddr_storage) * len);
+    CHECK_MALLOC(msg_name);
+    msg_control = arena_alloc(arena, sizeof(unsigned char) * UDP_MSG_CONTROL_LEN * len);
+    CHECK_MALLOC(msg_control);
+    if (cfg->udp_gso) {
+        conn_udp->write_control = arena_alloc(arena, sizeof(unsigned char) *
+                                              UDP_GSO_CONTROL_LEN * len);
+        CHECK_MALLOC(conn_udp->write_control);
+    }
+    conn_udp->queries = arena_alloc(arena, sizeof(query_t) * len);
+    CHECK_MALLOC(conn_udp->queries);
 
-    for (int i = 0; i < cfg->udp_conn_vector_len; i++) {
+    for (size_t i = 0; i < len; i++) {
         /* Initialize query structures. */
-        query_init(&conn_udp->queries[i], cfg, 0);
+        query_init_arena(&conn_udp->queries[i], arena);
 
-        /* Allocate read vector structures. */
+        /* Set up read vector structures. */
         struct msghdr *mh = &conn_udp->read_vector[i].msg_hdr;
 
-        struct iovec *iov = malloc(sizeof(struct iovec));
-        CHECK_MALLOC(iov);
-        iov->iov_base = conn_udp->queries[i].request_buffer;
-        iov->iov_len = conn_udp->queries[i].request_buffer_size;;
-        mh->msg_iov = iov;
-        mh->msg_iovlen = 1;
+        read_iov[i].iov_base = conn_udp->queries[i].request_buffer;
+        read_iov[i].iov_len  = conn_udp->queries[i].request_buffer_size;
+        mh->msg_iov          = &read_iov[i];
+        mh->msg_iovlen       = 1;
 
-        mh->msg_name = malloc(sizeof(struct sockaddr_storage));
-        CHECK_MALLOC(mh->msg_name);
+        mh->msg_name    = msg_name + sizeof(struct sockaddr_storage) * i;
         mh->msg_namelen = sizeof(struct sockaddr_storage);
 
-        if (family == AF_INET) {
-            mh->msg_control = malloc(sizeof(unsigned char) * UDP_MSG_CONTROL_LEN);
-            CHECK_MALLOC(mh->msg_control);
-            mh->msg_controllen = UDP_MSG_CONTROL_LEN;
-        } else {
-            mh->msg_control = malloc(sizeof(unsigned char) * UDP_MSG_CONTROL_LEN);
-            CHECK_MALLOC(mh->msg_control);
-            mh->msg_controllen = UDP_MSG_CONTROL_LEN;
-        }
-
+        mh->msg_control    = msg_control + UDP_MSG_CONTROL_LEN * i;
+        mh->msg_controllen = UDP_MSG_CONTROL_LEN;
 
-        /* Allocate write vector structures. */
+        /* Set up write vector structures. */
         mh = &conn_udp->write_vector[i].msg_hdr;
 
-        iov = malloc(sizeof(struct iovec));
-        CHECK_MALLOC(iov);
-        mh->msg_iov = iov;
+        mh->msg_iov = &conn_udp->write_iov[i];
         mh->msg_iovlen = 1;
     }
 
     return conn_udp;
 }
 
+/** Create batches of UDP listener, see @ref conn_udp_t. Listener is first
+ * batch, rest are connection objects sharing listener socket, each with UDP
+ * connection object of its own allocated from arena.
+ *
+ * @param listener UDP listener, with its UDP connection object.
+ * @param cfg      Application configuration to get various settings from.
+ * @param count    Number of batches, including listener.
+ * @param arena    Arena to allocate from, it must have at least
+ *                 @ref conn_udp_arena_size() bytes left for each batch
+ *                 other than listener.
+ */
+void
+conn_udp_batches_new(conn_t *listener, config_t *cfg, unsigned int count,
+                     arena_t *arena)
+{
+    conn_udp_t *conn_udp = listener->conn.udp;
+    int         family   = listener->ip_version ? AF_INET6 : AF_INET;
+
+    conn_udp->batches = mem_malloc(MEM_TAG_UDP, sizeof(conn_t *) * count);
+    CHECK_MALLOC(conn_udp->batches);
+    conn_udp->batches[0]    = listener;
+    conn_udp->batches_count = count;
+    conn_udp->batches_free  = count;
+    conn_udp->listener      = listener;
+
+    for (unsigned int i = 1; i < count; i++) {
+        conn_t *batch = mem_malloc(MEM_TAG_UDP, sizeof(conn_t));
+        CHECK_MALLOC(batch);
+
+        *batch = (conn_t) {
+            .fd         = listener->fd,
+            .lc         = 0,
+            .proto      = 0,
+            .ip_version = listener->ip_version,
+            .xdp        = listener->xdp,
+            .replay     = listener->replay,
+            .conn.udp   = conn_udp_new(cfg, family, arena),
+        };
+        batch->conn.udp->listener = listener;
+        conn_udp->batches[i]      = batch;
+    }
+}
+
+/** Get UDP listener batch free to receive into.
+ *
+ * @param listener UDP listener.
+ *
+ * @return         Returns first free batch, NULL if all batches hold
+ *                 queries.
+ */
+conn_t *
+conn_udp_batch_free(conn_t *listener)
+{
+    conn_udp_t *conn_udp = listener->conn.udp;
+
+    if (conn_udp->batches_free == 0) {
+        return NULL;
+    }
+    for (unsigned int i = 0; i < conn_udp->batches_count; i++) {
+        if (!conn_udp->batches[i]->conn.udp->busy) {
+            return conn_udp->batches[i];
+        }
+    }
+    return NULL;
+}
+
+/** Mark UDP listener batch as holding received queries.
+ *
+ * @param batch Free batch queries were received into.
+ */
+void
+conn_udp_batch_hold(conn_t *batch)
+{
+    batch->conn.udp->busy = 1;
+    batch->conn.udp->listener->conn.udp->batches_free--;
+}
+
+/** Mark UDP listener batch as free to receive into, once its queries are
+ * logged.
+ *
+ * @param batch Batch holding queries.
+ *
+ * @return      Returns listener if it was waiting for a free batch, to be
+ *              queued to receive again, otherwise NULL.
+ */
+conn_t *
+conn_udp_batch_release(conn_t *batch)
+{
+    conn_t     *listener = batch->conn.udp->listener;
+    conn_udp_t *conn_udp = listener->conn.udp;
+
+    batch->conn.udp->busy = 0;
+    conn_udp->batches_free++;
+    if (conn_udp->waiting_for_batch) {
+        conn_udp->waiting_for_batch = 0;
+        return listener;
+    }
+    return NULL;
+}
+
 /** Reset UDP connection vectors so the can be reused for next iteration of
- * read/resolve/send of DNS queries.
+ * read/resolve/send of DNS queries. Only entries read into by previous read,
+ * first read_vector_count of them, are reset, rest were not touched since
+ * they were last reset.
  * 
  * @param conn_udp UDP connection to reset vectors for.
  */
 void
 conn_udp_vectors_reset(conn_udp_t *conn_udp)
 {
-    for (int i = 0; i < conn_udp->vector_len; i++) {
+    for (unsigned int i = 0; i < conn_udp->read_vector_count; i++) {
         conn_udp->read_vector[i].msg_hdr.msg_controllen = UDP_MSG_CONTROL_LEN;
         conn_udp->read_vector[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_storage);
-        conn_udp->read_vector_count                     = 0;
-        conn_udp->write_vector_count                    = 0;
-        conn_udp->write_vector_write_index              = 0;
         query_reset(&conn_udp->queries[i]);
     }
+    conn_udp->read_vector_count        = 0;
+    conn_udp->query_index_count        = 0;
+    conn_udp->priority_count           = 0;
+    conn_udp->write_vector_count       = 0;
+    conn_udp->write_vector_write_index = 0;
+}
+
+/** Move priority lane queries ahead of rest in query index column, see
+ * @ref query_t.priority. Partition is stable, queries keep their order
+ * within each lane, and done in place as batch holds few priority queries.
+ *
+ * @param queries Queries index column indexes into.
+ * @param index   Query index column.
+ * @param count   Number of entries in index column.
+ *
+ * @return        Returns number of priority queries, now at start of index
+ *                column.
+ */
+unsigned int
+conn_udp_priority_first(query_t *queries, uint16_t *index, unsigned int count)
+{
+    unsigned int p = 0;
+
+    for (unsigned int j = 0; j < count; j++) {
+        uint16_t i = index[j];
+
+        if (!queries[i].priority) {
+            continue;
+        }
+        if (j > p) {
+            memmove(&index[p + 1], &index[p], (j - p) * sizeof(uint16_t));
+            index[p] = i;
+        }
+        p++;
+    }
+
+    return p;
+}
+
+/** Raise UDP listener socket receive buffer size after kernel dropped
+ * datagrams for lack of it. Size is doubled, up to max, at most once every
+ * @ref UDP_CONN_RECVBUFF_AUTOTUNE_INTERVAL_MS, so a burst of drops raises it
+ * once and the raise has time to take effect.
+ *
+ * @param listener UDP listener datagrams were dropped on.
+ * @param max      Size to raise receive buffer up to, 0 disables raising it.
+ * @param now_ms   Current time in milliseconds.
+ *
+ * @return         Returns new receive buffer size if it was raised, 0 if it
+ *                 was not.
+ */
+size_t
+conn_udp_recvbuff_autotune(conn_t *listener, size_t max, uint64_t now_ms)
+{
+    conn_udp_t *conn_udp = listener->conn.udp;
+    size_t      size     = conn_udp->recvbuff_size * 2;
+    int         opt      = 0;
+
+    if (max == 0 || conn_udp->recvbuff_size >= max ||
+        (conn_udp->recvbuff_tuned_ms != 0 &&
+         now_ms - conn_udp->recvbuff_tuned_ms < UDP_CONN_RECVBUFF_AUTOTUNE_INTERVAL_MS)) {
+        return 0;
+    }
+    conn_udp->recvbuff_tuned_ms = now_ms;
+    if (size > max) {
+        size = max;
+    }
+    opt = size;
+    if (setsockopt(listener->fd, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt)) != 0) {
+        return 0;
+    }
+    conn_udp->recvbuff_size = size;
+
+    return size;
+}
+
+/** Adapt active vector length of UDP connection to number of datagrams a
+ * read returned. Active length is doubled, up to vector_len_max, when read filled
+ * the whole vector, and halved, down to vector_len_min, after
+ * @ref UDP_CONN_VECTOR_SHRINK_READS consecutive reads filled less than half
+ * of it.
+ *
+ * @param conn_udp UDP connection read from.
+ * @param vlen     Vector length read was made with, may be less than active
+ *                 length if it was limited by read budget.
+ * @param received Number of datagrams read returned.
+ */
+void
+conn_udp_vector_len_adapt(conn_udp_t *conn_udp, unsigned int vlen,
+                          unsigned int received)
+{
+    unsigned int active = conn_udp->vector_len_active;
+
+    if (received >= vlen) {
+        conn_udp->vector_low_reads = 0;
+        if (vlen == active && active < conn_udp->vector_len_max) {
+            active *= 2;
+            if (active > conn_udp->vector_len_max) {
+                active = conn_udp->vector_len_max;
+            }
+            conn_udp->vector_len_active = active;
+        }
+    } else if (received * 2 < active) {
+        if (++conn_udp->vector_low_reads >= UDP_CONN_VECTOR_SHRINK_READS) {
+            conn_udp->vector_low_reads = 0;
+            active /= 2;
+            if (active < conn_udp->vector_len_min) {
+                active = conn_udp->vector_len_min;
+            }
+            conn_udp->vector_len_active = active;
+        }
+    } else {
+        conn_udp->vector_low_reads = 0;
+    }
+}
+
+/** Set bounds active vector length of UDP connection is adapted within, on
+ * configuration reload. Vectors are allocated at startup, so maximum is
+ * limited to vector_len UDP connection was created with. Active length is
+ * clamped to new bounds.
+ *
+ * @param conn_udp UDP connection to set bounds for.
+ * @param len      Maximum active vector length.
+ * @param len_min  Minimum active vector length, 0 disables adapting.
+ */
+void
+conn_udp_vector_len_set(conn_udp_t *conn_udp, unsigned int len,
+                        unsigned int len_min)
+{
+    if (len > conn_udp->vector_len) {
+        len = conn_udp->vector_len;
+    }
+    if (len_min == 0 || len_min > len) {
+        len_min = len;
+    }
+    conn_udp->vector_len_max = len;
+    conn_udp->vector_len_min = len_min;
+
+    if (conn_udp->vector_len_active > len) {
+        conn_udp->vector_len_active = len;
+    } else if (conn_udp->vector_len_active < len_min) {
+        conn_udp->vector_len_active = len_min;
+    }
+    conn_udp->vector_low_reads = 0;
 }
 
 /** Start a TCP or UDP DNS listener.
@@ -324,13 +802,18 @@ conn_udp_vectors_reset(conn_udp_t *conn_udp)
  *                 -tcp_listener_pending_conns_max,
  *                 - udp_socket_recvbuff_size,
  *                 - udp_socket_sendbuff_size,
- *                 - udp_listener_port.
+ *                 - udp_listener_port,
+ *                 - dot_listener_port.
  * @param family   IP family to start a listener for, valid options are:
  *                 - AF_INET,
  *                 - AF_INET6.
  * @param protocol Protocol to start listener for, valid options are:
  *                 - IPPROTO_TCP,
- *                 - IPPROTO_UDP.
+ *                 - IPPROTO_UDP,
+ *                 - LISTENER_PROTO_DOT,
+ *                 - LISTENER_PROTO_UDP_DUAL, family must be AF_INET6.
+ * @param addr     Address to bind listener to, its family must be family, or
+ *                 NULL to bind to any address.
  * @param err_no   Where to store value of errno if error was encountered.
  * 
  * @return         On success returns a socket descriptor for started listener.
@@ -346,10 +829,14 @@ conn_udp_vectors_reset(conn_udp_t *conn_udp)
  *                     LISTENER_ERR_SOCKET_OPT_IP_PKTINFO       = -7,
  *                     LISTENER_ERR_SOCKET_OPT_IPV6_V6ONLY      = -8,
  *                     LISTENER_ERR_SOCKET_OPT_IPV6_RECVPKTINFO = -9,
+ *                     ...
+ *                     LISTENER_ERR_SOCKET_OPT_RXQ_OVFL         = -15,
+ *                     LISTENER_ERR_SOCKET_OPT_TIMESTAMPNS      = -16,
  *                 } listener_start_error_t;
  */
 static int
-listener_start(config_t *cfg, int family, int protocol, int *err_no)
+listener_start(config_t *cfg, int family, int protocol, const utl_net_t *addr,
+               int *err_no)
 {
     int ret           = 0;
     int fd            = -1;
@@ -357,18 +844,25 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
     int socket_type   = 0;
     int socket_rcvbuf = 0;
     int socket_sndbuf = 0;
+    bool dual_stack   = protocol == LISTENER_PROTO_UDP_DUAL;
     uint16_t port     = 0;
 
     struct sockaddr_storage  ss = {};
     struct sockaddr_in      *sin  = (struct sockaddr_in *)&ss;
     struct sockaddr_in6     *sin6 = (struct sockaddr_in6 *)&ss;
 
-    if (protocol == IPPROTO_TCP) {
+    if (protocol == IPPROTO_TCP || protocol == LISTENER_PROTO_DOT) {
         socket_type = SOCK_STREAM | SOCK_NONBLOCK;
         socket_rcvbuf = cfg->tcp_readbuff_size;
         socket_sndbuf = cfg->tcp_writebuff_size;
         port          = cfg->tcp_listener_port;
-    } else if (protocol == IPPROTO_UDP) {
+        if (protocol == LISTENER_PROTO_DOT) {
+            /* DNS over TLS listener is a TCP listener on its own port. */
+            port = cfg->dot_listener_port;
+        }
+        protocol = IPPROTO_TCP;
+    } else if (protocol == IPPROTO_UDP || protocol == LISTENER_PROTO_UDP_DUAL) {
+        protocol    = IPPROTO_UDP;
         socket_type = SOCK_DGRAM | SOCK_NONBLOCK;
         socket_rcvbuf = cfg->udp_socket_recvbuff_size;
         socket_sndbuf = cfg->udp_socket_sendbuff_size;
@@ -398,6 +892,78 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
         return LISTENER_ERR_SOCKET_OPT_SNDBUF;
     }
 
+    /* Set socket option SO_BUSY_POLL on UDP listeners if configured. */
+    if (protocol == IPPROTO_UDP && cfg->udp_socket_busy_poll > 0) {
+        opt = cfg->udp_socket_busy_poll;
+        ret = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_BUSY_POLL;
+        }
+    }
+
+    /* Set socket option SO_RXQ_OVFL on UDP listeners, so received datagrams
+     * carry count of datagrams socket dropped for lack of receive buffer.
+     */
+    if (protocol == IPPROTO_UDP) {
+        opt = 1;
+        ret = setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_RXQ_OVFL;
+        }
+    }
+
+    /* Set socket option SO_TIMESTAMPNS if configured, received data carries
+     * kernel receive timestamp. Connections accepted inherit it.
+     */
+    if (cfg->listener_rx_timestamps) {
+        opt = 1;
+        ret = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_TIMESTAMPNS;
+        }
+    }
+
+    /* Set socket option TCP_FASTOPEN on TCP listeners if configured. */
+    if (protocol == IPPROTO_TCP && cfg->tcp_listener_fastopen > 0) {
+        opt = cfg->tcp_listener_fastopen;
+        ret = setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_TCP_FASTOPEN;
+        }
+    }
+
+    /* Set socket option TCP_DEFER_ACCEPT on TCP listeners if configured. */
+    if (protocol == IPPROTO_TCP && cfg->tcp_listener_defer_accept > 0) {
+        opt = cfg->tcp_listener_defer_accept;
+        ret = setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_TCP_DEFER_ACCEPT;
+        }
+    }
+
+    /* Set socket option TCP_NOTSENT_LOWAT on TCP listeners if configured,
+     * accepted connections inherit it.
+     */
+    if (protocol == IPPROTO_TCP && cfg->tcp_listener_notsent_lowat > 0) {
+        opt = cfg->tcp_listener_notsent_lowat;
+        ret = setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &opt, sizeof(opt));
+        if (ret != 0) {
+            *err_no = errno;
+            close(fd);
+            return LISTENER_ERR_SOCKET_OPT_TCP_NOTSENT_LOWAT;
+        }
+    }
+
     /* Set socket option SO_REUSEADDR. */
     opt = 1;
     ret = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
@@ -425,8 +991,11 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
         }
     } else {
         /* Set socket option IPV6_V6ONLY to receive IPv6 UDP packets only,
-         * and not get IPv4 mapped into IPv6 packets.
+         * and not get IPv4 mapped into IPv6 packets. Dual stack UDP listener
+         * gets both, IPv4 packet info then comes as IPV6_PKTINFO with
+         * IPv4-mapped address.
          */
+        opt = !dual_stack;
         ret = setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt));
         if (ret != 0) {
             *err_no = errno;
@@ -445,18 +1014,24 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
         }
     }
 
-    /* Populate socket address to be any IP address. */
+    /* Populate socket address to be address given, or any IP address. */
     socklen_t slen = sizeof(struct sockaddr_in6);
     if (family == AF_INET) {
         slen = sizeof(struct sockaddr_in);
         sin->sin_family = AF_INET;
         sin->sin_addr.s_addr = INADDR_ANY;
         sin->sin_port = htons(port);
+        if (addr != NULL) {
+            memcpy(&sin->sin_addr, addr->addr, 4);
+        }
     } else {
         slen = sizeof(struct sockaddr_in6);
         sin6->sin6_family = AF_INET6;
         sin6->sin6_addr = in6addr_any;
         sin6->sin6_port = htons(port);
+        if (addr != NULL) {
+            memcpy(&sin6->sin6_addr, addr->addr, 16);
+        }
     }
 
     /* Bind socket. */
@@ -483,17 +1058,27 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
 /** Provision a new TCP or UDP listener and return the corresponding connection
  *  conn_t object.
  * 
- * Listener is started and associated with new connection object. New connection
- * object is initialized meaning it has all necessary buffers allocated.
+ * Listener is started, or listener socket given is used, and associated with
+ * new connection object. New connection object is initialized meaning it has
+ * all necessary buffers allocated.
  * 
  * @param cfg          Configuration object that has settings:
  *                     - udp_conn_vector_len,
+ *                     - udp_listener_batches,
  * @param family       IP family to start a listener for, valid options are:
  *                     - AF_INET,
  *                     - AF_INET6.
  * @param protocol     Protocol to start listener for, valid options are:
  *                     - IPPROTO_TCP,
- *                     - IPPROTO_UDP.
+ *                     - IPPROTO_UDP,
+ *                     - LISTENER_PROTO_DOT, TCP listener connections
+ *                       accepted on are DNS over TLS,
+ *                     - LISTENER_PROTO_UDP_DUAL, IPv6 UDP listener that
+ *                       receives IPv4 datagrams too.
+ * @param arena        Arena UDP listener batches, their vectors and queries,
+ *                     are allocated from, not used for TCP.
+ * @param fd           Listener socket to use, e.g. one inherited from process
+ *                     being upgraded, or -1 to start a new listener.
  * @param err_buf      Buffer where to store error message if error was encountered.
  *                     If NULL no message is stored.
  * @param err_buf_len  Length of error buffer.
@@ -505,10 +1090,11 @@ listener_start(config_t *cfg, int family, int protocol, int *err_no)
  */
 conn_t *
 conn_listener_provision(config_t *cfg, int family, int protocol,
-                        char *err_buf, size_t err_buf_len)
+                        arena_t *arena, int fd, char *err_buf, size_t err_buf_len)
 {
     char *protp_str_udp = "UDP";
     char *protp_str_tcp = "TCP";
+    char *protp_str_dot = "DoT";
     char *protp_str     = protp_str_udp;
     char *ip4_str       = "IPv4";
     char *ip6_str       = "IPv6";
@@ -520,16 +1106,24 @@ conn_listener_provision(config_t *cfg, int family, int protocol,
     if (family != AF_INET && family != AF_INET6) {
         assert(0);
     }
-    if (protocol != IPPROTO_TCP && protocol != IPPROTO_UDP) {
+    if (protocol != IPPROTO_TCP && protocol != IPPROTO_UDP &&
+        protocol != LISTENER_PROTO_DOT && protocol != LISTENER_PROTO_UDP_DUAL) {
         assert(0);
     }
 
     /* Start listener. */
-    int fd = listener_start(cfg, family, protocol, &err_no);
+    if (fd < 0) {
+        fd = listener_start(cfg, family, protocol, NULL, &err_no);
+    }
+    if (protocol == LISTENER_PROTO_UDP_DUAL) {
+        protocol = IPPROTO_UDP;
+    }
 
     if (fd < 0) {
         if (protocol == IPPROTO_TCP) {
             protp_str = protp_str_tcp;
+        } else if (protocol == LISTENER_PROTO_DOT) {
+            protp_str = protp_str_dot;
         }
         if (family == AF_INET6) {
             ip_str = ip6_str;
@@ -543,7 +1137,8 @@ conn_listener_provision(config_t *cfg, int family, int protocol,
     }
 
     /* Initialize connection object. */
-    conn_t *conn = malloc(sizeof(conn_t));
+    conn_t *conn = mem_malloc(protocol == IPPROTO_UDP ? MEM_TAG_UDP : MEM_TAG_TCP_CONNS,
+                              sizeof(conn_t));
     CHECK_MALLOC(conn);
     *conn = (conn_t) {
         .fd = fd,
@@ -557,15 +1152,106 @@ conn_listener_provision(config_t *cfg, int family, int protocol,
 
     if (protocol == IPPROTO_UDP) {
         conn->proto = 0;
-        conn->conn.udp = conn_udp_new(cfg, family);
-    } else if (protocol == IPPROTO_TCP) {
+        conn->conn.udp = conn_udp_new(cfg, family, arena);
+        conn->conn.udp->recvbuff_size = cfg->udp_socket_recvbuff_size;
+        conn_udp_batches_new(conn, cfg, cfg->udp_listener_batches, arena);
+    } else {
         conn->proto = 1;
+        conn->tls   = protocol == LISTENER_PROTO_DOT;
         /* TCP listener does not have a conn->conn.tcp section. */
     }
 
     return conn;
 }
 
+/** Provision a new UDP listener bound to an address of configuration setting
+ * "udp_listener_addresses", and return the corresponding connection conn_t
+ * object.
+ *
+ * First listener of an IP family is provisioned as a regular UDP listener,
+ * with batches, whose batches are filled from sockets of all addresses of
+ * that family, see @ref conn_udp_t.read_socket. Listener of every other
+ * address of that family is a socket only, it receives into batches of first
+ * listener, so listening on another address costs a socket and a connection
+ * object, and not another set of batches.
+ *
+ * @param cfg         Configuration object that has settings:
+ *                    - udp_listener_addresses,
+ *                    - udp_conn_vector_len,
+ *                    - udp_listener_batches.
+ * @param addr_index  Index in "udp_listener_addresses" of address to bind
+ *                    listener to.
+ * @param listener    Listener of first address of same IP family, whose
+ *                    batches new listener receives into, or NULL to
+ *                    provision first listener.
+ * @param arena       Arena batches of first listener are allocated from.
+ * @param err_buf     Buffer where to store error message if error was
+ *                    encountered. If NULL no message is stored.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            On success returns a newly allocated and active
+ *                    connection object.
+ *                    On error returns NULL and message is populated into
+ *                    error buffer.
+ */
+conn_t *
+conn_listener_provision_addr(config_t *cfg, size_t addr_index, conn_t *listener,
+                             arena_t *arena, char *err_buf, size_t err_buf_len)
+{
+    utl_net_t  *addr     = &cfg->udp_listener_addresses[addr_index];
+    conn_t     *conn     = NULL;
+    conn_udp_t *conn_udp = NULL;
+    char        addr_str[INET6_ADDRSTRLEN];
+    int         err_no   = 0;
+    int         fd       = -1;
+
+    assert(addr_index < cfg->udp_listener_addresses_count);
+
+    fd = listener_start(cfg, addr->family, IPPROTO_UDP, addr, &err_no);
+    if (fd < 0) {
+        if (err_buf != NULL) {
+            inet_ntop(addr->family, addr->addr, addr_str, sizeof(addr_str));
+            snprintf(err_buf, err_buf_len, "Could not start UDP listener on %s, %s: %s",
+                     addr_str, listener_err_to_str(fd), strerror(err_no));
+        }
+        return NULL;
+    }
+
+    if (listener == NULL) {
+        conn = conn_listener_provision(cfg, addr->family, IPPROTO_UDP, arena, fd,
+                                       err_buf, err_buf_len);
+        conn_udp = conn->conn.udp;
+        for (unsigned int i = 0; i < conn_udp->batches_count; i++) {
+            conn_udp_t *batch = conn_udp->batches[i]->conn.udp;
+
+            batch->read_socket = mem_malloc(MEM_TAG_UDP, sizeof(conn_t *) * batch->vector_len);
+            CHECK_MALLOC(batch->read_socket);
+        }
+        conn_udp->addr_index = addr_index;
+        return conn;
+    }
+
+    /* Socket only listener, shares batches of listener given. */
+    conn = mem_malloc(MEM_TAG_UDP, sizeof(conn_t));
+    CHECK_MALLOC(conn);
+    conn_udp = mem_malloc(MEM_TAG_UDP, sizeof(conn_udp_t));
+    CHECK_MALLOC(conn_udp);
+    *conn_udp = (conn_udp_t) {
+        .listener      = listener,
+        .recvbuff_size = cfg->udp_socket_recvbuff_size,
+        .addr_index    = addr_index,
+    };
+    *conn = (conn_t) {
+        .fd         = fd,
+        .lc         = 0,
+        .proto      = 0,
+        .ip_version = listener->ip_version,
+        .conn.udp   = conn_udp,
+    };
+
+    return conn;
+}
+
 /** Add (enqueue) a connection object to read fifo queue.
  * 
  * @param queue Read queue to add connection object to.
@@ -576,6 +1262,7 @@ conn_fifo_enqueue_read(conn_fifo_queue_t *queue, conn_t *conn)
 {
     if (conn->in_read_queue == 0) {
         conn->read_q_handle = NULL;
+        conn->read_q_prev   = queue->tail;
         if (queue->head == NULL) {
             queue->head = queue->tail = conn;
         } else {
@@ -583,6 +1270,7 @@ conn_fifo_enqueue_read(conn_fifo_queue_t *queue, conn_t *conn)
             queue->tail = conn;
         }
         conn->in_read_queue = 1;
+        queue->len++;
     }
 }
 
@@ -602,10 +1290,12 @@ conn_fifo_dequeue_read(conn_fifo_queue_t *queue)
     if (queue->head == queue->tail) {
         queue->head = queue->tail = NULL;
     } else {
-        queue->head = conn->read_q_handle;
+        queue->head              = conn->read_q_handle;
+        queue->head->read_q_prev = NULL;
     }
     if (conn != NULL) {
         conn->in_read_queue = 0;
+        queue->len--;
     }
     return conn;
 }
@@ -625,6 +1315,7 @@ conn_fifo_enqueue_gen(conn_fifo_queue_t *queue, conn_t *conn)
         queue->tail->gen_q_handle = conn;
         queue->tail = conn;
     }
+    queue->len++;
 }
 
 /** Remove (dequeue) a connection object from generic fifo queue.
@@ -645,6 +1336,9 @@ conn_fifo_dequeue_gen(conn_fifo_queue_t *queue)
     } else {
         queue->head = conn->gen_q_handle;
     }
+    if (conn != NULL) {
+        queue->len--;
+    }
     
     return conn;
 }
@@ -659,6 +1353,7 @@ conn_fifo_enqueue_write(conn_fifo_queue_t *queue, conn_t *conn)
 {
     if (conn->in_write_queue == 0) {
         conn->write_q_handle = NULL;
+        conn->write_q_prev   = queue->tail;
         if (queue->head == NULL) {
             queue->head = queue->tail = conn;
         } else {
@@ -666,6 +1361,7 @@ conn_fifo_enqueue_write(conn_fifo_queue_t *queue, conn_t *conn)
             queue->tail = conn;
         }
         conn->in_write_queue = 1;
+        queue->len++;
     }
 }
 
@@ -685,10 +1381,12 @@ conn_fifo_dequeue_write(conn_fifo_queue_t *queue)
     if (queue->head == queue->tail) {
         queue->head = queue->tail = NULL;
     } else {
-        queue->head = conn->write_q_handle;
+        queue->head               = conn->write_q_handle;
+        queue->head->write_q_prev = NULL;
     }
     if (conn != NULL) {
         conn->in_write_queue = 0;
+        queue->len--;
     }
     return conn;
 }
@@ -711,6 +1409,7 @@ conn_fifo_enqueue_release(conn_fifo_queue_t *queue, conn_t *conn)
             queue->tail = conn;
         }
         conn->in_release_queue = 1;
+        queue->len++;
     }
 }
 
@@ -734,13 +1433,15 @@ conn_fifo_dequeue_release(conn_fifo_queue_t *queue)
     }
     if (conn != NULL) {
         conn->in_release_queue = 0;
+        queue->len--;
     }
     
     return conn;
 }
 
 
-/** Remove conn from read queue.
+/** Remove conn from read queue, in constant time by unlinking it from its
+ * neighbours. Conn must be in given queue if its in_read_queue flag is set.
  * 
  * @param queue   Read queue to remove conn object from.
  * @param conn_rm Conn object to remove from queue.
@@ -748,25 +1449,29 @@ conn_fifo_dequeue_release(conn_fifo_queue_t *queue)
 void
 conn_fifo_remove_from_read_queue(conn_fifo_queue_t *queue, conn_t *conn_rm)
 {
-    conn_t            *conn;
-    conn_fifo_queue_t new_queue = {};
+    conn_t *prev = conn_rm->read_q_prev;
+    conn_t *next = conn_rm->read_q_handle;
 
-    if (conn_rm->in_read_queue) {
-        while ((conn = conn_fifo_dequeue_read(queue)) != NULL) {
-            if (conn != conn_rm) {
-                conn_fifo_enqueue_read(queue, conn);
-            }
-        }
+    if (conn_rm->in_read_queue == 0) {
+        return;
     }
-
-    /* Repopulate queue. */
-    if (new_queue.head != NULL) {
-        queue->head = new_queue.head;
-        queue->tail = new_queue.tail;
+    if (prev != NULL) {
+        prev->read_q_handle = next;
+    } else {
+        queue->head = next;
     }
+    if (next != NULL) {
+        next->read_q_prev = prev;
+    } else {
+        queue->tail = prev;
+    }
+    conn_rm->read_q_handle = conn_rm->read_q_prev = NULL;
+    conn_rm->in_read_queue = 0;
+    queue->len--;
 }
 
-/** Remove conn from write queue.
+/** Remove conn from write queue, in constant time by unlinking it from its
+ * neighbours. Conn must be in given queue if its in_write_queue flag is set.
  * 
  * @param queue   Write queue to remove conn object from.
  * @param conn_rm Conn object to remove from queue.
@@ -774,83 +1479,98 @@ conn_fifo_remove_from_read_queue(conn_fifo_queue_t *queue, conn_t *conn_rm)
 void
 conn_fifo_remove_from_write_queue(conn_fifo_queue_t *queue, conn_t *conn_rm)
 {
-    conn_t            *conn;
-    conn_fifo_queue_t new_queue = {};
+    conn_t *prev = conn_rm->write_q_prev;
+    conn_t *next = conn_rm->write_q_handle;
 
-    if (conn_rm->in_read_queue) {
-        while ((conn = conn_fifo_dequeue_write(queue)) != NULL) {
-            if (conn != conn_rm) {
-                conn_fifo_enqueue_write(queue, conn);
-            }
-        }
+    if (conn_rm->in_write_queue == 0) {
+        return;
+    }
+    if (prev != NULL) {
+        prev->write_q_handle = next;
+    } else {
+        queue->head = next;
+    }
+    if (next != NULL) {
+        next->write_q_prev = prev;
+    } else {
+        queue->tail = prev;
     }
+    conn_rm->write_q_handle = conn_rm->write_q_prev = NULL;
+    conn_rm->in_write_queue = 0;
+    queue->len--;
+}
 
-    /* Repopulate queue. */
-    if (new_queue.head != NULL) {
-        queue->head = new_queue.head;
-        queue->tail = new_queue.tail;
+/** Add (enqueue) a TCP connection object to idle fifo queue. Connection
+ * already in the queue is moved to its tail, so queue head is the connection
+ * idle for longest time.
+ * 
+ * @param queue Idle queue to add connection object to.
+ * @param conn  TCP connection object to queue up.
+ */
+void
+conn_fifo_enqueue_idle(conn_fifo_queue_t *queue, conn_t *conn)
+{
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
+
+    conn_fifo_remove_from_idle_queue(queue, conn);
+    conn_tcp->idle_q_handle = NULL;
+    conn_tcp->idle_q_prev   = queue->tail;
+    if (queue->head == NULL) {
+        queue->head = queue->tail = conn;
+    } else {
+        queue->tail->conn.tcp->idle_q_handle = conn;
+        queue->tail = conn;
     }
+    conn->in_idle_queue = 1;
+    queue->len++;
 }
 
-/** Get entry in TCP connection LRU cache and also update LRU state (entry is set as MRU).
+/** Remove (dequeue) a TCP connection object from idle fifo queue, the one
+ * idle for longest time.
  * 
- * @param lru  Pointer to LRU cache.
- * @param id   Entry key to look for.
+ * @param queue Idle queue to remove connection object from.
  * 
- * @return     On success returns a pointer to connection in LRU cache. Entry
- *             place in LRU is updated.
- *             Otherwise returns NULL indicating that entry was not found in
- *             LRU cache.
+ * @return      On success returns connection object, otherwise there are
+ *              no entries in the queue and returns NULL.
  */
 conn_t *
-conn_lru_cache_get(conn_t **lru, uint64_t id)
+conn_fifo_dequeue_idle(conn_fifo_queue_t *queue)
 {
-    conn_t *entry = NULL;
+    conn_t *conn = queue->head;
 
-    HASH_FIND(hh, *lru, &id, sizeof(uint64_t), entry);
-
-    if (entry != NULL) {
-        /* Remove then add entry so it is on the front of the list. */
-        LRU_CACHE_DEL(*lru, entry);
-        LRU_CACHE_ADD(*lru, entry);
-        return entry;
+    if (conn != NULL) {
+        conn_fifo_remove_from_idle_queue(queue, conn);
     }
-    return NULL;
+    return conn;
 }
 
-/** Assign a new TCP connection ID.
- * 
- * @param id   Where to store newly assigned TCP connection ID.
- * @param lru  TCP connection LRU cache, used to verify uniqueness of connection
- *             ID being assigned.
- * @param base Base for connection ID. (Base is unique per Vectorloop object.
+/** Remove TCP conn from idle queue, in constant time by unlinking it from its
+ * neighbours. Conn must be in given queue if its in_idle_queue flag is set.
  * 
- * @return     Returns true if connection ID was assigned, otherwise returns
- *             false.
+ * @param queue   Idle queue to remove conn object from.
+ * @param conn_rm Conn object to remove from queue.
  */
-bool
-conn_tcp_id_assign(uint64_t *id, conn_t **lru, uint64_t *base)
+void
+conn_fifo_remove_from_idle_queue(conn_fifo_queue_t *queue, conn_t *conn_rm)
 {
-    conn_t *conn = NULL;
+    conn_tcp_t *conn_tcp = conn_rm->conn.tcp;
+    conn_t     *prev     = conn_tcp->idle_q_prev;
+    conn_t     *next     = conn_tcp->idle_q_handle;
 
-    for (uint64_t i = *base + 1; i < UINTMAX_MAX; i++){
-        conn = NULL;
-        HASH_FIND(hh, *lru, &i, sizeof(uint64_t), conn);
-        if (conn == NULL) {
-            *id = i;
-            *base = i;
-            return true;
-        }
+    if (conn_rm->in_idle_queue == 0) {
+        return;
     }
-    for (uint64_t i = 0; i < *base; i++){
-        conn = NULL;
-        HASH_FIND(hh, *lru, &i, sizeof(uint64_t), conn);
-        if (conn == NULL) {
-            *id = i;
-            *base = i;
-            return true;
-        }
-    }  
-
-    return false;
-}
\ No newline at end of file
+    if (prev != NULL) {
+        prev->conn.tcp->idle_q_handle = next;
+    } else {
+        queue->head = next;
+    }
+    if (next != NULL) {
+        next->conn.tcp->idle_q_prev = prev;
+    } else {
+        queue->tail = prev;
+    }
+    conn_tcp->idle_q_handle = conn_tcp->idle_q_prev = NULL;
+    conn_rm->in_idle_queue  = 0;
+    queue->len--;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file conn_limit.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup conn_limit
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conn_limit.h"
+#include "mem.h"
+#include "utils.h"
+
+/** Key bit set for every used entry. */
+#define CONN_LIMIT_KEY_VALID (1ULL << 63)
+
+/** Key bit set for IPv6 client networks. */
+#define CONN_LIMIT_KEY_IPV6  (1ULL << 60)
+
+/** Initialize connection limit table.
+ *
+ * @param limit           Table to initialize.
+ * @param size            Number of entries in table, rounded up to power of 2
+ *                        and to at least one bucket.
+ * @param per_client_max  Maximum number of connections per client network. If
+ *                        0 limit is disabled.
+ * @param ipv4_prefix_len Prefix length IPv4 clients are grouped by.
+ * @param ipv6_prefix_len Prefix length IPv6 clients are grouped by, up to
+ *                        @ref TCP_CONNS_CLIENT_IPV6_PREFIX_LEN_MAX.
+ */
+void
+conn_limit_init(conn_limit_t *limit, size_t size, size_t per_client_max,
+                unsigned int ipv4_prefix_len, unsigned int ipv6_prefix_len)
+{
+    size_t buckets_count = 1;
+
+    *limit = (conn_limit_t) {};
+    if (per_client_max == 0) {
+        return;
+    }
+    while (buckets_count * CONN_LIMIT_BUCKET_ENTRIES < size) {
+        buckets_count <<= 1;
+    }
+    limit->buckets = mem_aligned_alloc(MEM_TAG_TCP_CONNS, CACHE_LINE_SIZE,
+                                       buckets_count * sizeof(conn_limit_bucket_t));
+    CHECK_MALLOC(limit->buckets);
+    memset(limit->buckets, 0, buckets_count * sizeof(conn_limit_bucket_t));
+
+    limit->mask           = buckets_count - 1;
+    limit->per_client_max = per_client_max;
+    limit->ipv4_mask      = ipv4_prefix_len == 0 ? 0 :
+                            htonl(0xffffffffU << (32 - ipv4_prefix_len));
+    limit->ipv6_bytes     = (ipv6_prefix_len + 7) / 8;
+    limit->ipv6_last_mask = ipv6_prefix_len % 8 == 0 ? 0xff :
+                            (uint8_t)(0xff << (8 - ipv6_prefix_len % 8));
+}
+
+/** Release memory held by connection limit table.
+ *
+ * @param limit Table to release.
+ */
+void
+conn_limit_clean(conn_limit_t *limit)
+{
+    mem_free(MEM_TAG_TCP_CONNS, limit->buckets);
+    *limit = (conn_limit_t) {};
+}
+
+/** Build entry key from client address.
+ *
+ * @param limit     Connection limit table.
+ * @param client_ip Client address.
+ *
+ * @return          Returns key.
+ */
+static uint64_t
+conn_limit_key(conn_limit_t *limit, struct sockaddr_storage *client_ip)
+{
+    uint64_t key = CONN_LIMIT_KEY_VALID;
+
+    if (client_ip->ss_family == AF_INET6) {
+        const uint8_t *addr = ((struct sockaddr_in6 *)client_ip)->sin6_addr.s6_addr;
+        uint64_t       net  = 0;
+
+        for (uint8_t i = 0; i < limit->ipv6_bytes; i++) {
+            uint8_t byte = i == limit->ipv6_bytes - 1 ? addr[i] & limit->ipv6_last_mask :
+                                                        addr[i];
+
+            net |= (uint64_t)byte << (8 * (6 - i));
+        }
+        key |= CONN_LIMIT_KEY_IPV6 | net;
+    } else {
+        uint32_t addr = ((struct sockaddr_in *)client_ip)->sin_addr.s_addr;
+
+        key |= ntohl(addr & limit->ipv4_mask);
+    }
+    return key;
+}
+
+/** Map entry key to table bucket.
+ *
+ * @param limit Connection limit table.
+ * @param key   Entry key.
+ *
+ * @return      Returns bucket key maps to.
+ */
+static inline conn_limit_bucket_t *
+conn_limit_bucket(conn_limit_t *limit, uint64_t key)
+{
+    uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+
+    return &limit->buckets[(hash ^ (hash >> 32)) & limit->mask];
+}
+
+/** Count a new connection of client network, unless client network already
+ * holds maximum number of connections.
+ *
+ * @param limit     Connection limit table.
+ * @param client_ip Client address of connection.
+ * @param force     Count connection even if client network is at its maximum,
+ *                  used for connections vectorloop takes over.
+ * @param key       Set to key connection is counted under, to be passed to
+ *                  @ref conn_limit_release() once connection ends. Set to 0 if
+ *                  connection is not counted, as limit is disabled or client
+ *                  network found its bucket full.
+ *
+ * @return          Returns false if client network is at its maximum and
+ *                  connection is to be refused, otherwise true.
+ */
+bool
+conn_limit_acquire(conn_limit_t *limit, struct sockaddr_storage *client_ip,
+                   bool force, uint64_t *key)
+{
+    conn_limit_bucket_t *bucket;
+    conn_limit_entry_t  *entry = NULL;
+
+    *key = 0;
+    if (limit->buckets == NULL) {
+        return true;
+    }
+
+    *key   = conn_limit_key(limit, client_ip);
+    bucket = conn_limit_bucket(limit, *key);
+    for (size_t i = 0; i < CONN_LIMIT_BUCKET_ENTRIES; i++) {
+        if (bucket->entries[i].key == *key) {
+            entry = &bucket->entries[i];
+            break;
+        }
+        if (entry == NULL && bucket->entries[i].key == 0) {
+            entry = &bucket->entries[i];
+        }
+    }
+    if (entry == NULL) {
+        /* Bucket is full, let connection in uncounted. */
+        *key = 0;
+        return true;
+    }
+    if (entry->key == *key && entry->count >= limit->per_client_max && !force) {
+        *key = 0;
+        return false;
+    }
+    entry->key = *key;
+    INCREMENT(entry->count);
+    return true;
+}
+
+/** Uncount a connection of client network once it ends.
+ *
+ * @param limit Connection limit table.
+ * @param key   Key connection was counted under, as set by
+ *              @ref conn_limit_acquire(). If 0 nothing is done.
+ */
+void
+conn_limit_release(conn_limit_t *limit, uint64_t key)
+{
+    conn_limit_bucket_t *bucket;
+
+    if (key == 0 || limit->buckets == NULL) {
+        return;
+    }
+    bucket = conn_limit_bucket(limit, key);
+    for (size_t i = 0; i < CONN_LIMIT_BUCKET_ENTRIES; i++) {
+        if (bucket->entries[i].key == key) {
+            DECREMENT(bucket->entries[i].count);
+            if (bucket->entries[i].count == 0) {
+                bucket->entries[i].key = 0;
+            }
+            return;
+        }
+    }
+}
+
+/** @}*/
@@ -0,0 +1,207 @@
+/**
+ * @file conn_pool.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "conn_pool.h"
+
+/** Initialize TCP connection object pool, and preload it with
+ * @ref CONN_POOL_TCP_PREALLOC connection objects and
+ * @ref CONN_POOL_TCP_BUFS_FREE_MAX buffer sets (or size_max if lower).
+ *
+ * @param pool          Pool to initialize.
+ * @param cfg           Configuration used to allocate connection objects.
+ * @param response_pool Pool larger query response buffers of connection
+ *                      objects are taken from, NULL if none.
+ * @param size_max      Maximum number of connection objects pool keeps.
+ */
+void
+conn_pool_init(conn_pool_t *pool, config_t *cfg, buf_pool_t *response_pool,
+               size_t size_max)
+{
+    struct sockaddr_storage ip = {};
+    size_t                  prealloc = CONN_POOL_TCP_PREALLOC;
+
+    *pool = (conn_pool_t) {
+        .cfg           = cfg,
+        .response_pool = response_pool,
+        .size_max      = size_max,
+    };
+
+    if (prealloc > size_max) {
+        prealloc = size_max;
+    }
+    for (size_t i = 0; i < prealloc; i++) {
+        conn_t *conn = conn_new_tcp(-1, 0, &ip, &ip);
+
+        pool->count++;
+        conn_pool_put(pool, conn);
+    }
+
+    prealloc = CONN_POOL_TCP_BUFS_FREE_MAX;
+    if (prealloc > size_max) {
+        prealloc = size_max;
+    }
+    for (size_t i = 0; i < prealloc; i++) {
+        conn_tcp_bufs_t *bufs = conn_tcp_bufs_new(cfg, response_pool);
+
+        bufs->next           = pool->bufs_free_head;
+        pool->bufs_free_head = bufs;
+        pool->bufs_free_count++;
+        pool->bufs_count++;
+    }
+}
+
+/** Clean TCP connection object pool. This releases all connection objects
+ * and buffer sets in pool free lists. Connection objects in use, and buffer
+ * sets attached to them, are not released.
+ *
+ * @param pool Pool to clean.
+ */
+void
+conn_pool_clean(conn_pool_t *pool)
+{
+    conn_t          *conn;
+    conn_tcp_bufs_t *bufs;
+
+    while ((conn = pool->free_head) != NULL) {
+        pool->free_head = conn->gen_q_handle;
+        conn_release(conn);
+    }
+    while ((bufs = pool->bufs_free_head) != NULL) {
+        pool->bufs_free_head = bufs->next;
+        conn_tcp_bufs_free(bufs);
+    }
+    *pool = (conn_pool_t) {};
+}
+
+/** Get a TCP connection object for an established TCP connection. Object is
+ * taken from pool free list, or newly allocated if free list is empty. It
+ * holds no buffer set, see @ref conn_pool_bufs_get().
+ *
+ * @param pool       Pool to get connection object from.
+ * @param fd         Socket for TCP connection.
+ * @param ip_version IP version this connection is for, 0=IPv4, 1=IPv6.
+ * @param client_ip  Client IP address.
+ * @param local_ip   Local IP address.
+ *
+ * @return           Returns initialized TCP connection object.
+ */
+conn_t *
+conn_pool_get_tcp(conn_pool_t *pool, int fd, int ip_version,
+                  struct sockaddr_storage *client_ip,
+                  struct sockaddr_storage *local_ip)
+{
+    conn_t *conn = pool->free_head;
+
+    if (conn == NULL) {
+        pool->count++;
+        return conn_new_tcp(fd, ip_version, client_ip, local_ip);
+    }
+
+    pool->free_head = conn->gen_q_handle;
+    pool->free_count--;
+    conn_tcp_reuse(conn, fd, ip_version, client_ip, local_ip);
+
+    return conn;
+}
+
+/** Return TCP connection object to pool. Connection object must be removed
+ * from all queues, and have its timer disarmed. Socket is closed if still
+ * open, and buffer set connection holds is returned to pool. If pool holds
+ * more than maximum number of objects connection object is released instead.
+ *
+ * @param pool Pool to return connection object to.
+ * @param conn Connection object to return.
+ */
+void
+conn_pool_put(conn_pool_t *pool, conn_t *conn)
+{
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    conn_pool_bufs_put(pool, conn);
+
+    if (pool->count > pool->size_max) {
+        pool->count--;
+        conn_release(conn);
+        return;
+    }
+
+    conn->gen_q_handle = pool->free_head;
+    pool->free_head    = conn;
+    pool->free_count++;
+}
+
+/** Attach a buffer set to TCP connection object, unless it already holds
+ * one. Buffer set is taken from pool free list, or newly allocated if free
+ * list is empty.
+ *
+ * @param pool Pool to get buffer set from.
+ * @param conn TCP connection object.
+ */
+void
+conn_pool_bufs_get(conn_pool_t *pool, conn_t *conn)
+{
+    conn_tcp_bufs_t *bufs = pool->bufs_free_head;
+
+    if (conn->conn.tcp->bufs != NULL) {
+        return;
+    }
+    if (bufs == NULL) {
+        pool->bufs_count++;
+        bufs = conn_tcp_bufs_new(pool->cfg, pool->response_pool);
+    } else {
+        pool->bufs_free_head = bufs->next;
+        pool->bufs_free_count--;
+    }
+    conn_tcp_bufs_attach(conn->conn.tcp, bufs);
+}
+
+/** Return buffer set of TCP connection object to pool, if it holds one.
+ * Buffered data not yet framed into queries is discarded, so connection
+ * should have none. If pool free list is full buffer set is freed instead.
+ *
+ * @param pool Pool to return buffer set to.
+ * @param conn TCP connection object.
+ */
+void
+conn_pool_bufs_put(conn_pool_t *pool, conn_t *conn)
+{
+    conn_tcp_bufs_t *bufs = conn_tcp_bufs_detach(conn->conn.tcp);
+
+    if (bufs == NULL) {
+        return;
+    }
+    if (pool->bufs_free_count >= CONN_POOL_TCP_BUFS_FREE_MAX) {
+        pool->bufs_count--;
+        conn_tcp_bufs_free(bufs);
+        return;
+    }
+    bufs->next           = pool->bufs_free_head;
+    pool->bufs_free_head = bufs;
+    pool->bufs_free_count++;
+}
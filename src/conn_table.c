@@ -0,0 +1,159 @@
+/**
+ * @file conn_table.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup conn_table
+ *  @{
+ */
+#include <stdlib.h>
+
+#include "conn_table.h"
+#include "mem.h"
+#include "utils.h"
+
+/** Initial number of slots in connection table. */
+#define CONN_TABLE_SIZE_MIN 1024
+
+/** Maximum number of slots in connection table, slot index and generation
+ * are 32 bit.
+ */
+#define CONN_TABLE_SIZE_MAX 0x80000000u
+
+/** Mask of generation bits in connection ID, generation is 31 bits as top
+ * bit of connection ID is @ref CONN_TABLE_CID_F.
+ */
+#define CONN_TABLE_GENERATION_MASK 0x7fffffffu
+
+/** Initialize connection table.
+ *
+ * @param table    Connection table to initialize.
+ * @param size_max Maximum number of connections table holds.
+ */
+void
+conn_table_init(conn_table_t *table, size_t size_max)
+{
+    *table = (conn_table_t) {
+        .size_max = size_max < CONN_TABLE_SIZE_MAX ? size_max : CONN_TABLE_SIZE_MAX,
+    };
+}
+
+/** Release memory held by connection table. Connections in table are not
+ * released.
+ *
+ * @param table Connection table to release.
+ */
+void
+conn_table_clean(conn_table_t *table)
+{
+    mem_free(MEM_TAG_TCP_CONNS, table->slots);
+    *table = (conn_table_t) {};
+}
+
+/** Grow connection table, new slots are added to free list.
+ *
+ * @param table Connection table.
+ *
+ * @return      Returns true if table was grown, false if it is at its maximum
+ *              size.
+ */
+static bool
+conn_table_grow(conn_table_t *table)
+{
+    uint32_t size = table->size == 0 ? CONN_TABLE_SIZE_MIN : table->size * 2;
+
+    if (size > table->size_max) {
+        size = table->size_max;
+    }
+    if (size <= table->size) {
+        return false;
+    }
+
+    table->slots = mem_realloc(MEM_TAG_TCP_CONNS, table->slots, sizeof(conn_table_slot_t) * size);
+    CHECK_MALLOC(table->slots);
+    for (uint32_t i = table->size; i < size; i++) {
+        table->slots[i] = (conn_table_slot_t) {
+            .generation = 1,
+            .next_free  = i + 1,
+        };
+    }
+    /* Free list is empty when table is grown, new slots become free list. */
+    table->free_head = table->size;
+    table->size      = size;
+
+    return true;
+}
+
+/** Add connection to connection table and assign it connection ID.
+ *
+ * @param table Connection table.
+ * @param conn  Connection to add, its cid is set.
+ *
+ * @return      Returns true on success, false if table is full.
+ */
+bool
+conn_table_add(conn_table_t *table, conn_t *conn)
+{
+    conn_table_slot_t *slot  = NULL;
+    uint32_t           index = 0;
+
+    if (table->free_head >= table->size && !conn_table_grow(table)) {
+        return false;
+    }
+
+    index            = table->free_head;
+    slot             = &table->slots[index];
+    table->free_head = slot->next_free;
+    slot->conn       = conn;
+    table->count    += 1;
+
+    conn->cid = CONN_TABLE_CID_F | ((uint64_t)slot->generation << 32) | index;
+
+    return true;
+}
+
+/** Remove connection from connection table. Removing a connection that is
+ * not in table is a no-op.
+ *
+ * @param table Connection table.
+ * @param conn  Connection to remove.
+ */
+void
+conn_table_remove(conn_table_t *table, conn_t *conn)
+{
+    conn_table_slot_t *slot  = NULL;
+    uint32_t           index = (uint32_t)conn->cid;
+
+    if (conn_table_get(table, conn->cid) != conn) {
+        return;
+    }
+
+    slot             = &table->slots[index];
+    slot->conn       = NULL;
+    slot->generation = (slot->generation + 1) & CONN_TABLE_GENERATION_MASK;
+    slot->next_free  = table->free_head;
+    table->free_head = index;
+    table->count    -= 1;
+    conn->cid        = 0;
+}
+
+/** @}*/
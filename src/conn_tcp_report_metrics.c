@@ -27,58 +27,87 @@
 
 #include "conn.h"
 #include "metrics.h"
+#include "utils.h"
 
-/** Report TCP metrics for a query.
+/** Report TCP metrics for a connection being released: counter of state it
+ * ended in, and its lifetime queries, duration and bytes read and written
+ * into histograms. Connection handed off to another vectorloop is reported
+ * by vectorloop that releases it last, as it carries its totals along.
  * 
  * @param conn_tcp TCP connection to report metrics for.
- * @param metrics  Metrics object where to report metrics.
+ * @param metrics  Vectorloop metrics where to report metrics.
  */
 void
-conn_tcp_report_metrics(conn_tcp_t *conn_tcp, metrics_t *metrics)
+conn_tcp_report_metrics(conn_tcp_t *conn_tcp, metrics_vl_t *metrics)
 {
+    uint64_t start_ns;
+    uint64_t end_ns;
+
     switch (conn_tcp->state) {
     case TCP_CONN_ST_ASSIGN_CONN_ID_ERR:
-        atomic_fetch_add(&metrics->tcp.conn_id_unavailable, 1);
+        METRICS_INC(metrics->tcp.conn_id_unavailable);
         break;
 
     case TCP_CONN_ST_QUERY_SIZE_TOOLARGE:
-        atomic_fetch_add(&metrics->tcp.query_len_toolarge, 1);
+        METRICS_INC(metrics->tcp.query_len_toolarge);
         break;
 
     case TCP_CONN_ST_CLOSED_FOR_READ:
         if (conn_tcp->read_buffer_len != 0) {
-            atomic_fetch_add(&metrics->tcp.closed_partial_query, 1);
+            METRICS_INC(metrics->tcp.closed_partial_query);
         } else if (conn_tcp->queries_count == 0) {
-            atomic_fetch_add(&metrics->tcp.closed_no_query, 1);
+            METRICS_INC(metrics->tcp.closed_no_query);
         }
         break;
 
     case TCP_CONN_ST_CLOSED_FOR_WRITE:
-        atomic_fetch_add(&metrics->tcp.sock_closed_for_write, 1);
+        METRICS_INC(metrics->tcp.sock_closed_for_write);
         break;
 
     case TCP_CONN_ST_READ_ERR:
-        atomic_fetch_add(&metrics->tcp.sock_read_err, 1);
+        METRICS_INC(metrics->tcp.sock_read_err);
         break;
 
     case TCP_CONN_ST_WAIT_FOR_QUERY:
-        atomic_fetch_add(&metrics->tcp.keepalive_timeout, 1);
+        METRICS_INC(metrics->tcp.keepalive_timeout);
         break;
 
     case TCP_CONN_ST_WAIT_FOR_QUERY_DATA:
-        atomic_fetch_add(&metrics->tcp.query_recv_timeout, 1);
+        METRICS_INC(metrics->tcp.query_recv_timeout);
         break;
 
     case TCP_CONN_ST_WAIT_FOR_WRITE:
-        atomic_fetch_add(&metrics->tcp.sock_write_timeout, 1);
+    case TCP_CONN_ST_XFR:
+        METRICS_INC(metrics->tcp.sock_write_timeout);
         break;
 
     case TCP_CONN_ST_WRITE_ERR:
-        atomic_fetch_add(&metrics->tcp.sock_write_err, 1);
+        METRICS_INC(metrics->tcp.sock_write_err);
+        break;
+
+    case TCP_CONN_ST_EVICTED:
+        METRICS_INC(metrics->tcp.idle_evicted);
         break;
 
+    case TCP_CONN_ST_TLS_HANDSHAKE_BUSY:
+        METRICS_INC(metrics->dot.handshake_busy);
+        break;
+
+    case TCP_CONN_ST_HANDED_OFF:
+        return;
+
     default:
         break;
     }
 
+    if (conn_tcp->start_time.tv_sec == 0) {
+        /* Connection was never set up. */
+        return;
+    }
+    histogram_record(&metrics->tcp.conn_queries, conn_tcp->queries_total_count);
+    histogram_record(&metrics->tcp.conn_bytes_read, conn_tcp->bytes_read);
+    histogram_record(&metrics->tcp.conn_bytes_written, conn_tcp->bytes_written);
+    start_ns = utl_timespec_to_ns(&conn_tcp->start_time);
+    end_ns   = utl_timespec_to_ns(&conn_tcp->end_time);
+    histogram_record(&metrics->tcp.conn_duration, end_ns > start_ns ? end_ns - start_ns : 0);
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+/**
+ * @file dns_cookie.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup dns_cookie
+ *  @{
+ */
+#include <netinet/in.h>
+#include <string.h>
+
+#include "dns_cookie.h"
+
+/** Rotate 64 bit value left. */
+#define DNS_COOKIE_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+/** SipHash round. */
+#define DNS_COOKIE_SIPROUND(v0, v1, v2, v3) do { \
+    v0 += v1; v1 = DNS_COOKIE_ROTL(v1, 13); v1 ^= v0; v0 = DNS_COOKIE_ROTL(v0, 32); \
+    v2 += v3; v3 = DNS_COOKIE_ROTL(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = DNS_COOKIE_ROTL(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = DNS_COOKIE_ROTL(v1, 17); v1 ^= v2; v2 = DNS_COOKIE_ROTL(v2, 32); \
+} while (0)
+
+/** Read 64 bit little endian value.
+ *
+ * @param p Buffer to read from.
+ *
+ * @return  Returns value read.
+ */
+static inline uint64_t
+dns_cookie_get64le(const uint8_t *p)
+{
+    uint64_t v = 0;
+
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/** Calculate SipHash-2-4 of data.
+ *
+ * @param key  16 byte key.
+ * @param data Data to hash.
+ * @param len  Length of data.
+ *
+ * @return     Returns 64 bit hash.
+ */
+uint64_t
+dns_cookie_siphash(const uint8_t *key, const uint8_t *data, size_t len)
+{
+    uint64_t k0 = dns_cookie_get64le(key);
+    uint64_t k1 = dns_cookie_get64le(key + 8);
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    uint64_t m;
+    size_t   i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        m = dns_cookie_get64le(data + i);
+        v3 ^= m;
+        DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+        DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    /* Last block holds remaining bytes and length of data. */
+    m = (uint64_t)len << 56;
+    for (size_t j = 0; i + j < len; j++) {
+        m |= (uint64_t)data[i + j] << (8 * j);
+    }
+    v3 ^= m;
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xff;
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+    DNS_COOKIE_SIPROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/** Generate server cookie (RFC 9018).
+ *
+ * @param server_cookie Where to store @ref DNS_COOKIE_SERVER_LEN bytes of
+ *                      server cookie.
+ * @param secret        @ref DNS_COOKIE_SECRET_LEN bytes of secret.
+ * @param client_cookie Client cookie.
+ * @param client_ip     Client address.
+ * @param timestamp     Cookie timestamp, seconds since Epoch.
+ */
+void
+dns_cookie_server_cookie(uint8_t *server_cookie, const uint8_t *secret,
+                         const uint8_t *client_cookie,
+                         struct sockaddr_storage *client_ip, uint32_t timestamp)
+{
+    /* Client cookie, version, reserved, timestamp, and client IP. */
+    uint8_t  data[DNS_COOKIE_CLIENT_LEN + 8 + sizeof(struct in6_addr)];
+    size_t   len = DNS_COOKIE_CLIENT_LEN + 8;
+    uint64_t hash;
+
+    memcpy(data, client_cookie, DNS_COOKIE_CLIENT_LEN);
+    data[8]  = DNS_COOKIE_VERSION;
+    data[9]  = 0;
+    data[10] = 0;
+    data[11] = 0;
+    data[12] = timestamp >> 24;
+    data[13] = timestamp >> 16;
+    data[14] = timestamp >> 8;
+    data[15] = timestamp;
+    if (client_ip->ss_family == AF_INET6) {
+        memcpy(data + len, &((struct sockaddr_in6 *)client_ip)->sin6_addr,
+               sizeof(struct in6_addr));
+        len += sizeof(struct in6_addr);
+    } else {
+        memcpy(data + len, &((struct sockaddr_in *)client_ip)->sin_addr,
+               sizeof(struct in_addr));
+        len += sizeof(struct in_addr);
+    }
+    hash = dns_cookie_siphash(secret, data, len);
+
+    memcpy(server_cookie, data + DNS_COOKIE_CLIENT_LEN, 8);
+    for (int i = 0; i < 8; i++) {
+        server_cookie[8 + i] = hash >> (8 * i);
+    }
+}
+
+/** Verify server cookie of request, if any, and set server cookie to send in
+ * response. A valid server cookie is echoed back, unless it is older than
+ * @ref DNS_COOKIE_REFRESH in which case a new one is generated.
+ *
+ * @param cookie    Parsed EDNS cookie of request, must be valid.
+ * @param secret    @ref DNS_COOKIE_SECRET_LEN bytes of secret.
+ * @param client_ip Client address.
+ * @param now       Current time, seconds since Epoch.
+ */
+void
+dns_cookie_verify(edns_cookie_t *cookie, const uint8_t *secret,
+                  struct sockaddr_storage *client_ip, uint32_t now)
+{
+    const uint8_t *server = cookie->edns_cookie_raw_buf + DNS_COOKIE_CLIENT_LEN;
+    uint32_t       timestamp;
+    int32_t        age;
+    uint8_t        diff = 0;
+
+    cookie->server_cookie_valid = false;
+
+    if (cookie->server_cookie_len == DNS_COOKIE_SERVER_LEN &&
+        server[0] == DNS_COOKIE_VERSION) {
+        timestamp = (uint32_t)server[4] << 24 | (uint32_t)server[5] << 16 |
+                    (uint32_t)server[6] << 8 | server[7];
+        /* Serial number arithmetic, RFC 9018 section 4.3. */
+        age = (int32_t)(now - timestamp);
+        if (age <= DNS_COOKIE_LIFETIME && age >= -DNS_COOKIE_CLOCK_SKEW) {
+            dns_cookie_server_cookie(cookie->server_cookie, secret,
+                                     cookie->client_cookie, client_ip, timestamp);
+            /* Compare in constant time, not to leak how much of hash matched. */
+            for (int i = 0; i < DNS_COOKIE_SERVER_LEN; i++) {
+                diff |= cookie->server_cookie[i] ^ server[i];
+            }
+            if (diff == 0) {
+                cookie->server_cookie_valid = true;
+                if (age < DNS_COOKIE_REFRESH) {
+                    return;
+                }
+            }
+        }
+    }
+
+    dns_cookie_server_cookie(cookie->server_cookie, secret, cookie->client_cookie,
+                             client_ip, now);
+}
+
+/** @}*/
@@ -0,0 +1,693 @@
+/**
+ * @file dnssec.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup dnssec
+ *  @{
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/core_names.h>
+#include <openssl/ecdsa.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+
+#include "constants.h"
+#include "dnssec.h"
+#include "mem.h"
+#include "utils.h"
+
+/** Store OpenSSL error message for a signing key load error into error
+ * buffer, and clear OpenSSL error queue.
+ *
+ * @param err_buf     Buffer where to store error message.
+ * @param err_buf_len Length of error buffer.
+ * @param msg         Error message.
+ * @param path        File path message applies to.
+ */
+static void
+dnssec_key_err(char *err_buf, size_t err_buf_len, const char *msg, const char *path)
+{
+    char reason[256];
+
+    ERR_error_string_n(ERR_get_error(), reason, sizeof(reason));
+    snprintf(err_buf, err_buf_len, "DNSSEC: %s \"%s\", %s", msg, path, reason);
+    ERR_clear_error();
+}
+
+/** Compute key tag of a DNSKEY record (RFC 4034 appendix B).
+ *
+ * @param rdata     DNSKEY record rdata.
+ * @param rdata_len Length of rdata.
+ *
+ * @return          Returns key tag.
+ */
+uint16_t
+dnssec_key_tag(const uint8_t *rdata, uint16_t rdata_len)
+{
+    uint32_t ac = 0;
+
+    for (uint16_t i = 0; i < rdata_len; i++) {
+        ac += (i & 1) ? rdata[i] : (uint32_t)rdata[i] << 8;
+    }
+    ac += (ac >> 16) & 0xffff;
+
+    return ac & 0xffff;
+}
+
+/** Load signing key from PEM file set by configuration setting
+ * "dnssec_key_file", for zone set by "dnssec_signer_name". Key MUST be an
+ * ECDSA P-256 or Ed25519 private key.
+ *
+ * @param key         Signing key to load.
+ * @param cfg         Configuration with settings.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf.
+ */
+int
+dnssec_key_load(dnssec_key_t *key, config_t *cfg, char *err_buf, size_t err_buf_len)
+{
+    unsigned char  pub[DNSSEC_PUBKEY_LEN_MAX + 1];
+    size_t         pub_len = 0;
+    uint8_t       *p       = NULL;
+    FILE          *f       = NULL;
+    char           group[32];
+
+    *key = (dnssec_key_t) {
+        .validity = cfg->dnssec_sig_validity,
+    };
+
+    if (rip_ns_name_pton((const unsigned char *)cfg->dnssec_signer_name, key->signer,
+                         sizeof(key->signer)) < 0) {
+        snprintf(err_buf, err_buf_len, "DNSSEC: invalid signer name \"%s\"",
+                 cfg->dnssec_signer_name);
+        return -1;
+    }
+    key->signer_len = rip_ns_name_lc(key->signer);
+
+    if ((f = fopen(cfg->dnssec_key_file, "r")) == NULL) {
+        snprintf(err_buf, err_buf_len, "DNSSEC: could not open key file \"%s\", %s",
+                 cfg->dnssec_key_file, strerror(errno));
+        return -1;
+    }
+    key->pkey = PEM_read_PrivateKey(f, NULL, NULL, NULL);
+    fclose(f);
+    if (key->pkey == NULL) {
+        dnssec_key_err(err_buf, err_buf_len, "could not load private key",
+                       cfg->dnssec_key_file);
+        return -1;
+    }
+
+    if (EVP_PKEY_is_a(key->pkey, "ED25519")) {
+        key->algorithm = DNSSEC_ALG_ED25519;
+    } else if (EVP_PKEY_is_a(key->pkey, "EC") &&
+               EVP_PKEY_get_group_name(key->pkey, group, sizeof(group), NULL) == 1 &&
+               strcmp(group, "prime256v1") == 0) {
+        key->algorithm = DNSSEC_ALG_ECDSAP256SHA256;
+    } else {
+        snprintf(err_buf, err_buf_len, "DNSSEC: key \"%s\" is not an ECDSA P-256 "
+                 "or Ed25519 key", cfg->dnssec_key_file);
+        dnssec_key_clean(key);
+        return -1;
+    }
+
+    /* DNSKEY public key is raw Ed25519 key, or uncompressed EC point without
+     * its 0x04 prefix (RFC 6605 section 4).
+     */
+    if (EVP_PKEY_get_octet_string_param(key->pkey, OSSL_PKEY_PARAM_PUB_KEY, pub,
+                                        sizeof(pub), &pub_len) != 1) {
+        pub_len = 0;
+    }
+    if (key->algorithm == DNSSEC_ALG_ECDSAP256SHA256 && pub_len == 65 && pub[0] == 4) {
+        pub_len--;
+        memmove(pub, pub + 1, pub_len);
+    }
+    if (pub_len != (key->algorithm == DNSSEC_ALG_ED25519 ? 32 : 64)) {
+        dnssec_key_err(err_buf, err_buf_len, "could not get public key",
+                       cfg->dnssec_key_file);
+        dnssec_key_clean(key);
+        return -1;
+    }
+
+    p = key->dnskey;
+    RIP_NS_PUT16(DNSSEC_DNSKEY_FLAGS, p);
+    *p++ = DNSSEC_DNSKEY_PROTOCOL;
+    *p++ = key->algorithm;
+    memcpy(p, pub, pub_len);
+    key->dnskey_len = 4 + pub_len;
+    key->key_tag    = dnssec_key_tag(key->dnskey, key->dnskey_len);
+
+    return 0;
+}
+
+/** Release memory held by signing key.
+ *
+ * @param key Signing key to clean.
+ */
+void
+dnssec_key_clean(dnssec_key_t *key)
+{
+    EVP_PKEY_free(key->pkey);
+    key->pkey = NULL;
+}
+
+/** Format DNSKEY record of signing key as a zone file line, for it to be
+ * added to zone.
+ *
+ * @param key     Signing key.
+ * @param buf     Where to store '\0' terminated line.
+ * @param buf_len Size of buf.
+ *
+ * @return        Returns length of line, or -1 if it does not fit.
+ */
+int
+dnssec_key_dnskey_text(dnssec_key_t *key, char *buf, size_t buf_len)
+{
+    char          owner[RIP_NS_MAXCDNAME * 4 + 1];
+    unsigned char b64[((DNSSEC_PUBKEY_LEN_MAX + 2) / 3) * 4 + 1];
+    int           len;
+
+    if (rip_ns_name_ntop(key->signer, owner, sizeof(owner)) < 0) {
+        return -1;
+    }
+    EVP_EncodeBlock(b64, key->dnskey + 4, key->dnskey_len - 4);
+    /* Owner is written fully qualified, as in zone file. */
+    len = snprintf(buf, buf_len, "%s%s %u IN DNSKEY %u %u %u %s", owner,
+                   owner[strlen(owner) - 1] == '.' ? "" : ".", DNSSEC_DNSKEY_TTL, DNSSEC_DNSKEY_FLAGS, DNSSEC_DNSKEY_PROTOCOL,
+                   key->algorithm, b64);
+
+    return len < 0 || (size_t)len >= buf_len ? -1 : len;
+}
+
+/** Convert record rdata in place into canonical form, domain names embedded
+ * in rdata are lower cased (RFC 4034 section 6.2).
+ *
+ * @param type  Record type.
+ * @param rdata Record rdata.
+ */
+static void
+dnssec_rdata_canonical(uint16_t type, uint8_t *rdata)
+{
+    switch (type) {
+    case rip_ns_t_ns:
+    case rip_ns_t_cname:
+    case rip_ns_t_ptr:
+        rip_ns_name_lc(rdata);
+        break;
+    case rip_ns_t_mx:
+        rip_ns_name_lc(rdata + RIP_NS_INT16SZ);
+        break;
+    case rip_ns_t_srv:
+        rip_ns_name_lc(rdata + 3 * RIP_NS_INT16SZ);
+        break;
+    case rip_ns_t_soa:
+        rdata += rip_ns_name_lc(rdata);
+        rip_ns_name_lc(rdata);
+        break;
+    default:
+        break;
+    }
+}
+
+/** Compare function used to sort canonical form records of an RRset by their
+ * rdata (RFC 4034 section 6.3).
+ *
+ * @param a   First record, offset of its rdata length in rdata buffer.
+ * @param b   Second record.
+ * @param arg Buffer of records rdata length and rdata.
+ *
+ * @return    Returns <0, 0, >0 as per qsort_r() API.
+ */
+static int
+dnssec_rr_cmp(const void *a, const void *b, void *arg)
+{
+    const uint8_t *rd_a = (const uint8_t *)arg + *(const size_t *)a;
+    const uint8_t *rd_b = (const uint8_t *)arg + *(const size_t *)b;
+    uint16_t       len_a = (rd_a[0] << 8) | rd_a[1];
+    uint16_t       len_b = (rd_b[0] << 8) | rd_b[1];
+    int            ret   = memcmp(rd_a + 2, rd_b + 2, len_a < len_b ? len_a : len_b);
+
+    return ret != 0 ? ret : (int)len_a - (int)len_b;
+}
+
+/** Sign prepared signature cache entry, signature is appended to RRSIG
+ * record rdata. Data to be signed is released whether signing succeeds or
+ * not.
+ *
+ * @param key    Signing key.
+ * @param sig    Prepared signature cache entry, see @ref dnssec_sig_prepare().
+ * @param md_ctx Digest context to sign with, reused across calls.
+ *
+ * @return       Returns 0 on success, otherwise -1.
+ */
+int
+dnssec_sig_sign(dnssec_key_t *key, dnssec_sig_t *sig, EVP_MD_CTX *md_ctx)
+{
+    unsigned char  der[DNSSEC_SIG_LEN + 16];
+    const uint8_t *der_p   = der;
+    uint8_t       *out     = sig->rdata + sig->rr.rdata_len;
+    size_t         out_len = DNSSEC_SIG_LEN;
+    ECDSA_SIG     *es      = NULL;
+    int            ret     = -1;
+
+    EVP_MD_CTX_reset(md_ctx);
+
+    if (key->algorithm == DNSSEC_ALG_ED25519) {
+        /* Ed25519 signs data as is, no separate digest. */
+        if (EVP_DigestSignInit(md_ctx, NULL, NULL, NULL, key->pkey) == 1 &&
+            EVP_DigestSign(md_ctx, out, &out_len, sig->data, sig->data_len) == 1 &&
+            out_len == DNSSEC_SIG_LEN) {
+            ret = 0;
+        }
+    } else {
+        /* ECDSA signature is DER encoded, DNSSEC uses r and s as is, each
+         * padded to 32 bytes (RFC 6605 section 4).
+         */
+        out_len = sizeof(der);
+        if (EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, key->pkey) == 1 &&
+            EVP_DigestSign(md_ctx, der, &out_len, sig->data, sig->data_len) == 1 &&
+            (es = d2i_ECDSA_SIG(NULL, &der_p, out_len)) != NULL &&
+            BN_bn2binpad(ECDSA_SIG_get0_r(es), out, DNSSEC_SIG_LEN / 2) > 0 &&
+            BN_bn2binpad(ECDSA_SIG_get0_s(es), out + DNSSEC_SIG_LEN / 2,
+                         DNSSEC_SIG_LEN / 2) > 0) {
+            ret = 0;
+        }
+        ECDSA_SIG_free(es);
+    }
+    if (ret == 0) {
+        sig->rr.rdata_len += DNSSEC_SIG_LEN;
+    } else {
+        ERR_clear_error();
+    }
+
+    free(sig->data);
+    sig->data     = NULL;
+    sig->data_len = 0;
+
+    return ret;
+}
+
+/** Worker thread job function, signs prepared signature cache entry and sets
+ * its state to outcome. Digest context is kept per worker thread.
+ *
+ * @param job Job of entry, see @ref dnssec_sig_t.
+ */
+static void
+dnssec_sig_run(worker_job_t *job)
+{
+    static __thread EVP_MD_CTX *md_ctx = NULL;
+    dnssec_sig_t               *sig    = (dnssec_sig_t *)job;
+
+    if (md_ctx == NULL) {
+        md_ctx = EVP_MD_CTX_new();
+        CHECK_MALLOC(md_ctx);
+    }
+    sig->state = dnssec_sig_sign(sig->key, sig, md_ctx) == 0 ? DNSSEC_SIG_ST_READY :
+                                                               DNSSEC_SIG_ST_FAILED;
+}
+
+/** Prepare signature cache entry to be signed. RRSIG record without
+ * signature is built, and data to be signed: RRSIG rdata followed by RRset
+ * records in canonical form and order (RFC 4034 section 3.1.8.1). Entry job
+ * is set up to be handed to a worker thread, see @ref worker_pool_submit().
+ *
+ * @note No cryptographic operations are done, it is safe to call from
+ *       vectorloop.
+ *
+ * @param key       Signing key.
+ * @param sig       Signature cache entry to prepare.
+ * @param owner     RRset owner name, wire format lower cased. It MUST be
+ *                  at or below signer name.
+ * @param owner_len Length of owner name.
+ * @param rrs       Records of RRset.
+ * @param rr_count  Number of records.
+ * @param now       Current time, seconds since epoch.
+ *
+ * @return          Returns 0 on success, -1 if owner is not in signer zone or
+ *                  RRset is too large.
+ */
+int
+dnssec_sig_prepare(dnssec_key_t *key, dnssec_sig_t *sig, const unsigned char *owner,
+                   uint16_t owner_len, const rr_record_t *rrs, uint16_t rr_count,
+                   uint32_t now)
+{
+    size_t    rrs_offset[RIP_NS_RESP_MAX_ANSW];
+    uint8_t  *rdatas  = NULL;
+    uint8_t  *p       = sig->rdata;
+    size_t    len     = 0;
+    uint16_t  offset  = 0;
+    uint8_t   labels  = 0;
+
+    sig->job     = (worker_job_t) {
+        .run  = dnssec_sig_run,
+        .type = WORKER_JOB_DNSSEC_SIGN,
+    };
+    sig->key     = key;
+    sig->refresh = now + key->validity / 2;
+
+    /* Owner labels, and owner name ends with signer name on label boundary. */
+    if (owner_len < key->signer_len ||
+        memcmp(owner + owner_len - key->signer_len, key->signer, key->signer_len) != 0) {
+        return -1;
+    }
+    while (offset < owner_len - key->signer_len) {
+        offset += owner[offset] + 1;
+        labels++;
+    }
+    if (offset != owner_len - key->signer_len || rr_count > RIP_NS_RESP_MAX_ANSW) {
+        return -1;
+    }
+    /* Wildcard label is not counted, signature then covers every name
+     * wildcard answer is synthesized for (RFC 4034 section 3.1.3).
+     */
+    if (labels > 0 && owner[0] == 1 && owner[1] == '*') {
+        labels--;
+    }
+    for (const unsigned char *l = key->signer; *l != 0; l += *l + 1) {
+        labels++;
+    }
+
+    /* RRSIG rdata, without signature. */
+    RIP_NS_PUT16(rrs[0].type, p);
+    *p++ = key->algorithm;
+    *p++ = labels;
+    RIP_NS_PUT32(rrs[0].ttl, p);
+    RIP_NS_PUT32(now + key->validity, p);
+    RIP_NS_PUT32(now - DNSSEC_SIG_INCEPTION_SKEW, p);
+    RIP_NS_PUT16(key->key_tag, p);
+    memcpy(p, key->signer, key->signer_len);
+    p += key->signer_len;
+
+    len = p - sig->rdata;
+    for (uint16_t i = 0; i < rr_count; i++) {
+        len += owner_len + RIP_NS_RRFIXEDSZ + rrs[i].rdata_len;
+    }
+    if (len > DNSSEC_SIGN_DATA_MAX) {
+        return -1;
+    }
+    sig->data = malloc(len);
+    CHECK_MALLOC(sig->data);
+    sig->data_len = p - sig->rdata;
+    memcpy(sig->data, sig->rdata, sig->data_len);
+
+    /* Records rdata length and rdata in canonical form, sorted. */
+    rdatas = malloc(len - sig->data_len);
+    CHECK_MALLOC(rdatas);
+    p = rdatas;
+    for (uint16_t i = 0; i < rr_count; i++) {
+        rrs_offset[i] = p - rdatas;
+        RIP_NS_PUT16(rrs[i].rdata_len, p);
+        memcpy(p, rrs[i].rdata, rrs[i].rdata_len);
+        dnssec_rdata_canonical(rrs[i].type, p);
+        p += rrs[i].rdata_len;
+    }
+    qsort_r(rrs_offset, rr_count, sizeof(size_t), dnssec_rr_cmp, rdatas);
+
+    /* Records, owner name and fixed part is same for all of them. */
+    p = sig->data + sig->data_len;
+    for (uint16_t i = 0; i < rr_count; i++) {
+        const uint8_t *rd     = rdatas + rrs_offset[i];
+        uint16_t       rd_len = (rd[0] << 8) | rd[1];
+
+        memcpy(p, owner, owner_len);
+        p += owner_len;
+        RIP_NS_PUT16(rrs[0].type, p);
+        RIP_NS_PUT16(rip_ns_c_in, p);
+        RIP_NS_PUT32(rrs[0].ttl, p);
+        memcpy(p, rd, RIP_NS_INT16SZ + rd_len);
+        p += RIP_NS_INT16SZ + rd_len;
+    }
+    free(rdatas);
+    sig->data_len = p - sig->data;
+
+    /* RRSIG record, signature is appended to rdata once signed. */
+    if (rip_ns_name_ntop(owner, (char *)sig->name, sizeof(sig->name)) < 0) {
+        free(sig->data);
+        sig->data = NULL;
+        return -1;
+    }
+    sig->rr = (rr_record_t) {
+        .name      = sig->name,
+        .name_len  = strlen((char *)sig->name),
+        .type      = rip_ns_t_rrsig,
+        .class     = rip_ns_c_in,
+        .ttl       = rrs[0].ttl,
+        .rdata_len = DNSSEC_RRSIG_FIXED_LEN + key->signer_len,
+        .rdata     = sig->rdata,
+    };
+
+    return 0;
+}
+
+/** Hash signature cache key.
+ *
+ * @param generation Zone database generation.
+ * @param rrs        First record of RRset.
+ *
+ * @return           Returns hash.
+ */
+static inline uint32_t
+dnssec_sig_hash(uint64_t generation, const rr_record_t *rrs)
+{
+    uint64_t h = ((uint64_t)(uintptr_t)rrs ^ (generation << 40) ^ generation) *
+                 0x9e3779b97f4a7c15ULL;
+
+    return h >> 32;
+}
+
+/** Initialize signature cache.
+ *
+ * @param cache Signature cache to initialize.
+ * @param size  Number of entries in cache.
+ */
+void
+dnssec_sig_cache_init(dnssec_sig_cache_t *cache, size_t size)
+{
+    size_t table_size = 16;
+
+    while (table_size < size * 2) {
+        table_size *= 2;
+    }
+    *cache = (dnssec_sig_cache_t) {
+        .size = size,
+        .mask = table_size - 1,
+    };
+    cache->entries = mem_calloc(MEM_TAG_DNSSEC, size, sizeof(dnssec_sig_t));
+    CHECK_MALLOC(cache->entries);
+    cache->table = mem_calloc(MEM_TAG_DNSSEC, table_size, sizeof(dnssec_sig_t *));
+    CHECK_MALLOC(cache->table);
+
+    for (size_t i = size; i > 0; i--) {
+        cache->entries[i - 1].hash_next = cache->free;
+        cache->free = &cache->entries[i - 1];
+    }
+}
+
+/** Release memory held by signature cache. No entry may be pending.
+ *
+ * @param cache Signature cache to clean.
+ */
+void
+dnssec_sig_cache_clean(dnssec_sig_cache_t *cache)
+{
+    for (size_t i = 0; i < cache->size; i++) {
+        free(cache->entries[i].data);
+    }
+    mem_free(MEM_TAG_DNSSEC, cache->entries);
+    mem_free(MEM_TAG_DNSSEC, cache->table);
+    *cache = (dnssec_sig_cache_t) {};
+}
+
+/** Unlink entry from signature cache LRU list.
+ *
+ * @param cache Signature cache.
+ * @param sig   Entry on LRU list.
+ */
+static void
+dnssec_sig_lru_unlink(dnssec_sig_cache_t *cache, dnssec_sig_t *sig)
+{
+    if (sig->lru_prev != NULL) {
+        sig->lru_prev->lru_next = sig->lru_next;
+    } else {
+        cache->lru_head = sig->lru_next;
+    }
+    if (sig->lru_next != NULL) {
+        sig->lru_next->lru_prev = sig->lru_prev;
+    } else {
+        cache->lru_tail = sig->lru_prev;
+    }
+    sig->lru_prev = NULL;
+    sig->lru_next = NULL;
+}
+
+/** Link entry at head of signature cache LRU list.
+ *
+ * @param cache Signature cache.
+ * @param sig   Entry not on LRU list.
+ */
+static void
+dnssec_sig_lru_push(dnssec_sig_cache_t *cache, dnssec_sig_t *sig)
+{
+    sig->lru_prev = NULL;
+    sig->lru_next = cache->lru_head;
+    if (cache->lru_head != NULL) {
+        cache->lru_head->lru_prev = sig;
+    } else {
+        cache->lru_tail = sig;
+    }
+    cache->lru_head = sig;
+}
+
+/** Remove signed (or failed) entry from signature cache and free it.
+ *
+ * @param cache Signature cache.
+ * @param sig   Entry to remove.
+ */
+static void
+dnssec_sig_cache_remove(dnssec_sig_cache_t *cache, dnssec_sig_t *sig)
+{
+    dnssec_sig_t **pp = &cache->table[dnssec_sig_hash(sig->generation, sig->rrs) &
+                                      cache->mask];
+
+    while (*pp != sig) {
+        pp = &(*pp)->hash_next;
+    }
+    *pp = sig->hash_next;
+
+    dnssec_sig_lru_unlink(cache, sig);
+    sig->state     = DNSSEC_SIG_ST_FREE;
+    sig->hash_next = cache->free;
+    cache->free    = sig;
+}
+
+/** Drop pending signature cache entry that could not be handed to a signer
+ * thread, see @ref dnssec_pool_submit().
+ *
+ * @param cache Signature cache.
+ * @param sig   Prepared pending entry.
+ */
+void
+dnssec_sig_cache_drop(dnssec_sig_cache_t *cache, dnssec_sig_t *sig)
+{
+    free(sig->data);
+    sig->data     = NULL;
+    sig->data_len = 0;
+
+    /* Pending entry is not on LRU list, link it so it is removed as any. */
+    dnssec_sig_lru_push(cache, sig);
+    dnssec_sig_cache_remove(cache, sig);
+}
+
+/** Lookup RRSIG record of an RRset in signature cache. Entry found is marked
+ * as used in current epoch. Signed entry due to be refreshed is removed,
+ * unless it was already used in current epoch.
+ *
+ * @param cache      Signature cache.
+ * @param generation Zone database generation RRset belongs to.
+ * @param rrs        First record of RRset.
+ * @param now        Current time, seconds since epoch.
+ *
+ * @return           Returns entry, in any state but free, or NULL if RRset
+ *                   has none.
+ */
+dnssec_sig_t *
+dnssec_sig_cache_get(dnssec_sig_cache_t *cache, uint64_t generation,
+                     const rr_record_t *rrs, uint32_t now)
+{
+    dnssec_sig_t *sig = cache->table[dnssec_sig_hash(generation, rrs) & cache->mask];
+
+    while (sig != NULL && (sig->rrs != rrs || sig->generation != generation)) {
+        sig = sig->hash_next;
+    }
+    if (sig == NULL || sig->state == DNSSEC_SIG_ST_PENDING) {
+        return sig;
+    }
+    if ((int32_t)(now - sig->refresh) >= 0 && sig->used_epoch != cache->epoch) {
+        dnssec_sig_cache_remove(cache, sig);
+        return NULL;
+    }
+    dnssec_sig_lru_unlink(cache, sig);
+    dnssec_sig_lru_push(cache, sig);
+    sig->used_epoch = cache->epoch;
+
+    return sig;
+}
+
+/** Add pending entry for an RRset to signature cache. Entry is taken from
+ * free entries, or least recently used entry is evicted.
+ *
+ * @param cache      Signature cache.
+ * @param generation Zone database generation RRset belongs to.
+ * @param rrs        First record of RRset.
+ *
+ * @return           Returns pending entry, or NULL if cache has no free
+ *                   entry and all entries were used in current epoch or
+ *                   are pending.
+ */
+dnssec_sig_t *
+dnssec_sig_cache_add(dnssec_sig_cache_t *cache, uint64_t generation,
+                     const rr_record_t *rrs)
+{
+    dnssec_sig_t  *sig = cache->free;
+    dnssec_sig_t **bucket;
+
+    if (sig == NULL) {
+        if (cache->lru_tail == NULL || cache->lru_tail->used_epoch == cache->epoch) {
+            return NULL;
+        }
+        dnssec_sig_cache_remove(cache, cache->lru_tail);
+        sig = cache->free;
+    }
+    cache->free = sig->hash_next;
+
+    sig->generation = generation;
+    sig->rrs        = rrs;
+    sig->state      = DNSSEC_SIG_ST_PENDING;
+    sig->used_epoch = cache->epoch;
+
+    bucket         = &cache->table[dnssec_sig_hash(generation, rrs) & cache->mask];
+    sig->hash_next = *bucket;
+    *bucket        = sig;
+
+    return sig;
+}
+
+/** Complete pending signature cache entry, once signer thread signed it (or
+ * failed to). State of entry MUST already be set to its outcome.
+ *
+ * @param cache Signature cache.
+ * @param sig   Entry that was pending.
+ */
+void
+dnssec_sig_cache_done(dnssec_sig_cache_t *cache, dnssec_sig_t *sig)
+{
+    dnssec_sig_lru_push(cache, sig);
+}
+
+/** @}*/
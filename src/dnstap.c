@@ -0,0 +1,418 @@
+/**
+ * @file dnstap.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup dnstap
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "dnstap.h"
+#include "query.h"
+#include "rip_ns_utils.h"
+
+/** Maximum length of DNS message rebuilt from query log record. */
+#define DNSTAP_WIRE_MAX 8192
+
+/** Maximum length of dnstap Message rebuilt from query log record. */
+#define DNSTAP_MESSAGE_MAX (DNSTAP_WIRE_MAX + 256)
+
+/** Protobuf wire types used. */
+#define DNSTAP_PB_VARINT  0
+#define DNSTAP_PB_LENGTH  2
+#define DNSTAP_PB_FIXED32 5
+
+/** Dnstap field numbers, see dnstap.proto. */
+#define DNSTAP_F_VERSION                 2
+#define DNSTAP_F_MESSAGE                 14
+#define DNSTAP_F_TYPE                    15
+#define DNSTAP_M_TYPE                    1
+#define DNSTAP_M_SOCKET_FAMILY           2
+#define DNSTAP_M_SOCKET_PROTOCOL         3
+#define DNSTAP_M_QUERY_ADDRESS           4
+#define DNSTAP_M_RESPONSE_ADDRESS        5
+#define DNSTAP_M_QUERY_PORT              6
+#define DNSTAP_M_RESPONSE_PORT           7
+#define DNSTAP_M_QUERY_TIME_SEC          8
+#define DNSTAP_M_QUERY_TIME_NSEC         9
+#define DNSTAP_M_QUERY_MESSAGE           10
+#define DNSTAP_M_RESPONSE_TIME_SEC       12
+#define DNSTAP_M_RESPONSE_TIME_NSEC      13
+#define DNSTAP_M_RESPONSE_MESSAGE        14
+
+/** Write 32 bit number in network order and advance buffer pointer. */
+static inline void
+dnstap_put32(unsigned char **p, uint32_t v)
+{
+    uint32_t n = htonl(v);
+
+    memcpy(*p, &n, 4);
+    *p += 4;
+}
+
+/** Write 16 bit number in network order and advance buffer pointer. */
+static inline void
+dnstap_put16(unsigned char **p, uint16_t v)
+{
+    uint16_t n = htons(v);
+
+    memcpy(*p, &n, 2);
+    *p += 2;
+}
+
+/** Write protobuf varint and advance buffer pointer. */
+static inline void
+dnstap_pb_varint(unsigned char **p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *(*p)++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *(*p)++ = v;
+}
+
+/** Write protobuf varint field and advance buffer pointer. */
+static inline void
+dnstap_pb_uint(unsigned char **p, uint32_t field, uint64_t v)
+{
+    dnstap_pb_varint(p, (field << 3) | DNSTAP_PB_VARINT);
+    dnstap_pb_varint(p, v);
+}
+
+/** Write protobuf fixed32 field and advance buffer pointer. */
+static inline void
+dnstap_pb_fixed32(unsigned char **p, uint32_t field, uint32_t v)
+{
+    dnstap_pb_varint(p, (field << 3) | DNSTAP_PB_FIXED32);
+    for (int i = 0; i < 4; i++) {
+        *(*p)++ = v >> (8 * i);
+    }
+}
+
+/** Write protobuf bytes field and advance buffer pointer. */
+static inline void
+dnstap_pb_bytes(unsigned char **p, uint32_t field, const void *data, size_t len)
+{
+    dnstap_pb_varint(p, (field << 3) | DNSTAP_PB_LENGTH);
+    dnstap_pb_varint(p, len);
+    memcpy(*p, data, len);
+    *p += len;
+}
+
+/** Write domain name in presentation format as uncompressed wire format name.
+ * If name can not be encoded root name is written.
+ * 
+ * @param p        Pointer to buffer pointer, advanced past written name.
+ * @param name     Name in presentation format, not '\0' terminated.
+ * @param name_len Length of name.
+ */
+static void
+dnstap_put_name(unsigned char **p, const char *name, size_t name_len)
+{
+    unsigned char  str[RIP_NS_MAXCDNAME * 4 + 1];
+    unsigned char *label = *p;
+
+    if (name_len < sizeof(str)) {
+        memcpy(str, name, name_len);
+        str[name_len] = '\0';
+        if (rip_ns_name_pton(str, *p, RIP_NS_MAXCDNAME) >= 0) {
+            while (*label != 0) {
+                label += *label + 1;
+            }
+            *p = label + 1;
+            return;
+        }
+    }
+    *(*p)++ = 0;
+}
+
+/** Write OPT record with EDNS options logged in query log record.
+ * 
+ * @param p        Pointer to buffer pointer, advanced past written record.
+ * @param r        Query log record.
+ * @param response Set in response, where extended rcode and client subnet
+ *                 scope are set.
+ */
+static void
+dnstap_put_opt(unsigned char **p, query_log_record_t *r, bool response)
+{
+    uint32_t       ttl = (uint32_t)r->edns_version << 16;
+    unsigned char *addr;
+    size_t         addr_len = 0;
+
+    if (r->flags & QUERY_LOG_REC_F_DO) {
+        ttl |= 0x8000;
+    }
+    if (response && r->end_code > 0xf) {
+        ttl |= (uint32_t)(r->end_code >> 4) << 24;
+    }
+
+    *(*p)++ = 0;
+    dnstap_put16(p, rip_ns_t_opt);
+    dnstap_put16(p, r->udp_resp_len);
+    dnstap_put32(p, ttl);
+    if ((r->flags & QUERY_LOG_REC_F_CS) == 0) {
+        dnstap_put16(p, 0);
+        return;
+    }
+
+    addr_len = (r->cs_source_mask + 7) / 8;
+    if (r->cs_family == 1) {
+        addr = (unsigned char *)&r->cs_ip.sin.sin_addr;
+        if (addr_len > 4) {
+            addr_len = 4;
+        }
+    } else {
+        addr = (unsigned char *)&r->cs_ip.sin6.sin6_addr;
+        if (addr_len > 16) {
+            addr_len = 16;
+        }
+    }
+    dnstap_put16(p, 8 + addr_len);
+    dnstap_put16(p, rip_ns_ext_opt_c_cs);
+    dnstap_put16(p, 4 + addr_len);
+    dnstap_put16(p, r->cs_family);
+    *(*p)++ = r->cs_source_mask;
+    *(*p)++ = response ? r->cs_scope_mask : 0;
+    memcpy(*p, addr, addr_len);
+    *p += addr_len;
+}
+
+/** Rebuild DNS query or response message from query log record.
+ * 
+ * @param r        Query log record.
+ * @param rec      Query log record, with variable length data following it.
+ * @param response Set to rebuild response, otherwise query is rebuilt.
+ * @param wire     Buffer of @ref DNSTAP_WIRE_MAX bytes to write message to.
+ * 
+ * @return         Returns length of message.
+ */
+static size_t
+dnstap_wire(query_log_record_t *r, const char *rec, bool response,
+            unsigned char *wire)
+{
+    unsigned char         *p      = wire;
+    const char            *q_name = rec + sizeof(query_log_record_t);
+    const char            *rr_ptr = q_name + r->q_name_len;
+    query_log_record_rr_t  rr;
+    bool                   opt    = (r->flags & QUERY_LOG_REC_F_EDNS) ||
+                                    r->end_code == rip_ns_r_badvers;
+    uint16_t               ancount = response ? r->answer_count : 0;
+
+    /* Header. */
+    dnstap_put16(&p, r->id);
+    *p++ = (response ? 0x84 : 0) |
+           ((r->flags & QUERY_LOG_REC_F_TC) && !response ? 0x02 : 0) |
+           ((r->flags & QUERY_LOG_REC_F_RD) ? 0x01 : 0);
+    *p++ = response ? (r->end_code & 0xf) : 0;
+    dnstap_put16(&p, r->q_name_len > 0 ? 1 : 0);
+    dnstap_put16(&p, ancount);
+    dnstap_put16(&p, 0);
+    dnstap_put16(&p, opt ? 1 : 0);
+
+    /* Question. */
+    if (r->q_name_len > 0) {
+        dnstap_put_name(&p, q_name, r->q_name_len);
+        dnstap_put16(&p, r->q_type);
+        dnstap_put16(&p, r->q_class);
+    }
+
+    /* Answers. */
+    for (int i = 0; i < ancount; i++) {
+        memcpy(&rr, rr_ptr, sizeof(query_log_record_rr_t));
+        rr_ptr += sizeof(query_log_record_rr_t);
+        dnstap_put_name(&p, rr_ptr, rr.name_len);
+        rr_ptr += rr.name_len;
+        dnstap_put16(&p, rr.type);
+        dnstap_put16(&p, rr.class);
+        dnstap_put32(&p, rr.ttl);
+        dnstap_put16(&p, rr.rdata_len);
+        memcpy(p, rr_ptr, rr.rdata_len);
+        p      += rr.rdata_len;
+        rr_ptr += rr.rdata_len;
+    }
+
+    if (opt) {
+        dnstap_put_opt(&p, r, response);
+    }
+    return p - wire;
+}
+
+/** Write Frame Streams data frame with dnstap message of query log record.
+ * 
+ * @param r        Query log record.
+ * @param rec      Query log record, with variable length data following it.
+ * @param type     Dnstap message type.
+ * @param buf      Buffer to write frame to.
+ * 
+ * @return         Returns length of frame.
+ */
+static size_t
+dnstap_frame(query_log_record_t *r, const char *rec, dnstap_message_type_t type,
+             unsigned char *buf)
+{
+    unsigned char  wire[DNSTAP_WIRE_MAX];
+    unsigned char  msg[DNSTAP_MESSAGE_MAX];
+    unsigned char *m = msg;
+    unsigned char *p = buf + 4;
+    size_t         wire_len;
+    bool           response = type == DNSTAP_MESSAGE_AUTH_RESPONSE;
+
+    /* Message. */
+    dnstap_pb_uint(&m, DNSTAP_M_TYPE, type);
+    if (r->client_ip.sa.sa_family == AF_INET) {
+        dnstap_pb_uint(&m, DNSTAP_M_SOCKET_FAMILY, 1);
+        dnstap_pb_uint(&m, DNSTAP_M_SOCKET_PROTOCOL, r->protocol == 0 ? 1 : 2);
+        dnstap_pb_bytes(&m, DNSTAP_M_QUERY_ADDRESS, &r->client_ip.sin.sin_addr, 4);
+        dnstap_pb_bytes(&m, DNSTAP_M_RESPONSE_ADDRESS, &r->local_ip.sin.sin_addr, 4);
+        dnstap_pb_uint(&m, DNSTAP_M_QUERY_PORT, ntohs(r->client_ip.sin.sin_port));
+        dnstap_pb_uint(&m, DNSTAP_M_RESPONSE_PORT, ntohs(r->local_ip.sin.sin_port));
+    } else {
+        dnstap_pb_uint(&m, DNSTAP_M_SOCKET_FAMILY, 2);
+        dnstap_pb_uint(&m, DNSTAP_M_SOCKET_PROTOCOL, r->protocol == 0 ? 1 : 2);
+        dnstap_pb_bytes(&m, DNSTAP_M_QUERY_ADDRESS, &r->client_ip.sin6.sin6_addr, 16);
+        dnstap_pb_bytes(&m, DNSTAP_M_RESPONSE_ADDRESS, &r->local_ip.sin6.sin6_addr, 16);
+        dnstap_pb_uint(&m, DNSTAP_M_QUERY_PORT, ntohs(r->client_ip.sin6.sin6_port));
+        dnstap_pb_uint(&m, DNSTAP_M_RESPONSE_PORT, ntohs(r->local_ip.sin6.sin6_port));
+    }
+    dnstap_pb_uint(&m, DNSTAP_M_QUERY_TIME_SEC, r->start_time.tv_sec);
+    dnstap_pb_fixed32(&m, DNSTAP_M_QUERY_TIME_NSEC, r->start_time.tv_nsec);
+
+    wire_len = dnstap_wire(r, rec, response, wire);
+    if (response) {
+        dnstap_pb_uint(&m, DNSTAP_M_RESPONSE_TIME_SEC, r->end_time.tv_sec);
+        dnstap_pb_fixed32(&m, DNSTAP_M_RESPONSE_TIME_NSEC, r->end_time.tv_nsec);
+        dnstap_pb_bytes(&m, DNSTAP_M_RESPONSE_MESSAGE, wire, wire_len);
+    } else {
+        dnstap_pb_bytes(&m, DNSTAP_M_QUERY_MESSAGE, wire, wire_len);
+    }
+
+    /* Dnstap. */
+    dnstap_pb_bytes(&p, DNSTAP_F_VERSION, DNSTAP_VERSION, strlen(DNSTAP_VERSION));
+    dnstap_pb_bytes(&p, DNSTAP_F_MESSAGE, msg, m - msg);
+    dnstap_pb_uint(&p, DNSTAP_F_TYPE, 1);
+
+    /* Data frame length. */
+    m = buf;
+    dnstap_put32(&m, p - buf - 4);
+
+    return p - buf;
+}
+
+/** Write Frame Streams control frame.
+ * 
+ * @param buf          Buffer of at least @ref DNSTAP_FSTRM_CONTROL_MAX bytes
+ *                     to write frame to.
+ * @param type         Control frame type.
+ * @param content_type Set to include dnstap content type field.
+ * 
+ * @return             Returns length of frame.
+ */
+size_t
+dnstap_control_frame(char *buf, dnstap_fstrm_control_t type, bool content_type)
+{
+    unsigned char *p   = (unsigned char *)buf;
+    size_t         len = 4;
+
+    if (content_type) {
+        len += 8 + strlen(DNSTAP_CONTENT_TYPE);
+    }
+    dnstap_put32(&p, 0);
+    dnstap_put32(&p, len);
+    dnstap_put32(&p, type);
+    if (content_type) {
+        dnstap_put32(&p, DNSTAP_FSTRM_FIELD_CONTENT_TYPE);
+        dnstap_put32(&p, strlen(DNSTAP_CONTENT_TYPE));
+        memcpy(p, DNSTAP_CONTENT_TYPE, strlen(DNSTAP_CONTENT_TYPE));
+        p += strlen(DNSTAP_CONTENT_TYPE);
+    }
+    return (char *)p - buf;
+}
+
+/** Get type of Frame Streams control frame.
+ * 
+ * @param buf Buffer with control frame, starting with escape sequence.
+ * @param len Length of data in buf.
+ * 
+ * @return    Returns control frame type, or -1 if buf does not hold a complete
+ *            control frame.
+ */
+int
+dnstap_control_frame_type(const char *buf, size_t len)
+{
+    uint32_t escape;
+    uint32_t frame_len;
+    uint32_t type;
+
+    if (len < 12) {
+        return -1;
+    }
+    memcpy(&escape, buf, 4);
+    memcpy(&frame_len, buf + 4, 4);
+    memcpy(&type, buf + 8, 4);
+    if (escape != 0 || ntohl(frame_len) < 4 || ntohl(frame_len) > len - 8) {
+        return -1;
+    }
+    return ntohl(type);
+}
+
+/** Convert binary query log record to dnstap Frame Streams data frames, one
+ * with AUTH_QUERY message and, if response was sent, one with AUTH_RESPONSE
+ * message.
+ * 
+ * @param rec     Binary query log record, see @ref query_log_record_t.
+ * @param buf     Buffer to write frames to.
+ * @param buf_len Length of buffer (available space).
+ *
+ * @return        Returns number of bytes added to buf on success,
+ *                otherwise returns 0 and error occurred (ie not enough
+ *                room in buffer) and nothing was added to buf.
+ */
+int
+query_log_record_to_dnstap(const char *rec, char *buf, size_t buf_len)
+{
+    query_log_record_t  r;
+    unsigned char      *p = (unsigned char *)buf;
+
+    /* Same requirement as text conversion, two frames always fit. */
+    if (buf_len < QUERY_LOG_BUF_MIN_SPACE) {
+        return 0;
+    }
+
+    /* Records are not aligned in log buffer, copy fixed size part out. */
+    memcpy(&r, rec, sizeof(query_log_record_t));
+
+    p += dnstap_frame(&r, rec, DNSTAP_MESSAGE_AUTH_QUERY, p);
+    if (r.end_code >= 0) {
+        p += dnstap_frame(&r, rec, DNSTAP_MESSAGE_AUTH_RESPONSE, p);
+    }
+    return (char *)p - buf;
+}
+
+/** @}*/
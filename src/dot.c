@@ -0,0 +1,581 @@
+/**
+ * @file dot.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup dot
+ *  @{
+ */
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/kdf.h>
+
+#include "dot.h"
+#include "utils.h"
+
+/** Structure holds TLS 1.3 application traffic secrets of a connection, as
+ * reported by OpenSSL key log callback.
+ */
+typedef struct dot_secrets_s {
+    /** Client application traffic secret, connection receive key. */
+    unsigned char client[DOT_TLS_SECRET_MAX];
+
+    /** Length of client secret, 0 if not reported. */
+    size_t client_len;
+
+    /** Server application traffic secret, connection send key. */
+    unsigned char server[DOT_TLS_SECRET_MAX];
+
+    /** Length of server secret, 0 if not reported. */
+    size_t server_len;
+} dot_secrets_t;
+
+/** Store traffic secret from a key log line into buffer.
+ *
+ * @param line Key log line past its label: client random and secret, space
+ *             separated and hex encoded.
+ * @param buf  Buffer of DOT_TLS_SECRET_MAX bytes where to store secret.
+ *
+ * @return     Returns length of secret, 0 if line could not be parsed.
+ */
+static size_t
+dot_keylog_secret(const char *line, unsigned char *buf)
+{
+    const char *hex = strchr(line, ' ');
+    size_t      len = 0;
+
+    if (hex == NULL) {
+        return 0;
+    }
+    hex++;
+    len = strlen(hex) / 2;
+    if (len == 0 || len > DOT_TLS_SECRET_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (sscanf(&hex[i * 2], "%2hhx", &buf[i]) != 1) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/** OpenSSL key log callback, picks up application traffic secrets into
+ * connection @ref dot_secrets_t (SSL app data), handshake secrets are
+ * ignored.
+ *
+ * @param ssl  TLS connection.
+ * @param line Key log line in NSS key log format.
+ */
+static void
+dot_keylog(const SSL *ssl, const char *line)
+{
+    dot_secrets_t *secrets = SSL_get_app_data(ssl);
+
+    if (secrets == NULL) {
+        return;
+    }
+    if (strncmp(line, "CLIENT_TRAFFIC_SECRET_0 ", 24) == 0) {
+        secrets->client_len = dot_keylog_secret(line + 24, secrets->client);
+    } else if (strncmp(line, "SERVER_TRAFFIC_SECRET_0 ", 24) == 0) {
+        secrets->server_len = dot_keylog_secret(line + 24, secrets->server);
+    }
+}
+
+/** Derive TLS 1.3 key or IV from traffic secret, HKDF-Expand-Label with
+ * empty context (RFC 8446 section 7.1).
+ *
+ * @param digest     Digest name of cipher suite hash, "SHA256" or "SHA384".
+ * @param secret     Traffic secret.
+ * @param secret_len Length of traffic secret.
+ * @param label      Label, "key" or "iv".
+ * @param out        Where to store derived key or IV.
+ * @param out_len    Length of key or IV to derive.
+ *
+ * @return           Returns 0 on success, otherwise -1.
+ */
+static int
+dot_hkdf_expand_label(const char *digest, const unsigned char *secret,
+                      size_t secret_len, const char *label,
+                      unsigned char *out, size_t out_len)
+{
+    unsigned char info[32];
+    size_t        label_len = strlen(label);
+    size_t        info_len  = 0;
+    int           mode      = EVP_KDF_HKDF_MODE_EXPAND_ONLY;
+    int           ret       = 0;
+    EVP_KDF      *kdf       = NULL;
+    EVP_KDF_CTX  *kctx      = NULL;
+
+    /* HkdfLabel: length, label prefixed with "tls13 ", empty context. */
+    info[info_len++] = out_len >> 8;
+    info[info_len++] = out_len & 0xff;
+    info[info_len++] = 6 + label_len;
+    memcpy(&info[info_len], "tls13 ", 6);
+    info_len += 6;
+    memcpy(&info[info_len], label, label_len);
+    info_len += label_len;
+    info[info_len++] = 0;
+
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_int(OSSL_KDF_PARAM_MODE, &mode),
+        OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, (char *)digest, 0),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, (void *)secret, secret_len),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, info, info_len),
+        OSSL_PARAM_construct_end(),
+    };
+
+    kdf = EVP_KDF_fetch(NULL, OSSL_KDF_NAME_HKDF, NULL);
+    if (kdf == NULL) {
+        return -1;
+    }
+    kctx = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);
+    if (kctx == NULL) {
+        return -1;
+    }
+    ret = EVP_KDF_derive(kctx, out, out_len, params);
+    EVP_KDF_CTX_free(kctx);
+
+    return ret == 1 ? 0 : -1;
+}
+
+/** Build kernel TLS crypto info for one direction of a TLS 1.3 connection,
+ * record sequence number starts at 0 as it does for first application
+ * traffic key.
+ *
+ * @param info       Crypto info to populate.
+ * @param cipher     TLS 1.3 cipher suite ID, one of DOT_TLS_CIPHERSUITES.
+ * @param secret     Application traffic secret of direction.
+ * @param secret_len Length of traffic secret.
+ *
+ * @return           Returns 0 on success, -1 if cipher suite is not supported
+ *                   or key could not be derived.
+ */
+int
+dot_ktls_info(dot_ktls_info_t *info, uint16_t cipher,
+              const unsigned char *secret, size_t secret_len)
+{
+    unsigned char key[32];
+    unsigned char iv[DOT_TLS_IV_LEN];
+    const char   *digest  = "SHA256";
+    size_t        key_len = 0;
+
+    *info = (dot_ktls_info_t) { };
+
+    switch (cipher) {
+    case 0x1301:
+        /* TLS_AES_128_GCM_SHA256 */
+        key_len = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+        break;
+    case 0x1302:
+        /* TLS_AES_256_GCM_SHA384 */
+        key_len = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+        digest  = "SHA384";
+        break;
+    case 0x1303:
+        /* TLS_CHACHA20_POLY1305_SHA256 */
+        key_len = TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE;
+        break;
+    default:
+        return -1;
+    }
+
+    if (dot_hkdf_expand_label(digest, secret, secret_len, "key", key, key_len) != 0 ||
+        dot_hkdf_expand_label(digest, secret, secret_len, "iv", iv, sizeof(iv)) != 0) {
+        return -1;
+    }
+
+    info->crypto.info.version = TLS_1_3_VERSION;
+    switch (cipher) {
+    case 0x1301:
+        /* 12 byte IV is split into 4 byte salt and 8 byte IV. */
+        info->crypto.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        memcpy(info->crypto.aes_gcm_128.key, key, key_len);
+        memcpy(info->crypto.aes_gcm_128.salt, iv, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+        memcpy(info->crypto.aes_gcm_128.iv, &iv[TLS_CIPHER_AES_GCM_128_SALT_SIZE],
+               TLS_CIPHER_AES_GCM_128_IV_SIZE);
+        info->len = sizeof(info->crypto.aes_gcm_128);
+        break;
+    case 0x1302:
+        info->crypto.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        memcpy(info->crypto.aes_gcm_256.key, key, key_len);
+        memcpy(info->crypto.aes_gcm_256.salt, iv, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+        memcpy(info->crypto.aes_gcm_256.iv, &iv[TLS_CIPHER_AES_GCM_256_SALT_SIZE],
+               TLS_CIPHER_AES_GCM_256_IV_SIZE);
+        info->len = sizeof(info->crypto.aes_gcm_256);
+        break;
+    default:
+        info->crypto.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+        memcpy(info->crypto.chacha20_poly1305.key, key, key_len);
+        memcpy(info->crypto.chacha20_poly1305.iv, iv, TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE);
+        info->len = sizeof(info->crypto.chacha20_poly1305);
+        break;
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+
+    return 0;
+}
+
+/** Check if kernel TLS is available, socket option TCP_ULP "tls" is accepted
+ * on a (not connected) TCP socket only if tls kernel module is present.
+ *
+ * @return Returns true if kernel TLS is available, otherwise false.
+ */
+bool
+dot_ktls_available(void)
+{
+    int fd  = socket(AF_INET, SOCK_STREAM, 0);
+    int ret = 0;
+
+    if (fd < 0) {
+        return false;
+    }
+    ret = setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls"));
+    if (ret != 0 && errno == ENOENT) {
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    return true;
+}
+
+/** Populate error buffer with message followed by OpenSSL error reason.
+ *
+ * @param err_buf     Buffer where to store error message.
+ * @param err_buf_len Length of error buffer.
+ * @param msg         Message.
+ * @param path        File path message applies to.
+ */
+static void
+dot_ctx_err(char *err_buf, size_t err_buf_len, const char *msg, const char *path)
+{
+    char reason[256];
+
+    ERR_error_string_n(ERR_get_error(), reason, sizeof(reason));
+    snprintf(err_buf, err_buf_len, "DNS over TLS: %s \"%s\", %s", msg, path, reason);
+    ERR_clear_error();
+}
+
+/** Load TLS context DoT handshake threads use: TLS 1.3 only, cipher suites
+ * kernel TLS supports, no session tickets, and certificate chain and key
+ * from files set by configuration settings "dot_cert_file" and
+ * "dot_key_file". Kernel TLS MUST be available.
+ *
+ * @param ctx         TLS context to load.
+ * @param cfg         Configuration with settings.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf.
+ */
+int
+dot_ctx_load(dot_ctx_t *ctx, config_t *cfg, char *err_buf, size_t err_buf_len)
+{
+    *ctx = (dot_ctx_t) {
+        .timeout_ms = cfg->dot_handshake_timeout,
+    };
+
+    if (!dot_ktls_available()) {
+        snprintf(err_buf, err_buf_len, "DNS over TLS requires kernel TLS, "
+                 "tls kernel module is not available");
+        return -1;
+    }
+
+    ctx->ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx->ssl_ctx == NULL) {
+        dot_ctx_err(err_buf, err_buf_len, "could not create TLS context", "");
+        return -1;
+    }
+    SSL_CTX_set_min_proto_version(ctx->ssl_ctx, TLS1_3_VERSION);
+    SSL_CTX_set_max_proto_version(ctx->ssl_ctx, TLS1_3_VERSION);
+    SSL_CTX_set_ciphersuites(ctx->ssl_ctx, DOT_TLS_CIPHERSUITES);
+    SSL_CTX_set_num_tickets(ctx->ssl_ctx, 0);
+    SSL_CTX_set_keylog_callback(ctx->ssl_ctx, dot_keylog);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx->ssl_ctx, cfg->dot_cert_file) != 1) {
+        dot_ctx_err(err_buf, err_buf_len, "could not load certificate", cfg->dot_cert_file);
+    } else if (SSL_CTX_use_PrivateKey_file(ctx->ssl_ctx, cfg->dot_key_file,
+                                           SSL_FILETYPE_PEM) != 1) {
+        dot_ctx_err(err_buf, err_buf_len, "could not load private key", cfg->dot_key_file);
+    } else if (SSL_CTX_check_private_key(ctx->ssl_ctx) != 1) {
+        dot_ctx_err(err_buf, err_buf_len, "private key does not match certificate",
+                    cfg->dot_key_file);
+    } else {
+        return 0;
+    }
+
+    SSL_CTX_free(ctx->ssl_ctx);
+    ctx->ssl_ctx = NULL;
+    return -1;
+}
+
+/** Install TLS 1.3 traffic keys of connection into kernel.
+ *
+ * @param fd      Connection socket.
+ * @param cipher  TLS 1.3 cipher suite ID.
+ * @param secrets Connection traffic secrets.
+ *
+ * @return        Returns 0 on success, otherwise -1.
+ */
+static int
+dot_ktls_install(int fd, uint16_t cipher, dot_secrets_t *secrets)
+{
+    dot_ktls_info_t tx;
+    dot_ktls_info_t rx;
+    int             ret = -1;
+
+    if (dot_ktls_info(&tx, cipher, secrets->server, secrets->server_len) == 0 &&
+        dot_ktls_info(&rx, cipher, secrets->client, secrets->client_len) == 0 &&
+        setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+        setsockopt(fd, SOL_TLS, TLS_TX, &tx.crypto, tx.len) == 0 &&
+        setsockopt(fd, SOL_TLS, TLS_RX, &rx.crypto, rx.len) == 0) {
+        ret = 0;
+    }
+    OPENSSL_cleanse(&tx, sizeof(tx));
+    OPENSSL_cleanse(&rx, sizeof(rx));
+
+    return ret;
+}
+
+/** Do TLS handshake on a DoT connection, and switch connection to kernel
+ * TLS once done. Socket is non blocking, handshake waits for it in poll()
+ * up to handshake timeout.
+ *
+ * @param ctx TLS context.
+ * @param fd  Connection socket.
+ *
+ * @return    Returns state connection is to be in:
+ *            - TCP_CONN_ST_TLS_HANDSHAKE: kernel TLS is installed,
+ *            - TCP_CONN_ST_TLS_HANDSHAKE_ERR: handshake failed or timed out,
+ *            - TCP_CONN_ST_TLS_KTLS_ERR: kernel TLS could not be installed.
+ */
+static conn_tcp_state_t
+dot_handshake(dot_ctx_t *ctx, int fd)
+{
+    dot_secrets_t    secrets  = { };
+    struct pollfd    pfd      = { .fd = fd };
+    conn_tcp_state_t state    = TCP_CONN_ST_TLS_HANDSHAKE_ERR;
+    uint64_t         deadline = utl_clock_monotonic_ms_fatal() + ctx->timeout_ms;
+    uint64_t         now      = 0;
+    SSL             *ssl      = NULL;
+    int              ret      = 0;
+
+    ssl = SSL_new(ctx->ssl_ctx);
+    if (ssl == NULL) {
+        ERR_clear_error();
+        return state;
+    }
+    SSL_set_app_data(ssl, &secrets);
+    SSL_set_fd(ssl, fd);
+
+    while ((ret = SSL_accept(ssl)) != 1) {
+        switch (SSL_get_error(ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+            pfd.events = POLLIN;
+            break;
+        case SSL_ERROR_WANT_WRITE:
+            pfd.events = POLLOUT;
+            break;
+        default:
+            goto out;
+        }
+        now = utl_clock_monotonic_ms_fatal();
+        if (now >= deadline) {
+            goto out;
+        }
+        ret = poll(&pfd, 1, deadline - now);
+        if (ret == 0 || (ret < 0 && errno != EINTR)) {
+            goto out;
+        }
+    }
+
+    /* Kernel takes over from next record on, OpenSSL must not hold any. */
+    if (SSL_has_pending(ssl) || secrets.client_len == 0 || secrets.server_len == 0) {
+        goto out;
+    }
+    state = TCP_CONN_ST_TLS_KTLS_ERR;
+    if (dot_ktls_install(fd, SSL_CIPHER_get_protocol_id(SSL_get_current_cipher(ssl)),
+                         &secrets) == 0) {
+        state = TCP_CONN_ST_TLS_HANDSHAKE;
+    }
+
+out:
+    /* Connection socket is left open, SSL_free() does not write to it. */
+    SSL_free(ssl);
+    ERR_clear_error();
+    OPENSSL_cleanse(&secrets, sizeof(secrets));
+
+    return state;
+}
+
+/** TLS handshake thread function. Does handshake on each connection queued
+ * by vectorloop, sets its state to handshake outcome and queues it back,
+ * waking vectorloop up.
+ *
+ * @param arg Handshake thread object, @ref dot_worker_t.
+ *
+ * @return    NULL pointer returned upon termination.
+ */
+static void *
+dot_worker_run(void *arg)
+{
+    dot_worker_t *w    = (dot_worker_t *)arg;
+    conn_t       *conn = NULL;
+    eventfd_t     val  = 0;
+
+    LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+
+    while (1) {
+        while (lfds711_queue_bss_dequeue(&w->req_qbsss, NULL, (void **)&conn) != 0) {
+            conn->conn.tcp->state = dot_handshake(w->ctx, conn->fd);
+
+            /* Result queue has room, vectorloop limits connections in flight. */
+            lfds711_queue_bss_enqueue(&w->res_qbsss, NULL, conn);
+            eventfd_write(w->wake_fd, 1);
+        }
+        /* Block until vectorloop queues more requests. */
+        eventfd_read(w->req_fd, &val);
+    }
+
+    return NULL;
+}
+
+/** Start TLS handshake threads of a vectorloop. Threads are not bound to
+ * vectorloop CPU, so handshakes do not take CPU time from it.
+ *
+ * @param pool    Handshake thread pool to start.
+ * @param ctx     TLS context.
+ * @param count   Number of handshake threads.
+ * @param wake_fd Eventfd of vectorloop, written to when a handshake is done.
+ */
+void
+dot_pool_start(dot_pool_t *pool, dot_ctx_t *ctx, size_t count, int wake_fd)
+{
+    *pool = (dot_pool_t) {
+        .count = count,
+    };
+    pool->workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(dot_worker_t) * count);
+    CHECK_MALLOC(pool->workers);
+
+    for (size_t i = 0; i < count; i++) {
+        dot_worker_t *w = &pool->workers[i];
+
+        *w = (dot_worker_t) {
+            .wake_fd = wake_fd,
+            .ctx     = ctx,
+        };
+        lfds711_queue_bss_init_valid_on_current_logical_core(&w->req_qbsss,
+            w->req_qbsse, DOT_HANDSHAKE_QUEUE_LEN, NULL);
+        lfds711_queue_bss_init_valid_on_current_logical_core(&w->res_qbsss,
+            w->res_qbsse, DOT_HANDSHAKE_QUEUE_LEN, NULL);
+
+        w->req_fd = eventfd(0, EFD_CLOEXEC);
+        if (w->req_fd < 0) {
+            fprintf(stderr, "dot_pool_start() err no %d, error message: %s\n",
+                    errno, strerror(errno));
+            assert(0);
+        }
+        if (pthread_create(&w->thread, NULL, dot_worker_run, w) != 0) {
+            fprintf(stderr, "Could not create TLS handshake thread\n");
+            exit(-1);
+        }
+    }
+}
+
+/** Hand DoT connection to least busy handshake thread. Only vectorloop
+ * owning the pool may call this, and it MUST not touch connection object
+ * until it is returned by @ref dot_pool_done().
+ *
+ * @param pool Handshake thread pool.
+ * @param conn DoT connection, its socket is not registered with epoll.
+ *
+ * @return     Returns true if connection was queued, false if queues of all
+ *             handshake threads are full.
+ */
+bool
+dot_pool_submit(dot_pool_t *pool, conn_t *conn)
+{
+    dot_worker_t *w = &pool->workers[0];
+
+    for (size_t i = 1; i < pool->count; i++) {
+        if (pool->workers[i].in_flight < w->in_flight) {
+            w = &pool->workers[i];
+        }
+    }
+    if (w->in_flight >= DOT_HANDSHAKE_QUEUE_LEN - 1 ||
+        lfds711_queue_bss_enqueue(&w->req_qbsss, NULL, conn) == 0) {
+        return false;
+    }
+    w->in_flight++;
+    pool->in_flight++;
+    eventfd_write(w->req_fd, 1);
+
+    return true;
+}
+
+/** Get a DoT connection handshake was done on. Connection state is set to
+ * handshake outcome, TCP_CONN_ST_TLS_HANDSHAKE if connection was switched
+ * to kernel TLS, otherwise an error state.
+ *
+ * @param pool Handshake thread pool.
+ *
+ * @return     Returns connection, NULL if there are none.
+ */
+conn_t *
+dot_pool_done(dot_pool_t *pool)
+{
+    conn_t *conn = NULL;
+
+    if (pool->in_flight == 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        dot_worker_t *w = &pool->workers[i];
+
+        if (w->in_flight > 0 &&
+            lfds711_queue_bss_dequeue(&w->res_qbsss, NULL, (void **)&conn) != 0) {
+            w->in_flight--;
+            pool->in_flight--;
+            return conn;
+        }
+    }
+
+    return NULL;
+}
+
+/** @}*/
@@ -0,0 +1,487 @@
+/**
+ * @file ecs_map.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup ecs_map
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecs_map.h"
+#include "utils.h"
+
+/** Maximum length of a single line in ECS map file. */
+#define ECS_MAP_FILE_LINE_MAX 1024
+
+/** Maximum number of tokens (fields) on a single ECS map file line. */
+#define ECS_MAP_FILE_TOKENS_MAX 2
+
+/** Structure describes a binary trie node used while ECS map is built. */
+typedef struct ecs_map_trie_node_s {
+    /** Index of child nodes for next address bit 0 and 1, 0 means there is
+     * no child (root node is never a child).
+     */
+    uint32_t child[2];
+
+    /** View of prefix node represents, 0 means node is not a prefix from
+     * map file but only an ancestor of one.
+     */
+    uint16_t view;
+} ecs_map_trie_node_t;
+
+/** Structure describes binary trie of one address family. */
+typedef struct ecs_map_trie_s {
+    /** Array of trie nodes, first node is the root. */
+    ecs_map_trie_node_t *nodes;
+
+    /** Number of nodes in use. */
+    uint32_t count;
+
+    /** Number of nodes allocated. */
+    uint32_t size;
+} ecs_map_trie_t;
+
+/** Add a node to binary trie.
+ *
+ * @param trie Trie to add node to.
+ *
+ * @return     Returns index of added node.
+ */
+static uint32_t
+ecs_map_trie_node_add(ecs_map_trie_t *trie)
+{
+    if (trie->count == trie->size) {
+        trie->size = trie->size == 0 ? 64 : trie->size * 2;
+        trie->nodes = realloc(trie->nodes, sizeof(ecs_map_trie_node_t) * trie->size);
+        CHECK_MALLOC(trie->nodes);
+    }
+    trie->nodes[trie->count] = (ecs_map_trie_node_t) {};
+    return trie->count++;
+}
+
+/** Insert a prefix into binary trie.
+ *
+ * @param trie Trie to insert prefix into.
+ * @param addr Prefix address, network order.
+ * @param len  Prefix length in bits.
+ * @param view View prefix maps to.
+ *
+ * @return     Returns 0 on success, or -1 if prefix is already in trie.
+ */
+static int
+ecs_map_trie_insert(ecs_map_trie_t *trie, const uint8_t *addr, uint8_t len, uint16_t view)
+{
+    uint32_t node = 0;
+
+    if (trie->count == 0) {
+        ecs_map_trie_node_add(trie);
+    }
+    for (uint8_t depth = 0; depth < len; depth++) {
+        uint8_t bit = (addr[depth / 8] >> (7 - depth % 8)) & 1;
+
+        if (trie->nodes[node].child[bit] == 0) {
+            uint32_t child = ecs_map_trie_node_add(trie);
+            trie->nodes[node].child[bit] = child;
+        }
+        node = trie->nodes[node].child[bit];
+    }
+    if (trie->nodes[node].view != 0) {
+        return -1;
+    }
+    trie->nodes[node].view = view;
+    return 0;
+}
+
+/** Add a chunk to ECS map table.
+ *
+ * @param map         ECS map to add chunk to.
+ * @param chunks_size Number of chunks allocated.
+ * @param entry       Value to initialize chunk entries with.
+ *
+ * @return            Returns index of added chunk.
+ */
+static uint32_t
+ecs_map_chunk_add(ecs_map_t *map, size_t *chunks_size, uint32_t entry)
+{
+    uint32_t *chunk;
+
+    if (map->chunks_count == *chunks_size) {
+        *chunks_size = *chunks_size == 0 ? 16 : *chunks_size * 2;
+        map->chunks = realloc(map->chunks,
+                              sizeof(uint32_t) * ECS_MAP_CHUNK_SIZE * *chunks_size);
+        CHECK_MALLOC(map->chunks);
+    }
+    chunk = map->chunks + (size_t)map->chunks_count * ECS_MAP_CHUNK_SIZE;
+    for (int i = 0; i < ECS_MAP_CHUNK_SIZE; i++) {
+        chunk[i] = entry;
+    }
+    return map->chunks_count++;
+}
+
+/** Set ECS map table entries covering a region of address space.
+ *
+ * Regions set MUST be disjoint. Chunks are added along the way for regions
+ * longer than the stride of table level they fall into.
+ *
+ * @param map         ECS map to update.
+ * @param chunks_size Number of chunks allocated.
+ * @param root        Table root of region address family.
+ * @param addr        Region address, bits past region length MUST be 0.
+ * @param len         Region length in bits.
+ * @param leaf        Leaf entry to set.
+ */
+static void
+ecs_map_table_set(ecs_map_t *map, size_t *chunks_size, uint32_t *root,
+                  const uint8_t *addr, uint8_t len, uint32_t leaf)
+{
+    uint32_t *table = root;
+    uint32_t  index = addr[0] << 8 | addr[1];
+    uint8_t   bits  = 16;
+
+    for (size_t byte = 2; len > bits; byte++) {
+        uint32_t entry = table[index];
+
+        if (!(entry & ECS_MAP_F_CHILD)) {
+            /* Adding a chunk may move chunks, so locate table again. */
+            ptrdiff_t offset = table == root ? -1 : table - map->chunks;
+            uint32_t  chunk  = ecs_map_chunk_add(map, chunks_size, entry);
+
+            table = offset < 0 ? root : map->chunks + offset;
+            entry = ECS_MAP_F_CHILD | chunk;
+            table[index] = entry;
+        }
+        table = map->chunks + (size_t)(entry & ~ECS_MAP_F_CHILD) * ECS_MAP_CHUNK_SIZE;
+        index = addr[byte];
+        bits += 8;
+    }
+    for (uint32_t i = 0; i < (1U << (bits - len)); i++) {
+        table[index + i] = leaf;
+    }
+}
+
+/** Walk binary trie and set ECS map table entries for each disjoint region
+ * of address space.
+ *
+ * A region is either a trie leaf, or the side of a trie node that has no
+ * child. Addresses of a region all resolve to the same view, and no
+ * shorter prefix of region has that property, so region length is the
+ * scope prefix length.
+ *
+ * @param map         ECS map to update.
+ * @param chunks_size Number of chunks allocated.
+ * @param root        Table root of trie address family.
+ * @param trie        Trie to walk.
+ * @param node        Index of trie node to walk from.
+ * @param addr        Address of node, bits past depth are 0. Modified during
+ *                    walk and restored on return.
+ * @param depth       Depth of node (prefix length).
+ * @param view        View of closest ancestor prefix.
+ */
+static void
+ecs_map_table_build(ecs_map_t *map, size_t *chunks_size, uint32_t *root,
+                    ecs_map_trie_t *trie, uint32_t node, uint8_t *addr,
+                    uint8_t depth, uint16_t view)
+{
+    uint32_t child[2] = { trie->nodes[node].child[0], trie->nodes[node].child[1] };
+
+    if (trie->nodes[node].view != 0) {
+        view = trie->nodes[node].view;
+    }
+    if (child[0] == 0 && child[1] == 0) {
+        ecs_map_table_set(map, chunks_size, root, addr, depth, (uint32_t)view << 8 | depth);
+        return;
+    }
+    for (int bit = 0; bit < 2; bit++) {
+        if (bit == 1) {
+            addr[depth / 8] |= 0x80 >> (depth % 8);
+        }
+        if (child[bit] != 0) {
+            ecs_map_table_build(map, chunks_size, root, trie, child[bit], addr,
+                                depth + 1, view);
+        } else {
+            ecs_map_table_set(map, chunks_size, root, addr, depth + 1,
+                              (uint32_t)view << 8 | (depth + 1));
+        }
+        if (bit == 1) {
+            addr[depth / 8] &= ~(0x80 >> (depth % 8));
+        }
+    }
+}
+
+/** Find view by label, adding it if not yet present.
+ *
+ * @param map   ECS map to lookup view in.
+ * @param label Presentation format view label.
+ *
+ * @return      Returns view number (index + 1), or 0 if label is invalid or
+ *              there are too many views.
+ */
+static uint16_t
+ecs_map_view_get(ecs_map_t *map, const char *label)
+{
+    size_t        len = strlen(label);
+    unsigned char wire[RIP_NS_MAXLABEL + 1];
+
+    if (len == 0 || len > RIP_NS_MAXLABEL) {
+        return 0;
+    }
+    wire[0] = len;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)label[i]) && label[i] != '-' && label[i] != '_') {
+            return 0;
+        }
+        wire[i + 1] = tolower((unsigned char)label[i]);
+    }
+    for (uint16_t i = 0; i < map->views_count; i++) {
+        if (memcmp(map->views[i], wire, len + 1) == 0) {
+            return i + 1;
+        }
+    }
+    if (map->views_count == ECS_MAP_VIEWS_MAX) {
+        return 0;
+    }
+    memcpy(map->views[map->views_count], wire, len + 1);
+    map->views_count += 1;
+    return map->views_count;
+}
+
+/** Parse a single ECS map file line and insert its prefix into trie.
+ *
+ * @param map     ECS map views are added to.
+ * @param tries   Binary tries, IPv4 followed by IPv6.
+ * @param line    Line to parse, line is modified.
+ * @param line_no Line number, used in error message.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1.
+ */
+static int
+ecs_map_parse_line(ecs_map_t *map, ecs_map_trie_t *tries, char *line, uint32_t line_no,
+                   char *err, size_t err_len)
+{
+    char          *tokens[ECS_MAP_FILE_TOKENS_MAX + 1];
+    char          *save  = NULL;
+    char          *slash = NULL;
+    char          *comment;
+    int            count = 0;
+    int            family;
+    uint8_t        addr[RIP_NS_IN6ADDRSZ] = {};
+    unsigned long  len   = 0;
+    uint8_t        max;
+    uint16_t       view;
+
+    if ((comment = strchr(line, ';')) != NULL) {
+        *comment = '\0';
+    }
+    for (char *t = strtok_r(line, " \t\r", &save); t != NULL; t = strtok_r(NULL, " \t\r", &save)) {
+        if (count == ECS_MAP_FILE_TOKENS_MAX) {
+            count++;
+            break;
+        }
+        tokens[count++] = t;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (count != ECS_MAP_FILE_TOKENS_MAX || (slash = strchr(tokens[0], '/')) == NULL) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+
+    *slash = '\0';
+    family = strchr(tokens[0], ':') == NULL ? AF_INET : AF_INET6;
+    max = family == AF_INET ? 32 : 128;
+    if (inet_pton(family, tokens[0], addr) != 1 ||
+        str_to_unsigned_long(&len, slash + 1) != 0 || len > max) {
+        snprintf(err, err_len, "line %u: invalid prefix \"%s/%s\"", line_no,
+                 tokens[0], slash + 1);
+        return -1;
+    }
+    for (uint8_t bit = len; bit < max; bit++) {
+        if (addr[bit / 8] & (0x80 >> (bit % 8))) {
+            snprintf(err, err_len, "line %u: prefix \"%s/%lu\" has host bits set",
+                     line_no, tokens[0], len);
+            return -1;
+        }
+    }
+    if ((view = ecs_map_view_get(map, tokens[1])) == 0) {
+        snprintf(err, err_len, "line %u: invalid view \"%s\"", line_no, tokens[1]);
+        return -1;
+    }
+    if (ecs_map_trie_insert(&tries[family == AF_INET ? 0 : 1], addr, len, view) != 0) {
+        snprintf(err, err_len, "line %u: duplicate prefix \"%s/%lu\"", line_no,
+                 tokens[0], len);
+        return -1;
+    }
+    return 0;
+}
+
+/** Create ECS map from ECS map file contents.
+ *
+ * @param buf        ECS map file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to map.
+ * @param err        Where to store error message if map can not be created.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to ECS map on success, otherwise NULL is
+ *                   returned and err is populated.
+ */
+ecs_map_t *
+ecs_map_create(const char *buf, size_t buf_len, uint64_t generation,
+               char *err, size_t err_len)
+{
+    ecs_map_trie_t  tries[2]    = {};
+    ecs_map_t      *map         = NULL;
+    char            line[ECS_MAP_FILE_LINE_MAX];
+    const char     *p           = buf;
+    const char     *end         = buf + buf_len;
+    uint32_t        line_no     = 0;
+    size_t          chunks_size = 0;
+    uint8_t         addr[RIP_NS_IN6ADDRSZ] = {};
+
+    map = calloc(1, sizeof(ecs_map_t));
+    CHECK_MALLOC(map);
+    map->generation = generation;
+    map->views = malloc(sizeof(*map->views) * ECS_MAP_VIEWS_MAX);
+    CHECK_MALLOC(map->views);
+
+    /* Parse ECS map file into binary tries. */
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        line_no += 1;
+        if (len >= ECS_MAP_FILE_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", line_no);
+            goto ERR_END;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (ecs_map_parse_line(map, tries, line, line_no, err, err_len) != 0) {
+            goto ERR_END;
+        }
+        p += len + 1;
+    }
+
+    /* Expand tries into multibit tables. */
+    map->v4_root = malloc(sizeof(uint32_t) * ECS_MAP_ROOT_SIZE);
+    CHECK_MALLOC(map->v4_root);
+    map->v6_root = malloc(sizeof(uint32_t) * ECS_MAP_ROOT_SIZE);
+    CHECK_MALLOC(map->v6_root);
+    for (int i = 0; i < 2; i++) {
+        if (tries[i].count == 0) {
+            ecs_map_trie_node_add(&tries[i]);
+        }
+        ecs_map_table_build(map, &chunks_size, i == 0 ? map->v4_root : map->v6_root,
+                            &tries[i], 0, addr, 0, 0);
+        free(tries[i].nodes);
+    }
+    return map;
+
+ERR_END:
+    free(tries[0].nodes);
+    free(tries[1].nodes);
+    ecs_map_release(map);
+    return NULL;
+}
+
+/** Release ECS map.
+ *
+ * @param map ECS map to release.
+ */
+void
+ecs_map_release(ecs_map_t *map)
+{
+    if (map == NULL) {
+        return;
+    }
+    free(map->v4_root);
+    free(map->v6_root);
+    free(map->chunks);
+    free(map->views);
+    free(map);
+}
+
+/** Lookup view of an address.
+ *
+ * @param map    ECS map to lookup address in.
+ * @param family Address family, 1 = IPv4, 2 = IPv6 (as in EDNS client subnet
+ *               option).
+ * @param addr   Address, network order, 4 or 16 bytes depending on family.
+ * @param scope  Where to store scope prefix length, length of prefix all
+ *               addresses sharing it resolve to the same view.
+ *
+ * @return       Returns view number, index of view label in map views array
+ *               plus 1, or 0 if address does not map to a view.
+ */
+uint16_t
+ecs_map_lookup(ecs_map_t *map, uint16_t family, const uint8_t *addr, uint8_t *scope)
+{
+    size_t   addr_len = family == 1 ? RIP_NS_INADDRSZ : RIP_NS_IN6ADDRSZ;
+    uint32_t entry    = (family == 1 ? map->v4_root : map->v6_root)[addr[0] << 8 | addr[1]];
+
+    for (size_t i = 2; (entry & ECS_MAP_F_CHILD) && i < addr_len; i++) {
+        entry = map->chunks[(size_t)(entry & ~ECS_MAP_F_CHILD) * ECS_MAP_CHUNK_SIZE + addr[i]];
+    }
+    *scope = entry & 0xff;
+    return entry >> 8;
+}
+
+/** Lookup view of a socket address, see @ref ecs_map_lookup(). IPv4 mapped
+ * IPv6 addresses are looked up as IPv4.
+ *
+ * @param map ECS map to lookup address in.
+ * @param ip  Socket address, IPv4 or IPv6.
+ *
+ * @return    Returns view number, or 0 if address does not map to a view or
+ *            is not an IP address.
+ */
+uint16_t
+ecs_map_lookup_sockaddr(ecs_map_t *map, const struct sockaddr_storage *ip)
+{
+    const struct in6_addr *a6;
+    uint8_t                scope;
+
+    if (ip->ss_family == AF_INET) {
+        return ecs_map_lookup(map, 1, (const uint8_t *)&((const struct sockaddr_in *)ip)->sin_addr,
+                              &scope);
+    }
+    if (ip->ss_family != AF_INET6) {
+        return 0;
+    }
+    a6 = &((const struct sockaddr_in6 *)ip)->sin6_addr;
+    if (IN6_IS_ADDR_V4MAPPED(a6)) {
+        return ecs_map_lookup(map, 1, a6->s6_addr + 12, &scope);
+    }
+    return ecs_map_lookup(map, 2, a6->s6_addr, &scope);
+}
+
+/** @}*/
@@ -0,0 +1,477 @@
+/**
+ * @file geoip.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup geoip
+ *  @{
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "geoip.h"
+#include "utils.h"
+
+/** Marker metadata section starts after, "\xAB\xCD\xEFMaxMind.com". */
+#define GEOIP_METADATA_MARKER "\xab\xcd\xefMaxMind.com"
+
+/** Length of @ref GEOIP_METADATA_MARKER. */
+#define GEOIP_METADATA_MARKER_LEN 14
+
+/** Maximum size of metadata section, marker is searched for this far from
+ * end of file.
+ */
+#define GEOIP_METADATA_MAX (128 * 1024)
+
+/** Number of zero bytes separating search tree from data section. */
+#define GEOIP_DATA_SEPARATOR 16
+
+/** Maximum nesting of maps and arrays skipped while decoding. */
+#define GEOIP_DEPTH_MAX 16
+
+/** Enumerated MaxMind DB data types used here. */
+enum geoip_type_e {
+    GEOIP_TYPE_POINTER = 1,
+    GEOIP_TYPE_STRING  = 2,
+    GEOIP_TYPE_UINT16  = 5,
+    GEOIP_TYPE_UINT32  = 6,
+    GEOIP_TYPE_MAP     = 7,
+    GEOIP_TYPE_UINT64  = 9,
+    GEOIP_TYPE_ARRAY   = 11,
+    GEOIP_TYPE_BOOLEAN = 14,
+};
+
+/** Structure describes a decoded data field. */
+typedef struct geoip_field_s {
+    /** Data type. */
+    int type;
+
+    /** Size of field, number of entries for map and array, value for
+     * boolean, length of payload for other types.
+     */
+    uint32_t size;
+
+    /** Offset of payload, or of first entry of map and array. */
+    uint32_t offset;
+} geoip_field_t;
+
+/** Read big endian unsigned integer.
+ *
+ * @param p   Bytes to read.
+ * @param len Number of bytes, at most 4.
+ *
+ * @return    Returns integer.
+ */
+static uint32_t
+geoip_be(const uint8_t *p, int len)
+{
+    uint32_t v = 0;
+
+    for (int i = 0; i < len; i++) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+/** Decode field control byte(s), following a pointer.
+ *
+ * @param data     Section fields are in.
+ * @param data_len Length of section.
+ * @param offset   Offset of field.
+ * @param field    Where to store decoded field.
+ * @param next     Where to store offset of field following this one, for
+ *                 map and array offset of its first entry.
+ *
+ * @return         Returns 0 on success, -1 if field is out of bounds.
+ */
+static int
+geoip_decode(const uint8_t *data, uint32_t data_len, uint32_t offset, geoip_field_t *field,
+             uint32_t *next)
+{
+    static const uint32_t pointer_base[4] = { 0, 2048, 526336, 0 };
+    uint8_t               ctrl;
+    uint32_t              n;
+    bool                  pointer = false;
+
+    for (;;) {
+        if (offset >= data_len) {
+            return -1;
+        }
+        ctrl = data[offset++];
+        field->type = ctrl >> 5;
+        if (field->type != GEOIP_TYPE_POINTER) {
+            break;
+        }
+        /* Pointer to pointer is invalid. */
+        n = ((ctrl >> 3) & 3) + 1;
+        if (pointer || offset + n > data_len) {
+            return -1;
+        }
+        if (!pointer) {
+            *next = offset + n;
+        }
+        pointer = true;
+        offset = (n == 4 ? 0 : (uint32_t)(ctrl & 7) << (8 * n)) + geoip_be(data + offset, n) +
+                 pointer_base[n - 1];
+    }
+    if (field->type == 0) {
+        if (offset >= data_len) {
+            return -1;
+        }
+        field->type = 7 + data[offset++];
+    }
+    field->size = ctrl & 0x1f;
+    if (field->size >= 29) {
+        n = field->size - 28;
+        if (offset + n > data_len) {
+            return -1;
+        }
+        field->size = (n == 1 ? 29 : n == 2 ? 285 : 65821) + geoip_be(data + offset, n);
+        offset += n;
+    }
+    field->offset = offset;
+    if (!pointer) {
+        *next = offset;
+        if (field->type != GEOIP_TYPE_MAP && field->type != GEOIP_TYPE_ARRAY &&
+            field->type != GEOIP_TYPE_BOOLEAN) {
+            *next += field->size;
+        }
+    }
+    return 0;
+}
+
+/** Skip a field, with entries of map or array.
+ *
+ * @param data     Section field is in.
+ * @param data_len Length of section.
+ * @param offset   Offset of field.
+ * @param depth    Nesting depth of field.
+ *
+ * @return         Returns offset of field following this one, or -1 if data
+ *                 is invalid.
+ */
+static int64_t
+geoip_skip(const uint8_t *data, uint32_t data_len, uint32_t offset, int depth)
+{
+    geoip_field_t field;
+    uint32_t      next;
+    int64_t       p;
+    uint32_t      count;
+
+    if (depth > GEOIP_DEPTH_MAX || geoip_decode(data, data_len, offset, &field, &next) != 0) {
+        return -1;
+    }
+    /* Pointed to map or array is not inline, skip ends at pointer. */
+    if ((field.type != GEOIP_TYPE_MAP && field.type != GEOIP_TYPE_ARRAY) ||
+        next != field.offset) {
+        return next;
+    }
+    count = field.type == GEOIP_TYPE_MAP ? 2 * field.size : field.size;
+    p = next;
+    for (uint32_t i = 0; i < count && p >= 0; i++) {
+        p = geoip_skip(data, data_len, (uint32_t)p, depth + 1);
+    }
+    return p;
+}
+
+/** Find value of a key in a decoded map.
+ *
+ * @param data     Section map is in.
+ * @param data_len Length of section.
+ * @param map      Decoded map.
+ * @param key      Key to find.
+ * @param value    Where to store decoded value.
+ *
+ * @return         Returns 0 if key was found, otherwise -1.
+ */
+static int
+geoip_map_find(const uint8_t *data, uint32_t data_len, const geoip_field_t *map,
+               const char *key, geoip_field_t *value)
+{
+    geoip_field_t k;
+    size_t        key_len = strlen(key);
+    uint32_t      next;
+    int64_t       p       = map->offset;
+
+    if (map->type != GEOIP_TYPE_MAP) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < map->size; i++) {
+        if (geoip_decode(data, data_len, (uint32_t)p, &k, &next) != 0 ||
+            k.type != GEOIP_TYPE_STRING || k.offset + k.size > data_len) {
+            return -1;
+        }
+        if (k.size == key_len && memcmp(data + k.offset, key, key_len) == 0) {
+            return geoip_decode(data, data_len, next, value, &next);
+        }
+        if ((p = geoip_skip(data, data_len, next, 1)) < 0) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/** Find value of a key in a map.
+ *
+ * @param data     Section map is in.
+ * @param data_len Length of section.
+ * @param offset   Offset of map.
+ * @param key      Key to find.
+ * @param value    Where to store decoded value.
+ *
+ * @return         Returns 0 if key was found, otherwise -1.
+ */
+static int
+geoip_map_get(const uint8_t *data, uint32_t data_len, uint32_t offset, const char *key,
+              geoip_field_t *value)
+{
+    geoip_field_t map;
+    uint32_t      next;
+
+    if (geoip_decode(data, data_len, offset, &map, &next) != 0) {
+        return -1;
+    }
+    return geoip_map_find(data, data_len, &map, key, value);
+}
+
+/** Get unsigned integer value of a map key.
+ *
+ * @param data     Section map is in.
+ * @param data_len Length of section.
+ * @param offset   Offset of map.
+ * @param key      Key to find.
+ * @param value    Where to store value.
+ *
+ * @return         Returns 0 if key was found and is an unsigned integer that
+ *                 fits 32 bits, otherwise -1.
+ */
+static int
+geoip_map_get_uint(const uint8_t *data, uint32_t data_len, uint32_t offset, const char *key,
+                   uint32_t *value)
+{
+    geoip_field_t field;
+
+    if (geoip_map_get(data, data_len, offset, key, &field) != 0 ||
+        (field.type != GEOIP_TYPE_UINT16 && field.type != GEOIP_TYPE_UINT32 &&
+         field.type != GEOIP_TYPE_UINT64) ||
+        field.size > 4 || field.offset + field.size > data_len) {
+        return -1;
+    }
+    *value = geoip_be(data + field.offset, field.size);
+    return 0;
+}
+
+/** Get two character code at path "<map>.<key>" of a record, lower cased.
+ *
+ * @param geoip  Database.
+ * @param offset Offset of record in data section.
+ * @param map    Name of record map holding code.
+ * @param key    Name of code key.
+ *
+ * @return       Returns code, first character in high byte, 0 if record has
+ *               no such code.
+ */
+static uint16_t
+geoip_code(const geoip_t *geoip, uint32_t offset, const char *map, const char *key)
+{
+    geoip_field_t  field;
+    const uint8_t *s;
+
+    if (geoip_map_get(geoip->data, geoip->data_len, offset, map, &field) != 0 ||
+        geoip_map_find(geoip->data, geoip->data_len, &field, key, &field) != 0 ||
+        field.type != GEOIP_TYPE_STRING || field.size != 2 ||
+        field.offset + 2 > geoip->data_len) {
+        return 0;
+    }
+    s = geoip->data + field.offset;
+    return (uint16_t)(tolower(s[0]) << 8 | tolower(s[1]));
+}
+
+/** Read a search tree node record.
+ *
+ * @param geoip Database.
+ * @param node  Node, MUST be less than node_count.
+ * @param bit   Address bit, 0 for left record and 1 for right record.
+ *
+ * @return      Returns record value.
+ */
+static inline uint32_t
+geoip_record(const geoip_t *geoip, uint32_t node, int bit)
+{
+    const uint8_t *p;
+
+    switch (geoip->record_size) {
+    case 24:
+        return geoip_be(geoip->tree + (size_t)node * 6 + bit * 3, 3);
+    case 28:
+        p = geoip->tree + (size_t)node * 7;
+        return bit == 0 ? (uint32_t)(p[3] & 0xf0) << 20 | geoip_be(p, 3) :
+                          (uint32_t)(p[3] & 0x0f) << 24 | geoip_be(p + 4, 3);
+    default:
+        return geoip_be(geoip->tree + (size_t)node * 8 + bit * 4, 4);
+    }
+}
+
+/** Look up geo of address in database, see @ref geoip_lookup().
+ *
+ * @param geoip  Database to look address up in.
+ * @param family Address family, 1 for IPv4 and 2 for IPv6.
+ * @param addr   Address bytes, 4 or 16 of them.
+ * @param scope  Where to store prefix length of database network address is
+ *               in.
+ *
+ * @return       Returns geo of address, 0 if database has none.
+ */
+uint32_t
+geoip_lookup_addr(const geoip_t *geoip, uint16_t family, const uint8_t *addr, uint8_t *scope)
+{
+    uint32_t bits   = family == 1 ? 32 : 128;
+    uint32_t node   = family == 1 ? geoip->ipv4_start : 0;
+    uint32_t depth  = 0;
+    uint32_t offset;
+    uint16_t country;
+
+    *scope = 0;
+    if (family == 2 && geoip->ip_version == 4) {
+        return 0;
+    }
+    for (; depth < bits && node < geoip->node_count; depth++) {
+        node = geoip_record(geoip, node, (addr[depth >> 3] >> (7 - (depth & 7))) & 1);
+    }
+    *scope = (uint8_t)depth;
+    if (node <= geoip->node_count ||
+        (offset = node - geoip->node_count - GEOIP_DATA_SEPARATOR) >= geoip->data_len) {
+        return 0;
+    }
+    if ((country = geoip_code(geoip, offset, "country", "iso_code")) == 0) {
+        country = geoip_code(geoip, offset, "registered_country", "iso_code");
+    }
+    return (uint32_t)country << 16 | geoip_code(geoip, offset, "continent", "code");
+}
+
+/** Open GeoIP database from MaxMind DB file. File is memory mapped, so it
+ * can be closed once database is open.
+ *
+ * @param fd         Open database file.
+ * @param len        Length of database file.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if database can not be
+ *                   opened.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to database on success, otherwise NULL
+ *                   is returned and err is populated.
+ */
+geoip_t *
+geoip_open(int fd, size_t len, uint64_t generation, char *err, size_t err_len)
+{
+    const uint8_t *map  = NULL;
+    const uint8_t *meta = NULL;
+    geoip_t       *geoip;
+    uint32_t       meta_len;
+    uint32_t       value;
+    size_t         tree_len;
+
+    if (len < GEOIP_METADATA_MARKER_LEN || len > UINT32_MAX) {
+        snprintf(err, err_len, "invalid database length %zu", len);
+        return NULL;
+    }
+    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        snprintf(err, err_len, "database mmap error: %s", strerror(errno));
+        return NULL;
+    }
+    geoip = calloc(1, sizeof(geoip_t));
+    CHECK_MALLOC(geoip);
+    geoip->generation = generation;
+    geoip->map        = map;
+    geoip->map_len    = len;
+
+    /* Metadata follows last marker in file. */
+    for (size_t i = len - GEOIP_METADATA_MARKER_LEN + 1;
+         i-- > 0 && len - i <= GEOIP_METADATA_MAX;) {
+        if (map[i] == 0xab &&
+            memcmp(map + i, GEOIP_METADATA_MARKER, GEOIP_METADATA_MARKER_LEN) == 0) {
+            meta = map + i + GEOIP_METADATA_MARKER_LEN;
+            break;
+        }
+    }
+    if (meta == NULL) {
+        snprintf(err, err_len, "metadata not found");
+        goto ERR_END;
+    }
+    meta_len = (uint32_t)(map + len - meta);
+    if (geoip_map_get_uint(meta, meta_len, 0, "node_count", &geoip->node_count) != 0 ||
+        geoip_map_get_uint(meta, meta_len, 0, "record_size", &value) != 0 ||
+        (value != 24 && value != 28 && value != 32)) {
+        snprintf(err, err_len, "metadata record_size or node_count invalid");
+        goto ERR_END;
+    }
+    geoip->record_size = (uint16_t)value;
+    if (geoip_map_get_uint(meta, meta_len, 0, "ip_version", &value) != 0 ||
+        (value != 4 && value != 6)) {
+        snprintf(err, err_len, "metadata ip_version invalid");
+        goto ERR_END;
+    }
+    geoip->ip_version = (uint16_t)value;
+
+    tree_len = (size_t)geoip->node_count * geoip->record_size / 4;
+    if (tree_len + GEOIP_DATA_SEPARATOR > (size_t)(meta - GEOIP_METADATA_MARKER_LEN - map)) {
+        snprintf(err, err_len, "search tree of %u nodes exceeds file", geoip->node_count);
+        goto ERR_END;
+    }
+    geoip->tree     = map;
+    geoip->data     = map + tree_len + GEOIP_DATA_SEPARATOR;
+    geoip->data_len = (uint32_t)(meta - GEOIP_METADATA_MARKER_LEN - geoip->data);
+
+    /* IPv4 addresses are in IPv6 tree under ::/96. */
+    if (geoip->ip_version == 6) {
+        for (int i = 0; i < 96 && geoip->ipv4_start < geoip->node_count; i++) {
+            geoip->ipv4_start = geoip_record(geoip, geoip->ipv4_start, 0);
+        }
+    }
+    return geoip;
+
+ERR_END:
+    geoip_release(geoip);
+    return NULL;
+}
+
+/** Release GeoIP database.
+ *
+ * @param geoip Database to release.
+ */
+void
+geoip_release(geoip_t *geoip)
+{
+    if (geoip == NULL) {
+        return;
+    }
+    munmap((void *)geoip->map, geoip->map_len);
+    free(geoip);
+}
+
+/** @}*/
@@ -0,0 +1,120 @@
+/**
+ * @file histogram.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup histogram
+ *  @{
+ */
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histogram.h"
+
+/** Get highest value counted in a histogram bucket.
+ *
+ * @param index Bucket index.
+ *
+ * @return      Returns highest value bucket counts. For last bucket
+ *              UINT64_MAX is returned.
+ */
+uint64_t
+histogram_bucket_value_max(unsigned int index)
+{
+    unsigned int shift;
+    uint64_t     low;
+
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    if (index >= HISTOGRAM_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    low   = (uint64_t)(HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS) << shift;
+
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+/** Add counts of one histogram to another.
+ *
+ * @param dst Histogram to add counts to, only calling thread may write to it.
+ * @param src Histogram to add counts of, may be written to by another thread.
+ */
+void
+histogram_merge(histogram_t *dst, histogram_t *src)
+{
+    atomic_ullong *d = (atomic_ullong *)dst;
+    atomic_ullong *s = (atomic_ullong *)src;
+
+    for (size_t i = 0; i < sizeof(histogram_t) / sizeof(atomic_ullong); i++) {
+        atomic_store_explicit(&d[i],
+            atomic_load_explicit(&d[i], memory_order_relaxed) +
+            atomic_load_explicit(&s[i], memory_order_relaxed), memory_order_relaxed);
+    }
+}
+
+/** Get value at a quantile of values recorded in histogram. Value returned
+ * is highest value of bucket the quantile falls into, so it is never lower
+ * than actual value at quantile.
+ *
+ * @param h        Histogram.
+ * @param quantile Quantile, from 0.0 to 1.0. For example 0.99 for 99th
+ *                 percentile.
+ *
+ * @return         Returns value at quantile, or 0 if histogram is empty.
+ */
+uint64_t
+histogram_quantile(histogram_t *h, double quantile)
+{
+    unsigned long long count = 0;
+    unsigned long long rank;
+    unsigned long long seen  = 0;
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        count += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (quantile < 0.0) {
+        quantile = 0.0;
+    } else if (quantile > 1.0) {
+        quantile = 1.0;
+    }
+    /* Rank of value at quantile, rounded up. */
+    rank = (unsigned long long)(quantile * count);
+    if ((double)rank < quantile * count || rank == 0) {
+        rank++;
+    }
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            return histogram_bucket_value_max(i);
+        }
+    }
+    return histogram_bucket_value_max(HISTOGRAM_BUCKETS - 1);
+}
+
+/** @}*/
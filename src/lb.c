@@ -0,0 +1,753 @@
+/**
+ * @file lb.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup lb
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lb.h"
+#include "resource.h"
+#include "utils.h"
+
+/** Maximum length of a single line in load balancing file. */
+#define LB_FILE_LINE_MAX 1024
+
+/** Maximum number of tokens (fields) on a single load balancing file line. */
+#define LB_FILE_TOKENS_MAX 6
+
+/** Structure describes a candidate record while candidate sets are built. */
+typedef struct lb_item_s {
+    /** Hash of name, see @ref rip_ns_name_hash. */
+    uint64_t hash;
+
+    /** Line candidate is listed on. */
+    uint32_t line_no;
+
+    /** Record TTL. */
+    uint32_t ttl;
+
+    /** Weight of candidate. */
+    uint16_t weight;
+
+    /** TCP port endpoint is probed on, 0 if it is not probed. */
+    uint16_t port;
+
+    /** Record type, A or AAAA. */
+    uint16_t type;
+
+    /** Length of name, including root label. */
+    uint16_t name_len;
+
+    /** Lower cased wire format name. */
+    unsigned char name[RIP_NS_MAXCDNAME + 1];
+
+    /** Record data, IPv4 or IPv6 address. */
+    uint8_t rdata[16];
+} lb_item_t;
+
+/** Compare candidate items by name hash, type and name, then by line
+ * number, so candidates of a set are adjacent and in file order.
+ *
+ * @param a First item.
+ * @param b Second item.
+ *
+ * @return  Returns -1, 0 or 1 as a is ordered before, same as or after b.
+ */
+static int
+lb_item_cmp(const void *a, const void *b)
+{
+    const lb_item_t *x = a;
+    const lb_item_t *y = b;
+    int              c;
+
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    if (x->type != y->type) {
+        return x->type < y->type ? -1 : 1;
+    }
+    if (x->name_len != y->name_len) {
+        return x->name_len < y->name_len ? -1 : 1;
+    }
+    if ((c = memcmp(x->name, y->name, x->name_len)) != 0) {
+        return c;
+    }
+    return x->line_no < y->line_no ? -1 : x->line_no > y->line_no;
+}
+
+/** Parse an unsigned number token within bounds.
+ *
+ * @param token Token to parse.
+ * @param min   Minimum value.
+ * @param max   Maximum value.
+ * @param value Where to store value.
+ *
+ * @return      Returns 0 on success, otherwise -1.
+ */
+static int
+lb_parse_number(const char *token, unsigned long min, unsigned long max, unsigned long *value)
+{
+    char *end = NULL;
+
+    if (token[0] < '0' || token[0] > '9') {
+        return -1;
+    }
+    errno  = 0;
+    *value = strtoul(token, &end, 10);
+    return (errno != 0 || *end != '\0' || *value < min || *value > max) ? -1 : 0;
+}
+
+/** Parse a single load balancing file line.
+ *
+ * @param item    Where to store parsed candidate, its line number is 0 for
+ *                a line with no candidate.
+ * @param line    Line to parse, line is modified.
+ * @param line_no Line number, used in error message.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1.
+ */
+static int
+lb_parse_line(lb_item_t *item, char *line, uint32_t line_no, char *err, size_t err_len)
+{
+    char          *tokens[LB_FILE_TOKENS_MAX + 1];
+    char          *save    = NULL;
+    char          *comment;
+    int            count   = 0;
+    unsigned long  value   = 0;
+
+    item->line_no = 0;
+    if ((comment = strchr(line, ';')) != NULL) {
+        *comment = '\0';
+    }
+    for (char *t = strtok_r(line, " \t\r", &save); t != NULL; t = strtok_r(NULL, " \t\r", &save)) {
+        if (count == LB_FILE_TOKENS_MAX) {
+            count++;
+            break;
+        }
+        tokens[count++] = t;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (count < LB_FILE_TOKENS_MAX - 1 || count > LB_FILE_TOKENS_MAX) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+
+    if (rip_ns_name_pton((const unsigned char *)tokens[0], item->name, sizeof(item->name)) < 0 ||
+        item->name[0] == 0) {
+        snprintf(err, err_len, "line %u: invalid name \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+    item->name_len = rip_ns_name_lc(item->name);
+    item->hash     = rip_ns_name_hash(item->name, item->name_len);
+
+    if (lb_parse_number(tokens[1], 0, INT32_MAX, &value) != 0) {
+        snprintf(err, err_len, "line %u: invalid TTL \"%s\"", line_no, tokens[1]);
+        return -1;
+    }
+    item->ttl = (uint32_t)value;
+
+    if (strcasecmp(tokens[2], "A") == 0) {
+        item->type = rip_ns_t_a;
+    } else if (strcasecmp(tokens[2], "AAAA") == 0) {
+        item->type = rip_ns_t_aaaa;
+    } else {
+        snprintf(err, err_len, "line %u: invalid type \"%s\"", line_no, tokens[2]);
+        return -1;
+    }
+    if (inet_pton(item->type == rip_ns_t_a ? AF_INET : AF_INET6, tokens[3], item->rdata) != 1) {
+        snprintf(err, err_len, "line %u: invalid address \"%s\"", line_no, tokens[3]);
+        return -1;
+    }
+
+    if (lb_parse_number(tokens[4], 1, UINT16_MAX, &value) != 0) {
+        snprintf(err, err_len, "line %u: invalid weight \"%s\"", line_no, tokens[4]);
+        return -1;
+    }
+    item->weight = (uint16_t)value;
+
+    item->port = 0;
+    if (count == LB_FILE_TOKENS_MAX) {
+        if (lb_parse_number(tokens[5], 1, UINT16_MAX, &value) != 0) {
+            snprintf(err, err_len, "line %u: invalid port \"%s\"", line_no, tokens[5]);
+            return -1;
+        }
+        item->port = (uint16_t)value;
+    }
+    item->line_no = line_no;
+    return 0;
+}
+
+/** Set endpoint address from candidate record data.
+ *
+ * @param ep    Endpoint to set.
+ * @param type  Record type, A or AAAA.
+ * @param rdata Record data, address in network order.
+ * @param port  TCP port endpoint is probed on, 0 if it is not probed.
+ */
+static void
+lb_endpoint_set(lb_endpoint_t *ep, uint16_t type, const uint8_t *rdata, uint16_t port)
+{
+    memset(ep, 0, sizeof(lb_endpoint_t));
+    if (type == rip_ns_t_a) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&ep->addr;
+
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(port);
+        memcpy(&sin->sin_addr, rdata, 4);
+        ep->addr_len = sizeof(struct sockaddr_in);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ep->addr;
+
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port   = htons(port);
+        memcpy(&sin6->sin6_addr, rdata, 16);
+        ep->addr_len = sizeof(struct sockaddr_in6);
+    }
+    ep->port = port;
+}
+
+/** Hash endpoint address and port, see @ref lb_endpoints_index().
+ *
+ * @param ep Endpoint to hash.
+ *
+ * @return   Returns hash of endpoint.
+ */
+static uint64_t
+lb_endpoint_hash(const lb_endpoint_t *ep)
+{
+    const uint8_t *p = (const uint8_t *)&ep->addr;
+    uint64_t       h = 0xcbf29ce484222325ULL;
+
+    /* FNV-1a, addresses are zero padded so whole length is hashed. */
+    for (socklen_t i = 0; i < ep->addr_len; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/** Check if two endpoints have the same address and port.
+ *
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ *
+ * @return  Returns true if endpoints are the same.
+ */
+static bool
+lb_endpoint_eq(const lb_endpoint_t *a, const lb_endpoint_t *b)
+{
+    return a->addr_len == b->addr_len && memcmp(&a->addr, &b->addr, a->addr_len) == 0;
+}
+
+/** Find endpoint in open addressing table of endpoint indexes.
+ *
+ * @param endpoints Endpoints slots hold indexes of.
+ * @param slots     Table of endpoint indexes plus one, 0 is an empty slot.
+ * @param mask      Number of slots minus one.
+ * @param ep        Endpoint to find.
+ *
+ * @return          Returns slot of endpoint, or empty slot it would be
+ *                  stored at.
+ */
+static uint32_t *
+lb_endpoint_slot(const lb_endpoint_t *endpoints, uint32_t *slots, uint32_t mask,
+                 const lb_endpoint_t *ep)
+{
+    uint32_t s = (uint32_t)lb_endpoint_hash(ep) & mask;
+
+    while (slots[s] != 0 && !lb_endpoint_eq(&endpoints[slots[s] - 1], ep)) {
+        s = (s + 1) & mask;
+    }
+    return &slots[s];
+}
+
+/** Round up to a power of two table size at least twice count.
+ *
+ * @param count Number of entries table holds.
+ *
+ * @return      Returns table size.
+ */
+static uint32_t
+lb_table_size(uint32_t count)
+{
+    uint32_t size = 16;
+
+    while (size < count * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+/** Build endpoints of candidates, unique by address and port, and their
+ * health bitmap. Endpoints current candidate sets have keep their health,
+ * other endpoints start healthy.
+ *
+ * @param lb      Candidate sets whose endpoints to build.
+ * @param items   Candidate items, in candidates order.
+ * @param current Candidate sets being replaced, NULL if there are none.
+ */
+static void
+lb_endpoints_build(lb_t *lb, const lb_item_t *items, const lb_t *current)
+{
+    uint32_t      size  = lb_table_size(lb->candidates_count);
+    uint32_t     *slots = calloc(size, sizeof(uint32_t));
+    uint32_t     *cur_slots = NULL;
+    uint32_t      cur_size  = 0;
+    lb_endpoint_t ep;
+
+    CHECK_MALLOC(slots);
+    lb->endpoints = malloc(sizeof(lb_endpoint_t) * (lb->candidates_count + 1));
+    CHECK_MALLOC(lb->endpoints);
+    for (uint32_t i = 0; i < lb->candidates_count; i++) {
+        uint32_t *slot;
+
+        lb_endpoint_set(&ep, items[i].type, items[i].rdata, items[i].port);
+        slot = lb_endpoint_slot(lb->endpoints, slots, size - 1, &ep);
+        if (*slot == 0) {
+            lb->endpoints[lb->endpoints_count++] = ep;
+            *slot = lb->endpoints_count;
+        }
+        lb->candidates[i].endpoint = *slot - 1;
+    }
+    free(slots);
+
+    lb->health_words = (lb->endpoints_count + 63) / 64;
+    lb->health       = malloc(sizeof(atomic_ullong) * (lb->health_words + 1));
+    CHECK_MALLOC(lb->health);
+    for (uint32_t w = 0; w < lb->health_words; w++) {
+        atomic_init(&lb->health[w], ~0ULL);
+    }
+    if (current == NULL || current->endpoints_count == 0) {
+        return;
+    }
+
+    /* Carry over health of endpoints current candidate sets have. */
+    cur_size  = lb_table_size(current->endpoints_count);
+    cur_slots = calloc(cur_size, sizeof(uint32_t));
+    CHECK_MALLOC(cur_slots);
+    for (uint32_t i = 0; i < current->endpoints_count; i++) {
+        *lb_endpoint_slot(current->endpoints, cur_slots, cur_size - 1,
+                          &current->endpoints[i]) = i + 1;
+    }
+    for (uint32_t i = 0; i < lb->endpoints_count; i++) {
+        uint32_t *slot = lb_endpoint_slot(current->endpoints, cur_slots, cur_size - 1,
+                                          &lb->endpoints[i]);
+
+        if (*slot != 0 && !lb_healthy(current, *slot - 1)) {
+            atomic_fetch_and_explicit(&lb->health[i >> 6], ~(1ULL << (i & 63)),
+                                      memory_order_relaxed);
+        }
+    }
+    free(cur_slots);
+}
+
+/** Create load balancing candidate sets from load balancing file contents.
+ *
+ * @param buf        Load balancing file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to candidate sets.
+ * @param current    Candidate sets being replaced, endpoints they share keep
+ *                   their health. NULL if there are none.
+ * @param err        Where to store error message if candidate sets can not
+ *                   be created.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to candidate sets on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+lb_t *
+lb_create(const char *buf, size_t buf_len, uint64_t generation, const lb_t *current,
+          char *err, size_t err_len)
+{
+    lb_t        *lb      = NULL;
+    lb_item_t   *items   = NULL;
+    size_t       size    = 0;
+    uint32_t     count   = 0;
+    uint32_t     line_no = 0;
+    uint32_t     slots   = 0;
+    char         line[LB_FILE_LINE_MAX];
+    const char  *p       = buf;
+    const char  *end     = buf + buf_len;
+
+    lb = calloc(1, sizeof(lb_t));
+    CHECK_MALLOC(lb);
+    lb->generation = generation;
+
+    /* Parse load balancing file into array of candidates. */
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        line_no += 1;
+        if (len >= LB_FILE_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", line_no);
+            goto ERR_END;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (count == size) {
+            size  = size == 0 ? 64 : size * 2;
+            items = realloc(items, sizeof(lb_item_t) * size);
+            CHECK_MALLOC(items);
+        }
+        if (lb_parse_line(&items[count], line, line_no, err, err_len) != 0) {
+            goto ERR_END;
+        }
+        if (items[count].line_no != 0) {
+            count++;
+        }
+        p += len + 1;
+    }
+
+    /* Group candidates of a name and type into a set, in file order. */
+    if (count > 0) {
+        qsort(items, count, sizeof(lb_item_t), &lb_item_cmp);
+    }
+    lb->candidates = calloc(count + 1, sizeof(lb_candidate_t));
+    CHECK_MALLOC(lb->candidates);
+    lb->sets = calloc(count + 1, sizeof(lb_set_t));
+    CHECK_MALLOC(lb->sets);
+    for (uint32_t i = 0; i < count; i++) {
+        lb_candidate_t *c   = &lb->candidates[i];
+        lb_set_t       *set = lb->sets_count > 0 ? &lb->sets[lb->sets_count - 1] : NULL;
+
+        if (set == NULL || set->hash != items[i].hash || set->type != items[i].type ||
+            set->name_len != items[i].name_len ||
+            memcmp(set->name, items[i].name, items[i].name_len) != 0) {
+            if (set != NULL && set->count == UINT16_MAX) {
+                snprintf(err, err_len, "line %u: too many candidates of name", items[i].line_no);
+                goto ERR_END;
+            }
+            set           = &lb->sets[lb->sets_count++];
+            set->hash     = items[i].hash;
+            set->type     = items[i].type;
+            set->name_len = items[i].name_len;
+            set->first    = i;
+            memcpy(set->name, items[i].name, items[i].name_len);
+        }
+        set->count++;
+
+        memcpy(c->rdata, items[i].rdata, sizeof(c->rdata));
+        c->weight       = items[i].weight;
+        c->rr.type      = items[i].type;
+        c->rr.class     = rip_ns_c_in;
+        c->rr.ttl       = items[i].ttl;
+        c->rr.rdata_len = items[i].type == rip_ns_t_a ? 4 : 16;
+        c->rr.rdata     = c->rdata;
+    }
+    lb->candidates_count = count;
+
+    /* Candidates are packed with query name as owner name, record owner
+     * name is set so records read like zone records elsewhere.
+     */
+    for (uint32_t s = 0; s < lb->sets_count; s++) {
+        lb_set_t *set = &lb->sets[s];
+
+        rip_ns_name_ntop(set->name, set->text, sizeof(set->text));
+        for (uint32_t i = set->first; i < set->first + set->count; i++) {
+            lb->candidates[i].rr.name     = (unsigned char *)set->text;
+            lb->candidates[i].rr.name_len = strlen(set->text);
+        }
+    }
+
+    slots          = lb_table_size(lb->sets_count);
+    lb->slots_mask = slots - 1;
+    lb->slots      = calloc(slots, sizeof(uint32_t));
+    CHECK_MALLOC(lb->slots);
+    for (uint32_t s = 0; s < lb->sets_count; s++) {
+        uint32_t i = (uint32_t)(lb->sets[s].hash ^ lb->sets[s].type) & lb->slots_mask;
+
+        while (lb->slots[i] != 0) {
+            i = (i + 1) & lb->slots_mask;
+        }
+        lb->slots[i] = s + 1;
+    }
+
+    lb_endpoints_build(lb, items, current);
+    free(items);
+    return lb;
+
+ERR_END:
+    free(items);
+    lb_release(lb);
+    return NULL;
+}
+
+/** Release memory held by load balancing candidate sets.
+ *
+ * @param lb Candidate sets to release, may be NULL.
+ */
+void
+lb_release(lb_t *lb)
+{
+    if (lb == NULL) {
+        return;
+    }
+    free(lb->sets);
+    free(lb->slots);
+    free(lb->candidates);
+    free(lb->endpoints);
+    free(lb->health);
+    free(lb);
+}
+
+/** Start TCP connect probe of an endpoint.
+ *
+ * @param ep   Endpoint to probe.
+ * @param epfd Epoll instance pending probe is added to.
+ * @param idx  Index probe is identified with in epoll events.
+ * @param pass Set to true if probe passed right away.
+ *
+ * @return     Returns socket of pending probe, -1 if probe completed right
+ *             away, pass tells how.
+ */
+static int
+lb_probe_start(const lb_endpoint_t *ep, int epfd, uint32_t idx, bool *pass)
+{
+    struct epoll_event ev = { .events = EPOLLOUT, .data.u32 = idx };
+    int                fd = socket(ep->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    *pass = false;
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (const struct sockaddr *)&ep->addr, ep->addr_len) == 0) {
+        *pass = true;
+    } else if (errno == EINPROGRESS && epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+        return fd;
+    }
+    close(fd);
+    return -1;
+}
+
+/** Probe a batch of endpoints at once, waiting at most timeout for their TCP
+ * connects to complete.
+ *
+ * @param lb      Candidate sets endpoints belong to.
+ * @param start   Index of first endpoint of batch.
+ * @param count   Number of endpoints in batch, at most @ref LB_CHECK_BATCH.
+ * @param epfd    Epoll instance probes wait on.
+ * @param timeout Probe timeout in milliseconds.
+ * @param pass    Where to store results, true for endpoint that passed.
+ */
+static void
+lb_probe_batch(const lb_t *lb, uint32_t start, uint32_t count, int epfd,
+               size_t timeout, bool *pass)
+{
+    int                fds[LB_CHECK_BATCH];
+    struct epoll_event events[LB_CHECK_BATCH];
+    uint32_t           pending = 0;
+    uint64_t           end_ms  = utl_clock_monotonic_ms_fatal() + timeout;
+    uint64_t           now_ms;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const lb_endpoint_t *ep = &lb->endpoints[start + i];
+
+        fds[i] = -1;
+        if (ep->port == 0) {
+            pass[i] = true;
+            continue;
+        }
+        fds[i] = lb_probe_start(ep, epfd, i, &pass[i]);
+        pending += fds[i] >= 0;
+    }
+
+    while (pending > 0 && (now_ms = utl_clock_monotonic_ms_fatal()) < end_ms) {
+        int n = epoll_wait(epfd, events, LB_CHECK_BATCH, (int)(end_ms - now_ms));
+
+        for (int e = 0; e < n; e++) {
+            uint32_t  i     = events[e].data.u32;
+            int       error = 0;
+            socklen_t len   = sizeof(error);
+
+            if (fds[i] < 0) {
+                continue;
+            }
+            pass[i] = getsockopt(fds[i], SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+            close(fds[i]);
+            fds[i] = -1;
+            pending--;
+        }
+    }
+
+    /* Probes still pending timed out. */
+    for (uint32_t i = 0; i < count; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+}
+
+/** Log endpoint health change.
+ *
+ * @param ep              Endpoint whose health changed.
+ * @param healthy         Set if endpoint is now healthy.
+ * @param app_log_channel Application log channel.
+ */
+static void
+lb_log_health(const lb_endpoint_t *ep, bool healthy, channel_log_t *app_log_channel)
+{
+    char     ip[INET6_ADDRSTRLEN];
+    uint16_t port = 0;
+
+    utl_ip_port_from_ss(ip, sizeof(ip), &port, (struct sockaddr_storage *)&ep->addr);
+    channel_log_send(app_log_channel, 0, false, "Load balancing endpoint %s port %u is %s",
+                     ip, port, healthy ? "up" : "down");
+}
+
+/** Probe all endpoints of candidate sets once, and publish their health.
+ * Endpoint goes down after @ref LB_CHECK_FALL failed probes in a row and
+ * up after @ref LB_CHECK_RISE passed ones.
+ *
+ * @param lb              Candidate sets to check.
+ * @param streaks         Probe streak of each endpoint, passes if positive
+ *                        and failures if negative.
+ * @param epfd            Epoll instance probes wait on.
+ * @param timeout         Probe timeout in milliseconds.
+ * @param app_log_channel Application log channel.
+ * @param metrics         Metrics endpoint health is reported to.
+ */
+static void
+lb_check_round(lb_t *lb, int8_t *streaks, int epfd, size_t timeout,
+               channel_log_t *app_log_channel, metrics_t *metrics)
+{
+    bool     pass[LB_CHECK_BATCH];
+    uint64_t up   = 0;
+    uint64_t down = 0;
+
+    for (uint32_t start = 0; start < lb->endpoints_count; start += LB_CHECK_BATCH) {
+        uint32_t count = lb->endpoints_count - start;
+
+        count = count < LB_CHECK_BATCH ? count : LB_CHECK_BATCH;
+        lb_probe_batch(lb, start, count, epfd, timeout, pass);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t e       = start + i;
+            bool     healthy = lb_healthy(lb, e);
+            int8_t  *s       = &streaks[e];
+
+            if (lb->endpoints[e].port == 0) {
+                continue;
+            }
+            if (pass[i]) {
+                *s = *s > 0 ? (*s < INT8_MAX ? *s + 1 : *s) : 1;
+            } else {
+                *s = *s < 0 ? (*s > INT8_MIN ? *s - 1 : *s) : -1;
+            }
+            if (healthy && *s <= -LB_CHECK_FALL) {
+                atomic_fetch_and_explicit(&lb->health[e >> 6], ~(1ULL << (e & 63)),
+                                          memory_order_release);
+                lb_log_health(&lb->endpoints[e], false, app_log_channel);
+                healthy = false;
+            } else if (!healthy && *s >= LB_CHECK_RISE) {
+                atomic_fetch_or_explicit(&lb->health[e >> 6], 1ULL << (e & 63),
+                                         memory_order_release);
+                lb_log_health(&lb->endpoints[e], true, app_log_channel);
+                healthy = true;
+            }
+            up   += healthy;
+            down += !healthy;
+        }
+    }
+    atomic_store_explicit(&metrics->lb.endpoints_up, up, memory_order_relaxed);
+    atomic_store_explicit(&metrics->lb.endpoints_down, down, memory_order_relaxed);
+}
+
+/** Health checker thread loop function. Every "lb_check_interval" seconds it
+ * probes endpoints of load balancing candidate sets published in resource
+ * set, and publishes their health, see @ref lb_check_round(). Checker is
+ * online as a QSBR reader of resource set only while it probes, so
+ * candidate sets it probes are not released under it.
+ *
+ * @note This loop runs indefinitely and is meant to be run on its own thread.
+ *
+ * @param args Object with arguments passed to health checker thread, see
+ *             @ref lb_check_loop_args_t.
+ */
+void *
+lb_check_loop(void *args)
+{
+    lb_check_loop_args_t *lb_args    = (lb_check_loop_args_t *)args;
+    config_t             *cfg        = lb_args->cfg;
+    resource_set_t       *resources  = lb_args->resources;
+    int8_t               *streaks    = NULL;
+    uint64_t              generation = 0;
+    int                   epfd       = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epfd < 0) {
+        channel_log_send(lb_args->app_log_channel, 0, false,
+                         "Error creating health checker epoll instance: %s, endpoints "
+                         "are not checked", strerror(errno));
+        return NULL;
+    }
+
+    while (1) {
+        uint64_t        start_us = utl_clock_monotonic_us_fatal();
+        uint64_t        now_us;
+        lb_t           *lb;
+        struct timespec wait     = {};
+
+        qsbr_online(&resources->qsbr, lb_args->reader_id);
+        lb = atomic_load_explicit(&resources->resources[RESOURCE_ID_LB], memory_order_acquire);
+        if (lb != NULL && lb->endpoints_count > 0) {
+            if (lb->generation != generation) {
+                /* New candidate sets, probe streaks start over. */
+                free(streaks);
+                streaks = calloc(lb->endpoints_count, sizeof(int8_t));
+                CHECK_MALLOC(streaks);
+                generation = lb->generation;
+            }
+            lb_check_round(lb, streaks, epfd, cfg->lb_check_timeout,
+                           lb_args->app_log_channel, lb_args->metrics);
+        }
+        qsbr_offline(&resources->qsbr, lb_args->reader_id);
+
+        now_us = utl_clock_monotonic_us_fatal();
+        if (now_us - start_us < cfg->lb_check_interval * 1000000ULL) {
+            uint64_t left_us = cfg->lb_check_interval * 1000000ULL - (now_us - start_us);
+
+            wait.tv_sec  = left_us / 1000000;
+            wait.tv_nsec = left_us % 1000000 * 1000;
+            while (nanosleep(&wait, &wait) != 0 && errno == EINTR) {
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/** @}*/
@@ -25,9 +25,12 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
@@ -46,10 +49,168 @@ static const char *app_log_msg_id_txt[] = {
     "vl_fn_epoll: code error, event id not recognized",
     "vl_fn_tcp_accept_conns: non-supported client IP socket family on TCP connection",
     "vl_fn_tcp_accept_conns: non-supported local IP socket family on TCP connection",
-    "vl_fn_tcp_accept_conns: getsockname() coder error or system out of resources",
-    "vl_run: could not set CPU affinity for vectorloop thread, performance might be impacted.", //5
+    "vl_run: could not set CPU affinity for vectorloop thread, performance might be impacted.",
+    "vl_run: could not set real-time scheduling policy for vectorloop thread, running with default policy.",
+    "vl_slo: p50 query latency above objective",
+    "vl_slo: p99 query latency above objective",
+    "vl_slo: p999 query latency above objective",
+    "vl_slo: p50 query latency back within objective",
+    "vl_slo: p99 query latency back within objective",
+    "vl_slo: p999 query latency back within objective",
+    "vl_overload: overload level raised",
+    "vl_overload: overload level lowered",
 };
 
+/** How parameter of predefined application log message is formatted. */
+typedef enum app_log_param_e {
+    /** Parameter is errno, logged with strerror() unless 0. */
+    APP_LOG_PARAM_ERRNO = 0,
+    /** Parameter is latency in microseconds of vectorloop sending message. */
+    APP_LOG_PARAM_VL_US,
+    /** Parameter is overload level of vectorloop sending message. */
+    APP_LOG_PARAM_VL_LEVEL,
+} app_log_param_t;
+
+/** Parameter formatting of predefined application log messages.
+ * Order matters and MUST match one for @ref app_log_msg_id_t.
+ */
+static const uint8_t app_log_msg_id_param[] = {
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_ERRNO,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_US,
+    APP_LOG_PARAM_VL_LEVEL,
+    APP_LOG_PARAM_VL_LEVEL,
+};
+
+_Static_assert(sizeof(app_log_msg_id_txt) / sizeof(app_log_msg_id_txt[0]) == APP_LOG_MSG_COUNT,
+               "app_log_msg_id_txt does not match app_log_msg_id_t");
+_Static_assert(sizeof(app_log_msg_id_param) / sizeof(app_log_msg_id_param[0]) == APP_LOG_MSG_COUNT,
+               "app_log_msg_id_param does not match app_log_msg_id_t");
+
+/** Size of buffer parameter of a predefined message is formatted into. */
+#define APP_LOG_PARAM_BUF_SIZE 64
+
+/** Static predefined rate limited error descriptions.
+ * Order matters and MUST match one for @ref app_log_err_id_t.
+ */
+static const char *app_log_err_id_txt[] = {
+    "vl_fn_udp_read: UDP read errors",
+    "vl_fn_udp_write: UDP write errors",
+    "vl_fn_tcp_accept_conns: getsockname() errors",
+};
+
+_Static_assert(APP_LOG_ERR_COUNT <= CHANNEL_LOG_ERR_COUNT,
+               "log channel has fewer error counters than there are error IDs");
+_Static_assert(sizeof(app_log_err_id_txt) / sizeof(app_log_err_id_txt[0]) == APP_LOG_ERR_COUNT,
+               "app_log_err_id_txt does not match app_log_err_id_t");
+
+/** Number of io vectors a log message takes: time, message, parameter
+ * separator, parameter and new line.
+ */
+#define APP_LOG_MSG_IOV 5
+
+/** Log summary of rate limited errors counted on log channels since last
+ * summary, one line per vectorloop and error ID with errors.
+ * 
+ * @note This is a helper function for @ref log_app_loop().
+ * 
+ * @param log_fd        Application log file descriptor, -1 if log file is not
+ *                      open.
+ * @param channels      Application log channels.
+ * @param channel_count Number of entries in channels array.
+ * @param err_seen      Error counts logged by last summary, channel_count *
+ *                      APP_LOG_ERR_COUNT entries.
+ * @param current_time  Time of summary.
+ * @param time_fmt      Timestamp formatting cache of log thread.
+ * @param metrics       Metrics object to record statistics.
+ * 
+ * @return              Returns -1 if writing to log file failed, otherwise 0.
+ */
+static int
+log_app_err_summary(int log_fd, channel_log_t *channels, size_t channel_count,
+                    uint64_t *err_seen, struct timespec *current_time,
+                    utl_time_fmt_t *time_fmt, metrics_t *metrics)
+{
+    char     line[APP_LOG_ERR_SUMMARY_LEN];
+    size_t   time_len = 0;
+    uint64_t count;
+    int      len;
+
+    for (size_t i = 0; i < channel_count; i++) {
+        for (int j = 0; j < APP_LOG_ERR_COUNT; j++) {
+            count = atomic_load_explicit(&channels[i].errors[j], memory_order_relaxed);
+            if (count == err_seen[i * APP_LOG_ERR_COUNT + j]) {
+                continue;
+            }
+
+            /* If time was not formatted, format it! */
+            if (time_len == 0) {
+                time_len = utl_time_fmt_rfc3339nano(time_fmt, current_time, line);
+            }
+            len = snprintf(line + time_len, sizeof(line) - time_len,
+                           " - vectorloop %zu: %llu %s in last %ds, last error: %s\n",
+                           i, (unsigned long long)(count - err_seen[i * APP_LOG_ERR_COUNT + j]),
+                           app_log_err_id_txt[j], APP_LOG_ERR_SUMMARY_TIME,
+                           strerror(atomic_load_explicit(&channels[i].errors_errno[j],
+                                                         memory_order_relaxed)));
+            err_seen[i * APP_LOG_ERR_COUNT + j] = count;
+            if (len < 0) {
+                continue;
+            }
+            len = time_len + len >= sizeof(line) ? sizeof(line) - 1 : time_len + len;
+            line[len - 1] = '\n';
+
+            if (log_fd < 0) {
+                atomic_fetch_add(&metrics->app.app_log_write_error, 1);
+            } else if (write(log_fd, line, len) != len) {
+                atomic_fetch_add(&metrics->app.app_log_write_error, 1);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Wait until a sender wakes up application log thread, or it is time for
+ * next summary of rate limited errors. Senders wake up log thread only when
+ * their channel goes from empty to non-empty, so channels are checked once
+ * more before going to sleep.
+ * 
+ * @note This is a helper function for @ref log_app_loop().
+ * 
+ * @param wake_fd           Eventfd senders wake up log thread with.
+ * @param channels          Application log channels.
+ * @param channel_count     Number of entries in channels array.
+ * @param err_summary_time  Time of next error summary.
+ * @param current_time      Current time.
+ */
+static void
+log_app_wait(int wake_fd, channel_log_t *channels, size_t channel_count,
+             struct timespec *err_summary_time, struct timespec *current_time)
+{
+    struct pollfd pfd     = { .fd = wake_fd, .events = POLLIN };
+    double        wait    = utl_diff_timespec_as_double(err_summary_time, current_time);
+    eventfd_t     value;
+
+    for (size_t i = 0; i < channel_count; i++) {
+        if (!channel_log_empty(&channels[i])) {
+            return;
+        }
+    }
+    if (wait > 0 && poll(&pfd, 1, (int)(wait * 1000) + 1) > 0) {
+        eventfd_read(wake_fd, &value);
+    }
+}
+
 /** Application log loop function. This function is started by pthread.
  * 
  * @param args Arguments passed to application log loop.
@@ -64,32 +225,45 @@ log_app_loop(void *args)
     config_t            *cfg              = app_loop_args->cfg;
     channel_log_t       *app_log_channels = app_loop_args->app_log_channels;
     metrics_t           *metrics          = app_loop_args->metrics;
-    size_t               channel_count    = cfg->process_thread_count;
-    int                  msg_count        = 0;
+    size_t               channel_count    = app_loop_args->app_log_channel_count;
+    size_t               msg_count        = 0;
+    size_t               recv_count       = 0;
+    size_t              *recv_counts      = NULL;
+    uint64_t             dropped          = 0;
     channel_log_msg_t  **messages         = NULL;
-    struct timespec      sleep_time       = {
-                                                .tv_sec = 0,
-                                                .tv_nsec = APP_LOG_LOOP_SLEEP_TIME,
-                                            };
+    int                  wake_fd          = app_loop_args->wake_fd;
     struct timespec      current_time;
     struct iovec        *iov;
+    char               (*param_bufs)[APP_LOG_PARAM_BUF_SIZE];
     size_t               byte_count;
     ssize_t              ret;
     char                 time_buf[TIME_RFC3339_STRLEN+3];
+    utl_time_fmt_t       time_fmt;
     size_t               time_len;
     bool                 exit_by_msg      = false;
+    uint64_t            *err_seen         = NULL;
+    struct timespec      err_summary_time;
 
     int                  log_fd = -1;
     struct timespec      log_open_time = { .tv_sec = 0, .tv_nsec = 0};
 
-    /* Initialize channels on this thread(core). */
-    LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
-    
-    messages = malloc(sizeof(channel_log_msg_t *) * channel_count);
+    messages = malloc(sizeof(channel_log_msg_t *) * APP_LOG_WRITE_MSGS_MAX);
     CHECK_MALLOC(messages);
+    recv_counts = malloc(sizeof(size_t) * channel_count);
+    CHECK_MALLOC(recv_counts);
 
     /* Initialize IO vector*/
-    iov = malloc(sizeof(struct iovec) * channel_count * 3);
+    iov = malloc(sizeof(struct iovec) * APP_LOG_WRITE_MSGS_MAX * APP_LOG_MSG_IOV);
+    CHECK_MALLOC(iov);
+    param_bufs = malloc(sizeof(*param_bufs) * APP_LOG_WRITE_MSGS_MAX);
+    CHECK_MALLOC(param_bufs);
+
+    /* Rate limited error counts already logged. */
+    err_seen = calloc(channel_count * APP_LOG_ERR_COUNT, sizeof(uint64_t));
+    CHECK_MALLOC(err_seen);
+    utl_clock_gettime_rt_fatal(&err_summary_time);
+    err_summary_time.tv_sec += APP_LOG_ERR_SUMMARY_TIME;
+    utl_time_fmt_init(&time_fmt);
 
     while (1) {
         /* Get current time. */
@@ -117,48 +291,97 @@ log_app_loop(void *args)
             }
         }
 
+        /* If it is time, log summary of rate limited errors. */
+        if (utl_diff_timespec_as_double(&err_summary_time, &current_time) <= 0) {
+            if (log_app_err_summary(log_fd, app_log_channels, channel_count, err_seen,
+                                    &current_time, &time_fmt, metrics) < 0) {
+                /* Close log file & try to reopen it in next loop iteration. */
+                close(log_fd);
+                log_fd = -1;
+                log_open_time = (struct timespec) { .tv_sec = 0, .tv_nsec = 0};
+            }
+            err_summary_time = current_time;
+            err_summary_time.tv_sec += APP_LOG_ERR_SUMMARY_TIME;
+        }
+
         msg_count  = 0;
         byte_count = 0;
         time_len   = 0;
         
         /* Collect messages from channels and add then to io vector.*/
         for (size_t i = 0; i < channel_count; i++) {
-            if (channel_log_recv(&app_log_channels[i], &messages[msg_count]) != 0) {
-                /* If time was not formatted, format it! */
-                if (time_len == 0) {
-                    utl_timespec_to_rfc3339nano(&current_time, time_buf);
-                    time_len = strlen(time_buf);
-                    time_buf[time_len]   = ' ';
-                    time_buf[time_len+1] = '-';
-                    time_buf[time_len+2] = ' ';
+            recv_counts[i] = 0;
+            dropped = atomic_exchange_explicit(&app_log_channels[i].dropped, 0,
+                                               memory_order_relaxed);
+            if (dropped != 0) {
+                atomic_fetch_add(&metrics->app.app_log_write_error, dropped);
+            }
+            recv_count = channel_log_recv(&app_log_channels[i], &messages[msg_count],
+                                          APP_LOG_WRITE_MSGS_MAX - msg_count);
+            if (recv_count == 0) {
+                continue;
+            }
+            recv_counts[i] = recv_count;
+
+            /* If time was not formatted, format it! */
+            if (time_len == 0) {
+                time_len = utl_time_fmt_rfc3339nano(&time_fmt, &current_time, time_buf);
+                time_buf[time_len]   = ' ';
+                time_buf[time_len+1] = '-';
+                time_buf[time_len+2] = ' ';
+            }
+
+            for (size_t j = msg_count; j < msg_count + recv_count; j++) {
+                channel_log_msg_t *msg   = messages[j];
+                const char        *text  = msg->log_msg;
+                const char        *param = "";
+                size_t             iov_i = j * APP_LOG_MSG_IOV;
+
+                if (msg->log_msg_id != 0) {
+                    text = app_log_msg_id_txt[msg->log_msg_id];
+                    switch (app_log_msg_id_param[msg->log_msg_id]) {
+                    case APP_LOG_PARAM_VL_US:
+                        snprintf(param_bufs[j], APP_LOG_PARAM_BUF_SIZE,
+                                 "vectorloop %zu, %d us", i, msg->log_msg_param);
+                        param = param_bufs[j];
+                        break;
+                    case APP_LOG_PARAM_VL_LEVEL:
+                        snprintf(param_bufs[j], APP_LOG_PARAM_BUF_SIZE,
+                                 "vectorloop %zu, level %d", i, msg->log_msg_param);
+                        param = param_bufs[j];
+                        break;
+                    default:
+                        if (msg->log_msg_param != 0) {
+                            param = strerror(msg->log_msg_param);
+                        }
+                        break;
+                    }
                 }
 
                 /* Add message to io vector. */
-                if (log_fd > -1) {
-                    int iov_i = msg_count * 3;
-                    iov[iov_i].iov_base = time_buf;
-                    iov[iov_i].iov_len  = time_len + 3;
-
-                    if (messages[msg_count]->log_msg_id != 0) {
-                        iov[iov_i+1].iov_base = (void *)app_log_msg_id_txt[messages[msg_count]->log_msg_id];
-                        iov[iov_i+1].iov_len  = strlen(app_log_msg_id_txt[messages[msg_count]->log_msg_id]);
-                    } else {
-                        iov[iov_i+1].iov_base = messages[msg_count]->log_msg;
-                        iov[iov_i+1].iov_len  = strlen(messages[msg_count]->log_msg);
-                    }
-                    iov[iov_i+2].iov_base = "\n";
-                    iov[iov_i+2].iov_len  = 1;
+                iov[iov_i].iov_base   = time_buf;
+                iov[iov_i].iov_len    = time_len + 3;
+                iov[iov_i+1].iov_base = (void *)text;
+                iov[iov_i+1].iov_len  = msg->log_msg_id != 0 ? strlen(text) : msg->log_msg_len;
+                iov[iov_i+2].iov_base = ", ";
+                iov[iov_i+2].iov_len  = param[0] != '\0' ? 2 : 0;
+                iov[iov_i+3].iov_base = (void *)param;
+                iov[iov_i+3].iov_len  = strlen(param);
+                iov[iov_i+4].iov_base = "\n";
+                iov[iov_i+4].iov_len  = 1;
 
-                    byte_count += iov[iov_i].iov_len + iov[iov_i+1].iov_len + 1;
+                for (int k = 0; k < APP_LOG_MSG_IOV; k++) {
+                    byte_count += iov[iov_i+k].iov_len;
+                }
 
-                    /* Was exit indicated. */
-                    if (messages[msg_count]->exit == true) {
-                        fprintf(stderr, "%s", messages[msg_count]->log_msg);
-                        exit_by_msg = true;
-                    }
+                /* Was exit indicated. */
+                if (msg->exit == true) {
+                    fprintf(stderr, "%s%s%s\n", text, iov[iov_i+2].iov_len != 0 ? ", " : "",
+                            param);
+                    exit_by_msg = true;
                 }
-                msg_count  += 1;
             }
+            msg_count += recv_count;
         }
 
         /* If there were messages received write them to log file. */
@@ -166,7 +389,7 @@ log_app_loop(void *args)
             /* Write io vector to log. */
             if (log_fd > -1) {
                 errno = 0;
-                ret = writev(log_fd, iov, msg_count * 3);
+                ret = writev(log_fd, iov, msg_count * APP_LOG_MSG_IOV);
                 if (ret < byte_count) {
                     /* Error writing to disk. */
                     debug_printf("Error writing to application log file %s, writev() returned: %ld",
@@ -182,19 +405,36 @@ log_app_loop(void *args)
                 /* Application log file is not open, increment message drop counter. */
                 atomic_fetch_add(&metrics->app.app_log_write_error, msg_count);
             }
-            /* Cleanup messages. */
-            for (int i = 0; i < msg_count; i++) {
-                channel_log_msg_release(messages[msg_count]);
+            /* Release message slots. */
+            for (size_t i = 0; i < channel_count; i++) {
+                if (recv_counts[i] != 0) {
+                    channel_log_release(&app_log_channels[i], recv_counts[i]);
+                }
             }
             /* Exit if requested. */
             if (exit_by_msg == true) {
                 exit(1);
             }
+        } else if (atomic_load_explicit(&app_loop_args->stop, memory_order_acquire)) {
+            /* All messages sent before stop was set are written. */
+            break;
         } else {
-            /* No messages to write to log. */
-            clock_nanosleep(CLOCK_REALTIME, 0, &sleep_time, NULL);
+            /* No messages to write to log, wait for a sender to wake us up or
+             * for next error summary.
+             */
+            log_app_wait(wake_fd, app_log_channels, channel_count, &err_summary_time,
+                         &current_time);
         }
     }
 
+    if (log_fd > -1) {
+        close(log_fd);
+    }
+    free(err_seen);
+    free(param_bufs);
+    free(iov);
+    free(recv_counts);
+    free(messages);
+
     return NULL;
 }
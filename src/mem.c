@@ -0,0 +1,197 @@
+/**
+ * @file mem.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup mem
+ *  @{
+ */
+#include <malloc.h>
+#include <stdlib.h>
+
+#include "mem.h"
+
+/** Memory tag label values, indexed by @ref mem_tag_t. */
+const char *mem_tag_txt[MEM_TAGS] = {
+    "udp", "tcp_conns", "tcp_bufs", "query_log", "response_cache", "rrl",
+    "dnssec", "other",
+};
+
+/** Memory account of calling thread, NULL if thread has none. */
+static __thread mem_account_t *mem_account = NULL;
+
+/** Set memory account allocations of calling thread are counted in.
+ *
+ * @param account Memory account, NULL to stop counting.
+ */
+void
+mem_account_set(mem_account_t *account)
+{
+    mem_account = account;
+}
+
+/** Get memory account of calling thread.
+ *
+ * @return Returns memory account, or NULL if thread has none.
+ */
+mem_account_t *
+mem_account_get(void)
+{
+    return mem_account;
+}
+
+/** Add bytes to counter of tag in memory account of calling thread. Used
+ * directly for memory not allocated with tagged allocators, i.e. mapped
+ * memory.
+ *
+ * @param tag   Memory tag.
+ * @param bytes Bytes allocated, negative if released.
+ */
+void
+mem_account_update(mem_tag_t tag, ssize_t bytes)
+{
+    if (mem_account == NULL) {
+        return;
+    }
+    atomic_store_explicit(&mem_account->bytes[tag],
+                          atomic_load_explicit(&mem_account->bytes[tag],
+                                               memory_order_relaxed) + bytes,
+                          memory_order_relaxed);
+}
+
+/** Get bytes allocated by all subsystems of memory account. May be called
+ * by any thread.
+ *
+ * @param account Memory account.
+ *
+ * @return        Returns number of bytes.
+ */
+unsigned long long
+mem_account_total(mem_account_t *account)
+{
+    unsigned long long total = 0;
+
+    for (int i = 0; i < MEM_TAGS; i++) {
+        total += atomic_load_explicit(&account->bytes[i], memory_order_relaxed);
+    }
+    return total;
+}
+
+/** Allocate memory with malloc(), and count it in memory account of calling
+ * thread.
+ *
+ * @param tag  Memory tag.
+ * @param size Number of bytes to allocate.
+ *
+ * @return     Returns allocated memory, or NULL on failure.
+ */
+void *
+mem_malloc(mem_tag_t tag, size_t size)
+{
+    void *ptr = malloc(size);
+
+    if (ptr != NULL && mem_account != NULL) {
+        mem_account_update(tag, malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+/** Allocate zeroed memory with calloc(), and count it in memory account of
+ * calling thread.
+ *
+ * @param tag   Memory tag.
+ * @param count Number of elements.
+ * @param size  Size of element.
+ *
+ * @return      Returns allocated memory, or NULL on failure.
+ */
+void *
+mem_calloc(mem_tag_t tag, size_t count, size_t size)
+{
+    void *ptr = calloc(count, size);
+
+    if (ptr != NULL && mem_account != NULL) {
+        mem_account_update(tag, malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+/** Allocate aligned memory with aligned_alloc(), and count it in memory
+ * account of calling thread.
+ *
+ * @param tag       Memory tag.
+ * @param alignment Alignment of memory.
+ * @param size      Number of bytes to allocate, multiple of alignment.
+ *
+ * @return          Returns allocated memory, or NULL on failure.
+ */
+void *
+mem_aligned_alloc(mem_tag_t tag, size_t alignment, size_t size)
+{
+    void *ptr = aligned_alloc(alignment, size);
+
+    if (ptr != NULL && mem_account != NULL) {
+        mem_account_update(tag, malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+/** Resize memory with realloc(), and update memory account of calling
+ * thread. Memory MUST have been allocated by tagged allocator with same tag,
+ * on calling thread.
+ *
+ * @param tag  Memory tag.
+ * @param ptr  Memory to resize, may be NULL.
+ * @param size New size of memory.
+ *
+ * @return     Returns resized memory, or NULL on failure in which case ptr
+ *             is left unchanged.
+ */
+void *
+mem_realloc(mem_tag_t tag, void *ptr, size_t size)
+{
+    size_t old_size = malloc_usable_size(ptr);
+    void  *new_ptr  = realloc(ptr, size);
+
+    if (new_ptr != NULL && mem_account != NULL) {
+        mem_account_update(tag, (ssize_t)malloc_usable_size(new_ptr) - (ssize_t)old_size);
+    }
+    return new_ptr;
+}
+
+/** Free memory, and subtract it from memory account of calling thread.
+ * Memory MUST have been allocated by tagged allocator with same tag, on
+ * calling thread.
+ *
+ * @param tag Memory tag.
+ * @param ptr Memory to free, may be NULL.
+ */
+void
+mem_free(mem_tag_t tag, void *ptr)
+{
+    if (ptr != NULL && mem_account != NULL) {
+        mem_account_update(tag, -(ssize_t)malloc_usable_size(ptr));
+    }
+    free(ptr);
+}
+
+/** @}*/
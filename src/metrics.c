@@ -0,0 +1,548 @@
+/**
+ * @file metrics.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup metrics
+ *  @{
+ */
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "metrics.h"
+#include "rip_ns_utils.h"
+#include "sketch.h"
+#include "utils.h"
+
+/** Initialize metrics object and allocate per vectorloop metrics.
+ * 
+ * @param metrics  Metrics object to initialize.
+ * @param vl_count Number of vectorloops to allocate metrics for.
+ */
+void
+metrics_init(metrics_t *metrics, size_t vl_count)
+{
+    *metrics = (metrics_t){
+        .vl_shards_count = vl_count,
+    };
+
+    metrics->vl_shards = aligned_alloc(CACHE_LINE_SIZE,
+                                       sizeof(metrics_vl_shard_t) * vl_count);
+    CHECK_MALLOC(metrics->vl_shards);
+    for (size_t i = 0; i < vl_count; i++) {
+        metrics->vl_shards[i] = (metrics_vl_shard_t){ };
+    }
+}
+
+/** Create metrics object, and per vectorloop metrics, in a single shared
+ * anonymous memory mapping, so worker processes forked after it update and
+ * export same metrics, see @ref prefork. Object is never released, and MUST
+ * NOT be cleaned with @ref metrics_clean.
+ *
+ * @param vl_count Number of vectorloops of all worker processes.
+ *
+ * @return         Returns metrics object, exits application if memory could
+ *                 not be mapped.
+ */
+metrics_t *
+metrics_new_shared(size_t vl_count)
+{
+    size_t     offset  = (sizeof(metrics_t) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    metrics_t *metrics = mmap(NULL, offset + sizeof(metrics_vl_shard_t) * vl_count,
+                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (metrics == MAP_FAILED) {
+        fprintf(stderr, "Could not map shared metrics memory, error no: %d, "
+                "error message: %s.\n", errno, strerror(errno));
+        exit(1);
+    }
+
+    /* Mapping is zero filled, as metrics_init() leaves counters. */
+    metrics->vl_shards       = (metrics_vl_shard_t *)((char *)metrics + offset);
+    metrics->vl_shards_count = vl_count;
+
+    return metrics;
+}
+
+/** Initialize an empty sketch window.
+ *
+ * @param w Window to initialize.
+ */
+static void
+metrics_sketch_window_init(metrics_sketch_window_t *w)
+{
+    sketch_topk_init(&w->qnames, METRICS_SKETCH_TOPK_CAPACITY, RIP_NS_MAXCDNAME);
+    sketch_topk_init(&w->clients, METRICS_SKETCH_TOPK_CAPACITY, 0);
+    sketch_hll_reset(&w->clients_hll);
+    w->queries = 0;
+}
+
+/** Empty a sketch window.
+ *
+ * @param w Window to reset.
+ */
+static void
+metrics_sketch_window_reset(metrics_sketch_window_t *w)
+{
+    sketch_topk_reset(&w->qnames);
+    sketch_topk_reset(&w->clients);
+    sketch_hll_reset(&w->clients_hll);
+    w->queries = 0;
+}
+
+/** Release memory held by a sketch window.
+ *
+ * @param w Window to clean.
+ */
+static void
+metrics_sketch_window_clean(metrics_sketch_window_t *w)
+{
+    sketch_topk_clean(&w->qnames);
+    sketch_topk_clean(&w->clients);
+}
+
+/** Release memory held by metrics object, object it self is not freed.
+ * 
+ * @param metrics Metrics object to clean.
+ */
+void
+metrics_clean(metrics_t *metrics)
+{
+    if (metrics->sketch != NULL) {
+        for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+            metrics_sketch_window_clean(&metrics->sketch->vls[i].windows[0]);
+            metrics_sketch_window_clean(&metrics->sketch->vls[i].windows[1]);
+            metrics_sketch_window_clean(&metrics->sketch->last[i]);
+        }
+        metrics_sketch_window_clean(&metrics->sketch->merged);
+        free(metrics->sketch->vls);
+        free(metrics->sketch->last);
+        free(metrics->sketch);
+        metrics->sketch = NULL;
+    }
+    if (metrics->udp_addrs != NULL) {
+        munmap(metrics->udp_addrs, sizeof(metrics_udp_addr_t) * metrics->udp_addrs_count *
+                                   metrics->vl_shards_count);
+        free(metrics->udp_addr_nets);
+        metrics->udp_addrs       = NULL;
+        metrics->udp_addr_nets   = NULL;
+        metrics->udp_addrs_count = 0;
+    }
+    if (metrics->zones != NULL) {
+        munmap(metrics->zones, sizeof(metrics_zone_t) * METRICS_ZONES_MAX);
+        munmap(metrics->zone_counters, sizeof(metrics_zone_counters_t) *
+                                       (METRICS_ZONES_MAX + 1) * metrics->vl_shards_count);
+        metrics->zones         = NULL;
+        metrics->zone_counters = NULL;
+    }
+    if (metrics->cost != NULL) {
+        munmap(metrics->cost, sizeof(metrics_cost_t) * metrics->vl_shards_count);
+        metrics->cost = NULL;
+    }
+    free(metrics->vl_shards);
+    metrics->vl_shards       = NULL;
+    metrics->vl_shards_count = 0;
+}
+
+/** Get metrics of a vectorloop. Only vectorloop the metrics belong to may
+ * update them, and it updates them with @ref METRICS_INC and
+ * @ref METRICS_ADD.
+ * 
+ * @param metrics Metrics object.
+ * @param vl_id   Vectorloop ID.
+ * 
+ * @return        Returns pointer to vectorloop metrics.
+ */
+metrics_vl_t *
+metrics_vl_get(metrics_t *metrics, size_t vl_id)
+{
+    return &metrics->vl_shards[vl_id].vl;
+}
+
+/** Allocate per UDP listener address metrics of all vectorloops, called once
+ * after @ref metrics_init or @ref metrics_new_shared when
+ * "udp_listener_addresses" is configured. Metrics are in a shared anonymous
+ * memory mapping, so worker processes forked after it update same metrics.
+ *
+ * @param metrics Metrics object.
+ * @param addrs   UDP listener addresses, copied.
+ * @param count   Number of UDP listener addresses.
+ */
+void
+metrics_udp_addrs_init(metrics_t *metrics, const utl_net_t *addrs, size_t count)
+{
+    void *mem = mmap(NULL, sizeof(metrics_udp_addr_t) * count * metrics->vl_shards_count,
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "Could not map UDP listener address metrics memory, error no: "
+                "%d, error message: %s.\n", errno, strerror(errno));
+        exit(1);
+    }
+    metrics->udp_addrs     = mem;
+    metrics->udp_addr_nets = malloc(sizeof(utl_net_t) * count);
+    CHECK_MALLOC(metrics->udp_addr_nets);
+    memcpy(metrics->udp_addr_nets, addrs, sizeof(utl_net_t) * count);
+    metrics->udp_addrs_count = count;
+}
+
+/** Get per UDP listener address metrics of a vectorloop, indexed by address
+ * index in "udp_listener_addresses". Only vectorloop the metrics belong to
+ * may update them.
+ *
+ * @param metrics Metrics object.
+ * @param vl_id   Vectorloop ID.
+ *
+ * @return        Returns pointer to vectorloop address metrics, NULL if
+ *                there are none.
+ */
+metrics_udp_addr_t *
+metrics_udp_addrs_get(metrics_t *metrics, size_t vl_id)
+{
+    if (metrics->udp_addrs == NULL) {
+        return NULL;
+    }
+    return &metrics->udp_addrs[vl_id * metrics->udp_addrs_count];
+}
+
+/** Map shared anonymous memory for metrics, exits on failure.
+ *
+ * @param size Size of memory.
+ * @param what What memory is for, for error message.
+ *
+ * @return     Returns zeroed memory.
+ */
+static void *
+metrics_map_shared(size_t size, const char *what)
+{
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s metrics memory, error no: %d, error message: "
+                "%s.\n", what, errno, strerror(errno));
+        exit(1);
+    }
+    return mem;
+}
+
+/** Allocate per zone metrics slots and per zone query counters of all
+ * vectorloops, called once after @ref metrics_init or
+ * @ref metrics_new_shared when "metrics_zones" is configured. Both are in
+ * shared anonymous memory mappings, so worker processes forked after it
+ * update same counters, and register zones in same slots.
+ *
+ * @param metrics Metrics object.
+ */
+void
+metrics_zones_init(metrics_t *metrics)
+{
+    metrics->zones         = metrics_map_shared(sizeof(metrics_zone_t) * METRICS_ZONES_MAX,
+                                                "zone");
+    metrics->zone_counters = metrics_map_shared(sizeof(metrics_zone_counters_t) *
+                                                (METRICS_ZONES_MAX + 1) *
+                                                metrics->vl_shards_count, "zone");
+}
+
+/** Get per zone query counters of a vectorloop, indexed by zone metrics slot,
+ * with overflow row at METRICS_ZONES_MAX. Only vectorloop the counters
+ * belong to may update them.
+ *
+ * @param metrics Metrics object.
+ * @param vl_id   Vectorloop ID.
+ *
+ * @return        Returns pointer to vectorloop zone counters, NULL if zones
+ *                are not counted.
+ */
+metrics_zone_counters_t *
+metrics_zones_vl_get(metrics_t *metrics, size_t vl_id)
+{
+    if (metrics->zone_counters == NULL) {
+        return NULL;
+    }
+    return &metrics->zone_counters[vl_id * (METRICS_ZONES_MAX + 1)];
+}
+
+/** Allocate sampled query cost of all vectorloops and measure frequency of
+ * CPU cycle counter they are timed with, called once after
+ * @ref metrics_init or @ref metrics_new_shared when "metrics_query_cost" is
+ * configured. Cost is in a shared anonymous memory mapping, so worker
+ * processes forked after it update same counters.
+ *
+ * @param metrics Metrics object.
+ */
+void
+metrics_cost_init(metrics_t *metrics)
+{
+    metrics->cost = metrics_map_shared(sizeof(metrics_cost_t) * metrics->vl_shards_count,
+                                       "query cost");
+    metrics->cost_cycles_per_sec = utl_cycles_per_sec();
+}
+
+/** Get sampled query cost of a vectorloop. Only vectorloop the cost belongs
+ * to may update it.
+ *
+ * @param metrics Metrics object.
+ * @param vl_id   Vectorloop ID.
+ *
+ * @return        Returns pointer to vectorloop query cost, NULL if query cost
+ *                is not sampled.
+ */
+metrics_cost_t *
+metrics_cost_vl_get(metrics_t *metrics, size_t vl_id)
+{
+    if (metrics->cost == NULL) {
+        return NULL;
+    }
+    return &metrics->cost[vl_id];
+}
+
+/** Find or claim metrics slot of a zone.
+ *
+ * @param metrics  Metrics object.
+ * @param view     View label, length prefixed.
+ * @param name     Zone apex name, wire format.
+ * @param name_len Length of zone apex name.
+ *
+ * @return         Returns slot index, METRICS_ZONES_MAX if all slots are
+ *                 taken by other zones.
+ */
+static size_t
+metrics_zone_slot(metrics_t *metrics, const unsigned char *view,
+                  const unsigned char *name, uint16_t name_len)
+{
+    uint64_t key = rip_ns_name_hash(name, name_len) ^
+                   (rip_ns_name_hash(view, view[0] + 1) * 0x9e3779b97f4a7c15ULL);
+
+    if (key == 0) {
+        key = 1;
+    }
+    for (size_t i = 0; i < METRICS_ZONES_MAX; i++) {
+        metrics_zone_t *zone     = &metrics->zones[(key + i) % METRICS_ZONES_MAX];
+        uint64_t        expected = 0;
+
+        if (atomic_compare_exchange_strong(&zone->key, &expected, key)) {
+            zone->name_len = name_len;
+            memcpy(zone->view, view, view[0] + 1);
+            memcpy(zone->name, name, name_len);
+            atomic_store_explicit(&zone->ready, true, memory_order_release);
+            return (key + i) % METRICS_ZONES_MAX;
+        }
+        if (expected != key) {
+            continue;
+        }
+        while (!atomic_load_explicit(&zone->ready, memory_order_acquire)) {
+            /* Other process is writing names of slot. */
+        }
+        if (zone->name_len == name_len && memcmp(zone->name, name, name_len) == 0 &&
+            memcmp(zone->view, view, view[0] + 1) == 0) {
+            return (key + i) % METRICS_ZONES_MAX;
+        }
+    }
+    return METRICS_ZONES_MAX;
+}
+
+/** Register zones of a zone database in per zone metrics slots, and store
+ * slot of each zone in zone_slots array of database, which query resolution
+ * reads. Called by resource thread before database is published. Zone keeps
+ * its slot across database generations, so its counters continue.
+ *
+ * @param metrics Metrics object, does nothing if zones are not counted.
+ * @param view    View label, length prefixed, single 0 byte for main zone
+ *                database.
+ * @param db      Zone database.
+ */
+void
+metrics_zones_register(metrics_t *metrics, const unsigned char *view, zone_db_t *db)
+{
+    size_t count = db->zones_count < UINT16_MAX ? db->zones_count : UINT16_MAX + 1;
+
+    if (metrics->zones == NULL || db->zone_slots != NULL || count == 0) {
+        return;
+    }
+    db->zone_slots = malloc(sizeof(uint16_t) * count);
+    CHECK_MALLOC(db->zone_slots);
+    for (size_t i = 0; i < count; i++) {
+        const zone_node_t *apex = &db->nodes[db->zones[i]];
+
+        db->zone_slots[i] = metrics_zone_slot(metrics, view, apex->name, apex->name_len) + 1;
+    }
+}
+
+/** Sum metrics of all vectorloops. Safe to call from any thread while
+ * vectorloops are running, each counter is read atomically, though counters
+ * are not read all at the same instant.
+ * 
+ * @param metrics Metrics object.
+ * @param sum     Where to store the sum.
+ */
+void
+metrics_vl_sum(metrics_t *metrics, metrics_vl_t *sum)
+{
+    atomic_ullong *dst = (atomic_ullong *)sum;
+
+    for (size_t c = 0; c < METRICS_VL_COUNTERS; c++) {
+        unsigned long long total = 0;
+
+        for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+            atomic_ullong *src = (atomic_ullong *)&metrics->vl_shards[i].vl;
+
+            total += atomic_load_explicit(&src[c], memory_order_relaxed);
+        }
+        atomic_store_explicit(&dst[c], total, memory_order_relaxed);
+    }
+}
+
+/** Allocate query sketches of all vectorloops, called once after
+ * @ref metrics_init when "metrics_sketches" is configured.
+ *
+ * @param metrics Metrics object.
+ */
+void
+metrics_sketch_init(metrics_t *metrics)
+{
+    metrics_sketch_t *s = malloc(sizeof(metrics_sketch_t));
+
+    CHECK_MALLOC(s);
+    s->vls = aligned_alloc(CACHE_LINE_SIZE,
+                           sizeof(metrics_sketch_vl_t) * metrics->vl_shards_count);
+    CHECK_MALLOC(s->vls);
+    s->last = malloc(sizeof(metrics_sketch_window_t) * metrics->vl_shards_count);
+    CHECK_MALLOC(s->last);
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_sketch_vl_t *vl = &s->vls[i];
+
+        atomic_init(&vl->epoch, 0);
+        atomic_init(&vl->acked, 0);
+        vl->collected = 0;
+        vl->seen      = 0;
+        vl->current = &vl->windows[0];
+        metrics_sketch_window_init(&vl->windows[0]);
+        metrics_sketch_window_init(&vl->windows[1]);
+        metrics_sketch_window_init(&s->last[i]);
+    }
+    metrics_sketch_window_init(&s->merged);
+    metrics->sketch = s;
+}
+
+/** Get query sketches of a vectorloop. Only vectorloop sketches belong to
+ * may update them.
+ *
+ * @param metrics Metrics object.
+ * @param vl_id   Vectorloop ID.
+ *
+ * @return        Returns pointer to vectorloop sketches, or NULL if
+ *                "metrics_sketches" is not configured.
+ */
+metrics_sketch_vl_t *
+metrics_sketch_vl_get(metrics_t *metrics, size_t vl_id)
+{
+    if (metrics->sketch == NULL) {
+        return NULL;
+    }
+    return &metrics->sketch->vls[vl_id];
+}
+
+/** End current window of vectorloops, called by metrics thread every
+ * @ref METRICS_SKETCH_INTERVAL seconds. Each vectorloop whose previous
+ * window was collected is moved to its other, empty, window. Window it
+ * leaves is collected by @ref metrics_sketch_merge once vectorloop
+ * acknowledged the move.
+ *
+ * @param metrics Metrics object.
+ */
+void
+metrics_sketch_flip(metrics_t *metrics)
+{
+    metrics_sketch_t *s = metrics->sketch;
+
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_sketch_vl_t *vl    = &s->vls[i];
+        unsigned int         epoch = atomic_load_explicit(&vl->epoch, memory_order_relaxed);
+
+        if (vl->collected == epoch) {
+            atomic_store_explicit(&vl->epoch, epoch + 1, memory_order_release);
+        }
+    }
+}
+
+/** Collect windows vectorloops left and merge them, called by metrics thread
+ * after @ref metrics_sketch_flip until no vectorloop is pending.
+ *
+ * Window a vectorloop left, once it acknowledged leaving it, is swapped with
+ * its last complete window, and last complete window it replaces is emptied
+ * for next flip. Vectorloops acknowledge within one loop iteration, which
+ * is at most "loop_idle_wait_max" milliseconds when idle. If any window was
+ * collected, merged window is rebuilt from last complete windows of all
+ * vectorloops.
+ *
+ * @param metrics Metrics object.
+ *
+ * @return        Returns number of vectorloops that have not acknowledged
+ *                leaving their window yet.
+ */
+size_t
+metrics_sketch_merge(metrics_t *metrics)
+{
+    metrics_sketch_t        *s         = metrics->sketch;
+    size_t                   pending   = 0;
+    size_t                   collected = 0;
+    metrics_sketch_window_t  tmp;
+
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_sketch_vl_t     *vl    = &s->vls[i];
+        unsigned int             epoch = atomic_load_explicit(&vl->epoch, memory_order_relaxed);
+        metrics_sketch_window_t *done;
+
+        if (vl->collected == epoch) {
+            continue;
+        }
+        if (atomic_load_explicit(&vl->acked, memory_order_acquire) != epoch) {
+            pending++;
+            continue;
+        }
+        done          = &vl->windows[(epoch + 1) & 1];
+        tmp           = *done;
+        *done         = s->last[i];
+        s->last[i]    = tmp;
+        vl->collected = epoch;
+        metrics_sketch_window_reset(done);
+        collected++;
+    }
+    if (collected == 0) {
+        return pending;
+    }
+
+    metrics_sketch_window_reset(&s->merged);
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        sketch_topk_merge(&s->merged.qnames, &s->last[i].qnames);
+        sketch_topk_merge(&s->merged.clients, &s->last[i].clients);
+        sketch_hll_merge(&s->merged.clients_hll, &s->last[i].clients_hll);
+        s->merged.queries += s->last[i].queries;
+    }
+    return pending;
+}
+
+/** @}*/
@@ -0,0 +1,1353 @@
+/**
+ * @file metrics_loop.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup metrics
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "rip_ns_utils.h"
+#include "sketch.h"
+#include "utils.h"
+#include "vectorloop_xdp.h"
+
+/** Structure describes a counter exported in Prometheus text format. */
+typedef struct metrics_export_counter_s {
+    /** Metric name. Counters sharing a name MUST be listed one after another. */
+    const char *name;
+
+    /** Metric labels, NULL if none. */
+    const char *labels;
+
+    /** Metric help text, only printed for first counter of a name. */
+    const char *help;
+
+    /** Offset of counter in @ref metrics_vl_t. */
+    size_t offset;
+} metrics_export_counter_t;
+
+/** Shorthand to describe a @ref metrics_vl_t counter. */
+#define METRICS_EXPORT_COUNTER(name, labels, help, member) \
+    { name, labels, help, offsetof(metrics_vl_t, member) }
+
+/** Vectorloop counters exported in Prometheus text format. */
+static const metrics_export_counter_t metrics_export_counters[] = {
+    METRICS_EXPORT_COUNTER("ripples_tcp_connections_total", NULL,
+        "TCP connections accepted.", tcp.connections),
+    METRICS_EXPORT_COUNTER("ripples_tcp_queries_total", NULL,
+        "Queries received over TCP.", tcp.queries),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"unknown_client_ip_family\"",
+        "TCP connection errors by reason.", tcp.unknown_client_ip_soc_family),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"getsockname\"",
+        NULL, tcp.getsockname_err),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"unknown_local_ip_family\"",
+        NULL, tcp.unknown_local_ip_soc_family),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"conn_id_unavailable\"",
+        NULL, tcp.conn_id_unavailable),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"query_len_toolarge\"",
+        NULL, tcp.query_len_toolarge),
+    METRICS_EXPORT_COUNTER("ripples_tcp_errors_total", "reason=\"client_conns_max\"",
+        NULL, tcp.client_conns_max),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"query_recv_timeout\"",
+        "TCP connections closed by reason.", tcp.query_recv_timeout),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"keepalive_timeout\"",
+        NULL, tcp.keepalive_timeout),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"no_query\"",
+        NULL, tcp.closed_no_query),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"partial_query\"",
+        NULL, tcp.closed_partial_query),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"sock_read_err\"",
+        NULL, tcp.sock_read_err),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"sock_write_err\"",
+        NULL, tcp.sock_write_err),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"sock_write_timeout\"",
+        NULL, tcp.sock_write_timeout),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"sock_closed_for_write\"",
+        NULL, tcp.sock_closed_for_write),
+    METRICS_EXPORT_COUNTER("ripples_tcp_closed_total", "reason=\"idle_evicted\"",
+        NULL, tcp.idle_evicted),
+    METRICS_EXPORT_COUNTER("ripples_tcp_handoffs_total", "direction=\"out\"",
+        "TCP connections handed off between vectorloops.", tcp.handoffs_out),
+    METRICS_EXPORT_COUNTER("ripples_tcp_handoffs_total", "direction=\"in\"",
+        NULL, tcp.handoffs_in),
+
+    METRICS_EXPORT_COUNTER("ripples_udp_queries_total", NULL,
+        "Queries received over UDP.", udp.queries),
+    METRICS_EXPORT_COUNTER("ripples_udp_send_messages_total", NULL,
+        "UDP messages handed to kernel, a GSO message counts once.", udp.send_msgs),
+    METRICS_EXPORT_COUNTER("ripples_udp_gso_responses_total", NULL,
+        "UDP responses sent as segment of a GSO message.", udp.responses_gso),
+    METRICS_EXPORT_COUNTER("ripples_udp_batches_full_total", NULL,
+        "Times UDP write blocked with no free listener batch left.", udp.batches_full),
+    METRICS_EXPORT_COUNTER("ripples_udp_recvbuff_raises_total", NULL,
+        "Times UDP listener receive buffer size was raised after kernel drops.",
+        udp.recvbuff_raises),
+    METRICS_EXPORT_COUNTER("ripples_udp_mirrored_total", NULL,
+        "UDP queries mirrored to shadow server.", udp.mirrored),
+    METRICS_EXPORT_COUNTER("ripples_udp_mirror_dropped_total", NULL,
+        "UDP queries not mirrored because mirroring socket could not take them.",
+        udp.mirror_dropped),
+
+    METRICS_EXPORT_COUNTER("ripples_dot_handshakes_total", NULL,
+        "DoT TLS handshakes done, connection switched to kernel TLS.", dot.handshakes),
+    METRICS_EXPORT_COUNTER("ripples_dot_errors_total", "reason=\"handshake\"",
+        "DoT connection errors by reason.", dot.handshake_errors),
+    METRICS_EXPORT_COUNTER("ripples_dot_errors_total", "reason=\"handshake_busy\"",
+        NULL, dot.handshake_busy),
+
+    METRICS_EXPORT_COUNTER("ripples_dnssec_signatures_total", NULL,
+        "RRsets signed online.", dnssec.signatures),
+    METRICS_EXPORT_COUNTER("ripples_dnssec_sign_errors_total", NULL,
+        "RRsets that could not be signed online.", dnssec.sign_errors),
+    METRICS_EXPORT_COUNTER("ripples_dnssec_sig_cache_total", "result=\"hit\"",
+        "Signature cache lookups by result.", dnssec.sig_cache_hits),
+    METRICS_EXPORT_COUNTER("ripples_dnssec_sig_cache_total", "result=\"miss\"",
+        NULL, dnssec.sig_cache_misses),
+    METRICS_EXPORT_COUNTER("ripples_dnssec_responses_unsigned_total", NULL,
+        "Responses sent unsigned because workers were busy.", dnssec.responses_unsigned),
+
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_total", NULL,
+        "DNS queries received.", dns.queries),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"noerror\"",
+        "DNS queries by response rcode.", dns.queries_rcode_noerror),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"formerr\"",
+        NULL, dns.queries_rcode_formerr),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"servfail\"",
+        NULL, dns.queries_rcode_servfail),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"nxdomain\"",
+        NULL, dns.queries_rcode_nxdomain),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"notimpl\"",
+        NULL, dns.queries_rcode_notimpl),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"refused\"",
+        NULL, dns.queries_rcode_refused),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"shortheader\"",
+        NULL, dns.queries_rcode_shortheader),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"toolarge\"",
+        NULL, dns.queries_rcode_toolarge),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_rcode_total", "rcode=\"badversion\"",
+        NULL, dns.queries_rcode_badversion),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"invalid\"",
+        "DNS queries by question type.", dns.queries_type[RIP_NS_QTYPE_IDX_INVALID]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"A\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_A]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"AAAA\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_AAAA]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"CNAME\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_CNAME]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"MX\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_MX]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"NS\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_NS]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"PTR\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_PTR]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"SRV\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_SRV]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"SOA\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_SOA]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"TXT\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_TXT]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"ANY\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_ANY]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"AXFR\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_AXFR]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"IXFR\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_IXFR]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_type_total", "type=\"unsupported\"",
+        NULL, dns.queries_type[RIP_NS_QTYPE_IDX_UNSUPPORTED]),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"present\"",
+        "DNS queries with EDNS.", dns.queries_edns_present),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"valid\"",
+        NULL, dns.queries_edns_valid),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"dobit\"",
+        NULL, dns.queries_edns_dobit),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"clientsubnet\"",
+        NULL, dns.queries_clientsubnet),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"cookie\"",
+        NULL, dns.queries_cookie),
+    METRICS_EXPORT_COUNTER("ripples_dns_queries_edns_total", "edns=\"cookie_valid\"",
+        NULL, dns.queries_cookie_valid),
+    METRICS_EXPORT_COUNTER("ripples_response_cache_total", "result=\"hit\"",
+        "Response cache lookups by result.", dns.response_cache_hits),
+    METRICS_EXPORT_COUNTER("ripples_response_cache_total", "result=\"miss\"",
+        NULL, dns.response_cache_misses),
+    METRICS_EXPORT_COUNTER("ripples_response_cache_total", "result=\"coalesced\"",
+        NULL, dns.response_cache_coalesced),
+    METRICS_EXPORT_COUNTER("ripples_response_cache_total", "result=\"shared_hit\"",
+        NULL, dns.response_cache_shared_hits),
+
+    METRICS_EXPORT_COUNTER("ripples_rrl_responses_total", "action=\"drop\"",
+        "UDP responses over response rate limit by action taken.", dns.rrl_dropped),
+    METRICS_EXPORT_COUNTER("ripples_rrl_responses_total", "action=\"slip\"",
+        NULL, dns.rrl_slipped),
+
+    METRICS_EXPORT_COUNTER("ripples_queries_deferred_total", NULL,
+        "Times queries were deferred waiting for worker threads.", dns.queries_deferred),
+
+    METRICS_EXPORT_COUNTER("ripples_acl_total", "action=\"refuse\"",
+        "Queries, and TCP connections, denied by client ACL by action taken.",
+        dns.acl_refused),
+    METRICS_EXPORT_COUNTER("ripples_acl_total", "action=\"drop\"",
+        NULL, dns.acl_dropped),
+
+    METRICS_EXPORT_COUNTER("ripples_policy_total", "action=\"nxdomain\"",
+        "Queries matching response policy by action taken.", dns.policy_nxdomain),
+    METRICS_EXPORT_COUNTER("ripples_policy_total", "action=\"nodata\"",
+        NULL, dns.policy_nodata),
+    METRICS_EXPORT_COUNTER("ripples_policy_total", "action=\"refuse\"",
+        NULL, dns.policy_refused),
+    METRICS_EXPORT_COUNTER("ripples_policy_total", "action=\"drop\"",
+        NULL, dns.policy_dropped),
+    METRICS_EXPORT_COUNTER("ripples_policy_total", "action=\"passthru\"",
+        NULL, dns.policy_passthru),
+
+    METRICS_EXPORT_COUNTER("ripples_geoip_lookups_total", "result=\"cached\"",
+        "GeoIP lookups by whether result was in vectorloop cache.", dns.geoip_cache_hits),
+    METRICS_EXPORT_COUNTER("ripples_geoip_lookups_total", "result=\"database\"",
+        NULL, dns.geoip_cache_misses),
+
+    METRICS_EXPORT_COUNTER("ripples_lb_answers_total", "health=\"healthy\"",
+        "Queries answered from load balancing candidate set, by whether any "
+        "endpoint was healthy.", dns.lb_answers),
+    METRICS_EXPORT_COUNTER("ripples_lb_answers_total", "health=\"all_down\"",
+        NULL, dns.lb_all_down),
+
+    METRICS_EXPORT_COUNTER("ripples_xdp_responder_puts_total", NULL,
+        "Responses vectorloops added to in-kernel responder map of XDP program.",
+        dns.xdp_responder_puts),
+
+    METRICS_EXPORT_COUNTER("ripples_overload_periods_total", "level=\"0\"",
+        "Overload periods vectorloops spent at each overload level.",
+        overload.periods[VL_OVERLOAD_NONE]),
+    METRICS_EXPORT_COUNTER("ripples_overload_periods_total", "level=\"1\"",
+        NULL, overload.periods[VL_OVERLOAD_SHED_LOG]),
+    METRICS_EXPORT_COUNTER("ripples_overload_periods_total", "level=\"2\"",
+        NULL, overload.periods[VL_OVERLOAD_SHED_QTYPES]),
+    METRICS_EXPORT_COUNTER("ripples_overload_periods_total", "level=\"3\"",
+        NULL, overload.periods[VL_OVERLOAD_SHED_CLIENTS]),
+    METRICS_EXPORT_COUNTER("ripples_overload_shed_total", "action=\"log_skip\"",
+        "Queries work was shed for under overload by action taken.",
+        overload.log_skipped),
+    METRICS_EXPORT_COUNTER("ripples_overload_shed_total", "action=\"qtype_drop\"",
+        NULL, overload.qtype_dropped),
+    METRICS_EXPORT_COUNTER("ripples_overload_shed_total", "action=\"client_drop\"",
+        NULL, overload.client_dropped),
+    METRICS_EXPORT_COUNTER("ripples_overload_shed_total", "action=\"client_slip\"",
+        NULL, overload.client_slipped),
+
+    METRICS_EXPORT_COUNTER("ripples_query_log_buf_no_space_total", NULL,
+        "Queries not logged for lack of query log buffer space.",
+        app.query_log_buf_no_space),
+    METRICS_EXPORT_COUNTER("ripples_query_log_ring_full_total", NULL,
+        "Times a full query log chunk could not be published as query log ring was full.",
+        app.query_log_ring_full),
+    METRICS_EXPORT_COUNTER("ripples_query_log_filtered_total", NULL,
+        "Queries not logged because of query log filters or sampling.",
+        app.query_log_filtered),
+    METRICS_EXPORT_COUNTER("ripples_query_log_spilled_total", NULL,
+        "Queries logged to spill buffer as query log ring was full.",
+        app.query_log_spilled),
+    METRICS_EXPORT_COUNTER("ripples_query_log_aged_total", NULL,
+        "Spilled queries dropped for exceeding query_log_age_max.",
+        app.query_log_aged),
+    METRICS_EXPORT_COUNTER("ripples_query_log_sampled_out_total", NULL,
+        "Queries not logged because of sampling while query log ring was full.",
+        app.query_log_sampled_out),
+};
+
+/** Number of entries in @ref metrics_export_counters. */
+#define METRICS_EXPORT_COUNTERS_COUNT \
+    (sizeof(metrics_export_counters) / sizeof(metrics_export_counter_t))
+
+/** Protocol label values of latency histograms, indexed as in
+ * @ref metrics_vl_t latency structure.
+ */
+static const char *metrics_export_proto_txt[METRICS_LATENCY_PROTOCOLS] = {
+    "udp", "tcp",
+};
+
+/** Rcode label values of end to end latency histograms. */
+static const char *metrics_export_rcode_txt[METRICS_LATENCY_RCODES] = {
+    "noerror", "formerr", "servfail", "nxdomain", "notimpl", "refused", "other",
+};
+
+/** Stage label values of stage latency histograms. */
+static const char *metrics_export_stage_txt[METRICS_LATENCY_STAGES] = {
+    "recv_parse", "parse_resolve", "resolve_pack", "pack_send",
+};
+
+/** Stage label values of vectorloop stage histograms, indexed by
+ * @ref metrics_vl_stage_t.
+ */
+static const char *metrics_export_vl_stage_txt[METRICS_VL_STAGES] = {
+    "resources", "epoll", "udp_read", "tcp_accept", "dot_handshakes",
+    "tcp_handoff", "query_resume", "tcp_read", "query_parse", "query_resolve", "response_pack",
+    "write", "query_log", "tcp_timeouts", "tcp_release", "idle",
+};
+
+/** Queue label values of vectorloop queue metrics, indexed by
+ * @ref metrics_vl_queue_t.
+ */
+static const char *metrics_export_vl_queue_txt[METRICS_VL_QUEUES] = {
+    "query_parse", "query_resolve", "response_pack", "query_log", "tcp_read",
+    "tcp_write", "tcp_release",
+};
+
+/** Path label values of query cost, indexed by @ref metrics_cost_path_t. */
+static const char *metrics_export_cost_path_txt[METRICS_COST_PATHS] = {
+    "plain", "cached", "ecs", "truncated",
+};
+
+/** Rcode label values of per zone query counters and query cost, indexed by
+ * @ref metrics_rcode_idx_t.
+ */
+static const char *metrics_export_zone_rcode_txt[METRICS_RCODE_COUNT] = {
+    "noerror", "formerr", "servfail", "nxdomain", "notimpl", "refused", "badversion",
+    "shortheader", "toolarge", "other",
+};
+
+/** Type label values of per zone query counters and query cost, indexed by
+ * @ref rip_ns_qtype_idx_t.
+ */
+static const char *metrics_export_zone_type_txt[RIP_NS_QTYPE_IDX_COUNT] = {
+    "unsupported", "invalid", "A", "AAAA", "CNAME", "MX", "NS", "PTR", "SRV", "SOA", "TXT",
+    "ANY", "AXFR", "IXFR",
+};
+
+/** Structure describes a growing text buffer. */
+typedef struct metrics_export_buf_s {
+    /** Buffer. */
+    char *buf;
+
+    /** Length of data in buffer. */
+    size_t len;
+
+    /** Size of buffer. */
+    size_t size;
+} metrics_export_buf_t;
+
+/** Append formatted text to buffer, growing buffer as needed.
+ * 
+ * @param b   Buffer to append to.
+ * @param fmt printf style format.
+ */
+static void
+metrics_export_printf(metrics_export_buf_t *b, const char *fmt, ...)
+{
+    va_list ap;
+    int     n;
+
+    while (1) {
+        va_start(ap, fmt);
+        n = vsnprintf(b->buf + b->len, b->size - b->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < b->size - b->len) {
+            b->len += n;
+            return;
+        }
+        b->size = b->size * 2 + n;
+        b->buf  = realloc(b->buf, b->size);
+        CHECK_MALLOC(b->buf);
+    }
+}
+
+/** Append a histogram in Prometheus text format to buffer. Bucket bounds and
+ * sum are divided by scale, i.e. 1e9 converts nanoseconds to seconds.
+ * 
+ * @param b            Buffer to append to.
+ * @param name         Metric name.
+ * @param labels       Labels of histogram, without the "le" label.
+ * @param h            Histogram to append.
+ * @param exponent_min Power of two of first bucket bound exported.
+ * @param scale        Value bucket bounds and sum are divided by.
+ */
+static void
+metrics_export_histogram(metrics_export_buf_t *b, const char *name,
+                         const char *labels, histogram_t *h,
+                         unsigned int exponent_min, double scale)
+{
+    unsigned long long cumulative = 0;
+    unsigned int       exponent   = exponent_min;
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        /* Export only buckets ending at a power of two. */
+        if (histogram_bucket_value_max(i) + 1 == (uint64_t)1 << exponent) {
+            metrics_export_printf(b, "%s_bucket{%s,le=\"%.10g\"} %llu\n", name,
+                                  labels, ((uint64_t)1 << exponent) / scale,
+                                  cumulative);
+            exponent++;
+        }
+    }
+    cumulative += atomic_load_explicit(&h->buckets[HISTOGRAM_BUCKETS - 1],
+                                       memory_order_relaxed);
+    metrics_export_printf(b, "%s_bucket{%s,le=\"+Inf\"} %llu\n", name, labels,
+                          cumulative);
+    metrics_export_printf(b, "%s_sum{%s} %.9f\n", name, labels,
+                          atomic_load_explicit(&h->sum, memory_order_relaxed) / scale);
+    metrics_export_printf(b, "%s_count{%s} %llu\n", name, labels, cumulative);
+}
+
+/** Append vectorloop stage metrics in Prometheus text format to buffer.
+ * Unlike other vectorloop metrics they are exported per vectorloop, labeled
+ * with vectorloop ID. Idle fraction of a vectorloop is
+ * ripples_vl_loop_cycles_total{state="idle"} over sum of both states.
+ * 
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_vl_stages(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    char labels[128];
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_cycles_per_second Frequency of CPU cycle counter "
+        "vectorloop stages are timed with.\n"
+        "# TYPE ripples_vl_cycles_per_second gauge\n"
+        "ripples_vl_cycles_per_second %llu\n",
+        atomic_load(&metrics->cycles_per_sec));
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_loop_iterations_total Vectorloop iterations by "
+        "whether they processed anything.\n"
+        "# TYPE ripples_vl_loop_iterations_total counter\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_vl_t *vl = &metrics->vl_shards[i].vl;
+
+        metrics_export_printf(b,
+            "ripples_vl_loop_iterations_total{vl=\"%zu\",state=\"busy\"} %llu\n"
+            "ripples_vl_loop_iterations_total{vl=\"%zu\",state=\"idle\"} %llu\n",
+            i, atomic_load_explicit(&vl->loop.iterations_busy, memory_order_relaxed),
+            i, atomic_load_explicit(&vl->loop.iterations_idle, memory_order_relaxed));
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_loop_cycles_total Vectorloop CPU cycles spent "
+        "processing and idle.\n"
+        "# TYPE ripples_vl_loop_cycles_total counter\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_vl_t *vl = &metrics->vl_shards[i].vl;
+
+        metrics_export_printf(b,
+            "ripples_vl_loop_cycles_total{vl=\"%zu\",state=\"busy\"} %llu\n"
+            "ripples_vl_loop_cycles_total{vl=\"%zu\",state=\"idle\"} %llu\n",
+            i, atomic_load_explicit(&vl->loop.cycles_busy, memory_order_relaxed),
+            i, atomic_load_explicit(&vl->loop.cycles_idle, memory_order_relaxed));
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_loop_iteration_cycles CPU cycles of vectorloop "
+        "iterations that processed something, idle time excluded.\n"
+        "# TYPE ripples_vl_loop_iteration_cycles histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_vl_loop_iteration_cycles", labels,
+                                 &metrics->vl_shards[i].vl.loop.iteration,
+                                 METRICS_EXPORT_CYCLES_EXPONENT_MIN, 1);
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_stage_cycles CPU cycles of each vectorloop stage "
+        "per iteration.\n"
+        "# TYPE ripples_vl_stage_cycles histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        for (int s = 0; s < METRICS_VL_STAGES; s++) {
+            snprintf(labels, sizeof(labels), "vl=\"%zu\",stage=\"%s\"", i,
+                     metrics_export_vl_stage_txt[s]);
+            metrics_export_histogram(b, "ripples_vl_stage_cycles", labels,
+                                     &metrics->vl_shards[i].vl.loop.cycles[s],
+                                     METRICS_EXPORT_CYCLES_EXPONENT_MIN, 1);
+        }
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_stage_items Items each vectorloop stage processed "
+        "per iteration, when it processed any.\n"
+        "# TYPE ripples_vl_stage_items histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        for (int s = 0; s < METRICS_VL_STAGES; s++) {
+            snprintf(labels, sizeof(labels), "vl=\"%zu\",stage=\"%s\"", i,
+                     metrics_export_vl_stage_txt[s]);
+            metrics_export_histogram(b, "ripples_vl_stage_items", labels,
+                                     &metrics->vl_shards[i].vl.loop.items[s],
+                                     0, 1);
+        }
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_queue_depth Highest length of each vectorloop queue "
+        "per iteration, when it held any entries.\n"
+        "# TYPE ripples_vl_queue_depth histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        for (int q = 0; q < METRICS_VL_QUEUES; q++) {
+            snprintf(labels, sizeof(labels), "vl=\"%zu\",queue=\"%s\"", i,
+                     metrics_export_vl_queue_txt[q]);
+            metrics_export_histogram(b, "ripples_vl_queue_depth", labels,
+                                     &metrics->vl_shards[i].vl.loop.queue_depth[q],
+                                     0, 1);
+        }
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_vl_queue_dwell_cycles Mean CPU cycles entries spent in "
+        "each vectorloop queue per iteration, when any were queued.\n"
+        "# TYPE ripples_vl_queue_dwell_cycles histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        for (int q = 0; q < METRICS_VL_QUEUES; q++) {
+            snprintf(labels, sizeof(labels), "vl=\"%zu\",queue=\"%s\"", i,
+                     metrics_export_vl_queue_txt[q]);
+            metrics_export_histogram(b, "ripples_vl_queue_dwell_cycles", labels,
+                                     &metrics->vl_shards[i].vl.loop.queue_dwell[q],
+                                     METRICS_EXPORT_CYCLES_EXPONENT_MIN, 1);
+        }
+    }
+}
+
+/** Append per UDP listener address metrics in Prometheus text format to
+ * buffer, summed over vectorloops and labeled with address.
+ *
+ * @note This is a helper function for @ref metrics_export_udp_listeners().
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_udp_addrs(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    static const char *names[] = {
+        "ripples_udp_listener_datagrams_total",
+        "ripples_udp_listener_rxq_drops_total",
+    };
+    static const char *helps[] = {
+        "UDP datagrams received on listener address.",
+        "UDP datagrams kernel dropped because listener address receive buffer was full.",
+    };
+    char addr[INET6_ADDRSTRLEN];
+
+    for (size_t m = 0; m < sizeof(names) / sizeof(names[0]); m++) {
+        metrics_export_printf(b, "# HELP %s %s\n# TYPE %s counter\n",
+                              names[m], helps[m], names[m]);
+        for (size_t a = 0; a < metrics->udp_addrs_count; a++) {
+            unsigned long long total = 0;
+
+            for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+                metrics_udp_addr_t *ua = &metrics->udp_addrs[i * metrics->udp_addrs_count + a];
+
+                total += atomic_load_explicit(m == 0 ? &ua->datagrams : &ua->rxq_drops,
+                                              memory_order_relaxed);
+            }
+            inet_ntop(metrics->udp_addr_nets[a].family, metrics->udp_addr_nets[a].addr,
+                      addr, sizeof(addr));
+            metrics_export_printf(b, "%s{addr=\"%s\"} %llu\n", names[m], addr, total);
+        }
+    }
+}
+
+/** Append UDP listener metrics in Prometheus text format to buffer: datagrams
+ * kernel dropped per listener, labeled with vectorloop ID and IP family,
+ * datagrams each read of vectorloop listeners returned, and per address
+ * metrics if UDP listeners are bound to addresses.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_udp_listeners(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    char labels[32];
+
+    metrics_export_printf(b,
+        "# HELP ripples_udp_rxq_drops_total UDP datagrams kernel dropped "
+        "because listener receive buffer was full.\n"
+        "# TYPE ripples_udp_rxq_drops_total counter\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_vl_t *vl = &metrics->vl_shards[i].vl;
+
+        metrics_export_printf(b,
+            "ripples_udp_rxq_drops_total{vl=\"%zu\",family=\"ipv4\"} %llu\n"
+            "ripples_udp_rxq_drops_total{vl=\"%zu\",family=\"ipv6\"} %llu\n",
+            i, atomic_load_explicit(&vl->udp.rxq_drops[0], memory_order_relaxed),
+            i, atomic_load_explicit(&vl->udp.rxq_drops[1], memory_order_relaxed));
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_udp_recv_batch_datagrams UDP datagrams each listener "
+        "read returned.\n"
+        "# TYPE ripples_udp_recv_batch_datagrams histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_udp_recv_batch_datagrams", labels,
+                                 &metrics->vl_shards[i].vl.udp.recv_batch, 0, 1);
+    }
+
+    if (metrics->udp_addrs != NULL) {
+        metrics_export_udp_addrs(b, metrics);
+    }
+}
+
+/** Append TCP connection lifetime metrics in Prometheus text format to
+ * buffer: queries, duration and bytes read and written of each connection,
+ * labeled with vectorloop ID.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_tcp_conns(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    char labels[32];
+
+    metrics_export_printf(b,
+        "# HELP ripples_tcp_conn_queries Queries each TCP connection received "
+        "over its lifetime.\n"
+        "# TYPE ripples_tcp_conn_queries histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_tcp_conn_queries", labels,
+                                 &metrics->vl_shards[i].vl.tcp.conn_queries, 0, 1);
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_tcp_conn_duration_seconds Lifetime of each TCP "
+        "connection.\n"
+        "# TYPE ripples_tcp_conn_duration_seconds histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_tcp_conn_duration_seconds", labels,
+                                 &metrics->vl_shards[i].vl.tcp.conn_duration,
+                                 METRICS_EXPORT_HISTOGRAM_EXPONENT_MIN, 1e9);
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_tcp_conn_read_bytes Bytes read from each TCP "
+        "connection over its lifetime.\n"
+        "# TYPE ripples_tcp_conn_read_bytes histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_tcp_conn_read_bytes", labels,
+                                 &metrics->vl_shards[i].vl.tcp.conn_bytes_read, 0, 1);
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_tcp_conn_written_bytes Bytes written to each TCP "
+        "connection over its lifetime.\n"
+        "# TYPE ripples_tcp_conn_written_bytes histogram\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        snprintf(labels, sizeof(labels), "vl=\"%zu\"", i);
+        metrics_export_histogram(b, "ripples_tcp_conn_written_bytes", labels,
+                                 &metrics->vl_shards[i].vl.tcp.conn_bytes_written, 0, 1);
+    }
+}
+
+/** Append memory metrics in Prometheus text format to buffer: bytes each
+ * vectorloop allocated by subsystem, labeled with vectorloop ID and
+ * subsystem, bytes zone database holds and memory budget.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_memory(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    metrics_export_printf(b,
+        "# HELP ripples_memory_bytes Bytes of memory vectorloops allocated, "
+        "by subsystem.\n"
+        "# TYPE ripples_memory_bytes gauge\n");
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        mem_account_t *mem = &metrics->vl_shards[i].vl.mem;
+
+        for (int t = 0; t < MEM_TAGS; t++) {
+            metrics_export_printf(b, "ripples_memory_bytes{vl=\"%zu\",subsystem=\"%s\"} %llu\n",
+                                  i, mem_tag_txt[t],
+                                  atomic_load_explicit(&mem->bytes[t], memory_order_relaxed));
+        }
+    }
+    metrics_export_printf(b,
+        "# HELP ripples_memory_zone_bytes Bytes of memory zone database holds.\n"
+        "# TYPE ripples_memory_zone_bytes gauge\n"
+        "ripples_memory_zone_bytes %llu\n"
+        "# HELP ripples_memory_budget_bytes Memory budget, 0 if there is none.\n"
+        "# TYPE ripples_memory_budget_bytes gauge\n"
+        "ripples_memory_budget_bytes %llu\n",
+        atomic_load(&metrics->mem.zone_bytes), atomic_load(&metrics->mem.budget));
+}
+
+/** Append load balancing endpoint health gauges in Prometheus text format to
+ * buffer.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_lb(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    metrics_export_printf(b,
+        "# HELP ripples_lb_endpoints Probed load balancing endpoints by health.\n"
+        "# TYPE ripples_lb_endpoints gauge\n"
+        "ripples_lb_endpoints{state=\"up\"} %llu\n"
+        "ripples_lb_endpoints{state=\"down\"} %llu\n",
+        atomic_load(&metrics->lb.endpoints_up), atomic_load(&metrics->lb.endpoints_down));
+}
+
+/** Append in-kernel responder answer counter of XDP program in Prometheus
+ * text format to buffer.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_xdp_responder(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    metrics_export_printf(b,
+        "# HELP ripples_xdp_responder_answers_total Queries answered by in-kernel "
+        "responder of XDP program.\n"
+        "# TYPE ripples_xdp_responder_answers_total counter\n"
+        "ripples_xdp_responder_answers_total %llu\n",
+        atomic_load(&metrics->xdp_responder_answers));
+}
+
+/** Append a Prometheus label value to buffer, escaping backslash, double
+ * quote and new line characters.
+ *
+ * @param dst Buffer to append to, MUST have room for twice len characters
+ *            and terminating NUL character.
+ * @param src Label value.
+ * @param len Length of label value.
+ */
+static void
+metrics_export_label_escape(char *dst, const char *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] == '\\' || src[i] == '"') {
+            *dst++ = '\\';
+            *dst++ = src[i];
+        } else if (src[i] == '\n') {
+            *dst++ = '\\';
+            *dst++ = 'n';
+        } else {
+            *dst++ = src[i];
+        }
+    }
+    *dst = '\0';
+}
+
+/** Format client network key of query sketches as network address and
+ * prefix length.
+ *
+ * @param buf Buffer to store text at, MUST have room for INET6_ADDRSTRLEN + 4
+ *            characters.
+ * @param net Client network key, see @ref metrics_sketch_window_t.
+ */
+static void
+metrics_export_client_net(char *buf, uint64_t net)
+{
+    uint8_t addr[16] = { 0 };
+    size_t  len;
+
+    if (net >> 56 == METRICS_SKETCH_CLIENT_V4) {
+        for (int i = 0; i < 3; i++) {
+            addr[i] = (uint8_t)(net >> (16 - 8 * i));
+        }
+        len = utl_ipv4_to_str(addr, buf);
+        memcpy(buf + len, "/24", 4);
+    } else {
+        for (int i = 0; i < 7; i++) {
+            addr[i] = (uint8_t)(net >> (48 - 8 * i));
+        }
+        len = utl_ipv6_to_str(addr, buf);
+        memcpy(buf + len, "/56", 4);
+    }
+}
+
+/** Append merged query sketches in Prometheus text format to buffer: top
+ * question names and client networks with their estimated query counts, and
+ * estimated number of distinct clients, all of last complete window. Counts
+ * are upper bounds, see @ref sketch.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_sketches(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    metrics_sketch_window_t *w = &metrics->sketch->merged;
+    uint32_t                 idx[METRICS_SKETCH_TOPK_CAPACITY];
+    uint32_t                 n;
+    char                     name[RIP_NS_MAXCDNAME * 4 + 1];
+    char                     label[sizeof(name) * 2];
+    int                      name_len;
+
+    metrics_export_printf(b,
+        "# HELP ripples_sketch_window_seconds Length of query sketch window.\n"
+        "# TYPE ripples_sketch_window_seconds gauge\n"
+        "ripples_sketch_window_seconds %d\n"
+        "# HELP ripples_sketch_window_queries Queries sketched in last window.\n"
+        "# TYPE ripples_sketch_window_queries gauge\n"
+        "ripples_sketch_window_queries %llu\n"
+        "# HELP ripples_sketch_clients Estimated distinct client addresses in last window.\n"
+        "# TYPE ripples_sketch_clients gauge\n"
+        "ripples_sketch_clients %.0f\n",
+        METRICS_SKETCH_INTERVAL, (unsigned long long)w->queries,
+        sketch_hll_estimate(&w->clients_hll));
+
+    metrics_export_printf(b,
+        "# HELP ripples_sketch_top_qname_queries Estimated queries of top question "
+        "names in last window.\n"
+        "# TYPE ripples_sketch_top_qname_queries gauge\n");
+    n = sketch_topk_sorted(&w->qnames, idx, METRICS_SKETCH_TOPK_EXPORT);
+    for (uint32_t i = 0; i < n; i++) {
+        name_len = rip_ns_name_ntop(sketch_topk_data(&w->qnames, idx[i]), name, sizeof(name));
+        if (name_len < 0) {
+            continue;
+        }
+        metrics_export_label_escape(label, name, name_len);
+        metrics_export_printf(b, "ripples_sketch_top_qname_queries{rank=\"%u\",qname=\"%s\"} %llu\n",
+                              i + 1, label,
+                              (unsigned long long)w->qnames.entries[idx[i]].count);
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_sketch_top_client_queries Estimated queries of top client "
+        "networks in last window.\n"
+        "# TYPE ripples_sketch_top_client_queries gauge\n");
+    n = sketch_topk_sorted(&w->clients, idx, METRICS_SKETCH_TOPK_EXPORT);
+    for (uint32_t i = 0; i < n; i++) {
+        metrics_export_client_net(name, w->clients.entries[idx[i]].key);
+        metrics_export_printf(b, "ripples_sketch_top_client_queries{rank=\"%u\",client=\"%s\"} %llu\n",
+                              i + 1, name,
+                              (unsigned long long)w->clients.entries[idx[i]].count);
+    }
+}
+
+/** Append per zone query counters in Prometheus text format to buffer, summed
+ * over vectorloops and labeled with view, zone, rcode and question type.
+ * Only counters with queries are appended. Queries of zones past
+ * METRICS_ZONES_MAX are labeled with zone "_other".
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_zones(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    unsigned long long counts[METRICS_RCODE_COUNT][RIP_NS_QTYPE_IDX_COUNT];
+    char               name[RIP_NS_MAXCDNAME * 4 + 1];
+    char               zone[sizeof(name) * 2];
+    char               view[(RIP_NS_MAXLABEL + 1) * 2];
+    int                name_len;
+
+    metrics_export_printf(b,
+        "# HELP ripples_zone_queries_total DNS queries answered from zone, by "
+        "response rcode and question type.\n"
+        "# TYPE ripples_zone_queries_total counter\n");
+    for (size_t z = 0; z <= METRICS_ZONES_MAX; z++) {
+        if (z < METRICS_ZONES_MAX) {
+            metrics_zone_t *mz = &metrics->zones[z];
+
+            if (!atomic_load_explicit(&mz->ready, memory_order_acquire)) {
+                continue;
+            }
+            name_len = rip_ns_name_ntop(mz->name, name, sizeof(name));
+            if (name_len < 0) {
+                continue;
+            }
+            metrics_export_label_escape(zone, name, name_len);
+            metrics_export_label_escape(view, (const char *)mz->view + 1, mz->view[0]);
+        } else {
+            strcpy(zone, "_other");
+            view[0] = '\0';
+        }
+
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+            metrics_zone_counters_t *c = &metrics->zone_counters[i * (METRICS_ZONES_MAX + 1) + z];
+
+            for (int r = 0; r < METRICS_RCODE_COUNT; r++) {
+                for (int t = 0; t < RIP_NS_QTYPE_IDX_COUNT; t++) {
+                    counts[r][t] += atomic_load_explicit(&c->queries[r][t],
+                                                         memory_order_relaxed);
+                }
+            }
+        }
+        for (int r = 0; r < METRICS_RCODE_COUNT; r++) {
+            for (int t = 0; t < RIP_NS_QTYPE_IDX_COUNT; t++) {
+                if (counts[r][t] == 0) {
+                    continue;
+                }
+                metrics_export_printf(b, "ripples_zone_queries_total{view=\"%s\",zone=\"%s\","
+                                      "rcode=\"%s\",type=\"%s\"} %llu\n", view, zone,
+                                      metrics_export_zone_rcode_txt[r],
+                                      metrics_export_zone_type_txt[t], counts[r][t]);
+            }
+        }
+    }
+}
+
+/** Append sampled query cost in Prometheus text format to buffer, summed over
+ * vectorloops and labeled with protocol, path, rcode and question type. Only
+ * cells with sampled queries are appended. Mean cost of a query in seconds is
+ * ripples_query_cost_cycles_total over ripples_query_cost_samples_total and
+ * ripples_query_cost_cycles_per_second.
+ *
+ * @param b       Buffer to append to.
+ * @param metrics Metrics to format.
+ */
+static void
+metrics_export_cost(metrics_export_buf_t *b, metrics_t *metrics)
+{
+    static const char *names[2] = {
+        "ripples_query_cost_samples_total", "ripples_query_cost_cycles_total",
+    };
+    static const char *helps[2] = {
+        "DNS queries timed through parse, resolve and pack stages.",
+        "CPU cycles timed queries took in parse, resolve and pack stages.",
+    };
+    unsigned long long sums[2][2][METRICS_COST_PATHS][METRICS_RCODE_COUNT][RIP_NS_QTYPE_IDX_COUNT];
+
+    memset(sums, 0, sizeof(sums));
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        metrics_cost_t *c = &metrics->cost[i];
+
+        for (int p = 0; p < 2; p++) {
+            for (int h = 0; h < METRICS_COST_PATHS; h++) {
+                for (int r = 0; r < METRICS_RCODE_COUNT; r++) {
+                    for (int t = 0; t < RIP_NS_QTYPE_IDX_COUNT; t++) {
+                        sums[0][p][h][r][t] += atomic_load_explicit(&c->queries[p][h][r][t],
+                                                                    memory_order_relaxed);
+                        sums[1][p][h][r][t] += atomic_load_explicit(&c->cycles[p][h][r][t],
+                                                                    memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    }
+
+    metrics_export_printf(b,
+        "# HELP ripples_query_cost_cycles_per_second Frequency of CPU cycle "
+        "counter sampled queries are timed with.\n"
+        "# TYPE ripples_query_cost_cycles_per_second gauge\n"
+        "ripples_query_cost_cycles_per_second %llu\n",
+        (unsigned long long)metrics->cost_cycles_per_sec);
+    for (int m = 0; m < 2; m++) {
+        metrics_export_printf(b, "# HELP %s %s\n# TYPE %s counter\n", names[m], helps[m],
+                              names[m]);
+        for (int p = 0; p < 2; p++) {
+            for (int h = 0; h < METRICS_COST_PATHS; h++) {
+                for (int r = 0; r < METRICS_RCODE_COUNT; r++) {
+                    for (int t = 0; t < RIP_NS_QTYPE_IDX_COUNT; t++) {
+                        if (sums[0][p][h][r][t] == 0) {
+                            continue;
+                        }
+                        metrics_export_printf(b, "%s{proto=\"%s\",path=\"%s\",rcode=\"%s\","
+                                              "type=\"%s\"} %llu\n", names[m],
+                                              metrics_export_proto_txt[p],
+                                              metrics_export_cost_path_txt[h],
+                                              metrics_export_zone_rcode_txt[r],
+                                              metrics_export_zone_type_txt[t],
+                                              sums[m][p][h][r][t]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Format metrics in Prometheus text exposition format. Vectorloop metrics
+ * are summed over all vectorloops, see @ref metrics_vl_sum.
+ * 
+ * @param metrics Metrics to format.
+ * @param buf     Where to store pointer to allocated buffer holding formatted
+ *                text, caller must free it.
+ * 
+ * @return        Returns length of formatted text.
+ */
+size_t
+metrics_export_prometheus(metrics_t *metrics, char **buf)
+{
+    metrics_vl_t         *sum  = malloc(sizeof(metrics_vl_t));
+    metrics_export_buf_t  b    = { .len = 0, .size = 65536 };
+    const char           *prev = NULL;
+    char                  labels[128];
+
+    CHECK_MALLOC(sum);
+    b.buf = malloc(b.size);
+    CHECK_MALLOC(b.buf);
+    b.buf[0] = '\0';
+
+    metrics_vl_sum(metrics, sum);
+
+    for (size_t i = 0; i < METRICS_EXPORT_COUNTERS_COUNT; i++) {
+        const metrics_export_counter_t *c = &metrics_export_counters[i];
+        atomic_ullong *v = (atomic_ullong *)((char *)sum + c->offset);
+
+        if (prev == NULL || strcmp(prev, c->name) != 0) {
+            metrics_export_printf(&b, "# HELP %s %s\n# TYPE %s counter\n",
+                                  c->name, c->help, c->name);
+            prev = c->name;
+        }
+        metrics_export_printf(&b, "%s%s%s%s %llu\n", c->name,
+                              c->labels ? "{" : "", c->labels ? c->labels : "",
+                              c->labels ? "}" : "",
+                              atomic_load_explicit(v, memory_order_relaxed));
+    }
+
+    metrics_export_printf(&b,
+        "# HELP ripples_app_errors_total Support thread errors by reason.\n"
+        "# TYPE ripples_app_errors_total counter\n"
+        "ripples_app_errors_total{reason=\"app_log_open\"} %llu\n"
+        "ripples_app_errors_total{reason=\"app_log_write\"} %llu\n"
+        "ripples_app_errors_total{reason=\"resource_reload\"} %llu\n"
+        "ripples_app_errors_total{reason=\"query_log_open\"} %llu\n"
+        "ripples_app_errors_total{reason=\"worker_exit\"} %llu\n",
+        atomic_load(&metrics->app.app_log_open_error),
+        atomic_load(&metrics->app.app_log_write_error),
+        atomic_load(&metrics->app.resource_reload_error),
+        atomic_load(&metrics->app.query_log_open_error),
+        atomic_load(&metrics->app.worker_exit));
+
+    metrics_export_printf(&b,
+        "# HELP ripples_query_latency_seconds Query latency from query read "
+        "to response written.\n"
+        "# TYPE ripples_query_latency_seconds histogram\n");
+    for (int p = 0; p < METRICS_LATENCY_PROTOCOLS; p++) {
+        for (int r = 0; r < METRICS_LATENCY_RCODES; r++) {
+            snprintf(labels, sizeof(labels), "proto=\"%s\",rcode=\"%s\"",
+                     metrics_export_proto_txt[p], metrics_export_rcode_txt[r]);
+            metrics_export_histogram(&b, "ripples_query_latency_seconds",
+                                     labels, &sum->latency.total[p][r],
+                                     METRICS_EXPORT_HISTOGRAM_EXPONENT_MIN, 1e9);
+        }
+    }
+
+    metrics_export_printf(&b,
+        "# HELP ripples_query_stage_latency_seconds Query latency of each "
+        "processing stage.\n"
+        "# TYPE ripples_query_stage_latency_seconds histogram\n");
+    for (int s = 0; s < METRICS_LATENCY_STAGES; s++) {
+        for (int p = 0; p < METRICS_LATENCY_PROTOCOLS; p++) {
+            snprintf(labels, sizeof(labels), "proto=\"%s\",stage=\"%s\"",
+                     metrics_export_proto_txt[p], metrics_export_stage_txt[s]);
+            metrics_export_histogram(&b, "ripples_query_stage_latency_seconds",
+                                     labels, &sum->latency.stage[s][p],
+                                     METRICS_EXPORT_HISTOGRAM_EXPONENT_MIN, 1e9);
+        }
+    }
+
+    metrics_export_udp_listeners(&b, metrics);
+    metrics_export_tcp_conns(&b, metrics);
+
+    metrics_export_memory(&b, metrics);
+    metrics_export_lb(&b, metrics);
+    metrics_export_xdp_responder(&b, metrics);
+
+    if (atomic_load(&metrics->cycles_per_sec) > 0) {
+        metrics_export_vl_stages(&b, metrics);
+    }
+
+    if (metrics->sketch != NULL) {
+        metrics_export_sketches(&b, metrics);
+    }
+
+    if (metrics->zones != NULL) {
+        metrics_export_zones(&b, metrics);
+    }
+
+    if (metrics->cost != NULL) {
+        metrics_export_cost(&b, metrics);
+    }
+
+    free(sum);
+    *buf = b.buf;
+
+    return b.len;
+}
+
+/** Format metrics as binary snapshot, see @ref metrics_snapshot_header_t for
+ * layout. Vectorloop metrics are summed over all vectorloops.
+ * 
+ * @param metrics Metrics to format.
+ * @param buf     Where to store pointer to allocated buffer holding snapshot,
+ *                caller must free it.
+ * 
+ * @return        Returns length of snapshot.
+ */
+size_t
+metrics_export_snapshot(metrics_t *metrics, char **buf)
+{
+    size_t                     counter_count = METRICS_VL_COUNTERS + METRICS_APP_COUNTERS;
+    size_t                     len           = sizeof(metrics_snapshot_header_t) +
+                                               counter_count * sizeof(uint64_t);
+    char                      *snapshot      = malloc(len);
+    metrics_snapshot_header_t *hdr           = (metrics_snapshot_header_t *)snapshot;
+    uint64_t                  *counters;
+    struct timespec            now;
+
+    CHECK_MALLOC(snapshot);
+    counters = (uint64_t *)(snapshot + sizeof(metrics_snapshot_header_t));
+
+    utl_clock_gettime_rt_fatal(&now);
+    *hdr = (metrics_snapshot_header_t) {
+        .magic         = METRICS_SNAPSHOT_MAGIC,
+        .version       = METRICS_SNAPSHOT_VERSION,
+        .header_len    = sizeof(metrics_snapshot_header_t),
+        .timestamp_ns  = utl_timespec_to_ns(&now),
+        .vl_count      = metrics->vl_shards_count,
+        .counter_count = counter_count,
+    };
+
+    /* atomic_ullong is same size as uint64_t, sum straight into snapshot. */
+    metrics_vl_sum(metrics, (metrics_vl_t *)counters);
+    counters += METRICS_VL_COUNTERS;
+    counters[0] = atomic_load(&metrics->app.app_log_open_error);
+    counters[1] = atomic_load(&metrics->app.app_log_write_error);
+    counters[2] = atomic_load(&metrics->app.resource_reload_error);
+    counters[3] = atomic_load(&metrics->app.query_log_open_error);
+    counters[4] = atomic_load(&metrics->app.worker_exit);
+
+    *buf = snapshot;
+
+    return len;
+}
+
+/** Send a fatal error message to application log.
+ * 
+ * @param app_log_channel Application log channel.
+ * @param fmt             printf style format.
+ */
+static void
+metrics_loop_fatal(channel_log_t *app_log_channel, const char *fmt, ...)
+{
+    va_list ap;
+    char    err_str[ERR_MSG_LENGTH];
+
+    va_start(ap, fmt);
+    vsnprintf(err_str, ERR_MSG_LENGTH, fmt, ap);
+    va_end(ap);
+    channel_log_send(app_log_channel, 0, true, "%s", err_str);
+}
+
+/** Open metrics listening socket on configured IP address and port.
+ * 
+ * @param cfg Configuration settings to use.
+ * 
+ * @return    Returns listening socket, or -1 on error with errno set.
+ */
+static int
+metrics_loop_listen(config_t *cfg)
+{
+    struct sockaddr_storage ss  = { };
+    struct sockaddr_in     *sa4 = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6    *sa6 = (struct sockaddr_in6 *)&ss;
+    socklen_t               slen;
+    int                     fd;
+    int                     opt = 1;
+    int                     err;
+
+    if (inet_pton(AF_INET, cfg->metrics_listener_ip, &sa4->sin_addr) == 1) {
+        sa4->sin_family = AF_INET;
+        sa4->sin_port   = htons(cfg->metrics_listener_port);
+        slen            = sizeof(struct sockaddr_in);
+    } else if (inet_pton(AF_INET6, cfg->metrics_listener_ip, &sa6->sin6_addr) == 1) {
+        sa6->sin6_family = AF_INET6;
+        sa6->sin6_port   = htons(cfg->metrics_listener_port);
+        slen             = sizeof(struct sockaddr_in6);
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd = socket(ss.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    /* SO_REUSEPORT lets new process listen while process it upgrades is
+     * still running, see @ref upgrade.
+     */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) != 0 ||
+        bind(fd, (struct sockaddr *)&ss, slen) != 0 ||
+        listen(fd, METRICS_LOOP_LISTEN_BACKLOG) != 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/** Serve a single HTTP request on a client connection. Path "/metrics"
+ * returns Prometheus text format, path "/metrics.bin" returns binary
+ * snapshot, any other request gets 404 response.
+ * 
+ * @param fd      Client connection socket.
+ * @param metrics Metrics to export.
+ */
+static void
+metrics_loop_serve(int fd, metrics_t *metrics)
+{
+    struct timeval  tv  = { .tv_sec = METRICS_LOOP_CLIENT_TIMEOUT };
+    char            req[METRICS_LOOP_REQUEST_MAX];
+    size_t          req_len = 0;
+    ssize_t         ret;
+    char           *body     = NULL;
+    size_t          body_len = 0;
+    const char     *status   = "404 Not Found";
+    const char     *ctype    = "text/plain";
+    char            hdr[256];
+    int             hdr_len;
+    char            err[ERR_MSG_LENGTH];
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    /* Read request until end of request line. */
+    while (req_len < sizeof(req) - 1) {
+        ret = read(fd, req + req_len, sizeof(req) - 1 - req_len);
+        if (ret <= 0) {
+            return;
+        }
+        req_len += ret;
+        req[req_len] = '\0';
+        if (strchr(req, '\n') != NULL) {
+            break;
+        }
+    }
+
+    if (strncmp(req, "GET /metrics ", 13) == 0 ||
+        strncmp(req, "GET /metrics\r", 13) == 0) {
+        status   = "200 OK";
+        ctype    = "text/plain; version=0.0.4";
+        body_len = metrics_export_prometheus(metrics, &body);
+    } else if (strncmp(req, "GET /metrics.bin ", 17) == 0) {
+        status   = "200 OK";
+        ctype    = "application/octet-stream";
+        body_len = metrics_export_snapshot(metrics, &body);
+    }
+
+    hdr_len = snprintf(hdr, sizeof(hdr),
+                       "HTTP/1.0 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n",
+                       status, ctype, body_len);
+    if (utl_writeall(fd, hdr, hdr_len, err, ERR_MSG_LENGTH) == 0 && body_len > 0) {
+        utl_writeall(fd, body, body_len, err, ERR_MSG_LENGTH);
+    }
+    free(body);
+}
+
+/** Metrics loop function. It listens for HTTP requests on configured IP
+ * address and port and serves metrics, one client at a time. It only reads
+ * metrics, vectorloops are never blocked by it. With query sketches
+ * configured it also ends vectorloop sketch windows every
+ * @ref METRICS_SKETCH_INTERVAL seconds and merges them, see
+ * @ref metrics_sketch_flip.
+ * 
+ * @note This loop runs indefinitely and is meant to be run on its own thread.
+ * 
+ * @param args Object with arguments passed to metrics loop.
+ * 
+ * @return     On loop exit returns a NULL pointer only because it needs to
+ *             abide by pthread API.
+ */
+void *
+metrics_loop(void *args)
+{
+    metrics_loop_args_t *m_args          = (metrics_loop_args_t *)args;
+    config_t            *cfg             = m_args->cfg;
+    metrics_t           *metrics         = m_args->metrics;
+    channel_log_t       *app_log_channel = m_args->app_log_channel;
+    int                  listen_fd;
+    int                  fd;
+    struct pollfd        pfd;
+    uint64_t             now_ms;
+    uint64_t             flip_ms = 0;
+    int                  timeout = -1;
+
+    listen_fd = metrics_loop_listen(cfg);
+    if (listen_fd < 0) {
+        metrics_loop_fatal(app_log_channel,
+                           "Error opening metrics listener on %s port %u, %s\n",
+                           cfg->metrics_listener_ip, cfg->metrics_listener_port,
+                           strerror(errno));
+        return NULL;
+    }
+
+    pfd = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+    while (1) {
+        if (metrics->sketch != NULL) {
+            now_ms = utl_clock_monotonic_ms_fatal();
+            if (now_ms >= flip_ms) {
+                metrics_sketch_flip(metrics);
+                flip_ms = now_ms + METRICS_SKETCH_INTERVAL * 1000;
+            }
+            timeout = (int)(flip_ms - now_ms);
+            if (metrics_sketch_merge(metrics) > 0) {
+                timeout = METRICS_SKETCH_COLLECT_WAIT;
+            }
+        }
+        if (poll(&pfd, 1, timeout) <= 0) {
+            continue;
+        }
+        fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                debug_printf("Error accepting metrics connection, %s",
+                             strerror(errno));
+            }
+            continue;
+        }
+        if (m_args->xdp_prog != NULL) {
+            atomic_store(&metrics->xdp_responder_answers,
+                         vl_xdp_resp_answers(m_args->xdp_prog));
+        }
+        metrics_loop_serve(fd, metrics);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/** @}*/
@@ -0,0 +1,298 @@
+/**
+ * @file mphf.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup mphf
+ *  @{
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mphf.h"
+#include "utils.h"
+
+/** Get number of slots position hash of a set of keys maps to, about 3%
+ * more than keys, so last buckets placed still find free slots quickly.
+ *
+ * @param count Number of keys.
+ *
+ * @return      Returns number of slots.
+ */
+static uint32_t
+mphf_slots_count(uint32_t count)
+{
+    return count + count / 32 + 1;
+}
+
+/** Get number of buckets of a set of keys, at least 2 so there is a dense
+ * and a sparse bucket.
+ *
+ * @param count Number of keys.
+ *
+ * @return      Returns number of buckets.
+ */
+static uint32_t
+mphf_buckets_count(uint32_t count)
+{
+    uint32_t buckets = (count + MPHF_BUCKET_KEYS - 1) / MPHF_BUCKET_KEYS;
+
+    return buckets < 2 ? 2 : buckets;
+}
+
+/** Get number of pilots function of a set of keys has.
+ *
+ * @param count Number of keys.
+ *
+ * @return      Returns number of pilots array entries.
+ */
+size_t
+mphf_pilots_count(uint32_t count)
+{
+    return mphf_buckets_count(count);
+}
+
+/** Get number of remap entries function of a set of keys has.
+ *
+ * @param count Number of keys.
+ *
+ * @return      Returns number of remap array entries.
+ */
+size_t
+mphf_remap_count(uint32_t count)
+{
+    return mphf_slots_count(count) - count;
+}
+
+/** Initialize minimal perfect hash function of a set of keys from its seed
+ * and arrays, e.g. as stored in a file by whoever built it.
+ *
+ * @param f      Function to initialize.
+ * @param count  Number of keys.
+ * @param seed   Seed function was built with.
+ * @param pilots Pilots array, of @ref mphf_pilots_count entries.
+ * @param remap  Remap array, of @ref mphf_remap_count entries.
+ */
+void
+mphf_init(mphf_t *f, uint32_t count, uint64_t seed, const uint16_t *pilots,
+          const uint32_t *remap)
+{
+    uint32_t buckets = mphf_buckets_count(count);
+    uint32_t dense   = (uint32_t)((uint64_t)buckets * 3 / 10);
+
+    *f = (mphf_t) {
+        .seed          = seed,
+        .keys_count    = count,
+        .slots_count   = mphf_slots_count(count),
+        .buckets_count = buckets,
+        .dense_count   = dense == 0 ? 1 : dense,
+        .pilots        = pilots,
+        .remap         = remap,
+    };
+}
+
+/** Try to find pilots of all buckets with current seed. Buckets are placed
+ * largest first, pilots are tried in order until every key of bucket lands
+ * on a distinct free slot.
+ *
+ * @param f       Function being built.
+ * @param pilots  Pilots array to fill.
+ * @param hashes  Mixed keys, grouped by bucket.
+ * @param starts  Start of each bucket in hashes, buckets_count + 1 entries.
+ * @param order   Buckets, largest first.
+ * @param taken   Bitmap of taken slots, cleared.
+ * @param slots   Scratch array of largest bucket size entries.
+ *
+ * @return        Returns true if every bucket was placed.
+ */
+static bool
+mphf_place(mphf_t *f, uint16_t *pilots, const uint64_t *hashes, const uint32_t *starts,
+           const uint32_t *order, uint64_t *taken, uint32_t *slots)
+{
+    for (uint32_t i = 0; i < f->buckets_count; i++) {
+        uint32_t b     = order[i];
+        uint32_t start = starts[b];
+        uint32_t len   = starts[b + 1] - start;
+        uint32_t pilot = 0;
+
+        pilots[b] = 0;
+        if (len == 0) {
+            /* Buckets are ordered by size, rest are empty too. */
+            break;
+        }
+        for (; pilot <= UINT16_MAX; pilot++) {
+            uint32_t j = 0;
+
+            for (; j < len; j++) {
+                uint32_t s = mphf_position(f, hashes[start + j], pilot);
+                uint32_t k = 0;
+
+                if (taken[s / 64] & (1ULL << (s % 64))) {
+                    break;
+                }
+                while (k < j && slots[k] != s) {
+                    k++;
+                }
+                if (k < j) {
+                    break;
+                }
+                slots[j] = s;
+            }
+            if (j == len) {
+                break;
+            }
+        }
+        if (pilot > UINT16_MAX) {
+            return false;
+        }
+        pilots[b] = pilot;
+        for (uint32_t j = 0; j < len; j++) {
+            taken[slots[j] / 64] |= 1ULL << (slots[j] % 64);
+        }
+    }
+    return true;
+}
+
+/** Build minimal perfect hash function of a set of keys.
+ *
+ * Keys are mixed with a seed and grouped by bucket, and buckets are placed
+ * largest first, see @ref mphf_place(). If a bucket finds no pilot, build is
+ * retried with another seed. Slots past number of keys that keys landed on
+ * are then remapped to free slots below it.
+ *
+ * @param f      Function to build.
+ * @param pilots Pilots array, of @ref mphf_pilots_count entries.
+ * @param remap  Remap array, of @ref mphf_remap_count entries.
+ * @param keys   Keys of set, MUST be distinct.
+ * @param count  Number of keys.
+ *
+ * @return       Returns 0 on success, or -1 if set has duplicate keys or
+ *               build failed with @ref MPHF_SEEDS_MAX seeds.
+ */
+int
+mphf_build(mphf_t *f, uint16_t *pilots, uint32_t *remap, const uint64_t *keys,
+           uint32_t count)
+{
+    uint32_t  buckets  = mphf_buckets_count(count);
+    uint32_t  slots    = mphf_slots_count(count);
+    uint64_t *hashes   = malloc(sizeof(uint64_t) * count);
+    uint32_t *bucket   = malloc(sizeof(uint32_t) * count);
+    uint32_t *starts   = malloc(sizeof(uint32_t) * (buckets + 1));
+    uint32_t *order    = malloc(sizeof(uint32_t) * buckets);
+    uint32_t *sizes    = NULL;
+    uint64_t *taken    = malloc(sizeof(uint64_t) * (slots / 64 + 1));
+    uint32_t *scratch  = NULL;
+    uint64_t  state    = 0x9e3779b97f4a7c15ULL;
+    uint32_t  size_max = 0;
+    int       ret      = -1;
+
+    CHECK_MALLOC(hashes);
+    CHECK_MALLOC(bucket);
+    CHECK_MALLOC(starts);
+    CHECK_MALLOC(order);
+    CHECK_MALLOC(taken);
+
+    for (int attempt = 0; attempt < MPHF_SEEDS_MAX && ret != 0; attempt++) {
+        /* Next seed, splitmix64. */
+        state += 0x9e3779b97f4a7c15ULL;
+        mphf_init(f, count, mphf_mix(state, 0), pilots, remap);
+
+        /* Group mixed keys by bucket. */
+        memset(starts, 0, sizeof(uint32_t) * (buckets + 1));
+        for (uint32_t i = 0; i < count; i++) {
+            bucket[i] = mphf_bucket(f, mphf_mix(keys[i], f->seed));
+            starts[bucket[i] + 1]++;
+        }
+        size_max = 0;
+        for (uint32_t b = 0; b < buckets; b++) {
+            size_max = starts[b + 1] > size_max ? starts[b + 1] : size_max;
+            starts[b + 1] += starts[b];
+        }
+        /* Bucket write cursors, order is filled below. */
+        memcpy(order, starts, sizeof(uint32_t) * buckets);
+        for (uint32_t i = 0; i < count; i++) {
+            hashes[order[bucket[i]]++] = mphf_mix(keys[i], f->seed);
+        }
+
+        /* Order buckets largest first, counting sort by size. */
+        free(sizes);
+        sizes = calloc(size_max + 2, sizeof(uint32_t));
+        CHECK_MALLOC(sizes);
+        for (uint32_t b = 0; b < buckets; b++) {
+            sizes[size_max - (starts[b + 1] - starts[b]) + 1]++;
+        }
+        for (uint32_t s = 0; s <= size_max; s++) {
+            sizes[s + 1] += sizes[s];
+        }
+        for (uint32_t b = 0; b < buckets; b++) {
+            order[sizes[size_max - (starts[b + 1] - starts[b])]++] = b;
+        }
+
+        /* Mixing is a bijection, equal mixed keys are duplicate keys. */
+        for (uint32_t b = 0; b < buckets; b++) {
+            for (uint32_t i = starts[b]; i < starts[b + 1]; i++) {
+                for (uint32_t j = starts[b]; j < i; j++) {
+                    if (hashes[i] == hashes[j]) {
+                        goto END;
+                    }
+                }
+            }
+        }
+
+        free(scratch);
+        scratch = malloc(sizeof(uint32_t) * (size_max + 1));
+        CHECK_MALLOC(scratch);
+        memset(taken, 0, sizeof(uint64_t) * (slots / 64 + 1));
+        if (mphf_place(f, pilots, hashes, starts, order, taken, scratch)) {
+            ret = 0;
+        }
+    }
+
+    if (ret == 0) {
+        /* Remap slots past count keys landed on to free slots below it. */
+        uint32_t free_slot = 0;
+
+        for (uint32_t s = count; s < slots; s++) {
+            remap[s - count] = 0;
+            if (taken[s / 64] & (1ULL << (s % 64))) {
+                while (taken[free_slot / 64] & (1ULL << (free_slot % 64))) {
+                    free_slot++;
+                }
+                remap[s - count] = free_slot++;
+            }
+        }
+    }
+
+END:
+    free(hashes);
+    free(bucket);
+    free(starts);
+    free(order);
+    free(sizes);
+    free(taken);
+    free(scratch);
+    return ret;
+}
+
+/** @}*/
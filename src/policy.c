@@ -0,0 +1,286 @@
+/**
+ * @file policy.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup policy
+ *  @{
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "policy.h"
+#include "utils.h"
+
+/** Maximum length of a single line in policy file. */
+#define POLICY_FILE_LINE_MAX 1024
+
+/** Maximum number of tokens (fields) on a single policy file line. */
+#define POLICY_FILE_TOKENS_MAX 2
+
+/** Policy action names, indexed by action. */
+static const char *policy_action_names[POLICY_ACTION_COUNT] = {
+    [POLICY_ACTION_PASSTHRU] = "passthru",
+    [POLICY_ACTION_NXDOMAIN] = "nxdomain",
+    [POLICY_ACTION_NODATA]   = "nodata",
+    [POLICY_ACTION_REFUSE]   = "refuse",
+    [POLICY_ACTION_DROP]     = "drop",
+};
+
+/** Structure describes a policy name while policy is built. */
+typedef struct policy_item_s {
+    /** Name key, see @ref policy_lookup. */
+    uint64_t key;
+
+    /** Line name is listed on. */
+    uint32_t line_no;
+
+    /** Action of name. */
+    uint8_t action;
+} policy_item_t;
+
+/** Compare policy items by key, then by line number.
+ *
+ * @param a First item.
+ * @param b Second item.
+ *
+ * @return  Returns -1, 0 or 1 as a is ordered before, same as or after b.
+ */
+static int
+policy_item_cmp(const void *a, const void *b)
+{
+    const policy_item_t *x = a;
+    const policy_item_t *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->line_no < y->line_no ? -1 : x->line_no > y->line_no;
+}
+
+/** Parse a single policy file line.
+ *
+ * @param policy  Policy whose label masks are updated.
+ * @param item    Where to store parsed name, its line number is 0 for a line
+ *                with no name.
+ * @param line    Line to parse, line is modified.
+ * @param line_no Line number, used in error message.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1.
+ */
+static int
+policy_parse_line(policy_t *policy, policy_item_t *item, char *line, uint32_t line_no,
+                  char *err, size_t err_len)
+{
+    char          *tokens[POLICY_FILE_TOKENS_MAX + 1];
+    char          *save     = NULL;
+    char          *name;
+    char          *comment;
+    int            count    = 0;
+    bool           wildcard = false;
+    unsigned char  wire[RIP_NS_MAXCDNAME + 1];
+    uint16_t       len;
+    unsigned       labels   = 0;
+    int            a        = POLICY_ACTION_NXDOMAIN;
+
+    item->line_no = 0;
+    if ((comment = strchr(line, ';')) != NULL) {
+        *comment = '\0';
+    }
+    for (char *t = strtok_r(line, " \t\r", &save); t != NULL; t = strtok_r(NULL, " \t\r", &save)) {
+        if (count == POLICY_FILE_TOKENS_MAX) {
+            count++;
+            break;
+        }
+        tokens[count++] = t;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (count > POLICY_FILE_TOKENS_MAX) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+    if (count == 2) {
+        for (a = 0; a < POLICY_ACTION_COUNT; a++) {
+            if (strcasecmp(tokens[1], policy_action_names[a]) == 0) {
+                break;
+            }
+        }
+        if (a == POLICY_ACTION_COUNT) {
+            snprintf(err, err_len, "line %u: invalid action \"%s\"", line_no, tokens[1]);
+            return -1;
+        }
+    }
+
+    name = tokens[0];
+    if (name[0] == '*' && name[1] == '.') {
+        wildcard = true;
+        name += 2;
+    }
+    if (rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) < 0 ||
+        wire[0] == 0 || strchr(name, '*') != NULL) {
+        snprintf(err, err_len, "line %u: invalid name \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+    len = rip_ns_name_lc(wire);
+    for (uint16_t i = 0; wire[i] != 0; i += wire[i] + 1) {
+        labels++;
+    }
+    labels = labels < 63 ? labels : 63;
+
+    item->line_no = line_no;
+    item->action  = (uint8_t)a;
+    item->key     = rip_ns_name_hash(wire, len);
+    if (wildcard) {
+        item->key ^= POLICY_WILDCARD_KEY;
+        policy->wild_labels |= 1ULL << labels;
+    } else {
+        policy->exact_labels |= 1ULL << labels;
+    }
+    return 0;
+}
+
+/** Create response policy from policy file contents.
+ *
+ * @param buf        Policy file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to policy.
+ * @param err        Where to store error message if policy can not be
+ *                   created.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to policy on success, otherwise NULL is
+ *                   returned and err is populated.
+ */
+policy_t *
+policy_create(const char *buf, size_t buf_len, uint64_t generation, char *err, size_t err_len)
+{
+    policy_t      *policy  = NULL;
+    policy_item_t *items   = NULL;
+    uint64_t      *keys    = NULL;
+    uint16_t      *pilots  = NULL;
+    uint32_t      *remap   = NULL;
+    size_t         size    = 0;
+    uint32_t       count   = 0;
+    uint32_t       n       = 0;
+    uint32_t       line_no = 0;
+    char           line[POLICY_FILE_LINE_MAX];
+    const char    *p       = buf;
+    const char    *end     = buf + buf_len;
+
+    policy = calloc(1, sizeof(policy_t));
+    CHECK_MALLOC(policy);
+    policy->generation = generation;
+
+    /* Parse policy file into array of names. */
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        line_no += 1;
+        if (len >= POLICY_FILE_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", line_no);
+            goto ERR_END;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (count == size) {
+            size  = size == 0 ? 1024 : size * 2;
+            items = realloc(items, sizeof(policy_item_t) * size);
+            CHECK_MALLOC(items);
+        }
+        if (policy_parse_line(policy, &items[count], line, line_no, err, err_len) != 0) {
+            goto ERR_END;
+        }
+        if (items[count].line_no != 0) {
+            count++;
+        }
+        p += len + 1;
+    }
+    if (count == 0) {
+        free(items);
+        return policy;
+    }
+
+    /* Drop names listed more than once, first listing is kept. */
+    qsort(items, count, sizeof(policy_item_t), &policy_item_cmp);
+    keys = malloc(sizeof(uint64_t) * count);
+    CHECK_MALLOC(keys);
+    for (uint32_t i = 0; i < count; i++) {
+        if (n == 0 || items[i].key != items[n - 1].key) {
+            items[n] = items[i];
+            keys[n++] = items[i].key;
+        }
+    }
+
+    pilots = malloc(sizeof(uint16_t) * mphf_pilots_count(n));
+    CHECK_MALLOC(pilots);
+    remap = malloc(sizeof(uint32_t) * (mphf_remap_count(n) + 1));
+    CHECK_MALLOC(remap);
+    if (mphf_build(&policy->mphf, pilots, remap, keys, n) != 0) {
+        snprintf(err, err_len, "failed to build hash of %u names", n);
+        free(pilots);
+        free(remap);
+        goto ERR_END;
+    }
+    policy->entries = malloc(sizeof(uint64_t) * n);
+    CHECK_MALLOC(policy->entries);
+    for (uint32_t i = 0; i < n; i++) {
+        policy->entries[mphf_lookup(&policy->mphf, items[i].key)] =
+            (items[i].key & ~POLICY_ENTRY_ACTION_MASK) | items[i].action;
+    }
+    policy->entries_count = n;
+    free(items);
+    free(keys);
+    return policy;
+
+ERR_END:
+    free(items);
+    free(keys);
+    policy_release(policy);
+    return NULL;
+}
+
+/** Release response policy.
+ *
+ * @param policy Policy to release.
+ */
+void
+policy_release(policy_t *policy)
+{
+    if (policy == NULL) {
+        return;
+    }
+    if (policy->entries_count > 0) {
+        free((void *)policy->mphf.pilots);
+        free((void *)policy->mphf.remap);
+    }
+    free(policy->entries);
+    free(policy);
+}
+
+/** @}*/
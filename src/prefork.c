@@ -0,0 +1,305 @@
+/**
+ * @file prefork.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup prefork
+ *  @{
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "prefork.h"
+#include "utils.h"
+
+/** Initialize master process state, no worker is started. Termination,
+ * reload and child exit signals are blocked, master waits for them, see
+ * @ref prefork_run.
+ *
+ * @param p       Master process state to initialize.
+ * @param cfg     Configuration, with "process_workers" set.
+ * @param metrics Metrics shared by all workers, see @ref metrics_new_shared.
+ */
+void
+prefork_init(prefork_t *p, config_t *cfg, metrics_t *metrics)
+{
+    *p = (prefork_t) {
+        .cfg        = cfg,
+        .metrics    = metrics,
+        .master_pid = getpid(),
+        .count      = cfg->process_workers,
+    };
+    p->workers = malloc(sizeof(prefork_worker_t) * p->count);
+    CHECK_MALLOC(p->workers);
+    for (size_t i = 0; i < p->count; i++) {
+        p->workers[i] = (prefork_worker_t) { .pid = -1 };
+    }
+
+    sigemptyset(&p->signals);
+    sigaddset(&p->signals, SIGINT);
+    sigaddset(&p->signals, SIGTERM);
+    sigaddset(&p->signals, SIGHUP);
+    sigaddset(&p->signals, SIGUSR1);
+    sigaddset(&p->signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &p->signals, &p->mask_orig);
+}
+
+/** Release memory held by master process state and restore signal mask.
+ *
+ * @param p Master process state to clean.
+ */
+void
+prefork_clean(prefork_t *p)
+{
+    sigprocmask(SIG_SETMASK, &p->mask_orig, NULL);
+    free(p->workers);
+    p->workers = NULL;
+}
+
+/** Adjust configuration of worker process, called in worker right after it
+ * is forked. Worker takes its vectorloop CPU bindings out of bindings of all
+ * workers, and query log file names and shared memory paths get worker
+ * suffix, so workers do not write to same files. Admin socket path gets the
+ * same suffix.
+ *
+ * @param cfg Worker copy of configuration.
+ * @param id  Worker ID.
+ */
+void
+prefork_worker_config(config_t *cfg, size_t id)
+{
+    size_t  count = cfg->process_thread_count;
+    char   *str;
+
+    cfg->process_worker_id = id;
+    memmove(cfg->process_thread_masks, cfg->process_thread_masks + id * count,
+            sizeof(size_t) * count);
+
+    if (asprintf(&str, "%s_w%zu", cfg->query_log_base_name, id) < 0) {
+        CHECK_MALLOC(NULL);
+    }
+    free(cfg->query_log_base_name);
+    cfg->query_log_base_name = str;
+
+    if (cfg->query_log_shm_path != NULL) {
+        if (asprintf(&str, "%s_w%zu", cfg->query_log_shm_path, id) < 0) {
+            CHECK_MALLOC(NULL);
+        }
+        free(cfg->query_log_shm_path);
+        cfg->query_log_shm_path = str;
+    }
+
+    if (cfg->response_cache_snapshot_path != NULL) {
+        if (asprintf(&str, "%s_w%zu", cfg->response_cache_snapshot_path, id) < 0) {
+            CHECK_MALLOC(NULL);
+        }
+        free(cfg->response_cache_snapshot_path);
+        cfg->response_cache_snapshot_path = str;
+    }
+
+    if (cfg->admin_socket[0] != '\0') {
+        if (asprintf(&str, "%s_w%zu", cfg->admin_socket, id) < 0) {
+            CHECK_MALLOC(NULL);
+        }
+        free(cfg->admin_socket);
+        cfg->admin_socket = str;
+    }
+}
+
+/** Start worker process.
+ *
+ * @note Like fork(), function returns in both master and worker process.
+ *
+ * @param p      Master process state.
+ * @param id     ID of worker to start.
+ * @param now_ms Current monotonic time in milliseconds.
+ *
+ * @return       Returns 0 in worker process, which continues as single
+ *               process application would. In master returns worker process
+ *               ID, or -1 if fork failed in which case restart is retried
+ *               after @ref PREFORK_RESTART_BACKOFF_MS.
+ */
+pid_t
+prefork_spawn(prefork_t *p, size_t id, uint64_t now_ms)
+{
+    prefork_worker_t *w   = &p->workers[id];
+    pid_t             pid = fork();
+
+    if (pid < 0) {
+        fprintf(stderr, "Could not start worker process %zu, error no: %d, "
+                "error message: %s.\n", id, errno, strerror(errno));
+        w->restart_ms = now_ms + PREFORK_RESTART_BACKOFF_MS;
+        return -1;
+    }
+    if (pid == 0) {
+        /* Worker terminates (and drains) if master exits. */
+        if (prctl(PR_SET_PDEATHSIG, SIGTERM) != 0 || getppid() != p->master_pid) {
+            _exit(1);
+        }
+        sigprocmask(SIG_SETMASK, &p->mask_orig, NULL);
+        prefork_worker_config(p->cfg, id);
+        return 0;
+    }
+    w->pid        = pid;
+    w->started_ms = now_ms;
+    w->restart_ms = 0;
+
+    return pid;
+}
+
+/** Reap exited worker processes. Unless application is terminating, exit is
+ * counted in metrics, memory gauges of worker vectorloops are reset, and
+ * worker restart is scheduled.
+ *
+ * @param p      Master process state.
+ * @param now_ms Current monotonic time in milliseconds.
+ *
+ * @return       Returns number of workers running.
+ */
+size_t
+prefork_reap(prefork_t *p, uint64_t now_ms)
+{
+    size_t count   = p->cfg->process_thread_count;
+    size_t running = 0;
+    pid_t  pid;
+    int    status;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (size_t i = 0; i < p->count; i++) {
+            prefork_worker_t *w = &p->workers[i];
+
+            if (w->pid != pid) {
+                continue;
+            }
+            w->pid = -1;
+            if (p->stopping) {
+                break;
+            }
+            if (WIFSIGNALED(status)) {
+                fprintf(stderr, "Worker process %zu (pid %d) terminated by %s, "
+                        "restarting\n", i, pid, strsignal(WTERMSIG(status)));
+            } else {
+                fprintf(stderr, "Worker process %zu (pid %d) exited with status %d, "
+                        "restarting\n", i, pid, WEXITSTATUS(status));
+            }
+            atomic_fetch_add(&p->metrics->app.worker_exit, 1);
+
+            /* Counters carry on, memory restarted worker allocates is
+             * accounted from scratch.
+             */
+            for (size_t j = i * count; j < (i + 1) * count; j++) {
+                mem_account_t *mem = &metrics_vl_get(p->metrics, j)->mem;
+
+                for (int t = 0; t < MEM_TAGS; t++) {
+                    atomic_store_explicit(&mem->bytes[t], 0, memory_order_relaxed);
+                }
+            }
+            w->restart_ms = now_ms;
+            if (now_ms - w->started_ms < PREFORK_RESTART_BACKOFF_MS) {
+                w->restart_ms += PREFORK_RESTART_BACKOFF_MS;
+            }
+            break;
+        }
+    }
+    for (size_t i = 0; i < p->count; i++) {
+        if (p->workers[i].pid != -1) {
+            running++;
+        }
+    }
+    return running;
+}
+
+/** Send signal to all running worker processes.
+ *
+ * @param p   Master process state.
+ * @param sig Signal to send.
+ */
+static void
+prefork_signal(prefork_t *p, int sig)
+{
+    for (size_t i = 0; i < p->count; i++) {
+        if (p->workers[i].pid != -1) {
+            kill(p->workers[i].pid, sig);
+        }
+    }
+}
+
+/** Start worker processes and supervise them until application terminates.
+ * Termination (SIGINT, SIGTERM), reload (SIGHUP) and calibration (SIGUSR1)
+ * signals are forwarded to workers, and once terminating master waits for all workers to exit. Second
+ * termination signal is forwarded as well, so workers stop draining.
+ *
+ * @note Like fork(), function returns in both master and worker process.
+ *
+ * @param p Master process state, see @ref prefork_init.
+ *
+ * @return  Returns true in worker process, which continues as single process
+ *          application would. Returns false in master once all workers
+ *          exited.
+ */
+bool
+prefork_run(prefork_t *p)
+{
+    struct timespec poll   = { .tv_sec = 0, .tv_nsec = PREFORK_POLL_MS * 1000000L };
+    uint64_t        now_ms = utl_clock_monotonic_ms_fatal();
+    int             sig;
+
+    for (size_t i = 0; i < p->count; i++) {
+        if (prefork_spawn(p, i, now_ms) == 0) {
+            return true;
+        }
+    }
+
+    while (1) {
+        sig = sigtimedwait(&p->signals, NULL, &poll);
+        if (sig == SIGHUP || sig == SIGUSR1) {
+            prefork_signal(p, sig);
+        } else if (sig == SIGINT || sig == SIGTERM) {
+            p->stopping = true;
+            prefork_signal(p, sig);
+        }
+
+        now_ms = utl_clock_monotonic_ms_fatal();
+        if (prefork_reap(p, now_ms) == 0 && p->stopping) {
+            break;
+        }
+        for (size_t i = 0; i < p->count && !p->stopping; i++) {
+            prefork_worker_t *w = &p->workers[i];
+
+            if (w->pid == -1 && w->restart_ms != 0 && w->restart_ms <= now_ms &&
+                prefork_spawn(p, i, now_ms) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/** @}*/
@@ -0,0 +1,100 @@
+/**
+ * @file qsbr.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup qsbr
+ *  @{
+ */
+#include <stdlib.h>
+
+#include "qsbr.h"
+#include "utils.h"
+
+/** Initialize QSBR domain, readers start offline.
+ *
+ * @param qsbr          QSBR domain to initialize.
+ * @param readers_count Number of readers.
+ */
+void
+qsbr_init(qsbr_t *qsbr, size_t readers_count)
+{
+    qsbr->readers_count = readers_count;
+    qsbr->readers = aligned_alloc(CACHE_LINE_SIZE, sizeof(qsbr_reader_t) * (readers_count + 1));
+    CHECK_MALLOC(qsbr->readers);
+    for (size_t i = 0; i < readers_count; i++) {
+        atomic_init(&qsbr->readers[i].epoch, QSBR_OFFLINE);
+    }
+    atomic_init(&qsbr->epoch, 1);
+}
+
+/** Release memory held by QSBR domain, domain it self is not freed.
+ *
+ * @param qsbr QSBR domain to clean.
+ */
+void
+qsbr_clean(qsbr_t *qsbr)
+{
+    free(qsbr->readers);
+    qsbr->readers       = NULL;
+    qsbr->readers_count = 0;
+}
+
+/** Retire objects writer unpublished before this call by advancing global
+ * epoch.
+ *
+ * @param qsbr QSBR domain.
+ *
+ * @return     Returns epoch all readers have to reach before retired objects
+ *             can be released, see @ref qsbr_passed().
+ */
+uint64_t
+qsbr_retire(qsbr_t *qsbr)
+{
+    return atomic_fetch_add_explicit(&qsbr->epoch, 1, memory_order_seq_cst) + 1;
+}
+
+/** Check whether all readers passed a quiescent state since objects were
+ * retired.
+ *
+ * @param qsbr  QSBR domain.
+ * @param epoch Epoch returned by @ref qsbr_retire().
+ *
+ * @return      Returns true if no reader can reference objects retired at
+ *              epoch, and they can be released.
+ */
+bool
+qsbr_passed(qsbr_t *qsbr, uint64_t epoch)
+{
+    /* Pairs with fence in qsbr_online(). */
+    atomic_thread_fence(memory_order_seq_cst);
+    for (size_t i = 0; i < qsbr->readers_count; i++) {
+        uint64_t e = atomic_load_explicit(&qsbr->readers[i].epoch, memory_order_acquire);
+
+        if (e != QSBR_OFFLINE && e < epoch) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @}*/
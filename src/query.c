@@ -26,9 +26,60 @@
 #include <string.h>
 #include <sys/socket.h>
 
+#include "mem.h"
 #include "query.h"
 #include "utils.h"
 
+/** Strings describing query errors, indexed by @ref query_error_t. */
+static const char *query_error_strings[QUERY_ERR_COUNT] = {
+    [QUERY_ERR_NONE]           = "",
+    [QUERY_ERR_QNAME]          = "invalid question name",
+    [QUERY_ERR_QUESTION_SHORT] = "request too short for question",
+    [QUERY_ERR_QTYPE]          = "question type not supported",
+    [QUERY_ERR_QCLASS]         = "question class not supported",
+    [QUERY_ERR_ADDITIONAL]     = "malformed additional section",
+    [QUERY_ERR_EDNS_VERSION]   = "EDNS version not supported",
+    [QUERY_ERR_EDNS_OPTION]    = "malformed EDNS option",
+};
+
+/** Initialize query fields common to all queries, once query buffers are
+ * set.
+ *
+ * @param q Query object to initialize.
+ */
+static void
+query_init_fields(query_t *q)
+{
+    q->error = QUERY_ERR_NONE;
+
+    rip_ns_comp_init(&q->comp, (unsigned char *)q->response_hdr);
+
+    q->authoritative = true;
+
+    q->response_rrset = NULL;
+    q->response_soa   = NULL;
+    q->xfr            = NULL;
+    q->notify         = false;
+
+    q->response_cache_hash = 0;
+    q->response_cached     = false;
+    q->response_coalesced  = false;
+    q->response_slipped    = false;
+    q->priority            = false;
+    q->cost_sampled        = false;
+    q->lb_answer           = false;
+    q->lb_all_down         = false;
+    q->response_hot        = false;
+    q->cost_cycles         = 0;
+    q->view                = 0;
+    q->catalog_zone        = 0;
+    q->geo                 = 0;
+    q->geo_scope           = 0;
+    q->zone_slot           = 0;
+
+    q->end_code = -1;
+}
+
 /** Initialize a query object.
  * 
  * @param q        Query object to initialize.
@@ -38,24 +89,26 @@
  */
 void query_init(query_t *q, config_t *cfg, uint8_t protocol)
 {
+    mem_tag_t tag = protocol == 0 ? MEM_TAG_UDP : MEM_TAG_TCP_BUFS;
+
     *q = (query_t) {};
 
     if (protocol == 0) {
         /* UDP. */
-        q->client_ip = malloc(sizeof(struct sockaddr_storage));
+        q->client_ip = mem_malloc(tag, sizeof(struct sockaddr_storage));
         CHECK_MALLOC(q->client_ip);
-        q->local_ip = malloc(sizeof(struct sockaddr_storage));
+        q->local_ip = mem_malloc(tag, sizeof(struct sockaddr_storage));
         CHECK_MALLOC(q->local_ip);
 
         /* request buffer size allocated is RIP_NS_PACKETSZ+1. The +1 is to be
          * be able to detect mallformed requests that exceed 512 bytes.
          */
-        q->request_buffer = malloc(sizeof(unsigned char) * (RIP_NS_PACKETSZ+1));
+        q->request_buffer = mem_malloc(tag, sizeof(unsigned char) * (RIP_NS_PACKETSZ+1));
         CHECK_MALLOC(q->request_buffer);
         q->request_buffer_size = (RIP_NS_PACKETSZ+1);
         q->request_hdr = (rip_ns_header_t *)q->request_buffer;
 
-        q->response_buffer = malloc(sizeof(unsigned char) * RIP_NS_UDP_MAXMSG);
+        q->response_buffer = mem_malloc(tag, sizeof(unsigned char) * RIP_NS_UDP_MAXMSG);
         CHECK_MALLOC(q->response_buffer);
         q->response_buffer_size = RIP_NS_UDP_MAXMSG;
         q->response_hdr = (rip_ns_header_t *)q->response_buffer;
@@ -63,53 +116,178 @@ void query_init(query_t *q, config_t *cfg, uint8_t protocol)
     } else {
         /* TCP */
         q->protocol = 1;
-        q->response_buffer = malloc(sizeof(unsigned char) * cfg->tcp_writebuff_size);
+        q->response_buffer = mem_malloc(tag, sizeof(unsigned char) * cfg->tcp_writebuff_size);
+        CHECK_MALLOC(q->response_buffer);
         q->response_buffer_size = cfg->tcp_writebuff_size;
         q->response_hdr = (rip_ns_header_t *)(q->response_buffer + 2);
+        q->response_buffer_own      = q->response_buffer;
+        q->response_buffer_own_size = q->response_buffer_size;
     }
 
-    q->query_label = malloc(sizeof(unsigned char) * (RIP_NS_MAXCDNAME+1));
+    q->query_label = mem_malloc(tag, sizeof(unsigned char) * (RIP_NS_MAXCDNAME+1));
     CHECK_MALLOC(q->query_label);
     q->query_label_size = RIP_NS_MAXCDNAME + 1;
 
-    q->error_message[0] = '\0';
+    query_init_fields(q);
+}
 
-    q->dnptrs[0] = (unsigned char *)q->response_hdr;
+/** Size of arena space @ref query_init_arena() allocates for a query.
+ *
+ * @return Returns number of bytes.
+ */
+size_t
+query_arena_size(void)
+{
+    return ARENA_OBJ_SIZE(sizeof(struct sockaddr_storage)) * 2 +
+           ARENA_OBJ_SIZE(RIP_NS_UDP_MAXMSG) +
+           ARENA_OBJ_SIZE(RIP_NS_MAXCDNAME + 1);
+}
 
-    q->end_code = -1;
+/** Initialize a UDP query object with its buffers allocated from an arena.
+ * Buffers are released with arena, @ref query_clean() must not be called for
+ * query.
+ *
+ * Request and response share a single buffer: request is received into it
+ * and response is packed in place over it, reusing request header and
+ * question, see @ref query_response_in_place().
+ *
+ * @param q     Query object to initialize.
+ * @param arena Arena to allocate buffers from, it must have at least
+ *              @ref query_arena_size() bytes left.
+ */
+void
+query_init_arena(query_t *q, arena_t *arena)
+{
+    *q = (query_t) {};
+
+    q->client_ip = arena_alloc(arena, sizeof(struct sockaddr_storage));
+    CHECK_MALLOC(q->client_ip);
+    q->local_ip = arena_alloc(arena, sizeof(struct sockaddr_storage));
+    CHECK_MALLOC(q->local_ip);
+
+    q->response_buffer = arena_alloc(arena, RIP_NS_UDP_MAXMSG);
+    CHECK_MALLOC(q->response_buffer);
+    q->response_buffer_size = RIP_NS_UDP_MAXMSG;
+    q->response_hdr = (rip_ns_header_t *)q->response_buffer;
+
+    /* Request is read into response buffer, only RIP_NS_PACKETSZ+1 bytes of
+     * it as in query_init(), so oversized requests are detected.
+     */
+    q->request_buffer = q->response_buffer;
+    q->request_buffer_size = RIP_NS_PACKETSZ + 1;
+    q->request_hdr = (rip_ns_header_t *)q->request_buffer;
+
+    q->query_label = arena_alloc(arena, RIP_NS_MAXCDNAME + 1);
+    CHECK_MALLOC(q->query_label);
+    q->query_label_size = RIP_NS_MAXCDNAME + 1;
+
+    query_init_fields(q);
 }
 
 /** Reset query object so it is suitable to be reused for new query processing.
+ *
+ * Only fields a later stage reads without setting them first are reset,
+ * these include EDNS DO bit and extended rcode, which are only set when a
+ * query has them. Fields every query has set when it is read in or parsed
+ * (request length, parse timestamp, EDNS option lengths) or that are only
+ * read when another field says they are set (response wire of response
+ * RRset) are left as they are. Response header, and hence message name
+ * compression table packs into, do not change while query is reused, so only
+ * compression table is emptied.
  * 
  * @param q Query to reset.
  */
 void query_reset(query_t *q)
 {
-    q->request_buffer_len = 0;
     q->query_label_len    = 0;
+    q->query_qname_len    = 0;
+    q->query_question_len = 0;
 
     q->query_q_type  = rip_ns_t_invalid;
     q->query_q_class = rip_ns_c_invalid;
 
-    q->edns.edns_raw_buf_len  = 0;
-    q->edns.edns_valid        = 0;
+    q->edns.edns_raw_buf_len = 0;
+    q->edns.edns_valid       = 0;
+    q->edns.dnssec           = false;
+    q->edns.extended_rcode   = 0;
 
-    q->edns.client_subnet.edns_cs_raw_buf_len = 0;
-    q->edns.client_subnet.edns_cs_valid       = 0;
+    q->edns.client_subnet.edns_cs_valid = 0;
 
-    q->response_buffer_len = 0;
+    q->edns.cookie.edns_cookie_valid   = false;
+    q->edns.cookie.server_cookie_valid = false;
 
-    q->error_message[0] = '\0';
+    q->edns.tcp_keepalive = false;
 
-    for (int i = 0; i < DNS_RESPONSE_COMPRESSED_NAMES_MAX; i++) {
-        q->dnptrs[i] = NULL;
-    }
-    q->dnptrs[0] = (unsigned char *)q->response_hdr;
+    query_tcp_response_buffer_release(q);
+    q->response_buffer_len  = 0;
+    q->response_edns_offset = 0;
+
+    q->error = QUERY_ERR_NONE;
+
+    rip_ns_comp_reset(&q->comp);
+
+    q->answer_section_count     = 0;
+    q->answer_qname_count       = 0;
+    q->answer_wildcard          = false;
+    q->authority_section_count  = 0;
+    q->additional_section_count = 0;
+
+    q->authoritative = true;
+
+    q->response_rrset = NULL;
+    q->response_soa   = NULL;
+    q->xfr            = NULL;
+    q->notify         = false;
+
+    q->response_cache_hash = 0;
+    q->response_cached     = false;
+    q->response_coalesced  = false;
+    q->response_slipped    = false;
+    q->priority            = false;
+    q->cost_sampled        = false;
+    q->lb_answer           = false;
+    q->lb_all_down         = false;
+    q->response_hot        = false;
+    q->cost_cycles         = 0;
+    q->view                = 0;
+    q->catalog_zone        = 0;
+    q->geo                 = 0;
+    q->geo_scope           = 0;
+    q->zone_slot           = 0;
+
+    q->resolve_time = (struct timespec){ };
+    q->pack_time    = (struct timespec){ };
+
+    q->end_code = rip_ns_r_rip_unknown;
+}
 
+/** Reset parsed query so it is suitable to be resolved again, resolve
+ * results are cleared and parse results are kept.
+ *
+ * @param q Query to reset.
+ */
+void query_resolve_reset(query_t *q)
+{
     q->answer_section_count     = 0;
+    q->answer_qname_count       = 0;
+    q->answer_wildcard          = false;
     q->authority_section_count  = 0;
     q->additional_section_count = 0;
 
+    q->authoritative  = true;
+    q->response_rrset = NULL;
+    q->response_soa   = NULL;
+    q->xfr            = NULL;
+    q->zone_slot      = 0;
+
+    q->response_cache_hash = 0;
+    q->response_cached     = false;
+    q->response_coalesced  = false;
+    q->response_slipped    = false;
+    q->lb_answer           = false;
+    q->lb_all_down         = false;
+    q->response_hot        = false;
+
     q->end_code = rip_ns_r_rip_unknown;
 }
 
@@ -119,46 +297,90 @@ void query_reset(query_t *q)
  */
 void query_clean(query_t *q)
 {
+    mem_tag_t tag = q->protocol == 0 ? MEM_TAG_UDP : MEM_TAG_TCP_BUFS;
+
     if (q->protocol == 0) {
         /* UDP specific . */
-        free(q->client_ip);
-        free(q->local_ip);
-        free(q->request_buffer);
+        mem_free(tag, q->client_ip);
+        mem_free(tag, q->local_ip);
+        mem_free(tag, q->request_buffer);
+    } else {
+        /* TCP, response buffer taken from pool goes back to pool. */
+        query_tcp_response_buffer_release(q);
     }
-    free(q->response_buffer);
-    free(q->query_label);
+    mem_free(tag, q->response_buffer);
+    mem_free(tag, q->query_label);
+}
+
+/** Get string describing query error.
+ *
+ * @param error Query error, see @ref query_error_t.
+ *
+ * @return      Returns static '\0' terminated string describing error, empty
+ *              string if error is QUERY_ERR_NONE or not known.
+ */
+const char *
+query_error_str(query_error_t error)
+{
+    if (error >= QUERY_ERR_COUNT) {
+        return query_error_strings[QUERY_ERR_NONE];
+    }
+    return query_error_strings[error];
 }
 
 /** Increase the query response buffer size. This is only valid if query is
  * used with TCP transport.
  * 
- * Response buffer size is increased via call to realloc() in increments of
- * @ref RIP_NS_UDP_MAXMSG up to max size of @ref RIP_NS_MAXMSG.
+ * Response buffer is replaced by a buffer of next size class of query
+ * response buffer pool, up to size of @ref RIP_NS_MAXMSG plus 2 byte length
+ * prefix. Response buffer it replaces, if taken from pool, is returned to pool.
+ * Data in response buffer is not kept, response is to be packed again.
  * 
  * @param q Query whose response buffer to increase.
  *
  * @return  Returns 0 on success, otherwise an error occurred and response buffer
- *          was untouched.
+ *          was untouched. Error occurs if query has no response buffer pool or
+ *          response buffer is already of maximum size.
  */
 int
 query_tcp_response_buffer_increase(query_t *q)
 {
-    size_t buf_size = q->response_buffer_size;
-    if (buf_size >= RIP_NS_MAXMSG) {
-        return -1;
-    }
+    unsigned char *buf;
+    size_t         buf_size;
 
-    buf_size += RIP_NS_UDP_MAXMSG;
-    if (buf_size > RIP_NS_MAXMSG) {
-        buf_size = RIP_NS_MAXMSG;
+    if (q->response_pool == NULL || q->response_buffer_size >= RIP_NS_MAXMSG + 2) {
+        return -1;
     }
-    unsigned char *buf = realloc(q->response_buffer, buf_size);
+    buf = buf_pool_get(q->response_pool, q->response_buffer_size + 1, &buf_size);
     if (buf == NULL) {
         return -1;
     }
+    query_tcp_response_buffer_release(q);
+
     q->response_buffer = buf;
     q->response_buffer_size = buf_size;
     q->response_hdr = (rip_ns_header_t *)(buf + 2);
-    q->dnptrs[0] = (unsigned char *)q->response_hdr;
+    q->comp.msg = (unsigned char *)q->response_hdr;
     return 0;
-}
\ No newline at end of file
+}
+
+/** Release TCP response buffer taken from query response buffer pool, by
+ * @ref query_tcp_response_buffer_increase(), back to pool. Query goes back to
+ * using response buffer it owns. Nothing is done if query uses response
+ * buffer it owns, or has no response buffer pool.
+ *
+ * @param q Query whose response buffer to release.
+ */
+void
+query_tcp_response_buffer_release(query_t *q)
+{
+    if (q->response_buffer == q->response_buffer_own || q->response_pool == NULL) {
+        return;
+    }
+    buf_pool_put(q->response_pool, q->response_buffer, q->response_buffer_size);
+
+    q->response_buffer = q->response_buffer_own;
+    q->response_buffer_size = q->response_buffer_own_size;
+    q->response_hdr = (rip_ns_header_t *)(q->response_buffer + 2);
+    q->comp.msg = (unsigned char *)q->response_hdr;
+}
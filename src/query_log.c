@@ -22,41 +22,485 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "constants.h"
+#include "mem.h"
 #include "query.h"
 #include "rip_ns_utils.h"
 #include "utils.h"
 
-/** Rotate query log.
+/** Timestamp formatting cache of thread converting records to text. Query
+ * log thread converts records of all vectorloops, which are logged within
+ * the same second, so date and time are formatted about once a second.
+ */
+static __thread utl_time_fmt_t query_log_time_fmt = { .sec = -1 };
+
+/** Initialize query log and allocate its ring of chunks.
+ * 
+ * @param query_log   Query log to initialize.
+ * @param buf_size    Size of each chunk buffer.
+ * @param chunk_count Number of chunks in ring, MUST be at least 2.
+ */
+void
+query_log_init(query_log_t *query_log, size_t buf_size, size_t chunk_count)
+{
+    query_log->buf_size    = buf_size;
+    query_log->chunk_count = chunk_count;
+    query_log->chunks      = mem_malloc(MEM_TAG_QUERY_LOG, sizeof(query_log_chunk_t) * chunk_count);
+    CHECK_MALLOC(query_log->chunks);
+    for (size_t i = 0; i < chunk_count; i++) {
+        query_log->chunks[i].buf = mem_malloc(MEM_TAG_QUERY_LOG, buf_size);
+        CHECK_MALLOC(query_log->chunks[i].buf);
+        query_log->chunks[i].len = 0;
+    }
+    query_log->buf     = query_log->chunks[0].buf;
+    query_log->buf_len = 0;
+    query_log->shm     = NULL;
+    query_log->shm_len = 0;
+    query_log->spill   = NULL;
+    atomic_init(&query_log->head, 0);
+    atomic_init(&query_log->tail, 0);
+}
+
+/** Initialize query log with its ring of chunks mapped from shared memory
+ * file, see @ref query_log_shm_t. Existing file is replaced, readers still
+ * mapping it keep old ring.
+ * 
+ * @param query_log   Query log to initialize.
+ * @param path        Path of shared memory file, usually in /dev/shm.
+ * @param vl_id       ID of vectorloop query log belongs to.
+ * @param buf_size    Size of each chunk buffer.
+ * @param chunk_count Number of chunks in ring, MUST be at least 2.
+ * @param err         Buffer to write error message to.
+ * @param err_len     Size of err buffer.
+ * 
+ * @return            Returns 0 on success, otherwise -1 and query log is not
+ *                    initialized.
+ */
+int
+query_log_init_shm(query_log_t *query_log, const char *path, uint32_t vl_id,
+                   size_t buf_size, size_t chunk_count, char *err,
+                   size_t err_len)
+{
+    size_t           page    = sysconf(_SC_PAGESIZE);
+    size_t           offset  = sizeof(query_log_shm_t) +
+                               sizeof(query_log_shm_chunk_t) * chunk_count;
+    size_t           len     = 0;
+    void            *map     = NULL;
+    query_log_shm_t *shm     = NULL;
+    int              fd      = -1;
+
+    offset = (offset + page - 1) / page * page;
+    len    = offset + buf_size * chunk_count;
+
+    unlink(path);
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        snprintf(err, err_len, "Could not create query log shared memory \"%s\", "
+                 "error message: %s", path, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, len) != 0) {
+        snprintf(err, err_len, "Could not size query log shared memory \"%s\", "
+                 "error message: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        snprintf(err, err_len, "Could not map query log shared memory \"%s\", "
+                 "error message: %s", path, strerror(errno));
+        unlink(path);
+        return -1;
+    }
+    mem_account_update(MEM_TAG_QUERY_LOG, len);
+
+    shm = map;
+    shm->magic       = QUERY_LOG_SHM_MAGIC;
+    shm->version     = QUERY_LOG_SHM_VERSION;
+    shm->vl_id       = vl_id;
+    shm->chunk_count = chunk_count;
+    shm->buf_size    = buf_size;
+    shm->data_offset = offset;
+    atomic_init(&shm->closed, 0);
+    atomic_init(&shm->head, 0);
+    atomic_init(&shm->drops, 0);
+    atomic_init(&shm->overruns, 0);
+    atomic_init(&shm->reader, 0);
+
+    query_log->buf_size    = buf_size;
+    query_log->chunk_count = chunk_count;
+    query_log->chunks      = mem_malloc(MEM_TAG_QUERY_LOG, sizeof(query_log_chunk_t) * chunk_count);
+    CHECK_MALLOC(query_log->chunks);
+    for (size_t i = 0; i < chunk_count; i++) {
+        query_log->chunks[i].buf = (char *)map + offset + buf_size * i;
+        query_log->chunks[i].len = 0;
+        atomic_init(&shm->chunks[i].seq, 0);
+        shm->chunks[i].len = 0;
+    }
+    query_log->buf     = query_log->chunks[0].buf;
+    query_log->buf_len = 0;
+    query_log->shm     = shm;
+    query_log->shm_len = len;
+    query_log->spill   = NULL;
+    atomic_init(&query_log->head, 0);
+    atomic_init(&query_log->tail, 0);
+
+    /* First chunk is being written as chunk 0. */
+    atomic_store_explicit(&shm->chunks[0].seq, 1, memory_order_release);
+
+    return 0;
+}
+
+/** Mark shared memory ring of query log closed, telling readers no more
+ * chunks are published. Only vectorloop the query log belongs to may call
+ * this function, once it published its last chunk.
+ * 
+ * @param query_log Query log to close.
+ */
+void
+query_log_close(query_log_t *query_log)
+{
+    if (query_log->shm != NULL) {
+        atomic_store_explicit(&query_log->shm->closed, 1, memory_order_release);
+    }
+}
+
+/** Count a query not logged for lack of buffer space in shared memory ring
+ * of query log, if it has one. Only vectorloop the query log belongs to may
+ * call this function.
+ * 
+ * @param query_log Query log query was not logged to.
+ */
+void
+query_log_drop(query_log_t *query_log)
+{
+    if (query_log->shm != NULL) {
+        atomic_fetch_add_explicit(&query_log->shm->drops, 1, memory_order_relaxed);
+    }
+}
+
+/** Publish chunk to shared memory ring readers and mark next chunk as being
+ * written, counting an overrun if attached reader has not consumed chunk it
+ * held.
+ * 
+ * @param query_log Query log with shared memory ring.
+ * @param head      Number of chunk being published.
+ */
+static void
+query_log_shm_publish(query_log_t *query_log, unsigned long long head)
+{
+    query_log_shm_t       *shm   = query_log->shm;
+    query_log_shm_chunk_t *chunk = &shm->chunks[head % query_log->chunk_count];
+    unsigned long long     next  = head + 1;
+    unsigned long long     reader;
+
+    chunk->len = query_log->buf_len;
+    atomic_store_explicit(&chunk->seq, 2 * head + 2, memory_order_release);
+    atomic_store_explicit(&shm->head, next, memory_order_release);
+
+    /* Next chunk held chunk number next - chunk_count. */
+    chunk  = &shm->chunks[next % query_log->chunk_count];
+    reader = atomic_load_explicit(&shm->reader, memory_order_acquire);
+    if (reader != 0 && next >= query_log->chunk_count &&
+        reader <= next - query_log->chunk_count) {
+        atomic_fetch_add_explicit(&shm->overruns, 1, memory_order_relaxed);
+    }
+
+    /* Reader seeing its chunk's seq change discards what it copied, records
+     * written from here on MUST not be seen before seq is.
+     */
+    atomic_store_explicit(&chunk->seq, 2 * next + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/** Publish active chunk to query logging thread and switch to next chunk.
+ * Only vectorloop the query log belongs to may call this function.
  * 
- * Active log to write queries is switched to the other side.
+ * @param query_log Query log to publish active chunk of.
  * 
- * @param query_log Query log to rotate.
+ * @return          Returns true if chunk was published (or there was nothing
+ *                  to publish). Returns false if ring is full, in which case
+ *                  active chunk is kept and logging to it may continue.
+ */
+bool
+query_log_publish(query_log_t *query_log)
+{
+    unsigned long long head;
+    unsigned long long tail;
+
+    if (query_log->buf_len == 0) {
+        return true;
+    }
+    head = atomic_load_explicit(&query_log->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&query_log->tail, memory_order_acquire);
+
+    /* Next chunk MUST not be owned by query logging thread. */
+    if (head + 1 - tail >= query_log->chunk_count) {
+        return false;
+    }
+
+    query_log->chunks[head % query_log->chunk_count].len = query_log->buf_len;
+    atomic_store_explicit(&query_log->head, head + 1, memory_order_release);
+    if (query_log->shm != NULL) {
+        query_log_shm_publish(query_log, head);
+    }
+
+    query_log->buf     = query_log->chunks[(head + 1) % query_log->chunk_count].buf;
+    query_log->buf_len = 0;
+
+    return true;
+}
+
+/** Get oldest published chunk. Only query logging thread may call this
+ * function.
+ * 
+ * @param query_log Query log to get chunk from.
+ * 
+ * @return          Returns oldest published chunk, or NULL if no chunk is
+ *                  published. Chunk is owned by caller until it is handed
+ *                  back with @ref query_log_consume.
+ */
+query_log_chunk_t *
+query_log_peek(query_log_t *query_log)
+{
+    unsigned long long tail = atomic_load_explicit(&query_log->tail, memory_order_relaxed);
+
+    if (tail == atomic_load_explicit(&query_log->head, memory_order_acquire)) {
+        return NULL;
+    }
+    return &query_log->chunks[tail % query_log->chunk_count];
+}
+
+/** Hand oldest published chunk back to vectorloop. Only query logging thread
+ * may call this function, after @ref query_log_peek returned a chunk.
+ * 
+ * @param query_log Query log to hand chunk back to.
  */
 void
-query_log_rotate(query_log_t *query_log)
+query_log_consume(query_log_t *query_log)
+{
+    unsigned long long tail = atomic_load_explicit(&query_log->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&query_log->tail, tail + 1, memory_order_release);
+}
+
+/** Check if query log ring is full, I.E: active chunk could not be published
+ * if it was. Only vectorloop the query log belongs to may call this function.
+ * 
+ * @param query_log Query log to check.
+ * 
+ * @return          Returns true if all chunks but active one are owned by
+ *                  query logging thread.
+ */
+bool
+query_log_backlogged(query_log_t *query_log)
+{
+    unsigned long long head = atomic_load_explicit(&query_log->head, memory_order_relaxed);
+    unsigned long long tail = atomic_load_explicit(&query_log->tail, memory_order_acquire);
+
+    return head + 1 - tail >= query_log->chunk_count;
+}
+
+/** Allocate spill buffer of query log, records that do not fit into ring
+ * are logged to with @ref query_log_spill.
+ * 
+ * @param query_log  Query log to allocate spill buffer for.
+ * @param spill_size Size of spill buffer.
+ */
+void
+query_log_spill_init(query_log_t *query_log, size_t spill_size)
+{
+    query_log->spill        = mem_malloc(MEM_TAG_QUERY_LOG, spill_size);
+    CHECK_MALLOC(query_log->spill);
+    query_log->spill_size   = spill_size;
+    query_log->spill_len    = 0;
+    query_log->spill_offset = 0;
+    query_log->spill_time   = 0;
+}
+
+/** Log query to spill buffer of query log. Only vectorloop the query log
+ * belongs to may call this function, once query did not fit into ring or
+ * spill buffer is not empty, so records are kept in order.
+ * 
+ * @param ql        Query log with spill buffer.
+ * @param q         Query to log.
+ * @param now       Current time in nanoseconds.
+ * 
+ * @return          Returns number of bytes logged, 0 if spill buffer is full.
+ */
+int
+query_log_spill(query_log_t *ql, query_t *q, uint64_t now)
+{
+    int len;
+
+    len = query_log(ql->spill + ql->spill_len,
+                    ql->spill_size - ql->spill_len, q);
+    if (len > 0) {
+        if (ql->spill_len == 0) {
+            ql->spill_time = now;
+        }
+        ql->spill_len += len;
+    }
+    return len;
+}
+
+/** Move records from spill buffer of query log to ring, oldest first,
+ * publishing chunks as they fill up until ring is full. If oldest record
+ * still in spill buffer was logged more than age_max ago, records are
+ * dropped instead. Only vectorloop the query log belongs to may call this
+ * function.
+ * 
+ * @param query_log Query log with spill buffer.
+ * @param now       Current time in nanoseconds.
+ * @param age_max   Maximum age of spilled records in nanoseconds, 0 if not
+ *                  bounded.
+ * @param aged      Set to number of records dropped for age.
+ * 
+ * @return          Returns number of records moved to ring.
+ */
+size_t
+query_log_spill_drain(query_log_t *query_log, uint64_t now, uint64_t age_max,
+                      size_t *aged)
 {
-    if (query_log->buf == query_log->a_buf) {
-        /* Switch from A to B. */
-        query_log->a_buf_len = query_log->buf_len;
+    uint32_t rec_len;
+    size_t   moved = 0;
+
+    *aged = 0;
+    if (query_log->spill_len == 0) {
+        return 0;
+    }
+
+    while (query_log->spill_offset < query_log->spill_len) {
+        memcpy(&rec_len, query_log->spill + query_log->spill_offset, sizeof(rec_len));
+
+        if (age_max > 0 && now - query_log->spill_time > age_max) {
+            (*aged)++;
+        } else if (query_log->buf_size - query_log->buf_len >= rec_len) {
+            memcpy(query_log->buf + query_log->buf_len,
+                   query_log->spill + query_log->spill_offset, rec_len);
+            query_log->buf_len += rec_len;
+            moved++;
+        } else if (query_log->buf_len == 0) {
+            /* Record does not fit into an empty chunk. */
+            query_log_drop(query_log);
+        } else if (query_log_publish(query_log) == true) {
+            continue;
+        } else {
+            break;
+        }
+        query_log->spill_offset += rec_len;
+    }
+
+    if (query_log->spill_offset == query_log->spill_len) {
+        query_log->spill_len    = 0;
+        query_log->spill_offset = 0;
+    }
+    return moved;
+}
 
-        query_log->buf     = query_log->b_buf;
-        query_log->buf_len = query_log->b_buf_len = 0;
+/** Copy a socket address into query log record address.
+ * 
+ * @param dst Query log record address to copy to.
+ * @param src Socket address to copy.
+ */
+static inline void
+query_log_copy_sockaddr(query_log_sockaddr_t *dst, const struct sockaddr_storage *src)
+{
+    if (src->ss_family == AF_INET) {
+        memcpy(&dst->sin, src, sizeof(struct sockaddr_in));
     } else {
-        /* Switch from B to A. */
-        query_log->b_buf_len = query_log->buf_len;
+        memcpy(&dst->sin6, src, sizeof(struct sockaddr_in6));
+    }
+}
 
-        query_log->buf     = query_log->a_buf;
-        query_log->buf_len = query_log->a_buf_len = 0;
-    } 
+/** Get length of answer record data logged in query log record. Record data
+ * is logged for address and domain name records.
+ * 
+ * @param rr Answer record.
+ * 
+ * @return   Returns length of record data to log, 0 if none is logged.
+ */
+static inline uint16_t
+query_log_rr_rdata_len(rr_record_t *rr)
+{
+    if (rr->type == rip_ns_t_a || rr->type == rip_ns_t_aaaa ||
+        rr->type == rip_ns_t_cname || rr->type == rip_ns_t_ns ||
+        rr->type == rip_ns_t_ptr) {
+        return rr->rdata_len;
+    }
+    return 0;
 }
 
-/** Log query to buffer.
- *
- * Query log entry ends with new line "\n" (one query per line).
+/** Check if query passes query log filters and sampling, see configuration
+ * settings "query_log_rcodes", "query_log_qtypes", "query_log_errors_only",
+ * "query_log_latency_min" and "query_log_sample_rate".
+ * 
+ * @param cfg          Configuration with query log settings.
+ * @param q            Query to check.
+ * @param sample_count Queries that passed filters since last sampled one,
+ *                     kept by caller across queries.
+ * 
+ * @return             Returns true if query should be logged, otherwise
+ *                     false.
+ */
+bool
+query_log_filter(const config_t *cfg, query_t *q, uint32_t *sample_count)
+{
+    uint32_t rcode_bit;
+    uint64_t latency_us;
+
+    /* Rcode filter. */
+    rcode_bit = q->end_code < 0 ? QUERY_LOG_RCODE_NORESPONSE : 1U << (q->end_code & 31);
+    if ((cfg->query_log_rcodes & rcode_bit) == 0) {
+        return false;
+    }
+
+    /* Question type filter. */
+    if (cfg->query_log_qtypes != QUERY_LOG_QTYPES_ALL &&
+        (q->query_q_type >= 64 ||
+         (cfg->query_log_qtypes & ((uint64_t)1 << q->query_q_type)) == 0)) {
+        return false;
+    }
+
+    /* NOERROR queries, optionally only slow ones. */
+    if (q->end_code == rip_ns_r_noerror) {
+        if (cfg->query_log_latency_min > 0) {
+            latency_us = (utl_timespec_to_ns(&q->end_time) -
+                          utl_timespec_to_ns(&q->start_time)) / 1000;
+            if (latency_us < cfg->query_log_latency_min) {
+                return false;
+            }
+        } else if (cfg->query_log_errors_only == true) {
+            return false;
+        }
+    }
+
+    /* Sample one in query_log_sample_rate queries. */
+    if (cfg->query_log_sample_rate > 1) {
+        if (++*sample_count < cfg->query_log_sample_rate) {
+            return false;
+        }
+        *sample_count = 0;
+    }
+    return true;
+}
+
+/** Log query to buffer as binary query log record, see
+ * @ref query_log_record_t. Query data is only copied, conversion to text is
+ * left to query log thread, see @ref query_log_record_to_text.
  * 
  * @param buf     Buffer to log query to.
  * @param buf_len Length of buffer (available space).
@@ -64,8 +508,113 @@ query_log_rotate(query_log_t *query_log)
  *
  * @return        Returns number of bytes added to buf on success,
  *                otherwise returns 0 and error occurred (ie not enough
- *                room in buffer, or not a logable query end code) and nothing
- *                was added to buf.
+ *                room in buffer) and nothing was added to buf.
+ */
+int
+query_log(char *buf, size_t buf_len, query_t *q)
+{
+    query_log_record_t     rec;
+    query_log_record_rr_t  rec_rr;
+    rr_record_t           *rr;
+    size_t                 len;
+    int                    answer_count = q->answer_section_count;
+
+    if (answer_count > QUERY_LOG_ANSWER_MAX) {
+        answer_count = QUERY_LOG_ANSWER_MAX;
+    }
+
+    /* Length of record. */
+    len = sizeof(query_log_record_t) + q->query_label_len;
+    for (int i = 0; i < answer_count; i++) {
+        len += sizeof(query_log_record_rr_t) + q->answer_section[i]->name_len +
+               query_log_rr_rdata_len(q->answer_section[i]);
+    }
+    if (len > buf_len) {
+        return 0;
+    }
+
+    rec = (query_log_record_t) {
+        .len            = len,
+        .end_code       = q->end_code,
+        .start_time     = q->start_time,
+        .end_time       = q->end_time,
+        .udp_resp_len   = q->edns.udp_resp_len,
+        .cs_family      = q->edns.client_subnet.family,
+        .q_type         = q->query_q_type,
+        .q_class        = q->query_q_class,
+        .q_name_len     = q->query_label_len,
+        .protocol       = q->protocol,
+        .edns_version   = q->edns.version,
+        .cs_source_mask = q->edns.client_subnet.source_mask,
+        .cs_scope_mask  = q->edns.client_subnet.scope_mask,
+        .answer_count   = answer_count,
+    };
+    query_log_copy_sockaddr(&rec.client_ip, q->client_ip);
+    query_log_copy_sockaddr(&rec.local_ip, q->local_ip);
+
+    if (q->request_hdr != NULL) {
+        rec.id = q->request_hdr->id;
+        if (q->request_hdr->rd) {
+            rec.flags |= QUERY_LOG_REC_F_RD;
+        }
+        /* Request with TC bit set is not answered, header of an answered
+         * request may be overwritten by response packed in place.
+         */
+        if (q->request_hdr->tc && q->response_buffer_len == 0) {
+            rec.flags |= QUERY_LOG_REC_F_TC;
+        }
+    }
+    if (q->edns.edns_valid) {
+        rec.flags |= QUERY_LOG_REC_F_EDNS;
+        if (q->edns.dnssec) {
+            rec.flags |= QUERY_LOG_REC_F_DO;
+        }
+        if (q->edns.client_subnet.edns_cs_valid) {
+            rec.flags |= QUERY_LOG_REC_F_CS;
+            query_log_copy_sockaddr(&rec.cs_ip, query_edns_cs_ip(&q->edns.client_subnet));
+        }
+    }
+    if (q->answer_section_count > 0 || q->authority_section_count > 0 ||
+        q->additional_section_count > 0) {
+        rec.flags |= QUERY_LOG_REC_F_RESPONSE;
+    }
+
+    memcpy(buf, &rec, sizeof(query_log_record_t));
+    buf += sizeof(query_log_record_t);
+    memcpy(buf, q->query_label, q->query_label_len);
+    buf += q->query_label_len;
+
+    for (int i = 0; i < answer_count; i++) {
+        rr = q->answer_section[i];
+        rec_rr = (query_log_record_rr_t) {
+            .ttl       = rr->ttl,
+            .type      = rr->type,
+            .class     = rr->class,
+            .name_len  = rr->name_len,
+            .rdata_len = query_log_rr_rdata_len(rr),
+        };
+        memcpy(buf, &rec_rr, sizeof(query_log_record_rr_t));
+        buf += sizeof(query_log_record_rr_t);
+        memcpy(buf, rr->name, rr->name_len);
+        buf += rr->name_len;
+        memcpy(buf, rr->rdata, rec_rr.rdata_len);
+        buf += rec_rr.rdata_len;
+    }
+
+    return len;
+}
+
+/** Convert binary query log record to text.
+ *
+ * Query log entry ends with new line "\n" (one query per line).
+ * 
+ * @param rec     Binary query log record, see @ref query_log_record_t.
+ * @param buf     Buffer to write text to.
+ * @param buf_len Length of buffer (available space).
+ *
+ * @return        Returns number of bytes added to buf on success,
+ *                otherwise returns 0 and error occurred (ie not enough
+ *                room in buffer) and nothing was added to buf.
  *                
  */
 /*
@@ -94,18 +643,15 @@ response:
 
 */
 int
-query_log(char *buf, size_t buf_len, query_t *q)
+query_log_record_to_text(const char *rec, char *buf, size_t buf_len)
 {
+    query_log_record_t     r;
+    query_log_record_rr_t  rr;
+    const char            *q_name;
+    const char            *rr_ptr;
     char     *buf_start = buf;
-    char      client_ip[INET6_ADDRSTRLEN];
     uint16_t  client_port;
-    int       client_ip_len;
-    char      local_ip[INET6_ADDRSTRLEN];
     uint16_t  local_port;
-    int       local_ip_len;
-
-    struct sockaddr_in  *sin;
-    struct sockaddr_in6 *sin6;
 
     char one  = '1';
     char zero = '0';
@@ -113,66 +659,67 @@ query_log(char *buf, size_t buf_len, query_t *q)
     const char *cstr;
     size_t      cstr_len;
 
+    char         rdata[RIP_NS_MAXCDNAME * 4 + 1];
+    int          rdata_len;
+
     /* Space in the buffer MUST be at least 64K or assume there is not enough
      * room to write full query log. We purposefully enforce this
      * requirement to speed up logging by not having to check if there is 
-     * room before each memcpy() of sprintf() call.
+     * room before each memcpy() or number and address formatting call.
      */
     if (buf_len < QUERY_LOG_BUF_MIN_SPACE) {
         return 0;
     }
 
-    /* client and local IP & port. */
-    if (q->client_ip->ss_family == AF_INET) {
-        sin = (struct sockaddr_in *)q->client_ip;
-        inet_ntop(AF_INET, &sin->sin_addr, client_ip, INET6_ADDRSTRLEN);
-        client_port = ntohs(sin->sin_port);
-        sin = (struct sockaddr_in *)q->local_ip;
-        inet_ntop(AF_INET, &sin->sin_addr, local_ip, INET6_ADDRSTRLEN);
-        local_port = ntohs(sin->sin_port);
-    } else {
-        sin6 = (struct sockaddr_in6 *)q->client_ip;
-        inet_ntop(AF_INET6, &sin6->sin6_addr, client_ip, INET6_ADDRSTRLEN);
-        client_port = ntohs(sin6->sin6_port);
-        sin6 = (struct sockaddr_in6 *)q->local_ip;
-        inet_ntop(AF_INET6, &sin6->sin6_addr, local_ip, INET6_ADDRSTRLEN);
-        local_port = ntohs(sin6->sin6_port);
-    }
-    client_ip_len = strlen(client_ip);
-    local_ip_len  = strlen(local_ip);
+    /* Records are not aligned in log buffer, copy fixed size part out. */
+    memcpy(&r, rec, sizeof(query_log_record_t));
+    q_name = rec + sizeof(query_log_record_t);
 
+    /* client and local IP & port, addresses are written directly into the
+     * buffer.
+     */
     memcpy(buf, "{\"c_ip\":\"", 9);
     buf += 9;
-    memcpy(buf, client_ip, client_ip_len);
-    buf += client_ip_len;
+    if (r.client_ip.sa.sa_family == AF_INET) {
+        buf += utl_ipv4_to_str(&r.client_ip.sin.sin_addr, buf);
+        client_port = ntohs(r.client_ip.sin.sin_port);
+        local_port = ntohs(r.local_ip.sin.sin_port);
+    } else {
+        buf += utl_ipv6_to_str(&r.client_ip.sin6.sin6_addr, buf);
+        client_port = ntohs(r.client_ip.sin6.sin6_port);
+        local_port = ntohs(r.local_ip.sin6.sin6_port);
+    }
     memcpy(buf,"\",\"c_port\":\"", 12);
     buf += 12;
-    buf += sprintf(buf, "%u", client_port);
+    buf += utl_u32_to_dec(client_port, buf);
     memcpy(buf, "\",\"l_ip\":\"", 10);
     buf += 10;
-    memcpy(buf, local_ip, local_ip_len);
-    buf += local_ip_len;
+    if (r.client_ip.sa.sa_family == AF_INET) {
+        buf += utl_ipv4_to_str(&r.local_ip.sin.sin_addr, buf);
+    } else {
+        buf += utl_ipv6_to_str(&r.local_ip.sin6.sin6_addr, buf);
+    }
     memcpy(buf,"\",\"l_port\":\"", 12);
     buf += 12;
-    buf += sprintf(buf, "%u", local_port);
+    buf += utl_u32_to_dec(local_port, buf);
 
     /* receive and send timestamps. */
     memcpy(buf, "\",\"recv_time\":\"", 15);
     buf += 15;
-    buf += utl_timespec_to_rfc3339nano(&q->start_time, buf);
+    buf += utl_time_fmt_rfc3339nano(&query_log_time_fmt, &r.start_time, buf);
 
-    if (q->end_code >= 0) {
+    if (r.end_code >= 0) {
         /* Negative end code indicates that response was not sent hence no
          * send time.
          */
         memcpy(buf, "\",\"send_time\":\"", 15);
         buf += 15;
-        buf += utl_timespec_to_rfc3339nano(&q->end_time, buf);
+        buf += utl_time_fmt_rfc3339nano(&query_log_time_fmt, &r.end_time, buf);
         memcpy(buf, "\"", 1);
         buf += 1;
     }
 
-    if (q->end_code != rip_ns_r_noerror &&  q->end_code <= rip_ns_r_formerr ) {
+    if (r.end_code != rip_ns_r_noerror &&  r.end_code <= rip_ns_r_formerr ) {
         /* Error code so do not log anything else. */
         memcpy(buf, "}\n", 2);
         buf += 2;
@@ -187,7 +734,7 @@ query_log(char *buf, size_t buf_len, query_t *q)
      */
     memcpy(buf, ",\"request\":{\"rd\":\"", 18);
     buf += 18;
-    if (q->request_hdr->rd == 0) {
+    if ((r.flags & QUERY_LOG_REC_F_RD) == 0) {
         *buf = zero;
     } else {
         *buf = one;
@@ -195,7 +742,7 @@ query_log(char *buf, size_t buf_len, query_t *q)
     buf += 1;
     memcpy(buf, "\",\"tc\":\"", 8);
     buf += 8;
-    if (q->request_hdr->tc == 0) {
+    if ((r.flags & QUERY_LOG_REC_F_TC) == 0) {
         *buf = zero;
     } else {
         *buf = one;
@@ -205,18 +752,18 @@ query_log(char *buf, size_t buf_len, query_t *q)
     buf += 18;
     
     /* edns */
-    if (q->edns.edns_valid || q->end_code == rip_ns_r_badvers) {
+    if ((r.flags & QUERY_LOG_REC_F_EDNS) || r.end_code == rip_ns_r_badvers) {
         memcpy(buf,",\"edns\":{\"resp_size\":\"", 22);
         buf += 22;
-        buf += sprintf(buf, "%u", q->edns.udp_resp_len);
+        buf += utl_u32_to_dec(r.udp_resp_len, buf);
         memcpy(buf, "\",\"ver\":\"", 9);
         buf += 9;
-        buf += sprintf(buf, "%d", q->edns.version);
+        buf += utl_u32_to_dec(r.edns_version, buf);
 
-        if (q->edns.edns_valid) {
+        if ((r.flags & QUERY_LOG_REC_F_EDNS)) {
             memcpy(buf, "\",\"do\":\"", 8);
             buf += 8;
-            if (q->edns.dnssec) {
+            if (r.flags & QUERY_LOG_REC_F_DO) {
                 *buf = one;
             } else {
                 *buf = zero;
@@ -225,25 +772,20 @@ query_log(char *buf, size_t buf_len, query_t *q)
             *buf = '\"';
             buf += 1;
             /* edns client subnet */
-            if (q->edns.client_subnet.edns_cs_valid) {
+            if ((r.flags & QUERY_LOG_REC_F_CS)) {
                 memcpy(buf, ",\"cs\":{\"ip\":\"", 13);
                 buf += 13;
-                if (q->edns.client_subnet.family == 1) {
-                    sin = (struct sockaddr_in *)&q->edns.client_subnet.ip;
-                    inet_ntop(AF_INET, &sin->sin_addr, client_ip, INET6_ADDRSTRLEN);
+                if (r.cs_family == 1) {
+                    buf += utl_ipv4_to_str(&r.cs_ip.sin.sin_addr, buf);
                 } else {
-                    sin6 = (struct sockaddr_in6 *)&q->edns.client_subnet.ip;
-                    inet_ntop(AF_INET6, &sin6->sin6_addr, client_ip, INET6_ADDRSTRLEN);
+                    buf += utl_ipv6_to_str(&r.cs_ip.sin6.sin6_addr, buf);
                 }
-                client_ip_len = strlen(client_ip);
-                memcpy(buf, client_ip, client_ip_len);
-                buf += client_ip_len;
                 memcpy(buf, "\",\"source\":\"", 12);
                 buf += 12;
-                buf += sprintf(buf, "%u", q->edns.client_subnet.source_mask);
+                buf += utl_u32_to_dec(r.cs_source_mask, buf);
                 memcpy(buf, "\",\"scope\":\"", 11);
                 buf += 11;
-                buf += sprintf(buf, "%u", q->edns.client_subnet.scope_mask);
+                buf += utl_u32_to_dec(r.cs_scope_mask, buf);
                 memcpy(buf, "\"}", 2);
                 buf += 2;
             }
@@ -253,26 +795,26 @@ query_log(char *buf, size_t buf_len, query_t *q)
     }
 
     /* request question: q_name, q_type, q_class */
-    memcpy(buf, ",\"q_name\":\"", 12);
-    buf += 12;
-    memcpy(buf, q->query_label, q->query_label_len);
-    buf += q->query_label_len;
+    memcpy(buf, ",\"q_name\":\"", 11);
+    buf += 11;
+    memcpy(buf, q_name, r.q_name_len);
+    buf += r.q_name_len;
     memcpy(buf, "\",\"q_class\":\"", 13);
     buf += 13;
-    cstr = rip_ns_class_to_str(q->query_q_class);
+    cstr = rip_ns_class_to_str(r.q_class);
     cstr_len = strlen(cstr);
     memcpy(buf, cstr, cstr_len);
     buf += cstr_len;
     memcpy(buf, "\",\"q_type\":\"", 12);
     buf += 12;
-    cstr = rip_ns_rr_type_to_str(q->query_q_type);
+    cstr = rip_ns_rr_type_to_str(r.q_type);
     cstr_len = strlen(cstr);
     memcpy(buf, cstr, cstr_len);
     buf += cstr_len;
     memcpy(buf, "\"}", 2);
     buf += 2;
 
-    if (q->end_code == rip_ns_r_servfail ) {
+    if (r.end_code == rip_ns_r_servfail ) {
         /* Error code so do not log response. */
         memcpy(buf, "}\n", 2);
         buf += 2;
@@ -280,40 +822,53 @@ query_log(char *buf, size_t buf_len, query_t *q)
     }
 
     /* response. */
-    if (q->answer_section_count > 0 || q->authority_section_count > 0 ||
-        q->additional_section_count > 0) {
+    if (r.flags & QUERY_LOG_REC_F_RESPONSE) {
         memcpy(buf, ",\"response\":{", 13);
         buf += 13;
-        if (q->answer_section_count > 0) {
+        if (r.answer_count > 0) {
             memcpy(buf, "\"answer\":[", 10);
             buf += 10;
-            /* logs up to 10 entries from answer section */
-            for (int i = 0; i < q->answer_section_count && i < 10; i++) {
+            rr_ptr = q_name + r.q_name_len;
+            for (int i = 0; i < r.answer_count; i++) {
+                memcpy(&rr, rr_ptr, sizeof(query_log_record_rr_t));
+                rr_ptr += sizeof(query_log_record_rr_t);
+
                 memcpy(buf, "{\"name\":\"", 9);
                 buf += 9;
-                memcpy(buf, q->answer_section[i]->name, q->answer_section[i]->name_len);
-                buf += q->answer_section[i]->name_len;
+                memcpy(buf, rr_ptr, rr.name_len);
+                buf += rr.name_len;
+                rr_ptr += rr.name_len;
                 memcpy(buf, "\",\"class\":\"", 11);
                 buf += 11;
-                cstr = rip_ns_class_to_str(q->answer_section[i]->class);
+                cstr = rip_ns_class_to_str(rr.class);
                 cstr_len = strlen(cstr);
                 memcpy(buf, cstr, cstr_len);
                 buf += cstr_len;
                 memcpy(buf, "\",\"type\":\"", 10);
                 buf += 10;
-                cstr = rip_ns_rr_type_to_str(q->answer_section[i]->type);
+                cstr = rip_ns_rr_type_to_str(rr.type);
                 cstr_len = strlen(cstr);
                 memcpy(buf, cstr, cstr_len);
                 buf += cstr_len;
-                /* Only A type questions are supported, hence only A type
-                 * answers.
-                 */
-                memcpy(buf, "\",\"rdata\":\"", 11);
-                buf += 11;
-                inet_ntop(AF_INET, q->answer_section[i]->rdata, client_ip, INET6_ADDRSTRLEN);
-                client_ip_len = strlen(client_ip);
-                memcpy(buf, client_ip, client_ip_len);
-                buf += client_ip_len;
+                /* rdata is logged for address and domain name records. */
+                rdata_len = -1;
+                if (rr.rdata_len > 0) {
+                    if (rr.type == rip_ns_t_a) {
+                        rdata_len = utl_ipv4_to_str(rr_ptr, rdata);
+                    } else if (rr.type == rip_ns_t_aaaa) {
+                        rdata_len = utl_ipv6_to_str(rr_ptr, rdata);
+                    } else {
+                        rdata_len = rip_ns_name_ntop((const unsigned char *)rr_ptr,
+                                                     rdata, sizeof(rdata));
+                    }
+                }
+                rr_ptr += rr.rdata_len;
+                if (rdata_len >= 0) {
+                    memcpy(buf, "\",\"rdata\":\"", 11);
+                    buf += 11;
+                    memcpy(buf, rdata, rdata_len);
+                    buf += rdata_len;
+                }
                 memcpy(buf, "\"},", 3);
                 buf += 3;
             }
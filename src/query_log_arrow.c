@@ -0,0 +1,863 @@
+/**
+ * @file query_log_arrow.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_log_arrow
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "query.h"
+#include "query_log_arrow.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+
+/* Columns and FlatBuffer scalars are copied in host order, Arrow IPC is
+ * little endian.
+ */
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+               "Arrow query log is only written on little endian hosts");
+
+/** Arrow IPC continuation marker preceding message metadata length. */
+#define QUERY_LOG_ARROW_CONTINUATION 0xffffffffU
+
+/** Metadata version V5, see Schema.fbs. */
+#define QUERY_LOG_ARROW_METADATA_V5 4
+
+/** MessageHeader union types, see Message.fbs. */
+#define QUERY_LOG_ARROW_HEADER_SCHEMA           1
+#define QUERY_LOG_ARROW_HEADER_DICTIONARY_BATCH 2
+#define QUERY_LOG_ARROW_HEADER_RECORD_BATCH     3
+
+/** Type union types, see Schema.fbs. */
+#define QUERY_LOG_ARROW_TYPE_INT       2
+#define QUERY_LOG_ARROW_TYPE_UTF8      5
+#define QUERY_LOG_ARROW_TYPE_TIMESTAMP 10
+#define QUERY_LOG_ARROW_TYPE_DURATION  18
+
+/** TimeUnit NANOSECOND, see Schema.fbs. */
+#define QUERY_LOG_ARROW_UNIT_NS 3
+
+/** Dictionary IDs. */
+#define QUERY_LOG_ARROW_DICT_CLIENT_IP 0
+#define QUERY_LOG_ARROW_DICT_LOCAL_IP  1
+#define QUERY_LOG_ARROW_DICT_QTYPE     2
+#define QUERY_LOG_ARROW_DICT_RCODE     3
+
+/** Number of buffers of a batch: validity and values of each column, and
+ * data of question names.
+ */
+#define QUERY_LOG_ARROW_BUFFERS_MAX (2 * QUERY_LOG_ARROW_FIELD_COUNT + 1)
+
+/** Structure describes a column of query log schema. */
+typedef struct query_log_arrow_field_s {
+    /** Column name. */
+    const char *name;
+
+    /** Column type, QUERY_LOG_ARROW_TYPE_*, value type of dictionary encoded
+     * column.
+     */
+    uint8_t type;
+
+    /** Bit width of integer column, or of dictionary indices. */
+    uint8_t bit_width;
+
+    /** Set if integer column is signed. */
+    bool is_signed;
+
+    /** Dictionary ID of dictionary encoded column, otherwise -1. */
+    int8_t dict;
+
+    /** Offset of column in @ref query_log_arrow_t. */
+    size_t offset;
+} query_log_arrow_field_t;
+
+/** Columns of query log schema, in order. */
+static const query_log_arrow_field_t query_log_arrow_fields[] = {
+    { "time",          QUERY_LOG_ARROW_TYPE_TIMESTAMP, 64, true,  -1,
+      offsetof(query_log_arrow_t, time) },
+    { "duration",      QUERY_LOG_ARROW_TYPE_DURATION,  64, true,  -1,
+      offsetof(query_log_arrow_t, duration) },
+    { "client_ip",     QUERY_LOG_ARROW_TYPE_UTF8,      32, true,  QUERY_LOG_ARROW_DICT_CLIENT_IP,
+      offsetof(query_log_arrow_t, client_ip) },
+    { "client_port",   QUERY_LOG_ARROW_TYPE_INT,       16, false, -1,
+      offsetof(query_log_arrow_t, client_port) },
+    { "local_ip",      QUERY_LOG_ARROW_TYPE_UTF8,      32, true,  QUERY_LOG_ARROW_DICT_LOCAL_IP,
+      offsetof(query_log_arrow_t, local_ip) },
+    { "local_port",    QUERY_LOG_ARROW_TYPE_INT,       16, false, -1,
+      offsetof(query_log_arrow_t, local_port) },
+    { "protocol",      QUERY_LOG_ARROW_TYPE_INT,       8,  false, -1,
+      offsetof(query_log_arrow_t, protocol) },
+    { "id",            QUERY_LOG_ARROW_TYPE_INT,       16, false, -1,
+      offsetof(query_log_arrow_t, id) },
+    { "flags",         QUERY_LOG_ARROW_TYPE_INT,       8,  false, -1,
+      offsetof(query_log_arrow_t, flags) },
+    { "edns_udp_size", QUERY_LOG_ARROW_TYPE_INT,       16, false, -1,
+      offsetof(query_log_arrow_t, edns_udp_size) },
+    { "qname",         QUERY_LOG_ARROW_TYPE_UTF8,      0,  false, -1,
+      offsetof(query_log_arrow_t, qname) },
+    { "qclass",        QUERY_LOG_ARROW_TYPE_INT,       16, false, -1,
+      offsetof(query_log_arrow_t, qclass) },
+    { "qtype",         QUERY_LOG_ARROW_TYPE_UTF8,      32, true,  QUERY_LOG_ARROW_DICT_QTYPE,
+      offsetof(query_log_arrow_t, qtype) },
+    { "rcode",         QUERY_LOG_ARROW_TYPE_UTF8,      32, true,  QUERY_LOG_ARROW_DICT_RCODE,
+      offsetof(query_log_arrow_t, rcode) },
+    { "answer_count",  QUERY_LOG_ARROW_TYPE_INT,       8,  false, -1,
+      offsetof(query_log_arrow_t, answer_count) },
+};
+
+/** Number of columns of query log schema. */
+#define QUERY_LOG_ARROW_FIELD_COUNT \
+    (sizeof(query_log_arrow_fields) / sizeof(query_log_arrow_fields[0]))
+
+/** Upper bound of length of messages of a batch: fixed width columns,
+ * question names and full dictionaries, plus metadata and padding of each
+ * message.
+ */
+#define QUERY_LOG_ARROW_BATCH_MAX                                             \
+    (QUERY_LOG_ARROW_BATCH_ROWS * 64 + QUERY_LOG_ARROW_NAME_DATA_MAX +        \
+     QUERY_LOG_ARROW_DICT_COUNT * (QUERY_LOG_ARROW_BATCH_ROWS *               \
+     (QUERY_LOG_ARROW_DICT_VALUE_MAX + 4) + 64) +                             \
+     (QUERY_LOG_ARROW_DICT_COUNT + 1) * (QUERY_LOG_ARROW_SCHEMA_MAX + 64))
+
+_Static_assert(QUERY_LOG_ARROW_BATCH_MAX <= QUERY_LOG_TEXT_BUF_SIZE,
+               "Arrow query log batch must fit in an empty writer buffer");
+_Static_assert(QUERY_LOG_ARROW_NAME_DATA_MAX > UINT16_MAX,
+               "Any question name must fit in an empty batch");
+
+/** Rcode names, indexed by rcode. */
+static const char *query_log_arrow_rcode_txt[] = {
+    [rip_ns_r_noerror]  = "NOERROR",
+    [rip_ns_r_formerr]  = "FORMERR",
+    [rip_ns_r_servfail] = "SERVFAIL",
+    [rip_ns_r_nxdomain] = "NXDOMAIN",
+    [rip_ns_r_notimpl]  = "NOTIMPL",
+    [rip_ns_r_refused]  = "REFUSED",
+    [rip_ns_r_yxdomain] = "YXDOMAIN",
+    [rip_ns_r_yxrrset]  = "YXRRSET",
+    [rip_ns_r_nxrrset]  = "NXRRSET",
+    [rip_ns_r_notauth]  = "NOTAUTH",
+    [rip_ns_r_notzone]  = "NOTZONE",
+    [rip_ns_r_badvers]  = "BADVERS",
+    [rip_ns_r_badkey]   = "BADKEY",
+    [rip_ns_r_badtime]  = "BADTIME",
+};
+
+/** Names of reasons response was not sent, indexed by negated end code. */
+static const char *query_log_arrow_noresp_txt[] = {
+    [-rip_ns_r_rip_unknown]         = "UNKNOWN",
+    [-rip_ns_r_rip_shortheader]     = "SHORTHEADER",
+    [-rip_ns_r_rip_toolarge]        = "TOOLARGE",
+    [-rip_ns_r_rip_query_tc]        = "QUERYTC",
+    [-rip_ns_r_rip_pack_rr_err]     = "PACKERROR",
+    [-rip_ns_r_rip_tcp_write_err]   = "TCPWRITEERROR",
+    [-rip_ns_r_rip_tcp_write_close] = "TCPWRITECLOSE",
+    [-rip_ns_r_rip_rrl_drop]        = "RRLDROP",
+    [-rip_ns_r_rip_deferred]        = "DEFERRED",
+    [-rip_ns_r_rip_xfr]             = "XFR",
+    [-rip_ns_r_rip_acl_drop]        = "ACLDROP",
+    [-rip_ns_r_rip_overload_drop]   = "OVERLOADDROP",
+    [-rip_ns_r_rip_policy_drop]     = "POLICYDROP",
+};
+
+/** FlatBuffer being built. It is built front to back: every object is
+ * appended after objects referring to it, so each reference is a forward
+ * uoffset patched in once object it refers to is appended. Tables are 8 byte
+ * aligned and preceded by their vtable.
+ */
+typedef struct query_log_arrow_fb_s {
+    /** Buffer FlatBuffer is built in. */
+    unsigned char buf[QUERY_LOG_ARROW_META_MAX];
+
+    /** Length of FlatBuffer. */
+    size_t len;
+} query_log_arrow_fb_t;
+
+/** Structure describes a buffer of message body. */
+typedef struct query_log_arrow_buf_s {
+    /** Buffer data. */
+    const void *data;
+
+    /** Length of buffer data. */
+    size_t len;
+} query_log_arrow_buf_t;
+
+/** Append zeroed space to FlatBuffer.
+ * 
+ * @param fb  FlatBuffer.
+ * @param len Length of space.
+ * 
+ * @return    Returns position of space.
+ */
+static size_t
+query_log_arrow_fb_reserve(query_log_arrow_fb_t *fb, size_t len)
+{
+    size_t pos = fb->len;
+
+    /* Messages have a fixed number of columns, metadata is bounded. */
+    assert(fb->len + len <= QUERY_LOG_ARROW_META_MAX);
+    memset(fb->buf + pos, 0, len);
+    fb->len += len;
+    return pos;
+}
+
+/** Pad FlatBuffer with zeros to alignment. */
+static inline void
+query_log_arrow_fb_pad(query_log_arrow_fb_t *fb, size_t align)
+{
+    query_log_arrow_fb_reserve(fb, (align - fb->len % align) % align);
+}
+
+/** Write scalar into FlatBuffer at position. */
+static inline void
+query_log_arrow_fb_put(query_log_arrow_fb_t *fb, size_t pos, const void *v, size_t len)
+{
+    memcpy(fb->buf + pos, v, len);
+}
+
+/** Patch uoffset at position ref to refer to end of FlatBuffer, where
+ * object it refers to is appended next.
+ */
+static inline void
+query_log_arrow_fb_ref(query_log_arrow_fb_t *fb, size_t ref)
+{
+    uint32_t off = fb->len - ref;
+
+    query_log_arrow_fb_put(fb, ref, &off, 4);
+}
+
+/** Append table and its vtable to FlatBuffer. Fields are laid out by size,
+ * so each is aligned, and are left zeroed.
+ * 
+ * @param fb     FlatBuffer.
+ * @param ref    Position of uoffset referring to table.
+ * @param count  Number of fields in vtable.
+ * @param sizes  Size of each field (1, 2, 4 or 8), 0 if field is absent.
+ * @param fields Populated with position of each field, 0 if absent.
+ * 
+ * @return       Returns position of table.
+ */
+static size_t
+query_log_arrow_fb_table(query_log_arrow_fb_t *fb, size_t ref, size_t count,
+                         const uint8_t *sizes, size_t *fields)
+{
+    uint16_t vt[2 + count];
+    uint16_t len = 4;
+    size_t   vt_pos;
+    size_t   pos;
+    int32_t  soff;
+
+    /* Table starts with soffset to vtable, 8 byte fields follow the rest. */
+    for (uint8_t size = 4; size >= 1; size /= 2) {
+        for (size_t i = 0; i < count; i++) {
+            if (sizes[i] == size) {
+                vt[2 + i] = len;
+                len      += size;
+            }
+        }
+    }
+    len = (len + 7) & ~7;
+    for (size_t i = 0; i < count; i++) {
+        if (sizes[i] == 8) {
+            vt[2 + i] = len;
+            len      += 8;
+        } else if (sizes[i] == 0) {
+            vt[2 + i] = 0;
+        }
+    }
+    vt[0] = sizeof(vt);
+    vt[1] = len;
+
+    query_log_arrow_fb_pad(fb, 2);
+    vt_pos = query_log_arrow_fb_reserve(fb, sizeof(vt));
+    query_log_arrow_fb_put(fb, vt_pos, vt, sizeof(vt));
+
+    query_log_arrow_fb_pad(fb, 8);
+    query_log_arrow_fb_ref(fb, ref);
+    pos  = query_log_arrow_fb_reserve(fb, len);
+    soff = pos - vt_pos;
+    query_log_arrow_fb_put(fb, pos, &soff, 4);
+
+    for (size_t i = 0; i < count; i++) {
+        fields[i] = sizes[i] == 0 ? 0 : pos + vt[2 + i];
+    }
+    return pos;
+}
+
+/** Append string to FlatBuffer.
+ * 
+ * @param fb  FlatBuffer.
+ * @param ref Position of uoffset referring to string.
+ * @param str String, '\0' terminated.
+ */
+static void
+query_log_arrow_fb_string(query_log_arrow_fb_t *fb, size_t ref, const char *str)
+{
+    uint32_t len = strlen(str);
+    size_t   pos;
+
+    query_log_arrow_fb_pad(fb, 4);
+    query_log_arrow_fb_ref(fb, ref);
+    pos = query_log_arrow_fb_reserve(fb, 4 + len + 1);
+    query_log_arrow_fb_put(fb, pos, &len, 4);
+    query_log_arrow_fb_put(fb, pos + 4, str, len);
+}
+
+/** Append vector to FlatBuffer, elements are left zeroed.
+ * 
+ * @param fb        FlatBuffer.
+ * @param ref       Position of uoffset referring to vector.
+ * @param count     Number of elements.
+ * @param elem_size Size of element, elements of 8 bytes or more are 8 byte
+ *                  aligned.
+ * 
+ * @return          Returns position of first element.
+ */
+static size_t
+query_log_arrow_fb_vector(query_log_arrow_fb_t *fb, size_t ref, uint32_t count,
+                          size_t elem_size)
+{
+    size_t pos;
+
+    query_log_arrow_fb_pad(fb, 4);
+    if (elem_size >= 8 && fb->len % 8 == 0) {
+        /* Length precedes elements. */
+        query_log_arrow_fb_reserve(fb, 4);
+    }
+    query_log_arrow_fb_ref(fb, ref);
+    pos = query_log_arrow_fb_reserve(fb, 4 + count * elem_size);
+    query_log_arrow_fb_put(fb, pos, &count, 4);
+    return pos + 4;
+}
+
+/** Start FlatBuffer with Message table as its root.
+ * 
+ * @param fb          FlatBuffer.
+ * @param header_type Message header type, QUERY_LOG_ARROW_HEADER_*.
+ * @param body_len    Populated with position of message body length, 0
+ *                    until set.
+ * 
+ * @return            Returns position of uoffset referring to message header.
+ */
+static size_t
+query_log_arrow_fb_message(query_log_arrow_fb_t *fb, uint8_t header_type,
+                           size_t *body_len)
+{
+    /* version, header_type, header, bodyLength */
+    const uint8_t sizes[] = { 2, 1, 4, 8 };
+    size_t        f[4];
+    int16_t       version = QUERY_LOG_ARROW_METADATA_V5;
+
+    fb->len = 0;
+    query_log_arrow_fb_reserve(fb, 4);
+    query_log_arrow_fb_table(fb, 0, 4, sizes, f);
+    query_log_arrow_fb_put(fb, f[0], &version, 2);
+    query_log_arrow_fb_put(fb, f[1], &header_type, 1);
+    *body_len = f[3];
+    return f[2];
+}
+
+/** Append Int type table to FlatBuffer. */
+static void
+query_log_arrow_fb_int(query_log_arrow_fb_t *fb, size_t ref, int32_t bit_width,
+                       bool is_signed)
+{
+    /* bitWidth, is_signed */
+    const uint8_t sizes[] = { 4, 1 };
+    size_t        f[2];
+
+    query_log_arrow_fb_table(fb, ref, 2, sizes, f);
+    query_log_arrow_fb_put(fb, f[0], &bit_width, 4);
+    query_log_arrow_fb_put(fb, f[1], &is_signed, 1);
+}
+
+/** Append Field table of column to FlatBuffer.
+ * 
+ * @param fb    FlatBuffer.
+ * @param ref   Position of uoffset referring to field.
+ * @param field Column.
+ */
+static void
+query_log_arrow_fb_field(query_log_arrow_fb_t *fb, size_t ref,
+                         const query_log_arrow_field_t *field)
+{
+    /* name, nullable, type_type, type, dictionary, children */
+    const uint8_t sizes[]      = { 4, 1, 1, 4, field->dict < 0 ? 0 : 4, 4 };
+    /* Dictionary: id, indexType, isOrdered, dictionaryKind */
+    const uint8_t dict_sizes[] = { 8, 4, 1, 2 };
+    /* Timestamp: unit, timezone */
+    const uint8_t ts_sizes[]   = { 2, 4 };
+    size_t        f[6];
+    size_t        t[4];
+    int16_t       unit = QUERY_LOG_ARROW_UNIT_NS;
+    int64_t       id   = field->dict;
+
+    query_log_arrow_fb_table(fb, ref, 6, sizes, f);
+    query_log_arrow_fb_put(fb, f[2], &field->type, 1);
+    query_log_arrow_fb_string(fb, f[0], field->name);
+
+    switch (field->type) {
+    case QUERY_LOG_ARROW_TYPE_INT:
+        query_log_arrow_fb_int(fb, f[3], field->bit_width, field->is_signed);
+        break;
+    case QUERY_LOG_ARROW_TYPE_TIMESTAMP:
+        query_log_arrow_fb_table(fb, f[3], 2, ts_sizes, t);
+        query_log_arrow_fb_put(fb, t[0], &unit, 2);
+        query_log_arrow_fb_string(fb, t[1], "UTC");
+        break;
+    case QUERY_LOG_ARROW_TYPE_DURATION:
+        query_log_arrow_fb_table(fb, f[3], 1, ts_sizes, t);
+        query_log_arrow_fb_put(fb, t[0], &unit, 2);
+        break;
+    default:
+        /* Utf8 table has no fields. */
+        query_log_arrow_fb_table(fb, f[3], 0, NULL, t);
+        break;
+    }
+
+    if (field->dict >= 0) {
+        query_log_arrow_fb_table(fb, f[4], 4, dict_sizes, t);
+        query_log_arrow_fb_put(fb, t[0], &id, 8);
+        query_log_arrow_fb_int(fb, t[1], field->bit_width, field->is_signed);
+    }
+
+    /* Readers require children vector, even if empty. */
+    query_log_arrow_fb_vector(fb, f[5], 0, 4);
+}
+
+/** Append RecordBatch table to FlatBuffer, with a node and buffers of each
+ * column. Columns have no nulls, validity buffers are empty.
+ * 
+ * @param fb        FlatBuffer.
+ * @param ref       Position of uoffset referring to record batch.
+ * @param rows      Number of rows.
+ * @param nodes     Number of columns.
+ * @param bufs      Buffers of columns.
+ * @param buf_count Number of buffers.
+ * 
+ * @return          Returns length of message body.
+ */
+static int64_t
+query_log_arrow_fb_record_batch(query_log_arrow_fb_t *fb, size_t ref, int64_t rows,
+                                size_t nodes, const query_log_arrow_buf_t *bufs,
+                                size_t buf_count)
+{
+    /* length, nodes, buffers */
+    const uint8_t sizes[]  = { 8, 4, 4 };
+    size_t        f[3];
+    size_t        pos;
+    int64_t       node[2]  = { rows, 0 };
+    int64_t       buffer[2];
+    int64_t       body_len = 0;
+
+    query_log_arrow_fb_table(fb, ref, 3, sizes, f);
+    query_log_arrow_fb_put(fb, f[0], &rows, 8);
+
+    pos = query_log_arrow_fb_vector(fb, f[1], nodes, sizeof(node));
+    for (size_t i = 0; i < nodes; i++) {
+        query_log_arrow_fb_put(fb, pos + i * sizeof(node), node, sizeof(node));
+    }
+
+    /* Buffers are 8 byte aligned in body. */
+    pos = query_log_arrow_fb_vector(fb, f[2], buf_count, sizeof(buffer));
+    for (size_t i = 0; i < buf_count; i++) {
+        buffer[0] = body_len;
+        buffer[1] = bufs[i].len;
+        query_log_arrow_fb_put(fb, pos + i * sizeof(buffer), buffer, sizeof(buffer));
+        body_len += (bufs[i].len + 7) & ~7;
+    }
+    return body_len;
+}
+
+/** Write encapsulated message: continuation marker, metadata length,
+ * metadata padded to 8 bytes, and body buffers each padded to 8 bytes.
+ * 
+ * @param buf       Buffer to write message to, large enough for it.
+ * @param fb        FlatBuffer with message metadata.
+ * @param bufs      Body buffers.
+ * @param buf_count Number of body buffers.
+ * 
+ * @return          Returns length of message.
+ */
+static size_t
+query_log_arrow_message(char *buf, query_log_arrow_fb_t *fb,
+                        const query_log_arrow_buf_t *bufs, size_t buf_count)
+{
+    uint32_t marker   = QUERY_LOG_ARROW_CONTINUATION;
+    int32_t  meta_len;
+    char    *p        = buf;
+
+    query_log_arrow_fb_pad(fb, 8);
+    meta_len = fb->len;
+    memcpy(p, &marker, 4);
+    memcpy(p + 4, &meta_len, 4);
+    memcpy(p + 8, fb->buf, fb->len);
+    p += 8 + fb->len;
+
+    for (size_t i = 0; i < buf_count; i++) {
+        size_t pad = (8 - bufs[i].len % 8) % 8;
+
+        memcpy(p, bufs[i].data, bufs[i].len);
+        memset(p + bufs[i].len, 0, pad);
+        p += bufs[i].len + pad;
+    }
+    return p - buf;
+}
+
+/** Write Schema message of query log.
+ * 
+ * @param buf     Buffer to write message to.
+ * @param buf_len Length of buffer (available space), at least
+ *                @ref QUERY_LOG_ARROW_SCHEMA_MAX.
+ * 
+ * @return        Returns number of bytes added to buf on success,
+ *                otherwise returns 0 and error occurred (ie not enough
+ *                room in buffer) and nothing was added to buf.
+ */
+size_t
+query_log_arrow_schema(char *buf, size_t buf_len)
+{
+    query_log_arrow_fb_t fb;
+    /* endianness, fields */
+    const uint8_t        sizes[] = { 2, 4 };
+    size_t               f[2];
+    size_t               pos;
+    size_t               ref;
+    size_t               body_len_pos;
+
+    if (buf_len < QUERY_LOG_ARROW_SCHEMA_MAX) {
+        return 0;
+    }
+
+    /* Schema message has no body. */
+    ref = query_log_arrow_fb_message(&fb, QUERY_LOG_ARROW_HEADER_SCHEMA, &body_len_pos);
+    query_log_arrow_fb_table(&fb, ref, 2, sizes, f);
+    pos = query_log_arrow_fb_vector(&fb, f[1], QUERY_LOG_ARROW_FIELD_COUNT, 4);
+    for (size_t i = 0; i < QUERY_LOG_ARROW_FIELD_COUNT; i++) {
+        query_log_arrow_fb_field(&fb, pos + 4 * i, &query_log_arrow_fields[i]);
+    }
+    return query_log_arrow_message(buf, &fb, NULL, 0);
+}
+
+/** Write end-of-stream marker.
+ * 
+ * @param buf Buffer of at least @ref QUERY_LOG_ARROW_EOS_LEN to write marker
+ *            to.
+ * 
+ * @return    Returns @ref QUERY_LOG_ARROW_EOS_LEN.
+ */
+size_t
+query_log_arrow_eos(char *buf)
+{
+    uint32_t marker = QUERY_LOG_ARROW_CONTINUATION;
+
+    memcpy(buf, &marker, 4);
+    memset(buf + 4, 0, 4);
+    return QUERY_LOG_ARROW_EOS_LEN;
+}
+
+/** Reset batch to hold no rows, and its dictionaries to hold no values.
+ * 
+ * @param a Batch to reset.
+ */
+void
+query_log_arrow_reset(query_log_arrow_t *a)
+{
+    a->rows     = 0;
+    a->qname[0] = 0;
+    for (int i = 0; i < QUERY_LOG_ARROW_DICT_COUNT; i++) {
+        memset(a->dicts[i].slots, 0, sizeof(a->dicts[i].slots));
+        a->dicts[i].count      = 0;
+        a->dicts[i].offsets[0] = 0;
+    }
+}
+
+/** Look up key in dictionary, adding entry if key is not found. Value of
+ * added entry MUST be set with @ref query_log_arrow_dict_value.
+ * 
+ * @param d     Dictionary.
+ * @param key   Key, @ref QUERY_LOG_ARROW_DICT_KEY_MAX bytes.
+ * @param found Set if key was found.
+ * 
+ * @return      Returns index of entry.
+ */
+static inline int32_t
+query_log_arrow_dict_get(query_log_arrow_dict_t *d, const unsigned char *key,
+                         bool *found)
+{
+    uint32_t h = 2166136261U;
+    uint32_t slot;
+
+    for (int i = 0; i < QUERY_LOG_ARROW_DICT_KEY_MAX; i++) {
+        h = (h ^ key[i]) * 16777619U;
+    }
+    for (slot = h & (QUERY_LOG_ARROW_DICT_SLOTS - 1); d->slots[slot] != 0;
+         slot = (slot + 1) & (QUERY_LOG_ARROW_DICT_SLOTS - 1)) {
+        if (memcmp(d->keys[d->slots[slot] - 1], key, QUERY_LOG_ARROW_DICT_KEY_MAX) == 0) {
+            *found = true;
+            return d->slots[slot] - 1;
+        }
+    }
+    memcpy(d->keys[d->count], key, QUERY_LOG_ARROW_DICT_KEY_MAX);
+    d->slots[slot] = ++d->count;
+    *found = false;
+    return d->count - 1;
+}
+
+/** Set value of entry last added to dictionary.
+ * 
+ * @param d         Dictionary.
+ * @param value_len Length of value, written at d->data + d->offsets[count - 1].
+ */
+static inline void
+query_log_arrow_dict_value(query_log_arrow_dict_t *d, size_t value_len)
+{
+    d->offsets[d->count] = d->offsets[d->count - 1] + value_len;
+}
+
+/** Look up address in dictionary, adding it as text if not found.
+ * 
+ * @param d    Dictionary.
+ * @param addr Socket address.
+ * @param port Populated with port of address.
+ * 
+ * @return     Returns index of address entry.
+ */
+static int32_t
+query_log_arrow_dict_addr(query_log_arrow_dict_t *d, const query_log_sockaddr_t *addr,
+                          uint16_t *port)
+{
+    unsigned char key[QUERY_LOG_ARROW_DICT_KEY_MAX] = { };
+    int32_t       idx;
+    bool          found;
+    char         *value;
+
+    if (addr->sa.sa_family == AF_INET) {
+        key[0] = 4;
+        memcpy(key + 1, &addr->sin.sin_addr, 4);
+        *port = ntohs(addr->sin.sin_port);
+    } else {
+        key[0] = 6;
+        memcpy(key + 1, &addr->sin6.sin6_addr, 16);
+        *port = ntohs(addr->sin6.sin6_port);
+    }
+    idx = query_log_arrow_dict_get(d, key, &found);
+    if (!found) {
+        value = d->data + d->offsets[idx];
+        query_log_arrow_dict_value(d, key[0] == 4 ?
+                                   utl_ipv4_to_str(&addr->sin.sin_addr, value) :
+                                   utl_ipv6_to_str(&addr->sin6.sin6_addr, value));
+    }
+    return idx;
+}
+
+/** Look up question type in dictionary, adding its name if not found. Types
+ * without a name are added as "TYPE" followed by number (RFC 3597).
+ */
+static int32_t
+query_log_arrow_dict_qtype(query_log_arrow_dict_t *d, uint16_t q_type)
+{
+    unsigned char  key[QUERY_LOG_ARROW_DICT_KEY_MAX] = { };
+    int32_t        idx;
+    bool           found;
+    const char    *name;
+    char          *value;
+
+    memcpy(key, &q_type, sizeof(q_type));
+    idx = query_log_arrow_dict_get(d, key, &found);
+    if (!found) {
+        value = d->data + d->offsets[idx];
+        name  = rip_ns_rr_type_to_str(q_type);
+        if (strcmp(name, "unknown") == 0) {
+            query_log_arrow_dict_value(d, sprintf(value, "TYPE%u", q_type));
+        } else {
+            query_log_arrow_dict_value(d, stpcpy(value, name) - value);
+        }
+    }
+    return idx;
+}
+
+/** Look up query end code in dictionary, adding its rcode name, or name of
+ * reason response was not sent, if not found.
+ */
+static int32_t
+query_log_arrow_dict_rcode(query_log_arrow_dict_t *d, int32_t end_code)
+{
+    unsigned char  key[QUERY_LOG_ARROW_DICT_KEY_MAX] = { };
+    int32_t        idx;
+    bool           found;
+    const char    *name = NULL;
+    char          *value;
+
+    memcpy(key, &end_code, sizeof(end_code));
+    idx = query_log_arrow_dict_get(d, key, &found);
+    if (!found) {
+        value = d->data + d->offsets[idx];
+        if (end_code >= 0 && end_code < (int32_t)(sizeof(query_log_arrow_rcode_txt) /
+                                             sizeof(query_log_arrow_rcode_txt[0]))) {
+            name = query_log_arrow_rcode_txt[end_code];
+        } else if (end_code < 0 && -end_code < (int32_t)(sizeof(query_log_arrow_noresp_txt) /
+                                                   sizeof(query_log_arrow_noresp_txt[0]))) {
+            name = query_log_arrow_noresp_txt[-end_code];
+        }
+        if (name == NULL) {
+            query_log_arrow_dict_value(d, sprintf(value, "RCODE%d", end_code));
+        } else {
+            query_log_arrow_dict_value(d, stpcpy(value, name) - value);
+        }
+    }
+    return idx;
+}
+
+/** Add binary query log record to batch as a row.
+ * 
+ * @param a   Batch.
+ * @param rec Binary query log record, see @ref query_log_record_t.
+ * 
+ * @return    Returns 0 on success, otherwise batch is full, it has to be
+ *            encoded with @ref query_log_arrow_batch, and -1 is returned.
+ */
+int
+query_log_arrow_add(query_log_arrow_t *a, const char *rec)
+{
+    query_log_record_t r;
+    uint32_t           row = a->rows;
+
+    /* Records are not aligned in log buffer, copy fixed size part out. */
+    memcpy(&r, rec, sizeof(query_log_record_t));
+    if (row == QUERY_LOG_ARROW_BATCH_ROWS ||
+        a->qname[row] + r.q_name_len > QUERY_LOG_ARROW_NAME_DATA_MAX) {
+        return -1;
+    }
+
+    a->time[row]     = utl_timespec_to_ns(&r.start_time);
+    a->duration[row] = r.end_code >= 0 ?
+                       utl_timespec_to_ns(&r.end_time) - a->time[row] : 0;
+    a->client_ip[row] = query_log_arrow_dict_addr(&a->dicts[QUERY_LOG_ARROW_DICT_CLIENT_IP],
+                                                  &r.client_ip, &a->client_port[row]);
+    a->local_ip[row]  = query_log_arrow_dict_addr(&a->dicts[QUERY_LOG_ARROW_DICT_LOCAL_IP],
+                                                  &r.local_ip, &a->local_port[row]);
+    a->protocol[row]      = r.protocol;
+    a->id[row]            = ntohs(r.id);
+    a->flags[row]         = r.flags;
+    a->edns_udp_size[row] = r.udp_resp_len;
+    memcpy(a->qname_data + a->qname[row], rec + sizeof(query_log_record_t), r.q_name_len);
+    a->qname[row + 1]     = a->qname[row] + r.q_name_len;
+    a->qclass[row]        = r.q_class;
+    a->qtype[row]         = query_log_arrow_dict_qtype(&a->dicts[QUERY_LOG_ARROW_DICT_QTYPE],
+                                                       r.q_type);
+    a->rcode[row]         = query_log_arrow_dict_rcode(&a->dicts[QUERY_LOG_ARROW_DICT_RCODE],
+                                                       r.end_code);
+    a->answer_count[row]  = r.answer_count;
+    a->rows++;
+    return 0;
+}
+
+/** Encode batch as replacement DictionaryBatch message of each dictionary
+ * followed by RecordBatch message, and reset batch.
+ * 
+ * @param a       Batch, MUST hold at least one row.
+ * @param buf     Buffer to write messages to.
+ * @param buf_len Length of buffer (available space).
+ * 
+ * @return        Returns number of bytes added to buf on success,
+ *                otherwise returns 0 and error occurred (ie not enough
+ *                room in buffer), nothing was added to buf and batch is
+ *                left as is.
+ */
+size_t
+query_log_arrow_batch(query_log_arrow_t *a, char *buf, size_t buf_len)
+{
+    query_log_arrow_fb_t   fb;
+    query_log_arrow_buf_t  bufs[QUERY_LOG_ARROW_BUFFERS_MAX];
+    query_log_arrow_dict_t *d;
+    /* DictionaryBatch: id, data, isDelta */
+    const uint8_t          sizes[] = { 8, 4, 1 };
+    size_t                 f[3];
+    size_t                 ref;
+    size_t                 body_len_pos;
+    size_t                 buf_count;
+    size_t                 len = 0;
+    int64_t                body_len;
+    int64_t                id;
+    const char            *col;
+
+    /* Check room for whole batch up front, messages are not split. */
+    body_len = a->qname[a->rows];
+    for (int i = 0; i < QUERY_LOG_ARROW_DICT_COUNT; i++) {
+        body_len += (a->dicts[i].count + 1) * 4 + a->dicts[i].offsets[a->dicts[i].count] + 16;
+    }
+    body_len += (a->rows + 1) * 4 + QUERY_LOG_ARROW_FIELD_COUNT * (a->rows * 8 + 8);
+    if (buf_len < body_len + (QUERY_LOG_ARROW_DICT_COUNT + 1) * QUERY_LOG_ARROW_SCHEMA_MAX) {
+        return 0;
+    }
+
+    for (int i = 0; i < QUERY_LOG_ARROW_DICT_COUNT; i++) {
+        d       = &a->dicts[i];
+        id      = i;
+        bufs[0] = (query_log_arrow_buf_t){ NULL, 0 };
+        bufs[1] = (query_log_arrow_buf_t){ d->offsets, (d->count + 1) * 4 };
+        bufs[2] = (query_log_arrow_buf_t){ d->data, d->offsets[d->count] };
+
+        ref = query_log_arrow_fb_message(&fb, QUERY_LOG_ARROW_HEADER_DICTIONARY_BATCH,
+                                         &body_len_pos);
+        query_log_arrow_fb_table(&fb, ref, 3, sizes, f);
+        query_log_arrow_fb_put(&fb, f[0], &id, 8);
+        body_len = query_log_arrow_fb_record_batch(&fb, f[1], d->count, 1, bufs, 3);
+        query_log_arrow_fb_put(&fb, body_len_pos, &body_len, 8);
+        len += query_log_arrow_message(buf + len, &fb, bufs, 3);
+    }
+
+    buf_count = 0;
+    for (size_t i = 0; i < QUERY_LOG_ARROW_FIELD_COUNT; i++) {
+        const query_log_arrow_field_t *field = &query_log_arrow_fields[i];
+
+        col = (const char *)a + field->offset;
+        bufs[buf_count++] = (query_log_arrow_buf_t){ NULL, 0 };
+        if (field->dict < 0 && field->type == QUERY_LOG_ARROW_TYPE_UTF8) {
+            bufs[buf_count++] = (query_log_arrow_buf_t){ col, (a->rows + 1) * 4 };
+            bufs[buf_count++] = (query_log_arrow_buf_t){ a->qname_data, a->qname[a->rows] };
+        } else {
+            bufs[buf_count++] = (query_log_arrow_buf_t){ col, a->rows * field->bit_width / 8 };
+        }
+    }
+    ref = query_log_arrow_fb_message(&fb, QUERY_LOG_ARROW_HEADER_RECORD_BATCH, &body_len_pos);
+    body_len = query_log_arrow_fb_record_batch(&fb, ref, a->rows, QUERY_LOG_ARROW_FIELD_COUNT,
+                                               bufs, buf_count);
+    query_log_arrow_fb_put(&fb, body_len_pos, &body_len, 8);
+    len += query_log_arrow_message(buf + len, &fb, bufs, buf_count);
+
+    query_log_arrow_reset(a);
+    return len;
+}
+
+/** @}*/
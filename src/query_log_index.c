@@ -0,0 +1,144 @@
+/**
+ * @file xor_filter.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_log_index
+ *  @{
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "query_log_index.h"
+
+/** Hash question name for block Bloom filter. Name is hashed case
+ * insensitive and without trailing dot, so "WWW.Example.com." and
+ * "www.example.com" hash the same.
+ *
+ * @param name     Question name, as logged.
+ * @param name_len Length of name.
+ *
+ * @return         Returns 64 bit hash of name.
+ */
+uint64_t
+query_log_index_name_hash(const char *name, size_t name_len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    if (name_len > 1 && name[name_len - 1] == '.') {
+        name_len--;
+    }
+
+    /* FNV-1a, finalized with murmur3 64 bit finalizer. */
+    for (size_t i = 0; i < name_len; i++) {
+        unsigned char c = (unsigned char)name[i];
+
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/** Initialize index file header.
+ *
+ * @param h          Header to initialize.
+ * @param compressed Set if query log file is compressed.
+ */
+void
+query_log_index_header_init(query_log_index_header_t *h, bool compressed)
+{
+    memset(h, 0, sizeof(*h));
+    h->magic        = QUERY_LOG_INDEX_MAGIC;
+    h->version      = QUERY_LOG_INDEX_VERSION;
+    h->flags        = compressed ? QUERY_LOG_INDEX_F_COMPRESSED : 0;
+    h->entry_size   = sizeof(query_log_index_entry_t);
+    h->bloom_bits   = QUERY_LOG_INDEX_BLOOM_BITS;
+    h->bloom_hashes = QUERY_LOG_INDEX_BLOOM_HASHES;
+}
+
+/** Check index file header was written with same layout this module uses.
+ *
+ * @param h Header read from index file.
+ *
+ * @return  Returns 0 if index entries can be read, otherwise -1.
+ */
+int
+query_log_index_header_check(const query_log_index_header_t *h)
+{
+    if (h->magic != QUERY_LOG_INDEX_MAGIC ||
+        h->version != QUERY_LOG_INDEX_VERSION ||
+        h->entry_size != sizeof(query_log_index_entry_t) ||
+        h->bloom_bits != QUERY_LOG_INDEX_BLOOM_BITS ||
+        h->bloom_hashes != QUERY_LOG_INDEX_BLOOM_HASHES) {
+        return -1;
+    }
+    return 0;
+}
+
+/** Reset index entry to an empty block.
+ *
+ * @param e Index entry to reset.
+ */
+void
+query_log_index_entry_reset(query_log_index_entry_t *e)
+{
+    memset(e, 0, sizeof(*e));
+    e->time_first = UINT64_MAX;
+}
+
+/** Add query to index entry of block it is logged to.
+ *
+ * @param e        Index entry of block.
+ * @param name     Question name of query.
+ * @param name_len Length of question name.
+ * @param ts       Time query was received.
+ */
+void
+query_log_index_entry_add(query_log_index_entry_t *e, const char *name,
+                          size_t name_len, const struct timespec *ts)
+{
+    uint64_t hash = query_log_index_name_hash(name, name_len);
+    uint64_t ns   = (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+
+    for (uint32_t i = 0; i < QUERY_LOG_INDEX_BLOOM_HASHES; i++) {
+        uint32_t bit = query_log_index_bloom_bit(hash, i);
+
+        e->bloom[bit / 8] |= 1 << (bit % 8);
+    }
+    if (ns < e->time_first) {
+        e->time_first = ns;
+    }
+    if (ns > e->time_last) {
+        e->time_last = ns;
+    }
+    e->records++;
+}
+
+/** @}*/
@@ -22,58 +22,170 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-#include <errno.h>
-#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "config.h"
 #include "constants.h"
 #include "channel.h"
+#include "dnstap.h"
 #include "log_app.h"
 #include "query.h"
+#include "query_log_arrow.h"
+#include "query_log_writer.h"
 #include "utils.h"
 
 
-/** Open query log file for write.
+/** Function converting a binary query log record to query log format. */
+typedef int (*query_log_loop_convert_fn)(const char *rec, char *buf, size_t buf_len);
+
+/** Add binary query log record to index entry of query log writer buffer
+ * it is converted to.
  * 
- * @param cfg         Configuration with settings to use.
- * @param err_msg     Buffer to populate error message if error is one encountered.
- * @param err_msg_len Length (in bytes) of err_msg buffer.
- *
- * @return            On success return sfile descriptor, otherwise error
- *                    occurred and -1 is returned in which case error message
- *                    in populated in err_mgs buffer.
+ * @param b   Query log writer buffer.
+ * @param rec Binary query log record.
  */
-static int
-query_log_loop_openfile(config_t *cfg, char *err_msg, size_t err_msg_len)
+static inline void
+query_log_loop_index_add(query_log_writer_buf_t *b, const char *rec)
 {
-    int             fd = -1;
-    struct timespec ts;
-    char            current_time_str[TIME_RFC3339_STRLEN];
-    char            filename[QUERY_LOG_FILENAME_MAX_LEN];
-
-    utl_clock_gettime_rt_fatal(&ts);
-    utl_timespec_to_rfc3339nano(&ts, current_time_str);
-    snprintf(filename, QUERY_LOG_FILENAME_MAX_LEN, "%s/%s_%s",
-             cfg->query_log_realpath, cfg->query_log_base_name, current_time_str);
-    fd = open(filename, O_CREAT|O_WRONLY|O_APPEND, 00777);
-    if (fd < 0) {
-        /* Error opening file! */
-        snprintf(err_msg, err_msg_len, "Error opening query log file %s, %s",
-                 filename, strerror(errno));
-        debug_printf("%s", err_msg);
-    } else {
-        debug_printf("Query log file %s opened for append writes, fd: %d",
-                     filename, fd);
+    query_log_record_t r;
+
+    /* Records are not aligned in log buffer, copy fixed size part out. */
+    memcpy(&r, rec, sizeof(query_log_record_t));
+    query_log_index_entry_add(&b->index, rec + sizeof(query_log_record_t),
+                              r.q_name_len, &r.start_time);
+}
+
+/** Convert binary query log records to query log format into query log
+ * writer buffers.
+ * Buffers that may not have room for next record are handed to writer
+ * thread. If writer has no free buffer this function waits for one, so slow
+ * disk holds up draining instead of losing records already logged. With
+ * query log index buffers are also handed over once they hold
+ * "query_log_index_records" records, each is an indexed block.
+ * 
+ * @param w       Query log writer to convert records to.
+ * @param convert Function converting a record, see @ref query_log_record_to_text
+ *                and @ref query_log_record_to_dnstap.
+ * @param buf     Buffer with binary query log records.
+ * @param buf_len Length of data in buf.
+ * 
+ * @return        Returns number of bytes records were converted to.
+ */
+static size_t
+query_log_loop_convert(query_log_writer_t *w, query_log_loop_convert_fn convert,
+                       char *buf, size_t buf_len)
+{
+    size_t                  offset  = 0;
+    size_t                  written = 0;
+    size_t                  text_len;
+    uint32_t                rec_len;
+    query_log_writer_buf_t *b;
+
+    while (offset < buf_len) {
+        while ((b = query_log_writer_buf_get(w)) == NULL) {
+            usleep(QUERY_LOG_LOOP_SLOWDOWN);
+        }
+        if (w->buf_size - b->len < QUERY_LOG_BUF_MIN_SPACE) {
+            /* Buffer may not have room for next record. */
+            query_log_writer_buf_submit(w, false);
+            continue;
+        }
+
+        memcpy(&rec_len, buf + offset, sizeof(rec_len));
+        text_len = convert(buf + offset, b->buf + b->len, w->buf_size - b->len);
+        b->len  += text_len;
+        written += text_len;
+        if (w->index) {
+            query_log_loop_index_add(b, buf + offset);
+            if (b->index.records >= w->cfg->query_log_index_records) {
+                query_log_writer_buf_submit(w, false);
+            }
+        }
+        offset  += rec_len;
     }
-    return fd;
+    return written;
 }
 
-/** Function polls vectorloop threads for query log data and writes it to file.
+/** Encode Arrow batch held into query log writer buffer. If buffer being
+ * filled has no room for batch it is handed to writer thread, and batch is
+ * encoded into next one. Batch always fits in an empty buffer.
+ * 
+ * @param w Query log writer to encode batch to.
+ * @param a Arrow batch, left empty.
+ */
+static void
+query_log_loop_arrow_flush(query_log_writer_t *w, query_log_arrow_t *a)
+{
+    query_log_writer_buf_t *b;
+    size_t                  len;
+
+    while (a->rows > 0) {
+        while ((b = query_log_writer_buf_get(w)) == NULL) {
+            usleep(QUERY_LOG_LOOP_SLOWDOWN);
+        }
+        len = query_log_arrow_batch(a, b->buf + b->len, w->buf_size - b->len);
+        if (len == 0) {
+            query_log_writer_buf_submit(w, false);
+            continue;
+        }
+        b->len += len;
+    }
+}
+
+/** Add binary query log records to Arrow batch, full batch is encoded into
+ * query log writer buffers.
+ * 
+ * @param w       Query log writer to encode batches to.
+ * @param a       Arrow batch to add records to.
+ * @param buf     Buffer with binary query log records.
+ * @param buf_len Length of data in buf.
+ * 
+ * @return        Returns number of bytes of records added.
+ */
+static size_t
+query_log_loop_arrow(query_log_writer_t *w, query_log_arrow_t *a, char *buf,
+                     size_t buf_len)
+{
+    size_t   offset = 0;
+    uint32_t rec_len;
+
+    while (offset < buf_len) {
+        memcpy(&rec_len, buf + offset, sizeof(rec_len));
+        while (query_log_arrow_add(a, buf + offset) != 0) {
+            query_log_loop_arrow_flush(w, a);
+        }
+        offset += rec_len;
+    }
+    return buf_len;
+}
+
+/** Get monotonic time for query_log_age_max bound.
+ * 
+ * @return Returns monotonic time in nanoseconds.
+ */
+static inline uint64_t
+query_log_loop_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return utl_timespec_to_ns(&ts);
+}
+
+/** Function drains query log chunks vectorloop threads publish and converts
+ * binary query log records in them to text. Text is written to file by query
+ * log writer thread this function starts. Once stop is set, all published
+ * chunks are written out, writer thread is stopped and function returns.
+ * With configuration setting query_log_age_max this function never sleeps
+ * longer than it, and hands all text to writer at least that often.
  * This function is meant to run in its own dedicated thread.
  * 
  * @param args  Structure with settings to use.
@@ -85,114 +197,121 @@ query_log_loop(void *args)
 {
     query_log_loop_args_t *ql_args = (query_log_loop_args_t *)args;
 
-    config_t          *cfg                     = ql_args->cfg;
-    channel_bss_t     *query_log_channels      = ql_args->query_log_channels;
-    size_t             query_log_channel_count = ql_args->query_log_channel_count;
-    channel_bss_msg_t *ch_msg;
-    uint64_t           channel_msg_id_base = 0;
+    query_log_t        **query_logs      = ql_args->query_logs;
+    size_t               query_log_count = ql_args->query_log_count;
+    query_log_chunk_t   *chunk;
+    query_log_writer_t  *writer;
+    query_log_arrow_t   *arrow = NULL;
+    pthread_t            writer_thread;
 
-    bool   waiting;
-    char  *buf;
-    size_t buf_len;
-    size_t data_written           = 0;
-    size_t current_file_size      = 0;
-    int    current_file_fd        = -1;
-    char   err_msg[ERR_MSG_LENGTH];
+    query_log_loop_convert_fn convert = query_log_record_to_text;
 
-    /* Initialize admin channel on this thread(core). */
-    LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+    size_t   data_written = 0;
+    size_t   slowdown     = QUERY_LOG_LOOP_SLOWDOWN;
+    size_t   slowdown_max = QUERY_LOG_LOOP_SLOWDOWN_MAX;
+    uint64_t age_max      = (uint64_t)ql_args->cfg->query_log_age_max * 1000000;
+    uint64_t flushed      = query_log_loop_now();
+    bool     flush;
+    bool     stop         = false;
 
-    while (1)
+    if (age_max > 0 && age_max / 1000 < slowdown_max) {
+        slowdown_max = age_max / 1000 < QUERY_LOG_LOOP_SLOWDOWN ?
+                       QUERY_LOG_LOOP_SLOWDOWN : age_max / 1000;
+    }
+
+    if (ql_args->cfg->query_log_format == QUERY_LOG_FORMAT_DNSTAP) {
+        convert = query_log_record_to_dnstap;
+    } else if (ql_args->cfg->query_log_format == QUERY_LOG_FORMAT_ARROW) {
+        /* Records are accumulated in columns, not converted one by one. */
+        arrow = malloc(sizeof(query_log_arrow_t));
+        CHECK_MALLOC(arrow);
+        query_log_arrow_reset(arrow);
+    }
+
+    writer = aligned_alloc(CACHE_LINE_SIZE, sizeof(query_log_writer_t));
+    CHECK_MALLOC(writer);
+    query_log_writer_init(writer, ql_args->cfg, ql_args->writer_app_log_channel,
+                          ql_args->metrics);
+    if (pthread_create(&writer_thread, NULL, query_log_writer_loop, writer) != 0) {
+        fprintf(stderr, "Could not create query log writer thread\n");
+        exit(-1);
+    }
+
+    while (!stop)
     {
-        /* Is the query log file open for write. */
-        if (current_file_fd < 0) {
-            current_file_fd = query_log_loop_openfile(cfg, err_msg, ERR_MSG_LENGTH);
-            if (current_file_fd < 0) {
-                /* Error opening file! */
-                char              *log_err = strndup(err_msg, ERR_MSG_LENGTH);
-                channel_log_msg_t *log_msg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, log_err, false);
-
-                channel_log_send(ql_args->app_log_channel, log_msg);
-
-                atomic_fetch_add(&ql_args->metrics->app.query_log_open_error, 1);
-                usleep(QUERY_LOG_FILE_OPEN_RETRY_TIME);
-                continue;
-            } else {
-                current_file_size = 0;
-            }
-        }
+        /* Once stop is set, chunks published before it are all drained
+         * below.
+         */
+        stop = atomic_load_explicit(&ql_args->stop, memory_order_acquire);
 
-        /* Send channel message to each vectorloop to flip query log buffer
-         * and log the data in previous active buffer.
+        /* Drain chunks each vectorloop published. Vectorloops are drained
+         * independently and are never waited on.
          */
         data_written = 0;
-        for (int i = 0; i < query_log_channel_count; i++) {
-            /* Send flip message via channel. */
-            ch_msg = channel_bss_msg_create(channel_bss_assign_msg_id(&channel_msg_id_base),
-                                            CH_OP_QUERY_LOG_FLIP,
-                                            NULL);
-            channel_bss_send(&query_log_channels[i], ch_msg);
-
-            /* Wait for response. */
-            ch_msg = NULL;
-            waiting = true;
-            while (waiting) {
-                /* check if there is message on channel. */
-                if (channel_bssvl_recv(&query_log_channels[i], &ch_msg) == 1) {
-                    buf = ch_msg->p;
-                    buf_len = ch_msg->result;
-                    ch_msg->p = NULL;
-                    channel_bss_msg_release(ch_msg);
-                    waiting = false;
+        for (int i = 0; i < query_log_count; i++) {
+            while ((chunk = query_log_peek(query_logs[i])) != NULL) {
+                if (arrow != NULL) {
+                    data_written += query_log_loop_arrow(writer, arrow, chunk->buf, chunk->len);
                 } else {
-                    /* no message, wait some more. */
-                    usleep(QUERY_LOG_LOOP_MSG_WAIT_TIME);
+                    data_written += query_log_loop_convert(writer, convert, chunk->buf,
+                                                           chunk->len);
                 }
+
+                /* Hand chunk back to vectorloop. */
+                query_log_consume(query_logs[i]);
             }
+        }
 
-            /* Write data to disk. */
-            if (buf_len != 0) {
-                err_msg[0] = '\0';
-                if (utl_writeall(current_file_fd, buf, buf_len,
-                                 err_msg, ERR_MSG_LENGTH) != 0) {
-                    /* Could not write data to file. */
-
-                    debug_printf("Could not write data to file, %s", err_msg);
-                    /* Close file and */
-                    close(current_file_fd);
-                    current_file_fd = -1;
-                    break;
-                }
+        /* Hand text to writer thread. If there was no new data write out
+         * everything, there is nothing to wait for. Text held longer than
+         * query_log_age_max is written out as well.
+         */
+        flush = data_written == 0 || stop;
+        if (age_max > 0) {
+            uint64_t now = query_log_loop_now();
+
+            if (!flush) {
+                flush = now - flushed >= age_max;
             }
+            if (flush) {
+                flushed = now;
+            }
+        }
+        if (arrow != NULL && flush) {
+            /* Partial batch is encoded only when flushing. */
+            query_log_loop_arrow_flush(writer, arrow);
+        }
+        query_log_writer_buf_submit(writer, flush);
 
-            /* Check if latest write puts us over max file size limit. */
-            current_file_size += buf_len;
-            data_written += buf_len;
-            if (current_file_size >= ql_args->cfg->query_log_rotate_size) {
-                /* Rotate file. */
-                current_file_size = 0;
-                close(current_file_fd);
-                current_file_fd = -1;
-                current_file_fd = query_log_loop_openfile(cfg, err_msg, ERR_MSG_LENGTH);
-                if (current_file_fd < 0) {
-                    /* Error opening file! */
-                    char              *log_err = strndup(err_msg, ERR_MSG_LENGTH);
-                    channel_log_msg_t *log_msg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, log_err, false);
-                    
-                    channel_log_send(ql_args->app_log_channel, log_msg);
-                    
-                    atomic_fetch_add(&ql_args->metrics->app.query_log_open_error, 1);
-                    usleep(QUERY_LOG_FILE_OPEN_RETRY_TIME);
-                    break;
+        /* If amount of data written is 0 slow down the loop a bit, there is
+         * no data to log.
+         */
+        if (data_written == 0 && !stop) {
+            usleep(slowdown);
+            if (slowdown < slowdown_max) {
+                slowdown *= 2;
+                if (slowdown > slowdown_max) {
+                    slowdown = slowdown_max;
                 }
             }
+        } else {
+            slowdown = QUERY_LOG_LOOP_SLOWDOWN;
         }
+    }
 
-        /* If amount of data written is 0 slow down the loop a bit. */
-        if (data_written == 0) {
-            usleep(QUERY_LOG_LOOP_SLOWDOWN);
-        }
+    /* Text carried over with O_DIRECT waits for a free buffer. */
+    while (query_log_writer_buf_pending(writer)) {
+        usleep(QUERY_LOG_LOOP_SLOWDOWN);
+        query_log_writer_buf_submit(writer, true);
     }
-    
+
+    /* Have writer thread write out submitted buffers and exit. */
+    atomic_store_explicit(&writer->stop, true, memory_order_release);
+    eventfd_write(writer->wake_fd, 1);
+    pthread_join(writer_thread, NULL);
+    query_log_writer_clean(writer);
+    free(writer);
+    free(arrow);
+
     return NULL;
-}
\ No newline at end of file
+}
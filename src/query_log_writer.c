@@ -0,0 +1,938 @@
+/**
+ * @file query_log_writer.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_log_writer
+ *  @{
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <zlib.h>
+
+#include "channel.h"
+#include "config.h"
+#include "constants.h"
+#include "dnstap.h"
+#include "log_app.h"
+#include "metrics.h"
+#include "query_log_arrow.h"
+#include "query_log_writer.h"
+#include "utils.h"
+
+/** Initialize query log writer and allocate its buffers.
+ * 
+ * @note If eventfd or compression stream could not be created a message is
+ *       printed to stderr and assert called.
+ * 
+ * @param w               Query log writer to initialize.
+ * @param cfg             Configuration with settings to use.
+ * @param app_log_channel Channel writer thread sends application log messages
+ *                        on.
+ * @param metrics         Metrics object to report metrics to.
+ */
+void
+query_log_writer_init(query_log_writer_t *w, config_t *cfg,
+                      channel_log_t *app_log_channel, metrics_t *metrics)
+{
+    *w = (query_log_writer_t){
+        .cfg             = cfg,
+        .app_log_channel = app_log_channel,
+        .metrics         = metrics,
+        .buf_size        = QUERY_LOG_TEXT_BUF_SIZE,
+        .dnstap          = cfg->query_log_format == QUERY_LOG_FORMAT_DNSTAP,
+        .arrow           = cfg->query_log_format == QUERY_LOG_FORMAT_ARROW,
+        .remote          = cfg->query_log_remote_ip != NULL ||
+                           cfg->query_log_remote_unix != NULL,
+        .fd              = -1,
+        .next_fd         = -1,
+        .index_fd        = -1,
+        .pipe_fds        = { -1, -1 },
+    };
+    for (int i = 0; i < QUERY_LOG_WRITER_BUF_COUNT; i++) {
+        w->bufs[i].buf = aligned_alloc(QUERY_LOG_DIRECT_IO_ALIGN, w->buf_size);
+        CHECK_MALLOC(w->bufs[i].buf);
+    }
+    atomic_init(&w->head, 0);
+    atomic_init(&w->tail, 0);
+    atomic_init(&w->stop, false);
+
+    /* Dnstap collectors read uncompressed Frame Streams, O_DIRECT only applies
+     * to uncompressed text files. */
+    w->compress  = cfg->query_log_compress && !(w->dnstap && w->remote);
+    w->direct_io = cfg->query_log_direct_io && !w->compress && !w->remote &&
+                   !w->dnstap && !w->arrow;
+    w->index     = cfg->query_log_index && !w->remote && !w->dnstap && !w->arrow;
+    w->splice    = cfg->query_log_splice && !w->direct_io && !w->remote;
+
+    if (w->compress) {
+        /* Window bits + 16 writes gzip header and trailer. */
+        if (deflateInit2(&w->zs, QUERY_LOG_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            fprintf(stderr, "query_log_writer_init() could not initialize "
+                    "compression stream\n");
+            assert(0);
+        }
+        w->zbuf_size = deflateBound(&w->zs, w->buf_size);
+        w->zbuf      = malloc(w->zbuf_size);
+        CHECK_MALLOC(w->zbuf);
+    }
+
+    w->wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (w->wake_fd < 0) {
+        fprintf(stderr, "query_log_writer_init() err no %d, error message: %s\n",
+                errno, strerror(errno));
+        assert(0);
+    }
+}
+
+/** Close pipe buffers are spliced to file through, dropping data left in it.
+ * 
+ * @param w Query log writer.
+ */
+static void
+query_log_writer_pipe_close(query_log_writer_t *w)
+{
+    for (int i = 0; i < 2; i++) {
+        if (w->pipe_fds[i] > -1) {
+            close(w->pipe_fds[i]);
+            w->pipe_fds[i] = -1;
+        }
+    }
+}
+
+/** Release resources held by query log writer, writer it self is not freed.
+ * Writer thread MUST not be running.
+ * 
+ * @param w Query log writer to clean.
+ */
+void
+query_log_writer_clean(query_log_writer_t *w)
+{
+    for (int i = 0; i < QUERY_LOG_WRITER_BUF_COUNT; i++) {
+        free(w->bufs[i].buf);
+        w->bufs[i].buf = NULL;
+    }
+    if (w->compress) {
+        deflateEnd(&w->zs);
+        free(w->zbuf);
+        w->zbuf = NULL;
+    }
+    close(w->wake_fd);
+    if (w->fd > -1) {
+        close(w->fd);
+    }
+    if (w->next_fd > -1) {
+        close(w->next_fd);
+    }
+    if (w->index_fd > -1) {
+        close(w->index_fd);
+    }
+    query_log_writer_pipe_close(w);
+}
+
+/** Get buffer to write query log text to. Same buffer is returned until it is
+ * submitted with @ref query_log_writer_buf_submit. Only query log thread may
+ * call this function.
+ * 
+ * @param w Query log writer.
+ * 
+ * @return  Returns buffer to write text to, or NULL if all buffers are waiting
+ *          to be written to disk.
+ */
+query_log_writer_buf_t *
+query_log_writer_buf_get(query_log_writer_t *w)
+{
+    unsigned long long      head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    query_log_writer_buf_t *b    = &w->bufs[head % QUERY_LOG_WRITER_BUF_COUNT];
+
+    if (w->cur_open) {
+        return b;
+    }
+    if (head - atomic_load_explicit(&w->tail, memory_order_acquire) >= QUERY_LOG_WRITER_BUF_COUNT) {
+        return NULL;
+    }
+
+    /* Start buffer with text carried over from previous buffer. Queries in
+     * buffer are indexed from after it, offset is relative until written.
+     */
+    if (w->index) {
+        query_log_index_entry_reset(&b->index);
+        b->index.offset = w->carry_len;
+    }
+    memcpy(b->buf, w->carry, w->carry_len);
+    b->len       = w->carry_len;
+    w->carry_len = 0;
+    w->cur_open  = true;
+
+    return b;
+}
+
+/** Hand buffer being filled to writer thread. With O_DIRECT only whole blocks
+ * are handed over, remaining text is carried over to next buffer unless flush
+ * is set or file is to be rotated after buffer, in which case last block is
+ * padded with new lines. Flush hands over text carried over even if no buffer
+ * is being filled, as long as writer has a free buffer, see
+ * @ref query_log_writer_buf_pending. Empty buffer is not handed over. Only
+ * query log thread may call this function.
+ * 
+ * @param w     Query log writer.
+ * @param flush Set to hand over all text, even if it does not fill a block.
+ */
+void
+query_log_writer_buf_submit(query_log_writer_t *w, bool flush)
+{
+    unsigned long long      head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    query_log_writer_buf_t *b    = &w->bufs[head % QUERY_LOG_WRITER_BUF_COUNT];
+    bool                    rotate;
+
+    if (!w->cur_open && flush && w->carry_len > 0 &&
+        query_log_writer_buf_get(w) == NULL) {
+        return;
+    }
+    if (!w->cur_open || b->len == 0) {
+        return;
+    }
+
+    /* Queries in buffer are indexed with text carried over to next buffer,
+     * which is written right after it.
+     */
+    if (w->index) {
+        b->index.len = b->len - b->index.offset;
+    }
+
+    rotate = w->submitted + b->len >= w->cfg->query_log_rotate_size;
+    if (w->direct_io) {
+        size_t rem = b->len % QUERY_LOG_DIRECT_IO_ALIGN;
+
+        if (rem != 0) {
+            if (flush || rotate) {
+                /* Buffer ends with whole entry, keep it that way so entries
+                 * are not split between files. */
+                memset(b->buf + b->len, '\n', QUERY_LOG_DIRECT_IO_ALIGN - rem);
+                b->len += QUERY_LOG_DIRECT_IO_ALIGN - rem;
+            } else if (b->len < QUERY_LOG_DIRECT_IO_ALIGN) {
+                /* Not yet a whole block, keep filling this buffer. */
+                return;
+            } else {
+                b->len      -= rem;
+                w->carry_len = rem;
+                memcpy(w->carry, b->buf + b->len, rem);
+            }
+        }
+    }
+
+    b->rotate     = rotate;
+    w->submitted  = rotate ? 0 : w->submitted + b->len;
+    w->cur_open   = false;
+    atomic_store_explicit(&w->head, head + 1, memory_order_release);
+    eventfd_write(w->wake_fd, 1);
+}
+
+/** Check if query log thread holds text not handed to writer thread yet,
+ * text carried over with O_DIRECT. Only query log thread may call this
+ * function.
+ * 
+ * @param w Query log writer.
+ * 
+ * @return  Returns true if there is text a flush did not hand over for lack
+ *          of a free buffer.
+ */
+bool
+query_log_writer_buf_pending(query_log_writer_t *w)
+{
+    return w->carry_len > 0;
+}
+
+/** Compress data into a single gzip member in zbuf. Only writer thread may
+ * call this function.
+ * 
+ * @param w        Query log writer, MUST be initialized with compression.
+ * @param data     Data to compress.
+ * @param data_len Length of data, at most size of writer buffer.
+ * 
+ * @return         Returns length of compressed data in zbuf.
+ */
+size_t
+query_log_writer_compress(query_log_writer_t *w, const char *data, size_t data_len)
+{
+    deflateReset(&w->zs);
+    w->zs.next_in   = (Bytef *)data;
+    w->zs.avail_in  = data_len;
+    w->zs.next_out  = (Bytef *)w->zbuf;
+    w->zs.avail_out = w->zbuf_size;
+
+    /* zbuf is sized with deflateBound(), whole buffer fits in one call. */
+    deflate(&w->zs, Z_FINISH);
+
+    return w->zs.total_out;
+}
+
+/** Send error message to application log.
+ * 
+ * @param w       Query log writer.
+ * @param err_msg Error message.
+ */
+static void
+query_log_writer_log_error(query_log_writer_t *w, char *err_msg)
+{
+    channel_log_send(w->app_log_channel, APP_LOG_MSG_CUSTOM, false, "%s", err_msg);
+}
+
+/** Open query log file for write. If O_DIRECT is requested but file system
+ * does not support it, file is opened without it.
+ * 
+ * @param w           Query log writer.
+ * @param filename    Name of file to open.
+ * @param flags       Flags to add to O_CREAT|O_WRONLY|O_APPEND.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ *
+ * @return            On success return file descriptor, otherwise error
+ *                    occurred and -1 is returned in which case error message
+ *                    in populated in err_mgs buffer.
+ */
+static int
+query_log_writer_openfile(query_log_writer_t *w, char *filename, int flags,
+                          char *err_msg, size_t err_msg_len)
+{
+    int fd;
+
+    /* Splice refuses files opened with O_APPEND, writer is only writer of
+     * file so it seeks to end once file is opened instead. */
+    flags |= O_CREAT|O_WRONLY|(w->splice ? 0 : O_APPEND);
+    if (w->direct_io) {
+        fd = open(filename, flags|O_DIRECT, 00777);
+        if (fd > -1 || errno != EINVAL) {
+            goto done;
+        }
+        /* File system does not support O_DIRECT, writes are still block
+         * aligned so they work just as well without it. */
+        snprintf(err_msg, err_msg_len, "Query log file %s does not support "
+                 "O_DIRECT, writing without it", filename);
+        query_log_writer_log_error(w, err_msg);
+    }
+    fd = open(filename, flags, 00777);
+    if (fd > -1 && w->splice && lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        fd = -1;
+    }
+
+done:
+    if (fd < 0) {
+        /* Error opening file! */
+        snprintf(err_msg, err_msg_len, "Error opening query log file %s, %s",
+                 filename, strerror(errno));
+        debug_printf("%s", err_msg);
+    } else {
+        debug_printf("Query log file %s opened for append writes, fd: %d",
+                     filename, fd);
+    }
+    return fd;
+}
+
+/** Create name of query log file from current time.
+ * 
+ * @param cfg      Configuration with settings to use.
+ * @param filename Buffer of @ref QUERY_LOG_FILENAME_MAX_LEN to store name in.
+ */
+static void
+query_log_writer_filename(config_t *cfg, char *filename)
+{
+    struct timespec ts;
+    char            current_time_str[TIME_RFC3339_STRLEN];
+
+    utl_clock_gettime_rt_fatal(&ts);
+    utl_timespec_to_rfc3339nano(&ts, current_time_str);
+    snprintf(filename, QUERY_LOG_FILENAME_MAX_LEN, "%s/%s_%s%s",
+             cfg->query_log_realpath, cfg->query_log_base_name, current_time_str,
+             cfg->query_log_compress ? QUERY_LOG_GZIP_SUFFIX : "");
+}
+
+/** Connect to remote query log collector, over TCP or Unix socket.
+ * 
+ * @param cfg         Configuration with settings to use.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns connected socket, otherwise error
+ *                    occurred and -1 is returned in which case error message
+ *                    in populated in err_mgs buffer.
+ */
+static int
+query_log_writer_connect(config_t *cfg, char *err_msg, size_t err_msg_len)
+{
+    struct sockaddr_storage  ss  = { };
+    struct sockaddr_in      *sa4 = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6     *sa6 = (struct sockaddr_in6 *)&ss;
+    struct sockaddr_un      *sun = (struct sockaddr_un *)&ss;
+    socklen_t                slen;
+    int                      fd;
+    char                     peer[QUERY_LOG_FILENAME_MAX_LEN];
+
+    if (cfg->query_log_remote_unix != NULL) {
+        /* Path length was validated when configuration was parsed. */
+        sun->sun_family = AF_UNIX;
+        strcpy(sun->sun_path, cfg->query_log_remote_unix);
+        slen = sizeof(struct sockaddr_un);
+        snprintf(peer, sizeof(peer), "%s", cfg->query_log_remote_unix);
+    } else if (inet_pton(AF_INET, cfg->query_log_remote_ip, &sa4->sin_addr) == 1) {
+        sa4->sin_family = AF_INET;
+        sa4->sin_port   = htons(cfg->query_log_remote_port);
+        slen            = sizeof(struct sockaddr_in);
+        snprintf(peer, sizeof(peer), "%s port %u", cfg->query_log_remote_ip,
+                 cfg->query_log_remote_port);
+    } else {
+        /* Address was validated as IPv4 or IPv6 when configuration was parsed. */
+        inet_pton(AF_INET6, cfg->query_log_remote_ip, &sa6->sin6_addr);
+        sa6->sin6_family = AF_INET6;
+        sa6->sin6_port   = htons(cfg->query_log_remote_port);
+        slen             = sizeof(struct sockaddr_in6);
+        snprintf(peer, sizeof(peer), "%s port %u", cfg->query_log_remote_ip,
+                 cfg->query_log_remote_port);
+    }
+
+    fd = socket(ss.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd > -1 && connect(fd, (struct sockaddr *)&ss, slen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        snprintf(err_msg, err_msg_len, "Error connecting to query log collector "
+                 "%s, %s", peer, strerror(errno));
+        debug_printf("%s", err_msg);
+    } else {
+        debug_printf("Connected to query log collector %s, fd: %d", peer, fd);
+    }
+    return fd;
+}
+
+/** Send all data to remote query log collector. MSG_NOSIGNAL is used so
+ * connection closed by collector is reported as EPIPE error instead of raising
+ * SIGPIPE.
+ * 
+ * @param fd          Socket connected to collector.
+ * @param buf         Data to send.
+ * @param buf_len     Length of data in buf.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+static int
+query_log_writer_sendall(int fd, char *buf, size_t buf_len, char *err_msg,
+                         size_t err_msg_len)
+{
+    size_t  sent = 0;
+    ssize_t ret;
+
+    while (sent < buf_len) {
+        ret = send(fd, buf + sent, buf_len - sent, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            snprintf(err_msg, err_msg_len, "Error sending to query log collector, %s",
+                     ret == 0 ? "unknown error" : strerror(errno));
+            return -1;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+
+/** Write data to file by mapping it into a pipe with vmsplice and splicing
+ * pipe to file, so pages of data are not copied into a pipe or socket buffer
+ * on the way. Pages are only referenced by pipe until they are spliced, so
+ * pipe is drained before each next vmsplice and before function returns, and
+ * data can be reused once function returns. Pipe is created on first write.
+ * If kernel or file system does not support splicing, error is logged,
+ * splice is turned off and data not yet written is written with write.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor of file to write to, not opened with
+ *                    O_APPEND.
+ * @param data        Data to write.
+ * @param data_len    Length of data.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+int
+query_log_writer_splice(query_log_writer_t *w, int fd, char *data, size_t data_len,
+                        char *err_msg, size_t err_msg_len)
+{
+    struct iovec iov;
+    size_t       done = 0;
+    ssize_t      mapped;
+    ssize_t      ret;
+
+    if (w->pipe_fds[0] < 0) {
+        if (pipe2(w->pipe_fds, O_CLOEXEC) != 0) {
+            w->pipe_fds[0] = -1;
+            w->pipe_fds[1] = -1;
+            goto fallback;
+        }
+        /* Whole buffer fits in one vmsplice if pipe can be grown to it. */
+        fcntl(w->pipe_fds[1], F_SETPIPE_SZ, (int)w->buf_size);
+    }
+
+    while (done < data_len) {
+        iov.iov_base = data + done;
+        iov.iov_len  = data_len - done;
+        mapped = vmsplice(w->pipe_fds[1], &iov, 1, 0);
+        if (mapped < 0 && errno == EINTR) {
+            continue;
+        }
+        if (mapped <= 0) {
+            goto fallback;
+        }
+        while (mapped > 0) {
+            ret = splice(w->pipe_fds[0], NULL, fd, NULL, mapped, SPLICE_F_MOVE);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                /* Bytes left in pipe are written again with write. */
+                goto fallback;
+            }
+            if (ret <= 0) {
+                snprintf(err_msg, err_msg_len, "Error splicing to query log file, %s",
+                         ret == 0 ? "unknown error" : strerror(errno));
+                query_log_writer_pipe_close(w);
+                return -1;
+            }
+            done   += ret;
+            mapped -= ret;
+        }
+    }
+    return 0;
+
+fallback:
+    snprintf(err_msg, err_msg_len, "Query log file can not be written with "
+             "splice, %s, writing with write", strerror(errno));
+    query_log_writer_log_error(w, err_msg);
+    err_msg[0] = '\0';
+    query_log_writer_pipe_close(w);
+    w->splice = false;
+    return utl_writeall(fd, data + done, data_len - done, err_msg, err_msg_len);
+}
+
+/** Write data to query log file or remote collector, compressing it first
+ * if compression is set.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor to write to.
+ * @param data        Data to write.
+ * @param data_len    Length of data, at most size of writer buffer.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+static int
+query_log_writer_write(query_log_writer_t *w, int fd, char *data, size_t data_len,
+                       char *err_msg, size_t err_msg_len)
+{
+    if (w->compress) {
+        data_len = query_log_writer_compress(w, data, data_len);
+        data     = w->zbuf;
+    }
+    if (w->remote) {
+        return query_log_writer_sendall(fd, data, data_len, err_msg, err_msg_len);
+    }
+    if (w->splice) {
+        return query_log_writer_splice(w, fd, data, data_len, err_msg, err_msg_len);
+    }
+    return utl_writeall(fd, data, data_len, err_msg, err_msg_len);
+}
+
+/** Open index file of query log file being written, replacing index file
+ * left open for previous query log file. Error is logged and query log file
+ * is then written without index.
+ * 
+ * @param w        Query log writer.
+ * @param filename Name of query log file being written.
+ */
+static void
+query_log_writer_index_open(query_log_writer_t *w, const char *filename)
+{
+    char                     path[QUERY_LOG_FILENAME_MAX_LEN + sizeof(QUERY_LOG_INDEX_SUFFIX)];
+    char                     err_msg[ERR_MSG_LENGTH];
+    query_log_index_header_t hdr;
+
+    if (w->index_fd > -1) {
+        close(w->index_fd);
+    }
+    w->offset = 0;
+
+    snprintf(path, sizeof(path), "%s%s", filename, QUERY_LOG_INDEX_SUFFIX);
+    w->index_fd = open(path, O_CREAT|O_WRONLY|O_TRUNC|O_CLOEXEC, 00644);
+    if (w->index_fd < 0) {
+        snprintf(err_msg, ERR_MSG_LENGTH, "Error opening index of query log file %s, %s",
+                 filename, strerror(errno));
+        query_log_writer_log_error(w, err_msg);
+        return;
+    }
+
+    query_log_index_header_init(&hdr, w->compress);
+    if (utl_writeall(w->index_fd, (char *)&hdr, sizeof(hdr), err_msg, ERR_MSG_LENGTH) != 0) {
+        query_log_writer_log_error(w, err_msg);
+        close(w->index_fd);
+        w->index_fd = -1;
+    }
+}
+
+/** Append index entry of buffer just written to query log file to index
+ * file. Entry of uncompressed buffer spans text of its queries, starting
+ * after text carried over from previous buffer and ending with text carried
+ * over to next buffer, so it always holds whole lines. Entry of compressed
+ * buffer spans gzip member buffer was written as. Buffers with no queries in
+ * them (only padding or text carried over with O_DIRECT) are not indexed.
+ * 
+ * @param w Query log writer.
+ * @param b Buffer written.
+ */
+static void
+query_log_writer_index_add(query_log_writer_t *w, query_log_writer_buf_t *b)
+{
+    char err_msg[ERR_MSG_LENGTH];
+
+    if (w->compress) {
+        b->index.offset = w->offset;
+        b->index.len    = w->zs.total_out;
+        w->offset      += w->zs.total_out;
+    } else {
+        b->index.offset += w->offset;
+        w->offset       += b->len;
+    }
+    if (w->index_fd < 0 || b->index.records == 0) {
+        return;
+    }
+    if (utl_writeall(w->index_fd, (char *)&b->index, sizeof(b->index),
+                     err_msg, ERR_MSG_LENGTH) != 0) {
+        query_log_writer_log_error(w, err_msg);
+        close(w->index_fd);
+        w->index_fd = -1;
+    }
+}
+
+/** Write Frame Streams control frame to query log file or remote collector.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor to write to.
+ * @param type        Control frame type.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+static int
+query_log_writer_dnstap_control(query_log_writer_t *w, int fd,
+                                dnstap_fstrm_control_t type, char *err_msg,
+                                size_t err_msg_len)
+{
+    char   frame[DNSTAP_FSTRM_CONTROL_MAX];
+    size_t len = dnstap_control_frame(frame, type, type != DNSTAP_FSTRM_CONTROL_STOP);
+
+    return query_log_writer_write(w, fd, frame, len, err_msg, err_msg_len);
+}
+
+/** Start Frame Streams stream on newly opened query log file or connection
+ * to remote collector. With remote collector bidirectional handshake is done:
+ * READY is sent, ACCEPT is waited for, then START is sent.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor of file or connection.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+static int
+query_log_writer_dnstap_start(query_log_writer_t *w, int fd, char *err_msg,
+                              size_t err_msg_len)
+{
+    char           frame[DNSTAP_FSTRM_CONTROL_MAX];
+    size_t         len = 0;
+    uint32_t       frame_len = 0;
+    ssize_t        ret;
+    struct timeval tv  = { .tv_sec = QUERY_LOG_REMOTE_HANDSHAKE_TIMEOUT };
+
+    if (w->remote) {
+        if (query_log_writer_dnstap_control(w, fd, DNSTAP_FSTRM_CONTROL_READY,
+                                            err_msg, err_msg_len) != 0) {
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        /* Read escape sequence and length, then rest of ACCEPT frame. */
+        while (len < 8 || len < 8 + frame_len) {
+            ret = recv(fd, frame + len, (len < 8 ? 8 : 8 + frame_len) - len, 0);
+            if (ret <= 0) {
+                snprintf(err_msg, err_msg_len, "Error reading Frame Streams "
+                         "ACCEPT from query log collector, %s",
+                         ret == 0 ? "connection closed" : strerror(errno));
+                return -1;
+            }
+            len += ret;
+            if (len == 8) {
+                memcpy(&frame_len, frame + 4, 4);
+                frame_len = ntohl(frame_len);
+                if (frame_len > DNSTAP_FSTRM_CONTROL_MAX - 8) {
+                    break;
+                }
+            }
+        }
+        if (dnstap_control_frame_type(frame, len) != DNSTAP_FSTRM_CONTROL_ACCEPT) {
+            snprintf(err_msg, err_msg_len, "Query log collector did not accept "
+                     "Frame Streams content type %s", DNSTAP_CONTENT_TYPE);
+            return -1;
+        }
+    }
+    return query_log_writer_dnstap_control(w, fd, DNSTAP_FSTRM_CONTROL_START,
+                                           err_msg, err_msg_len);
+}
+
+/** Start stream of query log format on newly opened query log file or
+ * connection to remote collector: dnstap Frame Streams START, or Arrow IPC
+ * Schema message. Text needs no start.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor of file or connection.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ * 
+ * @return            On success returns 0, otherwise error occurred, error
+ *                    message is populated and -1 is returned.
+ */
+static int
+query_log_writer_stream_start(query_log_writer_t *w, int fd, char *err_msg,
+                              size_t err_msg_len)
+{
+    char schema[QUERY_LOG_ARROW_SCHEMA_MAX];
+
+    if (w->dnstap) {
+        return query_log_writer_dnstap_start(w, fd, err_msg, err_msg_len);
+    }
+    if (w->arrow) {
+        return query_log_writer_write(w, fd, schema,
+                                      query_log_arrow_schema(schema, sizeof(schema)),
+                                      err_msg, err_msg_len);
+    }
+    return 0;
+}
+
+/** End stream of query log format before query log file is closed: dnstap
+ * Frame Streams STOP, or Arrow IPC end-of-stream marker. Error is of no
+ * consequence, file is closed either way.
+ * 
+ * @param w           Query log writer.
+ * @param fd          File descriptor of file or connection.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ */
+static void
+query_log_writer_stream_end(query_log_writer_t *w, int fd, char *err_msg,
+                            size_t err_msg_len)
+{
+    char eos[QUERY_LOG_ARROW_EOS_LEN];
+
+    if (w->dnstap) {
+        query_log_writer_dnstap_control(w, fd, DNSTAP_FSTRM_CONTROL_STOP,
+                                        err_msg, err_msg_len);
+    } else if (w->arrow) {
+        query_log_writer_write(w, fd, eos, query_log_arrow_eos(eos),
+                               err_msg, err_msg_len);
+    }
+}
+
+/** Switch to query log file opened ahead of time and give it a name from
+ * current time. If there is no file opened ahead current file is closed and
+ * new one is opened in next writer loop iteration.
+ * 
+ * @param w           Query log writer.
+ * @param err_msg     Buffer to populate error message if error is one encountered.
+ * @param err_msg_len Length (in bytes) of err_msg buffer.
+ */
+static void
+query_log_writer_rotate(query_log_writer_t *w, char *err_msg, size_t err_msg_len)
+{
+    char filename[QUERY_LOG_FILENAME_MAX_LEN];
+
+    query_log_writer_stream_end(w, w->fd, err_msg, err_msg_len);
+    close(w->fd);
+    w->fd      = w->next_fd;
+    w->next_fd = -1;
+    if (w->fd < 0) {
+        return;
+    }
+
+    query_log_writer_filename(w->cfg, filename);
+    if (rename(w->next_filename, filename) != 0) {
+        snprintf(err_msg, err_msg_len, "Error renaming query log file %s to %s, %s",
+                 w->next_filename, filename, strerror(errno));
+        query_log_writer_log_error(w, err_msg);
+    }
+    if (w->index) {
+        query_log_writer_index_open(w, filename);
+    }
+}
+
+/** Function writes query log buffers query log thread submits to disk, and
+ * rotates query log files. Once stop is set, buffers submitted are written
+ * out and function returns. This function is meant to run in its own
+ * dedicated thread.
+ * 
+ * @param args Query log writer to run.
+ * 
+ * @return     Returns NULL just to abide by the pthread API.
+ */
+void *
+query_log_writer_loop(void *args)
+{
+    query_log_writer_t     *w = (query_log_writer_t *)args;
+    query_log_writer_buf_t *b;
+    unsigned long long      tail;
+    int                     ret;
+    eventfd_t               value;
+    char                    filename[QUERY_LOG_FILENAME_MAX_LEN];
+    char                    err_msg[ERR_MSG_LENGTH];
+    bool                    stop;
+
+    snprintf(w->next_filename, QUERY_LOG_FILENAME_MAX_LEN, "%s/.%s_next",
+             w->cfg->query_log_realpath, w->cfg->query_log_base_name);
+
+    while (1)
+    {
+        /* Once stop is set, all buffers were submitted before it. */
+        stop = atomic_load_explicit(&w->stop, memory_order_acquire);
+
+        /* Is the query log file open for write. */
+        if (w->fd < 0) {
+            if (w->remote) {
+                w->fd = query_log_writer_connect(w->cfg, err_msg, ERR_MSG_LENGTH);
+            } else {
+                query_log_writer_filename(w->cfg, filename);
+                w->fd = query_log_writer_openfile(w, filename, 0, err_msg, ERR_MSG_LENGTH);
+            }
+            if (w->fd > -1 &&
+                query_log_writer_stream_start(w, w->fd, err_msg, ERR_MSG_LENGTH) != 0) {
+                close(w->fd);
+                w->fd = -1;
+            }
+            if (w->fd < 0) {
+                query_log_writer_log_error(w, err_msg);
+                atomic_fetch_add(&w->metrics->app.query_log_open_error, 1);
+                if (stop) {
+                    /* Buffers left can not be written. */
+                    break;
+                }
+                usleep(QUERY_LOG_FILE_OPEN_RETRY_TIME);
+                continue;
+            }
+            if (w->index) {
+                query_log_writer_index_open(w, filename);
+            }
+        }
+
+        /* Open next file ahead of time so rotation does not wait on it. */
+        if (!w->remote && w->next_fd < 0) {
+            w->next_fd = query_log_writer_openfile(w, w->next_filename, O_TRUNC,
+                                                   err_msg, ERR_MSG_LENGTH);
+            if (w->next_fd > -1 &&
+                query_log_writer_stream_start(w, w->next_fd, err_msg, ERR_MSG_LENGTH) != 0) {
+                close(w->next_fd);
+                w->next_fd = -1;
+            }
+            if (w->next_fd < 0) {
+                query_log_writer_log_error(w, err_msg);
+                atomic_fetch_add(&w->metrics->app.query_log_open_error, 1);
+            }
+        }
+
+        /* Write submitted buffers. */
+        tail = atomic_load_explicit(&w->tail, memory_order_relaxed);
+        while (w->fd > -1 && tail != atomic_load_explicit(&w->head, memory_order_acquire)) {
+            b = &w->bufs[tail % QUERY_LOG_WRITER_BUF_COUNT];
+            err_msg[0] = '\0';
+            ret = query_log_writer_write(w, w->fd, b->buf, b->len, err_msg, ERR_MSG_LENGTH);
+            if (ret != 0) {
+                /* Could not write data to file. */
+                debug_printf("Could not write data to file, %s", err_msg);
+                /* Close file and reopen it in next loop iteration. */
+                close(w->fd);
+                w->fd = -1;
+            } else {
+                if (w->index) {
+                    query_log_writer_index_add(w, b);
+                }
+                if (b->rotate && !w->remote) {
+                    /* Latest write puts us over max file size limit. */
+                    query_log_writer_rotate(w, err_msg, ERR_MSG_LENGTH);
+                }
+            }
+
+            /* Hand buffer back to query log thread. */
+            tail++;
+            atomic_store_explicit(&w->tail, tail, memory_order_release);
+        }
+
+        /* Wait for buffers to be submitted. */
+        if (w->fd > -1 && tail == atomic_load_explicit(&w->head, memory_order_acquire)) {
+            if (stop) {
+                break;
+            }
+            eventfd_read(w->wake_fd, &value);
+        }
+    }
+
+    /* End Frame Streams or Arrow IPC stream, as on rotation. */
+    if (w->fd > -1) {
+        query_log_writer_stream_end(w, w->fd, err_msg, ERR_MSG_LENGTH);
+    }
+
+    return NULL;
+}
+
+/** @}*/
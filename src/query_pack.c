@@ -32,7 +32,83 @@
 #include "rip_ns_utils.h"
 #include "rr_record.h"
 
-/** Pack EDNS and it extensions into buffer.
+/** Get length of EDNS OPT RR, and its extensions, @ref query_pack_edns()
+ * packs.
+ *
+ * @param edns     EDNS object to get packed length of.
+ * @param cs_ip_len Set to length of client subnet address packed, if client
+ *                 subnet extension is packed. Can be NULL.
+ *
+ * @return         Returns length in bytes, 0 if edns object does not contain
+ *                 valid data.
+ */
+static int
+query_edns_len(const edns_t *edns, uint8_t *cs_ip_len)
+{
+    int     opts_len = 1 + RIP_NS_RRFIXEDSZ; /* EDNS header */
+    uint8_t ip_len   = 0;
+
+    if (!edns->edns_valid) {
+        return 0;
+    }
+    if (edns->client_subnet.edns_cs_valid) {
+        /* Length needed for client subnet extension. */
+        ip_len = (edns->client_subnet.source_mask + 7) / 8;
+        opts_len += 4 + 4 + ip_len;
+    }
+    if (cs_ip_len != NULL) {
+        *cs_ip_len = ip_len;
+    }
+    return opts_len;
+}
+
+/** EDNS OPT RR with no options (name, type, UDP payload size, extended rcode,
+ * version, flags, rdata length), one per DO bit value. UDP payload size,
+ * extended rcode and rdata length are patched in by @ref query_pack_edns().
+ */
+static const unsigned char query_edns_opt_templates[2][1 + RIP_NS_RRFIXEDSZ] = {
+    { 0, rip_ns_t_opt >> 8, rip_ns_t_opt & 0xff, 0, 0, 0, 0, 0x00, 0, 0, 0 },
+    { 0, rip_ns_t_opt >> 8, rip_ns_t_opt & 0xff, 0, 0, 0, 0, 0x80, 0, 0, 0 },
+};
+
+/** Pack EDNS client subnet option (option header, family, source and scope
+ * mask, address) into buffer.
+ *
+ * @param buf       Buffer to pack option into, MUST have room for it.
+ * @param cs        Client subnet to pack.
+ * @param cs_ip_len Length of client subnet address to pack.
+ *
+ * @return          Returns number of bytes packed.
+ */
+static int
+query_pack_edns_cs(uint8_t *buf, edns_client_subnet_t *cs, uint8_t cs_ip_len)
+{
+    const struct sockaddr_storage *ip    = query_edns_cs_ip(cs);
+    const uint8_t                 *cs_ip = NULL;
+
+    if (cs->family == 1) {
+        /* IPv4 */
+        cs_ip = (const uint8_t *)&((const struct sockaddr_in *)ip)->sin_addr.s_addr;
+    } else {
+        cs_ip = (const uint8_t *)&((const struct sockaddr_in6 *)ip)->sin6_addr;
+    }
+    /* Pack EDNS opt header (opt code and opt length) */
+    RIP_NS_PUT16(rip_ns_ext_opt_c_cs, buf);
+    RIP_NS_PUT16(4 + cs_ip_len, buf);
+
+    /* Pack client subnet (family, source mask, scope mask, ip)*/
+    RIP_NS_PUT16(cs->family, buf);
+    buf[0] = cs->source_mask;
+    buf[1] = cs->scope_mask;
+    memcpy(buf + 2, cs_ip, cs_ip_len);
+
+    return 4 + 4 + cs_ip_len;
+}
+
+/** Pack EDNS and it extensions into buffer. OPT RR is copied from template
+ * matching DO bit, with UDP payload size, extended rcode and rdata length
+ * patched in, and client subnet option appended. Cookie and TCP keepalive
+ * options are appended later, see @ref query_response_pack_opt().
  * 
  * @param buf     Buffer to pack EDNS and extensions into.
  * @param buf_len Length in bytes of available space in buffer.
@@ -46,74 +122,25 @@
  */
 int
 query_pack_edns(uint8_t *buf, uint16_t buf_len, edns_t *edns) {
-    uint16_t opts_len = 0;
-
-    uint8_t cs_opt_len = 0;
     uint8_t cs_ip_len  = 0;
-    
-    if (!edns->edns_valid) {
-        return 0;
-    }
-
-    /* Is there enough room to pack EDNS and its extensions. */
-    opts_len += 1 + RIP_NS_RRFIXEDSZ; /* EDNS header */
+    int     opts_len   = query_edns_len(edns, &cs_ip_len);
 
-    if (edns->client_subnet.edns_cs_valid) {
-        /* Length needed for client subnet extension. */
-        cs_ip_len = edns->client_subnet.source_mask / 8;
-        uint8_t r = edns->client_subnet.source_mask % 8;
-        if (r > 0) {
-            cs_ip_len += 1;
-        }
-        cs_opt_len = 4 + cs_ip_len;
-        opts_len += 4 + cs_opt_len;
+    if (opts_len == 0) {
+        return 0;
     }
-
     if (buf_len < opts_len) {
         /* Not enough room to pack edns. */
         return -1;
     }
 
-    /* Pack EDNS (name, option code, udp resp. len, extended rcode,
-     *            version, DO bit, rdata len).
-     */
-    *buf = 0;
-    buf += 1;
-    RIP_NS_PUT16(rip_ns_t_opt, buf);
-    RIP_NS_PUT16(edns->udp_resp_len, buf);
-    *buf = edns->extended_rcode;
-    buf += 1;
-    *buf = 0;
-    buf += 1;
-    *buf  = edns->dnssec << 7;
-    buf += 1;
-    *buf = 0;
-    buf += 1;
-    RIP_NS_PUT16((opts_len - 1 - RIP_NS_RRFIXEDSZ) , buf);
-
-    /* Pack client subnet. */
+    memcpy(buf, query_edns_opt_templates[edns->dnssec],
+           sizeof(query_edns_opt_templates[0]));
+    buf[3] = edns->udp_resp_len >> 8;
+    buf[4] = edns->udp_resp_len & 0xff;
+    buf[5] = edns->extended_rcode;
     if (edns->client_subnet.edns_cs_valid) {
-        uint8_t *cs_ip = NULL;
-
-        if (edns->client_subnet.family == 1) {
-            /* IPv4 */
-            struct sockaddr_in *sin = (struct sockaddr_in *)&edns->client_subnet.ip;
-            cs_ip = (uint8_t *)&sin->sin_addr.s_addr;
-        } else {
-            struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&edns->client_subnet.ip;
-            cs_ip = (uint8_t *)&sin6->sin6_addr;
-        }
-        /* Pack EDNS opt header (opt code and opt length) */
-        RIP_NS_PUT16(rip_ns_ext_opt_c_cs, buf);
-        RIP_NS_PUT16(cs_opt_len, buf);
-
-        /* Pack client subnet (family, source mask, scope mask, ip)*/
-        RIP_NS_PUT16(edns->client_subnet.family, buf);
-        *buf = edns->client_subnet.source_mask;
-        buf += 1;
-        *buf = edns->client_subnet.scope_mask;
-        buf += 1;
-        memcpy(buf, cs_ip, cs_ip_len);
+        rip_ns_put16(buf + RIP_NS_RRFIXEDSZ - 1, opts_len - 1 - RIP_NS_RRFIXEDSZ);
+        query_pack_edns_cs(buf + 1 + RIP_NS_RRFIXEDSZ, &edns->client_subnet, cs_ip_len);
     }
 
     return opts_len;
@@ -126,9 +153,7 @@ query_pack_edns(uint8_t *buf, uint16_t buf_len, edns_t *edns) {
  * @param rr        Resource record to pack.
  * @param buf       Buffer into which to pack the record.
  * @param buf_len   Length (in bytes) of available space in buffer.
- * @param dnptrs    Pointer to first entry in domain name array used to track
- *                  names already packed.
- * @param lastdnptr Last entry in domain name array.
+ * @param comp      Name compression table of names already packed.
  *
  * @return          On success returns number of bytes packed into buffer,
  *                  Otherwise error occurred. Currently error can occur if
@@ -136,16 +161,16 @@ query_pack_edns(uint8_t *buf, uint16_t buf_len, edns_t *edns) {
  */
 int
 query_pack_rr(const unsigned char *name, rr_record_t *rr, unsigned char *buf, uint16_t buf_len,
-              const unsigned char **dnptrs, const unsigned char **lastdnptr)
+              rip_ns_comp_t *comp)
 {
     int packed_name_len = 0;
     int packed_len      = 0;
 
     /* pack name */
     if (name != NULL) {
-        packed_name_len = rip_ns_name_put(name, buf, buf_len, dnptrs, lastdnptr);
+        packed_name_len = rip_ns_name_put(name, buf, buf_len, comp);
     } else {
-        packed_name_len = rip_ns_name_put(rr->name, buf, buf_len, dnptrs, lastdnptr);
+        packed_name_len = rip_ns_name_put(rr->name, buf, buf_len, comp);
     }
     if (packed_name_len < 0) {
         /* Not enough space in buf to pack RR name. */
@@ -178,56 +203,320 @@ query_pack_rr(const unsigned char *name, rr_record_t *rr, unsigned char *buf, ui
 }
 
 
-/** Pack query response into query response buffer.
- * 
- * @param q Query to pack response for
- * 
- * @return  Returns 0 on success otherwise error occurred:
- *          -1 indicates that there was not enough room to pack full response
- *             and response is truncated.
+/** Check if response with precompiled RRset response fragment is known to fit
+ * into maximum response length, from response size classes fragment was
+ * flagged to fit into when it was compiled.
+ *
+ * @param rrset    RRset with precompiled response fragment.
+ * @param size_max Maximum response length, at least @ref RIP_NS_PACKETSZ.
+ *
+ * @return         Returns true if response fits, false if it is not known to
+ *                 fit and its length needs to be checked.
  */
-int
-query_response_pack(query_t *q)
+static inline bool
+query_response_template_fits(const zone_rrset_t *rrset, size_t size_max)
 {
+    return (rrset->wire_fits & ZONE_RRSET_FITS_PACKETSZ) ||
+           ((rrset->wire_fits & ZONE_RRSET_FITS_EDNS) && size_max >= DNS_RESPONSE_SIZE_EDNS) ||
+           ((rrset->wire_fits & ZONE_RRSET_FITS_UDP_MAXMSG) && size_max >= RIP_NS_UDP_MAXMSG);
+}
 
+/** Pack response from precompiled RRset response fragment. Request question
+ * is copied as is, followed by fragment and EDNS. Response header is expected
+ * to be already packed except for section counts. If full fragment does not
+ * fit, fragment is cut to its answer section records, dropping additional
+ * section records.
+ *
+ * @param q        Query to pack response for, q->response_rrset must be set.
+ * @param size_max Maximum response length.
+ * @param minimal  Set to true if additional section records were dropped.
+ *
+ * @return         Returns length of packed response (including header), or -1
+ *                 if response does not fit even with additional section
+ *                 records dropped in which case response buffer past header
+ *                 is left untouched.
+ */
+static int
+query_response_pack_template(query_t *q, size_t size_max, bool *minimal)
+{
+    rip_ns_header_t *resp_hdr = q->response_hdr;
+    zone_rrset_t    *rrset    = q->response_rrset;
+    unsigned char   *buf      = (unsigned char *)resp_hdr + sizeof(rip_ns_header_t);
+    size_t           len      = sizeof(rip_ns_header_t) + q->query_question_len;
+    int              edns_len = query_edns_len(&q->edns, NULL);
+    uint16_t         wire_len = rrset->wire_len;
+    uint16_t         arcount  = rrset->wire_arcount;
+    int              pack_len = 0;
+
+    if (!query_response_template_fits(rrset, size_max) &&
+        len + wire_len + edns_len > size_max) {
+        /* Drop additional section records. */
+        wire_len = rrset->wire_an_len;
+        arcount  = 0;
+        if (len + wire_len + edns_len > size_max) {
+            return -1;
+        }
+        *minimal = true;
+    }
+    if (!query_response_in_place(q)) {
+        memcpy(buf, (unsigned char *)q->request_hdr + sizeof(rip_ns_header_t),
+               q->query_question_len);
+    }
+    buf += q->query_question_len;
+    memcpy(buf, rrset->wire, wire_len);
+    buf += wire_len;
+    len += wire_len;
+
+    pack_len = query_pack_edns(buf, size_max - len, &q->edns);
+    if (pack_len < 0) {
+        return -1;
+    }
+    if (pack_len > 0) {
+        q->response_edns_offset = len;
+    }
+
+    resp_hdr->qdcount = htons(1);
+    resp_hdr->ancount = htons(rrset->wire_ancount);
+    resp_hdr->arcount = htons(arcount + (pack_len > 0 ? 1 : 0));
+
+    return len + pack_len;
+}
+
+/** Pack negative response (NXDOMAIN or NODATA) from precompiled negative
+ * response fragment of zone SOA RRset. Request question is copied as is,
+ * followed by fragment and EDNS. Compression pointers of SOA owner name and
+ * names in its rdata are moved by difference between response offset fragment
+ * is copied to and one it was compiled at. Response header is expected to be
+ * already packed except for section counts.
+ *
+ * @param q        Query to pack response for, q->response_soa must be set.
+ * @param size_max Maximum response length.
+ *
+ * @return         Returns length of packed response (including header), or -1
+ *                 if response does not fit.
+ */
+static int
+query_response_pack_negative(query_t *q, size_t size_max)
+{
     rip_ns_header_t *resp_hdr = q->response_hdr;
-    int ret = 0;
+    zone_rrset_t    *soa      = q->response_soa;
+    unsigned char   *buf      = (unsigned char *)resp_hdr + sizeof(rip_ns_header_t);
+    size_t           len      = sizeof(rip_ns_header_t) + q->query_question_len;
+    int              delta    = (int)len - soa->neg_wire_base;
+    unsigned char   *p        = NULL;
+    unsigned char   *end      = NULL;
+    uint16_t         ptr      = 0;
+    int              pack_len = 0;
+
+    if (len + soa->neg_wire_len + query_edns_len(&q->edns, NULL) > size_max) {
+        return -1;
+    }
+    if (!query_response_in_place(q)) {
+        memcpy(buf, (unsigned char *)q->request_hdr + sizeof(rip_ns_header_t),
+               q->query_question_len);
+    }
+    buf += q->query_question_len;
+    memcpy(buf, soa->neg_wire, soa->neg_wire_len);
+
+    /* Owner, MNAME and RNAME, fixed part of record follows owner. */
+    p   = buf;
+    end = buf + soa->neg_wire_len;
+    for (int i = 0; i < 3 && p < end; i++) {
+        while (p < end && *p != 0 && (*p & RIP_NS_CMPRSFLGS) != RIP_NS_CMPRSFLGS) {
+            p += *p + 1;
+        }
+        if (p + 1 < end && (*p & RIP_NS_CMPRSFLGS) == RIP_NS_CMPRSFLGS) {
+            ptr = ((p[0] << 8) | p[1]) + delta;
+            p[0] = ptr >> 8;
+            p[1] = ptr & 0xff;
+            p += 1;
+        }
+        p += i == 0 ? 1 + RIP_NS_RRFIXEDSZ : 1;
+    }
+    buf += soa->neg_wire_len;
+    len += soa->neg_wire_len;
 
-    /* Pack header */
+    pack_len = query_pack_edns(buf, size_max - len, &q->edns);
+    if (pack_len < 0) {
+        return -1;
+    }
+    if (pack_len > 0) {
+        q->response_edns_offset = len;
+    }
+
+    resp_hdr->qdcount = htons(1);
+    resp_hdr->nscount = htons(1);
+    resp_hdr->arcount = htons(pack_len > 0 ? 1 : 0);
+
+    return len + pack_len;
+}
+
+/** Check if response is an error response with no records, one that is packed
+ * by @ref query_response_pack_error.
+ *
+ * @param q Query to pack response for.
+ *
+ * @return  Returns true if response is FORMERR, NOTIMPL or REFUSED error
+ *          response with empty answer, authority and additional sections.
+ */
+static inline bool
+query_response_is_error(const query_t *q)
+{
+    return (q->end_code == rip_ns_r_formerr || q->end_code == rip_ns_r_notimpl ||
+            q->end_code == rip_ns_r_refused) &&
+           q->answer_section_count == 0 && q->authority_section_count == 0 &&
+           q->additional_section_count == 0;
+}
+
+/** Pack error response with no records. Request header and question are
+ * copied, request question is not copied when response is packed in place
+ * over request, and flags and rcode are patched. EDNS OPT RR is copied from
+ * template, unless client subnet option is to be echoed. Section arrays and
+ * compressed names are not used, so names packed by an earlier pack of
+ * response stay valid.
+ *
+ * Header, question (at most @ref RIP_NS_MAXCDNAME plus @ref RIP_NS_QFIXEDSZ
+ * bytes) and OPT RR always fit into @ref RIP_NS_PACKETSZ bytes.
+ *
+ * @param q Query to pack response for, see @ref query_response_is_error().
+ */
+static void
+query_response_pack_error(query_t *q)
+{
+    rip_ns_header_t *resp_hdr = q->response_hdr;
+    unsigned char   *buf      = (unsigned char *)resp_hdr + sizeof(rip_ns_header_t);
+    size_t           len      = sizeof(rip_ns_header_t) + q->query_question_len;
+    int              pack_len = 0;
+
+    if (!query_response_in_place(q)) {
+        memcpy(resp_hdr, q->request_hdr, len);
+    }
+    resp_hdr->qr      = 1;
+    resp_hdr->opcode  = q->notify ? rip_ns_o_notify : rip_ns_o_query;
+    resp_hdr->aa      = q->authoritative;
+    resp_hdr->tc      = 0;
+    resp_hdr->ra      = 0;
+    resp_hdr->unused  = 0;
+    resp_hdr->ad      = 0;
+    resp_hdr->cd      = 0;
+    resp_hdr->rcode   = q->end_code;
+    resp_hdr->qdcount = htons(q->query_question_len > 0 ? 1 : 0);
+    resp_hdr->ancount = 0;
+    resp_hdr->nscount = 0;
+    resp_hdr->arcount = 0;
+    buf += q->query_question_len;
+
+    if (q->edns.edns_valid) {
+        pack_len = query_pack_edns(buf, RIP_NS_PACKETSZ - len, &q->edns);
+        q->response_edns_offset = len;
+        resp_hdr->arcount       = htons(1);
+        len += pack_len;
+    }
+    q->response_buffer_len = len;
+
+    /* If TCP add prefix with length of data. */
+    if (q->protocol == 1) {
+        rip_ns_put16(q->response_buffer, (uint16_t )q->response_buffer_len);
+        q->response_buffer_len += 2;
+    }
+}
+
+/** Pack query response into query response buffer, limited to given maximum
+ * response length.
+ *
+ * Room for EDNS OPT RR is kept while answer, authority and additional section
+ * records are packed. Additional section records that do not fit are dropped,
+ * and response is sent without them. If answer or authority section records
+ * do not fit response is truncated, it holds only question (and EDNS OPT RR)
+ * and has TC bit set.
+ *
+ * @param q        Query to pack response for.
+ * @param size_max Maximum response length, excluding TCP length prefix.
+ *
+ * @return         Returns 0 if full response was packed, 1 if response was
+ *                 packed with additional section records dropped, or -1 if
+ *                 response is truncated.
+ */
+static int
+query_response_pack_message(query_t *q, size_t size_max)
+{
+    rip_ns_header_t *resp_hdr = q->response_hdr;
+    uint16_t         id       = q->request_hdr->id;
+    uint8_t          rd       = q->request_hdr->rd;
+    bool             minimal  = false;
+    int              ret      = 0;
+
+    /* Pack header, request header may be the one packed over. */
     memset(resp_hdr, 0, sizeof(rip_ns_header_t));
-    resp_hdr->id      = q->request_hdr->id;
-    resp_hdr->rd      = q->request_hdr->rd;
+    resp_hdr->id      = id;
+    resp_hdr->rd      = rd;
     resp_hdr->tc      = 0;
-    resp_hdr->aa      = 1;
-    resp_hdr->opcode  = rip_ns_o_query;
+    resp_hdr->aa      = q->authoritative;
+    resp_hdr->opcode  = q->notify ? rip_ns_o_notify : rip_ns_o_query;
     resp_hdr->qr      = 1;
     resp_hdr->rcode   = 0;
+    resp_hdr->qdcount = 0;
     resp_hdr->ancount = 0;
     resp_hdr->nscount = 0;
     resp_hdr->arcount = 0;
 
     if (q->end_code < 16) {
-        resp_hdr->rcode  = q->end_code;
+        resp_hdr->rcode        = q->end_code;
+        q->edns.extended_rcode = 0;
     } else {
         /* it is the extended rcode */
         q->edns.extended_rcode = (q->end_code >> 4);
     }
 
+    /* Names packed by an earlier pack of response are no longer valid. */
+    rip_ns_comp_reset(&q->comp);
+
     unsigned char *buf = (unsigned char *)q->response_hdr + sizeof(rip_ns_header_t);
     int rrs_packed_len = sizeof(rip_ns_header_t);
+    int question_len   = sizeof(rip_ns_header_t);
+    int edns_len       = query_edns_len(&q->edns, NULL);
     int pack_len       = 0;
 
+    /* Use precompiled response if there is one and it fits. */
+    if (q->response_rrset != NULL && q->end_code == rip_ns_r_noerror) {
+        pack_len = query_response_pack_template(q, size_max, &minimal);
+        if (pack_len > 0) {
+            rrs_packed_len = pack_len;
+            ret = minimal ? 1 : 0;
+            goto DONE;
+        }
+    }
+    if (q->response_soa != NULL &&
+        (pack_len = query_response_pack_negative(q, size_max)) > 0) {
+        rrs_packed_len = pack_len;
+        goto DONE;
+    }
+
+    /* Pack question section, if request question was parsed. */
+    if (q->query_label_len > 0 && q->query_q_class != rip_ns_c_invalid) {
+        pack_len = rip_ns_name_put(q->query_label, buf,
+                                   size_max - rrs_packed_len - RIP_NS_QFIXEDSZ,
+                                   &q->comp);
+        if (pack_len < 0) {
+            goto TRUNCATED;
+        }
+        buf += pack_len;
+        RIP_NS_PUT16(q->query_q_type, buf);
+        RIP_NS_PUT16(q->query_q_class, buf);
+        rrs_packed_len += pack_len + RIP_NS_QFIXEDSZ;
+        question_len    = rrs_packed_len;
+        resp_hdr->qdcount = htons(1);
+    }
+
     /* Pack answer section */
     resp_hdr->ancount = htons(q->answer_section_count);
     for (int i = 0; i < q->answer_section_count; i++) {
-        pack_len = query_pack_rr(NULL, q->answer_section[i], buf,
-                                 q->response_buffer_size - rrs_packed_len,
-                                 &q->dnptrs[0],
-                                 &q->dnptrs[DNS_RESPONSE_COMPRESSED_NAMES_MAX-1]);
+        pack_len = query_pack_rr(i < q->answer_qname_count ? q->query_label : NULL,
+                                 q->answer_section[i], buf,
+                                 size_max - rrs_packed_len - edns_len,
+                                 &q->comp);
         if (pack_len < 0) {
-            resp_hdr->tc = 1;
-            ret = -1;
-            goto END;
+            goto TRUNCATED;
         }
         rrs_packed_len += pack_len;
         buf += pack_len;
@@ -237,48 +526,63 @@ query_response_pack(query_t *q)
     resp_hdr->nscount = htons(q->authority_section_count);
     for (int i = 0; i < q->authority_section_count; i++) { 
         pack_len = query_pack_rr(NULL, q->authority_section[i], buf,
-                                 q->response_buffer_size - rrs_packed_len,
-                                 &q->dnptrs[0],
-                                 &q->dnptrs[DNS_RESPONSE_COMPRESSED_NAMES_MAX-1]);
+                                 size_max - rrs_packed_len - edns_len,
+                                 &q->comp);
         if (pack_len < 0) {
-            resp_hdr->tc = 1;
-            ret = -1;
-            goto END;
+            goto TRUNCATED;
+        }
+        if (q->authority_section[i]->type == rip_ns_t_soa) {
+            /* SOA is only in authority section of negative responses. */
+            unsigned char *ttl = buf + pack_len - q->authority_section[i]->rdata_len -
+                                 RIP_NS_INT16SZ - RIP_NS_INT32SZ;
+
+            RIP_NS_PUT32(zone_soa_negative_ttl(q->authority_section[i]), ttl);
         }
         rrs_packed_len += pack_len;
         buf += pack_len;
     }
 
-    /* Pack additional section */
+    /* Pack additional section, records that do not fit are dropped. */
     for (int i = 0; i < q->additional_section_count; i++) { 
         pack_len = query_pack_rr(NULL, q->additional_section[i], buf,
-                                 q->response_buffer_size - rrs_packed_len,
-                                 &q->dnptrs[0],
-                                 &q->dnptrs[DNS_RESPONSE_COMPRESSED_NAMES_MAX-1]);
+                                 size_max - rrs_packed_len - edns_len,
+                                 &q->comp);
         if (pack_len < 0) {
-            resp_hdr->tc = 1;
-            ret = -1;
-            goto END;
+            q->additional_section_count = i;
+            ret = 1;
+            break;
         }
         rrs_packed_len += pack_len;
         buf += pack_len;
     }
 
-    /* Pack edns */
-    pack_len = query_pack_edns(buf, q->response_buffer_size - rrs_packed_len, &q->edns);
-    if (pack_len < 0) {
-        resp_hdr->tc = 1;
-        ret = -1;
-        goto END;
-    } else if (pack_len > 0) {
+    /* Pack edns, room for it was kept. */
+    pack_len = query_pack_edns(buf, size_max - rrs_packed_len, &q->edns);
+    if (pack_len > 0) {
         q->additional_section_count += 1;
+        q->response_edns_offset      = rrs_packed_len;
+        rrs_packed_len += pack_len;
     }
-    rrs_packed_len += pack_len;
-    buf += pack_len;   
-
-END:
     resp_hdr->arcount = htons(q->additional_section_count);
+    goto DONE;
+
+TRUNCATED:
+    /* Response is truncated to question, and EDNS if it fits. */
+    resp_hdr->tc      = 1;
+    resp_hdr->ancount = 0;
+    resp_hdr->nscount = 0;
+    rrs_packed_len    = question_len;
+    buf = (unsigned char *)q->response_hdr + question_len;
+
+    pack_len = query_pack_edns(buf, size_max - rrs_packed_len, &q->edns);
+    if (pack_len > 0) {
+        q->response_edns_offset = rrs_packed_len;
+        rrs_packed_len += pack_len;
+        resp_hdr->arcount = htons(1);
+    }
+    ret = -1;
 
+DONE:
     q->response_buffer_len = rrs_packed_len;
 
     /* If TCP add prefix with length of data. */
@@ -289,4 +593,162 @@ END:
     }
 
     return ret;
-}
\ No newline at end of file
+}
+
+/** Pack query response into query response buffer.
+ *
+ * Response is limited to @ref query_response_size_max(), so UDP response is
+ * no larger than EDNS UDP payload size client advertised (or 512 bytes
+ * without EDNS). Additional section records that do not fit are dropped
+ * before response is truncated. TCP response that does not fit is packed
+ * again into a larger response buffer from query response buffer pool, see
+ * @ref query_tcp_response_buffer_increase().
+ * 
+ * @param q Query to pack response for
+ * 
+ * @return  Returns 0 on success otherwise:
+ *          1 indicates that response was packed with some or all additional
+ *            section records dropped, it is complete but not to be cached.
+ *          -1 indicates that there was not enough room to pack full response
+ *             and response is truncated.
+ */
+int
+query_response_pack(query_t *q)
+{
+    uint16_t additional_count = q->additional_section_count;
+    int      ret;
+
+    if (q->edns.client_subnet.edns_cs_valid) {
+        /* Decode client subnet before request is overwritten by response. */
+        query_edns_cs_ip(&q->edns.client_subnet);
+    }
+    if (query_response_is_error(q)) {
+        query_response_pack_error(q);
+        return 0;
+    }
+    while ((ret = query_response_pack_message(q, query_response_size_max(q))) != 0 &&
+           q->protocol == 1 && query_tcp_response_buffer_increase(q) == 0) {
+        /* Pack again into larger TCP response buffer. */
+        q->additional_section_count = additional_count;
+        q->response_edns_offset     = 0;
+    }
+    return ret;
+}
+
+/** Pack truncated response, holding only header and question (and EDNS OPT
+ * RR), with TC bit set telling client to retry over TCP. Query is answered
+ * with it without being resolved, when it is shed under overload.
+ *
+ * @param q Parsed query to pack response for.
+ */
+void
+query_response_pack_truncated(query_t *q)
+{
+    if (q->edns.client_subnet.edns_cs_valid) {
+        query_edns_cs_ip(&q->edns.client_subnet);
+    }
+    q->end_code = rip_ns_r_noerror;
+    query_response_pack_error(q);
+    q->response_hdr->tc = 1;
+}
+
+/** Append EDNS option to packed response. Option is added to EDNS OPT RR
+ * which is always the last RR in response, after response is packed (or
+ * copied from response cache), so cached responses do not hold per client
+ * options.
+ *
+ * @note This is a helper function for @ref query_response_pack_cookie() and
+ * @ref query_response_pack_keepalive().
+ *
+ * @param q        Query with packed response, MUST have EDNS OPT RR.
+ * @param opt_code Option code.
+ * @param data     Option data, parts concatenated.
+ * @param data_len Lengths of option data parts.
+ * @param count    Number of option data parts.
+ *
+ * @return         Returns 0 on success, -1 if there is not enough room in
+ *                 response buffer in which case response is left untouched.
+ */
+static int
+query_response_pack_opt(query_t *q, uint16_t opt_code, const uint8_t **data,
+                        const uint16_t *data_len, int count)
+{
+    size_t         resp_len = q->response_buffer_len - (q->protocol == 1 ? 2 : 0);
+    unsigned char *opt      = (unsigned char *)q->response_hdr + q->response_edns_offset;
+    unsigned char *buf      = (unsigned char *)q->response_hdr + resp_len;
+    uint16_t       opt_len  = 0;
+    uint16_t       rdata_len;
+
+    for (int i = 0; i < count; i++) {
+        opt_len += data_len[i];
+    }
+    if (resp_len + 4 + opt_len > query_response_size_max(q)) {
+        return -1;
+    }
+
+    /* Update OPT RR rdata length, it is the last field of OPT RR fixed part. */
+    opt += 1 + RIP_NS_RRFIXEDSZ - 2;
+    RIP_NS_GET16(rdata_len, opt);
+    rip_ns_put16(opt - 2, rdata_len + 4 + opt_len);
+
+    RIP_NS_PUT16(opt_code, buf);
+    RIP_NS_PUT16(opt_len, buf);
+    for (int i = 0; i < count; i++) {
+        memcpy(buf, data[i], data_len[i]);
+        buf += data_len[i];
+    }
+
+    q->response_buffer_len += 4 + opt_len;
+    if (q->protocol == 1) {
+        /* TCP */
+        rip_ns_put16(q->response_buffer, (uint16_t )(q->response_buffer_len - 2));
+    }
+    return 0;
+}
+
+/** Append EDNS cookie option to packed response. Option holds client cookie
+ * from request and server cookie set by @ref dns_cookie_verify, see
+ * @ref query_response_pack_opt().
+ *
+ * @param q Query with packed response.
+ *
+ * @return  Returns 0 on success (or if no cookie is to be sent), -1 if there is
+ *          not enough room in response buffer in which case response is left
+ *          untouched.
+ */
+int
+query_response_pack_cookie(query_t *q)
+{
+    const uint8_t  *data[2]     = { q->edns.cookie.client_cookie,
+                                    q->edns.cookie.server_cookie };
+    const uint16_t  data_len[2] = { DNS_COOKIE_CLIENT_LEN, DNS_COOKIE_SERVER_LEN };
+
+    if (!q->edns.cookie.edns_cookie_valid || q->response_edns_offset == 0) {
+        return 0;
+    }
+    return query_response_pack_opt(q, rip_ns_ext_opt_c_cookie, data, data_len, 2);
+}
+
+/** Append EDNS TCP keepalive option (RFC 7828) to packed TCP response, if
+ * request carried it. Timeout 0 asks client to close connection, see
+ * @ref query_response_pack_opt().
+ *
+ * @param q       Query with packed response.
+ * @param timeout Idle timeout in units of 100 milliseconds.
+ *
+ * @return        Returns 0 on success (or if no option is to be sent), -1 if
+ *                there is not enough room in response buffer in which case
+ *                response is left untouched.
+ */
+int
+query_response_pack_keepalive(query_t *q, uint16_t timeout)
+{
+    uint8_t         value[2]    = { timeout >> 8, timeout & 0xff };
+    const uint8_t  *data[1]     = { value };
+    const uint16_t  data_len[1] = { sizeof(value) };
+
+    if (!q->edns.tcp_keepalive || q->protocol != 1 || q->response_edns_offset == 0) {
+        return 0;
+    }
+    return query_response_pack_opt(q, rip_ns_ext_opt_c_keepalive, data, data_len, 1);
+}
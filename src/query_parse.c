@@ -26,6 +26,12 @@
 #include <stdio.h>
 #include <netinet/in.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "constants.h"
 #include "rip_ns_utils.h"
 #include "query.h"
@@ -39,6 +45,9 @@
  * 1 byte          = scope netmask<br>
  * remaining bytes = client subnet<br>
  * 
+ * Option is validated in place in request buffer, client subnet address is
+ * decoded on demand, see @ref query_edns_cs_ip.
+ *
  * @param cs      EDNS client subnet object to parse data into.
  *
  * @return        Returns 0 on success, otherwise error occurred i.e.
@@ -55,6 +64,7 @@ query_parse_edns_ext_cs(edns_client_subnet_t *cs)
     uint8_t  scope_mask  = 0;
 
     cs->edns_cs_valid = false;
+    cs->ip_decoded    = false;
 
     if (buf_len < 4) {
         /* Invalid format, minimum number of required bytes not present. */
@@ -73,21 +83,11 @@ query_parse_edns_ext_cs(edns_client_subnet_t *cs)
             /* Invalid format, MUST be rejected and a FORMERR response */
             return -2;
         }
-
-        struct sockaddr_in *sin = (struct sockaddr_in *)&cs->ip;
-        sin->sin_family = AF_INET;
-        sin->sin_addr.s_addr = 0;
-        memcpy(&sin->sin_addr.s_addr, buf, bytes_to_copy);
     } else if (family == 2) {
         if (source_mask > 128 || scope_mask != 0 || bytes_to_copy > RIP_NS_IN6ADDRSZ) {
             /* Invalid format, MUST be rejected and a FORMERR response */
             return -3;
         }
-
-        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&cs->ip;
-        sin6->sin6_family = AF_INET6;
-        memset(&sin6->sin6_addr, 0, sizeof(struct in6_addr));
-        memcpy(&sin6->sin6_addr, buf, bytes_to_copy);
     } else {
         /* Unsupported address family. */
         /* Per RFC 7871 section 7.8.1:
@@ -129,6 +129,77 @@ query_parse_edns_ext_cs(edns_client_subnet_t *cs)
     return 0;
 }
 
+/** Get client subnet address of EDNS client subnet option, decoding it from
+ * request buffer on first use.
+ *
+ * @note Address MUST be decoded before response is packed in place over
+ * request, see @ref query_response_pack().
+ *
+ * @param cs EDNS client subnet object, MUST be valid.
+ *
+ * @return   Returns client subnet address, bits past source mask are 0.
+ */
+const struct sockaddr_storage *
+query_edns_cs_ip(edns_client_subnet_t *cs)
+{
+    uint8_t len;
+
+    if (cs->ip_decoded) {
+        return &cs->ip;
+    }
+    len = cs->edns_cs_raw_buf_len - 4;
+    if (cs->family == 1) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&cs->ip;
+        sin->sin_family = AF_INET;
+        sin->sin_addr.s_addr = 0;
+        memcpy(&sin->sin_addr.s_addr, cs->edns_cs_raw_buf + 4, len);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&cs->ip;
+        sin6->sin6_family = AF_INET6;
+        memset(&sin6->sin6_addr, 0, sizeof(struct in6_addr));
+        memcpy(&sin6->sin6_addr, cs->edns_cs_raw_buf + 4, len);
+    }
+    cs->ip_decoded = true;
+
+    return &cs->ip;
+}
+
+/** Parse EDNS cookie option (RFC 7873).
+ *
+ * Format of EDNS cookie option data is:
+ * 8 bytes              = client cookie,
+ * 0 or 8 to 32 bytes   = server cookie
+ *
+ * Server cookie is only copied, it is verified by @ref dns_cookie_verify.
+ *
+ * @param cookie  EDNS cookie object to parse data into.
+ *
+ * @return        Returns 0 on success, otherwise format error occurred.
+ */
+int
+query_parse_edns_ext_cookie(edns_cookie_t *cookie)
+{
+    uint16_t server_len = cookie->edns_cookie_raw_buf_len - DNS_COOKIE_CLIENT_LEN;
+
+    cookie->edns_cookie_valid   = false;
+    cookie->server_cookie_valid = false;
+
+    if (cookie->edns_cookie_raw_buf_len < DNS_COOKIE_CLIENT_LEN ||
+        (server_len != 0 && (server_len < DNS_COOKIE_SERVER_LEN_MIN ||
+                             server_len > DNS_COOKIE_SERVER_LEN_MAX))) {
+        /* Per RFC 7873 section 5.2.2 malformed cookie MUST be answered with
+         * FORMERR.
+         */
+        return -1;
+    }
+
+    memcpy(cookie->client_cookie, cookie->edns_cookie_raw_buf, DNS_COOKIE_CLIENT_LEN);
+    cookie->server_cookie_len = server_len;
+    cookie->edns_cookie_valid = true;
+
+    return 0;
+}
+
 /** Parse EDNS extensions.
  * 
  * Format of EDNS option is:
@@ -172,6 +243,23 @@ query_parse_edns_ext(query_t *q, unsigned char *buf, unsigned char *eobuf)
             }
             break;
 
+        case rip_ns_ext_opt_c_cookie:
+            /* Cookie */
+            q->edns.cookie.edns_cookie_raw_buf = buf;
+            q->edns.cookie.edns_cookie_raw_buf_len = opt_len;
+            if (query_parse_edns_ext_cookie(&q->edns.cookie) != 0) {
+                return -1;
+            }
+            break;
+
+        case rip_ns_ext_opt_c_keepalive:
+            /* TCP keepalive, client MUST NOT send timeout (RFC 7828). */
+            if (opt_len != 0) {
+                return -1;
+            }
+            q->edns.tcp_keepalive = true;
+            break;
+
         default:
             /* Extension is not one we support, skip it. */
             break;
@@ -202,6 +290,7 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
          * what we expect if additional records were present.
          */
         q->end_code = rip_ns_r_formerr;
+        q->error    = QUERY_ERR_ADDITIONAL;
         return -1;
     }
 
@@ -237,12 +326,14 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
         if (unpack < 1) {
             /* Invalid format, was not able to upack RR name. */
             q->end_code = rip_ns_r_formerr;
+            q->error    = QUERY_ERR_ADDITIONAL;
             return -1;
         }
         ptr += unpack;
         if (ptr >= eom || (ptr + RIP_NS_RRFIXEDSZ - 1) > eom) {
             /* Invalid format, not enough data for OPT RR */
             q->end_code = rip_ns_r_formerr;
+            q->error    = QUERY_ERR_ADDITIONAL;
             return -1;
         }
         if (unpack == 1 && strlen((char *)adr_name) == 0 &&
@@ -259,8 +350,10 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
                 q->edns.udp_resp_len = RIP_NS_UDP_MAXMSG;
             }
 
-            /* Check EDNS version, only version '0' is supported. */
-            q->edns.version = *ptr;
+            /* Check EDNS version, only version '0' is supported. Version
+             * follows extended rcode byte, which is not set in requests.
+             */
+            q->edns.version = ptr[1];
             if (q->edns.version != 0) {
                 /* EDNS version not supported. Per RFC 6891
                  * https://datatracker.ietf.org/doc/html/rfc6891
@@ -268,15 +361,14 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
                  */
                 q->edns.udp_resp_len = 512;
                 q->end_code = rip_ns_r_badvers;
+                q->error    = QUERY_ERR_EDNS_VERSION;
                 return -1;
             }
             ptr += 2;
 
             /* Check the DO bit for DNSSEC support. */
             uint8_t *u8 = (uint8_t *)ptr;
-            if ((*u8 & 0x80) == 0x80) {
-                q->edns.dnssec = true;
-            }
+            q->edns.dnssec = (*u8 & 0x80) != 0;
             ptr += 2;
 
             /* Get RDATA length. */
@@ -286,11 +378,13 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
                 if (ptr >= eom || (ptr + rdata_len - 1) > eom) {
                     /* Invalid format, not enough data for EDNS options. */
                     q->end_code = rip_ns_r_formerr;
+                    q->error    = QUERY_ERR_ADDITIONAL;
                     return -1;
                 }
                 if (query_parse_edns_ext(q, ptr, ptr + rdata_len - 1) != 0) {
                     /* Error parsing EDNS extensions. */
                     q->end_code = rip_ns_r_formerr;
+                    q->error    = QUERY_ERR_EDNS_OPTION;
                     return -1;
                 }
             }
@@ -302,6 +396,7 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
             ptr += unpack + 8;
             if (ptr + 1 > eom) {
                 q->end_code = rip_ns_r_formerr;
+                q->error    = QUERY_ERR_ADDITIONAL;
                 return -1;
             }
             RIP_NS_GET16(rdata_len, ptr);
@@ -311,6 +406,7 @@ query_parse_request_rr_additional_edns(query_t *q, unsigned char *ptr)
     }
     if (rr_count != ntohs(q->request_hdr->ancount)) {
         q->end_code = rip_ns_r_formerr;
+        q->error    = QUERY_ERR_ADDITIONAL;
         return -1;
     }
     return ptr - start;
@@ -342,38 +438,280 @@ int
 query_parse_request_rr_question(query_t *q)
 {
     int            unpack = 0;
+    int            len    = 0;
     unsigned char *ptr    = (unsigned char *)q->request_hdr;
     unsigned char *eom    = ptr + q->request_buffer_len -1;
 
-    /* Extract question label, type, and class */
-    unpack = rip_rr_name_get(ptr, eom, ptr + sizeof(rip_ns_header_t),
-                             q->query_label, q->query_label_size,
-                             &q->query_label_len);                                       
+    /* Extract question name, type, and class. Name is unpacked into
+     * query_qname, converted to query_label with its case preserved, and
+     * then case folded in place into canonical form.
+     */
+    unpack = rip_ns_name_unpack(ptr, eom, ptr + sizeof(rip_ns_header_t),
+                                q->query_qname, sizeof(q->query_qname));
     if (unpack < 1) {
-        q->end_code =  rip_ns_r_formerr;
+        q->end_code = rip_ns_r_formerr;
+        q->error    = QUERY_ERR_QNAME;
+        return -1;
+    }
+    len = rip_ns_name_ntop(q->query_qname, (char *)q->query_label, q->query_label_size);
+    if (len < 0) {
+        q->end_code = rip_ns_r_formerr;
+        q->error    = QUERY_ERR_QNAME;
         return -1;
     }
+    q->query_label_len = len;
+    q->query_qname_len  = rip_ns_name_lc(q->query_qname);
+    q->query_qname_hash = rip_ns_name_hash(q->query_qname, q->query_qname_len);
     ptr += sizeof(rip_ns_header_t) + unpack;
     if (ptr + 3 > eom) {
         /* Message is not long enough to satisfy parsing of RR. */
-        q->end_code =  rip_ns_r_formerr;
+        q->end_code = rip_ns_r_formerr;
+        q->error    = QUERY_ERR_QUESTION_SHORT;
         return -1;
     }
     RIP_NS_GET16(q->query_q_type, ptr);
-    if (!rip_ns_rr_type_supported(q->query_q_type)) {
-        /* RR type not supported. */
-        q->end_code = rip_ns_r_notimpl;
+    if (!(rip_ns_qtype_get(q->query_q_type).flags & RIP_NS_QTYPE_F_SUPPORTED)) {
+        /* RR type not supported, question is still echoed in response. */
+        q->end_code           = rip_ns_r_notimpl;
+        q->error              = QUERY_ERR_QTYPE;
+        q->query_question_len = unpack + RIP_NS_QFIXEDSZ;
         return -1;
     }
     RIP_NS_GET16(q->query_q_class, ptr);
     if (!rip_ns_rr_class_supported(q->query_q_class)) {
         /* RR class not supported. */
-        q->end_code = rip_ns_r_notimpl;
+        q->end_code           = rip_ns_r_notimpl;
+        q->error              = QUERY_ERR_QCLASS;
+        q->query_question_len = unpack + RIP_NS_QFIXEDSZ;
         return -1;
     }
     return unpack + 4;
 }
 
+/** Skip a resource record of query request, name and all.
+ *
+ * @param ptr Pointer in request buffer where resource record starts.
+ * @param eom Pointer to last byte of request.
+ *
+ * @return    Returns number of bytes of resource record, or -1 if request
+ *            ends before it does.
+ */
+static int
+query_parse_request_rr_skip(const unsigned char *ptr, const unsigned char *eom)
+{
+    const unsigned char *start     = ptr;
+    uint16_t             rdata_len = 0;
+
+    while (ptr <= eom && *ptr != 0 && (*ptr & 0xc0) != 0xc0) {
+        ptr += *ptr + 1;
+    }
+    if (ptr > eom) {
+        return -1;
+    }
+    ptr += (*ptr & 0xc0) == 0xc0 ? 2 : 1;
+    if (ptr + RIP_NS_RRFIXEDSZ - 1 > eom) {
+        return -1;
+    }
+    ptr += RIP_NS_RRFIXEDSZ - RIP_NS_INT16SZ;
+    RIP_NS_GET16(rdata_len, ptr);
+    if (rdata_len > 0 && ptr + rdata_len - 1 > eom) {
+        return -1;
+    }
+    return ptr + rdata_len - start;
+}
+
+/** Check request headers of a vector of received UDP queries at once, see
+ * @ref query_parse_fast_header. Each header is loaded into a vector
+ * register, masked down to the bits checked and compared against expected
+ * values with a single compare, so a whole vector is classified without
+ * per field branches. Queries whose bit is not set are left to
+ * @ref query_parse, which classifies what is wrong with them.
+ *
+ * Request buffers must be at least 16 bytes in size, which UDP query buffers
+ * always are.
+ *
+ * @param queries     Queries, request buffers hold received datagrams.
+ * @param read_vector Read vector datagrams were received with, holds their
+ *                    lengths.
+ * @param count       Number of queries to check, at most 64.
+ *
+ * @return            Returns bit mask with bit i set if header of query i
+ *                    has fast path shape.
+ */
+uint64_t
+query_parse_fast_headers(const query_t *queries, const struct mmsghdr *read_vector,
+                         unsigned int count)
+{
+    /* Header bytes: ID, QR|Opcode|AA|TC|RD, RA|Z|AD|CD|RCODE, QDCOUNT,
+     * ANCOUNT, NSCOUNT and ARCOUNT, followed by 4 bytes of question that are
+     * not checked.
+     */
+    static const uint8_t mask[16] = {
+        0x00, 0x00, 0xfa, 0x00, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xfe, 0x00, 0x00, 0x00, 0x00,
+    };
+    static const uint8_t want[16] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    uint64_t bits = 0;
+
+#if defined(__SSE2__)
+    const __m128i m = _mm_loadu_si128((const __m128i *)mask);
+    const __m128i w = _mm_loadu_si128((const __m128i *)want);
+
+    for (unsigned int i = 0; i < count; i++) {
+        __m128i h  = _mm_loadu_si128((const __m128i *)queries[i].request_hdr);
+        int     eq = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(h, m), w));
+
+        bits |= (uint64_t)(eq == 0xffff &&
+                           read_vector[i].msg_len >= sizeof(rip_ns_header_t) + 1 +
+                                                     RIP_NS_QFIXEDSZ) << i;
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t m = vld1q_u8(mask);
+    const uint8x16_t w = vld1q_u8(want);
+
+    for (unsigned int i = 0; i < count; i++) {
+        uint8x16_t h  = vld1q_u8((const uint8_t *)queries[i].request_hdr);
+        uint64x2_t eq = vreinterpretq_u64_u8(vceqq_u8(vandq_u8(h, m), w));
+
+        bits |= (uint64_t)((vgetq_lane_u64(eq, 0) & vgetq_lane_u64(eq, 1)) == UINT64_MAX &&
+                           read_vector[i].msg_len >= sizeof(rip_ns_header_t) + 1 +
+                                                     RIP_NS_QFIXEDSZ) << i;
+    }
+#else
+    uint64_t m_lo;
+    uint64_t w_lo;
+    uint32_t m_hi;
+    uint32_t w_hi;
+
+    memcpy(&m_lo, mask, sizeof(m_lo));
+    memcpy(&w_lo, want, sizeof(w_lo));
+    memcpy(&m_hi, mask + 8, sizeof(m_hi));
+    memcpy(&w_hi, want + 8, sizeof(w_hi));
+    for (unsigned int i = 0; i < count; i++) {
+        const unsigned char *h = (const unsigned char *)queries[i].request_hdr;
+        uint64_t             lo;
+        uint32_t             hi;
+
+        memcpy(&lo, h, sizeof(lo));
+        memcpy(&hi, h + 8, sizeof(hi));
+        bits |= (uint64_t)((lo & m_lo) == w_lo && (hi & m_hi) == w_hi &&
+                           read_vector[i].msg_len >= sizeof(rip_ns_header_t) + 1 +
+                                                     RIP_NS_QFIXEDSZ) << i;
+    }
+#endif
+    return bits;
+}
+
+/** Parse query request of the most common shape: single question of type A
+ * or AAAA and class IN with an uncompressed name, and either no additional
+ * records or a single EDNS(0) OPT RR without options. Name and OPT RR are at
+ * fixed offsets so no generic RR walking is done.
+ *
+ * Request of any other shape, including one that is malformed, is left to
+ * @ref query_parse which is then expected to be called.
+ *
+ * @param q Query to parse DNS request for.
+ *
+ * @return  Returns true if request was parsed, false otherwise in which case
+ *          query is left as it was.
+ */
+bool
+query_parse_fast(query_t *q)
+{
+    return query_parse_fast_header(q) && query_parse_fast_question(q);
+}
+
+/** Parse question and additional section of query request whose header was
+ * already found to have fast path shape, by @ref query_parse_fast_headers.
+ * See @ref query_parse_fast.
+ *
+ * @param q Query to parse DNS request for.
+ *
+ * @return  Returns true if request was parsed, false otherwise in which case
+ *          query is left as it was.
+ */
+bool
+query_parse_fast_question(query_t *q)
+{
+    const unsigned char *msg    = (const unsigned char *)q->request_hdr;
+    const unsigned char *end    = msg + q->request_buffer_len;
+    const unsigned char *ptr    = msg + sizeof(rip_ns_header_t);
+    rip_ns_header_t     *header = q->request_hdr;
+    uint16_t             q_type;
+    uint16_t             name_len;
+    uint16_t             udp_resp_len;
+    int                  label_len;
+    unsigned char        flags;
+
+    /* Question name, labels only. */
+    while (*ptr != 0) {
+        if (*ptr > RIP_NS_MAXLABEL || ptr + *ptr + 1 + RIP_NS_QFIXEDSZ >= end) {
+            return false;
+        }
+        ptr += *ptr + 1;
+    }
+    ptr += 1;
+    name_len = ptr - msg - sizeof(rip_ns_header_t);
+    if (name_len > RIP_NS_MAXCDNAME) {
+        return false;
+    }
+    q_type = ptr[0] << 8 | ptr[1];
+    if ((q_type != rip_ns_t_a && q_type != rip_ns_t_aaaa) ||
+        (ptr[2] << 8 | ptr[3]) != rip_ns_c_in) {
+        return false;
+    }
+    ptr += RIP_NS_QFIXEDSZ;
+
+    /* Nothing, or exactly an OPT RR of version 0 without options follows. */
+    if (header->arcount == 0) {
+        if (ptr != end) {
+            return false;
+        }
+    } else {
+        if (end - ptr != 1 + RIP_NS_RRFIXEDSZ || ptr[0] != 0 ||
+            (ptr[1] << 8 | ptr[2]) != rip_ns_t_opt || ptr[6] != 0 ||
+            ptr[9] != 0 || ptr[10] != 0) {
+            return false;
+        }
+        udp_resp_len = ptr[3] << 8 | ptr[4];
+        flags        = ptr[7];
+    }
+
+    label_len = rip_ns_name_ntop(msg + sizeof(rip_ns_header_t), (char *)q->query_label,
+                                 q->query_label_size);
+    if (label_len < 0) {
+        return false;
+    }
+    q->end_code           = -1;
+    q->query_label_len    = label_len;
+    q->query_question_len = name_len + RIP_NS_QFIXEDSZ;
+    q->query_q_type       = q_type;
+    q->query_q_class      = rip_ns_c_in;
+
+    memcpy(q->query_qname, msg + sizeof(rip_ns_header_t), name_len);
+    str_to_lc(q->query_qname, name_len);
+    q->query_qname_len  = name_len;
+    q->query_qname_hash = rip_ns_name_hash(q->query_qname, name_len);
+
+    if (header->arcount != 0) {
+        if (udp_resp_len < RIP_NS_PACKETSZ) {
+            udp_resp_len = RIP_NS_PACKETSZ;
+        } else if (udp_resp_len > RIP_NS_UDP_MAXMSG) {
+            udp_resp_len = RIP_NS_UDP_MAXMSG;
+        }
+        q->edns.edns_raw_buf     = (unsigned char *)ptr;
+        q->edns.edns_raw_buf_len = 1 + RIP_NS_RRFIXEDSZ;
+        q->edns.udp_resp_len     = udp_resp_len;
+        q->edns.version          = 0;
+        q->edns.dnssec           = (flags & 0x80) != 0;
+        q->edns.edns_valid       = true;
+    }
+    return true;
+}
+
 /** Parse query request from request buffer into query_t structure fields.
  * 
  * DNS request & response format is as per RFC 1035
@@ -403,10 +741,13 @@ query_parse(query_t *q)
         RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_rip_query_tc);
     }
 
-    /* Queries of type Question are only ones supported. */
-    if (header->opcode != rip_ns_o_query) {
+    /* Queries of type Question are only ones supported, along with NOTIFY
+     * secondary zones are refreshed on.
+     */
+    if (header->opcode != rip_ns_o_query && header->opcode != rip_ns_o_notify) {
         RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_notimpl);
     }
+    q->notify = header->opcode == rip_ns_o_notify;
 
     /* Response flag should not be set */
     if (header->qr != 0) {
@@ -424,21 +765,44 @@ query_parse(query_t *q)
         }
     }
 
-    /* Answer entries and Authority entries in question are not supported. */
-    if (ntohs(header->ancount) != 0 || ntohs(header->nscount) != 0) {
+    /* Answer entries in question are not supported, other than SOA record
+     * of NOTIFY, nor are authority entries other than SOA record of IXFR
+     * request.
+     */
+    if (ntohs(header->ancount) > (q->notify ? 1 : 0) || ntohs(header->nscount) > 1) {
         RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_formerr);
     }
 
-    q->dnptrs[0] = (unsigned char *)q->response_hdr;
-
     /* Extract question label, type, and class */
     unpack = query_parse_request_rr_question(q);
     if (unpack < 0) {
         return;
     }
+    q->query_question_len = unpack;
 
     ptr += sizeof(rip_ns_header_t) + unpack;
 
+    /* NOTIFY answer section holds new SOA record of zone (RFC 1996), it is
+     * skipped, zone is transferred to learn it.
+     */
+    if (ntohs(header->ancount) != 0) {
+        if ((unpack = query_parse_request_rr_skip(ptr, eom)) < 0) {
+            RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_formerr);
+        }
+        ptr += unpack;
+    }
+
+    /* IXFR request authority section holds SOA record of zone version client
+     * has (RFC 1995). It is skipped, IXFR is answered with full zone.
+     */
+    if (ntohs(header->nscount) != 0) {
+        if (q->query_q_type != rip_ns_t_ixfr ||
+            (unpack = query_parse_request_rr_skip(ptr, eom)) < 0) {
+            RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_formerr);
+        }
+        ptr += unpack;
+    }
+
     /* Are additional opt RRs present */
     uint16_t adr_count = ntohs(header->arcount);
     if (adr_count > 0) {
@@ -22,117 +22,276 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <arpa/inet.h>
 #include <stdatomic.h>
+#include <string.h>
 #include <sys/socket.h>
 
+#include "histogram.h"
 #include "query.h"
 #include "metrics.h"
+#include "rip_ns_utils.h"
+#include "sketch.h"
+#include "utils.h"
 
-/** Report query metrics.
- * 
- * @param q       Query to report metrics for.
- * @param metrics Metrics object where to report metrics.
+/** Record latency of a stage in stage histogram, if query went through both
+ * stage start and stage end.
+ *
+ * @param h     Stage histogram.
+ * @param start Stage start time in nanoseconds, 0 if not set.
+ * @param end   Stage end time in nanoseconds, 0 if not set.
  */
-void
-query_report_metrics(query_t *q, metrics_t *metrics)
+static inline void
+query_report_stage_latency(histogram_t *h, uint64_t start, uint64_t end)
+{
+    /* Realtime clock could have stepped back, skip such samples. */
+    if (start != 0 && end >= start) {
+        histogram_record(h, end - start);
+    }
+}
+
+/** Report query latency, end to end and per processing stage. Only queries
+ * for which response was sent are reported.
+ *
+ * @param q       Query to report latency for.
+ * @param metrics Vectorloop metrics where to report latency.
+ */
+static void
+query_report_latency(query_t *q, metrics_vl_t *metrics)
+{
+    uint64_t recv_ns;
+    uint64_t parse_ns;
+    uint64_t resolve_ns;
+    uint64_t pack_ns;
+    uint64_t send_ns;
+    int      proto = q->protocol == 0 ? 0 : 1;
+    int      rcode = q->end_code;
+
+    if (q->end_code < 0) {
+        return;
+    }
+    send_ns = utl_timespec_to_ns(&q->end_time);
+    recv_ns = utl_timespec_to_ns(&q->start_time);
+    if (send_ns == 0 || recv_ns == 0) {
+        return;
+    }
+    if (rcode >= METRICS_LATENCY_RCODES) {
+        rcode = METRICS_LATENCY_RCODES - 1;
+    }
+    query_report_stage_latency(&metrics->latency.total[proto][rcode], recv_ns, send_ns);
+
+    parse_ns   = utl_timespec_to_ns(&q->parse_time);
+    resolve_ns = utl_timespec_to_ns(&q->resolve_time);
+    pack_ns    = utl_timespec_to_ns(&q->pack_time);
+    query_report_stage_latency(&metrics->latency.stage[METRICS_LATENCY_RECV_PARSE][proto],
+                               recv_ns, parse_ns);
+    if (resolve_ns != 0) {
+        query_report_stage_latency(&metrics->latency.stage[METRICS_LATENCY_PARSE_RESOLVE][proto],
+                                   parse_ns, resolve_ns);
+        query_report_stage_latency(&metrics->latency.stage[METRICS_LATENCY_RESOLVE_PACK][proto],
+                                   resolve_ns, pack_ns);
+    }
+    query_report_stage_latency(&metrics->latency.stage[METRICS_LATENCY_PACK_SEND][proto],
+                               pack_ns, send_ns);
+}
+
+/** Sketch query question name, client network and client address into
+ * current window of vectorloop sketches.
+ *
+ * @param q      Query to sketch.
+ * @param sketch Vectorloop sketches.
+ */
+static void
+query_report_sketch(query_t *q, metrics_sketch_vl_t *sketch)
 {
+    metrics_sketch_window_t *w = sketch->current;
+    uint64_t                 net;
+    uint64_t                 hash;
+
+    w->queries++;
+    if (q->query_qname_len > 0) {
+        sketch_topk_add(&w->qnames, q->query_qname_hash, q->query_qname,
+                        q->query_qname_len, 1);
+    }
+
+    if (q->client_ip->ss_family == AF_INET) {
+        uint32_t addr = ntohl(((struct sockaddr_in *)q->client_ip)->sin_addr.s_addr);
 
-    atomic_ullong *atomic_ul = NULL;
+        net  = METRICS_SKETCH_CLIENT_V4 << 56 | addr >> 8;
+        hash = sketch_mix(addr);
+    } else if (q->client_ip->ss_family == AF_INET6) {
+        const uint8_t *addr = ((struct sockaddr_in6 *)q->client_ip)->sin6_addr.s6_addr;
 
-    if (q->protocol == 0) {
-        /* UDP */
-        atomic_fetch_add(&metrics->udp.queries, 1);
-    } else if (q->protocol == 1) {
-        /* TCP */
-        atomic_fetch_add(&metrics->tcp.queries, 1);
+        net = METRICS_SKETCH_CLIENT_V6 << 56;
+        for (int i = 0; i < 7; i++) {
+            net |= (uint64_t)addr[i] << (48 - 8 * i);
+        }
+        hash = rip_ns_name_hash(addr, 16);
+    } else {
+        return;
     }
+    sketch_topk_add(&w->clients, net, NULL, 0, 1);
+    sketch_hll_add(&w->clients_hll, hash);
+}
 
-    atomic_ul = NULL;
-    switch (q->end_code) {
+/** Map query end code to batch end code index.
+ *
+ * @param end_code Query end code, rcode or negative internal code.
+ *
+ * @return End code index, see @ref metrics_rcode_idx_t.
+ */
+static inline metrics_rcode_idx_t
+query_report_rcode_idx(int end_code)
+{
+    switch (end_code) {
         case 0:
-            atomic_ul = &metrics->dns.queries_rcode_noerror;
-            break;
+            return METRICS_RCODE_NOERROR;
         case 1:
-            atomic_ul = &metrics->dns.queries_rcode_formerr;
-            break;
+            return METRICS_RCODE_FORMERR;
         case 2:
-            atomic_ul = &metrics->dns.queries_rcode_servfail;
-            break;
+            return METRICS_RCODE_SERVFAIL;
         case 3:
-            atomic_ul = &metrics->dns.queries_rcode_nxdomain;
-            break;
+            return METRICS_RCODE_NXDOMAIN;
         case 4:
-            atomic_ul = &metrics->dns.queries_rcode_notimpl;
-            break;
+            return METRICS_RCODE_NOTIMPL;
         case 5:
-            atomic_ul = &metrics->dns.queries_rcode_refused;
-            break;
+            return METRICS_RCODE_REFUSED;
         case 16:
-            atomic_ul = &metrics->dns.queries_rcode_badversion;
-            break;
+            return METRICS_RCODE_BADVERSION;
         case -2:
-            atomic_ul = &metrics->dns.queries_rcode_shortheader;
-            break;
+            return METRICS_RCODE_SHORTHEADER;
         case -3:
-            atomic_ul = &metrics->dns.queries_rcode_toolarge;
-            break;
+            return METRICS_RCODE_TOOLARGE;
         default:
-            break;
-    }
-    if (atomic_ul != NULL) {
-        atomic_fetch_add(atomic_ul, 1);
-    }
-
-    atomic_ul = NULL;
-    switch (q->query_q_type) {
-    case 0:
-        atomic_ul = &metrics->dns.queries_type_invalid;
-        break;
-    case 1:
-        atomic_ul = &metrics->dns.queries_type_A;
-        break;
-    case 2:
-        atomic_ul = &metrics->dns.queries_type_NS;
-        break;
-    case 5:
-        atomic_ul = &metrics->dns.queries_type_CNAME;
-        break;
-    case 6:
-        atomic_ul = &metrics->dns.queries_type_SOA;
-        break;
-    case 12:
-        atomic_ul = &metrics->dns.queries_type_PTR;
-        break;
-    case 15:
-        atomic_ul = &metrics->dns.queries_type_MX;
-        break;
-    case 16:
-        atomic_ul = &metrics->dns.queries_type_TXT;
-        break;
-    case 28:
-        atomic_ul = &metrics->dns.queries_type_AAAA;
-        break;
-    case 33:
-        atomic_ul = &metrics->dns.queries_type_SRV;
-        break;
-    default:
-        break;
-    }
-    if (atomic_ul != NULL) {
-        atomic_fetch_add(atomic_ul, 1);
-    }
-
-    if (q->edns.edns_raw_buf_len > 0) {
-        atomic_fetch_add(&metrics->dns.queries_edns_present, 1);
-    }
-    if (q->edns.edns_valid) {
-        atomic_fetch_add(&metrics->dns.queries_edns_valid, 1);
-    }
-    if (q->edns.dnssec > 0) {
-        atomic_fetch_add(&metrics->dns.queries_edns_dobit, 1);
+            return METRICS_RCODE_OTHER;
+    }
+}
+
+/** Map timed query to path its cost is summed in.
+ *
+ * @param q Timed query.
+ *
+ * @return  Path of query, see @ref metrics_cost_path_t.
+ */
+static inline metrics_cost_path_t
+query_report_cost_path(const query_t *q)
+{
+    if (q->response_slipped || (q->response_hdr != NULL && q->response_hdr->tc)) {
+        return METRICS_COST_TRUNCATED;
+    }
+    if (q->response_cached) {
+        return METRICS_COST_CACHED;
     }
     if (q->edns.client_subnet.edns_cs_valid) {
-        atomic_fetch_add(&metrics->dns.queries_clientsubnet, 1);
+        return METRICS_COST_ECS;
+    }
+    return METRICS_COST_PLAIN;
+}
+
+/** Report query metrics. Counters are accumulated in batch, and are
+ * published to vectorloop metrics by @ref query_report_metrics_flush once
+ * per batch. Latency histograms, sketches, per zone counters and cost of
+ * timed queries are recorded directly.
+ * 
+ * @param q       Query to report metrics for.
+ * @param batch   Batch counters of queries being reported.
+ * @param metrics Vectorloop metrics where to report latency.
+ * @param sketch  Vectorloop query sketches, NULL if queries are not
+ *                sketched.
+ * @param zones   Vectorloop per zone counters, NULL if zones are not
+ *                counted.
+ * @param cost    Vectorloop query cost, NULL if query cost is not sampled.
+ */
+void
+query_report_metrics(query_t *q, metrics_query_batch_t *batch,
+                     metrics_vl_t *metrics, metrics_sketch_vl_t *sketch,
+                     metrics_zone_counters_t *zones, metrics_cost_t *cost)
+{
+    metrics_rcode_idx_t rcode_idx = query_report_rcode_idx(q->end_code);
+    uint8_t             type_idx  = rip_ns_qtype_get(q->query_q_type).idx;
+
+    if (q->protocol == 0 || q->protocol == 1) {
+        batch->queries[q->protocol]++;
+    }
+    batch->rcode[rcode_idx]++;
+    batch->type[type_idx]++;
+
+    batch->edns_present += q->edns.edns_raw_buf_len > 0;
+    batch->edns_valid   += q->edns.edns_valid;
+    batch->edns_dobit   += q->edns.dnssec > 0;
+    batch->clientsubnet += q->edns.client_subnet.edns_cs_valid;
+    batch->cookie       += q->edns.cookie.edns_cookie_valid;
+    batch->cookie_valid += q->edns.cookie.server_cookie_valid;
+
+    query_report_latency(q, metrics);
+
+    if (sketch != NULL) {
+        query_report_sketch(q, sketch);
+    }
+    if (zones != NULL && q->zone_slot != 0) {
+        METRICS_INC(zones[q->zone_slot - 1].queries[rcode_idx][type_idx]);
+    }
+    if (cost != NULL && q->cost_sampled && (q->protocol == 0 || q->protocol == 1)) {
+        metrics_cost_path_t path = query_report_cost_path(q);
+
+        METRICS_INC(cost->queries[q->protocol][path][rcode_idx][type_idx]);
+        METRICS_ADD(cost->cycles[q->protocol][path][rcode_idx][type_idx], q->cost_cycles);
     }
+}
+
+/** Add counter of a batch to vectorloop metrics counter, skipping the store
+ * when batch did not touch the counter.
+ */
+#define QUERY_REPORT_FLUSH(a, n) do { \
+        if ((n) > 0) {                \
+            METRICS_ADD(a, n);        \
+        }                             \
+    } while (0)
+
+/** Publish batch counters to vectorloop metrics and reset batch for next
+ * batch of queries.
+ *
+ * @param batch   Batch counters to publish.
+ * @param metrics Vectorloop metrics where to publish counters.
+ */
+void
+query_report_metrics_flush(metrics_query_batch_t *batch, metrics_vl_t *metrics)
+{
+    uint64_t queries = 0;
+
+    if (batch->queries[0] + batch->queries[1] == 0) {
+        return;
+    }
+
+    QUERY_REPORT_FLUSH(metrics->udp.queries, batch->queries[0]);
+    QUERY_REPORT_FLUSH(metrics->tcp.queries, batch->queries[1]);
+
+    /* Every reported query, answered or dropped, has an rcode. */
+    for (int i = 0; i < METRICS_RCODE_COUNT; i++) {
+        queries += batch->rcode[i];
+    }
+    QUERY_REPORT_FLUSH(metrics->dns.queries, queries);
+
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_noerror,     batch->rcode[METRICS_RCODE_NOERROR]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_formerr,     batch->rcode[METRICS_RCODE_FORMERR]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_servfail,    batch->rcode[METRICS_RCODE_SERVFAIL]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_nxdomain,    batch->rcode[METRICS_RCODE_NXDOMAIN]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_notimpl,     batch->rcode[METRICS_RCODE_NOTIMPL]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_refused,     batch->rcode[METRICS_RCODE_REFUSED]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_badversion,  batch->rcode[METRICS_RCODE_BADVERSION]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_shortheader, batch->rcode[METRICS_RCODE_SHORTHEADER]);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_rcode_toolarge,    batch->rcode[METRICS_RCODE_TOOLARGE]);
+
+    for (int i = 0; i < RIP_NS_QTYPE_IDX_COUNT; i++) {
+        QUERY_REPORT_FLUSH(metrics->dns.queries_type[i], batch->type[i]);
+    }
+
+    QUERY_REPORT_FLUSH(metrics->dns.queries_edns_present, batch->edns_present);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_edns_valid,   batch->edns_valid);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_edns_dobit,   batch->edns_dobit);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_clientsubnet, batch->clientsubnet);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_cookie,       batch->cookie);
+    QUERY_REPORT_FLUSH(metrics->dns.queries_cookie_valid, batch->cookie_valid);
 
-}
\ No newline at end of file
+    memset(batch, 0, sizeof(*batch));
+}
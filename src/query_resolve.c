@@ -22,93 +22,701 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-#include <arpa/inet.h>
-#include <stdlib.h>
+#include <netinet/in.h>
 #include <string.h>
 
-#include <stdio.h>
+#include "constants.h"
+#include "lb.h"
+#include "query.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "zone.h"
 
+/** Add resource records of an RRset to a response section.
+ *
+ * Records that do not fit into the section are not added.
+ *
+ * @param db      Zone database RRset belongs to.
+ * @param rrset   RRset to add.
+ * @param section Response section to add records to.
+ * @param count   Pointer to number of records in section.
+ * @param max     Maximum number of records section can hold.
+ */
+static void
+query_resolve_add_rrset(zone_db_t *db, zone_rrset_t *rrset, rr_record_t **section,
+                        uint8_t *count, uint8_t max)
+{
+    rr_record_t *rr = rrset->rrs;
 
-#include "query.h"
+    for (uint16_t i = 0; i < rrset->rr_count && *count < max; i++) {
+        section[*count] = &rr[i];
+        *count += 1;
+    }
+}
+
+/** Add RRSIG records of a node that cover an RRset type to a response
+ * section, if query has DNSSEC OK bit set.
+ *
+ * Records that do not fit into the section are not added.
+ *
+ * @param q       Query being resolved.
+ * @param db      Zone database node belongs to.
+ * @param node    Node RRset of type belongs to.
+ * @param type    Type RRSIG records cover.
+ * @param section Response section to add records to.
+ * @param count   Pointer to number of records in section.
+ * @param max     Maximum number of records section can hold.
+ *
+ * @return        Returns number of records added.
+ */
+static int
+query_resolve_add_rrsigs(query_t *q, zone_db_t *db, zone_node_t *node, uint16_t type,
+                         rr_record_t **section, uint8_t *count, uint8_t max)
+{
+    zone_rrset_t *sigs  = NULL;
+    int           added = 0;
+    uint16_t      covered;
+
+    if (!q->edns.edns_valid || !q->edns.dnssec ||
+        (sigs = zone_node_rrset_get(db, node, rip_ns_t_rrsig)) == NULL) {
+        return 0;
+    }
+    for (uint16_t i = 0; i < sigs->rr_count && *count < max; i++) {
+        const uint8_t *rdata = sigs->rrs[i].rdata;
+
+        RIP_NS_GET16(covered, rdata);
+        if (covered == type) {
+            section[*count] = &sigs->rrs[i];
+            *count += 1;
+            added++;
+        }
+    }
+    return added;
+}
+
+/** Lower case copy of wire format domain name.
+ *
+ * @param dst Where to store lower cased name, MUST be at least
+ *            RIP_NS_MAXCDNAME + 1 bytes.
+ * @param src Wire format name to copy.
+ *
+ * @return    Returns length of name.
+ */
+static uint16_t
+query_resolve_name_copy(unsigned char *dst, const unsigned char *src)
+{
+    uint16_t len = 0;
+
+    while (src[len] != 0 && len < RIP_NS_MAXCDNAME) {
+        len += src[len] + 1;
+    }
+    len += 1;
+    memcpy(dst, src, len);
+    str_to_lc(dst, len);
+    return len;
+}
+
+/** Add A and AAAA records (glue or in zone addresses) to additional section
+ * for targets of an NS, MX, or SRV RRset.
+ *
+ * @param q     Query to add records to.
+ * @param db    Zone database to lookup targets in.
+ * @param rrset RRset whose targets to lookup.
+ */
+static void
+query_resolve_add_additional(query_t *q, zone_db_t *db, zone_rrset_t *rrset)
+{
+    unsigned char        name[RIP_NS_MAXCDNAME + 1];
+    rr_record_t         *rr     = rrset->rrs;
+    const unsigned char *target = NULL;
+    zone_node_t         *node   = NULL;
+    zone_rrset_t        *addrs  = NULL;
+
+    for (uint16_t i = 0; i < rrset->rr_count; i++) {
+        target = zone_rr_rdata_target(&rr[i]);
+        if (target == NULL) {
+            return;
+        }
+        node = zone_db_lookup(db, name, query_resolve_name_copy(name, target));
+        if (node == NULL) {
+            continue;
+        }
+        if ((addrs = zone_node_rrset_get(db, node, rip_ns_t_a)) != NULL) {
+            query_resolve_add_rrset(db, addrs, q->additional_section,
+                                    &q->additional_section_count, RIP_NS_RESP_MAX_ADDL);
+        }
+        if ((addrs = zone_node_rrset_get(db, node, rip_ns_t_aaaa)) != NULL) {
+            query_resolve_add_rrset(db, addrs, q->additional_section,
+                                    &q->additional_section_count, RIP_NS_RESP_MAX_ADDL);
+        }
+    }
+}
+
+/** Add zone SOA record to authority section, used for negative responses.
+ * If SOA record is the only record of response, response is packed from
+ * precompiled negative response fragment of SOA RRset.
+ *
+ * @param q    Query to add SOA record to.
+ * @param db   Zone database.
+ * @param apex Zone apex node.
+ */
+static void
+query_resolve_add_soa(query_t *q, zone_db_t *db, zone_node_t *apex)
+{
+    zone_rrset_t *soa = zone_node_rrset_get(db, apex, rip_ns_t_soa);
+
+    query_resolve_add_rrset(db, soa, q->authority_section,
+                            &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+    if (query_resolve_add_rrsigs(q, db, apex, rip_ns_t_soa, q->authority_section,
+                                 &q->authority_section_count, RIP_NS_RESP_MAX_NS) == 0 &&
+        soa->neg_wire_len > 0 && q->answer_section_count == 0 &&
+        q->authority_section_count == 1 && q->additional_section_count == 0) {
+        q->response_soa = soa;
+    }
+}
+
+/** Add NSEC or NSEC3 RRset of a node, and RRSIG records covering it, to
+ * authority section, unless node was already added.
+ *
+ * @param q           Query to add records to.
+ * @param db          Zone database.
+ * @param node        Node owning NSEC or NSEC3 RRset, NULL adds nothing.
+ * @param type        Type of RRset, NSEC or NSEC3.
+ * @param added       Nodes already added.
+ * @param added_count Pointer to number of nodes already added.
+ */
+static void
+query_resolve_add_denial_node(query_t *q, zone_db_t *db, zone_node_t *node, uint16_t type,
+                              zone_node_t **added, int *added_count)
+{
+    zone_rrset_t *rrset = NULL;
+
+    if (node == NULL) {
+        return;
+    }
+    for (int i = 0; i < *added_count; i++) {
+        if (added[i] == node) {
+            return;
+        }
+    }
+    added[(*added_count)++] = node;
+    if ((rrset = zone_node_rrset_get(db, node, type)) != NULL) {
+        query_resolve_add_rrset(db, rrset, q->authority_section,
+                                &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+        query_resolve_add_rrsigs(q, db, node, type, q->authority_section,
+                                 &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+    }
+}
+
+/** Add NSEC3 record that matches, or covers, hash of a name to authority
+ * section.
+ *
+ * @param q           Query to add records to.
+ * @param db          Zone database.
+ * @param apex        Zone apex node.
+ * @param denial      NSEC3 chain of zone.
+ * @param cache       NSEC3 hash cache, NULL if there is none.
+ * @param name        Wire format (lower cased) name.
+ * @param name_len    Length of name.
+ * @param match       Add record only if it matches hash of name.
+ * @param added       Nodes already added.
+ * @param added_count Pointer to number of nodes already added.
+ */
+static void
+query_resolve_add_nsec3(query_t *q, zone_db_t *db, zone_node_t *apex,
+                        const zone_denial_t *denial, zone_nsec3_cache_t *cache,
+                        const unsigned char *name, uint16_t name_len, bool match,
+                        zone_node_t **added, int *added_count)
+{
+    uint8_t      hash[ZONE_NSEC3_HASH_LEN];
+    zone_node_t *node  = NULL;
+    bool         exact = false;
+
+    zone_nsec3_hash_cached(cache, db, denial, name, name_len, hash);
+    node = zone_db_nsec3_cover(db, apex, hash, &exact);
+    if (!match || exact) {
+        query_resolve_add_denial_node(q, db, node, rip_ns_t_nsec3, added, added_count);
+    }
+}
+
+/** Add denial of existence proof to authority section of a response for a
+ * query with DNSSEC OK bit set, if zone has a NSEC or NSEC3 chain.
+ *
+ * Proof is looked up in zone chain, see @ref zone_db_nsec_cover() and
+ * @ref zone_db_nsec3_cover(), and depends on response:
+ *
+ * - NXDOMAIN, record covering query name and record covering wildcard at
+ *   closest encloser (NSEC), or closest encloser proof (record matching
+ *   closest encloser and record covering next closer name) and record
+ *   covering wildcard at closest encloser (NSEC3), RFC 4035 3.1.3.2 and
+ *   RFC 5155 7.2.2.
+ * - NODATA, record matching query name (both), RFC 4035 3.1.3.1 and
+ *   RFC 5155 7.2.3.
+ * - NODATA from wildcard, record covering query name and record matching
+ *   wildcard (NSEC), or closest encloser proof and record matching wildcard
+ *   (NSEC3), RFC 4035 3.1.3.4 and RFC 5155 7.2.5.
+ * - Answer from wildcard, record covering query name (NSEC) or record
+ *   covering next closer name (NSEC3), RFC 4035 3.1.3.3 and RFC 5155 7.2.6.
+ *
+ * Records already in section are not added again, and response is no longer
+ * packed from SOA precompiled negative response fragment.
+ *
+ * @param q        Query to add proof to.
+ * @param db       Zone database.
+ * @param apex     Zone apex node.
+ * @param encloser Closest encloser of query name.
+ * @param wildcard Response was synthesized from wildcard at closest encloser.
+ * @param cache    NSEC3 hash cache, NULL if there is none.
+ */
+static void
+query_resolve_add_denial(query_t *q, zone_db_t *db, zone_node_t *apex, zone_node_t *encloser,
+                         bool wildcard, zone_nsec3_cache_t *cache)
+{
+    unsigned char        star[RIP_NS_MAXCDNAME + 1];
+    zone_node_t         *added[3];
+    int                  added_count = 0;
+    const zone_denial_t *denial      = NULL;
+    bool                 nxdomain    = q->end_code == rip_ns_r_nxdomain;
+    bool                 negative    = q->answer_section_count == 0;
+    uint16_t             star_len    = 0;
+    uint16_t             next        = 0;
+
+    if (!q->edns.edns_valid || !q->edns.dnssec || (denial = zone_db_denial(db, apex)) == NULL) {
+        return;
+    }
+    q->response_soa = NULL;
+
+    /* Wildcard name at closest encloser, and next closer name (ancestor of
+     * query name one label longer than closest encloser).
+     */
+    if ((nxdomain || wildcard) && encloser != NULL &&
+        encloser->name_len + 2 <= RIP_NS_MAXCDNAME && q->query_qname_len > encloser->name_len) {
+        star[0] = 1;
+        star[1] = '*';
+        memcpy(star + 2, encloser->name, encloser->name_len);
+        star_len = encloser->name_len + 2;
+        while (q->query_qname_len - next - q->query_qname[next] - 1 > encloser->name_len) {
+            next += q->query_qname[next] + 1;
+        }
+    }
+
+    if (denial->kind == ZONE_DENIAL_NSEC) {
+        query_resolve_add_denial_node(q, db, zone_db_nsec_cover(db, apex, q->query_qname,
+                                                                q->query_qname_len),
+                                      rip_ns_t_nsec, added, &added_count);
+        if (star_len > 0 && negative) {
+            query_resolve_add_denial_node(q, db, zone_db_nsec_cover(db, apex, star, star_len),
+                                          rip_ns_t_nsec, added, &added_count);
+        }
+        return;
+    }
+
+    if (!nxdomain && !wildcard) {
+        query_resolve_add_nsec3(q, db, apex, denial, cache, q->query_qname,
+                                q->query_qname_len, true, added, &added_count);
+        return;
+    }
+    if (star_len == 0) {
+        return;
+    }
+    if (negative) {
+        query_resolve_add_nsec3(q, db, apex, denial, cache, encloser->name,
+                                encloser->name_len, true, added, &added_count);
+    }
+    query_resolve_add_nsec3(q, db, apex, denial, cache, q->query_qname + next,
+                            q->query_qname_len - next, false, added, &added_count);
+    if (negative) {
+        query_resolve_add_nsec3(q, db, apex, denial, cache, star, star_len, !nxdomain,
+                                added, &added_count);
+    }
+}
+
+/** Follow CNAME chain within zone database adding records along the way to
+ * answer section.
+ *
+ * @param q        Query being resolved.
+ * @param db       Zone database.
+ * @param node     Node CNAME RRset belongs to.
+ * @param cname    CNAME RRset to start chasing from.
+ * @param wildcard Node is a wildcard, its CNAME RRset is packed with query
+ *                 name as owner name.
+ */
+static void
+query_resolve_cname_chase(query_t *q, zone_db_t *db, zone_node_t *node,
+                          zone_rrset_t *cname, bool wildcard)
+{
+    unsigned char  name[RIP_NS_MAXCDNAME + 1];
+    zone_rrset_t  *rrset = NULL;
+
+    for (int i = 0; i < QUERY_RESOLVE_CNAME_CHAIN_MAX; i++) {
+        query_resolve_add_rrset(db, cname, q->answer_section,
+                                &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+        query_resolve_add_rrsigs(q, db, node, rip_ns_t_cname, q->answer_section,
+                                 &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+        if (wildcard && i == 0) {
+            q->answer_qname_count = q->answer_section_count;
+        }
+
+        node = zone_db_lookup(db, name,
+                              query_resolve_name_copy(name, cname->rrs[0].rdata));
+        if (node == NULL) {
+            /* Target is not in zone database. */
+            return;
+        }
+        if ((rrset = zone_node_rrset_get(db, node, q->query_q_type)) != NULL) {
+            query_resolve_add_rrset(db, rrset, q->answer_section,
+                                    &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+            query_resolve_add_rrsigs(q, db, node, q->query_q_type, q->answer_section,
+                                     &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+            return;
+        }
+        if ((cname = zone_node_rrset_get(db, node, rip_ns_t_cname)) == NULL) {
+            return;
+        }
+    }
+}
+
+/** Lookup RRset variant of query name and type owned by query name prefixed
+ * with a label.
+ *
+ * @param q     Query being resolved.
+ * @param db    Zone database.
+ * @param label Wire format label, length byte followed by label.
+ *
+ * @return      Returns variant RRset, or NULL if there is none.
+ */
+static zone_rrset_t *
+query_resolve_variant(query_t *q, zone_db_t *db, const unsigned char *label)
+{
+    unsigned char  name[RIP_NS_MAXCDNAME + 1];
+    zone_node_t   *node;
 
+    if (label[0] + 1 + q->query_qname_len > RIP_NS_MAXCDNAME) {
+        return NULL;
+    }
+    memcpy(name, label, label[0] + 1);
+    memcpy(name + label[0] + 1, q->query_qname, q->query_qname_len);
+    if ((node = zone_db_lookup(db, name, label[0] + 1 + q->query_qname_len)) == NULL) {
+        return NULL;
+    }
+    return zone_node_rrset_get(db, node, q->query_q_type);
+}
+
+/** Lookup ECS view RRset variant of query name and type.
+ *
+ * Client subnet is looked up in ECS map and response scope prefix length is
+ * set to that of matched map region, whether or not view has a variant of
+ * query name, since other views might.
+ *
+ * @param q       Query being resolved, MUST have a valid client subnet.
+ * @param db      Zone database.
+ * @param ecs_map ECS map to lookup client subnet in.
+ *
+ * @return        Returns variant RRset, or NULL if client subnet does not
+ *                map to a view or view has no variant of query name and type.
+ */
+static zone_rrset_t *
+query_resolve_ecs_variant(query_t *q, zone_db_t *db, ecs_map_t *ecs_map)
+{
+    edns_client_subnet_t          *cs   = &q->edns.client_subnet;
+    const struct sockaddr_storage *ip   = query_edns_cs_ip(cs);
+    const uint8_t                 *addr;
+    uint16_t                       view;
+
+    if (cs->family == 1) {
+        addr = (const uint8_t *)&((const struct sockaddr_in *)ip)->sin_addr;
+    } else {
+        addr = (const uint8_t *)&((const struct sockaddr_in6 *)ip)->sin6_addr;
+    }
+    if ((view = ecs_map_lookup(ecs_map, cs->family, addr, &cs->scope_mask)) == 0) {
+        return NULL;
+    }
+
+    /* Variant is owned by query name prefixed with view label. */
+    return query_resolve_variant(q, db, ecs_map->views[view - 1]);
+}
+
+/** Lookup geo RRset variant of query name and type, country variant
+ * ("_cc-<country>" label) first and continent variant ("_ct-<continent>"
+ * label) next, see @ref geoip.
+ *
+ * Response scope prefix length of a query with client subnet is widened to
+ * that of GeoIP database network, whether or not there is a variant, since
+ * other countries might have one.
+ *
+ * @param q  Query being resolved, MUST have geo set.
+ * @param db Zone database.
+ *
+ * @return   Returns variant RRset, or NULL if there is none.
+ */
+static zone_rrset_t *
+query_resolve_geo_variant(query_t *q, zone_db_t *db)
+{
+    unsigned char  label[] = "\006_cc-xx";
+    zone_rrset_t  *rrset   = NULL;
+
+    if (q->edns.client_subnet.edns_cs_valid &&
+        q->geo_scope > q->edns.client_subnet.scope_mask) {
+        q->edns.client_subnet.scope_mask = q->geo_scope;
+    }
+    if ((q->geo >> 16) != 0) {
+        label[5] = (unsigned char)(q->geo >> 24);
+        label[6] = (unsigned char)(q->geo >> 16);
+        rrset = query_resolve_variant(q, db, label);
+    }
+    if (rrset == NULL && (q->geo & 0xffff) != 0) {
+        label[3] = 't';
+        label[5] = (unsigned char)(q->geo >> 8);
+        label[6] = (unsigned char)q->geo;
+        rrset = query_resolve_variant(q, db, label);
+    }
+    return rrset;
+}
+
+/** Resolve a zone transfer (AXFR or IXFR) query for a name in zone.
+ *
+ * Zone transfer is only for zone apex name, and only over TCP, where it is
+ * sent by vectorloop from precompiled zone transfer messages. IXFR over UDP
+ * is answered with zone SOA record, which tells client to retry over TCP if
+ * it does not have current zone version (RFC 1995). IXFR over TCP is answered
+ * with a full zone transfer, as zone history is not kept.
+ *
+ * @param q    Query to resolve.
+ * @param db   Zone database.
+ * @param node Node of query name, NULL if name does not exist.
+ * @param apex Closest zone apex of query name.
+ */
+static void
+query_resolve_xfr(query_t *q, zone_db_t *db, zone_node_t *node, zone_node_t *apex)
+{
+    if (node != apex) {
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_notauth);
+    }
+    if (q->protocol == 0) {
+        if (q->query_q_type == rip_ns_t_axfr) {
+            RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_refused);
+        }
+        query_resolve_add_rrset(db, zone_node_rrset_get(db, apex, rip_ns_t_soa),
+                                q->answer_section, &q->answer_section_count,
+                                RIP_NS_RESP_MAX_ANSW);
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_noerror);
+    }
+    if ((q->xfr = zone_db_xfr_find(db, apex)) == NULL) {
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_refused);
+    }
+    q->end_code = rip_ns_r_noerror;
+}
 
+/** Pick RRset minimal ANY response of node is answered with (RFC 8482), first
+ * RRset of node that is not RRSIG. RRsets of a node are sorted by type, so
+ * same RRset is picked for every query.
+ *
+ * @param node Node of query name.
+ *
+ * @return     Returns RRset to answer ANY query with, NULL if node has none.
+ */
+static zone_rrset_t *
+query_resolve_any_rrset(zone_node_t *node)
+{
+    for (uint16_t i = 0; i < node->rrset_count; i++) {
+        if (node->rrsets[i].type != rip_ns_t_rrsig) {
+            return &node->rrsets[i];
+        }
+    }
+    return NULL;
+}
 
-/** Resolve a query and if appropriate pack the answer into response buffer.
+/** Resolve a query against zone database, populating query response sections
+ * and end code.
  * 
- * @param q Query to resolve.
+ * Closest encloser of query name, closest zone apex and zone cut
+ * (delegation) are found in a single descent of zone database reverse label
+ * tree. Depending on what was found the response is one of: REFUSED (not
+ * authoritative for name), referral, NXDOMAIN, NODATA, or answer. Answer for
+ * a name that does not exist is synthesized from wildcard child of closest
+ * encloser, if it has one, with query name as owner name. Before that, a
+ * name that does not exist is matched against zone synthesis rules, and
+ * answer is record synthesized from rule name matches, see
+ * @ref zone_db_synth().
+ *
+ * When ECS map is loaded and query carries a client subnet, answer is taken
+ * from RRset variant of view client subnet maps to, if view has one.
+ * Otherwise, when query has a geo, answer is taken from RRset variant of its
+ * country or continent, if there is one.
+ *
+ * When query has DNSSEC OK bit set, presigned RRSIG records covering answer
+ * RRsets, negative response SOA and delegation DS RRset are added after RRset
+ * they cover. RRSIG records of view variants are not, as they are signed for
+ * variant owner name, not query name. Negative and wildcard responses of a
+ * zone with a NSEC or NSEC3 chain also get denial of existence proof, see
+ * @ref query_resolve_add_denial.
+ *
+ * ANY queries get a minimal response (RFC 8482) with a single RRset of query
+ * name, picked by @ref query_resolve_any_rrset, rather than every RRset of
+ * node. Response is then resolved as if RRset type was asked for, so it is
+ * served from RRset precompiled response fragment, and a small query cannot
+ * be used to amplify a large node.
+ *
+ * Query for a load balanced name and type is answered with a single record
+ * picked from its candidate set by @ref lb_pick(), in place of zone RRset of
+ * that type. Pick differs from query to query, so answer is not cached.
+ *
+ * Zone transfer queries are resolved by @ref query_resolve_xfr.
+ *
+ * @param q       Query to resolve.
+ * @param db      Zone database to resolve query against. If NULL (zone
+ *                database is not yet loaded) query is answered with SERVFAIL.
+ * @param ecs_map ECS map to tailor answer to client subnet with, NULL if ECS
+ *                map is not loaded.
+ * @param lb      Load balancing candidate sets, NULL if there are none.
+ * @param nsec3_cache NSEC3 hash cache, NULL if there is none.
  */
 void
-query_resolve(query_t *q)
+query_resolve(query_t *q, zone_db_t *db, ecs_map_t *ecs_map, const lb_t *lb,
+              zone_nsec3_cache_t *nsec3_cache)
 {
+    zone_match_t   match     = {};
+    zone_node_t   *node      = NULL;
+    zone_node_t   *apex      = NULL;
+    zone_node_t   *cut       = NULL;
+    zone_rrset_t  *rrset     = NULL;
+    bool           wildcard  = false;
+    zone_rrset_t  *ds        = NULL;
+    int            signed_count = 0;
+    rip_ns_qtype_t qtype     = rip_ns_qtype_get(q->query_q_type);
+    const rr_record_t *lb_rr = NULL;
+    bool           all_down  = false;
 
-    static rr_record_t example_com_rr_A = {
-        .class     = rip_ns_c_in,
-        .type      = rip_ns_t_a,
-        .ttl       = 60,
-        .rdata_len = 4,
-    };
-    if (example_com_rr_A.rdata == NULL) {
-        example_com_rr_A.name = q->query_label;
-        example_com_rr_A.name_len = q->query_label_len;
-        example_com_rr_A.rdata = malloc(4);
-        *(uint32_t *)example_com_rr_A.rdata = htonl(INADDR_LOOPBACK);
-    }
-
-    static rr_record_t example_com_rr_NS = {
-        .class     = rip_ns_c_in,
-        .type      = rip_ns_t_ns,
-        .ttl       = 60,
-    };
-    static char *ns_name = "ns.example.com";
-    if (example_com_rr_NS.rdata == NULL) {
-        example_com_rr_NS.name = q->query_label;
-        example_com_rr_NS.name_len = q->query_label_len;
-        example_com_rr_NS.rdata = malloc(16);
-        example_com_rr_NS.rdata_len = rip_ns_name_pton((unsigned char *)ns_name, example_com_rr_NS.rdata, 16);
-        example_com_rr_NS.rdata_len = 16;
-    }
-
-    static rr_record_t example_com_rr_NS_A = {
-        .name_len  = 14,
-        .class     = rip_ns_c_in,
-        .type      = rip_ns_t_a,
-        .ttl       = 60,
-        .rdata_len = 4,
-    };
-    if (example_com_rr_NS_A.rdata == NULL) {
-        example_com_rr_NS_A.name = (unsigned char *)strdup("ns.example.com");
-        example_com_rr_NS_A.rdata = malloc(4);
-        *(uint32_t *)example_com_rr_NS_A.rdata = htonl(INADDR_LOOPBACK);
-    }
-
-    static rr_record_t example_com_rr_NS_AAAA = {
-        .name_len  = 14,
-        .class     = rip_ns_c_in,
-        .type      = rip_ns_t_aaaa,
-        .ttl       = 60,
-        .rdata_len = 16,
-    };
-    if (example_com_rr_NS_AAAA.rdata == NULL) {
-        example_com_rr_NS_AAAA.name = (unsigned char *)strdup("ns.example.com");
-        example_com_rr_NS_AAAA.rdata = malloc(16);
-        struct in6_addr in6 = IN6ADDR_LOOPBACK_INIT;
-        memcpy(example_com_rr_NS_AAAA.rdata, &in6 , 16);
+    if (db == NULL) {
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_servfail);
+    }
+
+    if (q->query_qname_len == 0) {
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_formerr);
+    }
+
+    /* Find exact match node, closest zone apex and highest zone cut. */
+    zone_db_match_hash(db, q->query_qname, q->query_qname_len, q->query_qname_hash, &match);
+    node = match.node;
+    apex = match.apex;
+    cut  = match.cut;
+
+    /* DS records are served from parent side of zone cut. */
+    if (cut != NULL && cut == node && q->query_q_type == rip_ns_t_ds) {
+        cut = NULL;
+    }
+
+    if (apex == NULL) {
+        /* Not authoritative for this name. */
+        q->authoritative = false;
+        RIP_NS_QUERY_SET_END_CODE_AND_RETURN(q, rip_ns_r_refused);
+    }
+    if (db->zone_slots != NULL) {
+        q->zone_slot = db->zone_slots[apex->zone];
+    }
+
+    if (qtype.flags & RIP_NS_QTYPE_F_XFR) {
+        query_resolve_xfr(q, db, node, apex);
+        return;
     }
 
     q->end_code = rip_ns_r_noerror;
 
-    /* answer section */
-    q->answer_section[q->answer_section_count] = &example_com_rr_A;
-    q->answer_section_count += 1;
+    if (cut != NULL) {
+        /* Referral to delegated zone. */
+        q->authoritative = false;
+        rrset = zone_node_rrset_get(db, cut, rip_ns_t_ns);
+        query_resolve_add_rrset(db, rrset, q->authority_section,
+                                &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+        if (q->edns.edns_valid && q->edns.dnssec &&
+            (ds = zone_node_rrset_get(db, cut, rip_ns_t_ds)) != NULL) {
+            /* Signed delegation, DS RRset is signed by this zone. */
+            query_resolve_add_rrset(db, ds, q->authority_section,
+                                    &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+            query_resolve_add_rrsigs(q, db, cut, rip_ns_t_ds, q->authority_section,
+                                     &q->authority_section_count, RIP_NS_RESP_MAX_NS);
+        }
+        query_resolve_add_additional(q, db, rrset);
+        return;
+    }
+
+    if (node == NULL && db->synths_count > 0 &&
+        zone_db_synth(db, q->query_qname, q->query_qname_len, &q->synth_rr,
+                      q->synth_rdata) != NULL) {
+        /* Synthesized record, name exists only with its type. */
+        if ((qtype.flags & RIP_NS_QTYPE_F_ANY) || q->query_q_type == q->synth_rr.type) {
+            q->synth_rr.name      = q->query_label;
+            q->synth_rr.name_len  = q->query_label_len;
+            q->answer_section[0]  = &q->synth_rr;
+            q->answer_section_count = 1;
+            q->answer_qname_count   = 1;
+        } else {
+            query_resolve_add_soa(q, db, apex);
+        }
+        return;
+    }
+
+    if (node == NULL && match.wildcard != NULL) {
+        /* Answer synthesized from wildcard, closest encloser is in zone. */
+        node = match.wildcard;
+        wildcard = true;
+        q->answer_wildcard = true;
+    }
 
-    /* authority section */
-    q->authority_section[q->authority_section_count] = &example_com_rr_NS;
-    q->authority_section_count += 1;
+    if (node == NULL) {
+        /* Name does not exist. */
+        q->end_code = rip_ns_r_nxdomain;
+        query_resolve_add_soa(q, db, apex);
+        query_resolve_add_denial(q, db, apex, match.encloser, false, nsec3_cache);
+        return;
+    }
 
-    /* additional section */
-    q->additional_section[q->additional_section_count] = &example_com_rr_NS_A;
-    q->additional_section_count += 1;
-    q->additional_section[q->additional_section_count] = &example_com_rr_NS_AAAA;
-    q->additional_section_count += 1;
+    if (lb != NULL && !wildcard && !(qtype.flags & RIP_NS_QTYPE_F_ANY) &&
+        (lb_rr = lb_pick(lb, q->query_qname, q->query_qname_len, q->query_qname_hash,
+                         q->query_q_type, q->query_qname_hash ^ q->request_hdr->id,
+                         &all_down)) != NULL) {
+        /* Load balanced answer, packed with query name as owner name. */
+        q->answer_section[0]    = (rr_record_t *)lb_rr;
+        q->answer_section_count = 1;
+        q->answer_qname_count   = 1;
+        q->response_cache_hash  = 0;
+        q->lb_answer            = true;
+        q->lb_all_down          = all_down;
+    } else if (!(qtype.flags & RIP_NS_QTYPE_F_ANY) && !wildcard &&
+        ((ecs_map != NULL && q->edns.client_subnet.edns_cs_valid &&
+          (rrset = query_resolve_ecs_variant(q, db, ecs_map)) != NULL) ||
+         (q->geo != 0 && (rrset = query_resolve_geo_variant(q, db)) != NULL))) {
+        /* View or geo variant, packed with query name as owner name. */
+        query_resolve_add_rrset(db, rrset, q->answer_section,
+                                &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+        q->answer_qname_count = q->answer_section_count;
+        query_resolve_add_additional(q, db, rrset);
+    } else if ((rrset = (qtype.flags & RIP_NS_QTYPE_F_ANY) ? query_resolve_any_rrset(node) :
+                zone_node_rrset_get(db, node, q->query_q_type)) != NULL) {
+        query_resolve_add_rrset(db, rrset, q->answer_section,
+                                &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+        /* Precompiled response fragment does not have RRSIG records. */
+        signed_count = rrset->type == rip_ns_t_rrsig ? 0 :
+            query_resolve_add_rrsigs(q, db, node, rrset->type, q->answer_section,
+                                     &q->answer_section_count, RIP_NS_RESP_MAX_ANSW);
+        if (wildcard) {
+            q->answer_qname_count = q->answer_section_count;
+        }
+        query_resolve_add_additional(q, db, rrset);
+        if (!wildcard && rrset->wire_len > 0 && signed_count == 0 &&
+            q->query_question_len == node->name_len + RIP_NS_QFIXEDSZ) {
+            q->response_rrset = rrset;
+        }
+    } else if ((rrset = zone_node_rrset_get(db, node, rip_ns_t_cname)) != NULL) {
+        query_resolve_cname_chase(q, db, node, rrset, wildcard);
+    }
 
-}
\ No newline at end of file
+    if (q->answer_section_count == 0) {
+        /* Name exists but has no data of requested type (NODATA). */
+        query_resolve_add_soa(q, db, apex);
+        query_resolve_add_denial(q, db, apex, match.encloser, wildcard, nsec3_cache);
+    } else if (wildcard) {
+        /* Query name does not exist, only wildcard does. */
+        query_resolve_add_denial(q, db, apex, match.encloser, wildcard, nsec3_cache);
+    }
+}
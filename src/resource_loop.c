@@ -24,10 +24,17 @@
  */
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -37,6 +44,10 @@
 #include "config.h"
 #include "constants.h"
 #include "utils.h"
+#include "views.h"
+#include "worker.h"
+#include "zone.h"
+#include "zone_catalog.h"
 
 
 /** Resource loop function states. */
@@ -46,49 +57,361 @@ enum resource_loop_states {
 
     /* Resource Loop State: Get next resource to check. */
     GET_NEXT_RESOURCE,
-
-    /* Resource Loop State: Wait for all Vectorloop threads to signal they have
-     * processed the resource change.
-     */
-    WAIT_FOR_RESOURCE_UPDATE,
 };
 
-/** Function checks if all vectorloop threads have signaled the resource thread
- * that they processed the latest resource change they were notified of.
+/** Function initializes resource set, no resources are published and
+ * vectorloops start offline.
  * 
- * @note This is a helper function for @ref resource_loop().
+ * @param set      Resource set to initialize.
+ * @param vl_count Number of readers of resource set, vectorloops and health
+ *                 checker thread, see @ref lb_check_loop().
+ */
+void
+resource_set_init(resource_set_t *set, size_t vl_count)
+{
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        atomic_init(&set->resources[i], NULL);
+    }
+    qsbr_init(&set->qsbr, vl_count);
+
+    set->secondary      = NULL;
+    set->response_cache = NULL;
+    set->reload_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (set->reload_fd == -1) {
+        fprintf(stderr, "Error creating resource reload eventfd: %s\n", strerror(errno));
+        exit(1);
+    }
+    /* Without inotify resources are only polled for change. */
+    set->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+/** Function releases memory held by resource set, published resources are
+ * not released.
  * 
- * @param resource_channels   Array of resource channels.
- * @param vl_notifications Array of vector loop notifications.
- * @param count            Size of arrays. They MUST both match in size.
+ * @param set Resource set to clean.
+ */
+void
+resource_set_clean(resource_set_t *set)
+{
+    qsbr_clean(&set->qsbr);
+    close(set->reload_fd);
+    if (set->watch_fd >= 0) {
+        close(set->watch_fd);
+    }
+}
+
+/** Function wakes resource thread to check all resources for change right
+ * away, instead of waiting for their update frequency to elapse. It is safe
+ * to call from any thread.
  * 
- * @return                 Returns true if all vectorloop threads have processed
- *                         latest resource update, otherwise returns false.
+ * @param set Resource set resource thread updates.
+ */
+void
+resource_set_reload(resource_set_t *set)
+{
+    eventfd_write(set->reload_fd, 1);
+}
+
+/** Function watches directory holding file for file to be written or
+ * renamed into place. Directory rather than file is watched, as watch on file
+ * would stay with file an atomic rename replaced.
+ *
+ * @note This is a helper function for @ref resource_watch().
+ *
+ * @param watch_fd Inotify instance to add watch to.
+ * @param filepath Path of file to watch.
+ *
+ * @return         Returns watch descriptor, or -1 if watch could not be
+ *                 added.
+ */
+static int
+resource_watch_path(int watch_fd, const char *filepath)
+{
+    char        dir[PATH_MAX];
+    const char *slash = strrchr(filepath, '/');
+    size_t      len;
+
+    if (slash == NULL) {
+        return inotify_add_watch(watch_fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+    len = slash == filepath ? 1 : (size_t)(slash - filepath);
+    if (len >= sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(dir, filepath, len);
+    dir[len] = '\0';
+
+    return inotify_add_watch(watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+}
+
+/** Function watches resource file, and delta file if resource has one, for
+ * change, unless they are watched already. Resource is polled for change
+ * while it is not watched, so watch is retried each time it is checked.
+ *
+ * @note This is a helper function for @ref resource_loop().
+ *
+ * @param set      Resource set resource thread updates.
+ * @param resource Resource to watch.
+ *
+ * @return         Returns true if resource file is watched.
  */
 static bool
-resource_vls_notified(channel_bss_t *resource_channels, bool *vl_notifications, size_t count)
+resource_watch(resource_set_t *set, resource_t *resource)
+{
+    if (set->watch_fd < 0 || resource->filepath[0] == '\0') {
+        return false;
+    }
+    if (resource->watch_wd < 0) {
+        resource->watch_wd = resource_watch_path(set->watch_fd, resource->filepath);
+    }
+    if (resource->delta_watch_wd < 0 &&
+        resource->delta_filepath != NULL && resource->delta_filepath[0] != '\0') {
+        resource->delta_watch_wd = resource_watch_path(set->watch_fd,
+                                                       resource->delta_filepath);
+    }
+
+    return resource->watch_wd >= 0;
+}
+
+/** Function checks if file inotify event is for is file at path in watched
+ * directory.
+ *
+ * @note This is a helper function for @ref resource_watch_events().
+ *
+ * @param ev       Inotify event.
+ * @param wd       Watch descriptor of directory holding file at path.
+ * @param filepath Path of file.
+ *
+ * @return         Returns true if event is for file.
+ */
+static bool
+resource_watch_match(const struct inotify_event *ev, int wd, const char *filepath)
+{
+    const char *slash = strrchr(filepath, '/');
+
+    return wd >= 0 && ev->wd == wd && ev->len > 0 &&
+           strcmp(ev->name, slash != NULL ? slash + 1 : filepath) == 0;
+}
+
+/** Function reads pending inotify events and has resources whose file or
+ * delta file changed checked right away. If events were lost, all resources
+ * are checked. Watch of directory that was removed is dropped, resources in
+ * it are polled until watch can be added again.
+ *
+ * @note This is a helper function for @ref resource_wait().
+ *
+ * @param set       Resource set resource thread updates.
+ * @param resources Array of resources.
+ * @param count     Number of resources.
+ */
+static void
+resource_watch_events(resource_set_t *set, resource_t *resources, int count)
+{
+    _Alignas(struct inotify_event) char buf[RESOURCE_LOOP_WATCH_BUFFER_LEN];
+    const struct inotify_event        *ev;
+    ssize_t                            len;
+
+    while ((len = read(set->watch_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *)p;
+            for (int i = 0; i < count; i++) {
+                resource_t *r = &resources[i];
+
+                if (ev->mask & IN_Q_OVERFLOW ||
+                    resource_watch_match(ev, r->watch_wd, r->filepath) ||
+                    (r->delta_filepath != NULL &&
+                     resource_watch_match(ev, r->delta_watch_wd, r->delta_filepath))) {
+                    r->next_update_time.tv_sec  = 0;
+                    r->next_update_time.tv_nsec = 0;
+                }
+                if (ev->mask & IN_IGNORED) {
+                    if (r->watch_wd == ev->wd) {
+                        r->watch_wd                 = -1;
+                        r->next_update_time.tv_sec  = 0;
+                        r->next_update_time.tv_nsec = 0;
+                    }
+                    if (r->delta_watch_wd == ev->wd) {
+                        r->delta_watch_wd = -1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Function waits until it is time to check next resource, until a watched
+ * resource changes, or until resource thread is asked to check all resources
+ * right away, see @ref resource_set_reload().
+ * 
+ * @note This is a helper function for @ref resource_loop().
+ * 
+ * @param set       Resource set resource thread updates.
+ * @param wait_time How long to wait.
+ * @param resources Array of resources.
+ * @param count     Number of resources.
+ */
+static void
+resource_wait(resource_set_t *set, const struct timespec *wait_time,
+              resource_t *resources, int count)
+{
+    struct pollfd pfd[2] = {
+        { .fd = set->reload_fd, .events = POLLIN },
+        { .fd = set->watch_fd,  .events = POLLIN },
+    };
+    eventfd_t     value  = 0;
+
+    if (ppoll(pfd, set->watch_fd >= 0 ? 2 : 1, wait_time, NULL) <= 0) {
+        return;
+    }
+    if (pfd[1].revents & POLLIN) {
+        resource_watch_events(set, resources, count);
+    }
+    if (!(pfd[0].revents & POLLIN) || eventfd_read(set->reload_fd, &value) != 0) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        resources[i].next_update_time.tv_sec  = 0;
+        resources[i].next_update_time.tv_nsec = 0;
+    }
+}
+
+/** Function releases retired resources once all vectorloops have passed a
+ * quiescent state since they were retired.
+ * 
+ * @note This is a helper function for @ref resource_loop().
+ * 
+ * @param resources       Array of resources.
+ * @param count           Number of resources.
+ * @param qsbr            QSBR domain resources are retired in.
+ * @param app_log_channel Application log channel, to log vectorloop that
+ *                        does not pass a quiescent state in time.
+ * 
+ * @return                Returns number of retired resources still waiting to
+ *                        be released.
+ */
+static int
+resource_reclaim(resource_t *resources, int count, qsbr_t *qsbr,
+                 channel_log_t *app_log_channel)
 {
-    channel_bss_msg_t *ch_msg = NULL;
+    int waiting = 0;
 
     for (int i = 0; i < count; i++) {
-        if (vl_notifications[i] == false) {
-            if (channel_bssvl_recv(&resource_channels[i], &ch_msg) == 1) {
-                vl_notifications[i] = true;
-                ch_msg->p = NULL;
-                channel_bss_msg_release(ch_msg);
-            } else {
-                /* Notification from vectorloop not received yet. */
-                return false;
+        resource_t *resource = &resources[i];
+
+        if (resource->retired_resource == NULL) {
+            continue;
+        }
+        if (qsbr_passed(qsbr, resource->retire_epoch)) {
+            resource->release_fn(resource, resource->retired_resource);
+            resource->retired_resource = NULL;
+            continue;
+        }
+
+        /* If a vectorloop thread takes more than 10s to run a single loop it
+         * means that something is wrong and it is blocked. There SHOULD be
+         * no blocking operations in vectorloop. Message is logged and
+         * application exits!
+         */
+        uint64_t now_us = utl_clock_monotonic_us_fatal();
+        if (now_us - resource->retire_time_us > VL_RESOURCE_NOTIFY_WAIT_TIME_MAX) {
+            channel_log_send(app_log_channel, 0, true,
+                             "Vectorloop resource update timed out (10s) for resource \"%s\"",
+                             resource->filepath);
+            resource->retire_time_us = now_us;
+        }
+        waiting++;
+    }
+    return waiting;
+}
+
+/** Warm up zone database before it is published to vectorloops, so first
+ * queries after load or reload do not take page faults. Its memory is
+ * prefaulted and locked in memory, as configured. Locking failure is logged
+ * and database is published unlocked.
+ *
+ * @param cfg             Application configuration.
+ * @param resource        Zone database resource.
+ * @param db              Zone database to warm up.
+ * @param app_log_channel Channel application log messages are sent to.
+ */
+static void
+resource_zone_db_warm(config_t *cfg, resource_t *resource, zone_db_t *db,
+                      channel_log_t *app_log_channel)
+{
+    uint64_t start_us   = utl_clock_monotonic_us_fatal();
+    size_t   prefaulted = 0;
+    size_t   locked     = 0;
+    int      ret;
+
+    if (cfg->zone_prefault) {
+        prefaulted = zone_db_prefault(db);
+    }
+    if (cfg->zone_mlock) {
+        ret = zone_db_mlock(db, &locked);
+        if (ret < 0) {
+            channel_log_send(app_log_channel, 0, false,
+                             "Could not lock zone database \"%s\" in memory, %s",
+                             resource->filepath, strerror(-ret));
+        }
+    }
+    channel_log_send(app_log_channel, 0, false,
+                     "Zone database \"%s\" warmed up, %zu bytes prefaulted, "
+                     "%zu bytes locked, in %" PRIu64 " us",
+                     resource->filepath, prefaulted, locked,
+                     utl_clock_monotonic_us_fatal() - start_us);
+}
+
+/** Register zones of a zone database, views or zone catalog resource in per
+ * zone metrics slots before it is published to vectorloops, see
+ * @ref metrics_zones_register(). Of a zone catalog only zone databases its
+ * generation loaded are registered, others are shared with generation it
+ * replaced. Does nothing for other resources, or if zones are not counted.
+ *
+ * @param metrics      Metrics object.
+ * @param resource     Resource.
+ * @param new_resource Loaded resource.
+ */
+static void
+resource_zones_register(metrics_t *metrics, resource_t *resource, void *new_resource)
+{
+    static const unsigned char main_view[1] = { 0 };
+    views_t                   *views;
+    zone_catalog_t            *catalog;
+    zone_db_t                 *db;
+
+    if (metrics->zones == NULL) {
+        return;
+    }
+    if (resource->id == RESOURCE_ID_ZONE_DB) {
+        metrics_zones_register(metrics, main_view, new_resource);
+    } else if (resource->id == RESOURCE_ID_VIEWS) {
+        views = new_resource;
+        for (uint16_t i = 0; i < views->count; i++) {
+            if (views->zone_dbs[i] != NULL) {
+                metrics_zones_register(metrics, views->labels[i], views->zone_dbs[i]);
+            }
+        }
+    } else if (resource->id == RESOURCE_ID_CATALOG) {
+        catalog = new_resource;
+        for (uint32_t k = 0; k < catalog->pages_count; k++) {
+            for (uint32_t i = 0; i < ZONE_CATALOG_PAGE_ZONES; i++) {
+                db = catalog->pages[k]->dbs[i];
+                if (db != NULL &&
+                    ((db->generation & ~ZONE_CATALOG_GENERATION_BIT) >> 32) ==
+                    catalog->generation) {
+                    metrics_zones_register(metrics, main_view, db);
+                }
             }
         }
     }
-    return true;
 }
 
 
 /** Resource loop function. It periodically checks resources for change. On
- * resource change it loads the new resource into memory and notifies each
- * vectorloop thread that resource changed.
+ * resource change it loads the new resource into memory and publishes it to
+ * vectorloop threads, see @ref resource_set_t. Resource it replaced is
+ * released once all vectorloops passed a quiescent state.
  * 
  * @note This loop runs indefinitely and is meant to be run from the main()
  * function, not on vectorloop thread, or any other tread.
@@ -100,7 +423,7 @@ resource_loop(void *args)
 {
     resource_loop_args_t   *res_args          = (resource_loop_args_t *)args;
     config_t               *cfg               = res_args->cfg;
-    channel_bss_t          *resource_channels = res_args->resource_channels;
+    resource_set_t         *resource_set      = res_args->resources;
     channel_log_t          *app_log_channel   = res_args->app_log_channel;
     metrics_t              *metrics           = res_args->metrics;
 
@@ -110,6 +433,7 @@ resource_loop(void *args)
     double                  top_delta_time    = RESOURCE_LOOP_TOP_DELTA_TIME;
     int                     next_res_index    = 0;
     resource_check_load_fn  check_load;
+    resource_t             *resource;
 
     /* Array of all resources that are updated by this resource loop. */
     resource_t resources[RESOURCE_COUNT];
@@ -118,127 +442,222 @@ resource_loop(void *args)
      * encountered. */
     char    err[ERR_MSG_LENGTH];
 
-    int     res_count         = RESOURCE_COUNT;
+    int     res_count         = 0;
     void   *new_resource      = NULL;
     size_t  new_resource_len  = 0;
-    int     vl_count          = cfg->process_thread_count;
-
-    /* Array that holds VL notifications for resource update acknowledgments. */
-    bool               vl_notifications[vl_count];
+    int     ret               = 0;
 
-    channel_bss_msg_t *ch_msg;
-    uint64_t           channel_msg_id_base = 0;
-    int                ret                 = 0;
-
-    /* used to track how long resource loop waits for all notifications from VL
-     * threads to be received. */
-    size_t vectorloop_update_wait_time = 0;
+    /* Number of retired resources waiting to be released. */
+    int     reclaim_waiting   = 0;
 
     /* Starting state of resource loop. */
     enum resource_loop_states state = CHECK_RESOURCE;
 
-    /* Initialize channels on this thread(core). */
-    LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+    /* Helper threads zone database is built on along with this thread. */
+    worker_pool_t zone_workers    = {};
+
+    /* Registry of resources this loop can update. Each resource registers
+     * functions to load, compile and release its data, resources with no file
+     * configured are not loaded. Zone database has its own load function as
+     * it also applies zone delta file and secondary zone updates, it is
+     * loaded with no zone file when there are secondary zones.
+     */
+    resource_t registry[RESOURCE_COUNT] = {
+        {
+            .name             = cfg->resource_1_name,
+            .filepath         = cfg->resource_1_filepath,
+            .delta_filepath   = cfg->resource_1_delta_filepath,
+            .update_frequency = cfg->resource_1_update_freq,
+            .id               = RESOURCE_ID_ZONE_DB,
+            .check_load_fn    = &resource_check_load_zone_db,
+            .release_fn       = &resource_release_zone_db,
+            .secondary        = resource_set->secondary,
+            .workers          = cfg->zone_compile_threads > 1 ? &zone_workers : NULL,
+        },
+        {
+            .name             = cfg->resource_2_name,
+            .filepath         = cfg->resource_2_filepath,
+            .update_frequency = cfg->resource_2_update_freq,
+            .id               = RESOURCE_ID_ECS_MAP,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_ecs_map,
+            .release_fn       = &resource_release_ecs_map,
+        },
+        {
+            .name             = cfg->resource_3_name,
+            .filepath         = cfg->resource_3_filepath,
+            .update_frequency = cfg->resource_3_update_freq,
+            .id               = RESOURCE_ID_CONFIG,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_config,
+            .release_fn       = &resource_release_config,
+            .cfg              = cfg,
+        },
+        {
+            .name             = cfg->resource_4_name,
+            .filepath         = cfg->resource_4_filepath,
+            .update_frequency = cfg->resource_4_update_freq,
+            .id               = RESOURCE_ID_VIEWS,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_views,
+            .release_fn       = &resource_release_views,
+        },
+        {
+            .name             = cfg->resource_5_name,
+            .filepath         = cfg->resource_5_filepath,
+            .update_frequency = cfg->resource_5_update_freq,
+            .id               = RESOURCE_ID_ACL,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_acl,
+            .release_fn       = &resource_release_acl,
+        },
+        {
+            .name             = cfg->resource_6_name,
+            .filepath         = cfg->resource_6_filepath,
+            .update_frequency = cfg->resource_6_update_freq,
+            .id               = RESOURCE_ID_POLICY,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_policy,
+            .release_fn       = &resource_release_policy,
+        },
+        {
+            .name             = cfg->resource_7_name,
+            .filepath         = cfg->resource_7_filepath,
+            .update_frequency = cfg->resource_7_update_freq,
+            .id               = RESOURCE_ID_GEOIP,
+            .check_load_fn    = &resource_check_load_geoip,
+            .release_fn       = &resource_release_geoip,
+        },
+        {
+            .name             = cfg->resource_8_name,
+            .filepath         = cfg->resource_8_filepath,
+            .update_frequency = cfg->resource_8_update_freq,
+            .id               = RESOURCE_ID_LB,
+            .check_load_fn    = &resource_check_load_compiled,
+            .compile_fn       = &resource_compile_lb,
+            .release_fn       = &resource_release_lb,
+        },
+        {
+            .name             = cfg->resource_9_name,
+            .filepath         = cfg->resource_9_filepath,
+            .update_frequency = cfg->resource_9_update_freq,
+            .id               = RESOURCE_ID_CATALOG,
+            .check_load_fn    = &resource_check_load_catalog,
+            .release_fn       = &resource_release_catalog,
+        },
+    };
+
+    /* Start zone build helper threads, they inherit CPU binding of this
+     * thread.
+     */
+    if (cfg->zone_compile_threads > 1) {
+        int wake_fd = eventfd(0, EFD_CLOEXEC);
+
+        if (wake_fd < 0) {
+            fprintf(stderr, "Error creating zone build eventfd: %s\n", strerror(errno));
+            exit(1);
+        }
+        worker_pool_start(&zone_workers, cfg->zone_compile_threads - 1, wake_fd);
+    }
 
     /* Initialize resources. */
-    resources[0] = (resource_t) {};
-    resources[0].name = cfg->resource_1_name;
-    resources[0].filepath = cfg->resource_1_filepath;
-    resources[0].channel_op = CH_OP_RES_SET_RESOURCE1;
-    resources[0].update_frequency = 5;
-    resources[0].next_update_time.tv_sec = 0;
-    resources[0].next_update_time.tv_nsec = 0;
-    resources[0].check_load_fn = &resource_check_load_raw_file;
-    resources[0].release_fn = &resource_release_raw_file;
-    resources[0].current_resource = NULL;
-    resources[0].incoming_resource = NULL;
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        if (registry[i].filepath[0] != '\0' || registry[i].secondary != NULL) {
+            registry[i].watch_wd       = -1;
+            registry[i].delta_watch_wd = -1;
+            resources[res_count++]     = registry[i];
+        }
+    }
+    if (res_count == 0) {
+        return NULL;
+    }
 
     /* Check for updates and load updates when change in resource detected. */
     while (1) {
         switch (state) {
         case CHECK_RESOURCE:
-            /* Call check_load. */
-            check_load = resources[next_res_index].check_load_fn;
+            resource = &resources[next_res_index];
             memset(err, '\0', ERR_MSG_LENGTH);
-            ret = check_load(&resources[next_res_index], &new_resource, &new_resource_len,
-                             err, ERR_MSG_LENGTH);
-            debug_printf("resource index %d, check_load returned %d", next_res_index, ret);
+            if (resource->retired_resource != NULL) {
+                /* Resource this one replaced is not released yet, check for
+                 * change next time.
+                 */
+                ret = 0;
+            } else {
+                /* Call check_load. */
+                check_load = resource->check_load_fn;
+                ret = check_load(resource, &new_resource, &new_resource_len,
+                                 err, ERR_MSG_LENGTH);
+                debug_printf("resource index %d, check_load returned %d", next_res_index, ret);
+            }
 
             if (ret == 1) {
-                /* Update present so notify vectorloops via channels and
-                 * wait for all notifications to return.
+                /* Update present so publish it to vectorloops, and retire
+                 * resource it replaced.
                  */
-                resources[next_res_index].incoming_resource = new_resource;
-                for (int i = 0; i < vl_count; i++) {
-                    vl_notifications[i] = false;
-                    ch_msg = channel_bss_msg_create(channel_bss_assign_msg_id(&channel_msg_id_base),
-                                                    resources[next_res_index].channel_op,
-                                                    new_resource);
-                    channel_bss_send(&resource_channels[i], ch_msg);
-                    debug_print("channel message sent from resource loop to vector loop");
+                if (resource->id == RESOURCE_ID_ZONE_DB &&
+                    (cfg->zone_prefault || cfg->zone_mlock)) {
+                    resource_zone_db_warm(cfg, resource, new_resource, app_log_channel);
                 }
-                vectorloop_update_wait_time = 0;
-                state = WAIT_FOR_RESOURCE_UPDATE;
-            } else if (ret == 0) {
-                /* Resource has not changed, move to state GET_NEXT_RESOURCE */
-                state = GET_NEXT_RESOURCE;
-            } else {
+                resource_zones_register(metrics, resource, new_resource);
+                atomic_store_explicit(&resource_set->resources[resource->id], new_resource,
+                                      memory_order_release);
+                resource->retired_resource = resource->current_resource;
+                resource->current_resource = new_resource;
+                resource->retire_epoch     = qsbr_retire(&resource_set->qsbr);
+                resource->retire_time_us   = utl_clock_monotonic_us_fatal();
+                debug_print("resource published to vector loops");
+                if (resource->id == RESOURCE_ID_ZONE_DB) {
+                    atomic_store_explicit(&metrics->mem.zone_bytes,
+                                          zone_db_memory(new_resource), memory_order_relaxed);
+                }
+                if (resource->id == RESOURCE_ID_CONFIG) {
+                    channel_log_send(app_log_channel, 0, false,
+                                     "Configuration file \"%s\" loaded, generation %" PRIu64,
+                                     resource->filepath,
+                                     ((config_t *)new_resource)->generation);
+                }
+            } else if (ret < 0) {
                 /* Error reading in file. Log and try again later on. Keep using
                  * the old file.
                  */
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "Error opening resource file \"%s\", %s",
-                         resources[next_res_index].filepath, err);
-                channel_log_msg_t *cmsg = channel_log_msg_create(0, err_str, false);
-                channel_log_send(app_log_channel, cmsg);
+                channel_log_send(app_log_channel, 0, false,
+                                 "Error opening resource file \"%s\", %s",
+                                 resource->filepath, err);
 
                 atomic_fetch_add(&metrics->app.resource_reload_error, 1);
+            } else if (err[0] != '\0') {
+                /* Resource loaded, but some of its parts could not be, e.g.
+                 * zones of zone catalog. They keep what they had.
+                 */
+                channel_log_send(app_log_channel, 0, false,
+                                 "Error loading resource file \"%s\", %s",
+                                 resource->filepath, err);
 
-                state = GET_NEXT_RESOURCE;
+                atomic_fetch_add(&metrics->app.resource_reload_error, 1);
             }
+            state = GET_NEXT_RESOURCE;
 
-            /* Update next check time for this resource. */
-            utl_clock_gettime_rt_fatal(&resources[next_res_index].next_update_time);
-            resources[next_res_index].next_update_time.tv_sec += 
-                                resources[next_res_index].update_frequency;             
-            break;
-
-        case WAIT_FOR_RESOURCE_UPDATE:
-            /* Check if all vl loops returned notifications */
-            if (resource_vls_notified(resource_channels, vl_notifications, vl_count) == true) {
-                /* All Vectorloops updated. */
-                resources[next_res_index].release_fn(&resources[next_res_index],
-                                                     resources[next_res_index].current_resource);
-                resources[next_res_index].current_resource = resources[0].incoming_resource;
-                resources[next_res_index].incoming_resource = NULL;
-                state = GET_NEXT_RESOURCE;
+            /* Update next check time for this resource, watched resource is
+             * checked once it changes and only polled as a fallback. Change
+             * while resource it replaced is not released yet is not seen
+             * until its next check, so it is polled until then.
+             */
+            utl_clock_gettime_rt_fatal(&resource->next_update_time);
+            if (resource->retired_resource == NULL &&
+                resource_watch(resource_set, resource) &&
+                resource->update_frequency < RESOURCE_LOOP_WATCH_POLL_INTERVAL) {
+                resource->next_update_time.tv_sec += RESOURCE_LOOP_WATCH_POLL_INTERVAL;
             } else {
-                /* Not all vectorloops updated, wait 1us and check again.
-                 * We wait for 10 seconds (const VL_RESOURCE_NOTIFY_WAIT_TIME_MAX)
-                 * and if not all vectorloops have responded message is logged and
-                 * application exits!
-                 * 
-                 * If a vectorloop thread takes more than
-                 * 10s to run a single loop it means that something is wrong and it
-                 * is blocked. There SHOULD be no blocking operations in vectorloop.
-                 */
-                if (vectorloop_update_wait_time > VL_RESOURCE_NOTIFY_WAIT_TIME_MAX) {
-                    char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                    CHECK_MALLOC(err_str);
-                    snprintf(err_str, ERR_MSG_LENGTH,
-                             "Vectorloop resource update timed out (10s) for resource \"%s\"",
-                             resources[next_res_index].filepath);
-                    channel_log_msg_t *cmsg = channel_log_msg_create(0, err_str, true);
-                    channel_log_send(app_log_channel, cmsg);
-                }
-                wait_time.tv_sec = 0;
-                wait_time.tv_nsec = 1000;
-                clock_nanosleep(CLOCK_REALTIME, 0, &wait_time, NULL);
+                resource->next_update_time.tv_sec += resource->update_frequency;
             }
             break;
 
         case GET_NEXT_RESOURCE:
+            /* Release retired resources vectorloops no longer use. */
+            reclaim_waiting = resource_reclaim(resources, res_count, &resource_set->qsbr,
+                                               app_log_channel);
+
             top_delta_time = RESOURCE_LOOP_TOP_DELTA_TIME;
             /* Get current clock time. */
             utl_clock_gettime_rt_fatal(&current_time);
@@ -257,8 +676,18 @@ resource_loop(void *args)
                 }
             }
             if (top_delta_time < 0) {
+                if (reclaim_waiting > 0 &&
+                    (wait_time.tv_sec > 0 || wait_time.tv_nsec > RESOURCE_LOOP_RECLAIM_WAIT)) {
+                    /* Check on retired resources again shortly, before it is
+                     * time for next resource to be checked.
+                     */
+                    wait_time.tv_sec  = 0;
+                    wait_time.tv_nsec = RESOURCE_LOOP_RECLAIM_WAIT;
+                    resource_wait(resource_set, &wait_time, resources, res_count);
+                    break;
+                }
                 /* Wait until it is time for resource at next_res_index to be checked. */
-                clock_nanosleep(CLOCK_REALTIME, 0, &wait_time, NULL);
+                resource_wait(resource_set, &wait_time, resources, res_count);
             }
             state = CHECK_RESOURCE;
             break;
@@ -270,4 +699,4 @@ resource_loop(void *args)
     }
 
     return NULL;
-}
\ No newline at end of file
+}
@@ -26,12 +26,22 @@
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "acl.h"
+#include "geoip.h"
+#include "lb.h"
+#include "policy.h"
+#include "ecs_map.h"
 #include "resource.h"
 #include "utils.h"
+#include "views.h"
+#include "zone.h"
+#include "zone_catalog.h"
+#include "zone_secondary.h"
 
 /** Function releases resource data of type raw file.
  * 
@@ -46,44 +56,53 @@ resource_release_raw_file(resource_t *resource, void *buf)
     }
 }
 
-/** Function checks for change and if changed loads a file into memory buffer
- * as raw data.
+/** Function checks a file for change and if changed opens it.
  * 
  * Change is checked for by stating the file for change time.
  * 
- * @param resource Resource to check
- * @param buf      Where to store pointer to loaded data, on change.
- * @param buf_len  Length of buf available to use.
- * @param err      Buffer where to store error string if error was encountered.
- * @param err_len  Length of err buffer available to use.
+ * @param resource    Resource file belongs to, used in error message.
+ * @param filepath    Full path of file.
+ * @param create_time Change time of file last opened, updated on change.
+ * @param missing_ok  File not existing is not an error. It is reported as a
+ *                    change (with fd set to -1) if file existed before,
+ *                    otherwise as no change.
+ * @param fd          Where to store open file descriptor, on change.
+ * @param len         Where to store length of file, on change.
+ * @param err         Buffer where to store error string if error was encountered.
+ * @param err_len     Length of err buffer available to use.
  * 
- * @return           1 - Resource changed and was successfully loaded into buf
- *                   0 - Resource has not changed.
- *                  -1 - There was an error either checking of loading the
- *                       resource file. Error message is populated.
+ * @return           1 - File changed and was opened.
+ *                   0 - File has not changed.
+ *                  -1 - There was an error either checking or opening the
+ *                       file. Error message is populated.
  */
-int
-resource_check_load_raw_file(resource_t *resource, void **buf, size_t *buf_len,
-                             char *err, size_t err_len)
+static int
+resource_file_open(resource_t *resource, const char *filepath,
+                   struct timespec *create_time, bool missing_ok,
+                   int *fd, size_t *len, char *err, size_t err_len)
 {
-    int         fd = -1;
     struct stat file_stat;
-    int         ret = 0;
     char       *err_static;
-    char        err_str[err_len];
     
     /* Open file. */
-    fd = open(resource->filepath, O_RDONLY);
-    if (fd < 0) {
+    *fd = open(filepath, O_RDONLY);
+    if (*fd < 0 && errno == ENOENT && missing_ok) {
+        if (create_time->tv_sec == 0 && create_time->tv_nsec == 0) {
+            return 0;
+        }
+        *create_time = (struct timespec) {};
+        *len = 0;
+        return 1;
+    }
+    if (*fd < 0) {
         /* Error opening file! */
         err_static = strerror(errno);
         goto ERR_END;
     }
 
     /* Stat file to verify type, get last modified time and size. */
-    if (fstat(fd, &file_stat) != 0) {
+    if (fstat(*fd, &file_stat) != 0) {
         /* error stating file. */
-        close(fd);
         err_static = strerror(errno);
         goto ERR_END;
     }
@@ -92,32 +111,754 @@ resource_check_load_raw_file(resource_t *resource, void **buf, size_t *buf_len,
     if (!S_ISREG(file_stat.st_mode)) {
         /* not a regular file. */
         err_static = "not a regular file";
-        close(fd);
         goto ERR_END;
     }
 
-    /* Check if changed since last read and load. */
-    if (resource->create_time.tv_sec != file_stat.st_ctim.tv_sec &&
-        resource->create_time.tv_nsec != file_stat.st_ctim.tv_nsec) {
-        /* resource changed. */
-        size_t res_len = file_stat.st_size;
-        resource->create_time = file_stat.st_ctim;
-        ret = utl_readall(fd, res_len, buf, err_str, err_len);
+    /* Check if changed since last opened. */
+    if (create_time->tv_sec != file_stat.st_ctim.tv_sec ||
+        create_time->tv_nsec != file_stat.st_ctim.tv_nsec) {
+        *create_time = file_stat.st_ctim;
+        *len = file_stat.st_size;
+        return 1;
+    }
+    close(*fd);
+    return 0;
+
+ERR_END:
+    if (*fd >= 0) {
+        close(*fd);
+    }
+    if (err != NULL && err_len != 0) {
+        snprintf(err, err_len, "resource file %s error: %s",
+                 resource->name, err_static);
+    }
+    return -1;
+}
+
+/** Function checks a file for change and if changed loads it into memory
+ * buffer.
+ * 
+ * @param resource    Resource file belongs to, used in error message.
+ * @param filepath    Full path of file.
+ * @param create_time Change time of file last loaded, updated on change.
+ * @param missing_ok  File not existing, or being empty, is not an error. It
+ *                    is reported as a change to an empty file (buf set to
+ *                    NULL) if file was loaded before, otherwise as no change.
+ * @param buf         Where to store pointer to loaded data, on change.
+ * @param buf_len     Where to store length of loaded data, on change.
+ * @param err         Buffer where to store error string if error was encountered.
+ * @param err_len     Length of err buffer available to use.
+ * 
+ * @return           1 - File changed and was successfully loaded into buf
+ *                   0 - File has not changed.
+ *                  -1 - There was an error either checking of loading the
+ *                       file. Error message is populated.
+ */
+static int
+resource_load_file(resource_t *resource, const char *filepath,
+                   struct timespec *create_time, bool missing_ok,
+                   void **buf, size_t *buf_len, char *err, size_t err_len)
+{
+    int    fd  = -1;
+    size_t len = 0;
+    int    ret = 0;
+    char   err_str[err_len];
+
+    ret = resource_file_open(resource, filepath, create_time, missing_ok, &fd, &len,
+                             err, err_len);
+    if (ret != 1) {
+        return ret;
+    }
+    if (len == 0 && (missing_ok || fd < 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        *buf = NULL;
+        *buf_len = 0;
+        return 1;
+    }
+
+    if (len == 0) {
+        snprintf(err_str, err_len, "empty file");
+        ret = -1;
+    } else {
+        ret = utl_readall(fd, len, buf, err_str, err_len);
+    }
+    close(fd);
+    if (ret != 0) {
+        if (err != NULL && err_len != 0) {
+            snprintf(err, err_len, "resource file %s error: %s",
+                     resource->name, err_str);
+        }
+        return -1;
+    }
+    *buf_len = len;
+    return 1;
+}
+
+/** Function checks for change and if changed loads a file into memory buffer
+ * as raw data.
+ * 
+ * @param resource Resource to check
+ * @param buf      Where to store pointer to loaded data, on change.
+ * @param buf_len  Length of buf available to use.
+ * @param err      Buffer where to store error string if error was encountered.
+ * @param err_len  Length of err buffer available to use.
+ * 
+ * @return           1 - Resource changed and was successfully loaded into buf
+ *                   0 - Resource has not changed.
+ *                  -1 - There was an error either checking of loading the
+ *                       resource file. Error message is populated.
+ */
+int
+resource_check_load_raw_file(resource_t *resource, void **buf, size_t *buf_len,
+                             char *err, size_t err_len)
+{
+    return resource_load_file(resource, resource->filepath, &resource->create_time,
+                              false, buf, buf_len, err, err_len);
+}
+
+/** Function checks for change and if changed loads a resource file and
+ * compiles it with resource compile function.
+ * 
+ * Change is checked for via @ref resource_check_load_raw_file(). Raw file
+ * contents are released once compiled. Each successfully compiled object is
+ * assigned next resource generation number.
+ * 
+ * @param resource Resource to check, MUST have compile_fn set.
+ * @param buf      Where to store pointer to compiled object, on change.
+ * @param buf_len  Where to store length of resource file compiled object was
+ *                 built from.
+ * @param err      Buffer where to store error string if error was encountered.
+ * @param err_len  Length of err buffer available to use.
+ * 
+ * @return           1 - Resource changed and was compiled.
+ *                   0 - Resource has not changed.
+ *                  -1 - There was an error either loading the resource file,
+ *                       or compiling it. Error message is populated.
+ */
+int
+resource_check_load_compiled(resource_t *resource, void **buf, size_t *buf_len,
+                             char *err, size_t err_len)
+{
+    void   *raw     = NULL;
+    size_t  raw_len = 0;
+    void   *obj     = NULL;
+    char    err_str[err_len];
+    int     ret     = 0;
+
+    ret = resource_check_load_raw_file(resource, &raw, &raw_len, err, err_len);
+    if (ret != 1) {
+        return ret;
+    }
+
+    err_str[0] = '\0';
+    obj = resource->compile_fn(resource, raw, raw_len, resource->generation + 1,
+                               err_str, err_len);
+    free(raw);
+    if (obj == NULL) {
+        if (err != NULL && err_len != 0) {
+            snprintf(err, err_len, "resource file %s error: %s",
+                     resource->name, err_str);
+        }
+        return -1;
+    }
+
+    resource->generation += 1;
+    *buf = obj;
+    *buf_len = raw_len;
+    return 1;
+}
+
+/** Function releases resource data of type zone database.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Zone database to be released.
+ */
+void
+resource_release_zone_db(resource_t *resource, void *buf)
+{
+    zone_db_release((zone_db_t *)buf);
+}
+
+/** Function loads zone database from open zone file, which is either a zone
+ * image or a zone file to parse.
+ * 
+ * @param fd         Open zone file.
+ * @param len        Length of zone file.
+ * @param generation Generation number to assign to zone database.
+ * @param workers    Helper threads to build zone database on along with
+ *                   calling thread, NULL if none, see
+ *                   @ref zone_db_create_workers().
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns zone database, or NULL on error.
+ */
+static zone_db_t *
+resource_zone_db_load(int fd, size_t len, uint64_t generation, worker_pool_t *workers,
+                      char *err, size_t err_len)
+{
+    char       magic[ZONE_IMAGE_MAGIC_LEN];
+    void      *raw = NULL;
+    zone_db_t *db  = NULL;
+
+    if (pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+        zone_image_is(magic, sizeof(magic))) {
+        return zone_db_image_load(fd, len, generation, err, err_len);
+    }
+    if (len == 0) {
+        snprintf(err, err_len, "empty file");
+        return NULL;
+    }
+    if (utl_readall(fd, len, &raw, err, err_len) != 0) {
+        return NULL;
+    }
+    db = zone_db_create_workers(raw, len, generation, workers, err, err_len);
+    free(raw);
+    return db;
+}
+
+/** Function compiles zone file into zone image file.
+ * 
+ * @param zone_filepath  Path of zone file.
+ * @param image_filepath Path of zone image file to write.
+ * @param err            Where to store error message.
+ * @param err_len        Length of err buffer.
+ * 
+ * @return               Returns 0 on success, otherwise -1 and err is
+ *                       populated.
+ */
+int
+resource_zone_image_compile(const char *zone_filepath, const char *image_filepath,
+                            char *err, size_t err_len)
+{
+    resource_t  resource = {.name = "zone_file", .filepath = (char *)zone_filepath};
+    void       *raw      = NULL;
+    size_t      raw_len  = 0;
+    zone_db_t  *db       = NULL;
+    int         ret      = 0;
+
+    if (resource_check_load_raw_file(&resource, &raw, &raw_len, err, err_len) != 1) {
+        return -1;
+    }
+    if (zone_image_is(raw, raw_len)) {
+        snprintf(err, err_len, "\"%s\" is already a zone image", zone_filepath);
+        free(raw);
+        return -1;
+    }
+    db = zone_db_create(raw, raw_len, 1, err, err_len);
+    free(raw);
+    if (db == NULL) {
+        return -1;
+    }
+    ret = zone_db_image_write(db, image_filepath, err, err_len);
+    zone_db_release(db);
+    return ret;
+}
+
+/** Function checks for change and if changed loads zone file and zone delta
+ * file, and builds zone database from them.
+ * 
+ * When zone file changes zone database is built from scratch and kept as base
+ * resource. Zone delta file, if configured and present, is applied on top of
+ * base resource whenever either file changes, so delta always holds all
+ * changes since zone file. Secondary zone updates, if there are secondary
+ * zones, are applied on top of that, see @ref zone_secondary_db_update(), in
+ * which case zone file is optional. Each built database is assigned next
+ * resource generation number.
+ * 
+ * @param resource Resource to check
+ * @param buf      Where to store pointer to zone database, on change.
+ * @param buf_len  Where to store size of zone database object.
+ * @param err      Buffer where to store error string if error was encountered.
+ * @param err_len  Length of err buffer available to use.
+ * 
+ * @return           1 - Resource changed and zone database was built.
+ *                   0 - Resource has not changed.
+ *                  -1 - There was an error either loading the zone or zone
+ *                       delta file, or building zone database. Error message
+ *                       is populated.
+ */
+int
+resource_check_load_zone_db(resource_t *resource, void **buf, size_t *buf_len,
+                            char *err, size_t err_len)
+{
+    void      *raw     = NULL;
+    size_t     raw_len = 0;
+    int        fd      = -1;
+    zone_db_t *base    = NULL;
+    zone_db_t *db      = NULL;
+    char       err_str[err_len];
+    int        ret     = 0;
+
+    err_str[0] = '\0';
+
+    /* Zone file, base resource is built from scratch, or loaded from zone
+     * image.
+     */
+    ret = 0;
+    if (resource->filepath[0] != '\0') {
+        ret = resource_file_open(resource, resource->filepath, &resource->create_time,
+                                 false, &fd, &raw_len, err, err_len);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    if (ret == 1) {
+        base = resource_zone_db_load(fd, raw_len, resource->generation + 1,
+                                     resource->workers, err_str, err_len);
         close(fd);
-        if (ret == 0) {
-            *buf_len = res_len;
-            return 1;
-        } else {
-            err_static = err_str;
+        if (base == NULL) {
             goto ERR_END;
         }
+        resource->generation += 1;
+        zone_db_release(resource->base_resource);
+        resource->base_resource = base;
+
+        /* Zone delta file is applied again on top of new base. */
+        resource->delta_create_time = (struct timespec) {};
     }
-    return 0;
+    if (resource->base_resource == NULL && resource->secondary == NULL) {
+        return 0;
+    }
+
+    /* Zone delta file. */
+    ret = 0;
+    if (resource->base_resource != NULL &&
+        resource->delta_filepath != NULL && resource->delta_filepath[0] != '\0') {
+        ret = resource_load_file(resource, resource->delta_filepath,
+                                 &resource->delta_create_time, true, &raw, &raw_len,
+                                 err, err_len);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (ret == 1) {
+        db = zone_db_apply(resource->base_resource, raw != NULL ? raw : "", raw_len,
+                           resource->generation + 1, err_str, err_len);
+        free(raw);
+        if (db == NULL) {
+            goto ERR_END;
+        }
+        resource->generation += 1;
+    } else if (base != NULL) {
+        db = zone_db_ref(base);
+    }
+
+    /* Secondary zones. */
+    if (resource->secondary != NULL) {
+        db = zone_secondary_db_update(resource->secondary, resource->current_resource, db,
+                                      &resource->generation);
+    }
+    if (db == NULL) {
+        return 0;
+    }
+
+    *buf = db;
+    *buf_len = sizeof(zone_db_t);
+    return 1;
 
 ERR_END:
     if (err != NULL && err_len != 0) {
         snprintf(err, err_len, "resource file %s error: %s",
-                 resource->name, err_static);
+                 resource->name, err_str);
     }
     return -1;
-}
\ No newline at end of file
+}
+
+/** Function releases resource data of type ECS map.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      ECS map to be released.
+ */
+void
+resource_release_ecs_map(resource_t *resource, void *buf)
+{
+    ecs_map_release((ecs_map_t *)buf);
+}
+
+/** Function compiles ECS map file into ECS map.
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        ECS map file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to ECS map.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns ECS map, or NULL on error.
+ */
+void *
+resource_compile_ecs_map(resource_t *resource, const char *buf, size_t buf_len,
+                         uint64_t generation, char *err, size_t err_len)
+{
+    return ecs_map_create(buf, buf_len, generation, err, err_len);
+}
+
+/** Function releases resource data of type view set.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      View set to be released.
+ */
+void
+resource_release_views(resource_t *resource, void *buf)
+{
+    views_release((views_t *)buf);
+}
+
+/** Function loads zone database of a view from zone file, see
+ * @ref views_zone_load_fn.
+ * 
+ * @param filepath   Path of zone file or zone image.
+ * @param generation Generation number to assign to zone database.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns zone database, or NULL on error.
+ */
+static zone_db_t *
+resource_views_zone_load(const char *filepath, uint64_t generation, char *err, size_t err_len)
+{
+    struct stat  file_stat;
+    zone_db_t   *db = NULL;
+    int          fd = -1;
+
+    if ((fd = open(filepath, O_RDONLY)) < 0 || fstat(fd, &file_stat) != 0) {
+        snprintf(err, err_len, "%s", strerror(errno));
+    } else if (!S_ISREG(file_stat.st_mode)) {
+        snprintf(err, err_len, "not a regular file");
+    } else {
+        db = resource_zone_db_load(fd, file_stat.st_size, generation, NULL, err, err_len);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return db;
+}
+
+/** Function compiles view file into view set, loading zone file of each
+ * view.
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        View file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to view set.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns view set, or NULL on error.
+ */
+void *
+resource_compile_views(resource_t *resource, const char *buf, size_t buf_len,
+                       uint64_t generation, char *err, size_t err_len)
+{
+    return views_create(buf, buf_len, generation, &resource_views_zone_load, err, err_len);
+}
+
+/** Function releases resource data of type zone catalog.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Zone catalog to be released.
+ */
+void
+resource_release_catalog(resource_t *resource, void *buf)
+{
+    zone_catalog_release((zone_catalog_t *)buf);
+}
+
+/** Function checks zone file of a catalog zone for change and if changed
+ * loads its zone database, see @ref zone_catalog_zone_load_fn.
+ * 
+ * @param ctx         Zone catalog resource, unused.
+ * @param filepath    Path of zone file or zone image.
+ * @param create_time Change time of zone file last loaded, updated on change.
+ * @param generation  Generation number to assign to zone database.
+ * @param db          Where to store loaded zone database, on change.
+ * @param err         Where to store error message.
+ * @param err_len     Length of err buffer.
+ * 
+ * @return            1 - Zone file changed and zone database was loaded.
+ *                    0 - Zone file has not changed.
+ *                   -1 - Error, err is populated.
+ */
+static int
+resource_catalog_zone_load(void *ctx, const char *filepath, struct timespec *create_time,
+                           uint64_t generation, zone_db_t **db, char *err, size_t err_len)
+{
+    struct stat  file_stat;
+    int          fd  = -1;
+    int          ret = -1;
+
+    /* Zone files of all zones are checked each time, unchanged ones are
+     * only stated.
+     */
+    if (stat(filepath, &file_stat) == 0 &&
+        create_time->tv_sec == file_stat.st_ctim.tv_sec &&
+        create_time->tv_nsec == file_stat.st_ctim.tv_nsec) {
+        return 0;
+    }
+    if ((fd = open(filepath, O_RDONLY)) < 0 || fstat(fd, &file_stat) != 0) {
+        snprintf(err, err_len, "%s", strerror(errno));
+    } else if (!S_ISREG(file_stat.st_mode)) {
+        snprintf(err, err_len, "not a regular file");
+    } else {
+        *db = resource_zone_db_load(fd, file_stat.st_size, generation, NULL, err, err_len);
+        if (*db != NULL) {
+            *create_time = file_stat.st_ctim;
+            ret = 1;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ret;
+}
+
+/** Function checks zone catalog for change. If catalog file changed it is
+ * loaded and new catalog generation is created from it, otherwise zone file
+ * of each catalog zone is checked for change and new generation is derived
+ * from current one if any changed, see @ref zone_catalog_refresh(). Zones
+ * that could not be loaded do not fail the check, their errors are reported
+ * through err along with new generation.
+ * 
+ * @param resource Resource to check
+ * @param buf      Where to store pointer to new catalog generation, on change.
+ * @param buf_len  Where to store length of catalog file.
+ * @param err      Buffer where to store error string if error was encountered.
+ * @param err_len  Length of err buffer available to use.
+ * 
+ * @return           1 - Catalog or zone changed and new generation was
+ *                       created. Error message is populated if some zones
+ *                       could not be loaded.
+ *                   0 - Nothing changed. Error message is populated if
+ *                       some zones could not be loaded.
+ *                  -1 - There was an error either loading the catalog file,
+ *                       or parsing it. Error message is populated.
+ */
+int
+resource_check_load_catalog(resource_t *resource, void **buf, size_t *buf_len,
+                            char *err, size_t err_len)
+{
+    zone_catalog_t *current = resource->current_resource;
+    zone_catalog_t *catalog = NULL;
+    void           *raw     = NULL;
+    size_t          raw_len = 0;
+    char            err_str[err_len];
+    int             ret     = 0;
+
+    ret = resource_check_load_raw_file(resource, &raw, &raw_len, err, err_len);
+    if (ret < 0) {
+        return ret;
+    }
+
+    err_str[0] = '\0';
+    if (ret == 1) {
+        catalog = zone_catalog_create(raw, raw_len, current, resource->generation + 1,
+                                      &resource_catalog_zone_load, resource,
+                                      err_str, err_len);
+        free(raw);
+        if (catalog == NULL) {
+            if (err != NULL && err_len != 0) {
+                snprintf(err, err_len, "resource file %s error: %s",
+                         resource->name, err_str);
+            }
+            return -1;
+        }
+    } else if (current != NULL) {
+        catalog = zone_catalog_refresh(current, resource->generation + 1,
+                                       &resource_catalog_zone_load, resource,
+                                       err_str, err_len);
+    }
+
+    if (err_str[0] != '\0' && err != NULL && err_len != 0) {
+        snprintf(err, err_len, "resource file %s error: %s", resource->name, err_str);
+    }
+    if (catalog == NULL) {
+        return 0;
+    }
+    resource->generation += 1;
+    *buf = catalog;
+    *buf_len = raw_len;
+    return 1;
+}
+
+/** Function releases resource data of type client ACL.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Client ACL to be released.
+ */
+void
+resource_release_acl(resource_t *resource, void *buf)
+{
+    acl_release((acl_t *)buf);
+}
+
+/** Function compiles ACL file into client ACL.
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        ACL file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to client ACL.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns client ACL, or NULL on error.
+ */
+void *
+resource_compile_acl(resource_t *resource, const char *buf, size_t buf_len,
+                     uint64_t generation, char *err, size_t err_len)
+{
+    return acl_create(buf, buf_len, generation, err, err_len);
+}
+
+/** Function releases resource data of type response policy.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Response policy to be released.
+ */
+void
+resource_release_policy(resource_t *resource, void *buf)
+{
+    policy_release((policy_t *)buf);
+}
+
+/** Function compiles policy file into response policy.
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        Policy file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to response policy.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns response policy, or NULL on error.
+ */
+void *
+resource_compile_policy(resource_t *resource, const char *buf, size_t buf_len,
+                        uint64_t generation, char *err, size_t err_len)
+{
+    return policy_create(buf, buf_len, generation, err, err_len);
+}
+
+/** Function releases resource data of type GeoIP database.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      GeoIP database to be released.
+ */
+void
+resource_release_geoip(resource_t *resource, void *buf)
+{
+    geoip_release((geoip_t *)buf);
+}
+
+/** Function releases resource data of type load balancing candidate sets.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Candidate sets to be released.
+ */
+void
+resource_release_lb(resource_t *resource, void *buf)
+{
+    lb_release((lb_t *)buf);
+}
+
+/** Function compiles load balancing file into candidate sets. Endpoints
+ * published candidate sets have keep their health.
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        Load balancing file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to candidate sets.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns candidate sets, or NULL on error.
+ */
+void *
+resource_compile_lb(resource_t *resource, const char *buf, size_t buf_len,
+                    uint64_t generation, char *err, size_t err_len)
+{
+    return lb_create(buf, buf_len, generation, (const lb_t *)resource->current_resource,
+                     err, err_len);
+}
+
+/** Function checks for change and if changed memory maps GeoIP database
+ * file, which is not read into memory as compiled resources are. Each
+ * successfully opened database is assigned next resource generation number.
+ * 
+ * @param resource Resource to check
+ * @param buf      Where to store pointer to GeoIP database, on change.
+ * @param buf_len  Where to store length of database file.
+ * @param err      Buffer where to store error string if error was encountered.
+ * @param err_len  Length of err buffer available to use.
+ * 
+ * @return           1 - Resource changed and database was opened.
+ *                   0 - Resource has not changed.
+ *                  -1 - There was an error either opening or mapping the
+ *                       database file. Error message is populated.
+ */
+int
+resource_check_load_geoip(resource_t *resource, void **buf, size_t *buf_len,
+                          char *err, size_t err_len)
+{
+    geoip_t *geoip   = NULL;
+    size_t   len     = 0;
+    int      fd      = -1;
+    char     err_str[err_len];
+    int      ret;
+
+    ret = resource_file_open(resource, resource->filepath, &resource->create_time,
+                             false, &fd, &len, err, err_len);
+    if (ret != 1) {
+        return ret;
+    }
+
+    err_str[0] = '\0';
+    geoip = geoip_open(fd, len, resource->generation + 1, err_str, err_len);
+    close(fd);
+    if (geoip == NULL) {
+        if (err != NULL && err_len != 0) {
+            snprintf(err, err_len, "resource file %s error: %s",
+                     resource->name, err_str);
+        }
+        return -1;
+    }
+
+    resource->generation += 1;
+    *buf = geoip;
+    *buf_len = len;
+    return 1;
+}
+
+/** Function releases reloaded configuration. Strings and arrays are shared
+ * with configuration application was started with, so only the object is
+ * released.
+ * 
+ * @param resource Resource this data applies to.
+ * @param buf      Reloaded configuration to release.
+ */
+void
+resource_release_config(resource_t *resource, void *buf)
+{
+    free(buf);
+}
+
+/** Function compiles configuration file into reloaded configuration, see
+ * @ref config_reload().
+ * 
+ * @param resource   Resource this data applies to.
+ * @param buf        Configuration file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to configuration.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ * 
+ * @return           Returns reloaded configuration, or NULL on error.
+ */
+void *
+resource_compile_config(resource_t *resource, const char *buf, size_t buf_len,
+                        uint64_t generation, char *err, size_t err_len)
+{
+    return config_reload(resource->cfg, buf, buf_len, generation, err, err_len);
+}
@@ -0,0 +1,714 @@
+/**
+ * @file response_cache.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup response_cache
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "response_cache.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+
+/** Initialize response cache.
+ *
+ * @param cache Cache to initialize.
+ * @param size  Number of entries in cache, rounded up to power of 2. If 0
+ *              cache is disabled.
+ */
+void
+response_cache_init(response_cache_t *cache, size_t size)
+{
+    size_t entries_count = 1;
+
+    *cache = (response_cache_t) {};
+    if (size == 0) {
+        return;
+    }
+    while (entries_count < size) {
+        entries_count <<= 1;
+    }
+    cache->entries = mem_calloc(MEM_TAG_RESPONSE_CACHE, entries_count,
+                                sizeof(response_cache_entry_t));
+    CHECK_MALLOC(cache->entries);
+    cache->mask = entries_count - 1;
+}
+
+/** Release memory held by response cache.
+ *
+ * @param cache Cache to release.
+ */
+void
+response_cache_clean(response_cache_t *cache)
+{
+    mem_free(MEM_TAG_RESPONSE_CACHE, cache->entries);
+    *cache = (response_cache_t) {};
+}
+
+/** Set zone database generation cache entries are valid for. Entries from any
+ * other generation are treated as empty.
+ *
+ * @param cache      Response cache.
+ * @param generation Zone database generation.
+ */
+void
+response_cache_generation_set(response_cache_t *cache, uint64_t generation)
+{
+    cache->generation = generation;
+}
+
+/** Calculate hash of query cache key, from question name hash computed by
+ * query parse.
+ *
+ * @param q Query to calculate hash for.
+ *
+ * @return  Returns hash, or 0 if query is not cacheable.
+ */
+static uint32_t
+response_cache_hash(query_t *q)
+{
+    uint64_t key;
+    uint64_t hash;
+
+    /* Only an uncompressed question name is cached, in which case name in
+     * request is exactly as long as the unpacked name.
+     */
+    if (q->query_qname_len != q->query_question_len - RIP_NS_QFIXEDSZ) {
+        return 0;
+    }
+
+    key = (uint64_t)q->query_q_type << 48 | (uint64_t)q->query_q_class << 32 |
+          (uint64_t)q->view << 16 | (q->edns.edns_valid ? q->edns.udp_resp_len | (q->edns.dnssec << 15) : 0);
+    hash = (q->query_qname_hash ^ key ^ (uint64_t)q->geo << 1) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 32;
+
+    return (uint32_t)hash == 0 ? 1 : (uint32_t)hash;
+}
+
+/** Case insensitive compare of wire format domain names of same length.
+ *
+ * @param a   First name.
+ * @param b   Second name.
+ * @param len Length of names.
+ *
+ * @return    Returns true if names are equal.
+ */
+static bool
+response_cache_name_eq(const uint8_t *a, const uint8_t *b, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        if (a[i] != b[i] && tolower(a[i]) != tolower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Check if query is looked up in response cache, see
+ * @ref response_cache_get().
+ *
+ * @param q Parsed query.
+ *
+ * @return  Returns true if query is looked up.
+ */
+static bool
+response_cache_query_cacheable(query_t *q)
+{
+    return q->query_question_len > RIP_NS_QFIXEDSZ &&
+           !q->edns.client_subnet.edns_cs_valid && !q->notify &&
+           !(rip_ns_qtype_get(q->query_q_type).flags & RIP_NS_QTYPE_F_XFR);
+}
+
+/** Check if packed response of query is added to response cache, see
+ * @ref response_cache_put().
+ *
+ * @param q        Query with packed response.
+ * @param resp_len Length of packed response, without TCP length prefix.
+ *
+ * @return         Returns true if response is added.
+ */
+static bool
+response_cache_response_cacheable(query_t *q, uint16_t resp_len)
+{
+    return q->response_cache_hash != 0 &&
+           q->end_code >= 0 && q->end_code <= rip_ns_r_refused &&
+           q->response_hdr->tc == 0 && resp_len <= RESPONSE_CACHE_RESPONSE_MAX;
+}
+
+/** Check if cache entry holds response to query.
+ *
+ * @param entry      Cache entry.
+ * @param generation Generation entry must have been resolved against.
+ * @param hash       Hash of query cache key.
+ * @param q          Parsed query.
+ *
+ * @return           Returns true if entry holds response to query.
+ */
+static bool
+response_cache_entry_match(const response_cache_entry_t *entry, uint64_t generation,
+                           uint32_t hash, query_t *q)
+{
+    uint16_t edns_udp_size = q->edns.edns_valid ? q->edns.udp_resp_len : 0;
+
+    return entry->generation == generation && entry->hash == hash &&
+           entry->q_type == q->query_q_type && entry->q_class == q->query_q_class &&
+           entry->edns_udp_size == edns_udp_size &&
+           entry->dnssec == (q->edns.edns_valid && q->edns.dnssec) &&
+           entry->view == q->view && entry->geo == q->geo &&
+           entry->question_len == q->query_question_len &&
+           entry->response_len <= query_response_size_max(q) &&
+           response_cache_name_eq(entry->response + sizeof(rip_ns_header_t),
+                                  (const uint8_t *)q->request_hdr + sizeof(rip_ns_header_t),
+                                  q->query_question_len - RIP_NS_QFIXEDSZ);
+}
+
+/** Copy cached response into query response buffer, with request ID, RD
+ * bit, and question, and set query end code.
+ *
+ * @param entry Cache entry holding response to query, see
+ *              @ref response_cache_entry_match().
+ * @param q     Parsed query.
+ */
+static void
+response_cache_entry_copy(const response_cache_entry_t *entry, query_t *q)
+{
+    rip_ns_header_t *resp_hdr = q->response_hdr;
+    uint16_t         id       = q->request_hdr->id;
+    uint8_t          rd       = q->request_hdr->rd;
+    size_t           len      = sizeof(rip_ns_header_t) + q->query_question_len;
+
+    /* Question is already in place if response is packed over request. */
+    memcpy(resp_hdr, entry->response, sizeof(rip_ns_header_t));
+    resp_hdr->id = id;
+    resp_hdr->rd = rd;
+    if (!query_response_in_place(q)) {
+        memcpy((uint8_t *)resp_hdr + sizeof(rip_ns_header_t),
+               (const uint8_t *)q->request_hdr + sizeof(rip_ns_header_t),
+               q->query_question_len);
+    }
+    memcpy((uint8_t *)resp_hdr + len, entry->response + len, entry->response_len - len);
+
+    q->response_buffer_len  = entry->response_len;
+    q->response_edns_offset = entry->edns_offset;
+    if (q->protocol == 1) {
+        /* TCP */
+        rip_ns_put16(q->response_buffer, (uint16_t )q->response_buffer_len);
+        q->response_buffer_len += 2;
+    }
+
+    q->end_code             = entry->end_code;
+    q->authoritative        = entry->authoritative;
+    q->zone_slot            = entry->zone_slot;
+    q->answer_section_count = entry->answer_section_count;
+    for (int i = 0; i < entry->answer_section_count && i < RESPONSE_CACHE_ANSWER_MAX; i++) {
+        q->answer_section[i] = entry->answer_section[i];
+    }
+    q->response_cached = true;
+}
+
+/** Fill cache entry with packed response of query.
+ *
+ * @param entry      Cache entry to fill.
+ * @param generation Generation response was resolved against.
+ * @param q          Query with packed response.
+ * @param resp_len   Length of packed response, without TCP length prefix.
+ */
+static void
+response_cache_entry_fill(response_cache_entry_t *entry, uint64_t generation, query_t *q,
+                          uint16_t resp_len)
+{
+    *entry = (response_cache_entry_t) {
+        .generation           = generation,
+        .hash                 = q->response_cache_hash,
+        .q_type               = q->query_q_type,
+        .q_class              = q->query_q_class,
+        .edns_udp_size        = q->edns.edns_valid ? q->edns.udp_resp_len : 0,
+        .edns_offset          = q->response_edns_offset,
+        .dnssec               = q->edns.edns_valid && q->edns.dnssec,
+        .view                 = q->view,
+        .geo                  = q->geo,
+        .zone_slot            = q->zone_slot,
+        .question_len         = q->query_question_len,
+        .end_code             = q->end_code,
+        .authoritative        = q->authoritative,
+        .answer_section_count = q->answer_section_count,
+        .response_len         = resp_len,
+    };
+    for (int i = 0; i < q->answer_section_count && i < RESPONSE_CACHE_ANSWER_MAX; i++) {
+        entry->answer_section[i] = q->answer_section[i];
+    }
+    memcpy(entry->response, q->response_hdr, resp_len);
+}
+
+/** Lookup query in response cache, and on hit copy cached response into
+ * query response buffer and set query end code. On miss query is marked with
+ * its cache key hash so response can be added to cache once packed, see
+ * @ref response_cache_put. Zone transfer queries are never cached, their
+ * response depends on transport and client, nor is NOTIFY. Every
+ * hot_hits-th hit of an entry marks query hot and keeps its request, if it
+ * fits, see @ref response_cache_t.hot_hits.
+ *
+ * @param cache Response cache.
+ * @param q     Parsed query to lookup.
+ *
+ * @return      Returns true on cache hit, false otherwise.
+ */
+bool
+response_cache_get(response_cache_t *cache, query_t *q)
+{
+    response_cache_entry_t *entry = NULL;
+    uint32_t                hash;
+
+    if (cache->entries == NULL || cache->generation == 0 ||
+        !response_cache_query_cacheable(q)) {
+        return false;
+    }
+    if ((hash = response_cache_hash(q)) == 0) {
+        return false;
+    }
+
+    entry = &cache->entries[hash & cache->mask];
+    if (!response_cache_entry_match(entry, cache->generation, hash, q)) {
+        q->response_cache_hash = hash;
+        return false;
+    }
+    if (cache->hot_hits != 0 && (entry->hits + 1) % cache->hot_hits == 0 &&
+        q->request_buffer_len <= RESPONSE_CACHE_HOT_REQUEST_MAX) {
+        memcpy(cache->hot_request, q->request_hdr, q->request_buffer_len);
+        cache->hot_request_len = q->request_buffer_len;
+        q->response_hot        = true;
+    }
+    response_cache_entry_copy(entry, q);
+    entry->hits++;
+
+    return true;
+}
+
+/** Prefetch response cache entry query is looked up in by
+ * @ref response_cache_get, entry header and start of cached response whose
+ * question is compared. Used to overlap cache misses of a batch of queries.
+ *
+ * @param cache Response cache.
+ * @param q     Parsed query to be looked up.
+ */
+void
+response_cache_prefetch(response_cache_t *cache, query_t *q)
+{
+    response_cache_entry_t *entry;
+    uint32_t                hash;
+
+    if (cache->entries == NULL || q->query_question_len <= RIP_NS_QFIXEDSZ ||
+        (hash = response_cache_hash(q)) == 0) {
+        return;
+    }
+    entry = &cache->entries[hash & cache->mask];
+    __builtin_prefetch(entry);
+    __builtin_prefetch(entry->response);
+}
+
+/** Add packed query response to response cache. Query must have been looked
+ * up in cache with @ref response_cache_get, and missed, prior to being
+ * resolved and packed.
+ *
+ * @param cache Response cache.
+ * @param q     Query with packed response.
+ */
+void
+response_cache_put(response_cache_t *cache, query_t *q)
+{
+    uint16_t resp_len = q->response_buffer_len - (q->protocol == 1 ? 2 : 0);
+
+    if (cache->entries == NULL || !response_cache_response_cacheable(q, resp_len)) {
+        return;
+    }
+    response_cache_entry_fill(&cache->entries[q->response_cache_hash & cache->mask],
+                              cache->generation, q, resp_len);
+}
+
+/** Compare snapshot entries by number of hits, most hit first, see
+ * qsort().
+ *
+ * @param a First entry.
+ * @param b Second entry.
+ *
+ * @return  Returns negative, 0 or positive value as a has more, as many or
+ *          fewer hits than b.
+ */
+static int
+response_cache_snapshot_cmp(const void *a, const void *b)
+{
+    uint32_t hits_a = ((const response_cache_snapshot_entry_t *)a)->hits;
+    uint32_t hits_b = ((const response_cache_snapshot_entry_t *)b)->hits;
+
+    return (hits_a < hits_b) - (hits_a > hits_b);
+}
+
+/** Write questions of responses cached for current generation to snapshot
+ * file, most hit first. File is written next to filepath and renamed over
+ * it, so a reader never maps a partly written file.
+ *
+ * @param cache    Response cache.
+ * @param filepath Path of snapshot file.
+ * @param err      Where to store error message.
+ * @param err_len  Length of err buffer.
+ *
+ * @return         Returns number of entries written, -1 on error.
+ */
+int
+response_cache_snapshot_write(response_cache_t *cache, const char *filepath,
+                              char *err, size_t err_len)
+{
+    response_cache_snapshot_header_t  hdr     = {
+        .magic      = RESPONSE_CACHE_SNAPSHOT_MAGIC,
+        .version    = RESPONSE_CACHE_SNAPSHOT_VERSION,
+        .header_len = sizeof(response_cache_snapshot_header_t),
+        .entry_len  = sizeof(response_cache_snapshot_entry_t),
+    };
+    response_cache_snapshot_entry_t  *entries = NULL;
+    char                              tmp_path[FILE_REALPATH_MAX + 8];
+    int                               fd      = -1;
+    int                               ret     = -1;
+
+    if (cache->entries != NULL && cache->generation != 0) {
+        entries = mem_malloc(MEM_TAG_RESPONSE_CACHE,
+                             sizeof(response_cache_snapshot_entry_t) * (cache->mask + 1));
+        CHECK_MALLOC(entries);
+        for (uint32_t i = 0; i <= cache->mask; i++) {
+            response_cache_entry_t *entry = &cache->entries[i];
+
+            /* Geo responses depend on client address, which is not kept. */
+            if (entry->generation != cache->generation || entry->geo != 0) {
+                continue;
+            }
+            entries[hdr.count] = (response_cache_snapshot_entry_t) {
+                .hits          = entry->hits,
+                .q_type        = entry->q_type,
+                .q_class       = entry->q_class,
+                .edns_udp_size = entry->edns_udp_size,
+                .view          = entry->view,
+                .dnssec        = entry->dnssec,
+                .qname_len     = entry->question_len - RIP_NS_QFIXEDSZ,
+            };
+            memcpy(entries[hdr.count].qname, entry->response + sizeof(rip_ns_header_t),
+                   entries[hdr.count].qname_len);
+            hdr.count++;
+        }
+        qsort(entries, hdr.count, sizeof(response_cache_snapshot_entry_t),
+              response_cache_snapshot_cmp);
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filepath);
+    if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0 ||
+        utl_writeall(fd, &hdr, sizeof(hdr), NULL, 0) != 0 ||
+        (hdr.count > 0 &&
+         utl_writeall(fd, entries, sizeof(response_cache_snapshot_entry_t) * hdr.count,
+                      NULL, 0) != 0) ||
+        fsync(fd) != 0) {
+        snprintf(err, err_len, "error writing \"%s\": %s", tmp_path, strerror(errno));
+        goto END;
+    }
+    if (rename(tmp_path, filepath) != 0) {
+        snprintf(err, err_len, "error renaming \"%s\": %s", tmp_path, strerror(errno));
+        goto END;
+    }
+    ret = hdr.count;
+
+END:
+    if (fd >= 0) {
+        close(fd);
+        if (ret < 0) {
+            unlink(tmp_path);
+        }
+    }
+    mem_free(MEM_TAG_RESPONSE_CACHE, entries);
+    return ret;
+}
+
+/** Map response cache snapshot file, see @ref response_cache_snapshot_write().
+ *
+ * @param snap     Snapshot to map file into.
+ * @param filepath Path of snapshot file.
+ * @param err      Where to store error message.
+ * @param err_len  Length of err buffer.
+ *
+ * @return         Returns 0 on success, 1 if there is no snapshot file, -1 on
+ *                 error, snap is then left empty.
+ */
+int
+response_cache_snapshot_open(response_cache_snapshot_t *snap, const char *filepath,
+                             char *err, size_t err_len)
+{
+    const response_cache_snapshot_header_t *hdr;
+    struct stat                             st;
+    int                                     fd;
+
+    *snap = (response_cache_snapshot_t) {};
+    if ((fd = open(filepath, O_RDONLY | O_CLOEXEC)) < 0) {
+        if (errno == ENOENT) {
+            return 1;
+        }
+        snprintf(err, err_len, "error opening \"%s\": %s", filepath, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(response_cache_snapshot_header_t)) {
+        snprintf(err, err_len, "\"%s\" is not a response cache snapshot", filepath);
+        close(fd);
+        return -1;
+    }
+    snap->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (snap->map == MAP_FAILED) {
+        snprintf(err, err_len, "error mapping \"%s\": %s", filepath, strerror(errno));
+        *snap = (response_cache_snapshot_t) {};
+        return -1;
+    }
+    snap->map_len = st.st_size;
+
+    hdr = snap->map;
+    if (hdr->magic != RESPONSE_CACHE_SNAPSHOT_MAGIC ||
+        hdr->version != RESPONSE_CACHE_SNAPSHOT_VERSION ||
+        hdr->header_len != sizeof(response_cache_snapshot_header_t) ||
+        hdr->entry_len != sizeof(response_cache_snapshot_entry_t) ||
+        (snap->map_len - hdr->header_len) / hdr->entry_len < hdr->count) {
+        snprintf(err, err_len, "\"%s\" is not a response cache snapshot", filepath);
+        response_cache_snapshot_close(snap);
+        return -1;
+    }
+    snap->entries = (const response_cache_snapshot_entry_t *)((const uint8_t *)snap->map +
+                                                              hdr->header_len);
+    snap->count   = hdr->count;
+    return 0;
+}
+
+/** Unmap response cache snapshot file.
+ *
+ * @param snap Snapshot to unmap.
+ */
+void
+response_cache_snapshot_close(response_cache_snapshot_t *snap)
+{
+    if (snap->map != NULL) {
+        munmap(snap->map, snap->map_len);
+    }
+    *snap = (response_cache_snapshot_t) {};
+}
+
+/** Turn snapshot entry into a parsed query, as if its request was received,
+ * so it can be resolved and its response packed into response cache.
+ *
+ * @param entry Snapshot entry.
+ * @param q     Query to build request in, reset.
+ *
+ * @return      Returns true if query parsed and is to be resolved.
+ */
+bool
+response_cache_snapshot_query(const response_cache_snapshot_entry_t *entry, query_t *q)
+{
+    rip_ns_header_t *hdr = q->request_hdr;
+    uint8_t         *p   = q->request_buffer + sizeof(rip_ns_header_t);
+
+    if (entry->qname_len == 0 || entry->qname_len > RIP_NS_MAXCDNAME) {
+        return false;
+    }
+    memset(hdr, 0, sizeof(rip_ns_header_t));
+    hdr->qdcount = htons(1);
+    memcpy(p, entry->qname, entry->qname_len);
+    p += entry->qname_len;
+    RIP_NS_PUT16(entry->q_type, p);
+    RIP_NS_PUT16(entry->q_class, p);
+    if (entry->edns_udp_size > 0) {
+        /* EDNS OPT RR, no options. */
+        hdr->arcount = htons(1);
+        *p++ = 0;
+        RIP_NS_PUT16(rip_ns_t_opt, p);
+        RIP_NS_PUT16(entry->edns_udp_size, p);
+        RIP_NS_PUT16(0, p);
+        RIP_NS_PUT16(entry->dnssec ? 0x8000 : 0, p);
+        RIP_NS_PUT16(0, p);
+    }
+    q->request_buffer_len = p - q->request_buffer;
+
+    query_parse(q);
+    q->view = entry->view;
+    return q->end_code == -1;
+}
+
+/** Initialize shared response cache.
+ *
+ * @param shared Shared cache to initialize.
+ * @param size   Number of entries in cache, rounded up to power of 2, and to
+ *               at least one set. If 0 cache is disabled.
+ */
+void
+response_cache_shared_init(response_cache_shared_t *shared, size_t size)
+{
+    size_t entries_count = RESPONSE_CACHE_SHARED_WAYS;
+
+    *shared = (response_cache_shared_t) {};
+    if (size == 0) {
+        return;
+    }
+    while (entries_count < size) {
+        entries_count <<= 1;
+    }
+    shared->entries = mem_aligned_alloc(MEM_TAG_RESPONSE_CACHE, CACHE_LINE_SIZE,
+                                        entries_count * sizeof(response_cache_shared_entry_t));
+    CHECK_MALLOC(shared->entries);
+    memset(shared->entries, 0, entries_count * sizeof(response_cache_shared_entry_t));
+    shared->mask = entries_count / RESPONSE_CACHE_SHARED_WAYS - 1;
+}
+
+/** Release memory held by shared response cache, once no vectorloop uses it.
+ *
+ * @param shared Shared cache to release.
+ */
+void
+response_cache_shared_clean(response_cache_shared_t *shared)
+{
+    mem_free(MEM_TAG_RESPONSE_CACHE, shared->entries);
+    *shared = (response_cache_shared_t) {};
+}
+
+/** Lookup query in shared response cache, once it missed in response cache
+ * of vectorloop, see @ref response_cache_get. On hit response is copied into
+ * query response buffer, as by @ref response_cache_get, and added to response
+ * cache of vectorloop.
+ *
+ * Entries of set are read without locks. Each entry read is copied, and copy
+ * is used only if entry sequence number was even before copying and is still
+ * the same after, so a concurrent write is never seen half done.
+ *
+ * @param shared Shared response cache.
+ * @param cache  Response cache of vectorloop, its generation entry must match.
+ * @param q      Parsed query, looked up in cache of vectorloop and missed.
+ *
+ * @return       Returns true on cache hit, false otherwise.
+ */
+bool
+response_cache_shared_get(response_cache_shared_t *shared, response_cache_t *cache,
+                          query_t *q)
+{
+    response_cache_shared_entry_t *set;
+    response_cache_entry_t         copy;
+    unsigned int                   seq;
+
+    if (shared->entries == NULL || cache->generation == 0 || q->response_cache_hash == 0) {
+        return false;
+    }
+
+    set = &shared->entries[(q->response_cache_hash & shared->mask) * RESPONSE_CACHE_SHARED_WAYS];
+    for (int i = 0; i < RESPONSE_CACHE_SHARED_WAYS; i++) {
+        seq = atomic_load_explicit(&set[i].seq, memory_order_acquire);
+        if ((seq & 1) != 0 || set[i].entry.hash != q->response_cache_hash) {
+            continue;
+        }
+        memcpy(&copy, &set[i].entry, offsetof(response_cache_entry_t, response));
+        if (copy.response_len > RESPONSE_CACHE_RESPONSE_MAX) {
+            continue;
+        }
+        memcpy(copy.response, set[i].entry.response, copy.response_len);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&set[i].seq, memory_order_relaxed) != seq ||
+            !response_cache_entry_match(&copy, cache->generation,
+                                        q->response_cache_hash, q)) {
+            continue;
+        }
+        response_cache_entry_copy(&copy, q);
+        response_cache_put(cache, q);
+        return true;
+    }
+    return false;
+}
+
+/** Add packed query response to shared response cache, as
+ * @ref response_cache_put. Response replaces entry of set holding same key,
+ * else entry of an older generation, else entry written longest ago (lowest
+ * sequence number). Response is not added if that entry is being written by
+ * another vectorloop.
+ *
+ * @param shared Shared response cache.
+ * @param cache  Response cache of vectorloop, generation response was
+ *               resolved against.
+ * @param q      Query with packed response.
+ */
+void
+response_cache_shared_put(response_cache_shared_t *shared, response_cache_t *cache,
+                          query_t *q)
+{
+    response_cache_shared_entry_t *set;
+    response_cache_shared_entry_t *victim   = NULL;
+    uint16_t                       resp_len = q->response_buffer_len -
+                                              (q->protocol == 1 ? 2 : 0);
+    unsigned int                   victim_seq = UINT_MAX;
+    unsigned int                   seq;
+
+    if (shared->entries == NULL || !response_cache_response_cacheable(q, resp_len)) {
+        return;
+    }
+
+    /* Entry fields are only a hint for choosing victim, they may be written
+     * concurrently.
+     */
+    set = &shared->entries[(q->response_cache_hash & shared->mask) * RESPONSE_CACHE_SHARED_WAYS];
+    for (int i = 0; i < RESPONSE_CACHE_SHARED_WAYS; i++) {
+        seq = atomic_load_explicit(&set[i].seq, memory_order_relaxed);
+        if (set[i].entry.hash == q->response_cache_hash) {
+            victim = &set[i];
+            break;
+        }
+        if (set[i].entry.generation != cache->generation) {
+            seq = 0;
+        }
+        if (seq < victim_seq) {
+            victim     = &set[i];
+            victim_seq = seq;
+        }
+    }
+
+    /* Claim entry, sequence number is odd while it is written. */
+    seq = atomic_load_explicit(&victim->seq, memory_order_relaxed);
+    if ((seq & 1) != 0 ||
+        !atomic_compare_exchange_strong_explicit(&victim->seq, &seq, seq + 1,
+                                                 memory_order_relaxed,
+                                                 memory_order_relaxed)) {
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    response_cache_entry_fill(&victim->entry, cache->generation, q, resp_len);
+    atomic_store_explicit(&victim->seq, seq + 2, memory_order_release);
+}
+
+/** @}*/
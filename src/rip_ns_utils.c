@@ -42,6 +42,7 @@
 #include <stdio.h>
 
 #include "rip_ns_utils.h"
+#include "utils.h"
 
 /** Array mapping Resource Record types to enumerated rip_ns_type_e. 
  * Array is used for fast conversion from enum to string.
@@ -127,7 +128,26 @@ rip_ns_class_to_str(rip_ns_class_t class)
 }
 
 
-/** Check if DNS resource record type is one of supported types.
+/** Query type dispatch table, indexed by query type. Types with no entry are
+ * unsupported, see @ref rip_ns_qtype_get().
+ */
+const rip_ns_qtype_t rip_ns_qtypes[RIP_NS_QTYPE_TABLE_SIZE] = {
+    [0]              = { 0,                                             RIP_NS_QTYPE_IDX_INVALID },
+    [rip_ns_t_a]     = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_A },
+    [rip_ns_t_ns]    = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_NS },
+    [rip_ns_t_cname] = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_CNAME },
+    [rip_ns_t_soa]   = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_SOA },
+    [rip_ns_t_ptr]   = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_PTR },
+    [rip_ns_t_mx]    = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_MX },
+    [rip_ns_t_txt]   = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_TXT },
+    [rip_ns_t_aaaa]  = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_AAAA },
+    [rip_ns_t_srv]   = { RIP_NS_QTYPE_F_SUPPORTED,                      RIP_NS_QTYPE_IDX_SRV },
+    [rip_ns_t_ixfr]  = { RIP_NS_QTYPE_F_SUPPORTED | RIP_NS_QTYPE_F_XFR, RIP_NS_QTYPE_IDX_IXFR },
+    [rip_ns_t_axfr]  = { RIP_NS_QTYPE_F_SUPPORTED | RIP_NS_QTYPE_F_XFR, RIP_NS_QTYPE_IDX_AXFR },
+    [rip_ns_t_any]   = { RIP_NS_QTYPE_F_SUPPORTED | RIP_NS_QTYPE_F_ANY, RIP_NS_QTYPE_IDX_ANY },
+};
+
+/** Check if DNS resource record type is one of supported query types.
  * 
  * @param query_type DNS resource record type to check.
  * @return           Returns true if type is one of supported DNS resource
@@ -136,16 +156,7 @@ rip_ns_class_to_str(rip_ns_class_t class)
 bool
 rip_ns_rr_type_supported(uint16_t query_type)
 {
-    uint16_t supported_query_types[] = {
-        rip_ns_t_a,
-    };
-    uint16_t count = sizeof(supported_query_types)/sizeof(supported_query_types[0]);
-    for (int i = 0; i < count; i++) {
-        if (query_type == supported_query_types[i]) {
-            return true;
-        }
-    }
-    return false;
+    return (rip_ns_qtype_get(query_type).flags & RIP_NS_QTYPE_F_SUPPORTED) != 0;
 }
 
 /** Check if DNS resource record class is one of supported types.
@@ -184,31 +195,20 @@ rip_ns_put16(unsigned char *dst, uint16_t num)
  * This function converts the C string into "network" format, then packs it
  * into destination buffer.
  * 
- * DNPTRS is an array of pointers to previous compressed names.
- * DNPTRS[0] is a pointer to the beginning of the message. The array
- * ends with NULL. LASTDNPTR is a pointer to the end of the array
- * pointed to by 'dnptrs'.
- *
- * The list of pointers in DNPTRS is updated for labels inserted into
- * the message as we compress the name. If DNPTRS is NULL, we don't
- * try to compress names. If LASTDNPTR is NULL, we don't update the
- * list.
- * 
- * DNPTRS should be initialized when ready to populate DNS response.
- * It should then be used for all @ref rip_ns_name_put() and @ref
+ * COMP is name compression table of message, see @ref rip_ns_name_pack(). It
+ * should be initialized (or reset) when ready to populate DNS response. It
+ * should then be used for all @ref rip_ns_name_put() and @ref
  * rip_ns_name_pack() calls while adding RRs to DNS response.
  *
  * @param src       Domain name in "network" format to pack.
  * @param dst       Destination buffer where to pack the domain name.
  * @param dstsiz    Length of destination buffer.
- * @param dnptrs
- * @param lastdnptr 
+ * @param comp      Name compression table, or NULL not to compress name.
  *
  * @return          Returns size of the compressed name, or -1.
  */
 int rip_ns_name_put(const unsigned char *src, unsigned char *dst, int dstsiz,
-                    const unsigned char **dnptrs,
-                    const unsigned char **lastdnptr)
+                    rip_ns_comp_t *comp)
 {
     unsigned char compressed_name[RIP_NS_CDNAME_COMP_BUF_LEN];
     int           ret_p                 = 0;
@@ -220,7 +220,7 @@ int rip_ns_name_put(const unsigned char *src, unsigned char *dst, int dstsiz,
         return ret_c;
     }
 
-    ret_p = rip_ns_name_pack(compressed_name, dst, dstsiz, dnptrs, lastdnptr);
+    ret_p = rip_ns_name_pack(compressed_name, dst, dstsiz, comp);
 
     return ret_p;
 }
@@ -266,6 +266,103 @@ rip_rr_name_get(const unsigned char *msg, const unsigned char *eom,
 }
 
 
+/** Convert wire format domain name to lower case, in place. Name MUST be
+ * uncompressed and already validated, i.e. by @ref rip_ns_name_unpack.
+ * Label length bytes are never in 'A'..'Z' range so whole name is converted
+ * as a single string.
+ *
+ * @param name Wire format domain name.
+ *
+ * @return     Returns length of name, including root label.
+ */
+uint16_t
+rip_ns_name_lc(unsigned char *name)
+{
+    uint16_t len = 0;
+
+    while (name[len] != 0 && len < RIP_NS_MAXCDNAME) {
+        len += name[len] + 1;
+    }
+    len += 1;
+    str_to_lc(name, len);
+
+    return len;
+}
+
+/** Multiply two 64 bit values and fold 128 bit product into 64 bits.
+ *
+ * @param a First value.
+ * @param b Second value.
+ *
+ * @return  Returns xor of high and low 64 bits of product.
+ */
+static inline uint64_t
+rip_ns_name_hash_mum(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t)a * b;
+
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/** Load last 1 to 7 bytes of name, zero extended, same as copying them into a
+ * zeroed 64 bit word would. Name of 8 bytes or longer is loaded with a
+ * single load of its last 8 bytes, shifted, instead of a variable length
+ * copy.
+ *
+ * @param name     Wire format name.
+ * @param name_len Length of name.
+ * @param i        Offset of tail, name_len - i is 1 to 7.
+ *
+ * @return         Returns tail bytes as 64 bit word.
+ */
+static inline uint64_t
+rip_ns_name_hash_tail(const unsigned char *name, uint16_t name_len, uint16_t i)
+{
+    uint64_t w = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (name_len >= 8) {
+        memcpy(&w, name + name_len - 8, 8);
+        return w >> (8 - (name_len - i)) * 8;
+    }
+#endif
+    memcpy(&w, name + i, name_len - i);
+    return w;
+}
+
+/** Hash a wire format domain name, 8 bytes at a time, with multiply and fold
+ * mixing in the style of wyhash. Name is expected to already be in canonical
+ * (lower cased) form, see @ref rip_ns_name_lc.
+ *
+ * Query question name is hashed once when query is parsed, and the hash is
+ * shared by zone lookup and response cache.
+ *
+ * @param name     Wire format name to hash.
+ * @param name_len Length of name.
+ *
+ * @return         Returns 64 bit name hash.
+ */
+uint64_t
+rip_ns_name_hash(const unsigned char *name, uint16_t name_len)
+{
+    const uint64_t p0 = 0xa0761d6478bd642fULL;
+    const uint64_t p1 = 0xe7037ed1a0b428dbULL;
+    const uint64_t p2 = 0x8ebc6af09c88c6e3ULL;
+    uint64_t       h  = p0 ^ name_len;
+    uint64_t       w;
+    uint16_t       i  = 0;
+
+    for (; i + 8 <= name_len; i += 8) {
+        memcpy(&w, name + i, 8);
+        h = rip_ns_name_hash_mum(h ^ w, p1);
+    }
+    if (i < name_len) {
+        w = rip_ns_name_hash_tail(name, name_len, i);
+        h = rip_ns_name_hash_mum(h ^ w, p1);
+    }
+    return rip_ns_name_hash_mum(h ^ p2, p1 ^ name_len);
+}
+
 /** Unpack a domain name from a message Resource Record (RR), source may be
  * compressed. Unpacked name will be in "network" format. Use @ref 
  * rip_ns_name_ntop() function to convert from "network" to regular C string.
@@ -357,72 +454,100 @@ rip_ns_name_unpack(const unsigned char *msg, const unsigned char *eom,
     return len;
 }
 
-/** Search for the counted-label name in an array of compressed names.
+/** Extend name suffix hash with a label, 32 bit FNV-1a over label length and
+ * label bytes. Suffix hash is extended label by label from root, so hashes of
+ * all suffixes of a name are computed in one pass over it.
  *
- * DNPTRS is the pointer to the first name on the list, not the
- * pointer to the start of the message.
+ * @note This is a helper function for @ref rip_ns_name_pack().
+ *
+ * @param hash  Hash of suffix after label.
+ * @param label Label, length followed by label bytes.
+ *
+ * @return      Returns hash of suffix starting at label.
+ */
+static inline uint32_t
+rip_ns_comp_hash(uint32_t hash, const unsigned char *label)
+{
+    for (unsigned int i = 0; i <= label[0]; i++) {
+        hash = (hash ^ label[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Check if name packed into message at offset is name suffix. Comparison is
+ * exact (case sensitive) and follows compression pointers. Pointers must
+ * point backward, so a damaged message can not loop.
  *
  * @note This is a helper function for @ref rip_ns_name_pack().
- * 
- * @param domain    Name to search for.
- * @param msg       DNS message to search name in.
- * @param dnptrs    See @ref rip_ns_name_put().
- * @param lastdnptr See @ref rip_ns_name_put().
- * 
- * @return          Returns the offset from MSG if found, or -1.
+ *
+ * @param msg    DNS message.
+ * @param offset Offset of packed name from message start.
+ * @param domain Name suffix, in "network" format.
+ *
+ * @return       Returns true if names are equal, otherwise returns false.
  */
-static int
-rip_dn_find(const unsigned char *domain, const unsigned char *msg,
-            const unsigned char **dnptrs, const unsigned char **lastdnptr)
+static bool
+rip_ns_comp_equal(const unsigned char *msg, uint16_t offset, const unsigned char *domain)
 {
-    const unsigned char *dn, *cp, *sp;
-    const unsigned char **cpp;
+    const unsigned char *cp = msg + offset;
+    const unsigned char *dn = domain;
     unsigned int        n;
 
-    for (cpp = dnptrs; cpp < lastdnptr; cpp++) {
-        sp = *cpp;
-        /* Terminate search on: root label, compression pointer, unusable
-         * offset.
-         */
-        while (*sp != 0 && (*sp & RIP_NS_CMPRSFLGS) == 0 && (sp - msg) < 0x4000) {
-            dn = domain;
-            cp = sp;
-            while ((n = *cp++) != 0) {
-                /* Check for indirection.  */
-                switch (n & RIP_NS_CMPRSFLGS) {
-                case 0: /* Normal case, n == len.  */
-                    if (n != *dn++) {
-                        goto next;
-                    }
-                    for (; n > 0; n--) { 
-                        if (*dn++ != *cp++) { 
-                            goto next;
-                        }
-                    }
-                    /* Is next root for both?  */
-                    if (*dn == '\0' && *cp == '\0') { 
-                        return sp - msg;
-                    }
-                    if (*dn) { 
-                        continue;
-                    }
-                    goto next;
-
-                case RIP_NS_CMPRSFLGS:
-                    /* Indirection.  */
-                    cp = msg + (((n & 0x3f) << 8) | *cp);
-                    break;
+    for (;;) {
+        n = *cp;
+        switch (n & RIP_NS_CMPRSFLGS) {
+        case 0: /* Normal case, n == len.  */
+            if (n != *dn || memcmp(cp + 1, dn + 1, n) != 0) {
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            cp += n + 1;
+            dn += n + 1;
+            break;
 
-                default:
-                    /* Illegal type. EMSGSIZE */
-                    return -1;
-                }
+        case RIP_NS_CMPRSFLGS:
+            /* Indirection.  */
+            offset = ((n & 0x3f) << 8) | cp[1];
+            if (msg + offset >= cp) {
+                return false;
             }
-            next: ;
-            sp += *sp + 1;
+            cp = msg + offset;
+            break;
+
+        default:
+            /* Illegal type. */
+            return false;
         }
     }
-    /* EMSGSIZE */
+}
+
+/** Look up name suffix in name compression table.
+ *
+ * @note This is a helper function for @ref rip_ns_name_pack().
+ *
+ * @param comp   Name compression table.
+ * @param domain Name suffix to look up.
+ * @param hash   Hash of name suffix.
+ * @param slot   Pointer where to store index of empty slot suffix would be
+ *               recorded in, if it is not found.
+ *
+ * @return       Returns offset of suffix from message start if found, or -1.
+ */
+static int
+rip_ns_comp_find(const rip_ns_comp_t *comp, const unsigned char *domain, uint32_t hash,
+                 uint16_t *slot)
+{
+    uint16_t i = (hash ^ (hash >> 16)) & (RIP_NS_COMP_SLOTS - 1);
+
+    for (; comp->slots[i].gen == comp->gen; i = (i + 1) & (RIP_NS_COMP_SLOTS - 1)) {
+        if (comp->slots[i].hash == hash &&
+            rip_ns_comp_equal(comp->msg, comp->slots[i].offset, domain)) {
+            return comp->slots[i].offset;
+        }
+    }
+    *slot = i;
     return -1;
 }
 
@@ -541,46 +666,37 @@ rip_ns_name_pton(const unsigned char *src, unsigned char *dst, size_t dstsiz)
 /** Packs domain name SRC into DST. Domain name MUST be in "network" format.
  * To convert C string to "network" format use @ref rip_ns_name_pton().
  *
- * DNPTRS is an array of pointers to previous compressed names.
- * DNPTRS[0] is a pointer to the beginning of the message. The array
- * ends with NULL. LASTDNPTR is a pointer to the end of the array
- * pointed to by 'dnptrs'.
- *
- * The list of pointers in DNPTRS is updated for labels inserted into
- * the message as we compress the name. If DNPTRS is NULL, we don't
- * try to compress names. If LASTDNPTR is NULL, we don't update the
- * list.
+ * COMP is name compression table of message DST is in. Every suffix of name
+ * is looked up in it, longest first, and name is compressed with a pointer to
+ * first one found. Suffixes packed as labels are recorded in it, while it has
+ * room and they are at offsets a pointer can hold. If COMP is NULL, we don't
+ * try to compress names. If packing fails suffixes it recorded are removed.
  *
  * @param src       Domain name in "network" format to pack.
  * @param dst       Destination buffer where to pack the domain name.
  * @param dstsiz    Length of destination buffer.
- * @param dnptrs
- * @param lastdnptr 
+ * @param comp      Name compression table, or NULL not to compress name.
  *
  * @return          Returns size of the compressed name, or -1.
  */
 int
 rip_ns_name_pack(const unsigned char *src, unsigned char *dst, int dstsiz,
-                 const unsigned char **dnptrs, const unsigned char **lastdnptr)
+                 rip_ns_comp_t *comp)
 {
+    const unsigned char *labels[RIP_NS_MAXCDNAME / 2 + 1];
+    uint32_t            hashes[RIP_NS_MAXCDNAME / 2 + 1];
+    uint16_t            added[RIP_NS_MAXCDNAME / 2 + 1];
     unsigned char       *dstp;
-    const unsigned char **cpp, **lpp, *eob, *msg;
-    const unsigned char *srcp;
-    int                 n, l, first = 1;
+    const unsigned char *srcp, *eob;
+    uint32_t            hash;
+    uint16_t            slot;
+    int                 n, l, nlabels, nadded;
 
-    srcp = src;
-    dstp = dst;
-    eob  = dstp + dstsiz;
-    lpp  = cpp = NULL;
-    if (dnptrs != NULL) {
-        if ((msg = *dnptrs++) != NULL) {
-            for (cpp = dnptrs; *cpp != NULL; cpp++)
-            ;
-            lpp = cpp; /* End of list to search. */
-        }
-    } else {
-        msg = NULL;
-    }
+    srcp    = src;
+    dstp    = dst;
+    eob     = dstp + dstsiz;
+    nlabels = 0;
+    nadded  = 0;
 
     /* Make sure the domain we are about to add is legal. */
     l = 0;
@@ -595,17 +711,28 @@ rip_ns_name_pack(const unsigned char *src, unsigned char *dst, int dstsiz,
             /* EMSGSIZE */
             return -1;
         }
+        if (n != 0) {
+            labels[nlabels++] = srcp;
+        }
         srcp += n + 1;
     }
     while (n != 0);
 
-    /* from here on we need to reset compression pointer array on error */
-    srcp = src;
-    do {
+    /* Hashes of suffixes, from root. */
+    if (comp != NULL) {
+        hash = 2166136261u;
+        for (int i = nlabels - 1; i >= 0; i--) {
+            hash = rip_ns_comp_hash(hash, labels[i]);
+            hashes[i] = hash;
+        }
+    }
+
+    /* from here on we need to remove recorded suffixes on error */
+    for (int i = 0; i < nlabels; i++) {
+        n = *labels[i];
         /* Look to see if we can use pointers. */
-        n = *srcp;
-        if (n != 0 && msg != NULL) {
-            l = rip_dn_find (srcp, msg, dnptrs, lpp);
+        if (comp != NULL) {
+            l = rip_ns_comp_find(comp, labels[i], hashes[i], &slot);
             if (l >= 0) {
                 if (eob - dstp <= 1) {
                     goto cleanup;
@@ -615,36 +742,41 @@ rip_ns_name_pack(const unsigned char *src, unsigned char *dst, int dstsiz,
                 return dstp - dst;
             }
             /* Not found, save it.  */
-            if (lastdnptr != NULL && cpp < lastdnptr - 1
-                && (dstp - msg) < 0x4000 && first) {
-                *cpp++ = dstp;
-                *cpp = NULL;
-                first = 0;
+            if (comp->count < RIP_NS_COMP_NAMES_MAX && (dstp - comp->msg) < 0x4000) {
+                comp->slots[slot] = (rip_ns_comp_slot_t) {
+                    .hash   = hashes[i],
+                    .offset = dstp - comp->msg,
+                    .gen    = comp->gen,
+                };
+                comp->count += 1;
+                added[nadded++] = slot;
             }
         }
         /* Copy label to buffer.  */
-        if (n >= 64) {
-            /* Should not happen.  */
-            goto cleanup;
-        }
         if (n + 1 > eob - dstp) {
             goto cleanup;
         }
-        memcpy (dstp, srcp, n + 1);
-        srcp += n + 1;
+        memcpy (dstp, labels[i], n + 1);
         dstp += n + 1;
     }
-    while (n != 0);
-
-    if (dstp > eob) {
-    cleanup:
-        if (msg != NULL) {
-            *lpp = NULL;
-        }
-        /* EMSGSIZE */
-        return -1;
+    if (dstp >= eob) {
+        goto cleanup;
     }
+    *dstp++ = 0;
     return dstp - dst;
+
+cleanup:
+    /* Slots recorded here are last ones recorded, no probe sequence of an
+     * earlier suffix passes through them, they can be emptied.
+     */
+    for (int i = 0; i < nadded; i++) {
+        comp->slots[added[i]].gen = 0;
+    }
+    if (comp != NULL) {
+        comp->count -= nadded;
+    }
+    /* EMSGSIZE */
+    return -1;
 }
 
 
@@ -22,17 +22,124 @@
  * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <errno.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/sysinfo.h>
 
 #include "log_app.h"
+#include "admin.h"
 #include "channel.h"
 #include "config.h"
+#include "dnssec.h"
+#include "dot.h"
+#include "lb.h"
 #include "metrics.h"
+#include "prefork.h"
 #include "resource.h"
+#include "response_cache.h"
+#include "topology.h"
+#include "upgrade.h"
 #include "utils.h"
 #include "vectorloop.h"
+#include "vectorloop_calibrate.h"
+#include "zone_secondary.h"
+
+/** Place threads on CPUs: bind vectorloops not bound by hand to CPUs picked
+ * from CPU topology, if "process_thread_auto_pin" is set, and find CPUs
+ * support threads are bound to, "process_housekeeping_cpus" or, with auto
+ * pinning, CPUs left without a vectorloop. Bindings chosen are written to
+ * stdout.
+ *
+ * @param cfg          Configuration, vectorloop bindings are set in it.
+ * @param support_cpus CPU set support threads are to be bound to.
+ *
+ * @return             Returns true if support threads are to be bound.
+ */
+static bool
+ripples_threads_place(config_t *cfg, cpu_set_t *support_cpus)
+{
+    unsigned int   cpus         = get_nprocs_conf();
+    unsigned char *housekeeping = NULL;
+    size_t        *masks        = NULL;
+    const char    *ifname       = NULL;
+    topology_t     topo;
+    int            support      = 0;
+
+    CPU_ZERO(support_cpus);
+    if (cfg->process_housekeeping_cpus != NULL) {
+        housekeeping = malloc(cpus);
+        CHECK_MALLOC(housekeeping);
+        topology_cpu_list_parse(cfg->process_housekeeping_cpus, housekeeping, cpus);
+        for (unsigned int cpu = 0; cpu < cpus && cpu < CPU_SETSIZE; cpu++) {
+            if (housekeeping[cpu]) {
+                CPU_SET(cpu, support_cpus);
+                support++;
+            }
+        }
+    }
+
+    if (cfg->process_thread_auto_pin) {
+        masks = malloc(sizeof(size_t) * cfg->process_thread_count);
+        CHECK_MALLOC(masks);
+        memcpy(masks, cfg->process_thread_masks,
+               sizeof(size_t) * cfg->process_thread_count);
+
+        topology_load(&topo, TOPOLOGY_SYSFS_PATH, cpus);
+        ifname = cfg->process_thread_auto_pin_interface != NULL ?
+                 cfg->process_thread_auto_pin_interface : cfg->xdp_interface;
+        if (ifname != NULL) {
+            topology_nic_load(&topo, TOPOLOGY_SYSFS_PATH, TOPOLOGY_PROCFS_PATH,
+                              ifname);
+        }
+        topology_vl_place(&topo, housekeeping, cfg->process_thread_masks,
+                          cfg->process_thread_count);
+
+        for (size_t i = 0; i < cfg->process_thread_count; i++) {
+            size_t cpu = cfg->process_thread_masks[i];
+
+            if (cpu == 0) {
+                fprintf(stderr, "Warning: vectorloop %zu could not be bound to a "
+                        "CPU of its own, it is left unbound\n", i);
+            } else if (masks[i] == 0) {
+                topology_cpu_t *tc = &topo.cpus[cpu - 1];
+
+                fprintf(stdout, "Vectorloop %zu bound to CPU %zu (package %d, "
+                        "core %d, NUMA node %d%s)\n", i, cpu - 1, tc->package,
+                        tc->core, tc->node, tc->nic_irq ? ", interface interrupts" : "");
+            }
+        }
+
+        /* Support threads get CPUs no vectorloop runs on. */
+        for (unsigned int cpu = 0; housekeeping == NULL && cpu < cpus &&
+             cpu < CPU_SETSIZE; cpu++) {
+            bool used = false;
+
+            for (size_t i = 0; i < cfg->process_thread_count; i++) {
+                used |= cfg->process_thread_masks[i] == cpu + 1;
+            }
+            if (topo.cpus[cpu].online && !used) {
+                CPU_SET(cpu, support_cpus);
+                support++;
+            }
+        }
+        topology_release(&topo);
+        free(masks);
+    }
+    free(housekeeping);
+
+    if (support > 0) {
+        fprintf(stdout, "Support threads bound to %d CPUs\n", support);
+    }
+    fflush(stdout);
+
+    return support > 0;
+}
 
 /** This is the main process thread function for ripples application.
  * The reason this code is separated from function @ref main() is so unit tests
@@ -46,16 +153,29 @@
 int
 ripples(int argc, char *argv[])
 {
-    config_t      *cfg                = NULL;
-    pthread_t     *pthreads           = NULL;
-    channel_bss_t *resource_channels  = NULL;
-    channel_log_t *app_log_channels   = NULL;
-    channel_bss_t *query_log_channels = NULL;
-    size_t         channels_count     = 0;
+    config_t       *cfg                = NULL;
+    pthread_t      *pthreads           = NULL;
+    resource_set_t *resources          = NULL;
+    channel_log_t  *app_log_channels   = NULL;
+    query_log_t   **query_logs         = NULL;
+    size_t          channels_count     = 0;
+    vl_xdp_prog_t  *xdp_prog           = NULL;
+    vl_reuseport_t *reuseport          = NULL;
+    dot_ctx_t      *dot_ctx            = NULL;
+    dnssec_key_t   *dnssec_key         = NULL;
+    vl_handoff_t   *handoff            = NULL;
+    upgrade_t      *upgrade            = NULL;
+    vl_drain_t     *drain              = NULL;
+    admin_vl_state_t *admin_states     = NULL;
+    zone_secondary_t *secondary        = NULL;
+    vl_calibrate_t *calibrate          = NULL;
+    vl_calibrate_result_t calibrated;
+    char            calibrated_str[256];
+    int             app_log_wake_fd    = -1;
+    cpu_set_t       support_cpus;
+    bool            support_bind       = false;
 
-    metrics_t *metrics = malloc(sizeof(metrics_t));
-    CHECK_MALLOC(metrics);
-    *metrics = (metrics_t){ };
+    metrics_t      *metrics            = NULL;
 
     /* Initialize configuration defaults. */
     cfg = malloc(sizeof(config_t));
@@ -69,46 +189,341 @@ ripples(int argc, char *argv[])
         exit(1);
     }
 
+    /* Compile zone file into zone image and exit. */
+    if (cfg->zone_image_compile_filepath[0] != '\0') {
+        char err[ERR_MSG_LENGTH];
+
+        if (resource_zone_image_compile(cfg->resource_1_filepath,
+                                        cfg->zone_image_compile_filepath,
+                                        err, sizeof(err)) != 0) {
+            fprintf(stderr, "Error compiling zone image: %s\n", err);
+            exit(1);
+        }
+        exit(0);
+    }
+
+    /* Configuration file is loaded by resource thread, check it up front so
+     * an error in it is reported at startup rather than in application log.
+     */
+    if (cfg->resource_3_filepath[0] != '\0') {
+        char      err[ERR_MSG_LENGTH];
+        char     *buf     = NULL;
+        long      buf_len = 0;
+        config_t *reload  = NULL;
+        FILE     *file    = fopen(cfg->resource_3_filepath, "r");
+
+        if (file == NULL) {
+            fprintf(stderr, "Error opening configuration file \"%s\": %s\n",
+                    cfg->resource_3_filepath, strerror(errno));
+            exit(1);
+        }
+        fseek(file, 0, SEEK_END);
+        buf_len = ftell(file);
+        rewind(file);
+        buf = malloc(buf_len + 1);
+        CHECK_MALLOC(buf);
+        buf_len = fread(buf, 1, buf_len, file);
+        fclose(file);
+
+        reload = config_reload(cfg, buf, buf_len, 0, err, sizeof(err));
+        free(buf);
+        if (reload == NULL) {
+            fprintf(stderr, "Error in configuration file \"%s\": %s\n",
+                    cfg->resource_3_filepath, err);
+            exit(1);
+        }
+        free(reload);
+    }
+
+    /* Tune vectorloop settings to this server before vectorloops, or worker
+     * processes running them, are started. Calibration vectorloop is kept
+     * for calibration on demand (SIGUSR1).
+     */
+    if (cfg->loop_calibrate) {
+        char err[ERR_MSG_LENGTH];
+
+        calibrate = malloc(sizeof(vl_calibrate_t));
+        CHECK_MALLOC(calibrate);
+        if (vl_calibrate_init(calibrate, cfg, err, sizeof(err)) != 0) {
+            fprintf(stderr, "Error calibrating vectorloops: %s\n", err);
+            exit(1);
+        }
+        vl_calibrate_run(calibrate, &calibrated);
+        vl_calibrate_apply(&calibrated, cfg);
+        vl_calibrate_format(&calibrated, calibrated_str, sizeof(calibrated_str));
+        fprintf(stdout, "Vectorloops calibrated: %s\n", calibrated_str);
+        fflush(stdout);
+    }
+
+    /* Initialize metrics with a metrics shard for each vectorloop, of all
+     * worker processes if there are any, in memory they share.
+     */
+    if (cfg->process_workers > 0) {
+        metrics = metrics_new_shared(cfg->process_workers * cfg->process_thread_count);
+    } else {
+        metrics = malloc(sizeof(metrics_t));
+        CHECK_MALLOC(metrics);
+        metrics_init(metrics, cfg->process_thread_count);
+    }
+    atomic_store(&metrics->mem.budget, (unsigned long long)cfg->memory_budget * 1024 * 1024);
+    if (cfg->loop_stage_metrics) {
+        atomic_store(&metrics->cycles_per_sec, utl_cycles_per_sec());
+    }
+    if (cfg->metrics_enable && cfg->metrics_sketches) {
+        metrics_sketch_init(metrics);
+    }
+    if (cfg->metrics_enable && cfg->metrics_query_cost > 0) {
+        metrics_cost_init(metrics);
+    }
+    if (cfg->metrics_enable && cfg->metrics_zones) {
+        metrics_zones_init(metrics);
+    }
+    if (cfg->udp_listener_addresses_count > 0) {
+        metrics_udp_addrs_init(metrics, cfg->udp_listener_addresses,
+                               cfg->udp_listener_addresses_count);
+    }
+
+    /* Master process only supervises worker processes, each worker carries
+     * on from here as single process application does.
+     */
+    if (cfg->process_workers > 0) {
+        prefork_t *prefork = malloc(sizeof(prefork_t));
+
+        CHECK_MALLOC(prefork);
+        prefork_init(prefork, cfg, metrics);
+        if (!prefork_run(prefork)) {
+            prefork_clean(prefork);
+            free(prefork);
+            return 0;
+        }
+    }
+
+    /* Bind threads to CPUs, before AF_XDP queues and reuseport steering are
+     * set up by vectorloop CPUs.
+     */
+    support_bind = ripples_threads_place(cfg, &support_cpus);
+
+    /* Real-time vectorloops are preempted only by what still runs on their
+     * CPUs, warn about CPUs left shared.
+     */
+    if (cfg->process_thread_sched_policy != SCHED_OTHER) {
+        topology_isolation_check(TOPOLOGY_SYSFS_PATH, cfg->process_thread_masks,
+                                 cfg->process_thread_count, get_nprocs_conf(),
+                                 stderr);
+    }
+
+    /* Lock memory before vectorloops allocate theirs, so it is locked as it
+     * is faulted in.
+     */
+    if (cfg->process_mlockall && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "Warning: could not lock process memory, error no: %d, "
+                "error message: %s\n", errno, strerror(errno));
+    }
+
     /* Initialize channels. */
     channels_count    = cfg->process_thread_count;
-    resource_channels = malloc(sizeof(channel_bss_t) * channels_count);
-    CHECK_MALLOC(resource_channels);
-    app_log_channels = malloc(sizeof(channel_log_t) * (channels_count + 3)); /* +3 for resource, app log & query log threads. */
+    app_log_channels = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_log_t) * (channels_count + 10)); /* +10 for resource, app log, query log, metrics, query log writer, upgrade, main, zone transfer, admin & health checker threads. */
     CHECK_MALLOC(app_log_channels);
-    query_log_channels = malloc(sizeof(channel_bss_t) * channels_count);
-    CHECK_MALLOC(query_log_channels);
+    query_logs = malloc(sizeof(query_log_t *) * channels_count);
+    CHECK_MALLOC(query_logs);
+
+    /* Resources published to vectorloops, health checker thread is one more
+     * reader of them.
+     */
+    resources = aligned_alloc(CACHE_LINE_SIZE, sizeof(resource_set_t));
+    CHECK_MALLOC(resources);
+    resource_set_init(resources, cfg->process_thread_count + 1);
 
-    /* Resource and query channels. */
-    for (int i = 0; i < channels_count; i++) {
-        lfds711_queue_bss_init_valid_on_current_logical_core(&resource_channels[i].bss.qbsss,
-            resource_channels[i].bss.qbsse, CHANNEL_BSS_QUEUE_LEN, NULL);
-        lfds711_queue_bss_init_valid_on_current_logical_core(&resource_channels[i].vl.qbsss,
-            resource_channels[i].bss.qbsse, CHANNEL_BSS_QUEUE_LEN, NULL);
+    /* App log channels, all share one eventfd to wake up app log thread. */
+    app_log_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (app_log_wake_fd < 0) {
+        fprintf(stderr, "Could not create app log eventfd, error no: %d, "
+                "error message: %s.\n", errno, strerror(errno));
+        exit(1);
+    }
+    for (int i = 0; i < (channels_count + 10); i++) {
+        channel_log_init(&app_log_channels[i], app_log_wake_fd);
+    }
 
-        lfds711_queue_bss_init_valid_on_current_logical_core(&query_log_channels[i].bss.qbsss,
-            query_log_channels[i].bss.qbsse, CHANNEL_BSS_QUEUE_LEN, NULL);
-        lfds711_queue_bss_init_valid_on_current_logical_core(&query_log_channels[i].vl.qbsss,
-            query_log_channels[i].bss.qbsse, CHANNEL_BSS_QUEUE_LEN, NULL);
+
+    /* Load XDP program redirecting UDP DNS queries to vectorloop AF_XDP
+     * sockets, socket map has an entry for each receive queue bound to.
+     */
+    if (cfg->udp_enable && cfg->xdp_interface != NULL) {
+        unsigned int queues = 0;
+        char         err_str[ERR_MSG_LENGTH];
+
+        for (int i = 0; i < cfg->process_thread_count; i++) {
+            if (vl_xdp_queue_id(cfg, i) + 1 > queues) {
+                queues = vl_xdp_queue_id(cfg, i) + 1;
+            }
+        }
+        xdp_prog = malloc(sizeof(vl_xdp_prog_t));
+        CHECK_MALLOC(xdp_prog);
+        if (vl_xdp_prog_load(xdp_prog, cfg->xdp_interface, cfg->udp_listener_port,
+                             queues, cfg->xdp_responder_size, err_str,
+                             ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
     }
 
-    /* App log channels. */
-    for (int i = 0; i < (channels_count + 2); i++) {
-        lfds711_queue_bss_init_valid_on_current_logical_core(&app_log_channels[i].qbsss,
-            app_log_channels[i].qbsse, CHANNEL_LOG_QUEUE_LEN, NULL);
+    /* Load reuseport programs steering queries to listeners of vectorloop
+     * bound to CPU that received them.
+     */
+    if (cfg->process_thread_cpu_steering) {
+        unsigned int cpus = get_nprocs_conf();
+        char         err_str[ERR_MSG_LENGTH];
+
+        reuseport = malloc(sizeof(vl_reuseport_t));
+        CHECK_MALLOC(reuseport);
+        if (vl_reuseport_load(reuseport, cpus, err_str, ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
+        vl_reuseport_config_check(cfg, cpus, VL_REUSEPORT_SOFTIRQS_PATH, stderr);
+    } else if (cfg->process_thread_client_steering) {
+        /* Or steering all queries of a client prefix to same vectorloop. */
+        char err_str[ERR_MSG_LENGTH];
+
+        reuseport = malloc(sizeof(vl_reuseport_t));
+        CHECK_MALLOC(reuseport);
+        if (vl_reuseport_load_client(reuseport, cfg, cfg->rrl_ipv4_prefix_len,
+                                     cfg->rrl_ipv6_prefix_len, err_str,
+                                     ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
     }
 
+    /* Load TLS context DoT handshake threads use. */
+    if (cfg->dot_enable) {
+        char err_str[ERR_MSG_LENGTH];
 
-    /* Initialize threads. */
-    size_t pth_count = cfg->process_thread_count + 3;
+        dot_ctx = malloc(sizeof(dot_ctx_t));
+        CHECK_MALLOC(dot_ctx);
+        if (dot_ctx_load(dot_ctx, cfg, err_str, ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
+    }
+
+    /* Load key worker threads sign DNSSEC answers with. Its DNSKEY record is
+     * printed, to be published in zone and have DS record made from.
+     */
+    if (cfg->dnssec_key_file != NULL) {
+        char err_str[ERR_MSG_LENGTH];
+        char dnskey[512];
+
+        dnssec_key = malloc(sizeof(dnssec_key_t));
+        CHECK_MALLOC(dnssec_key);
+        if (dnssec_key_load(dnssec_key, cfg, err_str, ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
+        if (cfg->process_worker_id == 0 &&
+            dnssec_key_dnskey_text(dnssec_key, dnskey, sizeof(dnskey)) > 0) {
+            fprintf(stdout, "%s\n", dnskey);
+            fflush(stdout);
+        }
+    }
+
+    /* Secondary zones, transferred from zone primary by zone transfer thread
+     * and applied to zone database by resource thread.
+     */
+    if (cfg->zone_secondary[0] != '\0') {
+        char err_str[ERR_MSG_LENGTH];
+
+        secondary = malloc(sizeof(zone_secondary_t));
+        CHECK_MALLOC(secondary);
+        if (zone_secondary_init(secondary, cfg, resources, err_str, ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "Error in option \"zone_secondary\": %s\n", err_str);
+            exit(1);
+        }
+        resources->secondary = secondary;
+    }
+
+    /* Response cache shared by vectorloops, second level behind cache of
+     * each vectorloop.
+     */
+    if (cfg->response_cache_shared_size > 0) {
+        resources->response_cache = malloc(sizeof(response_cache_shared_t));
+        CHECK_MALLOC(resources->response_cache);
+        response_cache_shared_init(resources->response_cache,
+                                   cfg->response_cache_shared_size);
+    }
+
+    /* TCP connection handoff between vectorloops, of no use with single
+     * vectorloop.
+     */
+    if ((cfg->tcp_enable || cfg->dot_enable) && cfg->tcp_handoff &&
+        cfg->process_thread_count > 1) {
+        handoff = malloc(sizeof(vl_handoff_t));
+        CHECK_MALLOC(handoff);
+        vl_handoff_init(handoff, cfg);
+    }
+
+    /* Take listener sockets over from running process being upgraded, if
+     * there is one.
+     */
+    if (cfg->upgrade_socket[0] != '\0') {
+        char err_str[ERR_MSG_LENGTH];
+
+        upgrade = malloc(sizeof(upgrade_t));
+        CHECK_MALLOC(upgrade);
+        upgrade_init(upgrade, cfg);
+        if (upgrade_connect(upgrade, err_str, ERR_MSG_LENGTH) != 0) {
+            fprintf(stderr, "%s\n", err_str);
+            exit(1);
+        }
+    }
+
+    /* Vectorloops drain before application exits. */
+    drain = malloc(sizeof(vl_drain_t));
+    CHECK_MALLOC(drain);
+    vl_drain_init(drain, cfg->process_thread_count);
+
+    /* Vectorloop state snapshots admin thread serves. */
+    if (cfg->admin_socket[0] != '\0') {
+        admin_states = admin_vl_states_new(cfg->process_thread_count);
+    }
+
+    /* Termination, reload (SIGHUP) and calibration (SIGUSR1) signals are
+     * handled by main thread only, threads started from here on inherit
+     * blocked signal mask.
+     */
+    sigset_t signals;
+    int      sig = 0;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    /* Initialize threads, +8 for app log, resource, query log, metrics,
+     * upgrade, zone transfer, admin and health checker threads.
+     */
+    size_t pth_count = cfg->process_thread_count + 8;
     pthreads = malloc(sizeof(pthread_t) * pth_count);
     CHECK_MALLOC(pthreads);
 
+    /* Vectorloops allocate their buffers on their own thread, once bound to
+     * their CPU, other threads are started after all are done.
+     */
+    pthread_barrier_t vl_barrier;
+    pthread_barrier_init(&vl_barrier, NULL, cfg->process_thread_count + 1);
+
     int pth_ret = 0;
     /* Start vectorloop threads. */
     for (int i = 0; i < cfg->process_thread_count; i++) {
-        vectorloop_t *vl = vl_new(cfg, i, &resource_channels[i],
-                                 &app_log_channels[i],  &query_log_channels[i],
-                                 metrics);
+        vectorloop_t *vl = vl_new(cfg, i, resources,
+                                 &app_log_channels[i], metrics, xdp_prog,
+                                 reuseport, dot_ctx, dnssec_key, handoff, upgrade,
+                                 drain);
+        query_logs[i]     = &vl->query_log;
+        vl->start_barrier = &vl_barrier;
+        vl->admin_state   = admin_states != NULL ? &admin_states[i] : NULL;
 
         pth_ret = pthread_create(&pthreads[i], NULL, vl_run, vl);
         if (pth_ret != 0) {
@@ -119,11 +534,27 @@ ripples(int argc, char *argv[])
         }
     }
 
+    pthread_barrier_wait(&vl_barrier);
+
+    /* Support threads inherit CPU affinity of this thread, keeping them off
+     * vectorloop CPUs.
+     */
+    if (support_bind) {
+        pth_ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                         &support_cpus);
+        if (pth_ret != 0) {
+            fprintf(stderr, "Warning: could not bind support threads to CPUs, "
+                    "error no: %d, error message: %s\n", pth_ret, strerror(pth_ret));
+        }
+    }
+
     /* Start app log thread */
     app_log_loop_args_t app_log_args = {
         .cfg              = cfg,
-        .app_log_channels = app_log_channels,
-        .metrics          = metrics,
+        .app_log_channels      = app_log_channels,
+        .app_log_channel_count = channels_count + 10,
+        .wake_fd               = app_log_wake_fd,
+        .metrics               = metrics,
     };
     pth_ret = pthread_create(&pthreads[cfg->process_thread_count], NULL,
                              log_app_loop, &app_log_args);
@@ -136,7 +567,7 @@ ripples(int argc, char *argv[])
     /* Start resource thread */
     resource_loop_args_t res_args = {
         .cfg = cfg,
-        .resource_channels = resource_channels,
+        .resources         = resources,
         .app_log_channel   = &app_log_channels[channels_count],
         .metrics           = metrics,
     };
@@ -152,9 +583,10 @@ ripples(int argc, char *argv[])
     query_log_loop_args_t query_log_args = {
         .cfg = cfg,
         .metrics = metrics,
-        .query_log_channels = query_log_channels,
-        .query_log_channel_count = channels_count,
+        .query_logs = query_logs,
+        .query_log_count = channels_count,
         .app_log_channel = &app_log_channels[channels_count+1],
+        .writer_app_log_channel = &app_log_channels[channels_count+4],
     };
     pth_ret = pthread_create(&pthreads[cfg->process_thread_count+2], NULL,
                              query_log_loop, &query_log_args);
@@ -164,10 +596,159 @@ ripples(int argc, char *argv[])
         exit(1);
     }
 
-    /* Wait for threads to exit. */
-    for (int i = 0; i < pth_count; i++) {
-        pthread_join(pthreads[i], NULL);
+    /* Start metrics thread */
+    metrics_loop_args_t metrics_args = {
+        .cfg             = cfg,
+        .metrics         = metrics,
+        .app_log_channel = &app_log_channels[channels_count+3],
+        .xdp_prog        = xdp_prog,
+    };
+    if (cfg->metrics_enable == true && cfg->process_worker_id == 0) {
+        /* Worker processes share metrics, first worker exports them. */
+        pth_ret = pthread_create(&pthreads[cfg->process_thread_count+3], NULL,
+                                 metrics_loop, &metrics_args);
+        if (pth_ret != 0) {
+            fprintf(stderr,"Could not start metrics thread, error no: %d, "
+                    "error message: %s.", pth_ret, strerror(pth_ret));
+            exit(1);
+        }
+    }
+
+    /* Start upgrade thread */
+    upgrade_loop_args_t upgrade_args = {
+        .cfg             = cfg,
+        .upgrade         = upgrade,
+        .app_log_channel = &app_log_channels[channels_count+5],
+    };
+    if (upgrade != NULL) {
+        pth_ret = pthread_create(&pthreads[cfg->process_thread_count+4], NULL,
+                                 upgrade_loop, &upgrade_args);
+        if (pth_ret != 0) {
+            fprintf(stderr,"Could not start upgrade thread, error no: %d, "
+                    "error message: %s.", pth_ret, strerror(pth_ret));
+            exit(1);
+        }
+    }
+
+    /* Start zone transfer thread */
+    zone_secondary_loop_args_t secondary_args = {
+        .secondary       = secondary,
+        .app_log_channel = &app_log_channels[channels_count+7],
+    };
+    if (secondary != NULL) {
+        pth_ret = pthread_create(&pthreads[cfg->process_thread_count+5], NULL,
+                                 zone_secondary_loop, &secondary_args);
+        if (pth_ret != 0) {
+            fprintf(stderr,"Could not start zone transfer thread, error no: %d, "
+                    "error message: %s.", pth_ret, strerror(pth_ret));
+            exit(1);
+        }
+    }
+
+    /* Start admin thread */
+    admin_loop_args_t admin_args = {
+        .cfg             = cfg,
+        .vl_states       = admin_states,
+        .vl_count        = cfg->process_thread_count,
+        .app_log_channel = &app_log_channels[channels_count+8],
+    };
+    if (admin_states != NULL) {
+        pth_ret = pthread_create(&pthreads[cfg->process_thread_count+6], NULL,
+                                 admin_loop, &admin_args);
+        if (pth_ret != 0) {
+            fprintf(stderr,"Could not start admin thread, error no: %d, "
+                    "error message: %s.", pth_ret, strerror(pth_ret));
+            exit(1);
+        }
+    }
+
+    /* Start health checker thread */
+    lb_check_loop_args_t lb_check_args = {
+        .cfg             = cfg,
+        .resources       = resources,
+        .reader_id       = cfg->process_thread_count,
+        .app_log_channel = &app_log_channels[channels_count+9],
+        .metrics         = metrics,
+    };
+    if (cfg->resource_8_filepath[0] != '\0') {
+        pth_ret = pthread_create(&pthreads[cfg->process_thread_count+7], NULL,
+                                 lb_check_loop, &lb_check_args);
+        if (pth_ret != 0) {
+            fprintf(stderr,"Could not start health checker thread, error no: %d, "
+                    "error message: %s.", pth_ret, strerror(pth_ret));
+            exit(1);
+        }
+    }
+
+    /* Threads run until termination signal, then application drains and
+     * exits normally, so exit handlers run (e.g. profile data of an
+     * instrumented build is written, see "make release_pgo"). SIGHUP has
+     * resource thread check configuration file, and other resources, for
+     * change right away. SIGUSR1 has main thread calibrate vectorloop
+     * settings again and log those it would choose, settings vectorloops
+     * run with are not changed.
+     */
+    while (sigwait(&signals, &sig) == 0 && (sig == SIGHUP || sig == SIGUSR1)) {
+        if (sig == SIGHUP) {
+            resource_set_reload(resources);
+            continue;
+        }
+        if (calibrate == NULL) {
+            char err[ERR_MSG_LENGTH];
+
+            calibrate = malloc(sizeof(vl_calibrate_t));
+            CHECK_MALLOC(calibrate);
+            if (vl_calibrate_init(calibrate, cfg, err, sizeof(err)) != 0) {
+                channel_log_send(&app_log_channels[channels_count+6], 0, false,
+                                 "Error calibrating vectorloops: %s", err);
+                free(calibrate);
+                calibrate = NULL;
+                continue;
+            }
+        }
+        vl_calibrate_run(calibrate, &calibrated);
+        vl_calibrate_format(&calibrated, calibrated_str, sizeof(calibrated_str));
+        channel_log_send(&app_log_channels[channels_count+6], 0, false,
+                         "Vectorloops calibrated: %s", calibrated_str);
+    }
+
+    /* Have vectorloops drain, waiting for them at most "drain_time". Second
+     * termination signal stops waiting.
+     */
+    channel_log_t   *main_log_channel = &app_log_channels[channels_count+6];
+    uint64_t         drain_end_us     = utl_clock_monotonic_us_fatal() +
+                                        cfg->drain_time * 1000000;
+    struct timespec  drain_poll       = { .tv_sec = 0, .tv_nsec = DRAIN_POLL_MS * 1000000L };
+    size_t           drained;
+
+    channel_log_send(main_log_channel, 0, false, "Shutdown on %s, draining",
+                     strsignal(sig));
+    vl_drain_start(drain);
+    while (vl_drain_count(drain) < cfg->process_thread_count &&
+           utl_clock_monotonic_us_fatal() < drain_end_us) {
+        sig = sigtimedwait(&signals, NULL, &drain_poll);
+        if (sig == SIGHUP) {
+            resource_set_reload(resources);
+        } else if (sig == SIGINT || sig == SIGTERM) {
+            break;
+        }
+    }
+    drained = vl_drain_count(drain);
+    channel_log_send(main_log_channel, 0, false,
+                     "Shutdown, %zu of %zu vectorloops drained, exiting",
+                     drained, cfg->process_thread_count);
+    if (drained == cfg->process_thread_count) {
+        for (int i = 0; i < cfg->process_thread_count; i++) {
+            pthread_join(pthreads[i], NULL);
+        }
     }
 
+    /* Write out query log vectorloops published, then application log. */
+    atomic_store_explicit(&query_log_args.stop, true, memory_order_release);
+    pthread_join(pthreads[cfg->process_thread_count+2], NULL);
+    atomic_store_explicit(&app_log_args.stop, true, memory_order_release);
+    eventfd_write(app_log_wake_fd, 1);
+    pthread_join(pthreads[cfg->process_thread_count], NULL);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+/**
+ * @file rrl.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup rrl
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "rip_ns_utils.h"
+#include "rrl.h"
+#include "utils.h"
+
+/** Key bit set for every used entry. */
+#define RRL_KEY_VALID (1ULL << 63)
+
+/** Key bit set for IPv6 client networks. */
+#define RRL_KEY_IPV6  (1ULL << 60)
+
+/** Shift of response class within key. */
+#define RRL_KEY_CLASS_SHIFT 56
+
+/** Initialize RRL table.
+ *
+ * @param rrl                  Table to initialize.
+ * @param size                 Number of entries in table, rounded up to power
+ *                             of 2 and to at least one bucket. If 0 RRL is
+ *                             disabled.
+ * @param responses_per_second Responses per second allowed to each client
+ *                             network and response class. If 0 RRL is
+ *                             disabled.
+ * @param slip                 Every slip-th response over the limit is sent
+ *                             truncated, 0 to drop them all.
+ * @param ipv4_prefix_len      Prefix length IPv4 clients are grouped by.
+ * @param ipv6_prefix_len      Prefix length IPv6 clients are grouped by, up to
+ *                             @ref RRL_IPV6_PREFIX_LEN_MAX.
+ */
+void
+rrl_init(rrl_t *rrl, size_t size, unsigned int responses_per_second,
+         unsigned int slip, unsigned int ipv4_prefix_len,
+         unsigned int ipv6_prefix_len)
+{
+    size_t buckets_count = 1;
+
+    *rrl = (rrl_t) {};
+    if (size == 0 || responses_per_second == 0) {
+        return;
+    }
+    while (buckets_count * RRL_BUCKET_ENTRIES < size) {
+        buckets_count <<= 1;
+    }
+    rrl->buckets = mem_aligned_alloc(MEM_TAG_RRL, CACHE_LINE_SIZE,
+                                     buckets_count * sizeof(rrl_bucket_t));
+    CHECK_MALLOC(rrl->buckets);
+    memset(rrl->buckets, 0, buckets_count * sizeof(rrl_bucket_t));
+
+    rrl->mask      = buckets_count - 1;
+    rrl->interval  = 1000000 / responses_per_second;
+    rrl->burst     = 1000000 - rrl->interval;
+    rrl->slip      = slip;
+    rrl->ipv4_mask = ipv4_prefix_len == 0 ? 0 :
+                     htonl(0xffffffffU << (32 - ipv4_prefix_len));
+    rrl->ipv6_bytes     = (ipv6_prefix_len + 7) / 8;
+    rrl->ipv6_last_mask = ipv6_prefix_len % 8 == 0 ? 0xff :
+                          (uint8_t)(0xff << (8 - ipv6_prefix_len % 8));
+}
+
+/** Release memory held by RRL table.
+ *
+ * @param rrl Table to release.
+ */
+void
+rrl_clean(rrl_t *rrl)
+{
+    mem_free(MEM_TAG_RRL, rrl->buckets);
+    *rrl = (rrl_t) {};
+}
+
+/** Get response class of packed query response.
+ *
+ * @param q Query with packed response.
+ *
+ * @return  Returns response class.
+ */
+rrl_class_t
+rrl_class(query_t *q)
+{
+    switch (q->end_code) {
+    case rip_ns_r_noerror:
+        return q->answer_section_count > 0 ? rrl_class_answer : rrl_class_nodata;
+    case rip_ns_r_nxdomain:
+        return rrl_class_nxdomain;
+    default:
+        return rrl_class_error;
+    }
+}
+
+/** Build entry key from client address and response class.
+ *
+ * @param rrl       RRL table.
+ * @param client_ip Client address.
+ * @param class     Response class.
+ *
+ * @return          Returns key.
+ */
+static uint64_t
+rrl_key(rrl_t *rrl, struct sockaddr_storage *client_ip, rrl_class_t class)
+{
+    uint64_t key = RRL_KEY_VALID | (uint64_t)class << RRL_KEY_CLASS_SHIFT;
+
+    if (client_ip->ss_family == AF_INET6) {
+        const uint8_t *addr = ((struct sockaddr_in6 *)client_ip)->sin6_addr.s6_addr;
+        uint64_t       net  = 0;
+
+        for (uint8_t i = 0; i < rrl->ipv6_bytes; i++) {
+            uint8_t byte = i == rrl->ipv6_bytes - 1 ? addr[i] & rrl->ipv6_last_mask :
+                                                      addr[i];
+
+            net |= (uint64_t)byte << (8 * (6 - i));
+        }
+        key |= RRL_KEY_IPV6 | net;
+    } else {
+        uint32_t addr = ((struct sockaddr_in *)client_ip)->sin_addr.s_addr;
+
+        key |= ntohl(addr & rrl->ipv4_mask);
+    }
+    return key;
+}
+
+/** Map entry key to table bucket.
+ *
+ * @param rrl RRL table.
+ * @param key Entry key.
+ *
+ * @return    Returns bucket key maps to.
+ */
+static inline rrl_bucket_t *
+rrl_bucket(rrl_t *rrl, uint64_t key)
+{
+    uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+
+    return &rrl->buckets[(hash ^ (hash >> 32)) & rrl->mask];
+}
+
+/** Account a response and decide what to do with it.
+ *
+ * @param rrl       RRL table.
+ * @param client_ip Client address response is sent to.
+ * @param class     Response class.
+ * @param now       Current monotonic time in microseconds.
+ *
+ * @return          Returns rrl_action_send if response is within limit,
+ *                  otherwise rrl_action_slip or rrl_action_drop.
+ */
+rrl_action_t
+rrl_check(rrl_t *rrl, struct sockaddr_storage *client_ip, rrl_class_t class,
+          uint64_t now)
+{
+    uint64_t      key    = rrl_key(rrl, client_ip, class);
+    rrl_bucket_t *bucket = rrl_bucket(rrl, key);
+    rrl_entry_t  *entry  = &bucket->entries[0];
+
+    for (size_t i = 0; i < RRL_BUCKET_ENTRIES; i++) {
+        if (bucket->entries[i].key == key) {
+            entry = &bucket->entries[i];
+            break;
+        }
+        if (bucket->entries[i].tat < entry->tat) {
+            entry = &bucket->entries[i];
+        }
+    }
+    if (entry->key != key) {
+        *entry = (rrl_entry_t) {
+            .key = key,
+            .tat = now,
+        };
+    }
+
+    if (entry->tat < now) {
+        entry->tat = now;
+    }
+    if (entry->tat - now <= rrl->burst) {
+        entry->tat += rrl->interval;
+        return rrl_action_send;
+    }
+
+    /* Over the limit. */
+    if (rrl->slip == 0) {
+        return rrl_action_drop;
+    }
+    if (++rrl->slip_count >= rrl->slip) {
+        rrl->slip_count = 0;
+        return rrl_action_slip;
+    }
+    return rrl_action_drop;
+}
+
+/** Replace packed UDP response with a truncated response holding only header
+ * and question, telling client to retry over TCP.
+ *
+ * @param q Query with packed response.
+ */
+void
+rrl_slip(query_t *q)
+{
+    q->response_hdr->tc      = 1;
+    q->response_hdr->ancount = 0;
+    q->response_hdr->nscount = 0;
+    q->response_hdr->arcount = 0;
+    q->response_buffer_len   = sizeof(rip_ns_header_t) + q->query_question_len;
+
+    q->answer_section_count     = 0;
+    q->authority_section_count  = 0;
+    q->additional_section_count = 0;
+}
+
+/** @}*/
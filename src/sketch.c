@@ -0,0 +1,402 @@
+/**
+ * @file sketch.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup sketch
+ *  @{
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sketch.h"
+#include "utils.h"
+
+/** Get index slot a key hashes to.
+ *
+ * @param t   Sketch.
+ * @param key Key.
+ *
+ * @return    Returns index slot.
+ */
+static inline uint32_t
+sketch_topk_slot(const sketch_topk_t *t, uint64_t key)
+{
+    return (uint32_t)sketch_mix(key) & (2 * t->capacity - 1);
+}
+
+/** Find entry of a key.
+ *
+ * @param t    Sketch.
+ * @param key  Key to find.
+ * @param slot Where to store index slot of key, or of empty slot key would be
+ *             stored in.
+ *
+ * @return     Returns entry index, or -1 if key is not counted.
+ */
+static inline int64_t
+sketch_topk_find(const sketch_topk_t *t, uint64_t key, uint32_t *slot)
+{
+    uint32_t mask = 2 * t->capacity - 1;
+    uint32_t s    = sketch_topk_slot(t, key);
+
+    while (t->index[s] != 0) {
+        if (t->entries[t->index[s] - 1].key == key) {
+            *slot = s;
+            return t->index[s] - 1;
+        }
+        s = (s + 1) & mask;
+    }
+    *slot = s;
+    return -1;
+}
+
+/** Remove a key from index, shifting back keys that follow it in its probe
+ * run so lookups need no tombstones.
+ *
+ * @param t   Sketch.
+ * @param key Key to remove, MUST be in index.
+ */
+static void
+sketch_topk_index_remove(sketch_topk_t *t, uint64_t key)
+{
+    uint32_t mask = 2 * t->capacity - 1;
+    uint32_t hole;
+    uint32_t s;
+    uint32_t home;
+
+    sketch_topk_find(t, key, &hole);
+    s = hole;
+    while (1) {
+        s = (s + 1) & mask;
+        if (t->index[s] == 0) {
+            break;
+        }
+        /* Key at s can fill the hole if hole is between its home slot and s. */
+        home = sketch_topk_slot(t, t->entries[t->index[s] - 1].key);
+        if (((s - home) & mask) >= ((s - hole) & mask)) {
+            t->index[hole] = t->index[s];
+            hole = s;
+        }
+    }
+    t->index[hole] = 0;
+}
+
+/** Swap two heap positions.
+ *
+ * @param t Sketch.
+ * @param a Heap position.
+ * @param b Heap position.
+ */
+static inline void
+sketch_topk_heap_swap(sketch_topk_t *t, uint32_t a, uint32_t b)
+{
+    uint32_t e = t->heap[a];
+
+    t->heap[a] = t->heap[b];
+    t->heap[b] = e;
+    t->entries[t->heap[a]].heap_pos = a;
+    t->entries[t->heap[b]].heap_pos = b;
+}
+
+/** Move an entry up the heap until its parent count is not larger.
+ *
+ * @param t   Sketch.
+ * @param pos Heap position of entry.
+ */
+static void
+sketch_topk_heap_up(sketch_topk_t *t, uint32_t pos)
+{
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+
+        if (t->entries[t->heap[parent]].count <= t->entries[t->heap[pos]].count) {
+            break;
+        }
+        sketch_topk_heap_swap(t, parent, pos);
+        pos = parent;
+    }
+}
+
+/** Move an entry down the heap until no child count is smaller. Counts only
+ * grow, so an entry whose count grew only moves down.
+ *
+ * @param t   Sketch.
+ * @param pos Heap position of entry.
+ */
+static void
+sketch_topk_heap_down(sketch_topk_t *t, uint32_t pos)
+{
+    while (1) {
+        uint32_t child = 2 * pos + 1;
+
+        if (child >= t->used) {
+            break;
+        }
+        if (child + 1 < t->used &&
+            t->entries[t->heap[child + 1]].count < t->entries[t->heap[child]].count) {
+            child++;
+        }
+        if (t->entries[t->heap[pos]].count <= t->entries[t->heap[child]].count) {
+            break;
+        }
+        sketch_topk_heap_swap(t, pos, child);
+        pos = child;
+    }
+}
+
+/** Initialize top-K sketch and allocate its arrays.
+ *
+ * @param t         Sketch to initialize.
+ * @param capacity  Maximum number of keys counted, MUST be a power of two.
+ * @param data_size Size of data stored with each key, 0 if none.
+ */
+void
+sketch_topk_init(sketch_topk_t *t, uint32_t capacity, uint32_t data_size)
+{
+    *t = (sketch_topk_t){
+        .capacity  = capacity,
+        .data_size = data_size,
+    };
+    t->entries = malloc(sizeof(sketch_topk_entry_t) * capacity);
+    CHECK_MALLOC(t->entries);
+    t->heap = malloc(sizeof(uint32_t) * capacity);
+    CHECK_MALLOC(t->heap);
+    t->index = calloc(2 * capacity, sizeof(uint32_t));
+    CHECK_MALLOC(t->index);
+    if (data_size > 0) {
+        t->data = malloc((size_t)capacity * data_size);
+        CHECK_MALLOC(t->data);
+    }
+}
+
+/** Release memory held by top-K sketch, sketch it self is not freed.
+ *
+ * @param t Sketch to clean.
+ */
+void
+sketch_topk_clean(sketch_topk_t *t)
+{
+    free(t->entries);
+    free(t->heap);
+    free(t->index);
+    free(t->data);
+    *t = (sketch_topk_t){ };
+}
+
+/** Forget all keys counted by top-K sketch.
+ *
+ * @param t Sketch to reset.
+ */
+void
+sketch_topk_reset(sketch_topk_t *t)
+{
+    memset(t->index, 0, sizeof(uint32_t) * 2 * t->capacity);
+    t->used = 0;
+}
+
+/** Count a key error of which is already known, see @ref sketch_topk_add.
+ *
+ * @param t        Sketch.
+ * @param key      Key to count.
+ * @param data     Data to store with key if key is not counted yet.
+ * @param data_len Length of data, truncated to data size of sketch.
+ * @param weight   Count to add.
+ * @param error    Error of weight, added to key error.
+ */
+static void
+sketch_topk_add_error(sketch_topk_t *t, uint64_t key, const void *data,
+                      uint16_t data_len, uint64_t weight, uint64_t error)
+{
+    sketch_topk_entry_t *e;
+    uint32_t             slot;
+    int64_t              i;
+    uint64_t             base = 0;
+
+    i = sketch_topk_find(t, key, &slot);
+    if (i >= 0) {
+        e = &t->entries[i];
+        e->count += weight;
+        e->error += error;
+        sketch_topk_heap_down(t, e->heap_pos);
+        return;
+    }
+
+    if (t->used < t->capacity) {
+        /* Free entry, key is counted exactly. */
+        i = t->used;
+        t->heap[t->used] = i;
+        t->entries[i].heap_pos = t->used;
+        t->used++;
+    } else {
+        /* Replace key with smallest count, new key inherits its count. */
+        i    = t->heap[0];
+        base = t->entries[i].count;
+        sketch_topk_index_remove(t, t->entries[i].key);
+        sketch_topk_find(t, key, &slot);
+    }
+    e = &t->entries[i];
+    e->key   = key;
+    e->count = base + weight;
+    e->error = base + error;
+    if (data_len > t->data_size) {
+        data_len = t->data_size;
+    }
+    e->data_len = data_len;
+    if (data_len > 0) {
+        memcpy(t->data + (size_t)i * t->data_size, data, data_len);
+    }
+    t->index[slot] = i + 1;
+    if (base == 0) {
+        sketch_topk_heap_up(t, e->heap_pos);
+    } else {
+        sketch_topk_heap_down(t, e->heap_pos);
+    }
+}
+
+/** Count a key.
+ *
+ * @param t        Sketch.
+ * @param key      Key to count.
+ * @param data     Data to store with key if key is not counted yet, such as
+ *                 the name key is a hash of.
+ * @param data_len Length of data, truncated to data size of sketch.
+ * @param weight   Count to add, 1 for each occurrence.
+ */
+void
+sketch_topk_add(sketch_topk_t *t, uint64_t key, const void *data,
+                uint16_t data_len, uint64_t weight)
+{
+    sketch_topk_add_error(t, key, data, data_len, weight, 0);
+}
+
+/** Merge keys counted by one top-K sketch into another. Counts of keys are
+ * added, so merging sketches of disjoint streams sketches the combined
+ * stream.
+ *
+ * @param dst Sketch to merge into.
+ * @param src Sketch to merge.
+ */
+void
+sketch_topk_merge(sketch_topk_t *dst, const sketch_topk_t *src)
+{
+    for (uint32_t i = 0; i < src->used; i++) {
+        const sketch_topk_entry_t *e = &src->entries[i];
+
+        sketch_topk_add_error(dst, e->key, sketch_topk_data(src, i), e->data_len,
+                              e->count, e->error);
+    }
+}
+
+/** Compare entries by count, larger first, qsort_r() comparator.
+ *
+ * @param a   Pointer to entry index.
+ * @param b   Pointer to entry index.
+ * @param arg Sketch.
+ *
+ * @return    Returns order of entries.
+ */
+static int
+sketch_topk_cmp(const void *a, const void *b, void *arg)
+{
+    const sketch_topk_t *t  = arg;
+    uint64_t             ca = t->entries[*(const uint32_t *)a].count;
+    uint64_t             cb = t->entries[*(const uint32_t *)b].count;
+
+    return (ca < cb) - (ca > cb);
+}
+
+/** Get entries with largest counts.
+ *
+ * @param t   Sketch.
+ * @param idx Where to store entry indices, largest count first. MUST have
+ *            room for capacity indices.
+ * @param n   Maximum number of entries to get.
+ *
+ * @return    Returns number of entry indices stored.
+ */
+uint32_t
+sketch_topk_sorted(const sketch_topk_t *t, uint32_t *idx, uint32_t n)
+{
+    for (uint32_t i = 0; i < t->used; i++) {
+        idx[i] = i;
+    }
+    qsort_r(idx, t->used, sizeof(uint32_t), sketch_topk_cmp, (void *)t);
+    return n < t->used ? n : t->used;
+}
+
+/** Forget all keys added to HyperLogLog sketch.
+ *
+ * @param h Sketch to reset.
+ */
+void
+sketch_hll_reset(sketch_hll_t *h)
+{
+    memset(h->registers, 0, sizeof(h->registers));
+}
+
+/** Merge one HyperLogLog sketch into another, result estimates number of
+ * distinct keys added to either.
+ *
+ * @param dst Sketch to merge into.
+ * @param src Sketch to merge.
+ */
+void
+sketch_hll_merge(sketch_hll_t *dst, const sketch_hll_t *src)
+{
+    for (int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        if (src->registers[i] > dst->registers[i]) {
+            dst->registers[i] = src->registers[i];
+        }
+    }
+}
+
+/** Estimate number of distinct keys added to HyperLogLog sketch. Small
+ * cardinalities, while registers are still empty, are estimated with linear
+ * counting.
+ *
+ * @param h Sketch.
+ *
+ * @return  Returns estimated number of distinct keys.
+ */
+double
+sketch_hll_estimate(const sketch_hll_t *h)
+{
+    const double m     = SKETCH_HLL_REGISTERS;
+    double       sum   = 0;
+    int          zeros = 0;
+    double       estimate;
+
+    for (int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -h->registers[i]);
+        zeros += h->registers[i] == 0;
+    }
+    estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+/** @}*/
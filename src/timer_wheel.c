@@ -0,0 +1,210 @@
+/**
+ * @file timer_wheel.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup timer_wheel
+ *  @{
+ */
+#include <string.h>
+
+#include "timer_wheel.h"
+
+/** Initialize timer wheel.
+ *
+ * @param tw  Timer wheel to initialize.
+ * @param now Current time in ticks.
+ */
+void
+timer_wheel_init(timer_wheel_t *tw, uint64_t now)
+{
+    memset(tw, 0, sizeof(timer_wheel_t));
+    tw->current = now;
+}
+
+/** Add timer node to wheel slot matching its expire time.
+ *
+ * @param tw   Timer wheel.
+ * @param node Timer node, must not be armed.
+ */
+static void
+timer_wheel_insert(timer_wheel_t *tw, timer_wheel_node_t *node)
+{
+    uint64_t             expires = node->expires;
+    uint64_t             delta   = 0;
+    int                  level   = 0;
+    timer_wheel_node_t **slot    = NULL;
+
+    if (expires < tw->current) {
+        /* Already expired, fire on next tick processed. */
+        expires = tw->current;
+    }
+    delta = expires - tw->current;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta >= ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))) {
+        /* Beyond wheel span, park in furthest slot of top level. */
+        expires = tw->current +
+                  ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+    slot = &tw->slots[level][(expires >> (TIMER_WHEEL_SLOT_BITS * level)) &
+                             (TIMER_WHEEL_SLOTS - 1)];
+
+    node->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->pprev = &node->next;
+    }
+    *slot       = node;
+    node->pprev = slot;
+}
+
+/** Arm timer, or re-arm it if it is already armed.
+ *
+ * @param tw      Timer wheel.
+ * @param node    Timer node to arm.
+ * @param expires Tick at which timer expires.
+ */
+void
+timer_wheel_arm(timer_wheel_t *tw, timer_wheel_node_t *node, uint64_t expires)
+{
+    timer_wheel_disarm(node);
+    node->expires = expires;
+    timer_wheel_insert(tw, node);
+}
+
+/** Disarm timer. Disarming a timer that is not armed is a no-op.
+ *
+ * @param node Timer node to disarm.
+ */
+void
+timer_wheel_disarm(timer_wheel_node_t *node)
+{
+    if (node->pprev == NULL) {
+        return;
+    }
+    *node->pprev = node->next;
+    if (node->next != NULL) {
+        node->next->pprev = node->pprev;
+    }
+    node->next  = NULL;
+    node->pprev = NULL;
+}
+
+/** Move timers in wheel slot into slots matching their expire time.
+ *
+ * @param tw    Timer wheel.
+ * @param level Wheel level of slot.
+ * @param index Index of slot.
+ */
+static void
+timer_wheel_cascade(timer_wheel_t *tw, int level, int index)
+{
+    timer_wheel_node_t *node = tw->slots[level][index];
+    timer_wheel_node_t *next = NULL;
+
+    tw->slots[level][index] = NULL;
+    while (node != NULL) {
+        next        = node->next;
+        node->pprev = NULL;
+        timer_wheel_insert(tw, node);
+        node = next;
+    }
+}
+
+/** Advance timer wheel to current time and collect expired timers.
+ *
+ * @param tw  Timer wheel.
+ * @param now Current time in ticks.
+ *
+ * @return    Returns list (linked via next) of expired timers, NULL if no
+ *            timer expired. Expired timers are disarmed.
+ */
+timer_wheel_node_t *
+timer_wheel_advance(timer_wheel_t *tw, uint64_t now)
+{
+    timer_wheel_node_t *expired = NULL;
+    timer_wheel_node_t *node    = NULL;
+    int                 index   = 0;
+
+    while (tw->current <= now) {
+        index = tw->current & (TIMER_WHEEL_SLOTS - 1);
+        if (index == 0) {
+            /* Level 0 wrapped, cascade higher levels. */
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                int level_index = (tw->current >> (TIMER_WHEEL_SLOT_BITS * level)) &
+                                  (TIMER_WHEEL_SLOTS - 1);
+                timer_wheel_cascade(tw, level, level_index);
+                if (level_index != 0) {
+                    break;
+                }
+            }
+        }
+
+        while ((node = tw->slots[0][index]) != NULL) {
+            tw->slots[0][index] = node->next;
+            node->pprev         = NULL;
+            node->next          = expired;
+            expired             = node;
+        }
+        tw->current++;
+    }
+
+    return expired;
+}
+
+/** Get earliest tick at which a timer could expire. This is exact for timers
+ * in first wheel level (expiring within @ref TIMER_WHEEL_SLOTS ticks). For
+ * timers in higher levels it is the tick at which they are next cascaded,
+ * which is not later than their expire time.
+ *
+ * @param tw Timer wheel.
+ *
+ * @return   Returns tick, or UINT64_MAX if no timer is armed.
+ */
+uint64_t
+timer_wheel_next_expiry(timer_wheel_t *tw)
+{
+    int index = tw->current & (TIMER_WHEEL_SLOTS - 1);
+
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        if (tw->slots[0][(index + i) & (TIMER_WHEEL_SLOTS - 1)] != NULL) {
+            return tw->current + i;
+        }
+    }
+
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            if (tw->slots[level][i] != NULL) {
+                /* Next time level 0 wraps and higher levels are cascaded. */
+                return (tw->current + TIMER_WHEEL_SLOTS - 1) &
+                       ~(uint64_t)(TIMER_WHEEL_SLOTS - 1);
+            }
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+/** @}*/
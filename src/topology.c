@@ -0,0 +1,541 @@
+/**
+ * @file topology.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup topology
+ *  @{
+ */
+#include <dirent.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topology.h"
+#include "utils.h"
+
+/** Placement rank of a CPU, CPUs with lower rank get vectorloops first. */
+typedef struct topology_rank_s {
+    /** CPU number. */
+    unsigned int cpu;
+
+    /** 0 for CPU chosen to represent a free physical core, 1 for SMT
+     * siblings and cores shared with busy CPUs.
+     */
+    int shared;
+
+    /** 0 if CPU is on network interface NUMA node (or node is unknown). */
+    int remote;
+
+    /** 0 if CPU receives network interface interrupts. */
+    int no_irq;
+} topology_rank_t;
+
+/** Read integer from first line of a file.
+ *
+ * @param path Path of file.
+ * @param val  Integer read.
+ *
+ * @return     0 on success, -1 if file could not be read or parsed.
+ */
+static int
+topology_read_int(const char *path, int *val)
+{
+    FILE *f = fopen(path, "r");
+    char *end;
+    long  tmp;
+    char  line[64];
+
+    if (f == NULL) {
+        return -1;
+    }
+    if (fgets(line, sizeof(line), f) == NULL) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    tmp = strtol(line, &end, 10);
+    if (end == line || tmp < INT_MIN || tmp > INT_MAX) {
+        return -1;
+    }
+    *val = (int)tmp;
+
+    return 0;
+}
+
+/** Read CPU list (see @ref topology_cpu_list_parse) from first line of a
+ * file.
+ *
+ * @param path       Path of file.
+ * @param cpus       Array of flags, set to 1 for CPUs in list.
+ * @param cpus_count Number of elements in cpus array.
+ *
+ * @return           Returns number of CPUs in list, -1 if file could not be
+ *                   read or parsed.
+ */
+static int
+topology_read_cpu_list(const char *path, unsigned char *cpus,
+                       unsigned int cpus_count)
+{
+    FILE *f = fopen(path, "r");
+    char  line[0x1000];
+
+    if (f == NULL) {
+        return -1;
+    }
+    if (fgets(line, sizeof(line), f) == NULL) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    line[strcspn(line, "\n")] = '\0';
+
+    return topology_cpu_list_parse(line, cpus, cpus_count);
+}
+
+/** Compare placement ranks of two CPUs, for qsort().
+ *
+ * @param a First rank.
+ * @param b Second rank.
+ *
+ * @return  Returns negative, zero or positive as a is ranked before, same as
+ *          or after b.
+ */
+static int
+topology_rank_cmp(const void *a, const void *b)
+{
+    const topology_rank_t *ra = a;
+    const topology_rank_t *rb = b;
+
+    if (ra->shared != rb->shared) {
+        return ra->shared - rb->shared;
+    }
+    if (ra->remote != rb->remote) {
+        return ra->remote - rb->remote;
+    }
+    if (ra->no_irq != rb->no_irq) {
+        return ra->no_irq - rb->no_irq;
+    }
+    return (ra->cpu > rb->cpu) - (ra->cpu < rb->cpu);
+}
+
+/** Check if two CPUs are SMT siblings, hardware threads of same physical
+ * core. CPUs with unknown core are siblings of none.
+ *
+ * @param topo Topology.
+ * @param a    First CPU.
+ * @param b    Second CPU.
+ *
+ * @return     Returns true if CPUs share a physical core.
+ */
+static bool
+topology_cpu_siblings(topology_t *topo, unsigned int a, unsigned int b)
+{
+    topology_cpu_t *ca = &topo->cpus[a];
+    topology_cpu_t *cb = &topo->cpus[b];
+
+    return ca->core >= 0 && ca->core == cb->core && ca->package == cb->package;
+}
+
+/** Parse CPU list in format used by kernel (e.g. "0-3,8,10-11") into array
+ * of flags. CPUs past end of array are ignored.
+ *
+ * @param str        CPU list, an empty string is an empty list.
+ * @param cpus       Array of flags, set to 1 for CPUs in list, 0 for others.
+ * @param cpus_count Number of elements in cpus array.
+ *
+ * @return           Returns number of CPUs in list, or -1 if list is not
+ *                   valid.
+ */
+int
+topology_cpu_list_parse(const char *str, unsigned char *cpus,
+                        unsigned int cpus_count)
+{
+    const char *ptr   = str;
+    int         count = 0;
+
+    memset(cpus, 0, cpus_count);
+
+    while (*ptr != '\0') {
+        char          *end   = NULL;
+        unsigned long  first = 0;
+        unsigned long  last  = 0;
+
+        if (*ptr < '0' || *ptr > '9') {
+            return -1;
+        }
+        first = strtoul(ptr, &end, 10);
+        last  = first;
+        ptr   = end;
+        if (*ptr == '-') {
+            ptr++;
+            if (*ptr < '0' || *ptr > '9') {
+                return -1;
+            }
+            last = strtoul(ptr, &end, 10);
+            ptr  = end;
+            if (last < first) {
+                return -1;
+            }
+        }
+        if (*ptr == ',') {
+            ptr++;
+            if (*ptr == '\0') {
+                return -1;
+            }
+        } else if (*ptr != '\0') {
+            return -1;
+        }
+        for (unsigned long cpu = first; cpu <= last && cpu < cpus_count; cpu++) {
+            if (!cpus[cpu]) {
+                cpus[cpu] = 1;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/** Load CPU topology from sysfs: online CPUs, physical package and core of
+ * each CPU, and NUMA nodes. Information missing from sysfs is left unknown
+ * and all CPUs are treated as online if online list can not be read.
+ *
+ * @param topo       Topology to load.
+ * @param sysfs_path Path sysfs is mounted on, see @ref TOPOLOGY_SYSFS_PATH.
+ * @param cpus_count Number of CPUs, see get_nprocs_conf().
+ *
+ * @return           Returns number of online CPUs.
+ */
+int
+topology_load(topology_t *topo, const char *sysfs_path, unsigned int cpus_count)
+{
+    unsigned char *flags  = NULL;
+    DIR           *dir    = NULL;
+    struct dirent *entry  = NULL;
+    int            online = 0;
+    char           path[PATH_MAX];
+
+    topo->cpus_count = cpus_count;
+    topo->nic_node   = -1;
+    topo->cpus       = malloc(sizeof(topology_cpu_t) * cpus_count);
+    CHECK_MALLOC(topo->cpus);
+    flags = malloc(cpus_count);
+    CHECK_MALLOC(flags);
+
+    snprintf(path, sizeof(path), "%s/devices/system/cpu/online", sysfs_path);
+    if (topology_read_cpu_list(path, flags, cpus_count) < 0) {
+        memset(flags, 1, cpus_count);
+    }
+
+    for (unsigned int cpu = 0; cpu < cpus_count; cpu++) {
+        topology_cpu_t *tc = &topo->cpus[cpu];
+
+        tc->online  = flags[cpu] != 0;
+        tc->nic_irq = false;
+        tc->node    = -1;
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%u/topology/"
+                 "physical_package_id", sysfs_path, cpu);
+        if (topology_read_int(path, &tc->package) != 0) {
+            tc->package = -1;
+        }
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%u/topology/"
+                 "core_id", sysfs_path, cpu);
+        if (topology_read_int(path, &tc->core) != 0) {
+            tc->core = -1;
+        }
+        online += tc->online;
+    }
+
+    /* NUMA node of each CPU, from CPU list of each node. */
+    snprintf(path, sizeof(path), "%s/devices/system/node", sysfs_path);
+    dir = opendir(path);
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        char *end  = NULL;
+        long  node = 0;
+
+        if (strncmp(entry->d_name, "node", 4) != 0 ||
+            entry->d_name[4] < '0' || entry->d_name[4] > '9') {
+            continue;
+        }
+        node = strtol(entry->d_name + 4, &end, 10);
+        if (*end != '\0' || node > INT_MAX) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/devices/system/node/%s/cpulist",
+                 sysfs_path, entry->d_name);
+        if (topology_read_cpu_list(path, flags, cpus_count) < 0) {
+            continue;
+        }
+        for (unsigned int cpu = 0; cpu < cpus_count; cpu++) {
+            if (flags[cpu]) {
+                topo->cpus[cpu].node = (int)node;
+            }
+        }
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    free(flags);
+
+    return online;
+}
+
+/** Load NUMA node of network interface and mark CPUs its interrupts are
+ * delivered to, read from affinity of each of its MSI interrupts.
+ *
+ * @param topo        Topology loaded by @ref topology_load.
+ * @param sysfs_path  Path sysfs is mounted on, see @ref TOPOLOGY_SYSFS_PATH.
+ * @param procfs_path Path procfs is mounted on, see
+ *                    @ref TOPOLOGY_PROCFS_PATH.
+ * @param ifname      Network interface name.
+ *
+ * @return            Returns number of CPUs interface interrupts are
+ *                    delivered to.
+ */
+int
+topology_nic_load(topology_t *topo, const char *sysfs_path,
+                  const char *procfs_path, const char *ifname)
+{
+    unsigned char *flags = NULL;
+    DIR           *dir   = NULL;
+    struct dirent *entry = NULL;
+    int            count = 0;
+    char           path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/class/net/%s/device/numa_node",
+             sysfs_path, ifname);
+    if (topology_read_int(path, &topo->nic_node) != 0 || topo->nic_node < 0) {
+        topo->nic_node = -1;
+    }
+
+    flags = malloc(topo->cpus_count);
+    CHECK_MALLOC(flags);
+    snprintf(path, sizeof(path), "%s/class/net/%s/device/msi_irqs",
+             sysfs_path, ifname);
+    dir = opendir(path);
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        /* Effective affinity is where interrupt is actually delivered, it
+         * is missing on older kernels.
+         */
+        snprintf(path, sizeof(path), "%s/irq/%s/effective_affinity_list",
+                 procfs_path, entry->d_name);
+        if (topology_read_cpu_list(path, flags, topo->cpus_count) <= 0) {
+            snprintf(path, sizeof(path), "%s/irq/%s/smp_affinity_list",
+                     procfs_path, entry->d_name);
+            if (topology_read_cpu_list(path, flags, topo->cpus_count) < 0) {
+                continue;
+            }
+        }
+        for (unsigned int cpu = 0; cpu < topo->cpus_count; cpu++) {
+            if (flags[cpu] && !topo->cpus[cpu].nic_irq) {
+                topo->cpus[cpu].nic_irq = true;
+                count++;
+            }
+        }
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    free(flags);
+
+    return count;
+}
+
+/** Bind vectorloops not yet bound to a CPU, one per physical core. CPUs in
+ * housekeeping set, and cores with a CPU already in use (bound by hand or in
+ * housekeeping set), are not used until free cores run out. Free cores are
+ * taken first from network interface NUMA node, and CPUs that receive its
+ * interrupts first within those, so packets are processed on same CPU and
+ * node they arrived on. One CPU of each core is used, before SMT siblings
+ * are. Vectorloops that do not fit on a CPU of their own are left unbound.
+ *
+ * @param topo         Topology loaded by @ref topology_load.
+ * @param housekeeping Array of flags, 1 for CPUs in housekeeping set, of
+ *                     topo->cpus_count elements, or NULL for none.
+ * @param masks        Vectorloop CPU bindings, 1 based CPU number or 0 for
+ *                     unbound (see "process_thread_masks" configuration).
+ * @param masks_count  Number of vectorloops.
+ *
+ * @return             Returns number of vectorloops bound.
+ */
+size_t
+topology_vl_place(topology_t *topo, const unsigned char *housekeeping,
+                  size_t *masks, size_t masks_count)
+{
+    topology_rank_t *ranks       = NULL;
+    unsigned char   *busy        = NULL;
+    size_t           ranks_count = 0;
+    size_t           placed      = 0;
+    size_t           vl          = 0;
+
+    busy = calloc(topo->cpus_count, sizeof(unsigned char));
+    CHECK_MALLOC(busy);
+    for (size_t i = 0; i < masks_count; i++) {
+        if (masks[i] > 0 && masks[i] <= topo->cpus_count) {
+            busy[masks[i] - 1] = 1;
+        }
+    }
+    for (unsigned int cpu = 0; housekeeping != NULL && cpu < topo->cpus_count; cpu++) {
+        busy[cpu] |= housekeeping[cpu];
+    }
+
+    ranks = malloc(sizeof(topology_rank_t) * topo->cpus_count);
+    CHECK_MALLOC(ranks);
+    for (unsigned int cpu = 0; cpu < topo->cpus_count; cpu++) {
+        topology_cpu_t  *tc   = &topo->cpus[cpu];
+        topology_rank_t *rank = &ranks[ranks_count];
+
+        if (!tc->online || busy[cpu]) {
+            continue;
+        }
+        rank->cpu    = cpu;
+        rank->shared = 0;
+        rank->remote = topo->nic_node >= 0 && tc->node != topo->nic_node;
+        rank->no_irq = !tc->nic_irq;
+
+        /* Core is represented by its CPU receiving interface interrupts,
+         * or its lowest CPU, others are siblings. Core is shared if any of
+         * its CPUs is busy.
+         */
+        for (unsigned int sib = 0; sib < topo->cpus_count; sib++) {
+            topology_cpu_t *ts = &topo->cpus[sib];
+
+            if (sib == cpu || !topology_cpu_siblings(topo, cpu, sib)) {
+                continue;
+            }
+            if (busy[sib] ||
+                (ts->online && ts->nic_irq > tc->nic_irq) ||
+                (ts->online && ts->nic_irq == tc->nic_irq && sib < cpu)) {
+                rank->shared = 1;
+                break;
+            }
+        }
+        ranks_count++;
+    }
+    qsort(ranks, ranks_count, sizeof(topology_rank_t), topology_rank_cmp);
+
+    for (size_t i = 0; i < ranks_count; i++) {
+        while (vl < masks_count && masks[vl] > 0) {
+            vl++;
+        }
+        if (vl == masks_count) {
+            break;
+        }
+        masks[vl] = ranks[i].cpu + 1;
+        placed++;
+    }
+
+    free(ranks);
+    free(busy);
+
+    return placed;
+}
+
+/** Check isolation of vectorloop CPUs and write a warning for each problem
+ * found: vectorloops not bound to a CPU, and vectorloop CPUs not isolated
+ * from scheduler (isolcpus boot parameter) or not running tickless
+ * (nohz_full boot parameter), where kernel keeps running other tasks or
+ * timer interrupts that preempt vectorloop.
+ *
+ * @param sysfs_path  Path sysfs is mounted on, see @ref TOPOLOGY_SYSFS_PATH.
+ * @param masks       Vectorloop CPU bindings, 1 based CPU number or 0 for
+ *                    unbound.
+ * @param masks_count Number of vectorloops.
+ * @param cpus_count  Number of CPUs.
+ * @param out         Stream to write warnings to.
+ *
+ * @return            Returns number of warnings written.
+ */
+int
+topology_isolation_check(const char *sysfs_path, const size_t *masks,
+                         size_t masks_count, unsigned int cpus_count, FILE *out)
+{
+    unsigned char *isolated = NULL;
+    unsigned char *nohz     = NULL;
+    int            warnings = 0;
+    char           path[PATH_MAX];
+
+    isolated = malloc(cpus_count);
+    CHECK_MALLOC(isolated);
+    nohz = malloc(cpus_count);
+    CHECK_MALLOC(nohz);
+
+    /* Missing or unparsable lists ("(null)" on some kernels) are empty. */
+    snprintf(path, sizeof(path), "%s/devices/system/cpu/isolated", sysfs_path);
+    if (topology_read_cpu_list(path, isolated, cpus_count) < 0) {
+        memset(isolated, 0, cpus_count);
+    }
+    snprintf(path, sizeof(path), "%s/devices/system/cpu/nohz_full", sysfs_path);
+    if (topology_read_cpu_list(path, nohz, cpus_count) < 0) {
+        memset(nohz, 0, cpus_count);
+    }
+
+    for (size_t i = 0; i < masks_count; i++) {
+        size_t cpu = masks[i];
+
+        if (cpu == 0 || cpu > cpus_count) {
+            fprintf(out, "Warning: vectorloop %zu is not bound to a CPU, it "
+                    "competes with other tasks for CPUs (see "
+                    "\"--process_thread_masks\")\n", i);
+            warnings++;
+            continue;
+        }
+        cpu--;
+        if (!isolated[cpu]) {
+            fprintf(out, "Warning: vectorloop %zu CPU %zu is not isolated, "
+                    "scheduler runs other tasks on it (see \"isolcpus\" boot "
+                    "parameter)\n", i, cpu);
+            warnings++;
+        }
+        if (!nohz[cpu]) {
+            fprintf(out, "Warning: vectorloop %zu CPU %zu is not tickless, timer "
+                    "interrupts preempt it (see \"nohz_full\" boot "
+                    "parameter)\n", i, cpu);
+            warnings++;
+        }
+    }
+
+    free(isolated);
+    free(nohz);
+
+    return warnings;
+}
+
+/** Release topology.
+ *
+ * @param topo Topology to release.
+ */
+void
+topology_release(topology_t *topo)
+{
+    free(topo->cpus);
+    topo->cpus       = NULL;
+    topo->cpus_count = 0;
+}
+
+/** @}*/
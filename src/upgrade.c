@@ -0,0 +1,488 @@
+/**
+ * @file upgrade.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup upgrade
+ *  @{
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "upgrade.h"
+#include "utils.h"
+
+/** Initialize upgrade state for vectorloops configured, no listeners are
+ * inherited nor registered.
+ *
+ * @param u   Upgrade state to initialize.
+ * @param cfg Configuration with vectorloop count and "upgrade_socket".
+ */
+void
+upgrade_init(upgrade_t *u, config_t *cfg)
+{
+    size_t count = cfg->process_thread_count * UPGRADE_FD_KINDS;
+
+    u->path     = cfg->upgrade_socket;
+    u->vl_count = cfg->process_thread_count;
+    u->inherited = malloc(sizeof(int) * count);
+    CHECK_MALLOC(u->inherited);
+    u->listeners = malloc(sizeof(int) * count);
+    CHECK_MALLOC(u->listeners);
+
+    for (size_t i = 0; i < count; i++) {
+        u->inherited[i] = -1;
+        u->listeners[i] = -1;
+    }
+    u->inherited_count = 0;
+    u->sock            = -1;
+    atomic_init(&u->inherited_taken, 0);
+    atomic_init(&u->ready, 0);
+}
+
+/** Release memory held by upgrade state. Inherited listener sockets not
+ * taken are closed.
+ *
+ * @param u Upgrade state to clean.
+ */
+void
+upgrade_clean(upgrade_t *u)
+{
+    for (size_t i = 0; i < u->vl_count * UPGRADE_FD_KINDS; i++) {
+        if (u->inherited[i] >= 0) {
+            close(u->inherited[i]);
+        }
+    }
+    if (u->sock >= 0) {
+        close(u->sock);
+    }
+    free(u->inherited);
+    free(u->listeners);
+    u->inherited = NULL;
+    u->listeners = NULL;
+    u->vl_count  = 0;
+}
+
+/** Fill Unix socket address for upgrade socket path.
+ *
+ * @note This is a helper function for @ref upgrade_connect() and
+ * @ref upgrade_loop().
+ *
+ * @param sun  Address to fill.
+ * @param path Upgrade socket path.
+ *
+ * @return     Returns 0 on success, -1 if path is too long.
+ */
+static int
+upgrade_addr(struct sockaddr_un *sun, const char *path)
+{
+    memset(sun, 0, sizeof(*sun));
+    sun->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sun->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(sun->sun_path, path);
+    return 0;
+}
+
+/** Connect to running process over upgrade socket and receive its listener
+ * sockets. Connection is kept open, new process tells running process it is
+ * ready over it, see @ref upgrade_loop(). If there is no process listening on
+ * upgrade socket, no listeners are inherited and application starts its own.
+ *
+ * @param u       Upgrade state.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 on error in which case err is
+ *                populated.
+ */
+int
+upgrade_connect(upgrade_t *u, char *err, size_t err_len)
+{
+    struct sockaddr_un sun;
+    int                sock;
+
+    if (upgrade_addr(&sun, u->path) != 0) {
+        snprintf(err, err_len, "Upgrade socket path \"%s\" is too long", u->path);
+        return -1;
+    }
+    sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        snprintf(err, err_len, "Error creating upgrade socket: %s", strerror(errno));
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *)&sun, sizeof(sun)) != 0) {
+        if (errno == ENOENT || errno == ECONNREFUSED) {
+            /* No process running, or a stale socket left by one that is
+             * not running anymore.
+             */
+            close(sock);
+            return 0;
+        }
+        snprintf(err, err_len, "Error connecting to upgrade socket \"%s\": %s",
+                 u->path, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    if (upgrade_fds_recv(u, sock, err, err_len) != 0) {
+        close(sock);
+        return -1;
+    }
+    u->sock = sock;
+    return 0;
+}
+
+/** Send listener sockets vectorloops registered over a connected upgrade
+ * socket.
+ *
+ * @param u       Upgrade state.
+ * @param sock    Connected upgrade socket.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 on error in which case err is
+ *                populated.
+ */
+int
+upgrade_fds_send(upgrade_t *u, int sock, char *err, size_t err_len)
+{
+    size_t         total = u->vl_count * UPGRADE_FD_KINDS;
+    size_t         i     = 0;
+    int            fds[UPGRADE_FDS_PER_MSG];
+    upgrade_msg_t  msg;
+    char           control[CMSG_SPACE(sizeof(fds))];
+
+    do {
+        memset(&msg, 0, sizeof(msg));
+        msg.magic = UPGRADE_MSG_MAGIC;
+        for (; i < total && msg.count < UPGRADE_FDS_PER_MSG; i++) {
+            if (u->listeners[i] < 0) {
+                continue;
+            }
+            msg.fds[msg.count] = (upgrade_msg_fd_t) {
+                .vl_id = i / UPGRADE_FD_KINDS,
+                .kind  = i % UPGRADE_FD_KINDS,
+            };
+            fds[msg.count++] = u->listeners[i];
+        }
+        /* Skip to next registered listener to find out if this is last
+         * message.
+         */
+        while (i < total && u->listeners[i] < 0) {
+            i++;
+        }
+        msg.last = i == total;
+
+        struct iovec  iov = { .iov_base = &msg, .iov_len = sizeof(msg) };
+        struct msghdr mh  = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+        if (msg.count > 0) {
+            memset(control, 0, sizeof(control));
+            mh.msg_control    = control;
+            mh.msg_controllen = CMSG_SPACE(sizeof(int) * msg.count);
+
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type  = SCM_RIGHTS;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * msg.count);
+            memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * msg.count);
+        }
+        if (sendmsg(sock, &mh, MSG_NOSIGNAL) != sizeof(msg)) {
+            snprintf(err, err_len, "Error sending listener sockets: %s", strerror(errno));
+            return -1;
+        }
+    } while (!msg.last);
+
+    return 0;
+}
+
+/** Receive listener sockets of process being upgraded over a connected
+ * upgrade socket. Sockets of vectorloops this process does not have are
+ * closed.
+ *
+ * @param u       Upgrade state.
+ * @param sock    Connected upgrade socket.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 on error in which case err is
+ *                populated.
+ */
+int
+upgrade_fds_recv(upgrade_t *u, int sock, char *err, size_t err_len)
+{
+    upgrade_msg_t  msg;
+    char           control[CMSG_SPACE(sizeof(int) * UPGRADE_FDS_PER_MSG)];
+    int            fds[UPGRADE_FDS_PER_MSG];
+    size_t         fds_count;
+    ssize_t        ret;
+
+    do {
+        struct iovec  iov = { .iov_base = &msg, .iov_len = sizeof(msg) };
+        struct msghdr mh  = {
+            .msg_iov        = &iov,
+            .msg_iovlen     = 1,
+            .msg_control    = control,
+            .msg_controllen = sizeof(control),
+        };
+
+        ret = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+        if (ret < 0) {
+            snprintf(err, err_len, "Error receiving listener sockets: %s", strerror(errno));
+            return -1;
+        }
+
+        fds_count = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                fds_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * fds_count);
+            }
+        }
+
+        if (ret != sizeof(msg) || msg.magic != UPGRADE_MSG_MAGIC ||
+            msg.count != fds_count || (mh.msg_flags & MSG_CTRUNC)) {
+            for (size_t i = 0; i < fds_count; i++) {
+                close(fds[i]);
+            }
+            snprintf(err, err_len, "Malformed listener sockets message received");
+            return -1;
+        }
+
+        u->inherited_count += fds_count;
+        for (size_t i = 0; i < fds_count; i++) {
+            size_t vl_id = msg.fds[i].vl_id;
+            size_t kind  = msg.fds[i].kind;
+            size_t index = vl_id * UPGRADE_FD_KINDS + kind;
+
+            if (vl_id >= u->vl_count || kind >= UPGRADE_FD_KINDS ||
+                u->inherited[index] >= 0) {
+                close(fds[i]);
+                continue;
+            }
+            u->inherited[index] = fds[i];
+        }
+    } while (!msg.last);
+
+    return 0;
+}
+
+/** Take listener socket inherited from process being upgraded. Called by
+ * vectorloop, for its own listeners only.
+ *
+ * @param u     Upgrade state.
+ * @param vl_id Vectorloop ID.
+ * @param kind  Kind of listener.
+ *
+ * @return      Returns inherited listener socket, or -1 if there is none.
+ */
+int
+upgrade_fd_take(upgrade_t *u, int vl_id, upgrade_fd_kind_t kind)
+{
+    size_t index = vl_id * UPGRADE_FD_KINDS + kind;
+    int    fd    = u->inherited[index];
+
+    if (fd >= 0) {
+        u->inherited[index] = -1;
+        atomic_fetch_add_explicit(&u->inherited_taken, 1, memory_order_relaxed);
+    }
+    return fd;
+}
+
+/** Set listener socket vectorloop registered, to be handed over on next
+ * upgrade. Called by vectorloop, for its own listeners only.
+ *
+ * @param u     Upgrade state.
+ * @param vl_id Vectorloop ID.
+ * @param kind  Kind of listener.
+ * @param fd    Listener socket.
+ */
+void
+upgrade_listener_set(upgrade_t *u, int vl_id, upgrade_fd_kind_t kind, int fd)
+{
+    u->listeners[vl_id * UPGRADE_FD_KINDS + kind] = fd;
+}
+
+/** Mark vectorloop as done registering its listeners. Inherited listener
+ * sockets vectorloop did not take are closed.
+ *
+ * @param u     Upgrade state.
+ * @param vl_id Vectorloop ID.
+ */
+void
+upgrade_vl_ready(upgrade_t *u, int vl_id)
+{
+    for (int kind = 0; kind < UPGRADE_FD_KINDS; kind++) {
+        size_t index = vl_id * UPGRADE_FD_KINDS + kind;
+
+        if (u->inherited[index] >= 0) {
+            close(u->inherited[index]);
+            u->inherited[index] = -1;
+        }
+    }
+    atomic_fetch_add_explicit(&u->ready, 1, memory_order_release);
+}
+
+/** Sleep for @ref UPGRADE_POLL_MS.
+ *
+ * @note This is a helper function for @ref upgrade_loop().
+ */
+static void
+upgrade_poll_wait(void)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = UPGRADE_POLL_MS * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+/** Hand listener sockets over to new process connected on upgrade socket,
+ * and wait for it to become ready.
+ *
+ * @note This is a helper function for @ref upgrade_loop().
+ *
+ * @param u       Upgrade state.
+ * @param sock    Connection from new process.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 once new process is ready, -1 if it failed to
+ *                become ready in which case err is populated.
+ */
+static int
+upgrade_serve(upgrade_t *u, int sock, char *err, size_t err_len)
+{
+    struct timeval tv    = { .tv_sec = UPGRADE_READY_WAIT_MAX };
+    char           ready = 0;
+    ssize_t        ret;
+
+    if (upgrade_fds_send(u, sock, err, err_len) != 0) {
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ret = recv(sock, &ready, 1, 0);
+    if (ret != 1 || ready != UPGRADE_MSG_READY) {
+        snprintf(err, err_len, "new process did not become ready%s%s",
+                 ret < 0 ? ", " : "", ret < 0 ? strerror(errno) : "");
+        return -1;
+    }
+    return 0;
+}
+
+/** Upgrade loop function. Once vectorloops registered their listeners, it
+ * tells process being upgraded (if there was one) that this process is
+ * ready, and starts listening on upgrade socket. When a new process connects,
+ * it hands listener sockets over to it, and once new process is ready has
+ * application shuts down, see @ref vldrain.
+ *
+ * @note This loop is meant to be run on its own thread.
+ *
+ * @param args Object with arguments passed to upgrade loop.
+ *
+ * @return     Returns a NULL pointer only because it needs to abide by
+ *             pthread API.
+ */
+void *
+upgrade_loop(void *args)
+{
+    upgrade_loop_args_t *u_args          = (upgrade_loop_args_t *)args;
+    upgrade_t           *u               = u_args->upgrade;
+    channel_log_t       *app_log_channel = u_args->app_log_channel;
+    struct sockaddr_un   sun;
+    char                 err[ERR_MSG_LENGTH];
+    char                 ready           = UPGRADE_MSG_READY;
+    int                  listen_fd       = -1;
+    int                  sock            = -1;
+
+    /* Wait for vectorloops to register their listeners. */
+    while (atomic_load_explicit(&u->ready, memory_order_acquire) < u->vl_count) {
+        upgrade_poll_wait();
+    }
+
+    /* Let process being upgraded know this process is ready, it stops
+     * reading from listeners and exits once it drained.
+     */
+    if (u->sock >= 0) {
+        if (send(u->sock, &ready, 1, MSG_NOSIGNAL) != 1) {
+            channel_log_send(app_log_channel, 0, false,
+                             "Upgrade, error notifying running process: %s",
+                             strerror(errno));
+        }
+        close(u->sock);
+        u->sock = -1;
+        channel_log_send(app_log_channel, 0, false,
+                         "Upgrade, took over %zu of %zu listener sockets",
+                         atomic_load(&u->inherited_taken), u->inherited_count);
+    }
+
+    /* Listen on upgrade socket, taking it over from process upgraded. */
+    if (upgrade_addr(&sun, u->path) == 0) {
+        unlink(u->path);
+        listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    }
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&sun, sizeof(sun)) != 0 ||
+        listen(listen_fd, 1) != 0) {
+        channel_log_send(app_log_channel, 0, false,
+                         "Upgrade, error listening on upgrade socket \"%s\": %s",
+                         u->path, strerror(errno));
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        return NULL;
+    }
+
+    /* Hand listeners over to first new process that becomes ready. */
+    while (1) {
+        sock = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (sock < 0) {
+            continue;
+        }
+        if (upgrade_serve(u, sock, err, sizeof(err)) == 0) {
+            close(sock);
+            break;
+        }
+        close(sock);
+        channel_log_send(app_log_channel, 0, false, "Upgrade aborted, %s", err);
+    }
+    close(listen_fd);
+
+    /* Shut down, main thread has vectorloops stop reading from listeners
+     * and drain on termination signal.
+     */
+    channel_log_send(app_log_channel, 0, false,
+                     "Upgrade, listener sockets handed over, shutting down");
+    kill(getpid(), SIGTERM);
+    return NULL;
+}
+
+/** @}*/
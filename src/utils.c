@@ -28,12 +28,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "utils.h"
 
+#ifndef MADV_POPULATE_READ
+/** Populate page tables readable, in case C library headers predate it. */
+#define MADV_POPULATE_READ 22
+#endif
+
+#ifndef MADV_POPULATE_WRITE
+/** Populate page tables writable, in case C library headers predate it. */
+#define MADV_POPULATE_WRITE 23
+#endif
+
 /** From sockaddr_storage extract IP and port into strings.
  * 
  * @param ip       Buffer where to store IP address.
@@ -124,7 +141,9 @@ char_to_lc(char *c)
     }
 }
 
-/** Convert string ascii characters to lower case.
+/** Convert string ascii characters to lower case. String is converted 16
+ * bytes at a time with SSE2 or NEON where available, remaining bytes one at a
+ * time.
  *
  * @param str     String to convert to all lower case ASCII.
  * @param str_len Length of string.
@@ -132,8 +151,37 @@ char_to_lc(char *c)
 void
 str_to_lc(uint8_t *str, size_t str_len)
 {
-    for (int i = 0; i < str_len; i++) {
-        char_to_lc((char *)str);
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    /* Shift 'A'..'Z' to the 26 lowest signed byte values so a single signed
+     * compare selects upper case characters.
+     */
+    const __m128i shift = _mm_set1_epi8((char)(0x80 - 'A'));
+    const __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    const __m128i bit   = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= str_len; i += 16) {
+        __m128i v     = _mm_loadu_si128((const __m128i *)(str + i));
+        __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(v, shift), limit);
+
+        _mm_storeu_si128((__m128i *)(str + i),
+                         _mm_or_si128(v, _mm_and_si128(upper, bit)));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t a   = vdupq_n_u8('A');
+    const uint8x16_t z   = vdupq_n_u8('Z' - 'A');
+    const uint8x16_t bit = vdupq_n_u8(0x20);
+
+    for (; i + 16 <= str_len; i += 16) {
+        uint8x16_t v     = vld1q_u8(str + i);
+        uint8x16_t upper = vcleq_u8(vsubq_u8(v, a), z);
+
+        vst1q_u8(str + i, vorrq_u8(v, vandq_u8(upper, bit)));
+    }
+#endif
+    for (; i < str_len; i++) {
+        char_to_lc((char *)&str[i]);
     }
 }
 
@@ -272,6 +320,43 @@ parse_csv_to_ul_array(size_t *ul_array, size_t ul_array_len, char *str)
     return 0;
 }
 
+/** Parse string of hex digits into bytes.
+ * 
+ * @param dst     Buffer to store bytes into.
+ * @param dst_len Number of bytes to parse, string must have exactly twice as
+ *                many hex digits.
+ * @param str     String to parse.
+ * 
+ * @return        0 on success, otherwise an error occurred.
+ */
+int
+str_hex_to_bin(uint8_t *dst, size_t dst_len, char *str)
+{
+    if (strlen(str) != dst_len * 2) {
+        return -1;
+    }
+    for (size_t i = 0; i < dst_len * 2; i++) {
+        char    c = str[i];
+        uint8_t v;
+
+        if (c >= '0' && c <= '9') {
+            v = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v = c - 'A' + 10;
+        } else {
+            return -1;
+        }
+        if (i % 2 == 0) {
+            dst[i / 2] = v << 4;
+        } else {
+            dst[i / 2] |= v;
+        }
+    }
+    return 0;
+}
+
 /** Convert IPv4 or IPv6 addresses and port from binary to text form as
  * "ip:port".
  * 
@@ -419,18 +504,279 @@ utl_writeall(int fd, void *buf, size_t buf_len, char *err, size_t err_len)
     return 0;
 }
 
+/** Two digit decimal strings "00" to "99", digits of value v are at 2 * v. */
+static const char utl_dec_pairs[200] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/** Times from epoch up to this many seconds (year 10000) have four digit
+ * year and are converted without gmtime().
+ */
+#define UTL_RFC3339_FAST_SEC_MAX 253402300800LL
+
+/** Lowercase hexadecimal digits. */
+static const char utl_hex_digits[16] = "0123456789abcdef";
+
+/** Write unsigned integer v as decimal string to buf, same as sprintf() with
+ * "%u" but without terminating NUL character. Digits are written two at a
+ * time from a lookup table, from last to first.
+ *
+ * @param v   Value to write.
+ * @param buf Buffer to write to, MUST have room for at least 10 characters.
+ *
+ * @return    Returns number of characters written.
+ */
+size_t
+utl_u32_to_dec(uint32_t v, char *buf)
+{
+    size_t len;
+    char  *p;
+
+    len = v < 10 ? 1 : v < 100 ? 2 : v < 1000 ? 3 : v < 10000 ? 4 : v < 100000 ? 5 :
+          v < 1000000 ? 6 : v < 10000000 ? 7 : v < 100000000 ? 8 : v < 1000000000 ? 9 : 10;
+    p = buf + len;
+    while (v >= 100) {
+        p -= 2;
+        memcpy(p, &utl_dec_pairs[(v % 100) * 2], 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        memcpy(p - 2, &utl_dec_pairs[v * 2], 2);
+    } else {
+        *(p - 1) = '0' + v;
+    }
+    return len;
+}
+
+/** Write one IPv4 address octet as decimal string to buf.
+ *
+ * @param v   Octet to write.
+ * @param buf Buffer to write to, MUST have room for at least 3 characters.
+ *
+ * @return    Returns number of characters written.
+ */
+static inline size_t
+utl_u8_to_dec(uint8_t v, char *buf)
+{
+    if (v >= 100) {
+        buf[0] = '0' + v / 100;
+        memcpy(buf + 1, &utl_dec_pairs[(v % 100) * 2], 2);
+        return 3;
+    }
+    if (v >= 10) {
+        memcpy(buf, &utl_dec_pairs[v * 2], 2);
+        return 2;
+    }
+    buf[0] = '0' + v;
+    return 1;
+}
+
+/** Write IPv4 address in network byte order as dotted decimal string to buf,
+ * output is same as inet_ntop() but without terminating NUL character.
+ *
+ * @param addr IPv4 address, 4 bytes in network byte order.
+ * @param buf  Buffer to write to, MUST have room for at least
+ *             INET_ADDRSTRLEN - 1 characters.
+ *
+ * @return     Returns number of characters written.
+ */
+size_t
+utl_ipv4_to_str(const void *addr, char *buf)
+{
+    const uint8_t *a = addr;
+    char          *p = buf;
+
+    p += utl_u8_to_dec(a[0], p);
+    *p++ = '.';
+    p += utl_u8_to_dec(a[1], p);
+    *p++ = '.';
+    p += utl_u8_to_dec(a[2], p);
+    *p++ = '.';
+    p += utl_u8_to_dec(a[3], p);
+    return p - buf;
+}
+
+/** Write IPv6 address in network byte order as string to buf, output is
+ * byte identical to glibc inet_ntop(): lowercase hexadecimal groups without
+ * leading zeros, first longest run of two or more zero groups replaced
+ * with "::", and IPv4-compatible or IPv4-mapped addresses with trailing
+ * dotted decimal IPv4 address. Terminating NUL character is not written.
+ *
+ * @param addr IPv6 address, 16 bytes in network byte order.
+ * @param buf  Buffer to write to, MUST have room for at least
+ *             INET6_ADDRSTRLEN - 1 characters.
+ *
+ * @return     Returns number of characters written.
+ */
+size_t
+utl_ipv6_to_str(const void *addr, char *buf)
+{
+    const uint8_t *a = addr;
+    char          *p = buf;
+    uint16_t       words[8];
+    int            best_base = -1;
+    int            best_len  = 0;
+    int            cur_base  = -1;
+
+    for (int i = 0; i < 8; i++) {
+        words[i] = (uint16_t)(a[2 * i] << 8) | a[2 * i + 1];
+        if (words[i] == 0) {
+            if (cur_base < 0) {
+                cur_base = i;
+            }
+            if (i - cur_base + 1 > best_len) {
+                best_base = cur_base;
+                best_len  = i - cur_base + 1;
+            }
+        } else {
+            cur_base = -1;
+        }
+    }
+    if (best_len < 2) {
+        best_base = -1;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        uint16_t w = words[i];
+
+        if (best_base >= 0 && i >= best_base && i < best_base + best_len) {
+            if (i == best_base) {
+                *p++ = ':';
+            }
+            continue;
+        }
+        if (i != 0) {
+            *p++ = ':';
+        }
+        if (i == 6 && best_base == 0 &&
+            (best_len == 6 || (best_len == 5 && words[5] == 0xffff))) {
+            p += utl_ipv4_to_str(a + 12, p);
+            return p - buf;
+        }
+        /* Skip leading zero nibbles, zero group is written as single '0'. */
+        if (w >= 0x1000) {
+            *p++ = utl_hex_digits[w >> 12];
+        }
+        if (w >= 0x100) {
+            *p++ = utl_hex_digits[(w >> 8) & 0xf];
+        }
+        if (w >= 0x10) {
+            *p++ = utl_hex_digits[(w >> 4) & 0xf];
+        }
+        *p++ = utl_hex_digits[w & 0xf];
+    }
+    if (best_base >= 0 && best_base + best_len == 8) {
+        *p++ = ':';
+    }
+    return p - buf;
+}
+
+/** Store seconds since epoch sec as GMT "YYYY-MM-DDTHH:MM:SS" string, 19
+ * characters without terminating NUL character.
+ *
+ * @param sec Seconds since epoch.
+ * @param buf Buffer to store time string at, MUST have minimum length of
+ *            @ref TIME_RFC3339_STRLEN.
+ */
+static void
+utl_rfc3339_sec(time_t sec, char *buf)
+{
+    struct tm tm;
+
+    if (sec >= 0 && sec < UTL_RFC3339_FAST_SEC_MAX) {
+        /* Civil date from days since epoch, shifted to year starting in March
+         * so leap day is last day of year (H. Hinnant, chrono-Compatible
+         * Low-Level Date Algorithms).
+         */
+        uint32_t days = sec / 86400 + 719468;
+        uint32_t secs = sec % 86400;
+        uint32_t era  = days / 146097;
+        uint32_t doe  = days - era * 146097;
+        uint32_t yoe  = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        uint32_t doy  = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        uint32_t mp   = (5 * doy + 2) / 153;
+        uint32_t day  = doy - (153 * mp + 2) / 5 + 1;
+        uint32_t mon  = mp < 10 ? mp + 3 : mp - 9;
+        uint32_t year = yoe + era * 400 + (mon <= 2);
+
+        memcpy(buf, &utl_dec_pairs[(year / 100) * 2], 2);
+        memcpy(buf + 2, &utl_dec_pairs[(year % 100) * 2], 2);
+        buf[4] = '-';
+        memcpy(buf + 5, &utl_dec_pairs[mon * 2], 2);
+        buf[7] = '-';
+        memcpy(buf + 8, &utl_dec_pairs[day * 2], 2);
+        buf[10] = 'T';
+        memcpy(buf + 11, &utl_dec_pairs[(secs / 3600) * 2], 2);
+        buf[13] = ':';
+        memcpy(buf + 14, &utl_dec_pairs[((secs / 60) % 60) * 2], 2);
+        buf[16] = ':';
+        memcpy(buf + 17, &utl_dec_pairs[(secs % 60) * 2], 2);
+    } else {
+        strftime(buf, 31, "%Y-%m-%dT%H:%M:%S", gmtime_r(&sec, &tm));
+    }
+}
+
 /** Store time in ts as string in GMT rfc3339nano format.
  * 
  * @param ts  Time to store as string.
  * @param buf Buffer to store times string at. This buffer MUST have minimum
  *            length of @ref TIME_RFC3339_STRLEN.
+ *
+ * @return    Returns length of string, excluding terminating NUL character.
  */
 int
 utl_timespec_to_rfc3339nano(struct timespec *ts, char *buf)
 {
-    strftime(buf, 31, "%Y-%m-%dT%H:%M:%S", gmtime((time_t *)&ts->tv_sec));
-    return 19 + sprintf(buf+19, ".%ldZ", ts->tv_nsec);
-    
+    size_t len;
+
+    utl_rfc3339_sec(ts->tv_sec, buf);
+    buf[19] = '.';
+    len = 20 + utl_u32_to_dec((uint32_t)ts->tv_nsec, buf + 20);
+    buf[len] = 'Z';
+    buf[len + 1] = '\0';
+    return len + 1;
+}
+
+/** Initialize rfc3339nano formatting cache, no second is cached.
+ *
+ * @param fmt Cache to initialize.
+ */
+void
+utl_time_fmt_init(utl_time_fmt_t *fmt)
+{
+    fmt->sec = -1;
+}
+
+/** Store time in ts as string in GMT rfc3339nano format, same as
+ * @ref utl_timespec_to_rfc3339nano. Date and time are formatted only when
+ * second differs from the one cached in fmt, otherwise cached prefix is
+ * copied and only fractional part is formatted.
+ *
+ * @param fmt Formatting cache owned by calling thread.
+ * @param ts  Time to store as string.
+ * @param buf Buffer to store times string at. This buffer MUST have minimum
+ *            length of @ref TIME_RFC3339_STRLEN.
+ *
+ * @return    Returns length of string, excluding terminating NUL character.
+ */
+int
+utl_time_fmt_rfc3339nano(utl_time_fmt_t *fmt, const struct timespec *ts, char *buf)
+{
+    size_t len;
+
+    if (ts->tv_sec != fmt->sec) {
+        utl_rfc3339_sec(ts->tv_sec, buf);
+        buf[19] = '.';
+        memcpy(fmt->prefix, buf, sizeof(fmt->prefix));
+        fmt->sec = ts->tv_sec;
+    } else {
+        memcpy(buf, fmt->prefix, sizeof(fmt->prefix));
+    }
+    len = 20 + utl_u32_to_dec((uint32_t)ts->tv_nsec, buf + 20);
+    buf[len] = 'Z';
+    buf[len + 1] = '\0';
+    return len + 1;
 }
 
 /** Get current time from clock CLOCK_REALTIME (see man -3 time) and store it
@@ -450,3 +796,300 @@ utl_clock_gettime_rt_fatal(struct timespec *tp)
     }  
 }
 
+/** Get current time from clock CLOCK_MONOTONIC (see man -3 time) in
+ * milliseconds. Unlike CLOCK_REALTIME it is not affected by system time
+ * changes, which makes it suitable for measuring timeouts.
+ *
+ * @note This function is fatal on error, see @ref utl_clock_gettime_rt_fatal.
+ *
+ * @return Returns current monotonic time in milliseconds.
+ */
+uint64_t
+utl_clock_monotonic_ms_fatal(void)
+{
+    struct timespec tp;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0) {
+        assert(0);
+    }
+    return (uint64_t)tp.tv_sec * 1000 + tp.tv_nsec / 1000000;
+}
+
+
+/** Get current time from clock CLOCK_MONOTONIC (see man -3 time) in
+ * microseconds.
+ *
+ * @note This function is fatal on error, see @ref utl_clock_gettime_rt_fatal.
+ *
+ * @return Returns current monotonic time in microseconds.
+ */
+uint64_t
+utl_clock_monotonic_us_fatal(void)
+{
+    struct timespec tp;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0) {
+        assert(0);
+    }
+    return (uint64_t)tp.tv_sec * 1000000 + tp.tv_nsec / 1000;
+}
+
+/** Measure frequency of @ref utl_cycles counter against monotonic clock. On
+ * ARM64 frequency is read from cntfrq_el0, elsewhere it is measured over
+ * 10 milliseconds on first call, so first caller blocks for that long.
+ * Measured frequency is kept and returned to later callers.
+ *
+ * @return Returns number of cycles per second.
+ */
+uint64_t
+utl_cycles_per_sec(void)
+{
+#if defined(__aarch64__)
+    uint64_t freq;
+
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r" (freq));
+    return freq;
+#else
+    static _Atomic uint64_t freq = 0;
+    struct timespec         wait = { .tv_sec = 0, .tv_nsec = 10000000 };
+    uint64_t                start_ns;
+    uint64_t                start;
+    uint64_t                end_ns;
+    uint64_t                end;
+    struct timespec         tp;
+
+    if (freq != 0) {
+        return freq;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    start_ns = utl_timespec_to_ns(&tp);
+    start    = utl_cycles();
+    nanosleep(&wait, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    end_ns = utl_timespec_to_ns(&tp);
+    end    = utl_cycles();
+
+    /* Threads measuring concurrently store about the same value. */
+    freq = (end - start) * 1000000000 / (end_ns - start_ns);
+    return freq;
+#endif
+}
+
+/** Initialize clock and sync it with system clock, see @ref utl_clock_t.
+ *
+ * @param clk Clock to initialize.
+ */
+void
+utl_clock_init(utl_clock_t *clk)
+{
+    struct timespec now;
+
+    clk->mult = ((uint64_t)1000000000 << 32) / utl_cycles_per_sec();
+    utl_clock_sync(clk, &now);
+}
+
+/** Sync clock with system clock: read wall clock time, coarse monotonic
+ * time and cycle counter.
+ *
+ * @param clk Clock to sync.
+ * @param now Where to store current wall clock time.
+ */
+void
+utl_clock_sync(utl_clock_t *clk, struct timespec *now)
+{
+    struct timespec mono;
+
+    utl_clock_gettime_rt_fatal(now);
+    clk->base_cycles = utl_cycles();
+    clk->base_ns     = utl_timespec_to_ns(now);
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &mono) != 0) {
+        assert(0);
+    }
+    clk->mono_ms = (uint64_t)mono.tv_sec * 1000 + mono.tv_nsec / 1000000;
+}
+
+/** Convert timespec to nanoseconds.
+ *
+ * @param ts Timespec to convert.
+ *
+ * @return   Returns time in nanoseconds, 0 if timespec is not set (zero).
+ */
+uint64_t
+utl_timespec_to_ns(struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/** Advise kernel to back memory range with transparent huge pages. Only
+ * whole pages inside range are advised, so range should be large (a few huge
+ * pages) for this to have effect. Failure is not an error, memory is then
+ * backed by regular pages.
+ *
+ * @param ptr Start of range.
+ * @param len Length of range.
+ *
+ * @return    Returns number of bytes advised, 0 if range holds no whole page
+ *            or kernel does not support transparent huge pages.
+ */
+size_t
+utl_madvise_hugepages(void *ptr, size_t len)
+{
+    uintptr_t page  = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)ptr + page - 1) & ~(page - 1);
+    uintptr_t end   = ((uintptr_t)ptr + len) & ~(page - 1);
+
+    if (ptr == NULL || end <= start) {
+        return 0;
+    }
+    if (madvise((void *)start, end - start, MADV_HUGEPAGE) != 0) {
+        return 0;
+    }
+    return end - start;
+}
+
+/** Fault in pages of memory range, so they are not faulted in when first
+ * accessed later. File backed memory is read into page cache first
+ * (MADV_WILLNEED). Pages are populated with MADV_POPULATE_READ or
+ * MADV_POPULATE_WRITE, or touched one by one on kernels that do not support
+ * them (before Linux 5.14). Writable memory is touched by writing back byte
+ * it holds, only bytes inside range are touched, so range may share pages
+ * with memory other threads use.
+ *
+ * @param ptr      Start of range.
+ * @param len      Length of range.
+ * @param writable Whether memory is writable, read only memory is populated
+ *                 for read.
+ *
+ * @return         Returns number of bytes of pages range spans.
+ */
+size_t
+utl_mem_prefault(void *ptr, size_t len, bool writable)
+{
+    uintptr_t page  = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(page - 1);
+    uintptr_t end   = ((uintptr_t)ptr + len + page - 1) & ~(page - 1);
+
+    if (ptr == NULL || len == 0) {
+        return 0;
+    }
+    if (!writable) {
+        madvise((void *)start, end - start, MADV_WILLNEED);
+    }
+    if (madvise((void *)start, end - start,
+                writable ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) != 0) {
+        for (uintptr_t p = (uintptr_t)ptr; p < (uintptr_t)ptr + len;
+             p = (p & ~(page - 1)) + page) {
+            volatile unsigned char *b = (volatile unsigned char *)p;
+
+            if (writable) {
+                *b = *b;
+            } else {
+                (void)*b;
+            }
+        }
+    }
+    return end - start;
+}
+
+/** Parse IP network from string, an IPv4 or IPv6 address optionally followed
+ * by "/" and prefix length. Address without prefix length is a single host.
+ *
+ * @param net Where to store parsed network.
+ * @param str String to parse, e.g. "192.0.2.0/24" or "2001:db8::1".
+ *
+ * @return    Returns 0 on success, -1 if string is not a valid network.
+ */
+int
+utl_net_parse(utl_net_t *net, const char *str)
+{
+    char          buf[INET6_ADDRSTRLEN];
+    const char   *slash = strchr(str, '/');
+    size_t        len   = slash != NULL ? (size_t)(slash - str) : strlen(str);
+    unsigned long bits  = 0;
+    char         *end   = NULL;
+
+    if (len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    *net = (utl_net_t) { };
+    if (inet_pton(AF_INET, buf, net->addr) == 1) {
+        net->family = AF_INET;
+        bits = 32;
+    } else if (inet_pton(AF_INET6, buf, net->addr) == 1) {
+        net->family = AF_INET6;
+        bits = 128;
+    } else {
+        return -1;
+    }
+    if (slash != NULL) {
+        unsigned long max = bits;
+
+        errno = 0;
+        bits = strtoul(slash + 1, &end, 10);
+        if (errno != 0 || end == slash + 1 || *end != '\0' || bits > max) {
+            return -1;
+        }
+    }
+    net->prefix_len = bits;
+    return 0;
+}
+
+/** Convert IPv4-mapped IPv6 address, e.g. client of a dual stack listener,
+ * to IPv4 address in place. Other addresses are left as they are.
+ *
+ * @param ss IP address to convert, port is kept.
+ */
+void
+utl_sockaddr_unmap(struct sockaddr_storage *ss)
+{
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+    struct sockaddr_in   sin  = { .sin_family = AF_INET };
+
+    if (ss->ss_family != AF_INET6 || !IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr)) {
+        return;
+    }
+    sin.sin_port = sin6->sin6_port;
+    memcpy(&sin.sin_addr, &sin6->sin6_addr.s6_addr[12], sizeof(sin.sin_addr));
+    memset(ss, 0, sizeof(struct sockaddr_in6));
+    memcpy(ss, &sin, sizeof(sin));
+}
+
+/** Check whether IP address is in network. IPv4-mapped IPv6 address (client
+ * of a dual stack listener) matches as IPv4 address.
+ *
+ * @param net Network.
+ * @param ss  IP address to check.
+ *
+ * @return    Returns true if address is in network.
+ */
+bool
+utl_net_match(const utl_net_t *net, const struct sockaddr_storage *ss)
+{
+    const uint8_t *addr = NULL;
+    uint8_t        full = net->prefix_len / 8;
+    uint8_t        rest = net->prefix_len % 8;
+
+    if (ss->ss_family == AF_INET) {
+        addr = (const uint8_t *)&((const struct sockaddr_in *)ss)->sin_addr;
+        if (net->family != AF_INET) {
+            return false;
+        }
+    } else if (ss->ss_family == AF_INET6) {
+        const struct in6_addr *a6 = &((const struct sockaddr_in6 *)ss)->sin6_addr;
+
+        addr = a6->s6_addr;
+        if (net->family == AF_INET && IN6_IS_ADDR_V4MAPPED(a6)) {
+            addr += 12;
+        } else if (net->family != AF_INET6) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    if (memcmp(addr, net->addr, full) != 0) {
+        return false;
+    }
+    return rest == 0 || ((addr[full] ^ net->addr[full]) & (0xff << (8 - rest))) == 0;
+}
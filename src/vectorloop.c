@@ -25,9 +25,11 @@
 #include <arpa/inet.h>
 #include <assert.h>
 #include <errno.h>
+#include <netinet/udp.h>
 #include <sched.h>
 #include <stdio.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
@@ -36,99 +38,262 @@
 #include "channel.h"
 #include "config.h"
 #include "conn.h"
+#include "coroutine.h"
+#include "dns_cookie.h"
 #include "log_app.h"
-#include "lru_cache.h"
+#include "mem.h"
+#include "probes.h"
 #include "query.h"
+#include "response_cache.h"
 #include "utils.h"
 #include "vectorloop.h"
 #include "vectorloop_epoll.h"
+#include "vectorloop_uring.h"
+#include "zone_secondary.h"
+
+/** Vectorloop function publishes response cache generation to in-kernel
+ * responder of XDP program when it changes. Generation 0 is published, so
+ * responder stands aside, while anything that makes response depend on
+ * client is in use: views, client ACL, response policy, GeoIP, ECS map or
+ * response rate limiting. Each vectorloop publishes generation it moved to,
+ * entries of vectorloops still on previous generation are not answered.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_xdp_resp_generation(vectorloop_t *vl)
+{
+    uint64_t generation = vl->response_cache.generation;
+
+    if (vl->views != NULL || vl->acl != NULL || vl->policy != NULL ||
+        vl->geoip != NULL || vl->ecs_map != NULL || vl->rrl.buckets != NULL) {
+        generation = 0;
+    }
+    if (generation != vl->xdp_resp_generation) {
+        debug_printf("vl %d, XDP responder generation %lu", vl->id,
+                     (unsigned long)generation);
+        vl->xdp_resp_generation = generation;
+        vl_xdp_resp_generation_set(vl->xdp_prog, generation);
+    }
+}
+
+/** Check whether listener keeps UDP vector length of its listener tuning
+ * profile when configuration is reloaded.
+ *
+ * @param vl       Vectorloop operating on.
+ * @param listener UDP listener.
+ *
+ * @return         Returns true if listener profile sets vector length.
+ */
+static inline bool
+vl_listener_profile_vector_len(vectorloop_t *vl, conn_t *listener)
+{
+    return listener->profile != 0 &&
+           vl->cfg->listener_profiles[listener->profile - 1].udp_conn_vector_len_set;
+}
 
-/** Vectorloop function processes messages received on channels.
+/** Vectorloop function reads resources published by resource thread.
  * 
- * Channels vectorloop receives messages on are:
- * - resource channel which updates the resource pointer, returns message
- *   indicating operation completed.
- * - query log channel which flips the active query log buffer and returns a
- *   pointer to inactive buffer. Inactive buffer is one written to disk by
- *   query log thread.
+ * Called at start of each loop iteration, when vectorloop holds no references
+ * to resources, so it first announces a quiescent state which allows resource
+ * thread to release resources it retired. Response cache is invalidated when
+ * zone database, view set or zone catalog changed. Reloaded configuration replaces configuration
+ * vectorloop uses, see @ref config_reload(), and UDP listener vector lengths
+ * are set to its bounds, unless listener profile sets them.
  * 
  * @param vl Vectorloop operating on.
- * 
- * @return   Returns number of channel messages processed.
  */
-static int
-vl_fn_channel_messages(vectorloop_t *vl)
+static void
+vl_fn_resources(vectorloop_t *vl)
 {
-    int ret = 0;
-    channel_bss_msg_t *ch_msg;
+    zone_db_t      *zone_db;
+    views_t        *views;
+    zone_catalog_t *catalog;
+    config_t       *cfg;
+    conn_t         *conn;
+    conn_t         *listeners[4];
+
+    qsbr_quiescent(&vl->resources->qsbr, vl->id);
+
+    zone_db = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_ZONE_DB],
+                                   memory_order_acquire);
+    views = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_VIEWS],
+                                 memory_order_acquire);
+    catalog = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_CATALOG],
+                                   memory_order_acquire);
+    if (zone_db != vl->zone_db || views != vl->views || catalog != vl->catalog) {
+        debug_printf("vl %d, zone database, views or zone catalog updated", vl->id);
+        vl->zone_db = zone_db;
+        vl->views   = views;
+        vl->catalog = catalog;
+        /* Zone database generations stay below 2^32, view set and zone
+         * catalog generations take upper bits so any change invalidates
+         * cache.
+         */
+        response_cache_generation_set(&vl->response_cache,
+                                      ((zone_db != NULL ? zone_db->generation : 0) |
+                                       (views != NULL ? views->generation << 32 : 0)) ^
+                                      (catalog != NULL ? catalog->generation << 48 : 0));
+    }
+    vl->ecs_map = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_ECS_MAP],
+                                       memory_order_acquire);
+    vl->acl = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_ACL],
+                                   memory_order_acquire);
+    vl->policy = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_POLICY],
+                                      memory_order_acquire);
+    vl->geoip = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_GEOIP],
+                                     memory_order_acquire);
+    vl->lb = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_LB],
+                                  memory_order_acquire);
+    if (vl->response_cache.hot_hits != 0) {
+        vl_fn_xdp_resp_generation(vl);
+    }
 
-    /* Check for messages on resource channel. */
-    if (channel_bss_recv(vl->resource_channel, &ch_msg) != 0) {
-        switch (ch_msg->op) {
-        case CH_OP_RES_SET_RESOURCE1:
-            /* set new pointer for resource 1. */
-            debug_printf("vl %d, got channel message for resource 1", vl->id);
+    cfg = atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_CONFIG],
+                               memory_order_acquire);
+    if (cfg != NULL && cfg != vl->cfg) {
+        debug_printf("vl %d, configuration reloaded, generation %lu", vl->id,
+                     (unsigned long)cfg->generation);
+        vl->cfg = cfg;
+
+        listeners[0] = vl->listener_udp_ipv4;
+        listeners[1] = vl->listener_udp_ipv6;
+        listeners[2] = vl->listener_xdp;
+        listeners[3] = vl->listener_replay;
+        for (int i = 0; i < 4; i++) {
+            if (listeners[i] != NULL && !vl_listener_profile_vector_len(vl, listeners[i])) {
+                conn_udp_vector_len_set(listeners[i]->conn.udp, cfg->udp_conn_vector_len,
+                                        cfg->udp_conn_vector_len_min);
+            }
+        }
 
-            ch_msg->result = 1;
-            channel_bssvl_send(vl->resource_channel, ch_msg);
-            ret += 1;
-            break;
+        /* Listeners bound to addresses with batches of their own. */
+        for (size_t i = 0; i < vl->listeners_udp_addr_count; i++) {
+            conn = vl->listeners_udp_addr[i];
+            if (conn->conn.udp->listener == conn && conn != listeners[0] &&
+                conn != listeners[1] && !vl_listener_profile_vector_len(vl, conn)) {
+                conn_udp_vector_len_set(conn->conn.udp, cfg->udp_conn_vector_len,
+                                        cfg->udp_conn_vector_len_min);
+            }
+        }
+    }
+}
 
-        case CH_OP_RES_SET_RESOURCE2:
+/** Stop reading from listeners and have idle TCP connections closed. UDP
+ * listeners stay registered with epoll, so responses waiting for socket to
+ * become writable are still sent, but are not queued for read anymore. TCP
+ * listeners are removed from epoll. Idle TCP connections are queued for
+ * read, which finds no data and closes them, see @ref vl_fn_tcp_read().
+ * Connections with queries in progress are closed once they become idle.
+ *
+ * @note This is a helper function for @ref vl_fn_drain().
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_listeners_stop(vectorloop_t *vl)
+{
+    conn_t *udp[] = { vl->listener_udp_ipv4, vl->listener_udp_ipv6 };
+    conn_t *tcp[] = { vl->listener_tcp_ipv4, vl->listener_tcp_ipv6,
+                      vl->listener_dot_ipv4, vl->listener_dot_ipv6 };
+    conn_t *conn;
 
-            break;
+    vl->draining = true;
 
-        default:
-            /* Code error, unknown resource message op. Log and exit. */
-            {
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "vl_fn_channel_messages() error, "
-                        "unknown resource channel message op \"%d\"", ch_msg->op);
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-                channel_log_send(vl->app_log_channel, lmsg);
-            }
+    for (size_t i = 0; i < sizeof(udp) / sizeof(udp[0]); i++) {
+        if (udp[i] != NULL) {
+            conn_fifo_remove_from_read_queue(&vl->conn_udp_read_queue, udp[i]);
+            udp[i]->waiting_for_read            = 0;
+            udp[i]->conn.udp->waiting_for_batch = 0;
+        }
+    }
+    for (size_t i = 0; i < vl->listeners_udp_addr_count; i++) {
+        conn = vl->listeners_udp_addr[i];
+        conn_fifo_remove_from_read_queue(&vl->conn_udp_read_queue, conn);
+        conn->waiting_for_read            = 0;
+        conn->conn.udp->waiting_for_batch = 0;
+    }
+    vl->conn_udp_batch_wait_queue = (conn_fifo_queue_t) { };
+    for (size_t i = 0; i < sizeof(tcp) / sizeof(tcp[0]); i++) {
+        if (tcp[i] != NULL) {
+            conn_fifo_remove_from_read_queue(&vl->conn_tcp_accept_conns_queue, tcp[i]);
+            tcp[i]->waiting_for_read = 0;
+            vl_epoll_ctl_del(vl->ep_fd, tcp[i]->fd);
         }
     }
 
-    /* Check for messages on query log channel. */
-    if (channel_bss_recv(vl->query_log_channel, &ch_msg) != 0) {
-        switch (ch_msg->op) {
-        case CH_OP_QUERY_LOG_FLIP:
-            /* Flip log buffer */
-            debug_printf("vl %d, got channel message to flip query log buffer", vl->id);
+    for (uint32_t i = 0; i < vl->conn_tcp_table.size; i++) {
+        conn = vl->conn_tcp_table.slots[i].conn;
+        if (conn != NULL && conn->waiting_for_read &&
+            conn->conn.tcp->state == TCP_CONN_ST_WAIT_FOR_QUERY) {
+            conn->waiting_for_read = 0;
+            conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
+        }
+    }
+}
 
-            ch_msg->result = 1;
-            ch_msg->p = vl->query_log.buf;
-            ch_msg->result = vl->query_log.buf_len;
-            query_log_rotate(&vl->query_log);
+/** Vectorloop function for drain. Once drain is started, on termination
+ * signal or once listeners were handed over to new process, vectorloop stops
+ * reading from listeners, see @ref vl_listeners_stop().
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_drain(vectorloop_t *vl)
+{
+    if (!vl->draining && vl_drain_started(vl->drain)) {
+        vl_listeners_stop(vl);
+    }
+}
 
-            channel_bssvl_send(vl->query_log_channel, ch_msg);
-            ret += 1;
-            break;
+/** Check if draining vectorloop is drained: it has no TCP connections, nor
+ * UDP queries in progress, and all queries it logged are published to query
+ * log thread.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns true if vectorloop is drained and its thread may exit.
+ */
+static bool
+vl_drained(vectorloop_t *vl)
+{
+    conn_t *udp[] = { vl->listener_udp_ipv4, vl->listener_udp_ipv6 };
 
-        default:
-            /* Code error, unknown query log message op. Log and exit. */
-            {
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "vl_fn_channel_messages() error, "
-                        "unknown query log channel message op \"%d\"", ch_msg->op);
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-                channel_log_send(vl->app_log_channel, lmsg);
-            }
+    if (vl->conns_tcp_active > 0 || vl->pending_udp_count > 0 ||
+        vl->query_log.buf_len > 0) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(udp) / sizeof(udp[0]); i++) {
+        if (udp[i] != NULL &&
+            udp[i]->conn.udp->batches_free < udp[i]->conn.udp->batches_count) {
+            return false;
         }
     }
+    for (size_t i = 0; i < vl->listeners_udp_addr_count; i++) {
+        conn_udp_t *conn_udp = vl->listeners_udp_addr[i]->conn.udp;
 
-    return ret;
+        if (conn_udp->batches != NULL && conn_udp->batches_free < conn_udp->batches_count) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /** Vectorloop function polls epoll for events.
  * 
- * Each vectorloop has its own epoll file descriptor with witch all connections
- * are registered for events EPOLLIN (data available to read) and EPOLLOUT
- * (writable). Connections are registerred for Edge Trigger notifications, see
- * Linux manual page "man epoll" for full details on what Edge Triggered means.
+ * Each vectorloop has a single epoll file descriptor with witch all
+ * connections, UDP and TCP, are registered for events EPOLLIN (data available
+ * to read) and EPOLLOUT (writable). Connections are registerred for Edge
+ * Trigger notifications, see Linux manual page "man epoll" for full details
+ * on what Edge Triggered means.
+ *
+ * Event data is either connection ID (TCP connections), or a pointer to
+ * connection object (UDP and TCP listeners), connection type is dispatched on
+ * from connection object. Event with ID @ref VL_EPOLL_ID_WAKE is for the
+ * vectorloop wake up eventfd.
+ *
+ * epoll_wait() is non blocking unless vectorloop set ep_timeout_ms because it
+ * was idle, see @ref vl_run.
  * 
  * @param vl Vectorloop operating on.
  * 
@@ -138,21 +303,50 @@ static int
 vl_fn_epoll(vectorloop_t *vl)
 {
     struct epoll_event *ev;
-    int                 event_count = 0;
-    int                 count       = 0;
+    int                 count = 0;
     conn_t             *conn;
     
-    /* Check with epoll for new UDP events (non-blocking). */
-    count = vl_epoll_wait(vl->ep_fd_udp, vl->ep_events, vl->cfg->epoll_num_events_udp);
-    event_count += count;
+    /* Check with epoll for new events, blocks only if vectorloop is idle.
+     * Vectorloop holds no references to resources at this point, it is
+     * offline while blocked so it does not hold back their release.
+     */
+    if (vl->ep_timeout_ms > 0) {
+        qsbr_offline(&vl->resources->qsbr, vl->id);
+    }
+    count = vl_epoll_wait(vl->ep_fd, vl->ep_events, vl->ep_events_size,
+                          vl->ep_timeout_ms);
+    if (vl->ep_timeout_ms > 0) {
+        /* Resources may have been released while offline, read them again. */
+        qsbr_online(&vl->resources->qsbr, vl->id);
+        vl_fn_resources(vl);
+
+        /* Loop time is stale after a blocking wait. */
+        vl->ep_timeout_ms = 0;
+        utl_clock_sync(&vl->clock, &vl->loop_timestamp);
+        vl->loop_time_ms = vl->clock.mono_ms;
+        vl->rt_block_ms  = vl->loop_time_ms;
+    }
 
-     /* Handle each event. */
+    /* Handle each event. */
     for (int i = 0; i < count; i++) {
         /* Get event from epoll. */
         ev = &vl->ep_events[i];
 
-        /* Event data is a pointer to connection object it is associated with. */
-        conn = (conn_t *)ev->data.u64;
+        if (ev->data.u64 == VL_EPOLL_ID_WAKE) {
+            /* Woken up by another thread, work is picked up this iteration. */
+            vl_epoll_wake_drain(vl->wake_fd);
+            continue;
+        }
+
+        if (CONN_TABLE_IS_CID(ev->data.u64)) {
+            conn = conn_table_get(&vl->conn_tcp_table, ev->data.u64);
+            if (conn == NULL) {
+                /* Stale event for connection that was released. */
+                continue;
+            }
+        } else {
+            conn = (conn_t *)ev->data.u64;
+        }
 
         if (CONN_IS_UDP_LISTENER(conn)) {
             /* Single event could be for either or both EPOLLIN and EPOLLOUT, hence
@@ -165,70 +359,225 @@ vl_fn_epoll(vectorloop_t *vl)
                     conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
                 }
             }
+            if (ev->events & EPOLLOUT) {
+                /* Add listener batches waiting to be sent to write queue. */
+                for (unsigned int j = 0; j < conn->conn.udp->batches_count; j++) {
+                    conn_t *batch = conn->conn.udp->batches[j];
+
+                    if (batch->waiting_for_write) {
+                        batch->waiting_for_write = 0;
+                        conn_fifo_enqueue_write(&vl->conn_udp_write_queue, batch);
+                    }
+                }
+            }
+
+        } else if (CONN_IS_TCP_LISTENER(conn)) {
+            /* Accept connections from TCP listener. */
+            if (conn->waiting_for_read) {
+                /* Add conn to TCP accept conns queue. */
+                conn->waiting_for_read = 0;
+                conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+            }
+
+        } else if (CONN_IS_TCP_CONN(conn)) {
+            if (ev->events & EPOLLIN) {
+                if (conn->waiting_for_read) {
+                    /* Add conn to read queue. */
+                    conn->waiting_for_read = 0;
+                    conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
+                }
+            }
             if (ev->events & EPOLLOUT) {
                 if (conn->waiting_for_write) {
-                    /* Add conn to write queue. */
+                    /* Add conn to zone transfer or write queue. */
                     conn->waiting_for_write = 0;
-                    conn_fifo_enqueue_write(&vl->conn_udp_write_queue, conn);
+                    if (conn->conn.tcp->state == TCP_CONN_ST_XFR) {
+                        conn_fifo_enqueue_write(&vl->conn_tcp_xfr_queue, conn);
+                    } else {
+                        conn_fifo_enqueue_write(&vl->conn_tcp_write_queue, conn);
+                    }
                 }
             }
+
         } else {
             /* Code error, event id not recognized. Log and exit. */
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_FN_EPOLL, NULL, true);
-            channel_log_send(vl->app_log_channel, lmsg);
+            channel_log_write_id(vl->app_log_channel, APP_LOG_MSG_VL_FN_EPOLL, 0, true);
             return 0;
         }
     }
 
-    
-    /* Check with epoll for new TCP events (non-blocking). */
-    count = vl_epoll_wait(vl->ep_fd_tcp, vl->ep_events, vl->cfg->epoll_num_events_tcp);
-    event_count += count;
+    return count;
+}
 
-        /* Handle each event. */
-        for (int i = 0; i < count; i++) {
-            /* Get event from epoll. */
-            ev = &vl->ep_events[i];
+/** Set TCP connection state and (re)arm connection timer with timeout that
+ * applies to the state:
+ * - TCP_CONN_ST_WAIT_FOR_QUERY: keepalive (idle) timeout, connection is moved
+ *   to tail of idle queue.
+ * - TCP_CONN_ST_WAIT_FOR_QUERY_DATA: query receive timeout.
+ * - TCP_CONN_ST_WAIT_FOR_WRITE: query send timeout.
+ * - TCP_CONN_ST_XFR: query send timeout, rearmed on every zone transfer
+ *   progress.
+ *
+ * @param vl    Vectorloop operating on.
+ * @param conn  TCP connection.
+ * @param state New connection state, one of above states.
+ */
+static void
+vl_tcp_conn_state_set(vectorloop_t *vl, conn_t *conn, conn_tcp_state_t state)
+{
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
+    size_t      timeout  = 0;
+
+    switch (state) {
+    case TCP_CONN_ST_WAIT_FOR_QUERY:
+        timeout = conn_tcp->tcp_keepalive > 0 ? conn_tcp->tcp_keepalive :
+                                                vl->cfg->tcp_keepalive;
+        break;
+    case TCP_CONN_ST_WAIT_FOR_QUERY_DATA:
+        timeout = vl->cfg->tcp_query_recv_timeout;
+        break;
+    case TCP_CONN_ST_WAIT_FOR_WRITE:
+    case TCP_CONN_ST_XFR:
+        timeout = vl->cfg->tcp_query_send_timeout;
+        break;
+    default:
+        /* Code error, state has no timeout associated with it. */
+        assert(0);
+    }
+    conn_tcp->state = state;
+    timer_wheel_arm(&vl->conn_tcp_timers, &conn->timer, vl->loop_time_ms + timeout);
+    if (state == TCP_CONN_ST_WAIT_FOR_QUERY) {
+        conn_fifo_enqueue_idle(&vl->conn_tcp_idle_queue, conn);
+    } else {
+        conn_fifo_remove_from_idle_queue(&vl->conn_tcp_idle_queue, conn);
+    }
+}
 
-            /* Event data is a pointer to connection object it is associated with. */
-            conn = (conn_t *)ev->data.u64;
-            
-            if (CONN_IS_TCP_LISTENER(conn)) {
-                /* Accept connections from TCP listener. */
-                /* Add conn to TCP accept conns queue. */
-                conn->waiting_for_read = 0;
-                conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
-                
-            } else if (CONN_IS_TCP_CONN(conn)) {
-                if (ev->events & EPOLLIN) {
-                    if (conn->waiting_for_read) {
-                        /* Add conn to read queue. */
-                        conn->waiting_for_read = 0;
-                        conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
-                    }
-                }
-                if (ev->events & EPOLLOUT) {
-                    if (conn->waiting_for_write) {
-                        /* Add conn to write queue. */
-                        conn->waiting_for_write = 0;
-                        conn_fifo_enqueue_write(&vl->conn_tcp_write_queue, conn);
-                    }
-                }
-            } else {
-                /* Code error, event id not recognized. Log and exit. */
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_FN_EPOLL, NULL, true);
-                channel_log_send(vl->app_log_channel, lmsg);
-                return 0;
-            }
+/** Release TCP connection object of a connection that has ended: remove it
+ * from connection table, timer wheel, epoll and queues, close its socket,
+ * report its metrics and return it to connection pool.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection, not in release queue.
+ */
+static void
+vl_tcp_conn_release(vectorloop_t *vl, conn_t *conn)
+{
+    PROBE_TCP_CONN(tcp__release, vl->id, conn);
+
+    /* Remove TCP conn from TCP connection table, and disarm its timer. */
+    conn_table_remove(&vl->conn_tcp_table, conn);
+    timer_wheel_disarm(&conn->timer);
+
+    /* Deregister fd from epoll. */
+    if (conn->fd >= 0) {
+        vl_epoll_ctl_del(vl->ep_fd, conn->fd);
+        close(conn->fd);
+        conn->fd = -1;
+    }
+
+    /* Remove conn from read or write queue. Conn could be in either one of
+     * these queues if a timeout was detected.
+     */
+    conn_fifo_remove_from_read_queue(&vl->conn_tcp_read_queue, conn);
+    if (conn->conn.tcp->state == TCP_CONN_ST_XFR) {
+        conn_fifo_remove_from_write_queue(&vl->conn_tcp_xfr_queue, conn);
+    } else {
+        conn_fifo_remove_from_write_queue(&vl->conn_tcp_write_queue, conn);
+    }
+    conn_fifo_remove_from_idle_queue(&vl->conn_tcp_idle_queue, conn);
+
+    /* Uncount connection of its client network. */
+    conn_limit_release(&vl->conn_tcp_limit, conn->conn.tcp->client_key);
+
+    /* Abandon zone transfer still in progress, if any. */
+    zone_xfr_stream_free(conn->conn.tcp->xfr);
+    conn->conn.tcp->xfr = NULL;
+
+    /* Report TCP metrics, connection that did not end on an error ends now. */
+    if (conn->conn.tcp->end_time.tv_sec == 0) {
+        conn->conn.tcp->end_time = vl->loop_timestamp;
+    }
+    conn_tcp_report_metrics(conn->conn.tcp, vl->metrics_vl);
+
+    conn_pool_put(&vl->conn_tcp_pool, conn);
+    DECREMENT(vl->conns_tcp_active);
+}
+
+/** Evict TCP connection idle for longest time, to make room for a new
+ * connection once vectorloop holds maximum number of TCP connections.
+ * Connections in read queue are skipped, as epoll reported data arrived on
+ * them, as are connections already in release queue. Evicted connection is
+ * released right away, so new connection can take its connection ID.
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_accept_conns().
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns true if a connection was evicted.
+ */
+static bool
+vl_tcp_conn_evict(vectorloop_t *vl)
+{
+    conn_t *conn;
+
+    while ((conn = conn_fifo_dequeue_idle(&vl->conn_tcp_idle_queue)) != NULL) {
+        if (conn->in_read_queue || conn->in_release_queue) {
+            continue;
         }
+        conn->conn.tcp->state = TCP_CONN_ST_EVICTED;
+        vl_tcp_conn_release(vl, conn);
+        return true;
+    }
+    return false;
+}
 
-    return event_count;
+/** Update maximum number of active TCP connections vectorloop takes on to
+ * what fits in memory budget. Memory in use is memory all vectorloops
+ * allocated plus memory zone database holds. Vectorloop may grow by its
+ * share of memory left, in connections of @ref vectorloop_t conn_tcp_bytes
+ * each, and by none once memory in use reaches budget.
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_accept_conns().
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_mem_budget_update(vectorloop_t *vl)
+{
+    metrics_t *metrics = vl->metrics;
+    uint64_t   budget  = (uint64_t)vl->cfg->memory_budget * 1024 * 1024;
+    uint64_t   used    = atomic_load_explicit(&metrics->mem.zone_bytes, memory_order_relaxed);
+    uint64_t   conns   = vl->cfg->tcp_conns_per_vl_max;
+
+    vl->mem_budget_check_ms = vl->loop_time_ms;
+    for (size_t i = 0; i < metrics->vl_shards_count; i++) {
+        used += mem_account_total(&metrics->vl_shards[i].vl.mem);
+    }
+    if (used >= budget) {
+        conns = vl->conns_tcp_active;
+    } else if (vl->conn_tcp_bytes > 0) {
+        conns = vl->conns_tcp_active +
+                (budget - used) / metrics->vl_shards_count / vl->conn_tcp_bytes;
+    }
+    vl->conns_tcp_max = conns < vl->cfg->tcp_conns_per_vl_max ?
+                        conns : vl->cfg->tcp_conns_per_vl_max;
 }
 
 /** Vectorloop function accepts new TCP connections.
  * 
  * Number of active TCP connections is limited to
- * configuration setting "tcp_conns_per_vl_max".
+ * configuration setting "tcp_conns_per_vl_max", lowered to what fits in
+ * memory budget if "memory_budget" is set, see @ref vl_mem_budget_update().
+ * Number of connections
+ * accepted is limited to "tcp_listener_max_accept_new_conn" per listener, one
+ * of its listener profile if profile sets it, and
+ * "loop_budget_tcp_accepts" across listeners. Once the limit is reached, and
+ * "tcp_conns_idle_evict" is set, each connection accepted evicts connection
+ * idle for longest time, see @ref vl_tcp_conn_evict(). Connections are thus
+ * only evicted for connections that were actually waiting to be accepted.
+ * Connections of a client network over "tcp_conns_per_client_max" are closed
+ * once accepted.
  * 
  * @param vl Vectorloop operating on.
  * 
@@ -241,53 +590,86 @@ vl_fn_tcp_accept_conns(vectorloop_t *vl)
     conn_t                 *tcp_conn;
     struct sockaddr_storage client_ip;
     struct sockaddr_storage local_ip;
-    socklen_t               ip_len       = sizeof(struct sockaddr_storage);   
-    int                     fd           = -1;
-    int                     ip_version   = 0;
-    int                     accept_count = 0;
-    int                     accept_max   = 0;
-    conn_fifo_queue_t       new_queue    = {};
-
+    socklen_t               ip_len         = sizeof(struct sockaddr_storage);   
+    int                     fd             = -1;
+    int                     ip_version     = 0;
+    int                     accept_count   = 0;
+    int                     accept_max     = 0;
+    int                     listener_count = 0;
+    size_t                  listener_max   = 0;
+    size_t                  budget         = vl->cfg->loop_budget_tcp_accepts;
+    uint64_t                client_key     = 0;
+    conn_fifo_queue_t       new_queue      = {};
+
+    if (vl->cfg->memory_budget > 0 &&
+        vl->loop_time_ms - vl->mem_budget_check_ms >= VL_MEM_BUDGET_CHECK_MS) {
+        vl_mem_budget_update(vl);
+    }
     
     while ((conn = conn_fifo_dequeue_read(&vl->conn_tcp_accept_conns_queue)) != NULL) {
         /* Ensure that newly accepted connection count does not exceed maximum
-         * number of active TCP connections allowed.
+         * number of active TCP connections allowed, nor per listener and per
+         * vectorloop iteration accept limits.
          */
-        accept_max = vl->cfg->tcp_conns_per_vl_max - vl->conns_tcp_active;
-        if (accept_max > vl->cfg->tcp_listener_max_accept_new_conn) {
-            accept_max = vl->cfg->tcp_listener_max_accept_new_conn;
+        listener_max = vl->cfg->tcp_listener_max_accept_new_conn;
+        if (conn->profile != 0 &&
+            vl->cfg->listener_profiles[conn->profile - 1].tcp_listener_max_accept_new_conn != 0) {
+            listener_max = vl->cfg->listener_profiles[conn->profile - 1].tcp_listener_max_accept_new_conn;
         }
+        accept_max = (int64_t)vl->conns_tcp_max - (int64_t)vl->conns_tcp_active;
+        if (accept_max <= 0 && vl->cfg->tcp_conns_idle_evict &&
+            vl->conn_tcp_idle_queue.head != NULL) {
+            /* Connections accepted take place of idle connections. */
+            accept_max = listener_max;
+        }
+        if (accept_max > (int)listener_max) {
+            accept_max = listener_max;
+        }
+        if (budget > 0 && accept_max > (int)(budget - accept_count)) {
+            accept_max = budget - accept_count;
+        }
+        listener_count = 0;
+        fd             = 0;
+
+        while (listener_count < accept_max) {
+            /* Accepted socket is non-blocking from the start, and address
+             * length is reset as previous iteration may have shortened it.
+             */
+            ip_len = sizeof(struct sockaddr_storage);
+            fd = accept4(conn->fd, (struct sockaddr *)&client_ip, &ip_len,
+                         SOCK_NONBLOCK);
+            if (fd < 0) {
+                break;
+            }
 
-        while ((fd = accept4(conn->fd, (struct sockaddr *)&client_ip, &ip_len,
-                             SOCK_NONBLOCK)) > -1 &&
-                accept_count < vl->cfg->tcp_listener_max_accept_new_conn) {
             /* New TCP connection accepted. */
             INCREMENT(accept_count);
+            INCREMENT(listener_count);
 
             /* Check client IP. */
             if (client_ip.ss_family == AF_INET) {
                 ip_version = 0;
-                atomic_fetch_add(&vl->metrics->tcp.connections, 1);
+                METRICS_INC(vl->metrics_vl->tcp.connections);
             } else if (client_ip.ss_family == AF_INET6) {
                 ip_version = 1;
-                atomic_fetch_add(&vl->metrics->tcp.connections, 1);
+                METRICS_INC(vl->metrics_vl->tcp.connections);
             } else {
                 /* Unsupported client_ip socket family */
                 close(fd);
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_FN_TCP_CONN_CLIENT_IP_FAM, NULL, false);
-                channel_log_send(vl->app_log_channel, lmsg);
-                atomic_fetch_add(&vl->metrics->tcp.unknown_client_ip_soc_family, 1);
+                channel_log_write_id(vl->app_log_channel, APP_LOG_MSG_VL_FN_TCP_CONN_CLIENT_IP_FAM, 0, false);
+                METRICS_INC(vl->metrics_vl->tcp.unknown_client_ip_soc_family);
                 continue;
             }
 
             /* Get local IP. */
             ip_len = sizeof(struct sockaddr_storage);
             if (getsockname(fd, (struct sockaddr *)&local_ip, &ip_len) != 0) {
-                /* System error or system out of resources. Log and exit. */
+                /* System error or system out of resources. Count error and
+                 * move on.
+                 */
+                channel_log_error(vl->app_log_channel, APP_LOG_ERR_VL_FN_TCP_CONN_GETSOCKNAME, errno);
                 close(fd);
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_FN_TCP_CONN_GETSOCKNAME, NULL, false);
-                channel_log_send(vl->app_log_channel, lmsg);
-                atomic_fetch_add(&vl->metrics->tcp.getsockname_err, 1);
+                METRICS_INC(vl->metrics_vl->tcp.getsockname_err);
                 continue;
             }
 
@@ -295,29 +677,48 @@ vl_fn_tcp_accept_conns(vectorloop_t *vl)
             if (local_ip.ss_family != AF_INET && local_ip.ss_family != AF_INET6) {
                 /* Unsupported local_ip socket family. */
                 close(fd);
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_FN_TCP_CONN_LOCAL_IP_FAM, NULL, false);
-                channel_log_send(vl->app_log_channel, lmsg);
-                atomic_fetch_add(&vl->metrics->tcp.unknown_local_ip_soc_family, 1);
+                channel_log_write_id(vl->app_log_channel, APP_LOG_MSG_VL_FN_TCP_CONN_LOCAL_IP_FAM, 0, false);
+                METRICS_INC(vl->metrics_vl->tcp.unknown_local_ip_soc_family);
+                continue;
+            }
+
+            /* Close connection of a client the client ACL drops right away. */
+            if (vl->acl != NULL && acl_check(vl->acl, &client_ip) == ACL_ACTION_DROP) {
+                close(fd);
+                METRICS_INC(vl->metrics_vl->dns.acl_dropped);
+                continue;
+            }
+
+            /* Check client network is within its connection limit. */
+            if (!conn_limit_acquire(&vl->conn_tcp_limit, &client_ip, false, &client_key)) {
+                close(fd);
+                METRICS_INC(vl->metrics_vl->tcp.client_conns_max);
+                continue;
+            }
+
+            /* Make room for connection if vectorloop is at its maximum. */
+            if (vl->conns_tcp_active >= vl->conns_tcp_max &&
+                !vl_tcp_conn_evict(vl)) {
+                /* Idle connections left are all about to be read from. */
+                close(fd);
+                conn_limit_release(&vl->conn_tcp_limit, client_key);
+                METRICS_INC(vl->metrics_vl->tcp.conn_id_unavailable);
                 continue;
             }
             
             /* Create TCP conn object. */
-            tcp_conn = conn_new_tcp(fd, vl->cfg, ip_version, &client_ip, &local_ip);
+            tcp_conn = conn_pool_get_tcp(&vl->conn_tcp_pool, fd, ip_version,
+                                         &client_ip, &local_ip);
+            tcp_conn->conn.tcp->client_key = client_key;
 
-            /* Set time, timeout and state. */
+            /* Set time. */
             tcp_conn->conn.tcp->start_time = vl->loop_timestamp;
-            tcp_conn->conn.tcp->timeout    = vl->loop_timestamp;
-            tcp_conn->conn.tcp->timeout.tv_sec += vl->cfg->tcp_query_recv_timeout;
-            tcp_conn->conn.tcp->state = TCP_CONN_ST_WAIT_FOR_QUERY_DATA;
-
-            /* Assign conn TCP ID. */
-            if (conn_tcp_id_assign(&tcp_conn->cid, &vl->conn_tcp_lru_cache,
-                                   &vl->conn_tcp_id_base) == false) {
-                /* Could not find available ID to assign, reject connection.
-                 * This should never be the case as we could only run out of
-                 * IDs to assign if we have uint64_t max active connections.
-                 * In addition, we ensure that there are only max of
-                 * CONN_TCP_ACTIVE_CONNS_MAX active TCP connections. 
+
+            /* Add conn to TCP connection table, which assigns conn TCP ID. */
+            if (conn_table_add(&vl->conn_tcp_table, tcp_conn) == false) {
+                /* Connection table is full, reject connection.
+                 * This should never be the case as we ensure that there are
+                 * only max of tcp_conns_per_vl_max active TCP connections.
                  */
                 close(fd);
                 tcp_conn->fd = -1;
@@ -325,19 +726,38 @@ vl_fn_tcp_accept_conns(vectorloop_t *vl)
                 conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, tcp_conn);
                 continue;
             }
-                        
-            /* Add new conn to TCP_CONN_TRACK LRU HASH. */
-            LRU_CACHE_ADD(vl->conn_tcp_lru_cache, tcp_conn);
-
-            /* Register new conn with epoll. */
-            tcp_conn->waiting_for_read = 1;
-            vl_epoll_ctl_reg_for_read_et(vl->ep_fd_tcp, fd, (uint64_t)tcp_conn);
 
             /* Increment active TCP connections count. */
             INCREMENT(vl->conns_tcp_active);
+            PROBE_TCP_CONN(tcp__accept, vl->id, tcp_conn);
+
+            if (conn->tls) {
+                /* DoT connection, it is registered with epoll once a
+                 * handshake thread is done with TLS handshake.
+                 */
+                tcp_conn->tls = 1;
+                tcp_conn->conn.tcp->state = TCP_CONN_ST_TLS_HANDSHAKE;
+                if (!dot_pool_submit(&vl->dot_pool, tcp_conn)) {
+                    close(fd);
+                    tcp_conn->fd = -1;
+                    tcp_conn->conn.tcp->state = TCP_CONN_ST_TLS_HANDSHAKE_BUSY;
+                    conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, tcp_conn);
+                }
+                continue;
+            }
+
+            /* Set state and arm query receive timeout. Connection is idle
+             * until its first query data arrives.
+             */
+            vl_tcp_conn_state_set(vl, tcp_conn, TCP_CONN_ST_WAIT_FOR_QUERY_DATA);
+            conn_fifo_enqueue_idle(&vl->conn_tcp_idle_queue, tcp_conn);
+
+            /* Register new conn with epoll. */
+            tcp_conn->waiting_for_read = 1;
+            vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, fd, tcp_conn->cid);
         }
 
-        if (fd < 0 || accept_max <= 0) {
+        if (fd < 0) {
             /* accept4() returned an error. */
             if (errno == EWOULDBLOCK || errno == EAGAIN) {
                 /* No new connections to accept. Listener conn will be added to
@@ -346,17 +766,14 @@ vl_fn_tcp_accept_conns(vectorloop_t *vl)
                 conn->waiting_for_read = 1;
             } else {
                 /* Error occurred on TCP listener socket, this is not recoverable. Log and exit. */
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "listener error, %s", strerror(errno));
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-                channel_log_send(vl->app_log_channel, lmsg);
+                channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true,
+                                  "listener error, %s", strerror(errno));
                 return 0 ;
             }
         } else {
             /* There are more connections to accept, or number of connections is
-             * maxed out per vl->cfg->tcp_conns_per_vl_max. Try again next loop
-             * iteration.
+             * maxed out per vl->cfg->tcp_conns_per_vl_max, or accept limits
+             * were reached. Try again next loop iteration.
              */
             conn_fifo_enqueue_read(&new_queue, conn);
         }
@@ -366,892 +783,4756 @@ vl_fn_tcp_accept_conns(vectorloop_t *vl)
     if (new_queue.head != NULL) {
         vl->conn_tcp_accept_conns_queue.head = new_queue.head;
         vl->conn_tcp_accept_conns_queue.tail = new_queue.tail;
+        vl->conn_tcp_accept_conns_queue.len  = new_queue.len;
     }
 
     return accept_count;
 }
 
-/** Vectorloop function reads data from TCP connections.
- * 
+/** Vectorloop function collects DoT connections handshake threads are done
+ * with. Connection switched to kernel TLS is registered with epoll and from
+ * then on served same as a TCP connection, connection handshake failed on is
+ * released.
+ *
  * @param vl Vectorloop operating on.
- * 
- * @return   Returns number of TCP connections data was read in from.
+ *
+ * @return   Returns number of DoT connections collected.
  */
 static int
-vl_fn_tcp_read(vectorloop_t *vl)
+vl_fn_dot_handshakes(vectorloop_t *vl)
 {
-    conn_t            *conn;
-    conn_tcp_t        *conn_tcp;
-    conn_fifo_queue_t new_queue = {};
-    int               read_count = 0;
-    ssize_t           ret      = 0;
-
-    while ((conn = conn_fifo_dequeue_read(&vl->conn_tcp_read_queue)) != NULL) {
-        INCREMENT(read_count);
-        conn_tcp = conn->conn.tcp;
-
-        /* Update conn in LRU cache. */
-        if (conn_lru_cache_get(&vl->conn_tcp_lru_cache, conn->cid) == NULL) {
-            /* code error. */
-            assert(0);
-        }
-
-        /* Reset queries array */
-        for (int i = 0; i < conn_tcp->queries_count; i++) {
-            query_reset(&conn_tcp->queries[i]);
-        }
-        conn_tcp->queries_count = 0;
-
-        /* Read from socket into read buffer.  */
-        ret = read(conn->fd, &conn_tcp->read_buffer[conn_tcp->read_buffer_len],
-                   conn_tcp->read_buffer_size - conn_tcp->read_buffer_len);
-        conn_tcp->read_buffer_len += ret;
+    conn_t *conn;
+    int     count = 0;
 
-        if (ret == 0) {
-            /* Connection was closed for read.
-             * Since read is done only if there are no active queries associated
-             * with this TCP connection, meaning there are no pending writes,
-             * this means it is safe to just close fd and release the connection.
-             */
-            conn_tcp->state = TCP_CONN_ST_CLOSED_FOR_READ;
+    while ((conn = dot_pool_done(&vl->dot_pool)) != NULL) {
+        INCREMENT(count);
+        if (conn->conn.tcp->state != TCP_CONN_ST_TLS_HANDSHAKE) {
+            /* Socket was never registered with epoll, close it here. */
+            METRICS_INC(vl->metrics_vl->dot.handshake_errors);
+            close(conn->fd);
+            conn->fd = -1;
             conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
             continue;
-        } else if (ret < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                /* Need to wait for data to arrive.
-                 * If our read buffer is empty then set the state to
-                 * WAIT_FOR_QUERY with appropriate timeout matching the
-                 * tcp-keepalive.
-                 */
-                if (conn_tcp->read_buffer_len == 0) {
-                    conn_tcp->state = TCP_CONN_ST_WAIT_FOR_QUERY;
-                    conn_tcp->timeout = vl->loop_timestamp;
-                    conn_tcp->timeout.tv_sec += conn_tcp->tcp_keepalive;
-                }
-                conn->waiting_for_read = 1;
-                continue;
-            } else {
-                /* Some other error occurred on socket. End conn. */
-                conn_tcp->state = TCP_CONN_ST_READ_ERR;
-                conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
-            }
-        }
-
-        /* Data was read in, check if full DNS query is in read buffer. */
-        int            not_full_query = 0;
-        query_t       *queries        = conn_tcp->queries;
-        int            i              = 0;
-        unsigned char *buf            = conn_tcp->read_buffer;
-        size_t         buf_len        = conn_tcp->read_buffer_len;
-        uint16_t       q_len          = 0;
-        for (i = 0; i < conn_tcp->queries_size; i++) {
-            q_len = ntohs(*(uint16_t *)buf);
-            if (q_len > RIP_NS_PACKETSZ) {
-                /* Bad format, query length exceed RIP_NS_PACKETSZ (512) bytes. */
-                conn_tcp->state = TCP_CONN_ST_QUERY_SIZE_TOOLARGE;
-                conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
-            }
-
-            if ((q_len + 2) <= buf_len) {
-                /* Query present. */
-                queries[i].start_time          = vl->loop_timestamp;
-                queries[i].protocol            = 1;
-                queries[i].client_ip           = &conn_tcp->client_ip;
-                queries[i].local_ip            = &conn_tcp->local_ip;
-                queries[i].request_buffer      = buf;
-                queries[i].request_hdr         = (rip_ns_header_t *)(buf + 2);
-                queries[i].request_buffer_size = q_len;
-                queries[i].request_buffer_len  = q_len;
-                buf += 2 + q_len;
-                buf_len -= 2 + q_len;
-            } else {
-                if (i == 0) {
-                    /* Full query not received, need to wait for more data. */
-                    conn->waiting_for_read = 1;
-                    not_full_query = 1;
-                }
-                break;
-            }
-        }
-        if (not_full_query) {
-            /* Full query not received, need to read in some more. */
-            if (conn_tcp->state == TCP_CONN_ST_WAIT_FOR_QUERY) {
-                /* When TCP conn is in state WAIT_FOR_QUERY it means that the
-                 * previous idle (WAIT_FOR_QUERY) timeout applied. Since we got
-                 * data, idle timeout should now be changed to
-                 * WAIT_FOR_QUERY_DATA. Timeout for case where conn is in state
-                 * WAIT_FOR_FIRST_QUERY and state we are transitioning into are
-                 * the same, so we do not need to do anything for that case.
-                 */
-                conn_tcp->state = TCP_CONN_ST_WAIT_FOR_QUERY_DATA;
-                conn_tcp->timeout = vl->loop_timestamp;
-                conn_tcp->timeout.tv_sec += vl->cfg->tcp_query_recv_timeout;
-            }
-            conn_fifo_enqueue_read(&new_queue, conn);
-            continue;
         }
-        conn_tcp->queries_count        = i;
-        conn_tcp->queries_total_count += i;
+        METRICS_INC(vl->metrics_vl->dot.handshakes);
 
-        /* Query(s) received, move conn to parse query queue. */
-        conn_fifo_enqueue_gen(&vl->query_parse_queue, conn);
-    }
+        /* Set state and arm query receive timeout. Connection is idle until
+         * its first query data arrives.
+         */
+        vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY_DATA);
+        conn_fifo_enqueue_idle(&vl->conn_tcp_idle_queue, conn);
 
-    /* Repopulate vectorloop tcp read queue. */
-    if (new_queue.head != NULL) {
-        vl->conn_tcp_read_queue.head = new_queue.head;
-        vl->conn_tcp_read_queue.tail = new_queue.tail;
+        /* Register conn with epoll, which reports data already received. */
+        conn->waiting_for_read = 1;
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, conn->cid);
     }
 
-    return read_count;
+    return count;
 }
 
-/** Vectorloop function reads data from UDP connections.
- * 
+/** Start new TCP connection handoff period. Vectorloop publishes its load,
+ * number of queries it processed per @ref VL_HANDOFF_PERIOD_MS, and picks
+ * least loaded vectorloop as target. If its load exceeds target load by
+ * more than "tcp_handoff_threshold" percent, half of the difference is to be
+ * moved to target, so both end up at about same load.
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_handoff().
+ *
  * @param vl Vectorloop operating on.
- * 
- * @return   Returns number of UDP datagrams read in.
  */
-static int
-vl_fn_udp_read(vectorloop_t *vl)
+static void
+vl_tcp_handoff_period(vectorloop_t *vl)
 {
+    uint64_t elapsed     = vl->loop_time_ms - vl->handoff_start_ms;
+    uint64_t queries     = atomic_load_explicit(&vl->metrics_vl->udp.queries,
+                                                memory_order_relaxed) +
+                           atomic_load_explicit(&vl->metrics_vl->tcp.queries,
+                                                memory_order_relaxed);
+    uint64_t load        = (queries - vl->handoff_queries) * VL_HANDOFF_PERIOD_MS / elapsed;
+    uint64_t target_load = 0;
+
+    vl->handoff_start_ms = vl->loop_time_ms;
+    vl->handoff_queries  = queries;
+    vl_handoff_publish(vl->handoff, vl->id, load, vl->conns_tcp_active, vl->loop_time_ms);
+
+    vl->handoff_budget = 0;
+    vl->handoff_target = vl_handoff_target(vl->handoff, vl->id, vl->cfg->tcp_conns_per_vl_max,
+                                           vl->loop_time_ms, &target_load);
+    if (vl->handoff_target < 0 || load < target_load + VL_HANDOFF_LOAD_MIN ||
+        (load - target_load) * 100 <= target_load * vl->cfg->tcp_handoff_threshold) {
+        return;
+    }
+    vl->handoff_excess = (load - target_load) / 2;
+    vl->handoff_budget = VL_HANDOFF_CONNS_MAX;
+}
 
-    conn_t            *conn;
-    conn_udp_t        *conn_udp;
-    conn_fifo_queue_t  new_queue = {};
-    int                ret;    
-    int                recv_count = 0;
+/** Adopt TCP connection another vectorloop handed off, connection socket is
+ * wrapped into a connection object of this vectorloop and registered with
+ * epoll, which reports data client sent in meantime.
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_handoff().
+ *
+ * @param vl  Vectorloop operating on.
+ * @param msg Connection handed off.
+ */
+static void
+vl_tcp_conn_adopt(vectorloop_t *vl, channel_conn_msg_t *msg)
+{
+    struct sockaddr_storage client_ip;
+    struct sockaddr_storage local_ip;
+    socklen_t               ip_len = sizeof(struct sockaddr_storage);
+    conn_t                 *conn;
 
-    while ((conn = conn_fifo_dequeue_read(&vl->conn_udp_read_queue)) != NULL) {
-        conn_udp = conn->conn.udp;
+    if (getpeername(msg->fd, (struct sockaddr *)&client_ip, &ip_len) != 0) {
+        /* Client is gone already. */
+        close(msg->fd);
+        return;
+    }
+    ip_len = sizeof(struct sockaddr_storage);
+    if (getsockname(msg->fd, (struct sockaddr *)&local_ip, &ip_len) != 0) {
+        channel_log_error(vl->app_log_channel, APP_LOG_ERR_VL_FN_TCP_CONN_GETSOCKNAME, errno);
+        close(msg->fd);
+        METRICS_INC(vl->metrics_vl->tcp.getsockname_err);
+        return;
+    }
 
-        /* Reset conn UDP read, query and write vectors. */
-        conn_udp_vectors_reset(conn_udp);
+    conn = conn_pool_get_tcp(&vl->conn_tcp_pool, msg->fd, msg->ip_version,
+                             &client_ip, &local_ip);
+    conn->tls                           = msg->tls;
+    conn->conn.tcp->start_time          = msg->start_time;
+    conn->conn.tcp->queries_total_count = msg->queries_total_count;
+    conn->conn.tcp->bytes_read          = msg->bytes_read;
+    conn->conn.tcp->bytes_written       = msg->bytes_written;
+    conn->conn.tcp->tcp_keepalive       = msg->tcp_keepalive;
+
+    if (vl->conns_tcp_active >= vl->conns_tcp_max ||
+        conn_table_add(&vl->conn_tcp_table, conn) == false) {
+        /* Vectorloop took on connections of its own since it published
+         * number of connections it has.
+         */
+        close(msg->fd);
+        conn->fd = -1;
+        conn->conn.tcp->state = TCP_CONN_ST_ASSIGN_CONN_ID_ERR;
+        conn_pool_put(&vl->conn_tcp_pool, conn);
+        METRICS_INC(vl->metrics_vl->tcp.conn_id_unavailable);
+        return;
+    }
+    INCREMENT(vl->conns_tcp_active);
+    METRICS_INC(vl->metrics_vl->tcp.handoffs_in);
 
-        /* Read in packets via recvmmsg() into msg vector */
-        ret = recvmmsg(conn->fd, conn_udp->read_vector,
-                       conn_udp->vector_len, MSG_DONTWAIT, NULL);
-        if (ret > 0) {
+    /* Count connection against its client network, it is not refused as
+     * client already holds it.
+     */
+    conn_limit_acquire(&vl->conn_tcp_limit, &client_ip, true, &conn->conn.tcp->client_key);
 
-            /* UDP packets were received on UDP conn, move conn to parse
-             * DNS query queue.
-             */
-            conn_udp->read_vector_count  = ret;
-            conn_fifo_enqueue_gen(&vl->query_parse_queue, conn);
-            recv_count += ret;
-        } else {
-            /* No UDP packets were received on UDP conn. */
-            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                /* need to wait for read. */
-                conn->waiting_for_read = 1;
-            } else {
-                /* Error occurred on UDP conn. Of potential interest here is EHOSTUNREACH
-                 * (see Linux manual "man -s7 ip").
-                 * Current action is to log the error and move on.
-                 */
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "vl_fn_udp_read: UDP read error, %s", strerror(errno));
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, false);
-                channel_log_send(vl->app_log_channel, lmsg);
+    /* Set state and arm keepalive timeout. */
+    vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY);
 
-                /* Enqueue conn to read again. */
-                conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
-            }
-        }
+    /* Register conn with epoll. */
+    conn->waiting_for_read = 1;
+    vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, conn->cid);
+}
+
+/** Hand off idle TCP connection to vectorloop picked as target this period,
+ * if connection load does not exceed load left to move. Connection load is
+ * its average number of queries per @ref VL_HANDOFF_PERIOD_MS, connections
+ * that sent no queries are not handed off.
+ *
+ * Connection must have no queries in progress nor data buffered, as only its
+ * socket and state listed in @ref channel_conn_msg_t are handed off. Socket is
+ * deregistered from epoll and connection object is released without closing
+ * it.
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_read().
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection.
+ *
+ * @return     Returns true if connection was handed off.
+ */
+static bool
+vl_tcp_conn_handoff(vectorloop_t *vl, conn_t *conn)
+{
+    conn_tcp_t        *conn_tcp = conn->conn.tcp;
+    uint64_t           age_ms   = 0;
+    uint64_t           load     = 0;
+    channel_conn_msg_t msg;
+
+    if (vl->handoff_budget == 0 || conn_tcp->queries_total_count == 0) {
+        return false;
+    }
+    age_ms = (utl_timespec_to_ns(&vl->loop_timestamp) -
+              utl_timespec_to_ns(&conn_tcp->start_time)) / 1000000;
+    if (age_ms < VL_HANDOFF_PERIOD_MS) {
+        age_ms = VL_HANDOFF_PERIOD_MS;
+    }
+    load = conn_tcp->queries_total_count * VL_HANDOFF_PERIOD_MS / age_ms;
+    if (load == 0 || load > vl->handoff_excess) {
+        return false;
     }
 
-    /* Repopulate vectorloop udp read queue. */
-    if (new_queue.head != NULL) {
-        vl->conn_udp_read_queue.head = new_queue.head;
-        vl->conn_udp_read_queue.tail = new_queue.tail;
+    msg = (channel_conn_msg_t) {
+        .fd                  = conn->fd,
+        .ip_version          = conn->ip_version,
+        .tls                 = conn->tls,
+        .tcp_keepalive       = conn_tcp->tcp_keepalive,
+        .queries_total_count = conn_tcp->queries_total_count,
+        .bytes_read          = conn_tcp->bytes_read,
+        .bytes_written       = conn_tcp->bytes_written,
+        .start_time          = conn_tcp->start_time,
+    };
+    vl_epoll_ctl_del(vl->ep_fd, conn->fd);
+    if (!vl_handoff_send(vl->handoff, vl->id, vl->handoff_target, &msg)) {
+        /* Channel is full, target has not caught up yet. */
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, conn->cid);
+        vl->handoff_budget = 0;
+        return false;
     }
+    vl_handoff_wake(vl->handoff, vl->handoff_target);
+    METRICS_INC(vl->metrics_vl->tcp.handoffs_out);
 
-    return recv_count;
+    vl->handoff_excess -= load;
+    DECREMENT(vl->handoff_budget);
+
+    conn->fd        = -1;
+    conn_tcp->state = TCP_CONN_ST_HANDED_OFF;
+    conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
+    return true;
 }
 
-/** Vectorloop function parses newly received queries.
- * 
+/** Vectorloop function for TCP connection handoff. Starts new handoff period
+ * once @ref VL_HANDOFF_PERIOD_MS elapsed, and adopts TCP connections other
+ * vectorloops handed off to this one.
+ *
  * @param vl Vectorloop operating on.
+ *
+ * @return   Returns number of TCP connections adopted.
  */
-static void
-vl_fn_query_parse(vectorloop_t *vl)
+static int
+vl_fn_tcp_handoff(vectorloop_t *vl)
 {
-    conn_t         *conn;
-    struct mmsghdr *read_vector;
-    unsigned int    read_vector_count;
-    struct mmsghdr *write_vector;
-    query_t        *queries;
+    channel_conn_msg_t msgs[VL_HANDOFF_CONNS_MAX];
+    size_t             count   = 0;
+    int                adopted = 0;
 
-    while ((conn = conn_fifo_dequeue_gen(&vl->query_parse_queue)) != NULL) {
-        if (conn->proto == 0) {
-            /* UDP conn. */
-            read_vector       = conn->conn.udp->read_vector;
-            read_vector_count = conn->conn.udp->read_vector_count;
-            queries           = conn->conn.udp->queries;
-            write_vector      = conn->conn.udp->write_vector;
-
-            for (int i = 0; i < read_vector_count; i++) {
-                /* check request size. */
-                if (read_vector[i].msg_len > RIP_NS_PACKETSZ) {
-                    /* Request exceeds allowed RIP_NS_PACKETSZ size. */
-                    queries[i].end_code = rip_ns_r_rip_toolarge;
-                    continue;
-                }
-                /* Extract destination (local) IP from message control header.
-                 * Populate extracted destination IP & port in 
-                 * query structure local_ip field.
-                 */
-                for ( /* iterate through all the control headers */
-                    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&read_vector[i].msg_hdr);
-                    cmsg != NULL;
-                    cmsg = CMSG_NXTHDR(&read_vector[i].msg_hdr, cmsg)) {
-
-                    if (conn->ip_version == 0) {
-                        /* IPv4 */
-                        /* Ignore the control headers that don't match what we want */
-                        if (cmsg->cmsg_level != IPPROTO_IP ||
-                            cmsg->cmsg_type != IP_PKTINFO) {
-                            continue;
-                        }
-                        
-                        struct in_pktinfo *pi = (struct in_pktinfo *)CMSG_DATA(cmsg);
-                        /* At this point:
-                         * pi->ipi_spec_dst is the destination in_addr
-                         * pi->ipi_addr is the receiving interface in_addr
-                         */
-                        struct sockaddr_in *sin = (struct sockaddr_in *)queries[i].local_ip;
-                        sin->sin_family = AF_INET;
-                        sin->sin_addr = pi->ipi_spec_dst;
-                        sin->sin_port = htons(vl->cfg->udp_listener_port);
-                        
-                    } else {
-                        /* IPv6 */
-                        /* Ignore the control headers that don't match what we want */
-                        if (cmsg->cmsg_level != IPPROTO_IPV6 ||
-                            cmsg->cmsg_type != IPV6_PKTINFO) {
-                            continue;
-                        }
-                        struct in6_pktinfo *pi6 = (struct in6_pktinfo *)CMSG_DATA(cmsg);
-                        /* At this point:
-                         * pi->ipi6_addr is the destination in_addr
-                         */
-                        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)queries[i].local_ip;
-                        sin6->sin6_family = AF_INET6;
-                        sin6->sin6_addr = pi6->ipi6_addr;
-                        sin6->sin6_port = htons(vl->cfg->udp_listener_port);
-                    }
-                }
+    if (vl->loop_time_ms - vl->handoff_start_ms >= VL_HANDOFF_PERIOD_MS) {
+        vl_tcp_handoff_period(vl);
+    }
 
-                /* Extract source ip from message msg_name field. */
-                memcpy(queries[i].client_ip, read_vector[i].msg_hdr.msg_name,
-                       read_vector[i].msg_hdr.msg_namelen);
+    while ((count = vl_handoff_recv(vl->handoff, vl->id, msgs, VL_HANDOFF_CONNS_MAX)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            vl_tcp_conn_adopt(vl, &msgs[i]);
+        }
+        adopted += count;
+    }
 
-                /* Populate write vector with source & destination IPs. */
-                write_vector[i].msg_hdr.msg_control = read_vector[i].msg_hdr.msg_control;
-                write_vector[i].msg_hdr.msg_controllen = read_vector[i].msg_hdr.msg_controllen;
-                write_vector[i].msg_hdr.msg_name = read_vector[i].msg_hdr.msg_name;
-                write_vector[i].msg_hdr.msg_namelen = read_vector[i].msg_hdr.msg_namelen;
+    return adopted;
+}
 
-                /* Set query start time. */
-                queries[i].start_time = vl->loop_timestamp;
-        
-                /* Parse DNS query from datagram. */
-                queries[i].request_buffer_len = read_vector[i].msg_len;
-                query_parse(&queries[i]);
-            }
-        } else {
-            /* TCP protocol. */
-            for (int i = 0; i < conn->conn.tcp->queries_count; i++) {
-                query_parse(&conn->conn.tcp->queries[i]);
-            }
+/** Count complete DNS messages (2 byte length prefix followed by message)
+ * buffered in TCP connection read buffer, up to number of queries connection
+ * can process at once.
+ *
+ * @param conn_tcp TCP connection.
+ *
+ * @return         Returns number of complete messages buffered, -1 if a
+ *                 message exceeding RIP_NS_PACKETSZ precedes them.
+ */
+static int
+vl_tcp_frames_complete(conn_tcp_t *conn_tcp)
+{
+    unsigned char *buf     = &conn_tcp->read_buffer[conn_tcp->read_buffer_offset];
+    size_t         buf_len = conn_tcp->read_buffer_len;
+    uint16_t       q_len   = 0;
+    int            count   = 0;
+
+    while ((size_t)count < conn_tcp->queries_size && buf_len >= 2) {
+        q_len = ntohs(*(uint16_t *)buf);
+        if (q_len > RIP_NS_PACKETSZ) {
+            return -1;
         }
-        /* All queries for conn parsed, send conn to resolve query queue. */
-        conn_fifo_enqueue_gen(&vl->query_resolve_queue, conn);
+        if ((size_t)q_len + 2 > buf_len) {
+            break;
+        }
+        buf     += 2 + q_len;
+        buf_len -= 2 + q_len;
+        INCREMENT(count);
     }
+
+    return count;
 }
 
-/** Vectorloop function resolves newly parsed queries.
- * 
- * @param vl Vectorloop operating on.
+/** Set SO_RCVLOWAT of TCP connection waiting for read to number of bytes
+ * rest of a partially received query needs, so epoll reports connection
+ * readable once query is complete rather than on every segment of it. Low
+ * water mark is capped by room left in read buffer, and is set back to 1
+ * byte once connection has no partial query buffered. Socket option is only
+ * set when value changes. Kernel TLS connections are left at default, their
+ * readability is per TLS record.
+ *
+ * @param conn TCP connection.
  */
 static void
-vl_fn_query_resolve(vectorloop_t *vl)
+vl_tcp_rcvlowat_update(conn_t *conn)
 {
-    conn_t       *conn;
-    unsigned int  read_vector_count;
-    query_t      *queries;
-
-    while ((conn = conn_fifo_dequeue_gen(&vl->query_resolve_queue)) != NULL) {
-        if (conn->proto == 0) {
-            /* UDP conn. */
-            conn_udp_t *conn_udp = conn->conn.udp;
-
-            read_vector_count = conn_udp->read_vector_count;
-            queries           = conn_udp->queries;
-            for (int i = 0; i < read_vector_count; i++) {
-                if (queries[i].end_code != -1) {
-                    /* End code for query is already set, meaning request
-                     * did not pass query_parse() checks.
-                     */
-                    continue;
-                }
-                query_resolve(&queries[i]);
-            }
-            /* All queries for conn resolved, send conn to response pack queue. */
-            conn_fifo_enqueue_gen(&vl->query_response_pack_queue, conn);
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
+    size_t      len      = conn_tcp->read_buffer_len;
+    size_t      need     = 0;
+    size_t      room     = 0;
+    int         lowat    = 0;
+
+    if (conn->tls) {
+        return;
+    }
+    if (len > 0 && conn_tcp->read_buffer != NULL) {
+        /* Until length prefix is in, a query is at least a DNS header. */
+        need = len < 2 ? 2 + sizeof(rip_ns_header_t) - len :
+               2 + ntohs(*(uint16_t *)&conn_tcp->read_buffer[conn_tcp->read_buffer_offset]) - len;
+        room = conn_tcp->read_buffer_size - conn_tcp->read_buffer_offset - len;
+        if (need > room) {
+            need = room;
+        }
+        lowat = need > 1 ? (int)need : 0;
+    }
+    if (lowat == conn_tcp->rcvlowat) {
+        return;
+    }
+    conn_tcp->rcvlowat = lowat;
+    lowat = lowat > 0 ? lowat : 1;
+    setsockopt(conn->fd, SOL_SOCKET, SO_RCVLOWAT, &lowat, sizeof(lowat));
+}
 
-        } else {
-            /* TCP */
-            conn_tcp_t *conn_tcp = conn->conn.tcp;
+/** Read from TCP connection socket. With "listener_rx_timestamps" set data
+ * is read with recvmsg(), and kernel receive timestamp of data read is kept
+ * as connection receive time queries framed take. DNS over TLS connections
+ * are always read with read(), kernel TLS returns record type control message
+ * to recvmsg() rather than failing read on a non application data record.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection to read from.
+ * @param buf  Buffer to read into.
+ * @param len  Length of buffer.
+ *
+ * @return     Returns what read() would.
+ */
+static ssize_t
+vl_tcp_read(vectorloop_t *vl, conn_t *conn, unsigned char *buf, size_t len)
+{
+    union {
+        char           buf[CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } control;
+    struct iovec  iov = { .iov_base = buf, .iov_len = len };
+    struct msghdr msg = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    ssize_t       ret;
 
-            queries = conn_tcp->queries;
-            for (int i = 0; i < conn_tcp->queries_count; i++) {
-                if (queries[i].end_code != -1) {
-                    /* End code for query is already set, meaning request
-                     * did not pass query_parse() checks.
-                     */
-                    continue;
-                }
-                query_resolve(&queries[i]);
+    if (!vl->cfg->listener_rx_timestamps || conn->tls) {
+        ret = read(conn->fd, buf, len);
+        if (ret > 0) {
+            conn->conn.tcp->bytes_read += ret;
+        }
+        return ret;
+    }
+    ret = recvmsg(conn->fd, &msg, 0);
+    if (ret > 0) {
+        conn->conn.tcp->bytes_read += ret;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                memcpy(&conn->conn.tcp->rx_time, CMSG_DATA(cmsg), sizeof(struct timespec));
             }
-            /* All queries for conn resolved, send conn to pack query queue. */  
-            conn_fifo_enqueue_gen(&vl->query_response_pack_queue, conn);
         }
     }
+    return ret;
 }
 
-/** Pack query response into buffer suitable to be transmitted over network.
- * 
- * @param vl Vectorloop operating on.
+/** What TCP connection read coroutine returned, which tells
+ * @ref vl_fn_tcp_read() where connection goes next.
  */
-static void
-vl_fn_query_response_pack(vectorloop_t *vl)
-{
-    conn_t       *conn;
-    unsigned int  read_vector_count;
-    query_t      *queries;
+typedef enum vl_tcp_read_e {
+    /** Queries were framed, connection goes to query parse queue. */
+    VL_TCP_READ_QUERIES = 0,
 
-    while ((conn = conn_fifo_dequeue_gen(&vl->query_response_pack_queue)) != NULL) {
-        if (conn->proto == 0) {
-            /* UDP conn. */
-            conn_udp_t *conn_udp = conn->conn.udp;
+    /** Connection waits for epoll to report it readable. */
+    VL_TCP_READ_WAIT,
 
-            read_vector_count = conn_udp->read_vector_count;
-            queries           = conn_udp->queries;
-            for (int i = 0; i < read_vector_count; i++) {
-                if (queries[i].end_code >= 0) {
-                    query_response_pack(&queries[i]);
-                }
-                /* else query has a custom end_code indicating that no
-                 * response is to be sent.
-                 */
-            }
-            /* All queries for conn parsed, send conn to UDP write query queue. */
-            conn_fifo_enqueue_write(&vl->conn_udp_write_queue, conn);
+    /** Part of a query was read, connection is read again next iteration. */
+    VL_TCP_READ_AGAIN,
 
-        } else {
-            /* TCP */
-            conn_tcp_t *conn_tcp = conn->conn.tcp;
+    /** Connection ended, its state tells why, it goes to release queue. */
+    VL_TCP_READ_RELEASE,
 
-            queries = conn_tcp->queries;
-            for (int i = 0; i < conn_tcp->queries_count; i++) {
-                if (queries[i].end_code >= 0) {
-                    query_response_pack(&queries[i]);
-                }
-                /* else query has a custom end_code indicating that no
-                 * response is to be sent.
-                 */
-            }
-            /* All queries for conn parsed, send conn to TCP write query queue. */
-            conn_tcp->state           = TCP_CONN_ST_WAIT_FOR_WRITE;
-            conn_tcp->timeout         = vl->loop_timestamp;
-            conn_tcp->timeout.tv_sec += vl->cfg->tcp_query_send_timeout;
-            conn_fifo_enqueue_write(&vl->conn_tcp_write_queue, conn);
-        }
-    }
-}
+    /** Connection was handed off to another vectorloop. */
+    VL_TCP_READ_HANDED_OFF,
+} vl_tcp_read_t;
 
-/** Vectorloop function sends responses to resolved queries.
- * 
- * @param vl Vectorloop operating on.
+/** TCP connection read coroutine, see @ref coroutine. It reads from
+ * connection until at least one query is complete, frames complete queries
+ * in place and yields them to query parse. Once they are answered and logged
+ * connection is queued for read again, and coroutine resumes to reset them
+ * and read next ones.
+ *
+ * Read buffer works as a sliding window: queries are framed in place
+ * starting at read_buffer_offset, and consumed bytes are only moved to start
+ * of buffer when space after buffered data can no longer hold a full size
+ * query. A connection that has a full set of queries (tcp_conn_simultaneous_
+ * queries_count) already buffered, left over from what pipelining client sent
+ * earlier, is dispatched without reading from socket, and read returning no
+ * data does not hold back complete queries that are buffered.
+ *
+ * Connection takes a buffer set from connection pool when it is read from,
+ * and hands it back once it is idle with nothing buffered, see
+ * @ref conn_pool_bufs_get() and @ref conn_pool_bufs_put(). Connection left
+ * waiting for rest of a query has its receive low water mark set to what
+ * query needs, see @ref vl_tcp_rcvlowat_update().
+ *
+ * @note This is a helper function for @ref vl_fn_tcp_read().
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection.
+ *
+ * @return     Returns where connection goes next, see @ref vl_tcp_read_t.
  */
-static int
-vl_fn_tcp_write(vectorloop_t *vl)
+static vl_tcp_read_t
+vl_tcp_read_co(vectorloop_t *vl, conn_t *conn)
 {
-    conn_t           *conn;
-    conn_tcp_t       *conn_tcp  = NULL;
-    size_t            write_len = 0;
-    ssize_t           ret       = 0;
-    bool              done      = false;
-    conn_fifo_queue_t new_queue = {};
-    int               count     = 0;
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
+    ssize_t     ret      = 0;
+    int         frames   = 0;
+
+    CO_BEGIN(&conn_tcp->read_co);
+    while (1) {
+        /* Read until at least one query is complete. */
+        while (1) {
+            /* Idle connection holds no buffers, take a buffer set to read
+             * into.
+             */
+            conn_pool_bufs_get(&vl->conn_tcp_pool, conn);
 
-    while ((conn = conn_fifo_dequeue_write(&vl->conn_tcp_write_queue)) != NULL) {
-        conn_tcp = conn->conn.tcp;
-        done     = false;
+            frames = vl_tcp_frames_complete(conn_tcp);
+            if (frames < 0) {
+                /* Bad format, query length exceed RIP_NS_PACKETSZ (512) bytes. */
+                conn_tcp->state = TCP_CONN_ST_QUERY_SIZE_TOOLARGE;
+                CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_RELEASE);
+            }
+            if ((size_t)frames >= conn_tcp->queries_size) {
+                break;
+            }
 
-        for (int i = conn_tcp->query_write_index; i < conn_tcp->queries_count; i++) {
-            query_t *query = &conn_tcp->queries[i];
-            INCREMENT(count);
-            if (query->end_code >= 0) {
-                write_len = query->response_buffer_len - conn_tcp->write_index;
-                ret =  write(conn->fd,
-                             &query->response_buffer[conn_tcp->write_index],
-                              write_len);
-
-                if (ret == write_len) {
-                    /* Full query written. */
-                    utl_clock_gettime_rt_fatal(&query->end_time);
-                    conn_tcp->write_index = 0;
-                    continue;
+            /* Move buffered data to start of buffer if there is no room left
+             * after it for a full size query.
+             */
+            size_t tail = conn_tcp->read_buffer_size - conn_tcp->read_buffer_offset -
+                          conn_tcp->read_buffer_len;
+            if (conn_tcp->read_buffer_offset > 0 && tail < 2 + RIP_NS_PACKETSZ) {
+                memmove(conn_tcp->read_buffer,
+                        &conn_tcp->read_buffer[conn_tcp->read_buffer_offset],
+                        conn_tcp->read_buffer_len);
+                conn_tcp->read_buffer_offset = 0;
+            }
+
+            /* Read from socket into read buffer.  */
+            ret = vl_tcp_read(vl, conn,
+                              &conn_tcp->read_buffer[conn_tcp->read_buffer_offset +
+                                                     conn_tcp->read_buffer_len],
+                              conn_tcp->read_buffer_size - conn_tcp->read_buffer_offset -
+                              conn_tcp->read_buffer_len);
+
+            if (ret < 0 && errno == EIO && conn->tls) {
+                /* Kernel TLS fails read on a record that is not application
+                 * data, such as close_notify alert DoT client sends before
+                 * it closes connection, treat it as end of data.
+                 */
+                ret = 0;
+            }
+
+            if (ret > 0) {
+                /* Connection with data to process is no longer idle. */
+                conn_fifo_remove_from_idle_queue(&vl->conn_tcp_idle_queue, conn);
+                conn_tcp->read_buffer_len += ret;
+                frames = vl_tcp_frames_complete(conn_tcp);
+                if (frames < 0) {
+                    conn_tcp->state = TCP_CONN_ST_QUERY_SIZE_TOOLARGE;
+                    CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_RELEASE);
                 }
-                if (ret > 0) {
-                    /* Partial write. Enqueue conn to try again next vector loop. */
-                    conn_tcp->write_index      += ret;
-                    conn_tcp->query_write_index = i;
-                    conn_fifo_enqueue_write(&new_queue, conn);
-                    done = true; /* Don't enqueue to query log queue */
-                } else if (ret < 0) {
-                    if (ret == EAGAIN || ret == EWOULDBLOCK) {
-                        /* Need to wait for epoll to tell us when we can write again. */
-                        done = true; /* Don't enqueue to query log queue */
-                    } else {
-                        /* Some unrecoverable error occurred. Could be that far 
-                         * end closed (reset) connection before we had a chance
-                         * to send everything.
-                         */
-                        query->end_code = rip_ns_r_rip_tcp_write_err;
-                        conn_tcp->state = TCP_CONN_ST_WRITE_ERR;
-                        utl_clock_gettime_rt_fatal(&conn_tcp->end_time);
-                    }
-                } else {
-                    /* ret == 0, connection was closed before we had a chance
-                     * to send back the response.
+                if (frames > 0) {
+                    break;
+                }
+
+                /* Full query not received, need to read in some more. */
+                if (conn_tcp->state == TCP_CONN_ST_WAIT_FOR_QUERY) {
+                    /* When TCP conn is in state WAIT_FOR_QUERY it means that
+                     * the previous idle (WAIT_FOR_QUERY) timeout applied.
+                     * Since we got data, idle timeout should now be changed
+                     * to WAIT_FOR_QUERY_DATA. Timeout for case where conn is
+                     * in state WAIT_FOR_FIRST_QUERY and state we are
+                     * transitioning into are the same, so we do not need to
+                     * do anything for that case.
                      */
-                    query->end_code = rip_ns_r_rip_tcp_write_close;
-                    conn_tcp->state = TCP_CONN_ST_CLOSED_FOR_WRITE;
-                    utl_clock_gettime_rt_fatal(&conn_tcp->end_time);
+                    vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY_DATA);
                 }
+                conn->waiting_for_read = 1;
+                CO_YIELD(&conn_tcp->read_co, VL_TCP_READ_AGAIN);
+                continue;
+            }
+
+            if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                /* Some other error occurred on socket. End conn. */
+                conn_tcp->state = TCP_CONN_ST_READ_ERR;
+                CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_RELEASE);
+            }
+            if (frames > 0) {
+                /* Nothing more to read, answer queries that are buffered. */
                 break;
             }
+            if (ret == 0) {
+                /* Connection was closed for read.
+                 * Since read is done only if there are no active queries
+                 * associated with this TCP connection, meaning there are no
+                 * pending writes, this means it is safe to just close fd and
+                 * release the connection.
+                 */
+                conn_tcp->state = TCP_CONN_ST_CLOSED_FOR_READ;
+                CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_RELEASE);
+            }
+
+            /* Need to wait for data to arrive. If our read buffer is empty
+             * then set the state to WAIT_FOR_QUERY with appropriate timeout
+             * matching the tcp-keepalive.
+             */
+            if (conn_tcp->read_buffer_len == 0 && vl->draining) {
+                /* Vectorloop is draining, close idle connection so client
+                 * reconnects, to new process on upgrade.
+                 */
+                conn_tcp->state = TCP_CONN_ST_DRAINED;
+                CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_RELEASE);
+            }
+            if (conn_tcp->read_buffer_len == 0 &&
+                vl->handoff != NULL && vl_tcp_conn_handoff(vl, conn)) {
+                /* Idle connection handed off to less loaded vectorloop. */
+                CO_RETURN(&conn_tcp->read_co, VL_TCP_READ_HANDED_OFF);
+            }
+            if (conn_tcp->read_buffer_len == 0) {
+                if (conn_tcp->state != TCP_CONN_ST_WAIT_FOR_QUERY) {
+                    vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY);
+                }
+                /* Idle connection hands its buffers back until epoll
+                 * reports it readable again.
+                 */
+                conn_pool_bufs_put(&vl->conn_tcp_pool, conn);
+            }
+            vl_tcp_rcvlowat_update(conn);
+            conn->waiting_for_read = 1;
+            CO_YIELD(&conn_tcp->read_co, VL_TCP_READ_WAIT);
         }
-        if (done == true) {
-            continue;
+
+        /* Frame complete queries in place. */
+        query_t       *queries = conn_tcp->queries;
+        unsigned char *buf     = &conn_tcp->read_buffer[conn_tcp->read_buffer_offset];
+        uint16_t       q_len   = 0;
+        for (int i = 0; i < frames; i++) {
+            q_len = ntohs(*(uint16_t *)buf);
+            queries[i].start_time          = conn_tcp->rx_time.tv_sec != 0 ?
+                                             conn_tcp->rx_time : vl->loop_timestamp;
+            queries[i].protocol            = 1;
+            queries[i].client_ip           = &conn_tcp->client_ip;
+            queries[i].local_ip            = &conn_tcp->local_ip;
+            queries[i].request_buffer      = buf;
+            queries[i].request_hdr         = (rip_ns_header_t *)(buf + 2);
+            queries[i].request_buffer_size = q_len;
+            queries[i].request_buffer_len  = q_len;
+            buf += 2 + q_len;
         }
+        conn_tcp->queries_count        = frames;
+        conn_tcp->queries_total_count += frames;
 
-        /* Move conn to log queue. */
-        conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
-    }
+        /* Query(s) received, resumed once they are answered and logged, see
+         * @ref vl_fn_query_log().
+         */
+        CO_YIELD(&conn_tcp->read_co, VL_TCP_READ_QUERIES);
 
-    /* Requeue any connections back into TCP write queue. */
-    if (new_queue.head != NULL) {
-        vl->conn_tcp_write_queue.head = new_queue.head;
-        vl->conn_tcp_write_queue.tail = new_queue.head;
+        /* Reset queries array */
+        for (int i = 0; i < conn_tcp->queries_count; i++) {
+            query_reset(&conn_tcp->queries[i]);
+        }
+        conn_tcp->queries_count = 0;
     }
+    CO_END(&conn_tcp->read_co);
 
-    return count;
+    /* Not reached, coroutine reads connection until it ends. */
+    return VL_TCP_READ_RELEASE;
 }
 
-/** Vectorloop function that writes DNS query responses on UDP connections.
+/** Vectorloop function reads data from TCP connections.
+ *
+ * Each connection dequeued from read queue resumes its read coroutine, see
+ * @ref vl_tcp_read_co(), and is moved to queue of next stage it returned.
+ *
+ * Number of connections read from is limited to configuration setting
+ * "loop_budget_tcp_reads", connections not read from are left in read queue
+ * for next vectorloop iteration.
  * 
  * @param vl Vectorloop operating on.
  * 
- * @return   Returns number of UDP queries responses sent.
+ * @return   Returns number of TCP connections data was read in from.
  */
 static int
-vl_fn_udp_write(vectorloop_t *vl)
+vl_fn_tcp_read(vectorloop_t *vl)
 {
-    conn_t           *conn;
-    conn_udp_t       *conn_udp            = NULL;
-    int               ret                 = 0;
-    struct mmsghdr   *read_vector         = NULL;
-    struct mmsghdr   *write_vector        = NULL;
-    unsigned int      write_vector_count  = 0;
-    query_t          *queries             = NULL;
-    conn_fifo_queue_t new_queue           = {};
+    conn_t            *conn;
+    conn_fifo_queue_t new_queue = {};
+    int               read_count = 0;
+    size_t            budget     = vl->cfg->loop_budget_tcp_reads;
 
-    while ((conn = conn_fifo_dequeue_write(&vl->conn_udp_write_queue)) != NULL) {
-        conn_udp     = conn->conn.udp;
-        read_vector  = conn_udp->read_vector;
-        write_vector = conn_udp->write_vector;
-        queries      = conn_udp->queries;
-
-        /* Populate write vector from queries. */
-        for (int i = 0; i < conn_udp->read_vector_count; i++) {
-            if (queries[i].end_code > -1) {
-                struct msghdr *msg_hdr = &write_vector[write_vector_count].msg_hdr;
-
-                msg_hdr->msg_control       = read_vector[i].msg_hdr.msg_control;
-                msg_hdr->msg_controllen    = read_vector[i].msg_hdr.msg_controllen;
-                msg_hdr->msg_flags         = 0;
-                msg_hdr->msg_iov->iov_base = queries[i].response_buffer;
-                msg_hdr->msg_iov->iov_len  = queries[i].response_buffer_len;
-                msg_hdr->msg_name          = read_vector[i].msg_hdr.msg_name;
-                msg_hdr->msg_namelen       = read_vector[i].msg_hdr.msg_namelen;
-                write_vector_count += 1;
-            }
-        }
-        conn_udp->write_vector_count = write_vector_count;
-
-        ret = sendmmsg(conn->fd,
-                       &write_vector[conn_udp->write_vector_write_index],
-                       write_vector_count,
-                       0);
-
-        /* Set query end time */
-        if (ret > 0) {
-            struct timespec ts;
-            utl_clock_gettime_rt_fatal(&ts);
-            unsigned int index = conn_udp->write_vector_write_index;
-            for (int i = 0; i < ret; i++) {
-                queries[index + i].end_time = ts;
+    while ((budget == 0 || read_count < budget) &&
+           (conn = conn_fifo_dequeue_read(&vl->conn_tcp_read_queue)) != NULL) {
+        INCREMENT(read_count);
+
+        switch (vl_tcp_read_co(vl, conn)) {
+        case VL_TCP_READ_QUERIES:
+            conn_fifo_enqueue_gen(&vl->query_parse_queue, conn);
+            break;
+        case VL_TCP_READ_AGAIN:
+            conn_fifo_enqueue_read(&new_queue, conn);
+            break;
+        case VL_TCP_READ_RELEASE:
+            conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
+            break;
+        case VL_TCP_READ_WAIT:
+        case VL_TCP_READ_HANDED_OFF:
+            break;
+        }
+    }
+
+    /* Repopulate vectorloop tcp read queue, after connections that were not
+     * read from.
+     */
+    while ((conn = conn_fifo_dequeue_read(&new_queue)) != NULL) {
+        conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
+    }
+
+    return read_count;
+}
+
+/** Check whether AF_XDP listener keeps being polled when its receive ring is
+ * empty. Busy polling listener is, until vectorloop has been idle for
+ * "loop_idle_spin", after which it waits for epoll like other listeners, and
+ * receive queue interrupts take over.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns true if AF_XDP listener is to be read again next
+ *           iteration, false if it is to wait for epoll.
+ */
+static bool
+vl_xdp_busy(vectorloop_t *vl)
+{
+    if (!vl->xdp.busy_poll) {
+        return false;
+    }
+    return vl->idle_count == 0 ||
+           utl_clock_monotonic_us_fatal() - vl->idle_start_us < vl->cfg->loop_idle_spin;
+}
+
+/** Have UDP listener wait for one of its batches to become free. Listener
+ * bound to an address other than first of its IP family waits in vectorloop
+ * batch wait queue, see @ref vl_udp_batch_release().
+ *
+ * @note This is a helper function for @ref vl_fn_udp_read().
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn UDP listener.
+ */
+static void
+vl_udp_batch_wait(vectorloop_t *vl, conn_t *conn)
+{
+    conn->conn.udp->waiting_for_batch = 1;
+    if (conn->conn.udp->listener != conn) {
+        conn_fifo_enqueue_gen(&vl->conn_udp_batch_wait_queue, conn);
+    }
+}
+
+/** Move batch UDP datagrams were received into to query parse queue, and
+ * adapt listener vector length to how full batch is.
+ *
+ * @note This is a helper function for @ref vl_fn_udp_read().
+ *
+ * @param vl       Vectorloop operating on.
+ * @param listener UDP listener batch belongs to.
+ * @param batch    Batch received into.
+ * @param vlen     Number of datagrams batch was to receive.
+ * @param received Number of datagrams batch received.
+ */
+static void
+vl_udp_batch_received(vectorloop_t *vl, conn_t *listener, conn_t *batch,
+                      unsigned int vlen, unsigned int received)
+{
+    conn_udp_t *conn_udp = listener->conn.udp;
+
+    if (vl->cfg->overload_iteration_max > 0) {
+        vl_overload_read(&vl->overload,
+                         received >= vlen && (vlen < conn_udp->vector_len_active ||
+                                              vlen >= conn_udp->vector_len_max));
+    }
+    conn_udp_vector_len_adapt(conn_udp, vlen, received);
+    conn_fifo_enqueue_gen(&vl->query_parse_queue, batch);
+}
+
+/** Vectorloop function reads data from UDP connections.
+ *
+ * Listener reads into its first free batch, which then goes through query
+ * parse and on, see @ref conn_udp_t. Listener with batches left free is
+ * queued to read again next iteration, otherwise it waits for a batch to be
+ * freed by @ref vl_fn_query_log.
+ *
+ * Listeners bound to addresses of configuration setting
+ * "udp_listener_addresses" share batches of first listener of their IP
+ * family and listener profile, and a batch is filled from as many of them as are readable before
+ * it goes to query parse, so batches stay full however many addresses
+ * queries are spread over.
+ *
+ * Number of datagrams read in is limited to configuration setting
+ * "loop_budget_udp_datagrams", connections not read from are left in read
+ * queue for next vectorloop iteration.
+ *
+ * With "udp_mirror_ip" configured datagrams read in are mirrored to shadow
+ * server, sent from request buffers with one sendmmsg() call once reading is
+ * done, see @ref vlmirror.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of UDP datagrams read in.
+ */
+static int
+vl_fn_udp_read(vectorloop_t *vl)
+{
+
+    conn_t            *conn;
+    conn_t            *listener;
+    conn_t            *batch;
+    conn_t            *filling[2][LISTENER_PROFILES_MAX + 1] = {};
+    conn_udp_t        *conn_udp;
+    conn_fifo_queue_t  new_queue = {};
+    int                ret;    
+    int                recv_count = 0;
+    size_t             budget     = vl->cfg->loop_budget_udp_datagrams;
+    unsigned int       vlen       = 0;
+    unsigned int       offset     = 0;
+    bool               shared     = false;
+
+    while ((budget == 0 || recv_count < budget) &&
+           (conn = conn_fifo_dequeue_read(&vl->conn_udp_read_queue)) != NULL) {
+        /* Listener bound to an address receives into batch being filled
+         * by listeners of its IP family, if there is one.
+         */
+        listener = conn->conn.udp->listener;
+        shared   = listener->conn.udp->read_socket != NULL;
+        batch    = shared ? filling[conn->ip_version][listener->profile] : NULL;
+        if (batch == NULL) {
+            batch = conn_udp_batch_free(listener);
+            if (batch == NULL) {
+                /* All batches hold queries, listener is queued to read again
+                 * once one is freed.
+                 */
+                vl_udp_batch_wait(vl, conn);
+                if (vl->cfg->overload_iteration_max > 0) {
+                    vl_overload_read(&vl->overload, true);
+                }
+                continue;
             }
+
+            /* Reset batch UDP read, query and write vectors. */
+            conn_udp_vectors_reset(batch->conn.udp);
         }
+        conn_udp = batch->conn.udp;
+        offset   = conn_udp->read_vector_count;
 
-        if (ret == write_vector_count) {
-            /* All messages sent out, move conn to log queue. */
-            conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
-        } else if (ret < 0) {
-            /* Error sending.*/
-            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                /* Need to wait for writable. When epoll event that this conn
-                 * is writable arrives, this conn will be put back into
-                 * conn_udp_write_queue so queries could be sent.
+        /* Vector length is adapted per listener, not per batch. */
+        vlen = listener->conn.udp->vector_len_active - offset;
+        if (budget > 0 && vlen > budget - recv_count) {
+            vlen = budget - recv_count;
+        }
+
+        /* Read in packets via recvmmsg() into msg vector, from AF_XDP
+         * socket receive ring, or from replayed pcap file.
+         */
+        if (conn->replay) {
+            ret = vl_replay_recv(vl->replay, conn_udp, vlen);
+        } else if (conn->xdp) {
+            ret = vl_xdp_recv(&vl->xdp, conn_udp, vlen, vl->cfg->udp_listener_port);
+            if (ret == 0) {
+                /* Only frames that are not DNS queries were received, there
+                 * may be more to read.
                  */
-                conn->waiting_for_write = 1;
+                conn_fifo_enqueue_read(&new_queue, conn);
+                continue;
+            }
+        } else {
+            ret = recvmmsg(conn->fd, conn_udp->read_vector + offset, vlen, MSG_DONTWAIT, NULL);
+        }
+        if (ret > 0) {
+
+            /* UDP packets were received into batch, move batch to parse
+             * DNS query queue once it is filled.
+             */
+            conn_udp->read_vector_count = offset + ret;
+            histogram_record(&vl->metrics_vl->udp.recv_batch, ret);
+            if (vl->mirror.fd >= 0) {
+                vl_mirror_add(&vl->mirror, conn_udp->read_vector + offset, ret);
+            }
+            if (offset == 0) {
+                conn_udp_batch_hold(batch);
+            }
+            if (!shared) {
+                vl_udp_batch_received(vl, listener, batch, vlen, ret);
             } else {
-                /* UDP write error occurred. */
-                char *err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-                CHECK_MALLOC(err_str);
-                snprintf(err_str, ERR_MSG_LENGTH, "vl_fn_udp_read: UDP write error, %s", strerror(errno));
-                channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, false);
-                channel_log_send(vl->app_log_channel, lmsg);
+                for (unsigned int i = offset; i < conn_udp->read_vector_count; i++) {
+                    conn_udp->read_socket[i] = conn;
+                }
+                if (vl->metrics_udp_addrs != NULL) {
+                    METRICS_ADD(vl->metrics_udp_addrs[conn->conn.udp->addr_index].datagrams,
+                                ret);
+                }
+                filling[conn->ip_version][listener->profile] = batch;
+                if (conn_udp->read_vector_count >= listener->conn.udp->vector_len_active) {
+                    vl_udp_batch_received(vl, listener, batch, offset + vlen,
+                                          conn_udp->read_vector_count);
+                    filling[conn->ip_version][listener->profile] = NULL;
+                }
+            }
+            recv_count += ret;
 
-                /* Put conn back into write queue. */
-                conn_fifo_enqueue_write(&new_queue, conn);
+            /* Read into next free batch next iteration. */
+            if (listener->conn.udp->batches_free > 0 ||
+                (shared && filling[conn->ip_version][listener->profile] != NULL)) {
+                conn_fifo_enqueue_read(&new_queue, conn);
+            } else {
+                vl_udp_batch_wait(vl, conn);
             }
         } else {
-            /* (ret != write_vector_count)
-             * Not all messages were sent, need to try again. Update marker
-             * where to start sending messages from and update vector count.
+            /* No UDP packets were received on UDP conn. */
+            if ((errno == EWOULDBLOCK || errno == EAGAIN) && conn->xdp && vl_xdp_busy(vl)) {
+                /* Receive ring is polled again next iteration. */
+                conn_fifo_enqueue_read(&new_queue, conn);
+            } else if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                /* need to wait for read. */
+                conn->waiting_for_read = 1;
+            } else {
+                /* Error occurred on UDP conn. Of potential interest here is EHOSTUNREACH
+                 * (see Linux manual "man -s7 ip").
+                 * Current action is to count the error, it is logged in a
+                 * periodic summary, and move on.
+                 */
+                channel_log_error(vl->app_log_channel, APP_LOG_ERR_VL_FN_UDP_READ, errno);
+
+                /* Enqueue conn to read again. */
+                conn_fifo_enqueue_read(&new_queue, conn);
+            }
+        }
+    }
+
+    /* Batches listeners bound to addresses did not fill go to query parse as
+     * they are.
+     */
+    for (int v = 0; v < 2; v++) {
+        for (size_t p = 0; p <= vl->cfg->listener_profiles_count; p++) {
+            if (filling[v][p] != NULL) {
+                listener = filling[v][p]->conn.udp->listener;
+                vl_udp_batch_received(vl, listener, filling[v][p],
+                                      listener->conn.udp->vector_len_active,
+                                      filling[v][p]->conn.udp->read_vector_count);
+            }
+        }
+    }
+
+    /* Mirror datagrams read in, before query parse touches request
+     * buffers.
+     */
+    if (vl->mirror.count > 0) {
+        vl_mirror_flush(&vl->mirror);
+        METRICS_ADD(vl->metrics_vl->udp.mirrored, vl->mirror.sent);
+        METRICS_ADD(vl->metrics_vl->udp.mirror_dropped, vl->mirror.dropped);
+        vl->mirror.sent    = 0;
+        vl->mirror.dropped = 0;
+    }
+
+    /* Repopulate vectorloop udp read queue, after connections that were not
+     * read from.
+     */
+    while ((conn = conn_fifo_dequeue_read(&new_queue)) != NULL) {
+        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+    }
+
+    return recv_count;
+}
+
+/** Check received query against client ACL, before any parsing work is
+ * done. Refused query is answered with REFUSED, its response holds request
+ * header only. Dropped query gets rip_ns_r_rip_acl_drop end code, so it is
+ * left out of write vector and nothing is packed for it. Query of
+ * allowlisted client is put in priority lane, see @ref query_t.priority.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Received query, with client address set.
+ *
+ * @return   Returns true if query is to be parsed, false if its end code was
+ *           set by ACL.
+ */
+static inline bool
+vl_query_acl(vectorloop_t *vl, query_t *q)
+{
+    bool allowlisted;
+
+    if (vl->acl == NULL) {
+        return true;
+    }
+    switch (acl_check_allowlisted(vl->acl, q->client_ip, &allowlisted)) {
+    case ACL_ACTION_REFUSE:
+        q->end_code      = q->request_buffer_len < sizeof(rip_ns_header_t) ?
+                           rip_ns_r_rip_shortheader : rip_ns_r_refused;
+        q->authoritative = false;
+        METRICS_INC(vl->metrics_vl->dns.acl_refused);
+        return false;
+    case ACL_ACTION_DROP:
+        q->end_code = rip_ns_r_rip_acl_drop;
+        METRICS_INC(vl->metrics_vl->dns.acl_dropped);
+        return false;
+    default:
+        q->priority = allowlisted;
+        return true;
+    }
+}
+
+/** Shed parsed UDP query under overload, see @ref vloverload. At
+ * @ref VL_OVERLOAD_SHED_QTYPES queries of types zone database does not hold,
+ * and ANY queries, are dropped. At @ref VL_OVERLOAD_SHED_CLIENTS queries of
+ * clients without a valid server cookie are dropped or slipped, slipped query is answered with truncated response
+ * packed in place of its response, see @ref vl_query_response_pack(). Shed
+ * query is not resolved. Priority lane queries are never shed.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Query that passed parse.
+ *
+ * @return   Returns true if query was shed.
+ */
+static inline bool
+vl_query_shed(vectorloop_t *vl, query_t *q)
+{
+    if (vl->overload.level < VL_OVERLOAD_SHED_QTYPES || q->priority) {
+        return false;
+    }
+    if (q->query_q_type == rip_ns_t_any || !zone_type_supported(q->query_q_type)) {
+        q->end_code = rip_ns_r_rip_overload_drop;
+        METRICS_INC(vl->metrics_vl->overload.qtype_dropped);
+        return true;
+    }
+    if (vl->overload.level < VL_OVERLOAD_SHED_CLIENTS ||
+        q->edns.cookie.server_cookie_valid) {
+        return false;
+    }
+    if (vl_overload_slip(&vl->overload)) {
+        q->end_code         = rip_ns_r_noerror;
+        q->response_slipped = true;
+        METRICS_INC(vl->metrics_vl->overload.client_slipped);
+    } else {
+        q->end_code = rip_ns_r_rip_overload_drop;
+        METRICS_INC(vl->metrics_vl->overload.client_dropped);
+    }
+    return true;
+}
+
+/** Select view parsed query is answered from, see @ref views_select(), or
+ * if it has none its zone catalog zone, see @ref zone_catalog_find(), and
+ * look up its geo, see @ref geoip_cache_lookup(). Geo is that of client
+ * subnet address if query has one, otherwise of client address. Deferred
+ * query has its view, zone and geo selected again once it is resolved
+ * again, as view set, zone catalog or GeoIP database may have been reloaded
+ * in between.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed query.
+ */
+static inline void
+vl_query_view(vectorloop_t *vl, query_t *q)
+{
+    const struct sockaddr_storage *ip;
+
+    q->view = vl->views != NULL && vl->views->count != 0 ?
+              views_select(vl->views, q->local_ip, q->client_ip) : 0;
+    q->catalog_zone = q->view == 0 && vl->catalog != NULL ?
+                      zone_catalog_find(vl->catalog, q->query_qname, q->query_qname_len) : 0;
+    if (vl->geoip == NULL) {
+        q->geo       = 0;
+        q->geo_scope = 0;
+        return;
+    }
+    ip = q->edns.client_subnet.edns_cs_valid ? query_edns_cs_ip(&q->edns.client_subnet) :
+                                               q->client_ip;
+    if (geoip_cache_lookup(&vl->geoip_cache, vl->geoip, ip, &q->geo, &q->geo_scope)) {
+        METRICS_INC(vl->metrics_vl->dns.geoip_cache_hits);
+    } else {
+        METRICS_INC(vl->metrics_vl->dns.geoip_cache_misses);
+    }
+}
+
+/** Get zone database query is resolved against, zone database of its view,
+ * of its zone catalog zone or main zone database.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed query.
+ *
+ * @return   Returns zone database, NULL if it is not loaded.
+ */
+static inline zone_db_t *
+vl_query_zone_db(vectorloop_t *vl, query_t *q)
+{
+    if (q->view != 0) {
+        return vl->views->zone_dbs[q->view - 1];
+    }
+    return q->catalog_zone != 0 ? zone_catalog_db(vl->catalog, q->catalog_zone) : vl->zone_db;
+}
+
+/** Verify EDNS cookie of parsed query, if any.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed query.
+ */
+static inline void
+vl_query_cookie_verify(vectorloop_t *vl, query_t *q)
+{
+    if (!q->edns.cookie.edns_cookie_valid) {
+        return;
+    }
+    if (!vl->cfg->dns_cookies) {
+        q->edns.cookie.edns_cookie_valid = false;
+        return;
+    }
+    dns_cookie_verify(&q->edns.cookie, vl->cfg->dns_cookie_secret, q->client_ip,
+                      (uint32_t)q->start_time.tv_sec);
+}
+
+/** Read CPU cycle counter at start of a stage query is timed through, see
+ * "metrics_query_cost".
+ *
+ * @param q Query stage is run for.
+ *
+ * @return  Returns cycle counter, 0 if query is not timed.
+ */
+static inline uint64_t
+vl_query_cost_start(const query_t *q)
+{
+    return q->cost_sampled ? utl_cycles() : 0;
+}
+
+/** Add cycles of a stage to cost of a timed query.
+ *
+ * @param q     Query stage was run for.
+ * @param start Cycle counter at start of stage, see
+ *              @ref vl_query_cost_start, 0 if query is not timed.
+ */
+static inline void
+vl_query_cost_end(query_t *q, uint64_t start)
+{
+    if (start != 0) {
+        q->cost_cycles += utl_cycles() - start;
+    }
+}
+
+/** Parse query, with fast path parser if request has the common shape, and
+ * verify its EDNS cookie, if any. 1 in "metrics_query_cost" queries is
+ * marked to be timed through parse, resolve and pack stages.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param cid  Connection ID query was received on, 0 for UDP.
+ * @param q    Query to parse.
+ * @param fast Whether request header has fast path shape, see
+ *             @ref query_parse_fast_header.
+ */
+static inline void
+vl_query_parse(vectorloop_t *vl, uint64_t cid, query_t *q, bool fast)
+{
+    uint64_t cost;
+
+    if (vl->metrics_cost != NULL && ++vl->cost_sample_count >= vl->cfg->metrics_query_cost) {
+        vl->cost_sample_count = 0;
+        q->cost_sampled       = true;
+    }
+    cost = vl_query_cost_start(q);
+
+    PROBE_QUERY(query__receive, vl->id, cid, q, q->start_time);
+    if (!fast || !query_parse_fast_question(q)) {
+        query_parse(q);
+        vl_query_cookie_verify(vl, q);
+    }
+    if (q->end_code == -1) {
+        vl_query_view(vl, q);
+    }
+    PROBE_QUERY(query__parse, vl->id, cid, q, q->parse_time);
+    vl_query_cost_end(q, cost);
+}
+
+/** Check if answer section of query holds an RRSIG record covering a type,
+ * i.e. RRset of type is presigned in zone.
+ *
+ * @param q    Resolved query.
+ * @param type Type covered.
+ *
+ * @return     Returns true if RRSIG record is found, otherwise false.
+ */
+static inline bool
+vl_query_answer_signed(query_t *q, uint16_t type)
+{
+    for (uint8_t i = 0; i < q->answer_section_count; i++) {
+        rr_record_t *rr = q->answer_section[i];
+
+        if (rr->type == rip_ns_t_rrsig && rr->rdata_len >= RIP_NS_INT16SZ &&
+            ((rr->rdata[0] << 8) | rr->rdata[1]) == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Sign answer section RRsets of query with DNSSEC OK bit set online, for
+ * RRsets zone holds no RRSIG records for.
+ *
+ * RRSIG records are taken from vectorloop signature cache. RRset not found in
+ * cache is prepared and handed to a worker thread, vectorloop never signs
+ * itself. If query can be deferred, its end code is set to
+ * rip_ns_r_rip_deferred and it is resolved again once they are done, see
+ * @ref vl_fn_query_resume. Otherwise response is sent with RRsets not signed
+ * yet, and it is not added to response cache.
+ *
+ * @param vl       Vectorloop operating on.
+ * @param q        Resolved query.
+ * @param can_defer Query can be deferred, waiting for worker threads.
+ */
+static void
+vl_query_sign(vectorloop_t *vl, query_t *q, bool can_defer)
+{
+    dnssec_sig_cache_t *cache      = &vl->dnssec_sig_cache;
+    rr_record_t       **an         = q->answer_section;
+    rr_record_t        *sigs[RIP_NS_RESP_MAX_ANSW];
+    unsigned char       owner[RIP_NS_MAXCDNAME + 1];
+    uint16_t            owner_len  = 0;
+    uint32_t            now        = (uint32_t)vl->loop_timestamp.tv_sec;
+    uint8_t             count      = q->answer_section_count;
+    uint8_t             sigs_count = 0;
+    uint8_t             n          = 0;
+    bool                wait       = false;
+    bool                unsigned_  = false;
+
+    for (uint8_t i = 0; i < count; i += n) {
+        dnssec_sig_t *sig;
+
+        /* Records of an RRset are stored next to each other in zone. */
+        for (n = 1; i + n < count && an[i + n] == an[i] + n &&
+                    an[i + n]->type == an[i]->type; n++);
+
+        if (an[i]->type == rip_ns_t_rrsig || an[i] == &q->synth_rr ||
+            vl_query_answer_signed(q, an[i]->type)) {
+            /* Signature cache is keyed by record, synthesized record is
+             * query owned and answered unsigned.
              */
-            conn_udp->write_vector_write_index += ret;
-            conn_udp->write_vector_count       -= ret;
+            continue;
+        }
+        sig = dnssec_sig_cache_get(cache, vl_query_zone_db(vl, q)->generation, an[i], now);
+        if (sig != NULL) {
+            if (sig->state == DNSSEC_SIG_ST_READY) {
+                METRICS_INC(vl->metrics_vl->dnssec.sig_cache_hits);
+                sigs[sigs_count++] = &sig->rr;
+            } else if (sig->state == DNSSEC_SIG_ST_PENDING) {
+                wait = true;
+            }
+            /* else RRset failed to be signed, it is answered unsigned. */
+            continue;
+        }
+        METRICS_INC(vl->metrics_vl->dnssec.sig_cache_misses);
 
-            /* Put conn back into write queue! */
-            conn_fifo_enqueue_write(&new_queue, conn);
+        sig = dnssec_sig_cache_add(cache, vl_query_zone_db(vl, q)->generation, an[i]);
+        if (sig == NULL) {
+            /* All entries are pending or used by this iteration queries. */
+            unsigned_ = true;
+            continue;
+        }
+        if (i < q->answer_qname_count && !q->answer_wildcard) {
+            /* ECS view RRset variant, packed with query name as owner. */
+            memcpy(owner, q->query_qname, q->query_qname_len);
+            owner_len = q->query_qname_len;
+        } else if (rip_ns_name_pton(an[i]->name, owner, sizeof(owner)) >= 0) {
+            owner_len = rip_ns_name_lc(owner);
+        } else {
+            owner_len = 0;
         }
+        if (owner_len == 0 ||
+            dnssec_sig_prepare(vl->dnssec_key, sig, owner, owner_len, an[i], n, now) != 0) {
+            /* RRset is out of signer zone, or too large, never signed. */
+            METRICS_INC(vl->metrics_vl->dnssec.sign_errors);
+            sig->state = DNSSEC_SIG_ST_FAILED;
+            dnssec_sig_cache_done(cache, sig);
+            continue;
+        }
+        if (!worker_pool_submit(&vl->workers, &sig->job)) {
+            /* Worker thread queues are full. */
+            dnssec_sig_cache_drop(cache, sig);
+            unsigned_ = true;
+            continue;
+        }
+        wait = true;
     }
 
-    /* Requeue any connections back into UDP write queue. */
-    if (new_queue.head != NULL) {
-        vl->conn_udp_write_queue.head = new_queue.head;
-        vl->conn_udp_write_queue.tail = new_queue.tail;
+    if (wait && can_defer) {
+        METRICS_INC(vl->metrics_vl->dns.queries_deferred);
+        q->end_code = rip_ns_r_rip_deferred;
+        return;
+    }
+    if (sigs_count > RIP_NS_RESP_MAX_ANSW - count) {
+        sigs_count = RIP_NS_RESP_MAX_ANSW - count;
+        unsigned_  = true;
+    }
+    if (wait || unsigned_) {
+        /* Response lacks signatures, do not cache it. */
+        METRICS_INC(vl->metrics_vl->dnssec.responses_unsigned);
+        q->response_cache_hash = 0;
+    }
+    if (sigs_count > 0) {
+        /* Answer differs from RRset template response. */
+        memcpy(an + count, sigs, sigs_count * sizeof(rr_record_t *));
+        q->answer_section_count += sigs_count;
+        q->response_rrset        = NULL;
+        if (q->answer_wildcard && q->answer_qname_count == count) {
+            /* Signed over wildcard name, packed with query name as owner. */
+            q->answer_qname_count = q->answer_section_count;
+        }
+    }
+}
+
+/** Answer NOTIFY (RFC 1996). NOTIFY from zone primary for a secondary zone
+ * only flags zone for transfer thread, see @ref zone_secondary_notify(),
+ * others are refused.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed NOTIFY.
+ */
+static void
+vl_query_notify(vectorloop_t *vl, query_t *q)
+{
+    zone_secondary_t *secondary = vl->resources->secondary;
+
+    if (secondary != NULL && q->query_q_type == rip_ns_t_soa &&
+        zone_secondary_notify(secondary, q->query_qname, q->query_qname_len, q->client_ip)) {
+        q->end_code = rip_ns_r_noerror;
+        return;
+    }
+    q->authoritative = false;
+    q->end_code      = rip_ns_r_refused;
+}
+
+/** Check query name against response policy, before response cache and zone
+ * lookup. Rewritten query is answered with no records and without AA bit, it
+ * is not cached, so policy reload takes effect right away. Dropped query gets
+ * rip_ns_r_rip_policy_drop end code, so nothing is packed for it.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed query.
+ *
+ * @return   Returns true if end code of query was set by policy, false if
+ *           query is to be resolved.
+ */
+static inline bool
+vl_query_policy(vectorloop_t *vl, query_t *q)
+{
+    policy_action_t action;
+
+    if (vl->policy == NULL ||
+        !policy_check(vl->policy, q->query_qname, q->query_qname_len,
+                      q->query_qname_hash, &action)) {
+        return false;
+    }
+    switch (action) {
+    case POLICY_ACTION_NXDOMAIN:
+        q->end_code = rip_ns_r_nxdomain;
+        METRICS_INC(vl->metrics_vl->dns.policy_nxdomain);
+        break;
+    case POLICY_ACTION_NODATA:
+        q->end_code = rip_ns_r_noerror;
+        METRICS_INC(vl->metrics_vl->dns.policy_nodata);
+        break;
+    case POLICY_ACTION_REFUSE:
+        q->end_code = rip_ns_r_refused;
+        METRICS_INC(vl->metrics_vl->dns.policy_refused);
+        break;
+    case POLICY_ACTION_DROP:
+        q->end_code = rip_ns_r_rip_policy_drop;
+        METRICS_INC(vl->metrics_vl->dns.policy_dropped);
+        return true;
+    default:
+        METRICS_INC(vl->metrics_vl->dns.policy_passthru);
+        return false;
+    }
+    q->authoritative = false;
+    return true;
+}
+
+/** Resolve query from zone database, or load balancing candidate set,
+ * signing answer online if DNSSEC signing key is configured, see
+ * @ref vl_query_sign.
+ *
+ * @param vl        Vectorloop operating on.
+ * @param q         Parsed query to resolve.
+ * @param can_defer Query can be deferred, waiting for worker threads.
+ */
+static inline void
+vl_query_resolve_zone(vectorloop_t *vl, query_t *q, bool can_defer)
+{
+    query_resolve(q, vl_query_zone_db(vl, q), vl->ecs_map, vl->lb, &vl->nsec3_cache);
+    if (q->lb_answer) {
+        if (q->lb_all_down) {
+            METRICS_INC(vl->metrics_vl->dns.lb_all_down);
+        } else {
+            METRICS_INC(vl->metrics_vl->dns.lb_answers);
+        }
+    }
+    if (vl->dnssec_key != NULL && q->answer_section_count > 0 &&
+        q->edns.edns_valid && q->edns.dnssec) {
+        vl_query_sign(vl, q, can_defer);
+    }
+}
+
+/** Start a new batch of queries duplicates are looked for in, see
+ * @ref vl_query_coalesce(). Queries of a batch are resolved, and then packed,
+ * in order.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static inline void
+vl_query_coalesce_batch(vectorloop_t *vl)
+{
+    vl->coalesce_batch++;
+}
+
+/** Coalesce query that missed response cache with same query resolved
+ * earlier in batch. Flash crowds send same name and type from many clients
+ * at once, and as batch is resolved before any of its responses are packed
+ * into response cache, all of them would miss it. Query whose key hash is
+ * in batch table is not resolved, its response is copied from response
+ * cache once first query's response is packed, see
+ * @ref vl_query_response_pack(). Resolved query that can be cached records
+ * its hash in table.
+ *
+ * Table is direct mapped and only hashes are compared, response cache lookup
+ * at pack time compares full key, and query that still misses it is resolved
+ * then.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Query that missed response cache.
+ *
+ * @return   Returns true if query was coalesced.
+ */
+static inline bool
+vl_query_coalesce(vectorloop_t *vl, query_t *q)
+{
+    uint64_t *slot = &vl->coalesce[q->response_cache_hash & (VL_COALESCE_SLOTS - 1)];
+    uint64_t  tag  = (uint64_t)vl->coalesce_batch << 32 | (uint32_t)q->response_cache_hash;
+
+    if (*slot == tag) {
+        q->response_coalesced = true;
+        q->end_code           = rip_ns_r_noerror;
+        return true;
+    }
+    return false;
+}
+
+/** Record query resolved from zone database in batch table, if its response
+ * can be cached, see @ref vl_query_coalesce().
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Resolved query.
+ */
+static inline void
+vl_query_coalesce_add(vectorloop_t *vl, query_t *q)
+{
+    if (q->response_cache_hash != 0 && q->end_code >= 0) {
+        vl->coalesce[q->response_cache_hash & (VL_COALESCE_SLOTS - 1)] =
+            (uint64_t)vl->coalesce_batch << 32 | (uint32_t)q->response_cache_hash;
+    }
+}
+
+/** Add response of query, that was copied from response cache entry which
+ * turned hot, to in-kernel responder map of XDP program, keyed by request it
+ * answers, see @ref vlxdp. Only UDP queries without EDNS cookie are added,
+ * their response is complete once copied from cache, and only while
+ * responder does not stand aside, see @ref vl_fn_xdp_resp_generation.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Query answered from response cache.
+ */
+static void
+vl_query_xdp_resp_put(vectorloop_t *vl, query_t *q)
+{
+    vl_xdp_resp_key_t   key;
+    vl_xdp_resp_value_t value;
+
+    if (vl->xdp_resp_generation == 0 || q->protocol != 0 ||
+        q->edns.cookie.edns_cookie_raw_buf_len != 0) {
+        return;
+    }
+    if (!vl_xdp_resp_entry_build(&key, &value, vl->xdp_resp_generation,
+                                 vl->response_cache.hot_request,
+                                 vl->response_cache.hot_request_len,
+                                 (const unsigned char *)q->response_hdr,
+                                 q->response_buffer_len, vl->xdp_prog->mtu)) {
+        return;
+    }
+    if (vl_xdp_resp_put(vl->xdp_prog, &key, &value) == 0) {
+        METRICS_INC(vl->metrics_vl->dns.xdp_responder_puts);
+    }
+}
+
+/** Resolve query, from response cache if cached response is available, or
+ * else from shared response cache. Answer resolved from zone is signed online
+ * if DNSSEC signing key is configured, see @ref vl_query_sign. Query that
+ * misses response caches is coalesced with same query resolved earlier in
+ * batch, see
+ * @ref vl_query_coalesce(). NOTIFY is answered by @ref vl_query_notify.
+ *
+ * @param vl       Vectorloop operating on.
+ * @param cid      Connection ID query was received on, 0 for UDP.
+ * @param q        Parsed query to resolve.
+ * @param can_defer Query can be deferred, waiting for worker threads.
+ */
+static inline void
+vl_query_resolve(vectorloop_t *vl, uint64_t cid, query_t *q, bool can_defer)
+{
+    uint64_t cost = vl_query_cost_start(q);
+
+    if (q->notify) {
+        vl_query_notify(vl, q);
+    } else if (vl_query_policy(vl, q)) {
+        /* End code is set by response policy. */
+    } else if (response_cache_get(&vl->response_cache, q)) {
+        METRICS_INC(vl->metrics_vl->dns.response_cache_hits);
+        if (q->response_hot) {
+            vl_query_xdp_resp_put(vl, q);
+        }
+    } else if (q->response_cache_hash == 0) {
+        vl_query_resolve_zone(vl, q, can_defer);
+    } else if (vl->response_cache_shared != NULL &&
+               response_cache_shared_get(vl->response_cache_shared, &vl->response_cache, q)) {
+        METRICS_INC(vl->metrics_vl->dns.response_cache_shared_hits);
+    } else if (!vl_query_coalesce(vl, q)) {
+        METRICS_INC(vl->metrics_vl->dns.response_cache_misses);
+        vl_query_resolve_zone(vl, q, can_defer);
+        vl_query_coalesce_add(vl, q);
+    }
+    PROBE_QUERY(query__resolve, vl->id, cid, q, q->resolve_time);
+    vl_query_cost_end(q, cost);
+}
+
+/** Prefetch memory @ref vl_query_resolve reads first for a query, its
+ * response policy pilot, response cache entry and zone name filter entries. Issued a few queries
+ * ahead so cache misses of a batch overlap instead of forming a chain.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Parsed query to be resolved.
+ */
+static inline void
+vl_query_resolve_prefetch(vectorloop_t *vl, query_t *q)
+{
+    zone_db_t *db;
+
+    if (q->notify) {
+        return;
+    }
+    db = vl_query_zone_db(vl, q);
+    if (vl->policy != NULL) {
+        policy_prefetch(vl->policy, q->query_qname_hash);
+    }
+    response_cache_prefetch(&vl->response_cache, q);
+    if (db != NULL) {
+        zone_db_prefetch(db, q->query_qname_hash);
+    }
+}
+
+/** Prefetch precompiled response fragment @ref vl_query_response_pack copies
+ * into query response, see @ref vl_query_resolve_prefetch.
+ *
+ * @param q Resolved query to be packed.
+ */
+static inline void
+vl_query_response_pack_prefetch(query_t *q)
+{
+    if (q->response_cached) {
+        return;
+    }
+    if (q->response_rrset != NULL) {
+        __builtin_prefetch(q->response_rrset->wire);
+    } else if (q->response_soa != NULL) {
+        __builtin_prefetch(q->response_soa->neg_wire);
+    }
+}
+
+/** Pack query response, unless it was copied from response cache, and add
+ * it to response cache and shared response cache. Query slipped under overload gets truncated response
+ * instead, see @ref vl_query_shed(). Coalesced query copies response of query it was
+ * coalesced with from response cache, and is resolved now if it is not
+ * there, see @ref vl_query_coalesce(). EDNS cookie is appended afterwards,
+ * so it is not cached, as is TCP keepalive, see
+ * @ref vl_fn_query_response_pack().
+ *
+ * @param vl  Vectorloop operating on.
+ * @param cid Connection ID query was received on, 0 for UDP.
+ * @param q   Resolved query to pack response for.
+ */
+static inline void
+vl_query_response_pack(vectorloop_t *vl, uint64_t cid, query_t *q)
+{
+    uint64_t cost = vl_query_cost_start(q);
+
+    if (q->response_coalesced) {
+        q->response_coalesced = false;
+        if (response_cache_get(&vl->response_cache, q)) {
+            METRICS_INC(vl->metrics_vl->dns.response_cache_coalesced);
+        } else {
+            METRICS_INC(vl->metrics_vl->dns.response_cache_misses);
+            vl_query_resolve_zone(vl, q, false);
+        }
+    }
+    if (q->response_slipped) {
+        query_response_pack_truncated(q);
+    } else if (!q->response_cached && query_response_pack(q) == 0) {
+        response_cache_put(&vl->response_cache, q);
+        if (vl->response_cache_shared != NULL) {
+            response_cache_shared_put(vl->response_cache_shared, &vl->response_cache, q);
+        }
+    }
+    /* If options do not fit, response is sent without them. */
+    query_response_pack_cookie(q);
+    PROBE_QUERY(query__pack, vl->id, cid, q, q->pack_time);
+    vl_query_cost_end(q, cost);
+}
+
+/** Vectorloop function warms response cache from snapshot of previous
+ * process once first zone database is published, before any query is
+ * answered from it. Each snapshot question is resolved and packed into
+ * response cache, least hit first so most hit ones keep slots they collide
+ * on, and snapshot is unmapped. Questions with DNSSEC OK bit are skipped
+ * when answers are signed online, as signing is left to worker threads.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_response_cache_warm(vectorloop_t *vl)
+{
+    response_cache_snapshot_t *snap   = &vl->response_cache_snapshot;
+    size_t                     warmed = 0;
+    query_t                    q;
+
+    if (snap->entries == NULL || (vl->zone_db == NULL && vl->catalog == NULL)) {
+        return;
+    }
+
+    query_init(&q, vl->cfg, 0);
+    for (uint32_t i = snap->count; i > 0; i--) {
+        const response_cache_snapshot_entry_t *entry = &snap->entries[i - 1];
+
+        query_reset(&q);
+        if ((entry->dnssec && vl->dnssec_key != NULL) ||
+            (entry->view != 0 && (vl->views == NULL || entry->view > vl->views->count)) ||
+            !response_cache_snapshot_query(entry, &q) ||
+            response_cache_get(&vl->response_cache, &q) || q.response_cache_hash == 0) {
+            continue;
+        }
+        if (q.view == 0 && vl->catalog != NULL) {
+            q.catalog_zone = zone_catalog_find(vl->catalog, q.query_qname,
+                                               q.query_qname_len);
+        }
+        vl_query_resolve_zone(vl, &q, false);
+        if (query_response_pack(&q) == 0) {
+            response_cache_put(&vl->response_cache, &q);
+            if (vl->response_cache_shared != NULL) {
+                response_cache_shared_put(vl->response_cache_shared, &vl->response_cache, &q);
+            }
+            warmed++;
+        }
+    }
+    query_clean(&q);
+
+    channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                      "vectorloop %d: response cache warmed with %zu of %u snapshot "
+                      "responses", vl->id, warmed, snap->count);
+    response_cache_snapshot_close(snap);
+}
+
+/** Write questions of cached responses to response cache snapshot file, so
+ * next process starts with a warm cache, see @ref vl_fn_response_cache_warm().
+ * Called once vectorloop is drained.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_response_cache_snapshot_write(vectorloop_t *vl)
+{
+    char path[FILE_REALPATH_MAX + 16];
+    char err_str[ERR_MSG_LENGTH];
+
+    /* Snapshot of previous process may never have been replayed. */
+    response_cache_snapshot_close(&vl->response_cache_snapshot);
+    if (vl->cfg->response_cache_snapshot_path == NULL || vl->response_cache.entries == NULL) {
+        return;
+    }
+    snprintf(path, sizeof(path), "%s.%d", vl->cfg->response_cache_snapshot_path, vl->id);
+    if (response_cache_snapshot_write(&vl->response_cache, path, err_str, ERR_MSG_LENGTH) < 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_response_cache_snapshot_write: %s", err_str);
+    }
+}
+
+/** Idle timeout TCP connections are told in EDNS tcp-keepalive option (RFC
+ * 7828), shrunk as vectorloop fills up with TCP connections, see
+ * @ref conn_tcp_keepalive_scale(). Once vectorloop is draining timeout is 0,
+ * asking clients to close connections.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns idle timeout, in milliseconds.
+ */
+static size_t
+vl_tcp_keepalive(vectorloop_t *vl)
+{
+    if (vl->draining) {
+        return 0;
+    }
+    return conn_tcp_keepalive_scale(vl->cfg->tcp_keepalive, vl->conns_tcp_active,
+                                    vl->cfg->tcp_conns_per_vl_max,
+                                    vl->cfg->tcp_keepalive_shrink_start);
+}
+
+/** Apply response rate limiting to packed UDP query response. Response over
+ * the limit is either replaced by a truncated response, or its end code is set
+ * to rip_ns_r_rip_rrl_drop so no response is sent. Queries with a valid
+ * server cookie, and priority lane queries, are not rate limited.
+ *
+ * @param vl Vectorloop operating on.
+ * @param q  Query with packed response.
+ */
+static inline void
+vl_query_response_rrl(vectorloop_t *vl, query_t *q)
+{
+    switch (rrl_check(&vl->rrl, q->client_ip, rrl_class(q), vl->loop_time_ms * 1000)) {
+    case rrl_action_send:
+        break;
+    case rrl_action_slip:
+        rrl_slip(q);
+        METRICS_INC(vl->metrics_vl->dns.rrl_slipped);
+        break;
+    case rrl_action_drop:
+        q->end_code = rip_ns_r_rip_rrl_drop;
+        METRICS_INC(vl->metrics_vl->dns.rrl_dropped);
+        break;
+    }
+}
+
+/** Account datagrams kernel dropped on UDP listener, from drop count a
+ * received datagram carried in SO_RXQ_OVFL control message. Count is of
+ * socket lifetime, so difference from last one seen is counted. When
+ * "udp_socket_recvbuff_autotune_max" is set listener receive buffer is
+ * raised, see @ref conn_udp_recvbuff_autotune().
+ *
+ * @param vl       Vectorloop operating on.
+ * @param listener UDP listener datagram was received on.
+ * @param drops    Socket drop count datagram carried.
+ */
+static void
+vl_udp_rxq_drops(vectorloop_t *vl, conn_t *listener, uint32_t drops)
+{
+    conn_udp_t *conn_udp = listener->conn.udp;
+    uint32_t    delta    = drops - conn_udp->rxq_drops;
+    size_t      size     = 0;
+
+    if (delta == 0) {
+        return;
+    }
+    conn_udp->rxq_drops = drops;
+    METRICS_ADD(vl->metrics_vl->udp.rxq_drops[listener->ip_version], delta);
+    if (vl->metrics_udp_addrs != NULL) {
+        METRICS_ADD(vl->metrics_udp_addrs[conn_udp->addr_index].rxq_drops, delta);
+    }
+    vl_overload_drops(&vl->overload, delta);
+
+    size = conn_udp_recvbuff_autotune(listener, vl->cfg->udp_socket_recvbuff_autotune_max,
+                                      vl->loop_time_ms);
+    if (size > 0) {
+        METRICS_INC(vl->metrics_vl->udp.recvbuff_raises);
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vectorloop %u: kernel dropped UDP datagrams, IPv%d listener "
+                          "receive buffer size raised to %zu", vl->id,
+                          listener->ip_version ? 6 : 4, size);
+    }
+}
+
+/** Parse a batch of UDP connection queries. Priority lane queries, see
+ * @ref query_t.priority, are moved ahead of rest in index column so they are
+ * resolved first.
+ *
+ * @param vl    Vectorloop operating on.
+ * @param conn  UDP connection queries belong to.
+ * @param start Index of first query in batch.
+ * @param end   Index after last query in batch.
+ * @param index Index column to add queries that passed parse to.
+ * @param ts    Parse timestamp.
+ *
+ * @return      Returns number of queries added to index column.
+ */
+static unsigned int
+vl_udp_batch_parse(vectorloop_t *vl, conn_t *conn, unsigned int start,
+                   unsigned int end, uint16_t *index, struct timespec *ts)
+{
+    struct mmsghdr *read_vector  = conn->conn.udp->read_vector;
+    struct mmsghdr *write_vector = conn->conn.udp->write_vector;
+    query_t        *queries      = conn->conn.udp->queries;
+    unsigned int    count        = 0;
+    unsigned int    priority     = 0;
+    uint64_t        fast         = 0;
+
+    for (unsigned int i = start; i < end; i++) {
+        /* Check headers of up to next 64 queries at once, only those not of
+         * fast path shape go through header checks one by one.
+         */
+        if ((i - start) % 64 == 0) {
+            fast = query_parse_fast_headers(&queries[i], &read_vector[i],
+                                            end - i < 64 ? end - i : 64);
+        }
+
+        /* check request size. */
+        if (read_vector[i].msg_len > RIP_NS_PACKETSZ) {
+            /* Request exceeds allowed RIP_NS_PACKETSZ size. */
+            queries[i].end_code = rip_ns_r_rip_toolarge;
+            continue;
+        }
+        /* Extract destination (local) IP from message control header.
+         * Populate extracted destination IP & port in 
+         * query structure local_ip field.
+         */
+        struct cmsghdr *pktinfo = NULL;
+        bool            strip   = false;
+        struct timespec rx_time = {};
+        for ( /* iterate through all the control headers */
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&read_vector[i].msg_hdr);
+            cmsg != NULL;
+            cmsg = CMSG_NXTHDR(&read_vector[i].msg_hdr, cmsg)) {
+
+            if (cmsg->cmsg_level == SOL_SOCKET) {
+                /* Socket drop count, only present once socket dropped
+                 * datagrams, and kernel receive timestamp.
+                 */
+                if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t drops;
+
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                    vl_udp_rxq_drops(vl, conn->conn.udp->read_socket != NULL ?
+                                         conn->conn.udp->read_socket[i] :
+                                         conn->conn.udp->listener, drops);
+                } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    memcpy(&rx_time, CMSG_DATA(cmsg), sizeof(rx_time));
+                }
+                strip = true;
+            } else if (cmsg->cmsg_level == IPPROTO_IP) {
+                /* IPv4 */
+                /* Ignore the control headers that don't match what we want */
+                if (cmsg->cmsg_level != IPPROTO_IP ||
+                    cmsg->cmsg_type != IP_PKTINFO) {
+                    continue;
+                }
+                
+                struct in_pktinfo *pi = (struct in_pktinfo *)CMSG_DATA(cmsg);
+                /* At this point:
+                 * pi->ipi_spec_dst is the destination in_addr
+                 * pi->ipi_addr is the receiving interface in_addr
+                 */
+                struct sockaddr_in *sin = (struct sockaddr_in *)queries[i].local_ip;
+                sin->sin_family = AF_INET;
+                sin->sin_addr = pi->ipi_spec_dst;
+                sin->sin_port = htons(vl->cfg->udp_listener_port);
+                pktinfo = cmsg;
+                
+            } else {
+                /* IPv6 */
+                /* Ignore the control headers that don't match what we want */
+                if (cmsg->cmsg_level != IPPROTO_IPV6 ||
+                    cmsg->cmsg_type != IPV6_PKTINFO) {
+                    continue;
+                }
+                struct in6_pktinfo *pi6 = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+                /* At this point:
+                 * pi->ipi6_addr is the destination in_addr
+                 */
+                if (IN6_IS_ADDR_V4MAPPED(&pi6->ipi6_addr)) {
+                    /* IPv4 datagram on dual stack listener. Response is sent
+                     * with packet info as received, kernel takes IPv4 source
+                     * address from IPv4-mapped one.
+                     */
+                    struct sockaddr_in *sin = (struct sockaddr_in *)queries[i].local_ip;
+                    sin->sin_family = AF_INET;
+                    memcpy(&sin->sin_addr, &pi6->ipi6_addr.s6_addr[12], sizeof(sin->sin_addr));
+                    sin->sin_port = htons(vl->cfg->udp_listener_port);
+                    pktinfo = cmsg;
+                    continue;
+                }
+                struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)queries[i].local_ip;
+                sin6->sin6_family = AF_INET6;
+                sin6->sin6_addr = pi6->ipi6_addr;
+                sin6->sin6_port = htons(vl->cfg->udp_listener_port);
+                pktinfo = cmsg;
+            }
+        }
+        if (strip) {
+            /* Response is sent with control message received, which must
+             * only carry packet info, sendmsg() rejects SO_RXQ_OVFL and
+             * SCM_TIMESTAMPNS.
+             */
+            if (pktinfo != NULL) {
+                size_t len = pktinfo->cmsg_len;
+
+                memmove(read_vector[i].msg_hdr.msg_control, pktinfo, len);
+                read_vector[i].msg_hdr.msg_controllen = CMSG_ALIGN(len);
+            } else {
+                read_vector[i].msg_hdr.msg_controllen = 0;
+            }
+        }
+
+        /* Extract source ip from message msg_name field. Client of dual
+         * stack listener is handled as IPv4 client, response is sent to
+         * address as received.
+         */
+        memcpy(queries[i].client_ip, read_vector[i].msg_hdr.msg_name,
+               read_vector[i].msg_hdr.msg_namelen);
+        utl_sockaddr_unmap(queries[i].client_ip);
+
+        /* Populate write vector with source & destination IPs. */
+        write_vector[i].msg_hdr.msg_control = read_vector[i].msg_hdr.msg_control;
+        write_vector[i].msg_hdr.msg_controllen = read_vector[i].msg_hdr.msg_controllen;
+        write_vector[i].msg_hdr.msg_name = read_vector[i].msg_hdr.msg_name;
+        write_vector[i].msg_hdr.msg_namelen = read_vector[i].msg_hdr.msg_namelen;
+
+        /* Set query start time, kernel receive time if datagram has it. */
+        queries[i].start_time = rx_time.tv_sec != 0 ? rx_time : vl->loop_timestamp;
+
+        /* Parse DNS query from datagram, unless client ACL denies it. */
+        queries[i].parse_time         = *ts;
+        queries[i].request_buffer_len = read_vector[i].msg_len;
+        if (!vl_query_acl(vl, &queries[i])) {
+            continue;
+        }
+        vl_query_parse(vl, 0, &queries[i], (fast >> ((i - start) % 64)) & 1);
+        if (queries[i].end_code == -1 && !vl_query_shed(vl, &queries[i])) {
+            /* Query passed parse, queue it for resolve. */
+            index[count++] = i;
+            priority      += queries[i].priority;
+        }
+    }
+    if (priority > 0) {
+        conn->conn.udp->priority_count += priority;
+        conn_udp_priority_first(queries, index, count);
+    }
+
+    return count;
+}
+
+/** Detach deferred UDP query from listener batch into a free pending slot,
+ * so listener can carry on receiving next batch of queries. Request is copied
+ * and parsed again in slot, along with client address and control message
+ * response is sent with.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn UDP connection query was received on.
+ * @param i    Index of query in connection vectors.
+ */
+static void
+vl_udp_query_defer(vectorloop_t *vl, conn_t *conn, unsigned int i)
+{
+    conn_udp_t       *conn_udp = conn->conn.udp;
+    query_t          *src      = &conn_udp->queries[i];
+    struct msghdr    *hdr      = &conn_udp->read_vector[i].msg_hdr;
+    vl_pending_udp_t *w        = vl->pending_udp;
+    query_t          *q;
+
+    while (w->listener != NULL) {
+        w++;
+    }
+    q = &w->q;
+    query_reset(q);
+
+    memcpy(q->request_buffer, src->request_buffer, src->request_buffer_len);
+    q->request_buffer_len = src->request_buffer_len;
+    memcpy(q->client_ip, src->client_ip, sizeof(struct sockaddr_storage));
+    memcpy(q->local_ip, src->local_ip, sizeof(struct sockaddr_storage));
+    q->start_time = src->start_time;
+    q->parse_time = src->parse_time;
+    q->priority   = src->priority;
+
+    q->cost_sampled = src->cost_sampled;
+    q->cost_cycles  = src->cost_cycles;
+
+    w->listener      = conn;
+    w->client_ip_len = hdr->msg_namelen;
+    w->control_len   = hdr->msg_controllen <= sizeof(w->control) ? hdr->msg_controllen : 0;
+    memcpy(w->control, hdr->msg_control, w->control_len);
+    INCREMENT(vl->pending_udp_count);
+
+    if (!query_parse_fast(q)) {
+        query_parse(q);
+        vl_query_cookie_verify(vl, q);
+    }
+    q->end_code = rip_ns_r_rip_deferred;
+}
+
+/** Resolve a batch of parsed UDP connection queries. Deferred query is
+ * detached into a pending slot, queries are deferred only while slots are
+ * available. Queries received on AF_XDP socket are never deferred.
+ *
+ * @param vl    Vectorloop operating on.
+ * @param conn  UDP connection queries belong to.
+ * @param index Index column of queries to resolve.
+ * @param count Number of entries in index column.
+ * @param ts    Resolve timestamp.
+ */
+static void
+vl_udp_batch_resolve(vectorloop_t *vl, conn_t *conn, uint16_t *index,
+                     unsigned int count, struct timespec *ts)
+{
+    query_t *queries = conn->conn.udp->queries;
+
+    vl_query_coalesce_batch(vl);
+    for (unsigned int j = 0; j < count && j < VL_PREFETCH_DISTANCE; j++) {
+        vl_query_resolve_prefetch(vl, &queries[index[j]]);
+    }
+    for (unsigned int j = 0; j < count; j++) {
+        query_t *q = &queries[index[j]];
+
+        if (j + VL_PREFETCH_DISTANCE < count) {
+            vl_query_resolve_prefetch(vl, &queries[index[j + VL_PREFETCH_DISTANCE]]);
+        }
+        q->resolve_time = *ts;
+        vl_query_resolve(vl, 0, q, conn != vl->listener_xdp &&
+                         vl->pending_udp_count < VL_PENDING_UDP_MAX);
+        if (q->end_code == rip_ns_r_rip_deferred) {
+            vl_udp_query_defer(vl, conn, index[j]);
+        }
+    }
+}
+
+/** Pack responses for a batch of UDP connection queries and apply response
+ * rate limiting to them.
+ *
+ * @param vl    Vectorloop operating on.
+ * @param conn  UDP connection queries belong to.
+ * @param start Index of first query in batch.
+ * @param end   Index after last query in batch.
+ * @param index Index column to add queries a response is sent for to.
+ * @param ts    Response pack timestamp.
+ *
+ * @return      Returns number of queries added to index column.
+ */
+static unsigned int
+vl_udp_batch_response_pack(vectorloop_t *vl, conn_t *conn, unsigned int start,
+                           unsigned int end, uint16_t *index, struct timespec *ts)
+{
+    query_t     *queries = conn->conn.udp->queries;
+    unsigned int count   = 0;
+
+    for (unsigned int i = start; i < end && i < start + VL_PREFETCH_DISTANCE; i++) {
+        if (queries[i].end_code >= 0) {
+            vl_query_response_pack_prefetch(&queries[i]);
+        }
+    }
+    for (unsigned int i = start; i < end; i++) {
+        if (i + VL_PREFETCH_DISTANCE < end &&
+            queries[i + VL_PREFETCH_DISTANCE].end_code >= 0) {
+            vl_query_response_pack_prefetch(&queries[i + VL_PREFETCH_DISTANCE]);
+        }
+        if (queries[i].end_code >= 0) {
+            queries[i].pack_time = *ts;
+            vl_query_response_pack(vl, 0, &queries[i]);
+            if (vl->rrl.buckets != NULL && queries[i].end_code >= 0 &&
+                !queries[i].edns.cookie.server_cookie_valid && !queries[i].priority) {
+                vl_query_response_rrl(vl, &queries[i]);
+            }
+            if (queries[i].end_code >= 0) {
+                /* Response is to be sent. */
+                index[count++] = i;
+            }
+        }
+        /* else query has a custom end_code indicating that no
+         * response is to be sent.
+         */
+    }
+
+    return count;
+}
+
+/** Run UDP connection queries through parse, resolve and response pack in
+ * batches of udp_pipeline_batch_len queries. Each batch passes all steps
+ * while its queries are still in CPU cache, instead of each step going over
+ * the whole vector. Connection is then queued for UDP write.
+ *
+ * Queries responses are sent for are gathered at the front of index column.
+ * Space after them holds current batch queries to resolve, which response
+ * pack of the batch is free to overwrite as resolve is done with them.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn UDP connection.
+ */
+static void
+vl_udp_pipeline_fused(vectorloop_t *vl, conn_t *conn)
+{
+    conn_udp_t     *conn_udp = conn->conn.udp;
+    unsigned int    batch    = vl->cfg->udp_pipeline_batch_len;
+    unsigned int    count    = 0;
+    struct timespec ts;
+
+    for (unsigned int start = 0; start < conn_udp->read_vector_count; start += batch) {
+        unsigned int end      = start + batch;
+        uint16_t    *index    = conn_udp->query_index + count;
+        unsigned int resolves = 0;
+
+        if (end > conn_udp->read_vector_count) {
+            end = conn_udp->read_vector_count;
+        }
+        utl_clock_now(&vl->clock, &ts);
+        resolves = vl_udp_batch_parse(vl, conn, start, end, index, &ts);
+        if (resolves > 0) {
+            utl_clock_now(&vl->clock, &ts);
+            vl_udp_batch_resolve(vl, conn, index, resolves, &ts);
+        }
+        utl_clock_now(&vl->clock, &ts);
+        count += vl_udp_batch_response_pack(vl, conn, start, end, index, &ts);
+    }
+    conn_udp->query_index_count = count;
+
+    conn_fifo_enqueue_write(&vl->conn_udp_write_queue, conn);
+}
+
+/** Vectorloop function parses newly received queries.
+ *
+ * When udp_pipeline_batch_len is set, UDP connection queries are instead
+ * taken through resolve and response pack as well, see
+ * @ref vl_udp_pipeline_fused.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of queries parsed.
+ */
+static int
+vl_fn_query_parse(vectorloop_t *vl)
+{
+    conn_t         *conn;
+    struct timespec ts;
+    int             count = 0;
+
+    if (vl->query_parse_queue.head == NULL) {
+        return 0;
+    }
+    /* Queries parsed in this step share a single stage timestamp. */
+    utl_clock_now(&vl->clock, &ts);
+
+    while ((conn = conn_fifo_dequeue_gen(&vl->query_parse_queue)) != NULL) {
+        if (conn->proto == 0) {
+            /* UDP conn. */
+            conn_udp_t *conn_udp = conn->conn.udp;
+
+            count += conn_udp->read_vector_count;
+            if (vl->cfg->udp_pipeline_batch_len > 0) {
+                vl_udp_pipeline_fused(vl, conn);
+                continue;
+            }
+            conn_udp->query_index_count =
+                vl_udp_batch_parse(vl, conn, 0, conn_udp->read_vector_count,
+                                   conn_udp->query_index, &ts);
+        } else {
+            /* TCP protocol. */
+            for (int i = 0; i < conn->conn.tcp->queries_count; i++) {
+                conn->conn.tcp->queries[i].parse_time = ts;
+                if (vl_query_acl(vl, &conn->conn.tcp->queries[i])) {
+                    vl_query_parse(vl, conn->cid, &conn->conn.tcp->queries[i],
+                                   query_parse_fast_header(&conn->conn.tcp->queries[i]));
+                }
+            }
+            count += conn->conn.tcp->queries_count;
+        }
+        /* All queries for conn parsed, send conn to resolve query queue. */
+        conn_fifo_enqueue_gen(&vl->query_resolve_queue, conn);
+    }
+    return count;
+}
+
+/** Start zone transfer resolved for TCP query. Client must match one of
+ * zone_transfer_allow networks, and connection may only have one zone
+ * transfer in progress, otherwise query is refused.
+ *
+ * Query of started zone transfer gets rip_ns_r_rip_xfr end code, so no
+ * response is packed for it; its messages are sent by
+ * @ref vl_fn_tcp_xfr() once other responses on connection are written.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection.
+ * @param q    Query resolved into zone transfer.
+ */
+static void
+vl_tcp_xfr_start(vectorloop_t *vl, conn_t *conn, query_t *q)
+{
+    conn_tcp_t *conn_tcp = conn->conn.tcp;
+    bool        allowed  = false;
+
+    for (size_t i = 0; i < vl->cfg->zone_transfer_allow_count && !allowed; i++) {
+        allowed = utl_net_match(&vl->cfg->zone_transfer_allow[i], &conn_tcp->client_ip);
+    }
+    if (!allowed || conn_tcp->xfr != NULL) {
+        q->end_code = rip_ns_r_refused;
+    } else {
+        conn_tcp->xfr = zone_xfr_stream_new(vl_query_zone_db(vl, q), q->xfr,
+                                            (const uint8_t *)q->request_hdr,
+                                            q->query_question_len);
+        if (conn_tcp->xfr == NULL) {
+            q->end_code = rip_ns_r_servfail;
+        } else {
+            conn_tcp->xfr_query = q;
+            q->end_code         = rip_ns_r_rip_xfr;
+        }
+    }
+    q->xfr = NULL;
+}
+
+/** Vectorloop function resolves newly parsed queries.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of queries resolved.
+ */
+static int
+vl_fn_query_resolve(vectorloop_t *vl)
+{
+    conn_t         *conn;
+    query_t        *queries;
+    struct timespec ts;
+    int             count = 0;
+
+    if (vl->query_resolve_queue.head == NULL) {
+        return 0;
+    }
+    /* Queries resolved in this step share a single stage timestamp. */
+    utl_clock_now(&vl->clock, &ts);
+
+    while ((conn = conn_fifo_dequeue_gen(&vl->query_resolve_queue)) != NULL) {
+        if (conn->proto == 0) {
+            /* UDP conn. */
+            conn_udp_t *conn_udp = conn->conn.udp;
+
+            /* Index column holds only queries that passed query_parse()
+             * checks.
+             */
+            vl_udp_batch_resolve(vl, conn, conn_udp->query_index,
+                                 conn_udp->query_index_count, &ts);
+            count += conn_udp->query_index_count;
+            /* All queries for conn resolved, send conn to response pack queue. */
+            conn_fifo_enqueue_gen(&vl->query_response_pack_queue, conn);
+
+        } else {
+            /* TCP */
+            conn_tcp_t *conn_tcp = conn->conn.tcp;
+
+            bool        wait     = false;
+
+            queries = conn_tcp->queries;
+            vl_query_coalesce_batch(vl);
+            for (int i = 0; i < conn_tcp->queries_count; i++) {
+                if (queries[i].end_code == rip_ns_r_rip_deferred) {
+                    /* Worker threads are done, resolve query again. */
+                    query_resolve_reset(&queries[i]);
+                    vl_query_view(vl, &queries[i]);
+                } else if (queries[i].end_code != -1) {
+                    /* End code for query is already set, meaning request
+                     * did not pass query_parse() checks or was resolved.
+                     */
+                    continue;
+                }
+                queries[i].resolve_time = ts;
+                vl_query_resolve(vl, conn->cid, &queries[i], true);
+                if (queries[i].xfr != NULL) {
+                    vl_tcp_xfr_start(vl, conn, &queries[i]);
+                }
+                if (queries[i].end_code == rip_ns_r_rip_deferred) {
+                    wait = true;
+                }
+                count++;
+            }
+            if (wait) {
+                /* Connection timer is disarmed while worker threads, which
+                 * always return, are waited for. It is armed again once
+                 * responses are packed.
+                 */
+                timer_wheel_disarm(&conn->timer);
+                conn_fifo_enqueue_gen(&vl->pending_tcp_queue, conn);
+                continue;
+            }
+            /* All queries for conn resolved, send conn to pack query queue. */  
+            conn_fifo_enqueue_gen(&vl->query_response_pack_queue, conn);
+        }
+    }
+    return count;
+}
+
+/** Pack query response into buffer suitable to be transmitted over network.
+ * TCP response to query carrying EDNS tcp-keepalive option is told idle
+ * timeout current TCP connection load allows, see @ref vl_tcp_keepalive(),
+ * and connection is then held to it.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of responses packed.
+ */
+static int
+vl_fn_query_response_pack(vectorloop_t *vl)
+{
+    conn_t         *conn;
+    query_t        *queries;
+    struct timespec ts;
+    int             count = 0;
+
+    if (vl->query_response_pack_queue.head == NULL) {
+        return 0;
+    }
+    /* Responses packed in this step share a single stage timestamp. */
+    utl_clock_now(&vl->clock, &ts);
+
+    while ((conn = conn_fifo_dequeue_gen(&vl->query_response_pack_queue)) != NULL) {
+        if (conn->proto == 0) {
+            /* UDP conn. */
+            conn_udp_t *conn_udp = conn->conn.udp;
+
+            conn_udp->query_index_count =
+                vl_udp_batch_response_pack(vl, conn, 0, conn_udp->read_vector_count,
+                                           conn_udp->query_index, &ts);
+            count += conn_udp->query_index_count;
+            /* All queries for conn parsed, send conn to UDP write query queue. */
+            conn_fifo_enqueue_write(&vl->conn_udp_write_queue, conn);
+
+        } else {
+            /* TCP */
+            conn_tcp_t *conn_tcp  = conn->conn.tcp;
+            size_t      keepalive = vl_tcp_keepalive(vl);
+            bool        told      = false;
+
+            queries = conn_tcp->queries;
+            for (int i = 0; i < conn_tcp->queries_count; i++) {
+                if (queries[i].end_code >= 0) {
+                    queries[i].pack_time = ts;
+                    vl_query_response_pack(vl, conn->cid, &queries[i]);
+                    /* Timeout is sent in units of 100 milliseconds. If option
+                     * does not fit, response is sent without it.
+                     */
+                    if (queries[i].edns.tcp_keepalive && queries[i].response_edns_offset > 0 &&
+                        query_response_pack_keepalive(&queries[i], keepalive / 100) == 0) {
+                        told = true;
+                    }
+                    count++;
+                }
+                /* else query has a custom end_code indicating that no
+                 * response is to be sent.
+                 */
+            }
+            /* Connection told idle timeout is held to it, see
+             * @ref vl_tcp_conn_state_set().
+             */
+            if (told && keepalive > 0) {
+                conn_tcp->tcp_keepalive = keepalive;
+            }
+            /* All queries for conn parsed, send conn to TCP write query queue. */
+            vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_WRITE);
+            conn_fifo_enqueue_write(&vl->conn_tcp_write_queue, conn);
+        }
+    }
+    return count;
+}
+
+/** Gather responses of TCP connection queries that are ready to be sent into
+ * connection write I/O vector, and set up connection write message to send
+ * it. Vector elements point directly to query response buffers, starting from
+ * where last write ended.
+ *
+ * @param conn TCP connection.
+ * @param cnt  Incremented by number of queries visited.
+ *
+ * @return     Returns number of elements in connection write I/O vector.
+ */
+static int
+vl_tcp_write_prepare(conn_t *conn, int *cnt)
+{
+    conn_tcp_t *conn_tcp  = conn->conn.tcp;
+    int         iov_count = 0;
+    size_t      offset    = 0;
+
+    for (size_t i = conn_tcp->query_write_index; i < conn_tcp->queries_count; i++) {
+        query_t *query = &conn_tcp->queries[i];
+        INCREMENT(*cnt);
+        if (query->end_code < 0) {
+            /* No response is to be sent for query. */
+            continue;
+        }
+        offset = i == conn_tcp->query_write_index ? conn_tcp->write_index : 0;
+        conn_tcp->write_iov[iov_count].iov_base = &query->response_buffer[offset];
+        conn_tcp->write_iov[iov_count].iov_len  = query->response_buffer_len - offset;
+        INCREMENT(iov_count);
+    }
+    conn_tcp->write_msg = (struct msghdr) {
+        .msg_iov    = conn_tcp->write_iov,
+        .msg_iovlen = iov_count,
+    };
+
+    return iov_count;
+}
+
+/** Move TCP connection whose responses were all written on, to zone transfer
+ * queue if it has zone transfer to send, otherwise to query log queue.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param conn TCP connection.
+ */
+static void
+vl_tcp_write_done(vectorloop_t *vl, conn_t *conn)
+{
+    if (conn->conn.tcp->xfr != NULL) {
+        vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_XFR);
+        conn_fifo_enqueue_write(&vl->conn_tcp_xfr_queue, conn);
+        return;
+    }
+    conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
+}
+
+/** Process result of writing TCP connection write I/O vector.
+ *
+ * On partial write, connection records query and offset in query response
+ * buffer to resume from, and is queued into new_queue so the rest is written
+ * in next vectorloop iteration. If all was written, or there was an error,
+ * connection is moved to query log queue.
+ *
+ * @param vl        Vectorloop operating on.
+ * @param conn      TCP connection.
+ * @param ret       Result of write, number of bytes written or -1 on error.
+ * @param err       Error (errno) if ret is -1.
+ * @param new_queue Queue to enqueue connection into on partial write.
+ */
+static void
+vl_tcp_write_complete(vectorloop_t *vl, conn_t *conn, ssize_t ret, int err,
+                      conn_fifo_queue_t *new_queue)
+{
+    conn_tcp_t     *conn_tcp  = conn->conn.tcp;
+    size_t          write_len = 0;
+    struct timespec ts;
+
+    if (ret < 0 && (err == EAGAIN || err == EWOULDBLOCK)) {
+        /* Need to wait for epoll to tell us when we can write again. */
+        conn->waiting_for_write = 1;
+        return;
+    }
+
+    if (ret <= 0) {
+        /* ret == 0 means connection was closed before we had a chance to
+         * send back responses. Otherwise some unrecoverable error occurred,
+         * could be that far end closed (reset) connection before we had a
+         * chance to send everything.
+         */
+        for (size_t i = conn_tcp->query_write_index; i < conn_tcp->queries_count; i++) {
+            query_t *query = &conn_tcp->queries[i];
+            if (query->end_code >= 0) {
+                query->end_code = ret == 0 ? rip_ns_r_rip_tcp_write_close :
+                                             rip_ns_r_rip_tcp_write_err;
+            }
+        }
+        if (conn_tcp->xfr != NULL) {
+            conn_tcp->xfr_query->end_code = ret == 0 ? rip_ns_r_rip_tcp_write_close :
+                                                       rip_ns_r_rip_tcp_write_err;
+        }
+        conn_tcp->state = ret == 0 ? TCP_CONN_ST_CLOSED_FOR_WRITE :
+                                     TCP_CONN_ST_WRITE_ERR;
+        utl_clock_now(&vl->clock, &conn_tcp->end_time);
+        conn_tcp->query_write_index = 0;
+        conn_tcp->write_index       = 0;
+
+        /* Move conn to log queue. */
+        conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
+        return;
+    }
+
+    /* Account for bytes written, query by query. Queries fully written by
+     * this write share a single end time.
+     */
+    conn_tcp->bytes_written += ret;
+    utl_clock_now(&vl->clock, &ts);
+    for (size_t i = conn_tcp->query_write_index; i < conn_tcp->queries_count; i++) {
+        query_t *query = &conn_tcp->queries[i];
+        if (query->end_code < 0) {
+            continue;
+        }
+        write_len = query->response_buffer_len - conn_tcp->write_index;
+        if ((size_t)ret < write_len) {
+            /* Partial write. Enqueue conn to try again next vector loop,
+             * don't enqueue to query log queue.
+             */
+            conn_tcp->query_write_index = i;
+            conn_tcp->write_index      += ret;
+            conn_fifo_enqueue_write(new_queue, conn);
+            return;
+        }
+        /* Full query written. */
+        ret -= write_len;
+        query->end_time = ts;
+        PROBE_QUERY(query__send, vl->id, conn->cid, query, query->end_time);
+        conn_tcp->write_index = 0;
+    }
+    conn_tcp->query_write_index = 0;
+
+    vl_tcp_write_done(vl, conn);
+}
+
+/** Vectorloop function sends responses to resolved queries over TCP
+ * connections.
+ *
+ * Responses of all queries of a connection that are ready to be sent are
+ * gathered into an I/O vector (see @ref vl_tcp_write_prepare()), and written
+ * with a single call to sendmsg(). MSG_NOSIGNAL is used so connection reset
+ * by far end is reported as EPIPE error instead of raising SIGPIPE.
+ * 
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns number of TCP queries processed.
+ */
+static int
+vl_fn_tcp_write(vectorloop_t *vl)
+{
+    conn_t           *conn;
+    conn_tcp_t       *conn_tcp  = NULL;
+    int               iov_count = 0;
+    ssize_t           ret       = 0;
+    conn_fifo_queue_t new_queue = {};
+    int               count     = 0;
+
+    while ((conn = conn_fifo_dequeue_write(&vl->conn_tcp_write_queue)) != NULL) {
+        conn_tcp  = conn->conn.tcp;
+        iov_count = vl_tcp_write_prepare(conn, &count);
+        if (iov_count == 0) {
+            /* Nothing to write, move conn on. */
+            conn_tcp->query_write_index = 0;
+            vl_tcp_write_done(vl, conn);
+            continue;
+        }
+
+        ret = sendmsg(conn->fd, &conn_tcp->write_msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        vl_tcp_write_complete(vl, conn, ret, errno, &new_queue);
+    }
+
+    /* Requeue any connections back into TCP write queue. */
+    if (new_queue.head != NULL) {
+        vl->conn_tcp_write_queue.head = new_queue.head;
+        vl->conn_tcp_write_queue.tail = new_queue.tail;
+        vl->conn_tcp_write_queue.len  = new_queue.len;
+    }
+
+    return count;
+}
+
+/** Vectorloop function sends zone transfers over TCP connections.
+ *
+ * Zone transfer messages are sent from zone image file with sendfile() (see
+ * @ref zone_xfr_stream_send()). At most loop_budget_xfr_bytes are sent per
+ * vectorloop iteration, so large transfers do not hold up queries. Transfers
+ * that made progress are requeued behind those that did not get to send, so
+ * budget is shared round robin. Finished transfer's query is logged with
+ * NOERROR end code.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns number of zone transfer sends that made progress.
+ */
+static int
+vl_fn_tcp_xfr(vectorloop_t *vl)
+{
+    conn_t           *conn;
+    conn_tcp_t       *conn_tcp;
+    query_t          *query;
+    conn_fifo_queue_t new_queue = {};
+    size_t            budget    = vl->cfg->loop_budget_xfr_bytes;
+    size_t            sent      = 0;
+    ssize_t           ret;
+    int               count     = 0;
+
+    if (budget == 0) {
+        budget = SIZE_MAX;
+    }
+    while (sent < budget &&
+           (conn = conn_fifo_dequeue_write(&vl->conn_tcp_xfr_queue)) != NULL) {
+        conn_tcp = conn->conn.tcp;
+        query    = conn_tcp->xfr_query;
+
+        ret = zone_xfr_stream_send(conn_tcp->xfr, conn->fd, budget - sent);
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            /* Need to wait for epoll to tell us when we can write again. */
+            conn->waiting_for_write = 1;
+            continue;
+        }
+        if (ret > 0) {
+            conn_tcp->bytes_written += ret;
+        }
+        if (ret < 0 || zone_xfr_stream_done(conn_tcp->xfr)) {
+            if (ret < 0) {
+                query->end_code = rip_ns_r_rip_tcp_write_err;
+                conn_tcp->state = TCP_CONN_ST_WRITE_ERR;
+                utl_clock_now(&vl->clock, &conn_tcp->end_time);
+            } else {
+                query->end_code = rip_ns_r_noerror;
+            }
+            utl_clock_now(&vl->clock, &query->end_time);
+            zone_xfr_stream_free(conn_tcp->xfr);
+            conn_tcp->xfr = NULL;
+
+            /* Move conn to log queue. */
+            conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
+            count++;
+            continue;
+        }
+
+        /* Transfer progressed, it has send timeout again for the rest. */
+        sent += ret;
+        count++;
+        vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_XFR);
+        conn_fifo_enqueue_write(&new_queue, conn);
+    }
+
+    /* Requeue transfers that made progress behind those still waiting. */
+    while ((conn = conn_fifo_dequeue_write(&new_queue)) != NULL) {
+        conn_fifo_enqueue_write(&vl->conn_tcp_xfr_queue, conn);
+    }
+
+    return count;
+}
+
+/** Check if two UDP read vector messages are from same client to same local
+ * address, so their responses may be sent in single UDP GSO message.
+ *
+ * @param a Read vector message.
+ * @param b Read vector message.
+ *
+ * @return  Returns true if client and local address match.
+ */
+static inline bool
+vl_udp_same_path(struct msghdr *a, struct msghdr *b)
+{
+    return a->msg_namelen == b->msg_namelen &&
+           a->msg_controllen == b->msg_controllen &&
+           memcmp(a->msg_name, b->msg_name, a->msg_namelen) == 0 &&
+           memcmp(a->msg_control, b->msg_control, a->msg_controllen) == 0;
+}
+
+/** Count responses, starting at position j of query index column, that can
+ * be sent as segments of single UDP GSO message along with response at
+ * position j. All segments but last must be of same length as first one,
+ * last may be shorter, and all go to same client from same local address.
+ *
+ * @param conn_udp UDP connection.
+ * @param j        Position in query index column of first response.
+ *
+ * @return         Returns number of responses (segments), at least 1.
+ */
+static unsigned int
+vl_udp_gso_segments(conn_udp_t *conn_udp, unsigned int j)
+{
+    query_t     *queries = conn_udp->queries;
+    uint16_t    *index   = conn_udp->query_index;
+    unsigned int first   = index[j];
+    size_t       seg_len = queries[first].response_buffer_len;
+    unsigned int segs    = 1;
+
+    if (seg_len > UDP_GSO_SEGMENT_LEN_MAX) {
+        return 1;
+    }
+    while (j + segs < conn_udp->query_index_count &&
+           segs < UDP_GSO_SEGMENTS_MAX &&
+           (segs + 1) * seg_len <= UDP_GSO_BYTES_MAX) {
+        unsigned int i = index[j + segs];
+
+        if (queries[i].response_buffer_len > seg_len ||
+            !vl_udp_same_path(&conn_udp->read_vector[first].msg_hdr,
+                              &conn_udp->read_vector[i].msg_hdr)) {
+            break;
+        }
+        segs++;
+        if (queries[i].response_buffer_len < seg_len) {
+            /* Shorter segment can only be the last one. */
+            break;
+        }
+    }
+
+    return segs;
+}
+
+/** Populate UDP connection write vector from responses of queries that are
+ * ready to be sent. If previous write was partial, write vector is left as is
+ * so write resumes from write_vector_write_index.
+ *
+ * If UDP GSO is enabled, consecutive responses to same client are sent as
+ * one message with UDP_SEGMENT control message set to response length, and
+ * kernel splits it into a datagram per response.
+ *
+ * @param conn_udp UDP connection.
+ *
+ * @return         Returns number of messages to send, starting with
+ *                 write_vector_write_index.
+ */
+static unsigned int
+vl_udp_write_prepare(conn_udp_t *conn_udp)
+{
+    struct mmsghdr *read_vector        = conn_udp->read_vector;
+    struct mmsghdr *write_vector       = conn_udp->write_vector;
+    struct iovec   *write_iov          = conn_udp->write_iov;
+    query_t        *queries            = conn_udp->queries;
+    unsigned int    write_vector_count = 0;
+    unsigned int    segs               = 1;
+
+    if (conn_udp->write_vector_write_index > 0) {
+        return conn_udp->write_vector_count;
+    }
+
+    /* Populate write vector from queries response pack left in index
+     * column, priority lane queries first.
+     */
+    if (conn_udp->priority_count > 0) {
+        conn_udp_priority_first(queries, conn_udp->query_index, conn_udp->query_index_count);
+    }
+    for (unsigned int j = 0; j < conn_udp->query_index_count; j += segs) {
+        unsigned int   i       = conn_udp->query_index[j];
+        struct msghdr *msg_hdr = &write_vector[write_vector_count].msg_hdr;
+
+        segs = conn_udp->write_control != NULL ? vl_udp_gso_segments(conn_udp, j) : 1;
+        for (unsigned int k = 0; k < segs; k++) {
+            query_t *q = &queries[conn_udp->query_index[j + k]];
+
+            write_iov[j + k].iov_base = q->response_buffer;
+            write_iov[j + k].iov_len  = q->response_buffer_len;
+        }
+
+        msg_hdr->msg_control    = read_vector[i].msg_hdr.msg_control;
+        msg_hdr->msg_controllen = read_vector[i].msg_hdr.msg_controllen;
+        msg_hdr->msg_flags      = 0;
+        msg_hdr->msg_iov        = &write_iov[j];
+        msg_hdr->msg_iovlen     = segs;
+        msg_hdr->msg_name       = read_vector[i].msg_hdr.msg_name;
+        msg_hdr->msg_namelen    = read_vector[i].msg_hdr.msg_namelen;
+        if (segs > 1) {
+            /* Copy packet info and append segment size to it. */
+            unsigned char  *control = conn_udp->write_control +
+                                      write_vector_count * UDP_GSO_CONTROL_LEN;
+            size_t          len     = CMSG_ALIGN(msg_hdr->msg_controllen);
+            struct cmsghdr *cmsg    = (struct cmsghdr *)(control + len);
+            uint16_t        seg_len = queries[i].response_buffer_len;
+
+            memcpy(control, msg_hdr->msg_control, msg_hdr->msg_controllen);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            memcpy(CMSG_DATA(cmsg), &seg_len, sizeof(uint16_t));
+
+            msg_hdr->msg_control    = control;
+            msg_hdr->msg_controllen = len + CMSG_SPACE(sizeof(uint16_t));
+        }
+        conn_udp->write_query_start[write_vector_count] = j;
+        write_vector_count += 1;
+    }
+    conn_udp->write_query_start[write_vector_count] = conn_udp->query_index_count;
+    conn_udp->write_vector_count = write_vector_count;
+
+    return write_vector_count;
+}
+
+/** Process result of sending UDP connection write vector.
+ *
+ * @param vl        Vectorloop operating on.
+ * @param conn      UDP connection.
+ * @param ret       Result of send, number of messages sent or -1 on error.
+ * @param err       Error (errno) if ret is -1.
+ * @param new_queue Queue to enqueue connection into if not all messages were
+ *                  sent.
+ */
+static void
+vl_udp_write_complete(vectorloop_t *vl, conn_t *conn, int ret, int err,
+                      conn_fifo_queue_t *new_queue)
+{
+    conn_udp_t *conn_udp = conn->conn.udp;
+    query_t    *queries  = conn_udp->queries;
+
+    /* Set query end time. Write vector holds only queries a response is
+     * sent for, message k of write vector sends responses of index column
+     * positions write_query_start[k] up to write_query_start[k+1].
+     */
+    if (ret > 0) {
+        struct timespec ts;
+        unsigned int    first = conn_udp->write_vector_write_index;
+        unsigned int    start = conn_udp->write_query_start[first];
+        unsigned int    end   = conn_udp->write_query_start[first + ret];
+
+        utl_clock_now(&vl->clock, &ts);
+        for (unsigned int j = start; j < end; j++) {
+            queries[conn_udp->query_index[j]].end_time = ts;
+            PROBE_QUERY(query__send, vl->id, 0, &queries[conn_udp->query_index[j]], ts);
+        }
+        METRICS_ADD(vl->metrics_vl->udp.send_msgs, ret);
+        if (end - start > (unsigned int)ret) {
+            /* Some messages were UDP GSO messages. */
+            for (unsigned int k = first; k < first + ret; k++) {
+                unsigned int segs = conn_udp->write_query_start[k + 1] -
+                                    conn_udp->write_query_start[k];
+                if (segs > 1) {
+                    METRICS_ADD(vl->metrics_vl->udp.responses_gso, segs);
+                }
+            }
+        }
+    }
+
+    if (ret == conn_udp->write_vector_count) {
+        /* All messages sent out, move conn to log queue. */
+        conn_fifo_enqueue_gen(&vl->query_log_queue, conn);
+    } else if (ret < 0) {
+        /* Error sending.*/
+        if (err == EWOULDBLOCK || err == EAGAIN) {
+            /* Need to wait for writable. When epoll event that this conn
+             * is writable arrives, this conn will be put back into
+             * conn_udp_write_queue so queries could be sent.
+             */
+            conn->waiting_for_write = 1;
+            if (conn_udp->listener->conn.udp->batches_free == 0) {
+                /* Listener stops receiving until a batch is sent. */
+                METRICS_INC(vl->metrics_vl->udp.batches_full);
+            }
+        } else {
+            /* UDP write error occurred. */
+            channel_log_error(vl->app_log_channel, APP_LOG_ERR_VL_FN_UDP_WRITE, err);
+
+            /* Put conn back into write queue. */
+            conn_fifo_enqueue_write(new_queue, conn);
+        }
+    } else {
+        /* (ret != write_vector_count)
+         * Not all messages were sent, need to try again. Update marker
+         * where to start sending messages from and update vector count.
+         */
+        conn_udp->write_vector_write_index += ret;
+        conn_udp->write_vector_count       -= ret;
+
+        /* Put conn back into write queue! */
+        conn_fifo_enqueue_write(new_queue, conn);
+    }
+}
+
+/** Vectorloop function that writes DNS query responses on UDP connections.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of UDP queries responses sent.
+ */
+static int
+vl_fn_udp_write(vectorloop_t *vl)
+{
+    conn_t           *conn;
+    conn_udp_t       *conn_udp  = NULL;
+    int               ret       = 0;
+    int               count     = 0;
+    unsigned int      msg_count = 0;
+    conn_fifo_queue_t new_queue = {};
+
+    while ((conn = conn_fifo_dequeue_write(&vl->conn_udp_write_queue)) != NULL) {
+        conn_udp  = conn->conn.udp;
+        msg_count = vl_udp_write_prepare(conn_udp);
+
+        if (conn->replay) {
+            ret = vl_replay_send(vl->replay, conn_udp);
+        } else if (conn->xdp) {
+            ret = vl_xdp_send(&vl->xdp, conn_udp, vl->cfg->udp_listener_port);
+        } else {
+            ret = sendmmsg(conn->fd,
+                           &conn_udp->write_vector[conn_udp->write_vector_write_index],
+                           msg_count,
+                           0);
+        }
+        if (ret > 0) {
+            count += ret;
+        }
+        vl_udp_write_complete(vl, conn, ret, errno, &new_queue);
+    }
+
+    /* Requeue any connections back into UDP write queue. */
+    if (new_queue.head != NULL) {
+        vl->conn_udp_write_queue.head = new_queue.head;
+        vl->conn_udp_write_queue.tail = new_queue.tail;
+        vl->conn_udp_write_queue.len  = new_queue.len;
+    }
+
+    return count;
+}
+
+/** Submit writes prepared in vectorloop io_uring, wait for them to complete,
+ * and process their results.
+ *
+ * @param vl        Vectorloop operating on.
+ * @param udp_conns UDP connections that have messages submitted.
+ * @param udp_queue Queue to enqueue UDP connections into if not all messages
+ *                  were sent.
+ * @param tcp_queue Queue to enqueue TCP connections into on partial write.
+ */
+static void
+vl_uring_write_flush(vectorloop_t *vl, conn_fifo_queue_t *udp_conns,
+                     conn_fifo_queue_t *udp_queue, conn_fifo_queue_t *tcp_queue)
+{
+    struct io_uring_cqe *cqe;
+    conn_t              *conn;
+    conn_udp_t          *conn_udp;
+
+    vl_uring_submit_and_wait(&vl->uring);
+
+    while ((cqe = vl_uring_peek_cqe(&vl->uring)) != NULL) {
+        conn = (conn_t *)(uintptr_t)cqe->user_data;
+        if (conn->proto == 0) {
+            /* UDP messages of a connection are linked, so once one fails to
+             * send the rest are cancelled, and messages sent are the ones
+             * before it.
+             */
+            conn_udp = conn->conn.udp;
+            if (cqe->res >= 0 && conn_udp->write_errno == 0) {
+                INCREMENT(conn_udp->write_vector_sent);
+            } else if (conn_udp->write_errno == 0) {
+                conn_udp->write_errno = -cqe->res;
+            }
+        } else {
+            vl_tcp_write_complete(vl, conn, cqe->res < 0 ? -1 : cqe->res,
+                                  -cqe->res, tcp_queue);
+        }
+        vl_uring_cqe_seen(&vl->uring);
+    }
+
+    while ((conn = conn_fifo_dequeue_write(udp_conns)) != NULL) {
+        conn_udp = conn->conn.udp;
+        if (conn_udp->write_vector_sent == 0 && conn_udp->write_errno != 0) {
+            vl_udp_write_complete(vl, conn, -1, conn_udp->write_errno, udp_queue);
+        } else {
+            vl_udp_write_complete(vl, conn, conn_udp->write_vector_sent, 0, udp_queue);
+        }
+    }
+}
+
+/** Vectorloop function that writes DNS query responses on UDP and TCP
+ * connections via io_uring.
+ *
+ * A sendmsg submission is prepared for each UDP message and for each TCP
+ * connection (its write I/O vector, see @ref vl_tcp_write_prepare()). All are submitted with a single system call,
+ * unless there are more than io_uring submission queue holds.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns number of UDP queries responses sent plus number of TCP
+ *           queries processed.
+ */
+static int
+vl_fn_uring_write(vectorloop_t *vl)
+{
+    conn_t              *conn;
+    conn_udp_t          *conn_udp  = NULL;
+    conn_tcp_t          *conn_tcp  = NULL;
+    struct io_uring_sqe *sqe;
+    unsigned int         msg_count = 0;
+    int                  iov_count = 0;
+    int                  count     = 0;
+    conn_fifo_queue_t    udp_conns = {};
+    conn_fifo_queue_t    udp_queue = {};
+    conn_fifo_queue_t    tcp_queue = {};
+
+    while ((conn = conn_fifo_dequeue_write(&vl->conn_udp_write_queue)) != NULL) {
+        conn_udp  = conn->conn.udp;
+        msg_count = vl_udp_write_prepare(conn_udp);
+        if (msg_count == 0) {
+            vl_udp_write_complete(vl, conn, 0, 0, &udp_queue);
+            continue;
+        }
+        if (conn->xdp) {
+            /* AF_XDP transmit ring is written to directly. */
+            int ret = vl_xdp_send(&vl->xdp, conn_udp, vl->cfg->udp_listener_port);
+
+            count += ret;
+            vl_udp_write_complete(vl, conn, ret, 0, &udp_queue);
+            continue;
+        }
+
+        if (vl_uring_sq_space(&vl->uring) < msg_count) {
+            vl_uring_write_flush(vl, &udp_conns, &udp_queue, &tcp_queue);
+            if (vl_uring_sq_space(&vl->uring) < msg_count) {
+                /* Rest is sent in next vectorloop iteration. */
+                msg_count = vl_uring_sq_space(&vl->uring);
+            }
+        }
+
+        conn_udp->write_vector_sent = 0;
+        conn_udp->write_errno       = 0;
+        for (unsigned int i = 0; i < msg_count; i++) {
+            sqe = vl_uring_get_sqe(&vl->uring);
+            vl_uring_prep_sendmsg(sqe, conn->fd,
+                &conn_udp->write_vector[conn_udp->write_vector_write_index + i].msg_hdr,
+                0, (uint64_t)(uintptr_t)conn);
+            if (i + 1 < msg_count) {
+                sqe->flags |= IOSQE_IO_LINK;
+            }
+        }
+        count += msg_count;
+        conn_fifo_enqueue_write(&udp_conns, conn);
+    }
+
+    while ((conn = conn_fifo_dequeue_write(&vl->conn_tcp_write_queue)) != NULL) {
+        conn_tcp  = conn->conn.tcp;
+        iov_count = vl_tcp_write_prepare(conn, &count);
+        if (iov_count == 0) {
+            /* Nothing to write, move conn on. */
+            conn_tcp->query_write_index = 0;
+            vl_tcp_write_done(vl, conn);
+            continue;
+        }
+
+        if (vl_uring_sq_space(&vl->uring) == 0) {
+            vl_uring_write_flush(vl, &udp_conns, &udp_queue, &tcp_queue);
+        }
+        sqe = vl_uring_get_sqe(&vl->uring);
+        vl_uring_prep_sendmsg(sqe, conn->fd, &conn_tcp->write_msg, MSG_NOSIGNAL,
+                              (uint64_t)(uintptr_t)conn);
+    }
+
+    vl_uring_write_flush(vl, &udp_conns, &udp_queue, &tcp_queue);
+
+    /* Requeue any connections back into UDP and TCP write queues. */
+    if (udp_queue.head != NULL) {
+        vl->conn_udp_write_queue.head = udp_queue.head;
+        vl->conn_udp_write_queue.tail = udp_queue.tail;
+        vl->conn_udp_write_queue.len  = udp_queue.len;
+    }
+    if (tcp_queue.head != NULL) {
+        vl->conn_tcp_write_queue.head = tcp_queue.head;
+        vl->conn_tcp_write_queue.tail = tcp_queue.tail;
+        vl->conn_tcp_write_queue.len  = tcp_queue.len;
+    }
+
+    return count;
+}
+
+/** Log a query into vectorloop's active query log chunk. If chunk is full it
+ * is published and query is logged into next chunk.
+ * 
+ * @param vl  Vectorloop operating on.
+ * @param cid Connection ID query was received on, 0 for UDP.
+ * @param q   Query to log.
+ * 
+ * @return    Returns number of bytes logged, 0 if query was not logged.
+ */
+static inline int
+vl_query_log(vectorloop_t *vl, uint64_t cid, query_t *q)
+{
+    int len;
+
+    PROBE_QUERY(query__log, vl->id, cid, q, q->end_time);
+
+    if (vl->overload.level >= VL_OVERLOAD_SHED_LOG) {
+        METRICS_INC(vl->metrics_vl->overload.log_skipped);
+        return 0;
+    }
+    if (query_log_filter(vl->cfg, q, &vl->query_log_sample_count) == false) {
+        METRICS_INC(vl->metrics_vl->app.query_log_filtered);
+        return 0;
+    }
+    if (vl->query_log_backlog) {
+        /* Query log ring is full, stretch active chunk by sampling. */
+        if (++vl->query_log_full_sample_count < vl->cfg->query_log_full_sample_rate) {
+            METRICS_INC(vl->metrics_vl->app.query_log_sampled_out);
+            return 0;
+        }
+        vl->query_log_full_sample_count = 0;
+    }
+
+    if (vl->query_log.spill_len == 0) {
+        len = query_log(vl->query_log.buf + vl->query_log.buf_len,
+                        vl->query_log.buf_size - vl->query_log.buf_len, q);
+    } else {
+        /* Queries spilled before are logged first, spill to keep order. */
+        len = -1;
+    }
+
+    if (len == 0) {
+        /* Active chunk is full, publish it and retry in next chunk. */
+        if (query_log_publish(&vl->query_log) == true) {
+            len = query_log(vl->query_log.buf, vl->query_log.buf_size, q);
+        } else {
+            /* Query log thread is behind, all chunks are in use. */
+            METRICS_INC(vl->metrics_vl->app.query_log_ring_full);
+            vl->query_log_backlog = vl->cfg->query_log_full_policy == QUERY_LOG_FULL_SAMPLE;
+        }
+    }
+    if (len <= 0 && vl->query_log.spill != NULL) {
+        len = query_log_spill(&vl->query_log, q, utl_timespec_to_ns(&vl->loop_timestamp));
+        if (len > 0) {
+            METRICS_INC(vl->metrics_vl->app.query_log_spilled);
+            return len;
+        }
+    }
+    if (len > 0) {
+        vl->query_log.buf_len += len;
+    } else {
+        /* error logging query, not enough room in buf. */
+        METRICS_INC(vl->metrics_vl->app.query_log_buf_no_space);
+        query_log_drop(&vl->query_log);
+        return 0;
+    }
+    return len;
+}
+
+/** Vectorloop function to log processed DNS queries. Queries logged are
+ * published to query log thread at end of function, see
+ * @ref query_log_publish.
+ * 
+ * @param vl Vectorloop operating on.
+ * 
+ * @return   Returns number of query log bytes written.
+ */
+static int
+vl_fn_query_log(vectorloop_t *vl)
+{
+    conn_t     *conn;
+    conn_udp_t *conn_udp;
+    conn_tcp_t *conn_tcp;
+    int         bytes = 0;
+    size_t      aged;
+
+    /* Query counters are summed on stack and published once per batch. */
+    metrics_query_batch_t batch = {0};
+
+    if (vl->metrics_sketch != NULL) {
+        metrics_sketch_vl_sync(vl->metrics_sketch);
+    }
+
+    /* Move queries spilled while query log ring was full to chunks handed
+     * back since, queries logged below follow them.
+     */
+    if (vl->query_log.spill_len > 0) {
+        query_log_spill_drain(&vl->query_log, utl_timespec_to_ns(&vl->loop_timestamp),
+                              (uint64_t)vl->cfg->query_log_age_max * 1000000, &aged);
+        METRICS_ADD(vl->metrics_vl->app.query_log_aged, aged);
+    }
+    if (vl->query_log_backlog) {
+        vl->query_log_backlog = query_log_backlogged(&vl->query_log);
+    }
+
+    while ((conn = conn_fifo_dequeue_gen(&vl->query_log_queue)) != NULL) {
+        if (CONN_IS_UDP_LISTENER(conn)) {
+            /* UDP */
+            conn_udp = conn->conn.udp;
+
+            for (int i =0; i < conn_udp->read_vector_count; i++) {
+                if (conn_udp->queries[i].end_code == rip_ns_r_rip_deferred) {
+                    /* Logged from pending slot query was detached to. */
+                    continue;
+                }
+                bytes += vl_query_log(vl, 0, &conn_udp->queries[i]);
+                query_report_metrics(&conn_udp->queries[i], &batch, vl->metrics_vl,
+                                     vl->metrics_sketch, vl->metrics_zones,
+                                     vl->metrics_cost);
+            }
+            query_report_metrics_flush(&batch, vl->metrics_vl);
+
+            /* Free batch, move listeners to read queue if they waited for
+             * it.
+             */
+            conn = conn_udp_batch_release(conn);
+            if (conn != NULL) {
+                conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+            }
+            while ((conn = conn_fifo_dequeue_gen(&vl->conn_udp_batch_wait_queue)) != NULL) {
+                conn->conn.udp->waiting_for_batch = 0;
+                conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+            }
+
+        } else if (CONN_IS_TCP_CONN(conn)) {
+            /* TCP */
+            conn_tcp = conn->conn.tcp;
+
+            for (int i = 0; i < conn_tcp->queries_count; i++) {
+                bytes += vl_query_log(vl, conn->cid, &conn_tcp->queries[i]);
+                query_report_metrics(&conn_tcp->queries[i], &batch, vl->metrics_vl,
+                                     vl->metrics_sketch, vl->metrics_zones,
+                                     vl->metrics_cost);
+                /* Response is sent and logged, return larger response buffer. */
+                query_tcp_response_buffer_release(&conn_tcp->queries[i]);
+            }
+            query_report_metrics_flush(&batch, vl->metrics_vl);
+
+            /* If TCP connection is closed for write release conn oject. */
+            if (conn_tcp->state == TCP_CONN_ST_CLOSED_FOR_WRITE ||
+                conn_tcp->state == TCP_CONN_ST_WRITE_ERR) {
+                conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
+                continue;
+            }
+
+            /* All messages sent. Consume queries from read buffer, any extra
+             * data (not associated with query) is left in place for next read
+             * to frame. Set the timeout appropriately.
+             */
+            size_t data_len   = 0;
+            for (int i = 0; i < conn_tcp->queries_count; i++) {
+                data_len += conn_tcp->queries[i].request_buffer_len + 2;
+            }
+            size_t data_extra = conn_tcp->read_buffer_len - data_len;
+            if (data_extra > 0) {
+                conn_tcp->read_buffer_offset += data_len;
+                vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY_DATA);
+            } else {
+                conn_tcp->read_buffer_offset = 0;
+                vl_tcp_conn_state_set(vl, conn, TCP_CONN_ST_WAIT_FOR_QUERY);
+            }
+            conn_tcp->read_buffer_len = data_extra;
+
+            /* Move conn to read queue. */
+            conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
+        }
+    }
+
+    /* Publish logged queries. If query log thread is behind and no chunk is
+     * free, keep logging into active chunk.
+     */
+    query_log_publish(&vl->query_log);
+
+    return bytes;
+}
+
+/** Resume deferred UDP query in pending slot by resolving it again, send
+ * its response, then log query and free slot. Query deferred again, e.g. for
+ * another RRset of its answer, is left in slot.
+ *
+ * @param vl Vectorloop operating on.
+ * @param w  Pending UDP query slot.
+ * @param ts Resolve timestamp.
+ */
+static void
+vl_udp_query_resume(vectorloop_t *vl, vl_pending_udp_t *w, struct timespec *ts)
+{
+    query_t              *q     = &w->q;
+    metrics_query_batch_t batch = {0};
+    struct iovec          iov;
+    struct msghdr         msg;
+
+    query_resolve_reset(q);
+    vl_query_view(vl, q);
+    q->resolve_time = *ts;
+    /* Query is packed right away, it is a batch of its own. */
+    vl_query_coalesce_batch(vl);
+    vl_query_resolve(vl, 0, q, true);
+    if (q->end_code == rip_ns_r_rip_deferred) {
+        return;
+    }
+
+    if (q->end_code >= 0) {
+        q->pack_time = *ts;
+        vl_query_response_pack(vl, 0, q);
+        if (vl->rrl.buckets != NULL && q->end_code >= 0 &&
+            !q->edns.cookie.server_cookie_valid && !q->priority) {
+            vl_query_response_rrl(vl, q);
+        }
+    }
+    if (q->end_code >= 0) {
+        iov = (struct iovec) {
+            .iov_base = q->response_buffer,
+            .iov_len  = q->response_buffer_len,
+        };
+        msg = (struct msghdr) {
+            .msg_name       = q->client_ip,
+            .msg_namelen    = w->client_ip_len,
+            .msg_iov        = &iov,
+            .msg_iovlen     = 1,
+            .msg_control    = w->control_len > 0 ? w->control : NULL,
+            .msg_controllen = w->control_len,
+        };
+        if (sendmsg(w->listener->fd, &msg, MSG_DONTWAIT) < 0) {
+            channel_log_error(vl->app_log_channel, APP_LOG_ERR_VL_FN_UDP_WRITE, errno);
+        } else {
+            METRICS_INC(vl->metrics_vl->udp.send_msgs);
+        }
+    }
+    utl_clock_now(&vl->clock, &q->end_time);
+
+    vl_query_log(vl, 0, q);
+    query_report_metrics(q, &batch, vl->metrics_vl, vl->metrics_sketch, vl->metrics_zones,
+                         vl->metrics_cost);
+    query_report_metrics_flush(&batch, vl->metrics_vl);
+
+    w->listener = NULL;
+    DECREMENT(vl->pending_udp_count);
+}
+
+/** Vectorloop function collects jobs worker threads are done with and
+ * completes them, e.g. RRSIG records signed are added to signature cache.
+ * Deferred queries are then resumed by resolving them again: TCP connections
+ * go back to resolve queue, and responses to pending UDP queries are sent
+ * from here.
+ *
+ * @param vl Vectorloop operating on.
+ *
+ * @return   Returns number of jobs collected.
+ */
+static int
+vl_fn_query_resume(vectorloop_t *vl)
+{
+    worker_job_t   *job;
+    dnssec_sig_t   *sig;
+    conn_t         *conn;
+    struct timespec ts;
+    int             count = 0;
+
+    /* Entries used by queries of previous iteration may now be evicted. */
+    vl->dnssec_sig_cache.epoch++;
+
+    while ((job = worker_pool_done(&vl->workers)) != NULL) {
+        INCREMENT(count);
+        switch (job->type) {
+        case WORKER_JOB_DNSSEC_SIGN:
+            sig = (dnssec_sig_t *)job;
+            if (sig->state == DNSSEC_SIG_ST_READY) {
+                METRICS_INC(vl->metrics_vl->dnssec.signatures);
+            } else {
+                METRICS_INC(vl->metrics_vl->dnssec.sign_errors);
+            }
+            dnssec_sig_cache_done(&vl->dnssec_sig_cache, sig);
+            break;
+        default:
+            /* Coding error. */
+            assert(0);
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    while ((conn = conn_fifo_dequeue_gen(&vl->pending_tcp_queue)) != NULL) {
+        conn_fifo_enqueue_gen(&vl->query_resolve_queue, conn);
+    }
+    if (vl->pending_udp_count > 0) {
+        utl_clock_now(&vl->clock, &ts);
+        for (size_t i = 0; i < VL_PENDING_UDP_MAX; i++) {
+            if (vl->pending_udp[i].listener != NULL) {
+                vl_udp_query_resume(vl, &vl->pending_udp[i], &ts);
+            }
+        }
+    }
+
+    return count;
+}
+
+/** Vectorloop function to advance TCP connection timer wheel and release
+ * connections whose timer expired. Connection state at time of expiry
+ * identifies which timeout occurred.
+ * 
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_tcp_conn_timeouts(vectorloop_t *vl)
+{
+    timer_wheel_node_t *node = timer_wheel_advance(&vl->conn_tcp_timers, vl->loop_time_ms);
+    timer_wheel_node_t *next = NULL;
+    conn_t             *conn;
+
+    while (node != NULL) {
+        next = node->next;
+        conn = TIMER_WHEEL_ENTRY(node, conn_t, timer);
+        PROBE_TCP_CONN(tcp__timeout, vl->id, conn);
+        conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
+        node = next;
+    }
+}
+
+/** Vectorloop function to release TCP connection objects. These are TCP
+ * connections that have ended.
+ * 
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_tcp_conn_release(vectorloop_t *vl)
+{
+    conn_t *conn;
+
+    while ((conn = conn_fifo_dequeue_release(&vl->conn_tcp_release_queue)) != NULL) {
+        vl_tcp_conn_release(vl, conn);
+    }
+}
+
+/** Create io_uring used to send query responses. Submission queue is sized to
+ * hold messages of both UDP listeners. If io_uring can not be created, error
+ * is logged and responses are sent via sendmmsg() and sendmsg().
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_uring_start(vectorloop_t *vl)
+{
+    size_t entries = vl->cfg->udp_conn_vector_len * 2;
+    int    err     = 0;
+
+    if (entries < VL_URING_ENTRIES_MIN) {
+        entries = VL_URING_ENTRIES_MIN;
+    } else if (entries > VL_URING_ENTRIES_MAX) {
+        entries = VL_URING_ENTRIES_MAX;
+    }
+
+    err = vl_uring_init(&vl->uring, entries);
+    if (err < 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_uring_start: io_uring not available, %s", strerror(-err));
+    }
+}
+
+/** Register UDP listener on AF_XDP socket bound to vectorloop receive queue,
+ * see @ref vl_xdp_queue_id(). Listener receives both IPv4 and IPv6 queries,
+ * and its responses are limited to what fits a single frame, larger ones are
+ * truncated. If AF_XDP socket can not be created, error is logged and queries
+ * are received on kernel UDP listeners only.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_register_listener_xdp(vectorloop_t *vl)
+{
+    unsigned int queue_id = vl_xdp_queue_id(vl->cfg, vl->id);
+    conn_t      *conn     = NULL;
+    int          err      = 0;
+
+    err = vl_xdp_init(&vl->xdp, vl->xdp_prog, queue_id, vl->cfg->udp_conn_vector_len,
+                      vl->cfg->xdp_busy_poll);
+    if (err < 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_register_listener_xdp: AF_XDP socket on "
+                          "queue %u not available, %s", queue_id, strerror(-err));
+        return;
+    }
+    if (vl->cfg->xdp_busy_poll > 0 && !vl->xdp.busy_poll) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_register_listener_xdp: AF_XDP socket on "
+                          "queue %u can not busy poll, interrupt driven", queue_id);
+    }
+
+    conn = mem_malloc(MEM_TAG_UDP, sizeof(conn_t));
+    CHECK_MALLOC(conn);
+    *conn = (conn_t) {
+        .fd       = vl->xdp.fd,
+        .lc       = 0,
+        .proto    = 0,
+        .xdp      = 1,
+        .conn.udp = conn_udp_new(vl->cfg, AF_INET6, &vl->arena),
+    };
+    /* Frames are received into AF_XDP socket UMEM, listener has a single
+     * batch.
+     */
+    conn_udp_batches_new(conn, vl->cfg, 1, &vl->arena);
+    for (unsigned int i = 0; i < conn->conn.udp->vector_len; i++) {
+        conn->conn.udp->queries[i].response_buffer_size = vl->xdp.payload_max;
+    }
+
+    /* Register AF_XDP socket to epoll for read & write edge triggered. */
+    vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+
+    /* Add AF_XDP listener to Vectorloop UDP read queue. */
+    conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+
+    vl->listener_xdp = conn;
+    debug_printf("VL ID %d AF_XDP UDP listener started on queue %u, %s mode%s", vl->id,
+                 queue_id, vl->xdp.zero_copy ? "zero copy" : "copy",
+                 vl->xdp.busy_poll ? ", busy polling" : "");
+}
+
+/** Add listener to its reuseport group steering, if steering is used and
+ * vectorloop is bound to a CPU (or always when steering by client, at slot of
+ * vectorloop). If listener can not be added error is logged and listener gets
+ * packets by hash.
+ *
+ * @param vl    Vectorloop operating on.
+ * @param conn  Listener connection.
+ * @param group Reuseport group of listener.
+ */
+static void
+vl_reuseport_listener_join(vectorloop_t *vl, conn_t *conn, vl_reuseport_group_t group)
+{
+    size_t cpu = vl->cfg->process_thread_masks[vl->id];
+    int    err = 0;
+
+    if (vl->reuseport != NULL && vl->reuseport->client) {
+        unsigned int slot = vl_reuseport_client_slot(vl->cfg, group, vl->id);
+
+        err = vl_reuseport_join(vl->reuseport, group, conn->fd, slot);
+        if (err < 0) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_reuseport_listener_join: listener not "
+                              "steered to slot %u, %s", slot, strerror(-err));
+        }
+        return;
+    }
+    if (vl->reuseport == NULL || cpu == 0) {
+        return;
+    }
+
+    err = vl_reuseport_join(vl->reuseport, group, conn->fd, cpu - 1);
+    if (err < 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_reuseport_listener_join: listener not "
+                          "steered to CPU %zu, %s", cpu - 1, strerror(-err));
+    }
+}
+
+/** Provision listener of vectorloop. Listener socket inherited from process
+ * being upgraded is used if there is one, and listener socket is recorded to
+ * be handed over on next upgrade. Listener is provisioned with configuration
+ * of its listener tuning profile if it has one, see
+ * @ref config_listener_cfg().
+ *
+ * @note This is a helper function for @ref vl_register_listeners().
+ *
+ * @param vl          Vectorloop operating on.
+ * @param family      IP family of listener.
+ * @param protocol    Protocol of listener, see @ref conn_listener_provision().
+ * @param kind        Kind of listener handed over on upgrade.
+ * @param arena       Arena UDP listener batches are allocated from, NULL for
+ *                    TCP.
+ * @param err_buf     Buffer where to store error message.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns listener connection object, or NULL on error.
+ */
+static conn_t *
+vl_listener_provision(vectorloop_t *vl, int family, int protocol, upgrade_fd_kind_t kind,
+                      arena_t *arena, char *err_buf, size_t err_buf_len)
+{
+    conn_t  *conn    = NULL;
+    int      fd      = -1;
+    uint8_t  profile = vl->cfg->listener_profile_udp;
+
+    if (protocol == IPPROTO_TCP) {
+        profile = vl->cfg->listener_profile_tcp;
+    } else if (protocol == LISTENER_PROTO_DOT) {
+        profile = vl->cfg->listener_profile_dot;
+    }
+
+    if (vl->upgrade != NULL) {
+        fd = upgrade_fd_take(vl->upgrade, vl->id, kind);
+    }
+    conn = conn_listener_provision(config_listener_cfg(vl->cfg, profile), family, protocol,
+                                   arena, fd, err_buf, err_buf_len);
+    if (conn != NULL) {
+        conn->profile = profile;
+    }
+    if (conn != NULL && vl->upgrade != NULL) {
+        upgrade_listener_set(vl->upgrade, vl->id, kind, conn->fd);
+    }
+    return conn;
+}
+
+/** Register (start) UDP listeners bound to addresses of configuration
+ * setting "udp_listener_addresses", IPv4 addresses if vectorloop has "udp4"
+ * role and IPv6 addresses if it has "udp6" role. First listener of each IP
+ * family and listener tuning profile has batches, sized by its profile,
+ * listeners of other addresses receive into its batches and are only
+ * registered with epoll for read, see @ref conn_listener_provision_addr().
+ * First listener of each IP family with batches is its listener_udp_ipv4 or
+ * listener_udp_ipv6. Listeners are neither
+ * steered by reuseport programs, as each address is a reuseport group of its
+ * own, nor handed over on upgrade.
+ *
+ * @note This is a helper function for @ref vl_register_listeners().
+ *
+ * @param vl    Vectorloop operating on.
+ * @param roles Roles of vectorloop.
+ *
+ * @return      Returns 0 on success, -1 if a listener could not be started,
+ *              error is logged.
+ */
+static int
+vl_register_listeners_udp_addr(vectorloop_t *vl, uint8_t roles)
+{
+    config_t *cfg     = vl->cfg;
+    char      err_str[ERR_MSG_LENGTH];
+    conn_t   *conn    = NULL;
+    conn_t  **first   = NULL;
+    conn_t   *firsts[2][LISTENER_PROFILES_MAX + 1] = {};
+    uint8_t   profile = 0;
+    int       v       = 0;
+
+    vl->listeners_udp_addr = mem_malloc(MEM_TAG_UDP, sizeof(conn_t *) *
+                                        cfg->udp_listener_addresses_count);
+    CHECK_MALLOC(vl->listeners_udp_addr);
+
+    for (size_t i = 0; i < cfg->udp_listener_addresses_count; i++) {
+        v = cfg->udp_listener_addresses[i].family == AF_INET6;
+        if (!(roles & (v ? VL_ROLE_UDP_IPV6 : VL_ROLE_UDP_IPV4))) {
+            continue;
+        }
+        profile = cfg->udp_listener_addresses_profile != NULL ?
+                  cfg->udp_listener_addresses_profile[i] : 0;
+        first   = &firsts[v][profile];
+
+        conn = conn_listener_provision_addr(config_listener_cfg(cfg, profile), i, *first,
+                                            &vl->arena, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return -1;
+        }
+        conn->profile = profile;
+        if (*first == NULL) {
+            /* Batches of first listener are sent from. */
+            vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+            *first = conn;
+            if (v == 0 && vl->listener_udp_ipv4 == NULL) {
+                vl->listener_udp_ipv4 = conn;
+            } else if (v == 1 && vl->listener_udp_ipv6 == NULL) {
+                vl->listener_udp_ipv6 = conn;
+            }
+        } else {
+            vl_epoll_ctl_reg_for_read_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        }
+        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+        vl->listeners_udp_addr[vl->listeners_udp_addr_count++] = conn;
+    }
+    debug_printf("VL ID %d UDP listeners started on %zu addresses", vl->id,
+                 vl->listeners_udp_addr_count);
+    return 0;
+}
+
+/** Register (start) UDP and TCP listeners for this vectorloop, IPv4 and IPv6
+ * listeners selected by its roles, see configuration option
+ * "process_thread_roles". Vectorloop with both UDP roles runs a single dual
+ * stack UDP listener if configuration option "udp_dual_stack" is set. UDP
+ * listeners are bound to addresses of configuration option
+ * "udp_listener_addresses" if it is set, see
+ * @ref vl_register_listeners_udp_addr().
+ * 
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_register_listeners(vectorloop_t *vl)
+{
+    char    err_str[ERR_MSG_LENGTH];
+    conn_t *conn  = NULL;
+    uint8_t roles = vl->cfg->process_thread_roles[vl->id];
+    bool    addrs = vl->cfg->udp_listener_addresses_count > 0;
+    bool    dual  = vl->cfg->udp_dual_stack && !addrs &&
+                    (roles & (VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6)) ==
+                    (VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6);
+
+    /* Start UDP listening sockets */
+    if (vl->cfg->udp_enable && addrs) {
+        if (vl_register_listeners_udp_addr(vl, roles) != 0) {
+            return;
+        }
+        if (vl->xdp_prog != NULL && (roles & VL_ROLE_UDP_IPV6)) {
+            vl_register_listener_xdp(vl);
+        }
+    }
+    if (vl->cfg->udp_enable && (roles & VL_ROLE_UDP_IPV4) && !dual && !addrs) {
+        /* Start UDP IPv4 listener. */
+        conn = vl_listener_provision(vl, AF_INET, IPPROTO_UDP, UPGRADE_FD_UDP_IPV4,
+                                     &vl->arena, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+
+        /* Register IPv4 listener fd to epoll for read & write edge triggered. */
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        vl_reuseport_listener_join(vl, conn, VL_REUSEPORT_UDP_IPV4);
+
+        /* Add IPv4 listener to Vectorloop UDP read queue. */
+        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+
+        vl->listener_udp_ipv4 = conn;
+        debug_printf("VL ID %d IPv4 UDP listener started", vl->id);
+    }
+    if (vl->cfg->udp_enable && (roles & VL_ROLE_UDP_IPV6) && !addrs) {
+        /* Start UDP IPv6 listener, dual stack one receives IPv4 queries too. */
+        conn = vl_listener_provision(vl, AF_INET6, dual ? LISTENER_PROTO_UDP_DUAL : IPPROTO_UDP,
+                                     dual ? UPGRADE_FD_UDP_DUAL : UPGRADE_FD_UDP_IPV6,
+                                     &vl->arena, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+
+        /* Register IPv6 listener fd to epoll for read & write edge triggered. */
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        vl_reuseport_listener_join(vl, conn, VL_REUSEPORT_UDP_IPV6);
+
+        /* Add IPv6 listener to Vectorloop UDP read queue. */
+        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+
+        vl->listener_udp_ipv6 = conn;
+        debug_printf("VL ID %d IPv6%s UDP listener started", vl->id, dual ? " dual stack" : "");
+
+        if (vl->xdp_prog != NULL) {
+            vl_register_listener_xdp(vl);
+        }
+    }
+
+    /* Start TCP listening sockets */
+    if (vl->cfg->tcp_enable && (roles & VL_ROLE_TCP_IPV4)) {
+        /* Start TCP IPv4 listener. */
+        conn = vl_listener_provision(vl, AF_INET, IPPROTO_TCP, UPGRADE_FD_TCP_IPV4,
+                                     NULL, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+
+        /* Register IPv4 listener fd to epoll for read & write edge triggered. */
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        vl_reuseport_listener_join(vl, conn, VL_REUSEPORT_TCP_IPV4);
+
+        /* Add IPv4 listener to Vectorloop TCP read queue. */
+        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+
+        vl->listener_tcp_ipv4 = conn;
+        debug_printf("VL ID %d IPv4 TCP listener started", vl->id);
+    }
+    if (vl->cfg->tcp_enable && (roles & VL_ROLE_TCP_IPV6)) {
+        /* Start TCP IPv6 listener. */
+        conn = vl_listener_provision(vl, AF_INET6, IPPROTO_TCP, UPGRADE_FD_TCP_IPV6,
+                                     NULL, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+
+        /* Register IPv6 listener fd to epoll for read & write edge triggered. */
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        vl_reuseport_listener_join(vl, conn, VL_REUSEPORT_TCP_IPV6);
+
+        /* Add IPv6 listener to Vectorloop TCP read queue. */
+        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+
+        vl->listener_tcp_ipv6 = conn;
+        debug_printf("VL ID %d IPv6 TCP listener started", vl->id);
+    }
+
+    /* Start DoT listening sockets, these are not steered by reuseport
+     * programs.
+     */
+    if (vl->dot_ctx != NULL && (roles & VL_ROLE_TCP_IPV4)) {
+        /* Start DoT IPv4 listener. */
+        conn = vl_listener_provision(vl, AF_INET, LISTENER_PROTO_DOT, UPGRADE_FD_DOT_IPV4,
+                                     NULL, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+        vl->listener_dot_ipv4 = conn;
+        debug_printf("VL ID %d IPv4 DoT listener started", vl->id);
+    }
+    if (vl->dot_ctx != NULL && (roles & VL_ROLE_TCP_IPV6)) {
+        /* Start DoT IPv6 listener. */
+        conn = vl_listener_provision(vl, AF_INET6, LISTENER_PROTO_DOT, UPGRADE_FD_DOT_IPV6,
+                                     NULL, err_str, ERR_MSG_LENGTH);
+        if (conn == NULL) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, true, "%s", err_str);
+            return;
+        }
+        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd, conn->fd, (uint64_t)conn);
+        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+        vl->listener_dot_ipv6 = conn;
+        debug_printf("VL ID %d IPv6 DoT listener started", vl->id);
+    }
+}
+
+/** Warm up vectorloop buffers before listeners start, so first queries do
+ * not take page faults: response cache, response rate limiting table, query
+ * log buffers and TCP connection table are prefaulted, and locked in memory
+ * together with UDP listener arena, as configured. TCP connection table grows
+ * on demand so it is only prefaulted. Locking failure is logged, buffers are
+ * used unlocked.
+ *
+ * @param vl Vectorloop whose buffers to warm up.
+ */
+static void
+vl_buffers_warm(vectorloop_t *vl)
+{
+    config_t *cfg        = vl->cfg;
+    uint64_t  start_us   = utl_clock_monotonic_us_fatal();
+    size_t    prefaulted = 0;
+    size_t    locked     = 0;
+    int       err_no     = 0;
+    size_t    count      = 0;
+    struct {
+        void   *ptr;
+        size_t  len;
+    } regions[4 + vl->query_log.chunk_count];
+
+    regions[count++] = (typeof(regions[0])) {
+        vl->response_cache.entries,
+        (vl->response_cache.mask + 1) * sizeof(response_cache_entry_t) };
+    if (vl->rrl.buckets != NULL) {
+        regions[count++] = (typeof(regions[0])) {
+            vl->rrl.buckets, (vl->rrl.mask + 1) * sizeof(rrl_bucket_t) };
+    }
+    for (size_t i = 0; i < vl->query_log.chunk_count; i++) {
+        regions[count++] = (typeof(regions[0])) {
+            vl->query_log.chunks[i].buf, vl->query_log.buf_size };
+    }
+
+    if (cfg->loop_prefault) {
+        for (size_t i = 0; i < count; i++) {
+            prefaulted += utl_mem_prefault(regions[i].ptr, regions[i].len, true);
+        }
+        prefaulted += utl_mem_prefault(vl->conn_tcp_table.slots,
+                                       vl->conn_tcp_table.size * sizeof(conn_table_slot_t),
+                                       true);
+        prefaulted += vl->arena.size;
+    }
+    if (cfg->loop_mlock) {
+        if (vl->arena.base != NULL) {
+            regions[count++] = (typeof(regions[0])) { vl->arena.base, vl->arena.size };
+        }
+        for (size_t i = 0; i < count && err_no == 0; i++) {
+            if (regions[i].ptr == NULL || regions[i].len == 0) {
+                continue;
+            }
+            if (mlock(regions[i].ptr, regions[i].len) != 0) {
+                err_no = errno;
+                continue;
+            }
+            locked += regions[i].len;
+        }
+        if (err_no != 0) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: could not lock vectorloop buffers "
+                              "in memory, %s", strerror(err_no));
+        }
+    }
+    channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                      "Vectorloop %d warmed up, %zu bytes prefaulted, %zu bytes locked, "
+                      "in %" PRIu64 " us", vl->id, prefaulted, locked,
+                      utl_clock_monotonic_us_fatal() - start_us);
+}
+
+/** Get number of entries of a vectorloop cache that fit in memory budget.
+ * Cache is to fit in vectorloop share of budget divided by
+ * @ref VL_MEM_BUDGET_CACHE_DIV, entries are halved until it does.
+ *
+ * @param vl         Vectorloop operating on.
+ * @param size       Configured number of cache entries.
+ * @param entry_size Bytes of memory a cache entry takes.
+ *
+ * @return           Returns number of cache entries, size if there is no
+ *                   memory budget.
+ */
+static size_t
+vl_mem_budget_cache_size(vectorloop_t *vl, size_t size, size_t entry_size)
+{
+    uint64_t budget = (uint64_t)vl->cfg->memory_budget * 1024 * 1024;
+
+    if (budget == 0) {
+        return size;
+    }
+    budget /= vl->metrics->vl_shards_count * VL_MEM_BUDGET_CACHE_DIV;
+    while (size > 1 && size * entry_size > budget) {
+        size /= 2;
+    }
+    return size;
+}
+
+/** Size of arena UDP listener batches of vectorloop are allocated from, see
+ * @ref conn_udp_arena_size(). Each listener with batches takes as many as
+ * its listener profile sets: one per IP family vectorloop has role for, or
+ * with "udp_listener_addresses" one per IP family and profile of its
+ * addresses.
+ *
+ * @note This is a helper function for @ref vl_buffers_init().
+ *
+ * @param vl    Vectorloop operating on.
+ * @param roles Roles of vectorloop.
+ *
+ * @return      Returns number of bytes, not counting AF_XDP listener.
+ */
+static size_t
+vl_udp_arena_size(vectorloop_t *vl, uint8_t roles)
+{
+    config_t *cfg  = vl->cfg;
+    config_t *pcfg = config_listener_cfg(cfg, cfg->listener_profile_udp);
+    size_t    size = 0;
+    bool      seen[2][LISTENER_PROFILES_MAX + 1] = {};
+
+    for (int v = 0; v < 2; v++) {
+        size_t family_size = 0;
+
+        if (!(roles & (v ? VL_ROLE_UDP_IPV6 : VL_ROLE_UDP_IPV4))) {
+            continue;
+        }
+        for (size_t i = 0; i < cfg->udp_listener_addresses_count; i++) {
+            uint8_t profile = cfg->udp_listener_addresses_profile != NULL ?
+                              cfg->udp_listener_addresses_profile[i] : 0;
+            config_t *acfg  = config_listener_cfg(cfg, profile);
+
+            if ((cfg->udp_listener_addresses[i].family == AF_INET6) != v ||
+                seen[v][profile]) {
+                continue;
+            }
+            seen[v][profile] = true;
+            family_size += conn_udp_arena_size(acfg) * acfg->udp_listener_batches;
+        }
+        if (family_size == 0) {
+            family_size = conn_udp_arena_size(pcfg) * pcfg->udp_listener_batches;
+        }
+        size += family_size;
+    }
+    return size;
+}
+
+/** Allocate vectorloop buffers: epoll events, query log ring, TCP connection
+ * table, pool and timers, response cache, RRL table and arena UDP listeners
+ * are allocated from. Called from vectorloop thread once it is bound to its
+ * CPU, so memory is first touched, and hence placed, on memory node of that
+ * CPU. If configuration setting "loop_hugepages" is set, large buffers are
+ * advised to be backed by transparent huge pages. Arena is backed by explicit
+ * huge pages if "loop_hugetlb" is set, and prefaulted if "loop_prefault" is
+ * set.
+ *
+ * Vectorloop metrics are set as memory account of calling thread, so memory
+ * vectorloop allocates is accounted by subsystem, see @ref mem. With memory
+ * budget, response cache and DNSSEC signature cache are shrunk to fit it, see
+ * @ref vl_mem_budget_cache_size().
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_buffers_init(vectorloop_t *vl)
+{
+    config_t      *cfg     = vl->cfg;
+    mem_account_t *account = &vl->metrics_vl->mem;
+    size_t         size;
+    uint64_t       conns_bytes;
+    uint64_t       bufs_bytes;
+
+    /* Account memory allocated from here on to this vectorloop. */
+    mem_account_set(account);
+
+    /* Allocate epoll events array. */
+    vl->ep_events_size = cfg->epoll_num_events_udp + cfg->epoll_num_events_tcp;
+    vl->ep_events = mem_malloc(MEM_TAG_OTHER, sizeof(struct epoll_event) * vl->ep_events_size);
+    CHECK_MALLOC(vl->ep_events);
+
+    /* Allocate query log ring, in shared memory if external readers consume
+     * it too. If shared memory can not be set up ring is allocated as usual.
+     */
+    if (cfg->query_log_shm_path != NULL) {
+        char path[FILE_REALPATH_MAX + 16];
+        char err_str[ERR_MSG_LENGTH];
+
+        snprintf(path, sizeof(path), "%s.%d", cfg->query_log_shm_path, vl->id);
+        if (query_log_init_shm(&vl->query_log, path, vl->id,
+                               cfg->query_log_buffer_size,
+                               cfg->query_log_buffer_count,
+                               err_str, ERR_MSG_LENGTH) != 0) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: %s", err_str);
+            query_log_init(&vl->query_log, cfg->query_log_buffer_size,
+                           cfg->query_log_buffer_count);
+        }
+    } else {
+        query_log_init(&vl->query_log, cfg->query_log_buffer_size,
+                       cfg->query_log_buffer_count);
+    }
+    if (cfg->query_log_full_policy == QUERY_LOG_FULL_SPILL) {
+        query_log_spill_init(&vl->query_log, cfg->query_log_spill_size);
+    }
+
+    /* Initialize TCP connection table, response buffer pool, connection pool,
+     * per client connection limit table and timer wheel. Limit table is sized
+     * to twice the number of connections, so buckets rarely fill up.
+     */
+    conn_table_init(&vl->conn_tcp_table, cfg->tcp_conns_per_vl_max);
+    buf_pool_init(&vl->tcp_response_pool, RIP_NS_UDP_MAXMSG, RIP_NS_MAXMSG + 2,
+                  VL_TCP_RESPONSE_POOL_FREE_MAX, MEM_TAG_TCP_BUFS);
+
+    /* Memory a connection takes is measured as pool is preloaded. */
+    conns_bytes = atomic_load_explicit(&account->bytes[MEM_TAG_TCP_CONNS], memory_order_relaxed);
+    bufs_bytes  = atomic_load_explicit(&account->bytes[MEM_TAG_TCP_BUFS], memory_order_relaxed);
+    conn_pool_init(&vl->conn_tcp_pool, cfg, &vl->tcp_response_pool,
+                   cfg->tcp_conns_per_vl_max);
+    if (vl->conn_tcp_pool.count > 0) {
+        vl->conn_tcp_bytes = (atomic_load_explicit(&account->bytes[MEM_TAG_TCP_CONNS],
+                                                   memory_order_relaxed) - conns_bytes) /
+                             vl->conn_tcp_pool.count;
+    }
+    if (vl->conn_tcp_pool.bufs_count > 0) {
+        vl->conn_tcp_bytes += (atomic_load_explicit(&account->bytes[MEM_TAG_TCP_BUFS],
+                                                    memory_order_relaxed) - bufs_bytes) /
+                              vl->conn_tcp_pool.bufs_count;
+    }
+    vl->conns_tcp_max = cfg->tcp_conns_per_vl_max;
+    conn_limit_init(&vl->conn_tcp_limit,
+                    cfg->tcp_conns_per_vl_max < TCP_CONNS_CLIENT_TABLE_SIZE_MAX / 2 ?
+                    cfg->tcp_conns_per_vl_max * 2 : TCP_CONNS_CLIENT_TABLE_SIZE_MAX,
+                    cfg->tcp_conns_per_client_max, cfg->tcp_conns_client_ipv4_prefix_len,
+                    cfg->tcp_conns_client_ipv6_prefix_len);
+    utl_clock_init(&vl->clock);
+    vl->loop_time_ms = vl->clock.mono_ms;
+    timer_wheel_init(&vl->conn_tcp_timers, vl->loop_time_ms);
+
+    /* Allocate response cache. */
+    size = vl_mem_budget_cache_size(vl, cfg->response_cache_size,
+                                    sizeof(response_cache_entry_t));
+    response_cache_init(&vl->response_cache, size);
+    vl->response_cache_shared = vl->resources->response_cache;
+    if (vl->xdp_prog != NULL && vl->xdp_prog->resp_map_fd >= 0) {
+        vl->response_cache.hot_hits = cfg->xdp_responder_hits;
+    }
+
+    /* Map response cache snapshot of previous process, see
+     * @ref vl_fn_response_cache_warm().
+     */
+    if (cfg->response_cache_snapshot_path != NULL && vl->response_cache.entries != NULL) {
+        char path[FILE_REALPATH_MAX + 16];
+        char err_str[ERR_MSG_LENGTH];
+
+        snprintf(path, sizeof(path), "%s.%d", cfg->response_cache_snapshot_path, vl->id);
+        if (response_cache_snapshot_open(&vl->response_cache_snapshot, path,
+                                         err_str, ERR_MSG_LENGTH) < 0) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: %s", err_str);
+        }
+    }
+    if (size < cfg->response_cache_size) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_buffers_init: response cache shrunk to %zu entries "
+                          "to fit memory budget", size);
+    }
+
+    /* Allocate DNSSEC signature cache. */
+    if (vl->dnssec_key != NULL) {
+        size = vl_mem_budget_cache_size(vl, cfg->dnssec_sig_cache_size,
+                                        sizeof(dnssec_sig_t) + 2 * sizeof(dnssec_sig_t *));
+        dnssec_sig_cache_init(&vl->dnssec_sig_cache, size);
+        if (size < cfg->dnssec_sig_cache_size) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: DNSSEC signature cache shrunk to %zu "
+                              "entries to fit memory budget", size);
+        }
+    }
+
+    /* Allocate NSEC3 hash cache. */
+    size = vl_mem_budget_cache_size(vl, cfg->dnssec_nsec3_cache_size,
+                                    sizeof(zone_nsec3_cache_entry_t));
+    if (zone_nsec3_cache_init(&vl->nsec3_cache, size) != 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_buffers_init: NSEC3 hash cache allocation failed");
+    }
+
+    /* Allocate pending slots of deferred UDP queries. */
+    if (vl->workers.count > 0) {
+        vl->pending_udp = mem_aligned_alloc(MEM_TAG_OTHER, CACHE_LINE_SIZE,
+                                            VL_PENDING_UDP_MAX * sizeof(vl_pending_udp_t));
+        CHECK_MALLOC(vl->pending_udp);
+        memset(vl->pending_udp, 0, VL_PENDING_UDP_MAX * sizeof(vl_pending_udp_t));
+        for (size_t i = 0; i < VL_PENDING_UDP_MAX; i++) {
+            query_init(&vl->pending_udp[i].q, cfg, 0);
+        }
+    }
+
+    /* Allocate response rate limiting table. */
+    rrl_init(&vl->rrl, cfg->rrl_table_size, cfg->rrl_responses_per_second,
+             cfg->rrl_slip, cfg->rrl_ipv4_prefix_len, cfg->rrl_ipv6_prefix_len);
+    vl_overload_init(&vl->overload, cfg->overload_iteration_max, cfg->overload_slip,
+                     vl->loop_time_ms);
+
+    /* Allocate latency SLO window. */
+    uint64_t slo_objective_us[VL_SLO_QUANTILES] = {
+        [VL_SLO_P50]  = cfg->slo_latency_p50,
+        [VL_SLO_P99]  = cfg->slo_latency_p99,
+        [VL_SLO_P999] = cfg->slo_latency_p999,
+    };
+    if (vl_slo_enabled(slo_objective_us) &&
+        vl_slo_init(&vl->slo, slo_objective_us, cfg->slo_window,
+                    &vl->metrics_vl->latency.total[0][0],
+                    METRICS_LATENCY_PROTOCOLS * METRICS_LATENCY_RCODES,
+                    vl->loop_time_ms) != 0) {
+        channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                          "vl_buffers_init: latency SLO window allocation failed");
+    }
+
+    /* Create UDP query mirroring socket. */
+    vl->mirror.fd = -1;
+    if (cfg->udp_mirror_ip != NULL && cfg->udp_enable &&
+        (cfg->process_thread_roles[vl->id] & (VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6))) {
+        char err_str[ERR_MSG_LENGTH];
+
+        if (vl_mirror_init(&vl->mirror, cfg->udp_mirror_ip, cfg->udp_mirror_port,
+                           cfg->udp_mirror_sample_rate, err_str, sizeof(err_str)) != 0) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: UDP query mirroring disabled, %s", err_str);
+        }
+    }
+
+    /* Allocate arena for UDP listener batches: IPv4 and IPv6 listeners this
+     * vectorloop runs and AF_XDP listener, which has a single batch.
+     */
+    if (cfg->udp_enable && (cfg->process_thread_roles[vl->id] & (VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6))) {
+        uint8_t roles = cfg->process_thread_roles[vl->id];
+        size_t  size  = vl_udp_arena_size(vl, roles);
+        int     flags = 0;
+
+        if ((roles & VL_ROLE_UDP_IPV6) && vl->xdp_prog != NULL) {
+            size += conn_udp_arena_size(cfg);
+        }
+
+        if (cfg->loop_hugetlb) {
+            flags |= ARENA_HUGETLB;
+        }
+        if (cfg->loop_hugepages) {
+            flags |= ARENA_THP;
+        }
+        if (cfg->loop_prefault) {
+            flags |= ARENA_PREFAULT;
+        }
+        arena_init(&vl->arena, size, flags);
+        CHECK_MALLOC(vl->arena.base);
+        mem_account_update(MEM_TAG_UDP, vl->arena.size);
+        if (cfg->loop_hugetlb && !vl->arena.hugetlb) {
+            channel_log_write(vl->app_log_channel, APP_LOG_MSG_CUSTOM, false,
+                              "vl_buffers_init: no huge pages available "
+                              "for UDP listener arena, regular pages are used");
+        }
+    }
+
+    if (cfg->loop_hugepages) {
+        utl_madvise_hugepages(vl->response_cache.entries,
+                              (vl->response_cache.mask + 1) * sizeof(response_cache_entry_t));
+        utl_madvise_hugepages(vl->rrl.buckets, (vl->rrl.mask + 1) * sizeof(rrl_bucket_t));
+        for (size_t i = 0; i < vl->query_log.chunk_count; i++) {
+            utl_madvise_hugepages(vl->query_log.chunks[i].buf, vl->query_log.buf_size);
+        }
+    }
+
+    if (cfg->loop_prefault || cfg->loop_mlock) {
+        vl_buffers_warm(vl);
+    }
+}
+
+/** Create a new vectorloop object. Only the object is allocated here,
+ * vectorloop buffers are allocated by @ref vl_run() on vectorloop thread.
+ * 
+ * @param cfg               Configuration with settings.
+ * @param id                Vectorloop ID.
+ * @param resources         Resources published by resource thread.
+ * @param app_log_channel   Application log channel used for this vectorloop.
+ * @param metrics           Metrics object vectorloop to use.
+ * @param xdp_prog          XDP program to bind AF_XDP socket to, NULL if
+ *                          AF_XDP is not used.
+ * @param reuseport         Reuseport steering listeners join, NULL if
+ *                          steering is not used.
+ * @param dot_ctx           TLS context of DoT listeners, NULL if DoT is not
+ *                          used.
+ * @param dnssec_key        DNSSEC online signing key, NULL if answers are
+ *                          not signed online.
+ * @param handoff           TCP connection handoff state shared by all
+ *                          vectorloops, NULL if connections are not handed
+ *                          off.
+ * @param upgrade           Upgrade state shared by all vectorloops, NULL if
+ *                          upgrades are disabled.
+ * @param drain             Drain state shared by all vectorloops.
+ *
+ * @return                  Returns newly created vectorloop object. 
+ */
+vectorloop_t *
+vl_new(config_t *cfg, int id, resource_set_t *resources,
+       channel_log_t *app_log_channel, metrics_t *metrics,
+       vl_xdp_prog_t *xdp_prog, vl_reuseport_t *reuseport,
+       dot_ctx_t *dot_ctx, dnssec_key_t *dnssec_key, vl_handoff_t *handoff,
+       upgrade_t *upgrade, vl_drain_t *drain) {
+    /* Init new vectorloop object, aligned for its cache line aligned members. */
+    vectorloop_t *vl = aligned_alloc(CACHE_LINE_SIZE, sizeof(vectorloop_t));
+    CHECK_MALLOC(vl);
+    *vl = (vectorloop_t) {
+        .cfg               = cfg,
+        .id                = id,
+        .resources         = resources,
+        .app_log_channel   = app_log_channel,
+        .metrics           = metrics,
+        .metrics_vl        = metrics_vl_get(metrics, cfg->process_worker_id *
+                                            cfg->process_thread_count + id),
+        .metrics_sketch    = metrics_sketch_vl_get(metrics, id),
+        .metrics_zones     = metrics_zones_vl_get(metrics, cfg->process_worker_id *
+                                                  cfg->process_thread_count + id),
+        .metrics_cost      = metrics_cost_vl_get(metrics, cfg->process_worker_id *
+                                                 cfg->process_thread_count + id),
+        .metrics_udp_addrs = metrics_udp_addrs_get(metrics, cfg->process_worker_id *
+                                                   cfg->process_thread_count + id),
+        .ep_fd             = -1,
+        .wake_fd           = -1,
+        .uring.ring_fd     = -1,
+        .xdp_prog          = xdp_prog,
+        .reuseport         = reuseport,
+        .dot_ctx           = dot_ctx,
+        .dnssec_key        = dnssec_key,
+        .handoff           = handoff,
+        .handoff_target    = -1,
+        .upgrade           = upgrade,
+        .drain             = drain,
+        .xdp.fd            = -1,
+    };
+
+    /* Create epoll fd and wake up eventfd other threads use to wake
+     * vectorloop.
+     */
+    vl->ep_fd   = vl_epoll_create();
+    vl->wake_fd = vl_epoll_wake_create(vl->ep_fd);
+
+    /* Other vectorloops wake vectorloop up once they hand off TCP
+     * connections to it.
+     */
+    if (handoff != NULL) {
+        vl_handoff_register(handoff, id, vl->wake_fd);
+    }
+
+    /* Main thread wakes vectorloop up once it should drain. */
+    vl_drain_register(drain, id, vl->wake_fd);
+
+    /* Start TLS handshake threads, they are not bound to vectorloop CPU. */
+    if (dot_ctx != NULL) {
+        dot_pool_start(&vl->dot_pool, dot_ctx, cfg->dot_handshake_threads, vl->wake_fd);
+    }
+
+    /* Start worker threads if a feature that defers queries is enabled,
+     * they are not bound to vectorloop CPU.
+     */
+    if (dnssec_key != NULL) {
+        worker_pool_start(&vl->workers, cfg->worker_threads, vl->wake_fd);
+    }
+
+    return vl;
+}
+
+/** Get network interface receive queue vectorloop binds its AF_XDP socket to,
+ * which is number of CPU vectorloop thread is bound to, or vectorloop ID if
+ * it is not bound to a CPU.
+ *
+ * @param cfg Configuration with settings.
+ * @param id  Vectorloop ID.
+ *
+ * @return    Returns receive queue number.
+ */
+unsigned int
+vl_xdp_queue_id(config_t *cfg, int id)
+{
+    if (cfg->process_thread_masks[id] > 0) {
+        return cfg->process_thread_masks[id] - 1;
+    }
+    return id;
+}
+
+/** Check if vectorloop has no connections queued for processing.
+ * 
+ * @param vl Vectorloop to check.
+ * 
+ * @return   Returns true if all vectorloop queues are empty, otherwise false.
+ */
+static bool
+vl_queues_empty(vectorloop_t *vl)
+{
+    return vl->conn_udp_read_queue.head == NULL &&
+           vl->conn_udp_write_queue.head == NULL &&
+           vl->conn_tcp_accept_conns_queue.head == NULL &&
+           vl->conn_tcp_read_queue.head == NULL &&
+           vl->conn_tcp_write_queue.head == NULL &&
+           vl->conn_tcp_xfr_queue.head == NULL &&
+           vl->conn_tcp_release_queue.head == NULL &&
+           vl->query_parse_queue.head == NULL &&
+           vl->query_resolve_queue.head == NULL &&
+           vl->query_response_pack_queue.head == NULL &&
+           vl->query_log_queue.head == NULL;
+}
+
+/** Apply idle policy after a loop iteration that processed nothing.
+ * 
+ * For the first "loop_idle_spin" microseconds of being idle the loop spins,
+ * executing @ref VL_IDLE_SPIN_PAUSES CPU pause instructions per iteration.
+ * After that, next epoll_wait() blocks until an event arrives, with timeout
+ * set to nearest TCP connection timer expiry capped to "loop_idle_wait_max"
+ * milliseconds.
+ * 
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_idle(vectorloop_t *vl)
+{
+    uint64_t now_us = utl_clock_monotonic_us_fatal();
+    uint64_t expiry;
+    uint64_t timeout;
+
+    if (vl->idle_count == 0) {
+        vl->idle_start_us = now_us;
+    }
+    INCREMENT(vl->idle_count);
+
+    if (now_us - vl->idle_start_us < vl->cfg->loop_idle_spin) {
+        for (int i = 0; i < VL_IDLE_SPIN_PAUSES; i++) {
+            CPU_PAUSE();
+        }
+        return;
+    }
+
+    if (!vl_queues_empty(vl)) {
+        return;
+    }
+
+    timeout = vl->cfg->loop_idle_wait_max;
+    expiry  = timer_wheel_next_expiry(&vl->conn_tcp_timers);
+    if (expiry != UINT64_MAX) {
+        expiry = expiry > vl->loop_time_ms ? expiry - vl->loop_time_ms : 1;
+        if (expiry < timeout) {
+            timeout = expiry;
+        }
     }
-
-    return ret;
+    vl->ep_timeout_ms = (int)timeout;
 }
 
-/** Vectorloop function to log processed DNS queries. 
- * 
+/** Let other tasks of vectorloop CPU run, if vectorloop runs with real-time
+ * scheduling policy and has not blocked for "process_thread_rt_run_max".
+ * Busy or spinning real-time vectorloop is otherwise never preempted by
+ * normal tasks, starving kernel threads of its CPU (e.g. softirq and
+ * workqueue processing) which network stack depends on.
+ *
  * @param vl Vectorloop operating on.
  */
 static void
-vl_fn_query_log(vectorloop_t *vl)
+vl_rt_yield(vectorloop_t *vl)
 {
-    conn_t     *conn;
-    conn_udp_t *conn_udp;
-    conn_tcp_t *conn_tcp;
-    int         len       = 0;
-
-    while ((conn = conn_fifo_dequeue_gen(&vl->query_log_queue)) != NULL) {
-        if (CONN_IS_UDP_LISTENER(conn)) {
-            /* UDP */
-            conn_udp = conn->conn.udp;
-
-            for (int i =0; i < conn_udp->read_vector_count; i++) {
-                len = query_log(vl->query_log.buf + vl->query_log.buf_len,
-                                vl->query_log.buf_size - vl->query_log.buf_len,
-                                &conn_udp->queries[i]);
-                if (len > 0) {
-                    vl->query_log.buf_len += len;
-                } else {
-                    /* error logging query, not enough room in buf. */
-                    atomic_fetch_add(&vl->metrics->app.query_log_buf_no_space, 1);
-                }
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = VL_RT_YIELD_US * 1000L };
 
-                query_report_metrics(&conn_udp->queries[i], vl->metrics);
-            }
+    if (!vl->rt_sched ||
+        vl->loop_time_ms - vl->rt_block_ms < vl->cfg->process_thread_rt_run_max) {
+        return;
+    }
+    nanosleep(&ts, NULL);
+    vl->rt_block_ms = vl->loop_time_ms;
+}
 
-            /* Move UDP conn to read queue. */
-            conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+/** Feed time of loop iteration to overload state, and move overload level
+ * once overload period ended, see @ref vl_overload_update(). Iteration is
+ * timed from loop timestamp, taken when it started or when blocking
+ * epoll_wait() returned. Level changes are logged.
+ *
+ * @param vl   Vectorloop operating on.
+ * @param busy Whether iteration processed anything.
+ */
+static void
+vl_fn_overload(vectorloop_t *vl, bool busy)
+{
+    vl_overload_level_t level = vl->overload.level;
+    struct timespec     ts;
 
-        } else if (CONN_IS_TCP_CONN(conn)) {
-            /* TCP */
-            conn_tcp = conn->conn.tcp;
+    if (busy) {
+        utl_clock_now(&vl->clock, &ts);
+        vl_overload_iteration(&vl->overload, utl_timespec_to_ns(&ts) -
+                                             utl_timespec_to_ns(&vl->loop_timestamp));
+    }
+    if (!vl_overload_update(&vl->overload, vl->loop_time_ms)) {
+        return;
+    }
+    METRICS_INC(vl->metrics_vl->overload.periods[level]);
+    if (vl->overload.level != level) {
+        channel_log_write_id(vl->app_log_channel,
+                             vl->overload.level > level ? APP_LOG_MSG_VL_OVERLOAD_RAISED :
+                                                          APP_LOG_MSG_VL_OVERLOAD_LOWERED,
+                             vl->overload.level, false);
+    }
+}
 
-            for (int i = 0; i < conn_tcp->queries_count; i++) {
-                len = query_log(vl->query_log.buf + vl->query_log.buf_len,
-                                vl->query_log.buf_size - vl->query_log.buf_len,
-                                &conn_tcp->queries[i]);
-                if (len > 0) {
-                    vl->query_log.buf_len += len;
-                } else {
-                    /* error logging query, not enough room in buf. */
-                    atomic_fetch_add(&vl->metrics->app.query_log_buf_no_space, 1);
-                }
+/** Evaluate latency SLO once its period ended, see @ref vl_slo_update(),
+ * and log quantiles that entered or left breach. Messages are predefined,
+ * with latency in microseconds as parameter, so nothing is formatted here.
+ *
+ * @param vl Vectorloop operating on.
+ */
+static void
+vl_fn_slo(vectorloop_t *vl)
+{
+    uint8_t changed = 0;
 
-                query_report_metrics(&conn_tcp->queries[i], vl->metrics);
-            }
+    if (!vl_slo_update(&vl->slo, &vl->metrics_vl->latency.total[0][0],
+                       METRICS_LATENCY_PROTOCOLS * METRICS_LATENCY_RCODES,
+                       vl->loop_time_ms, &changed)) {
+        return;
+    }
+    for (int i = 0; i < VL_SLO_QUANTILES; i++) {
+        uint64_t latency_us;
 
-            /* If TCP connection is closed for write release conn oject. */
-            if (conn_tcp->state == TCP_CONN_ST_CLOSED_FOR_WRITE ||
-                conn_tcp->state == TCP_CONN_ST_WRITE_ERR) {
-                conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
-                continue;
-            }
+        if (!(changed & (1 << i))) {
+            continue;
+        }
+        latency_us = vl->slo.latency_ns[i] / 1000;
+        channel_log_write_id(vl->app_log_channel,
+                             (vl->slo.breached & (1 << i)) ? APP_LOG_MSG_VL_SLO_P50_BREACHED + i :
+                                                             APP_LOG_MSG_VL_SLO_P50_MET + i,
+                             latency_us > INT32_MAX ? INT32_MAX : (int32_t)latency_us, false);
+    }
+}
 
-            /* All messages sent. If there is any extra data (not associated with
-            * query) in read_buffer it should be moved to the begining of buffer.
-            * Set the timeout appropriately.
-            */
-            conn_tcp->timeout = vl->loop_timestamp;
-            size_t data_len   = 0;
-            for (int i = 0; i < conn_tcp->queries_count; i++) {
-                data_len += conn_tcp->queries[i].request_buffer_len + 2;
-            }
-            size_t data_extra = conn_tcp->read_buffer_len - data_len;
-            if (data_extra > 0) {
-                memmove(conn_tcp->read_buffer, &conn_tcp->read_buffer[data_len], data_extra);
-                conn_tcp->state           = TCP_CONN_ST_WAIT_FOR_QUERY_DATA;
-                conn_tcp->timeout.tv_sec += vl->cfg->tcp_query_recv_timeout;
-            } else {
-                conn_tcp->state           = TCP_CONN_ST_WAIT_FOR_QUERY;
-                conn_tcp->timeout.tv_sec += vl->cfg->tcp_keepalive;
-            }
-            conn_tcp->read_buffer_len = data_extra;
+/** Offsets in vectorloop of pipeline queues, indexed by
+ * @ref metrics_vl_queue_t.
+ */
+static const size_t vl_queue_offsets[METRICS_VL_QUEUES] = {
+    [METRICS_VL_QUEUE_QUERY_PARSE]   = offsetof(vectorloop_t, query_parse_queue),
+    [METRICS_VL_QUEUE_QUERY_RESOLVE] = offsetof(vectorloop_t, query_resolve_queue),
+    [METRICS_VL_QUEUE_RESPONSE_PACK] = offsetof(vectorloop_t, query_response_pack_queue),
+    [METRICS_VL_QUEUE_QUERY_LOG]     = offsetof(vectorloop_t, query_log_queue),
+    [METRICS_VL_QUEUE_TCP_READ]      = offsetof(vectorloop_t, conn_tcp_read_queue),
+    [METRICS_VL_QUEUE_TCP_WRITE]     = offsetof(vectorloop_t, conn_tcp_write_queue),
+    [METRICS_VL_QUEUE_TCP_RELEASE]   = offsetof(vectorloop_t, conn_tcp_release_queue),
+};
+
+/** Sample pipeline queue lengths at end of a stage that took given cycles.
+ * Queue occupancy over stage is average of its lengths at stage start and
+ * end times stage cycles, and length increase counts as entries queued.
+ *
+ * @note This is a helper function for @ref vl_stage_end().
+ *
+ * @param vl     Vectorloop operating on.
+ * @param cycles CPU cycles stage took.
+ */
+static inline void
+vl_queues_sample(vectorloop_t *vl, uint64_t cycles)
+{
+    for (int i = 0; i < METRICS_VL_QUEUES; i++) {
+        vl_queue_sample_t *s   = &vl->queue_samples[i];
+        uint32_t           len = ((conn_fifo_queue_t *)((char *)vl + vl_queue_offsets[i]))->len;
 
-            /* Move conn to read queue. */
-            conn_fifo_enqueue_read(&vl->conn_tcp_read_queue, conn);
+        s->occupancy += ((uint64_t)s->len + len) * cycles / 2;
+        if (len > s->len) {
+            s->queued += len - s->len;
+        }
+        if (len > s->len_max) {
+            s->len_max = len;
         }
+        s->len = len;
     }
 }
 
-/** Vectorloop function to check for timed out entries in TCP conn LRU cache.
- * 
+/** Record pipeline queue depth and dwell time of iteration that just ended,
+ * and start samples of next iteration from current queue lengths.
+ *
+ * @note This is a helper function for @ref vl_loop_end().
+ *
  * @param vl Vectorloop operating on.
  */
-static void
-vl_fn_tcp_conn_timeouts(vectorloop_t *vl)
+static inline void
+vl_queues_record(vectorloop_t *vl)
 {
-    conn_t     *conn, *tmp_conn;
-    conn_tcp_t *conn_tcp;
+    for (int i = 0; i < METRICS_VL_QUEUES; i++) {
+        vl_queue_sample_t *s = &vl->queue_samples[i];
 
-    HASH_ITER(hh, vl->conn_tcp_lru_cache, conn, tmp_conn) {
-        /* Check if connection timeout occurred? */
-        conn_tcp = conn->conn.tcp;
-        if (utl_diff_timespec_as_double(&conn_tcp->timeout, &vl->loop_timestamp) < 0) {
-            /* Timeout occurred. */
-            conn_fifo_enqueue_release(&vl->conn_tcp_release_queue, conn);
-        } else {
-            break;
+        if (s->len_max > 0) {
+            histogram_record(&vl->metrics_vl->loop.queue_depth[i], s->len_max);
         }
+        if (s->queued > 0) {
+            histogram_record(&vl->metrics_vl->loop.queue_dwell[i],
+                             s->occupancy / s->queued);
+        }
+        s->len_max   = s->len;
+        s->queued    = 0;
+        s->occupancy = 0;
     }
 }
 
-/** Vectorloop function to release TCP connection objects. These are TCP
- * connections that have ended.
+/** Record CPU cycles and items of a vectorloop stage that just ended, if
+ * "loop_stage_metrics" is configured. Stage started at cycle count t, which
+ * is moved to end of stage (start of next stage).
  * 
- * @param vl Vectorloop operating on.
+ * @param vl    Vectorloop operating on.
+ * @param stage Stage that ended.
+ * @param items Number of items stage processed.
+ * @param t     Cycle count stage started at.
  */
-static void
-vl_fn_tcp_conn_release(vectorloop_t *vl)
+static inline void
+vl_stage_end(vectorloop_t *vl, metrics_vl_stage_t stage, int items, uint64_t *t)
 {
-    conn_t *conn;
+    uint64_t now;
 
-    while ((conn = conn_fifo_dequeue_release(&vl->conn_tcp_release_queue)) != NULL) {
-        /* Remove TCP conn from TCP CONN TRACK LRU HASH. */
-        LRU_CACHE_DEL(vl->conn_tcp_lru_cache, conn);
+    if (!vl->cfg->loop_stage_metrics) {
+        return;
+    }
+    now = utl_cycles();
+    histogram_record(&vl->metrics_vl->loop.cycles[stage], now - *t);
+    if (items > 0) {
+        histogram_record(&vl->metrics_vl->loop.items[stage], items);
+    }
+    vl_queues_sample(vl, now - *t);
+    if (stage == METRICS_VL_STAGE_IDLE) {
+        vl->loop_idle_cycles += now - *t;
+    }
+    *t = now;
+}
 
-        /* Deregister fd from epoll. */
-        if (conn->fd >= 0) {
-            vl_epoll_ctl_del(vl->ep_fd_tcp, conn->fd);
-            close(conn->fd);
-            conn->fd = -1;
-        }
+/** Record CPU cycles of a vectorloop iteration, split into busy and idle
+ * cycles, if "loop_stage_metrics" is configured. Iteration that processed
+ * nothing is idle as a whole.
+ * 
+ * @param vl    Vectorloop operating on.
+ * @param start Cycle count iteration started at.
+ * @param busy  Whether iteration processed anything.
+ */
+static inline void
+vl_loop_end(vectorloop_t *vl, uint64_t start, bool busy)
+{
+    uint64_t cycles;
+    uint64_t idle;
 
-        /* Remove conn from read or write queue. Conn could be in either one of
-         * these queues if a timeout was detected.
-         */
-        conn_fifo_remove_from_read_queue(&vl->conn_tcp_read_queue, conn);
-        conn_fifo_remove_from_write_queue(&vl->conn_tcp_write_queue, conn);
+    if (!vl->cfg->loop_stage_metrics) {
+        return;
+    }
+    cycles = utl_cycles() - start;
+    idle   = busy ? vl->loop_idle_cycles : cycles;
+    vl->loop_idle_cycles = 0;
+
+    METRICS_ADD(vl->metrics_vl->loop.cycles_idle, idle);
+    METRICS_ADD(vl->metrics_vl->loop.cycles_busy, cycles - idle);
+    if (busy) {
+        METRICS_INC(vl->metrics_vl->loop.iterations_busy);
+        histogram_record(&vl->metrics_vl->loop.iteration, cycles - idle);
+    } else {
+        METRICS_INC(vl->metrics_vl->loop.iterations_idle);
+    }
+    vl_queues_record(vl);
+}
 
-        /* Report TCP metrics. */
-        conn_tcp_report_metrics(conn->conn.tcp, vl->metrics);
+/** Count entries of a vectorloop queue, up to @ref ADMIN_VL_QUEUE_WALK_MAX.
+ *
+ * @note This is a helper function for @ref vl_admin_publish().
+ *
+ * @param queue  Queue to count entries of.
+ * @param handle Offset in connection object of handle queue is linked by.
+ *
+ * @return       Returns number of entries in queue.
+ */
+static uint64_t
+vl_admin_queue_len(conn_fifo_queue_t *queue, size_t handle)
+{
+    uint64_t  len  = 0;
+    conn_t   *conn = queue->head;
 
-        conn_release(conn);
-        DECREMENT(vl->conns_tcp_active);
+    while (conn != NULL && len < ADMIN_VL_QUEUE_WALK_MAX) {
+        len++;
+        conn = *(conn_t **)((char *)conn + handle);
     }
+    return len;
 }
 
-/** Register (start) UDP and TCP listeners for this vectorloop, both IPv4 and IPv6.
- * 
+/** Publish vectorloop state snapshot for admin thread, if "admin_socket" is
+ * configured. Called once at end of each iteration, see @ref admin.
+ *
  * @param vl Vectorloop operating on.
  */
 static void
-vl_register_listeners(vectorloop_t *vl)
+vl_admin_publish(vectorloop_t *vl)
 {
-    char   *err_str;
-    conn_t *conn = NULL;
+    admin_vl_state_t *s = vl->admin_state;
+    uint64_t          v[ADMIN_VL_FIELDS];
+    uint64_t          now;
 
-    err_str = malloc(sizeof(char) * ERR_MSG_LENGTH);
-    CHECK_MALLOC(err_str);
+    if (s == NULL) {
+        return;
+    }
+    now = utl_cycles();
+    v[ADMIN_VL_ITERATIONS]          = admin_vl_get(s, ADMIN_VL_ITERATIONS) + 1;
+    v[ADMIN_VL_LOOP_TIME_MS]        = vl->loop_time_ms;
+    v[ADMIN_VL_ITERATION_CYCLES]    = vl->admin_cycles != 0 ? now - vl->admin_cycles : 0;
+    v[ADMIN_VL_IDLE_COUNT]          = vl->idle_count;
+    v[ADMIN_VL_OVERLOAD_LEVEL]      = vl->overload.level;
+    v[ADMIN_VL_DRAINING]            = vl->draining;
+    v[ADMIN_VL_CONNS_TCP_ACTIVE]    = vl->conns_tcp_active;
+    v[ADMIN_VL_CONNS_TCP_MAX]       = vl->conns_tcp_max;
+    v[ADMIN_VL_UDP_READ_QUEUE]      = vl_admin_queue_len(&vl->conn_udp_read_queue,
+                                                         offsetof(conn_t, read_q_handle));
+    v[ADMIN_VL_UDP_WRITE_QUEUE]     = vl_admin_queue_len(&vl->conn_udp_write_queue,
+                                                         offsetof(conn_t, write_q_handle));
+    v[ADMIN_VL_TCP_READ_QUEUE]      = vl_admin_queue_len(&vl->conn_tcp_read_queue,
+                                                         offsetof(conn_t, read_q_handle));
+    v[ADMIN_VL_TCP_WRITE_QUEUE]     = vl_admin_queue_len(&vl->conn_tcp_write_queue,
+                                                         offsetof(conn_t, write_q_handle));
+    v[ADMIN_VL_QUERY_PARSE_QUEUE]   = vl_admin_queue_len(&vl->query_parse_queue,
+                                                         offsetof(conn_t, gen_q_handle));
+    v[ADMIN_VL_QUERY_RESOLVE_QUEUE] = vl_admin_queue_len(&vl->query_resolve_queue,
+                                                         offsetof(conn_t, gen_q_handle));
+    v[ADMIN_VL_RESPONSE_PACK_QUEUE] = vl_admin_queue_len(&vl->query_response_pack_queue,
+                                                         offsetof(conn_t, gen_q_handle));
+    v[ADMIN_VL_QUERY_LOG_QUEUE]     = vl_admin_queue_len(&vl->query_log_queue,
+                                                         offsetof(conn_t, gen_q_handle));
+    v[ADMIN_VL_QUERY_LOG_BUF_LEN]   = vl->query_log.buf_len;
+    v[ADMIN_VL_QUERY_LOG_BUF_SIZE]  = vl->query_log.buf_size;
+    v[ADMIN_VL_QUERY_LOG_CHUNKS_PENDING] =
+        atomic_load_explicit(&vl->query_log.head, memory_order_relaxed) -
+        atomic_load_explicit(&vl->query_log.tail, memory_order_relaxed);
+    v[ADMIN_VL_QUERY_LOG_CHUNK_COUNT] = vl->query_log.chunk_count;
+    v[ADMIN_VL_ZONE_DB_GENERATION]  = vl->zone_db != NULL ? vl->zone_db->generation : 0;
+    v[ADMIN_VL_CONFIG_GENERATION]   = vl->cfg->generation;
+    vl->admin_cycles = now;
+
+    admin_vl_publish_begin(s);
+    for (size_t i = 0; i < ADMIN_VL_FIELDS; i++) {
+        admin_vl_set(s, i, v[i]);
+    }
+    admin_vl_publish_end(s);
+}
 
-    /* Start UDP listening sockets */
-    if (vl->cfg->udp_enable) {
-        /* Start UDP IPv4 listener. */
-        conn = conn_listener_provision(vl->cfg, AF_INET, IPPROTO_UDP, err_str,
-                                       ERR_MSG_LENGTH);
-        if (conn == NULL) {
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-            channel_log_send(vl->app_log_channel, lmsg);
-            return;
-        }
+/** Vectorloop profile flag, vectorloop serves TCP (or DoT) connections. */
+#define VL_PROFILE_TCP           (1u << 0)
 
-        /* Register IPv4 listener fd to epoll for read & write edge triggered. */
-        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd_udp, conn->fd, (uint64_t)conn);
+/** Vectorloop profile flag, vectorloop times its stages, "loop_stage_metrics"
+ * is configured.
+ */
+#define VL_PROFILE_STAGE_METRICS (1u << 1)
 
-        /* Add IPv4 listener to Vectorloop UDP read queue. */
-        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+/** Number of vectorloop profiles, combinations of VL_PROFILE_* flags. */
+#define VL_PROFILES              4
 
-        vl->listener_udp_ipv4 = conn;
-        debug_printf("VL ID %d IPv4 UDP listener started", vl->id);
+/** End stage of vectorloop loop, timing it only if profile has stage
+ * metrics, see @ref vl_stage_end.
+ */
+#define VL_STAGE_END(profile, vl, stage, items, t) do {       \
+        if ((profile) & VL_PROFILE_STAGE_METRICS) {           \
+            vl_stage_end(vl, stage, items, t);                \
+        }                                                     \
+    } while (0)
+
+/** Vectorloop loop template, see @ref vl_run. It is instantiated once per
+ * profile by @ref VL_LOOP_PROFILE with profile a constant, so stages profile
+ * does not have, TCP stages of a UDP only vectorloop and stage timing when
+ * "loop_stage_metrics" is not configured, are compiled out of that
+ * instance rather than checked on every iteration.
+ *
+ * @param vl      Vectorloop operating on.
+ * @param profile Vectorloop profile, VL_PROFILE_* flags.
+ */
+static inline __attribute__((always_inline)) void
+vl_loop(vectorloop_t *vl, unsigned int profile)
+{
+    int loop_end = 0;
 
-        /* Start UDP IPv6 listener. */
-        conn = conn_listener_provision(vl->cfg, AF_INET6, IPPROTO_UDP, err_str,
-                                       ERR_MSG_LENGTH);
-        if (conn == NULL) {
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-            channel_log_send(vl->app_log_channel, lmsg);
-            return;
+    while (!loop_end) {
+        /* ret is used to track how many queries were processed in a loop
+         * with purpose of slowing down the loop frequency so we do not burn up
+         * the CPU unnecessarily.
+         */
+        int ret = 0;
+
+        /* Number of items a stage processed. */
+        int n;
+
+        /* Cycle count at start of iteration and current stage, and whether
+         * epoll_wait() blocks this iteration.
+         */
+        uint64_t loop_start = (profile & VL_PROFILE_STAGE_METRICS) ? utl_cycles() : 0;
+        uint64_t t          = loop_start;
+        bool     ep_blocks  = vl->ep_timeout_ms > 0;
+
+        /* Get timestamp of loop iteration. */
+        utl_clock_sync(&vl->clock, &vl->loop_timestamp);
+        vl->loop_time_ms = vl->clock.mono_ms;
+
+        /* Read resources published by resource thread. */
+        vl_fn_resources(vl);
+        vl_fn_response_cache_warm(vl);
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_RESOURCES, 0, &t);
+
+        /* Check epoll for events. */
+        n = vl_fn_epoll(vl);
+        ret += n;
+        VL_STAGE_END(profile, vl, ep_blocks ? METRICS_VL_STAGE_IDLE : METRICS_VL_STAGE_EPOLL, n, &t);
+
+        /* Stop reading from listeners once drain started. */
+        vl_fn_drain(vl);
+
+        /* Read data in from UDP sockets. */
+        n = vl_fn_udp_read(vl);
+        ret += n;
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_UDP_READ, n, &t);
+
+        if (profile & VL_PROFILE_TCP) {
+            /* Accept new TCP connections. */
+            n = vl_fn_tcp_accept_conns(vl);
+            ret += n;
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_TCP_ACCEPT, n, &t);
+
+            /* Collect DoT connections TLS handshake was done on. */
+            n = vl_fn_dot_handshakes(vl);
+            ret += n;
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_DOT_HANDSHAKES, n, &t);
+
+            /* Publish load and adopt TCP connections handed off to
+             * vectorloop.
+             */
+            if (vl->handoff != NULL) {
+                n = vl_fn_tcp_handoff(vl);
+                ret += n;
+                VL_STAGE_END(profile, vl, METRICS_VL_STAGE_TCP_HANDOFF, n, &t);
+            }
         }
 
-        /* Register IPv6 listener fd to epoll for read & write edge triggered. */
-        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd_udp, conn->fd, (uint64_t)conn);
+        /* Collect worker thread jobs and resume deferred queries. */
+        if (vl->workers.count > 0) {
+            n = vl_fn_query_resume(vl);
+            ret += n;
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_QUERY_RESUME, n, &t);
+        }
 
-        /* Add IPv6 listener to Vectorloop UDP read queue. */
-        conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
+        /* Read data from TCP connections. */
+        if (profile & VL_PROFILE_TCP) {
+            n = vl_fn_tcp_read(vl);
+            ret += n;
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_TCP_READ, n, &t);
+        }
 
-        vl->listener_udp_ipv6 = conn;
-        debug_printf("VL ID %d IPv6 UDP listener started", vl->id);
-    }
+        /* Parse data into queries. */
+        n = vl_fn_query_parse(vl);
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_QUERY_PARSE, n, &t);
 
-    /* Start TCP listening sockets */
-    if (vl->cfg->tcp_enable) {
-        /* Start TCP IPv4 listener. */
-        conn = conn_listener_provision(vl->cfg, AF_INET, IPPROTO_TCP, err_str,
-                                       ERR_MSG_LENGTH);
-        if (conn == NULL) {
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-            channel_log_send(vl->app_log_channel, lmsg);
-            return;
+        /* Resolve queries into answers. */
+        n = vl_fn_query_resolve(vl);
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_QUERY_RESOLVE, n, &t);
+
+        n = vl_fn_query_response_pack(vl);
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_RESPONSE_PACK, n, &t);
+
+        if (vl->uring.ring_fd >= 0) {
+            /* Send queries answers UDP and TCP. */
+            n = vl_fn_uring_write(vl);
+        } else {
+            /* Send queries answers UDP. */
+            n = vl_fn_udp_write(vl);
+
+            /* Send queries answers TCP. */
+            if (profile & VL_PROFILE_TCP) {
+                n += vl_fn_tcp_write(vl);
+            }
         }
+        /* Send zone transfers TCP. */
+        if (profile & VL_PROFILE_TCP) {
+            n += vl_fn_tcp_xfr(vl);
+        }
+        ret += n;
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_WRITE, n, &t);
 
-        /* Register IPv4 listener fd to epoll for read & write edge triggered. */
-        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd_tcp, conn->fd, (uint64_t)conn);
+        /* Log queries. */
+        n = vl_fn_query_log(vl);
+        VL_STAGE_END(profile, vl, METRICS_VL_STAGE_QUERY_LOG, n, &t);
 
-        /* Add IPv4 listener to Vectorloop TCP read queue. */
-        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+        if (profile & VL_PROFILE_TCP) {
+            /* Check TCP connection timers for timeouts. */
+            vl_fn_tcp_conn_timeouts(vl);
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_TCP_TIMEOUTS, 0, &t);
 
-        vl->listener_tcp_ipv4 = conn;
-        debug_printf("VL ID %d IPv4 TCP listener started", vl->id);
+            /* Release TCP connection objects. */
+            vl_fn_tcp_conn_release(vl);
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_TCP_RELEASE, 0, &t);
+        }
 
+        /* Publish application log messages written this iteration. */
+        channel_log_flush(vl->app_log_channel);
 
-        /* Start TCP IPv6 listener. */
-        conn = conn_listener_provision(vl->cfg, AF_INET6, IPPROTO_TCP, err_str,
-                                       ERR_MSG_LENGTH);
-        if (conn == NULL) {
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_CUSTOM, err_str, true);
-            channel_log_send(vl->app_log_channel, lmsg);
-            return;
+        /* Idle backoff time. */
+        if (ret == 0) {
+            /* Need to slow down the loop as there was nothing to process. */
+            vl_idle(vl);
+            VL_STAGE_END(profile, vl, METRICS_VL_STAGE_IDLE, 0, &t);
+        } else if (vl->idle_count != 0) {
+            vl->idle_count = 0;
         }
 
-        /* Register IPv6 listener fd to epoll for read & write edge triggered. */
-        vl_epoll_ctl_reg_for_readwrite_et(vl->ep_fd_tcp, conn->fd, (uint64_t)conn);
+        /* Move overload level by how loop kept up. */
+        if (vl->cfg->overload_iteration_max > 0) {
+            vl_fn_overload(vl, ret != 0);
+        }
 
-        /* Add IPv6 listener to Vectorloop TCP read queue. */
-        conn_fifo_enqueue_read(&vl->conn_tcp_accept_conns_queue, conn);
+        /* Track latency against its objectives. */
+        if (vl->slo.snapshots != NULL) {
+            vl_fn_slo(vl);
+        }
+        vl_rt_yield(vl);
+        vl_loop_end(vl, loop_start, ret != 0);
+        vl_admin_publish(vl);
 
-        vl->listener_tcp_ipv6 = conn;
-        debug_printf("VL ID %d IPv6 TCP listener started", vl->id);
+        /* Exit once drained. */
+        loop_end = vl->draining && vl_drained(vl);
     }
 
-    free(err_str);
-
 }
 
-/** Create a new vectorloop object
- * 
- * @param cfg               Configuration with settings.
- * @param id                Vectorloop ID.
- * @param res_ch            Resource channel used for this vectorloop.
- * @param app_log_channel   Application log channel used for this vectorloop.
- * @param query_log_channel Query log channel used for this vectorloop.
- * @param metrics           Metrics object vectorloop to use.
+/** Instantiate vectorloop loop template for a profile.
  *
- * @return                  Returns newly created vectorloop object. 
+ * @param name    Name of loop function.
+ * @param profile Vectorloop profile, VL_PROFILE_* flags.
  */
-vectorloop_t *
-vl_new(config_t *cfg, int id, channel_bss_t *res_ch,
-       channel_log_t *app_log_channel, channel_bss_t *query_log_channel,
-       metrics_t *metrics) {
-    /* Init new vectorloop object. */
-    vectorloop_t *vl = malloc(sizeof(vectorloop_t));
-    CHECK_MALLOC(vl);
-    *vl = (vectorloop_t) {
-        .cfg               = cfg,
-        .id                = id,
-        .resource_channel  = res_ch,
-        .app_log_channel   = app_log_channel,
-        .query_log_channel = query_log_channel,
-        .metrics           = metrics,
-        .ep_fd_tcp         = -1,
-        .ep_fd_udp         = -1,
-    };
-
-    /* Allocate epoll events array. */
-    int num_events = cfg->epoll_num_events_udp > cfg->epoll_num_events_tcp ?
-                     cfg->epoll_num_events_udp : cfg->epoll_num_events_tcp;
-    vl->ep_events = malloc(sizeof(struct epoll_event) * num_events);
-    CHECK_MALLOC(vl->ep_events);
-
-    /* Create epoll fd. */
-    vl->ep_fd_udp = vl_epoll_create();
+#define VL_LOOP_PROFILE(name, profile) \
+    static void                        \
+    name(vectorloop_t *vl)             \
+    {                                  \
+        vl_loop(vl, profile);          \
+    }
 
-    /* Create epoll fd. */
-    vl->ep_fd_tcp = vl_epoll_create(); 
+VL_LOOP_PROFILE(vl_loop_udp,       0)
+VL_LOOP_PROFILE(vl_loop_tcp,       VL_PROFILE_TCP)
+VL_LOOP_PROFILE(vl_loop_udp_timed, VL_PROFILE_STAGE_METRICS)
+VL_LOOP_PROFILE(vl_loop_tcp_timed, VL_PROFILE_TCP | VL_PROFILE_STAGE_METRICS)
 
-    /* Allocate query log buffers. */
-    vl->query_log.a_buf    = malloc(vl->cfg->query_log_buffer_size);
-    CHECK_MALLOC(vl->query_log.a_buf);
-    vl->query_log.b_buf    = malloc(vl->cfg->query_log_buffer_size);
-    CHECK_MALLOC(vl->query_log.b_buf);
-    vl->query_log.buf      = vl->query_log.a_buf;
-    vl->query_log.buf_size = vl->cfg->query_log_buffer_size;
-    vl->query_log.buf_len  = 0;
+/** Vectorloop loop instances, indexed by profile. */
+static void (*const vl_loops[VL_PROFILES])(vectorloop_t *vl) = {
+    [0]                                        = vl_loop_udp,
+    [VL_PROFILE_TCP]                           = vl_loop_tcp,
+    [VL_PROFILE_STAGE_METRICS]                 = vl_loop_udp_timed,
+    [VL_PROFILE_TCP | VL_PROFILE_STAGE_METRICS] = vl_loop_tcp_timed,
+};
 
-    return vl;
+/** Get profile of vectorloop loop instance to run for configuration.
+ *
+ * @param cfg Application configuration.
+ *
+ * @return    Returns vectorloop profile, VL_PROFILE_* flags.
+ */
+static unsigned int
+vl_profile(const config_t *cfg)
+{
+    return (cfg->tcp_enable || cfg->dot_enable ? VL_PROFILE_TCP : 0) |
+           (cfg->loop_stage_metrics ? VL_PROFILE_STAGE_METRICS : 0);
 }
 
 /** Main Vectorloop function (loop) that receives DNS queries, processes then,
  * sends and logs responses.
  *
  * This is a continuous loop that slows it self down if there was no data to
- * process. Slowdown is done so we do not run CPU hot needlessly.
- * Policy is to slow down (sleep) after 8 iteration by 10us, then 8 more
- * iterations by 50us, then by 1ms. from there on. If data is received the
- * slowdown loop stages start over.
+ * process, so we do not run CPU hot needlessly. Idle loop first spins for a
+ * short time so that queries arriving shortly after are picked up without
+ * delay, then blocks in epoll_wait() until a socket becomes ready, another
+ * thread wakes it through wake_fd (DoT handshake done) or nearest TCP
+ * connection timer is due. See @ref vl_idle. If data is received the idle
+ * policy starts over.
+ *
+ * With "loop_stage_metrics" configured each step (stage) is timed with CPU
+ * cycle counter, see @ref vl_stage_end.
  * 
  * @param arg Pointer to vectorloop object to run. Argument is of type void* as
  *            this function is invoked by pthread_create().
@@ -1261,8 +5542,7 @@ vl_new(config_t *cfg, int id, channel_bss_t *res_ch,
 void *
 vl_run(void *arg)
 {
-    vectorloop_t *vl       = (vectorloop_t *)arg;
-    int           loop_end = 0;
+    vectorloop_t *vl = (vectorloop_t *)arg;
     cpu_set_t     cpu_set;
     int           affinity;
 
@@ -1272,82 +5552,175 @@ vl_run(void *arg)
         CPU_SET(vl->cfg->process_thread_masks[vl->id]-1, &cpu_set);
         affinity = sched_setaffinity(0, sizeof(cpu_set_t), &cpu_set);
         if (affinity < 0) {
-            channel_log_msg_t *lmsg = channel_log_msg_create(APP_LOG_MSG_VL_RUN_CPU_AFFINITY, NULL, false);
-            channel_log_send(vl->app_log_channel, lmsg);
+            channel_log_write_id(vl->app_log_channel, APP_LOG_MSG_VL_RUN_CPU_AFFINITY, errno, false);
+        }
+    }
+
+    /* Set real-time scheduling policy, once bound to CPU. */
+    if (vl->cfg->process_thread_sched_policy != SCHED_OTHER) {
+        struct sched_param param = {
+            .sched_priority = vl->cfg->process_thread_sched_priority,
+        };
+
+        affinity = pthread_setschedparam(pthread_self(),
+                                         vl->cfg->process_thread_sched_policy,
+                                         &param);
+        if (affinity != 0) {
+            channel_log_write_id(vl->app_log_channel, APP_LOG_MSG_VL_RUN_SCHED_POLICY, affinity, false);
         }
+        vl->rt_sched = affinity == 0;
     }
 
-    /* Initialize admin channel on this thread(core). */
+    /* Initialize DoT handshake and worker queues on this thread(core). */
     LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
 
+    /* Allocate buffers now that thread is bound to its CPU, and let thread
+     * that started vectorloop know they are ready.
+     */
+    vl_buffers_init(vl);
+    if (vl->start_barrier != NULL) {
+        pthread_barrier_wait(vl->start_barrier);
+    }
+
+    /* Create io_uring for sending query responses. */
+    if (vl->cfg->io_uring_enable) {
+        vl_uring_start(vl);
+    }
+
+    /* Listeners inherited from process being upgraded are shared with it,
+     * and it serves them until this process is ready. Start serving them once
+     * zone database is loaded. With zone prefaulting listeners also wait for
+     * zone database, so first queries are answered from warm memory.
+     */
+    if ((vl->upgrade != NULL && vl->upgrade->inherited_count > 0) ||
+        vl->cfg->zone_prefault) {
+        while (vl->cfg->resource_1_filepath[0] != '\0' &&
+               atomic_load_explicit(&vl->resources->resources[RESOURCE_ID_ZONE_DB],
+                                    memory_order_acquire) == NULL) {
+            usleep(UPGRADE_POLL_MS * 1000);
+        }
+    }
+
     /* Start listeners. */
     vl_register_listeners(vl);
-    
-    /* Vector loop. */
-    while (!loop_end)
-    {
-        /* ret is used to track how many queries were processed in a loop
-         * with purpose of slowing down the loop frequency so we do not burn up
-         * the CPU unnecessarily.
-         */
-        int ret = 0;
-
-        /* Get timestamp of loop iteration. */
-        utl_clock_gettime_rt_fatal(&vl->loop_timestamp); 
+    if (vl->upgrade != NULL) {
+        upgrade_vl_ready(vl->upgrade, vl->id);
+    }
 
-        /* Check for messages on channels from other treads */
-        ret += vl_fn_channel_messages(vl);
+    /* Start reading resources. */
+    qsbr_online(&vl->resources->qsbr, vl->id);
 
-        /* Check epoll for events. */
-        ret += vl_fn_epoll(vl);
+    /* Publish application log messages written while starting up. */
+    channel_log_flush(vl->app_log_channel);
+    
+    /* Vector loop, instance for profile of configuration. Options profile
+     * is made of are not reloadable.
+     */
+    vl_loops[vl_profile(vl->cfg)](vl);
+
+    /* Save questions of cached responses for next process. */
+    vl_response_cache_snapshot_write(vl);
+
+    /* Stop reading resources, resource thread no longer waits on vectorloop
+     * to release old ones.
+     */
+    qsbr_offline(&vl->resources->qsbr, vl->id);
+    channel_log_flush(vl->app_log_channel);
+    query_log_close(&vl->query_log);
+    vl_drain_done(vl->drain);
 
-        /* Read data in from UDP sockets. */
-        ret += vl_fn_udp_read(vl);
+    return NULL;
+}
 
-        /* Accept new TCP connections. */
-        ret += vl_fn_tcp_accept_conns(vl);
+/** Replay queries of a pcap file through vectorloop UDP stages: read, parse,
+ * resolve, pack, write and log, on calling thread. Replay listener reads
+ * queries from memory and captures responses instead of sending them, see
+ * @ref vl_replay_recv() and @ref vl_replay_send(), so stages are measured
+ * without kernel network stack. Query log chunks are dropped once published,
+ * as there is no query log thread consuming them. Function returns once
+ * replay->queries_max queries were replayed and logged.
+ *
+ * Vectorloop is created by @ref vl_new() and is not run by @ref vl_run().
+ * Its configuration MUST have UDP enabled for it, so arena replay listener
+ * batches are allocated from is there. Resources (zone database and
+ * configuration) are read from resource set, same as @ref vl_run() does.
+ * With "loop_stage_metrics" configured each stage is timed, see
+ * @ref vl_stage_end. Vectorloop buffers and replay listener are allocated on
+ * first replay and reused by next ones.
+ *
+ * @param vl     Vectorloop to replay queries through.
+ * @param replay Queries to replay, see @ref vl_replay_reset().
+ */
+void
+vl_replay_run(vectorloop_t *vl, vl_replay_t *replay)
+{
+    conn_t   *conn = vl->listener_replay;
+    config_t *cfg  = NULL;
+
+    if (conn == NULL) {
+        vl_buffers_init(vl);
+
+        /* Replay listener stands in for UDP listener bound to any address. */
+        cfg  = config_listener_cfg(vl->cfg, vl->cfg->listener_profile_udp);
+        conn = mem_malloc(MEM_TAG_UDP, sizeof(conn_t));
+        CHECK_MALLOC(conn);
+        *conn = (conn_t) {
+            .fd         = -1,
+            .lc         = 0,
+            .proto      = 0,
+            .ip_version = 1,
+            .replay     = 1,
+            .conn.udp   = conn_udp_new(cfg, AF_INET6, &vl->arena),
+        };
+        conn_udp_batches_new(conn, cfg, cfg->udp_listener_batches, &vl->arena);
+        vl->listener_replay = conn;
+    }
+    vl->replay             = replay;
+    conn->waiting_for_read = 0;
+    conn_fifo_enqueue_read(&vl->conn_udp_read_queue, conn);
 
-        /* Read data from TCP connections. */
-        ret += vl_fn_tcp_read(vl);
+    qsbr_online(&vl->resources->qsbr, vl->id);
+    do {
+        int      ret        = 0;
+        int      n;
+        uint64_t loop_start = vl->cfg->loop_stage_metrics ? utl_cycles() : 0;
+        uint64_t t          = loop_start;
 
-        /* Parse data into queries. */
-        vl_fn_query_parse(vl);
+        utl_clock_sync(&vl->clock, &vl->loop_timestamp);
+        vl->loop_time_ms = vl->clock.mono_ms;
 
-        /* Resolve queries into answers. */
-        vl_fn_query_resolve(vl);
+        vl_fn_resources(vl);
+        vl_stage_end(vl, METRICS_VL_STAGE_RESOURCES, 0, &t);
 
-        vl_fn_query_response_pack(vl);
+        n = vl_fn_udp_read(vl);
+        ret += n;
+        vl_stage_end(vl, METRICS_VL_STAGE_UDP_READ, n, &t);
 
-        /* Send queries answers UDP. */
-        ret += vl_fn_udp_write(vl);
+        n = vl_fn_query_parse(vl);
+        vl_stage_end(vl, METRICS_VL_STAGE_QUERY_PARSE, n, &t);
 
-        /* Send queries answers TCP. */
-        ret += vl_fn_tcp_write(vl);
+        n = vl_fn_query_resolve(vl);
+        vl_stage_end(vl, METRICS_VL_STAGE_QUERY_RESOLVE, n, &t);
 
-        /* Log queries. */
-        vl_fn_query_log(vl);
+        n = vl_fn_query_response_pack(vl);
+        vl_stage_end(vl, METRICS_VL_STAGE_RESPONSE_PACK, n, &t);
 
-        /* Check TCP LRU cache for timeouts. */
-        vl_fn_tcp_conn_timeouts(vl);
+        n = vl_fn_udp_write(vl);
+        ret += n;
+        vl_stage_end(vl, METRICS_VL_STAGE_WRITE, n, &t);
 
-        /* Release TCP connection objects. */
-        vl_fn_tcp_conn_release(vl);
+        n = vl_fn_query_log(vl);
+        vl_stage_end(vl, METRICS_VL_STAGE_QUERY_LOG, n, &t);
 
-        /* Idle backoff time. */
-        if (ret == 0) {
-            /* Need to slow down the loop as there was nothing to process. */
-            INCREMENT(vl->idle_count);
-            if (vl->idle_count < 8) {
-               usleep(vl->cfg->loop_slowdown_one);
-            } else if (vl->idle_count < 16) {
-               usleep(vl->cfg->loop_slowdown_two);
-            } else {
-                usleep(vl->cfg->loop_slowdown_three);
-            }
-        } else if (vl->idle_count != 0) {
-            vl->idle_count = 0;
+        /* Drop published query log chunks, query log thread would write
+         * them out.
+         */
+        while (query_log_peek(&vl->query_log) != NULL) {
+            query_log_consume(&vl->query_log);
         }
-    }
+        channel_log_flush(vl->app_log_channel);
 
-    return NULL;
+        vl_loop_end(vl, loop_start, ret != 0);
+    } while (!vl_queues_empty(vl));
+    qsbr_offline(&vl->resources->qsbr, vl->id);
 }
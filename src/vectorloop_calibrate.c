@@ -0,0 +1,446 @@
+/**
+ * @file vectorloop_calibrate.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlcalibrate
+ *  @{
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+
+#include "constants.h"
+#include "histogram.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "vectorloop_calibrate.h"
+#include "vectorloop_epoll.h"
+
+/** Number of names in calibration zone, each has an A and AAAA record. */
+#define VL_CALIBRATE_NAMES 1024
+
+/** Number of distinct queries replayed, every eighth is for a name not in
+ * calibration zone.
+ */
+#define VL_CALIBRATE_FRAMES 4096
+
+/** Number of queries replayed per round. */
+#define VL_CALIBRATE_QUERIES 32768
+
+/** Number of rounds per vector length, fastest one counts. */
+#define VL_CALIBRATE_ROUNDS 3
+
+/** UDP events per epoll_wait(): IPv4, IPv6 and AF_XDP listener and wake up
+ * eventfd.
+ */
+#define VL_CALIBRATE_EPOLL_EVENTS_UDP 4
+
+/** Number of wake ups measured. */
+#define VL_CALIBRATE_WAKE_ROUNDS 64
+
+/** Time in nanoseconds waker sleeps before each wake up, so calibration
+ * vectorloop is blocked in epoll_wait() by then.
+ */
+#define VL_CALIBRATE_WAKE_DELAY_NS 200000
+
+/** Time in milliseconds calibration vectorloop blocks for a wake up at most. */
+#define VL_CALIBRATE_WAKE_TIMEOUT_MS 100
+
+/** Wake up latency measurement state, shared by calibrating thread and
+ * waker thread.
+ */
+typedef struct vl_calibrate_waker_s {
+    /** Eventfd calibration vectorloop is woken up through. */
+    int fd;
+
+    /** Monotonic time in nanoseconds of last eventfd write. */
+    atomic_ullong sent_ns;
+
+    /** Number of wake ups calibrating thread has measured. */
+    atomic_uint acked;
+} vl_calibrate_waker_t;
+
+/** Get monotonic time in nanoseconds.
+ *
+ * @return Returns time.
+ */
+static uint64_t
+vl_calibrate_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return utl_timespec_to_ns(&ts);
+}
+
+/** Compare two 64 bit values, for qsort().
+ *
+ * @param a First value.
+ * @param b Second value.
+ *
+ * @return  Returns -1, 0 or 1 as a is lower, equal or higher than b.
+ */
+static int
+vl_calibrate_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/** Build calibration zone, its apex and VL_CALIBRATE_NAMES names with an A
+ * and AAAA record each.
+ *
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns zone database, or NULL on error.
+ */
+static zone_db_t *
+vl_calibrate_zone(char *err, size_t err_len)
+{
+    static const char *apex =
+        "calibrate.test. 3600 IN SOA ns.calibrate.test. admin.calibrate.test. "
+        "1 7200 3600 1209600 300\n"
+        "calibrate.test. 3600 IN NS ns.calibrate.test.\n"
+        "ns.calibrate.test. 3600 IN A 192.0.2.1\n";
+    size_t     size = strlen(apex) + VL_CALIBRATE_NAMES * 128;
+    char      *buf  = malloc(size);
+    size_t     len  = 0;
+    zone_db_t *db   = NULL;
+
+    CHECK_MALLOC(buf);
+    len = snprintf(buf, size, "%s", apex);
+    for (unsigned int i = 0; i < VL_CALIBRATE_NAMES; i++) {
+        len += snprintf(buf + len, size - len,
+                        "h%u.calibrate.test. 300 IN A 192.0.2.%u\n"
+                        "h%u.calibrate.test. 300 IN AAAA 2001:db8::%x\n",
+                        i, i & 0xff, i, i);
+    }
+    db = zone_db_create(buf, len, 1, err, err_len);
+    free(buf);
+
+    return db;
+}
+
+/** Initialize calibration of vectorloop settings for configuration. Zone
+ * and queries to replay are built, and calibration vectorloop is created,
+ * its buffers are allocated by first @ref vl_calibrate_run(). Calibration
+ * vectorloop runs UDP listener of replayed queries only, other settings,
+ * such as response cache, response rate limiting or query log sampling,
+ * are those of configuration.
+ *
+ * @param cal     Calibration to initialize.
+ * @param cfg     Configuration with settings:
+ *                - loop_calibrate_latency,
+ *                - loop_budget_tcp_reads,
+ *                - udp_listener_port.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, -1 if calibration zone could not be
+ *                built.
+ */
+int
+vl_calibrate_init(vl_calibrate_t *cal, const config_t *cfg, char *err, size_t err_len)
+{
+    char name[64];
+
+    memset(cal, 0, sizeof(*cal));
+    cal->db = vl_calibrate_zone(err, err_len);
+    if (cal->db == NULL) {
+        return -1;
+    }
+    cal->latency_ns       = (uint64_t)cfg->loop_calibrate_latency * 1000;
+    cal->budget_tcp_reads = cfg->loop_budget_tcp_reads;
+    cal->roles[0]         = VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6;
+    cal->masks[0]         = 0;
+
+    /* Queries for names spread over calibration zone, from many clients so
+     * per client state (RRL buckets) is spread too.
+     */
+    vl_replay_init(&cal->replay, cfg->udp_listener_port, VL_CALIBRATE_FRAMES);
+    for (uint32_t i = 0; i < VL_CALIBRATE_FRAMES; i++) {
+        uint32_t n = (i * 7919) % VL_CALIBRATE_NAMES;
+
+        snprintf(name, sizeof(name), "%c%u.calibrate.test", i % 8 == 7 ? 'x' : 'h', n);
+        vl_replay_query_add(&cal->replay, (i * 2654435761u) & 0xffffff, name,
+                            i % 2 == 0 ? rip_ns_t_a : rip_ns_t_aaaa);
+    }
+
+    /* Vectorloop is created with longest vector, buffers are sized for it
+     * and shorter ones are set as configuration reload sets them.
+     */
+    for (size_t i = 0; i < VL_CALIBRATE_VECTOR_LENS; i++) {
+        config_t *c = &cal->cfgs[i];
+
+        *c = *cfg;
+        c->udp_enable                   = true;
+        c->tcp_enable                   = false;
+        c->dot_enable                   = false;
+        c->io_uring_enable              = false;
+        c->xdp_interface                = NULL;
+        c->process_thread_count         = 1;
+        c->process_worker_id            = 0;
+        c->process_thread_roles         = cal->roles;
+        c->process_thread_masks         = cal->masks;
+        c->tcp_conns_per_vl_max         = 1;
+        c->query_log_shm_path           = NULL;
+        c->response_cache_snapshot_path = NULL;
+        c->loop_stage_metrics           = true;
+        c->loop_mlock                   = false;
+        c->udp_conn_vector_len          = (size_t)1 << i;
+        c->udp_conn_vector_len_min      = 0;
+    }
+
+    cal->metrics = malloc(sizeof(metrics_t));
+    CHECK_MALLOC(cal->metrics);
+    metrics_init(cal->metrics, 1);
+    cal->resources = aligned_alloc(CACHE_LINE_SIZE, sizeof(resource_set_t));
+    CHECK_MALLOC(cal->resources);
+    resource_set_init(cal->resources, 1);
+    atomic_store(&cal->resources->resources[RESOURCE_ID_ZONE_DB], cal->db);
+    atomic_store(&cal->resources->resources[RESOURCE_ID_CONFIG],
+                 &cal->cfgs[VL_CALIBRATE_VECTOR_LENS - 1]);
+    cal->app_log_channel = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_log_t));
+    CHECK_MALLOC(cal->app_log_channel);
+    channel_log_init(cal->app_log_channel, -1);
+    vl_drain_init(&cal->drain, 1);
+
+    cal->vl = vl_new(&cal->cfgs[VL_CALIBRATE_VECTOR_LENS - 1], 0, cal->resources,
+                     cal->app_log_channel, cal->metrics, NULL, NULL, NULL, NULL, NULL,
+                     NULL, &cal->drain);
+
+    return 0;
+}
+
+/** Waker thread function, writes calibration vectorloop eventfd
+ * VL_CALIBRATE_WAKE_ROUNDS times, each time once previous wake up was
+ * measured and VL_CALIBRATE_WAKE_DELAY_NS has passed.
+ *
+ * @param arg Wake up measurement state.
+ *
+ * @return    Returns NULL.
+ */
+static void *
+vl_calibrate_waker(void *arg)
+{
+    vl_calibrate_waker_t *w     = arg;
+    struct timespec       delay = { .tv_sec = 0, .tv_nsec = VL_CALIBRATE_WAKE_DELAY_NS };
+
+    for (unsigned int i = 1; i <= VL_CALIBRATE_WAKE_ROUNDS; i++) {
+        nanosleep(&delay, NULL);
+        atomic_store(&w->sent_ns, vl_calibrate_now_ns());
+        eventfd_write(w->fd, 1);
+        while (atomic_load(&w->acked) < i) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/** Measure how long blocking in epoll_wait() and being woken up through
+ * eventfd takes, as calibration vectorloop would when idle.
+ *
+ * @note This is a helper function for @ref vl_calibrate_run().
+ *
+ * @param cal Calibration operating on.
+ *
+ * @return    Returns median wake up time in nanoseconds, or 0 if waker
+ *            thread could not be started.
+ */
+static uint64_t
+vl_calibrate_wake(vl_calibrate_t *cal)
+{
+    vl_calibrate_waker_t waker = { .fd = cal->vl->wake_fd };
+    uint64_t             samples[VL_CALIBRATE_WAKE_ROUNDS];
+    struct epoll_event   event;
+    pthread_t            thread;
+    uint32_t             n;
+
+    atomic_init(&waker.sent_ns, 0);
+    atomic_init(&waker.acked, 0);
+    vl_epoll_wake_drain(cal->vl->wake_fd);
+    if (pthread_create(&thread, NULL, vl_calibrate_waker, &waker) != 0) {
+        return 0;
+    }
+    for (unsigned int i = 1; i <= VL_CALIBRATE_WAKE_ROUNDS; i++) {
+        do {
+            n = vl_epoll_wait(cal->vl->ep_fd, &event, 1, VL_CALIBRATE_WAKE_TIMEOUT_MS);
+        } while (n == 0 || atomic_load(&waker.sent_ns) == 0);
+        samples[i - 1] = vl_calibrate_now_ns() - atomic_load(&waker.sent_ns);
+        vl_epoll_wake_drain(cal->vl->wake_fd);
+        atomic_store(&waker.sent_ns, 0);
+        atomic_store(&waker.acked, i);
+    }
+    pthread_join(thread, NULL);
+    qsort(samples, VL_CALIBRATE_WAKE_ROUNDS, sizeof(uint64_t), vl_calibrate_cmp);
+
+    return samples[VL_CALIBRATE_WAKE_ROUNDS / 2];
+}
+
+/** Run calibration: replay queries once per vector length tried and measure
+ * wake up time, then choose settings, see @ref vlcalibrate. Runs on calling
+ * thread and takes a second or two.
+ *
+ * @param cal    Calibration to run.
+ * @param result Where to store chosen settings and measurements.
+ */
+void
+vl_calibrate_run(vl_calibrate_t *cal, vl_calibrate_result_t *result)
+{
+    metrics_vl_t *metrics_vl     = metrics_vl_get(cal->metrics, 0);
+    uint64_t      cycles_per_sec = utl_cycles_per_sec();
+    uint64_t      query_ns[VL_CALIBRATE_VECTOR_LENS];
+    size_t        best           = 0;
+    bool          found          = false;
+    uint64_t      tcp            = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    /* Warm up caches and branch predictors, with longest vector. */
+    atomic_store_explicit(&cal->resources->resources[RESOURCE_ID_CONFIG],
+                          &cal->cfgs[VL_CALIBRATE_VECTOR_LENS - 1], memory_order_release);
+    vl_replay_reset(&cal->replay, VL_CALIBRATE_QUERIES);
+    vl_replay_run(cal->vl, &cal->replay);
+
+    for (size_t i = 0; i < VL_CALIBRATE_VECTOR_LENS; i++) {
+        uint64_t ns_min   = UINT64_MAX;
+        uint64_t iter_min = UINT64_MAX;
+
+        atomic_store_explicit(&cal->resources->resources[RESOURCE_ID_CONFIG],
+                              &cal->cfgs[i], memory_order_release);
+        for (int r = 0; r < VL_CALIBRATE_ROUNDS; r++) {
+            uint64_t start;
+            uint64_t ns;
+            uint64_t iter;
+
+            memset(&metrics_vl->loop.iteration, 0, sizeof(histogram_t));
+            vl_replay_reset(&cal->replay, VL_CALIBRATE_QUERIES);
+            start = vl_calibrate_now_ns();
+            vl_replay_run(cal->vl, &cal->replay);
+            ns   = vl_calibrate_now_ns() - start;
+            iter = (unsigned __int128)histogram_quantile(&metrics_vl->loop.iteration, 0.99) *
+                   1000000000 / cycles_per_sec;
+            if (ns < ns_min) {
+                ns_min = ns;
+            }
+            if (iter < iter_min) {
+                iter_min = iter;
+            }
+        }
+        if (ns_min == 0) {
+            ns_min = 1;
+        }
+        result->qps[i]          = (unsigned __int128)VL_CALIBRATE_QUERIES * 1000000000 / ns_min;
+        result->iteration_ns[i] = iter_min;
+        query_ns[i]             = ns_min / VL_CALIBRATE_QUERIES > 0 ?
+                                  ns_min / VL_CALIBRATE_QUERIES : 1;
+
+        if (iter_min <= cal->latency_ns && (!found || result->qps[i] > result->qps[best])) {
+            best  = i;
+            found = true;
+        }
+    }
+
+    /* Shortest vector if none keeps iterations within latency target. */
+    result->udp_conn_vector_len = cal->cfgs[best].udp_conn_vector_len;
+
+    /* TCP reads fill rest of iteration time. */
+    if (cal->latency_ns > result->iteration_ns[best]) {
+        tcp = (cal->latency_ns - result->iteration_ns[best]) / query_ns[best];
+    }
+    if (cal->budget_tcp_reads > 0 && tcp > cal->budget_tcp_reads) {
+        tcp = cal->budget_tcp_reads;
+    }
+    if (tcp < EPOLL_NUM_EVENTS_MIN) {
+        tcp = EPOLL_NUM_EVENTS_MIN;
+    } else if (tcp > EPOLL_NUM_EVENTS_MAX) {
+        tcp = EPOLL_NUM_EVENTS_MAX;
+    }
+    result->epoll_num_events_tcp = tcp;
+    result->epoll_num_events_udp = VL_CALIBRATE_EPOLL_EVENTS_UDP;
+
+    /* Spin as long as blocking and being woken up takes, configured spin
+     * time is kept if it could not be measured.
+     */
+    result->wake_ns = vl_calibrate_wake(cal);
+    if (result->wake_ns > 0) {
+        result->loop_idle_spin = (result->wake_ns + 999) / 1000;
+        if (result->loop_idle_spin > VL_IDLE_SPIN_MAX) {
+            result->loop_idle_spin = VL_IDLE_SPIN_MAX;
+        }
+    } else {
+        result->loop_idle_spin = cal->cfgs[0].loop_idle_spin;
+    }
+}
+
+/** Set settings calibration chose in configuration.
+ *
+ * @param result Calibration result.
+ * @param cfg    Configuration to set settings in.
+ */
+void
+vl_calibrate_apply(const vl_calibrate_result_t *result, config_t *cfg)
+{
+    cfg->udp_conn_vector_len  = result->udp_conn_vector_len;
+    cfg->epoll_num_events_udp = result->epoll_num_events_udp;
+    cfg->epoll_num_events_tcp = result->epoll_num_events_tcp;
+    cfg->loop_idle_spin       = result->loop_idle_spin;
+}
+
+/** Format settings calibration chose, as "<option>=<value>" pairs, followed
+ * by throughput and iteration time at chosen vector length and wake up time
+ * they were chosen from.
+ *
+ * @param result  Calibration result.
+ * @param buf     Buffer to format into.
+ * @param buf_len Length of buffer.
+ *
+ * @return        Returns number of characters formatted, as snprintf().
+ */
+int
+vl_calibrate_format(const vl_calibrate_result_t *result, char *buf, size_t buf_len)
+{
+    size_t i = __builtin_ctzll(result->udp_conn_vector_len);
+
+    return snprintf(buf, buf_len,
+                    "udp_conn_vector_len=%zu epoll_num_events_udp=%d "
+                    "epoll_num_events_tcp=%d loop_idle_spin=%zu (%" PRIu64 " queries/s, "
+                    "p99 iteration %" PRIu64 " us, wake up %" PRIu64 " us)",
+                    result->udp_conn_vector_len, result->epoll_num_events_udp,
+                    result->epoll_num_events_tcp, result->loop_idle_spin,
+                    result->qps[i], result->iteration_ns[i] / 1000,
+                    result->wake_ns / 1000);
+}
+
+/** @}*/
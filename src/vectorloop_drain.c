@@ -0,0 +1,118 @@
+/**
+ * @file vectorloop_drain.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vldrain
+ *  @{
+ */
+#include <stdlib.h>
+#include <sys/eventfd.h>
+
+#include "utils.h"
+#include "vectorloop_drain.h"
+
+/** Initialize drain state for count vectorloops, none registered.
+ *
+ * @param d     Drain state to initialize.
+ * @param count Number of vectorloops.
+ */
+void
+vl_drain_init(vl_drain_t *d, size_t count)
+{
+    d->count    = count;
+    d->wake_fds = malloc(sizeof(int) * count);
+    CHECK_MALLOC(d->wake_fds);
+    for (size_t i = 0; i < count; i++) {
+        d->wake_fds[i] = -1;
+    }
+    atomic_init(&d->draining, false);
+    atomic_init(&d->drained, 0);
+}
+
+/** Release memory held by drain state.
+ *
+ * @param d Drain state to clean.
+ */
+void
+vl_drain_clean(vl_drain_t *d)
+{
+    free(d->wake_fds);
+    d->wake_fds = NULL;
+    d->count    = 0;
+}
+
+/** Register eventfd vectorloop is woken up with once drain starts. Called
+ * before vectorloop threads are started.
+ *
+ * @param d       Drain state.
+ * @param id      Vectorloop ID.
+ * @param wake_fd Vectorloop eventfd.
+ */
+void
+vl_drain_register(vl_drain_t *d, int id, int wake_fd)
+{
+    d->wake_fds[id] = wake_fd;
+}
+
+/** Have vectorloops drain, and wake them up so vectorloops blocked waiting
+ * for events start right away. Calling it again has no effect.
+ *
+ * @param d Drain state.
+ */
+void
+vl_drain_start(vl_drain_t *d)
+{
+    if (atomic_exchange_explicit(&d->draining, true, memory_order_relaxed)) {
+        return;
+    }
+    for (size_t i = 0; i < d->count; i++) {
+        if (d->wake_fds[i] >= 0) {
+            eventfd_write(d->wake_fds[i], 1);
+        }
+    }
+}
+
+/** Report vectorloop drained. Called by vectorloop once, right before its
+ * thread exits.
+ *
+ * @param d Drain state.
+ */
+void
+vl_drain_done(vl_drain_t *d)
+{
+    atomic_fetch_add_explicit(&d->drained, 1, memory_order_release);
+}
+
+/** Get number of vectorloops drained.
+ *
+ * @param d Drain state.
+ *
+ * @return  Returns number of vectorloops that reported they drained.
+ */
+size_t
+vl_drain_count(vl_drain_t *d)
+{
+    return atomic_load_explicit(&d->drained, memory_order_acquire);
+}
+
+/** @}*/
@@ -27,9 +27,11 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "constants.h"
 #include "utils.h"
+#include "vectorloop_epoll.h"
 
 /** Create an epoll file descriptor.
  * 
@@ -70,25 +72,32 @@ vl_epoll_create(void)
 }
 
 /** Issue epoll wait on vectorloop epoll instance and return number of events
- * epoll_wait() returned. epoll_wait is called with timeout of 0.
+ * epoll_wait() returned.
  * 
  * If there was an error in which case epoll_wait() returned -1, function aborts
- * (throws an exception).
+ * (throws an exception). Wait interrupted by a signal is not an error, 0 is
+ * returned in that case.
  * 
  * @param ep_fd          Vectorloop operating under.
  * @param ep_events      Array of epoll events.
  * @param num_max_events Maximum number of events to report. There MUST be at
  *                       least this many entries in ep_events array.
+ * @param timeout        Time in milliseconds to block for if there are no
+ *                       events, 0 returns immediately.
  * 
  * @return   On success returns number of events returned by epoll. 
  *           On error, message if printed to stderr and assert called.
  */
 uint32_t
-vl_epoll_wait(int ep_fd, struct epoll_event *ep_events, int num_max_events)
+vl_epoll_wait(int ep_fd, struct epoll_event *ep_events, int num_max_events,
+              int timeout)
 {
     int event_count = 0;
 
-    event_count = epoll_wait(ep_fd, ep_events, num_max_events, 0);
+    event_count = epoll_wait(ep_fd, ep_events, num_max_events, timeout);
+    if (event_count < 0 && errno == EINTR) {
+        return 0;
+    }
     if (event_count < 0) {
         fprintf(stderr, "vl_epoll_wait() err no %d, error message: %s\n",
                 errno, strerror(errno));
@@ -97,6 +106,44 @@ vl_epoll_wait(int ep_fd, struct epoll_event *ep_events, int num_max_events)
     return event_count;
 }
 
+/** Create a non blocking eventfd used to wake up vectorloop blocked in
+ * epoll_wait() and register it with epoll for Edge Triggered read events
+ * under event ID @ref VL_EPOLL_ID_WAKE.
+ * 
+ * @note If eventfd could not be created a message is printed to stderr and
+ *       assert called.
+ * 
+ * @param ep_fd Epoll file descriptor to register with.
+ * 
+ * @return      Returns eventfd file descriptor.
+ */
+int
+vl_epoll_wake_create(int ep_fd)
+{
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        fprintf(stderr, "vl_epoll_wake_create() err no %d, error message: %s\n",
+                errno, strerror(errno));
+        assert(0);
+    }
+    vl_epoll_ctl_reg_for_read_et(ep_fd, wake_fd, VL_EPOLL_ID_WAKE);
+
+    return wake_fd;
+}
+
+/** Reset counter of wake up eventfd after it was reported by epoll.
+ * 
+ * @param wake_fd Eventfd to reset.
+ */
+void
+vl_epoll_wake_drain(int wake_fd)
+{
+    eventfd_t value;
+
+    /* Only possible error is EAGAIN if counter was already reset. */
+    eventfd_read(wake_fd, &value);
+}
+
 /** Register an open socket with epoll for Edge Triggered read events.
  * 
  * @note If socket could not be registered with epoll a message is printed to
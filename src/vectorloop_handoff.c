@@ -0,0 +1,225 @@
+/**
+ * @file vectorloop_handoff.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlhandoff
+ *  @{
+ */
+#include <stdlib.h>
+#include <sys/eventfd.h>
+
+#include "utils.h"
+#include "vectorloop_handoff.h"
+
+/** Initialize TCP connection handoff state for vectorloops configured,
+ * vectorloops start with no load published.
+ *
+ * @param h   Handoff state to initialize.
+ * @param cfg Configuration with vectorloop count and roles.
+ */
+void
+vl_handoff_init(vl_handoff_t *h, config_t *cfg)
+{
+    size_t count = cfg->process_thread_count;
+
+    h->count = count;
+    h->vls   = aligned_alloc(CACHE_LINE_SIZE, sizeof(vl_handoff_vl_t) * count);
+    CHECK_MALLOC(h->vls);
+    h->channels = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_conn_t) * count * count);
+    CHECK_MALLOC(h->channels);
+
+    for (size_t i = 0; i < count; i++) {
+        vl_handoff_vl_t *v = &h->vls[i];
+
+        atomic_init(&v->load, 0);
+        atomic_init(&v->load_time_ms, 0);
+        atomic_init(&v->conns, 0);
+        atomic_init(&v->pending, false);
+        v->wake_fd = -1;
+        v->tcp     = (cfg->process_thread_roles[i] &
+                      (VL_ROLE_TCP_IPV4 | VL_ROLE_TCP_IPV6)) != 0;
+    }
+    for (size_t i = 0; i < count * count; i++) {
+        channel_conn_init(&h->channels[i]);
+    }
+}
+
+/** Release memory held by TCP connection handoff state. Connections left in
+ * channels are not closed.
+ *
+ * @param h Handoff state to clean.
+ */
+void
+vl_handoff_clean(vl_handoff_t *h)
+{
+    free(h->vls);
+    free(h->channels);
+    h->vls      = NULL;
+    h->channels = NULL;
+    h->count    = 0;
+}
+
+/** Register eventfd vectorloop is woken up with when connections are sent to
+ * it. Called before vectorloop threads are started.
+ *
+ * @param h       Handoff state.
+ * @param id      Vectorloop ID.
+ * @param wake_fd Vectorloop eventfd.
+ */
+void
+vl_handoff_register(vl_handoff_t *h, int id, int wake_fd)
+{
+    h->vls[id].wake_fd = wake_fd;
+}
+
+/** Publish vectorloop load and number of TCP connections.
+ *
+ * @param h      Handoff state.
+ * @param id     Vectorloop ID.
+ * @param load   Number of queries vectorloop processed in last period.
+ * @param conns  Number of TCP connections vectorloop has.
+ * @param now_ms Vectorloop loop time in milliseconds.
+ */
+void
+vl_handoff_publish(vl_handoff_t *h, int id, uint64_t load, uint64_t conns,
+                   uint64_t now_ms)
+{
+    vl_handoff_vl_t *v = &h->vls[id];
+
+    atomic_store_explicit(&v->load, load, memory_order_relaxed);
+    atomic_store_explicit(&v->conns, conns, memory_order_relaxed);
+    atomic_store_explicit(&v->load_time_ms, now_ms, memory_order_relaxed);
+}
+
+/** Find least loaded vectorloop, other than one given, that runs TCP
+ * listeners and has room for more TCP connections.
+ *
+ * @param h           Handoff state.
+ * @param id          ID of vectorloop looking for target.
+ * @param conns_max   Maximum number of TCP connections vectorloop can have.
+ * @param now_ms      Loop time in milliseconds, load published more than two
+ *                    periods earlier is taken as 0.
+ * @param target_load Where to store load of vectorloop found.
+ *
+ * @return            Returns ID of vectorloop found, -1 if there is none.
+ */
+int
+vl_handoff_target(vl_handoff_t *h, int id, uint64_t conns_max, uint64_t now_ms,
+                  uint64_t *target_load)
+{
+    int      target   = -1;
+    uint64_t min_load = UINT64_MAX;
+    uint64_t load;
+
+    for (size_t i = 0; i < h->count; i++) {
+        vl_handoff_vl_t *v = &h->vls[i];
+
+        if ((int)i == id || !v->tcp ||
+            atomic_load_explicit(&v->conns, memory_order_relaxed) >= conns_max) {
+            continue;
+        }
+        load = 0;
+        if (atomic_load_explicit(&v->load_time_ms, memory_order_relaxed) +
+            2 * VL_HANDOFF_PERIOD_MS >= now_ms) {
+            load = atomic_load_explicit(&v->load, memory_order_relaxed);
+        }
+        if (load < min_load) {
+            min_load = load;
+            target   = i;
+        }
+    }
+    *target_load = min_load;
+    return target;
+}
+
+/** Send TCP connection from one vectorloop to another, receiving vectorloop
+ * is to be woken up once sender is done sending, see @ref vl_handoff_wake().
+ *
+ * @param h   Handoff state.
+ * @param src ID of vectorloop sending connection.
+ * @param dst ID of vectorloop connection is sent to.
+ * @param msg Connection to send.
+ *
+ * @return    Returns true if connection was sent, false if channel is full in
+ *            which case sender keeps connection.
+ */
+bool
+vl_handoff_send(vl_handoff_t *h, int src, int dst, const channel_conn_msg_t *msg)
+{
+    if (!channel_conn_send(&h->channels[src * h->count + dst], msg)) {
+        return false;
+    }
+    atomic_store_explicit(&h->vls[dst].pending, true, memory_order_release);
+    return true;
+}
+
+/** Wake up vectorloop connections were sent to, in case it is blocked
+ * waiting for events.
+ *
+ * @param h   Handoff state.
+ * @param dst ID of vectorloop connections were sent to.
+ */
+void
+vl_handoff_wake(vl_handoff_t *h, int dst)
+{
+    if (h->vls[dst].wake_fd >= 0) {
+        eventfd_write(h->vls[dst].wake_fd, 1);
+    }
+}
+
+/** Receive TCP connections other vectorloops sent to vectorloop. Channels
+ * are only checked if connections were sent since last call.
+ *
+ * @param h        Handoff state.
+ * @param dst      ID of receiving vectorloop.
+ * @param msgs     Array to receive connections into.
+ * @param msgs_len Number of elements in msgs array.
+ *
+ * @return         Returns number of connections received, if it is msgs_len
+ *                 there may be more to receive.
+ */
+size_t
+vl_handoff_recv(vl_handoff_t *h, int dst, channel_conn_msg_t *msgs, size_t msgs_len)
+{
+    vl_handoff_vl_t *v     = &h->vls[dst];
+    size_t           count = 0;
+
+    if (!atomic_load_explicit(&v->pending, memory_order_relaxed) ||
+        !atomic_exchange_explicit(&v->pending, false, memory_order_acquire)) {
+        return 0;
+    }
+    for (size_t src = 0; src < h->count && count < msgs_len; src++) {
+        channel_conn_t *ch = &h->channels[src * h->count + dst];
+
+        while (count < msgs_len && channel_conn_recv(ch, &msgs[count])) {
+            INCREMENT(count);
+        }
+    }
+    if (count == msgs_len) {
+        /* Channels may not be drained, check them again next call. */
+        atomic_store_explicit(&v->pending, true, memory_order_relaxed);
+    }
+    return count;
+}
+
+/** @}*/
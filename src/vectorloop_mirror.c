@@ -0,0 +1,159 @@
+/**
+ * @file vectorloop_mirror.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlmirror
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "vectorloop_mirror.h"
+
+/** Initialize mirroring of a vectorloop, creating its UDP socket connected
+ * to shadow server.
+ *
+ * @param m           Mirror state to initialize.
+ * @param ip          IPv4 or IPv6 address of shadow server.
+ * @param port        UDP port of shadow server.
+ * @param sample_rate Mirror one in this many received datagrams.
+ * @param err         Where to store error message.
+ * @param err_len     Length of err buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and err is
+ *                    populated, mirror is then left disabled.
+ */
+int
+vl_mirror_init(vl_mirror_t *m, const char *ip, uint16_t port, uint32_t sample_rate,
+               char *err, size_t err_len)
+{
+    struct sockaddr_storage  addr = {};
+    struct sockaddr_in      *sa4  = (struct sockaddr_in *)&addr;
+    struct sockaddr_in6     *sa6  = (struct sockaddr_in6 *)&addr;
+    socklen_t                addr_len;
+    int                      rcvbuf = 0;
+
+    memset(m, 0, sizeof(vl_mirror_t));
+    m->fd          = -1;
+    m->sample_rate = sample_rate;
+
+    if (inet_pton(AF_INET, ip, &sa4->sin_addr) == 1) {
+        sa4->sin_family = AF_INET;
+        sa4->sin_port   = htons(port);
+        addr_len        = sizeof(struct sockaddr_in);
+    } else if (inet_pton(AF_INET6, ip, &sa6->sin6_addr) == 1) {
+        sa6->sin6_family = AF_INET6;
+        sa6->sin6_port   = htons(port);
+        addr_len         = sizeof(struct sockaddr_in6);
+    } else {
+        snprintf(err, err_len, "invalid shadow server address \"%s\"", ip);
+        return -1;
+    }
+
+    m->fd = socket(addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m->fd < 0) {
+        snprintf(err, err_len, "socket error: %s", strerror(errno));
+        return -1;
+    }
+    /* Responses of shadow server are never read. */
+    if (setsockopt(m->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0 ||
+        connect(m->fd, (struct sockaddr *)&addr, addr_len) != 0) {
+        snprintf(err, err_len, "socket error: %s", strerror(errno));
+        vl_mirror_clean(m);
+        return -1;
+    }
+
+    m->msgs = mem_calloc(MEM_TAG_UDP, VL_MIRROR_VECTOR_LEN, sizeof(struct mmsghdr));
+    m->iovs = mem_calloc(MEM_TAG_UDP, VL_MIRROR_VECTOR_LEN, sizeof(struct iovec));
+    if (m->msgs == NULL || m->iovs == NULL) {
+        snprintf(err, err_len, "out of memory");
+        vl_mirror_clean(m);
+        return -1;
+    }
+    for (unsigned int i = 0; i < VL_MIRROR_VECTOR_LEN; i++) {
+        m->msgs[i].msg_hdr.msg_iov    = &m->iovs[i];
+        m->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+
+/** Release mirroring resources of a vectorloop, mirror is left disabled.
+ *
+ * @param m Mirror state.
+ */
+void
+vl_mirror_clean(vl_mirror_t *m)
+{
+    if (m->fd >= 0) {
+        close(m->fd);
+    }
+    mem_free(MEM_TAG_UDP, m->msgs);
+    mem_free(MEM_TAG_UDP, m->iovs);
+    m->fd    = -1;
+    m->msgs  = NULL;
+    m->iovs  = NULL;
+    m->count = 0;
+}
+
+/** Send mirror send vector to shadow server with sendmmsg(), without
+ * waiting. Datagrams socket does not take are dropped. Error shadow server
+ * address reported for an earlier datagram (e.g. ECONNREFUSED, as ICMP
+ * port unreachable) fails one send call, which is then made again.
+ *
+ * @param m Mirror state, MUST be initialized.
+ *
+ * @return  Returns number of datagrams sent.
+ */
+int
+vl_mirror_flush(vl_mirror_t *m)
+{
+    unsigned int sent    = 0;
+    bool         retried = false;
+    int          ret;
+
+    while (sent < m->count) {
+        ret = sendmmsg(m->fd, m->msgs + sent, m->count - sent, MSG_DONTWAIT);
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+        if (ret < 0 && (errno == EINTR ||
+                        (!retried && errno != EAGAIN && errno != EWOULDBLOCK))) {
+            retried = errno != EINTR;
+            continue;
+        }
+        break;
+    }
+    m->sent    += sent;
+    m->dropped += m->count - sent;
+    m->count    = 0;
+    return sent;
+}
+
+/** @}*/
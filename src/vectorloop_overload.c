@@ -0,0 +1,117 @@
+/**
+ * @file vectorloop_overload.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vloverload
+ *  @{
+ */
+#include "vectorloop_overload.h"
+
+/** Initialize overload state, vectorloop is not overloaded.
+ *
+ * @param o                Overload state to initialize.
+ * @param iteration_us_max Mean busy iteration time in microseconds above
+ *                         which vectorloop is overloaded.
+ * @param slip             Every slip-th query shed by client is slipped, 0 to
+ *                         drop all.
+ * @param now_ms           Loop time in milliseconds, first period starts at.
+ */
+void
+vl_overload_init(vl_overload_t *o, uint64_t iteration_us_max, uint32_t slip,
+                 uint64_t now_ms)
+{
+    *o = (vl_overload_t) {
+        .level            = VL_OVERLOAD_NONE,
+        .iteration_ns_max = iteration_us_max * 1000,
+        .period_start_ms  = now_ms,
+        .slip             = slip,
+    };
+}
+
+/** End current period once @ref VL_OVERLOAD_PERIOD_MS has elapsed, and move
+ * overload level by signals recorded in it: level is raised by one if
+ * vectorloop was overloaded in period, and lowered by one once it was not
+ * for @ref VL_OVERLOAD_CALM_PERIODS periods in a row. Signals are reset for
+ * next period.
+ *
+ * @param o      Overload state.
+ * @param now_ms Loop time in milliseconds.
+ *
+ * @return       Returns true if period ended, level is then level of next
+ *               period.
+ */
+bool
+vl_overload_update(vl_overload_t *o, uint64_t now_ms)
+{
+    bool overloaded;
+
+    if (now_ms - o->period_start_ms < VL_OVERLOAD_PERIOD_MS) {
+        return false;
+    }
+    overloaded = o->drops > 0 ||
+                 (o->iterations > 0 &&
+                  o->iterations_ns / o->iterations > o->iteration_ns_max) ||
+                 (uint64_t)o->reads_full * 2 > o->reads;
+
+    if (overloaded) {
+        o->calm_periods = 0;
+        if (o->level + 1 < VL_OVERLOAD_LEVELS) {
+            o->level++;
+        }
+    } else if (o->level > VL_OVERLOAD_NONE &&
+               ++o->calm_periods >= VL_OVERLOAD_CALM_PERIODS) {
+        o->calm_periods = 0;
+        o->level--;
+    }
+
+    o->period_start_ms = now_ms;
+    o->iterations      = 0;
+    o->iterations_ns   = 0;
+    o->reads           = 0;
+    o->reads_full      = 0;
+    o->drops           = 0;
+
+    return true;
+}
+
+/** Decide whether query shed by client is slipped, answered with truncated
+ * response, or dropped. Every slip-th query is slipped.
+ *
+ * @param o Overload state.
+ *
+ * @return  Returns true if query is to be slipped.
+ */
+bool
+vl_overload_slip(vl_overload_t *o)
+{
+    if (o->slip == 0) {
+        return false;
+    }
+    if (++o->slip_count >= o->slip) {
+        o->slip_count = 0;
+        return true;
+    }
+    return false;
+}
+
+/** @}*/
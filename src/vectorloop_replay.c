@@ -0,0 +1,492 @@
+/**
+ * @file vectorloop_replay.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlreplay
+ *  @{
+ */
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "vectorloop_replay.h"
+#include "vectorloop_xdp.h"
+
+/** Length of pcap file header. */
+#define VL_REPLAY_PCAP_HLEN 24
+
+/** Length of pcap record header. */
+#define VL_REPLAY_PCAP_REC_HLEN 16
+
+/** Link type of Ethernet frames. */
+#define VL_REPLAY_LINKTYPE_ETHERNET 1
+
+/** Link type of raw IPv4 or IPv6 packets. */
+#define VL_REPLAY_LINKTYPE_RAW 101
+
+/** Link type of Linux "cooked" capture (e.g. tcpdump -i any). */
+#define VL_REPLAY_LINKTYPE_LINUX_SLL 113
+
+/** Length of Linux "cooked" capture header. */
+#define VL_REPLAY_SLL_HLEN 16
+
+/** Length of 802.1Q VLAN tag, tags are stripped off. */
+#define VL_REPLAY_VLAN_HLEN 4
+
+/** Length of IPv4 header of query frames built by @ref vl_replay_query_add. */
+#define VL_REPLAY_IPV4_HLEN 20
+
+/** Length of UDP header. */
+#define VL_REPLAY_UDP_HLEN 8
+
+/** Maximum length of query frame built by @ref vl_replay_query_add. */
+#define VL_REPLAY_QUERY_FRAME_MAX (VL_XDP_ETH_HLEN + VL_REPLAY_IPV4_HLEN + \
+                                   VL_REPLAY_UDP_HLEN + sizeof(rip_ns_header_t) + \
+                                   RIP_NS_MAXCDNAME + RIP_NS_QFIXEDSZ)
+
+/** Read 32 bit value of pcap header, in byte order of file.
+ *
+ * @param p       Value.
+ * @param swapped Whether file byte order differs from host byte order.
+ *
+ * @return        Returns value.
+ */
+static inline uint32_t
+vl_replay_u32(const unsigned char *p, bool swapped)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+/** Append packet of pcap record to frames buffer as Ethernet frame, if it is
+ * a UDP datagram to replay port, see @ref vl_xdp_frame_parse. Packets of link
+ * types other than Ethernet get an Ethernet header with zero MAC addresses,
+ * VLAN tags are stripped off.
+ *
+ * @param replay    Replay to append frame to.
+ * @param pkt       Packet.
+ * @param len       Length of packet.
+ * @param link_type Link type of pcap file.
+ */
+static void
+vl_replay_frame_add(vl_replay_t *replay, const unsigned char *pkt, size_t len,
+                    uint32_t link_type)
+{
+    unsigned char      *frame                       = replay->buf + replay->buf_len;
+    unsigned char       payload[RIP_NS_UDP_MAXMSG];
+    unsigned char       macs[VL_XDP_MACS_LEN];
+    unsigned char       control[UDP_MSG_CONTROL_LEN];
+    struct sockaddr_storage ss;
+    struct msghdr       msg_hdr = {
+        .msg_name       = &ss,
+        .msg_namelen    = sizeof(ss),
+        .msg_control    = control,
+        .msg_controllen = sizeof(control),
+    };
+
+    switch (link_type) {
+    case VL_REPLAY_LINKTYPE_ETHERNET:
+        if (len < VL_XDP_ETH_HLEN) {
+            return;
+        }
+        memcpy(frame, pkt, VL_XDP_ETH_HLEN);
+        pkt += VL_XDP_ETH_HLEN;
+        len -= VL_XDP_ETH_HLEN;
+        while (len >= VL_REPLAY_VLAN_HLEN &&
+               (frame[12] << 8 | frame[13]) == 0x8100) {
+            memcpy(frame + 12, pkt + 2, 2);
+            pkt += VL_REPLAY_VLAN_HLEN;
+            len -= VL_REPLAY_VLAN_HLEN;
+        }
+        break;
+    case VL_REPLAY_LINKTYPE_RAW:
+        if (len < 1) {
+            return;
+        }
+        memset(frame, 0, VL_XDP_ETH_HLEN);
+        frame[12] = (pkt[0] >> 4) == 6 ? 0x86 : 0x08;
+        frame[13] = (pkt[0] >> 4) == 6 ? 0xdd : 0x00;
+        break;
+    case VL_REPLAY_LINKTYPE_LINUX_SLL:
+        if (len < VL_REPLAY_SLL_HLEN) {
+            return;
+        }
+        memset(frame, 0, VL_XDP_ETH_HLEN);
+        memcpy(frame + 12, pkt + 14, 2);
+        pkt += VL_REPLAY_SLL_HLEN;
+        len -= VL_REPLAY_SLL_HLEN;
+        break;
+    default:
+        return;
+    }
+    memcpy(frame + VL_XDP_ETH_HLEN, pkt, len);
+    len += VL_XDP_ETH_HLEN;
+
+    if (vl_xdp_frame_parse(frame, len, replay->port, &msg_hdr, payload,
+                           sizeof(payload), macs) < 0) {
+        return;
+    }
+    replay->frames[replay->frame_count++] = (vl_replay_frame_t) {
+        .offset = replay->buf_len,
+        .len    = len,
+    };
+    replay->buf_len += len;
+}
+
+/** Load UDP DNS queries of a pcap file to replay. Classic pcap format is
+ * supported, in either byte order and with microsecond or nanosecond
+ * timestamps, with Ethernet, raw IP or Linux "cooked" capture link types.
+ * Only UDP datagrams to port are kept, IPv4 fragments and IPv6 extension
+ * headers are skipped.
+ *
+ * @param replay      Replay to load queries into.
+ * @param filepath    Path of pcap file.
+ * @param port        UDP destination port of queries.
+ * @param err_buf     Buffer error message is written to.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, -1 on error.
+ */
+int
+vl_replay_load(vl_replay_t *replay, const char *filepath, uint16_t port,
+               char *err_buf, size_t err_buf_len)
+{
+    FILE          *f         = NULL;
+    unsigned char *file_buf  = NULL;
+    long           file_len  = 0;
+    uint32_t       magic     = 0;
+    uint32_t       link_type = 0;
+    bool           swapped   = false;
+    size_t         off       = 0;
+    size_t         max_count = 0;
+
+    *replay = (vl_replay_t) { .port = port };
+
+    f = fopen(filepath, "rb");
+    if (f == NULL) {
+        snprintf(err_buf, err_buf_len, "could not open \"%s\", %s", filepath, strerror(errno));
+        return -1;
+    }
+    if (fseek(f, 0, SEEK_END) != 0 || (file_len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        snprintf(err_buf, err_buf_len, "could not read \"%s\", %s", filepath, strerror(errno));
+        fclose(f);
+        return -1;
+    }
+    file_buf = malloc(file_len > 0 ? file_len : 1);
+    CHECK_MALLOC(file_buf);
+    if (fread(file_buf, 1, file_len, f) != (size_t)file_len) {
+        snprintf(err_buf, err_buf_len, "could not read \"%s\"", filepath);
+        free(file_buf);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    if (file_len < VL_REPLAY_PCAP_HLEN) {
+        snprintf(err_buf, err_buf_len, "\"%s\" is not a pcap file", filepath);
+        free(file_buf);
+        return -1;
+    }
+    memcpy(&magic, file_buf, sizeof(magic));
+    if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+        swapped = false;
+    } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+        swapped = true;
+    } else {
+        snprintf(err_buf, err_buf_len, "\"%s\" is not a pcap file, pcapng is not supported",
+                 filepath);
+        free(file_buf);
+        return -1;
+    }
+    link_type = vl_replay_u32(file_buf + 20, swapped) & 0x0fffffff;
+    if (link_type != VL_REPLAY_LINKTYPE_ETHERNET && link_type != VL_REPLAY_LINKTYPE_RAW &&
+        link_type != VL_REPLAY_LINKTYPE_LINUX_SLL) {
+        snprintf(err_buf, err_buf_len, "\"%s\" link type %u is not supported", filepath,
+                 link_type);
+        free(file_buf);
+        return -1;
+    }
+
+    /* Frames buffer is sized for every record becoming a frame, a record
+     * grows by at most the Ethernet header.
+     */
+    max_count   = (file_len - VL_REPLAY_PCAP_HLEN) / VL_REPLAY_PCAP_REC_HLEN;
+    replay->buf = malloc(file_len + max_count * VL_XDP_ETH_HLEN + 1);
+    CHECK_MALLOC(replay->buf);
+    replay->frames = malloc(sizeof(vl_replay_frame_t) * (max_count + 1));
+    CHECK_MALLOC(replay->frames);
+
+    off = VL_REPLAY_PCAP_HLEN;
+    while (off + VL_REPLAY_PCAP_REC_HLEN <= (size_t)file_len) {
+        uint32_t incl_len = vl_replay_u32(file_buf + off + 8, swapped);
+
+        off += VL_REPLAY_PCAP_REC_HLEN;
+        if (incl_len > (size_t)file_len - off) {
+            /* Truncated capture, keep records read so far. */
+            break;
+        }
+        vl_replay_frame_add(replay, file_buf + off, incl_len, link_type);
+        off += incl_len;
+    }
+    free(file_buf);
+
+    if (replay->frame_count == 0) {
+        snprintf(err_buf, err_buf_len, "\"%s\" has no UDP datagrams to port %u", filepath, port);
+        vl_replay_clean(replay);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Prepare empty replay that queries are added to by
+ * @ref vl_replay_query_add(), instead of being loaded from a pcap file.
+ *
+ * @param replay     Replay to initialize.
+ * @param port       UDP destination port of queries.
+ * @param frames_max Maximum number of queries to be added.
+ */
+void
+vl_replay_init(vl_replay_t *replay, uint16_t port, size_t frames_max)
+{
+    *replay = (vl_replay_t) { .port = port };
+
+    replay->buf = malloc(frames_max * VL_REPLAY_QUERY_FRAME_MAX + 1);
+    CHECK_MALLOC(replay->buf);
+    replay->frames = malloc(sizeof(vl_replay_frame_t) * (frames_max + 1));
+    CHECK_MALLOC(replay->frames);
+    replay->frames_max = frames_max;
+}
+
+/** Add query to replay, as Ethernet frame carrying IPv4 UDP datagram from
+ * client address 10.0.0.0/8 + client to 192.0.2.1, see
+ * @ref vl_replay_init().
+ *
+ * @param replay Replay to add query to.
+ * @param client Client number, sets client address, source port and query
+ *               ID.
+ * @param name   Query name in presentation format.
+ * @param type   Query type.
+ *
+ * @return       Returns 0 on success, -1 if name is not valid or replay
+ *               holds frames_max queries.
+ */
+int
+vl_replay_query_add(vl_replay_t *replay, uint32_t client, const char *name, uint16_t type)
+{
+    unsigned char *frame = replay->buf + replay->buf_len;
+    unsigned char *ip    = frame + VL_XDP_ETH_HLEN;
+    unsigned char *udp   = ip + VL_REPLAY_IPV4_HLEN;
+    unsigned char *dns   = udp + VL_REPLAY_UDP_HLEN;
+    unsigned char *p     = dns + sizeof(rip_ns_header_t);
+    uint16_t       port  = 1024 + (client & 0x7fff);
+    int            len   = 0;
+    size_t         udp_len;
+
+    if (replay->frame_count >= replay->frames_max) {
+        return -1;
+    }
+    len = rip_ns_name_pton((const unsigned char *)name, p, RIP_NS_MAXCDNAME);
+    if (len < 0) {
+        return -1;
+    }
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    p += 1;
+    RIP_NS_PUT16(type, p);
+    RIP_NS_PUT16(rip_ns_c_in, p);
+    udp_len = p - udp;
+
+    /* Ethernet header with zero MAC addresses, IPv4 without checksum, UDP
+     * without checksum, neither is verified on read.
+     */
+    memset(frame, 0, VL_XDP_ETH_HLEN + VL_REPLAY_IPV4_HLEN + VL_REPLAY_UDP_HLEN +
+           sizeof(rip_ns_header_t));
+    frame[12] = 0x08;
+    ip[0]     = 0x45;
+    ip[2]     = (VL_REPLAY_IPV4_HLEN + udp_len) >> 8;
+    ip[3]     = (VL_REPLAY_IPV4_HLEN + udp_len) & 0xff;
+    ip[8]     = 64;
+    ip[9]     = IPPROTO_UDP;
+    ip[12]    = 10;
+    ip[13]    = (client >> 16) & 0xff;
+    ip[14]    = (client >> 8) & 0xff;
+    ip[15]    = client & 0xff;
+    ip[16]    = 192;
+    ip[17]    = 0;
+    ip[18]    = 2;
+    ip[19]    = 1;
+    udp[0]    = port >> 8;
+    udp[1]    = port & 0xff;
+    udp[2]    = replay->port >> 8;
+    udp[3]    = replay->port & 0xff;
+    udp[4]    = udp_len >> 8;
+    udp[5]    = udp_len & 0xff;
+    dns[0]    = client >> 8;
+    dns[1]    = client & 0xff;
+    dns[5]    = 1;
+
+    replay->frames[replay->frame_count++] = (vl_replay_frame_t) {
+        .offset = replay->buf_len,
+        .len    = p - frame,
+    };
+    replay->buf_len += p - frame;
+
+    return 0;
+}
+
+/** Keep first responses_max responses of replay, in addition to counting
+ * them, so their content can be inspected.
+ *
+ * @param replay        Replay to keep responses of.
+ * @param responses_max Number of responses to keep, until replay is reset.
+ */
+void
+vl_replay_capture(vl_replay_t *replay, size_t responses_max)
+{
+    free(replay->capture);
+    replay->capture = calloc(responses_max, VL_REPLAY_CAPTURE_LEN);
+    CHECK_MALLOC(replay->capture);
+    replay->capture_max = responses_max;
+    replay->captured    = 0;
+}
+
+/** Release frames of replay, and responses it kept.
+ *
+ * @param replay Replay to clean.
+ */
+void
+vl_replay_clean(vl_replay_t *replay)
+{
+    free(replay->buf);
+    free(replay->frames);
+    free(replay->capture);
+    *replay = (vl_replay_t) { .port = replay->port };
+}
+
+/** Start replay over, from first frame, with counters cleared.
+ *
+ * @param replay      Replay to reset.
+ * @param queries_max Number of queries to replay, frames are replayed in a
+ *                    loop until this many were read.
+ */
+void
+vl_replay_reset(vl_replay_t *replay, uint64_t queries_max)
+{
+    replay->next           = 0;
+    replay->queries_max    = queries_max;
+    replay->queries        = 0;
+    replay->responses      = 0;
+    replay->response_bytes = 0;
+    replay->captured       = 0;
+}
+
+/** Read next frames of replay into UDP connection read vector, same as
+ * recvmmsg() would read datagrams, see @ref vl_xdp_frame_parse.
+ *
+ * @param replay   Replay to read from.
+ * @param conn_udp UDP connection to read into.
+ * @param vlen     Maximum number of datagrams to read.
+ *
+ * @return         Returns number of datagrams read, or -1 with errno set to
+ *                 EAGAIN once all queries were replayed.
+ */
+int
+vl_replay_recv(vl_replay_t *replay, conn_udp_t *conn_udp, unsigned int vlen)
+{
+    unsigned char macs[VL_XDP_MACS_LEN];
+    unsigned int  count = 0;
+
+    if (replay->queries >= replay->queries_max) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (vlen > conn_udp->vector_len) {
+        vlen = conn_udp->vector_len;
+    }
+    if (vlen > replay->queries_max - replay->queries) {
+        vlen = replay->queries_max - replay->queries;
+    }
+    while (count < vlen) {
+        vl_replay_frame_t *frame = &replay->frames[replay->next];
+        query_t           *q     = &conn_udp->queries[count];
+        int                ret   = 0;
+
+        ret = vl_xdp_frame_parse(replay->buf + frame->offset, frame->len, replay->port,
+                                 &conn_udp->read_vector[count].msg_hdr,
+                                 q->request_buffer, q->request_buffer_size, macs);
+        conn_udp->read_vector[count].msg_len = ret;
+        count++;
+
+        if (++replay->next == replay->frame_count) {
+            replay->next = 0;
+        }
+    }
+    replay->queries += count;
+
+    return count;
+}
+
+/** Capture UDP connection write vector messages, starting with
+ * write_vector_write_index, instead of sending them. Responses (iov entries,
+ * more than one for a UDP GSO message) and their bytes are counted, and
+ * kept while capture buffer has room, see @ref vl_replay_capture().
+ *
+ * @param replay   Replay to count responses of.
+ * @param conn_udp UDP connection with prepared write vector.
+ *
+ * @return         Returns number of messages captured, which is all of them.
+ */
+int
+vl_replay_send(vl_replay_t *replay, conn_udp_t *conn_udp)
+{
+    unsigned int first = conn_udp->write_vector_write_index;
+
+    for (unsigned int k = first; k < first + conn_udp->write_vector_count; k++) {
+        struct msghdr *msg_hdr = &conn_udp->write_vector[k].msg_hdr;
+
+        for (size_t s = 0; s < msg_hdr->msg_iovlen; s++) {
+            size_t len = msg_hdr->msg_iov[s].iov_len;
+
+            replay->response_bytes += len;
+            if (replay->captured < replay->capture_max) {
+                memcpy(replay->capture + replay->captured++ * VL_REPLAY_CAPTURE_LEN,
+                       msg_hdr->msg_iov[s].iov_base,
+                       len < VL_REPLAY_CAPTURE_LEN ? len : VL_REPLAY_CAPTURE_LEN);
+            }
+        }
+        replay->responses += msg_hdr->msg_iovlen;
+    }
+
+    return conn_udp->write_vector_count;
+}
+
+/** @}*/
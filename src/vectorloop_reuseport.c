@@ -0,0 +1,499 @@
+/**
+ * @file vectorloop_reuseport.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlreuseport
+ *  @{
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "vectorloop_bpf.h"
+#include "vectorloop_reuseport.h"
+
+/** Build reuseport steering program, which selects socket stored in socket
+ * map at index of CPU program runs on. If there is no socket at that index
+ * selection fails and kernel falls back to picking socket by hash.
+ *
+ * @param insns  Array to build program into, at least 16 instructions.
+ * @param map_fd Socket map.
+ *
+ * @return       Returns number of instructions in program.
+ */
+static int
+vl_reuseport_prog_build(struct bpf_insn *insns, int map_fd)
+{
+    int n = 0;
+
+    /* r6 = ctx */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+
+    /* key = bpf_get_smp_processor_id(), stored on stack. */
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_get_smp_processor_id);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_W | BPF_MEM, BPF_REG_10, BPF_REG_0, -4, 0);
+
+    /* bpf_sk_select_reuseport(ctx, map, &key, 0) */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_2,
+                             BPF_PSEUDO_MAP_FD, 0, map_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -4);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_sk_select_reuseport);
+
+    /* Pass even if no socket was selected, so kernel falls back to hash. */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    return n;
+}
+
+/** Build reuseport client steering program, which selects socket stored in
+ * socket map at slot picked by hash of client address prefix, so all queries
+ * of a client prefix go to same socket. Source address is loaded relative to
+ * network header, masked to prefix length and hashed (multiplicative hash),
+ * and hash is scaled to number of slots. If there is no socket in slot
+ * selection fails and kernel falls back to picking socket by hash.
+ *
+ * @param insns      Array to build program into, at least 32 instructions.
+ * @param map_fd     Socket map.
+ * @param ipv6       Set if reuseport group is IPv6, otherwise it is IPv4.
+ * @param prefix_len Client prefix length, at most 32 for IPv4 and 64 for
+ *                   IPv6.
+ * @param slots      Number of slots in socket map.
+ *
+ * @return           Returns number of instructions in program.
+ */
+static int
+vl_reuseport_prog_build_client(struct bpf_insn *insns, int map_fd, bool ipv6,
+                               unsigned int prefix_len, unsigned int slots)
+{
+    int      n    = 0;
+    int      pass = 0;
+    uint64_t mask = 0;
+
+    /* Mask as it reads from prefix bytes loaded into register. */
+    for (unsigned int i = 0; i < prefix_len; i++) {
+        ((uint8_t *)&mask)[i / 8] |= 0x80 >> (i % 8);
+    }
+
+    /* r6 = ctx */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+
+    /* bpf_skb_load_bytes_relative(ctx, off, fp - 16, len, BPF_HDR_START_NET),
+     * source address, only first 8 bytes of IPv6 one.
+     */
+    insns[n++] = VL_BPF_INSN(BPF_ST | BPF_MEM | BPF_DW, BPF_REG_10, 0, -16, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, ipv6 ? 8 : 12);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -16);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, ipv6 ? 8 : 4);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_5, 0, 0,
+                             BPF_HDR_START_NET);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+                             BPF_FUNC_skb_load_bytes_relative);
+    pass = n;
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 0, 0);
+
+    /* key = ((prefix & mask) * golden ratio >> 32) * slots >> 32 */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_2, BPF_REG_10, -16, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_3, 0, 0, (uint32_t)mask);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, (uint32_t)(mask >> 32));
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_AND | BPF_X, BPF_REG_2, BPF_REG_3, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_3, 0, 0, 0x7f4a7c15);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0x9e3779b9);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MUL | BPF_X, BPF_REG_2, BPF_REG_3, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_RSH | BPF_K, BPF_REG_2, 0, 0, 32);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MUL | BPF_K, BPF_REG_2, 0, 0, slots);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_RSH | BPF_K, BPF_REG_2, 0, 0, 32);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_W | BPF_MEM, BPF_REG_10, BPF_REG_2, -4, 0);
+
+    /* bpf_sk_select_reuseport(ctx, map, &key, 0) */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_2,
+                             BPF_PSEUDO_MAP_FD, 0, map_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -4);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_sk_select_reuseport);
+
+    /* Pass even if no socket was selected, so kernel falls back to hash. */
+    insns[pass].off = n - pass - 1;
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    return n;
+}
+
+/** Create socket map of listener reuseport group, and load its steering
+ * program built into insns once map is created.
+ *
+ * @param rp          Reuseport steering object.
+ * @param group       Reuseport group.
+ * @param insns       Array program is built into.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf.
+ */
+static int
+vl_reuseport_group_load(vl_reuseport_t *rp, vl_reuseport_group_t group,
+                        struct bpf_insn *insns, char *err_buf, size_t err_buf_len)
+{
+    union bpf_attr attr = {};
+    bool           ipv6 = group == VL_REUSEPORT_UDP_IPV6 || group == VL_REUSEPORT_TCP_IPV6;
+
+    attr.map_type    = BPF_MAP_TYPE_REUSEPORT_SOCKARRAY;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint32_t);
+    attr.max_entries = rp->entries[group] > 0 ? rp->entries[group] : 1;
+    rp->map_fd[group] = vl_bpf(BPF_MAP_CREATE, &attr);
+    if (rp->map_fd[group] < 0) {
+        snprintf(err_buf, err_buf_len, "Reuseport steering: could not create "
+                 "socket map, %s", strerror(errno));
+        return -1;
+    }
+
+    attr = (union bpf_attr) {};
+    attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+    attr.insns     = (uint64_t)(uintptr_t)insns;
+    if (rp->client) {
+        attr.insn_cnt = vl_reuseport_prog_build_client(insns, rp->map_fd[group], ipv6,
+                                                       rp->prefix_len[ipv6],
+                                                       rp->entries[group]);
+    } else {
+        attr.insn_cnt = vl_reuseport_prog_build(insns, rp->map_fd[group]);
+    }
+    attr.license   = (uint64_t)(uintptr_t)VL_BPF_LICENSE;
+    rp->prog_fd[group] = vl_bpf(BPF_PROG_LOAD, &attr);
+    if (rp->prog_fd[group] < 0) {
+        snprintf(err_buf, err_buf_len, "Reuseport steering: could not load "
+                 "program, %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Create socket map and load steering program for each listener reuseport
+ * group.
+ *
+ * @param rp          Reuseport steering object to initialize.
+ * @param cpus        Number of CPUs, socket maps have an entry for each.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf. On error object is left not loaded.
+ */
+int
+vl_reuseport_load(vl_reuseport_t *rp, unsigned int cpus, char *err_buf,
+                  size_t err_buf_len)
+{
+    struct bpf_insn insns[32];
+
+    *rp = (vl_reuseport_t) {};
+    for (int g = 0; g < VL_REUSEPORT_GROUPS; g++) {
+        rp->map_fd[g]  = -1;
+        rp->prog_fd[g] = -1;
+        rp->entries[g] = cpus;
+    }
+
+    for (int g = 0; g < VL_REUSEPORT_GROUPS; g++) {
+        if (vl_reuseport_group_load(rp, g, insns, err_buf, err_buf_len) != 0) {
+            vl_reuseport_clean(rp);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/** Create socket map and load client steering program for each listener
+ * reuseport group, see @ref vl_reuseport_prog_build_client. Socket map of
+ * each group has a slot for each vectorloop running its listeners, see
+ * @ref vl_reuseport_client_slot.
+ *
+ * @param rp              Reuseport steering object to initialize.
+ * @param cfg             Configuration with vectorloop roles.
+ * @param ipv4_prefix_len Length of IPv4 client prefix, 0-32.
+ * @param ipv6_prefix_len Length of IPv6 client prefix, 0-64.
+ * @param err_buf         Buffer where to store error message on error.
+ * @param err_buf_len     Length of error buffer.
+ *
+ * @return                Returns 0 on success, otherwise -1 and error message
+ *                        is stored in err_buf. On error object is left not
+ *                        loaded.
+ */
+int
+vl_reuseport_load_client(vl_reuseport_t *rp, config_t *cfg, unsigned int ipv4_prefix_len,
+                         unsigned int ipv6_prefix_len, char *err_buf, size_t err_buf_len)
+{
+    struct bpf_insn insns[32];
+
+    *rp = (vl_reuseport_t) {
+        .client     = true,
+        .prefix_len = { ipv4_prefix_len, ipv6_prefix_len },
+    };
+    for (int g = 0; g < VL_REUSEPORT_GROUPS; g++) {
+        rp->map_fd[g]  = -1;
+        rp->prog_fd[g] = -1;
+        rp->entries[g] = vl_reuseport_client_slot(cfg, g, cfg->process_thread_count);
+    }
+
+    for (int g = 0; g < VL_REUSEPORT_GROUPS; g++) {
+        if (vl_reuseport_group_load(rp, g, insns, err_buf, err_buf_len) != 0) {
+            vl_reuseport_clean(rp);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/** Slot of vectorloop in socket map of a reuseport group when steering by
+ * client, its rank among vectorloops whose roles include listeners of group.
+ *
+ * @param cfg   Configuration with vectorloop roles.
+ * @param group Reuseport group.
+ * @param id    Vectorloop ID, number of vectorloops gives number of slots.
+ *
+ * @return      Returns slot of vectorloop.
+ */
+unsigned int
+vl_reuseport_client_slot(config_t *cfg, vl_reuseport_group_t group, size_t id)
+{
+    static const uint8_t roles[VL_REUSEPORT_GROUPS] = {
+        [VL_REUSEPORT_UDP_IPV4] = VL_ROLE_UDP_IPV4,
+        [VL_REUSEPORT_UDP_IPV6] = VL_ROLE_UDP_IPV6,
+        [VL_REUSEPORT_TCP_IPV4] = VL_ROLE_TCP_IPV4,
+        [VL_REUSEPORT_TCP_IPV6] = VL_ROLE_TCP_IPV6,
+    };
+    unsigned int slot = 0;
+
+    for (size_t i = 0; i < id; i++) {
+        if (cfg->process_thread_roles[i] & roles[group]) {
+            slot++;
+        }
+    }
+
+    return slot;
+}
+
+/** Release reuseport steering programs and socket maps. Programs stay
+ * attached to reuseport groups until their sockets are closed.
+ *
+ * @param rp Reuseport steering object to clean.
+ */
+void
+vl_reuseport_clean(vl_reuseport_t *rp)
+{
+    for (int g = 0; g < VL_REUSEPORT_GROUPS; g++) {
+        if (rp->prog_fd[g] >= 0) {
+            close(rp->prog_fd[g]);
+        }
+        if (rp->map_fd[g] >= 0) {
+            close(rp->map_fd[g]);
+        }
+        rp->map_fd[g]  = -1;
+        rp->prog_fd[g] = -1;
+    }
+}
+
+/** Add listener socket to its reuseport group socket map at index of CPU its
+ * vectorloop is bound to, or at its slot when steering by client, and attach
+ * group steering program. Socket must be bound (and listening if TCP).
+ *
+ * @param rp    Reuseport steering object.
+ * @param group Reuseport group of socket.
+ * @param fd    Listener socket.
+ * @param index CPU vectorloop owning socket is bound to, or its slot, see
+ *              @ref vl_reuseport_client_slot.
+ *
+ * @return      Returns 0 on success, otherwise negative errno value.
+ */
+int
+vl_reuseport_join(vl_reuseport_t *rp, vl_reuseport_group_t group, int fd,
+                  unsigned int index)
+{
+    union bpf_attr attr  = {};
+    uint32_t       key   = index;
+    uint32_t       value = fd;
+
+    if (index >= rp->entries[group]) {
+        return -EINVAL;
+    }
+
+    attr.map_fd = rp->map_fd[group];
+    attr.key    = (uint64_t)(uintptr_t)&key;
+    attr.value  = (uint64_t)(uintptr_t)&value;
+    if (vl_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        return -errno;
+    }
+
+    /* Program applies to whole group, attaching it again replaces it with
+     * the same program.
+     */
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF, &rp->prog_fd[group],
+                   sizeof(int)) < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/** Find CPUs that process network receive interrupts, those with non zero
+ * NET_RX counter in softirqs file.
+ *
+ * @param path    Path of softirqs file, see @ref VL_REUSEPORT_SOFTIRQS_PATH.
+ * @param rx_cpus Array of flags set to 1 for CPUs with network receive
+ *                interrupts, 0 for others.
+ * @param cpus    Number of elements in rx_cpus array.
+ *
+ * @return        Returns number of CPUs in file, or -1 if file could not be
+ *                read or has no NET_RX counters.
+ */
+int
+vl_reuseport_rx_cpus(const char *path, unsigned char *rx_cpus, unsigned int cpus)
+{
+    FILE *f            = NULL;
+    char  line[0x2000];
+    int   count        = -1;
+
+    memset(rx_cpus, 0, cpus);
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *ptr = line;
+        char *end = NULL;
+
+        while (*ptr == ' ') {
+            ptr++;
+        }
+        if (strncmp(ptr, "NET_RX:", 7) != 0) {
+            continue;
+        }
+        ptr  += 7;
+        count = 0;
+        for (;;) {
+            unsigned long long val = strtoull(ptr, &end, 10);
+
+            if (end == ptr) {
+                break;
+            }
+            if ((unsigned int)count < cpus) {
+                rx_cpus[count] = val > 0;
+            }
+            count++;
+            ptr = end;
+        }
+        break;
+    }
+    fclose(f);
+
+    return count;
+}
+
+/** Check reuseport steering configuration and write a warning for each
+ * problem found: vectorloops not bound to a CPU (their listeners only get
+ * packets of CPUs no vectorloop is bound to), vectorloops bound to same CPU
+ * (only one gets steered packets), and CPUs that process network receive
+ * interrupts but have no vectorloop bound to them (queue interrupts should
+ * be steered to vectorloop CPUs, see RSS and IRQ affinity).
+ *
+ * @param cfg           Configuration with settings.
+ * @param cpus          Number of CPUs.
+ * @param softirqs_path Path of softirqs file, see
+ *                      @ref VL_REUSEPORT_SOFTIRQS_PATH.
+ * @param out           Stream to write warnings to.
+ *
+ * @return              Returns number of warnings written.
+ */
+int
+vl_reuseport_config_check(config_t *cfg, unsigned int cpus,
+                          const char *softirqs_path, FILE *out)
+{
+    unsigned char *vl_cpus  = NULL;
+    unsigned char *rx_cpus  = NULL;
+    int            warnings = 0;
+    int            rx_count = 0;
+
+    vl_cpus = calloc(cpus, sizeof(unsigned char));
+    CHECK_MALLOC(vl_cpus);
+    rx_cpus = malloc(sizeof(unsigned char) * cpus);
+    CHECK_MALLOC(rx_cpus);
+
+    for (size_t i = 0; i < cfg->process_thread_count; i++) {
+        size_t cpu = cfg->process_thread_masks[i];
+
+        if (cpu == 0) {
+            fprintf(out, "Warning: reuseport steering, vectorloop %zu is not bound "
+                    "to a CPU (see \"--process_thread_masks\")\n", i);
+            warnings++;
+            continue;
+        }
+        cpu--;
+        if (cpu >= cpus) {
+            fprintf(out, "Warning: reuseport steering, vectorloop %zu is bound to "
+                    "CPU %zu which does not exist\n", i, cpu);
+            warnings++;
+            continue;
+        }
+        if (vl_cpus[cpu]) {
+            fprintf(out, "Warning: reuseport steering, vectorloop %zu is bound to "
+                    "CPU %zu of another vectorloop\n", i, cpu);
+            warnings++;
+        }
+        vl_cpus[cpu] = 1;
+    }
+
+    rx_count = vl_reuseport_rx_cpus(softirqs_path, rx_cpus, cpus);
+    for (int cpu = 0; cpu < rx_count && (unsigned int)cpu < cpus; cpu++) {
+        if (rx_cpus[cpu] && !vl_cpus[cpu]) {
+            fprintf(out, "Warning: reuseport steering, CPU %d processes network "
+                    "receive interrupts but no vectorloop is bound to it, check "
+                    "RSS and IRQ affinity\n", cpu);
+            warnings++;
+        }
+    }
+
+    free(vl_cpus);
+    free(rx_cpus);
+
+    return warnings;
+}
+
+/** @}*/
@@ -0,0 +1,180 @@
+/**
+ * @file vectorloop_slo.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlslo
+ *  @{
+ */
+#include <string.h>
+
+#include "mem.h"
+#include "vectorloop_slo.h"
+
+/** Quantile of each tracked latency, in parts per thousand, indexed by
+ * @ref vl_slo_quantile_t.
+ */
+static const uint32_t vl_slo_permille[VL_SLO_QUANTILES] = {
+    [VL_SLO_P50]  = 500,
+    [VL_SLO_P99]  = 990,
+    [VL_SLO_P999] = 999,
+};
+
+/** Sum bucket counts of histograms.
+ *
+ * @param hists       Histograms to sum.
+ * @param hists_count Number of histograms.
+ * @param i           Bucket index.
+ *
+ * @return            Returns sum of bucket counts.
+ */
+static inline uint64_t
+vl_slo_bucket_sum(histogram_t *hists, size_t hists_count, unsigned int i)
+{
+    uint64_t sum = 0;
+
+    for (size_t h = 0; h < hists_count; h++) {
+        sum += atomic_load_explicit(&hists[h].buckets[i], memory_order_relaxed);
+    }
+    return sum;
+}
+
+/** Initialize latency SLO state, no quantile is in breach. Every snapshot
+ * of window is taken from histograms as they are, so first windows count
+ * only queries recorded from now on.
+ *
+ * @param s            SLO state to initialize.
+ * @param objective_us Latency objective of each quantile in microseconds, 0
+ *                     if quantile has none.
+ * @param window       Number of periods in rolling window, at least 1.
+ * @param hists        Latency histograms of vectorloop.
+ * @param hists_count  Number of histograms.
+ * @param now_ms       Loop time in milliseconds, first period starts at.
+ *
+ * @return             Returns 0 on success, -1 if memory could not be
+ *                     allocated.
+ */
+int
+vl_slo_init(vl_slo_t *s, const uint64_t objective_us[VL_SLO_QUANTILES], uint32_t window,
+            histogram_t *hists, size_t hists_count, uint64_t now_ms)
+{
+    memset(s, 0, sizeof(*s));
+    for (int q = 0; q < VL_SLO_QUANTILES; q++) {
+        s->objective_ns[q] = objective_us[q] * 1000;
+    }
+    s->window          = window > 0 ? window : 1;
+    s->period_start_ms = now_ms;
+    s->snapshots       = mem_calloc(MEM_TAG_OTHER, (size_t)s->window * HISTOGRAM_BUCKETS,
+                                    sizeof(uint64_t));
+    if (s->snapshots == NULL) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t sum = vl_slo_bucket_sum(hists, hists_count, i);
+
+        for (uint32_t w = 0; w < s->window; w++) {
+            s->snapshots[(size_t)w * HISTOGRAM_BUCKETS + i] = sum;
+        }
+    }
+    return 0;
+}
+
+/** Release latency SLO state memory.
+ *
+ * @param s SLO state to clean.
+ */
+void
+vl_slo_clean(vl_slo_t *s)
+{
+    mem_free(MEM_TAG_OTHER, s->snapshots);
+    s->snapshots = NULL;
+}
+
+/** End current period once @ref VL_SLO_PERIOD_MS has elapsed: take a
+ * snapshot of histograms in place of oldest one, compute window quantiles
+ * and move each quantile in or out of breach. Window with fewer than
+ * @ref VL_SLO_QUERIES_MIN queries leaves breach state as it is.
+ *
+ * @param s           SLO state.
+ * @param hists       Latency histograms of vectorloop.
+ * @param hists_count Number of histograms.
+ * @param now_ms      Loop time in milliseconds.
+ * @param changed     Where to store bit mask of quantiles that entered or
+ *                    left breach, see @ref vl_slo_t.breached.
+ *
+ * @return            Returns true if period ended.
+ */
+bool
+vl_slo_update(vl_slo_t *s, histogram_t *hists, size_t hists_count, uint64_t now_ms,
+              uint8_t *changed)
+{
+    uint64_t *snapshot = NULL;
+    uint64_t  ranks[VL_SLO_QUANTILES];
+    uint64_t  seen     = 0;
+    uint8_t   breached = 0;
+    int       q        = 0;
+
+    *changed = 0;
+    if (now_ms - s->period_start_ms < VL_SLO_PERIOD_MS) {
+        return false;
+    }
+    s->period_start_ms = now_ms;
+
+    /* Window counts are what newest snapshot added to oldest one. */
+    snapshot   = s->snapshots + (size_t)s->oldest * HISTOGRAM_BUCKETS;
+    s->oldest  = (s->oldest + 1) % s->window;
+    s->queries = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t sum = vl_slo_bucket_sum(hists, hists_count, i);
+
+        s->counts[i] = sum - snapshot[i];
+        s->queries  += s->counts[i];
+        snapshot[i]  = sum;
+    }
+    if (s->queries < VL_SLO_QUERIES_MIN) {
+        return true;
+    }
+
+    /* Rank of each quantile, rounded up, quantiles are found in order. */
+    for (q = 0; q < VL_SLO_QUANTILES; q++) {
+        ranks[q] = (s->queries * vl_slo_permille[q] + 999) / 1000;
+    }
+    q = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS && q < VL_SLO_QUANTILES; i++) {
+        seen += s->counts[i];
+        while (q < VL_SLO_QUANTILES && seen >= ranks[q]) {
+            s->latency_ns[q++] = histogram_bucket_value_max(i);
+        }
+    }
+
+    for (q = 0; q < VL_SLO_QUANTILES; q++) {
+        if (s->objective_ns[q] != 0 && s->latency_ns[q] > s->objective_ns[q]) {
+            breached |= 1 << q;
+        }
+    }
+    *changed    = breached ^ s->breached;
+    s->breached = breached;
+
+    return true;
+}
+
+/** @}*/
@@ -0,0 +1,251 @@
+/**
+ * @file vectorloop_uring.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vectorloop_uring.h"
+
+/** Create an io_uring instance and map its rings.
+ *
+ * @param ring    io_uring instance to initialize.
+ * @param entries Number of submission queue entries, rounded up by kernel to
+ *                a power of 2.
+ *
+ * @return        Returns 0 on success, otherwise negative errno value. On
+ *                error ring is left not created (ring_fd is -1).
+ */
+int
+vl_uring_init(vl_uring_t *ring, unsigned int entries)
+{
+    struct io_uring_params p   = {};
+    int                    err = 0;
+
+    *ring = (vl_uring_t) { .ring_fd = -1 };
+
+    ring->ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->ring_fd < 0) {
+        err = -errno;
+        ring->ring_fd = -1;
+        return err;
+    }
+
+    ring->sq_entries   = p.sq_entries;
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                         IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        err = -errno;
+        ring->sq_ring = NULL;
+        vl_uring_clean(ring);
+        return err;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                             IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            err = -errno;
+            ring->cq_ring = NULL;
+            vl_uring_clean(ring);
+            return err;
+        }
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                      IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        err = -errno;
+        ring->sqes = NULL;
+        vl_uring_clean(ring);
+        return err;
+    }
+
+    ring->sq_head  = (unsigned int *)((char *)ring->sq_ring + p.sq_off.head);
+    ring->sq_tail  = (unsigned int *)((char *)ring->sq_ring + p.sq_off.tail);
+    ring->sq_mask  = (unsigned int *)((char *)ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((char *)ring->sq_ring + p.sq_off.array);
+    ring->cq_head  = (unsigned int *)((char *)ring->cq_ring + p.cq_off.head);
+    ring->cq_tail  = (unsigned int *)((char *)ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask  = (unsigned int *)((char *)ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)((char *)ring->cq_ring + p.cq_off.cqes);
+
+    return 0;
+}
+
+/** Unmap io_uring rings and close io_uring file descriptor.
+ *
+ * @param ring io_uring instance to clean.
+ */
+void
+vl_uring_clean(vl_uring_t *ring)
+{
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+    }
+    *ring = (vl_uring_t) { .ring_fd = -1 };
+}
+
+/** Get next free submission queue entry. Entry is zeroed.
+ *
+ * @param ring io_uring instance.
+ *
+ * @return     Returns submission queue entry, or NULL if submission queue is
+ *             full and needs to be submitted first.
+ */
+struct io_uring_sqe *
+vl_uring_get_sqe(vl_uring_t *ring)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int         index;
+
+    if (ring->sq_pending == ring->sq_entries) {
+        return NULL;
+    }
+
+    index = (*ring->sq_tail + ring->sq_pending) & *ring->sq_mask;
+    ring->sq_array[index] = index;
+    ring->sq_pending++;
+
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+/** Prepare submission queue entry for sendmsg(). MSG_DONTWAIT is always
+ * added to flags, so send that would block completes with -EAGAIN instead of
+ * waiting for socket to become writable.
+ *
+ * @param sqe       Submission queue entry.
+ * @param fd        Socket to send on.
+ * @param msg       Message to send.
+ * @param flags     Flags as for sendmsg().
+ * @param user_data Value returned in completion queue entry.
+ */
+void
+vl_uring_prep_sendmsg(struct io_uring_sqe *sqe, int fd, struct msghdr *msg,
+                      int flags, uint64_t user_data)
+{
+    sqe->opcode    = IORING_OP_SENDMSG;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)msg;
+    sqe->len       = 1;
+    sqe->msg_flags = flags | MSG_DONTWAIT;
+    sqe->user_data = user_data;
+}
+
+/** Submit all prepared submission queue entries and wait for all of them to
+ * complete.
+ *
+ * If there was an error in which case io_uring_enter() returned -1 (other
+ * than EINTR), function aborts (throws an exception).
+ *
+ * @param ring io_uring instance.
+ *
+ * @return     Returns number of entries submitted.
+ */
+unsigned int
+vl_uring_submit_and_wait(vl_uring_t *ring)
+{
+    unsigned int submit = ring->sq_pending;
+    int          ret    = 0;
+
+    if (submit == 0) {
+        return 0;
+    }
+
+    /* Publish entries to kernel. */
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + submit, __ATOMIC_RELEASE);
+    ring->sq_pending = 0;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->ring_fd, submit, submit,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        fprintf(stderr, "vl_uring_submit_and_wait() err no %d, error message: %s\n",
+                errno, strerror(errno));
+        assert(0);
+    }
+
+    return submit;
+}
+
+/** Get next completion queue entry.
+ *
+ * @param ring io_uring instance.
+ *
+ * @return     Returns completion queue entry or NULL if there are none. Entry
+ *             must be marked seen via @ref vl_uring_cqe_seen().
+ */
+struct io_uring_cqe *
+vl_uring_peek_cqe(vl_uring_t *ring)
+{
+    unsigned int head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+/** Mark completion queue entry returned by @ref vl_uring_peek_cqe() as seen.
+ *
+ * @param ring io_uring instance.
+ */
+void
+vl_uring_cqe_seen(vl_uring_t *ring)
+{
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,1399 @@
+/**
+ * @file vectorloop_xdp.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup vlxdp
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "vectorloop_bpf.h"
+#include "vectorloop_xdp.h"
+
+#ifndef AF_XDP
+/** AF_XDP socket family, in case C library headers predate it. */
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+/** AF_XDP socket option level, in case C library headers predate it. */
+#define SOL_XDP 283
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+/** Socket option preferring busy polling over interrupts, in case C library
+ * headers predate it.
+ */
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+#ifndef SO_BUSY_POLL_BUDGET
+/** Socket option setting packets processed per busy poll, in case C library
+ * headers predate it.
+ */
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+
+/** Length of IPv4 header, IPv4 options are not supported. */
+#define VL_XDP_IPV4_HLEN 20
+
+/** Length of IPv6 header, IPv6 extension headers are not supported. */
+#define VL_XDP_IPV6_HLEN 40
+
+/** Length of UDP header. */
+#define VL_XDP_UDP_HLEN 8
+
+/** Jump offset placeholder for jump to XDP program label passing packet to
+ * kernel, resolved once program is built.
+ */
+#define VL_BPF_LABEL_PASS 0x7fff
+
+/** Jump offset placeholder for jump to XDP program label redirecting packet
+ * to AF_XDP socket, resolved once program is built.
+ */
+#define VL_BPF_LABEL_REDIRECT 0x7ffe
+
+/** Jump offset placeholder for jump to XDP program label parsing IPv6
+ * packet, resolved once program is built.
+ */
+#define VL_BPF_LABEL_IPV6 0x7ffd
+
+/** Jump offset placeholder for jump to XDP program label dropping packet,
+ * resolved once program is built.
+ */
+#define VL_BPF_LABEL_DROP 0x7ffc
+
+/** Maximum number of instructions of XDP program. */
+#define VL_XDP_PROG_INSNS_MAX 256
+
+/** Offset of DNS message in frame of IPv4 UDP datagram. */
+#define VL_XDP_IPV4_DNS_OFF (VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN)
+
+/** Offset of in-kernel responder map key on XDP program stack. */
+#define VL_XDP_RESP_KEY_OFF (-(int)sizeof(vl_xdp_resp_key_t))
+
+/** Offset of single entry map index (0) on XDP program stack. */
+#define VL_XDP_RESP_INDEX_OFF (VL_XDP_RESP_KEY_OFF - 8)
+
+/** Build in-kernel responder part of XDP program, run for IPv4 UDP datagrams
+ * to DNS port, see @ref vlxdp. Request following message ID is copied into
+ * responder map key on stack and looked up, on a hit of current generation
+ * frame is resized to fit response, which is copied after message ID, and
+ * headers are turned around. Frame is sent back out with XDP_TX. Datagrams
+ * that are not answered are redirected to AF_XDP socket.
+ *
+ * @param insns Array to build program into.
+ * @param n     Number of instructions already in array.
+ * @param prog  XDP program object with responder maps.
+ *
+ * @return      Returns number of instructions in array.
+ */
+static int
+vl_xdp_prog_build_resp(struct bpf_insn *insns, int n, const vl_xdp_prog_t *prog)
+{
+    const int dns = VL_XDP_IPV4_DNS_OFF;
+    const int ip  = VL_XDP_ETH_HLEN;
+    const int udp = VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN;
+
+    /* r7 = request length following message ID, from UDP length. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_7, BPF_REG_2, udp + 4, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_7, 0, 0, 16);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JLT | BPF_K, BPF_REG_7, 0,
+                             VL_BPF_LABEL_REDIRECT, VL_XDP_UDP_HLEN + 12);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JGT | BPF_K, BPF_REG_7, 0,
+                             VL_BPF_LABEL_REDIRECT,
+                             VL_XDP_UDP_HLEN + 2 + VL_XDP_RESP_QUERY_MAX);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_7, 0, 0,
+                             -(VL_XDP_UDP_HLEN + 2));
+
+    /* Zero padded key, length followed by request. */
+    for (int off = VL_XDP_RESP_KEY_OFF; off < 0; off += 8) {
+        insns[n++] = VL_BPF_INSN(BPF_ST | BPF_MEM | BPF_DW, BPF_REG_10, 0, off, 0);
+    }
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_MEM | BPF_H, BPF_REG_10, BPF_REG_7,
+                             VL_XDP_RESP_KEY_OFF, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, dns + 2);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0,
+                             VL_XDP_RESP_KEY_OFF + (int)offsetof(vl_xdp_resp_key_t, query));
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_7, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_xdp_load_bytes);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0,
+                             VL_BPF_LABEL_REDIRECT, 0);
+
+    /* r8 = current generation, 0 if responder stands aside. */
+    insns[n++] = VL_BPF_INSN(BPF_ST | BPF_MEM | BPF_W, BPF_REG_10, 0,
+                             VL_XDP_RESP_INDEX_OFF, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1,
+                             BPF_PSEUDO_MAP_FD, 0, prog->resp_gen_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0,
+                             VL_XDP_RESP_INDEX_OFF);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0,
+                             VL_BPF_LABEL_REDIRECT, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_8, BPF_REG_0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_8, 0,
+                             VL_BPF_LABEL_REDIRECT, 0);
+
+    /* r9 = response entry of current generation, r7 = its length. */
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1,
+                             BPF_PSEUDO_MAP_FD, 0, prog->resp_map_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0,
+                             VL_XDP_RESP_KEY_OFF);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0,
+                             VL_BPF_LABEL_REDIRECT, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_9, BPF_REG_0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_1, BPF_REG_9,
+                             offsetof(vl_xdp_resp_value_t, generation), 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_X, BPF_REG_1, BPF_REG_8,
+                             VL_BPF_LABEL_REDIRECT, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_7, BPF_REG_9,
+                             offsetof(vl_xdp_resp_value_t, len), 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JLT | BPF_K, BPF_REG_7, 0,
+                             VL_BPF_LABEL_REDIRECT, 10);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JGT | BPF_K, BPF_REG_7, 0,
+                             VL_BPF_LABEL_REDIRECT, VL_XDP_RESP_RESPONSE_MAX);
+
+    /* Resize frame to end with response, frame is unchanged on error. */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_xdp_get_buff_len);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_7, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, dns + 2);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_SUB | BPF_X, BPF_REG_2, BPF_REG_0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_xdp_adjust_tail);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0,
+                             VL_BPF_LABEL_REDIRECT, 0);
+
+    /* Response following message ID, frame is left half built on error. */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, dns + 2);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_9, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0,
+                             offsetof(vl_xdp_resp_value_t, response));
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_7, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_xdp_store_bytes);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0,
+                             VL_BPF_LABEL_DROP, 0);
+
+    /* Packet pointers are invalidated by resize, headers are checked again. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6,
+                             offsetof(struct xdp_md, data), 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_3, BPF_REG_6,
+                             offsetof(struct xdp_md, data_end), 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, dns);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3,
+                             VL_BPF_LABEL_DROP, 0);
+
+    /* Swap MAC addresses (in half words), IPv4 addresses and UDP ports. */
+    for (int off = 0; off < 6; off += 2) {
+        insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_4, BPF_REG_2, off, 0);
+        insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2, off + 6, 0);
+        insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_5, off, 0);
+        insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_4, off + 6, 0);
+    }
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_4, BPF_REG_2, ip + 12, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_5, BPF_REG_2, ip + 16, 0);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_5, ip + 12, 0);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_4, ip + 16, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_4, BPF_REG_2, udp, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2, udp + 2, 0);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_5, udp, 0);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_4, udp + 2, 0);
+
+    /* UDP length, checksum is optional for IPv4 and is left 0. */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_7, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+                             VL_XDP_UDP_HLEN + 2);
+    insns[n++] = VL_BPF_INSN(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_4, 0, 0, 16);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_4, udp + 4, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ST | BPF_H | BPF_MEM, BPF_REG_2, 0, udp + 6, 0);
+
+    /* IPv4 total length, TTL and header checksum. One's complement sum does
+     * not depend on byte order, so words are summed as loaded.
+     */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_7, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+                             VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN + 2);
+    insns[n++] = VL_BPF_INSN(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_4, 0, 0, 16);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_4, ip + 2, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ST | BPF_B | BPF_MEM, BPF_REG_2, 0, ip + 8, 64);
+    insns[n++] = VL_BPF_INSN(BPF_ST | BPF_H | BPF_MEM, BPF_REG_2, 0, ip + 10, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0);
+    for (int off = 0; off < VL_XDP_IPV4_HLEN; off += 2) {
+        insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                                 ip + off, 0);
+        insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_4, BPF_REG_5, 0, 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_5, BPF_REG_4, 0, 0);
+        insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_RSH | BPF_K, BPF_REG_5, 0, 0, 16);
+        insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_4, 0, 0, 0xffff);
+        insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_4, BPF_REG_5, 0, 0);
+    }
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_XOR | BPF_K, BPF_REG_4, 0, 0, 0xffff);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_H | BPF_MEM, BPF_REG_2, BPF_REG_4, ip + 10, 0);
+
+    /* Count answer in per CPU counter, index 0 is still on stack. */
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1,
+                             BPF_PSEUDO_MAP_FD, 0, prog->resp_stat_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0,
+                             VL_XDP_RESP_INDEX_OFF);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 3, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_1, BPF_REG_0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_1, 0, 0, 1);
+    insns[n++] = VL_BPF_INSN(BPF_STX | BPF_DW | BPF_MEM, BPF_REG_0, BPF_REG_1, 0, 0);
+
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_TX);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    return n;
+}
+
+/** Build XDP program which redirects UDP datagrams to DNS port into AF_XDP
+ * socket of receive queue they arrived on, and passes all other traffic to
+ * kernel. Packets not parsed by application (IP fragments, IPv4 options,
+ * IPv6 extension headers, VLAN tagged) are passed to kernel as well. If no
+ * socket is bound to receive queue packet is also passed to kernel. IPv4
+ * datagrams go through in-kernel responder first, if it is enabled, see
+ * @ref vl_xdp_prog_build_resp.
+ *
+ * @param insns Array to build program into, @ref VL_XDP_PROG_INSNS_MAX
+ *              instructions.
+ * @param prog  XDP program object with AF_XDP socket map and responder maps.
+ * @param port  DNS UDP port.
+ *
+ * @return      Returns number of instructions in program.
+ */
+static int
+vl_xdp_prog_build(struct bpf_insn *insns, const vl_xdp_prog_t *prog, uint16_t port)
+{
+    int n        = 0;
+    int redirect = 0;
+    int pass     = 0;
+    int drop     = 0;
+    int ipv6     = 0;
+
+    /* r6 = ctx, r2 = data, r3 = data_end */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6,
+                             offsetof(struct xdp_md, data), 0);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_3, BPF_REG_6,
+                             offsetof(struct xdp_md, data_end), 0);
+
+    /* Frame must hold Ethernet, IPv4 and UDP headers. */
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+                             VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3,
+                             VL_BPF_LABEL_PASS, 0);
+
+    /* Ethernet type, packet data is in network byte order. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2, 12, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_IPV6, htons(0x86dd));
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, htons(0x0800));
+
+    /* IPv4, version 4 with no options, UDP, not a fragment. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_B | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, 0x45);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_B | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN + 9, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, IPPROTO_UDP);
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN + 6, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0,
+                             htons(0x3fff));
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, 0);
+    /* UDP destination port. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN + 2, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, htons(port));
+    if (prog->resp_map_fd >= 0) {
+        n = vl_xdp_prog_build_resp(insns, n, prog);
+    } else {
+        insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JA, 0, 0, VL_BPF_LABEL_REDIRECT, 0);
+    }
+
+    /* IPv6, frame must hold Ethernet, IPv6 and UDP headers. */
+    ipv6 = n;
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+                             VL_XDP_ETH_HLEN + VL_XDP_IPV6_HLEN + VL_XDP_UDP_HLEN);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3,
+                             VL_BPF_LABEL_PASS, 0);
+    /* Next header is UDP. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_B | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN + 6, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, IPPROTO_UDP);
+    /* UDP destination port. */
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2,
+                             VL_XDP_ETH_HLEN + VL_XDP_IPV6_HLEN + 2, 0);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0,
+                             VL_BPF_LABEL_PASS, htons(port));
+
+    /* bpf_redirect_map(map, rx_queue_index, XDP_PASS) */
+    redirect = n;
+    insns[n++] = VL_BPF_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6,
+                             offsetof(struct xdp_md, rx_queue_index), 0);
+    insns[n++] = VL_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1,
+                             BPF_PSEUDO_MAP_FD, 0, prog->map_fd);
+    insns[n++] = VL_BPF_INSN(0, 0, 0, 0, 0);
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    /* Pass packet to kernel. */
+    pass = n;
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    /* Drop packet responder failed to turn into response. */
+    drop = n;
+    insns[n++] = VL_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_DROP);
+    insns[n++] = VL_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    /* Resolve jumps to labels, offset is relative to next instruction. */
+    for (int i = 0; i < n; i++) {
+        if (BPF_CLASS(insns[i].code) != BPF_JMP ||
+            BPF_OP(insns[i].code) == BPF_CALL || BPF_OP(insns[i].code) == BPF_EXIT) {
+            continue;
+        }
+        if (insns[i].off == VL_BPF_LABEL_PASS) {
+            insns[i].off = pass - i - 1;
+        } else if (insns[i].off == VL_BPF_LABEL_REDIRECT) {
+            insns[i].off = redirect - i - 1;
+        } else if (insns[i].off == VL_BPF_LABEL_IPV6) {
+            insns[i].off = ipv6 - i - 1;
+        } else if (insns[i].off == VL_BPF_LABEL_DROP) {
+            insns[i].off = drop - i - 1;
+        }
+    }
+
+    return n;
+}
+
+/** Number of possible CPUs, values of per CPU BPF maps hold as many entries.
+ * Read from highest CPU number in "/sys/devices/system/cpu/possible", which
+ * may exceed number of configured CPUs.
+ *
+ * @return Returns number of possible CPUs.
+ */
+static unsigned int
+vl_xdp_cpus_possible(void)
+{
+    char          buf[128] = {};
+    unsigned int  cpus     = get_nprocs_conf();
+    FILE         *f        = fopen("/sys/devices/system/cpu/possible", "r");
+    char         *last     = NULL;
+
+    if (f == NULL) {
+        return cpus;
+    }
+    if (fgets(buf, sizeof(buf), f) != NULL) {
+        last = buf + strcspn(buf, "\n");
+        while (last > buf && last[-1] != '-' && last[-1] != ',') {
+            last--;
+        }
+        if ((unsigned int)strtoul(last, NULL, 10) + 1 > cpus) {
+            cpus = strtoul(last, NULL, 10) + 1;
+        }
+    }
+    fclose(f);
+
+    return cpus;
+}
+
+/** Create in-kernel responder maps: LRU hash map of responses, generation
+ * map and per CPU answer counter map, see @ref vlxdp.
+ *
+ * @param prog        XDP program object maps are stored in.
+ * @param resp_size   Number of entries in responder map.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf.
+ */
+static int
+vl_xdp_prog_resp_create(vl_xdp_prog_t *prog, unsigned int resp_size, char *err_buf,
+                        size_t err_buf_len)
+{
+    union bpf_attr attr = {};
+
+    attr.map_type    = BPF_MAP_TYPE_LRU_HASH;
+    attr.key_size    = sizeof(vl_xdp_resp_key_t);
+    attr.value_size  = sizeof(vl_xdp_resp_value_t);
+    attr.max_entries = resp_size;
+    prog->resp_map_fd = vl_bpf(BPF_MAP_CREATE, &attr);
+
+    attr = (union bpf_attr) {};
+    attr.map_type    = BPF_MAP_TYPE_ARRAY;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint64_t);
+    attr.max_entries = 1;
+    prog->resp_gen_fd = vl_bpf(BPF_MAP_CREATE, &attr);
+
+    attr.map_type     = BPF_MAP_TYPE_PERCPU_ARRAY;
+    prog->resp_stat_fd = vl_bpf(BPF_MAP_CREATE, &attr);
+
+    if (prog->resp_map_fd < 0 || prog->resp_gen_fd < 0 || prog->resp_stat_fd < 0) {
+        snprintf(err_buf, err_buf_len, "XDP: could not create responder maps, %s",
+                 strerror(errno));
+        return -1;
+    }
+    prog->cpus = vl_xdp_cpus_possible();
+
+    return 0;
+}
+
+/** Load XDP program, along with AF_XDP socket map, and attach it to network
+ * interface. Program is attached via BPF link, so it is detached when link
+ * is closed, including when process exits.
+ *
+ * @param prog        XDP program object to initialize.
+ * @param ifname      Network interface name.
+ * @param port        DNS UDP port, only datagrams to it are redirected.
+ * @param queues      Number of entries in socket map, highest receive queue
+ *                    number an AF_XDP socket is bound to + 1.
+ * @param resp_size   Number of entries in in-kernel responder map, 0 if
+ *                    responder is disabled.
+ * @param err_buf     Buffer where to store error message on error.
+ * @param err_buf_len Length of error buffer.
+ *
+ * @return            Returns 0 on success, otherwise -1 and error message is
+ *                    stored in err_buf. On error program object is left not
+ *                    loaded.
+ */
+int
+vl_xdp_prog_load(vl_xdp_prog_t *prog, const char *ifname, uint16_t port,
+                 unsigned int queues, unsigned int resp_size, char *err_buf,
+                 size_t err_buf_len)
+{
+    struct bpf_insn insns[VL_XDP_PROG_INSNS_MAX];
+    union bpf_attr  attr  = {};
+    struct ifreq    ifr   = {};
+    int             fd    = -1;
+    int             count = 0;
+
+    *prog = (vl_xdp_prog_t) { .map_fd = -1, .prog_fd = -1, .link_fd = -1,
+                              .resp_map_fd = -1, .resp_gen_fd = -1, .resp_stat_fd = -1 };
+
+    prog->ifindex = if_nametoindex(ifname);
+    if (prog->ifindex == 0) {
+        snprintf(err_buf, err_buf_len, "XDP: unknown network interface \"%s\", %s",
+                 ifname, strerror(errno));
+        return -1;
+    }
+
+    /* Interface MTU. */
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (fd < 0 || ioctl(fd, SIOCGIFMTU, &ifr) < 0) {
+        snprintf(err_buf, err_buf_len, "XDP: could not get MTU of \"%s\", %s",
+                 ifname, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        vl_xdp_prog_clean(prog);
+        return -1;
+    }
+    close(fd);
+    prog->mtu = ifr.ifr_mtu;
+
+    /* AF_XDP socket map. */
+    attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint32_t);
+    attr.max_entries = queues;
+    prog->map_fd = vl_bpf(BPF_MAP_CREATE, &attr);
+    if (prog->map_fd < 0) {
+        snprintf(err_buf, err_buf_len, "XDP: could not create socket map, %s",
+                 strerror(errno));
+        vl_xdp_prog_clean(prog);
+        return -1;
+    }
+
+    if (resp_size > 0 && vl_xdp_prog_resp_create(prog, resp_size, err_buf,
+                                                 err_buf_len) != 0) {
+        vl_xdp_prog_clean(prog);
+        return -1;
+    }
+
+    /* Program. */
+    count = vl_xdp_prog_build(insns, prog, port);
+    attr = (union bpf_attr) {};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns     = (uint64_t)(uintptr_t)insns;
+    attr.insn_cnt  = count;
+    attr.license   = (uint64_t)(uintptr_t)VL_BPF_LICENSE;
+    prog->prog_fd = vl_bpf(BPF_PROG_LOAD, &attr);
+    if (prog->prog_fd < 0) {
+        snprintf(err_buf, err_buf_len, "XDP: could not load program, %s",
+                 strerror(errno));
+        vl_xdp_prog_clean(prog);
+        return -1;
+    }
+
+    /* Attach to interface. */
+    attr = (union bpf_attr) {};
+    attr.link_create.prog_fd        = prog->prog_fd;
+    attr.link_create.target_ifindex = prog->ifindex;
+    attr.link_create.attach_type    = BPF_XDP;
+    prog->link_fd = vl_bpf(BPF_LINK_CREATE, &attr);
+    if (prog->link_fd < 0) {
+        snprintf(err_buf, err_buf_len, "XDP: could not attach program to \"%s\", %s",
+                 ifname, strerror(errno));
+        vl_xdp_prog_clean(prog);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Detach XDP program from network interface and release it along with
+ * socket map.
+ *
+ * @param prog XDP program object to clean.
+ */
+void
+vl_xdp_prog_clean(vl_xdp_prog_t *prog)
+{
+    if (prog->link_fd >= 0) {
+        close(prog->link_fd);
+    }
+    if (prog->prog_fd >= 0) {
+        close(prog->prog_fd);
+    }
+    if (prog->map_fd >= 0) {
+        close(prog->map_fd);
+    }
+    if (prog->resp_map_fd >= 0) {
+        close(prog->resp_map_fd);
+    }
+    if (prog->resp_gen_fd >= 0) {
+        close(prog->resp_gen_fd);
+    }
+    if (prog->resp_stat_fd >= 0) {
+        close(prog->resp_stat_fd);
+    }
+    *prog = (vl_xdp_prog_t) { .map_fd = -1, .prog_fd = -1, .link_fd = -1,
+                              .resp_map_fd = -1, .resp_gen_fd = -1, .resp_stat_fd = -1 };
+}
+
+/** Build in-kernel responder map entry from request and its response, both
+ * starting with DNS header. Message ID is left out of both, XDP program keeps
+ * ID of request it answers.
+ *
+ * @param key          Key to build.
+ * @param value        Value to build.
+ * @param generation   Response cache generation response was resolved
+ *                     against.
+ * @param query        Request.
+ * @param query_len    Length of request.
+ * @param response     Response.
+ * @param response_len Length of response.
+ * @param mtu          Interface MTU, IPv4 datagram of response must fit it.
+ *
+ * @return             Returns true if entry is built, false if request or
+ *                     response is too short or too long.
+ */
+bool
+vl_xdp_resp_entry_build(vl_xdp_resp_key_t *key, vl_xdp_resp_value_t *value,
+                        uint64_t generation, const unsigned char *query, size_t query_len,
+                        const unsigned char *response, size_t response_len,
+                        unsigned int mtu)
+{
+    if (query_len < 12 || query_len - 2 > VL_XDP_RESP_QUERY_MAX ||
+        response_len < 12 || response_len - 2 > VL_XDP_RESP_RESPONSE_MAX ||
+        VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN + response_len > mtu) {
+        return false;
+    }
+    memset(key, 0, sizeof(*key));
+    key->len = query_len - 2;
+    memcpy(key->query, query + 2, query_len - 2);
+
+    value->generation = generation;
+    value->len        = response_len - 2;
+    memset(value->pad, 0, sizeof(value->pad));
+    memcpy(value->response, response + 2, response_len - 2);
+
+    return true;
+}
+
+/** Add entry to in-kernel responder map, or replace entry with same key. Map
+ * evicts least recently used entries once full.
+ *
+ * @param prog  XDP program object with responder maps.
+ * @param key   Entry key, see @ref vl_xdp_resp_entry_build.
+ * @param value Entry value.
+ *
+ * @return      Returns 0 on success, otherwise negative errno value.
+ */
+int
+vl_xdp_resp_put(vl_xdp_prog_t *prog, const vl_xdp_resp_key_t *key,
+                const vl_xdp_resp_value_t *value)
+{
+    union bpf_attr attr = {};
+
+    attr.map_fd = prog->resp_map_fd;
+    attr.key    = (uint64_t)(uintptr_t)key;
+    attr.value  = (uint64_t)(uintptr_t)value;
+    attr.flags  = BPF_ANY;
+
+    return vl_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0 ? -errno : 0;
+}
+
+/** Publish generation in-kernel responder answers entries of, 0 to stand
+ * aside.
+ *
+ * @param prog       XDP program object with responder maps.
+ * @param generation Response cache generation.
+ *
+ * @return           Returns 0 on success, otherwise negative errno value.
+ */
+int
+vl_xdp_resp_generation_set(vl_xdp_prog_t *prog, uint64_t generation)
+{
+    union bpf_attr attr  = {};
+    uint32_t       index = 0;
+
+    attr.map_fd = prog->resp_gen_fd;
+    attr.key    = (uint64_t)(uintptr_t)&index;
+    attr.value  = (uint64_t)(uintptr_t)&generation;
+    attr.flags  = BPF_ANY;
+
+    return vl_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0 ? -errno : 0;
+}
+
+/** Number of queries in-kernel responder answered, summed over all CPUs.
+ *
+ * @param prog XDP program object with responder maps.
+ *
+ * @return     Returns number of answered queries, 0 if responder is disabled
+ *             or counter could not be read.
+ */
+uint64_t
+vl_xdp_resp_answers(vl_xdp_prog_t *prog)
+{
+    union bpf_attr  attr   = {};
+    uint32_t        index  = 0;
+    uint64_t        sum    = 0;
+    uint64_t       *values = NULL;
+
+    if (prog->resp_stat_fd < 0) {
+        return 0;
+    }
+    values = calloc(prog->cpus, sizeof(uint64_t));
+    CHECK_MALLOC(values);
+    attr.map_fd = prog->resp_stat_fd;
+    attr.key    = (uint64_t)(uintptr_t)&index;
+    attr.value  = (uint64_t)(uintptr_t)values;
+    if (vl_bpf(BPF_MAP_LOOKUP_ELEM, &attr) == 0) {
+        for (unsigned int i = 0; i < prog->cpus; i++) {
+            sum += values[i];
+        }
+    }
+    free(values);
+
+    return sum;
+}
+
+/** Map one of AF_XDP socket rings.
+ *
+ * @param ring      Ring object to initialize.
+ * @param fd        AF_XDP socket.
+ * @param off       Ring offsets as returned by XDP_MMAP_OFFSETS.
+ * @param desc_size Size of ring descriptor.
+ * @param pgoff     Page offset identifying ring to map.
+ *
+ * @return          Returns 0 on success, otherwise negative errno value.
+ */
+static int
+vl_xdp_ring_map(vl_xdp_ring_t *ring, int fd, struct xdp_ring_offset *off,
+                size_t desc_size, off_t pgoff)
+{
+    ring->map_size = off->desc + VL_XDP_RING_SIZE * desc_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        return -errno;
+    }
+    ring->producer = (uint32_t *)((char *)ring->map + off->producer);
+    ring->consumer = (uint32_t *)((char *)ring->map + off->consumer);
+    ring->flags    = (uint32_t *)((char *)ring->map + off->flags);
+    ring->descs    = (char *)ring->map + off->desc;
+    ring->mask     = VL_XDP_RING_SIZE - 1;
+
+    return 0;
+}
+
+/** Make AF_XDP socket busy poll network device in preferred mode. Receive
+ * queue interrupts are then kept off as long as application keeps polling
+ * (provided "napi_defer_hard_irqs" and "gro_flush_timeout" of interface are
+ * set), device driver (NAPI) processing receive and transmit ring runs in
+ * system calls kicking socket instead of softirq.
+ *
+ * @param fd     AF_XDP socket.
+ * @param usecs  Time in microseconds a system call busy polls for.
+ * @param budget Number of packets processed per poll.
+ *
+ * @return       Returns 0 on success, otherwise negative errno value.
+ */
+static int
+vl_xdp_busy_poll_set(int fd, unsigned int usecs, unsigned int budget)
+{
+    int prefer = 1;
+    int value  = (int)usecs;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) < 0) {
+        return -errno;
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0) {
+        return -errno;
+    }
+    value = (int)budget;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &value, sizeof(value)) < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/** Create AF_XDP socket with its UMEM, bind it to network interface receive
+ * queue and add it to XDP program socket map. Socket is bound in zero copy
+ * mode if driver supports it, otherwise in copy mode.
+ *
+ * @param xdp        AF_XDP socket object to initialize.
+ * @param prog       Loaded XDP program.
+ * @param queue_id   Receive queue to bind to.
+ * @param vector_len Length of UDP connection vectors socket is read into.
+ * @param busy_poll  Time in microseconds to busy poll network device for, 0
+ *                   to stay interrupt driven, see @ref vl_xdp_busy_poll_set.
+ *
+ * @return           Returns 0 on success, otherwise negative errno value. On
+ *                   error socket is left not created (fd is -1).
+ */
+int
+vl_xdp_init(vl_xdp_t *xdp, vl_xdp_prog_t *prog, unsigned int queue_id,
+            unsigned int vector_len, unsigned int busy_poll)
+{
+    struct xdp_umem_reg     mr    = {};
+    struct xdp_mmap_offsets off   = {};
+    socklen_t               len   = sizeof(off);
+    int                     size  = VL_XDP_RING_SIZE;
+    int                     err   = 0;
+    union bpf_attr          attr  = {};
+    uint32_t                key   = queue_id;
+    uint32_t                value = 0;
+    struct sockaddr_xdp     sxdp  = {
+        .sxdp_family   = AF_XDP,
+        .sxdp_flags    = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP,
+        .sxdp_ifindex  = prog->ifindex,
+        .sxdp_queue_id = queue_id,
+    };
+
+    *xdp = (vl_xdp_t) { .fd = -1, .queue_id = queue_id };
+
+    xdp->umem_size = (size_t)VL_XDP_FRAME_COUNT * VL_XDP_FRAME_SIZE;
+    xdp->umem = mmap(NULL, xdp->umem_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (xdp->umem == MAP_FAILED) {
+        err = -errno;
+        xdp->umem = NULL;
+        vl_xdp_clean(xdp);
+        return err;
+    }
+
+    xdp->fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xdp->fd < 0) {
+        err = -errno;
+        xdp->fd = -1;
+        vl_xdp_clean(xdp);
+        return err;
+    }
+
+    mr.addr       = (uint64_t)(uintptr_t)xdp->umem;
+    mr.len        = xdp->umem_size;
+    mr.chunk_size = VL_XDP_FRAME_SIZE;
+    if (setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) < 0 ||
+        setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) < 0 ||
+        setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) < 0 ||
+        setsockopt(xdp->fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) < 0 ||
+        setsockopt(xdp->fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size)) < 0 ||
+        getsockopt(xdp->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len) < 0) {
+        err = -errno;
+        vl_xdp_clean(xdp);
+        return err;
+    }
+
+    if ((err = vl_xdp_ring_map(&xdp->fill, xdp->fd, &off.fr, sizeof(uint64_t),
+                               XDP_UMEM_PGOFF_FILL_RING)) < 0 ||
+        (err = vl_xdp_ring_map(&xdp->comp, xdp->fd, &off.cr, sizeof(uint64_t),
+                               XDP_UMEM_PGOFF_COMPLETION_RING)) < 0 ||
+        (err = vl_xdp_ring_map(&xdp->rx, xdp->fd, &off.rx, sizeof(struct xdp_desc),
+                               XDP_PGOFF_RX_RING)) < 0 ||
+        (err = vl_xdp_ring_map(&xdp->tx, xdp->fd, &off.tx, sizeof(struct xdp_desc),
+                               XDP_PGOFF_TX_RING)) < 0) {
+        vl_xdp_clean(xdp);
+        return err;
+    }
+
+    /* First half of frames is given to kernel to receive into, second half
+     * is used to send from.
+     */
+    for (unsigned int i = 0; i < VL_XDP_RING_SIZE; i++) {
+        ((uint64_t *)xdp->fill.descs)[i] = (uint64_t)i * VL_XDP_FRAME_SIZE;
+    }
+    __atomic_store_n(xdp->fill.producer, VL_XDP_RING_SIZE, __ATOMIC_RELEASE);
+
+    xdp->tx_free = malloc(sizeof(uint64_t) * (VL_XDP_FRAME_COUNT - VL_XDP_RING_SIZE));
+    CHECK_MALLOC(xdp->tx_free);
+    for (unsigned int i = VL_XDP_RING_SIZE; i < VL_XDP_FRAME_COUNT; i++) {
+        xdp->tx_free[xdp->tx_free_count++] = (uint64_t)i * VL_XDP_FRAME_SIZE;
+    }
+
+    xdp->macs = malloc(sizeof(*xdp->macs) * vector_len);
+    CHECK_MALLOC(xdp->macs);
+
+    if (bind(xdp->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+        /* Driver does not support zero copy, fall back to copy mode. */
+        sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        if (bind(xdp->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+            err = -errno;
+            vl_xdp_clean(xdp);
+            return err;
+        }
+    } else {
+        xdp->zero_copy = true;
+    }
+
+    if (busy_poll > 0) {
+        xdp->busy_poll = vl_xdp_busy_poll_set(xdp->fd, busy_poll, vector_len) == 0;
+    }
+
+    /* Largest response that fits single packet, on IPv6 too. */
+    xdp->payload_max = VL_XDP_FRAME_SIZE - VL_XDP_ETH_HLEN;
+    if (prog->mtu < xdp->payload_max) {
+        xdp->payload_max = prog->mtu;
+    }
+    xdp->payload_max -= VL_XDP_IPV6_HLEN + VL_XDP_UDP_HLEN;
+
+    /* Redirect packets of receive queue to socket. */
+    value = xdp->fd;
+    attr.map_fd = prog->map_fd;
+    attr.key    = (uint64_t)(uintptr_t)&key;
+    attr.value  = (uint64_t)(uintptr_t)&value;
+    if (vl_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        err = -errno;
+        vl_xdp_clean(xdp);
+        return err;
+    }
+
+    return 0;
+}
+
+/** Close AF_XDP socket, unmap its rings and release its UMEM. Socket is
+ * removed from XDP program socket map by kernel when it is closed.
+ *
+ * @param xdp AF_XDP socket object to clean.
+ */
+void
+vl_xdp_clean(vl_xdp_t *xdp)
+{
+    vl_xdp_ring_t *rings[] = { &xdp->fill, &xdp->comp, &xdp->rx, &xdp->tx };
+
+    for (size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); i++) {
+        if (rings[i]->map != NULL) {
+            munmap(rings[i]->map, rings[i]->map_size);
+        }
+    }
+    if (xdp->fd >= 0) {
+        close(xdp->fd);
+    }
+    if (xdp->umem != NULL) {
+        munmap(xdp->umem, xdp->umem_size);
+    }
+    free(xdp->tx_free);
+    free(xdp->macs);
+    *xdp = (vl_xdp_t) { .fd = -1 };
+}
+
+/** Add data to Internet checksum.
+ *
+ * @param sum Checksum accumulated so far.
+ * @param buf Data to add.
+ * @param len Length of data.
+ *
+ * @return    Returns accumulated checksum, not folded.
+ */
+static uint64_t
+vl_xdp_csum_add(uint64_t sum, const unsigned char *buf, size_t len)
+{
+    size_t i = 0;
+
+    for (; i + 1 < len; i += 2) {
+        sum += (uint32_t)buf[i] << 8 | buf[i + 1];
+    }
+    if (i < len) {
+        sum += (uint32_t)buf[i] << 8;
+    }
+    return sum;
+}
+
+/** Fold accumulated Internet checksum into 16 bits and complement it.
+ *
+ * @param sum Accumulated checksum.
+ *
+ * @return    Returns checksum in host byte order.
+ */
+static uint16_t
+vl_xdp_csum_fold(uint64_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return ~sum & 0xffff;
+}
+
+/** Parse Ethernet frame carrying UDP datagram into a read vector message,
+ * same as recvmmsg() would fill it. Client address is stored in msg_name,
+ * local (destination) address is stored in an IP_PKTINFO or IPV6_PKTINFO
+ * control message, and UDP payload is copied to payload buffer.
+ *
+ * On input msg_namelen and msg_controllen are sizes of msg_name and
+ * msg_control buffers, on success they are set to length of data stored. On
+ * failure message is left as it was, so vector entry can be read into next.
+ *
+ * @param frame        Frame.
+ * @param len          Length of frame.
+ * @param port         UDP destination port datagram must be sent to.
+ * @param msg_hdr      Message to populate.
+ * @param payload      Buffer to copy UDP payload to.
+ * @param payload_size Size of payload buffer.
+ * @param macs         Where to store VL_XDP_MACS_LEN bytes of frame
+ *                     destination and source MAC addresses.
+ *
+ * @return             Returns number of payload bytes copied, which is
+ *                     payload_size if payload was truncated, or -1 if frame
+ *                     is not a UDP datagram to port.
+ */
+int
+vl_xdp_frame_parse(const unsigned char *frame, size_t len, uint16_t port,
+                   struct msghdr *msg_hdr, unsigned char *payload,
+                   size_t payload_size, unsigned char *macs)
+{
+    const unsigned char *ip      = frame + VL_XDP_ETH_HLEN;
+    const unsigned char *udp     = NULL;
+    struct cmsghdr      *cmsg    = (struct cmsghdr *)msg_hdr->msg_control;
+    uint16_t             type    = 0;
+    size_t               ip_len  = 0;
+    size_t               udp_len = 0;
+
+    if (len < VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN) {
+        return -1;
+    }
+    type = frame[12] << 8 | frame[13];
+
+    if (type == 0x0800) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)msg_hdr->msg_name;
+        struct in_pktinfo  *pi  = NULL;
+
+        /* IPv4, no options, UDP, not a fragment. */
+        ip_len = ip[2] << 8 | ip[3];
+        if (ip[0] != 0x45 || ip[9] != IPPROTO_UDP || ((ip[6] & 0x3f) | ip[7]) != 0 ||
+            ip_len < VL_XDP_IPV4_HLEN + VL_XDP_UDP_HLEN ||
+            VL_XDP_ETH_HLEN + ip_len > len ||
+            msg_hdr->msg_namelen < sizeof(struct sockaddr_in) ||
+            msg_hdr->msg_controllen < CMSG_SPACE(sizeof(struct in_pktinfo))) {
+            return -1;
+        }
+        udp     = ip + VL_XDP_IPV4_HLEN;
+        udp_len = udp[4] << 8 | udp[5];
+        if (udp_len < VL_XDP_UDP_HLEN || VL_XDP_IPV4_HLEN + udp_len > ip_len ||
+            (udp[2] << 8 | udp[3]) != port) {
+            return -1;
+        }
+
+        *sin = (struct sockaddr_in) { .sin_family = AF_INET };
+        memcpy(&sin->sin_port, udp, 2);
+        memcpy(&sin->sin_addr, ip + 12, 4);
+        msg_hdr->msg_namelen = sizeof(struct sockaddr_in);
+
+        cmsg->cmsg_level = IPPROTO_IP;
+        cmsg->cmsg_type  = IP_PKTINFO;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in_pktinfo));
+        pi = (struct in_pktinfo *)CMSG_DATA(cmsg);
+        *pi = (struct in_pktinfo) {};
+        memcpy(&pi->ipi_spec_dst, ip + 16, 4);
+        memcpy(&pi->ipi_addr, ip + 16, 4);
+        msg_hdr->msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+
+    } else if (type == 0x86dd) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)msg_hdr->msg_name;
+        struct in6_pktinfo  *pi6  = NULL;
+
+        /* IPv6, no extension headers. */
+        if (len < VL_XDP_ETH_HLEN + VL_XDP_IPV6_HLEN + VL_XDP_UDP_HLEN ||
+            (ip[0] >> 4) != 6 || ip[6] != IPPROTO_UDP ||
+            msg_hdr->msg_namelen < sizeof(struct sockaddr_in6) ||
+            msg_hdr->msg_controllen < CMSG_SPACE(sizeof(struct in6_pktinfo))) {
+            return -1;
+        }
+        ip_len = ip[4] << 8 | ip[5];
+        if (ip_len < VL_XDP_UDP_HLEN ||
+            VL_XDP_ETH_HLEN + VL_XDP_IPV6_HLEN + ip_len > len) {
+            return -1;
+        }
+        udp     = ip + VL_XDP_IPV6_HLEN;
+        udp_len = udp[4] << 8 | udp[5];
+        if (udp_len < VL_XDP_UDP_HLEN || udp_len > ip_len ||
+            (udp[2] << 8 | udp[3]) != port) {
+            return -1;
+        }
+
+        *sin6 = (struct sockaddr_in6) { .sin6_family = AF_INET6 };
+        memcpy(&sin6->sin6_port, udp, 2);
+        memcpy(&sin6->sin6_addr, ip + 8, 16);
+        msg_hdr->msg_namelen = sizeof(struct sockaddr_in6);
+
+        cmsg->cmsg_level = IPPROTO_IPV6;
+        cmsg->cmsg_type  = IPV6_PKTINFO;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in6_pktinfo));
+        pi6 = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+        *pi6 = (struct in6_pktinfo) {};
+        memcpy(&pi6->ipi6_addr, ip + 24, 16);
+        msg_hdr->msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+
+    } else {
+        return -1;
+    }
+
+    memcpy(macs, frame, VL_XDP_MACS_LEN);
+
+    udp_len -= VL_XDP_UDP_HLEN;
+    if (udp_len > payload_size) {
+        udp_len = payload_size;
+    }
+    memcpy(payload, udp + VL_XDP_UDP_HLEN, udp_len);
+
+    return udp_len;
+}
+
+/** Build Ethernet frame carrying UDP datagram of a write vector message.
+ * Destination is client address in msg_name, source is local address
+ * stored in msg_control packet info. Frame MAC addresses are those of
+ * request frame, swapped.
+ *
+ * @param frame      Frame buffer to build into.
+ * @param frame_size Size of frame buffer.
+ * @param port       UDP source port.
+ * @param msg_hdr    Message to send.
+ * @param macs       Request frame destination and source MAC addresses.
+ * @param payload    UDP payload.
+ * @param len        Length of UDP payload.
+ *
+ * @return           Returns length of frame, or -1 if frame does not fit
+ *                   frame buffer or message has no packet info.
+ */
+int
+vl_xdp_frame_build(unsigned char *frame, size_t frame_size, uint16_t port,
+                   const struct msghdr *msg_hdr, const unsigned char *macs,
+                   const unsigned char *payload, size_t len)
+{
+    struct msghdr  *mh       = (struct msghdr *)msg_hdr;
+    struct cmsghdr *cmsg     = NULL;
+    unsigned char  *ip       = frame + VL_XDP_ETH_HLEN;
+    unsigned char  *udp      = NULL;
+    size_t          udp_len  = VL_XDP_UDP_HLEN + len;
+    size_t          frame_len;
+    uint64_t        sum      = 0;
+    uint16_t        csum     = 0;
+    uint16_t        sport    = htons(port);
+
+    memcpy(frame, macs + 6, 6);
+    memcpy(frame + 6, macs, 6);
+
+    for (cmsg = CMSG_FIRSTHDR(mh); cmsg != NULL; cmsg = CMSG_NXTHDR(mh, cmsg)) {
+        if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) ||
+            (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO)) {
+            break;
+        }
+    }
+    if (cmsg == NULL) {
+        return -1;
+    }
+
+    if (cmsg->cmsg_level == IPPROTO_IP) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)msg_hdr->msg_name;
+        struct in_pktinfo  *pi  = (struct in_pktinfo *)CMSG_DATA(cmsg);
+
+        frame_len = VL_XDP_ETH_HLEN + VL_XDP_IPV4_HLEN + udp_len;
+        if (frame_len > frame_size) {
+            return -1;
+        }
+        frame[12] = 0x08;
+        frame[13] = 0x00;
+
+        ip[0] = 0x45;
+        ip[1] = 0;
+        ip[2] = (VL_XDP_IPV4_HLEN + udp_len) >> 8;
+        ip[3] = (VL_XDP_IPV4_HLEN + udp_len) & 0xff;
+        ip[4] = 0;
+        ip[5] = 0;
+        ip[6] = 0x40; /* Don't fragment. */
+        ip[7] = 0;
+        ip[8] = 64;
+        ip[9] = IPPROTO_UDP;
+        ip[10] = 0;
+        ip[11] = 0;
+        memcpy(ip + 12, &pi->ipi_spec_dst, 4);
+        memcpy(ip + 16, &sin->sin_addr, 4);
+        csum = vl_xdp_csum_fold(vl_xdp_csum_add(0, ip, VL_XDP_IPV4_HLEN));
+        ip[10] = csum >> 8;
+        ip[11] = csum & 0xff;
+
+        udp = ip + VL_XDP_IPV4_HLEN;
+        memcpy(udp + 2, &sin->sin_port, 2);
+        /* Pseudo header: addresses, protocol and UDP length. */
+        sum = vl_xdp_csum_add(0, ip + 12, 8);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)msg_hdr->msg_name;
+        struct in6_pktinfo  *pi6  = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+
+        frame_len = VL_XDP_ETH_HLEN + VL_XDP_IPV6_HLEN + udp_len;
+        if (frame_len > frame_size) {
+            return -1;
+        }
+        frame[12] = 0x86;
+        frame[13] = 0xdd;
+
+        ip[0] = 0x60;
+        ip[1] = 0;
+        ip[2] = 0;
+        ip[3] = 0;
+        ip[4] = udp_len >> 8;
+        ip[5] = udp_len & 0xff;
+        ip[6] = IPPROTO_UDP;
+        ip[7] = 64;
+        memcpy(ip + 8, &pi6->ipi6_addr, 16);
+        memcpy(ip + 24, &sin6->sin6_addr, 16);
+
+        udp = ip + VL_XDP_IPV6_HLEN;
+        memcpy(udp + 2, &sin6->sin6_port, 2);
+        /* Pseudo header: addresses, UDP length and next header. */
+        sum = vl_xdp_csum_add(0, ip + 8, 32);
+    }
+    sum += IPPROTO_UDP + udp_len;
+
+    memcpy(udp, &sport, 2);
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xff;
+    udp[6] = 0;
+    udp[7] = 0;
+    memcpy(udp + VL_XDP_UDP_HLEN, payload, len);
+
+    csum = vl_xdp_csum_fold(vl_xdp_csum_add(sum, udp, udp_len));
+    if (csum == 0) {
+        /* Checksum of 0 means no checksum, all ones is sent instead. */
+        csum = 0xffff;
+    }
+    udp[6] = csum >> 8;
+    udp[7] = csum & 0xff;
+
+    return frame_len;
+}
+
+/** Receive frames from AF_XDP socket receive ring into UDP connection read
+ * vector, see @ref vl_xdp_frame_parse. Frames are copied and handed back to
+ * kernel on fill ring right away.
+ *
+ * @param xdp      AF_XDP socket.
+ * @param conn_udp UDP connection to receive into, its vectors must be reset.
+ * @param vlen     Maximum number of datagrams to receive.
+ * @param port     DNS UDP port.
+ *
+ * @return         Returns number of datagrams received, which may be 0 if
+ *                 only frames that are not DNS datagrams were received. If
+ *                 receive ring is empty returns -1 and errno is set to
+ *                 EAGAIN.
+ */
+int
+vl_xdp_recv(vl_xdp_t *xdp, conn_udp_t *conn_udp, unsigned int vlen, uint16_t port)
+{
+    struct xdp_desc *rx_descs   = (struct xdp_desc *)xdp->rx.descs;
+    uint64_t        *fill_descs = (uint64_t *)xdp->fill.descs;
+    uint32_t         rx_cons    = *xdp->rx.consumer;
+    uint32_t         rx_prod    = __atomic_load_n(xdp->rx.producer, __ATOMIC_ACQUIRE);
+    uint32_t         fill_prod  = *xdp->fill.producer;
+    unsigned int     count      = 0;
+
+    if (rx_cons == rx_prod) {
+        /* Busy polling socket drives device driver on every kick. */
+        if (xdp->busy_poll ||
+            (__atomic_load_n(xdp->fill.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP)) {
+            recvfrom(xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if (vlen > conn_udp->vector_len) {
+        vlen = conn_udp->vector_len;
+    }
+    while (rx_cons != rx_prod && count < vlen) {
+        struct xdp_desc *desc  = &rx_descs[rx_cons & xdp->rx.mask];
+        query_t         *q     = &conn_udp->queries[count];
+        int              ret   = 0;
+
+        ret = vl_xdp_frame_parse(xdp->umem + desc->addr, desc->len, port,
+                                 &conn_udp->read_vector[count].msg_hdr,
+                                 q->request_buffer, q->request_buffer_size,
+                                 xdp->macs[count]);
+        if (ret >= 0) {
+            conn_udp->read_vector[count].msg_len = ret;
+            count++;
+        }
+
+        /* Frame was copied, hand it back to kernel. */
+        fill_descs[fill_prod & xdp->fill.mask] = desc->addr & ~((uint64_t)VL_XDP_FRAME_SIZE - 1);
+        fill_prod++;
+        rx_cons++;
+    }
+    __atomic_store_n(xdp->rx.consumer, rx_cons, __ATOMIC_RELEASE);
+    __atomic_store_n(xdp->fill.producer, fill_prod, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(xdp->fill.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP) {
+        recvfrom(xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+
+    return count;
+}
+
+/** Send UDP connection write vector messages, starting with
+ * write_vector_write_index, via AF_XDP socket transmit ring, see
+ * @ref vl_xdp_frame_build. Each iov entry of a message (more than one for a
+ * UDP GSO message) is sent as its own datagram. Frames kernel is done
+ * sending are reclaimed from completion ring first.
+ *
+ * @param xdp      AF_XDP socket.
+ * @param conn_udp UDP connection with prepared write vector.
+ * @param port     DNS UDP port, responses are sent from.
+ *
+ * @return         Returns number of messages put on transmit ring, which is
+ *                 less than write_vector_count if ring or UMEM frames ran
+ *                 out.
+ */
+int
+vl_xdp_send(vl_xdp_t *xdp, conn_udp_t *conn_udp, uint16_t port)
+{
+    uint64_t        *comp_descs = (uint64_t *)xdp->comp.descs;
+    struct xdp_desc *tx_descs   = (struct xdp_desc *)xdp->tx.descs;
+    uint32_t         comp_cons  = *xdp->comp.consumer;
+    uint32_t         comp_prod  = __atomic_load_n(xdp->comp.producer, __ATOMIC_ACQUIRE);
+    uint32_t         tx_prod    = *xdp->tx.producer;
+    uint32_t         tx_space   = 0;
+    unsigned int     first      = conn_udp->write_vector_write_index;
+    int              sent       = 0;
+
+    /* Reclaim frames kernel is done sending. */
+    while (comp_cons != comp_prod) {
+        xdp->tx_free[xdp->tx_free_count++] = comp_descs[comp_cons & xdp->comp.mask];
+        comp_cons++;
+    }
+    __atomic_store_n(xdp->comp.consumer, comp_cons, __ATOMIC_RELEASE);
+
+    tx_space = VL_XDP_RING_SIZE -
+               (tx_prod - __atomic_load_n(xdp->tx.consumer, __ATOMIC_ACQUIRE));
+
+    for (unsigned int k = first; k < first + conn_udp->write_vector_count; k++) {
+        struct msghdr *msg_hdr = &conn_udp->write_vector[k].msg_hdr;
+        uint16_t      *index   = &conn_udp->query_index[conn_udp->write_query_start[k]];
+
+        if (msg_hdr->msg_iovlen > tx_space || msg_hdr->msg_iovlen > xdp->tx_free_count) {
+            break;
+        }
+        for (size_t s = 0; s < msg_hdr->msg_iovlen; s++) {
+            uint64_t addr = xdp->tx_free[xdp->tx_free_count - 1];
+            int      len  = vl_xdp_frame_build(xdp->umem + addr, VL_XDP_FRAME_SIZE, port,
+                                               msg_hdr, xdp->macs[index[s]],
+                                               msg_hdr->msg_iov[s].iov_base,
+                                               msg_hdr->msg_iov[s].iov_len);
+            if (len < 0) {
+                /* Response can not be sent, frame stays free. */
+                continue;
+            }
+            xdp->tx_free_count--;
+            tx_descs[tx_prod & xdp->tx.mask] = (struct xdp_desc) {
+                .addr = addr,
+                .len  = len,
+            };
+            tx_prod++;
+            tx_space--;
+        }
+        sent++;
+    }
+    __atomic_store_n(xdp->tx.producer, tx_prod, __ATOMIC_RELEASE);
+
+    if (sent > 0 &&
+        (xdp->busy_poll ||
+         (__atomic_load_n(xdp->tx.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP))) {
+        /* Kick kernel to transmit, errors other than socket being closed are
+         * transient (ring busy) and frames are sent on next kick.
+         */
+        sendto(xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+    }
+
+    return sent;
+}
+
+/** @}*/
@@ -0,0 +1,361 @@
+/**
+ * @file views.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup views
+ *  @{
+ */
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "constants.h"
+#include "utils.h"
+#include "views.h"
+
+/** Maximum length of a single line in view file, long enough for a view
+ * directive with a zone file path of @ref FILE_REALPATH_MAX.
+ */
+#define VIEWS_FILE_LINE_MAX (FILE_REALPATH_MAX + 2 * RIP_NS_MAXLABEL)
+
+/** Number of tokens (fields) on a view file directive line. */
+#define VIEWS_FILE_TOKENS 3
+
+/** Convert view label to lower cased wire format, length byte followed by
+ * label.
+ *
+ * @param label View label.
+ * @param wire  Where to store wire format label.
+ *
+ * @return      Returns 0 on success, or -1 if label is not a valid view label.
+ */
+static int
+views_label_wire(const char *label, unsigned char *wire)
+{
+    size_t len = strlen(label);
+
+    if (len == 0 || len > RIP_NS_MAXLABEL) {
+        return -1;
+    }
+    wire[0] = len;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)label[i]) && label[i] != '-' && label[i] != '_') {
+            return -1;
+        }
+        wire[i + 1] = tolower((unsigned char)label[i]);
+    }
+    return 0;
+}
+
+/** Find view by its wire format label.
+ *
+ * @param views View set.
+ * @param wire  Wire format, lower cased, view label.
+ *
+ * @return      Returns view number (index + 1), or 0 if view is not declared.
+ */
+static uint16_t
+views_find(views_t *views, const unsigned char *wire)
+{
+    for (uint16_t i = 0; i < views->count; i++) {
+        if (memcmp(views->labels[i], wire, wire[0] + 1) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/** Build table of view numbers of views of an address table, address table
+ * numbers its views in order they first appear in it.
+ *
+ * @param views View set.
+ * @param map   Address table.
+ *
+ * @return      Returns table of view numbers indexed by address table view
+ *              number - 1.
+ */
+static uint16_t *
+views_table_views(views_t *views, ecs_map_t *map)
+{
+    uint16_t *table = malloc(sizeof(uint16_t) * (map->views_count + 1));
+
+    CHECK_MALLOC(table);
+    for (uint16_t i = 0; i < map->views_count; i++) {
+        table[i] = views_find(views, map->views[i]);
+    }
+    return table;
+}
+
+/** Parse a single view file line. View directive loads zone database of
+ * view, address directives are appended to address table text of their
+ * direction, in ECS map file format. A line is appended to text of each table
+ * for every view file line, so errors ECS map reports carry view file line
+ * numbers.
+ *
+ * @param views      View set views are added to.
+ * @param line       Line to parse, line is modified.
+ * @param line_no    Line number, used in error message.
+ * @param zone_load  Function loading zone database of a view.
+ * @param texts      Address table texts, destination followed by source.
+ * @param lens       Length of address table texts.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns 0 on success, otherwise -1.
+ */
+static int
+views_parse_line(views_t *views, char *line, uint32_t line_no, views_zone_load_fn zone_load,
+                 char **texts, size_t *lens, char *err, size_t err_len)
+{
+    char          *tokens[VIEWS_FILE_TOKENS + 1];
+    char          *save    = NULL;
+    char          *comment;
+    int            count   = 0;
+    int            table   = -1;
+    unsigned char  wire[RIP_NS_MAXLABEL + 1];
+    char           err_str[err_len];
+    zone_db_t     *db;
+
+    if ((comment = strchr(line, ';')) != NULL) {
+        *comment = '\0';
+    }
+    for (char *t = strtok_r(line, " \t\r", &save); t != NULL; t = strtok_r(NULL, " \t\r", &save)) {
+        if (count == VIEWS_FILE_TOKENS) {
+            count++;
+            break;
+        }
+        tokens[count++] = t;
+    }
+    if (count != 0 && count != VIEWS_FILE_TOKENS) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+
+    if (count == 0) {
+        /* Empty line. */
+    } else if (strcasecmp(tokens[0], "view") == 0) {
+        if (views_label_wire(tokens[1], wire) != 0) {
+            snprintf(err, err_len, "line %u: invalid view \"%s\"", line_no, tokens[1]);
+            return -1;
+        }
+        if (views_find(views, wire) != 0) {
+            snprintf(err, err_len, "line %u: duplicate view \"%s\"", line_no, tokens[1]);
+            return -1;
+        }
+        if (views->count == VIEWS_MAX) {
+            snprintf(err, err_len, "line %u: too many views", line_no);
+            return -1;
+        }
+        err_str[0] = '\0';
+        db = zone_load(tokens[2], views->generation << 32 | (views->count + 1),
+                       err_str, err_len);
+        if (db == NULL) {
+            snprintf(err, err_len, "line %u: view \"%s\" zone file \"%s\" error: %s",
+                     line_no, tokens[1], tokens[2], err_str);
+            return -1;
+        }
+        memcpy(views->labels[views->count], wire, wire[0] + 1);
+        views->zone_dbs[views->count] = db;
+        views->count += 1;
+    } else if (strcasecmp(tokens[0], "dst") == 0 || strcasecmp(tokens[0], "src") == 0) {
+        if (views_label_wire(tokens[2], wire) != 0 || views_find(views, wire) == 0) {
+            snprintf(err, err_len, "line %u: unknown view \"%s\"", line_no, tokens[2]);
+            return -1;
+        }
+        table = strcasecmp(tokens[0], "dst") == 0 ? 0 : 1;
+        lens[table] += sprintf(texts[table] + lens[table], "%s %s", tokens[1], tokens[2]);
+    } else {
+        snprintf(err, err_len, "line %u: unknown directive \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+
+    texts[0][lens[0]++] = '\n';
+    texts[1][lens[1]++] = '\n';
+    return 0;
+}
+
+/** Create view set from view file contents, loading zone database of each
+ * view. Zone database of a view is assigned generation number made of view
+ * set generation in upper 32 bits and view number in lower ones, so it never
+ * equals generation of main zone database or of another view.
+ *
+ * @param buf        View file contents.
+ * @param buf_len    Length of buf.
+ * @param generation Generation number to assign to view set.
+ * @param zone_load  Function loading zone database of a view.
+ * @param err        Where to store error message if view set can not be
+ *                   created.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to view set on success, otherwise NULL is
+ *                   returned and err is populated.
+ */
+views_t *
+views_create(const char *buf, size_t buf_len, uint64_t generation,
+             views_zone_load_fn zone_load, char *err, size_t err_len)
+{
+    views_t    *views    = NULL;
+    char       *texts[2] = {};
+    size_t      lens[2]  = {};
+    char       *line     = NULL;
+    const char *p        = buf;
+    const char *end      = buf + buf_len;
+    uint32_t    line_no  = 0;
+
+    views = calloc(1, sizeof(views_t));
+    CHECK_MALLOC(views);
+    views->generation = generation;
+    views->labels = malloc(sizeof(*views->labels) * VIEWS_MAX);
+    CHECK_MALLOC(views->labels);
+    views->zone_dbs = calloc(VIEWS_MAX, sizeof(zone_db_t *));
+    CHECK_MALLOC(views->zone_dbs);
+
+    /* Every line appends at most its own length and a new line to address
+     * table texts.
+     */
+    line = malloc(VIEWS_FILE_LINE_MAX);
+    CHECK_MALLOC(line);
+    for (int i = 0; i < 2; i++) {
+        texts[i] = malloc(buf_len + 2);
+        CHECK_MALLOC(texts[i]);
+    }
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        line_no += 1;
+        if (len >= VIEWS_FILE_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", line_no);
+            goto ERR_END;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (views_parse_line(views, line, line_no, zone_load, texts, lens,
+                             err, err_len) != 0) {
+            goto ERR_END;
+        }
+        p += len + 1;
+    }
+    texts[0][lens[0]] = '\0';
+    texts[1][lens[1]] = '\0';
+
+    /* Compile address tables, only tables with prefixes are looked up. */
+    for (int i = 0; i < 2; i++) {
+        ecs_map_t **map = i == 0 ? &views->dst : &views->src;
+
+        if (strspn(texts[i], "\n") == lens[i]) {
+            continue;
+        }
+        if ((*map = ecs_map_create(texts[i], lens[i], generation, err, err_len)) == NULL) {
+            goto ERR_END;
+        }
+        if (i == 0) {
+            views->dst_views = views_table_views(views, *map);
+        } else {
+            views->src_views = views_table_views(views, *map);
+        }
+    }
+    free(line);
+    free(texts[0]);
+    free(texts[1]);
+    return views;
+
+ERR_END:
+    free(line);
+    free(texts[0]);
+    free(texts[1]);
+    views_release(views);
+    return NULL;
+}
+
+/** Release view set and zone databases of its views.
+ *
+ * @param views View set to release.
+ */
+void
+views_release(views_t *views)
+{
+    if (views == NULL) {
+        return;
+    }
+    for (uint16_t i = 0; i < views->count; i++) {
+        zone_db_release(views->zone_dbs[i]);
+    }
+    ecs_map_release(views->dst);
+    ecs_map_release(views->src);
+    free(views->dst_views);
+    free(views->src_views);
+    free(views->zone_dbs);
+    free(views->labels);
+    free(views);
+}
+
+/** Lookup view of an address in an address table.
+ *
+ * @param map       Address table.
+ * @param map_views View numbers of address table views.
+ * @param ip        Address to lookup, IPv4 mapped IPv6 addresses are looked
+ *                  up as IPv4.
+ *
+ * @return          Returns view number, or 0 if address does not map to a
+ *                  view.
+ */
+static inline uint16_t
+views_lookup(ecs_map_t *map, const uint16_t *map_views, const struct sockaddr_storage *ip)
+{
+    uint16_t view = ecs_map_lookup_sockaddr(map, ip);
+
+    return view != 0 ? map_views[view - 1] : 0;
+}
+
+/** Select view of a query. Destination address is looked up first, source
+ * address only if destination address did not select a view. Address tables
+ * with no prefixes are not looked up.
+ *
+ * @param views     View set.
+ * @param local_ip  Query destination address.
+ * @param client_ip Query source address.
+ *
+ * @return          Returns view number, index of view in view set plus 1, or
+ *                  0 if query is answered from main zone database.
+ */
+uint16_t
+views_select(views_t *views, const struct sockaddr_storage *local_ip,
+             const struct sockaddr_storage *client_ip)
+{
+    uint16_t view = 0;
+
+    if (views->dst != NULL) {
+        view = views_lookup(views->dst, views->dst_views, local_ip);
+    }
+    if (view == 0 && views->src != NULL) {
+        view = views_lookup(views->src, views->src_views, client_ip);
+    }
+    return view;
+}
+
+/** @}*/
@@ -0,0 +1,226 @@
+/**
+ * @file worker.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup worker
+ *  @{
+ */
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+
+#include "constants.h"
+#include "utils.h"
+#include "worker.h"
+
+/** Worker thread function. Runs all jobs queued by vectorloop since it last
+ * woke up as one batch, then queues them back and wakes vectorloop up once
+ * for the whole batch.
+ *
+ * @param arg Worker thread object, @ref worker_t.
+ *
+ * @return    NULL pointer returned upon termination.
+ */
+static void *
+worker_run(void *arg)
+{
+    worker_t     *w     = (worker_t *)arg;
+    worker_job_t *batch[WORKER_QUEUE_LEN];
+    worker_job_t *job   = NULL;
+    eventfd_t     val   = 0;
+    size_t        count = 0;
+
+    LFDS711_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+
+    while (1) {
+        count = 0;
+        while (count < WORKER_QUEUE_LEN &&
+               lfds711_queue_bss_dequeue(&w->req_qbsss, NULL, (void **)&job) != 0) {
+            batch[count++] = job;
+        }
+        if (count == 0) {
+            /* Block until vectorloop queues more requests. */
+            eventfd_read(w->req_fd, &val);
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            batch[i]->run(batch[i]);
+        }
+        /* Result queue has room, vectorloop limits jobs in flight. */
+        for (size_t i = 0; i < count; i++) {
+            lfds711_queue_bss_enqueue(&w->res_qbsss, NULL, batch[i]);
+        }
+        eventfd_write(w->wake_fd, 1);
+    }
+
+    return NULL;
+}
+
+/** Start worker threads of a vectorloop.
+ *
+ * @param pool    Worker thread pool to start.
+ * @param count   Number of worker threads.
+ * @param wake_fd Eventfd of vectorloop, written to when a batch of jobs is
+ *                run.
+ */
+void
+worker_pool_start(worker_pool_t *pool, size_t count, int wake_fd)
+{
+    /* Size passed to aligned_alloc() MUST be a multiple of alignment. */
+    size_t size = (sizeof(worker_t) * count + CACHE_LINE_SIZE - 1) &
+                  ~((size_t)CACHE_LINE_SIZE - 1);
+
+    *pool = (worker_pool_t) {
+        .count = count,
+    };
+    pool->workers = aligned_alloc(CACHE_LINE_SIZE, size);
+    CHECK_MALLOC(pool->workers);
+
+    for (size_t i = 0; i < count; i++) {
+        worker_t *w = &pool->workers[i];
+
+        *w = (worker_t) {
+            .wake_fd = wake_fd,
+        };
+        lfds711_queue_bss_init_valid_on_current_logical_core(&w->req_qbsss,
+            w->req_qbsse, WORKER_QUEUE_LEN, NULL);
+        lfds711_queue_bss_init_valid_on_current_logical_core(&w->res_qbsss,
+            w->res_qbsse, WORKER_QUEUE_LEN, NULL);
+
+        w->req_fd = eventfd(0, EFD_CLOEXEC);
+        if (w->req_fd < 0) {
+            fprintf(stderr, "worker_pool_start() err no %d, error message: %s\n",
+                    errno, strerror(errno));
+            assert(0);
+        }
+        if (pthread_create(&w->thread, NULL, worker_run, w) != 0) {
+            fprintf(stderr, "Could not create worker thread\n");
+            exit(-1);
+        }
+    }
+}
+
+/** Hand job to least busy worker thread. Only vectorloop owning the pool may
+ * call this, and it MUST not touch object job is embedded into until job is
+ * returned by @ref worker_pool_done().
+ *
+ * @param pool Worker thread pool.
+ * @param job  Job to run.
+ *
+ * @return     Returns true if job was queued, false if queues of all worker
+ *             threads are full.
+ */
+bool
+worker_pool_submit(worker_pool_t *pool, worker_job_t *job)
+{
+    worker_t *w = &pool->workers[0];
+
+    for (size_t i = 1; i < pool->count; i++) {
+        if (pool->workers[i].in_flight < w->in_flight) {
+            w = &pool->workers[i];
+        }
+    }
+    if (w->in_flight >= WORKER_QUEUE_LEN - 1 ||
+        lfds711_queue_bss_enqueue(&w->req_qbsss, NULL, job) == 0) {
+        return false;
+    }
+    w->in_flight++;
+    pool->in_flight++;
+    eventfd_write(w->req_fd, 1);
+
+    return true;
+}
+
+/** Get a job worker threads are done with.
+ *
+ * @param pool Worker thread pool.
+ *
+ * @return     Returns job, NULL if there are none.
+ */
+worker_job_t *
+worker_pool_done(worker_pool_t *pool)
+{
+    worker_job_t *job = NULL;
+
+    if (pool->in_flight == 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        worker_t *w = &pool->workers[i];
+
+        if (w->in_flight > 0 &&
+            lfds711_queue_bss_dequeue(&w->res_qbsss, NULL, (void **)&job) != 0) {
+            w->in_flight--;
+            pool->in_flight--;
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+/** Run jobs on worker threads and calling thread, and wait until all of them
+ * are run. Calling thread runs first job, and any job that does not fit into
+ * worker thread queues. Only thread owning the pool, and free to block, may
+ * call this, its jobs MUST be the only ones in flight.
+ *
+ * @param pool  Worker thread pool, NULL or pool of no threads to run all jobs
+ *              on calling thread.
+ * @param jobs  Jobs to run.
+ * @param count Number of jobs.
+ */
+void
+worker_pool_run(worker_pool_t *pool, worker_job_t **jobs, size_t count)
+{
+    struct pollfd pfd;
+    eventfd_t     val = 0;
+
+    for (size_t i = 1; i < count; i++) {
+        if (pool == NULL || pool->count == 0 || !worker_pool_submit(pool, jobs[i])) {
+            jobs[i]->run(jobs[i]);
+        }
+    }
+    if (count > 0) {
+        jobs[0]->run(jobs[0]);
+    }
+    if (pool == NULL || pool->count == 0) {
+        return;
+    }
+
+    /* Results are queued before wake eventfd is written, so none are missed
+     * between collecting them and blocking.
+     */
+    pfd = (struct pollfd) { .fd = pool->workers[0].wake_fd, .events = POLLIN };
+    while (pool->in_flight > 0) {
+        if (worker_pool_done(pool) == NULL) {
+            poll(&pfd, 1, -1);
+            eventfd_read(pfd.fd, &val);
+        }
+    }
+}
+
+/** @}*/
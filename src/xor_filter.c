@@ -0,0 +1,202 @@
+/**
+ * @file xor_filter.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup xor_filter
+ *  @{
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "xor_filter.h"
+
+/** Get number of fingerprints in each block of a filter.
+ *
+ * @param count Number of keys in filter set.
+ *
+ * @return      Returns block length.
+ */
+static uint32_t
+xor_filter_block_len(uint32_t count)
+{
+    return (32 + ((uint64_t)count * 123 + 99) / 100) / 3;
+}
+
+/** Get size of fingerprints array filter of a set of keys needs.
+ *
+ * @param count Number of keys in filter set.
+ *
+ * @return      Returns size of fingerprints array, in bytes.
+ */
+size_t
+xor_filter_size(uint32_t count)
+{
+    return 3 * (size_t)xor_filter_block_len(count);
+}
+
+/** Compare 64 bit keys, qsort() comparator.
+ *
+ * @param a First key.
+ * @param b Second key.
+ *
+ * @return  Returns -1, 0 or 1 if first key is lower, equal or higher.
+ */
+static int
+xor_filter_key_cmp(const void *a, const void *b)
+{
+    uint64_t ka = *(const uint64_t *)a;
+    uint64_t kb = *(const uint64_t *)b;
+
+    return (ka > kb) - (ka < kb);
+}
+
+/** Build xor filter of a set of keys.
+ *
+ * Keys are hashed into three slots each, and slots that only a single key
+ * hashes to are peeled off one by one, along with their key. If every key is
+ * peeled, fingerprints are assigned in reverse peeling order so that xor of a
+ * key's three slots is key fingerprint. Otherwise build is retried with
+ * another seed.
+ *
+ * @param f            Filter to build.
+ * @param fingerprints Fingerprints array, of @ref xor_filter_size bytes.
+ * @param keys         Keys of filter set, sorted and deduplicated in place.
+ * @param count        Number of keys.
+ *
+ * @return             Returns 0 on success, or -1 if build failed with
+ *                     @ref XOR_FILTER_SEEDS_MAX seeds.
+ */
+int
+xor_filter_build(xor_filter_t *f, uint8_t *fingerprints, uint64_t *keys, uint32_t count)
+{
+    uint32_t  block_len = xor_filter_block_len(count);
+    size_t    size      = 3 * (size_t)block_len;
+    uint64_t *masks     = malloc(sizeof(uint64_t) * size);
+    uint32_t *counts    = malloc(sizeof(uint32_t) * size);
+    uint32_t *queue     = malloc(sizeof(uint32_t) * (size + 3 * (size_t)count));
+    uint64_t *peeled    = malloc(sizeof(uint64_t) * (count + 1));
+    uint32_t *slots     = malloc(sizeof(uint32_t) * (count + 1));
+    uint64_t  state     = 0x9e3779b97f4a7c15ULL;
+    uint32_t  n         = 0;
+    uint32_t  peeled_n  = 0;
+    int       ret       = -1;
+
+    CHECK_MALLOC(masks);
+    CHECK_MALLOC(counts);
+    CHECK_MALLOC(queue);
+    CHECK_MALLOC(peeled);
+    CHECK_MALLOC(slots);
+
+    /* Duplicate key would never peel. */
+    if (count > 0) {
+        qsort(keys, count, sizeof(uint64_t), xor_filter_key_cmp);
+        n = 1;
+        for (uint32_t i = 1; i < count; i++) {
+            if (keys[i] != keys[n - 1]) {
+                keys[n++] = keys[i];
+            }
+        }
+    }
+
+    *f = (xor_filter_t) {
+        .block_len    = block_len,
+        .fingerprints = fingerprints,
+    };
+    for (int attempt = 0; attempt < XOR_FILTER_SEEDS_MAX; attempt++) {
+        size_t queue_len = 0;
+
+        /* Next seed, splitmix64. */
+        state += 0x9e3779b97f4a7c15ULL;
+        f->seed = xor_filter_mix(state, 0);
+
+        memset(masks, 0, sizeof(uint64_t) * size);
+        memset(counts, 0, sizeof(uint32_t) * size);
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t h = xor_filter_mix(keys[i], f->seed);
+
+            for (int b = 0; b < 3; b++) {
+                uint32_t s = xor_filter_slot(f, h, b);
+
+                masks[s] ^= h;
+                counts[s] += 1;
+            }
+        }
+
+        /* Peel slots with a single key. */
+        for (uint32_t s = 0; s < size; s++) {
+            if (counts[s] == 1) {
+                queue[queue_len++] = s;
+            }
+        }
+        peeled_n = 0;
+        while (queue_len > 0) {
+            uint32_t s = queue[--queue_len];
+            uint64_t h = masks[s];
+
+            if (counts[s] != 1) {
+                continue;
+            }
+            peeled[peeled_n] = h;
+            slots[peeled_n]  = s;
+            peeled_n += 1;
+            for (int b = 0; b < 3; b++) {
+                uint32_t t = xor_filter_slot(f, h, b);
+
+                masks[t] ^= h;
+                counts[t] -= 1;
+                if (counts[t] == 1) {
+                    queue[queue_len++] = t;
+                }
+            }
+        }
+        if (peeled_n == n) {
+            ret = 0;
+            break;
+        }
+    }
+
+    if (ret == 0) {
+        memset(fingerprints, 0, size);
+        for (uint32_t i = peeled_n; i > 0; i--) {
+            uint64_t h  = peeled[i - 1];
+            uint8_t  fp = (uint8_t)(h ^ (h >> 32));
+
+            /* Slot being assigned is still 0. */
+            for (int b = 0; b < 3; b++) {
+                fp ^= fingerprints[xor_filter_slot(f, h, b)];
+            }
+            fingerprints[slots[i - 1]] = fp;
+        }
+    }
+
+    free(masks);
+    free(counts);
+    free(queue);
+    free(peeled);
+    free(slots);
+    return ret;
+}
+
+/** @}*/
@@ -0,0 +1,3538 @@
+/**
+ * @file zone.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "worker.h"
+#include "zone.h"
+
+/** Maximum length of a single line in zone file. */
+#define ZONE_FILE_LINE_MAX 4096
+
+/** Maximum number of tokens (fields) on a single zone file line. */
+#define ZONE_FILE_TOKENS_MAX 64
+
+/** Minimum size of zone database hash table. */
+#define ZONE_DB_TABLE_SIZE_MIN 16
+
+/** Maximum length of precompiled RRset response fragment. Room is left for
+ * header, question and EDNS.
+ */
+#define ZONE_RRSET_WIRE_MAX (RIP_NS_MAXMSG - RIP_NS_PACKETSZ)
+
+/** Structure describes a resource record parsed from zone file, before zone
+ * database is built. All data is referenced by offsets since build buffers
+ * are reallocated as they grow.
+ */
+typedef struct zone_build_rr_s {
+    /** Offset of owner wire format (lower cased) name in names buffer. */
+    uint32_t name_offset;
+
+    /** Length of owner wire format name. */
+    uint16_t name_len;
+
+    /** Offset of owner presentation format name in texts buffer. */
+    uint32_t text_offset;
+
+    /** Length of owner presentation format name. */
+    uint16_t text_len;
+
+    /** Resource record type. */
+    uint16_t type;
+
+    /** Resource record class. */
+    uint16_t class;
+
+    /** Resource record TTL. */
+    uint32_t ttl;
+
+    /** Offset of rdata in rdata buffer. */
+    uint32_t rdata_offset;
+
+    /** Length of rdata. */
+    uint16_t rdata_len;
+
+    /** Line number record was found on, used to keep file order of records
+     * within an RRset.
+     */
+    uint32_t line;
+
+    /** Record is a zone delta deletion line, type rip_ns_t_any deletes all
+     * RRsets of owner name.
+     */
+    bool del;
+} zone_build_rr_t;
+
+/** Structure holds state used while building zone database. */
+typedef struct zone_build_s {
+    /** Parsed resource records. */
+    zone_build_rr_t *rrs;
+    size_t           rrs_len;
+    size_t           rrs_size;
+
+    /** Wire format owner names buffer. */
+    unsigned char   *names;
+    size_t           names_len;
+    size_t           names_size;
+
+    /** Presentation format owner names buffer. */
+    unsigned char   *texts;
+    size_t           texts_len;
+    size_t           texts_size;
+
+    /** Rdata buffer. */
+    uint8_t         *rdata;
+    size_t           rdata_len;
+    size_t           rdata_size;
+
+    /** Record synthesis rules. */
+    zone_synth_t    *synths;
+    size_t           synths_len;
+    size_t           synths_size;
+} zone_build_t;
+
+/** Zone file mnemonic to resource record type mapping. */
+static const struct {
+    const char *mnemonic;
+    uint16_t    type;
+} zone_types[] = {
+    {"A",     rip_ns_t_a},
+    {"AAAA",  rip_ns_t_aaaa},
+    {"NS",    rip_ns_t_ns},
+    {"CNAME", rip_ns_t_cname},
+    {"PTR",   rip_ns_t_ptr},
+    {"MX",    rip_ns_t_mx},
+    {"TXT",   rip_ns_t_txt},
+    {"SRV",   rip_ns_t_srv},
+    {"SOA",   rip_ns_t_soa},
+    {"DS",     rip_ns_t_ds},
+    {"DNSKEY", rip_ns_t_dnskey},
+    {"RRSIG",  rip_ns_t_rrsig},
+    {"NSEC",       rip_ns_t_nsec},
+    {"NSEC3",      rip_ns_t_nsec3},
+    {"NSEC3PARAM", rip_ns_t_nsec3param},
+};
+
+/** Hash a wire format domain name. Name is expected to already be lower
+ * cased.
+ *
+ * Hash is lower 32 bits of @ref rip_ns_name_hash, so hash query parse
+ * computed for question name can be used for lookup.
+ *
+ * @param name     Wire format name to hash.
+ * @param name_len Length of name.
+ *
+ * @return         Returns name hash.
+ */
+uint32_t
+zone_name_hash(const unsigned char *name, uint16_t name_len)
+{
+    return (uint32_t)rip_ns_name_hash(name, name_len);
+}
+
+/** Get length of an uncompressed wire format domain name.
+ *
+ * @param name Wire format name.
+ *
+ * @return     Returns length of name, including terminating root label.
+ */
+static uint16_t
+zone_name_wire_len(const unsigned char *name)
+{
+    const unsigned char *p = name;
+
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    return (p - name) + 1;
+}
+
+/** Lower case wire format domain name in place.
+ *
+ * @note Label length octets are at most 63 so they never fall in 'A'-'Z'
+ *       range, which allows for the whole name to be lower cased in one pass.
+ *
+ * @param name     Wire format name.
+ * @param name_len Length of name.
+ */
+static void
+zone_name_tolower(unsigned char *name, uint16_t name_len)
+{
+    for (uint16_t i = 0; i < name_len; i++) {
+        name[i] = tolower(name[i]);
+    }
+}
+
+/** Append data to a build buffer growing it as needed.
+ *
+ * @param buf      Pointer to buffer.
+ * @param buf_len  Pointer to length of data in buffer.
+ * @param buf_size Pointer to size of buffer.
+ * @param data     Data to append.
+ * @param len      Length of data to append.
+ *
+ * @return         Returns offset in buffer where data was appended at.
+ */
+static uint32_t
+zone_build_append(void **buf, size_t *buf_len, size_t *buf_size,
+                  const void *data, size_t len)
+{
+    uint32_t offset = *buf_len;
+
+    if (*buf_len + len > *buf_size) {
+        size_t size = *buf_size == 0 ? 0x10000 : *buf_size;
+        while (*buf_len + len > size) {
+            size *= 2;
+        }
+        *buf = realloc(*buf, size);
+        CHECK_MALLOC(*buf);
+        *buf_size = size;
+    }
+    memcpy((uint8_t *)*buf + *buf_len, data, len);
+    *buf_len += len;
+    return offset;
+}
+
+/** Release zone build state.
+ *
+ * @param zb Zone build object to release memory for.
+ */
+static void
+zone_build_clean(zone_build_t *zb)
+{
+    free(zb->rrs);
+    free(zb->names);
+    free(zb->texts);
+    free(zb->rdata);
+    free(zb->synths);
+    *zb = (zone_build_t) {};
+}
+
+/** Split zone file line into tokens. Tokens are separated by white space.
+ * Quoted strings are a single token and can contain white space, escaped
+ * characters \\" and \\\\ are supported within quoted strings. Text after ';'
+ * (outside of quoted string) is a comment and is ignored.
+ *
+ * @param line   Line to tokenize, line is modified.
+ * @param tokens Array where to store pointers to tokens.
+ * @param max    Size of tokens array.
+ *
+ * @return       Returns number of tokens found, or -1 on error.
+ */
+static int
+zone_line_tokenize(char *line, char **tokens, int max)
+{
+    int   count = 0;
+    char *p     = line;
+
+    while (*p != '\0') {
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0' || *p == ';') {
+            break;
+        }
+        if (count == max) {
+            return -1;
+        }
+        if (*p == '"') {
+            char *dst = ++p;
+            tokens[count] = dst;
+            while (*p != '"') {
+                if (*p == '\0') {
+                    /* Unterminated quoted string. */
+                    return -1;
+                }
+                if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) {
+                    p++;
+                }
+                *dst++ = *p++;
+            }
+            p++;
+            *dst = '\0';
+        } else {
+            tokens[count] = p;
+            while (*p != '\0' && !isspace((unsigned char)*p) && *p != ';') {
+                p++;
+            }
+            if (*p == ';') {
+                *p = '\0';
+                count++;
+                break;
+            }
+            if (*p != '\0') {
+                *p++ = '\0';
+            }
+        }
+        count++;
+    }
+    return count;
+}
+
+/** Parse presentation format domain name into wire format.
+ *
+ * @param str Presentation format domain name.
+ * @param dst Buffer where to store wire format name, MUST be at least
+ *            RIP_NS_MAXCDNAME + 1 bytes.
+ *
+ * @return    Returns length of wire format name, or -1 on error.
+ */
+static int
+zone_parse_name(const char *str, unsigned char *dst)
+{
+    if (rip_ns_name_pton((const unsigned char *)str, dst, RIP_NS_MAXCDNAME + 1) < 0) {
+        return -1;
+    }
+    return zone_name_wire_len(dst);
+}
+
+/** Parse unsigned number within bounds.
+ *
+ * @param str Number as string.
+ * @param max Maximum allowed value.
+ * @param num Where to store parsed number.
+ *
+ * @return    Returns 0 on success, otherwise -1.
+ */
+static int
+zone_parse_number(const char *str, uint32_t max, uint32_t *num)
+{
+    unsigned long tmp = 0;
+
+    if (str_to_unsigned_long(&tmp, (char *)str) != 0 || tmp > max) {
+        return -1;
+    }
+    *num = tmp;
+    return 0;
+}
+
+/** Parse resource record type mnemonic.
+ *
+ * @param str  Type mnemonic, case insensitive.
+ * @param type Where to store type.
+ *
+ * @return     Returns 0 on success, -1 if type is not supported.
+ */
+static int
+zone_parse_type(const char *str, uint16_t *type)
+{
+    for (size_t i = 0; i < ARRAY_COUNT(zone_types); i++) {
+        if (strcasecmp(str, zone_types[i].mnemonic) == 0) {
+            *type = zone_types[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/** Check whether resource record type is one zone database holds.
+ *
+ * @param type Resource record type.
+ *
+ * @return     Returns true if type is supported.
+ */
+bool
+zone_type_supported(uint16_t type)
+{
+    for (size_t i = 0; i < ARRAY_COUNT(zone_types); i++) {
+        if (zone_types[i].type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Parse RRSIG signature expiration or inception time, either as
+ * YYYYMMDDHHmmSS in UTC or as number of seconds since epoch (RFC 4034,
+ * section 3.2).
+ *
+ * @param str  Time as string.
+ * @param time Where to store time.
+ *
+ * @return     Returns 0 on success, otherwise -1.
+ */
+static int
+zone_parse_time(const char *str, uint32_t *time)
+{
+    struct tm tm  = {};
+    char     *end = NULL;
+
+    if (strlen(str) != 14) {
+        return zone_parse_number(str, UINT32_MAX, time);
+    }
+    end = strptime(str, "%Y%m%d%H%M%S", &tm);
+    if (end == NULL || *end != '\0') {
+        return -1;
+    }
+    /* Serial number arithmetic (RFC 1982) wraps time into 32 bits. */
+    *time = (uint32_t)timegm(&tm);
+    return 0;
+}
+
+/** Decode base64 data, which can be split over multiple tokens.
+ *
+ * @param tokens  Tokens holding base64 data.
+ * @param count   Number of tokens.
+ * @param dst     Where to store decoded data.
+ * @param dst_len Size of dst buffer.
+ *
+ * @return        Returns length of decoded data, or -1 on error.
+ */
+static int
+zone_parse_base64(char **tokens, int count, uint8_t *dst, size_t dst_len)
+{
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t bits  = 0;
+    int      nbits = 0;
+    size_t   len   = 0;
+    bool     pad   = false;
+
+    for (int i = 0; i < count; i++) {
+        for (const char *c = tokens[i]; *c != '\0'; c++) {
+            const char *v = NULL;
+
+            if (*c == '=') {
+                pad = true;
+                continue;
+            }
+            if (pad || (v = strchr(b64, *c)) == NULL) {
+                return -1;
+            }
+            bits   = (bits << 6) | (uint32_t)(v - b64);
+            nbits += 6;
+            if (nbits >= 8) {
+                nbits -= 8;
+                if (len == dst_len) {
+                    return -1;
+                }
+                dst[len++] = bits >> nbits;
+            }
+        }
+    }
+    return len;
+}
+
+/** Decode hexadecimal data, which can be split over multiple tokens.
+ *
+ * @param tokens  Tokens holding hexadecimal data.
+ * @param count   Number of tokens.
+ * @param dst     Where to store decoded data.
+ * @param dst_len Size of dst buffer.
+ *
+ * @return        Returns length of decoded data, or -1 on error.
+ */
+static int
+zone_parse_hex(char **tokens, int count, uint8_t *dst, size_t dst_len)
+{
+    size_t digits = 0;
+
+    for (int i = 0; i < count; i++) {
+        for (const char *c = tokens[i]; *c != '\0'; c++) {
+            if (!isxdigit((unsigned char)*c) || digits / 2 == dst_len) {
+                return -1;
+            }
+            int v = isdigit((unsigned char)*c) ? *c - '0' : tolower(*c) - 'a' + 10;
+            if (digits % 2 == 0) {
+                dst[digits / 2] = v << 4;
+            } else {
+                dst[digits / 2] |= v;
+            }
+            digits++;
+        }
+    }
+    return digits % 2 == 0 ? (int)(digits / 2) : -1;
+}
+
+/** Parse NSEC or NSEC3 type bitmap (RFC 4034, section 4.1.2), types given
+ * as mnemonics or as "TYPE<number>" (RFC 3597, section 5).
+ *
+ * @param tokens Type tokens, none for an empty bitmap.
+ * @param count  Number of tokens.
+ * @param dst    Where to store wire format bitmap, MUST be at least
+ *               256 * 34 bytes.
+ *
+ * @return       Returns length of bitmap, or -1 on error.
+ */
+static int
+zone_parse_type_bitmap(char **tokens, int count, uint8_t *dst)
+{
+    uint8_t  windows[256][32];
+    uint8_t  lens[256] = {};
+    uint8_t *p         = dst;
+
+    for (int i = 0; i < count; i++) {
+        uint16_t type = 0;
+        uint32_t num  = 0;
+
+        if (strncasecmp(tokens[i], "TYPE", 4) == 0 && isdigit((unsigned char)tokens[i][4]) &&
+            zone_parse_number(tokens[i] + 4, 0xffff, &num) == 0) {
+            type = num;
+        } else if (zone_parse_type(tokens[i], &type) != 0) {
+            return -1;
+        }
+        if (lens[type >> 8] == 0) {
+            memset(windows[type >> 8], 0, sizeof(windows[0]));
+        }
+        windows[type >> 8][(type & 0xff) / 8] |= 0x80 >> (type % 8);
+        if (lens[type >> 8] < (type & 0xff) / 8 + 1) {
+            lens[type >> 8] = (type & 0xff) / 8 + 1;
+        }
+    }
+    for (int w = 0; w < 256; w++) {
+        if (lens[w] != 0) {
+            *p++ = w;
+            *p++ = lens[w];
+            memcpy(p, windows[w], lens[w]);
+            p += lens[w];
+        }
+    }
+    return p - dst;
+}
+
+/** Parse NSEC3 salt, hexadecimal or "-" for an empty salt, prefixed with
+ * its length.
+ *
+ * @param str Salt token.
+ * @param dst Where to store salt length and salt.
+ *
+ * @return    Returns length of wire format salt, or -1 on error.
+ */
+static int
+zone_parse_salt(char *str, uint8_t *dst)
+{
+    int len = 0;
+
+    if (strcmp(str, "-") == 0) {
+        dst[0] = 0;
+        return 1;
+    }
+    if ((len = zone_parse_hex(&str, 1, dst + 1, UINT8_MAX)) <= 0) {
+        return -1;
+    }
+    dst[0] = len;
+    return 1 + len;
+}
+
+/** Parse resource record rdata into wire format.
+ *
+ * @param type   Resource record type.
+ * @param tokens Rdata tokens.
+ * @param count  Number of rdata tokens.
+ * @param dst    Where to store wire format rdata, MUST be at least
+ *               RIP_NS_MAXMSG bytes.
+ *
+ * @return       Returns length of rdata, or -1 on error.
+ */
+static int
+zone_parse_rdata(uint16_t type, char **tokens, int count, uint8_t *dst)
+{
+    uint8_t  *p     = dst;
+    uint16_t  rtype = 0;
+    uint32_t  num[5];
+    int       len;
+
+    switch (type) {
+    case rip_ns_t_a:
+        if (count != 1 || inet_pton(AF_INET, tokens[0], p) != 1) {
+            return -1;
+        }
+        return RIP_NS_INADDRSZ;
+
+    case rip_ns_t_aaaa:
+        if (count != 1 || inet_pton(AF_INET6, tokens[0], p) != 1) {
+            return -1;
+        }
+        return RIP_NS_IN6ADDRSZ;
+
+    case rip_ns_t_ns:
+    case rip_ns_t_cname:
+    case rip_ns_t_ptr:
+        if (count != 1) {
+            return -1;
+        }
+        return zone_parse_name(tokens[0], p);
+
+    case rip_ns_t_mx:
+        if (count != 2 || zone_parse_number(tokens[0], 0xffff, &num[0]) != 0) {
+            return -1;
+        }
+        RIP_NS_PUT16(num[0], p);
+        if ((len = zone_parse_name(tokens[1], p)) < 0) {
+            return -1;
+        }
+        return RIP_NS_INT16SZ + len;
+
+    case rip_ns_t_srv:
+        if (count != 4) {
+            return -1;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (zone_parse_number(tokens[i], 0xffff, &num[i]) != 0) {
+                return -1;
+            }
+            RIP_NS_PUT16(num[i], p);
+        }
+        if ((len = zone_parse_name(tokens[3], p)) < 0) {
+            return -1;
+        }
+        return (3 * RIP_NS_INT16SZ) + len;
+
+    case rip_ns_t_txt:
+        if (count < 1) {
+            return -1;
+        }
+        for (int i = 0; i < count; i++) {
+            size_t str_len = strlen(tokens[i]);
+            if (str_len > 255 || (p - dst) + 1 + str_len > RIP_NS_MAXMSG - RIP_NS_RRFIXEDSZ) {
+                return -1;
+            }
+            *p++ = str_len;
+            memcpy(p, tokens[i], str_len);
+            p += str_len;
+        }
+        return p - dst;
+
+    case rip_ns_t_soa:
+        if (count != 7) {
+            return -1;
+        }
+        for (int i = 0; i < 2; i++) {
+            if ((len = zone_parse_name(tokens[i], p)) < 0) {
+                return -1;
+            }
+            p += len;
+        }
+        for (int i = 0; i < 5; i++) {
+            if (zone_parse_number(tokens[2 + i], UINT32_MAX, &num[i]) != 0) {
+                return -1;
+            }
+            RIP_NS_PUT32(num[i], p);
+        }
+        return p - dst;
+
+    case rip_ns_t_ds:
+        /* Key tag, algorithm, digest type and digest. */
+        if (count < 4 || zone_parse_number(tokens[0], 0xffff, &num[0]) != 0 ||
+            zone_parse_number(tokens[1], 0xff, &num[1]) != 0 ||
+            zone_parse_number(tokens[2], 0xff, &num[2]) != 0) {
+            return -1;
+        }
+        RIP_NS_PUT16(num[0], p);
+        *p++ = num[1];
+        *p++ = num[2];
+        if ((len = zone_parse_hex(&tokens[3], count - 3, p, RIP_NS_PACKETSZ)) <= 0) {
+            return -1;
+        }
+        return (p - dst) + len;
+
+    case rip_ns_t_dnskey:
+        /* Flags, protocol, algorithm and public key. */
+        if (count < 4 || zone_parse_number(tokens[0], 0xffff, &num[0]) != 0 ||
+            zone_parse_number(tokens[1], 0xff, &num[1]) != 0 ||
+            zone_parse_number(tokens[2], 0xff, &num[2]) != 0) {
+            return -1;
+        }
+        RIP_NS_PUT16(num[0], p);
+        *p++ = num[1];
+        *p++ = num[2];
+        if ((len = zone_parse_base64(&tokens[3], count - 3, p, RIP_NS_PACKETSZ)) <= 0) {
+            return -1;
+        }
+        return (p - dst) + len;
+
+    case rip_ns_t_rrsig:
+        /* Type covered, algorithm, labels, original TTL, expiration,
+         * inception, key tag, signer name and signature.
+         */
+        if (count < 9 || zone_parse_type(tokens[0], &rtype) != 0 ||
+            zone_parse_number(tokens[1], 0xff, &num[0]) != 0 ||
+            zone_parse_number(tokens[2], 0xff, &num[1]) != 0 ||
+            zone_parse_number(tokens[3], UINT32_MAX, &num[2]) != 0 ||
+            zone_parse_time(tokens[4], &num[3]) != 0 ||
+            zone_parse_time(tokens[5], &num[4]) != 0) {
+            return -1;
+        }
+        RIP_NS_PUT16(rtype, p);
+        *p++ = num[0];
+        *p++ = num[1];
+        RIP_NS_PUT32(num[2], p);
+        RIP_NS_PUT32(num[3], p);
+        RIP_NS_PUT32(num[4], p);
+        if (zone_parse_number(tokens[6], 0xffff, &num[0]) != 0) {
+            return -1;
+        }
+        RIP_NS_PUT16(num[0], p);
+        /* Signer name is not compressed nor lower cased (RFC 4034, 3.1.7). */
+        if ((len = zone_parse_name(tokens[7], p)) < 0) {
+            return -1;
+        }
+        p += len;
+        if ((len = zone_parse_base64(&tokens[8], count - 8, p, RIP_NS_PACKETSZ)) <= 0) {
+            return -1;
+        }
+        return (p - dst) + len;
+
+    case rip_ns_t_nsec:
+        /* Next domain name, not lower cased (RFC 6840, 5.1), and type bitmap. */
+        if (count < 1 || (len = zone_parse_name(tokens[0], p)) < 0) {
+            return -1;
+        }
+        p += len;
+        if ((len = zone_parse_type_bitmap(&tokens[1], count - 1, p)) < 0) {
+            return -1;
+        }
+        return (p - dst) + len;
+
+    case rip_ns_t_nsec3:
+    case rip_ns_t_nsec3param:
+        /* Hash algorithm, flags, iterations and salt, NSEC3 followed by next
+         * hashed owner name and type bitmap.
+         */
+        if (count < 4 || zone_parse_number(tokens[0], 0xff, &num[0]) != 0 ||
+            zone_parse_number(tokens[1], 0xff, &num[1]) != 0 ||
+            zone_parse_number(tokens[2], 0xffff, &num[2]) != 0) {
+            return -1;
+        }
+        *p++ = num[0];
+        *p++ = num[1];
+        RIP_NS_PUT16(num[2], p);
+        if ((len = zone_parse_salt(tokens[3], p)) < 0) {
+            return -1;
+        }
+        p += len;
+        if (type == rip_ns_t_nsec3param) {
+            return count == 4 ? p - dst : -1;
+        }
+        if (count < 5 || (len = zone_base32hex_decode(tokens[4], strlen(tokens[4]), p + 1,
+                                                      UINT8_MAX)) <= 0) {
+            return -1;
+        }
+        *p  = len;
+        p  += 1 + len;
+        if ((len = zone_parse_type_bitmap(&tokens[5], count - 5, p)) < 0) {
+            return -1;
+        }
+        return (p - dst) + len;
+
+    default:
+        return -1;
+    }
+}
+
+/** Parse zone delta deletion line and add deletion it describes to build
+ * state.
+ *
+ * @param zb      Zone build state.
+ * @param tokens  Line tokens, first token is owner name prefixed with '-'.
+ * @param count   Number of tokens.
+ * @param line_no Line number.
+ * @param err     Where to store error message on error.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_parse_delete(zone_build_t *zb, char **tokens, int count, uint32_t line_no,
+                  char *err, size_t err_len)
+{
+    unsigned char   name[RIP_NS_MAXCDNAME + 1];
+    zone_build_rr_t rr  = {.line = line_no, .del = true};
+    int             len = 0;
+
+    if (count != 2) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+
+    /* Owner. */
+    len = zone_parse_name(tokens[0] + 1, name);
+    if (len < 0) {
+        snprintf(err, err_len, "line %u: invalid owner name \"%s\"", line_no, tokens[0] + 1);
+        return -1;
+    }
+    rr.name_len = len;
+
+    /* Type. */
+    if (strcasecmp(tokens[1], "ANY") == 0) {
+        rr.type = rip_ns_t_any;
+    } else {
+        if (zone_parse_type(tokens[1], &rr.type) != 0) {
+            snprintf(err, err_len, "line %u: unsupported type \"%s\"", line_no, tokens[1]);
+            return -1;
+        }
+    }
+
+    zone_name_tolower(name, rr.name_len);
+    rr.name_offset = zone_build_append((void **)&zb->names, &zb->names_len,
+                                       &zb->names_size, name, rr.name_len);
+    zone_build_append((void **)&zb->rrs, &zb->rrs_len, &zb->rrs_size, &rr,
+                      sizeof(zone_build_rr_t));
+    return 0;
+}
+
+/** Parse record synthesis rule zone file line and add rule to build state.
+ *
+ * Line is "$SYNTH forward|reverse <label prefix> <origin> <network>/<prefix
+ * length> <ttl>", e.g. "$SYNTH forward ip- pool.example.com. 192.0.2.0/24
+ * 300" answers A query for ip-192-0-2-1.pool.example.com. with 192.0.2.1,
+ * and same line with reverse answers PTR query for 1.2.0.192.in-addr.arpa.
+ * with that name.
+ *
+ * @param zb      Zone build state.
+ * @param tokens  Line tokens.
+ * @param count   Number of tokens.
+ * @param line_no Line number.
+ * @param err     Where to store error message on error.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_parse_synth(zone_build_t *zb, char **tokens, int count, uint32_t line_no,
+                 char *err, size_t err_len)
+{
+    zone_synth_t rule   = {};
+    char        *slash  = NULL;
+    size_t       len    = 0;
+    uint32_t     num    = 0;
+    int          ret    = 0;
+
+    if (count != 6) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+    if (zb->synths_len / sizeof(zone_synth_t) >= ZONE_SYNTH_RULES_MAX) {
+        snprintf(err, err_len, "line %u: too many synthesis rules", line_no);
+        return -1;
+    }
+
+    /* Type. */
+    if (strcasecmp(tokens[1], "forward") == 0) {
+        rule.type = ZONE_SYNTH_FORWARD;
+    } else if (strcasecmp(tokens[1], "reverse") == 0) {
+        rule.type = ZONE_SYNTH_REVERSE;
+    } else {
+        snprintf(err, err_len, "line %u: invalid synthesis rule type \"%s\"",
+                 line_no, tokens[1]);
+        return -1;
+    }
+
+    /* Label prefix, letters, digits and hyphens. */
+    len = strlen(tokens[2]);
+    if (len > ZONE_SYNTH_PREFIX_MAX ||
+        strspn(tokens[2], "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                          "0123456789-") != len) {
+        snprintf(err, err_len, "line %u: invalid label prefix \"%s\"", line_no, tokens[2]);
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        rule.label_prefix[i] = tolower((unsigned char)tokens[2][i]);
+    }
+    rule.label_prefix_len = len;
+
+    /* Origin. */
+    if ((ret = zone_parse_name(tokens[3], rule.origin)) < 0) {
+        snprintf(err, err_len, "line %u: invalid origin \"%s\"", line_no, tokens[3]);
+        return -1;
+    }
+    rule.origin_len = ret;
+    zone_name_tolower(rule.origin, rule.origin_len);
+
+    /* Network, host bits MUST be 0. */
+    if ((slash = strchr(tokens[4], '/')) != NULL) {
+        *slash = '\0';
+        if (inet_pton(AF_INET, tokens[4], rule.network) == 1) {
+            rule.addr_len = 4;
+        } else if (inet_pton(AF_INET6, tokens[4], rule.network) == 1) {
+            rule.addr_len = 16;
+        }
+    }
+    if (rule.addr_len == 0 || zone_parse_number(slash + 1, rule.addr_len * 8, &num) != 0) {
+        snprintf(err, err_len, "line %u: invalid network \"%s\"", line_no, tokens[4]);
+        return -1;
+    }
+    rule.prefix_len = num;
+    for (uint32_t bit = num; bit < rule.addr_len * 8U; bit++) {
+        if (rule.network[bit / 8] & (0x80 >> (bit % 8))) {
+            snprintf(err, err_len, "line %u: network \"%s\" has host bits set",
+                     line_no, tokens[4]);
+            return -1;
+        }
+    }
+
+    /* TTL. */
+    if (zone_parse_number(tokens[5], INT32_MAX, &num) != 0) {
+        snprintf(err, err_len, "line %u: invalid ttl \"%s\"", line_no, tokens[5]);
+        return -1;
+    }
+    rule.ttl = num;
+
+    if (!zone_synth_valid(&rule)) {
+        snprintf(err, err_len, "line %u: origin \"%s\" too long", line_no, tokens[3]);
+        return -1;
+    }
+    zone_build_append((void **)&zb->synths, &zb->synths_len, &zb->synths_size,
+                      &rule, sizeof(zone_synth_t));
+    return 0;
+}
+
+/** Parse single zone file line and add resource record it describes to build
+ * state.
+ *
+ * @param zb      Zone build state.
+ * @param line    Line to parse, line is modified.
+ * @param line_no Line number.
+ * @param delta   Line is from a zone delta file, deletion lines are allowed.
+ * @param err     Where to store error message on error.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_parse_line(zone_build_t *zb, char *line, uint32_t line_no, bool delta,
+                char *err, size_t err_len)
+{
+    char           *tokens[ZONE_FILE_TOKENS_MAX];
+    unsigned char   name[RIP_NS_MAXCDNAME + 1];
+    char            text[RIP_NS_MAXCDNAME * 4 + 1];
+    uint8_t         rdata[RIP_NS_MAXMSG];
+    zone_build_rr_t rr    = {.line = line_no};
+    int             count = 0;
+    int             len   = 0;
+    uint32_t        ttl   = 0;
+
+    count = zone_line_tokenize(line, tokens, ZONE_FILE_TOKENS_MAX);
+    if (count == 0) {
+        return 0;
+    }
+    if (delta && count > 0 && tokens[0][0] == '-') {
+        return zone_parse_delete(zb, tokens, count, line_no, err, err_len);
+    }
+    if (strcasecmp(tokens[0], "$SYNTH") == 0) {
+        if (delta) {
+            snprintf(err, err_len, "line %u: synthesis rule in zone delta", line_no);
+            return -1;
+        }
+        return zone_parse_synth(zb, tokens, count, line_no, err, err_len);
+    }
+    if (count < 5) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+
+    /* Owner. */
+    len = zone_parse_name(tokens[0], name);
+    if (len < 0) {
+        snprintf(err, err_len, "line %u: invalid owner name \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+    rr.name_len = len;
+
+    /* TTL. */
+    if (zone_parse_number(tokens[1], INT32_MAX, &ttl) != 0) {
+        snprintf(err, err_len, "line %u: invalid ttl \"%s\"", line_no, tokens[1]);
+        return -1;
+    }
+    rr.ttl = ttl;
+
+    /* Class. */
+    if (strcasecmp(tokens[2], "IN") != 0) {
+        snprintf(err, err_len, "line %u: unsupported class \"%s\"", line_no, tokens[2]);
+        return -1;
+    }
+    rr.class = rip_ns_c_in;
+
+    /* Type. */
+    if (zone_parse_type(tokens[3], &rr.type) != 0) {
+        snprintf(err, err_len, "line %u: unsupported type \"%s\"", line_no, tokens[3]);
+        return -1;
+    }
+
+    /* Rdata. */
+    len = zone_parse_rdata(rr.type, &tokens[4], count - 4, rdata);
+    if (len < 0) {
+        snprintf(err, err_len, "line %u: invalid %s rdata", line_no, tokens[3]);
+        return -1;
+    }
+    rr.rdata_len = len;
+
+    /* Owner as presentation (case preserved) and wire (lower cased) format. */
+    len = rip_ns_name_ntop(name, text, sizeof(text));
+    if (len < 0) {
+        snprintf(err, err_len, "line %u: invalid owner name \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+    rr.text_len = len;
+    rr.text_offset = zone_build_append((void **)&zb->texts, &zb->texts_len,
+                                       &zb->texts_size, text, len + 1);
+    zone_name_tolower(name, rr.name_len);
+    rr.name_offset = zone_build_append((void **)&zb->names, &zb->names_len,
+                                       &zb->names_size, name, rr.name_len);
+    rr.rdata_offset = zone_build_append((void **)&zb->rdata, &zb->rdata_len,
+                                        &zb->rdata_size, rdata, rr.rdata_len);
+
+    zone_build_append((void **)&zb->rrs, &zb->rrs_len, &zb->rrs_size, &rr,
+                      sizeof(zone_build_rr_t));
+    return 0;
+}
+
+/** Add resource record to build state, see @ref zone_db_create_rrs().
+ *
+ * @param zb      Zone build state.
+ * @param rr      Resource record, owner name in presentation format. Class
+ *                ANY record is a deletion, as zone delta deletion line.
+ * @param line_no Position of record, keeps order of records within RRset.
+ * @param err     Where to store error message on error.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_build_rr_record(zone_build_t *zb, const rr_record_t *rr, uint32_t line_no,
+                     char *err, size_t err_len)
+{
+    unsigned char   name[RIP_NS_MAXCDNAME + 1];
+    char            text[RIP_NS_MAXCDNAME * 4 + 1];
+    zone_build_rr_t brr = {
+        .line      = line_no,
+        .type      = rr->type,
+        .class     = rip_ns_c_in,
+        .ttl       = rr->ttl,
+        .del       = rr->class == rip_ns_c_any,
+    };
+    int             len = 0;
+
+    if ((len = zone_parse_name((const char *)rr->name, name)) < 0 ||
+        rip_ns_name_ntop(name, text, sizeof(text)) < 0) {
+        snprintf(err, err_len, "record %u: invalid owner name \"%s\"", line_no, rr->name);
+        return -1;
+    }
+    brr.name_len = len;
+    if (!(brr.del && brr.type == rip_ns_t_any) && !zone_type_supported(brr.type)) {
+        snprintf(err, err_len, "record %u: unsupported type %u", line_no, brr.type);
+        return -1;
+    }
+    if (!brr.del) {
+        if (rr->class != rip_ns_c_in) {
+            snprintf(err, err_len, "record %u: unsupported class %u", line_no, rr->class);
+            return -1;
+        }
+        brr.text_len    = strlen(text);
+        brr.text_offset = zone_build_append((void **)&zb->texts, &zb->texts_len,
+                                            &zb->texts_size, text, brr.text_len + 1);
+        brr.rdata_len    = rr->rdata_len;
+        brr.rdata_offset = zone_build_append((void **)&zb->rdata, &zb->rdata_len,
+                                             &zb->rdata_size, rr->rdata, rr->rdata_len);
+    }
+    zone_name_tolower(name, brr.name_len);
+    brr.name_offset = zone_build_append((void **)&zb->names, &zb->names_len,
+                                        &zb->names_size, name, brr.name_len);
+    zone_build_append((void **)&zb->rrs, &zb->rrs_len, &zb->rrs_size, &brr,
+                      sizeof(zone_build_rr_t));
+    return 0;
+}
+
+/** Add resource records to build state.
+ *
+ * @param zb        Zone build state, cleaned on error.
+ * @param rrs       Resource records.
+ * @param rrs_count Number of resource records.
+ * @param err       Where to store error message on error.
+ * @param err_len   Length of err buffer.
+ *
+ * @return          Returns number of records added, or -1 on error.
+ */
+static ssize_t
+zone_build_rr_records(zone_build_t *zb, const rr_record_t *rrs, size_t rrs_count,
+                      char *err, size_t err_len)
+{
+    for (size_t i = 0; i < rrs_count; i++) {
+        if (zone_build_rr_record(zb, &rrs[i], i + 1, err, err_len) != 0) {
+            zone_build_clean(zb);
+            return -1;
+        }
+    }
+    return zb->rrs_len / sizeof(zone_build_rr_t);
+}
+
+/** Compare function used to sort parsed resource records by owner name, type
+ * and line number.
+ *
+ * @param a   First record.
+ * @param b   Second record.
+ * @param arg Names buffer.
+ *
+ * @return    Returns <0, 0, >0 as per qsort_r() API.
+ */
+static int
+zone_build_rr_cmp(const void *a, const void *b, void *arg)
+{
+    const zone_build_rr_t *rr_a  = a;
+    const zone_build_rr_t *rr_b  = b;
+    const unsigned char   *names = arg;
+    int                    ret   = 0;
+
+    if (rr_a->name_len != rr_b->name_len) {
+        return rr_a->name_len - rr_b->name_len;
+    }
+    ret = memcmp(names + rr_a->name_offset, names + rr_b->name_offset, rr_a->name_len);
+    if (ret != 0) {
+        return ret;
+    }
+    if (rr_a->type != rr_b->type) {
+        return rr_a->type - rr_b->type;
+    }
+    return (rr_a->line > rr_b->line) - (rr_a->line < rr_b->line);
+}
+
+/** Insert node into zone database hash table. Table is grown when it becomes
+ * half full.
+ *
+ * @param db         Zone database.
+ * @param node_index Index of node in nodes array to insert.
+ */
+static void
+zone_db_table_insert(zone_db_t *db, uint32_t node_index)
+{
+    uint32_t i = db->nodes[node_index].hash & db->table_mask;
+
+    while (db->table[i] != 0) {
+        i = (i + 1) & db->table_mask;
+    }
+    db->table[i] = node_index + 1;
+}
+
+/** Grow zone database hash table, if needed, so it can hold one more node
+ * while staying at most half full.
+ *
+ * @param db Zone database.
+ */
+static void
+zone_db_table_reserve(zone_db_t *db)
+{
+    uint32_t size = db->table_mask + 1;
+
+    if ((db->nodes_count + 1) * 2 <= size) {
+        return;
+    }
+    free(db->table);
+    db->table_mask = (size * 2) - 1;
+    db->table = calloc(size * 2, sizeof(uint32_t));
+    CHECK_MALLOC(db->table);
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_db_table_insert(db, i);
+    }
+}
+
+/** Add node to zone database.
+ *
+ * @param db         Zone database.
+ * @param nodes_size Pointer to size of nodes array.
+ * @param name       Node name, MUST outlive database.
+ * @param name_len   Length of node name.
+ * @param hash       Hash of node name.
+ *
+ * @return           Returns pointer to added node.
+ */
+static zone_node_t *
+zone_db_node_add(zone_db_t *db, size_t *nodes_size, const unsigned char *name,
+                 uint16_t name_len, uint32_t hash)
+{
+    if (db->nodes_count == *nodes_size) {
+        *nodes_size = *nodes_size == 0 ? 1024 : *nodes_size * 2;
+        db->nodes = realloc(db->nodes, sizeof(zone_node_t) * *nodes_size);
+        CHECK_MALLOC(db->nodes);
+    }
+    zone_db_table_reserve(db);
+
+    zone_node_t *node = &db->nodes[db->nodes_count];
+    *node = (zone_node_t) {
+        .hash     = hash,
+        .name     = name,
+        .name_len = name_len,
+    };
+    zone_db_table_insert(db, db->nodes_count);
+    db->nodes_count += 1;
+    return node;
+}
+
+/** Add empty non-terminal nodes so names that exist only as ancestors of
+ * other names are not reported as non existent.
+ *
+ * @param db           Zone database.
+ * @param nodes_size   Pointer to size of nodes array.
+ * @param owners_count Number of nodes, from start of nodes array, to add
+ *                     ancestors of.
+ */
+static void
+zone_db_ent_add(zone_db_t *db, size_t *nodes_size, uint32_t owners_count)
+{
+    for (uint32_t i = 0; i < owners_count; i++) {
+        const unsigned char *name = db->nodes[i].name;
+        uint16_t             len  = db->nodes[i].name_len;
+
+        while (len > 1) {
+            uint8_t label_len = name[0];
+            name += label_len + 1;
+            len -= label_len + 1;
+            if (len <= 1 || zone_db_lookup(db, name, len) != NULL) {
+                break;
+            }
+            zone_db_node_add(db, nodes_size, name, len, zone_name_hash(name, len));
+        }
+    }
+}
+
+/** Add resource record parsed from zone file to zone database records array.
+ *
+ * @param db  Zone database, rrs array MUST have room for the record.
+ * @param brr Parsed resource record.
+ */
+static void
+zone_db_rr_add(zone_db_t *db, zone_build_rr_t *brr)
+{
+    db->rrs[db->rrs_count] = (rr_record_t) {
+        .name      = db->texts + brr->text_offset,
+        .name_len  = brr->text_len,
+        .type      = brr->type,
+        .class     = brr->class,
+        .ttl       = brr->ttl,
+        .rdata_len = brr->rdata_len,
+        .rdata     = db->rdata + brr->rdata_offset,
+    };
+    db->rrs_count += 1;
+}
+
+/** Update node flags for an RRset added to node. RRsets MUST be added in type
+ * order.
+ *
+ * @param node Node RRset was added to.
+ * @param type Type of added RRset.
+ */
+static void
+zone_node_flags_update(zone_node_t *node, uint16_t type)
+{
+    if (type == rip_ns_t_soa) {
+        node->flags = (node->flags | ZONE_NODE_F_APEX) & ~ZONE_NODE_F_CUT;
+    } else if (type == rip_ns_t_ns && !(node->flags & ZONE_NODE_F_APEX)) {
+        node->flags |= ZONE_NODE_F_CUT;
+    }
+}
+
+/** Get domain name from resource record rdata that additional section
+ * processing applies to.
+ *
+ * @param rr Resource record.
+ *
+ * @return   Returns pointer to wire format domain name in rdata, or NULL if
+ *           record type does not trigger additional section processing.
+ */
+const unsigned char *
+zone_rr_rdata_target(rr_record_t *rr)
+{
+    switch (rr->type) {
+    case rip_ns_t_ns:
+        return rr->rdata;
+    case rip_ns_t_mx:
+        return rr->rdata + RIP_NS_INT16SZ;
+    case rip_ns_t_srv:
+        return rr->rdata + (3 * RIP_NS_INT16SZ);
+    default:
+        return NULL;
+    }
+}
+
+/** Pack resource record into a message being compiled, compressing owner
+ * name and (where allowed) domain names in rdata.
+ *
+ * @param rr        Resource record to pack.
+ * @param buf       Where to pack the record.
+ * @param buf_len   Available space in buf.
+ * @param comp      Name compression table of message.
+ *
+ * @return          Returns number of bytes packed, or -1 if record does not fit.
+ */
+static int
+zone_rr_compile(rr_record_t *rr, unsigned char *buf, int buf_len,
+                rip_ns_comp_t *comp)
+{
+    unsigned char  name[RIP_NS_MAXCDNAME + 1];
+    unsigned char *p         = buf;
+    unsigned char *eob       = buf + buf_len;
+    unsigned char *rdlen_p   = NULL;
+    const uint8_t *rdata     = rr->rdata;
+    int            len       = 0;
+
+    if (rip_ns_name_pton(rr->name, name, sizeof(name)) < 0) {
+        return -1;
+    }
+    if ((len = rip_ns_name_pack(name, p, eob - p, comp)) < 0) {
+        return -1;
+    }
+    p += len;
+    if (eob - p < RIP_NS_RRFIXEDSZ) {
+        return -1;
+    }
+    RIP_NS_PUT16(rr->type, p);
+    RIP_NS_PUT16(rr->class, p);
+    RIP_NS_PUT32(rr->ttl, p);
+    rdlen_p = p;
+    p += RIP_NS_INT16SZ;
+
+    switch (rr->type) {
+    case rip_ns_t_mx:
+        if (eob - p < RIP_NS_INT16SZ) {
+            return -1;
+        }
+        memcpy(p, rdata, RIP_NS_INT16SZ);
+        p += RIP_NS_INT16SZ;
+        rdata += RIP_NS_INT16SZ;
+        /* fall through */
+    case rip_ns_t_ns:
+    case rip_ns_t_cname:
+    case rip_ns_t_ptr:
+        if ((len = rip_ns_name_pack(rdata, p, eob - p, comp)) < 0) {
+            return -1;
+        }
+        p += len;
+        break;
+
+    case rip_ns_t_soa:
+        for (int i = 0; i < 2; i++) {
+            if ((len = rip_ns_name_pack(rdata, p, eob - p, comp)) < 0) {
+                return -1;
+            }
+            p += len;
+            rdata += zone_name_wire_len(rdata);
+        }
+        if (eob - p < 5 * RIP_NS_INT32SZ) {
+            return -1;
+        }
+        memcpy(p, rdata, 5 * RIP_NS_INT32SZ);
+        p += 5 * RIP_NS_INT32SZ;
+        break;
+
+    default:
+        /* SRV target, per RFC 2782, and other rdata is not compressed. */
+        if (eob - p < rr->rdata_len) {
+            return -1;
+        }
+        memcpy(p, rdata, rr->rdata_len);
+        p += rr->rdata_len;
+        break;
+    }
+    RIP_NS_PUT16(p - rdlen_p - RIP_NS_INT16SZ, rdlen_p);
+
+    return p - buf;
+}
+
+/** Precompile RRset response fragment. Fragment is compiled as part of a
+ * response message whose question is RRset owner name, so compression
+ * pointers in it are valid for any response to such a question.
+ *
+ * @param db        Zone database, additional section addresses are looked up
+ *                  in it and fragment is appended to its wire buffer.
+ * @param node      Node RRset belongs to.
+ * @param rrset     RRset to precompile.
+ * @param msg       Scratch buffer of RIP_NS_MAXMSG bytes to compile in.
+ * @param wire      Pointer to wire buffer fragment is appended to.
+ * @param wire_len  Pointer to length of data in wire buffer.
+ * @param wire_size Pointer to size of wire buffer.
+ */
+static void
+zone_rrset_compile(zone_db_t *db, zone_node_t *node, zone_rrset_t *rrset,
+                   unsigned char *msg, unsigned char **wire, size_t *wire_len,
+                   size_t *wire_size)
+{
+    rip_ns_comp_t         comp;
+    unsigned char         name[RIP_NS_MAXCDNAME + 1];
+    unsigned char        *start     = NULL;
+    unsigned char        *p         = msg + sizeof(rip_ns_header_t);
+    unsigned char        *eom       = NULL;
+    rr_record_t          *rr        = rrset->rrs;
+    const unsigned char  *target    = NULL;
+    zone_node_t          *target_n  = NULL;
+    zone_rrset_t         *addrs     = NULL;
+    uint16_t              ancount   = 0;
+    uint16_t              arcount   = 0;
+    uint16_t              an_len    = 0;
+    size_t                resp_len  = 0;
+    int                   len       = 0;
+
+    /* Question. */
+    rip_ns_comp_init(&comp, msg);
+    len = rip_ns_name_pack(node->name, p, RIP_NS_MAXCDNAME + 1, &comp);
+    if (len < 0) {
+        return;
+    }
+    p += len + RIP_NS_QFIXEDSZ;
+    start = p;
+    eom = start + ZONE_RRSET_WIRE_MAX;
+
+    /* Answer section. */
+    for (uint16_t i = 0; i < rrset->rr_count && ancount < RIP_NS_RESP_MAX_ANSW; i++) {
+        if ((len = zone_rr_compile(&rr[i], p, eom - p, &comp)) < 0) {
+            /* Does not fit, response is packed record by record (and truncated). */
+            return;
+        }
+        p += len;
+        ancount += 1;
+    }
+    an_len = p - start;
+
+    /* Additional section. */
+    for (uint16_t i = 0; i < rrset->rr_count; i++) {
+        if ((target = zone_rr_rdata_target(&rr[i])) == NULL) {
+            break;
+        }
+        memcpy(name, target, zone_name_wire_len(target));
+        zone_name_tolower(name, zone_name_wire_len(target));
+        if ((target_n = zone_db_lookup(db, name, zone_name_wire_len(target))) == NULL) {
+            continue;
+        }
+        for (uint16_t t = rip_ns_t_a; t != 0; t = (t == rip_ns_t_a ? rip_ns_t_aaaa : 0)) {
+            if ((addrs = zone_node_rrset_get(db, target_n, t)) == NULL) {
+                continue;
+            }
+            for (uint16_t j = 0; j < addrs->rr_count && arcount < RIP_NS_RESP_MAX_ADDL; j++) {
+                len = zone_rr_compile(&addrs->rrs[j], p, eom - p, &comp);
+                if (len < 0) {
+                    break;
+                }
+                p += len;
+                arcount += 1;
+            }
+        }
+    }
+
+    rrset->wire_offset  = zone_build_append((void **)wire, wire_len, wire_size,
+                                            start, p - start);
+    rrset->wire_len     = p - start;
+    rrset->wire_ancount = ancount;
+    rrset->wire_arcount = arcount;
+    rrset->wire_an_len  = an_len;
+
+    /* Response size classes full response fits into. */
+    resp_len = (p - msg) + DNS_RESPONSE_EDNS_LEN_MAX;
+    rrset->wire_fits = (resp_len <= RIP_NS_PACKETSZ ? ZONE_RRSET_FITS_PACKETSZ : 0) |
+                       (resp_len <= DNS_RESPONSE_SIZE_EDNS ? ZONE_RRSET_FITS_EDNS : 0) |
+                       (resp_len <= RIP_NS_UDP_MAXMSG ? ZONE_RRSET_FITS_UDP_MAXMSG : 0);
+}
+
+/** Precompile negative response fragment of zone SOA RRset. Fragment is
+ * compiled as part of a response message whose question is zone apex name,
+ * every compression pointer in it points either into question (at a suffix of
+ * apex name) or into fragment, so they all move by same difference when
+ * question is a name in zone, see @ref zone_soa_negative_ttl.
+ *
+ * @param node      Zone apex node.
+ * @param rrset     SOA RRset to precompile.
+ * @param msg       Scratch buffer of RIP_NS_MAXMSG bytes to compile in.
+ * @param wire      Pointer to wire buffer fragment is appended to.
+ * @param wire_len  Pointer to length of data in wire buffer.
+ * @param wire_size Pointer to size of wire buffer.
+ */
+static void
+zone_rrset_compile_negative(zone_node_t *node, zone_rrset_t *rrset, unsigned char *msg,
+                            unsigned char **wire, size_t *wire_len, size_t *wire_size)
+{
+    rip_ns_comp_t         comp;
+    unsigned char        *p         = msg + sizeof(rip_ns_header_t);
+    rr_record_t           soa       = rrset->rrs[0];
+    int                   len       = 0;
+
+    rip_ns_comp_init(&comp, msg);
+    len = rip_ns_name_pack(node->name, p, RIP_NS_MAXCDNAME + 1, &comp);
+    if (len < 0) {
+        return;
+    }
+    p += len + RIP_NS_QFIXEDSZ;
+    soa.ttl = zone_soa_negative_ttl(&soa);
+    if ((len = zone_rr_compile(&soa, p, ZONE_RRSET_WIRE_MAX, &comp)) < 0) {
+        return;
+    }
+    rrset->neg_wire_offset = zone_build_append((void **)wire, wire_len, wire_size,
+                                               p, len);
+    rrset->neg_wire_len    = len;
+    rrset->neg_wire_base   = p - msg;
+}
+
+/** Run shards of work as jobs of worker thread pool, first shard on calling
+ * thread, see @ref worker_pool_run(). Each shard starts with its
+ * @ref worker_job_t.
+ *
+ * @param workers    Worker thread pool, NULL to run shards on calling thread.
+ * @param run        Function to run shard with.
+ * @param shards     Array of shards.
+ * @param shard_size Size of shard array element.
+ * @param count      Number of shards, at most @ref ZONE_COMPILE_THREADS_MAX.
+ */
+static void
+zone_shards_run(worker_pool_t *workers, void (*run)(worker_job_t *job), void *shards,
+                size_t shard_size, unsigned int count)
+{
+    worker_job_t *jobs[ZONE_COMPILE_THREADS_MAX];
+
+    for (unsigned int i = 0; i < count; i++) {
+        jobs[i]  = (worker_job_t *)((char *)shards + i * shard_size);
+        *jobs[i] = (worker_job_t) {
+            .run  = run,
+            .type = WORKER_JOB_ZONE_SHARD,
+        };
+    }
+    worker_pool_run(workers, jobs, count);
+}
+
+/** Number of shards to split work into, one per thread of worker thread pool
+ * and calling thread, but no more than leaves each shard with min units of
+ * work.
+ *
+ * @param workers Worker thread pool, NULL if there is none.
+ * @param units   Units of work.
+ * @param min     Minimum units of work per shard.
+ *
+ * @return        Returns number of shards, at least 1.
+ */
+static unsigned int
+zone_shards_count(worker_pool_t *workers, size_t units, size_t min)
+{
+    size_t count = workers != NULL ? workers->count + 1 : 1;
+
+    count = count < ZONE_COMPILE_THREADS_MAX ? count : ZONE_COMPILE_THREADS_MAX;
+    count = count < units / min ? count : units / min;
+    return count < 1 ? 1 : count;
+}
+
+/** Structure holds nodes one thread precompiles RRsets of, see
+ * @ref zone_db_compile().
+ */
+typedef struct zone_compile_shard_s {
+    /** Worker thread job compiling shard, MUST be first member. */
+    worker_job_t   job;
+
+    /** Zone database nodes are in. */
+    zone_db_t     *db;
+
+    /** Nodes to compile RRsets of. */
+    zone_node_t   *nodes;
+
+    /** Number of nodes. */
+    uint32_t       nodes_count;
+
+    /** Wire buffer fragments are appended to, offsets of fragments are
+     * relative to it.
+     */
+    unsigned char *wire;
+    size_t         wire_len;
+    size_t         wire_size;
+} zone_compile_shard_t;
+
+/** Precompile response fragments of RRsets of shard nodes into shard wire
+ * buffer.
+ *
+ * @param job Job of shard, see @ref zone_compile_shard_t.
+ */
+static void
+zone_compile_shard(worker_job_t *job)
+{
+    zone_compile_shard_t *s     = (zone_compile_shard_t *)job;
+    zone_node_t          *nodes = s->nodes;
+    unsigned char        *msg   = malloc(RIP_NS_MAXMSG);
+
+    CHECK_MALLOC(msg);
+    for (uint32_t i = 0; i < s->nodes_count; i++) {
+        for (uint16_t j = 0; j < nodes[i].rrset_count; j++) {
+            zone_rrset_compile(s->db, &nodes[i], &nodes[i].rrsets[j], msg,
+                               &s->wire, &s->wire_len, &s->wire_size);
+            if (nodes[i].rrsets[j].type == rip_ns_t_soa) {
+                zone_rrset_compile_negative(&nodes[i], &nodes[i].rrsets[j], msg,
+                                            &s->wire, &s->wire_len, &s->wire_size);
+            }
+        }
+    }
+    free(msg);
+}
+
+/** Precompile response fragments of RRsets of nodes.
+ *
+ * Nodes are split into shards of at least @ref ZONE_COMPILE_SHARD_NODES_MIN
+ * nodes, compiled on worker threads and calling thread, each into a wire
+ * buffer of its own. Shard wire buffers are then joined into database wire buffer, and
+ * fragment offsets of each shard moved by where its buffer was joined at.
+ * Wire buffer is reallocated as it grows, so fragments are pointed to once
+ * all of them are compiled.
+ *
+ * @param db          Zone database, RRsets of nodes MUST be in its rrsets
+ *                    array.
+ * @param nodes       Nodes to compile RRsets of.
+ * @param nodes_count Number of nodes.
+ * @param workers     Worker thread pool, NULL to compile on calling thread.
+ */
+static void
+zone_db_compile(zone_db_t *db, zone_node_t *nodes, uint32_t nodes_count,
+                worker_pool_t *workers)
+{
+    zone_compile_shard_t  shards[ZONE_COMPILE_THREADS_MAX] = {};
+    unsigned int          count     = zone_shards_count(workers, nodes_count,
+                                                        ZONE_COMPILE_SHARD_NODES_MIN);
+    uint32_t              first     = 0;
+    size_t                wire_size = 0;
+    for (unsigned int k = 0; k < count; k++) {
+        uint32_t last = (uint64_t)nodes_count * (k + 1) / count;
+
+        shards[k] = (zone_compile_shard_t) {
+            .db          = db,
+            .nodes       = &nodes[first],
+            .nodes_count = last - first,
+        };
+        first = last;
+    }
+    zone_shards_run(workers, zone_compile_shard, shards, sizeof(zone_compile_shard_t), count);
+
+    db->wire     = shards[0].wire;
+    db->wire_len = shards[0].wire_len;
+    wire_size    = shards[0].wire_size;
+    for (unsigned int k = 1; k < count; k++) {
+        zone_compile_shard_t *s    = &shards[k];
+        uint32_t              base = 0;
+
+        if (s->wire_len == 0) {
+            continue;
+        }
+        base = zone_build_append((void **)&db->wire, &db->wire_len, &wire_size,
+                                 s->wire, s->wire_len);
+        free(s->wire);
+        for (uint32_t i = 0; i < s->nodes_count; i++) {
+            for (uint16_t j = 0; j < s->nodes[i].rrset_count; j++) {
+                zone_rrset_t *rrset = &s->nodes[i].rrsets[j];
+
+                if (rrset->wire_len > 0) {
+                    rrset->wire_offset += base;
+                }
+                if (rrset->neg_wire_len > 0) {
+                    rrset->neg_wire_offset += base;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < db->rrsets_count; i++) {
+        if (db->rrsets[i].wire_len > 0) {
+            db->rrsets[i].wire = db->wire + db->rrsets[i].wire_offset;
+        }
+        if (db->rrsets[i].neg_wire_len > 0) {
+            db->rrsets[i].neg_wire = db->wire + db->rrsets[i].neg_wire_offset;
+        }
+    }
+}
+
+/** Structure holds state used while compiling zone transfer messages. */
+typedef struct zone_xfr_build_s {
+    /** Scratch buffer of RIP_NS_MAXMSG bytes message is compiled in. */
+    unsigned char  *msg;
+
+    /** Name compression table of message. */
+    rip_ns_comp_t   comp;
+
+    /** Start of message answer section. */
+    unsigned char  *start;
+
+    /** End of message answer section compiled so far. */
+    unsigned char  *p;
+
+    /** Number of records in message answer section. */
+    uint16_t        ancount;
+
+    /** Size of xfr_data buffer. */
+    size_t          data_size;
+
+    /** Size of xfr_msgs array, in bytes. */
+    size_t          msgs_size;
+
+    /** Record that did not fit into a message, set on error. */
+    rr_record_t    *failed;
+} zone_xfr_build_t;
+
+/** Start a new zone transfer message, question for zone apex name is packed
+ * so compression pointers of answer section are relative to it.
+ *
+ * @param xb   Zone transfer build state.
+ * @param apex Zone apex node.
+ */
+static void
+zone_xfr_msg_start(zone_xfr_build_t *xb, zone_node_t *apex)
+{
+    unsigned char *p   = xb->msg + sizeof(rip_ns_header_t);
+    int            len = 0;
+
+    rip_ns_comp_reset(&xb->comp);
+    len = rip_ns_name_pack(apex->name, p, RIP_NS_MAXCDNAME + 1, &xb->comp);
+    xb->start   = p + (len < 0 ? 0 : len) + RIP_NS_QFIXEDSZ;
+    xb->p       = xb->start;
+    xb->ancount = 0;
+}
+
+/** Append compiled zone transfer message to database.
+ *
+ * @param db Zone database.
+ * @param xb Zone transfer build state.
+ */
+static void
+zone_xfr_msg_flush(zone_db_t *db, zone_xfr_build_t *xb)
+{
+    zone_xfr_msg_t msg = {
+        .len     = xb->p - xb->start,
+        .ancount = xb->ancount,
+    };
+    size_t         msgs_len = db->xfr_msgs_count * sizeof(zone_xfr_msg_t);
+
+    msg.offset = zone_build_append((void **)&db->xfr_data, &db->xfr_data_len,
+                                   &xb->data_size, xb->start, msg.len);
+    zone_build_append((void **)&db->xfr_msgs, &msgs_len, &xb->msgs_size,
+                      &msg, sizeof(msg));
+    db->xfr_msgs_count += 1;
+}
+
+/** Add a resource record to zone transfer being compiled. Current message is
+ * flushed when record does not fit into it.
+ *
+ * @param db   Zone database.
+ * @param xb   Zone transfer build state.
+ * @param apex Zone apex node.
+ * @param rr   Resource record to add.
+ *
+ * @return     Returns 0 on success, or -1 if record does not fit even into
+ *             an empty message of largest size.
+ */
+static int
+zone_xfr_rr_add(zone_db_t *db, zone_xfr_build_t *xb, zone_node_t *apex, rr_record_t *rr)
+{
+    unsigned char *eom = xb->start + ZONE_XFR_MSG_LEN;
+    int            len = 0;
+
+    if ((len = zone_rr_compile(rr, xb->p, eom - xb->p, &xb->comp)) < 0) {
+        /* Compression table may hold names of record that did not fit. */
+        if (xb->ancount > 0) {
+            zone_xfr_msg_flush(db, xb);
+        }
+        zone_xfr_msg_start(xb, apex);
+        eom = xb->msg + RIP_NS_MAXMSG;
+        if ((len = zone_rr_compile(rr, xb->p, eom - xb->p, &xb->comp)) < 0) {
+            xb->failed = rr;
+            return -1;
+        }
+    }
+    xb->p += len;
+    xb->ancount += 1;
+    if (xb->p - xb->start >= ZONE_XFR_MSG_LEN) {
+        zone_xfr_msg_flush(db, xb);
+        zone_xfr_msg_start(xb, apex);
+    }
+    return 0;
+}
+
+/** Precompile zone transfer messages of every zone (apex node) in database.
+ *
+ * Each zone is its SOA record, followed by every record of nodes whose
+ * closest zone apex is zone apex (names below a zone cut are glue and
+ * belong to zone, names of another zone hosted in database do not), followed
+ * by SOA record again, as described by RFC 5936. Records are packed into
+ * messages of up to @ref ZONE_XFR_MSG_LEN bytes.
+ *
+ * @param db      Zone database.
+ * @param err     Where to store error message if error was encountered.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+int
+zone_db_xfr_compile(zone_db_t *db, char *err, size_t err_len)
+{
+    zone_xfr_build_t  xb        = {};
+    zone_match_t      match     = {};
+    uint32_t         *apexes    = malloc(sizeof(uint32_t) * (db->nodes_count + 1));
+    uint32_t         *order     = malloc(sizeof(uint32_t) * (db->nodes_count + 1));
+    uint32_t         *first     = calloc(db->nodes_count + 2, sizeof(uint32_t));
+    size_t            xfrs_size = 0;
+    size_t            xfrs_len  = 0;
+    const uint8_t    *serial    = NULL;
+    int               ret       = -1;
+
+    CHECK_MALLOC(apexes);
+    CHECK_MALLOC(order);
+    CHECK_MALLOC(first);
+    xb.msg = malloc(RIP_NS_MAXMSG);
+    CHECK_MALLOC(xb.msg);
+    rip_ns_comp_init(&xb.comp, xb.msg);
+
+    /* Nodes are grouped by their closest zone apex, in node order. */
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_db_match(db, db->nodes[i].name, db->nodes[i].name_len, &match);
+        apexes[i] = match.apex != NULL ? match.apex - db->nodes : db->nodes_count;
+        first[apexes[i] + 1] += 1;
+    }
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        first[i + 1] += first[i];
+    }
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        order[first[apexes[i]]++] = i;
+    }
+    /* Bucket of apex i now starts at first[i - 1] and ends at first[i]. */
+
+    for (uint32_t a = 0; a < db->nodes_count; a++) {
+        zone_node_t  *apex  = &db->nodes[a];
+        zone_rrset_t *soa   = NULL;
+        zone_xfr_t    xfr   = { .apex = a, .msg_index = db->xfr_msgs_count };
+
+        if (!(apex->flags & ZONE_NODE_F_APEX) ||
+            (soa = zone_node_rrset_get(db, apex, rip_ns_t_soa)) == NULL) {
+            continue;
+        }
+        zone_xfr_msg_start(&xb, apex);
+        if (zone_xfr_rr_add(db, &xb, apex, &soa->rrs[0]) != 0) {
+            goto ERR;
+        }
+        for (uint32_t i = (a == 0 ? 0 : first[a - 1]); i < first[a]; i++) {
+            zone_node_t *node = &db->nodes[order[i]];
+
+            for (uint16_t j = 0; j < node->rrset_count; j++) {
+                zone_rrset_t *rrset = &node->rrsets[j];
+
+                if (rrset == soa) {
+                    continue;
+                }
+                for (uint16_t k = 0; k < rrset->rr_count; k++) {
+                    if (zone_xfr_rr_add(db, &xb, apex, &rrset->rrs[k]) != 0) {
+                        goto ERR;
+                    }
+                }
+            }
+        }
+        if (zone_xfr_rr_add(db, &xb, apex, &soa->rrs[0]) != 0) {
+            goto ERR;
+        }
+        if (xb.ancount > 0) {
+            zone_xfr_msg_flush(db, &xb);
+        }
+
+        /* Serial is first field after SOA MNAME and RNAME. */
+        serial = soa->rrs[0].rdata;
+        serial += zone_name_wire_len(serial);
+        serial += zone_name_wire_len(serial);
+        RIP_NS_GET32(xfr.serial, serial);
+        xfr.msg_count = db->xfr_msgs_count - xfr.msg_index;
+        zone_build_append((void **)&db->xfrs, &xfrs_len, &xfrs_size, &xfr, sizeof(xfr));
+        db->xfrs_count += 1;
+    }
+    ret = 0;
+    goto END;
+
+ERR:
+    snprintf(err, err_len, "zone transfer record of %s does not fit into a message",
+             xb.failed->name);
+END:
+    free(xb.msg);
+    free(apexes);
+    free(order);
+    free(first);
+    return ret;
+}
+
+/** Parse lines of zone (or zone delta) file data into build state.
+ *
+ * @param zb      Zone build state, released on error.
+ * @param buf     Zone file data, whole lines.
+ * @param buf_len Length of zone file data.
+ * @param delta   Data is a zone delta, deletion lines are allowed.
+ * @param line_no Pointer to number of line before data, set to number of
+ *                last line parsed.
+ * @param err     Where to store error message if error was encountered.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns number of parsed records, or -1 on error.
+ */
+static ssize_t
+zone_db_parse_lines(zone_build_t *zb, const char *buf, size_t buf_len, bool delta,
+                    uint32_t *line_no, char *err, size_t err_len)
+{
+    char        line[ZONE_FILE_LINE_MAX];
+    const char *p       = buf;
+    const char *end     = buf + buf_len;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        *line_no += 1;
+        if (len >= ZONE_FILE_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", *line_no);
+            zone_build_clean(zb);
+            return -1;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (zone_parse_line(zb, line, *line_no, delta, err, err_len) != 0) {
+            zone_build_clean(zb);
+            return -1;
+        }
+        p += len + 1;
+    }
+    return zb->rrs_len / sizeof(zone_build_rr_t);
+}
+
+/** Parse zone (or zone delta) file data into build state.
+ *
+ * @param zb      Zone build state, released on error.
+ * @param buf     Zone file data.
+ * @param buf_len Length of zone file data.
+ * @param delta   Data is a zone delta, deletion lines are allowed.
+ * @param err     Where to store error message if error was encountered.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns number of parsed records, or -1 on error.
+ */
+static ssize_t
+zone_db_parse(zone_build_t *zb, const char *buf, size_t buf_len, bool delta,
+              char *err, size_t err_len)
+{
+    uint32_t line_no = 0;
+
+    return zone_db_parse_lines(zb, buf, buf_len, delta, &line_no, err, err_len);
+}
+
+/** Structure holds part of zone file one thread parses, see
+ * @ref zone_db_parse_workers().
+ */
+typedef struct zone_parse_shard_s {
+    /** Worker thread job parsing shard, MUST be first member. */
+    worker_job_t  job;
+
+    /** Zone file data, whole lines. */
+    const char   *buf;
+    size_t        buf_len;
+
+    /** Data is a zone delta, deletion lines are allowed. */
+    bool          delta;
+
+    /** Build state lines are parsed into, line numbers of its records are
+     * relative to start of shard.
+     */
+    zone_build_t  zb;
+
+    /** Number of lines parsed. */
+    uint32_t      lines;
+
+    /** Number of parsed records, or -1 on error. */
+    ssize_t       rrs_count;
+
+    /** Error message, set on error. */
+    char          err[ERR_MSG_LENGTH];
+} zone_parse_shard_t;
+
+/** Parse lines of shard into shard build state.
+ *
+ * @param job Job of shard, see @ref zone_parse_shard_t.
+ */
+static void
+zone_parse_shard(worker_job_t *job)
+{
+    zone_parse_shard_t *s = (zone_parse_shard_t *)job;
+
+    s->rrs_count = zone_db_parse_lines(&s->zb, s->buf, s->buf_len, s->delta, &s->lines,
+                                       s->err, sizeof(s->err));
+}
+
+/** Parse zone (or zone delta) file data into build state on worker threads
+ * and calling thread.
+ *
+ * Data is split at line boundaries into shards of at least
+ * @ref ZONE_PARSE_SHARD_LEN_MIN bytes, each parsed into a build state of its
+ * own with line numbers counted from start of shard. Shard build states are
+ * then joined in file order, moving offsets and line numbers of each shard
+ * records by where its buffers were joined at and by number of lines before
+ * it. Error in a shard is reported with line number in file, of first shard
+ * in file order that failed.
+ *
+ * @param zb      Zone build state, released on error.
+ * @param buf     Zone file data.
+ * @param buf_len Length of zone file data.
+ * @param delta   Data is a zone delta, deletion lines are allowed.
+ * @param workers Worker thread pool, NULL to parse on calling thread.
+ * @param err     Where to store error message if error was encountered.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns number of parsed records, or -1 on error.
+ */
+static ssize_t
+zone_db_parse_workers(zone_build_t *zb, const char *buf, size_t buf_len, bool delta,
+                      worker_pool_t *workers, char *err, size_t err_len)
+{
+    zone_parse_shard_t *shards  = NULL;
+    unsigned int        count   = zone_shards_count(workers, buf_len,
+                                                    ZONE_PARSE_SHARD_LEN_MIN);
+    const char         *p       = buf;
+    const char         *end     = buf + buf_len;
+    uint32_t            line_no = 0;
+    ssize_t             ret     = 0;
+
+    if (count <= 1) {
+        return zone_db_parse(zb, buf, buf_len, delta, err, err_len);
+    }
+    shards = calloc(count, sizeof(zone_parse_shard_t));
+    CHECK_MALLOC(shards);
+    for (unsigned int k = 0; k < count; k++) {
+        const char *stop = k + 1 == count ? end : buf + buf_len / count * (k + 1);
+        const char *eol  = NULL;
+
+        /* Shard ends after end of line its share of data ends in. */
+        stop = stop < p ? p : stop;
+        if (stop < end) {
+            eol  = memchr(stop, '\n', end - stop);
+            stop = eol != NULL ? eol + 1 : end;
+        }
+        shards[k].buf     = p;
+        shards[k].buf_len = stop - p;
+        shards[k].delta   = delta;
+        p = stop;
+    }
+    zone_shards_run(workers, zone_parse_shard, shards, sizeof(zone_parse_shard_t), count);
+
+    /* Join shard build states, in file order. */
+    for (unsigned int k = 0; k < count; k++) {
+        zone_parse_shard_t *s = &shards[k];
+
+        if (s->rrs_count < 0) {
+            /* Parse failed shard again, with line numbers in file. */
+            zone_build_t tmp = {};
+
+            zone_db_parse_lines(&tmp, s->buf, s->buf_len, delta, &line_no, err, err_len);
+            ret = -1;
+            break;
+        }
+        if (k == 0) {
+            *zb = s->zb;
+            s->zb = (zone_build_t) {};
+        } else if (s->zb.rrs_len > 0 || s->zb.synths_len > 0) {
+            uint32_t names_base = zb->names_len;
+            uint32_t texts_base = zb->texts_len;
+            uint32_t rdata_base = zb->rdata_len;
+
+            for (ssize_t i = 0; i < s->rrs_count; i++) {
+                s->zb.rrs[i].name_offset  += names_base;
+                s->zb.rrs[i].text_offset  += texts_base;
+                s->zb.rrs[i].rdata_offset += rdata_base;
+                s->zb.rrs[i].line         += line_no;
+            }
+            if (s->zb.rrs_len > 0) {
+                zone_build_append((void **)&zb->rrs, &zb->rrs_len, &zb->rrs_size,
+                                  s->zb.rrs, s->zb.rrs_len);
+                zone_build_append((void **)&zb->names, &zb->names_len, &zb->names_size,
+                                  s->zb.names, s->zb.names_len);
+            }
+            if (s->zb.texts_len > 0) {
+                zone_build_append((void **)&zb->texts, &zb->texts_len, &zb->texts_size,
+                                  s->zb.texts, s->zb.texts_len);
+            }
+            if (s->zb.rdata_len > 0) {
+                zone_build_append((void **)&zb->rdata, &zb->rdata_len, &zb->rdata_size,
+                                  s->zb.rdata, s->zb.rdata_len);
+            }
+            if (s->zb.synths_len > 0) {
+                zone_build_append((void **)&zb->synths, &zb->synths_len, &zb->synths_size,
+                                  s->zb.synths, s->zb.synths_len);
+            }
+            zone_build_clean(&s->zb);
+        }
+        line_no += s->lines;
+    }
+    if (ret == 0 && zb->synths_len / sizeof(zone_synth_t) > ZONE_SYNTH_RULES_MAX) {
+        snprintf(err, err_len, "too many synthesis rules");
+        ret = -1;
+    }
+    for (unsigned int k = 0; k < count; k++) {
+        zone_build_clean(&shards[k].zb);
+    }
+    free(shards);
+    if (ret < 0) {
+        zone_build_clean(zb);
+        return -1;
+    }
+    return zb->rrs_len / sizeof(zone_build_rr_t);
+}
+
+/** Structure holds run of records one thread sorts, or two adjacent sorted
+ * runs it merges, see @ref zone_build_rr_sort().
+ */
+typedef struct zone_sort_shard_s {
+    /** Worker thread job sorting or merging shard, MUST be first member. */
+    worker_job_t           job;
+
+    /** First run of records. */
+    zone_build_rr_t       *rrs;
+
+    /** Number of records in first run. */
+    size_t                 count;
+
+    /** Number of records in second run, which follows first one, 0 when
+     * sorting.
+     */
+    size_t                 count_next;
+
+    /** Where to merge runs to, same position as rrs in other buffer. */
+    zone_build_rr_t       *dst;
+
+    /** Names buffer records point into. */
+    const unsigned char   *names;
+} zone_sort_shard_t;
+
+/** Sort run of records of shard.
+ *
+ * @param job Job of shard, see @ref zone_sort_shard_t.
+ */
+static void
+zone_sort_shard(worker_job_t *job)
+{
+    zone_sort_shard_t *s = (zone_sort_shard_t *)job;
+
+    qsort_r(s->rrs, s->count, sizeof(zone_build_rr_t), zone_build_rr_cmp,
+            (void *)s->names);
+}
+
+/** Merge two adjacent sorted runs of records of shard into its destination.
+ *
+ * @param job Job of shard, see @ref zone_sort_shard_t.
+ */
+static void
+zone_merge_shard(worker_job_t *job)
+{
+    zone_sort_shard_t     *s     = (zone_sort_shard_t *)job;
+    const zone_build_rr_t *a     = s->rrs;
+    const zone_build_rr_t *a_end = a + s->count;
+    const zone_build_rr_t *b     = a_end;
+    const zone_build_rr_t *b_end = b + s->count_next;
+    zone_build_rr_t       *dst   = s->dst;
+
+    while (a < a_end && b < b_end) {
+        if (zone_build_rr_cmp(b, a, (void *)s->names) < 0) {
+            *dst++ = *b++;
+        } else {
+            *dst++ = *a++;
+        }
+    }
+    memcpy(dst, a, (a_end - a) * sizeof(zone_build_rr_t));
+    dst += a_end - a;
+    memcpy(dst, b, (b_end - b) * sizeof(zone_build_rr_t));
+}
+
+/** Sort records of build state by owner name, type and line number, so
+ * records of a node, and RRsets of a node, are contiguous.
+ *
+ * Records are split into runs of at least @ref ZONE_SORT_RUN_MIN records,
+ * sorted on worker threads and calling thread, and adjacent runs are then
+ * merged in pairs, each pair on a thread of its own, until a single run is
+ * left.
+ *
+ * @param zb        Zone build state.
+ * @param rrs_count Number of records in build state.
+ * @param workers   Worker thread pool, NULL to sort on calling thread.
+ */
+static void
+zone_build_rr_sort(zone_build_t *zb, size_t rrs_count, worker_pool_t *workers)
+{
+    zone_sort_shard_t  shards[ZONE_COMPILE_THREADS_MAX];
+    size_t             bounds[ZONE_COMPILE_THREADS_MAX + 1];
+    unsigned int       count = zone_shards_count(workers, rrs_count, ZONE_SORT_RUN_MIN);
+    zone_build_rr_t   *src   = zb->rrs;
+    zone_build_rr_t   *dst   = NULL;
+    zone_build_rr_t   *tmp   = NULL;
+
+    if (count <= 1) {
+        qsort_r(zb->rrs, rrs_count, sizeof(zone_build_rr_t), zone_build_rr_cmp, zb->names);
+        return;
+    }
+    for (unsigned int k = 0; k <= count; k++) {
+        bounds[k] = rrs_count * k / count;
+    }
+    for (unsigned int k = 0; k < count; k++) {
+        shards[k] = (zone_sort_shard_t) {
+            .rrs   = &src[bounds[k]],
+            .count = bounds[k + 1] - bounds[k],
+            .names = zb->names,
+        };
+    }
+    zone_shards_run(workers, zone_sort_shard, shards, sizeof(zone_sort_shard_t), count);
+
+    dst = malloc(rrs_count * sizeof(zone_build_rr_t));
+    CHECK_MALLOC(dst);
+    while (count > 1) {
+        unsigned int pairs = (count + 1) / 2;
+
+        for (unsigned int k = 0; k < pairs; k++) {
+            size_t next = 2 * k + 1 < count ? bounds[2 * k + 2] - bounds[2 * k + 1] : 0;
+
+            shards[k] = (zone_sort_shard_t) {
+                .rrs        = &src[bounds[2 * k]],
+                .count      = bounds[2 * k + 1] - bounds[2 * k],
+                .count_next = next,
+                .dst        = &dst[bounds[2 * k]],
+                .names      = zb->names,
+            };
+        }
+        zone_shards_run(workers, zone_merge_shard, shards, sizeof(zone_sort_shard_t), pairs);
+        for (unsigned int k = 0; k < pairs; k++) {
+            bounds[k] = bounds[2 * k];
+        }
+        bounds[pairs] = rrs_count;
+        count = pairs;
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    free(dst);
+    zb->rrs      = src;
+    zb->rrs_size = rrs_count * sizeof(zone_build_rr_t);
+}
+
+/** Allocate zone database and hand it build state buffers.
+ *
+ * @param zb         Zone build state, names, texts and rdata buffers are
+ *                   taken over by database.
+ * @param generation Generation number to assign to database.
+ * @param rrs_max    Number of records database rrs array can hold.
+ * @param rrsets_max Number of RRsets database rrsets array can hold.
+ *
+ * @return           Returns pointer to zone database.
+ */
+static zone_db_t *
+zone_db_alloc(zone_build_t *zb, uint64_t generation, size_t rrs_max, size_t rrsets_max)
+{
+    zone_db_t *db = calloc(1, sizeof(zone_db_t));
+    CHECK_MALLOC(db);
+
+    db->generation = generation;
+    db->refs = 1;
+    db->image_fd = -1;
+    db->names = zb->names;
+    db->names_len = zb->names_len;
+    db->texts = zb->texts;
+    db->texts_len = zb->texts_len;
+    db->rdata = zb->rdata;
+    db->rdata_len = zb->rdata_len;
+    db->synths = zb->synths;
+    db->synths_count = zb->synths_len / sizeof(zone_synth_t);
+    db->table_mask = ZONE_DB_TABLE_SIZE_MIN - 1;
+    db->table = calloc(ZONE_DB_TABLE_SIZE_MIN, sizeof(uint32_t));
+    CHECK_MALLOC(db->table);
+    db->rrs = malloc(sizeof(rr_record_t) * (rrs_max + 1));
+    CHECK_MALLOC(db->rrs);
+    db->rrsets = malloc(sizeof(zone_rrset_t) * (rrsets_max + 1));
+    CHECK_MALLOC(db->rrsets);
+    return db;
+}
+
+/** Build zone database from records of build state.
+ *
+ * @param zb         Zone build state, released.
+ * @param rrs_count  Number of records in build state.
+ * @param generation Generation number to assign to database.
+ * @param workers    Worker thread pool to sort records and precompile RRsets
+ *                   on along with calling thread, NULL if there is none.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+static zone_db_t *
+zone_db_build(zone_build_t *zb, size_t rrs_count, uint64_t generation,
+              worker_pool_t *workers, char *err, size_t err_len)
+{
+    zone_db_t *db         = NULL;
+    size_t     nodes_size = 0;
+
+    /* Sort records so records of a node, and RRsets of a node are contiguous. */
+    zone_build_rr_sort(zb, rrs_count, workers);
+
+    db = zone_db_alloc(zb, generation, rrs_count, rrs_count);
+
+    /* Build nodes, RRsets and records. */
+    zone_node_t  *node  = NULL;
+    zone_rrset_t *rrset = NULL;
+    for (size_t i = 0; i < rrs_count; i++) {
+        zone_build_rr_t *brr  = &zb->rrs[i];
+        unsigned char   *name = db->names + brr->name_offset;
+
+        if (node == NULL || node->name_len != brr->name_len ||
+            memcmp(node->name, name, brr->name_len) != 0) {
+            node = zone_db_node_add(db, &nodes_size, name, brr->name_len,
+                                    zone_name_hash(name, brr->name_len));
+            node->rrsets = &db->rrsets[db->rrsets_count];
+            rrset = NULL;
+        }
+        if (rrset == NULL || rrset->type != brr->type) {
+            rrset = &db->rrsets[db->rrsets_count];
+            *rrset = (zone_rrset_t) {
+                .type = brr->type,
+                .rrs  = &db->rrs[db->rrs_count],
+            };
+            db->rrsets_count += 1;
+            node->rrset_count += 1;
+            zone_node_flags_update(node, brr->type);
+        }
+        zone_db_rr_add(db, brr);
+        rrset->rr_count += 1;
+    }
+
+    /* Add empty non-terminal nodes. */
+    uint32_t owners_count = db->nodes_count;
+    zone_db_ent_add(db, &nodes_size, owners_count);
+
+    /* Precompile RRset response fragments. */
+    zone_db_compile(db, db->nodes, owners_count, workers);
+
+    free(zb->rrs);
+    if (zone_db_tree_build(db, err, err_len) != 0) {
+        zone_db_release(db);
+        return NULL;
+    }
+    return db;
+}
+
+/** Create zone database from zone file data.
+ *
+ * @param buf        Zone file data.
+ * @param buf_len    Length of zone file data.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_create(const char *buf, size_t buf_len, uint64_t generation,
+               char *err, size_t err_len)
+{
+    return zone_db_create_workers(buf, buf_len, generation, NULL, err, err_len);
+}
+
+/** Create zone database from zone file data, as @ref zone_db_create(), on
+ * worker threads along with calling thread. Zone file is parsed, its records
+ * sorted and RRsets precompiled in shards, one per thread, see
+ * @ref worker_pool_run(). Zones too small to be worth splitting are built on
+ * fewer threads. Database built is same as built on calling thread alone.
+ *
+ * @param buf        Zone file data.
+ * @param buf_len    Length of zone file data.
+ * @param generation Generation number to assign to database.
+ * @param workers    Worker thread pool owned by calling thread, NULL to
+ *                   build on calling thread alone.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_create_workers(const char *buf, size_t buf_len, uint64_t generation,
+                       worker_pool_t *workers, char *err, size_t err_len)
+{
+    zone_build_t zb        = {};
+    ssize_t      rrs_count = 0;
+
+    /* Parse zone file. */
+    rrs_count = zone_db_parse_workers(&zb, buf, buf_len, false, workers, err, err_len);
+    if (rrs_count < 0) {
+        return NULL;
+    }
+    return zone_db_build(&zb, rrs_count, generation, workers, err, err_len);
+}
+
+/** Create zone database from resource records, as if they were lines of a
+ * zone file.
+ *
+ * @param rrs        Resource records, owner names in presentation format.
+ * @param rrs_count  Number of resource records.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_create_rrs(const rr_record_t *rrs, size_t rrs_count, uint64_t generation,
+                   char *err, size_t err_len)
+{
+    zone_build_t zb    = {};
+    ssize_t      count = 0;
+
+    if ((count = zone_build_rr_records(&zb, rrs, rrs_count, err, err_len)) < 0) {
+        return NULL;
+    }
+    for (ssize_t i = 0; i < count; i++) {
+        if (zb.rrs[i].del) {
+            snprintf(err, err_len, "record %zd: deletion without base", i + 1);
+            zone_build_clean(&zb);
+            return NULL;
+        }
+    }
+    return zone_db_build(&zb, count, generation, NULL, err, err_len);
+}
+
+/** Check whether any RRset of a node has additional section processing
+ * target in a set of nodes.
+ *
+ * @param node         Node to check.
+ * @param set          Database holding set of nodes.
+ * @param owners_count Number of nodes, from start of set nodes array, that
+ *                     are in set.
+ *
+ * @return             Returns true if node has a target in set.
+ */
+static bool
+zone_node_targets_in(zone_node_t *node, zone_db_t *set, uint32_t owners_count)
+{
+    unsigned char        name[RIP_NS_MAXCDNAME + 1];
+    const unsigned char *target = NULL;
+    zone_node_t         *found  = NULL;
+    uint16_t             len    = 0;
+
+    for (uint16_t i = 0; i < node->rrset_count; i++) {
+        zone_rrset_t *rrset = &node->rrsets[i];
+
+        for (uint16_t j = 0; j < rrset->rr_count; j++) {
+            if ((target = zone_rr_rdata_target(&rrset->rrs[j])) == NULL) {
+                break;
+            }
+            len = zone_name_wire_len(target);
+            memcpy(name, target, len);
+            zone_name_tolower(name, len);
+            found = zone_db_lookup(set, name, len);
+            if (found != NULL && found - set->nodes < owners_count) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/** Apply records of build state to a base database, see @ref zone_db_apply().
+ *
+ * @param base       Database to apply records to.
+ * @param zb         Zone build state, released.
+ * @param rrs_count  Number of records in build state.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+static zone_db_t *
+zone_db_apply_build(zone_db_t *base, zone_build_t *zb, size_t rrs_count,
+                    uint64_t generation, char *err, size_t err_len)
+{
+    zone_db_t    *db           = NULL;
+    zone_db_t     chg          = {};
+    size_t        chg_size     = 0;
+    uint32_t     *ranges       = NULL;
+    size_t        ranges_len   = 0;
+    size_t        ranges_size  = 0;
+    size_t        nodes_size   = 0;
+    size_t        rrsets_max   = 0;
+    uint32_t      owners_count = 0;
+    zone_node_t  *bnode        = NULL;
+
+    if (rrs_count > 0) {
+        qsort_r(zb->rrs, rrs_count, sizeof(zone_build_rr_t), zone_build_rr_cmp, zb->names);
+    }
+
+    /* Changed nodes are kept in a separate table, along with range of delta
+     * records each one has.
+     */
+    chg.table_mask = ZONE_DB_TABLE_SIZE_MIN - 1;
+    chg.table = calloc(ZONE_DB_TABLE_SIZE_MIN, sizeof(uint32_t));
+    CHECK_MALLOC(chg.table);
+    for (size_t i = 0, j = 0; i < rrs_count; i = j) {
+        zone_build_rr_t *brr       = &zb->rrs[i];
+        unsigned char   *name      = zb->names + brr->name_offset;
+        uint32_t         range[2]  = {i, 0};
+
+        j = i + 1;
+        while (j < rrs_count && zb->rrs[j].name_len == brr->name_len &&
+               memcmp(zb->names + zb->rrs[j].name_offset, name, brr->name_len) == 0) {
+            j++;
+        }
+        range[1] = j;
+        zone_db_node_add(&chg, &chg_size, name, brr->name_len,
+                         zone_name_hash(name, brr->name_len));
+        zone_build_append((void **)&ranges, &ranges_len, &ranges_size, range, sizeof(range));
+        bnode = zone_db_lookup(base, name, brr->name_len);
+        rrsets_max += (j - i) + (bnode != NULL ? bnode->rrset_count : 0);
+    }
+    owners_count = chg.nodes_count;
+    for (uint32_t i = 0; i < base->nodes_count && owners_count > 0; i++) {
+        bnode = &base->nodes[i];
+        if (zone_node_targets_in(bnode, &chg, owners_count) &&
+            zone_db_lookup(&chg, bnode->name, bnode->name_len) == NULL) {
+            uint32_t range[2] = {0, 0};
+
+            zone_db_node_add(&chg, &chg_size, bnode->name, bnode->name_len, bnode->hash);
+            zone_build_append((void **)&ranges, &ranges_len, &ranges_size, range, sizeof(range));
+            rrsets_max += bnode->rrset_count;
+        }
+    }
+
+    db = zone_db_alloc(zb, generation, rrs_count, rrsets_max);
+    db->base = zone_db_ref(base);
+
+    /* Synthesis rules are not changed by deltas. */
+    if (base->synths_count > 0) {
+        db->synths = malloc(sizeof(zone_synth_t) * base->synths_count);
+        CHECK_MALLOC(db->synths);
+        memcpy(db->synths, base->synths, sizeof(zone_synth_t) * base->synths_count);
+        db->synths_count = base->synths_count;
+    }
+
+    /* Build RRsets of changed nodes. */
+    for (uint32_t i = 0; i < chg.nodes_count; i++) {
+        zone_node_t     *node  = &chg.nodes[i];
+        zone_rrset_t    *brs   = NULL;
+        zone_rrset_t    *brs_e = NULL;
+        zone_build_rr_t *brr   = &zb->rrs[ranges[i * 2]];
+        zone_build_rr_t *brr_e = &zb->rrs[ranges[i * 2 + 1]];
+        bool             any   = false;
+
+        if ((bnode = zone_db_lookup(base, node->name, node->name_len)) != NULL) {
+            brs = bnode->rrsets;
+            brs_e = brs + bnode->rrset_count;
+        }
+        for (zone_build_rr_t *b = brr; b < brr_e; b++) {
+            any = any || (b->del && b->type == rip_ns_t_any);
+        }
+        node->rrsets = &db->rrsets[db->rrsets_count];
+
+        while (brs < brs_e || brr < brr_e) {
+            zone_rrset_t *rrset = &db->rrsets[db->rrsets_count];
+
+            if (brr < brr_e && brr->del && brr->type == rip_ns_t_any) {
+                brr++;
+                continue;
+            }
+            if (brr == brr_e || (brs < brs_e && brs->type < brr->type)) {
+                /* RRset delta left as is, compiled again. */
+                if (!any) {
+                    *rrset = *brs;
+                    rrset->wire = NULL;
+                    rrset->wire_len = 0;
+                    rrset->neg_wire = NULL;
+                    rrset->neg_wire_len = 0;
+                    db->rrsets_count += 1;
+                    node->rrset_count += 1;
+                    zone_node_flags_update(node, rrset->type);
+                }
+                brs++;
+                continue;
+            }
+
+            /* RRset delta replaces or deletes. */
+            *rrset = (zone_rrset_t) {
+                .type = brr->type,
+                .rrs  = &db->rrs[db->rrs_count],
+            };
+            if (brs < brs_e && brs->type == brr->type) {
+                brs++;
+            }
+            for (; brr < brr_e && brr->type == rrset->type; brr++) {
+                if (!brr->del) {
+                    zone_db_rr_add(db, brr);
+                    rrset->rr_count += 1;
+                }
+            }
+            if (rrset->rr_count > 0) {
+                db->rrsets_count += 1;
+                node->rrset_count += 1;
+                zone_node_flags_update(node, rrset->type);
+            }
+        }
+    }
+
+    /* Nodes, base nodes that did not change are copied as is. */
+    for (uint32_t i = 0; i < base->nodes_count + chg.nodes_count; i++) {
+        zone_node_t *src  = i < base->nodes_count ? &base->nodes[i] :
+                                                    &chg.nodes[i - base->nodes_count];
+        zone_node_t *node = NULL;
+
+        if (src->rrset_count == 0 || (i < base->nodes_count &&
+            zone_db_lookup(&chg, src->name, src->name_len) != NULL)) {
+            continue;
+        }
+        node = zone_db_node_add(db, &nodes_size, src->name, src->name_len, src->hash);
+        node->rrset_count = src->rrset_count;
+        node->rrsets = src->rrsets;
+        node->flags = src->flags;
+    }
+    zone_db_ent_add(db, &nodes_size, db->nodes_count);
+
+    /* Precompile response fragments of changed nodes RRsets. */
+    zone_db_compile(db, chg.nodes, chg.nodes_count, NULL);
+
+    free(chg.nodes);
+    free(chg.table);
+    free(ranges);
+    free(zb->rrs);
+    if (zone_db_tree_build(db, err, err_len) != 0) {
+        zone_db_release(db);
+        return NULL;
+    }
+    return db;
+}
+
+/** Create zone database generation by applying zone delta file data to a
+ * base database.
+ *
+ * Each owner name in delta is a changed node, its RRsets are those of base
+ * node that delta did not replace or delete, followed (in type order) by
+ * RRsets in delta. Nodes whose NS, MX or SRV targets are changed nodes are
+ * changed as well, as additional section addresses of their precompiled
+ * fragments may have changed. Only RRsets of changed nodes are compiled, all
+ * other nodes are copied from base and share its RRsets and records.
+ *
+ * @param base       Database to apply delta to, new generation holds a
+ *                   reference to it.
+ * @param buf        Zone delta file data.
+ * @param buf_len    Length of zone delta file data.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_apply(zone_db_t *base, const char *buf, size_t buf_len, uint64_t generation,
+              char *err, size_t err_len)
+{
+    zone_build_t zb        = {};
+    ssize_t      rrs_count = 0;
+
+    /* Parse zone delta file. */
+    if ((rrs_count = zone_db_parse(&zb, buf, buf_len, true, err, err_len)) < 0) {
+        return NULL;
+    }
+    return zone_db_apply_build(base, &zb, rrs_count, generation, err, err_len);
+}
+
+/** Create zone database generation by applying resource records to a base
+ * database, as if they were lines of a zone delta file, see
+ * @ref zone_db_apply(). Records replace RRset of their owner name and type,
+ * class ANY record deletes RRset of its type, or all RRsets of owner name if
+ * its type is ANY.
+ *
+ * @param base       Database to apply records to, new generation holds a
+ *                   reference to it.
+ * @param rrs        Resource records, owner names in presentation format.
+ * @param rrs_count  Number of resource records.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_apply_rrs(zone_db_t *base, const rr_record_t *rrs, size_t rrs_count,
+                  uint64_t generation, char *err, size_t err_len)
+{
+    zone_build_t zb    = {};
+    ssize_t      count = 0;
+
+    if ((count = zone_build_rr_records(&zb, rrs, rrs_count, err, err_len)) < 0) {
+        return NULL;
+    }
+    return zone_db_apply_build(base, &zb, count, generation, err, err_len);
+}
+
+/** Take a reference to zone database.
+ *
+ * @param db Zone database.
+ *
+ * @return   Returns db.
+ */
+zone_db_t *
+zone_db_ref(zone_db_t *db)
+{
+    db->refs += 1;
+    return db;
+}
+
+/** Number of memory regions of zone database, see @ref zone_db_regions(). */
+#define ZONE_DB_REGIONS_COUNT 9
+
+/** Memory region of zone database. */
+typedef struct zone_db_region_s {
+    /** Start of region, NULL if database does not have it. */
+    void *ptr;
+
+    /** Length of region. */
+    size_t len;
+
+    /** Whether region is writable, zone image is mapped read only. */
+    bool writable;
+} zone_db_region_t;
+
+/** Get memory regions lookups of zone database read: nodes, RRsets, records,
+ * arena, and zone image or hash table and buffers of a database built from
+ * zone file. Zone transfer data is not included, transfers are sent from
+ * zone image file. Regions of database it was derived from are not included.
+ *
+ * @param db      Zone database.
+ * @param regions Where to store @ref ZONE_DB_REGIONS_COUNT regions, regions
+ *                database does not have are empty.
+ */
+static void
+zone_db_regions(zone_db_t *db, zone_db_region_t *regions)
+{
+    memset(regions, 0, sizeof(zone_db_region_t) * ZONE_DB_REGIONS_COUNT);
+    regions[0] = (zone_db_region_t) { db->nodes, sizeof(zone_node_t) * db->nodes_count, true };
+    regions[1] = (zone_db_region_t) { db->rrsets, sizeof(zone_rrset_t) * db->rrsets_count, true };
+    regions[2] = (zone_db_region_t) { db->rrs, sizeof(rr_record_t) * db->rrs_count, true };
+    regions[3] = (zone_db_region_t) { db->arena.base, db->arena.size, true };
+    if (db->image != NULL) {
+        regions[4] = (zone_db_region_t) { db->image, db->image_len, false };
+        return;
+    }
+    regions[4] = (zone_db_region_t) { db->table,
+                                      sizeof(uint32_t) * ((size_t)db->table_mask + 1), true };
+    regions[5] = (zone_db_region_t) { db->names, db->names_len, true };
+    regions[6] = (zone_db_region_t) { db->texts, db->texts_len, true };
+    regions[7] = (zone_db_region_t) { db->rdata, db->rdata_len, true };
+    regions[8] = (zone_db_region_t) { db->wire, db->wire_len, true };
+}
+
+/** Unlock first count memory regions of zone database, see
+ * @ref zone_db_mlock().
+ *
+ * @param db    Zone database.
+ * @param count Number of regions to unlock.
+ */
+static void
+zone_db_regions_munlock(zone_db_t *db, int count)
+{
+    zone_db_region_t regions[ZONE_DB_REGIONS_COUNT];
+
+    zone_db_regions(db, regions);
+    for (int i = 0; i < count; i++) {
+        if (regions[i].len > 0) {
+            munlock(regions[i].ptr, regions[i].len);
+        }
+    }
+    db->locked = false;
+}
+
+/** Release a reference to zone database, database is freed once last
+ * reference is released.
+ *
+ * @param db Zone database to release.
+ */
+void
+zone_db_release(zone_db_t *db)
+{
+    if (db == NULL || --db->refs > 0) {
+        return;
+    }
+    if (db->locked) {
+        zone_db_regions_munlock(db, ZONE_DB_REGIONS_COUNT);
+    }
+    free(db->nodes);
+    free(db->rrsets);
+    free(db->rrs);
+    free(db->zone_slots);
+    arena_clean(&db->arena);
+    if (db->image_fd >= 0) {
+        close(db->image_fd);
+    }
+    if (db->image != NULL) {
+        munmap(db->image, db->image_len);
+    } else {
+        free(db->table);
+        free(db->names);
+        free(db->texts);
+        free(db->rdata);
+        free(db->wire);
+        free(db->xfrs);
+        free(db->xfr_msgs);
+        free(db->xfr_data);
+        free(db->synths);
+    }
+    zone_db_release(db->base);
+    free(db);
+}
+
+/** Fault in every page of zone database, and of databases it was derived
+ * from, so lookups do not fault pages in, see @ref utl_mem_prefault(). Zone
+ * image is read into page cache first.
+ *
+ * @param db Zone database to fault in.
+ *
+ * @return   Returns number of bytes faulted in.
+ */
+size_t
+zone_db_prefault(zone_db_t *db)
+{
+    zone_db_region_t regions[ZONE_DB_REGIONS_COUNT];
+    size_t           bytes = 0;
+
+    for (; db != NULL; db = db->base) {
+        zone_db_regions(db, regions);
+        for (int i = 0; i < ZONE_DB_REGIONS_COUNT; i++) {
+            bytes += utl_mem_prefault(regions[i].ptr, regions[i].len, regions[i].writable);
+        }
+    }
+    return bytes;
+}
+
+/** Get bytes of memory zone database, and databases it was derived from,
+ * hold: nodes, RRsets, records, arena, and zone image or hash table and
+ * buffers.
+ *
+ * @param db Zone database.
+ *
+ * @return   Returns number of bytes.
+ */
+size_t
+zone_db_memory(zone_db_t *db)
+{
+    zone_db_region_t regions[ZONE_DB_REGIONS_COUNT];
+    size_t           bytes = 0;
+
+    for (; db != NULL; db = db->base) {
+        zone_db_regions(db, regions);
+        for (int i = 0; i < ZONE_DB_REGIONS_COUNT; i++) {
+            bytes += regions[i].len;
+        }
+    }
+    return bytes;
+}
+
+/** Lock memory of zone database, and of databases it was derived from that
+ * are not locked yet, with mlock(). Memory is unlocked when database is
+ * released, see @ref zone_db_release().
+ *
+ * @param db     Zone database to lock.
+ * @param locked Where to store number of bytes locked.
+ *
+ * @return       Returns 0 on success, otherwise -errno of failed mlock(), in
+ *               which case database whose memory could not be locked is
+ *               left unlocked.
+ */
+int
+zone_db_mlock(zone_db_t *db, size_t *locked)
+{
+    zone_db_region_t regions[ZONE_DB_REGIONS_COUNT];
+    int              err = 0;
+
+    *locked = 0;
+    for (; db != NULL && !db->locked; db = db->base) {
+        zone_db_regions(db, regions);
+        for (int i = 0; i < ZONE_DB_REGIONS_COUNT; i++) {
+            if (regions[i].len > 0 && mlock(regions[i].ptr, regions[i].len) != 0) {
+                err = -errno;
+                zone_db_regions_munlock(db, i);
+                return err;
+            }
+            *locked += regions[i].len;
+        }
+        db->locked = true;
+    }
+    return 0;
+}
+
+/** Lookup node in zone database.
+ *
+ * @param db       Zone database to lookup node in.
+ * @param name     Wire format, lower cased, name of node.
+ * @param name_len Length of name.
+ *
+ * @return         Returns pointer to node if found, otherwise NULL.
+ */
+zone_node_t *
+zone_db_lookup(zone_db_t *db, const unsigned char *name, uint16_t name_len)
+{
+    return zone_db_lookup_hash(db, name, name_len, rip_ns_name_hash(name, name_len));
+}
+
+/** Lookup node in zone database by name whose hash is already known.
+ *
+ * @param db        Zone database to lookup node in.
+ * @param name      Wire format, lower cased, name of node.
+ * @param name_len  Length of name.
+ * @param name_hash Hash of name, as returned by @ref rip_ns_name_hash.
+ *
+ * @return          Returns pointer to node if found, otherwise NULL.
+ */
+zone_node_t *
+zone_db_lookup_hash(zone_db_t *db, const unsigned char *name, uint16_t name_len,
+                    uint64_t name_hash)
+{
+    uint32_t     hash = (uint32_t)name_hash;
+    uint32_t     i    = hash & db->table_mask;
+    zone_node_t *node = NULL;
+
+    if (db->table == NULL) {
+        /* Zone image, node index is slot of name. */
+        if (db->nodes_count == 0) {
+            return NULL;
+        }
+        node = &db->nodes[mphf_lookup(&db->mphf, name_hash)];
+        return node->hash == hash && node->name_len == name_len &&
+               memcmp(node->name, name, name_len) == 0 ? node : NULL;
+    }
+    while (db->table[i] != 0) {
+        node = &db->nodes[db->table[i] - 1];
+        if (node->hash == hash && node->name_len == name_len &&
+            memcmp(node->name, name, name_len) == 0) {
+            return node;
+        }
+        i = (i + 1) & db->table_mask;
+    }
+    return NULL;
+}
+
+/** Compare two labels in canonical order, as octet strings where a label
+ * that is a prefix of the other sorts first.
+ *
+ * @param a     First label.
+ * @param a_len Length of first label.
+ * @param b     Second label.
+ * @param b_len Length of second label.
+ *
+ * @return      Returns negative, 0 or positive number if first label sorts
+ *              before, same as, or after second label.
+ */
+static inline int
+zone_label_cmp(const unsigned char *a, uint8_t a_len, const unsigned char *b, uint8_t b_len)
+{
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+
+    return cmp != 0 ? cmp : a_len - b_len;
+}
+
+/** Compare reverse label tree nodes by label, qsort_r() comparator.
+ *
+ * @param a   First tree node.
+ * @param b   Second tree node.
+ * @param arg Zone database.
+ *
+ * @return    Returns result of @ref zone_label_cmp of node labels.
+ */
+static int
+zone_tree_node_cmp(const void *a, const void *b, void *arg)
+{
+    zone_db_t           *db = arg;
+    const unsigned char *la = db->nodes[((const zone_tree_node_t *)a)->node - 1].name;
+    const unsigned char *lb = db->nodes[((const zone_tree_node_t *)b)->node - 1].name;
+
+    return zone_label_cmp(la + 1, la[0], lb + 1, lb[0]);
+}
+
+/** Build reverse label tree, zones array and name filter of zone database
+ * nodes. Every node, other than root name, MUST have its parent name in
+ * database, which empty non-terminal nodes guarantee. Each zone apex is given
+ * a dense zone index, in nodes array order.
+ *
+ * Tree nodes are laid out breadth first, so nodes near the root that every
+ * descent goes through share cache lines and pages. Name filter fingerprints
+ * and denial of existence chains (see @ref zone_db_denial_build()) follow
+ * tree nodes in database arena.
+ *
+ * @param db      Zone database, hash table and nodes array MUST be built.
+ * @param err     Where to store error message if error was encountered.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+int
+zone_db_tree_build(zone_db_t *db, char *err, size_t err_len)
+{
+    uint32_t  count   = db->nodes_count;
+    uint32_t *parents = malloc(sizeof(uint32_t) * (count + 1));
+    uint32_t *ends    = calloc(count + 2, sizeof(uint32_t));
+    uint32_t *order   = malloc(sizeof(uint32_t) * (count + 1));
+    uint64_t *keys    = NULL;
+    uint32_t  pos     = 1;
+    uint32_t  zones   = 0;
+    int       ret     = -1;
+
+    CHECK_MALLOC(parents);
+    CHECK_MALLOC(ends);
+    CHECK_MALLOC(order);
+
+    for (uint32_t i = 0; i < count; i++) {
+        zones += (db->nodes[i].flags & ZONE_NODE_F_APEX) != 0;
+    }
+
+    /* Parent of each node as (index + 1) of parent node, 0 for tree root,
+     * UINT32_MAX for root name which is tree root itself.
+     */
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char *name   = db->nodes[i].name;
+        uint16_t             len    = db->nodes[i].name_len;
+        zone_node_t         *parent = NULL;
+
+        if (len == 1 && name[0] == 0) {
+            parents[i] = UINT32_MAX;
+            continue;
+        }
+        if (len < 2 || name[0] == 0 || name[0] > RIP_NS_MAXLABEL || name[0] + 1 >= len) {
+            snprintf(err, err_len, "zone node %u name invalid", i);
+            goto END;
+        }
+        parents[i] = 0;
+        if (len - name[0] - 1 > 1) {
+            parent = zone_db_lookup(db, name + name[0] + 1, len - name[0] - 1);
+            if (parent == NULL) {
+                snprintf(err, err_len, "zone node %u parent missing", i);
+                goto END;
+            }
+            parents[i] = (parent - db->nodes) + 1;
+        }
+        ends[parents[i] + 1] += 1;
+    }
+
+    /* Order nodes by parent, children of parent k end up in order range
+     * [ends[k - 1], ends[k]) (or [0, ends[0]) for tree root).
+     */
+    for (uint32_t k = 1; k <= count; k++) {
+        ends[k] += ends[k - 1];
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (parents[i] != UINT32_MAX) {
+            order[ends[parents[i]]++] = i;
+        }
+    }
+
+    ret = arena_init(&db->arena, ARENA_OBJ_SIZE(sizeof(zone_tree_node_t) * (count + 1)) +
+                                 ARENA_OBJ_SIZE(sizeof(uint32_t) * (zones + 1)) +
+                                 ARENA_OBJ_SIZE(xor_filter_size(count)) +
+                                 zone_db_denial_size(db), ARENA_THP);
+    if (ret != 0) {
+        snprintf(err, err_len, "zone tree arena error: %s", strerror(-ret));
+        ret = -1;
+        goto END;
+    }
+    db->tree = arena_alloc(&db->arena, sizeof(zone_tree_node_t) * (count + 1));
+    db->tree[0] = (zone_tree_node_t) { };
+    for (uint32_t i = 0; i < count; i++) {
+        if (parents[i] == UINT32_MAX) {
+            db->tree[0].node = i + 1;
+        }
+    }
+
+    /* Breadth first, each tree node gets its children placed at end of tree
+     * nodes array, and sorted.
+     */
+    for (uint32_t t = 0; t < pos; t++) {
+        zone_tree_node_t *tn    = &db->tree[t];
+        uint32_t          k     = t == 0 ? 0 : tn->node;
+        uint32_t          start = k == 0 ? 0 : ends[k - 1];
+
+        tn->children = pos;
+        tn->children_count = ends[k] - start;
+        for (uint32_t j = start; j < ends[k]; j++) {
+            zone_node_t *node = &db->nodes[order[j]];
+
+            db->tree[pos] = (zone_tree_node_t) {
+                .node      = order[j] + 1,
+                .label_len = node->name[0],
+            };
+            memcpy(db->tree[pos].label, node->name + 1,
+                   node->name[0] < ZONE_TREE_LABEL_INLINE ? node->name[0] : ZONE_TREE_LABEL_INLINE);
+            pos++;
+        }
+        qsort_r(&db->tree[tn->children], tn->children_count, sizeof(zone_tree_node_t),
+                zone_tree_node_cmp, db);
+    }
+    db->tree_count = pos;
+
+    /* Zones, apex nodes in nodes array order. */
+    db->zones       = arena_alloc(&db->arena, sizeof(uint32_t) * (zones + 1));
+    db->zones_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (db->nodes[i].flags & ZONE_NODE_F_APEX) {
+            db->nodes[i].zone = db->zones_count < UINT16_MAX ? db->zones_count : UINT16_MAX;
+            db->zones[db->zones_count++] = i;
+        }
+    }
+
+    /* Name filter, keyed by full name hash. */
+    keys = malloc(sizeof(uint64_t) * (count + 1));
+    CHECK_MALLOC(keys);
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = rip_ns_name_hash(db->nodes[i].name, db->nodes[i].name_len);
+    }
+    if (xor_filter_build(&db->filter, arena_alloc(&db->arena, xor_filter_size(count)),
+                         keys, count) != 0) {
+        snprintf(err, err_len, "zone name filter build failed");
+        ret = -1;
+        goto END;
+    }
+
+    /* Denial of existence chains of signed zones. */
+    zone_db_denial_build(db);
+    ret = 0;
+
+END:
+    free(parents);
+    free(ends);
+    free(order);
+    free(keys);
+    return ret;
+}
+
+/** Find child of reverse label tree node by label.
+ *
+ * @param db        Zone database.
+ * @param tn        Tree node whose children to search.
+ * @param label     Label to search for, lower cased.
+ * @param label_len Length of label.
+ *
+ * @return          Returns child tree node, or NULL if there is none.
+ */
+static inline zone_tree_node_t *
+zone_tree_child(zone_db_t *db, zone_tree_node_t *tn, const unsigned char *label,
+                uint8_t label_len)
+{
+    zone_tree_node_t *children = &db->tree[tn->children];
+    uint32_t          lo       = 0;
+    uint32_t          hi       = tn->children_count;
+
+    while (lo < hi) {
+        uint32_t          mid = lo + (hi - lo) / 2;
+        zone_tree_node_t *c   = &children[mid];
+        uint8_t           len = c->label_len < label_len ? c->label_len : label_len;
+        int               cmp = memcmp(c->label, label,
+                                       len < ZONE_TREE_LABEL_INLINE ? len : ZONE_TREE_LABEL_INLINE);
+
+        if (cmp == 0 && len > ZONE_TREE_LABEL_INLINE) {
+            cmp = memcmp(db->nodes[c->node - 1].name + 1 + ZONE_TREE_LABEL_INLINE,
+                         label + ZONE_TREE_LABEL_INLINE, len - ZONE_TREE_LABEL_INLINE);
+        }
+        if (cmp == 0) {
+            cmp = c->label_len - label_len;
+        }
+        if (cmp == 0) {
+            return c;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/** Find wildcard ("*") child of reverse label tree node.
+ *
+ * Canonical order puts "*" label first among children, unless some label
+ * starts with a lower octet, so first child alone tells in most cases.
+ *
+ * @param db Zone database.
+ * @param tn Tree node whose children to search.
+ *
+ * @return   Returns wildcard child tree node, or NULL if there is none.
+ */
+static inline zone_tree_node_t *
+zone_tree_wildcard(zone_db_t *db, zone_tree_node_t *tn)
+{
+    zone_tree_node_t *first = &db->tree[tn->children];
+
+    if (tn->children_count == 0 || first->label[0] > '*') {
+        return NULL;
+    }
+    if (first->label[0] == '*') {
+        return first->label_len == 1 ? first : NULL;
+    }
+    return zone_tree_child(db, tn, (const unsigned char *)"*", 1);
+}
+
+/** Search zone database for closest encloser of a name, see
+ * @ref zone_db_match_hash.
+ *
+ * @param db       Zone database to search.
+ * @param name     Wire format, lower cased, name to search for.
+ * @param name_len Length of name.
+ * @param match    Where to store search result.
+ */
+void
+zone_db_match(zone_db_t *db, const unsigned char *name, uint16_t name_len,
+              zone_match_t *match)
+{
+    zone_db_match_hash(db, name, name_len, rip_ns_name_hash(name, name_len), match);
+}
+
+/** Search zone database for closest encloser of a name whose hash is already
+ * known, along with closest zone apex, highest zone cut below it, and
+ * wildcard node answers for a non existent name are synthesized from. All in
+ * a single descent of reverse label tree, from root label towards leftmost
+ * label of name.
+ *
+ * Name hash is first tested against database name filter. On a definite miss
+ * (most names of a random subdomain attack) leftmost label is not searched
+ * for, so children of closest encloser, often every name of a zone, are not
+ * touched.
+ *
+ * @param db        Zone database to search.
+ * @param name      Wire format, lower cased, name to search for.
+ * @param name_len  Length of name.
+ * @param name_hash Hash of name, as returned by @ref rip_ns_name_hash.
+ * @param match     Where to store search result.
+ */
+void
+zone_db_match_hash(zone_db_t *db, const unsigned char *name, uint16_t name_len,
+                   uint64_t name_hash, zone_match_t *match)
+{
+    uint16_t          offsets[RIP_NS_MAXCDNAME / 2 + 1];
+    int               labels = 0;
+    bool              exists = xor_filter_contain(&db->filter, name_hash);
+    zone_tree_node_t *tn     = &db->tree[0];
+    zone_tree_node_t *child  = NULL;
+    zone_node_t      *node   = NULL;
+
+    *match = (zone_match_t) { };
+
+    for (uint16_t offset = 0; offset < name_len && name[offset] != 0;
+         offset += name[offset] + 1) {
+        offsets[labels++] = offset;
+    }
+
+    while (1) {
+        if (tn->node != 0) {
+            node = &db->nodes[tn->node - 1];
+            match->encloser = node;
+            if (node->flags & ZONE_NODE_F_APEX) {
+                match->apex = node;
+                match->cut = NULL;
+            } else if ((node->flags & ZONE_NODE_F_CUT) && match->cut == NULL) {
+                match->cut = node;
+            }
+        }
+        if (labels == 0) {
+            match->node = match->encloser;
+            return;
+        }
+        labels--;
+        if (labels == 0 && !exists) {
+            break;
+        }
+        child = zone_tree_child(db, tn, name + offsets[labels] + 1, name[offsets[labels]]);
+        if (child == NULL) {
+            break;
+        }
+        tn = child;
+    }
+
+    /* Name does not exist, wildcard is "*" child of closest encloser. */
+    if (match->encloser != NULL && (child = zone_tree_wildcard(db, tn)) != NULL) {
+        match->wildcard = &db->nodes[child->node - 1];
+    }
+}
+
+/** Get RRset of a type from zone database node.
+ *
+ * @param db   Zone database node belongs to.
+ * @param node Node to get RRset from.
+ * @param type Type of RRset to get.
+ *
+ * @return     Returns pointer to RRset if node has an RRset of requested
+ *             type, otherwise NULL.
+ */
+zone_rrset_t *
+zone_node_rrset_get(zone_db_t *db, zone_node_t *node, uint16_t type)
+{
+    zone_rrset_t *rrset = node->rrsets;
+
+    for (uint16_t i = 0; i < node->rrset_count; i++) {
+        if (rrset[i].type == type) {
+            return &rrset[i];
+        }
+    }
+    return NULL;
+}
+
+/** Find precompiled zone transfer of a zone.
+ *
+ * Transfers are sent from zone image file, so only a database loaded from a
+ * zone image has them.
+ *
+ * @param db   Zone database.
+ * @param apex Zone apex node.
+ *
+ * @return     Returns pointer to zone transfer, or NULL if there is none.
+ */
+const zone_xfr_t *
+zone_db_xfr_find(zone_db_t *db, const zone_node_t *apex)
+{
+    uint32_t index = apex - db->nodes;
+    uint32_t lo    = 0;
+    uint32_t hi    = db->xfrs_count;
+
+    if (db->image_fd < 0) {
+        return NULL;
+    }
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (db->xfrs[mid].apex < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < db->xfrs_count && db->xfrs[lo].apex == index ? &db->xfrs[lo] : NULL;
+}
+
+/** Check whether a synthesis rule is well formed, rules of a zone image are
+ * checked before use.
+ *
+ * @param rule Synthesis rule.
+ *
+ * @return     Returns true if rule is valid.
+ */
+bool
+zone_synth_valid(const zone_synth_t *rule)
+{
+    uint16_t len = 0;
+
+    if ((rule->type != ZONE_SYNTH_FORWARD && rule->type != ZONE_SYNTH_REVERSE) ||
+        (rule->addr_len != 4 && rule->addr_len != 16) ||
+        rule->prefix_len > rule->addr_len * 8 ||
+        rule->label_prefix_len > ZONE_SYNTH_PREFIX_MAX ||
+        1 + rule->label_prefix_len + INET6_ADDRSTRLEN + rule->origin_len > RIP_NS_MAXCDNAME) {
+        return false;
+    }
+    while (len < rule->origin_len && rule->origin[len] != 0) {
+        len += rule->origin[len] + 1;
+    }
+    return len + 1 == rule->origin_len;
+}
+
+/** Check whether address is within address block of synthesis rule.
+ *
+ * @param rule Synthesis rule.
+ * @param addr Address, of rule address length.
+ *
+ * @return     Returns true if address is in block.
+ */
+static bool
+zone_synth_in(const zone_synth_t *rule, const uint8_t *addr)
+{
+    uint8_t bytes = rule->prefix_len / 8;
+    uint8_t bits  = rule->prefix_len % 8;
+
+    return memcmp(addr, rule->network, bytes) == 0 &&
+           (bits == 0 || ((addr[bytes] ^ rule->network[bytes]) >> (8 - bits)) == 0);
+}
+
+/** Format first label of forward name of an address, label prefix followed
+ * by address text with '.' and ':' replaced by '-'.
+ *
+ * @param rule  Synthesis rule.
+ * @param addr  Address, of rule address length.
+ * @param label Where to store label, at least 63 bytes.
+ *
+ * @return      Returns length of label.
+ */
+static uint8_t
+zone_synth_label(const zone_synth_t *rule, const uint8_t *addr, char *label)
+{
+    char    text[INET6_ADDRSTRLEN];
+    uint8_t len = rule->label_prefix_len;
+
+    inet_ntop(rule->addr_len == 4 ? AF_INET : AF_INET6, addr, text, sizeof(text));
+    memcpy(label, rule->label_prefix, len);
+    for (const char *p = text; *p != '\0'; p++) {
+        label[len++] = *p == '.' || *p == ':' ? '-' : *p;
+    }
+    return len;
+}
+
+/** Match name against forward synthesis rule, name is label prefix and
+ * address text (in canonical form, so each address has a single name)
+ * directly under rule origin.
+ *
+ * @param rule     Forward synthesis rule.
+ * @param name     Wire format, lower cased, name.
+ * @param name_len Length of name.
+ * @param addr     Where to store address name is of.
+ *
+ * @return         Returns true if name is forward name of an address of block.
+ */
+static bool
+zone_synth_forward(const zone_synth_t *rule, const unsigned char *name, uint16_t name_len,
+                   uint8_t *addr)
+{
+    char    text[INET6_ADDRSTRLEN];
+    char    label[RIP_NS_MAXLABEL];
+    uint8_t len = name[0];
+    uint8_t i   = rule->label_prefix_len;
+
+    if (1 + len + rule->origin_len != name_len || len <= i ||
+        len - i >= sizeof(text) ||
+        memcmp(name + 1 + len, rule->origin, rule->origin_len) != 0 ||
+        memcmp(name + 1, rule->label_prefix, i) != 0) {
+        return false;
+    }
+    for (; i < len; i++) {
+        text[i - rule->label_prefix_len] = name[1 + i] != '-' ? name[1 + i] :
+                                           rule->addr_len == 4 ? '.' : ':';
+    }
+    text[len - rule->label_prefix_len] = '\0';
+    return inet_pton(rule->addr_len == 4 ? AF_INET : AF_INET6, text, addr) == 1 &&
+           zone_synth_in(rule, addr) &&
+           zone_synth_label(rule, addr, label) == len && memcmp(label, name + 1, len) == 0;
+}
+
+/** Match name against reverse synthesis rule, name is in-addr.arpa name (4
+ * decimal labels) or ip6.arpa name (32 nibble labels) of an address.
+ *
+ * @param rule     Reverse synthesis rule.
+ * @param name     Wire format, lower cased, name.
+ * @param name_len Length of name.
+ * @param addr     Where to store address name is of.
+ *
+ * @return         Returns true if name is reverse name of an address of block.
+ */
+static bool
+zone_synth_reverse(const zone_synth_t *rule, const unsigned char *name, uint16_t name_len,
+                   uint8_t *addr)
+{
+    static const unsigned char in_addr[] = "\7in-addr\4arpa";
+    static const unsigned char ip6[]     = "\3ip6\4arpa";
+    const unsigned char       *p         = name;
+    const unsigned char       *suffix    = ip6;
+    size_t                     suffix_len = sizeof(ip6);
+
+    memset(addr, 0, rule->addr_len);
+    if (rule->addr_len == 4) {
+        for (int i = 3; i >= 0; i--) {
+            unsigned int value = 0;
+
+            if (p[0] < 1 || p[0] > 3 || (p[0] > 1 && p[1] == '0')) {
+                return false;
+            }
+            for (uint8_t j = 1; j <= p[0]; j++) {
+                if (!isdigit(p[j])) {
+                    return false;
+                }
+                value = value * 10 + p[j] - '0';
+            }
+            if (value > 255) {
+                return false;
+            }
+            addr[i] = value;
+            p += p[0] + 1;
+        }
+        suffix     = in_addr;
+        suffix_len = sizeof(in_addr);
+    } else {
+        for (int i = 31; i >= 0; i--) {
+            uint8_t nibble;
+
+            if (p[0] != 1 || !isxdigit(p[1]) || isupper(p[1])) {
+                return false;
+            }
+            nibble = isdigit(p[1]) ? p[1] - '0' : p[1] - 'a' + 10;
+            addr[i / 2] |= i % 2 ? nibble : nibble << 4;
+            p += 2;
+        }
+    }
+    return (size_t)(name + name_len - p) == suffix_len &&
+           memcmp(p, suffix, suffix_len) == 0 && zone_synth_in(rule, addr);
+}
+
+/** Synthesize record of a name from synthesis rules of zone database. Rules
+ * are matched in zone file order, first rule name is of (forward name or
+ * reverse name of an address of its block) synthesizes record: A or AAAA
+ * record of address for forward rule, PTR record pointing at forward name of
+ * address for reverse rule. Nothing is allocated, record and its rdata are
+ * stored in caller provided storage.
+ *
+ * @param db       Zone database.
+ * @param name     Wire format, lower cased, name, MUST not be in database.
+ * @param name_len Length of name.
+ * @param rr       Where to store record, owner name is not set.
+ * @param rdata    Where to store record rdata, at least RIP_NS_MAXCDNAME + 1
+ *                 bytes.
+ *
+ * @return         Returns rule record was synthesized from, or NULL if name
+ *                 matches no rule.
+ */
+const zone_synth_t *
+zone_db_synth(zone_db_t *db, const unsigned char *name, uint16_t name_len,
+              rr_record_t *rr, uint8_t *rdata)
+{
+    uint8_t addr[16];
+
+    for (uint32_t i = 0; i < db->synths_count; i++) {
+        const zone_synth_t *rule = &db->synths[i];
+
+        if (rule->type == ZONE_SYNTH_FORWARD) {
+            if (!zone_synth_forward(rule, name, name_len, addr)) {
+                continue;
+            }
+            memcpy(rdata, addr, rule->addr_len);
+            rr->type      = rule->addr_len == 4 ? rip_ns_t_a : rip_ns_t_aaaa;
+            rr->rdata_len = rule->addr_len;
+        } else {
+            if (!zone_synth_reverse(rule, name, name_len, addr)) {
+                continue;
+            }
+            rdata[0] = zone_synth_label(rule, addr, (char *)rdata + 1);
+            memcpy(rdata + 1 + rdata[0], rule->origin, rule->origin_len);
+            rr->type      = rip_ns_t_ptr;
+            rr->rdata_len = 1 + rdata[0] + rule->origin_len;
+        }
+        rr->class = rip_ns_c_in;
+        rr->ttl   = rule->ttl;
+        rr->rdata = rdata;
+        return rule;
+    }
+    return NULL;
+}
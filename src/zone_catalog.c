@@ -0,0 +1,646 @@
+/**
+ * @file zone_catalog.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup zone_catalog
+ *  @{
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "utils.h"
+#include "zone_catalog.h"
+
+/** Maximum length of a single line in catalog file, long enough for an apex
+ * name in presentation format (every byte escaped) and a zone file path of
+ * @ref FILE_REALPATH_MAX.
+ */
+#define ZONE_CATALOG_LINE_MAX (FILE_REALPATH_MAX + 4 * RIP_NS_MAXCDNAME)
+
+/** Number of tokens (fields) on a catalog file line. */
+#define ZONE_CATALOG_FILE_TOKENS 2
+
+/** Structure collects errors of zones that could not be loaded, so one
+ * broken zone file does not hold up all other zones. First error is kept.
+ */
+typedef struct zone_catalog_errs_s {
+    /** Number of zones that could not be loaded. */
+    uint32_t count;
+
+    /** Where to store first error message. */
+    char *err;
+
+    /** Length of err buffer. */
+    size_t err_len;
+} zone_catalog_errs_t;
+
+/** Count labels of wire format name, not counting root label.
+ *
+ * @param name Wire format name.
+ *
+ * @return     Returns number of labels.
+ */
+static uint8_t
+zone_catalog_labels(const unsigned char *name)
+{
+    uint8_t count = 0;
+
+    for (const unsigned char *p = name; *p != 0; p += *p + 1) {
+        count++;
+    }
+    return count;
+}
+
+/** Lookup zone in apex index by its exact apex name.
+ *
+ * @param index    Apex index.
+ * @param name     Wire format (lower cased) name.
+ * @param name_len Length of name, including terminating root label.
+ * @param hash     Hash of name, see @ref zone_name_hash.
+ *
+ * @return         Returns zone number + 1, or 0 if name is not an apex of a
+ *                 catalog zone.
+ */
+static inline uint32_t
+zone_catalog_index_lookup(const zone_catalog_index_t *index, const unsigned char *name,
+                          uint16_t name_len, uint32_t hash)
+{
+    const zone_catalog_zone_t *zone;
+    uint32_t                   slot = hash & index->table_mask;
+
+    while (index->table[slot] != 0) {
+        zone = &index->zones[index->table[slot] - 1];
+        if (zone->hash == hash && zone->name_len == name_len &&
+            memcmp(index->names + zone->name_offset, name, name_len) == 0) {
+            return index->table[slot];
+        }
+        slot = (slot + 1) & index->table_mask;
+    }
+    return 0;
+}
+
+/** Drop a reference to apex index, releasing it with last one.
+ *
+ * @param index Apex index, may be NULL.
+ */
+static void
+zone_catalog_index_release(zone_catalog_index_t *index)
+{
+    if (index == NULL || --index->refs > 0) {
+        return;
+    }
+    free(index->table);
+    free(index->zones);
+    free(index->names);
+    free(index->paths);
+    free(index);
+}
+
+/** Drop a reference to page, releasing it and its zone databases with last
+ * one.
+ *
+ * @param page Page, may be NULL.
+ */
+static void
+zone_catalog_page_release(zone_catalog_page_t *page)
+{
+    if (page == NULL || --page->refs > 0) {
+        return;
+    }
+    for (int i = 0; i < ZONE_CATALOG_PAGE_ZONES; i++) {
+        zone_db_release(page->dbs[i]);
+    }
+    free(page);
+}
+
+/** Copy page, copy takes a reference to each of its zone databases.
+ *
+ * @param page Page to copy.
+ *
+ * @return     Returns page copy with a single reference.
+ */
+static zone_catalog_page_t *
+zone_catalog_page_copy(const zone_catalog_page_t *page)
+{
+    zone_catalog_page_t *copy = malloc(sizeof(zone_catalog_page_t));
+
+    CHECK_MALLOC(copy);
+    memcpy(copy, page, sizeof(zone_catalog_page_t));
+    for (int i = 0; i < ZONE_CATALOG_PAGE_ZONES; i++) {
+        if (copy->dbs[i] != NULL) {
+            zone_db_ref(copy->dbs[i]);
+        }
+    }
+    copy->refs = 1;
+    return copy;
+}
+
+/** Record error of a zone that could not be loaded.
+ *
+ * @param errs  Errors collected.
+ * @param index Apex index.
+ * @param zone  Zone number.
+ * @param msg   Error message.
+ */
+static void
+zone_catalog_errs_add(zone_catalog_errs_t *errs, const zone_catalog_index_t *index,
+                      uint32_t zone, const char *msg)
+{
+    char apex[RIP_NS_MAXCDNAME * 4 + 1];
+
+    if (errs->count++ != 0) {
+        return;
+    }
+    if (rip_ns_name_ntop(index->names + index->zones[zone].name_offset,
+                         apex, sizeof(apex)) < 0) {
+        snprintf(apex, sizeof(apex), "?");
+    }
+    snprintf(errs->err, errs->err_len, "zone \"%s\" zone file \"%s\" error: %s",
+             apex, index->paths + index->zones[zone].path_offset, msg);
+}
+
+/** Complete collected errors with number of other zones that could not be
+ * loaded.
+ *
+ * @param errs Errors collected.
+ */
+static void
+zone_catalog_errs_end(zone_catalog_errs_t *errs)
+{
+    size_t len;
+
+    if (errs->count > 1 && (len = strlen(errs->err)) + 1 < errs->err_len) {
+        snprintf(errs->err + len, errs->err_len - len, ", and %u more zones",
+                 errs->count - 1);
+    }
+}
+
+/** Load zone database of a zone if its zone file changed since database in
+ * page was loaded. Zone that can not be loaded, or whose zone file has no
+ * SOA record at apex, keeps database it had and is tried again next time.
+ *
+ * @param index      Apex index.
+ * @param zone       Zone number.
+ * @param page       Page zone database is in, MUST be page owned by caller
+ *                   if changed is set.
+ * @param generation Catalog generation.
+ * @param zone_load  Function loading zone database.
+ * @param ctx        Context passed to zone_load.
+ * @param errs       Errors collected.
+ * @param db         Where to store loaded zone database, on change.
+ * @param time       Where to store change time of zone file, on change.
+ *
+ * @return           Returns true if zone database was loaded.
+ */
+static bool
+zone_catalog_zone_load(const zone_catalog_index_t *index, uint32_t zone,
+                       const zone_catalog_page_t *page, uint64_t generation,
+                       zone_catalog_zone_load_fn zone_load, void *ctx,
+                       zone_catalog_errs_t *errs, zone_db_t **db, struct timespec *time)
+{
+    const zone_catalog_zone_t *z          = &index->zones[zone];
+    const unsigned char       *apex       = index->names + z->name_offset;
+    zone_node_t               *node;
+    char                       err_str[ERR_MSG_LENGTH];
+    int                        ret;
+
+    *time      = page->create_times[zone % ZONE_CATALOG_PAGE_ZONES];
+    err_str[0] = '\0';
+    ret = zone_load(ctx, index->paths + z->path_offset, time,
+                    ZONE_CATALOG_GENERATION_BIT | generation << 32 | zone, db,
+                    err_str, sizeof(err_str));
+    if (ret < 0) {
+        zone_catalog_errs_add(errs, index, zone, err_str);
+        return false;
+    }
+    if (ret == 0) {
+        return false;
+    }
+    node = zone_db_lookup(*db, apex, z->name_len);
+    if (node == NULL || !(node->flags & ZONE_NODE_F_APEX)) {
+        zone_catalog_errs_add(errs, index, zone, "no SOA record at zone apex");
+        zone_db_release(*db);
+        return false;
+    }
+    return true;
+}
+
+/** Parse a single catalog file line, adding its zone to apex index.
+ *
+ * @param index     Apex index zone is added to, hash table is not built yet.
+ * @param capacity  Capacity of zones array, updated when array grows.
+ * @param names_len Length of data in names buffer, updated.
+ * @param paths_len Length of data in paths buffer, updated.
+ * @param line      Line to parse, line is modified.
+ * @param line_no   Line number, used in error message.
+ * @param err       Where to store error message.
+ * @param err_len   Length of err buffer.
+ *
+ * @return          Returns 0 on success, otherwise -1.
+ */
+static int
+zone_catalog_parse_line(zone_catalog_index_t *index, uint32_t *capacity,
+                        size_t *names_len, size_t *paths_len, char *line,
+                        uint32_t line_no, char *err, size_t err_len)
+{
+    char                *tokens[ZONE_CATALOG_FILE_TOKENS + 1];
+    char                *save  = NULL;
+    char                *comment;
+    int                  count = 0;
+    unsigned char        wire[RIP_NS_MAXCDNAME + 1];
+    uint16_t             len;
+    zone_catalog_zone_t *zone;
+
+    if ((comment = strchr(line, ';')) != NULL) {
+        *comment = '\0';
+    }
+    for (char *t = strtok_r(line, " \t\r", &save); t != NULL; t = strtok_r(NULL, " \t\r", &save)) {
+        if (count == ZONE_CATALOG_FILE_TOKENS) {
+            count++;
+            break;
+        }
+        tokens[count++] = t;
+    }
+    if (count == 0) {
+        /* Empty line. */
+        return 0;
+    }
+    if (count != ZONE_CATALOG_FILE_TOKENS) {
+        snprintf(err, err_len, "line %u: invalid format", line_no);
+        return -1;
+    }
+    if (rip_ns_name_pton((const unsigned char *)tokens[0], wire, sizeof(wire)) < 0) {
+        snprintf(err, err_len, "line %u: invalid zone apex \"%s\"", line_no, tokens[0]);
+        return -1;
+    }
+    if (index->zones_count == ZONE_CATALOG_ZONES_MAX) {
+        snprintf(err, err_len, "line %u: too many zones", line_no);
+        return -1;
+    }
+    if (index->zones_count == *capacity) {
+        *capacity   = *capacity * 2;
+        index->zones = realloc(index->zones, sizeof(zone_catalog_zone_t) * *capacity);
+        CHECK_MALLOC(index->zones);
+    }
+
+    len  = rip_ns_name_lc(wire);
+    zone = &index->zones[index->zones_count++];
+    *zone = (zone_catalog_zone_t){
+        .hash        = zone_name_hash(wire, len),
+        .name_offset = *names_len,
+        .path_offset = *paths_len,
+        .name_len    = len,
+    };
+    memcpy(index->names + *names_len, wire, len);
+    *names_len += len;
+    memcpy(index->paths + *paths_len, tokens[1], strlen(tokens[1]) + 1);
+    *paths_len += strlen(tokens[1]) + 1;
+    return 0;
+}
+
+/** Build apex index from catalog file contents.
+ *
+ * @param buf     Catalog file contents.
+ * @param buf_len Length of buf.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns apex index with a single reference, or NULL on
+ *                error.
+ */
+static zone_catalog_index_t *
+zone_catalog_index_create(const char *buf, size_t buf_len, char *err, size_t err_len)
+{
+    zone_catalog_index_t *index     = NULL;
+    char                 *line      = NULL;
+    const char           *p         = buf;
+    const char           *end       = buf + buf_len;
+    uint32_t              line_no   = 0;
+    uint32_t              capacity  = 64;
+    uint32_t              size      = 2;
+    size_t                names_len = 0;
+    size_t                paths_len = 0;
+    uint32_t              slot;
+    uint8_t               labels;
+
+    index = calloc(1, sizeof(zone_catalog_index_t));
+    CHECK_MALLOC(index);
+    index->refs       = 1;
+    index->labels_min = UINT8_MAX;
+    index->zones      = malloc(sizeof(zone_catalog_zone_t) * capacity);
+    CHECK_MALLOC(index->zones);
+
+    /* Wire format apex name is at most 2 bytes longer than its text, and
+     * each line holds a separator and apex name text, so names fit into
+     * length of file. Paths are at most as long as file too.
+     */
+    index->names = malloc(buf_len + 2);
+    CHECK_MALLOC(index->names);
+    index->paths = malloc(buf_len + 1);
+    CHECK_MALLOC(index->paths);
+    line = malloc(ZONE_CATALOG_LINE_MAX);
+    CHECK_MALLOC(line);
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t      len = (eol == NULL ? end : eol) - p;
+
+        line_no += 1;
+        if (len >= ZONE_CATALOG_LINE_MAX) {
+            snprintf(err, err_len, "line %u: line too long", line_no);
+            goto ERR_END;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (zone_catalog_parse_line(index, &capacity, &names_len, &paths_len, line,
+                                    line_no, err, err_len) != 0) {
+            goto ERR_END;
+        }
+        p += len + 1;
+    }
+    if (index->zones_count == 0) {
+        snprintf(err, err_len, "no zones");
+        goto ERR_END;
+    }
+
+    /* Hash table is at most half full. */
+    while (size < index->zones_count * 2) {
+        size *= 2;
+    }
+    index->table      = calloc(size, sizeof(uint32_t));
+    CHECK_MALLOC(index->table);
+    index->table_mask = size - 1;
+    for (uint32_t i = 0; i < index->zones_count; i++) {
+        const zone_catalog_zone_t *zone = &index->zones[i];
+        const unsigned char       *name = index->names + zone->name_offset;
+
+        if (zone_catalog_index_lookup(index, name, zone->name_len, zone->hash) != 0) {
+            char apex[RIP_NS_MAXCDNAME * 4 + 1];
+
+            rip_ns_name_ntop(name, apex, sizeof(apex));
+            snprintf(err, err_len, "duplicate zone \"%s\"", apex);
+            goto ERR_END;
+        }
+        for (slot = zone->hash & index->table_mask; index->table[slot] != 0;
+             slot = (slot + 1) & index->table_mask) {
+        }
+        index->table[slot] = i + 1;
+
+        labels = zone_catalog_labels(name);
+        if (labels > index->labels_max) {
+            index->labels_max = labels;
+        }
+        if (labels < index->labels_min) {
+            index->labels_min = labels;
+        }
+    }
+    free(line);
+    return index;
+
+ERR_END:
+    free(line);
+    zone_catalog_index_release(index);
+    return NULL;
+}
+
+/** Create zone catalog from catalog file contents, loading zone database
+ * of each zone. Zone of previous catalog generation with same apex and zone
+ * file keeps its zone database, which is only loaded again if its zone file
+ * changed. Zone whose zone database can not be loaded is kept in catalog,
+ * without zone database or with one of previous generation, and loading it
+ * is retried by @ref zone_catalog_refresh. Its names are answered from main
+ * zone database until it is loaded, and its error is reported through err
+ * while catalog is still created.
+ *
+ * @param buf        Catalog file contents.
+ * @param buf_len    Length of buf.
+ * @param prev       Catalog generation being replaced, NULL if there is none.
+ * @param generation Generation number to assign to catalog.
+ * @param zone_load  Function loading zone database of a zone.
+ * @param ctx        Context passed to zone_load.
+ * @param err        Where to store error message if catalog can not be
+ *                   created, or some of its zones could not be loaded.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to catalog on success, otherwise NULL is
+ *                   returned and err is populated.
+ */
+zone_catalog_t *
+zone_catalog_create(const char *buf, size_t buf_len, const zone_catalog_t *prev,
+                    uint64_t generation, zone_catalog_zone_load_fn zone_load, void *ctx,
+                    char *err, size_t err_len)
+{
+    zone_catalog_t      *catalog;
+    zone_catalog_page_t *page;
+    zone_catalog_errs_t  errs = { .err = err, .err_len = err_len };
+    zone_db_t           *db;
+    struct timespec      time;
+    uint32_t             prev_zone;
+
+    zone_catalog_index_t *index = zone_catalog_index_create(buf, buf_len, err, err_len);
+
+    if (index == NULL) {
+        return NULL;
+    }
+
+    catalog = calloc(1, sizeof(zone_catalog_t));
+    CHECK_MALLOC(catalog);
+    catalog->generation  = generation;
+    catalog->index       = index;
+    catalog->pages_count = (index->zones_count + ZONE_CATALOG_PAGE_ZONES - 1) /
+                           ZONE_CATALOG_PAGE_ZONES;
+    catalog->pages       = malloc(sizeof(zone_catalog_page_t *) * catalog->pages_count);
+    CHECK_MALLOC(catalog->pages);
+    for (uint32_t k = 0; k < catalog->pages_count; k++) {
+        catalog->pages[k] = calloc(1, sizeof(zone_catalog_page_t));
+        CHECK_MALLOC(catalog->pages[k]);
+        catalog->pages[k]->refs = 1;
+    }
+
+    for (uint32_t i = 0; i < index->zones_count; i++) {
+        const zone_catalog_zone_t *zone = &index->zones[i];
+
+        page = catalog->pages[i / ZONE_CATALOG_PAGE_ZONES];
+
+        /* Same zone of previous generation, loaded from same zone file. */
+        prev_zone = prev == NULL ? 0 :
+                    zone_catalog_index_lookup(prev->index, index->names + zone->name_offset,
+                                              zone->name_len, zone->hash);
+        if (prev_zone != 0 &&
+            strcmp(index->paths + zone->path_offset,
+                   prev->index->paths + prev->index->zones[prev_zone - 1].path_offset) == 0) {
+            const zone_catalog_page_t *prev_page =
+                prev->pages[(prev_zone - 1) / ZONE_CATALOG_PAGE_ZONES];
+
+            db = prev_page->dbs[(prev_zone - 1) % ZONE_CATALOG_PAGE_ZONES];
+            page->dbs[i % ZONE_CATALOG_PAGE_ZONES] = db != NULL ? zone_db_ref(db) : NULL;
+            page->create_times[i % ZONE_CATALOG_PAGE_ZONES] =
+                prev_page->create_times[(prev_zone - 1) % ZONE_CATALOG_PAGE_ZONES];
+        }
+
+        if (zone_catalog_zone_load(index, i, page, generation, zone_load, ctx, &errs,
+                                   &db, &time)) {
+            zone_db_release(page->dbs[i % ZONE_CATALOG_PAGE_ZONES]);
+            page->dbs[i % ZONE_CATALOG_PAGE_ZONES]          = db;
+            page->create_times[i % ZONE_CATALOG_PAGE_ZONES] = time;
+            catalog->loaded++;
+        }
+    }
+    zone_catalog_errs_end(&errs);
+    return catalog;
+}
+
+/** Derive new catalog generation from a catalog, loading zone database of
+ * each zone whose zone file changed. New generation shares apex index, and
+ * every page with no changed zone, with catalog it was derived from, so only
+ * pages of changed zones and page array are copied. Zone whose zone database
+ * can not be loaded keeps database it had, its error is reported through
+ * err.
+ *
+ * @param catalog    Catalog generation to derive from.
+ * @param generation Generation number to assign to new catalog.
+ * @param zone_load  Function loading zone database of a zone.
+ * @param ctx        Context passed to zone_load.
+ * @param err        Where to store error message if some zones could not be
+ *                   loaded.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns new catalog generation, or NULL if no zone
+ *                   changed.
+ */
+zone_catalog_t *
+zone_catalog_refresh(const zone_catalog_t *catalog, uint64_t generation,
+                     zone_catalog_zone_load_fn zone_load, void *ctx,
+                     char *err, size_t err_len)
+{
+    const zone_catalog_index_t *index = catalog->index;
+    zone_catalog_t             *next;
+    zone_catalog_page_t        *page;
+    zone_catalog_errs_t         errs  = { .err = err, .err_len = err_len };
+    zone_db_t                  *db;
+    struct timespec             time;
+    uint32_t                    k;
+
+    next = calloc(1, sizeof(zone_catalog_t));
+    CHECK_MALLOC(next);
+    next->generation  = generation;
+    next->index       = catalog->index;
+    next->pages_count = catalog->pages_count;
+    next->pages       = malloc(sizeof(zone_catalog_page_t *) * next->pages_count);
+    CHECK_MALLOC(next->pages);
+    memcpy(next->pages, catalog->pages, sizeof(zone_catalog_page_t *) * next->pages_count);
+
+    for (uint32_t i = 0; i < index->zones_count; i++) {
+        k = i / ZONE_CATALOG_PAGE_ZONES;
+        if (!zone_catalog_zone_load(index, i, next->pages[k], generation, zone_load, ctx,
+                                    &errs, &db, &time)) {
+            continue;
+        }
+        if (next->pages[k] == catalog->pages[k]) {
+            next->pages[k] = zone_catalog_page_copy(catalog->pages[k]);
+        }
+        page = next->pages[k];
+        zone_db_release(page->dbs[i % ZONE_CATALOG_PAGE_ZONES]);
+        page->dbs[i % ZONE_CATALOG_PAGE_ZONES]          = db;
+        page->create_times[i % ZONE_CATALOG_PAGE_ZONES] = time;
+        next->loaded++;
+    }
+    zone_catalog_errs_end(&errs);
+
+    if (next->loaded == 0) {
+        free(next->pages);
+        free(next);
+        return NULL;
+    }
+    next->index->refs++;
+    for (k = 0; k < next->pages_count; k++) {
+        if (next->pages[k] == catalog->pages[k]) {
+            next->pages[k]->refs++;
+        }
+    }
+    return next;
+}
+
+/** Release zone catalog generation, and apex index, pages and zone
+ * databases no other generation references.
+ *
+ * @param catalog Zone catalog to release, may be NULL.
+ */
+void
+zone_catalog_release(zone_catalog_t *catalog)
+{
+    if (catalog == NULL) {
+        return;
+    }
+    for (uint32_t k = 0; k < catalog->pages_count; k++) {
+        zone_catalog_page_release(catalog->pages[k]);
+    }
+    zone_catalog_index_release(catalog->index);
+    free(catalog->pages);
+    free(catalog);
+}
+
+/** Find catalog zone a name is in, zone whose apex is longest ancestor of
+ * name (or name itself). Apex index is probed with name and each of its
+ * ancestors, longest first, starting at ancestor with as many labels as
+ * longest apex name.
+ *
+ * @param catalog  Zone catalog.
+ * @param name     Wire format (lower cased) name.
+ * @param name_len Length of name, including terminating root label.
+ *
+ * @return         Returns zone number + 1, or 0 if name is in no catalog
+ *                 zone or its zone has no zone database loaded.
+ */
+uint32_t
+zone_catalog_find(const zone_catalog_t *catalog, const unsigned char *name,
+                  uint16_t name_len)
+{
+    const zone_catalog_index_t *index = catalog->index;
+    uint16_t                    offsets[RIP_NS_MAXCDNAME / 2 + 1];
+    uint16_t                    count = 0;
+    uint16_t                    off;
+    uint32_t                    zone;
+
+    for (off = 0; off < name_len && name[off] != 0; off += name[off] + 1) {
+        offsets[count++] = off;
+    }
+    offsets[count] = off;
+
+    /* Ancestor with i labels removed has (count - i) labels. */
+    for (uint16_t i = count > index->labels_max ? count - index->labels_max : 0;
+         i <= count && count - i >= index->labels_min; i++) {
+        off  = offsets[i];
+        zone = zone_catalog_index_lookup(index, name + off, name_len - off,
+                                         zone_name_hash(name + off, name_len - off));
+        if (zone != 0) {
+            return zone_catalog_db(catalog, zone) != NULL ? zone : 0;
+        }
+    }
+    return 0;
+}
+
+/** @}*/
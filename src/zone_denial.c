@@ -0,0 +1,634 @@
+/**
+ * @file zone_denial.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup zone
+ *  @{
+ */
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+
+#include "mem.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "zone.h"
+
+/** Maximum number of labels of a wire format name. */
+#define ZONE_NAME_LABELS_MAX ((RIP_NS_MAXCDNAME + 1) / 2)
+
+/** Get denial of existence chain zone apex NSEC3PARAM or NSEC RRset
+ * describes.
+ *
+ * Zone whose apex has a NSEC3PARAM record, of SHA-1 algorithm with flags 0
+ * (RFC 5155, section 4.1.2) and at most @ref ZONE_NSEC3_ITERATIONS_MAX
+ * iterations, gets a NSEC3 chain. Otherwise zone whose apex has a NSEC
+ * record gets a NSEC chain.
+ *
+ * @param db     Zone database.
+ * @param apex   Zone apex node.
+ * @param denial Where to store chain kind and NSEC3 parameters.
+ *
+ * @return       Returns chain kind, see ZONE_DENIAL_* constants.
+ */
+static uint8_t
+zone_denial_params(zone_db_t *db, zone_node_t *apex, zone_denial_t *denial)
+{
+    zone_rrset_t *rrset = zone_node_rrset_get(db, apex, rip_ns_t_nsec3param);
+
+    denial->kind = ZONE_DENIAL_NONE;
+    if (rrset != NULL && rrset->rr_count > 0) {
+        const uint8_t *rdata = rrset->rrs[0].rdata;
+        uint16_t       len   = rrset->rrs[0].rdata_len;
+
+        /* Algorithm, flags, iterations, salt length and salt. */
+        if (len >= 5 && len == 5 + rdata[4] && rdata[0] == ZONE_NSEC3_ALG_SHA1 &&
+            rdata[1] == 0 && (((uint16_t)rdata[2] << 8) | rdata[3]) <= ZONE_NSEC3_ITERATIONS_MAX) {
+            denial->kind       = ZONE_DENIAL_NSEC3;
+            denial->iterations = ((uint16_t)rdata[2] << 8) | rdata[3];
+            denial->salt_len   = rdata[4];
+            memcpy(denial->salt, rdata + 5, rdata[4]);
+            return denial->kind;
+        }
+    }
+    if (zone_node_rrset_get(db, apex, rip_ns_t_nsec) != NULL) {
+        denial->kind = ZONE_DENIAL_NSEC;
+    }
+    return denial->kind;
+}
+
+/** Count zones that get a denial of existence chain, and nodes that can be
+ * an entry of one (nodes that have NSEC or NSEC3 RRset).
+ *
+ * @param db      Zone database, nodes array MUST be built.
+ * @param zones   Where to store number of zones.
+ * @param entries Where to store number of nodes.
+ */
+static void
+zone_denial_count(zone_db_t *db, uint32_t *zones, uint32_t *entries)
+{
+    *zones   = 0;
+    *entries = 0;
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_node_t  *node   = &db->nodes[i];
+        zone_denial_t denial = {};
+
+        if ((node->flags & ZONE_NODE_F_APEX) && zone_denial_params(db, node, &denial)) {
+            *zones += 1;
+        }
+        if (zone_node_rrset_get(db, node, rip_ns_t_nsec) != NULL ||
+            zone_node_rrset_get(db, node, rip_ns_t_nsec3) != NULL) {
+            *entries += 1;
+        }
+    }
+}
+
+/** Get size of database arena space denial of existence chains take, see
+ * @ref zone_db_denial_build().
+ *
+ * @param db Zone database, nodes array MUST be built.
+ *
+ * @return   Returns size in bytes.
+ */
+size_t
+zone_db_denial_size(zone_db_t *db)
+{
+    uint32_t apexes  = 0;
+    uint32_t zones   = 0;
+    uint32_t entries = 0;
+
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        apexes += (db->nodes[i].flags & ZONE_NODE_F_APEX) != 0;
+    }
+    zone_denial_count(db, &zones, &entries);
+
+    return ARENA_OBJ_SIZE(sizeof(uint32_t) * (apexes + 1)) +
+           ARENA_OBJ_SIZE(sizeof(zone_denial_t) * (zones + 1)) +
+           2 * ARENA_OBJ_SIZE(sizeof(zone_denial_entry_t) * (entries + 1));
+}
+
+/** Get NSEC3 owner name of node, a hash label directly below a NSEC3 zone
+ * apex, and decode its hash.
+ *
+ * @param db   Zone database.
+ * @param node Node that has NSEC3 RRset.
+ * @param hash Where to store decoded hash.
+ *
+ * @return     Returns (index + 1) of chain of zone node belongs to, or 0 if
+ *             node is not a NSEC3 chain entry.
+ */
+static uint32_t
+zone_denial_nsec3_owner(zone_db_t *db, zone_node_t *node, uint8_t *hash)
+{
+    zone_node_t *apex = NULL;
+    uint32_t     idx  = 0;
+
+    if (node->name_len < 34 || node->name[0] != 32 ||
+        zone_base32hex_decode((const char *)node->name + 1, 32, hash,
+                              ZONE_NSEC3_HASH_LEN) != ZONE_NSEC3_HASH_LEN) {
+        return 0;
+    }
+    apex = zone_db_lookup(db, node->name + 33, node->name_len - 33);
+    if (apex == NULL || !(apex->flags & ZONE_NODE_F_APEX) ||
+        (idx = db->zone_denials[apex->zone]) == 0 ||
+        db->denials[idx - 1].kind != ZONE_DENIAL_NSEC3) {
+        return 0;
+    }
+    return idx;
+}
+
+/** Add NSEC owner nodes of reverse label tree below tree node, in canonical
+ * order, to chains of their zones.
+ *
+ * @param db     Zone database.
+ * @param t      Tree node index.
+ * @param idx    Chain (index + 1) of zone enclosing tree node, 0 if none.
+ * @param filled Number of entries added to each chain so far, NULL to only
+ *               count entries into chain count.
+ */
+static void
+zone_denial_nsec_walk(zone_db_t *db, uint32_t t, uint32_t idx, uint32_t *filled)
+{
+    zone_tree_node_t *tn = &db->tree[t];
+
+    if (tn->node != 0) {
+        zone_node_t *node = &db->nodes[tn->node - 1];
+
+        if (node->flags & ZONE_NODE_F_APEX) {
+            idx = node->zone < db->zones_count ? db->zone_denials[node->zone] : 0;
+        }
+        if (idx != 0 && db->denials[idx - 1].kind == ZONE_DENIAL_NSEC &&
+            zone_node_rrset_get(db, node, rip_ns_t_nsec) != NULL) {
+            zone_denial_t *denial = &db->denials[idx - 1];
+
+            if (filled == NULL) {
+                denial->count++;
+            } else {
+                db->denial_chain[denial->first + filled[idx - 1]++] =
+                    (zone_denial_entry_t) {.node = tn->node - 1};
+            }
+        }
+    }
+    for (uint32_t i = 0; i < tn->children_count; i++) {
+        zone_denial_nsec_walk(db, tn->children + i, idx, filled);
+    }
+}
+
+/** Compare NSEC3 chain entries by hash, qsort() callback. */
+static int
+zone_denial_hash_cmp(const void *a, const void *b)
+{
+    return memcmp(((const zone_denial_entry_t *)a)->hash,
+                  ((const zone_denial_entry_t *)b)->hash, ZONE_NSEC3_HASH_LEN);
+}
+
+/** Lay sorted chain entries out in Eytzinger order, entry k (counting from
+ * 1) has children 2k and 2k + 1.
+ *
+ * @param sorted Chain entries, sorted.
+ * @param tree   Where to store chain entries in Eytzinger order.
+ * @param i      Index of next sorted entry to place.
+ * @param k      Eytzinger position to place entries of subtree of.
+ * @param n      Number of chain entries.
+ *
+ * @return       Returns index of next sorted entry to place.
+ */
+static uint32_t
+zone_denial_eytzinger(const zone_denial_entry_t *sorted, zone_denial_entry_t *tree,
+                      uint32_t i, uint64_t k, uint32_t n)
+{
+    if (k <= n) {
+        i = zone_denial_eytzinger(sorted, tree, i, 2 * k, n);
+        tree[k - 1] = sorted[i++];
+        i = zone_denial_eytzinger(sorted, tree, i, 2 * k + 1, n);
+    }
+    return i;
+}
+
+/** Build denial of existence chain of each zone of database that has one.
+ *
+ * NSEC chain holds nodes of zone that have NSEC RRset, which pre-order
+ * traversal of reverse label tree visits in canonical order. NSEC3 chain
+ * holds nodes below zone apex whose label is a base32hex encoded hash and
+ * that have NSEC3 RRset, sorted by hash. Chains are allocated from database
+ * arena, which MUST have @ref zone_db_denial_size() bytes left.
+ *
+ * @param db Zone database, reverse label tree and zones array MUST be built.
+ */
+void
+zone_db_denial_build(zone_db_t *db)
+{
+    uint32_t  zones   = 0;
+    uint32_t  entries = 0;
+    uint32_t  pos     = 0;
+    uint32_t *filled  = NULL;
+
+    zone_denial_count(db, &zones, &entries);
+    db->zone_denials         = arena_alloc(&db->arena, sizeof(uint32_t) * (db->zones_count + 1));
+    db->denials              = arena_alloc(&db->arena, sizeof(zone_denial_t) * (zones + 1));
+    db->denial_chain         = arena_alloc(&db->arena, sizeof(zone_denial_entry_t) * (entries + 1));
+    db->denial_tree          = arena_alloc(&db->arena, sizeof(zone_denial_entry_t) * (entries + 1));
+    db->denials_count        = 0;
+    db->denial_entries_count = 0;
+    memset(db->zone_denials, 0, sizeof(uint32_t) * (db->zones_count + 1));
+    if (zones == 0) {
+        return;
+    }
+
+    /* Zones past UINT16_MAX share a zone index and get no chain. */
+    for (uint32_t z = 0; z < db->zones_count && z < UINT16_MAX; z++) {
+        zone_denial_t *denial = &db->denials[db->denials_count];
+
+        *denial = (zone_denial_t) {};
+        if (zone_denial_params(db, &db->nodes[db->zones[z]], denial) != ZONE_DENIAL_NONE) {
+            db->zone_denials[z] = ++db->denials_count;
+        }
+    }
+
+    /* Count entries of each chain, then place chains one after another. */
+    zone_denial_nsec_walk(db, 0, 0, NULL);
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        uint8_t  hash[ZONE_NSEC3_HASH_LEN];
+        uint32_t idx = 0;
+
+        if (zone_node_rrset_get(db, &db->nodes[i], rip_ns_t_nsec3) != NULL &&
+            (idx = zone_denial_nsec3_owner(db, &db->nodes[i], hash)) != 0) {
+            db->denials[idx - 1].count++;
+        }
+    }
+    for (uint32_t d = 0; d < db->denials_count; d++) {
+        db->denials[d].first = pos;
+        pos += db->denials[d].count;
+    }
+    db->denial_entries_count = pos;
+
+    filled = calloc(db->denials_count, sizeof(uint32_t));
+    CHECK_MALLOC(filled);
+    zone_denial_nsec_walk(db, 0, 0, filled);
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_denial_entry_t entry = {.node = i};
+        uint32_t            idx   = 0;
+
+        if (zone_node_rrset_get(db, &db->nodes[i], rip_ns_t_nsec3) != NULL &&
+            (idx = zone_denial_nsec3_owner(db, &db->nodes[i], entry.hash)) != 0) {
+            db->denial_chain[db->denials[idx - 1].first + filled[idx - 1]++] = entry;
+        }
+    }
+    free(filled);
+
+    for (uint32_t d = 0; d < db->denials_count; d++) {
+        zone_denial_t       *denial = &db->denials[d];
+        zone_denial_entry_t *chain  = db->denial_chain + denial->first;
+
+        if (denial->kind == ZONE_DENIAL_NSEC3) {
+            qsort(chain, denial->count, sizeof(zone_denial_entry_t), zone_denial_hash_cmp);
+        }
+        for (uint32_t i = 0; i < denial->count; i++) {
+            chain[i].rank = i;
+        }
+        zone_denial_eytzinger(chain, db->denial_tree + denial->first, 0, 1, denial->count);
+    }
+}
+
+/** Get denial of existence chain of zone.
+ *
+ * @param db   Zone database.
+ * @param apex Zone apex node.
+ *
+ * @return     Returns chain, or NULL if zone has none or it is empty.
+ */
+const zone_denial_t *
+zone_db_denial(zone_db_t *db, const zone_node_t *apex)
+{
+    uint32_t idx = 0;
+
+    if (db->zone_denials == NULL || apex->zone >= db->zones_count ||
+        (idx = db->zone_denials[apex->zone]) == 0 || db->denials[idx - 1].count == 0) {
+        return NULL;
+    }
+    return &db->denials[idx - 1];
+}
+
+/** Get chain entry preceding the one at Eytzinger position k, the position
+ * of first entry greater than searched key upper bound search ended at
+ * (shifted left by number of trailing right turns plus one). Key greater
+ * than or equal to every entry, or less than every entry, is covered by last
+ * entry of chain, chain wraps around.
+ *
+ * @param db     Zone database.
+ * @param denial Denial of existence chain.
+ * @param k      Position upper bound search ended at.
+ *
+ * @return       Returns chain entry.
+ */
+static inline const zone_denial_entry_t *
+zone_denial_predecessor(zone_db_t *db, const zone_denial_t *denial, uint64_t k)
+{
+    uint32_t rank = denial->count - 1;
+
+    k >>= __builtin_ffsll(~k);
+    if (k != 0 && db->denial_tree[denial->first + k - 1].rank != 0) {
+        rank = db->denial_tree[denial->first + k - 1].rank - 1;
+    }
+    return &db->denial_chain[denial->first + rank];
+}
+
+/** Find NSEC owner node of zone that matches or covers name (RFC 4034,
+ * section 4.1.1), the last one in canonical order that is not greater than
+ * name.
+ *
+ * @param db       Zone database.
+ * @param apex     Zone apex node, zone MUST have a NSEC chain.
+ * @param name     Wire format (lower cased) name, in zone.
+ * @param name_len Length of name.
+ *
+ * @return         Returns node, or NULL if zone has no NSEC chain.
+ */
+zone_node_t *
+zone_db_nsec_cover(zone_db_t *db, const zone_node_t *apex, const unsigned char *name,
+                   uint16_t name_len)
+{
+    const zone_denial_t       *denial = zone_db_denial(db, apex);
+    const zone_denial_entry_t *tree   = NULL;
+    uint64_t                   k      = 1;
+
+    if (denial == NULL || denial->kind != ZONE_DENIAL_NSEC) {
+        return NULL;
+    }
+    tree = db->denial_tree + denial->first;
+    while (k <= denial->count) {
+        const zone_node_t *node = &db->nodes[tree[k - 1].node];
+
+        k = 2 * k + (zone_name_canonical_cmp(node->name, node->name_len, name, name_len) <= 0);
+    }
+    return &db->nodes[zone_denial_predecessor(db, denial, k)->node];
+}
+
+/** Find NSEC3 owner node of zone that matches or covers hash (RFC 5155,
+ * section 7.2), the last one in hash order that is not greater than hash.
+ *
+ * @param db    Zone database.
+ * @param apex  Zone apex node, zone MUST have a NSEC3 chain.
+ * @param hash  NSEC3 hash of name, see @ref zone_nsec3_hash().
+ * @param match Where to store whether node hash equals hash.
+ *
+ * @return      Returns node, or NULL if zone has no NSEC3 chain.
+ */
+zone_node_t *
+zone_db_nsec3_cover(zone_db_t *db, const zone_node_t *apex, const uint8_t *hash, bool *match)
+{
+    const zone_denial_t       *denial = zone_db_denial(db, apex);
+    const zone_denial_entry_t *tree   = NULL;
+    const zone_denial_entry_t *entry  = NULL;
+    uint64_t                   k      = 1;
+
+    *match = false;
+    if (denial == NULL || denial->kind != ZONE_DENIAL_NSEC3) {
+        return NULL;
+    }
+    tree = db->denial_tree + denial->first;
+    while (k <= denial->count) {
+        k = 2 * k + (memcmp(tree[k - 1].hash, hash, ZONE_NSEC3_HASH_LEN) <= 0);
+    }
+    entry  = zone_denial_predecessor(db, denial, k);
+    *match = memcmp(entry->hash, hash, ZONE_NSEC3_HASH_LEN) == 0;
+    return &db->nodes[entry->node];
+}
+
+/** Compare wire format names in canonical DNS name order (RFC 4034, section
+ * 6.1), labels compared right to left as unsigned octet strings, and a name
+ * sorts before names it is an ancestor of. Names are expected to already be
+ * lower cased.
+ *
+ * @param a     First name.
+ * @param a_len Length of first name.
+ * @param b     Second name.
+ * @param b_len Length of second name.
+ *
+ * @return      Returns negative, 0 or positive value if first name sorts
+ *              before, same as or after second name.
+ */
+int
+zone_name_canonical_cmp(const unsigned char *a, uint16_t a_len, const unsigned char *b,
+                        uint16_t b_len)
+{
+    uint16_t a_labels[ZONE_NAME_LABELS_MAX];
+    uint16_t b_labels[ZONE_NAME_LABELS_MAX];
+    uint32_t a_count = 0;
+    uint32_t b_count = 0;
+
+    for (uint16_t p = 0; p < a_len && a[p] != 0 && a_count < ZONE_NAME_LABELS_MAX; p += a[p] + 1) {
+        a_labels[a_count++] = p;
+    }
+    for (uint16_t p = 0; p < b_len && b[p] != 0 && b_count < ZONE_NAME_LABELS_MAX; p += b[p] + 1) {
+        b_labels[b_count++] = p;
+    }
+    while (a_count > 0 && b_count > 0) {
+        const unsigned char *la  = a + a_labels[--a_count];
+        const unsigned char *lb  = b + b_labels[--b_count];
+        int                  cmp = memcmp(la + 1, lb + 1, la[0] < lb[0] ? la[0] : lb[0]);
+
+        if (cmp != 0) {
+            return cmp;
+        }
+        if (la[0] != lb[0]) {
+            return la[0] < lb[0] ? -1 : 1;
+        }
+    }
+    return (int)a_count - (int)b_count;
+}
+
+/** Decode base32hex data (RFC 4648, section 7), case insensitive and
+ * without padding, as NSEC3 owner name labels and next hashed owner names
+ * are encoded.
+ *
+ * @param src     Base32hex encoded data.
+ * @param src_len Length of encoded data.
+ * @param dst     Where to store decoded data.
+ * @param dst_len Size of dst buffer.
+ *
+ * @return        Returns length of decoded data, or -1 on error.
+ */
+int
+zone_base32hex_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_len)
+{
+    uint32_t bits  = 0;
+    int      nbits = 0;
+    size_t   len   = 0;
+
+    for (size_t i = 0; i < src_len; i++) {
+        int c = tolower((unsigned char)src[i]);
+        int v = 0;
+
+        if (c >= '0' && c <= '9') {
+            v = c - '0';
+        } else if (c >= 'a' && c <= 'v') {
+            v = c - 'a' + 10;
+        } else {
+            return -1;
+        }
+        bits   = (bits << 5) | v;
+        nbits += 5;
+        if (nbits >= 8) {
+            nbits -= 8;
+            if (len == dst_len) {
+                return -1;
+            }
+            dst[len++] = bits >> nbits;
+        }
+    }
+    return len;
+}
+
+/** Compute NSEC3 hash of name with digest context (RFC 5155, section 5),
+ * SHA-1 of name and salt, then iterations times SHA-1 of previous hash and
+ * salt.
+ *
+ * @param ctx      Digest context.
+ * @param denial   NSEC3 chain, holds salt and iterations.
+ * @param name     Wire format (lower cased) name.
+ * @param name_len Length of name.
+ * @param hash     Where to store @ref ZONE_NSEC3_HASH_LEN bytes of hash.
+ */
+static void
+zone_nsec3_hash_ctx(EVP_MD_CTX *ctx, const zone_denial_t *denial, const unsigned char *name,
+                    uint16_t name_len, uint8_t *hash)
+{
+    const EVP_MD *md = EVP_sha1();
+
+    EVP_DigestInit_ex(ctx, md, NULL);
+    EVP_DigestUpdate(ctx, name, name_len);
+    EVP_DigestUpdate(ctx, denial->salt, denial->salt_len);
+    EVP_DigestFinal_ex(ctx, hash, NULL);
+    for (uint16_t i = 0; i < denial->iterations; i++) {
+        EVP_DigestInit_ex(ctx, md, NULL);
+        EVP_DigestUpdate(ctx, hash, ZONE_NSEC3_HASH_LEN);
+        EVP_DigestUpdate(ctx, denial->salt, denial->salt_len);
+        EVP_DigestFinal_ex(ctx, hash, NULL);
+    }
+}
+
+/** Compute NSEC3 hash of name (RFC 5155, section 5).
+ *
+ * @param denial   NSEC3 chain, holds salt and iterations.
+ * @param name     Wire format (lower cased) name.
+ * @param name_len Length of name.
+ * @param hash     Where to store @ref ZONE_NSEC3_HASH_LEN bytes of hash.
+ */
+void
+zone_nsec3_hash(const zone_denial_t *denial, const unsigned char *name, uint16_t name_len,
+                uint8_t *hash)
+{
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+
+    CHECK_MALLOC(ctx);
+    zone_nsec3_hash_ctx(ctx, denial, name, name_len, hash);
+    EVP_MD_CTX_free(ctx);
+}
+
+/** Initialize NSEC3 hash cache.
+ *
+ * @param cache Cache to initialize.
+ * @param size  Number of cache entries, rounded up to a power of 2, 0
+ *              disables cache (hashes are still computed with cache digest
+ *              context).
+ *
+ * @return      Returns 0 on success, -1 if memory could not be allocated.
+ */
+int
+zone_nsec3_cache_init(zone_nsec3_cache_t *cache, uint32_t size)
+{
+    uint32_t slots = 1;
+
+    *cache = (zone_nsec3_cache_t) {};
+    if ((cache->md_ctx = EVP_MD_CTX_new()) == NULL) {
+        return -1;
+    }
+    if (size == 0) {
+        return 0;
+    }
+    while (slots < size) {
+        slots <<= 1;
+    }
+    cache->entries = mem_calloc(MEM_TAG_DNSSEC, slots, sizeof(zone_nsec3_cache_entry_t));
+    if (cache->entries == NULL) {
+        zone_nsec3_cache_clean(cache);
+        return -1;
+    }
+    cache->mask = slots - 1;
+    return 0;
+}
+
+/** Release NSEC3 hash cache memory.
+ *
+ * @param cache Cache to clean.
+ */
+void
+zone_nsec3_cache_clean(zone_nsec3_cache_t *cache)
+{
+    mem_free(MEM_TAG_DNSSEC, cache->entries);
+    EVP_MD_CTX_free(cache->md_ctx);
+    *cache = (zone_nsec3_cache_t) {};
+}
+
+/** Get NSEC3 hash of name, from cache if it holds one for same database
+ * generation and chain, otherwise compute it and store it into cache.
+ *
+ * @param cache    NSEC3 hash cache, NULL to always compute hash.
+ * @param db       Zone database chain belongs to.
+ * @param denial   NSEC3 chain, holds salt and iterations.
+ * @param name     Wire format (lower cased) name.
+ * @param name_len Length of name.
+ * @param hash     Where to store @ref ZONE_NSEC3_HASH_LEN bytes of hash.
+ */
+void
+zone_nsec3_hash_cached(zone_nsec3_cache_t *cache, zone_db_t *db, const zone_denial_t *denial,
+                       const unsigned char *name, uint16_t name_len, uint8_t *hash)
+{
+    zone_nsec3_cache_entry_t *entry = NULL;
+
+    if (cache == NULL || cache->md_ctx == NULL) {
+        zone_nsec3_hash(denial, name, name_len, hash);
+        return;
+    }
+    if (cache->entries != NULL) {
+        entry = &cache->entries[rip_ns_name_hash(name, name_len) & cache->mask];
+        if (entry->generation == db->generation && entry->denial == denial &&
+            entry->name_len == name_len && memcmp(entry->name, name, name_len) == 0) {
+            memcpy(hash, entry->hash, ZONE_NSEC3_HASH_LEN);
+            return;
+        }
+    }
+    zone_nsec3_hash_ctx(cache->md_ctx, denial, name, name_len, hash);
+    if (entry != NULL) {
+        entry->generation = db->generation;
+        entry->denial     = denial;
+        entry->name_len   = name_len;
+        memcpy(entry->hash, hash, ZONE_NSEC3_HASH_LEN);
+        memcpy(entry->name, name, name_len);
+    }
+}
+
+/** @}*/
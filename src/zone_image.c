@@ -0,0 +1,782 @@
+/**
+ * @file zone_image.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup zone
+ *  @{
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "zone.h"
+
+/** Zone image format version. */
+#define ZONE_IMAGE_VERSION 6
+
+/** Zone image sections are aligned to this many bytes. */
+#define ZONE_IMAGE_ALIGN 8
+
+/** Zone image sections. */
+enum zone_image_sections {
+    ZONE_IMAGE_NODES = 0,
+    ZONE_IMAGE_TABLE,
+    ZONE_IMAGE_RRSETS,
+    ZONE_IMAGE_RRS,
+    ZONE_IMAGE_NAMES,
+    ZONE_IMAGE_TEXTS,
+    ZONE_IMAGE_RDATA,
+    ZONE_IMAGE_WIRE,
+    ZONE_IMAGE_XFRS,
+    ZONE_IMAGE_XFR_MSGS,
+    ZONE_IMAGE_XFR_DATA,
+    ZONE_IMAGE_MPHF_PILOTS,
+    ZONE_IMAGE_MPHF_REMAP,
+    ZONE_IMAGE_SYNTHS,
+    ZONE_IMAGE_SECTIONS_COUNT
+};
+
+/** Structure describes a zone image section. */
+typedef struct zone_image_section_s {
+    /** Offset of section from start of image. */
+    uint64_t offset;
+
+    /** Length of section. */
+    uint64_t len;
+} zone_image_section_t;
+
+/** Structure describes zone image header, found at start of image. */
+typedef struct zone_image_hdr_s {
+    /** Magic bytes, ZONE_IMAGE_MAGIC. */
+    char magic[ZONE_IMAGE_MAGIC_LEN];
+
+    /** Zone image format version. */
+    uint32_t version;
+
+    /** Hash table mask, 0 if image has a minimal perfect hash function of
+     * node names instead.
+     */
+    uint32_t table_mask;
+
+    /** Number of nodes. */
+    uint32_t nodes_count;
+
+    /** Number of RRsets. */
+    uint32_t rrsets_count;
+
+    /** Number of resource records. */
+    uint32_t rrs_count;
+
+    /** Padding, 0. */
+    uint32_t pad;
+
+    /** Image sections. */
+    zone_image_section_t sections[ZONE_IMAGE_SECTIONS_COUNT];
+
+    /** Seed of minimal perfect hash function of node names. */
+    uint64_t mphf_seed;
+} zone_image_hdr_t;
+
+/** Structure describes a zone image node, see @ref zone_node_t. */
+typedef struct zone_image_node_s {
+    uint32_t hash;
+    uint32_t name_offset;
+    uint32_t rrset_index;
+    uint16_t name_len;
+    uint16_t rrset_count;
+    uint8_t  flags;
+    uint8_t  pad[3];
+} zone_image_node_t;
+
+/** Structure describes a zone image RRset, see @ref zone_rrset_t. */
+typedef struct zone_image_rrset_s {
+    uint32_t rr_index;
+    uint32_t wire_offset;
+    uint32_t neg_wire_offset;
+    uint16_t type;
+    uint16_t rr_count;
+    uint16_t wire_len;
+    uint16_t wire_ancount;
+    uint16_t wire_arcount;
+    uint16_t wire_an_len;
+    uint16_t neg_wire_len;
+    uint16_t neg_wire_base;
+    uint8_t  wire_fits;
+    uint8_t  pad[3];
+} zone_image_rrset_t;
+
+/** Structure describes a zone image resource record, see @ref rr_record_t. */
+typedef struct zone_image_rr_s {
+    uint32_t text_offset;
+    uint32_t rdata_offset;
+    uint32_t ttl;
+    uint16_t text_len;
+    uint16_t type;
+    uint16_t class;
+    uint16_t rdata_len;
+} zone_image_rr_t;
+
+/** Structure describes a string added to a zone image string pool. */
+typedef struct zone_image_str_s {
+    /** String bytes. */
+    const unsigned char *data;
+
+    /** Length of string. */
+    uint32_t len;
+
+    /** Index of string offset in pool offsets array. */
+    uint32_t index;
+} zone_image_str_t;
+
+/** Compare strings by their reversed bytes, qsort() comparator. A string
+ * that is a suffix of another sorts right before strings it is a suffix of.
+ *
+ * @param a First string.
+ * @param b Second string.
+ *
+ * @return  Returns negative, 0 or positive number if first reversed string
+ *          sorts before, same as, or after second.
+ */
+static int
+zone_image_str_cmp(const void *a, const void *b)
+{
+    const zone_image_str_t *sa = a;
+    const zone_image_str_t *sb = b;
+    uint32_t                n  = sa->len < sb->len ? sa->len : sb->len;
+
+    for (uint32_t i = 1; i <= n; i++) {
+        int diff = sa->data[sa->len - i] - sb->data[sb->len - i];
+
+        if (diff != 0) {
+            return diff;
+        }
+    }
+    return sa->len < sb->len ? -1 : sa->len > sb->len;
+}
+
+/** Build a string pool, each string is stored once and a string that is a
+ * suffix of another string is stored as tail of it. Owner names of a zone
+ * are repeated by every record of name and share suffixes with names below
+ * them (an ancestor is a suffix of its descendants), so most names take no
+ * space of their own, and a name in pool is still contiguous.
+ *
+ * @param strs     Strings, array is reordered.
+ * @param count    Number of strings.
+ * @param offsets  Pool offset of each string, indexed by string index.
+ * @param pool_len Where to store length of pool.
+ *
+ * @return         Returns pool buffer, caller frees it.
+ */
+static unsigned char *
+zone_image_pool_build(zone_image_str_t *strs, size_t count, uint32_t *offsets,
+                      size_t *pool_len)
+{
+    const zone_image_str_t *prev = NULL;
+    unsigned char          *pool = NULL;
+    size_t                  size = 1;
+    size_t                  len  = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size += strs[i].len;
+    }
+    pool = malloc(size);
+    CHECK_MALLOC(pool);
+
+    /* In descending order a string is reached right after the string it is a
+     * suffix of (if any) was stored.
+     */
+    qsort(strs, count, sizeof(zone_image_str_t), zone_image_str_cmp);
+    for (size_t i = count; i-- > 0;) {
+        const zone_image_str_t *s = &strs[i];
+
+        if (prev != NULL && s->len <= prev->len &&
+            memcmp(prev->data + prev->len - s->len, s->data, s->len) == 0) {
+            offsets[s->index] = offsets[prev->index] + prev->len - s->len;
+            continue;
+        }
+        offsets[s->index] = len;
+        memcpy(pool + len, s->data, s->len);
+        len += s->len;
+        prev = s;
+    }
+    *pool_len = len;
+    return pool;
+}
+
+/** Write a zone image section to file, section is padded to
+ * ZONE_IMAGE_ALIGN bytes.
+ *
+ * @param fd      File to write to.
+ * @param hdr     Image header, section offset and length are set.
+ * @param section Section to write.
+ * @param data    Section data.
+ * @param len     Length of section data.
+ * @param offset  Pointer to offset of section in image, advanced past
+ *                section.
+ *
+ * @return        Returns 0 on success, otherwise -1 and errno is set.
+ */
+static int
+zone_image_section_write(int fd, zone_image_hdr_t *hdr, int section, const void *data,
+                         size_t len, uint64_t *offset)
+{
+    static const uint8_t pad[ZONE_IMAGE_ALIGN] = {};
+    size_t               pad_len = (ZONE_IMAGE_ALIGN - len % ZONE_IMAGE_ALIGN) % ZONE_IMAGE_ALIGN;
+
+    hdr->sections[section].offset = *offset;
+    hdr->sections[section].len = len;
+    if (utl_writeall(fd, (void *)data, len, NULL, 0) != 0 ||
+        utl_writeall(fd, (void *)pad, pad_len, NULL, 0) != 0) {
+        return -1;
+    }
+    *offset += len + pad_len;
+    return 0;
+}
+
+/** Compare zone transfers by zone apex node index, qsort() comparator.
+ *
+ * @param a First zone transfer.
+ * @param b Second zone transfer.
+ *
+ * @return  Returns negative, 0 or positive number if first apex index is
+ *          lower than, same as, or higher than second.
+ */
+static int
+zone_image_xfr_cmp(const void *a, const void *b)
+{
+    const zone_xfr_t *xa = a;
+    const zone_xfr_t *xb = b;
+
+    return xa->apex < xb->apex ? -1 : xa->apex > xb->apex;
+}
+
+/** Write zone database into a zone image file.
+ *
+ * Image is written to a temporary file which is then renamed to filepath, so
+ * a reload never sees a partially written image.
+ *
+ * A minimal perfect hash function of node names is built and image nodes
+ * are ordered by slot of their name, so image needs no hash table. Should
+ * build fail, nodes keep database order and hash table is written instead.
+ *
+ * @param db       Zone database built from zone file, MUST not be derived
+ *                 from a base by a delta.
+ * @param filepath Path of zone image file.
+ * @param err      Where to store error message if error was encountered.
+ * @param err_len  Length of err buffer.
+ *
+ * @return         Returns 0 on success, otherwise -1 and err is populated.
+ */
+int
+zone_db_image_write(zone_db_t *db, const char *filepath, char *err, size_t err_len)
+{
+    zone_image_hdr_t    hdr    = {
+        .magic        = ZONE_IMAGE_MAGIC,
+        .version      = ZONE_IMAGE_VERSION,
+        .table_mask   = db->table_mask,
+        .nodes_count  = db->nodes_count,
+        .rrsets_count = db->rrsets_count,
+        .rrs_count    = db->rrs_count,
+    };
+    zone_image_node_t  *nodes  = calloc(db->nodes_count + 1, sizeof(zone_image_node_t));
+    zone_image_rrset_t *rrsets = calloc(db->rrsets_count + 1, sizeof(zone_image_rrset_t));
+    zone_image_rr_t    *rrs    = calloc(db->rrs_count + 1, sizeof(zone_image_rr_t));
+    uint64_t           *keys   = malloc(sizeof(uint64_t) * (db->nodes_count + 1));
+    uint32_t           *slots  = malloc(sizeof(uint32_t) * (db->nodes_count + 1));
+    uint16_t           *pilots = malloc(sizeof(uint16_t) * mphf_pilots_count(db->nodes_count));
+    uint32_t           *remap  = malloc(sizeof(uint32_t) * mphf_remap_count(db->nodes_count));
+    zone_xfr_t         *xfrs   = NULL;
+    zone_image_str_t   *strs   = malloc(sizeof(zone_image_str_t) *
+                                        ((db->nodes_count > db->rrs_count ?
+                                          db->nodes_count : db->rrs_count) + 1));
+    uint32_t           *name_offsets = malloc(sizeof(uint32_t) * (db->nodes_count + 1));
+    uint32_t           *text_offsets = malloc(sizeof(uint32_t) * (db->rrs_count + 1));
+    unsigned char      *names  = NULL;
+    unsigned char      *texts  = NULL;
+    size_t              names_len = 0;
+    size_t              texts_len = 0;
+    size_t              pilots_count = 0;
+    size_t              remap_count  = 0;
+    mphf_t              mphf;
+    char                tmp_path[FILE_REALPATH_MAX + 8];
+    uint64_t            offset = sizeof(zone_image_hdr_t);
+    int                 fd     = -1;
+    int                 ret    = -1;
+
+    CHECK_MALLOC(nodes);
+    CHECK_MALLOC(rrsets);
+    CHECK_MALLOC(rrs);
+    CHECK_MALLOC(keys);
+    CHECK_MALLOC(slots);
+    CHECK_MALLOC(pilots);
+    CHECK_MALLOC(remap);
+    CHECK_MALLOC(strs);
+    CHECK_MALLOC(name_offsets);
+    CHECK_MALLOC(text_offsets);
+
+    if (db->base != NULL) {
+        snprintf(err, err_len, "zone database has a delta applied");
+        goto END;
+    }
+    if (db->xfrs == NULL && zone_db_xfr_compile(db, err, err_len) != 0) {
+        goto END;
+    }
+
+    /* Image node index is slot of node name. */
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        keys[i]  = rip_ns_name_hash(db->nodes[i].name, db->nodes[i].name_len);
+        slots[i] = i;
+    }
+    if (db->nodes_count > 0 && mphf_build(&mphf, pilots, remap, keys, db->nodes_count) == 0) {
+        for (uint32_t i = 0; i < db->nodes_count; i++) {
+            slots[i] = mphf_lookup(&mphf, keys[i]);
+        }
+        pilots_count   = mphf_pilots_count(db->nodes_count);
+        remap_count    = mphf_remap_count(db->nodes_count);
+        hdr.table_mask = 0;
+        hdr.mphf_seed  = mphf.seed;
+    }
+    xfrs = malloc(sizeof(zone_xfr_t) * (db->xfrs_count + 1));
+    CHECK_MALLOC(xfrs);
+    for (uint32_t i = 0; i < db->xfrs_count; i++) {
+        xfrs[i] = db->xfrs[i];
+        xfrs[i].apex = slots[xfrs[i].apex];
+    }
+    qsort(xfrs, db->xfrs_count, sizeof(zone_xfr_t), zone_image_xfr_cmp);
+
+    /* Node names and record presentation names (with terminating '\0') are
+     * stored in pools.
+     */
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        strs[i] = (zone_image_str_t) { db->nodes[i].name, db->nodes[i].name_len, i };
+    }
+    names = zone_image_pool_build(strs, db->nodes_count, name_offsets, &names_len);
+    for (uint32_t i = 0; i < db->rrs_count; i++) {
+        strs[i] = (zone_image_str_t) { db->rrs[i].name, db->rrs[i].name_len + 1U, i };
+    }
+    texts = zone_image_pool_build(strs, db->rrs_count, text_offsets, &texts_len);
+
+    /* Pointers are turned into offsets and indexes. */
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_node_t *node = &db->nodes[i];
+
+        nodes[slots[i]] = (zone_image_node_t) {
+            .hash        = node->hash,
+            .name_offset = name_offsets[i],
+            .rrset_index = node->rrset_count > 0 ? node->rrsets - db->rrsets : 0,
+            .name_len    = node->name_len,
+            .rrset_count = node->rrset_count,
+            .flags       = node->flags,
+        };
+    }
+    for (uint32_t i = 0; i < db->rrsets_count; i++) {
+        zone_rrset_t *rrset = &db->rrsets[i];
+
+        rrsets[i] = (zone_image_rrset_t) {
+            .rr_index     = rrset->rrs - db->rrs,
+            .wire_offset     = rrset->wire_offset,
+            .neg_wire_offset = rrset->neg_wire_offset,
+            .type            = rrset->type,
+            .rr_count        = rrset->rr_count,
+            .wire_len        = rrset->wire_len,
+            .wire_ancount    = rrset->wire_ancount,
+            .wire_arcount    = rrset->wire_arcount,
+            .wire_an_len     = rrset->wire_an_len,
+            .neg_wire_len    = rrset->neg_wire_len,
+            .neg_wire_base   = rrset->neg_wire_base,
+            .wire_fits       = rrset->wire_fits,
+        };
+    }
+    for (uint32_t i = 0; i < db->rrs_count; i++) {
+        rr_record_t *rr = &db->rrs[i];
+
+        rrs[i] = (zone_image_rr_t) {
+            .text_offset  = text_offsets[i],
+            .rdata_offset = rr->rdata - db->rdata,
+            .ttl          = rr->ttl,
+            .text_len     = rr->name_len,
+            .type         = rr->type,
+            .class        = rr->class,
+            .rdata_len    = rr->rdata_len,
+        };
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filepath);
+    if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0 ||
+        lseek(fd, offset, SEEK_SET) < 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_NODES, nodes,
+                                 sizeof(zone_image_node_t) * db->nodes_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_TABLE, db->table,
+                                 pilots_count > 0 ? 0 : sizeof(uint32_t) * (db->table_mask + 1),
+                                 &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_RRSETS, rrsets,
+                                 sizeof(zone_image_rrset_t) * db->rrsets_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_RRS, rrs,
+                                 sizeof(zone_image_rr_t) * db->rrs_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_NAMES, names,
+                                 names_len, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_TEXTS, texts,
+                                 texts_len, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_RDATA, db->rdata,
+                                 db->rdata_len, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_WIRE, db->wire,
+                                 db->wire_len, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_XFRS, xfrs,
+                                 sizeof(zone_xfr_t) * db->xfrs_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_XFR_MSGS, db->xfr_msgs,
+                                 sizeof(zone_xfr_msg_t) * db->xfr_msgs_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_XFR_DATA, db->xfr_data,
+                                 db->xfr_data_len, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_MPHF_PILOTS, pilots,
+                                 sizeof(uint16_t) * pilots_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_MPHF_REMAP, remap,
+                                 sizeof(uint32_t) * remap_count, &offset) != 0 ||
+        zone_image_section_write(fd, &hdr, ZONE_IMAGE_SYNTHS, db->synths,
+                                 sizeof(zone_synth_t) * db->synths_count, &offset) != 0 ||
+        lseek(fd, 0, SEEK_SET) < 0 ||
+        utl_writeall(fd, &hdr, sizeof(hdr), NULL, 0) != 0 ||
+        fsync(fd) != 0) {
+        snprintf(err, err_len, "error writing \"%s\": %s", tmp_path, strerror(errno));
+        goto END;
+    }
+    if (rename(tmp_path, filepath) != 0) {
+        snprintf(err, err_len, "error renaming \"%s\": %s", tmp_path, strerror(errno));
+        goto END;
+    }
+    ret = 0;
+
+END:
+    if (fd >= 0) {
+        close(fd);
+        if (ret != 0) {
+            unlink(tmp_path);
+        }
+    }
+    free(nodes);
+    free(rrsets);
+    free(rrs);
+    free(keys);
+    free(slots);
+    free(pilots);
+    free(remap);
+    free(xfrs);
+    free(strs);
+    free(name_offsets);
+    free(text_offsets);
+    free(names);
+    free(texts);
+    return ret;
+}
+
+/** Check whether data starts with zone image magic bytes.
+ *
+ * @param buf     Data to check.
+ * @param buf_len Length of data.
+ *
+ * @return        Returns true if data is a zone image.
+ */
+bool
+zone_image_is(const void *buf, size_t buf_len)
+{
+    return buf_len >= ZONE_IMAGE_MAGIC_LEN &&
+           memcmp(buf, ZONE_IMAGE_MAGIC, ZONE_IMAGE_MAGIC_LEN) == 0;
+}
+
+/** Load zone database from zone image file.
+ *
+ * Image is memory mapped read only. Hash table or minimal perfect hash
+ * function, names, rdata and precompiled response fragments are used in place, node, RRset and resource record
+ * arrays are built from image with offsets turned into pointers. Every offset
+ * and index is bounds checked so a corrupt image is rejected rather than
+ * used.
+ *
+ * Zone transfer messages are sent from image file, if image has any a
+ * duplicate of fd is kept open by database.
+ *
+ * @param fd         Open zone image file, file can be closed once loaded.
+ * @param len        Length of zone image file.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message if error was encountered.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns pointer to zone database on success, otherwise
+ *                   NULL is returned and err is populated.
+ */
+zone_db_t *
+zone_db_image_load(int fd, size_t len, uint64_t generation, char *err, size_t err_len)
+{
+    const zone_image_hdr_t   *hdr    = NULL;
+    const zone_image_node_t  *nodes  = NULL;
+    const zone_image_rrset_t *rrsets = NULL;
+    const zone_image_rr_t    *rrs    = NULL;
+    const uint32_t           *table  = NULL;
+    const uint16_t           *pilots = NULL;
+    const uint32_t           *remap  = NULL;
+    const uint8_t            *image  = NULL;
+    zone_db_t                *db     = NULL;
+    size_t                    table_size;
+    size_t                    pilots_count = 0;
+    size_t                    remap_count  = 0;
+    bool                      has_mphf;
+
+    if (len < sizeof(zone_image_hdr_t)) {
+        snprintf(err, err_len, "zone image too short");
+        return NULL;
+    }
+    image = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED) {
+        snprintf(err, err_len, "zone image mmap error: %s", strerror(errno));
+        return NULL;
+    }
+    hdr = (const zone_image_hdr_t *)image;
+
+    /* Header and sections. */
+    table_size = (size_t)hdr->table_mask + 1;
+    has_mphf   = hdr->sections[ZONE_IMAGE_MPHF_PILOTS].len > 0;
+    if (has_mphf) {
+        /* Nodes are ordered by minimal perfect hash function, no table. */
+        table_size   = 0;
+        pilots_count = mphf_pilots_count(hdr->nodes_count);
+        remap_count  = mphf_remap_count(hdr->nodes_count);
+    }
+    if (!zone_image_is(image, len) || hdr->version != ZONE_IMAGE_VERSION ||
+        (has_mphf && (hdr->table_mask != 0 || hdr->nodes_count == 0)) ||
+        (!has_mphf && ((table_size & hdr->table_mask) != 0 ||
+                       (size_t)hdr->nodes_count * 2 > table_size))) {
+        snprintf(err, err_len, "zone image header invalid");
+        goto ERR_END;
+    }
+    for (int i = 0; i < ZONE_IMAGE_SECTIONS_COUNT; i++) {
+        const zone_image_section_t *s = &hdr->sections[i];
+
+        if (s->offset % ZONE_IMAGE_ALIGN != 0 || s->offset > len || s->len > len - s->offset) {
+            snprintf(err, err_len, "zone image section %d out of bounds", i);
+            goto ERR_END;
+        }
+    }
+    if (hdr->sections[ZONE_IMAGE_NODES].len != sizeof(zone_image_node_t) * hdr->nodes_count ||
+        hdr->sections[ZONE_IMAGE_TABLE].len != sizeof(uint32_t) * table_size ||
+        hdr->sections[ZONE_IMAGE_RRSETS].len != sizeof(zone_image_rrset_t) * hdr->rrsets_count ||
+        hdr->sections[ZONE_IMAGE_RRS].len != sizeof(zone_image_rr_t) * hdr->rrs_count ||
+        hdr->sections[ZONE_IMAGE_XFRS].len % sizeof(zone_xfr_t) != 0 ||
+        hdr->sections[ZONE_IMAGE_XFR_MSGS].len % sizeof(zone_xfr_msg_t) != 0 ||
+        hdr->sections[ZONE_IMAGE_MPHF_PILOTS].len != sizeof(uint16_t) * pilots_count ||
+        hdr->sections[ZONE_IMAGE_MPHF_REMAP].len != sizeof(uint32_t) * remap_count ||
+        hdr->sections[ZONE_IMAGE_SYNTHS].len % sizeof(zone_synth_t) != 0 ||
+        hdr->sections[ZONE_IMAGE_SYNTHS].len > sizeof(zone_synth_t) * ZONE_SYNTH_RULES_MAX) {
+        snprintf(err, err_len, "zone image section length invalid");
+        goto ERR_END;
+    }
+    nodes  = (const void *)(image + hdr->sections[ZONE_IMAGE_NODES].offset);
+    table  = (const void *)(image + hdr->sections[ZONE_IMAGE_TABLE].offset);
+    rrsets = (const void *)(image + hdr->sections[ZONE_IMAGE_RRSETS].offset);
+    rrs    = (const void *)(image + hdr->sections[ZONE_IMAGE_RRS].offset);
+    pilots = (const void *)(image + hdr->sections[ZONE_IMAGE_MPHF_PILOTS].offset);
+    remap  = (const void *)(image + hdr->sections[ZONE_IMAGE_MPHF_REMAP].offset);
+
+    db = calloc(1, sizeof(zone_db_t));
+    CHECK_MALLOC(db);
+    db->generation   = generation;
+    db->refs         = 1;
+    db->image_fd     = -1;
+    db->image        = (void *)image;
+    db->image_len    = len;
+    db->table        = has_mphf ? NULL : (uint32_t *)table;
+    db->table_mask   = hdr->table_mask;
+    db->names        = (unsigned char *)image + hdr->sections[ZONE_IMAGE_NAMES].offset;
+    db->names_len    = hdr->sections[ZONE_IMAGE_NAMES].len;
+    db->texts        = (unsigned char *)image + hdr->sections[ZONE_IMAGE_TEXTS].offset;
+    db->texts_len    = hdr->sections[ZONE_IMAGE_TEXTS].len;
+    db->rdata        = (uint8_t *)image + hdr->sections[ZONE_IMAGE_RDATA].offset;
+    db->rdata_len    = hdr->sections[ZONE_IMAGE_RDATA].len;
+    db->wire         = (uint8_t *)image + hdr->sections[ZONE_IMAGE_WIRE].offset;
+    db->wire_len     = hdr->sections[ZONE_IMAGE_WIRE].len;
+    db->xfrs         = (zone_xfr_t *)(image + hdr->sections[ZONE_IMAGE_XFRS].offset);
+    db->xfrs_count   = hdr->sections[ZONE_IMAGE_XFRS].len / sizeof(zone_xfr_t);
+    db->xfr_msgs     = (zone_xfr_msg_t *)(image + hdr->sections[ZONE_IMAGE_XFR_MSGS].offset);
+    db->xfr_msgs_count = hdr->sections[ZONE_IMAGE_XFR_MSGS].len / sizeof(zone_xfr_msg_t);
+    db->xfr_data     = (uint8_t *)image + hdr->sections[ZONE_IMAGE_XFR_DATA].offset;
+    db->xfr_data_len = hdr->sections[ZONE_IMAGE_XFR_DATA].len;
+    db->xfr_data_file_offset = hdr->sections[ZONE_IMAGE_XFR_DATA].offset;
+    db->synths       = (zone_synth_t *)(image + hdr->sections[ZONE_IMAGE_SYNTHS].offset);
+    db->synths_count = hdr->sections[ZONE_IMAGE_SYNTHS].len / sizeof(zone_synth_t);
+    db->nodes        = malloc(sizeof(zone_node_t) * (hdr->nodes_count + 1));
+    CHECK_MALLOC(db->nodes);
+    db->rrsets       = malloc(sizeof(zone_rrset_t) * (hdr->rrsets_count + 1));
+    CHECK_MALLOC(db->rrsets);
+    db->rrs          = malloc(sizeof(rr_record_t) * (hdr->rrs_count + 1));
+    CHECK_MALLOC(db->rrs);
+
+    /* Resource records. */
+    for (uint32_t i = 0; i < hdr->rrs_count; i++) {
+        const zone_image_rr_t *rr = &rrs[i];
+
+        if ((size_t)rr->text_offset + rr->text_len >= db->texts_len ||
+            db->texts[rr->text_offset + rr->text_len] != '\0' ||
+            (size_t)rr->rdata_offset + rr->rdata_len > db->rdata_len) {
+            snprintf(err, err_len, "zone image record %u out of bounds", i);
+            goto ERR_END;
+        }
+        db->rrs[i] = (rr_record_t) {
+            .name      = db->texts + rr->text_offset,
+            .name_len  = rr->text_len,
+            .type      = rr->type,
+            .class     = rr->class,
+            .ttl       = rr->ttl,
+            .rdata_len = rr->rdata_len,
+            .rdata     = db->rdata + rr->rdata_offset,
+        };
+    }
+    db->rrs_count = hdr->rrs_count;
+
+    /* RRsets. */
+    for (uint32_t i = 0; i < hdr->rrsets_count; i++) {
+        const zone_image_rrset_t *rrset = &rrsets[i];
+
+        if ((size_t)rrset->rr_index + rrset->rr_count > hdr->rrs_count ||
+            (size_t)rrset->wire_offset + rrset->wire_len > db->wire_len ||
+            (size_t)rrset->neg_wire_offset + rrset->neg_wire_len > db->wire_len ||
+            rrset->wire_an_len > rrset->wire_len ||
+            (rrset->neg_wire_len > 0 && rrset->type != rip_ns_t_soa)) {
+            snprintf(err, err_len, "zone image RRset %u out of bounds", i);
+            goto ERR_END;
+        }
+        db->rrsets[i] = (zone_rrset_t) {
+            .type         = rrset->type,
+            .rr_count     = rrset->rr_count,
+            .rrs          = &db->rrs[rrset->rr_index],
+            .wire            = rrset->wire_len > 0 ? db->wire + rrset->wire_offset : NULL,
+            .neg_wire        = rrset->neg_wire_len > 0 ?
+                               db->wire + rrset->neg_wire_offset : NULL,
+            .wire_offset     = rrset->wire_offset,
+            .neg_wire_offset = rrset->neg_wire_offset,
+            .wire_len        = rrset->wire_len,
+            .wire_ancount    = rrset->wire_ancount,
+            .wire_arcount    = rrset->wire_arcount,
+            .wire_an_len     = rrset->wire_an_len,
+            .neg_wire_len    = rrset->neg_wire_len,
+            .neg_wire_base   = rrset->neg_wire_base,
+            .wire_fits       = rrset->wire_fits,
+        };
+    }
+    db->rrsets_count = hdr->rrsets_count;
+
+    /* Nodes. */
+    for (uint32_t i = 0; i < hdr->nodes_count; i++) {
+        const zone_image_node_t *node = &nodes[i];
+
+        if ((size_t)node->name_offset + node->name_len > db->names_len ||
+            (size_t)node->rrset_index + node->rrset_count > hdr->rrsets_count) {
+            snprintf(err, err_len, "zone image node %u out of bounds", i);
+            goto ERR_END;
+        }
+        db->nodes[i] = (zone_node_t) {
+            .hash        = node->hash,
+            .name        = db->names + node->name_offset,
+            .name_len    = node->name_len,
+            .rrset_count = node->rrset_count,
+            .rrsets      = &db->rrsets[node->rrset_index],
+            .flags       = node->flags,
+        };
+    }
+    db->nodes_count = hdr->nodes_count;
+
+    /* Hash table. */
+    for (size_t i = 0; i < table_size; i++) {
+        if (table[i] > hdr->nodes_count) {
+            snprintf(err, err_len, "zone image hash table entry %zu out of bounds", i);
+            goto ERR_END;
+        }
+    }
+
+    /* Minimal perfect hash function, every node MUST be in slot of its name. */
+    if (has_mphf) {
+        mphf_init(&db->mphf, hdr->nodes_count, hdr->mphf_seed, pilots, remap);
+        for (size_t i = 0; i < remap_count; i++) {
+            if (remap[i] >= hdr->nodes_count) {
+                snprintf(err, err_len, "zone image remap entry %zu out of bounds", i);
+                goto ERR_END;
+            }
+        }
+        for (uint32_t i = 0; i < hdr->nodes_count; i++) {
+            uint64_t hash = rip_ns_name_hash(db->nodes[i].name, db->nodes[i].name_len);
+
+            if (db->nodes[i].hash != (uint32_t)hash || mphf_lookup(&db->mphf, hash) != i) {
+                snprintf(err, err_len, "zone image node %u not in its slot", i);
+                goto ERR_END;
+            }
+        }
+    }
+
+    /* Zone transfers. */
+    for (uint32_t i = 0; i < db->xfrs_count; i++) {
+        const zone_xfr_t *xfr = &db->xfrs[i];
+
+        if (xfr->apex >= db->nodes_count ||
+            !(db->nodes[xfr->apex].flags & ZONE_NODE_F_APEX) ||
+            (i > 0 && xfr->apex <= db->xfrs[i - 1].apex) ||
+            (size_t)xfr->msg_index + xfr->msg_count > db->xfr_msgs_count) {
+            snprintf(err, err_len, "zone image zone transfer %u out of bounds", i);
+            goto ERR_END;
+        }
+    }
+    for (uint32_t i = 0; i < db->xfr_msgs_count; i++) {
+        if ((size_t)db->xfr_msgs[i].offset + db->xfr_msgs[i].len > db->xfr_data_len) {
+            snprintf(err, err_len, "zone image zone transfer message %u out of bounds", i);
+            goto ERR_END;
+        }
+    }
+    for (uint32_t i = 0; i < db->synths_count; i++) {
+        if (!zone_synth_valid(&db->synths[i])) {
+            snprintf(err, err_len, "zone image synthesis rule %u invalid", i);
+            goto ERR_END;
+        }
+    }
+    if (db->xfrs_count > 0 && (db->image_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0)) < 0) {
+        snprintf(err, err_len, "zone image dup error: %s", strerror(errno));
+        goto ERR_END;
+    }
+
+    /* Reverse label tree, also checks node names. */
+    if (zone_db_tree_build(db, err, err_len) != 0) {
+        goto ERR_END;
+    }
+    return db;
+
+ERR_END:
+    if (db != NULL) {
+        zone_db_release(db);
+    } else {
+        munmap((void *)image, len);
+    }
+    return NULL;
+}
+
+/** @}*/
@@ -0,0 +1,1221 @@
+/**
+ * @file zone_secondary.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "zone_secondary.h"
+
+/** Allocate space for owner name or RDATA of update record.
+ *
+ * @param update Update to allocate in.
+ * @param len    Number of bytes to allocate.
+ *
+ * @return       Returns pointer to allocated space.
+ */
+static uint8_t *
+zone_secondary_update_alloc(zone_secondary_update_t *update, size_t len)
+{
+    zone_secondary_block_t *block = update->blocks;
+    uint8_t                *ptr   = NULL;
+
+    if (block == NULL || ZONE_SECONDARY_BLOCK_SIZE - block->len < len) {
+        block = malloc(sizeof(zone_secondary_block_t));
+        CHECK_MALLOC(block);
+        block->next    = update->blocks;
+        block->len     = 0;
+        update->blocks = block;
+    }
+    ptr = block->data + block->len;
+    block->len += len;
+    return ptr;
+}
+
+/** Append record to update records array, record owner name and RDATA are
+ * not copied.
+ *
+ * @param update Update to append to.
+ * @param rr     Record to append.
+ */
+static void
+zone_secondary_update_rr_push(zone_secondary_update_t *update, const rr_record_t *rr)
+{
+    if (update->rrs_count == update->rrs_size) {
+        update->rrs_size = update->rrs_size == 0 ? 64 : update->rrs_size * 2;
+        update->rrs = realloc(update->rrs, sizeof(rr_record_t) * update->rrs_size);
+        CHECK_MALLOC(update->rrs);
+    }
+    update->rrs[update->rrs_count++] = *rr;
+}
+
+/** Create a secondary zone update, with no records.
+ *
+ * @param zone Index of zone update is for.
+ * @param full Update is full zone.
+ *
+ * @return     Returns update, release with @ref zone_secondary_update_free().
+ */
+zone_secondary_update_t *
+zone_secondary_update_new(size_t zone, bool full)
+{
+    zone_secondary_update_t *update = calloc(1, sizeof(zone_secondary_update_t));
+
+    CHECK_MALLOC(update);
+    update->zone = zone;
+    update->full = full;
+    return update;
+}
+
+/** Release secondary zone update and its records.
+ *
+ * @param update Update to release, may be NULL.
+ */
+void
+zone_secondary_update_free(zone_secondary_update_t *update)
+{
+    zone_secondary_block_t *block = NULL;
+
+    if (update == NULL) {
+        return;
+    }
+    while ((block = update->blocks) != NULL) {
+        update->blocks = block->next;
+        free(block);
+    }
+    free(update->rrs);
+    free(update);
+}
+
+/** Add record to secondary zone update, owner name and RDATA are copied.
+ *
+ * @param update    Update to add record to.
+ * @param name      Owner name in presentation format.
+ * @param type      Record type.
+ * @param class     Record class, NONE if record is deleted.
+ * @param ttl       Record TTL.
+ * @param rdata     Record RDATA, uncompressed.
+ * @param rdata_len Length of RDATA.
+ */
+void
+zone_secondary_update_add(zone_secondary_update_t *update, const char *name,
+                          uint16_t type, uint16_t class, uint32_t ttl,
+                          const uint8_t *rdata, uint16_t rdata_len)
+{
+    size_t      name_len = strlen(name);
+    rr_record_t rr       = {
+        .name      = zone_secondary_update_alloc(update, name_len + 1),
+        .name_len  = name_len,
+        .type      = type,
+        .class     = class,
+        .ttl       = ttl,
+        .rdata_len = rdata_len,
+        .rdata     = zone_secondary_update_alloc(update, rdata_len),
+    };
+
+    memcpy(rr.name, name, name_len + 1);
+    memcpy(rr.rdata, rdata, rdata_len);
+    zone_secondary_update_rr_push(update, &rr);
+}
+
+/** Hand update to resource thread, and wake it. It is safe to call from any
+ * thread.
+ *
+ * @param zs     Secondary zones state.
+ * @param update Update to hand over, owned by resource thread from now on.
+ */
+void
+zone_secondary_update_push(zone_secondary_t *zs, zone_secondary_update_t *update)
+{
+    update->next = atomic_load_explicit(&zs->updates, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&zs->updates, &update->next, update,
+                                                  memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    if (zs->resources != NULL) {
+        resource_set_reload(zs->resources);
+    }
+}
+
+/** Take all updates handed to resource thread.
+ *
+ * @param zs Secondary zones state.
+ *
+ * @return   Returns updates in order they were handed over, NULL if there are
+ *           none.
+ */
+static zone_secondary_update_t *
+zone_secondary_updates_take(zone_secondary_t *zs)
+{
+    zone_secondary_update_t *update  = NULL;
+    zone_secondary_update_t *ordered = NULL;
+
+    update = atomic_exchange_explicit(&zs->updates, NULL, memory_order_acquire);
+    while (update != NULL) {
+        zone_secondary_update_t *next = update->next;
+
+        update->next = ordered;
+        ordered      = update;
+        update       = next;
+    }
+    return ordered;
+}
+
+/** Initialize secondary zones state from configuration.
+ *
+ * @param zs        Secondary zones state to initialize.
+ * @param cfg       Configuration, with zone_secondary and zone_primary set.
+ * @param resources Resource set zone database is published to, NULL if
+ *                  resource thread is not to be woken on updates.
+ * @param err       Where to store error message.
+ * @param err_len   Length of err buffer.
+ *
+ * @return          Returns 0 on success, otherwise -1 and err is populated.
+ */
+int
+zone_secondary_init(zone_secondary_t *zs, config_t *cfg, resource_set_t *resources,
+                    char *err, size_t err_len)
+{
+    char *list    = NULL;
+    char *tok     = NULL;
+    char *saveptr = NULL;
+
+    *zs = (zone_secondary_t) {
+        .primary_net = cfg->zone_primary,
+        .notify_fd   = -1,
+        .resources   = resources,
+    };
+    atomic_init(&zs->updates, NULL);
+
+    list = strdup(cfg->zone_secondary);
+    CHECK_MALLOC(list);
+    for (tok = strtok_r(list, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        zone_secondary_zone_t *zone = NULL;
+
+        zs->zones = realloc(zs->zones, sizeof(zone_secondary_zone_t) * (zs->zones_count + 1));
+        CHECK_MALLOC(zs->zones);
+        zone = &zs->zones[zs->zones_count];
+        *zone = (zone_secondary_zone_t) { .retry = ZONE_SECONDARY_REFRESH_MIN };
+        atomic_init(&zone->notified, false);
+        atomic_init(&zone->failed, false);
+        if (rip_ns_name_pton((const unsigned char *)tok, zone->name, sizeof(zone->name)) < 0) {
+            snprintf(err, err_len, "secondary zone '%s' is not a valid zone name", tok);
+            free(list);
+            zone_secondary_clean(zs);
+            return -1;
+        }
+        zone->name_len = rip_ns_name_lc(zone->name);
+        rip_ns_name_ntop(zone->name, zone->text, sizeof(zone->text));
+        zs->zones_count++;
+    }
+    free(list);
+    if (zs->zones_count == 0) {
+        snprintf(err, err_len, "no secondary zones");
+        return -1;
+    }
+
+    if (cfg->zone_primary.family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&zs->primary;
+
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(cfg->zone_primary_port);
+        memcpy(&sin->sin_addr, cfg->zone_primary.addr, 4);
+        zs->primary_len = sizeof(struct sockaddr_in);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&zs->primary;
+
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port   = htons(cfg->zone_primary_port);
+        memcpy(&sin6->sin6_addr, cfg->zone_primary.addr, 16);
+        zs->primary_len = sizeof(struct sockaddr_in6);
+    }
+
+    zs->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (zs->notify_fd < 0) {
+        snprintf(err, err_len, "error creating secondary zone eventfd: %s", strerror(errno));
+        zone_secondary_clean(zs);
+        return -1;
+    }
+    return 0;
+}
+
+/** Release memory held by secondary zones state, including updates resource
+ * thread did not take.
+ *
+ * @param zs Secondary zones state to clean.
+ */
+void
+zone_secondary_clean(zone_secondary_t *zs)
+{
+    zone_secondary_update_t *update = zone_secondary_updates_take(zs);
+
+    while (update != NULL) {
+        zone_secondary_update_t *next = update->next;
+
+        zone_secondary_update_free(update);
+        update = next;
+    }
+    if (zs->notify_fd >= 0) {
+        close(zs->notify_fd);
+    }
+    free(zs->zones);
+    zs->zones       = NULL;
+    zs->zones_count = 0;
+    zs->notify_fd   = -1;
+}
+
+/** Handle NOTIFY (RFC 1996) received by a vectorloop. If it is for a
+ * secondary zone and comes from zone primary, zone is flagged and transfer
+ * thread woken to refresh it. Function never blocks.
+ *
+ * @param zs        Secondary zones state.
+ * @param name      NOTIFY question name, wire format and lower cased.
+ * @param name_len  Length of name.
+ * @param client_ip Address NOTIFY was received from.
+ *
+ * @return          Returns true if NOTIFY was accepted.
+ */
+bool
+zone_secondary_notify(zone_secondary_t *zs, const unsigned char *name,
+                      uint16_t name_len, const struct sockaddr_storage *client_ip)
+{
+    if (!utl_net_match(&zs->primary_net, client_ip)) {
+        return false;
+    }
+    for (size_t i = 0; i < zs->zones_count; i++) {
+        zone_secondary_zone_t *zone = &zs->zones[i];
+
+        if (zone->name_len == name_len && memcmp(zone->name, name, name_len) == 0) {
+            atomic_store_explicit(&zone->notified, true, memory_order_release);
+            eventfd_write(zs->notify_fd, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Get length of an uncompressed wire format domain name.
+ *
+ * @param name Wire format name.
+ *
+ * @return     Returns length of name, including terminating root label.
+ */
+static uint16_t
+zone_secondary_name_len(const unsigned char *name)
+{
+    uint16_t len = 0;
+
+    while (name[len] != 0) {
+        len += name[len] + 1;
+    }
+    return len + 1;
+}
+
+/** Check whether name is at or below zone apex.
+ *
+ * @param zone     Secondary zone.
+ * @param name     Wire format name, lower cased.
+ * @param name_len Length of name.
+ *
+ * @return         Returns true if name is in zone.
+ */
+static bool
+zone_secondary_name_in_zone(const zone_secondary_zone_t *zone, const unsigned char *name,
+                            uint16_t name_len)
+{
+    uint16_t offset = 0;
+
+    while (name_len - offset > zone->name_len) {
+        offset += name[offset] + 1;
+    }
+    return name_len - offset == zone->name_len &&
+           memcmp(name + offset, zone->name, zone->name_len) == 0;
+}
+
+/** Uncompress domain names in RDATA of a transferred record, so RDATA can be
+ * stored as is.
+ *
+ * @param msg       Message record is in.
+ * @param eom       End of message, one past its last byte.
+ * @param type      Record type.
+ * @param rdata     Record RDATA in message.
+ * @param rdata_len Length of RDATA, updated to uncompressed length.
+ * @param buf       Buffer where to store uncompressed RDATA.
+ * @param buf_len   Length of buf.
+ *
+ * @return          Returns uncompressed RDATA, either rdata (type has no
+ *                  compressed names) or buf. NULL if RDATA is malformed.
+ */
+static const uint8_t *
+zone_secondary_rdata_unpack(const uint8_t *msg, const uint8_t *eom, uint16_t type,
+                            const uint8_t *rdata, uint16_t *rdata_len,
+                            uint8_t *buf, size_t buf_len)
+{
+    const uint8_t *src     = rdata;
+    const uint8_t *end     = rdata + *rdata_len;
+    uint8_t       *dst     = buf;
+    size_t         prefix  = 0;
+    size_t         suffix  = 0;
+    int            names   = 1;
+    int            n       = 0;
+
+    switch (type) {
+    case rip_ns_t_ns:
+    case rip_ns_t_cname:
+    case rip_ns_t_ptr:
+        break;
+    case rip_ns_t_mx:
+        prefix = 2;
+        break;
+    case rip_ns_t_srv:
+        prefix = 6;
+        break;
+    case rip_ns_t_soa:
+        names  = 2;
+        suffix = 20;
+        break;
+    default:
+        return rdata;
+    }
+
+    if (end - src < prefix) {
+        return NULL;
+    }
+    memcpy(dst, src, prefix);
+    src += prefix;
+    dst += prefix;
+    for (int i = 0; i < names; i++) {
+        if (src >= end ||
+            (n = rip_ns_name_unpack(msg, eom, src, dst, buf + buf_len - dst)) < 0) {
+            return NULL;
+        }
+        src += n;
+        dst += zone_secondary_name_len(dst);
+    }
+    if (end - src != suffix) {
+        return NULL;
+    }
+    memcpy(dst, src, suffix);
+    dst += suffix;
+    *rdata_len = dst - buf;
+    return buf;
+}
+
+/** Add transferred record to transfer update, see
+ * @ref zone_secondary_xfr_parse().
+ *
+ * @param zone      Secondary zone transferred.
+ * @param xfr       Transfer state.
+ * @param name      Owner name, wire format and lower cased.
+ * @param type      Record type.
+ * @param class     Record class.
+ * @param ttl       Record TTL.
+ * @param rdata     Record RDATA, uncompressed.
+ * @param rdata_len Length of RDATA.
+ * @param err       Where to store error message.
+ * @param err_len   Length of err buffer.
+ *
+ * @return          Returns 1 if record was last of transfer, 0 if more are
+ *                  expected, -1 on error and err is populated.
+ */
+static int
+zone_secondary_xfr_rr(zone_secondary_zone_t *zone, zone_secondary_xfr_t *xfr,
+                      const unsigned char *name, uint16_t type, uint16_t class,
+                      uint32_t ttl, const uint8_t *rdata, uint16_t rdata_len,
+                      char *err, size_t err_len)
+{
+    zone_secondary_update_t *update   = xfr->update;
+    uint16_t                 name_len = zone_secondary_name_len(name);
+    bool                     soa      = false;
+    uint32_t                 serial   = 0;
+    char                     text[RIP_NS_MAXCDNAME * 4 + 1];
+
+    if (type == rip_ns_t_soa) {
+        const uint8_t *ptr = rdata + rdata_len - 20;
+
+        if (name_len != zone->name_len || memcmp(name, zone->name, name_len) != 0) {
+            snprintf(err, err_len, "SOA record of another zone in transfer");
+            return -1;
+        }
+        soa = true;
+        RIP_NS_GET32(serial, ptr);
+        if (xfr->rr_count == 0) {
+            update->serial = serial;
+            RIP_NS_GET32(xfr->refresh, ptr);
+            RIP_NS_GET32(xfr->retry, ptr);
+        }
+    } else if (xfr->rr_count == 0) {
+        snprintf(err, err_len, "transfer does not start with SOA record");
+        return -1;
+    }
+    xfr->rr_count++;
+
+    if (soa && xfr->rr_count > 1 && !xfr->incremental) {
+        if (xfr->rr_count > 2 || !xfr->ixfr || serial == update->serial) {
+            /* Closing SOA record of full zone response. */
+            return 1;
+        }
+        /* Second SOA record of IXFR response is old SOA record of first
+         * difference sequence, first one is added by last sequence.
+         */
+        xfr->incremental = true;
+        xfr->del         = true;
+        update->rrs_count--;
+    } else if (soa && xfr->incremental) {
+        if (!xfr->del && serial == update->serial) {
+            return 1;
+        }
+        xfr->del = !xfr->del;
+    }
+
+    /* Records of types zone database does not hold, and records outside of
+     * zone, are skipped.
+     */
+    if (class != rip_ns_c_in || !zone_type_supported(type) ||
+        !zone_secondary_name_in_zone(zone, name, name_len)) {
+        return 0;
+    }
+    if (rip_ns_name_ntop(name, text, sizeof(text)) < 0) {
+        snprintf(err, err_len, "invalid owner name in transfer");
+        return -1;
+    }
+    zone_secondary_update_add(update, text, type,
+                              xfr->incremental && xfr->del ? rip_ns_c_none : rip_ns_c_in,
+                              ttl, rdata, rdata_len);
+    return 0;
+}
+
+/** Parse a zone transfer (AXFR, IXFR) response message, adding its records
+ * to transfer update.
+ *
+ * Full zone response is SOA record, zone records and SOA record again.
+ * Incremental response (RFC 1995) is new SOA record followed by difference
+ * sequences, each being old SOA record, deleted records, new SOA record and
+ * added records, and new SOA record again. Single SOA record response means
+ * zone is up to date.
+ *
+ * @param zs      Secondary zones state.
+ * @param xfr     Transfer state, its update is for zone transferred.
+ * @param msg     Response message.
+ * @param msg_len Length of response message.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 1 if message was last of transfer, 0 if more are
+ *                expected, -1 on error and err is populated.
+ */
+int
+zone_secondary_xfr_parse(zone_secondary_t *zs, zone_secondary_xfr_t *xfr,
+                         const uint8_t *msg, size_t msg_len,
+                         char *err, size_t err_len)
+{
+    zone_secondary_zone_t *zone   = &zs->zones[xfr->update->zone];
+    const rip_ns_header_t *header = (const rip_ns_header_t *)msg;
+    const uint8_t         *eom    = msg + msg_len;
+    const uint8_t         *ptr    = msg + sizeof(rip_ns_header_t);
+    unsigned char          name[RIP_NS_MAXCDNAME];
+    uint8_t                buf[RIP_NS_MAXCDNAME * 2 + 20];
+    int                    n      = 0;
+    int                    ret    = 0;
+
+    if (msg_len < sizeof(rip_ns_header_t) || header->qr == 0) {
+        snprintf(err, err_len, "malformed response");
+        return -1;
+    }
+    if (header->rcode != rip_ns_r_noerror) {
+        snprintf(err, err_len, "primary answered with rcode %u", header->rcode);
+        return -1;
+    }
+    for (uint16_t i = 0; i < ntohs(header->qdcount); i++) {
+        if ((n = rip_ns_name_unpack(msg, eom, ptr, name, sizeof(name))) < 0 ||
+            eom - (ptr + n) < RIP_NS_QFIXEDSZ) {
+            snprintf(err, err_len, "malformed response question");
+            return -1;
+        }
+        ptr += n + RIP_NS_QFIXEDSZ;
+    }
+
+    for (uint16_t i = 0; i < ntohs(header->ancount) && ret == 0; i++) {
+        const uint8_t *rdata     = NULL;
+        uint16_t       type      = 0;
+        uint16_t       class     = 0;
+        uint32_t       ttl       = 0;
+        uint16_t       wire_len  = 0;
+        uint16_t       rdata_len = 0;
+
+        if ((n = rip_ns_name_unpack(msg, eom, ptr, name, sizeof(name))) < 0 ||
+            eom - (ptr + n) < RIP_NS_RRFIXEDSZ) {
+            snprintf(err, err_len, "malformed response record");
+            return -1;
+        }
+        ptr += n;
+        RIP_NS_GET16(type, ptr);
+        RIP_NS_GET16(class, ptr);
+        RIP_NS_GET32(ttl, ptr);
+        RIP_NS_GET16(wire_len, ptr);
+        if (eom - ptr < wire_len) {
+            snprintf(err, err_len, "malformed response record");
+            return -1;
+        }
+        rdata_len = wire_len;
+        rdata = zone_secondary_rdata_unpack(msg, eom, type, ptr, &rdata_len,
+                                            buf, sizeof(buf));
+        ptr += wire_len;
+        if (rdata == NULL) {
+            snprintf(err, err_len, "malformed response record data");
+            return -1;
+        }
+        rip_ns_name_lc(name);
+        ret = zone_secondary_xfr_rr(zone, xfr, name, type, class, ttl, rdata, rdata_len,
+                                    err, err_len);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* Single SOA record, primary has no newer zone. */
+    if (xfr->ixfr && xfr->rr_count == 1 &&
+        (int32_t)(xfr->update->serial - xfr->serial) <= 0) {
+        xfr->current = true;
+        return 1;
+    }
+    return 0;
+}
+
+/** Build zone transfer request, AXFR or if zone was transferred before IXFR
+ * with authority section SOA record carrying zone serial (RFC 1995).
+ *
+ * @param zone Secondary zone to transfer.
+ * @param xfr  Transfer state.
+ * @param id   Request message ID.
+ * @param buf  Where to store request, prefixed with its length as sent over
+ *             TCP.
+ *
+ * @return     Returns length of request, including length prefix.
+ */
+static size_t
+zone_secondary_request(zone_secondary_zone_t *zone, zone_secondary_xfr_t *xfr,
+                       uint16_t id, uint8_t *buf)
+{
+    rip_ns_header_t *header = (rip_ns_header_t *)(buf + 2);
+    uint8_t         *ptr    = buf + 2 + sizeof(rip_ns_header_t);
+    uint8_t         *len    = buf;
+
+    memset(header, 0, sizeof(rip_ns_header_t));
+    header->id      = id;
+    header->opcode  = rip_ns_o_query;
+    header->qdcount = htons(1);
+    header->nscount = htons(xfr->ixfr ? 1 : 0);
+
+    memcpy(ptr, zone->name, zone->name_len);
+    ptr += zone->name_len;
+    RIP_NS_PUT16(xfr->ixfr ? rip_ns_t_ixfr : rip_ns_t_axfr, ptr);
+    RIP_NS_PUT16(rip_ns_c_in, ptr);
+    if (xfr->ixfr) {
+        /* Owner is question name, SOA names are root, only serial matters. */
+        RIP_NS_PUT16(0xc000 | sizeof(rip_ns_header_t), ptr);
+        RIP_NS_PUT16(rip_ns_t_soa, ptr);
+        RIP_NS_PUT16(rip_ns_c_in, ptr);
+        RIP_NS_PUT32(0, ptr);
+        RIP_NS_PUT16(2 + 20, ptr);
+        *ptr++ = 0;
+        *ptr++ = 0;
+        RIP_NS_PUT32(xfr->serial, ptr);
+        memset(ptr, 0, 16);
+        ptr += 16;
+    }
+    RIP_NS_PUT16(ptr - buf - 2, len);
+    return ptr - buf;
+}
+
+/** Receive exactly len bytes from zone primary.
+ *
+ * @param sock    Connection to zone primary.
+ * @param buf     Where to store received data.
+ * @param len     Number of bytes to receive.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_secondary_recv(int sock, uint8_t *buf, size_t len, char *err, size_t err_len)
+{
+    size_t  done = 0;
+    ssize_t n    = 0;
+
+    while (done < len) {
+        n = recv(sock, buf + done, len - done, 0);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        snprintf(err, err_len, "%s", n == 0 ? "connection closed by primary" :
+                 errno == EAGAIN || errno == EWOULDBLOCK ? "receive timed out" :
+                 strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/** Transfer zone from zone primary over TCP. Connection, and each send and
+ * receive on it, times out after @ref ZONE_SECONDARY_IO_TIMEOUT.
+ *
+ * @param zs      Secondary zones state.
+ * @param xfr     Transfer state, records are added to its update.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_secondary_transfer(zone_secondary_t *zs, zone_secondary_xfr_t *xfr,
+                        char *err, size_t err_len)
+{
+    zone_secondary_zone_t *zone = &zs->zones[xfr->update->zone];
+    struct timeval         tv   = { .tv_sec = ZONE_SECONDARY_IO_TIMEOUT };
+    uint8_t                req[2 + sizeof(rip_ns_header_t) + RIP_NS_MAXCDNAME +
+                               RIP_NS_QFIXEDSZ + 2 + RIP_NS_RRFIXEDSZ + 22];
+    size_t                 req_len = 0;
+    uint8_t               *msg     = NULL;
+    uint8_t                len[2];
+    uint16_t               msg_len = 0;
+    uint16_t               id      = (uint16_t)utl_clock_monotonic_us_fatal();
+    int                    sock    = -1;
+    int                    ret     = -1;
+
+    sock = socket(zs->primary.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        snprintf(err, err_len, "socket error: %s", strerror(errno));
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(sock, (struct sockaddr *)&zs->primary, zs->primary_len) != 0) {
+        snprintf(err, err_len, "connect error: %s",
+                 errno == EINPROGRESS ? "timed out" : strerror(errno));
+        goto END;
+    }
+
+    req_len = zone_secondary_request(zone, xfr, id, req);
+    if (utl_writeall(sock, req, req_len, err, err_len) != 0) {
+        goto END;
+    }
+
+    msg = malloc(RIP_NS_MAXMSG);
+    CHECK_MALLOC(msg);
+    do {
+        if (zone_secondary_recv(sock, len, sizeof(len), err, err_len) != 0) {
+            ret = -1;
+            break;
+        }
+        msg_len = ((uint16_t)len[0] << 8) | len[1];
+        if (zone_secondary_recv(sock, msg, msg_len, err, err_len) != 0) {
+            ret = -1;
+            break;
+        }
+        if (msg_len < sizeof(rip_ns_header_t) || ((rip_ns_header_t *)msg)->id != id) {
+            snprintf(err, err_len, "response ID does not match request");
+            ret = -1;
+            break;
+        }
+        ret = zone_secondary_xfr_parse(zs, xfr, msg, msg_len, err, err_len);
+    } while (ret == 0);
+
+END:
+    free(msg);
+    close(sock);
+    return ret == 1 ? 0 : -1;
+}
+
+/** Clamp SOA refresh or retry value to secondary zone refresh bounds.
+ *
+ * @param seconds SOA refresh or retry value.
+ *
+ * @return        Returns clamped value.
+ */
+static uint32_t
+zone_secondary_interval(uint32_t seconds)
+{
+    if (seconds < ZONE_SECONDARY_REFRESH_MIN) {
+        return ZONE_SECONDARY_REFRESH_MIN;
+    }
+    if (seconds > ZONE_SECONDARY_REFRESH_MAX) {
+        return ZONE_SECONDARY_REFRESH_MAX;
+    }
+    return seconds;
+}
+
+/** Refresh secondary zone, transfer it from zone primary and hand transferred
+ * records to resource thread. Next refresh is scheduled SOA refresh interval
+ * later, or SOA retry interval later if transfer failed.
+ *
+ * @param zs              Secondary zones state.
+ * @param index           Index of zone to refresh.
+ * @param app_log_channel Application log channel.
+ */
+static void
+zone_secondary_refresh(zone_secondary_t *zs, size_t index, channel_log_t *app_log_channel)
+{
+    zone_secondary_zone_t *zone = &zs->zones[index];
+    zone_secondary_xfr_t   xfr  = {
+        .update = zone_secondary_update_new(index, true),
+        .ixfr   = zone->loaded,
+        .serial = zone->serial,
+    };
+    char                   err[ERR_MSG_LENGTH];
+    uint64_t               now_us = 0;
+    int                    ret    = 0;
+
+    err[0] = '\0';
+    ret    = zone_secondary_transfer(zs, &xfr, err, sizeof(err));
+    now_us = utl_clock_monotonic_us_fatal();
+    if (ret != 0) {
+        channel_log_send(app_log_channel, 0, false,
+                         "Secondary zone \"%s\" transfer from primary failed, %s",
+                         zone->text, err);
+        zone_secondary_update_free(xfr.update);
+        zone->refresh_us = now_us + zone->retry * 1000000ULL;
+        return;
+    }
+
+    zone->retry      = zone_secondary_interval(xfr.retry);
+    zone->refresh_us = now_us + zone_secondary_interval(xfr.refresh) * 1000000ULL;
+    if (xfr.current) {
+        zone_secondary_update_free(xfr.update);
+        return;
+    }
+    xfr.update->full = !xfr.incremental;
+    zone->loaded     = true;
+    zone->serial     = xfr.update->serial;
+    channel_log_send(app_log_channel, 0, false,
+                     "Secondary zone \"%s\" transferred (%s), serial %" PRIu32 ", %zu records",
+                     zone->text, xfr.incremental ? "IXFR" : "AXFR", xfr.update->serial,
+                     xfr.update->rrs_count);
+    zone_secondary_update_push(zs, xfr.update);
+}
+
+/** Transfer thread loop function. It refreshes each secondary zone when its
+ * refresh time comes, or right away when NOTIFY was received for it, see
+ * @ref zone_secondary_notify(). Zone whose update did not apply is
+ * transferred in full after SOA retry interval.
+ *
+ * @note This loop runs indefinitely and is meant to be run on its own thread.
+ *
+ * @param args Object with arguments passed to transfer thread, see
+ *             @ref zone_secondary_loop_args_t.
+ */
+void *
+zone_secondary_loop(void *args)
+{
+    zone_secondary_loop_args_t *zs_args         = (zone_secondary_loop_args_t *)args;
+    zone_secondary_t           *zs              = zs_args->secondary;
+    channel_log_t              *app_log_channel = zs_args->app_log_channel;
+    struct pollfd               pfd             = { .fd = zs->notify_fd, .events = POLLIN };
+    eventfd_t                   value           = 0;
+
+    while (1) {
+        uint64_t        now_us  = utl_clock_monotonic_us_fatal();
+        uint64_t        next_us = UINT64_MAX;
+        struct timespec wait    = {};
+
+        for (size_t i = 0; i < zs->zones_count; i++) {
+            zone_secondary_zone_t *zone = &zs->zones[i];
+
+            if (atomic_exchange_explicit(&zone->failed, false, memory_order_acquire)) {
+                channel_log_send(app_log_channel, 0, false,
+                                 "Secondary zone \"%s\" transfer did not apply to zone "
+                                 "database, zone is transferred in full", zone->text);
+                zone->loaded     = false;
+                zone->refresh_us = now_us + zone->retry * 1000000ULL;
+            }
+            if (atomic_exchange_explicit(&zone->notified, false, memory_order_acquire)) {
+                zone->refresh_us = now_us;
+            }
+            if (zone->refresh_us <= now_us) {
+                zone_secondary_refresh(zs, i, app_log_channel);
+                now_us = utl_clock_monotonic_us_fatal();
+            }
+            if (zone->refresh_us < next_us) {
+                next_us = zone->refresh_us;
+            }
+        }
+
+        if (next_us > now_us) {
+            wait.tv_sec  = (next_us - now_us) / 1000000;
+            wait.tv_nsec = (next_us - now_us) % 1000000 * 1000;
+        }
+        if (ppoll(&pfd, 1, &wait, NULL) > 0) {
+            eventfd_read(zs->notify_fd, &value);
+        }
+    }
+
+    return NULL;
+}
+
+/** Collect records of secondary zone in zone database, nodes whose closest
+ * zone apex is zone apex.
+ *
+ * @param zs     Secondary zones state.
+ * @param index  Index of zone.
+ * @param db     Zone database to collect from.
+ * @param update Where to append records, owner names and RDATA point into
+ *               db.
+ * @param del    Append a deletion of all RRsets of each zone node, instead of
+ *               its records.
+ */
+static void
+zone_secondary_zone_rrs(zone_secondary_t *zs, size_t index, zone_db_t *db,
+                        zone_secondary_update_t *update, bool del)
+{
+    zone_secondary_zone_t *zone  = &zs->zones[index];
+    zone_match_t           match = {};
+
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        zone_node_t *node = &db->nodes[i];
+
+        if (node->rrset_count == 0) {
+            continue;
+        }
+        zone_db_match(db, node->name, node->name_len, &match);
+        if (match.apex == NULL || match.apex->name_len != zone->name_len ||
+            memcmp(match.apex->name, zone->name, zone->name_len) != 0) {
+            continue;
+        }
+        if (del) {
+            rr_record_t rr = node->rrsets[0].rrs[0];
+
+            rr.type      = rip_ns_t_any;
+            rr.class     = rip_ns_c_any;
+            rr.rdata_len = 0;
+            zone_secondary_update_rr_push(update, &rr);
+            continue;
+        }
+        for (uint16_t j = 0; j < node->rrset_count; j++) {
+            for (uint16_t k = 0; k < node->rrsets[j].rr_count; k++) {
+                zone_secondary_update_rr_push(update, &node->rrsets[j].rrs[k]);
+            }
+        }
+    }
+}
+
+/** Compare function used to sort incremental update records by owner name,
+ * type and transfer order.
+ *
+ * @param a   First record index.
+ * @param b   Second record index.
+ * @param arg Update records.
+ *
+ * @return    Returns negative, zero or positive value as with strcmp.
+ */
+static int
+zone_secondary_rr_cmp(const void *a, const void *b, void *arg)
+{
+    const rr_record_t *rrs = (const rr_record_t *)arg;
+    const rr_record_t *ra  = &rrs[*(const size_t *)a];
+    const rr_record_t *rb  = &rrs[*(const size_t *)b];
+    int                ret = strcasecmp((const char *)ra->name, (const char *)rb->name);
+
+    if (ret != 0) {
+        return ret;
+    }
+    if (ra->type != rb->type) {
+        return ra->type < rb->type ? -1 : 1;
+    }
+    return ra < rb ? -1 : ra > rb;
+}
+
+/** Turn incremental update into records replacing RRsets it changes. Each
+ * changed RRset is RRset of base database with deleted records removed and
+ * added records appended, or a deletion if no record is left.
+ *
+ * @param base    Zone database update applies to.
+ * @param update  Incremental update.
+ * @param out     Where to append replacement records.
+ * @param err     Where to store error message.
+ * @param err_len Length of err buffer.
+ *
+ * @return        Returns 0 on success, otherwise -1 and err is populated.
+ */
+static int
+zone_secondary_changes(zone_db_t *base, zone_secondary_update_t *update,
+                       zone_secondary_update_t *out, char *err, size_t err_len)
+{
+    size_t      *order     = malloc(sizeof(size_t) * (update->rrs_count + 1));
+    rr_record_t *set       = NULL;
+    size_t       set_size  = 0;
+    int          ret       = -1;
+
+    CHECK_MALLOC(order);
+    for (size_t i = 0; i < update->rrs_count; i++) {
+        order[i] = i;
+    }
+    qsort_r(order, update->rrs_count, sizeof(size_t), zone_secondary_rr_cmp, update->rrs);
+
+    for (size_t i = 0, j = 0; i < update->rrs_count; i = j) {
+        rr_record_t   *first    = &update->rrs[order[i]];
+        zone_node_t   *node     = NULL;
+        zone_rrset_t  *rrset    = NULL;
+        size_t         count    = 0;
+        unsigned char  name[RIP_NS_MAXCDNAME];
+
+        j = i + 1;
+        while (j < update->rrs_count &&
+               update->rrs[order[j]].type == first->type &&
+               strcasecmp((const char *)update->rrs[order[j]].name,
+                          (const char *)first->name) == 0) {
+            j++;
+        }
+
+        if (rip_ns_name_pton(first->name, name, sizeof(name)) < 0) {
+            snprintf(err, err_len, "invalid owner name \"%s\"", first->name);
+            goto END;
+        }
+        if ((node = zone_db_lookup(base, name, rip_ns_name_lc(name))) != NULL) {
+            rrset = zone_node_rrset_get(base, node, first->type);
+        }
+        count = rrset != NULL ? rrset->rr_count : 0;
+        if (set_size < count + (j - i)) {
+            set_size = count + (j - i);
+            set = realloc(set, sizeof(rr_record_t) * set_size);
+            CHECK_MALLOC(set);
+        }
+        if (count > 0) {
+            memcpy(set, rrset->rrs, sizeof(rr_record_t) * count);
+        }
+
+        for (size_t k = i; k < j; k++) {
+            rr_record_t *rr    = &update->rrs[order[k]];
+            size_t       found = 0;
+
+            while (found < count && (set[found].rdata_len != rr->rdata_len ||
+                   memcmp(set[found].rdata, rr->rdata, rr->rdata_len) != 0)) {
+                found++;
+            }
+            if (rr->class == rip_ns_c_none) {
+                if (found == count) {
+                    snprintf(err, err_len, "deleted %s record of \"%s\" is not in zone",
+                             rip_ns_rr_type_to_str(rr->type), rr->name);
+                    goto END;
+                }
+                memmove(&set[found], &set[found + 1],
+                        sizeof(rr_record_t) * (count - found - 1));
+                count--;
+            } else if (found < count) {
+                set[found].ttl = rr->ttl;
+            } else {
+                set[count] = *rr;
+                count++;
+            }
+        }
+
+        for (size_t k = 0; k < count; k++) {
+            set[k].name     = first->name;
+            set[k].name_len = first->name_len;
+            set[k].class    = rip_ns_c_in;
+            zone_secondary_update_rr_push(out, &set[k]);
+        }
+        if (count == 0 && rrset != NULL) {
+            rr_record_t del = {
+                .name     = first->name,
+                .name_len = first->name_len,
+                .type     = first->type,
+                .class    = rip_ns_c_any,
+            };
+
+            zone_secondary_update_rr_push(out, &del);
+        }
+    }
+    ret = 0;
+
+END:
+    free(set);
+    free(order);
+    return ret;
+}
+
+/** Apply secondary zone update to zone database.
+ *
+ * Full update replaces all nodes of zone in base database, incremental update
+ * replaces RRsets it changes, see @ref zone_secondary_changes().
+ *
+ * @param zs         Secondary zones state.
+ * @param base       Zone database to apply update to, NULL if there is none.
+ * @param update     Update to apply.
+ * @param generation Generation number to assign to database.
+ * @param err        Where to store error message.
+ * @param err_len    Length of err buffer.
+ *
+ * @return           Returns new zone database, or NULL on error and err is
+ *                   populated.
+ */
+static zone_db_t *
+zone_secondary_update_apply(zone_secondary_t *zs, zone_db_t *base,
+                            zone_secondary_update_t *update, uint64_t generation,
+                            char *err, size_t err_len)
+{
+    zone_secondary_update_t *out = NULL;
+    zone_db_t               *db  = NULL;
+
+    if (base == NULL) {
+        if (!update->full) {
+            snprintf(err, err_len, "incremental update without zone");
+            return NULL;
+        }
+        return zone_db_create_rrs(update->rrs, update->rrs_count, generation, err, err_len);
+    }
+
+    out = zone_secondary_update_new(update->zone, update->full);
+    if (update->full) {
+        zone_secondary_zone_rrs(zs, update->zone, base, out, true);
+        for (size_t i = 0; i < update->rrs_count; i++) {
+            zone_secondary_update_rr_push(out, &update->rrs[i]);
+        }
+    } else if (zone_secondary_changes(base, update, out, err, err_len) != 0) {
+        zone_secondary_update_free(out);
+        return NULL;
+    }
+    db = zone_db_apply_rrs(base, out->rrs, out->rrs_count, generation, err, err_len);
+    zone_secondary_update_free(out);
+    return db;
+}
+
+/** Bring zone database up to date with secondary zone updates. Called by
+ * resource thread each time it checks zone database for change.
+ *
+ * When zone file layer changed, secondary zones in published database are
+ * applied on top of it again. Updates transfer thread handed over are then
+ * applied in order. Update that does not apply flags zone for transfer
+ * thread to transfer it in full, incremental updates of the zone are skipped
+ * until then. Database generation chain longer than
+ * @ref ZONE_SECONDARY_DEPTH_MAX is rebuilt from scratch.
+ *
+ * @param zs         Secondary zones state.
+ * @param current    Published zone database, NULL if there is none.
+ * @param db         Zone database built from changed zone file layer, NULL
+ *                   if zone file layer did not change. Ownership is taken.
+ * @param generation Generation number of last built database, incremented
+ *                   for each database built.
+ *
+ * @return           Returns zone database to publish, NULL if there is no
+ *                   change.
+ */
+zone_db_t *
+zone_secondary_db_update(zone_secondary_t *zs, zone_db_t *current, zone_db_t *db,
+                         uint64_t *generation)
+{
+    zone_secondary_update_t *updates = zone_secondary_updates_take(zs);
+    zone_secondary_update_t *update  = NULL;
+    zone_db_t               *next    = NULL;
+    size_t                   depth   = 0;
+    char                     err[ERR_MSG_LENGTH];
+
+    if (db != NULL && current != NULL) {
+        for (size_t i = 0; i < zs->zones_count; i++) {
+            if (!zs->zones[i].applied) {
+                continue;
+            }
+            update = zone_secondary_update_new(i, true);
+            zone_secondary_zone_rrs(zs, i, current, update, false);
+            next = zone_secondary_update_apply(zs, db, update, *generation + 1,
+                                               err, sizeof(err));
+            zone_secondary_update_free(update);
+            if (next == NULL) {
+                zs->zones[i].applied = false;
+                atomic_store_explicit(&zs->zones[i].failed, true, memory_order_release);
+                eventfd_write(zs->notify_fd, 1);
+                continue;
+            }
+            *generation += 1;
+            zone_db_release(db);
+            db = next;
+        }
+    }
+
+    while ((update = updates) != NULL) {
+        zone_secondary_zone_t *zone = &zs->zones[update->zone];
+
+        updates = update->next;
+        if (!update->full && zone->broken) {
+            zone_secondary_update_free(update);
+            continue;
+        }
+        next = zone_secondary_update_apply(zs, db != NULL ? db : current, update,
+                                           *generation + 1, err, sizeof(err));
+        zone_secondary_update_free(update);
+        if (next == NULL) {
+            zone->broken = true;
+            atomic_store_explicit(&zone->failed, true, memory_order_release);
+            eventfd_write(zs->notify_fd, 1);
+            continue;
+        }
+        *generation += 1;
+        zone_db_release(db);
+        db            = next;
+        zone->applied = true;
+        zone->broken  = false;
+    }
+
+    if (db == NULL) {
+        return NULL;
+    }
+    for (zone_db_t *d = db; d->base != NULL; d = d->base) {
+        depth++;
+    }
+    if (depth > ZONE_SECONDARY_DEPTH_MAX) {
+        update = zone_secondary_update_new(0, true);
+        for (uint32_t i = 0; i < db->nodes_count; i++) {
+            zone_node_t *node = &db->nodes[i];
+
+            for (uint16_t j = 0; j < node->rrset_count; j++) {
+                for (uint16_t k = 0; k < node->rrsets[j].rr_count; k++) {
+                    zone_secondary_update_rr_push(update, &node->rrsets[j].rrs[k]);
+                }
+            }
+        }
+        next = zone_db_create_rrs(update->rrs, update->rrs_count, *generation + 1,
+                                  err, sizeof(err));
+        zone_secondary_update_free(update);
+        if (next != NULL) {
+            *generation += 1;
+            zone_db_release(db);
+            db = next;
+        }
+    }
+    return db;
+}
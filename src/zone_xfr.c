@@ -0,0 +1,179 @@
+/**
+ * @file zone_xfr.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup zone_xfr
+ *  @{
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "zone_xfr.h"
+
+/** Create zone transfer stream.
+ *
+ * @param db           Zone database transfer is of, MUST be loaded from a
+ *                     zone image (see @ref zone_db_xfr_find).
+ * @param xfr          Zone transfer to send.
+ * @param request      Zone transfer request message, its ID, RD flag and
+ *                     question are copied into each message.
+ * @param question_len Length of request question.
+ *
+ * @return             Returns pointer to zone transfer stream, or NULL if
+ *                     zone image file descriptor could not be duplicated.
+ */
+zone_xfr_stream_t *
+zone_xfr_stream_new(zone_db_t *db, const zone_xfr_t *xfr, const uint8_t *request,
+                    uint16_t question_len)
+{
+    zone_xfr_stream_t *s  = NULL;
+    int                fd = fcntl(db->image_fd, F_DUPFD_CLOEXEC, 0);
+    uint8_t           *p  = NULL;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    s = calloc(1, sizeof(zone_xfr_stream_t));
+    CHECK_MALLOC(s);
+    s->msgs = malloc(sizeof(zone_xfr_msg_t) * (xfr->msg_count + 1));
+    CHECK_MALLOC(s->msgs);
+    memcpy(s->msgs, &db->xfr_msgs[xfr->msg_index], sizeof(zone_xfr_msg_t) * xfr->msg_count);
+    s->fd           = fd;
+    s->data_offset  = db->xfr_data_file_offset;
+    s->msg_count    = xfr->msg_count;
+    s->question_len = question_len;
+    s->head_len     = RIP_NS_INT16SZ + sizeof(rip_ns_header_t) + question_len;
+
+    /* ID, response, authoritative, RD copied, one question. Answer count and
+     * length prefix are patched per message.
+     */
+    p = s->head + RIP_NS_INT16SZ;
+    memcpy(p, request, RIP_NS_INT16SZ);
+    p[2] = 0x84 | (request[2] & 0x01);
+    p[3] = 0;
+    p += 4;
+    RIP_NS_PUT16(1, p);
+    RIP_NS_PUT16(0, p);
+    RIP_NS_PUT16(0, p);
+    RIP_NS_PUT16(0, p);
+    memcpy(p, request + sizeof(rip_ns_header_t), question_len);
+    return s;
+}
+
+/** Patch message head of zone transfer stream for next message to send.
+ *
+ * @param s Zone transfer stream.
+ */
+static void
+zone_xfr_stream_head(zone_xfr_stream_t *s)
+{
+    const zone_xfr_msg_t *msg = &s->msgs[s->msg_next];
+    uint8_t              *p   = s->head;
+
+    RIP_NS_PUT16(s->head_len - RIP_NS_INT16SZ + msg->len, p);
+    p = s->head + RIP_NS_INT16SZ + 6;
+    RIP_NS_PUT16(msg->ancount, p);
+}
+
+/** Send zone transfer stream, next part of it, to TCP connection socket.
+ *
+ * Message head is sent with send() and MSG_MORE, so it goes out in same
+ * segment as start of answer section sent with sendfile(). Neither blocks,
+ * stream stops at first short write and continues from there next time.
+ *
+ * @param s       Zone transfer stream.
+ * @param sock_fd Connection socket.
+ * @param budget  Maximum number of bytes to send.
+ *
+ * @return        Returns number of bytes sent. If nothing was sent, -1 is
+ *                returned and errno is set, EAGAIN if socket is not
+ *                writable.
+ */
+ssize_t
+zone_xfr_stream_send(zone_xfr_stream_t *s, int sock_fd, size_t budget)
+{
+    size_t  sent = 0;
+    ssize_t ret  = 0;
+
+    while (s->msg_next < s->msg_count && sent < budget) {
+        const zone_xfr_msg_t *msg = &s->msgs[s->msg_next];
+
+        if (s->msg_pos < s->head_len) {
+            if (s->msg_pos == 0) {
+                zone_xfr_stream_head(s);
+            }
+            ret = send(sock_fd, s->head + s->msg_pos, s->head_len - s->msg_pos,
+                       MSG_DONTWAIT | MSG_NOSIGNAL | MSG_MORE);
+        } else {
+            off_t  offset = s->data_offset + msg->offset + (s->msg_pos - s->head_len);
+            size_t len    = msg->len - (s->msg_pos - s->head_len);
+
+            if (len > budget - sent) {
+                len = budget - sent;
+            }
+            /* Socket is non blocking, sendfile() does not block on it. */
+            ret = sendfile(sock_fd, s->fd, &offset, len);
+            if (ret == 0) {
+                /* Zone image file is shorter than it was when loaded. */
+                errno = EIO;
+                ret = -1;
+            }
+        }
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return sent > 0 ? (ssize_t)sent : -1;
+        }
+        sent += ret;
+        s->msg_pos += ret;
+        if (s->msg_pos == (uint32_t)s->head_len + msg->len) {
+            s->msg_next += 1;
+            s->msg_pos = 0;
+        }
+    }
+    return sent;
+}
+
+/** Free zone transfer stream.
+ *
+ * @param s Zone transfer stream, may be NULL.
+ */
+void
+zone_xfr_stream_free(zone_xfr_stream_t *s)
+{
+    if (s == NULL) {
+        return;
+    }
+    close(s->fd);
+    free(s->msgs);
+    free(s);
+}
+
+/** @}*/
@@ -0,0 +1,629 @@
+/**
+ * @file bench_query.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup microbench Microbenchmarks
+ *
+ * @brief Microbenchmarks of query processing hot functions.
+ *
+ *        Each benchmark runs a function over a corpus of realistic query
+ *        packets and reports time, instructions and cache misses per
+ *        operation. Counters are read via perf_event_open(), if perf events are
+ *        not available (e.g. kernel.perf_event_paranoid) only time is
+ *        reported. Query pipeline stages are measured cumulatively (parse,
+ *        parse + resolve, parse + resolve + pack), same as they run in
+ *        vectorloop, cost of a stage is difference between rows.
+ *
+ *        Run via "make microbench", optionally with number of operations per
+ *        benchmark and a benchmark name filter: test_c/microbench [ops] [name].
+ *
+ *        Given a pcap file of recorded queries, "vl_replay" benchmark replays
+ *        ops queries of it through vectorloop UDP stages, see
+ *        @ref vl_replay_run(), and reports time each stage takes per query:
+ *        test_c/microbench [ops] vl_replay file.pcap [zone_file]. Queries are
+ *        resolved against zone file, if given, otherwise against benchmark
+ *        zone. As queries are not sent through kernel, runs are reproducible,
+ *        so stage optimizations can be compared on real traffic mix.
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "config.h"
+#include "metrics.h"
+#include "query.h"
+#include "resource.h"
+#include "rip_ns_utils.h"
+#include "utils.h"
+#include "vectorloop.h"
+#include "vectorloop_drain.h"
+#include "vectorloop_replay.h"
+#include "zone.h"
+
+/**! @cond */
+#define BENCH_OPS_DEFAULT 1000000
+
+/** Zone queries in corpus are resolved against. */
+static const char *bench_zone_file =
+    "example.com.       3600 IN SOA  ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+    "example.com.       3600 IN NS   ns1.example.com.\n"
+    "example.com.       3600 IN NS   ns2.example.com.\n"
+    "ns1.example.com.   3600 IN A    192.0.2.1\n"
+    "ns2.example.com.   3600 IN A    192.0.2.2\n"
+    "www.example.com.     60 IN A    192.0.2.10\n"
+    "www.example.com.     60 IN A    192.0.2.11\n"
+    "www.example.com.     60 IN AAAA 2001:db8::10\n"
+    "api.example.com.     60 IN CNAME www.example.com.\n"
+    "static.cdn.eu-west-1.assets.example.com. 300 IN A 198.51.100.7\n";
+
+/** Query in corpus. */
+typedef struct bench_packet_s {
+    const char *name;
+    uint16_t    qtype;
+    bool        edns;
+    bool        ecs;
+} bench_packet_t;
+
+/** Corpus, mix of common query shapes: short and long names, mixed case,
+ * A and AAAA, CNAME chase, NXDOMAIN, with and without EDNS client subnet.
+ */
+static const bench_packet_t bench_corpus[] = {
+    { "www.example.com",                          rip_ns_t_a,    false, false },
+    { "www.example.com",                          rip_ns_t_aaaa, true,  false },
+    { "WWW.Example.COM",                          rip_ns_t_a,    true,  false },
+    { "api.example.com",                          rip_ns_t_a,    true,  false },
+    { "static.cdn.eu-west-1.assets.example.com",  rip_ns_t_a,    true,  true  },
+    { "missing.example.com",                      rip_ns_t_a,    true,  false },
+    { "example.com",                              rip_ns_t_ns,   false, false },
+    { "www.example.com",                          rip_ns_t_a,    true,  true  },
+};
+
+#define BENCH_CORPUS_LEN (sizeof(bench_corpus) / sizeof(bench_corpus[0]))
+
+/** Benchmark state shared by benchmark functions. */
+typedef struct bench_s {
+    config_t   cfg;
+    zone_db_t *db;
+    query_t    queries[BENCH_CORPUS_LEN];
+    uint8_t    names[BENCH_CORPUS_LEN][RIP_NS_MAXCDNAME];
+    char       log_buf[4096];
+    char       text_buf[QUERY_LOG_BUF_MIN_SPACE];
+    uint8_t    pack_buf[RIP_NS_PACKETSZ];
+    rip_ns_comp_t comp;
+    uint64_t   sink;
+} bench_t;
+
+typedef void (*bench_fn_t)(bench_t *b, size_t i);
+
+/** Performance counters of a benchmark. */
+typedef struct bench_perf_s {
+    int fd_instructions;
+    int fd_cache_misses;
+} bench_perf_t;
+
+/** Build query packet of corpus entry into query request buffer.
+ *
+ * @param q Query to build request of.
+ * @param p Corpus entry.
+ */
+static void
+bench_packet_build(query_t *q, const bench_packet_t *p)
+{
+    uint8_t *buf = q->request_buffer;
+    int      len;
+
+    memset(buf, 0, 12);
+    buf[0]  = 0x12;
+    buf[1]  = 0x34;
+    buf[2]  = 0x01;
+    buf[5]  = 1;
+    buf[11] = p->edns ? 1 : 0;
+    if (rip_ns_name_pton((const unsigned char *)p->name, buf + 12, RIP_NS_MAXCDNAME) < 0) {
+        fprintf(stderr, "bench_packet_build() invalid name %s\n", p->name);
+        exit(1);
+    }
+    /* Skip over name labels, name is not lower cased so corpus keeps case. */
+    for (len = 12; buf[len] != 0; len += buf[len] + 1);
+    len += 1;
+    rip_ns_put16(buf + len, p->qtype);
+    rip_ns_put16(buf + len + 2, rip_ns_c_in);
+    len += 4;
+    if (p->edns) {
+        uint8_t opt[] = { 0, 0, 41, 0x04, 0xd0, 0, 0, 0, 0, 0, 0 };
+        uint8_t ecs[] = { 0, 8, 0, 7, 0, 1, 24, 0, 198, 51, 100 };
+
+        if (p->ecs) {
+            opt[10] = sizeof(ecs);
+        }
+        memcpy(buf + len, opt, sizeof(opt));
+        len += sizeof(opt);
+        if (p->ecs) {
+            memcpy(buf + len, ecs, sizeof(ecs));
+            len += sizeof(ecs);
+        }
+    }
+    q->request_buffer_len = len;
+}
+
+static void
+bench_query_parse(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    query_reset(q);
+    query_parse(q);
+    b->sink += q->end_code;
+}
+
+static void
+bench_query_resolve(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    query_reset(q);
+    query_parse(q);
+    query_resolve(q, b->db, NULL, NULL, NULL);
+    b->sink += q->answer_section_count;
+}
+
+static void
+bench_query_response_pack(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    query_reset(q);
+    query_parse(q);
+    query_resolve(q, b->db, NULL, NULL, NULL);
+    query_response_pack(q);
+    b->sink += q->response_buffer_len;
+}
+
+static void
+bench_query_log(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    b->sink += query_log(b->log_buf, sizeof(b->log_buf), q);
+}
+
+static void
+bench_query_log_text(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    query_log(b->log_buf, sizeof(b->log_buf), q);
+    b->sink += query_log_record_to_text(b->log_buf, b->text_buf, sizeof(b->text_buf));
+}
+
+static void
+bench_name_unpack(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    b->sink += rip_ns_name_unpack(q->request_buffer,
+                                  q->request_buffer + q->request_buffer_len,
+                                  q->request_buffer + 12, b->names[i % BENCH_CORPUS_LEN],
+                                  RIP_NS_MAXCDNAME);
+}
+
+static void
+bench_name_pack(bench_t *b, size_t i)
+{
+    const unsigned char *name      = b->names[i % BENCH_CORPUS_LEN];
+    int                  len;
+
+    /* Second name is compressed against first. */
+    rip_ns_comp_reset(&b->comp);
+    len = rip_ns_name_pack(name, b->pack_buf + 12, sizeof(b->pack_buf) - 12, &b->comp);
+    b->sink += rip_ns_name_pack(name, b->pack_buf + 12 + len,
+                                sizeof(b->pack_buf) - 12 - len, &b->comp);
+}
+
+static void
+bench_name_hash(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    b->sink += rip_ns_name_hash(q->query_qname, q->query_qname_len);
+}
+
+static void
+bench_str_to_lc(bench_t *b, size_t i)
+{
+    query_t *q = &b->queries[i % BENCH_CORPUS_LEN];
+
+    str_to_lc(q->query_label, q->query_label_len);
+    b->sink += q->query_label[0];
+}
+
+/** Open a perf event counter of this thread, user space only.
+ *
+ * @param config Hardware event to count.
+ * @param group  Group leader file descriptor, -1 to open a group leader.
+ *
+ * @return       Returns file descriptor, -1 if event is not available.
+ */
+static int
+bench_perf_open(uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = config;
+    attr.disabled       = group == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static uint64_t
+bench_perf_read(int fd)
+{
+    uint64_t value = 0;
+
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+
+static uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** Print results of a benchmark.
+ *
+ * @param name         Benchmark name.
+ * @param ns           Time benchmark took.
+ * @param instructions Instructions benchmark executed.
+ * @param cache_misses Cache misses of benchmark.
+ * @param perf         Performance counters, counters not available are
+ *                     printed as "-".
+ * @param ops          Number of operations benchmark ran.
+ */
+static void
+bench_print(const char *name, uint64_t ns, uint64_t instructions, uint64_t cache_misses,
+            bench_perf_t *perf, size_t ops)
+{
+    printf("%-28s %10.1f", name, (double)ns / ops);
+    if (perf != NULL && perf->fd_instructions > -1) {
+        printf(" %12.1f", (double)instructions / ops);
+    } else {
+        printf(" %12s", "-");
+    }
+    if (perf != NULL && perf->fd_cache_misses > -1) {
+        printf(" %12.3f\n", (double)cache_misses / ops);
+    } else {
+        printf(" %12s\n", "-");
+    }
+}
+
+/** Run a benchmark and print its results.
+ *
+ * @param b    Benchmark state.
+ * @param perf Performance counters.
+ * @param name Benchmark name.
+ * @param fn   Benchmark function, runs a single operation.
+ * @param ops  Number of operations to run.
+ */
+static void
+bench_run(bench_t *b, bench_perf_t *perf, const char *name, bench_fn_t fn, size_t ops)
+{
+    uint64_t start;
+    uint64_t ns;
+    uint64_t instructions;
+    uint64_t cache_misses;
+
+    /* Warm up caches and branch predictors. */
+    for (size_t i = 0; i < ops / 10 + BENCH_CORPUS_LEN; i++) {
+        fn(b, i);
+    }
+
+    if (perf->fd_instructions > -1) {
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    start = bench_now_ns();
+    for (size_t i = 0; i < ops; i++) {
+        fn(b, i);
+    }
+    ns = bench_now_ns() - start;
+    if (perf->fd_instructions > -1) {
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    instructions = bench_perf_read(perf->fd_instructions);
+    cache_misses = bench_perf_read(perf->fd_cache_misses);
+
+    bench_print(name, ns, instructions, cache_misses, perf, ops);
+}
+
+/** Replay queries of a pcap file through vectorloop UDP stages and print
+ * time each stage took per query, from "loop_stage_metrics" cycle counts,
+ * followed by whole replay with its instructions and cache misses. Replay
+ * runs twice, first run warms up caches and is not reported.
+ *
+ * @param b             Benchmark state, its zone database is used if no zone
+ *                      file is given.
+ * @param perf          Performance counters.
+ * @param pcap_filepath Path of pcap file with queries.
+ * @param zone_filepath Path of zone file to resolve queries against, NULL to
+ *                      use benchmark zone.
+ * @param ops           Number of queries to replay.
+ *
+ * @return              Returns 0 on success, -1 if pcap or zone file could
+ *                      not be loaded.
+ */
+static int
+bench_replay(bench_t *b, bench_perf_t *perf, const char *pcap_filepath,
+             const char *zone_filepath, size_t ops)
+{
+    static const struct {
+        const char         *name;
+        metrics_vl_stage_t  stage;
+    } stages[] = {
+        { "vl_replay:udp_read",      METRICS_VL_STAGE_UDP_READ },
+        { "vl_replay:query_parse",   METRICS_VL_STAGE_QUERY_PARSE },
+        { "vl_replay:query_resolve", METRICS_VL_STAGE_QUERY_RESOLVE },
+        { "vl_replay:response_pack", METRICS_VL_STAGE_RESPONSE_PACK },
+        { "vl_replay:write",         METRICS_VL_STAGE_WRITE },
+        { "vl_replay:query_log",     METRICS_VL_STAGE_QUERY_LOG },
+    };
+    uint64_t        cycles[METRICS_VL_STAGES] = {};
+    uint64_t        cycles_per_sec            = utl_cycles_per_sec();
+    config_t        cfg;
+    vl_replay_t     replay;
+    zone_db_t      *db                        = b->db;
+    metrics_t      *metrics                   = NULL;
+    metrics_vl_t   *metrics_vl                = NULL;
+    resource_set_t *resources                 = NULL;
+    channel_log_t  *app_log_channel           = NULL;
+    vl_drain_t      drain;
+    vectorloop_t   *vl                        = NULL;
+    char            err[256]                  = {'\0'};
+    uint64_t        start;
+    uint64_t        ns;
+    uint64_t        instructions;
+    uint64_t        cache_misses;
+
+    config_init(&cfg);
+    cfg.loop_stage_metrics = true;
+
+    if (vl_replay_load(&replay, pcap_filepath, cfg.udp_listener_port, err, sizeof(err)) < 0) {
+        fprintf(stderr, "Could not load queries to replay, %s\n", err);
+        config_clean(&cfg);
+        return -1;
+    }
+    if (zone_filepath != NULL) {
+        char   *buf     = NULL;
+        size_t  buf_len = 0;
+        FILE   *f       = fopen(zone_filepath, "r");
+
+        if (f != NULL && fseek(f, 0, SEEK_END) == 0) {
+            buf_len = ftell(f);
+            buf     = malloc(buf_len + 1);
+            CHECK_MALLOC(buf);
+            rewind(f);
+            buf_len = fread(buf, 1, buf_len, f);
+            db      = zone_db_create(buf, buf_len, 1, err, sizeof(err));
+            free(buf);
+        } else {
+            snprintf(err, sizeof(err), "could not open \"%s\"", zone_filepath);
+            db = NULL;
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+        if (db == NULL) {
+            fprintf(stderr, "Could not create zone database, %s\n", err);
+            vl_replay_clean(&replay);
+            config_clean(&cfg);
+            return -1;
+        }
+    }
+
+    /* Vectorloop reads zone database and configuration from resource set,
+     * same as when resource thread publishes them.
+     */
+    metrics = aligned_alloc(CACHE_LINE_SIZE, sizeof(metrics_t));
+    CHECK_MALLOC(metrics);
+    metrics_init(metrics, 1);
+    resources = aligned_alloc(CACHE_LINE_SIZE, sizeof(resource_set_t));
+    CHECK_MALLOC(resources);
+    resource_set_init(resources, 1);
+    atomic_store(&resources->resources[RESOURCE_ID_ZONE_DB], db);
+    atomic_store(&resources->resources[RESOURCE_ID_CONFIG], &cfg);
+    app_log_channel = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_log_t));
+    CHECK_MALLOC(app_log_channel);
+    channel_log_init(app_log_channel, -1);
+    vl_drain_init(&drain, 1);
+
+    vl = vl_new(&cfg, 0, resources, app_log_channel, metrics, NULL, NULL, NULL, NULL,
+                NULL, NULL, &drain);
+    metrics_vl = metrics_vl_get(metrics, 0);
+
+    /* Warm up caches and branch predictors. */
+    vl_replay_reset(&replay, ops / 10 + replay.frame_count);
+    vl_replay_run(vl, &replay);
+
+    for (size_t i = 0; i < METRICS_VL_STAGES; i++) {
+        cycles[i] = atomic_load(&metrics_vl->loop.cycles[i].sum);
+    }
+    vl_replay_reset(&replay, ops);
+    if (perf->fd_instructions > -1) {
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    start = bench_now_ns();
+    vl_replay_run(vl, &replay);
+    ns = bench_now_ns() - start;
+    if (perf->fd_instructions > -1) {
+        ioctl(perf->fd_instructions, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    instructions = bench_perf_read(perf->fd_instructions);
+    cache_misses = bench_perf_read(perf->fd_cache_misses);
+
+    for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+        uint64_t c = atomic_load(&metrics_vl->loop.cycles[stages[i].stage].sum) -
+                     cycles[stages[i].stage];
+
+        bench_print(stages[i].name,
+                    (uint64_t)((unsigned __int128)c * 1000000000 / cycles_per_sec),
+                    0, 0, NULL, ops);
+    }
+    bench_print("vl_replay", ns, instructions, cache_misses, perf, ops);
+    printf("vl_replay: %zu queries in pcap, %llu responses of %.1f bytes on average\n",
+           replay.frame_count, (unsigned long long)replay.responses,
+           replay.responses > 0 ? (double)replay.response_bytes / replay.responses : 0.0);
+    b->sink += replay.responses;
+
+    /* Vectorloop, and configuration it uses, is not freed, it lives until
+     * benchmark exits.
+     */
+    if (db != b->db) {
+        zone_db_release(db);
+    }
+    vl_replay_clean(&replay);
+    return 0;
+}
+/**! @endcond */
+
+/** Microbenchmark main function.
+ *
+ * @param argc Number of CLI arguments
+ * @param argv Array of CLI arguments, optional number of operations and
+ *             benchmark name filter.
+ *
+ * @return     Returns 0 on success.
+ */
+int
+main(int argc, char *argv[])
+{
+    static const struct {
+        const char *name;
+        bench_fn_t  fn;
+    } benches[] = {
+        { "query_parse",              bench_query_parse },
+        { "query_parse+resolve",      bench_query_resolve },
+        { "query_parse+resolve+pack", bench_query_response_pack },
+        { "query_log",                bench_query_log },
+        { "query_log+to_text",        bench_query_log_text },
+        { "rip_ns_name_unpack",       bench_name_unpack },
+        { "rip_ns_name_pack",         bench_name_pack },
+        { "rip_ns_name_hash",         bench_name_hash },
+        { "str_to_lc",                bench_str_to_lc },
+    };
+    size_t        ops    = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_OPS_DEFAULT;
+    const char   *filter = argc > 2 ? argv[2] : NULL;
+    const char   *pcap   = argc > 3 ? argv[3] : NULL;
+    const char   *zone   = argc > 4 ? argv[4] : NULL;
+    int           ret    = 0;
+    bench_t      *b      = aligned_alloc(CACHE_LINE_SIZE, sizeof(bench_t));
+    bench_perf_t  perf;
+    char          err[256] = {'\0'};
+
+    if (b == NULL || ops == 0) {
+        fprintf(stderr, "Usage: %s [ops] [name] [pcap [zone_file]]\n", argv[0]);
+        return 1;
+    }
+    memset(b, 0, sizeof(bench_t));
+
+    config_init(&b->cfg);
+    rip_ns_comp_init(&b->comp, b->pack_buf);
+    b->db = zone_db_create(bench_zone_file, strlen(bench_zone_file), 1, err, sizeof(err));
+    if (b->db == NULL) {
+        fprintf(stderr, "Could not create zone database, %s\n", err);
+        return 1;
+    }
+
+    /* Queries are parsed, resolved and packed once, so query_log and name
+     * benchmarks have input.
+     */
+    for (size_t i = 0; i < BENCH_CORPUS_LEN; i++) {
+        query_t            *q   = &b->queries[i];
+        struct sockaddr_in *sin;
+
+        query_init(q, &b->cfg, 0);
+        sin = (struct sockaddr_in *)q->client_ip;
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(5353);
+        inet_pton(AF_INET, "192.0.2.99", &sin->sin_addr);
+        sin = (struct sockaddr_in *)q->local_ip;
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(53);
+        inet_pton(AF_INET, "192.0.2.1", &sin->sin_addr);
+        bench_packet_build(q, &bench_corpus[i]);
+        bench_query_response_pack(b, i);
+        bench_name_unpack(b, i);
+    }
+
+    perf.fd_instructions = bench_perf_open(PERF_COUNT_HW_INSTRUCTIONS, -1);
+    perf.fd_cache_misses = perf.fd_instructions < 0 ? -1 :
+                           bench_perf_open(PERF_COUNT_HW_CACHE_MISSES, perf.fd_instructions);
+
+    printf("%-28s %10s %12s %12s\n", "benchmark", "ns/op", "instr/op", "misses/op");
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (filter == NULL || strstr(benches[i].name, filter) != NULL) {
+            bench_run(b, &perf, benches[i].name, benches[i].fn, ops);
+        }
+    }
+    if (pcap != NULL && (filter == NULL || strstr("vl_replay", filter) != NULL)) {
+        ret = bench_replay(b, &perf, pcap, zone, ops) < 0 ? 1 : 0;
+    }
+
+    for (size_t i = 0; i < BENCH_CORPUS_LEN; i++) {
+        query_clean(&b->queries[i]);
+    }
+    zone_db_release(b->db);
+    config_clean(&b->cfg);
+    if (perf.fd_cache_misses > -1) {
+        close(perf.fd_cache_misses);
+    }
+    if (perf.fd_instructions > -1) {
+        close(perf.fd_instructions);
+    }
+    /* Keep results of benchmark functions alive. */
+    if (b->sink == 0) {
+        printf("\n");
+    }
+    free(b);
+    return ret;
+}
+
+/** @}*/
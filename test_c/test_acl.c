@@ -0,0 +1,146 @@
+/**
+ * @file test_acl.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup acl_ut Client ACL
+ *
+ * @brief Client ACL unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acl.h"
+
+/**! @cond */
+TestSuite(acl);
+
+static const char *test_acl_file =
+    "; test ACL\n"
+    "0.0.0.0/0           refuse\n"
+    "10.0.0.0/8          allow\n"
+    "10.66.0.0/16        DROP   ; abusive network\n"
+    "\n"
+    "2001:db8::/32       allow\n"
+    "2001:db8:66::/48    drop\n";
+
+static struct sockaddr_storage
+test_acl_addr(const char *ip)
+{
+    struct sockaddr_storage ss = {};
+
+    if (strchr(ip, ':') == NULL) {
+        ss.ss_family = AF_INET;
+        cr_assert(inet_pton(AF_INET, ip, &((struct sockaddr_in *)&ss)->sin_addr) == 1);
+    } else {
+        ss.ss_family = AF_INET6;
+        cr_assert(inet_pton(AF_INET6, ip, &((struct sockaddr_in6 *)&ss)->sin6_addr) == 1);
+    }
+    return ss;
+}
+
+static void
+test_acl_check(acl_t *acl, const char *ip, acl_action_t action)
+{
+    struct sockaddr_storage ss = test_acl_addr(ip);
+
+    cr_assert(acl_check(acl, &ss) == action, "%s action %d, expected %d", ip,
+              acl_check(acl, &ss), action);
+}
+/**! @endcond */
+
+/** Test longest matching prefix decides action, unmatched addresses are
+ * allowed.
+ */
+Test(acl, test_acl_check) {
+    char   err[256] = {'\0'};
+    acl_t *acl      = acl_create(test_acl_file, strlen(test_acl_file), 1, err, sizeof(err));
+
+    cr_assert(acl != NULL, "%s", err);
+    cr_assert(acl->generation == 1);
+
+    test_acl_check(acl, "192.0.2.1", ACL_ACTION_REFUSE);
+    test_acl_check(acl, "10.1.2.3", ACL_ACTION_ALLOW);
+    test_acl_check(acl, "10.66.2.3", ACL_ACTION_DROP);
+    test_acl_check(acl, "10.67.0.0", ACL_ACTION_ALLOW);
+
+    /* IPv4 mapped IPv6 addresses are checked as IPv4. */
+    test_acl_check(acl, "::ffff:10.66.0.1", ACL_ACTION_DROP);
+    test_acl_check(acl, "::ffff:192.0.2.1", ACL_ACTION_REFUSE);
+
+    /* No IPv6 default prefix, unmatched addresses are allowed. */
+    test_acl_check(acl, "2001:db8:1::1", ACL_ACTION_ALLOW);
+    test_acl_check(acl, "2001:db8:66:1::1", ACL_ACTION_DROP);
+    test_acl_check(acl, "2001:db9::1", ACL_ACTION_ALLOW);
+
+    acl_release(acl);
+
+    /* Empty ACL allows everything. */
+    acl = acl_create("", 0, 2, err, sizeof(err));
+    cr_assert(acl != NULL, "%s", err);
+    test_acl_check(acl, "192.0.2.1", ACL_ACTION_ALLOW);
+    acl_release(acl);
+}
+
+/** Test only addresses matching an allow prefix are allowlisted, not those
+ * allowed as no prefix matches them.
+ */
+Test(acl, test_acl_check_allowlisted) {
+    char                    err[256] = {'\0'};
+    acl_t                  *acl      = acl_create(test_acl_file, strlen(test_acl_file), 1,
+                                                  err, sizeof(err));
+    const char             *ips[]    = { "10.1.2.3", "2001:db8:1::1", "10.66.2.3",
+                                         "192.0.2.1", "2001:db9::1" };
+    bool                    listed[] = { true, true, false, false, false };
+    struct sockaddr_storage ss;
+    bool                    allowlisted;
+
+    cr_assert(acl != NULL, "%s", err);
+    for (size_t i = 0; i < sizeof(listed) / sizeof(listed[0]); i++) {
+        ss = test_acl_addr(ips[i]);
+        cr_assert(acl_check_allowlisted(acl, &ss, &allowlisted) == acl_check(acl, &ss));
+        cr_assert(allowlisted == listed[i], "%s", ips[i]);
+    }
+    acl_release(acl);
+}
+
+/** Test ACL file errors. */
+Test(acl, test_acl_create_errors) {
+    char   err[256] = {'\0'};
+    acl_t *acl;
+
+    acl = acl_create("10.0.0.0/8 deny\n", 16, 1, err, sizeof(err));
+    cr_assert(acl == NULL);
+    cr_assert(strcmp(err, "invalid action \"deny\"") == 0, "%s", err);
+
+    acl = acl_create("10.0.0.0/8 allow\n10.0.0.1/8 drop\n", 32, 1, err, sizeof(err));
+    cr_assert(acl == NULL);
+    cr_assert(strstr(err, "line 2: prefix") != NULL, "%s", err);
+}
+
+/** @}*/
@@ -0,0 +1,79 @@
+/**
+ * @file test_admin.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup admin_ut Admin socket
+ *
+ * @brief Admin socket unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "admin.h"
+
+/**! @cond */
+TestSuite(admin);
+/**! @endcond */
+
+/** Test published state snapshot is read back and formatted a line per
+ * vectorloop, and snapshot being published is not read as consistent.
+ */
+Test(admin, test_admin_vl_format) {
+    admin_vl_state_t *states = admin_vl_states_new(2);
+    uint64_t          values[ADMIN_VL_FIELDS];
+    char              buf[2 * ADMIN_VL_LINE_MAX];
+    size_t            len;
+
+    cr_assert(((uintptr_t)&states[1] % CACHE_LINE_SIZE) == 0);
+
+    admin_vl_publish_begin(&states[1]);
+    admin_vl_set(&states[1], ADMIN_VL_ITERATIONS, 7);
+    admin_vl_set(&states[1], ADMIN_VL_CONNS_TCP_ACTIVE, 3);
+    admin_vl_set(&states[1], ADMIN_VL_CONFIG_GENERATION, 2);
+    cr_assert(admin_vl_read(&states[1], values) == -1);
+    admin_vl_publish_end(&states[1]);
+
+    cr_assert(admin_vl_read(&states[1], values) == 0);
+    cr_assert(values[ADMIN_VL_ITERATIONS] == 7);
+    cr_assert(values[ADMIN_VL_CONNS_TCP_ACTIVE] == 3);
+    cr_assert(values[ADMIN_VL_QUERY_PARSE_QUEUE] == 0);
+
+    len = admin_vl_format(states, 2, buf, sizeof(buf));
+    cr_assert(len == strlen(buf));
+    cr_assert(strncmp(buf, "vl=0 iterations=0 ", 18) == 0);
+    cr_assert(strstr(buf, "\nvl=1 iterations=7 ") != NULL);
+    cr_assert(strstr(buf, " conns_tcp_active=3 ") != NULL);
+    cr_assert(strstr(buf, " config_generation=2\n") != NULL);
+    cr_assert(strstr(buf, "torn") == NULL);
+
+    /* Text is truncated to buffer. */
+    len = admin_vl_format(states, 2, buf, 32);
+    cr_assert(len == 31 && strlen(buf) == 31);
+
+    free(states);
+}
+
+/** @}*/
@@ -0,0 +1,149 @@
+/**
+ * @file test_arena.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup arena_ut Memory Arena
+ *
+ * @brief Memory arena unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "config.h"
+#include "conn.h"
+#include "query.h"
+
+/**! @cond */
+TestSuite(arena);
+/**! @endcond */
+
+/** Test objects are cache line aligned, zero filled and arena is exhausted
+ * once its space is used up.
+ */
+Test(arena, test_arena_alloc) {
+    arena_t        arena;
+    size_t         page = sysconf(_SC_PAGESIZE);
+    unsigned char *a;
+    unsigned char *b;
+
+    cr_assert(arena_init(&arena, 1, ARENA_PREFAULT) == 0);
+    cr_assert(arena.base != NULL);
+    cr_assert(arena.size == page, "arena is rounded up to page size");
+    cr_assert(arena.used == 0);
+
+    a = arena_alloc(&arena, 1);
+    b = arena_alloc(&arena, CACHE_LINE_SIZE + 1);
+    cr_assert(a == arena.base);
+    cr_assert(b == a + CACHE_LINE_SIZE);
+    cr_assert((uintptr_t)b % CACHE_LINE_SIZE == 0);
+    cr_assert(arena.used == CACHE_LINE_SIZE * 3);
+    for (size_t i = 0; i < CACHE_LINE_SIZE + 1; i++) {
+        cr_assert(b[i] == 0);
+    }
+
+    cr_assert(arena_alloc(&arena, page) == NULL);
+    cr_assert(arena_alloc(&arena, page - arena.used) != NULL);
+    cr_assert(arena.used == arena.size);
+    cr_assert(arena_alloc(&arena, 1) == NULL);
+
+    arena_clean(&arena);
+    cr_assert(arena.base == NULL);
+    cr_assert(arena_alloc(&arena, 1) == NULL);
+}
+
+/** Test arena falls back to regular pages when explicit huge pages are
+ * requested but none are reserved, and is usable either way.
+ */
+Test(arena, test_arena_hugetlb) {
+    arena_t arena;
+
+    cr_assert(arena_init(&arena, 4096, ARENA_HUGETLB | ARENA_THP | ARENA_PREFAULT) == 0);
+    cr_assert(arena.base != NULL);
+    if (arena.hugetlb) {
+        cr_assert(arena.size == ARENA_HUGETLB_SIZE);
+    } else {
+        cr_assert(arena.size == (size_t)sysconf(_SC_PAGESIZE));
+    }
+    cr_assert(arena_alloc(&arena, 4096) != NULL);
+
+    arena_clean(&arena);
+}
+
+/** Test UDP connection object is carved out of arena in one contiguous block
+ * of the size reported for it, with read vector pointing into query buffers.
+ */
+Test(arena, test_arena_conn_udp) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_udp_t *conn_udp;
+    size_t      size;
+
+    config_init(&cfg);
+    cfg.udp_conn_vector_len = 16;
+    cfg.udp_gso             = true;
+    size = conn_udp_arena_size(&cfg);
+
+    cr_assert(arena_init(&arena, size * 2, 0) == 0);
+    conn_udp = conn_udp_new(&cfg, AF_INET6, &arena);
+    cr_assert(arena.used == size);
+    cr_assert((unsigned char *)conn_udp == arena.base);
+    cr_assert(conn_udp->vector_len == 16);
+    cr_assert(conn_udp->write_control != NULL);
+
+    for (unsigned int i = 0; i < conn_udp->vector_len; i++) {
+        struct msghdr *mh = &conn_udp->read_vector[i].msg_hdr;
+        query_t       *q  = &conn_udp->queries[i];
+
+        cr_assert(mh->msg_iov->iov_base == q->request_buffer);
+        cr_assert(mh->msg_iov->iov_len == RIP_NS_PACKETSZ + 1);
+        cr_assert(mh->msg_namelen == sizeof(struct sockaddr_storage));
+        cr_assert(mh->msg_controllen == UDP_MSG_CONTROL_LEN);
+        cr_assert(conn_udp->write_vector[i].msg_hdr.msg_iov == &conn_udp->write_iov[i]);
+        cr_assert(q->protocol == 0);
+        cr_assert(q->response_buffer_size == RIP_NS_UDP_MAXMSG);
+        cr_assert((void *)q->response_hdr == (void *)q->response_buffer);
+        cr_assert(q->comp.msg == (unsigned char *)q->response_hdr);
+        cr_assert((unsigned char *)q->query_label >= arena.base &&
+                  (unsigned char *)q->query_label < arena.base + size);
+        if (i > 0) {
+            cr_assert((unsigned char *)mh->msg_name ==
+                      (unsigned char *)conn_udp->read_vector[i - 1].msg_hdr.msg_name +
+                      sizeof(struct sockaddr_storage));
+        }
+    }
+
+    /* Second listener fits in the rest of arena. */
+    conn_udp_new(&cfg, AF_INET, &arena);
+    cr_assert(arena.used == size * 2);
+
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,104 @@
+/**
+ * @file test_buf_pool.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup buf_pool_ut Buffer Pool
+ *
+ * @brief Buffer pool unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "buf_pool.h"
+
+/**! @cond */
+TestSuite(buf_pool);
+/**! @endcond */
+
+/** Test buffer pool size classes. */
+Test(buf_pool, test_buf_pool_init) {
+    buf_pool_t pool;
+
+    buf_pool_init(&pool, 4096, 65537, 2, MEM_TAG_TCP_BUFS);
+    cr_assert(pool.classes_count == 6);
+    cr_assert(pool.classes[0].size == 4096);
+    cr_assert(pool.classes[4].size == 65536);
+    cr_assert(pool.classes[5].size == 65537);
+    buf_pool_clean(&pool);
+
+    /* Maximum size is a power of two multiple of minimum size. */
+    buf_pool_init(&pool, 1024, 4096, 2, MEM_TAG_TCP_BUFS);
+    cr_assert(pool.classes_count == 3);
+    cr_assert(pool.classes[2].size == 4096);
+    buf_pool_clean(&pool);
+
+    /* Number of size classes is limited, last one is of maximum size. */
+    buf_pool_init(&pool, 16, 1 << 20, 2, MEM_TAG_TCP_BUFS);
+    cr_assert(pool.classes_count == BUF_POOL_CLASSES_MAX);
+    cr_assert(pool.classes[BUF_POOL_CLASSES_MAX - 1].size == 1 << 20);
+    buf_pool_clean(&pool);
+}
+
+/** Test getting buffers from pool, returning them, and reuse of returned
+ * buffers.
+ */
+Test(buf_pool, test_buf_pool_get_put) {
+    buf_pool_t pool;
+    void      *buf[3];
+    size_t     size[3];
+
+    buf_pool_init(&pool, 4096, 65537, 2, MEM_TAG_TCP_BUFS);
+
+    /* Smallest size class that holds size. */
+    buf[0] = buf_pool_get(&pool, 1, &size[0]);
+    cr_assert(buf[0] != NULL && size[0] == 4096);
+    buf[1] = buf_pool_get(&pool, 4097, &size[1]);
+    cr_assert(buf[1] != NULL && size[1] == 8192);
+    buf[2] = buf_pool_get(&pool, 65537, &size[2]);
+    cr_assert(buf[2] != NULL && size[2] == 65537);
+    cr_assert(buf_pool_get(&pool, 65538, &size[2]) == NULL);
+
+    /* Returned buffer is reused. */
+    buf_pool_put(&pool, buf[1], size[1]);
+    cr_assert(pool.classes[1].free_count == 1);
+    cr_assert(buf_pool_get(&pool, 5000, &size[1]) == buf[1]);
+    cr_assert(pool.classes[1].free_count == 0);
+
+    buf_pool_put(&pool, buf[1], size[1]);
+    buf_pool_put(&pool, buf[2], size[2]);
+
+    /* Size class keeps at most free_max buffers. */
+    buf[1] = buf_pool_get(&pool, 4096, &size[1]);
+    buf[2] = buf_pool_get(&pool, 4096, &size[2]);
+    buf_pool_put(&pool, buf[0], size[0]);
+    buf_pool_put(&pool, buf[1], size[1]);
+    buf_pool_put(&pool, buf[2], size[2]);
+    cr_assert(pool.classes[0].free_count == 2);
+
+    buf_pool_clean(&pool);
+    cr_assert(pool.classes_count == 0);
+}
+
+/** @}*/
@@ -0,0 +1,238 @@
+/**
+ * @file test_channel.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup channel_ut Channels
+ *
+ * @brief Log channel unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "channel.h"
+
+/**! @cond */
+TestSuite(channel);
+
+#define TEST_CHANNEL_MSGS 100000
+
+static channel_log_t *
+test_channel_new(void)
+{
+    channel_log_t *ch = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_log_t));
+
+    cr_assert(ch != NULL);
+    channel_log_init(ch, -1);
+    return ch;
+}
+
+static void *
+test_channel_sender(void *arg)
+{
+    channel_log_t *ch = arg;
+
+    for (int i = 0; i < TEST_CHANNEL_MSGS; i++) {
+        while (channel_log_write(ch, 0, false, "msg %d", i) == 0) {
+            channel_log_flush(ch);
+            sched_yield();
+        }
+        if (i % 7 == 0) {
+            channel_log_flush(ch);
+        }
+    }
+    channel_log_flush(ch);
+    return NULL;
+}
+/**! @endcond */
+
+/** Test messages written are received once flushed, in order. */
+Test(channel, test_channel_log_write_flush) {
+    channel_log_t     *ch = test_channel_new();
+    channel_log_msg_t *msgs[8];
+
+    cr_assert(channel_log_write(ch, 0, false, "first %d", 1) == 1);
+    cr_assert(channel_log_write(ch, 3, false, NULL) == 1);
+    cr_assert(channel_log_recv(ch, msgs, 8) == 0);
+
+    channel_log_flush(ch);
+    cr_assert(channel_log_recv(ch, msgs, 8) == 2);
+    cr_assert(msgs[0]->log_msg_id == 0);
+    cr_assert(strcmp(msgs[0]->log_msg, "first 1") == 0);
+    cr_assert(msgs[0]->log_msg_len == 7);
+    cr_assert(msgs[1]->log_msg_id == 3);
+    cr_assert(msgs[1]->log_msg_len == 0);
+
+    /* Messages stay in channel until released. */
+    cr_assert(channel_log_recv(ch, msgs, 1) == 1);
+    channel_log_release(ch, 2);
+    cr_assert(channel_log_recv(ch, msgs, 8) == 0);
+
+    /* Send publishes messages written before it, fatal messages are
+     * published right away.
+     */
+    channel_log_write(ch, 0, false, "a");
+    channel_log_send(ch, 0, false, "b");
+    cr_assert(channel_log_recv(ch, msgs, 8) == 2);
+    channel_log_release(ch, 2);
+    channel_log_write(ch, 0, true, "fatal");
+    cr_assert(channel_log_recv(ch, msgs, 8) == 1);
+    cr_assert(msgs[0]->exit);
+    free(ch);
+}
+
+/** Test full channel drops messages, and long messages are truncated. */
+Test(channel, test_channel_log_full) {
+    channel_log_t     *ch = test_channel_new();
+    channel_log_msg_t *msgs[CHANNEL_LOG_QUEUE_LEN];
+    char               long_msg[CHANNEL_LOG_MSG_LEN * 2];
+
+    memset(long_msg, 'x', sizeof(long_msg) - 1);
+    long_msg[sizeof(long_msg) - 1] = '\0';
+    for (int i = 0; i < CHANNEL_LOG_QUEUE_LEN; i++) {
+        cr_assert(channel_log_write(ch, 0, false, "%s", long_msg) == 1);
+    }
+    cr_assert(channel_log_send(ch, 0, false, "dropped") == 0);
+    cr_assert(atomic_load(&ch->dropped) == 1);
+
+    cr_assert(channel_log_recv(ch, msgs, CHANNEL_LOG_QUEUE_LEN) == CHANNEL_LOG_QUEUE_LEN);
+    cr_assert(msgs[0]->log_msg_len == CHANNEL_LOG_MSG_LEN - 1);
+    cr_assert(strlen(msgs[0]->log_msg) == CHANNEL_LOG_MSG_LEN - 1);
+    channel_log_release(ch, CHANNEL_LOG_QUEUE_LEN);
+    cr_assert(channel_log_send(ch, 0, false, "fits") == 1);
+    free(ch);
+}
+
+/** Test predefined messages carry parameter, and errors are only counted. */
+Test(channel, test_channel_log_write_id) {
+    channel_log_t     *ch = test_channel_new();
+    channel_log_msg_t *msgs[8];
+
+    cr_assert(channel_log_write_id(ch, 2, 113, false) == 1);
+    channel_log_flush(ch);
+    cr_assert(channel_log_recv(ch, msgs, 8) == 1);
+    cr_assert(msgs[0]->log_msg_id == 2);
+    cr_assert(msgs[0]->log_msg_param == 113);
+    cr_assert(msgs[0]->log_msg_len == 0);
+    channel_log_release(ch, 1);
+
+    for (int i = 0; i < CHANNEL_LOG_QUEUE_LEN * 2; i++) {
+        channel_log_error(ch, 1, i);
+    }
+    channel_log_flush(ch);
+    cr_assert(channel_log_recv(ch, msgs, 8) == 0);
+    cr_assert(atomic_load(&ch->errors[0]) == 0);
+    cr_assert(atomic_load(&ch->errors[1]) == CHANNEL_LOG_QUEUE_LEN * 2);
+    cr_assert(atomic_load(&ch->errors_errno[1]) == CHANNEL_LOG_QUEUE_LEN * 2 - 1);
+    cr_assert(atomic_load(&ch->dropped) == 0);
+    free(ch);
+}
+
+/** Test sender wakes up log thread only when channel goes non-empty. */
+Test(channel, test_channel_log_wake) {
+    channel_log_t     *ch      = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_log_t));
+    int                wake_fd = eventfd(0, EFD_NONBLOCK);
+    channel_log_msg_t *msgs[8];
+    eventfd_t          value;
+
+    cr_assert(wake_fd > -1);
+    channel_log_init(ch, wake_fd);
+    cr_assert(channel_log_empty(ch));
+
+    channel_log_send(ch, 0, false, "a");
+    cr_assert(!channel_log_empty(ch));
+    cr_assert(eventfd_read(wake_fd, &value) == 0 && value == 1);
+
+    /* Channel was not empty, no wake up. */
+    channel_log_send(ch, 0, false, "b");
+    cr_assert(eventfd_read(wake_fd, &value) < 0);
+
+    cr_assert(channel_log_recv(ch, msgs, 8) == 2);
+    channel_log_release(ch, 2);
+    cr_assert(channel_log_empty(ch));
+    channel_log_send(ch, 0, false, "c");
+    cr_assert(eventfd_read(wake_fd, &value) == 0 && value == 1);
+
+    close(wake_fd);
+    free(ch);
+}
+
+/** Test messages sent from another thread are all received in order. */
+Test(channel, test_channel_log_threads) {
+    channel_log_t     *ch = test_channel_new();
+    channel_log_msg_t *msgs[64];
+    pthread_t          thread;
+    int                next = 0;
+    char               expect[32];
+
+    cr_assert(pthread_create(&thread, NULL, test_channel_sender, ch) == 0);
+    while (next < TEST_CHANNEL_MSGS) {
+        size_t count = channel_log_recv(ch, msgs, 64);
+
+        for (size_t i = 0; i < count; i++) {
+            snprintf(expect, sizeof(expect), "msg %d", next++);
+            cr_assert(strcmp(msgs[i]->log_msg, expect) == 0, "%s", msgs[i]->log_msg);
+        }
+        channel_log_release(ch, count);
+    }
+    pthread_join(thread, NULL);
+    free(ch);
+}
+
+/** Test connection channel keeps order, and refuses connections once full
+ * until receiver frees slots.
+ */
+Test(channel, test_channel_conn_send_recv) {
+    channel_conn_t     *ch = aligned_alloc(CACHE_LINE_SIZE, sizeof(channel_conn_t));
+    channel_conn_msg_t  msg = {};
+
+    cr_assert(ch != NULL);
+    channel_conn_init(ch);
+    cr_assert(!channel_conn_recv(ch, &msg));
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < CHANNEL_CONN_QUEUE_LEN; i++) {
+            msg.fd                  = 100 + i;
+            msg.queries_total_count = round * 1000 + i;
+            cr_assert(channel_conn_send(ch, &msg));
+        }
+        msg.fd = -1;
+        cr_assert(!channel_conn_send(ch, &msg));
+
+        for (int i = 0; i < CHANNEL_CONN_QUEUE_LEN; i++) {
+            cr_assert(channel_conn_recv(ch, &msg));
+            cr_assert(msg.fd == 100 + i, "fd %d", msg.fd);
+            cr_assert(msg.queries_total_count == (size_t)(round * 1000 + i));
+        }
+        cr_assert(!channel_conn_recv(ch, &msg));
+    }
+    free(ch);
+}
+
+/** @}*/
@@ -0,0 +1,620 @@
+/**
+ * @file test_conn.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup conn_ut Connection
+ *
+ * @brief Connection object unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "config.h"
+#include "conn.h"
+#include "query.h"
+
+/**! @cond */
+TestSuite(conn);
+/**! @endcond */
+
+/** Create UDP connection object from a new arena. */
+static conn_udp_t *
+test_conn_udp_new(config_t *cfg, arena_t *arena)
+{
+    cr_assert(arena_init(arena, conn_udp_arena_size(cfg), 0) == 0);
+    return conn_udp_new(cfg, AF_INET, arena);
+}
+
+/** Test active vector length grows on full reads, shrinks after a run of
+ * low reads and stays within its bounds.
+ */
+Test(conn, test_conn_udp_vector_len_adapt) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_udp_t *conn_udp;
+
+    config_init(&cfg);
+    cfg.udp_conn_vector_len     = 64;
+    cfg.udp_conn_vector_len_min = 4;
+    conn_udp = test_conn_udp_new(&cfg, &arena);
+    cr_assert(conn_udp->vector_len_active == 64);
+    cr_assert(conn_udp->vector_len_min == 4);
+
+    /* Low reads shrink only after a run of them. */
+    for (int i = 0; i < UDP_CONN_VECTOR_SHRINK_READS - 1; i++) {
+        conn_udp_vector_len_adapt(conn_udp, 64, 1);
+    }
+    cr_assert(conn_udp->vector_len_active == 64);
+    conn_udp_vector_len_adapt(conn_udp, 64, 1);
+    cr_assert(conn_udp->vector_len_active == 32);
+
+    /* A read at least half full breaks the run. */
+    for (int i = 0; i < UDP_CONN_VECTOR_SHRINK_READS - 1; i++) {
+        conn_udp_vector_len_adapt(conn_udp, 32, 1);
+    }
+    conn_udp_vector_len_adapt(conn_udp, 32, 16);
+    conn_udp_vector_len_adapt(conn_udp, 32, 1);
+    cr_assert(conn_udp->vector_len_active == 32);
+
+    /* Shrinks down to minimum only. */
+    for (int i = 0; i < UDP_CONN_VECTOR_SHRINK_READS * 8; i++) {
+        conn_udp_vector_len_adapt(conn_udp, conn_udp->vector_len_active, 0);
+    }
+    cr_assert(conn_udp->vector_len_active == 4);
+
+    /* Full read grows, a read limited by budget does not. */
+    conn_udp_vector_len_adapt(conn_udp, 2, 2);
+    cr_assert(conn_udp->vector_len_active == 4);
+    conn_udp_vector_len_adapt(conn_udp, 4, 4);
+    cr_assert(conn_udp->vector_len_active == 8);
+    for (int i = 0; i < 8; i++) {
+        conn_udp_vector_len_adapt(conn_udp, conn_udp->vector_len_active,
+                                  conn_udp->vector_len_active);
+    }
+    cr_assert(conn_udp->vector_len_active == 64);
+
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test active vector length stays fixed when adapting is disabled. */
+Test(conn, test_conn_udp_vector_len_fixed) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_udp_t *conn_udp;
+
+    config_init(&cfg);
+    conn_udp = test_conn_udp_new(&cfg, &arena);
+    cr_assert(conn_udp->vector_len_min == conn_udp->vector_len);
+    for (int i = 0; i < UDP_CONN_VECTOR_SHRINK_READS * 2; i++) {
+        conn_udp_vector_len_adapt(conn_udp, conn_udp->vector_len, 0);
+    }
+    cr_assert(conn_udp->vector_len_active == cfg.udp_conn_vector_len);
+
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test reloaded vector length bounds are capped to allocated vector length
+ * and active length is clamped to them.
+ */
+Test(conn, test_conn_udp_vector_len_set) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_udp_t *conn_udp;
+
+    config_init(&cfg);
+    cfg.udp_conn_vector_len     = 64;
+    cfg.udp_conn_vector_len_min = 4;
+    conn_udp = test_conn_udp_new(&cfg, &arena);
+
+    /* Lower maximum clamps active length and caps growth. */
+    conn_udp_vector_len_set(conn_udp, 16, 4);
+    cr_assert(conn_udp->vector_len_active == 16);
+    conn_udp_vector_len_adapt(conn_udp, 16, 16);
+    cr_assert(conn_udp->vector_len_active == 16);
+
+    /* Maximum can not exceed allocated vector length. */
+    conn_udp_vector_len_set(conn_udp, 1024, 32);
+    cr_assert(conn_udp->vector_len_max == 64);
+    cr_assert(conn_udp->vector_len_active == 32);
+
+    /* Minimum of 0 disables adapting. */
+    conn_udp_vector_len_set(conn_udp, 8, 0);
+    cr_assert(conn_udp->vector_len_min == 8);
+    cr_assert(conn_udp->vector_len_active == 8);
+
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test vectors reset only entries used by previous read. */
+Test(conn, test_conn_udp_vectors_reset) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_udp_t *conn_udp;
+
+    config_init(&cfg);
+    conn_udp = test_conn_udp_new(&cfg, &arena);
+
+    for (unsigned int i = 0; i < conn_udp->vector_len; i++) {
+        conn_udp->read_vector[i].msg_hdr.msg_namelen = 16;
+        conn_udp->queries[i].response_buffer_len     = 100;
+    }
+    conn_udp->read_vector_count  = 3;
+    conn_udp->query_index_count  = 3;
+    conn_udp->write_vector_count = 2;
+
+    conn_udp_vectors_reset(conn_udp);
+    cr_assert(conn_udp->read_vector_count == 0);
+    cr_assert(conn_udp->query_index_count == 0);
+    cr_assert(conn_udp->write_vector_count == 0);
+    cr_assert(conn_udp->write_vector_write_index == 0);
+    for (unsigned int i = 0; i < conn_udp->vector_len; i++) {
+        if (i < 3) {
+            cr_assert(conn_udp->read_vector[i].msg_hdr.msg_namelen ==
+                      sizeof(struct sockaddr_storage));
+            cr_assert(conn_udp->queries[i].response_buffer_len == 0);
+        } else {
+            cr_assert(conn_udp->read_vector[i].msg_hdr.msg_namelen == 16);
+            cr_assert(conn_udp->queries[i].response_buffer_len == 100);
+        }
+    }
+
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test priority lane queries are moved ahead of rest of index column, and
+ * both lanes keep their order.
+ */
+Test(conn, test_conn_udp_priority_first) {
+    query_t      queries[8] = {0};
+    uint16_t     index[]    = { 0, 2, 3, 5, 6, 7 };
+    uint16_t     expect[]   = { 3, 6, 0, 2, 5, 7 };
+    unsigned int count      = sizeof(index) / sizeof(index[0]);
+
+    cr_assert(conn_udp_priority_first(queries, index, count) == 0);
+    cr_assert(index[0] == 0 && index[5] == 7);
+
+    queries[3].priority = true;
+    queries[4].priority = true;
+    queries[6].priority = true;
+    cr_assert(conn_udp_priority_first(queries, index, count) == 2);
+    for (unsigned int j = 0; j < count; j++) {
+        cr_assert(index[j] == expect[j], "position %u", j);
+    }
+    /* Partition of partitioned column leaves it as is. */
+    cr_assert(conn_udp_priority_first(queries, index, count) == 2);
+    for (unsigned int j = 0; j < count; j++) {
+        cr_assert(index[j] == expect[j], "position %u", j);
+    }
+}
+
+/** Test listener batches share listener socket, are taken in order while
+ * free, and listener waiting for a batch is returned once one is freed.
+ */
+Test(conn, test_conn_udp_batches) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_t      listener = {.fd = 7, .ip_version = 1};
+    conn_t     *batch;
+
+    config_init(&cfg);
+    cr_assert(arena_init(&arena, conn_udp_arena_size(&cfg) * 3, 0) == 0);
+    listener.conn.udp = conn_udp_new(&cfg, AF_INET6, &arena);
+    conn_udp_batches_new(&listener, &cfg, 3, &arena);
+
+    cr_assert(listener.conn.udp->batches_count == 3);
+    cr_assert(listener.conn.udp->batches_free == 3);
+    cr_assert(listener.conn.udp->batches[0] == &listener);
+    for (unsigned int i = 0; i < 3; i++) {
+        batch = listener.conn.udp->batches[i];
+        cr_assert(batch->fd == 7);
+        cr_assert(batch->ip_version == 1);
+        cr_assert(CONN_IS_UDP_LISTENER(batch));
+        cr_assert(batch->conn.udp->listener == &listener);
+        cr_assert(i == 0 || batch->conn.udp != listener.conn.udp);
+    }
+
+    /* Batches are taken in order, until none is free. */
+    for (unsigned int i = 0; i < 3; i++) {
+        batch = conn_udp_batch_free(&listener);
+        cr_assert(batch == listener.conn.udp->batches[i]);
+        conn_udp_batch_hold(batch);
+    }
+    cr_assert(listener.conn.udp->batches_free == 0);
+    cr_assert(conn_udp_batch_free(&listener) == NULL);
+
+    /* Listener is returned only if it waited for a batch. */
+    cr_assert(conn_udp_batch_release(listener.conn.udp->batches[1]) == NULL);
+    cr_assert(conn_udp_batch_free(&listener) == listener.conn.udp->batches[1]);
+    conn_udp_batch_hold(listener.conn.udp->batches[1]);
+    listener.conn.udp->waiting_for_batch = 1;
+    cr_assert(conn_udp_batch_release(listener.conn.udp->batches[2]) == &listener);
+    cr_assert(listener.conn.udp->waiting_for_batch == 0);
+    cr_assert(listener.conn.udp->batches_free == 1);
+    cr_assert(conn_udp_batch_free(&listener) == listener.conn.udp->batches[2]);
+
+    for (unsigned int i = 1; i < 3; i++) {
+        free(listener.conn.udp->batches[i]);
+    }
+    free(listener.conn.udp->batches);
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test UDP listener receive buffer is doubled up to its max, at most once
+ * per interval.
+ */
+Test(conn, test_conn_udp_recvbuff_autotune) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_t      listener = {};
+    int         size     = 0;
+    socklen_t   len      = sizeof(size);
+
+    config_init(&cfg);
+    listener.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    cr_assert(listener.fd >= 0);
+    listener.conn.udp = test_conn_udp_new(&cfg, &arena);
+    listener.conn.udp->recvbuff_size = 4096;
+
+    /* Disabled. */
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 0, 1000) == 0);
+
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 20000, 1000) == 8192);
+    cr_assert(getsockopt(listener.fd, SOL_SOCKET, SO_RCVBUF, &size, &len) == 0);
+    cr_assert(size >= 8192);
+
+    /* Raised at most once per interval. */
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 20000, 1500) == 0);
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 20000,
+                                         1000 + UDP_CONN_RECVBUFF_AUTOTUNE_INTERVAL_MS) == 16384);
+
+    /* Capped at max, then not raised any more. */
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 20000, 10000) == 20000);
+    cr_assert(conn_udp_recvbuff_autotune(&listener, 20000, 20000) == 0);
+    cr_assert(listener.conn.udp->recvbuff_size == 20000);
+
+    close(listener.fd);
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test UDP and TCP listener socket options: drop count always, kernel
+ * receive timestamps only when configured.
+ */
+Test(conn, test_conn_listener_provision_opts) {
+    config_t    cfg;
+    arena_t     arena;
+    conn_t     *conn;
+    char        err[256] = {'\0'};
+    int         opt      = 0;
+    socklen_t   len      = sizeof(opt);
+
+    config_init(&cfg);
+    cfg.udp_listener_port = 0;
+    cfg.tcp_listener_port = 0;
+    cr_assert(arena_init(&arena, conn_udp_arena_size(&cfg) * cfg.udp_listener_batches, 0) == 0);
+
+    conn = conn_listener_provision(&cfg, AF_INET, IPPROTO_UDP, &arena, -1, err, sizeof(err));
+    cr_assert(conn != NULL, "%s", err);
+    cr_assert(conn->conn.udp->recvbuff_size == cfg.udp_socket_recvbuff_size);
+    cr_assert(getsockopt(conn->fd, SOL_SOCKET, SO_RXQ_OVFL, &opt, &len) == 0);
+    cr_assert(opt == 1);
+    cr_assert(getsockopt(conn->fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, &len) == 0);
+    cr_assert(opt == 0);
+    conn_release(conn);
+    arena_clean(&arena);
+
+    cfg.listener_rx_timestamps = true;
+    conn = conn_listener_provision(&cfg, AF_INET, IPPROTO_TCP, NULL, -1, err, sizeof(err));
+    cr_assert(conn != NULL, "%s", err);
+    cr_assert(getsockopt(conn->fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, &len) == 0);
+    cr_assert(opt == 1);
+    conn_release(conn);
+
+    config_clean(&cfg);
+}
+
+/** Test UDP listeners bound to addresses: first one has batches that record
+ * socket each datagram was received on, second one is a socket only sharing
+ * them, and both are bound to their address.
+ */
+Test(conn, test_conn_listener_provision_addr) {
+    config_t            cfg;
+    arena_t             arena;
+    conn_t             *first;
+    conn_t             *second;
+    char                err[256] = {'\0'};
+    struct sockaddr_in  sin      = {};
+    socklen_t           len      = sizeof(sin);
+    utl_net_t           addrs[2];
+
+    config_init(&cfg);
+    cfg.udp_listener_port = 0;
+    cr_assert(utl_net_parse(&addrs[0], "127.0.0.1") == 0);
+    cr_assert(utl_net_parse(&addrs[1], "127.0.0.2") == 0);
+    cfg.udp_listener_addresses       = addrs;
+    cfg.udp_listener_addresses_count = 2;
+    cr_assert(arena_init(&arena, conn_udp_arena_size(&cfg) * cfg.udp_listener_batches, 0) == 0);
+
+    first = conn_listener_provision_addr(&cfg, 0, NULL, &arena, err, sizeof(err));
+    cr_assert(first != NULL, "%s", err);
+    cr_assert(first->conn.udp->listener == first);
+    cr_assert(first->conn.udp->batches_count == cfg.udp_listener_batches);
+    for (unsigned int i = 0; i < first->conn.udp->batches_count; i++) {
+        cr_assert(first->conn.udp->batches[i]->conn.udp->read_socket != NULL);
+    }
+    cr_assert(getsockname(first->fd, (struct sockaddr *)&sin, &len) == 0);
+    cr_assert(sin.sin_addr.s_addr == htonl(0x7f000001));
+
+    second = conn_listener_provision_addr(&cfg, 1, first, &arena, err, sizeof(err));
+    cr_assert(second != NULL, "%s", err);
+    cr_assert(second->conn.udp->listener == first);
+    cr_assert(second->conn.udp->batches == NULL);
+    cr_assert(second->conn.udp->addr_index == 1);
+    cr_assert(second->ip_version == 0);
+    cr_assert(getsockname(second->fd, (struct sockaddr *)&sin, &len) == 0);
+    cr_assert(sin.sin_addr.s_addr == htonl(0x7f000002));
+
+    conn_release(second);
+    conn_release(first);
+    arena_clean(&arena);
+    cfg.udp_listener_addresses       = NULL;
+    cfg.udp_listener_addresses_count = 0;
+    config_clean(&cfg);
+}
+
+/** Set up configuration with UDP listeners bound to 127.0.0.1 and
+ * 127.0.0.2, on ports picked by kernel.
+ */
+static void
+test_conn_profiles_cfg(config_t *cfg)
+{
+    config_init(cfg);
+    cfg->udp_listener_port            = 0;
+    cfg->tcp_listener_port            = 0;
+    cfg->udp_listener_addresses       = malloc(sizeof(utl_net_t) * 2);
+    cfg->udp_listener_addresses_count = 2;
+    cr_assert(utl_net_parse(&cfg->udp_listener_addresses[0], "127.0.0.1") == 0);
+    cr_assert(utl_net_parse(&cfg->udp_listener_addresses[1], "127.0.0.2") == 0);
+}
+
+/** Test listener profiles: settings of a profile apply to its copy of
+ * configuration only, listeners are assigned to their profile, and UDP
+ * listener provisioned with profile configuration is sized by it.
+ */
+Test(conn, test_conn_listener_profiles) {
+    config_t    cfg;
+    config_t   *pcfg;
+    arena_t     arena;
+    conn_t     *conn;
+    char        err[256] = {'\0'};
+    const char *buf      = "# Resolver facing address.\n"
+                           "profile resolvers\n"
+                           "listener 127.0.0.2\n"
+                           "udp_conn_vector_len 64\n"
+                           "udp_socket_recvbuff_size 65536\n"
+                           "\n"
+                           "profile public\n"
+                           "listener tcp\n"
+                           "listener 127.0.0.1\n"
+                           "tcp_listener_pending_conns_max 16\n"
+                           "tcp_listener_max_accept_new_conn 4\n";
+
+    test_conn_profiles_cfg(&cfg);
+    cr_assert(config_listener_profiles_parse(&cfg, buf, strlen(buf), err, sizeof(err)) == 0,
+              "%s", err);
+    cr_assert(cfg.listener_profiles_count == 2);
+    cr_assert(cfg.udp_listener_addresses_profile[0] == 2);
+    cr_assert(cfg.udp_listener_addresses_profile[1] == 1);
+    cr_assert(cfg.listener_profile_tcp == 2);
+    cr_assert(cfg.listener_profile_udp == 0);
+    cr_assert(cfg.listener_profile_dot == 0);
+    cr_assert(config_listener_cfg(&cfg, 0) == &cfg);
+
+    pcfg = config_listener_cfg(&cfg, 1);
+    cr_assert(pcfg->udp_conn_vector_len == 64);
+    cr_assert(cfg.udp_conn_vector_len == CFG_DEFAULT_UDP_CONN_VECTOR_LEN);
+    cr_assert(cfg.listener_profiles[0].udp_conn_vector_len_set);
+    cr_assert(cfg.listener_profiles[0].tcp_listener_max_accept_new_conn == 0);
+    cr_assert(!cfg.listener_profiles[1].udp_conn_vector_len_set);
+    cr_assert(cfg.listener_profiles[1].tcp_listener_max_accept_new_conn == 4);
+    cr_assert(config_listener_cfg(&cfg, 2)->tcp_listener_pending_conns_max == 16);
+    cr_assert(cfg.tcp_listener_pending_conns_max == CFG_DEFAULT_TCP_LIST_PEND_CONNS_MAX);
+
+    /* UDP listener of profile has batches sized by it. */
+    cr_assert(arena_init(&arena, conn_udp_arena_size(pcfg) * pcfg->udp_listener_batches,
+                         0) == 0);
+    conn = conn_listener_provision_addr(pcfg, 1, NULL, &arena, err, sizeof(err));
+    cr_assert(conn != NULL, "%s", err);
+    cr_assert(conn->conn.udp->vector_len == 64);
+    cr_assert(conn->conn.udp->batches[1]->conn.udp->vector_len == 64);
+    cr_assert(conn->conn.udp->recvbuff_size == 65536);
+    conn_release(conn);
+    arena_clean(&arena);
+
+    config_clean(&cfg);
+}
+
+/** Listener profiles file with an error, and error it is expected to be
+ * reported with.
+ */
+typedef struct test_conn_profiles_err_s {
+    const char *buf;
+    const char *err;
+} test_conn_profiles_err_t;
+
+/** Listener profiles files with an error. */
+ParameterizedTestParameters(conn, test_conn_listener_profiles_err) {
+    static test_conn_profiles_err_t params[] = {
+        { "udp_conn_vector_len 64\n", "line 1, option \"udp_conn_vector_len\" is not in a profile" },
+        { "profile a\nlistener udp\n", "line 2, listener \"udp\", UDP listeners are bound" },
+        { "profile a\nlistener 127.0.0.3\n", "line 2, listener '127.0.0.3' is not an address" },
+        { "profile a\nlistener eth0\n", "line 2, listener 'eth0' is not one of" },
+        { "profile a\nlistener tcp\nprofile b\nlistener tcp\n",
+          "line 4, listener 'tcp' already has profile \"a\"" },
+        { "profile a\nprofile a\n", "line 2, profile \"a\" is already defined" },
+        { "profile a\ntcp_keepalive 10\n",
+          "line 2, option \"tcp_keepalive\" can not be set in listener profile" },
+        { "profile a\nudp_listener_batches 17\n", "line 2, option \"udp_listener_batches\", '17' is not within" },
+        { "profile a\nudp_conn_vector_len 8\nudp_conn_vector_len_min 16\n",
+          "profile \"a\", option \"udp_conn_vector_len_min\" (16) can not be larger" },
+    };
+
+    return cr_make_param_array(test_conn_profiles_err_t, params,
+                               sizeof(params) / sizeof(params[0]));
+}
+
+/** Test listener profiles file with an error is rejected with error of the
+ * line it is on.
+ */
+ParameterizedTest(test_conn_profiles_err_t *param, conn, test_conn_listener_profiles_err) {
+    config_t cfg;
+    char     err[256] = {'\0'};
+
+    test_conn_profiles_cfg(&cfg);
+    cr_assert(config_listener_profiles_parse(&cfg, param->buf, strlen(param->buf),
+                                             err, sizeof(err)) == -1);
+    cr_assert(strncmp(err, param->err, strlen(param->err)) == 0, "%s", err);
+    config_clean(&cfg);
+}
+
+/** Test removing connections from head, middle and tail of read and write
+ * queues keeps the remaining ones in order, and that removal of a connection
+ * not in queue is a no-op.
+ */
+Test(conn, test_conn_fifo_remove) {
+    conn_t            conns[5] = {};
+    conn_fifo_queue_t read_q   = {};
+    conn_fifo_queue_t write_q  = {};
+    conn_t           *expected[] = { &conns[1], &conns[3], &conns[4] };
+
+    for (size_t i = 0; i < 5; i++) {
+        conn_fifo_enqueue_read(&read_q, &conns[i]);
+        conn_fifo_enqueue_write(&write_q, &conns[i]);
+    }
+
+    /* Remove head, then middle, then tail which is re-added afterwards. */
+    conn_fifo_remove_from_read_queue(&read_q, &conns[0]);
+    conn_fifo_remove_from_read_queue(&read_q, &conns[2]);
+    conn_fifo_remove_from_read_queue(&read_q, &conns[4]);
+    conn_fifo_remove_from_read_queue(&read_q, &conns[4]);
+    cr_assert(conns[0].in_read_queue == 0 && conns[4].in_read_queue == 0);
+    cr_assert(read_q.head == &conns[1] && read_q.tail == &conns[3]);
+    cr_assert(read_q.len == 2);
+    conn_fifo_enqueue_read(&read_q, &conns[4]);
+    conn_fifo_enqueue_read(&read_q, &conns[4]);
+    cr_assert(read_q.len == 3);
+
+    conn_fifo_remove_from_write_queue(&write_q, &conns[2]);
+    conn_fifo_remove_from_write_queue(&write_q, &conns[0]);
+    cr_assert(write_q.len == 3);
+
+    for (size_t i = 0; i < 3; i++) {
+        cr_assert(conn_fifo_dequeue_read(&read_q) == expected[i]);
+        cr_assert(conn_fifo_dequeue_write(&write_q) == expected[i]);
+    }
+    cr_assert(conn_fifo_dequeue_read(&read_q) == NULL);
+    cr_assert(conn_fifo_dequeue_write(&write_q) == NULL);
+    cr_assert(read_q.len == 0 && write_q.len == 0);
+
+    /* Removing the only entry empties queue. */
+    conn_fifo_enqueue_write(&write_q, &conns[2]);
+    conn_fifo_remove_from_write_queue(&write_q, &conns[2]);
+    cr_assert(write_q.head == NULL && write_q.tail == NULL && write_q.len == 0);
+
+    /* Removal after dequeue of head keeps new head unlinked from it. */
+    for (size_t i = 0; i < 3; i++) {
+        conn_fifo_enqueue_read(&read_q, &conns[i]);
+    }
+    cr_assert(conn_fifo_dequeue_read(&read_q) == &conns[0]);
+    conn_fifo_remove_from_read_queue(&read_q, &conns[1]);
+    cr_assert(read_q.head == &conns[2] && read_q.tail == &conns[2]);
+    cr_assert(conn_fifo_dequeue_read(&read_q) == &conns[2]);
+    cr_assert(conn_fifo_dequeue_read(&read_q) == NULL);
+}
+
+/** Test TCP idle timeout is kept until connections reach shrink start, and
+ * then shrinks linearly down to minimum at maximum number of connections.
+ */
+Test(conn, test_conn_tcp_keepalive_scale) {
+    cr_assert(conn_tcp_keepalive_scale(10000, 0, 1000, 50) == 10000);
+    cr_assert(conn_tcp_keepalive_scale(10000, 500, 1000, 50) == 10000);
+    cr_assert(conn_tcp_keepalive_scale(10000, 750, 1000, 50) == 5500);
+    cr_assert(conn_tcp_keepalive_scale(10000, 1000, 1000, 50) == TCP_KEEPALIVE_MIN);
+    cr_assert(conn_tcp_keepalive_scale(10000, 1200, 1000, 50) == TCP_KEEPALIVE_MIN);
+
+    /* Shrink start of 100 keeps timeout, 0 shrinks it from first connection. */
+    cr_assert(conn_tcp_keepalive_scale(10000, 1000, 1000, 100) == 10000);
+    cr_assert(conn_tcp_keepalive_scale(10000, 0, 1000, 0) == 10000);
+    cr_assert(conn_tcp_keepalive_scale(10000, 500, 1000, 0) == 5500);
+
+    /* Large maximum does not overflow. */
+    cr_assert(conn_tcp_keepalive_scale(10000, SIZE_MAX / 4 * 3, SIZE_MAX, 50) < 10000);
+    cr_assert(conn_tcp_keepalive_scale(10000, SIZE_MAX / 4 * 3, SIZE_MAX, 50) > 5000);
+}
+
+/** Test idle queue keeps TCP connections in order they became idle, moves
+ * connection enqueued again to its tail, and removes connections in constant
+ * time.
+ */
+Test(conn, test_conn_fifo_idle) {
+    conn_tcp_t        conn_tcps[4] = {};
+    conn_t            conns[4]     = {};
+    conn_fifo_queue_t idle_q       = {};
+
+    for (size_t i = 0; i < 4; i++) {
+        conns[i].conn.tcp = &conn_tcps[i];
+        conn_fifo_enqueue_idle(&idle_q, &conns[i]);
+    }
+
+    /* Connection that became idle again moves to tail. */
+    conn_fifo_enqueue_idle(&idle_q, &conns[0]);
+    cr_assert(idle_q.head == &conns[1] && idle_q.tail == &conns[0]);
+    cr_assert(idle_q.len == 4);
+
+    /* Removal of connection with data to process, twice is a no-op. */
+    conn_fifo_remove_from_idle_queue(&idle_q, &conns[2]);
+    conn_fifo_remove_from_idle_queue(&idle_q, &conns[2]);
+    cr_assert(conns[2].in_idle_queue == 0 && idle_q.len == 3);
+
+    cr_assert(conn_fifo_dequeue_idle(&idle_q) == &conns[1]);
+    cr_assert(conn_fifo_dequeue_idle(&idle_q) == &conns[3]);
+    cr_assert(conn_fifo_dequeue_idle(&idle_q) == &conns[0]);
+    cr_assert(conn_fifo_dequeue_idle(&idle_q) == NULL);
+    cr_assert(idle_q.head == NULL && idle_q.tail == NULL && idle_q.len == 0);
+    cr_assert(conns[0].in_idle_queue == 0 && conn_tcps[0].idle_q_prev == NULL);
+}
+
+/** @}*/
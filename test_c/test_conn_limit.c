@@ -0,0 +1,158 @@
+/**
+ * @file test_conn_limit.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup conn_limit_ut TCP Connection Limit
+ *
+ * @brief Per client TCP connection limit unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "conn_limit.h"
+
+/**! @cond */
+TestSuite(conn_limit);
+
+static void
+test_conn_limit_ipv4(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin->sin_family = AF_INET;
+    cr_assert(inet_pton(AF_INET, ip, &sin->sin_addr) == 1);
+}
+
+static void
+test_conn_limit_ipv6(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin6->sin6_family = AF_INET6;
+    cr_assert(inet_pton(AF_INET6, ip, &sin6->sin6_addr) == 1);
+}
+/**! @endcond */
+
+/** Test client network is refused connections over its limit, until one of
+ * its connections is released, and other networks are counted separately.
+ */
+Test(conn_limit, test_conn_limit_acquire) {
+    conn_limit_t            limit;
+    struct sockaddr_storage ip;
+    uint64_t                keys[3];
+    uint64_t                key;
+
+    conn_limit_init(&limit, 64, 3, 24, 56);
+    test_conn_limit_ipv4(&ip, "192.0.2.1");
+    for (int i = 0; i < 3; i++) {
+        cr_assert(conn_limit_acquire(&limit, &ip, false, &keys[i]));
+        cr_assert(keys[i] != 0);
+    }
+
+    /* Address within same /24 shares the limit. */
+    test_conn_limit_ipv4(&ip, "192.0.2.200");
+    cr_assert(!conn_limit_acquire(&limit, &ip, false, &key));
+    cr_assert(key == 0);
+
+    /* Other network is counted separately. */
+    test_conn_limit_ipv4(&ip, "192.0.3.1");
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+    test_conn_limit_ipv6(&ip, "2001:db8::1");
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+
+    /* Released connection makes room for a new one. */
+    conn_limit_release(&limit, keys[0]);
+    test_conn_limit_ipv4(&ip, "192.0.2.1");
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &keys[0]));
+    cr_assert(!conn_limit_acquire(&limit, &ip, false, &key));
+
+    /* Forced connection is counted over the limit. */
+    cr_assert(conn_limit_acquire(&limit, &ip, true, &key));
+    cr_assert(key == keys[0]);
+    conn_limit_release(&limit, key);
+    conn_limit_release(&limit, keys[0]);
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+
+    conn_limit_clean(&limit);
+}
+
+/** Test entry is freed once its count drops to 0, and client network finding
+ * its bucket full is let in uncounted.
+ */
+Test(conn_limit, test_conn_limit_table_full) {
+    conn_limit_t            limit;
+    struct sockaddr_storage ip;
+    uint64_t                keys[CONN_LIMIT_BUCKET_ENTRIES];
+    uint64_t                key;
+    char                    addr[INET_ADDRSTRLEN];
+
+    conn_limit_init(&limit, 1, 1, 32, 56);
+    cr_assert(limit.mask == 0);
+
+    for (size_t i = 0; i < CONN_LIMIT_BUCKET_ENTRIES; i++) {
+        snprintf(addr, sizeof(addr), "198.51.100.%zu", i);
+        test_conn_limit_ipv4(&ip, addr);
+        cr_assert(conn_limit_acquire(&limit, &ip, false, &keys[i]));
+        cr_assert(keys[i] != 0);
+    }
+    test_conn_limit_ipv4(&ip, "198.51.100.200");
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+    cr_assert(key == 0);
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+    conn_limit_release(&limit, key);
+
+    /* Freed entry is taken by next network. */
+    conn_limit_release(&limit, keys[0]);
+    cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+    cr_assert(key != 0);
+    cr_assert(!conn_limit_acquire(&limit, &ip, false, &key));
+
+    conn_limit_clean(&limit);
+}
+
+/** Test limit is disabled when per client maximum is 0. */
+Test(conn_limit, test_conn_limit_init_disabled) {
+    conn_limit_t            limit;
+    struct sockaddr_storage ip;
+    uint64_t                key;
+
+    conn_limit_init(&limit, 64, 0, 24, 56);
+    cr_assert(limit.buckets == NULL);
+
+    test_conn_limit_ipv4(&ip, "192.0.2.1");
+    for (int i = 0; i < 10; i++) {
+        cr_assert(conn_limit_acquire(&limit, &ip, false, &key));
+        cr_assert(key == 0);
+    }
+    conn_limit_release(&limit, key);
+}
+
+/** @}*/
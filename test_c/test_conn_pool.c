@@ -0,0 +1,172 @@
+/**
+ * @file test_conn_pool.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup conn_pool_ut Connection Pool
+ *
+ * @brief Connection pool unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <netinet/in.h>
+
+#include "config.h"
+#include "conn.h"
+#include "conn_pool.h"
+
+/**! @cond */
+TestSuite(conn_pool);
+/**! @endcond */
+
+/** Test getting connection objects from pool, returning them, and reuse of
+ * returned objects with their state reset.
+ */
+Test(conn_pool, test_conn_pool_get_put) {
+    config_t                cfg;
+    conn_pool_t             pool;
+    conn_t                  *conn[3];
+    unsigned char           *read_buffer;
+    query_t                 *queries;
+    struct sockaddr_storage client_ip = {};
+    struct sockaddr_storage local_ip  = {};
+
+    config_init(&cfg);
+    ((struct sockaddr_in *)&client_ip)->sin_family = AF_INET;
+    ((struct sockaddr_in *)&client_ip)->sin_port   = htons(5353);
+
+    /* Pool is preloaded up to its maximum. */
+    conn_pool_init(&pool, &cfg, NULL, 2);
+    cr_assert(pool.count == 2);
+    cr_assert(pool.free_count == 2);
+
+    conn[0] = conn_pool_get_tcp(&pool, -1, 0, &client_ip, &local_ip);
+    conn[1] = conn_pool_get_tcp(&pool, -1, 0, &client_ip, &local_ip);
+    cr_assert(pool.free_count == 0);
+    cr_assert(CONN_IS_TCP_CONN(conn[0]));
+    cr_assert(conn[0]->conn.tcp->read_buffer == NULL);
+    conn_pool_bufs_get(&pool, conn[0]);
+    conn_pool_bufs_get(&pool, conn[1]);
+    cr_assert(pool.bufs_free_count == 0);
+    cr_assert(conn[0]->conn.tcp->read_buffer_size == cfg.tcp_readbuff_size);
+    cr_assert(conn[0]->conn.tcp->queries_size == cfg.tcp_conn_simultaneous_queries_count);
+    cr_assert(((struct sockaddr_in *)&conn[0]->conn.tcp->client_ip)->sin_port == htons(5353));
+
+    /* Pool grows past preloaded objects. */
+    conn[2] = conn_pool_get_tcp(&pool, -1, 0, &client_ip, &local_ip);
+    cr_assert(pool.count == 3);
+    cr_assert(conn[2] != conn[0] && conn[2] != conn[1]);
+
+    /* Pool over its maximum releases returned objects. */
+    conn_pool_put(&pool, conn[2]);
+    cr_assert(pool.count == 2);
+    cr_assert(pool.free_count == 0);
+
+    /* Dirty connection state, return it, and get it back. */
+    read_buffer = conn[0]->conn.tcp->read_buffer;
+    queries     = conn[0]->conn.tcp->queries;
+    conn[0]->cid                         = 7;
+    conn[0]->in_read_queue               = 1;
+    conn[0]->conn.tcp->read_buffer_len   = 10;
+    conn[0]->conn.tcp->queries_count     = 1;
+    conn[0]->conn.tcp->state             = TCP_CONN_ST_READ_ERR;
+    conn[0]->conn.tcp->queries[0].response_buffer_len = 20;
+    conn_pool_put(&pool, conn[0]);
+    cr_assert(pool.free_count == 1);
+    cr_assert(pool.bufs_free_count == 1);
+
+    conn[0] = conn_pool_get_tcp(&pool, -1, 1, &client_ip, &local_ip);
+    cr_assert(conn[0]->conn.tcp->read_buffer == NULL);
+    conn_pool_bufs_get(&pool, conn[0]);
+    cr_assert(conn[0]->conn.tcp->read_buffer == read_buffer);
+    cr_assert(conn[0]->conn.tcp->queries == queries);
+    cr_assert(CONN_IS_TCP_CONN(conn[0]));
+    cr_assert(conn[0]->ip_version == 1);
+    cr_assert(conn[0]->cid == 0);
+    cr_assert(conn[0]->in_read_queue == 0);
+    cr_assert(conn[0]->conn.tcp->read_buffer_len == 0);
+    cr_assert(conn[0]->conn.tcp->queries_count == 0);
+    cr_assert(conn[0]->conn.tcp->state == 0);
+    cr_assert(conn[0]->conn.tcp->queries[0].response_buffer_len == 0);
+
+    conn_pool_put(&pool, conn[0]);
+    conn_pool_put(&pool, conn[1]);
+    cr_assert(pool.count == 2);
+    cr_assert(pool.free_count == 2);
+
+    conn_pool_clean(&pool);
+    cr_assert(pool.free_head == NULL);
+    config_clean(&cfg);
+}
+
+/** Test idle connections hand buffer sets back to pool, and that pool keeps
+ * at most CONN_POOL_TCP_BUFS_FREE_MAX free buffer sets.
+ */
+Test(conn_pool, test_conn_pool_bufs) {
+    config_t                cfg;
+    conn_pool_t             pool;
+    size_t                  count = CONN_POOL_TCP_BUFS_FREE_MAX + 2;
+    conn_t                 *conn[CONN_POOL_TCP_BUFS_FREE_MAX + 2];
+    struct sockaddr_storage ip = {};
+
+    config_init(&cfg);
+    conn_pool_init(&pool, &cfg, NULL, count);
+    cr_assert(pool.bufs_count == CONN_POOL_TCP_BUFS_FREE_MAX);
+    cr_assert(pool.bufs_free_count == CONN_POOL_TCP_BUFS_FREE_MAX);
+
+    /* Buffer sets are allocated past preloaded ones while all are in use. */
+    for (size_t i = 0; i < count; i++) {
+        conn[i] = conn_pool_get_tcp(&pool, -1, 0, &ip, &ip);
+        conn_pool_bufs_get(&pool, conn[i]);
+        cr_assert(conn[i]->conn.tcp->bufs != NULL);
+    }
+    cr_assert(pool.bufs_count == count);
+    cr_assert(pool.bufs_free_count == 0);
+
+    /* Getting buffers of connection holding them is a no-op. */
+    conn_pool_bufs_get(&pool, conn[0]);
+    cr_assert(pool.bufs_count == count);
+
+    /* Idle connections hand buffers back, free list is capped. */
+    for (size_t i = 0; i < count; i++) {
+        conn_pool_bufs_put(&pool, conn[i]);
+        cr_assert(conn[i]->conn.tcp->bufs == NULL);
+        cr_assert(conn[i]->conn.tcp->read_buffer == NULL);
+        cr_assert(conn[i]->conn.tcp->queries == NULL);
+    }
+    cr_assert(pool.bufs_free_count == CONN_POOL_TCP_BUFS_FREE_MAX);
+    cr_assert(pool.bufs_count == CONN_POOL_TCP_BUFS_FREE_MAX);
+
+    /* Returning idle connection object does not touch buffer sets. */
+    for (size_t i = 0; i < count; i++) {
+        conn_pool_put(&pool, conn[i]);
+    }
+    cr_assert(pool.bufs_free_count == CONN_POOL_TCP_BUFS_FREE_MAX);
+
+    conn_pool_clean(&pool);
+    cr_assert(pool.bufs_free_head == NULL);
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,110 @@
+/**
+ * @file test_conn_table.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup conn_table_ut Connection Table
+ *
+ * @brief Connection table unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "conn.h"
+#include "conn_table.h"
+
+/**! @cond */
+TestSuite(conn_table);
+/**! @endcond */
+
+/** Test adding, looking up, and removing connections, including stale IDs. */
+Test(conn_table, test_conn_table_add_get_remove) {
+    conn_table_t table;
+    conn_t       conns[3] = {};
+    uint64_t     stale    = 0;
+
+    conn_table_init(&table, 2);
+    cr_assert(conn_table_add(&table, &conns[0]));
+    cr_assert(conn_table_add(&table, &conns[1]));
+    cr_assert(table.count == 2);
+    /* Table is at its maximum size. */
+    cr_assert(!conn_table_add(&table, &conns[2]));
+
+    cr_assert(CONN_TABLE_IS_CID(conns[0].cid));
+    cr_assert(conns[0].cid != conns[1].cid);
+    cr_assert(conn_table_get(&table, conns[0].cid) == &conns[0]);
+    cr_assert(conn_table_get(&table, conns[1].cid) == &conns[1]);
+
+    /* Pointers are not connection IDs. */
+    cr_assert(!CONN_TABLE_IS_CID((uint64_t)&conns[0]));
+    cr_assert(conn_table_get(&table, (uint64_t)&conns[0]) == NULL);
+
+    /* Removed slot is reused with a new generation. */
+    stale = conns[0].cid;
+    conn_table_remove(&table, &conns[0]);
+    cr_assert(conns[0].cid == 0);
+    cr_assert(table.count == 1);
+    cr_assert(conn_table_get(&table, stale) == NULL);
+    cr_assert(conn_table_add(&table, &conns[2]));
+    cr_assert((uint32_t)conns[2].cid == (uint32_t)stale);
+    cr_assert(conns[2].cid != stale);
+    cr_assert(conn_table_get(&table, stale) == NULL);
+    cr_assert(conn_table_get(&table, conns[2].cid) == &conns[2]);
+
+    /* Removing connection not in table is a no-op. */
+    conn_table_remove(&table, &conns[0]);
+    cr_assert(table.count == 2);
+
+    conn_table_clean(&table);
+}
+
+/** Test connection table growth. */
+Test(conn_table, test_conn_table_grow) {
+    conn_table_t  table;
+    int           count = 5000;
+    conn_t       *conns = calloc(count, sizeof(conn_t));
+
+    conn_table_init(&table, count);
+    for (int i = 0; i < count; i++) {
+        cr_assert(conn_table_add(&table, &conns[i]));
+    }
+    cr_assert(table.size == count);
+    for (int i = 0; i < count; i++) {
+        cr_assert(conn_table_get(&table, conns[i].cid) == &conns[i]);
+    }
+    for (int i = 0; i < count; i += 2) {
+        conn_table_remove(&table, &conns[i]);
+    }
+    cr_assert(table.count == count / 2);
+    for (int i = 0; i < count; i += 2) {
+        cr_assert(conn_table_add(&table, &conns[i]));
+    }
+    cr_assert(!conn_table_add(&table, &conns[0]));
+    cr_assert(table.size == count);
+
+    conn_table_clean(&table);
+    free(conns);
+}
+
+/** @}*/
@@ -0,0 +1,94 @@
+/**
+ * @file test_coroutine.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup coroutine_ut Stackless coroutines
+ *
+ * @brief Stackless coroutine unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <stdbool.h>
+
+#include "coroutine.h"
+
+/**! @cond */
+TestSuite(coroutine);
+
+typedef struct test_co_s {
+    co_t co;
+    int  i;
+} test_co_t;
+
+/* Yields 1, 2, 3 from a loop, then returns 0 and starts over. */
+static int
+test_co_count(test_co_t *t)
+{
+    CO_BEGIN(&t->co);
+    for (t->i = 1; t->i <= 3; t->i++) {
+        CO_YIELD(&t->co, t->i);
+    }
+    CO_END(&t->co);
+    return 0;
+}
+
+/* Yields 1, returns -1 when told to stop, before it would yield 2. */
+static int
+test_co_stop(test_co_t *t, bool stop)
+{
+    CO_BEGIN(&t->co);
+    CO_YIELD(&t->co, 1);
+    if (stop) {
+        CO_RETURN(&t->co, -1);
+    }
+    CO_YIELD(&t->co, 2);
+    CO_END(&t->co);
+    return 0;
+}
+/**! @endcond */
+
+/** Test coroutine resumes after yield it returned from, and starts over once
+ * it ends or returns.
+ */
+Test(coroutine, test_coroutine_resume) {
+    test_co_t t = { };
+
+    for (int round = 0; round < 2; round++) {
+        cr_assert(test_co_count(&t) == 1);
+        cr_assert(test_co_count(&t) == 2);
+        cr_assert(test_co_count(&t) == 3);
+        cr_assert(test_co_count(&t) == 0);
+        cr_assert(t.co == 0);
+    }
+
+    cr_assert(test_co_stop(&t, true) == 1);
+    cr_assert(t.co != 0);
+    cr_assert(test_co_stop(&t, true) == -1);
+    cr_assert(t.co == 0);
+    cr_assert(test_co_stop(&t, false) == 1);
+    cr_assert(test_co_stop(&t, false) == 2);
+    cr_assert(test_co_stop(&t, false) == 0);
+}
+
+/** @}*/
@@ -0,0 +1,172 @@
+/**
+ * @file test_dns_cookie.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup dns_cookie_ut DNS Cookies
+ *
+ * @brief DNS cookies unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#include "dns_cookie.h"
+#include "query.h"
+
+/**! @cond */
+TestSuite(dns_cookie);
+
+static const uint8_t test_dns_cookie_secret[DNS_COOKIE_SECRET_LEN] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+static const uint8_t test_dns_cookie_client[DNS_COOKIE_CLIENT_LEN] = {
+    0x24, 0x64, 0xc4, 0xab, 0xcf, 0x10, 0xc9, 0x57
+};
+
+static void
+test_dns_cookie_ipv4(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin->sin_family = AF_INET;
+    cr_assert(inet_pton(AF_INET, ip, &sin->sin_addr) == 1);
+}
+
+/* Build cookie option data from client cookie and server_len bytes of
+ * server cookie, and parse it.
+ */
+static int
+test_dns_cookie_parse(edns_cookie_t *cookie, uint8_t *buf, const uint8_t *server,
+                      uint16_t server_len)
+{
+    memcpy(buf, test_dns_cookie_client, DNS_COOKIE_CLIENT_LEN);
+    if (server_len > 0) {
+        memcpy(buf + DNS_COOKIE_CLIENT_LEN, server, server_len);
+    }
+    *cookie = (edns_cookie_t) {
+        .edns_cookie_raw_buf     = buf,
+        .edns_cookie_raw_buf_len = DNS_COOKIE_CLIENT_LEN + server_len,
+    };
+    return query_parse_edns_ext_cookie(cookie);
+}
+/**! @endcond */
+
+/** Test SipHash-2-4 against reference implementation test vectors. */
+Test(dns_cookie, test_dns_cookie_siphash) {
+    uint8_t data[15];
+
+    for (int i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+    cr_assert(dns_cookie_siphash(test_dns_cookie_secret, data, 0) == 0x726fdb47dd0e0e31ULL);
+    cr_assert(dns_cookie_siphash(test_dns_cookie_secret, data, 8) == 0x93f5f5799a932462ULL);
+    cr_assert(dns_cookie_siphash(test_dns_cookie_secret, data, 15) == 0xa129ca6149be45e5ULL);
+}
+
+/** Test parsing of cookie option lengths. */
+Test(dns_cookie, test_dns_cookie_parse_len) {
+    edns_cookie_t cookie;
+    uint8_t       buf[DNS_COOKIE_CLIENT_LEN + DNS_COOKIE_SERVER_LEN_MAX + 1] = {0};
+    uint8_t       server[DNS_COOKIE_SERVER_LEN_MAX + 1] = {0};
+
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, 0) == 0);
+    cr_assert(cookie.edns_cookie_valid);
+    cr_assert(cookie.server_cookie_len == 0);
+    cr_assert(memcmp(cookie.client_cookie, test_dns_cookie_client, DNS_COOKIE_CLIENT_LEN) == 0);
+
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, 8) == 0);
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, 32) == 0);
+    cr_assert(cookie.server_cookie_len == 32);
+
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, 7) != 0);
+    cr_assert(!cookie.edns_cookie_valid);
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, 33) != 0);
+
+    cookie.edns_cookie_raw_buf_len = 4;
+    cr_assert(query_parse_edns_ext_cookie(&cookie) != 0);
+}
+
+/** Test server cookie generated for a client verifies, and does not verify
+ * for other client address, modified cookie, or once expired.
+ */
+Test(dns_cookie, test_dns_cookie_verify) {
+    edns_cookie_t           cookie;
+    struct sockaddr_storage ip;
+    struct sockaddr_storage other_ip;
+    uint8_t                 buf[DNS_COOKIE_CLIENT_LEN + DNS_COOKIE_SERVER_LEN];
+    uint8_t                 server[DNS_COOKIE_SERVER_LEN];
+    uint32_t                now = 1700000000;
+
+    test_dns_cookie_ipv4(&ip, "192.0.2.1");
+    test_dns_cookie_ipv4(&other_ip, "192.0.2.2");
+
+    /* Request with only client cookie gets server cookie generated now. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, NULL, 0) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now);
+    cr_assert(!cookie.server_cookie_valid);
+    cr_assert(cookie.server_cookie[0] == DNS_COOKIE_VERSION);
+    cr_assert(cookie.server_cookie[4] == (now >> 24 & 0xff) &&
+              cookie.server_cookie[7] == (now & 0xff));
+    memcpy(server, cookie.server_cookie, DNS_COOKIE_SERVER_LEN);
+
+    /* Same cookie a minute later is valid and echoed back unchanged. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now + 60);
+    cr_assert(cookie.server_cookie_valid);
+    cr_assert(memcmp(cookie.server_cookie, server, DNS_COOKIE_SERVER_LEN) == 0);
+
+    /* Valid but old cookie is replaced by a new one. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now + DNS_COOKIE_REFRESH);
+    cr_assert(cookie.server_cookie_valid);
+    cr_assert(memcmp(cookie.server_cookie, server, DNS_COOKIE_SERVER_LEN) != 0);
+
+    /* Expired cookie. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now + DNS_COOKIE_LIFETIME + 1);
+    cr_assert(!cookie.server_cookie_valid);
+
+    /* Cookie from too far in the future. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now - DNS_COOKIE_CLOCK_SKEW - 1);
+    cr_assert(!cookie.server_cookie_valid);
+
+    /* Other client address. */
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &other_ip, now);
+    cr_assert(!cookie.server_cookie_valid);
+
+    /* Modified hash. */
+    server[DNS_COOKIE_SERVER_LEN - 1] ^= 1;
+    cr_assert(test_dns_cookie_parse(&cookie, buf, server, DNS_COOKIE_SERVER_LEN) == 0);
+    dns_cookie_verify(&cookie, test_dns_cookie_secret, &ip, now);
+    cr_assert(!cookie.server_cookie_valid);
+}
+
+/** @}*/
@@ -0,0 +1,251 @@
+/**
+ * @file test_dnssec.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup dnssec_ut DNSSEC
+ *
+ * @brief DNSSEC online signing unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/ecdsa.h>
+#include <openssl/pem.h>
+
+#include "config.h"
+#include "dnssec.h"
+#include "rip_ns_utils.h"
+
+/**! @cond */
+TestSuite(dnssec);
+
+/** Generate signing key of an algorithm, write it to a temporary PEM file and
+ * load it.
+ */
+static void
+test_dnssec_key(dnssec_key_t *key, config_t *cfg, const char *alg)
+{
+    char      path[] = "/tmp/test_dnssec_key_XXXXXX";
+    char      err[256] = {'\0'};
+    int       fd     = mkstemp(path);
+    FILE     *f      = fdopen(fd, "w");
+    EVP_PKEY *pkey   = strcmp(alg, "EC") == 0 ? EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-256") :
+                                                EVP_PKEY_Q_keygen(NULL, NULL, alg);
+
+    cr_assert(f != NULL && pkey != NULL);
+    cr_assert(PEM_write_PrivateKey(f, pkey, NULL, NULL, 0, NULL, NULL) == 1);
+    fclose(f);
+    EVP_PKEY_free(pkey);
+
+    config_init(cfg);
+    cfg->dnssec_key_file    = strdup(path);
+    cfg->dnssec_signer_name = strdup("Example.COM.");
+    cr_assert(dnssec_key_load(key, cfg, err, sizeof(err)) == 0, "%s", err);
+    unlink(path);
+}
+
+/** Verify RRSIG record signature over data that was signed. */
+static bool
+test_dnssec_verify(dnssec_key_t *key, dnssec_sig_t *sig, const uint8_t *data,
+                   size_t data_len)
+{
+    const uint8_t *s      = sig->rr.rdata + sig->rr.rdata_len - DNSSEC_SIG_LEN;
+    EVP_MD_CTX    *ctx    = EVP_MD_CTX_new();
+    ECDSA_SIG     *es     = NULL;
+    unsigned char *der    = NULL;
+    int            ok     = 0;
+
+    if (key->algorithm == DNSSEC_ALG_ED25519) {
+        ok = EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, key->pkey) == 1 &&
+             EVP_DigestVerify(ctx, s, DNSSEC_SIG_LEN, data, data_len) == 1;
+    } else {
+        int der_len;
+
+        es = ECDSA_SIG_new();
+        ECDSA_SIG_set0(es, BN_bin2bn(s, DNSSEC_SIG_LEN / 2, NULL),
+                       BN_bin2bn(s + DNSSEC_SIG_LEN / 2, DNSSEC_SIG_LEN / 2, NULL));
+        der_len = i2d_ECDSA_SIG(es, &der);
+        ok = EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, key->pkey) == 1 &&
+             EVP_DigestVerify(ctx, der, der_len, data, data_len) == 1;
+        OPENSSL_free(der);
+        ECDSA_SIG_free(es);
+    }
+    EVP_MD_CTX_free(ctx);
+    return ok;
+}
+/**! @endcond */
+
+/** Test key tag calculation (RFC 4034 appendix B). */
+Test(dnssec, test_dnssec_key_tag) {
+    const uint8_t rdata[] = {0x01, 0x01, 0x03, 0x0d, 0xff};
+
+    cr_assert(dnssec_key_tag(rdata, 4) == (1 << 8) + 1 + (3 << 8) + 13);
+    /* Carry above 16 bits is added back in. */
+    cr_assert(dnssec_key_tag(rdata, 5) == ((1038 + 0xff00 + 1) & 0xffff));
+}
+
+/** Key algorithms tested. */
+ParameterizedTestParameters(dnssec, test_dnssec_sign) {
+    static const char *algs[] = {"EC", "ED25519"};
+
+    return cr_make_param_array(const char *, algs, sizeof(algs) / sizeof(algs[0]));
+}
+
+/** Test RRset is prepared in canonical form and order, signed and the
+ * signature verifies with signing key.
+ */
+ParameterizedTest(const char **alg, dnssec, test_dnssec_sign) {
+    dnssec_key_t   key;
+    config_t       cfg;
+    dnssec_sig_t   sig   = {};
+    EVP_MD_CTX    *ctx   = EVP_MD_CTX_new();
+    unsigned char  owner[RIP_NS_MAXCDNAME + 1];
+    uint8_t        rdata[2][32];
+    uint8_t       *data  = NULL;
+    size_t         data_len;
+    uint16_t       owner_len;
+    char           text[512];
+    rr_record_t    rrs[2] = {
+        {.name = (unsigned char *)"www.example.com", .type = rip_ns_t_mx,
+         .class = rip_ns_c_in, .ttl = 300, .rdata = rdata[0]},
+        {.name = (unsigned char *)"www.example.com", .type = rip_ns_t_mx,
+         .class = rip_ns_c_in, .ttl = 300, .rdata = rdata[1]},
+    };
+
+    test_dnssec_key(&key, &cfg, *alg);
+    cr_assert(key.algorithm == (strcmp(*alg, "EC") == 0 ? DNSSEC_ALG_ECDSAP256SHA256 :
+                                                           DNSSEC_ALG_ED25519));
+    cr_assert(key.signer_len == 13 && memcmp(key.signer, "\7example\3com", 13) == 0);
+    cr_assert(key.key_tag == dnssec_key_tag(key.dnskey, key.dnskey_len));
+    cr_assert(dnssec_key_dnskey_text(&key, text, sizeof(text)) > 0);
+    cr_assert(strncmp(text, "example.com. 3600 IN DNSKEY 257 3 ", 34) == 0);
+
+    /* Records are out of canonical order, with upper case target names. */
+    rdata[0][0] = 0;
+    rdata[0][1] = 20;
+    rip_ns_name_pton((const unsigned char *)"MAIL.example.com.", rdata[0] + 2, 30);
+    rrs[0].rdata_len = 2 + 18;
+    rdata[1][0] = 0;
+    rdata[1][1] = 10;
+    rip_ns_name_pton((const unsigned char *)"mail.example.com.", rdata[1] + 2, 30);
+    rrs[1].rdata_len = 2 + 18;
+
+    rip_ns_name_pton((const unsigned char *)"www.example.com.", owner, sizeof(owner));
+    owner_len = rip_ns_name_lc(owner);
+
+    cr_assert(dnssec_sig_prepare(&key, &sig, owner, owner_len, rrs, 2, 1700000000) == 0);
+    cr_assert(sig.refresh == 1700000000 + cfg.dnssec_sig_validity / 2);
+    cr_assert(sig.rr.type == rip_ns_t_rrsig && sig.rr.ttl == 300);
+    cr_assert(strcmp((char *)sig.rr.name, "www.example.com") == 0);
+    cr_assert(sig.rdata[2] == key.algorithm && sig.rdata[3] == 3);
+
+    /* Second record sorts first, and first record target is lower cased. */
+    data_len = sig.data_len;
+    data     = malloc(data_len);
+    memcpy(data, sig.data, data_len);
+    cr_assert(data[DNSSEC_RRSIG_FIXED_LEN + 13 + owner_len + 10 + 1] == 10);
+    cr_assert(memmem(data, data_len, "MAIL", 4) == NULL);
+
+    cr_assert(dnssec_sig_sign(&key, &sig, ctx) == 0);
+    cr_assert(sig.data == NULL);
+    cr_assert(sig.rr.rdata_len == DNSSEC_RRSIG_FIXED_LEN + 13 + DNSSEC_SIG_LEN);
+    cr_assert(test_dnssec_verify(&key, &sig, data, data_len));
+
+    /* Signature does not verify over other data. */
+    data[data_len - 1] ^= 1;
+    cr_assert(!test_dnssec_verify(&key, &sig, data, data_len));
+
+    /* Owner name out of signer zone. */
+    rip_ns_name_pton((const unsigned char *)"www.example.net.", owner, sizeof(owner));
+    cr_assert(dnssec_sig_prepare(&key, &sig, owner, owner_len, rrs, 2, 1700000000) == -1);
+    rip_ns_name_pton((const unsigned char *)"wwwexample.com.", owner, sizeof(owner));
+    cr_assert(dnssec_sig_prepare(&key, &sig, owner, 16, rrs, 2, 1700000000) == -1);
+
+    free(data);
+    EVP_MD_CTX_free(ctx);
+    dnssec_key_clean(&key);
+    config_clean(&cfg);
+}
+
+/** Test signature cache lookup, LRU eviction, and refresh of signatures
+ * due to expire.
+ */
+Test(dnssec, test_dnssec_sig_cache) {
+    dnssec_sig_cache_t cache;
+    rr_record_t        rrs[4];
+    dnssec_sig_t      *sig;
+
+    dnssec_sig_cache_init(&cache, 2);
+    cr_assert(cache.mask == 15);
+
+    /* Miss, then pending entry is found. */
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 100) == NULL);
+    sig = dnssec_sig_cache_add(&cache, 1, &rrs[0]);
+    cr_assert(sig != NULL && sig->state == DNSSEC_SIG_ST_PENDING);
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 100) == sig);
+    cr_assert(dnssec_sig_cache_get(&cache, 2, &rrs[0], 100) == NULL);
+    sig->state   = DNSSEC_SIG_ST_READY;
+    sig->refresh = 200;
+    dnssec_sig_cache_done(&cache, sig);
+
+    sig = dnssec_sig_cache_add(&cache, 1, &rrs[1]);
+    cr_assert(sig != NULL);
+    sig->state   = DNSSEC_SIG_ST_READY;
+    sig->refresh = 200;
+    dnssec_sig_cache_done(&cache, sig);
+
+    /* Cache is full and all entries were used in current epoch. */
+    cr_assert(dnssec_sig_cache_add(&cache, 1, &rrs[2]) == NULL);
+
+    /* Next epoch, least recently used entry is evicted. */
+    cache.epoch++;
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 100) != NULL);
+    sig = dnssec_sig_cache_add(&cache, 1, &rrs[2]);
+    cr_assert(sig != NULL);
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[1], 100) == NULL);
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 100) != NULL);
+
+    /* Pending entry that could not be queued is dropped. */
+    sig->data = malloc(16);
+    dnssec_sig_cache_drop(&cache, sig);
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[2], 100) == NULL);
+    cr_assert(cache.free == sig);
+
+    /* Entry due to be refreshed is kept within epoch it was used in. */
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 200) != NULL);
+    cache.epoch++;
+    cr_assert(dnssec_sig_cache_get(&cache, 1, &rrs[0], 200) == NULL);
+    cr_assert(dnssec_sig_cache_add(&cache, 1, &rrs[3]) != NULL);
+    cr_assert(dnssec_sig_cache_add(&cache, 1, &rrs[0]) != NULL);
+
+    dnssec_sig_cache_clean(&cache);
+    cr_assert(cache.entries == NULL);
+}
+
+/** @}*/
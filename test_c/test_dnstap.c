@@ -0,0 +1,167 @@
+/**
+ * @file test_dnstap.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_ut
+ * \defgroup dnstap_ut Dnstap
+ *
+ * @brief Dnstap unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "dnstap.h"
+#include "query.h"
+
+/**! @cond */
+TestSuite(dnstap);
+/**! @endcond */
+
+/** Test query log record is converted to AUTH_QUERY and AUTH_RESPONSE data
+ * frames holding rebuilt DNS messages.
+ */
+Test(dnstap, test_query_log_record_to_dnstap) {
+    query_t                  q          = { };
+    struct sockaddr_storage  client_ss  = { };
+    struct sockaddr_storage  local_ss   = { };
+    struct sockaddr_in      *client_sin = (struct sockaddr_in *)&client_ss;
+    struct sockaddr_in      *local_sin  = (struct sockaddr_in *)&local_ss;
+    rip_ns_header_t          hdr        = { };
+    unsigned char            label[]    = "www.example.com.";
+    unsigned char            rr_name[]  = "www.example.com.";
+    uint8_t                  rr_rdata[] = { 192, 0, 2, 10 };
+    rr_record_t              rr         = {
+                                              .name      = rr_name,
+                                              .name_len  = strlen((char *)rr_name),
+                                              .type      = rip_ns_t_a,
+                                              .class     = rip_ns_c_in,
+                                              .ttl       = 60,
+                                              .rdata_len = sizeof(rr_rdata),
+                                              .rdata     = rr_rdata,
+                                          };
+    const unsigned char      query_wire[] = {
+                                              0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+                                              0x00, 0x00, 0x00, 0x00,
+                                              3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p',
+                                              'l', 'e', 3, 'c', 'o', 'm', 0,
+                                              0x00, 0x01, 0x00, 0x01,
+                                          };
+    const unsigned char      resp_wire[] = {
+                                              0x12, 0x34, 0x85, 0x00, 0x00, 0x01, 0x00, 0x01,
+                                              0x00, 0x00, 0x00, 0x00,
+                                              3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p',
+                                              'l', 'e', 3, 'c', 'o', 'm', 0,
+                                              0x00, 0x01, 0x00, 0x01,
+                                              3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p',
+                                              'l', 'e', 3, 'c', 'o', 'm', 0,
+                                              0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c,
+                                              0x00, 0x04, 192, 0, 2, 10,
+                                          };
+    char                     rec[1024];
+    char                    *buf = malloc(QUERY_LOG_BUF_MIN_SPACE);
+    int                      len;
+    uint32_t                 frame_len;
+    uint32_t                 frame2_len;
+
+    client_sin->sin_family = AF_INET;
+    client_sin->sin_port   = htons(5353);
+    inet_pton(AF_INET, "192.0.2.99", &client_sin->sin_addr);
+    local_sin->sin_family  = AF_INET;
+    local_sin->sin_port    = htons(53);
+    inet_pton(AF_INET, "192.0.2.1", &local_sin->sin_addr);
+    hdr.id = 0x1234;
+    hdr.rd = 1;
+
+    q.client_ip            = &client_ss;
+    q.local_ip             = &local_ss;
+    q.request_hdr          = &hdr;
+    q.query_label          = label;
+    q.query_label_len      = strlen((char *)label);
+    q.query_q_type         = rip_ns_t_a;
+    q.query_q_class        = rip_ns_c_in;
+    q.answer_section[0]    = &rr;
+    q.answer_section_count = 1;
+    q.end_code             = rip_ns_r_noerror;
+
+    cr_assert(query_log(rec, sizeof(rec), &q) > 0);
+
+    /* Not enough room. */
+    cr_assert(query_log_record_to_dnstap(rec, buf, QUERY_LOG_BUF_MIN_SPACE - 1) == 0);
+
+    /* Two data frames, query and response. */
+    len = query_log_record_to_dnstap(rec, buf, QUERY_LOG_BUF_MIN_SPACE);
+    memcpy(&frame_len, buf, 4);
+    frame_len = ntohl(frame_len);
+    cr_assert(frame_len > 0);
+    cr_assert(len > 4 + frame_len + 4);
+    memcpy(&frame2_len, buf + 4 + frame_len, 4);
+    frame2_len = ntohl(frame2_len);
+    cr_assert(len == 8 + frame_len + frame2_len);
+
+    /* Message type 1 (AUTH_QUERY) with query_message field (10), then type 2
+     * (AUTH_RESPONSE) with response_message field (14). */
+    cr_assert(memmem(buf + 4, frame_len, "\x08\x01", 2) != NULL);
+    cr_assert(memmem(buf + 4, frame_len, query_wire, sizeof(query_wire)) != NULL);
+    cr_assert(((char *)memmem(buf + 4, frame_len, query_wire, sizeof(query_wire)))[-2] == 0x52);
+    cr_assert(memmem(buf + 8 + frame_len, frame2_len, "\x08\x02", 2) != NULL);
+    cr_assert(memmem(buf + 8 + frame_len, frame2_len, resp_wire, sizeof(resp_wire)) != NULL);
+    cr_assert(((char *)memmem(buf + 8 + frame_len, frame2_len, resp_wire, sizeof(resp_wire)))[-2] == 0x72);
+
+    /* No response sent, only query frame. */
+    q.end_code = rip_ns_r_rip_unknown;
+    cr_assert(query_log(rec, sizeof(rec), &q) > 0);
+    len = query_log_record_to_dnstap(rec, buf, QUERY_LOG_BUF_MIN_SPACE);
+    cr_assert(len == 4 + frame_len);
+
+    free(buf);
+}
+
+/** Test Frame Streams control frames are built and recognized. */
+Test(dnstap, test_dnstap_control_frame) {
+    char   frame[DNSTAP_FSTRM_CONTROL_MAX];
+    size_t len;
+
+    len = dnstap_control_frame(frame, DNSTAP_FSTRM_CONTROL_START, true);
+    cr_assert(len == 12 + 8 + strlen(DNSTAP_CONTENT_TYPE));
+    cr_assert(memcmp(frame, "\0\0\0\0\0\0\0\x22\0\0\0\x02\0\0\0\x01\0\0\0\x16", 20) == 0);
+    cr_assert(memcmp(frame + 20, DNSTAP_CONTENT_TYPE, strlen(DNSTAP_CONTENT_TYPE)) == 0);
+    cr_assert(dnstap_control_frame_type(frame, len) == DNSTAP_FSTRM_CONTROL_START);
+
+    len = dnstap_control_frame(frame, DNSTAP_FSTRM_CONTROL_STOP, false);
+    cr_assert(len == 12);
+    cr_assert(dnstap_control_frame_type(frame, len) == DNSTAP_FSTRM_CONTROL_STOP);
+
+    /* Incomplete frame. */
+    cr_assert(dnstap_control_frame_type(frame, 11) == -1);
+    frame[7] = 5;
+    cr_assert(dnstap_control_frame_type(frame, len) == -1);
+}
+
+/** @}*/
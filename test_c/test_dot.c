@@ -0,0 +1,104 @@
+/**
+ * @file test_dot.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup dot_ut DNS over TLS
+ *
+ * @brief DNS over TLS unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <string.h>
+
+#include "dot.h"
+
+/**! @cond */
+TestSuite(dot);
+
+/** Decode hex string into buffer. */
+static void
+hex_to_buf(const char *hex, unsigned char *buf)
+{
+    for (size_t i = 0; i < strlen(hex) / 2; i++) {
+        sscanf(&hex[i * 2], "%2hhx", &buf[i]);
+    }
+}
+/**! @endcond */
+
+/** Test kernel TLS crypto info is derived from application traffic secrets
+ * per RFC 8448 section 3, simple 1-RTT handshake (TLS_AES_128_GCM_SHA256).
+ */
+Test(dot, test_dot_ktls_info_aes_gcm_128) {
+    dot_ktls_info_t info;
+    unsigned char   secret[32];
+    unsigned char   key[16];
+    unsigned char   iv[DOT_TLS_IV_LEN];
+
+    /* Server application traffic secret. */
+    hex_to_buf("a11af9f05531f856ad47116b45a950328204b4f44bfb6b3a4b4f1f3fcb631643", secret);
+    hex_to_buf("9f02283b6c9c07efc26bb9f2ac92e356", key);
+    hex_to_buf("cf782b88dd83549aadf1e984", iv);
+
+    cr_assert(dot_ktls_info(&info, 0x1301, secret, sizeof(secret)) == 0);
+    cr_assert(info.len == sizeof(struct tls12_crypto_info_aes_gcm_128));
+    cr_assert(info.crypto.info.version == TLS_1_3_VERSION);
+    cr_assert(info.crypto.info.cipher_type == TLS_CIPHER_AES_GCM_128);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.key, key, sizeof(key)) == 0);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.salt, iv, 4) == 0);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.iv, &iv[4], 8) == 0);
+    for (size_t i = 0; i < TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE; i++) {
+        cr_assert(info.crypto.aes_gcm_128.rec_seq[i] == 0);
+    }
+
+    /* Client application traffic secret. */
+    hex_to_buf("9e40646ce79a7f9dc05af8889bce6552875afa0b06df0087f792ebb7c17504a5", secret);
+    hex_to_buf("17422dda596ed5d9acd890e3c63f5051", key);
+    hex_to_buf("5b78923dee08579033e523d9", iv);
+
+    cr_assert(dot_ktls_info(&info, 0x1301, secret, sizeof(secret)) == 0);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.key, key, sizeof(key)) == 0);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.salt, iv, 4) == 0);
+    cr_assert(memcmp(info.crypto.aes_gcm_128.iv, &iv[4], 8) == 0);
+}
+
+/** Test crypto info layout of other cipher suites kernel TLS supports, and
+ * that cipher suites it does not support are rejected.
+ */
+Test(dot, test_dot_ktls_info_ciphers) {
+    dot_ktls_info_t info;
+    unsigned char   secret[DOT_TLS_SECRET_MAX] = { 1 };
+
+    cr_assert(dot_ktls_info(&info, 0x1302, secret, 48) == 0);
+    cr_assert(info.crypto.info.cipher_type == TLS_CIPHER_AES_GCM_256);
+    cr_assert(info.len == sizeof(struct tls12_crypto_info_aes_gcm_256));
+
+    cr_assert(dot_ktls_info(&info, 0x1303, secret, 32) == 0);
+    cr_assert(info.crypto.info.cipher_type == TLS_CIPHER_CHACHA20_POLY1305);
+    cr_assert(info.len == sizeof(struct tls12_crypto_info_chacha20_poly1305));
+
+    /* TLS_AES_128_CCM_SHA256 */
+    cr_assert(dot_ktls_info(&info, 0x1304, secret, 32) == -1);
+}
+
+/** @}*/
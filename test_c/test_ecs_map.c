@@ -0,0 +1,262 @@
+/**
+ * @file test_ecs_map.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup ecs_map_ut ECS Map
+ *
+ * @brief ECS map unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecs_map.h"
+#include "query.h"
+#include "rip_ns_utils.h"
+#include "zone.h"
+
+/**! @cond */
+TestSuite(ecs_map);
+
+static const char *test_ecs_map_file =
+    "; test ECS map\n"
+    "10.0.0.0/8          _eu\n"
+    "10.1.0.0/16         _US  ; more specific\n"
+    "10.1.2.128/25       _eu\n"
+    "\n"
+    "2001:db8::/32       _eu\n"
+    "2001:db8:1:2::/64   _us\n";
+
+static ecs_map_t *
+test_ecs_map_create(const char *file)
+{
+    char err[256] = {'\0'};
+
+    ecs_map_t *map = ecs_map_create(file, strlen(file), 1, err, sizeof(err));
+    cr_assert(map != NULL, "%s", err);
+    return map;
+}
+
+static void
+test_ecs_map_check(ecs_map_t *map, const char *ip, const char *view, uint8_t scope)
+{
+    uint8_t  addr[RIP_NS_IN6ADDRSZ];
+    uint16_t family = strchr(ip, ':') == NULL ? 1 : 2;
+    uint8_t  got_scope = 0xff;
+    uint16_t got_view;
+
+    cr_assert(inet_pton(family == 1 ? AF_INET : AF_INET6, ip, addr) == 1);
+    got_view = ecs_map_lookup(map, family, addr, &got_scope);
+    if (view == NULL) {
+        cr_assert(got_view == 0, "%s view %u", ip, got_view);
+    } else {
+        cr_assert(got_view != 0, "%s", ip);
+        cr_assert(map->views[got_view - 1][0] == strlen(view), "%s", ip);
+        cr_assert(memcmp(map->views[got_view - 1] + 1, view, strlen(view)) == 0, "%s", ip);
+    }
+    cr_assert(got_scope == scope, "%s scope %u, expected %u", ip, got_scope, scope);
+}
+/**! @endcond */
+
+/** Test ECS map lookup of view and scope prefix length. */
+Test(ecs_map, test_ecs_map_lookup) {
+    ecs_map_t *map = test_ecs_map_create(test_ecs_map_file);
+
+    cr_assert(map->views_count == 2);
+
+    /* Scope is first bit that distinguishes address from other prefixes. */
+    test_ecs_map_check(map, "10.5.0.0", "_eu", 14);
+    test_ecs_map_check(map, "10.200.0.0", "_eu", 9);
+    test_ecs_map_check(map, "10.1.3.0", "_us", 24);
+    test_ecs_map_check(map, "10.1.2.5", "_us", 25);
+    test_ecs_map_check(map, "10.1.2.200", "_eu", 25);
+    test_ecs_map_check(map, "11.0.0.0", NULL, 8);
+    test_ecs_map_check(map, "192.0.2.1", NULL, 1);
+
+    test_ecs_map_check(map, "2001:db8:1:2::1", "_us", 64);
+    test_ecs_map_check(map, "2001:db8:5::", "_eu", 46);
+    test_ecs_map_check(map, "2002::", NULL, 15);
+    ecs_map_release(map);
+
+    /* Empty map, whole address space is one region. */
+    map = test_ecs_map_create("; nothing\n");
+    test_ecs_map_check(map, "10.5.0.0", NULL, 0);
+    test_ecs_map_check(map, "2001:db8::1", NULL, 0);
+    ecs_map_release(map);
+}
+
+/** Test ECS map lookup against a linear scan of random IPv4 prefixes. */
+Test(ecs_map, test_ecs_map_lookup_random) {
+    char       file[64 * 32] = {'\0'};
+    uint32_t   prefix[64];
+    uint8_t    prefix_len[64];
+    char       prefix_view[64][4];
+    int        count = 0;
+    ecs_map_t *map   = NULL;
+
+    srandom(1);
+    for (int i = 0; i < 64; i++) {
+        uint8_t  len  = random() % 33;
+        uint32_t ip   = len == 0 ? 0 : ((uint32_t)random() ^ (uint32_t)random() << 16) &
+                        (0xffffffffU << (32 - len));
+        uint32_t ip_n = htonl(ip);
+        char     ip_str[INET_ADDRSTRLEN];
+        bool     dup  = false;
+
+        for (int j = 0; j < count; j++) {
+            dup = dup || (prefix[j] == ip && prefix_len[j] == len);
+        }
+        if (dup) {
+            continue;
+        }
+        prefix[count] = ip;
+        prefix_len[count] = len;
+        snprintf(prefix_view[count], sizeof(prefix_view[count]), "v%ld", random() % 4);
+        inet_ntop(AF_INET, &ip_n, ip_str, sizeof(ip_str));
+        snprintf(file + strlen(file), sizeof(file) - strlen(file), "%s/%u %s\n",
+                 ip_str, len, prefix_view[count]);
+        count++;
+    }
+    map = test_ecs_map_create(file);
+
+    for (int i = 0; i < 100000; i++) {
+        uint32_t ip    = (uint32_t)random() ^ (uint32_t)random() << 16;
+        int      match = -1;
+        uint8_t  scope = 0;
+        uint32_t ip_n;
+        char     ip_str[INET_ADDRSTRLEN];
+
+        /* Half of addresses are picked from within prefixes. */
+        if (i % 2) {
+            ip = prefix_len[i % count] == 32 ? prefix[i % count] :
+                 prefix[i % count] | ((uint32_t)random() >> prefix_len[i % count]);
+        }
+        for (int j = 0; j < count; j++) {
+            uint32_t diff = ip ^ prefix[j];
+            uint8_t  cpl  = diff == 0 ? 32 : __builtin_clz(diff);
+            uint8_t  s    = cpl + 1 < prefix_len[j] ? cpl + 1 : prefix_len[j];
+
+            if (cpl >= prefix_len[j] && (match < 0 || prefix_len[j] > prefix_len[match])) {
+                match = j;
+            }
+            scope = s > scope ? s : scope;
+        }
+
+        ip_n = htonl(ip);
+        inet_ntop(AF_INET, &ip_n, ip_str, sizeof(ip_str));
+        test_ecs_map_check(map, ip_str, match < 0 ? NULL : prefix_view[match], scope);
+    }
+    ecs_map_release(map);
+}
+
+/** Test ECS map file errors. */
+Test(ecs_map, test_ecs_map_create_err) {
+    const char *files[] = {
+        "10.0.0.0 _eu\n",
+        "10.0.0.0/8\n",
+        "10.0.0.0/8 _eu extra\n",
+        "10.0.0.0/33 _eu\n",
+        "10.0.0.1/8 _eu\n",
+        "2001:db8::/129 _eu\n",
+        "10.0.0.0/8 eu.west\n",
+        "10.0.0.0/8 _eu\n10.0.0.0/8 _us\n",
+    };
+    char err[256];
+
+    for (int i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        err[0] = '\0';
+        cr_assert(ecs_map_create(files[i], strlen(files[i]), 1, err, sizeof(err)) == NULL,
+                  "%s", files[i]);
+        cr_assert(strncmp(err, "line ", 5) == 0, "%s", err);
+    }
+}
+
+/** Test query resolve picks RRset variant of client subnet view. */
+Test(ecs_map, test_ecs_map_query_resolve) {
+    const char *zone_file =
+        "example.com.     3600 IN SOA  ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.     3600 IN NS   ns.example.com.\n"
+        "ns.example.com.  3600 IN A    192.0.2.1\n"
+        "www.example.com.   60 IN A    192.0.2.10\n"
+        "_eu.www.example.com. 60 IN A  198.51.100.10\n";
+    char        err[256] = {'\0'};
+    zone_db_t  *db  = zone_db_create(zone_file, strlen(zone_file), 1, err, sizeof(err));
+    ecs_map_t  *map = test_ecs_map_create(test_ecs_map_file);
+    const char *ips[]      = {"10.5.0.0", "10.1.3.0", "192.0.2.0", NULL};
+    const char *answers[]  = {"198.51.100.10", "192.0.2.10", "192.0.2.10", "192.0.2.10"};
+    uint8_t     scopes[]   = {14, 24, 1, 0};
+    config_t    cfg;
+    query_t     q;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    for (int i = 0; i < sizeof(scopes); i++) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&q.edns.client_subnet.ip;
+        uint8_t             a[RIP_NS_INADDRSZ];
+        uint8_t            *p;
+
+        query_init(&q, &cfg, 0);
+        query_reset(&q);
+        memset(q.request_buffer, 0, sizeof(rip_ns_header_t));
+        strcpy((char *)q.query_label, "www.example.com");
+        q.query_label_len = strlen((char *)q.query_label);
+        cr_assert(rip_ns_name_pton(q.query_label, q.query_qname, sizeof(q.query_qname)) >= 0);
+        q.query_qname_len  = rip_ns_name_lc(q.query_qname);
+        q.query_qname_hash = rip_ns_name_hash(q.query_qname, q.query_qname_len);
+        q.query_question_len = q.query_qname_len + RIP_NS_QFIXEDSZ;
+        q.query_q_type  = rip_ns_t_a;
+        q.query_q_class = rip_ns_c_in;
+        if (ips[i] != NULL) {
+            q.edns.client_subnet.edns_cs_valid = true;
+            q.edns.client_subnet.family        = 1;
+            q.edns.client_subnet.source_mask   = 24;
+            q.edns.client_subnet.ip_decoded    = true;
+            cr_assert(inet_pton(AF_INET, ips[i], &sin->sin_addr) == 1);
+        }
+
+        query_resolve(&q, db, map, NULL, NULL);
+        cr_assert(q.end_code == rip_ns_r_noerror);
+        cr_assert(q.answer_section_count == 1);
+        cr_assert(q.answer_qname_count == (i == 0 ? 1 : 0));
+        cr_assert(q.edns.client_subnet.scope_mask == scopes[i], "%s", ips[i]);
+        cr_assert(inet_pton(AF_INET, answers[i], a) == 1);
+        cr_assert(memcmp(q.answer_section[0]->rdata, a, sizeof(a)) == 0, "%s", ips[i]);
+
+        /* Variant is packed with query name (compressed) as owner name. */
+        cr_assert(query_response_pack(&q) == 0);
+        p = (uint8_t *)q.response_hdr + sizeof(rip_ns_header_t) + q.query_question_len;
+        cr_assert(p[0] == 0xc0 && p[1] == sizeof(rip_ns_header_t));
+        cr_assert(memcmp(p + 2 + RIP_NS_RRFIXEDSZ, a, sizeof(a)) == 0);
+        query_clean(&q);
+    }
+    config_clean(&cfg);
+    zone_db_release(db);
+    ecs_map_release(map);
+}
+
+/** @}*/
@@ -0,0 +1,346 @@
+/**
+ * @file test_geoip.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup geoip_ut GeoIP
+ *
+ * @brief GeoIP database unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "geoip.h"
+
+/**! @cond */
+TestSuite(geoip);
+
+/* Search tree of database being written, child -1 is empty, values from
+ * TEST_GEOIP_DATA up are data records.
+ */
+#define TEST_GEOIP_NODES_MAX 1024
+#define TEST_GEOIP_DATA      0x10000000
+
+typedef struct test_geoip_s {
+    int32_t  child[TEST_GEOIP_NODES_MAX][2];
+    uint32_t count;
+    uint8_t  data[1024];
+    uint32_t data_len;
+} test_geoip_t;
+
+static void
+test_geoip_init(test_geoip_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    t->child[0][0] = t->child[0][1] = -1;
+    t->count = 1;
+}
+
+static void
+test_geoip_string(test_geoip_t *t, const char *s)
+{
+    t->data[t->data_len++] = 2 << 5 | strlen(s);
+    memcpy(t->data + t->data_len, s, strlen(s));
+    t->data_len += strlen(s);
+}
+
+/* Append record {"continent": {"code": ...}, "country": {"iso_code": ...}},
+ * country is left out if NULL, continent is a pointer to continent map of
+ * record at offset pointer if it is not 0.
+ */
+static uint32_t
+test_geoip_record(test_geoip_t *t, const char *country, const char *continent,
+                  uint32_t pointer)
+{
+    uint32_t offset = t->data_len;
+
+    t->data[t->data_len++] = 7 << 5 | (country != NULL ? 2 : 1);
+    test_geoip_string(t, "continent");
+    if (pointer != 0) {
+        t->data[t->data_len++] = 1 << 5 | (pointer >> 8);
+        t->data[t->data_len++] = pointer & 0xff;
+    } else {
+        t->data[t->data_len++] = 7 << 5 | 1;
+        test_geoip_string(t, "code");
+        test_geoip_string(t, continent);
+    }
+    if (country != NULL) {
+        test_geoip_string(t, "country");
+        t->data[t->data_len++] = 7 << 5 | 1;
+        test_geoip_string(t, "iso_code");
+        test_geoip_string(t, country);
+    }
+    return offset;
+}
+
+static void
+test_geoip_insert(test_geoip_t *t, const uint8_t *addr, int len, uint32_t data)
+{
+    uint32_t node = 0;
+
+    for (int i = 0; i < len - 1; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+
+        /* Network inside a shorter one splits its data record. */
+        if (t->child[node][bit] < 0 || t->child[node][bit] >= TEST_GEOIP_DATA) {
+            cr_assert(t->count < TEST_GEOIP_NODES_MAX);
+            t->child[t->count][0] = t->child[t->count][1] = t->child[node][bit];
+            t->child[node][bit] = t->count++;
+        }
+        node = t->child[node][bit];
+    }
+    t->child[node][(addr[(len - 1) / 8] >> (7 - (len - 1) % 8)) & 1] = TEST_GEOIP_DATA + data;
+}
+
+static void
+test_geoip_uint(FILE *f, const char *key, int type, int size, uint32_t v)
+{
+    fputc(2 << 5 | strlen(key), f);
+    fputs(key, f);
+    fputc(type << 5 | size, f);
+    for (int i = size - 1; i >= 0; i--) {
+        fputc((v >> (8 * i)) & 0xff, f);
+    }
+}
+
+/* Write database with record size to open file, returns its length. */
+static size_t
+test_geoip_write(test_geoip_t *t, FILE *f, int record_size, int ip_version)
+{
+    for (uint32_t n = 0; n < t->count; n++) {
+        uint32_t r[2];
+        uint8_t  b[8];
+
+        for (int i = 0; i < 2; i++) {
+            r[i] = t->child[n][i] < 0 ? t->count :
+                   t->child[n][i] >= TEST_GEOIP_DATA ?
+                   t->count + 16 + (t->child[n][i] - TEST_GEOIP_DATA) : (uint32_t)t->child[n][i];
+        }
+        if (record_size == 24) {
+            b[0] = r[0] >> 16; b[1] = r[0] >> 8; b[2] = r[0];
+            b[3] = r[1] >> 16; b[4] = r[1] >> 8; b[5] = r[1];
+        } else if (record_size == 28) {
+            b[0] = r[0] >> 16; b[1] = r[0] >> 8; b[2] = r[0];
+            b[3] = ((r[0] >> 20) & 0xf0) | ((r[1] >> 24) & 0x0f);
+            b[4] = r[1] >> 16; b[5] = r[1] >> 8; b[6] = r[1];
+        } else {
+            for (int i = 0; i < 4; i++) {
+                b[i] = r[0] >> (24 - 8 * i);
+                b[4 + i] = r[1] >> (24 - 8 * i);
+            }
+        }
+        fwrite(b, 1, record_size / 4, f);
+    }
+    for (int i = 0; i < 16; i++) {
+        fputc(0, f);
+    }
+    fwrite(t->data, 1, t->data_len, f);
+    fwrite("\xab\xcd\xefMaxMind.com", 1, 14, f);
+    fputc(7 << 5 | 4, f);
+    test_geoip_uint(f, "node_count", 6, 4, t->count);
+    test_geoip_uint(f, "record_size", 5, 2, record_size);
+    test_geoip_uint(f, "ip_version", 5, 2, ip_version);
+    fputc(2 << 5 | 13, f);
+    fputs("database_type", f);
+    fputc(2 << 5 | 4, f);
+    fputs("Test", f);
+    fflush(f);
+    return ftell(f);
+}
+
+static geoip_t *
+test_geoip_open(test_geoip_t *t, int record_size, int ip_version)
+{
+    char     path[] = "/tmp/test_geoip_XXXXXX";
+    char     err[256] = {'\0'};
+    int      fd     = mkstemp(path);
+    FILE    *f      = fdopen(fd, "w+");
+    size_t   len;
+    geoip_t *geoip;
+
+    cr_assert(f != NULL);
+    len = test_geoip_write(t, f, record_size, ip_version);
+    geoip = geoip_open(fd, len, 1, err, sizeof(err));
+    cr_assert(geoip != NULL, "%s", err);
+    fclose(f);
+    unlink(path);
+    return geoip;
+}
+
+static void
+test_geoip_check(geoip_t *geoip, const char *ip, const char *geo, uint8_t scope)
+{
+    struct sockaddr_storage ss = {};
+    uint32_t                expected = 0;
+    uint32_t                g;
+    uint8_t                 s;
+
+    if (strchr(ip, ':') == NULL) {
+        ss.ss_family = AF_INET;
+        cr_assert(inet_pton(AF_INET, ip, &((struct sockaddr_in *)&ss)->sin_addr) == 1);
+    } else {
+        ss.ss_family = AF_INET6;
+        cr_assert(inet_pton(AF_INET6, ip, &((struct sockaddr_in6 *)&ss)->sin6_addr) == 1);
+    }
+    for (int i = 0; geo != NULL && i < 4; i++) {
+        expected = expected << 8 | (geo[i] == '-' ? 0 : geo[i]);
+    }
+    g = geoip_lookup(geoip, &ss, &s);
+    cr_assert(g == expected, "%s geo %08x, expected %08x", ip, g, expected);
+    cr_assert(s == scope, "%s scope %u, expected %u", ip, s, scope);
+}
+
+/* Database of test networks, IPv4 at ::/96 of IPv6 tree if v6 is set. */
+static void
+test_geoip_networks(test_geoip_t *t, bool v6)
+{
+    uint8_t  a[16] = {};
+    int      base  = v6 ? 12 : 0;
+    uint32_t de;
+    uint32_t fr;
+    uint32_t as;
+
+    test_geoip_init(t);
+    de = test_geoip_record(t, "DE", "EU", 0);
+    /* Continent of FR record points to continent map of DE record. */
+    fr = test_geoip_record(t, "FR", NULL, de + 1 + 10);
+    as = test_geoip_record(t, NULL, "AS", 0);
+
+    a[base] = 10;
+    test_geoip_insert(t, a, base * 8 + 8, de);
+    a[base + 1] = 1; a[base + 2] = 2; a[base + 3] = 128;
+    test_geoip_insert(t, a, base * 8 + 25, fr);
+    a[base] = 192; a[base + 1] = 0; a[base + 2] = 2; a[base + 3] = 0;
+    test_geoip_insert(t, a, base * 8 + 24, as);
+    if (v6) {
+        memset(a, 0, sizeof(a));
+        a[0] = 0x20; a[1] = 0x01; a[2] = 0x0d; a[3] = 0xb8;
+        test_geoip_insert(t, a, 32, fr);
+    }
+}
+/**! @endcond */
+
+/** Test country and continent lookup, in IPv6 and IPv4 databases of each
+ * record size.
+ */
+Test(geoip, test_geoip_lookup) {
+    static test_geoip_t t;
+    const int           sizes[] = { 24, 28, 32 };
+
+    for (int i = 0; i < 3; i++) {
+        geoip_t *geoip;
+
+        test_geoip_networks(&t, true);
+        geoip = test_geoip_open(&t, sizes[i], 6);
+        cr_assert(geoip->node_count == t.count && geoip->record_size == sizes[i]);
+        /* Network of /8 is split around the /25 inside it. */
+        test_geoip_check(geoip, "10.200.2.3", "deeu", 9);
+        test_geoip_check(geoip, "::ffff:10.200.2.3", "deeu", 9);
+        test_geoip_check(geoip, "10.1.2.3", "deeu", 25);
+        test_geoip_check(geoip, "10.1.2.200", "freu", 25);
+        test_geoip_check(geoip, "192.0.2.7", "--as", 24);
+        test_geoip_check(geoip, "192.0.3.7", NULL, 24);
+        test_geoip_check(geoip, "2001:db8::1", "freu", 32);
+        test_geoip_check(geoip, "2001:db9::1", NULL, 32);
+        geoip_release(geoip);
+
+        test_geoip_networks(&t, false);
+        geoip = test_geoip_open(&t, sizes[i], 4);
+        test_geoip_check(geoip, "10.200.2.3", "deeu", 9);
+        test_geoip_check(geoip, "10.1.2.200", "freu", 25);
+        test_geoip_check(geoip, "2001:db8::1", NULL, 0);
+        geoip_release(geoip);
+    }
+}
+
+/** Test result cache holds results by /24 prefix, unless database network is
+ * longer, and is emptied when database generation changes.
+ */
+Test(geoip, test_geoip_cache_lookup) {
+    static test_geoip_t     t;
+    static geoip_cache_t    cache;
+    struct sockaddr_storage ss = { .ss_family = AF_INET };
+    struct sockaddr_in     *sin = (struct sockaddr_in *)&ss;
+    geoip_t                *geoip;
+    uint32_t                geo;
+    uint8_t                 scope;
+
+    test_geoip_networks(&t, true);
+    geoip = test_geoip_open(&t, 24, 6);
+
+    inet_pton(AF_INET, "10.9.9.1", &sin->sin_addr);
+    cr_assert(!geoip_cache_lookup(&cache, geoip, &ss, &geo, &scope));
+    cr_assert(geo == ('d' << 24 | 'e' << 16 | 'e' << 8 | 'u') && scope == 13);
+    inet_pton(AF_INET, "10.9.9.2", &sin->sin_addr);
+    cr_assert(geoip_cache_lookup(&cache, geoip, &ss, &geo, &scope));
+    cr_assert(geo == ('d' << 24 | 'e' << 16 | 'e' << 8 | 'u') && scope == 13);
+
+    /* /25 network is not cached for its /24. */
+    inet_pton(AF_INET, "10.1.2.200", &sin->sin_addr);
+    cr_assert(!geoip_cache_lookup(&cache, geoip, &ss, &geo, &scope));
+    cr_assert(!geoip_cache_lookup(&cache, geoip, &ss, &geo, &scope));
+    cr_assert(scope == 25);
+
+    geoip->generation = 2;
+    inet_pton(AF_INET, "10.9.9.2", &sin->sin_addr);
+    cr_assert(!geoip_cache_lookup(&cache, geoip, &ss, &geo, &scope));
+    geoip_release(geoip);
+}
+
+/** Test invalid database files are rejected. */
+Test(geoip, test_geoip_open_errors) {
+    char     path[] = "/tmp/test_geoip_XXXXXX";
+    char     err[256] = {'\0'};
+    int      fd     = mkstemp(path);
+    FILE    *f      = fdopen(fd, "w+");
+    geoip_t *geoip;
+
+    cr_assert(f != NULL);
+    fputs("not a MaxMind database file", f);
+    fflush(f);
+    geoip = geoip_open(fd, ftell(f), 1, err, sizeof(err));
+    cr_assert(geoip == NULL);
+    cr_assert(strcmp(err, "metadata not found") == 0, "%s", err);
+
+    /* Metadata claims more nodes than file has. */
+    rewind(f);
+    fwrite("\xab\xcd\xefMaxMind.com", 1, 14, f);
+    fputc(7 << 5 | 3, f);
+    test_geoip_uint(f, "node_count", 6, 4, 1000);
+    test_geoip_uint(f, "record_size", 5, 2, 24);
+    test_geoip_uint(f, "ip_version", 5, 2, 6);
+    fflush(f);
+    geoip = geoip_open(fd, ftell(f), 1, err, sizeof(err));
+    cr_assert(geoip == NULL);
+    cr_assert(strstr(err, "search tree of 1000 nodes") != NULL, "%s", err);
+    fclose(f);
+    unlink(path);
+}
+
+/** @}*/
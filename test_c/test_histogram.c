@@ -0,0 +1,101 @@
+/**
+ * @file test_histogram.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup histogram_ut Histogram
+ *
+ * @brief Histogram unit tests
+ *  @{
+ */
+#include <stdint.h>
+
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "histogram.h"
+
+/**! @cond */
+TestSuite(histogram);
+/**! @endcond */
+
+/** Test values map to contiguous buckets whose width stays within precision. */
+Test(histogram, test_histogram_bucket_index) {
+    unsigned int prev = 0;
+
+    for (uint64_t v = 0; v < HISTOGRAM_SUB_BUCKETS; v++) {
+        cr_assert(histogram_bucket_index(v) == v);
+        cr_assert(histogram_bucket_value_max(v) == v);
+    }
+    cr_assert(histogram_bucket_index(16) == 16);
+    cr_assert(histogram_bucket_index(31) == 31);
+    cr_assert(histogram_bucket_index(32) == 32);
+    cr_assert(histogram_bucket_index(33) == 32);
+    cr_assert(histogram_bucket_value_max(32) == 33);
+
+    /* Buckets are monotonic, and value is never larger than its bucket max. */
+    for (uint64_t v = 1; v < ((uint64_t)1 << 36); v = v * 5 / 4 + 1) {
+        unsigned int index = histogram_bucket_index(v);
+
+        cr_assert(index >= prev);
+        cr_assert(v <= histogram_bucket_value_max(index));
+        cr_assert(histogram_bucket_value_max(index) - v <= v / HISTOGRAM_SUB_BUCKETS);
+        prev = index;
+    }
+    cr_assert(histogram_bucket_index((uint64_t)1 << 36) == HISTOGRAM_BUCKETS - 1);
+    cr_assert(histogram_bucket_index(UINT64_MAX) == HISTOGRAM_BUCKETS - 1);
+}
+
+/** Test recording, merging and quantiles. */
+Test(histogram, test_histogram_quantile_merge) {
+    histogram_t a = {};
+    histogram_t b = {};
+
+    cr_assert(histogram_quantile(&a, 0.5) == 0);
+
+    for (uint64_t v = 1; v <= 100; v++) {
+        histogram_record(&a, v * 1000);
+    }
+    cr_assert(a.count == 100);
+    cr_assert(a.sum == 5050 * 1000);
+
+    /* Quantiles are within bucket precision, never below actual value. */
+    cr_assert(histogram_quantile(&a, 0.5) >= 50000);
+    cr_assert(histogram_quantile(&a, 0.5) <= 50000 + 50000 / HISTOGRAM_SUB_BUCKETS);
+    cr_assert(histogram_quantile(&a, 0.99) >= 99000);
+    cr_assert(histogram_quantile(&a, 1.0) >= 100000);
+    cr_assert(histogram_quantile(&a, 0.0) >= 1000);
+    cr_assert(histogram_quantile(&a, 0.0) < 2000);
+
+    /* Merge a slow tail, p99 moves into it. */
+    for (int i = 0; i < 100; i++) {
+        histogram_record(&b, 10000000);
+    }
+    histogram_merge(&a, &b);
+    cr_assert(a.count == 200);
+    cr_assert(histogram_quantile(&a, 0.99) >= 10000000);
+    cr_assert(histogram_quantile(&a, 0.25) <= 55000);
+    cr_assert(b.count == 100);
+}
+
+/** @}*/
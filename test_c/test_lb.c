@@ -0,0 +1,214 @@
+/**
+ * @file test_lb.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup lb_ut Load Balancing
+ *
+ * @brief Load balancing unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lb.h"
+
+/**! @cond */
+TestSuite(lb);
+
+static const char *test_lb_file =
+    "; test candidates\n"
+    "www.example.com   30  A     192.0.2.1    3  80\n"
+    "www.example.com   30  A     192.0.2.2    1  80   ; backup\n"
+    "WWW.Example.com   60  AAAA  2001:db8::1  1\n"
+    "\n"
+    "api.example.com   10  A     192.0.2.1    1  80   ; shares endpoint\n"
+    "api.example.com   10  A     192.0.2.1    1  443\n";
+
+/* Pick record of name and type, NULL if there is no set. */
+static const rr_record_t *
+test_lb_pick(lb_t *lb, const char *name, uint16_t type, uint64_t seed, bool *all_down)
+{
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+    uint16_t      len;
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    len = rip_ns_name_lc(wire);
+    return lb_pick(lb, wire, len, rip_ns_name_hash(wire, len), type, seed, all_down);
+}
+
+/* Mark endpoint 192.0.2.<octet>:<port> down. */
+static void
+test_lb_down(lb_t *lb, uint8_t octet, uint16_t port)
+{
+    uint32_t e = 0;
+
+    for (; e < lb->endpoints_count; e++) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)&lb->endpoints[e].addr;
+
+        if (sin->sin_family == AF_INET && lb->endpoints[e].port == port &&
+            sin->sin_addr.s_addr == htonl(0xc0000200 | octet)) {
+            break;
+        }
+    }
+    cr_assert(e < lb->endpoints_count, "no endpoint 192.0.2.%u port %u", octet, port);
+    atomic_fetch_and(&lb->health[e >> 6], ~(1ULL << (e & 63)));
+}
+
+/* Count picks of each IPv4 address last octet, over many seeds. */
+static void
+test_lb_count(lb_t *lb, const char *name, unsigned *counts, bool all_down)
+{
+    bool down = !all_down;
+
+    memset(counts, 0, sizeof(unsigned) * 4);
+    for (uint64_t seed = 0; seed < 4000; seed++) {
+        const rr_record_t *rr = test_lb_pick(lb, name, rip_ns_t_a, seed, &down);
+
+        cr_assert(rr != NULL);
+        cr_assert(rr->rdata_len == 4);
+        cr_assert(down == all_down);
+        counts[rr->rdata[3] & 3]++;
+    }
+}
+/**! @endcond */
+
+/** Test candidates are grouped into sets by name and type, and records are
+ * picked by weight among healthy candidates, or among all of them if none
+ * is healthy.
+ */
+Test(lb, test_lb_pick) {
+    char               err[256]  = {'\0'};
+    lb_t              *lb        = lb_create(test_lb_file, strlen(test_lb_file), 1, NULL,
+                                             err, sizeof(err));
+    unsigned           counts[4];
+    bool               all_down  = true;
+    const rr_record_t *rr;
+
+    cr_assert(lb != NULL, "%s", err);
+    cr_assert(lb->generation == 1);
+    cr_assert(lb->sets_count == 3);
+    cr_assert(lb->candidates_count == 5);
+    /* 192.0.2.1:80 is shared by www and api sets. */
+    cr_assert(lb->endpoints_count == 4);
+
+    rr = test_lb_pick(lb, "www.example.com", rip_ns_t_aaaa, 7, &all_down);
+    cr_assert(rr != NULL);
+    cr_assert(!all_down);
+    cr_assert(rr->type == rip_ns_t_aaaa && rr->ttl == 60 && rr->rdata_len == 16);
+    cr_assert(strcmp((const char *)rr->name, "www.example.com") == 0, "%s", rr->name);
+    cr_assert(test_lb_pick(lb, "www.example.com", rip_ns_t_mx, 7, &all_down) == NULL);
+    cr_assert(test_lb_pick(lb, "example.com", rip_ns_t_a, 7, &all_down) == NULL);
+
+    /* Weights 3:1. */
+    test_lb_count(lb, "www.example.com", counts, false);
+    cr_assert(counts[1] > 2700 && counts[1] < 3300, "%u", counts[1]);
+    cr_assert(counts[1] + counts[2] == 4000);
+
+    /* Shared endpoint goes down, for both sets. */
+    test_lb_down(lb, 1, 80);
+    test_lb_count(lb, "www.example.com", counts, false);
+    cr_assert(counts[2] == 4000, "%u", counts[2]);
+
+    /* Remaining www endpoint goes down, records are picked by weight again. */
+    test_lb_down(lb, 2, 80);
+    test_lb_count(lb, "www.example.com", counts, true);
+    cr_assert(counts[1] > 2700 && counts[1] < 3300, "%u", counts[1]);
+
+    /* api set has a healthy candidate on port 443 only. */
+    for (uint64_t seed = 0; seed < 100; seed++) {
+        rr = test_lb_pick(lb, "api.example.com", rip_ns_t_a, seed, &all_down);
+        cr_assert(rr != NULL && !all_down);
+        cr_assert(lb->endpoints[((const lb_candidate_t *)rr)->endpoint].port == 443);
+    }
+    lb_release(lb);
+}
+
+/** Test candidate sets built from a changed file keep health of endpoints
+ * they share with sets they replace, and new endpoints start healthy.
+ */
+Test(lb, test_lb_create_health) {
+    char        err[256] = {'\0'};
+    const char *changed  = "www.example.com 30 A 192.0.2.2 1 80\n"
+                           "www.example.com 30 A 192.0.2.3 1 80\n";
+    lb_t       *lb       = lb_create(test_lb_file, strlen(test_lb_file), 1, NULL,
+                                     err, sizeof(err));
+    lb_t       *next;
+
+    cr_assert(lb != NULL, "%s", err);
+    test_lb_down(lb, 1, 80);
+    test_lb_down(lb, 2, 80);
+    next = lb_create(changed, strlen(changed), 2, lb, err, sizeof(err));
+    cr_assert(next != NULL, "%s", err);
+    cr_assert(next->endpoints_count == 2);
+    for (uint32_t i = 0; i < next->endpoints_count; i++) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)&next->endpoints[i].addr;
+
+        cr_assert(lb_healthy(next, i) == (sin->sin_addr.s_addr == htonl(0xc0000203)));
+    }
+    lb_release(lb);
+    lb_release(next);
+
+    /* Empty file has no sets. */
+    lb = lb_create("; nothing\n", 10, 3, NULL, err, sizeof(err));
+    cr_assert(lb != NULL, "%s", err);
+    cr_assert(lb->sets_count == 0 && lb->endpoints_count == 0);
+    cr_assert(test_lb_pick(lb, "www.example.com", rip_ns_t_a, 1, &(bool){false}) == NULL);
+    lb_release(lb);
+}
+
+/** Test load balancing file errors. */
+Test(lb, test_lb_create_errors) {
+    char  err[256] = {'\0'};
+    lb_t *lb;
+
+    lb = lb_create("www.example.com 30 MX 192.0.2.1 1\n", 34, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 1: invalid type \"MX\"") == 0, "%s", err);
+
+    lb = lb_create("\nwww.example.com 30 AAAA 192.0.2.1 1\n", 37, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 2: invalid address \"192.0.2.1\"") == 0, "%s", err);
+
+    lb = lb_create("www.example.com 30 A 192.0.2.1 0\n", 33, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 1: invalid weight \"0\"") == 0, "%s", err);
+
+    lb = lb_create("www.example.com x A 192.0.2.1 1\n", 32, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 1: invalid TTL \"x\"") == 0, "%s", err);
+
+    lb = lb_create("www.example.com 30 A 192.0.2.1 1 65536\n", 39, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 1: invalid port \"65536\"") == 0, "%s", err);
+
+    lb = lb_create("www.example.com 30 A 192.0.2.1\n", 31, 1, NULL, err, sizeof(err));
+    cr_assert(lb == NULL);
+    cr_assert(strcmp(err, "line 1: invalid format") == 0, "%s", err);
+}
+
+/** @}*/
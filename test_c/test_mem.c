@@ -0,0 +1,110 @@
+/**
+ * @file test_mem.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \defgroup mem_ut Memory Accounting
+ *
+ * @brief Memory accounting unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <malloc.h>
+#include <stdint.h>
+
+#include "buf_pool.h"
+#include "mem.h"
+
+/**! @cond */
+TestSuite(mem);
+/**! @endcond */
+
+/** Test tagged allocators count memory in account of calling thread, and
+ * allocate uncounted when thread has no account.
+ */
+Test(mem, test_mem_account) {
+    mem_account_t account = {};
+    void         *a;
+    void         *b;
+    void         *c;
+
+    mem_account_set(&account);
+    cr_assert(mem_account_get() == &account);
+
+    a = mem_malloc(MEM_TAG_UDP, 100);
+    cr_assert(a != NULL);
+    cr_assert(account.bytes[MEM_TAG_UDP] == malloc_usable_size(a));
+    b = mem_calloc(MEM_TAG_RRL, 10, 64);
+    cr_assert(b != NULL && ((char *)b)[639] == 0);
+    c = mem_aligned_alloc(MEM_TAG_RRL, 64, 256);
+    cr_assert(c != NULL && ((uintptr_t)c & 63) == 0);
+    cr_assert(account.bytes[MEM_TAG_RRL] == malloc_usable_size(b) + malloc_usable_size(c));
+    cr_assert(mem_account_total(&account) ==
+              malloc_usable_size(a) + malloc_usable_size(b) + malloc_usable_size(c));
+
+    a = mem_realloc(MEM_TAG_UDP, a, 10000);
+    cr_assert(a != NULL);
+    cr_assert(account.bytes[MEM_TAG_UDP] == malloc_usable_size(a));
+
+    mem_free(MEM_TAG_UDP, a);
+    mem_free(MEM_TAG_RRL, b);
+    mem_free(MEM_TAG_RRL, c);
+    mem_free(MEM_TAG_RRL, NULL);
+    cr_assert(mem_account_total(&account) == 0);
+
+    /* Memory not allocated with tagged allocators. */
+    mem_account_update(MEM_TAG_OTHER, 4096);
+    cr_assert(account.bytes[MEM_TAG_OTHER] == 4096);
+    mem_account_update(MEM_TAG_OTHER, -4096);
+    cr_assert(account.bytes[MEM_TAG_OTHER] == 0);
+
+    /* No account, nothing is counted. */
+    mem_account_set(NULL);
+    a = mem_malloc(MEM_TAG_UDP, 100);
+    mem_free(MEM_TAG_UDP, a);
+    cr_assert(mem_account_total(&account) == 0);
+}
+
+/** Test buffer pool accounts buffers to its tag until they are freed. */
+Test(mem, test_mem_buf_pool) {
+    mem_account_t account = {};
+    buf_pool_t    pool;
+    size_t        size;
+    void         *buf;
+
+    mem_account_set(&account);
+    buf_pool_init(&pool, 1024, 4096, 1, MEM_TAG_TCP_BUFS);
+    buf = buf_pool_get(&pool, 2000, &size);
+    cr_assert(buf != NULL && size == 2048);
+    cr_assert(account.bytes[MEM_TAG_TCP_BUFS] >= 2048);
+
+    /* Buffer kept in free list stays accounted. */
+    buf_pool_put(&pool, buf, size);
+    cr_assert(account.bytes[MEM_TAG_TCP_BUFS] >= 2048);
+    buf_pool_clean(&pool);
+    cr_assert(account.bytes[MEM_TAG_TCP_BUFS] == 0);
+    mem_account_set(NULL);
+}
+
+/** @}*/
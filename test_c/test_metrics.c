@@ -0,0 +1,327 @@
+/**
+ * @file test_metrics.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup metrics_ut Metrics
+ *
+ * @brief Metrics unit tests
+ *  @{
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "conn.h"
+#include "metrics.h"
+#include "query.h"
+#include "zone.h"
+
+/**! @cond */
+TestSuite(metrics);
+/**! @endcond */
+
+/** Test per vectorloop metrics are cache line aligned and summed by reader. */
+Test(metrics, test_metrics_vl_sum) {
+    metrics_t     metrics;
+    metrics_vl_t *vl0;
+    metrics_vl_t *vl1;
+    metrics_vl_t  sum;
+
+    metrics_init(&metrics, 3);
+    vl0 = metrics_vl_get(&metrics, 0);
+    vl1 = metrics_vl_get(&metrics, 1);
+    cr_assert(((uintptr_t)vl0 % CACHE_LINE_SIZE) == 0);
+    cr_assert(((uintptr_t)vl1 % CACHE_LINE_SIZE) == 0);
+    cr_assert((uintptr_t)vl1 - (uintptr_t)vl0 >= sizeof(metrics_vl_t));
+
+    METRICS_INC(vl0->udp.queries);
+    METRICS_INC(vl0->udp.queries);
+    METRICS_INC(vl1->udp.queries);
+    METRICS_ADD(vl1->tcp.connections, 5);
+    METRICS_INC(metrics_vl_get(&metrics, 2)->app.query_log_buf_no_space);
+
+    metrics_vl_sum(&metrics, &sum);
+    cr_assert(sum.udp.queries == 3);
+    cr_assert(sum.tcp.connections == 5);
+    cr_assert(sum.app.query_log_buf_no_space == 1);
+    cr_assert(sum.dns.queries_rcode_noerror == 0);
+    /* Shards are not modified by summing. */
+    cr_assert(vl0->udp.queries == 2);
+
+    metrics_clean(&metrics);
+    cr_assert(metrics.vl_shards == NULL);
+}
+
+/** Test vectorloop sketch windows are collected only once vectorloop moved
+ * off them, and are merged over vectorloops.
+ */
+Test(metrics, test_metrics_sketch_merge) {
+    metrics_t            metrics;
+    metrics_sketch_vl_t *vl0;
+    metrics_sketch_vl_t *vl1;
+    uint32_t             idx[METRICS_SKETCH_TOPK_CAPACITY];
+    char                *text;
+    size_t               text_len;
+    const unsigned char  name[] = "\3www\7example\3com";
+
+    metrics_init(&metrics, 2);
+    cr_assert(metrics_sketch_vl_get(&metrics, 0) == NULL);
+    metrics_sketch_init(&metrics);
+    vl0 = metrics_sketch_vl_get(&metrics, 0);
+    vl1 = metrics_sketch_vl_get(&metrics, 1);
+
+    sketch_topk_add(&vl0->current->qnames, 1, name, sizeof(name), 3);
+    sketch_topk_add(&vl1->current->qnames, 1, name, sizeof(name), 2);
+    sketch_topk_add(&vl1->current->clients, METRICS_SKETCH_CLIENT_V4 << 56 | 0xc00002, NULL, 0, 5);
+    sketch_hll_add(&vl1->current->clients_hll, 42);
+    vl0->current->queries = 3;
+    vl1->current->queries = 2;
+
+    /* Windows are collected only once vectorloops acknowledged leaving them. */
+    metrics_sketch_flip(&metrics);
+    cr_assert(atomic_load(&vl0->epoch) == 1);
+    cr_assert(metrics_sketch_merge(&metrics) == 2);
+    metrics_sketch_vl_sync(vl0);
+    cr_assert(metrics_sketch_merge(&metrics) == 1);
+    cr_assert(metrics.sketch->merged.queries == 3);
+
+    /* vl1 is still pending, flip does not move it again. */
+    metrics_sketch_flip(&metrics);
+    cr_assert(atomic_load(&vl1->epoch) == 1);
+    metrics_sketch_vl_sync(vl1);
+    cr_assert(atomic_load(&vl1->acked) == 1);
+    sketch_topk_add(&vl1->current->qnames, 2, name, sizeof(name), 1);
+    cr_assert(metrics_sketch_merge(&metrics) == 1);
+    cr_assert(metrics.sketch->merged.queries == 5);
+    cr_assert(sketch_topk_sorted(&metrics.sketch->merged.qnames, idx, 1) == 1);
+    cr_assert(metrics.sketch->merged.qnames.entries[idx[0]].count == 5);
+
+    text_len = metrics_export_prometheus(&metrics, &text);
+    cr_assert(text_len > 0);
+    cr_assert(strstr(text, "ripples_sketch_window_queries 5\n") != NULL);
+    cr_assert(strstr(text, "ripples_sketch_clients 1\n") != NULL);
+    cr_assert(strstr(text, "ripples_sketch_top_qname_queries{rank=\"1\",qname=\"www.example.com\"} 5\n") != NULL);
+    cr_assert(strstr(text, "ripples_sketch_top_client_queries{rank=\"1\",client=\"192.0.2.0/24\"} 5\n") != NULL);
+    free(text);
+
+    metrics_clean(&metrics);
+    cr_assert(metrics.sketch == NULL);
+}
+
+/** Test query counters are summed in batch and published by flush. */
+Test(metrics, test_metrics_query_batch) {
+    metrics_t             metrics;
+    metrics_vl_t         *vl;
+    metrics_query_batch_t batch = {0};
+    query_t               q[3];
+
+    metrics_init(&metrics, 1);
+    vl = metrics_vl_get(&metrics, 0);
+
+    memset(q, 0, sizeof(q));
+    q[0].protocol     = 0;
+    q[0].end_code     = 0;
+    q[0].query_q_type = 1;
+    q[1].protocol     = 0;
+    q[1].end_code     = 3;
+    q[1].query_q_type = 28;
+    q[1].edns.edns_raw_buf_len = 11;
+    q[1].edns.edns_valid       = true;
+    q[1].edns.dnssec           = true;
+    q[2].protocol     = 1;
+    q[2].end_code     = -2;
+    for (int i = 0; i < 3; i++) {
+        query_report_metrics(&q[i], &batch, vl, NULL, NULL, NULL);
+    }
+
+    /* Nothing is published before flush. */
+    cr_assert(vl->udp.queries == 0);
+    cr_assert(batch.queries[0] == 2);
+    cr_assert(batch.queries[1] == 1);
+
+    query_report_metrics_flush(&batch, vl);
+    cr_assert(vl->udp.queries == 2);
+    cr_assert(vl->tcp.queries == 1);
+    cr_assert(vl->dns.queries == 3);
+    cr_assert(vl->dns.queries_rcode_noerror == 1);
+    cr_assert(vl->dns.queries_rcode_nxdomain == 1);
+    cr_assert(vl->dns.queries_rcode_shortheader == 1);
+    cr_assert(vl->dns.queries_type[RIP_NS_QTYPE_IDX_A] == 1);
+    cr_assert(vl->dns.queries_type[RIP_NS_QTYPE_IDX_AAAA] == 1);
+    cr_assert(vl->dns.queries_type[RIP_NS_QTYPE_IDX_INVALID] == 1);
+    cr_assert(vl->dns.queries_edns_present == 1);
+    cr_assert(vl->dns.queries_edns_valid == 1);
+    cr_assert(vl->dns.queries_edns_dobit == 1);
+    cr_assert(vl->dns.queries_cookie == 0);
+
+    /* Batch is reset, flushing it again publishes nothing. */
+    cr_assert(batch.queries[0] == 0 && batch.type[RIP_NS_QTYPE_IDX_A] == 0);
+    query_report_metrics_flush(&batch, vl);
+    cr_assert(vl->udp.queries == 2);
+    cr_assert(vl->dns.queries == 3);
+
+    metrics_clean(&metrics);
+}
+
+/** Test connection lifetime is recorded when connection is released, but not
+ * when it is handed off to another vectorloop.
+ */
+Test(metrics, test_metrics_tcp_conn_lifetime) {
+    metrics_t    metrics;
+    metrics_vl_t *vl;
+    conn_tcp_t   conn_tcp = {
+        .state               = TCP_CONN_ST_WAIT_FOR_QUERY,
+        .queries_total_count = 3,
+        .bytes_read          = 90,
+        .bytes_written       = 300,
+        .start_time          = { .tv_sec = 10, .tv_nsec = 0 },
+        .end_time            = { .tv_sec = 12, .tv_nsec = 500 },
+    };
+
+    metrics_init(&metrics, 1);
+    vl = metrics_vl_get(&metrics, 0);
+
+    conn_tcp_report_metrics(&conn_tcp, vl);
+    cr_assert(vl->tcp.keepalive_timeout == 1);
+    cr_assert(vl->tcp.conn_queries.count == 1);
+    cr_assert(vl->tcp.conn_queries.sum == 3);
+    cr_assert(vl->tcp.conn_bytes_read.sum == 90);
+    cr_assert(vl->tcp.conn_bytes_written.sum == 300);
+    cr_assert(vl->tcp.conn_duration.sum == 2000000500ULL);
+
+    conn_tcp.state = TCP_CONN_ST_HANDED_OFF;
+    conn_tcp_report_metrics(&conn_tcp, vl);
+    cr_assert(vl->tcp.conn_queries.count == 1);
+
+    metrics_clean(&metrics);
+}
+
+/** Test zones of zone databases get stable per zone metrics slots, and query
+ * of a counted zone is one increment of its counter.
+ */
+Test(metrics, test_metrics_zones) {
+    static const char *text =
+        "example.com. 3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "www.example.com. 60 IN A 192.0.2.10\n"
+        "example.net. 3600 IN SOA ns.example.net. admin.example.net. 1 7200 3600 1209600 300\n";
+    static const unsigned char main_view[1] = { 0 };
+    static const unsigned char view_a[2]    = { 1, 'a' };
+    metrics_t                metrics;
+    metrics_zone_counters_t *zones;
+    metrics_query_batch_t    batch = {0};
+    zone_db_t               *db[3];
+    char                     err[256] = {'\0'};
+    query_t                  q;
+
+    metrics_init(&metrics, 2);
+    cr_assert(metrics_zones_vl_get(&metrics, 0) == NULL);
+    metrics_zones_init(&metrics);
+    for (int i = 0; i < 3; i++) {
+        db[i] = zone_db_create(text, strlen(text), i + 1, err, sizeof(err));
+        cr_assert(db[i] != NULL, "%s", err);
+        cr_assert(db[i]->zones_count == 2);
+    }
+
+    metrics_zones_register(&metrics, main_view, db[0]);
+    cr_assert(db[0]->zone_slots[0] != 0 && db[0]->zone_slots[1] != 0);
+    cr_assert(db[0]->zone_slots[0] != db[0]->zone_slots[1]);
+
+    /* Zones keep their slots in next generation, views get slots of their
+     * own.
+     */
+    metrics_zones_register(&metrics, main_view, db[1]);
+    cr_assert(memcmp(db[0]->zone_slots, db[1]->zone_slots, 2 * sizeof(uint16_t)) == 0);
+    metrics_zones_register(&metrics, view_a, db[2]);
+    cr_assert(db[2]->zone_slots[0] != db[0]->zone_slots[0]);
+    cr_assert(db[2]->zone_slots[0] != db[0]->zone_slots[1]);
+
+    zones = metrics_zones_vl_get(&metrics, 1);
+    memset(&q, 0, sizeof(q));
+    q.end_code     = 3;
+    q.query_q_type = 1;
+    q.zone_slot    = db[1]->zone_slots[1];
+    query_report_metrics(&q, &batch, metrics_vl_get(&metrics, 1), NULL, zones, NULL);
+    cr_assert(zones[q.zone_slot - 1].queries[METRICS_RCODE_NXDOMAIN][RIP_NS_QTYPE_IDX_A] == 1);
+    cr_assert(metrics_zones_vl_get(&metrics, 0)[q.zone_slot - 1].
+              queries[METRICS_RCODE_NXDOMAIN][RIP_NS_QTYPE_IDX_A] == 0);
+
+    for (int i = 0; i < 3; i++) {
+        zone_db_release(db[i]);
+    }
+    metrics_clean(&metrics);
+    cr_assert(metrics.zones == NULL);
+}
+
+/** Test cost of timed queries is summed by protocol, path, rcode and type,
+ * and queries that are not timed are left out.
+ */
+Test(metrics, test_metrics_query_cost) {
+    metrics_t             metrics;
+    metrics_cost_t       *cost;
+    metrics_query_batch_t batch = {0};
+    query_t               q[3];
+
+    metrics_init(&metrics, 2);
+    cr_assert(metrics_cost_vl_get(&metrics, 1) == NULL);
+    metrics_cost_init(&metrics);
+    cr_assert(metrics.cost_cycles_per_sec > 0);
+    cost = metrics_cost_vl_get(&metrics, 1);
+
+    memset(q, 0, sizeof(q));
+    q[0].protocol     = 0;
+    q[0].end_code     = 0;
+    q[0].query_q_type = 1;
+    q[0].cost_sampled = true;
+    q[0].cost_cycles  = 1000;
+    q[1]              = q[0];
+    q[1].cost_cycles  = 200;
+    q[1].response_cached = true;
+    q[2]              = q[0];
+    q[2].cost_sampled = false;
+    for (int i = 0; i < 3; i++) {
+        query_report_metrics(&q[i], &batch, metrics_vl_get(&metrics, 1), NULL, NULL, cost);
+    }
+    q[0].protocol = 1;
+    q[0].end_code = 3;
+    q[0].edns.client_subnet.edns_cs_valid = 1;
+    q[0].response_slipped = true;
+    query_report_metrics(&q[0], &batch, metrics_vl_get(&metrics, 1), NULL, NULL, cost);
+
+    cr_assert(cost->queries[0][METRICS_COST_PLAIN][METRICS_RCODE_NOERROR][RIP_NS_QTYPE_IDX_A] == 1);
+    cr_assert(cost->cycles[0][METRICS_COST_PLAIN][METRICS_RCODE_NOERROR][RIP_NS_QTYPE_IDX_A] == 1000);
+    cr_assert(cost->queries[0][METRICS_COST_CACHED][METRICS_RCODE_NOERROR][RIP_NS_QTYPE_IDX_A] == 1);
+    cr_assert(cost->cycles[0][METRICS_COST_CACHED][METRICS_RCODE_NOERROR][RIP_NS_QTYPE_IDX_A] == 200);
+    cr_assert(cost->queries[1][METRICS_COST_TRUNCATED][METRICS_RCODE_NXDOMAIN][RIP_NS_QTYPE_IDX_A] == 1);
+    cr_assert(cost->queries[1][METRICS_COST_ECS][METRICS_RCODE_NXDOMAIN][RIP_NS_QTYPE_IDX_A] == 0);
+    cr_assert(metrics_cost_vl_get(&metrics, 0)->
+              queries[0][METRICS_COST_PLAIN][METRICS_RCODE_NOERROR][RIP_NS_QTYPE_IDX_A] == 0);
+
+    metrics_clean(&metrics);
+    cr_assert(metrics.cost == NULL);
+}
+
+/** @}*/
@@ -0,0 +1,166 @@
+/**
+ * @file test_metrics_loop.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup metrics_loop_ut Metrics export
+ *
+ * @brief Metrics export unit tests
+ *  @{
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "metrics.h"
+
+/**! @cond */
+TestSuite(metrics_loop);
+/**! @endcond */
+
+/** Test Prometheus text format sums vectorloop metrics and exports histograms. */
+Test(metrics_loop, test_metrics_export_prometheus) {
+    metrics_t  metrics;
+    char      *buf = NULL;
+    size_t     len;
+
+    metrics_init(&metrics, 2);
+    METRICS_ADD(metrics_vl_get(&metrics, 0)->udp.queries, 3);
+    METRICS_ADD(metrics_vl_get(&metrics, 1)->udp.queries, 4);
+    METRICS_INC(metrics_vl_get(&metrics, 1)->dns.queries_type[RIP_NS_QTYPE_IDX_AAAA]);
+    METRICS_ADD(metrics_vl_get(&metrics, 1)->udp.rxq_drops[1], 5);
+    histogram_record(&metrics_vl_get(&metrics, 0)->udp.recv_batch, 8);
+    histogram_record(&metrics_vl_get(&metrics, 1)->tcp.conn_queries, 20);
+    atomic_store(&metrics.app.resource_reload_error, 2);
+    histogram_record(&metrics_vl_get(&metrics, 0)->latency.total[1][3], 3000);
+    histogram_record(&metrics_vl_get(&metrics, 1)->latency.total[1][3], 5000000);
+
+    len = metrics_export_prometheus(&metrics, &buf);
+    cr_assert(len == strlen(buf));
+    cr_assert(strstr(buf, "# TYPE ripples_udp_queries_total counter\n"
+                          "ripples_udp_queries_total 7\n") != NULL);
+    cr_assert(strstr(buf, "ripples_dns_queries_type_total{type=\"AAAA\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_udp_rxq_drops_total{vl=\"1\",family=\"ipv6\"} 5\n") != NULL);
+    cr_assert(strstr(buf, "ripples_udp_recv_batch_datagrams_bucket{vl=\"0\",le=\"8\"} 0\n") != NULL);
+    cr_assert(strstr(buf, "ripples_udp_recv_batch_datagrams_bucket{vl=\"0\",le=\"16\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_tcp_conn_queries_bucket{vl=\"1\",le=\"32\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_tcp_conn_queries_count{vl=\"1\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_app_errors_total{reason=\"resource_reload\"} 2\n") != NULL);
+
+    /* Help and type are printed once per metric name. */
+    cr_assert(strstr(strstr(buf, "# TYPE ripples_tcp_closed_total") + 1,
+                     "# TYPE ripples_tcp_closed_total") == NULL);
+
+    /* Buckets are cumulative, 3us falls below 4.096us bound. */
+    cr_assert(strstr(buf, "ripples_query_latency_seconds_bucket{proto=\"tcp\","
+                          "rcode=\"nxdomain\",le=\"2.048e-06\"} 0\n") != NULL);
+    cr_assert(strstr(buf, "ripples_query_latency_seconds_bucket{proto=\"tcp\","
+                          "rcode=\"nxdomain\",le=\"4.096e-06\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_query_latency_seconds_bucket{proto=\"tcp\","
+                          "rcode=\"nxdomain\",le=\"+Inf\"} 2\n") != NULL);
+    cr_assert(strstr(buf, "ripples_query_latency_seconds_sum{proto=\"tcp\","
+                          "rcode=\"nxdomain\"} 0.005003000\n") != NULL);
+    cr_assert(strstr(buf, "ripples_query_latency_seconds_count{proto=\"tcp\","
+                          "rcode=\"nxdomain\"} 2\n") != NULL);
+    cr_assert(strstr(buf, "ripples_query_stage_latency_seconds_count{proto=\"udp\","
+                          "stage=\"pack_send\"} 0\n") != NULL);
+
+    free(buf);
+    metrics_clean(&metrics);
+}
+
+/** Test vectorloop stage metrics are exported per vectorloop, only when
+ * cycle counter frequency is set.
+ */
+Test(metrics_loop, test_metrics_export_prometheus_vl_stages) {
+    metrics_t     metrics;
+    metrics_vl_t *vl;
+    char         *buf = NULL;
+
+    metrics_init(&metrics, 2);
+    vl = metrics_vl_get(&metrics, 1);
+    METRICS_ADD(vl->loop.cycles_busy, 300);
+    METRICS_ADD(vl->loop.cycles_idle, 700);
+    histogram_record(&vl->loop.cycles[METRICS_VL_STAGE_UDP_READ], 100);
+    histogram_record(&vl->loop.items[METRICS_VL_STAGE_UDP_READ], 3);
+
+    metrics_export_prometheus(&metrics, &buf);
+    cr_assert(strstr(buf, "ripples_vl_") == NULL);
+    free(buf);
+
+    atomic_store(&metrics.cycles_per_sec, 1000000000);
+    metrics_export_prometheus(&metrics, &buf);
+    cr_assert(strstr(buf, "ripples_vl_cycles_per_second 1000000000\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_loop_cycles_total{vl=\"1\",state=\"busy\"} 300\n"
+                          "ripples_vl_loop_cycles_total{vl=\"1\",state=\"idle\"} 700\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_stage_cycles_bucket{vl=\"1\",stage=\"udp_read\","
+                          "le=\"64\"} 0\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_stage_cycles_bucket{vl=\"1\",stage=\"udp_read\","
+                          "le=\"128\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_stage_items_bucket{vl=\"1\",stage=\"udp_read\","
+                          "le=\"2\"} 0\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_stage_items_bucket{vl=\"1\",stage=\"udp_read\","
+                          "le=\"4\"} 1\n") != NULL);
+    cr_assert(strstr(buf, "ripples_vl_stage_items_count{vl=\"0\",stage=\"udp_read\"} 0\n") != NULL);
+
+    free(buf);
+    metrics_clean(&metrics);
+}
+
+/** Test binary snapshot header and counter layout. */
+Test(metrics_loop, test_metrics_export_snapshot) {
+    metrics_t                  metrics;
+    char                      *buf = NULL;
+    size_t                     len;
+    metrics_snapshot_header_t *hdr;
+    uint64_t                  *counters;
+
+    metrics_init(&metrics, 3);
+    METRICS_INC(metrics_vl_get(&metrics, 0)->tcp.connections);
+    METRICS_INC(metrics_vl_get(&metrics, 2)->tcp.connections);
+    atomic_store(&metrics.app.query_log_open_error, 9);
+    atomic_store(&metrics.app.worker_exit, 4);
+
+    len = metrics_export_snapshot(&metrics, &buf);
+    hdr = (metrics_snapshot_header_t *)buf;
+    cr_assert(hdr->magic == METRICS_SNAPSHOT_MAGIC);
+    cr_assert(hdr->version == METRICS_SNAPSHOT_VERSION);
+    cr_assert(hdr->header_len == sizeof(metrics_snapshot_header_t));
+    cr_assert(hdr->timestamp_ns > 0);
+    cr_assert(hdr->vl_count == 3);
+    cr_assert(hdr->counter_count == METRICS_VL_COUNTERS + METRICS_APP_COUNTERS);
+    cr_assert(len == hdr->header_len + hdr->counter_count * sizeof(uint64_t));
+
+    counters = (uint64_t *)(buf + hdr->header_len);
+    cr_assert(counters[offsetof(metrics_vl_t, tcp.connections) / sizeof(uint64_t)] == 2);
+    cr_assert(counters[hdr->counter_count - 2] == 9);
+    cr_assert(counters[hdr->counter_count - 1] == 4);
+
+    free(buf);
+    metrics_clean(&metrics);
+}
+
+/** @}*/
@@ -0,0 +1,103 @@
+/**
+ * @file test_mphf.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup mphf_ut Minimal Perfect Hash
+ *
+ * @brief Minimal perfect hash unit tests
+ *  @{
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <criterion/criterion.h>
+
+#include "mphf.h"
+
+/**! @cond */
+TestSuite(mphf);
+
+static uint64_t
+test_mphf_rand(uint64_t *state)
+{
+    *state += 0x9e3779b97f4a7c15ULL;
+    return mphf_mix(*state, 0x1234);
+}
+/**! @endcond */
+
+/** Test every key of set maps to a distinct slot below number of keys, and
+ * function initialized from seed and arrays maps keys the same way.
+ */
+Test(mphf, test_mphf_build) {
+    uint32_t counts[] = {0, 1, 2, 7, 1000, 100000};
+    uint64_t state    = 1;
+    mphf_t   f;
+    mphf_t   g;
+
+    for (int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint32_t  count  = counts[c];
+        uint64_t *keys   = malloc(sizeof(uint64_t) * (count + 1));
+        uint8_t  *seen   = calloc(count + 1, 1);
+        uint16_t *pilots = malloc(sizeof(uint16_t) * mphf_pilots_count(count));
+        uint32_t *remap  = malloc(sizeof(uint32_t) * mphf_remap_count(count));
+
+        for (uint32_t i = 0; i < count; i++) {
+            keys[i] = test_mphf_rand(&state);
+        }
+        cr_assert(mphf_build(&f, pilots, remap, keys, count) == 0, "%u", count);
+        mphf_init(&g, count, f.seed, pilots, remap);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t slot = mphf_lookup(&f, keys[i]);
+
+            cr_assert(slot < count, "%u %u %u", count, i, slot);
+            cr_assert(seen[slot] == 0, "%u %u %u", count, i, slot);
+            cr_assert(mphf_lookup(&g, keys[i]) == slot, "%u %u", count, i);
+            seen[slot] = 1;
+        }
+
+        /* Keys not in set map to some slot too. */
+        for (uint32_t i = 0; count > 0 && i < 1000; i++) {
+            cr_assert(mphf_lookup(&f, test_mphf_rand(&state)) < count, "%u", count);
+        }
+
+        free(keys);
+        free(seen);
+        free(pilots);
+        free(remap);
+    }
+}
+
+/** Test build of set with duplicate keys fails. */
+Test(mphf, test_mphf_build_duplicate) {
+    uint64_t keys[] = {1, 2, 3, 4, 5, 3};
+    uint16_t pilots[16];
+    uint32_t remap[16];
+    mphf_t   f;
+
+    cr_assert(mphf_pilots_count(6) <= 16);
+    cr_assert(mphf_remap_count(6) <= 16);
+    cr_assert(mphf_build(&f, pilots, remap, keys, 6) == -1);
+}
+
+/** @}*/
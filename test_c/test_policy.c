@@ -0,0 +1,157 @@
+/**
+ * @file test_policy.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup policy_ut Response Policy
+ *
+ * @brief Response policy unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "policy.h"
+
+/**! @cond */
+TestSuite(policy);
+
+static const char *test_policy_file =
+    "; test policy\n"
+    "ads.example.com\n"
+    "*.ads.example.com       nxdomain\n"
+    "*.example.com           NODATA   ; whole zone\n"
+    "www.example.com         passthru\n"
+    "\n"
+    "*.b.c.example.com       refuse\n"
+    "tracker.example.net     drop\n"
+    "tracker.example.net     passthru ; first listing is kept\n";
+
+/* Check name, -1 for action means name is expected not to match. */
+static void
+test_policy_check(policy_t *policy, const char *name, int action)
+{
+    unsigned char   wire[RIP_NS_MAXCDNAME + 1];
+    uint16_t        len;
+    policy_action_t a      = POLICY_ACTION_COUNT;
+    bool            match;
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    len   = rip_ns_name_lc(wire);
+    match = policy_check(policy, wire, len, rip_ns_name_hash(wire, len), &a);
+    cr_assert(match == (action >= 0), "%s match %d", name, match);
+    if (match) {
+        cr_assert((int)a == action, "%s action %d, expected %d", name, a, action);
+    }
+}
+/**! @endcond */
+
+/** Test exact name decides, otherwise longest matching wildcard does, and
+ * wildcard matches only names below its suffix.
+ */
+Test(policy, test_policy_check) {
+    char      err[256] = {'\0'};
+    policy_t *policy   = policy_create(test_policy_file, strlen(test_policy_file), 1,
+                                       err, sizeof(err));
+
+    cr_assert(policy != NULL, "%s", err);
+    cr_assert(policy->generation == 1);
+    cr_assert(policy->entries_count == 6);
+
+    test_policy_check(policy, "ads.example.com", POLICY_ACTION_NXDOMAIN);
+    test_policy_check(policy, "ADS.Example.COM", POLICY_ACTION_NXDOMAIN);
+    test_policy_check(policy, "x.y.ads.example.com", POLICY_ACTION_NXDOMAIN);
+    test_policy_check(policy, "foo.example.com", POLICY_ACTION_NODATA);
+    test_policy_check(policy, "www.example.com", POLICY_ACTION_PASSTHRU);
+    test_policy_check(policy, "a.www.example.com", POLICY_ACTION_NODATA);
+    test_policy_check(policy, "a.b.c.example.com", POLICY_ACTION_REFUSE);
+    test_policy_check(policy, "b.c.example.com", POLICY_ACTION_NODATA);
+    test_policy_check(policy, "tracker.example.net", POLICY_ACTION_DROP);
+
+    /* Wildcard does not match its suffix name itself. */
+    test_policy_check(policy, "example.com", -1);
+    test_policy_check(policy, "a.tracker.example.net", -1);
+    test_policy_check(policy, "example.org", -1);
+    test_policy_check(policy, ".", -1);
+    policy_release(policy);
+
+    /* Empty policy matches nothing. */
+    policy = policy_create("; nothing\n", 10, 2, err, sizeof(err));
+    cr_assert(policy != NULL, "%s", err);
+    test_policy_check(policy, "ads.example.com", -1);
+    policy_release(policy);
+}
+
+/** Test a large policy finds each of its names. */
+Test(policy, test_policy_check_many) {
+    char      err[256] = {'\0'};
+    size_t    size     = 100000 * 32;
+    char     *buf      = malloc(size);
+    size_t    len      = 0;
+    char      name[64];
+    policy_t *policy;
+
+    cr_assert(buf != NULL);
+    for (int i = 0; i < 100000; i++) {
+        len += snprintf(buf + len, size - len, "%sh%d.example.org %s\n",
+                        i % 2 ? "*." : "", i, i % 3 ? "nxdomain" : "drop");
+    }
+    policy = policy_create(buf, len, 1, err, sizeof(err));
+    cr_assert(policy != NULL, "%s", err);
+    cr_assert(policy->entries_count == 100000);
+    for (int i = 0; i < 100000; i++) {
+        snprintf(name, sizeof(name), "%sh%d.example.org", i % 2 ? "w." : "", i);
+        test_policy_check(policy, name, i % 3 ? POLICY_ACTION_NXDOMAIN : POLICY_ACTION_DROP);
+    }
+    test_policy_check(policy, "h1.example.org", -1);
+    test_policy_check(policy, "w.h0.example.org", -1);
+    policy_release(policy);
+    free(buf);
+}
+
+/** Test policy file errors. */
+Test(policy, test_policy_create_errors) {
+    char      err[256] = {'\0'};
+    policy_t *policy;
+
+    policy = policy_create("example.com block\n", 18, 1, err, sizeof(err));
+    cr_assert(policy == NULL);
+    cr_assert(strcmp(err, "line 1: invalid action \"block\"") == 0, "%s", err);
+
+    policy = policy_create("a.example.com\nb*.example.com\n", 29, 1, err, sizeof(err));
+    cr_assert(policy == NULL);
+    cr_assert(strcmp(err, "line 2: invalid name \"b*.example.com\"") == 0, "%s", err);
+
+    policy = policy_create("*. nxdomain\n", 12, 1, err, sizeof(err));
+    cr_assert(policy == NULL);
+    cr_assert(strstr(err, "line 1: invalid name") != NULL, "%s", err);
+
+    policy = policy_create("a.example.com drop extra\n", 25, 1, err, sizeof(err));
+    cr_assert(policy == NULL);
+    cr_assert(strcmp(err, "line 1: invalid format") == 0, "%s", err);
+}
+
+/** @}*/
@@ -0,0 +1,114 @@
+/**
+ * @file test_prefork.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup prefork_ut Worker processes
+ *
+ * @brief Worker processes unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "constants.h"
+#include "metrics.h"
+#include "prefork.h"
+#include "utils.h"
+
+/**! @cond */
+TestSuite(prefork);
+/**! @endcond */
+
+/** Test worker takes its CPU bindings and gets its own query log names. */
+Test(prefork, test_prefork_worker_config) {
+    config_t cfg;
+
+    config_init(&cfg);
+    cfg.process_thread_count = 2;
+    cfg.process_workers      = 2;
+    cfg.process_thread_masks = realloc(cfg.process_thread_masks, sizeof(size_t) * 4);
+    cr_assert(cfg.process_thread_masks != NULL);
+    for (size_t i = 0; i < 4; i++) {
+        cfg.process_thread_masks[i] = i + 1;
+    }
+    cfg.query_log_shm_path = strdup("/dev/shm/ripples");
+    free(cfg.admin_socket);
+    cfg.admin_socket = strdup("/run/ripples.sock");
+
+    prefork_worker_config(&cfg, 1);
+    cr_assert(cfg.process_worker_id == 1);
+    cr_assert(cfg.process_thread_masks[0] == 3);
+    cr_assert(cfg.process_thread_masks[1] == 4);
+    cr_assert_str_eq(cfg.query_log_base_name, CFG_DEFAULT_QUERY_LOG_BASE_NAME "_w1");
+    cr_assert_str_eq(cfg.query_log_shm_path, "/dev/shm/ripples_w1");
+    cr_assert_str_eq(cfg.admin_socket, "/run/ripples.sock_w1");
+
+    config_clean(&cfg);
+}
+
+/** Test worker updates metrics master sees, and worker that exits right
+ * after start is restarted after backoff with its memory gauges reset.
+ */
+Test(prefork, test_prefork_reap) {
+    config_t   cfg;
+    prefork_t  p;
+    metrics_t *metrics = metrics_new_shared(2);
+    uint64_t   now_ms  = utl_clock_monotonic_ms_fatal();
+    pid_t      pid;
+
+    config_init(&cfg);
+    cfg.process_workers      = 2;
+    cfg.process_thread_masks = realloc(cfg.process_thread_masks, sizeof(size_t) * 2);
+    cr_assert(cfg.process_thread_masks != NULL);
+    cfg.process_thread_masks[1] = 0;
+    prefork_init(&p, &cfg, metrics);
+    atomic_store(&metrics_vl_get(metrics, 1)->mem.bytes[0], 100);
+
+    pid = prefork_spawn(&p, 1, now_ms);
+    if (pid == 0) {
+        /* Worker. */
+        METRICS_INC(metrics_vl_get(metrics, cfg.process_worker_id)->udp.queries);
+        _exit(3);
+    }
+    cr_assert(pid > 0);
+    cr_assert(p.workers[1].pid == pid);
+    cr_assert(p.workers[0].pid == -1);
+
+    while (prefork_reap(&p, now_ms) != 0) {
+        usleep(1000);
+    }
+    cr_assert(p.workers[1].pid == -1);
+    cr_assert(p.workers[1].restart_ms == now_ms + PREFORK_RESTART_BACKOFF_MS);
+    cr_assert(atomic_load(&metrics->app.worker_exit) == 1);
+    cr_assert(metrics_vl_get(metrics, 1)->udp.queries == 1);
+    cr_assert(metrics_vl_get(metrics, 1)->mem.bytes[0] == 0);
+
+    prefork_clean(&p);
+    config_clean(&cfg);
+}
+
+/** @}*/
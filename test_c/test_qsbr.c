@@ -0,0 +1,173 @@
+/**
+ * @file test_qsbr.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup qsbr_ut QSBR
+ *
+ * @brief Quiescent state based reclamation unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "qsbr.h"
+
+/**! @cond */
+TestSuite(qsbr);
+
+#define TEST_QSBR_READERS 3
+#define TEST_QSBR_UPDATES 2000
+#define TEST_QSBR_ALIVE   0x5a5a5a5a
+
+typedef struct test_qsbr_obj_s {
+    volatile uint32_t magic;
+} test_qsbr_obj_t;
+
+typedef struct test_qsbr_shared_s {
+    qsbr_t                   qsbr;
+    _Atomic(test_qsbr_obj_t *) obj;
+    atomic_bool              done;
+    atomic_int               errors;
+} test_qsbr_shared_t;
+
+typedef struct test_qsbr_reader_arg_s {
+    test_qsbr_shared_t *shared;
+    size_t              id;
+} test_qsbr_reader_arg_t;
+
+static void *
+test_qsbr_reader(void *arg)
+{
+    test_qsbr_reader_arg_t *r = arg;
+    test_qsbr_shared_t     *s = r->shared;
+    unsigned long           i = 0;
+
+    qsbr_online(&s->qsbr, r->id);
+    while (!atomic_load(&s->done)) {
+        test_qsbr_obj_t *obj = atomic_load_explicit(&s->obj, memory_order_acquire);
+
+        for (int j = 0; j < 16; j++) {
+            if (obj->magic != TEST_QSBR_ALIVE) {
+                atomic_fetch_add(&s->errors, 1);
+            }
+        }
+        qsbr_quiescent(&s->qsbr, r->id);
+
+        /* Go offline now and then, as an idle vectorloop does. */
+        if (++i % 64 == 0) {
+            qsbr_offline(&s->qsbr, r->id);
+            qsbr_online(&s->qsbr, r->id);
+        }
+    }
+    qsbr_offline(&s->qsbr, r->id);
+    return NULL;
+}
+
+static test_qsbr_obj_t *
+test_qsbr_obj_new(void)
+{
+    test_qsbr_obj_t *obj = malloc(sizeof(test_qsbr_obj_t));
+
+    cr_assert(obj != NULL);
+    obj->magic = TEST_QSBR_ALIVE;
+    return obj;
+}
+/**! @endcond */
+
+/** Test retired objects can be released only once all online readers passed
+ * a quiescent state.
+ */
+Test(qsbr, test_qsbr_passed) {
+    qsbr_t   qsbr;
+    uint64_t epoch;
+
+    qsbr_init(&qsbr, TEST_QSBR_READERS);
+
+    /* Offline readers do not hold back release. */
+    cr_assert(qsbr_passed(&qsbr, qsbr_retire(&qsbr)));
+
+    qsbr_online(&qsbr, 0);
+    qsbr_online(&qsbr, 1);
+    epoch = qsbr_retire(&qsbr);
+    cr_assert(!qsbr_passed(&qsbr, epoch));
+    qsbr_quiescent(&qsbr, 0);
+    cr_assert(!qsbr_passed(&qsbr, epoch));
+    qsbr_offline(&qsbr, 1);
+    cr_assert(qsbr_passed(&qsbr, epoch));
+
+    /* Reader coming online after retire does not hold it back. */
+    qsbr_online(&qsbr, 2);
+    cr_assert(qsbr_passed(&qsbr, epoch));
+
+    /* Quiescent state before retire does not count. */
+    qsbr_quiescent(&qsbr, 0);
+    qsbr_quiescent(&qsbr, 2);
+    epoch = qsbr_retire(&qsbr);
+    qsbr_quiescent(&qsbr, 0);
+    cr_assert(!qsbr_passed(&qsbr, epoch));
+    qsbr_quiescent(&qsbr, 2);
+    cr_assert(qsbr_passed(&qsbr, epoch));
+
+    qsbr_clean(&qsbr);
+}
+
+/** Test readers never see an object writer released while they run. */
+Test(qsbr, test_qsbr_threads) {
+    test_qsbr_shared_t     s;
+    test_qsbr_reader_arg_t args[TEST_QSBR_READERS];
+    pthread_t              threads[TEST_QSBR_READERS];
+
+    qsbr_init(&s.qsbr, TEST_QSBR_READERS);
+    atomic_init(&s.obj, test_qsbr_obj_new());
+    atomic_init(&s.done, false);
+    atomic_init(&s.errors, 0);
+    for (int i = 0; i < TEST_QSBR_READERS; i++) {
+        args[i] = (test_qsbr_reader_arg_t) {.shared = &s, .id = i};
+        cr_assert(pthread_create(&threads[i], NULL, test_qsbr_reader, &args[i]) == 0);
+    }
+
+    for (int i = 0; i < TEST_QSBR_UPDATES; i++) {
+        test_qsbr_obj_t *old   = atomic_exchange(&s.obj, test_qsbr_obj_new());
+        uint64_t         epoch = qsbr_retire(&s.qsbr);
+
+        while (!qsbr_passed(&s.qsbr, epoch)) {
+            sched_yield();
+        }
+        old->magic = 0;
+        free(old);
+    }
+
+    atomic_store(&s.done, true);
+    for (int i = 0; i < TEST_QSBR_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    cr_assert(atomic_load(&s.errors) == 0);
+    free(atomic_load(&s.obj));
+    qsbr_clean(&s.qsbr);
+}
+
+/** @}*/
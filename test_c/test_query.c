@@ -42,6 +42,7 @@
 
 #include "config.h"
 #include "query.h"
+#include "rip_ns_utils.h"
 
 /**! @cond */
 TestSuite(query);
@@ -88,8 +89,9 @@ Test(query, test_query_init_udp) {
     cr_assert(q.authority_section_count == 0);
     cr_assert(q.additional_section_count == 0);
     cr_assert(q.end_code == -1);
-    cr_assert(q.error_message[0] == '\0');
-    cr_assert(q.dnptrs[0] == (unsigned char *)q.response_hdr);
+    cr_assert(q.error == QUERY_ERR_NONE);
+    cr_assert(q.comp.msg == (unsigned char *)q.response_hdr);
+    cr_assert(q.comp.gen == 1 && q.comp.count == 0);
 
     query_clean(&q);
     config_clean(&cfg);
@@ -136,8 +138,8 @@ Test(query, test_query_init_tcp) {
     cr_assert(q.authority_section_count == 0);
     cr_assert(q.additional_section_count == 0);
     cr_assert(q.end_code == -1);
-    cr_assert(q.error_message[0] == '\0');
-    cr_assert(q.dnptrs[0] == (unsigned char *)q.response_hdr);
+    cr_assert(q.error == QUERY_ERR_NONE);
+    cr_assert(q.comp.msg == (unsigned char *)q.response_hdr);
 
     query_clean(&q);
     config_clean(&cfg);
@@ -164,9 +166,10 @@ ParameterizedTestParameters(query, test_query_reset)
 
             .response_buffer_len = 1,
 
-            .error_message[0] = 'a',
+            .error = QUERY_ERR_QNAME,
 
-            .dnptrs[0] = NULL,
+            .comp.gen   = 7,
+            .comp.count = 1,
 
             .answer_section_count     = 1,
             .authority_section_count  = 1,
@@ -199,10 +202,10 @@ ParameterizedTest(query_t *param, query, test_query_reset)
     uint16_t                 query_label_size    = param->query_label_size    = 14;
 
     unsigned char           *edns_raw_buf        = param->edns.edns_raw_buf   = (unsigned char *)0xf5;
-    uint8_t                  edns_extended_rcode = param->edns.extended_rcode = 2;
+    param->edns.extended_rcode = 2;
     uint8_t                  edns_version        = param->edns.version        = 1;
     uint16_t                 edns_udp_resp_len   = param->edns.udp_resp_len   = 128;
-    bool                     edns_dnssec         = param->edns.dnssec         = true;
+    param->edns.dnssec = true;
 
     unsigned char           *edns_cs_raw_buf     = param->edns.client_subnet.edns_cs_raw_buf = (unsigned char *)0xf6;
     uint16_t                 edns_cs_family      = param->edns.client_subnet.family          = 2;
@@ -230,17 +233,17 @@ ParameterizedTest(query_t *param, query, test_query_reset)
     query_reset(param);
 
     /* Assert parameters were reset. */
-    cr_assert(param->request_buffer_len == 0);
     cr_assert(param->query_label_len == 0);
     cr_assert(param->query_q_type == rip_ns_t_invalid);
     cr_assert(param->query_q_class == rip_ns_c_invalid);
     cr_assert(param->edns.edns_raw_buf_len == 0);
     cr_assert(param->edns.edns_valid == 0);
-    cr_assert(param->edns.client_subnet.edns_cs_raw_buf_len == 0);
+    cr_assert(param->edns.dnssec == false);
+    cr_assert(param->edns.extended_rcode == 0);
     cr_assert(param->edns.client_subnet.edns_cs_valid == 0);
     cr_assert(param->response_buffer_len == 0);
-    cr_assert(param->error_message[0] == '\0');
-    cr_assert(param->dnptrs[0] == (unsigned char *)param->response_hdr);
+    cr_assert(param->error == QUERY_ERR_NONE);
+    cr_assert(param->comp.gen == 8 && param->comp.count == 0);
     cr_assert(param->answer_section_count == 0);
     cr_assert(param->authority_section_count == 0);
     cr_assert(param->additional_section_count == 0);
@@ -252,21 +255,22 @@ ParameterizedTest(query_t *param, query, test_query_reset)
     cr_assert(local_ip == param->local_ip);
     cr_assert(request_buffer == param->request_buffer);
     cr_assert(request_buffer_size == param->request_buffer_size);
+    cr_assert(param->request_buffer_len == 1);
     cr_assert(request_hdr == param->request_hdr);
     cr_assert(query_label == param->query_label);
     cr_assert(query_label_size == param->query_label_size);
     cr_assert(edns_raw_buf == param->edns.edns_raw_buf);
-    cr_assert(edns_extended_rcode == param->edns.extended_rcode);
     cr_assert(edns_version == param->edns.version);
     cr_assert(edns_udp_resp_len == param->edns.udp_resp_len);
-    cr_assert(edns_dnssec == param->edns.dnssec);
     cr_assert(edns_cs_raw_buf == param->edns.client_subnet.edns_cs_raw_buf);
+    cr_assert(param->edns.client_subnet.edns_cs_raw_buf_len == 1);
     cr_assert(edns_cs_family == param->edns.client_subnet.family);
     cr_assert(edns_cs_source_mask == param->edns.client_subnet.source_mask);
     cr_assert(edns_cs_scope_mask == param->edns.client_subnet.scope_mask);
     cr_assert(response_buffer == param->response_buffer);
     cr_assert(response_buffer_size == param->response_buffer_size);
     cr_assert(response_hdr == param->response_hdr);
+    cr_assert(param->comp.msg == NULL);
     cr_assert(answer_section[0] == param->answer_section[0]);
     cr_assert(authority_section[0] == param->authority_section[0]);
     cr_assert(additional_section[0] == param->additional_section[0]);
@@ -319,6 +323,9 @@ struct test_params_query_tcp_response_buffer_increase {
     /** Initial size of buffer. */
     size_t size;
 
+    /** Set if query has a response buffer pool. */
+    bool pool;
+
     /** Size of buffer expected after increase. */
     size_t new_size;
 
@@ -330,24 +337,32 @@ struct test_params_query_tcp_response_buffer_increase {
 ParameterizedTestParameters(query, test_query_tcp_response_buffer_increase)
 {
     static struct test_params_query_tcp_response_buffer_increase params[] = {
-        /* fields represent: initial buffer size, result buffer size, func() return value. */
+        /* fields represent: initial buffer size, response buffer pool,
+         * result buffer size, func() return value.
+         */
+        {
+            .size = 1, .pool = true, .new_size = RIP_NS_UDP_MAXMSG, .ret = 0
+        },
+        {
+            .size = 514, .pool = true, .new_size = RIP_NS_UDP_MAXMSG, .ret = 0
+        },
         {
-            .size = 1, .new_size = RIP_NS_UDP_MAXMSG+1, .ret = 0
+            .size = RIP_NS_UDP_MAXMSG, .pool = true, .new_size = 2 * RIP_NS_UDP_MAXMSG, .ret = 0
         },
         {
-            .size = 2, .new_size = RIP_NS_UDP_MAXMSG+2, .ret = 0
+            .size = RIP_NS_UDP_MAXMSG + 1, .pool = true, .new_size = 2 * RIP_NS_UDP_MAXMSG, .ret = 0
         },
         {
-            .size = 512, .new_size = RIP_NS_UDP_MAXMSG+512, .ret = 0
+            .size = RIP_NS_MAXMSG, .pool = true, .new_size = RIP_NS_MAXMSG + 1, .ret = 0
         },
         {
-            .size = RIP_NS_UDP_MAXMSG, .new_size = RIP_NS_UDP_MAXMSG+RIP_NS_UDP_MAXMSG, .ret = 0
+            .size = RIP_NS_MAXMSG + 1, .pool = true, .new_size = RIP_NS_MAXMSG + 2, .ret = 0
         },
         {
-            .size = RIP_NS_MAXMSG, .new_size = RIP_NS_MAXMSG, .ret = -1
+            .size = RIP_NS_MAXMSG + 2, .pool = true, .new_size = RIP_NS_MAXMSG + 2, .ret = -1
         },
         {
-            .size = RIP_NS_MAXMSG-1, .new_size = RIP_NS_MAXMSG, .ret = 0
+            .size = 514, .pool = false, .new_size = 514, .ret = -1
         },
     };
 
@@ -359,8 +374,10 @@ ParameterizedTestParameters(query, test_query_tcp_response_buffer_increase)
 ParameterizedTest(struct test_params_query_tcp_response_buffer_increase *param,
                   query, test_query_tcp_response_buffer_increase)
 {
-    config_t cfg;
+    config_t   cfg;
+    buf_pool_t pool;
     config_init(&cfg);
+    buf_pool_init(&pool, RIP_NS_UDP_MAXMSG, RIP_NS_MAXMSG + 2, 1, MEM_TAG_TCP_BUFS);
 
     query_t q;
 
@@ -369,18 +386,208 @@ ParameterizedTest(struct test_params_query_tcp_response_buffer_increase *param,
 
     q.response_buffer = malloc(sizeof(unsigned char *) * param->size);
     q.response_buffer_size = param->size;
+    q.response_buffer_own = q.response_buffer;
+    q.response_buffer_own_size = q.response_buffer_size;
+    q.response_pool = param->pool ? &pool : NULL;
 
     int ret = query_tcp_response_buffer_increase(&q);
 
     cr_assert(ret == param->ret, "ret: %d, pret: %d", ret, param->ret);
+    cr_assert(q.response_buffer_size == param->new_size,
+              "q.response_buffer_size: %lu, param->new_size: %lu",
+              q.response_buffer_size, param->new_size);
     if (ret == 0) {
-        cr_assert(q.response_buffer_size == param->new_size,
-                  "q.response_buffer_size: %lu, param->new_size: %lu",
-                  q.response_buffer_size, param->new_size);
+        cr_assert(q.response_hdr == (rip_ns_header_t *)(q.response_buffer + 2));
+
+        /* Buffer goes back to pool, query goes back to buffer it owns. */
+        query_tcp_response_buffer_release(&q);
+        cr_assert(q.response_buffer == q.response_buffer_own);
+        cr_assert(q.response_buffer_size == param->size);
+        cr_assert(q.comp.msg == (unsigned char *)q.response_hdr);
     }
     
+    query_clean(&q);
+    buf_pool_clean(&pool);
+    config_clean(&cfg);
+}
+
+/** Unit test for @ref query_error_str. */
+Test(query, test_query_error_str) {
+    cr_assert_str_eq(query_error_str(QUERY_ERR_NONE), "");
+    cr_assert_str_eq(query_error_str(QUERY_ERR_QTYPE), "question type not supported");
+    cr_assert_str_eq(query_error_str(QUERY_ERR_EDNS_OPTION), "malformed EDNS option");
+    cr_assert_str_eq(query_error_str(QUERY_ERR_COUNT), "");
+    for (int e = QUERY_ERR_NONE + 1; e < QUERY_ERR_COUNT; e++) {
+        cr_assert_not_null(query_error_str(e));
+        cr_assert(query_error_str(e)[0] != '\0', "error: %d", e);
+    }
+}
+
+/** Unit test for @ref query_response_pack_keepalive. Option is appended to
+ * EDNS OPT RR of TCP response only if request carried it.
+ */
+Test(query, test_query_response_pack_keepalive) {
+    config_t       cfg;
+    query_t        q;
+    uint8_t        opt[] = { 0, 0, 41, 0x04, 0xd0, 0, 0, 0, 0, 0, 0 };
+    uint8_t        keepalive[] = { 0, 11, 0, 2, 0, 0 };
+    unsigned char *p;
+    size_t         len = sizeof(rip_ns_header_t) + sizeof(opt);
+
+    config_init(&cfg);
+    query_init(&q, &cfg, 1);
+    query_reset(&q);
+
+    memset(q.response_hdr, 0, sizeof(rip_ns_header_t));
+    memcpy((unsigned char *)q.response_hdr + sizeof(rip_ns_header_t), opt, sizeof(opt));
+    q.response_edns_offset = sizeof(rip_ns_header_t);
+    q.response_buffer_len  = len + 2;
+    rip_ns_put16(q.response_buffer, len);
+
+    /* Request did not carry option. */
+    cr_assert(query_response_pack_keepalive(&q, 0) == 0);
+    cr_assert(q.response_buffer_len == len + 2);
+
+    q.edns.tcp_keepalive = true;
+    cr_assert(query_response_pack_keepalive(&q, 0) == 0);
+    cr_assert(q.response_buffer_len == len + 2 + sizeof(keepalive));
+    cr_assert((q.response_buffer[0] << 8 | q.response_buffer[1]) == len + sizeof(keepalive));
+    p = (unsigned char *)q.response_hdr + sizeof(rip_ns_header_t);
+    cr_assert((p[sizeof(opt) - 2] << 8 | p[sizeof(opt) - 1]) == sizeof(keepalive));
+    cr_assert(memcmp(p + sizeof(opt), keepalive, sizeof(keepalive)) == 0);
+
+    /* Not sent over UDP. */
+    q.protocol = 0;
+    cr_assert(query_response_pack_keepalive(&q, 0) == 0);
+    cr_assert(q.response_buffer_len == len + 2 + sizeof(keepalive));
+    q.protocol = 1;
+
+    query_clean(&q);
+    config_clean(&cfg);
+}
+
+/** Unit test for @ref query_pack_edns. OPT RR template of DO bit is patched
+ * with UDP payload size and extended rcode, client subnet option follows it.
+ */
+Test(query, test_query_pack_edns) {
+    edns_t              edns = {};
+    struct sockaddr_in *sin  = (struct sockaddr_in *)&edns.client_subnet.ip;
+    uint8_t             buf[64];
+    uint8_t             opt[] = { 0, 0, 41, 0x04, 0xd0, 1, 0, 0x80, 0, 0, 0 };
+    uint8_t             cs[]  = { 0, 8, 0, 7, 0, 1, 24, 16, 192, 0, 2 };
+
+    /* No EDNS. */
+    cr_assert(query_pack_edns(buf, sizeof(buf), &edns) == 0);
+
+    edns.edns_valid     = true;
+    edns.udp_resp_len   = 1232;
+    edns.extended_rcode = 1;
+    edns.dnssec         = true;
+    cr_assert(query_pack_edns(buf, sizeof(buf), &edns) == sizeof(opt));
+    cr_assert(memcmp(buf, opt, sizeof(opt)) == 0);
+
+    edns.dnssec = false;
+    cr_assert(query_pack_edns(buf, sizeof(buf), &edns) == sizeof(opt));
+    cr_assert(buf[7] == 0);
+
+    edns.client_subnet = (edns_client_subnet_t) {
+        .edns_cs_valid = true,
+        .ip_decoded    = true,
+        .family        = 1,
+        .source_mask   = 24,
+        .scope_mask    = 16,
+    };
+    sin->sin_family      = AF_INET;
+    sin->sin_addr.s_addr = htonl(0xc0000201);
+    cr_assert(query_pack_edns(buf, sizeof(opt) + sizeof(cs) - 1, &edns) == -1);
+    cr_assert(query_pack_edns(buf, sizeof(buf), &edns) == sizeof(opt) + sizeof(cs));
+    cr_assert((buf[9] << 8 | buf[10]) == sizeof(cs));
+    cr_assert(memcmp(buf + sizeof(opt), cs, sizeof(cs)) == 0);
+}
+
+/** Unit test for @ref query_response_pack_truncated. Response holds request
+ * header and question only, with TC bit set.
+ */
+Test(query, test_query_response_pack_truncated) {
+    config_t cfg;
+    query_t  q;
+    uint8_t  buf[] = { 0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0,
+                       7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+                       0, 1, 0, 1 };
+
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+    query_reset(&q);
+    memcpy(q.request_buffer, buf, sizeof(buf));
+    q.request_buffer_len = sizeof(buf);
+    query_parse(&q);
+    cr_assert(q.end_code == rip_ns_r_rip_unknown);
+
+    query_response_pack_truncated(&q);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.response_buffer_len == sizeof(buf));
+    cr_assert(q.response_hdr->id == htons(0x1234));
+    cr_assert(q.response_hdr->qr == 1 && q.response_hdr->tc == 1);
+    cr_assert(q.response_hdr->rcode == rip_ns_r_noerror);
+    cr_assert(ntohs(q.response_hdr->qdcount) == 1);
+    cr_assert(q.response_hdr->ancount == 0 && q.response_hdr->arcount == 0);
+    cr_assert(memcmp((uint8_t *)q.response_hdr + sizeof(rip_ns_header_t),
+                     buf + sizeof(rip_ns_header_t),
+                     sizeof(buf) - sizeof(rip_ns_header_t)) == 0);
+
     query_clean(&q);
     config_clean(&cfg);
 }
 
+/** Test name packing with name compression table: suffixes are compressed
+ * against, rollback on failure and reset by generation.
+ */
+Test(query, test_query_name_pack_comp) {
+    unsigned char  msg[64] = {0};
+    unsigned char *p       = msg + sizeof(rip_ns_header_t);
+    rip_ns_comp_t  comp;
+    int            len;
+
+    rip_ns_comp_init(&comp, msg);
+
+    /* www.example.com is packed in full, its three suffixes are recorded. */
+    len = rip_ns_name_put((unsigned char *)"www.example.com", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == 17, "len %d", len);
+    cr_assert(comp.count == 3);
+    p += len;
+
+    /* mail.example.com points at example.com. */
+    len = rip_ns_name_put((unsigned char *)"mail.example.com", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == 7, "len %d", len);
+    cr_assert(p[5] == RIP_NS_CMPRSFLGS && p[6] == 16);
+    cr_assert(comp.count == 4);
+    p += len;
+
+    /* Name already packed is a single pointer, found through a pointer. */
+    len = rip_ns_name_put((unsigned char *)"mail.example.com", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == 2 && p[0] == RIP_NS_CMPRSFLGS && p[1] == 29);
+    p += len;
+
+    /* Comparison is exact, names differing in case are not compressed. */
+    len = rip_ns_name_put((unsigned char *)"EXAMPLE.com", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == 10 && p[8] == RIP_NS_CMPRSFLGS && p[9] == 24);
+    p += len;
+
+    /* Name that does not fit leaves table as it was. */
+    len = rip_ns_name_put((unsigned char *)"longer.name.org", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == -1);
+    cr_assert(comp.count == 5);
+    len = rip_ns_name_put((unsigned char *)"name.org", p, msg + sizeof(msg) - p, &comp);
+    cr_assert(len == 10, "len %d", len);
+
+    /* Reset empties table. */
+    rip_ns_comp_reset(&comp);
+    cr_assert(comp.gen == 2 && comp.count == 0);
+    p = msg + sizeof(rip_ns_header_t);
+    cr_assert(rip_ns_name_put((unsigned char *)"mail.example.com", p, 64, &comp) == 18);
+
+    /* Without table name is not compressed. */
+    cr_assert(rip_ns_name_put((unsigned char *)"mail.example.com", p, 64, NULL) == 18);
+}
+
 /** @}*/
@@ -0,0 +1,455 @@
+/**
+ * @file test_query_log.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_ut
+ * \defgroup query_log_ut Query Log
+ *
+ * @brief Query log unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "query.h"
+
+/**! @cond */
+TestSuite(query_log);
+/**! @endcond */
+
+/** Test query logged as binary record is converted to same text entry. */
+Test(query_log, test_query_log_record_to_text) {
+    query_t                  q          = { };
+    struct sockaddr_storage  client_ss  = { };
+    struct sockaddr_storage  local_ss   = { };
+    struct sockaddr_in      *client_sin = (struct sockaddr_in *)&client_ss;
+    struct sockaddr_in      *local_sin  = (struct sockaddr_in *)&local_ss;
+    rip_ns_header_t          hdr        = { };
+    unsigned char            label[]    = "www.example.com.";
+    unsigned char            rr_name[]  = "www.example.com.";
+    uint8_t                  rr_rdata[] = { 192, 0, 2, 10 };
+    rr_record_t              rr         = {
+                                              .name      = rr_name,
+                                              .name_len  = strlen((char *)rr_name),
+                                              .type      = rip_ns_t_a,
+                                              .class     = rip_ns_c_in,
+                                              .ttl       = 60,
+                                              .rdata_len = sizeof(rr_rdata),
+                                              .rdata     = rr_rdata,
+                                          };
+    char                     rec[1024];
+    char                    *text = malloc(QUERY_LOG_BUF_MIN_SPACE);
+    int                      rec_len;
+    int                      text_len;
+    uint32_t                 len;
+
+    client_sin->sin_family = AF_INET;
+    client_sin->sin_port   = htons(5353);
+    inet_pton(AF_INET, "192.0.2.99", &client_sin->sin_addr);
+    local_sin->sin_family  = AF_INET;
+    local_sin->sin_port    = htons(53);
+    inet_pton(AF_INET, "192.0.2.1", &local_sin->sin_addr);
+    hdr.rd = 1;
+
+    q.client_ip            = &client_ss;
+    q.local_ip             = &local_ss;
+    q.request_hdr          = &hdr;
+    q.query_label          = label;
+    q.query_label_len      = strlen((char *)label);
+    q.query_q_type         = rip_ns_t_a;
+    q.query_q_class        = rip_ns_c_in;
+    q.answer_section[0]    = &rr;
+    q.answer_section_count = 1;
+    q.end_code             = rip_ns_r_noerror;
+
+    /* Not enough room for record. */
+    cr_assert(query_log(rec, sizeof(query_log_record_t), &q) == 0);
+
+    rec_len = query_log(rec, sizeof(rec), &q);
+    memcpy(&len, rec, sizeof(len));
+    cr_assert(rec_len == len);
+    cr_assert(rec_len == sizeof(query_log_record_t) + q.query_label_len +
+                         sizeof(query_log_record_rr_t) + rr.name_len + sizeof(rr_rdata));
+
+    /* Record is copied, so text does not depend on query once logged. */
+    memset(label, 'x', q.query_label_len);
+    memset(rr_rdata, 0, sizeof(rr_rdata));
+
+    /* Not enough room for text. */
+    cr_assert(query_log_record_to_text(rec, text, QUERY_LOG_BUF_MIN_SPACE - 1) == 0);
+
+    text_len = query_log_record_to_text(rec, text, QUERY_LOG_BUF_MIN_SPACE);
+    cr_assert(text_len > 0);
+    cr_assert(text[text_len - 1] == '\n');
+    text[text_len] = '\0';
+    cr_assert(strncmp(text, "{\"c_ip\":\"192.0.2.99\",\"c_port\":\"5353\","
+                            "\"l_ip\":\"192.0.2.1\",\"l_port\":\"53\",", 64) == 0);
+    cr_assert(strstr(text, "\"request\":{\"rd\":\"1\",\"tc\":\"0\",\"opcode\":\"query\","
+                           "\"q_name\":\"www.example.com.\",\"q_class\":\"IN\","
+                           "\"q_type\":\"A\"}") != NULL);
+    cr_assert(strstr(text, ",\"response\":{\"answer\":[{\"name\":\"www.example.com.\","
+                           "\"class\":\"IN\",\"type\":\"A\",\"rdata\":\"192.0.2.10\"}]}}\n") != NULL);
+
+    free(text);
+}
+
+/** Test query log ring hands chunks from vectorloop to query log thread in
+ * order, and keeps active chunk when ring is full.
+ */
+Test(query_log, test_query_log_ring) {
+    query_log_t        ql;
+    query_log_chunk_t *chunk;
+    char              *first;
+
+    query_log_init(&ql, 64, 3);
+
+    /* Nothing logged, nothing to publish. */
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(query_log_peek(&ql) == NULL);
+
+    first = ql.buf;
+    ql.buf_len = 10;
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(ql.buf != first);
+    cr_assert(ql.buf_len == 0);
+    ql.buf_len = 20;
+    cr_assert(query_log_publish(&ql) == true);
+
+    /* Two chunks published, third is active, ring is full. */
+    ql.buf_len = 30;
+    cr_assert(query_log_publish(&ql) == false);
+    cr_assert(ql.buf_len == 30);
+
+    chunk = query_log_peek(&ql);
+    cr_assert(chunk != NULL);
+    cr_assert(chunk->buf == first);
+    cr_assert(chunk->len == 10);
+    /* Peek does not consume. */
+    cr_assert(query_log_peek(&ql) == chunk);
+    query_log_consume(&ql);
+
+    /* Chunk handed back, active chunk can be published again. */
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(ql.buf == first);
+    cr_assert(query_log_peek(&ql)->len == 20);
+    query_log_consume(&ql);
+    cr_assert(query_log_peek(&ql)->len == 30);
+    query_log_consume(&ql);
+    cr_assert(query_log_peek(&ql) == NULL);
+}
+
+/** Write a fake record of given length and fill byte to query log spill
+ * buffer, as @ref query_log_spill would.
+ */
+static void
+test_query_log_spill_rec(query_log_t *ql, uint32_t len, char fill, uint64_t now)
+{
+    if (ql->spill_len == 0) {
+        ql->spill_time = now;
+    }
+    memset(ql->spill + ql->spill_len, fill, len);
+    memcpy(ql->spill + ql->spill_len, &len, sizeof(len));
+    ql->spill_len += len;
+}
+
+/** Test records spilled while query log ring is full are moved to ring in
+ * order as chunks are handed back, and are dropped once older than age
+ * bound.
+ */
+Test(query_log, test_query_log_spill) {
+    query_log_t        ql;
+    query_log_chunk_t *chunk;
+    size_t             aged;
+
+    query_log_init(&ql, 64, 2);
+    query_log_spill_init(&ql, 256);
+    cr_assert(query_log_backlogged(&ql) == false);
+
+    /* One chunk published, active chunk is last one, ring is full. */
+    ql.buf_len = 60;
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(query_log_backlogged(&ql) == true);
+    ql.buf_len = 60;
+
+    test_query_log_spill_rec(&ql, 40, 'a', 100);
+    test_query_log_spill_rec(&ql, 40, 'b', 100);
+    test_query_log_spill_rec(&ql, 40, 'c', 100);
+
+    /* Nothing fits, nothing is moved. */
+    cr_assert(query_log_spill_drain(&ql, 200, 0, &aged) == 0);
+    cr_assert(aged == 0 && ql.spill_len == 120 && ql.spill_offset == 0);
+
+    /* Chunk handed back, active chunk is published and spilled records
+     * follow it up to when ring is full again.
+     */
+    query_log_consume(&ql);
+    cr_assert(query_log_spill_drain(&ql, 200, 0, &aged) == 1);
+    cr_assert(ql.buf_len == 40 && ql.buf[sizeof(uint32_t)] == 'a');
+    cr_assert(ql.spill_offset == 40);
+    cr_assert(query_log_peek(&ql)->len == 60);
+    query_log_consume(&ql);
+
+    cr_assert(query_log_spill_drain(&ql, 200, 0, &aged) == 1);
+    chunk = query_log_peek(&ql);
+    cr_assert(chunk->len == 40 && chunk->buf[sizeof(uint32_t)] == 'a');
+    cr_assert(ql.buf_len == 40 && ql.buf[sizeof(uint32_t)] == 'b');
+    cr_assert(ql.spill_offset == 80);
+    query_log_consume(&ql);
+
+    /* Oldest spilled record is past age bound, rest is dropped. */
+    cr_assert(query_log_spill_drain(&ql, 1200, 1000, &aged) == 0);
+    cr_assert(aged == 1);
+    cr_assert(ql.spill_len == 0 && ql.spill_offset == 0);
+    cr_assert(ql.buf_len == 40);
+
+    for (size_t i = 0; i < ql.chunk_count; i++) {
+        free(ql.chunks[i].buf);
+    }
+    free(ql.chunks);
+    free(ql.spill);
+}
+
+/** Test query log ring mapped from shared memory is read by an external
+ * reader mapping same file: published chunks, overruns of an attached reader
+ * that fell behind, drops and close.
+ */
+Test(query_log, test_query_log_shm) {
+    char             path[] = "/tmp/test_query_log_shm_XXXXXX";
+    char             err[256];
+    query_log_t      ql;
+    query_log_shm_t *shm;
+    struct stat      st;
+    char            *map;
+    int              fd     = mkstemp(path);
+
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(query_log_init_shm(&ql, path, 7, 64, 3, err, sizeof(err)) == 0);
+
+    /* Reader maps file on its own. */
+    fd = open(path, O_RDWR);
+    cr_assert(fd >= 0);
+    cr_assert(fstat(fd, &st) == 0);
+    cr_assert((size_t)st.st_size == ql.shm_len);
+    map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    cr_assert(map != MAP_FAILED);
+    close(fd);
+    shm = (query_log_shm_t *)map;
+    cr_assert(shm->magic == QUERY_LOG_SHM_MAGIC);
+    cr_assert(shm->version == QUERY_LOG_SHM_VERSION);
+    cr_assert(shm->vl_id == 7 && shm->chunk_count == 3 && shm->buf_size == 64);
+    cr_assert(shm->data_offset % sysconf(_SC_PAGESIZE) == 0);
+    cr_assert(shm->chunks[0].seq == 1 && shm->head == 0);
+
+    /* Records are written to the mapping, no copy is made. */
+    memcpy(ql.buf, "first", 5);
+    ql.buf_len = 5;
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(shm->head == 1);
+    cr_assert(shm->chunks[0].seq == 2 && shm->chunks[0].len == 5);
+    cr_assert(memcmp(map + shm->data_offset, "first", 5) == 0);
+    cr_assert(shm->chunks[1].seq == 3);
+
+    /* No reader attached, no overruns counted as chunks are reused. */
+    for (int i = 0; i < 4; i++) {
+        query_log_consume(&ql);
+        ql.buf_len = 1;
+        cr_assert(query_log_publish(&ql) == true);
+    }
+    cr_assert(shm->head == 5 && shm->overruns == 0);
+
+    /* Reader consumed 3 chunks, chunk 3 is reused for chunk 6 unread. */
+    shm->reader = 3;
+    query_log_consume(&ql);
+    ql.buf_len = 1;
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(shm->overruns == 1);
+    cr_assert(shm->chunks[6 % 3].seq == 2 * 6 + 1);
+    shm->reader = 6;
+    query_log_consume(&ql);
+    ql.buf_len = 1;
+    cr_assert(query_log_publish(&ql) == true);
+    cr_assert(shm->overruns == 1);
+
+    query_log_drop(&ql);
+    cr_assert(shm->drops == 1);
+    cr_assert(shm->closed == 0);
+    query_log_close(&ql);
+    cr_assert(shm->closed == 1);
+
+    munmap(map, st.st_size);
+    munmap(ql.shm, ql.shm_len);
+    free(ql.chunks);
+    unlink(path);
+
+    /* File can not be created. */
+    cr_assert(query_log_init_shm(&ql, "/nonexistent/qlog", 0, 64, 3, err,
+                                 sizeof(err)) == -1);
+}
+
+/** Test rcode filter, queries without response are matched by
+ * QUERY_LOG_RCODE_NORESPONSE bit.
+ */
+Test(query_log, test_query_log_filter_rcodes) {
+    config_t cfg;
+    query_t  q     = { .query_q_type = rip_ns_t_a };
+    uint32_t count = 0;
+
+    config_init(&cfg);
+    cfg.query_log_rcodes = 1U << rip_ns_r_servfail | QUERY_LOG_RCODE_NORESPONSE;
+
+    q.end_code = rip_ns_r_servfail;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.end_code = rip_ns_r_rip_unknown;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.end_code = rip_ns_r_rip_toolarge;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.end_code = rip_ns_r_noerror;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    q.end_code = rip_ns_r_nxdomain;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+
+    cfg.query_log_rcodes = 1U << rip_ns_r_nxdomain;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.end_code = rip_ns_r_rip_unknown;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+
+    config_clean(&cfg);
+}
+
+/** Test question type filter, types 64 and above only pass with all types
+ * logged.
+ */
+Test(query_log, test_query_log_filter_qtypes) {
+    config_t cfg;
+    query_t  q     = { .end_code = rip_ns_r_noerror };
+    uint32_t count = 0;
+
+    config_init(&cfg);
+    q.query_q_type = rip_ns_t_caa;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+
+    cfg.query_log_qtypes = (uint64_t)1 << rip_ns_t_a | (uint64_t)1 << rip_ns_t_aaaa;
+    q.query_q_type = rip_ns_t_a;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.query_q_type = rip_ns_t_aaaa;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.query_q_type = rip_ns_t_mx;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    q.query_q_type = rip_ns_t_any;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    q.query_q_type = rip_ns_t_caa;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+
+    /* Type 64 must not wrap around onto type 0 bit. */
+    cfg.query_log_qtypes = 1;
+    q.query_q_type = 64;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+
+    config_clean(&cfg);
+}
+
+/** Test errors only filter drops NOERROR queries, unless latency threshold
+ * is set, in which case NOERROR queries slower than it are logged.
+ */
+Test(query_log, test_query_log_filter_errors_latency) {
+    config_t cfg;
+    query_t  q     = {
+        .query_q_type = rip_ns_t_a,
+        .end_code     = rip_ns_r_noerror,
+        .start_time   = { .tv_sec = 10, .tv_nsec = 0 },
+        .end_time     = { .tv_sec = 10, .tv_nsec = 2000000 },
+    };
+    uint32_t count = 0;
+
+    config_init(&cfg);
+    cfg.query_log_errors_only = true;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    q.end_code = rip_ns_r_refused;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    q.end_code = rip_ns_r_rip_unknown;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+
+    /* 2 ms query, latency threshold decides over errors only. */
+    q.end_code                = rip_ns_r_noerror;
+    cfg.query_log_latency_min = 1000;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    cfg.query_log_latency_min = 2000;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    cfg.query_log_latency_min = 2001;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    cfg.query_log_errors_only = false;
+    cr_assert(query_log_filter(&cfg, &q, &count) == false);
+
+    /* Errors are logged regardless of latency. */
+    q.end_code = rip_ns_r_servfail;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+
+    config_clean(&cfg);
+}
+
+/** Test sampling logs exactly one in query_log_sample_rate queries that pass
+ * filters, and filtered queries do not advance sample counter.
+ */
+Test(query_log, test_query_log_filter_sample) {
+    config_t cfg;
+    query_t  q      = { .query_q_type = rip_ns_t_a, .end_code = rip_ns_r_noerror };
+    uint32_t count  = 0;
+    int      logged = 0;
+
+    config_init(&cfg);
+    cfg.query_log_sample_rate = 4;
+    for (int i = 1; i <= 40; i++) {
+        bool pass = query_log_filter(&cfg, &q, &count);
+
+        cr_assert(pass == (i % 4 == 0), "query %d", i);
+        logged += pass;
+    }
+    cr_assert(logged == 10);
+
+    cfg.query_log_errors_only = true;
+    for (int i = 0; i < 8; i++) {
+        cr_assert(query_log_filter(&cfg, &q, &count) == false);
+    }
+    cr_assert(count == 0);
+
+    cfg.query_log_sample_rate = 1;
+    q.end_code                = rip_ns_r_servfail;
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+    cr_assert(query_log_filter(&cfg, &q, &count) == true);
+
+    config_clean(&cfg);
+}
+
+/** @}*/
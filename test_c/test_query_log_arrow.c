@@ -0,0 +1,263 @@
+/**
+ * @file test_query_log_arrow.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_ut
+ * \defgroup query_log_arrow_ut Query Log Arrow
+ *
+ * @brief Query log Arrow IPC unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "constants.h"
+#include "query.h"
+#include "query_log_arrow.h"
+
+/**! @cond */
+TestSuite(query_log_arrow);
+/**! @endcond */
+
+/** Read 32 bit number at position of FlatBuffer. */
+static uint32_t
+test_fb_u32(const char *fb, uint32_t pos)
+{
+    uint32_t v;
+
+    memcpy(&v, fb + pos, 4);
+    return v;
+}
+
+/** Get position of table field of FlatBuffer, 0 if field is absent. */
+static uint32_t
+test_fb_field(const char *fb, uint32_t table, int id)
+{
+    int32_t  soff;
+    uint16_t vt_len;
+    uint16_t off;
+
+    memcpy(&soff, fb + table, 4);
+    memcpy(&vt_len, fb + table - soff, 2);
+    if (4 + 2 * id >= vt_len) {
+        return 0;
+    }
+    memcpy(&off, fb + table - soff + 4 + 2 * id, 2);
+    return off == 0 ? 0 : table + off;
+}
+
+/** Get position of table, vector or string field of FlatBuffer refers to. */
+static uint32_t
+test_fb_deref(const char *fb, uint32_t table, int id)
+{
+    uint32_t pos = test_fb_field(fb, table, id);
+
+    return pos + test_fb_u32(fb, pos);
+}
+
+/** Check encapsulated message at buf, and get its FlatBuffer, header type and
+ * length.
+ * 
+ * @param buf         Message.
+ * @param header_type Populated with header type.
+ * @param header      Populated with position of header table in FlatBuffer.
+ * 
+ * @return            Returns length of message.
+ */
+static size_t
+test_message(const char *buf, uint8_t *header_type, uint32_t *header)
+{
+    const char *fb  = buf + 8;
+    uint32_t    msg = test_fb_u32(fb, 0);
+    int64_t     body_len;
+    int16_t     version;
+
+    cr_assert(test_fb_u32(buf, 0) == 0xffffffff);
+    cr_assert(test_fb_u32(buf, 4) % 8 == 0);
+    cr_assert(msg % 8 == 0);
+
+    memcpy(&version, fb + test_fb_field(fb, msg, 0), 2);
+    cr_assert(version == 4);
+    *header_type = fb[test_fb_field(fb, msg, 1)];
+    *header      = test_fb_deref(fb, msg, 2);
+    memcpy(&body_len, fb + test_fb_field(fb, msg, 3), 8);
+    cr_assert(body_len % 8 == 0);
+
+    return 8 + test_fb_u32(buf, 4) + body_len;
+}
+
+/** Test Schema message lists query log columns, with dictionary encoded
+ * address columns, and end-of-stream marker.
+ */
+Test(query_log_arrow, test_query_log_arrow_schema) {
+    char         buf[QUERY_LOG_ARROW_SCHEMA_MAX];
+    const char  *fb = buf + 8;
+    size_t       len;
+    uint8_t      header_type;
+    uint32_t     schema;
+    uint32_t     fields;
+    uint32_t     field;
+    uint32_t     name;
+
+    cr_assert(query_log_arrow_schema(buf, sizeof(buf) - 1) == 0);
+    len = query_log_arrow_schema(buf, sizeof(buf));
+    cr_assert(test_message(buf, &header_type, &schema) == len);
+    cr_assert(header_type == 1);
+
+    fields = test_fb_deref(fb, schema, 1);
+    cr_assert(test_fb_u32(fb, fields) == 15);
+
+    /* First field "time" is a Timestamp. */
+    field = fields + 4 + test_fb_u32(fb, fields + 4);
+    name  = test_fb_deref(fb, field, 0);
+    cr_assert(test_fb_u32(fb, name) == 4);
+    cr_assert(memcmp(fb + name + 4, "time", 5) == 0);
+    cr_assert(fb[test_fb_field(fb, field, 2)] == 10);
+    cr_assert(test_fb_field(fb, field, 4) == 0);
+
+    /* Third field "client_ip" is Utf8 with dictionary. */
+    field = fields + 12 + test_fb_u32(fb, fields + 12);
+    name  = test_fb_deref(fb, field, 0);
+    cr_assert(memcmp(fb + name + 4, "client_ip", 10) == 0);
+    cr_assert(fb[test_fb_field(fb, field, 2)] == 5);
+    cr_assert(test_fb_field(fb, field, 4) != 0);
+
+    cr_assert(query_log_arrow_eos(buf) == QUERY_LOG_ARROW_EOS_LEN);
+    cr_assert(memcmp(buf, "\xff\xff\xff\xff\0\0\0\0", 8) == 0);
+}
+
+/** Test records are encoded as dictionary batches, holding each distinct
+ * value once, followed by record batch.
+ */
+Test(query_log_arrow, test_query_log_arrow_batch) {
+    query_t                  q          = { };
+    struct sockaddr_storage  client_ss  = { };
+    struct sockaddr_storage  local_ss   = { };
+    struct sockaddr_in      *client_sin = (struct sockaddr_in *)&client_ss;
+    struct sockaddr_in      *local_sin  = (struct sockaddr_in *)&local_ss;
+    rip_ns_header_t          hdr        = { };
+    unsigned char            label[]    = "www.example.com.";
+    query_log_arrow_t       *a          = malloc(sizeof(query_log_arrow_t));
+    char                    *buf        = malloc(QUERY_LOG_TEXT_BUF_SIZE);
+    const char              *msg        = buf;
+    const char              *body;
+    char                     rec[1024];
+    size_t                   len;
+    uint8_t                  header_type;
+    uint32_t                 header;
+    uint32_t                 data;
+    uint32_t                 pos;
+    int64_t                  id;
+    int64_t                  rows;
+    int64_t                  offset;
+    int32_t                  offsets[3];
+
+    query_log_arrow_reset(a);
+
+    client_sin->sin_family = AF_INET;
+    client_sin->sin_port   = htons(5353);
+    inet_pton(AF_INET, "192.0.2.99", &client_sin->sin_addr);
+    local_sin->sin_family  = AF_INET;
+    local_sin->sin_port    = htons(53);
+    inet_pton(AF_INET, "192.0.2.1", &local_sin->sin_addr);
+    hdr.id = htons(0x1234);
+
+    q.client_ip       = &client_ss;
+    q.local_ip        = &local_ss;
+    q.request_hdr     = &hdr;
+    q.query_label     = label;
+    q.query_label_len = strlen((char *)label);
+    q.query_q_type    = rip_ns_t_a;
+    q.query_q_class   = rip_ns_c_in;
+    q.end_code        = rip_ns_r_noerror;
+
+    /* Two queries from one client, one from another. */
+    cr_assert(query_log(rec, sizeof(rec), &q) > 0);
+    cr_assert(query_log_arrow_add(a, rec) == 0);
+    cr_assert(query_log_arrow_add(a, rec) == 0);
+    inet_pton(AF_INET, "192.0.2.7", &client_sin->sin_addr);
+    q.query_q_type = rip_ns_t_aaaa;
+    cr_assert(query_log(rec, sizeof(rec), &q) > 0);
+    cr_assert(query_log_arrow_add(a, rec) == 0);
+    cr_assert(a->rows == 3);
+    cr_assert(a->id[0] == 0x1234);
+    cr_assert(a->client_ip[0] == 0 && a->client_ip[1] == 0 && a->client_ip[2] == 1);
+    cr_assert(a->local_ip[2] == 0);
+
+    /* Not enough room, batch is kept. */
+    cr_assert(query_log_arrow_batch(a, buf, 1024) == 0);
+    cr_assert(a->rows == 3);
+
+    len = query_log_arrow_batch(a, buf, QUERY_LOG_TEXT_BUF_SIZE);
+    cr_assert(len > 0);
+    cr_assert(a->rows == 0);
+
+    /* Dictionary batch of client addresses. */
+    msg += test_message(msg, &header_type, &header);
+    cr_assert(header_type == 2);
+    memcpy(&id, buf + 8 + test_fb_field(buf + 8, header, 0), 8);
+    cr_assert(id == 0);
+    data = test_fb_deref(buf + 8, header, 1);
+    memcpy(&rows, buf + 8 + test_fb_field(buf + 8, data, 0), 8);
+    cr_assert(rows == 2);
+    body = buf + 8 + test_fb_u32(buf, 4);
+    pos  = test_fb_deref(buf + 8, data, 2);
+    cr_assert(test_fb_u32(buf + 8, pos) == 3);
+    memcpy(&offset, buf + 8 + pos + 4 + 16, 8);
+    memcpy(offsets, body + offset, sizeof(offsets));
+    memcpy(&offset, buf + 8 + pos + 4 + 32, 8);
+    cr_assert(offsets[0] == 0 && offsets[1] == 10 && offsets[2] == 19);
+    cr_assert(memcmp(body + offset, "192.0.2.99192.0.2.7", 19) == 0);
+
+    /* Local address, qtype and rcode dictionaries. */
+    for (int i = 1; i < 4; i++) {
+        msg += test_message(msg, &header_type, &header);
+        cr_assert(header_type == 2);
+    }
+
+    /* Record batch, message ends batch. */
+    len -= msg - buf;
+    cr_assert(test_message(msg, &header_type, &header) == len);
+    cr_assert(header_type == 3);
+    memcpy(&rows, msg + 8 + test_fb_field(msg + 8, header, 0), 8);
+    cr_assert(rows == 3);
+
+    /* Full batch. */
+    for (int i = 0; i < QUERY_LOG_ARROW_BATCH_ROWS; i++) {
+        cr_assert(query_log_arrow_add(a, rec) == 0);
+    }
+    cr_assert(query_log_arrow_add(a, rec) == -1);
+    cr_assert(query_log_arrow_batch(a, buf, QUERY_LOG_TEXT_BUF_SIZE) > 0);
+    cr_assert(query_log_arrow_add(a, rec) == 0);
+
+    free(buf);
+    free(a);
+}
+
+/** @}*/
@@ -0,0 +1,103 @@
+/**
+ * @file xor_filter.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_ut
+ * \defgroup query_log_index_ut Query Log Index
+ *
+ * @brief Query log index unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "query_log_index.h"
+
+/**! @cond */
+TestSuite(query_log_index);
+/**! @endcond */
+
+/** Test question name hash ignores case and trailing dot. */
+Test(query_log_index, test_query_log_index_name_hash) {
+    uint64_t h = query_log_index_name_hash("www.example.com", 15);
+
+    cr_assert(query_log_index_name_hash("WWW.Example.COM", 15) == h);
+    cr_assert(query_log_index_name_hash("www.example.com.", 16) == h);
+    cr_assert(query_log_index_name_hash("www.example.org", 15) != h);
+    cr_assert(query_log_index_name_hash(".", 1) != query_log_index_name_hash("", 0));
+}
+
+/** Test block entry holds receive time range and names of its queries, and
+ * Bloom filter has no false negatives and few false positives.
+ */
+Test(query_log_index, test_query_log_index_entry) {
+    static query_log_index_entry_t e;
+    struct timespec                ts;
+    char                           name[64];
+    int                            len;
+    int                            fp = 0;
+
+    query_log_index_entry_reset(&e);
+    cr_assert(e.records == 0 && e.time_first == UINT64_MAX && e.time_last == 0);
+
+    for (int i = 0; i < 4096; i++) {
+        len = snprintf(name, sizeof(name), "n%d.example.com.", i);
+        ts  = (struct timespec){ .tv_sec = 1000 + i % 7, .tv_nsec = i };
+        query_log_index_entry_add(&e, name, len, &ts);
+    }
+    cr_assert(e.records == 4096);
+    cr_assert(e.time_first == 1000ULL * 1000000000 + 0);
+    cr_assert(e.time_last == 1006ULL * 1000000000 + 4094);
+
+    for (int i = 0; i < 4096; i++) {
+        len = snprintf(name, sizeof(name), "N%d.EXAMPLE.COM", i);
+        cr_assert(query_log_index_contain(&e, query_log_index_name_hash(name, len)));
+    }
+    for (int i = 0; i < 10000; i++) {
+        len = snprintf(name, sizeof(name), "m%d.example.com", i);
+        fp += query_log_index_contain(&e, query_log_index_name_hash(name, len));
+    }
+    cr_assert(fp < 500, "false positives: %d", fp);
+}
+
+/** Test index header is checked against layout in use. */
+Test(query_log_index, test_query_log_index_header) {
+    query_log_index_header_t h;
+
+    query_log_index_header_init(&h, true);
+    cr_assert(query_log_index_header_check(&h) == 0);
+    cr_assert(h.flags == QUERY_LOG_INDEX_F_COMPRESSED);
+
+    query_log_index_header_init(&h, false);
+    cr_assert(h.flags == 0);
+    h.version++;
+    cr_assert(query_log_index_header_check(&h) == -1);
+    query_log_index_header_init(&h, false);
+    h.entry_size--;
+    cr_assert(query_log_index_header_check(&h) == -1);
+}
+
+/** @}*/
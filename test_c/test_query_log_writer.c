@@ -0,0 +1,242 @@
+/**
+ * @file test_query_log_writer.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup query_ut
+ * \defgroup query_log_writer_ut Query Log Writer
+ *
+ * @brief Query log writer unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "config.h"
+#include "constants.h"
+#include "query_log_writer.h"
+
+/** Fill writer buffer with len bytes of text, last byte being a new line. */
+static void
+test_query_log_writer_fill(query_log_writer_buf_t *b, size_t len)
+{
+    memset(b->buf + b->len, 'x', len - 1);
+    b->buf[b->len + len - 1] = '\n';
+    b->len += len;
+}
+
+/**! @cond */
+TestSuite(query_log_writer);
+/**! @endcond */
+
+/** Test writer buffers are handed over in order, and none is handed out when
+ * all are waiting to be written.
+ */
+Test(query_log_writer, test_query_log_writer_ring) {
+    config_t                cfg = { .query_log_rotate_size = 1000 };
+    query_log_writer_t      w;
+    query_log_writer_buf_t *b;
+    query_log_writer_buf_t *first;
+
+    query_log_writer_init(&w, &cfg, NULL, NULL);
+
+    /* Empty buffer is not handed over. */
+    first = query_log_writer_buf_get(&w);
+    cr_assert(first != NULL);
+    query_log_writer_buf_submit(&w, true);
+    cr_assert(atomic_load(&w.head) == 0);
+    cr_assert(query_log_writer_buf_get(&w) == first);
+
+    for (int i = 0; i < QUERY_LOG_WRITER_BUF_COUNT; i++) {
+        b = query_log_writer_buf_get(&w);
+        cr_assert(b == &w.bufs[i]);
+        test_query_log_writer_fill(b, 300);
+        query_log_writer_buf_submit(&w, false);
+    }
+    cr_assert(atomic_load(&w.head) == QUERY_LOG_WRITER_BUF_COUNT);
+    cr_assert(query_log_writer_buf_get(&w) == NULL);
+
+    /* Rotation is requested after buffer that reaches rotate size. */
+    cr_assert(w.bufs[0].rotate == false);
+    cr_assert(w.bufs[2].rotate == false);
+    cr_assert(w.bufs[3].rotate == true);
+
+    /* Buffer written, it can be handed out again. */
+    atomic_store(&w.tail, 1);
+    b = query_log_writer_buf_get(&w);
+    cr_assert(b == first);
+    cr_assert(b->len == 0);
+
+    query_log_writer_clean(&w);
+}
+
+/** Test with O_DIRECT only whole blocks are handed over and rest of text is
+ * carried over to next buffer.
+ */
+Test(query_log_writer, test_query_log_writer_direct_io) {
+    config_t                cfg = {
+                                      .query_log_rotate_size = 1000000,
+                                      .query_log_direct_io   = true,
+                                  };
+    query_log_writer_t      w;
+    query_log_writer_buf_t *b;
+
+    query_log_writer_init(&w, &cfg, NULL, NULL);
+
+    /* Less than a block is not handed over unless flushed. */
+    b = query_log_writer_buf_get(&w);
+    test_query_log_writer_fill(b, 100);
+    query_log_writer_buf_submit(&w, false);
+    cr_assert(atomic_load(&w.head) == 0);
+
+    /* Text after last whole block is carried over. */
+    test_query_log_writer_fill(b, QUERY_LOG_DIRECT_IO_ALIGN);
+    query_log_writer_buf_submit(&w, false);
+    cr_assert(atomic_load(&w.head) == 1);
+    cr_assert(b->len == QUERY_LOG_DIRECT_IO_ALIGN);
+    cr_assert(w.carry_len == 100);
+
+    b = query_log_writer_buf_get(&w);
+    cr_assert(b == &w.bufs[1]);
+    cr_assert(b->len == 100);
+    cr_assert(b->buf[99] == '\n');
+
+    /* Flush pads last block with new lines. */
+    query_log_writer_buf_submit(&w, true);
+    cr_assert(atomic_load(&w.head) == 2);
+    cr_assert(b->len == QUERY_LOG_DIRECT_IO_ALIGN);
+    cr_assert(b->buf[100] == '\n');
+    cr_assert(b->buf[QUERY_LOG_DIRECT_IO_ALIGN - 1] == '\n');
+    cr_assert(w.carry_len == 0);
+
+    /* Text carried over is flushed with no buffer being filled. */
+    b = query_log_writer_buf_get(&w);
+    test_query_log_writer_fill(b, QUERY_LOG_DIRECT_IO_ALIGN + 100);
+    query_log_writer_buf_submit(&w, false);
+    cr_assert(atomic_load(&w.head) == 3);
+    cr_assert(query_log_writer_buf_pending(&w) == true);
+    query_log_writer_buf_submit(&w, true);
+    cr_assert(atomic_load(&w.head) == 4);
+    cr_assert(w.bufs[3].len == QUERY_LOG_DIRECT_IO_ALIGN);
+    cr_assert(w.bufs[3].buf[99] == '\n');
+    cr_assert(query_log_writer_buf_pending(&w) == false);
+
+    query_log_writer_clean(&w);
+}
+
+/** Test buffer is compressed into a gzip member that decompresses to same
+ * text, and that O_DIRECT is not used with compression.
+ */
+Test(query_log_writer, test_query_log_writer_compress) {
+    config_t                cfg = {
+                                      .query_log_rotate_size = 1000000,
+                                      .query_log_direct_io   = true,
+                                      .query_log_compress    = true,
+                                  };
+    query_log_writer_t      w;
+    query_log_writer_buf_t *b;
+    size_t                  zlen;
+    char                   *out = malloc(QUERY_LOG_TEXT_BUF_SIZE);
+    z_stream                zs  = { };
+
+    query_log_writer_init(&w, &cfg, NULL, NULL);
+    cr_assert(w.direct_io == false);
+
+    b = query_log_writer_buf_get(&w);
+    test_query_log_writer_fill(b, 10000);
+    zlen = query_log_writer_compress(&w, b->buf, b->len);
+    cr_assert(zlen > 0);
+    cr_assert(zlen < b->len);
+
+    /* Compressing again produces an independent member. */
+    cr_assert(query_log_writer_compress(&w, b->buf, b->len) == zlen);
+
+    cr_assert(inflateInit2(&zs, 15 + 16) == Z_OK);
+    zs.next_in   = (Bytef *)w.zbuf;
+    zs.avail_in  = zlen;
+    zs.next_out  = (Bytef *)out;
+    zs.avail_out = QUERY_LOG_TEXT_BUF_SIZE;
+    cr_assert(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    cr_assert(zs.total_out == b->len);
+    cr_assert(memcmp(out, b->buf, b->len) == 0);
+    inflateEnd(&zs);
+
+    free(out);
+    query_log_writer_clean(&w);
+}
+
+/** Test buffers spliced to file land in file in order, each after the other,
+ * and that splice is not used with O_DIRECT.
+ */
+Test(query_log_writer, test_query_log_writer_splice) {
+    config_t                cfg = {
+                                      .query_log_rotate_size = 1000000,
+                                      .query_log_splice      = true,
+                                  };
+    query_log_writer_t      w;
+    query_log_writer_buf_t *b;
+    char                    path[] = "/tmp/test_query_log_writer_XXXXXX";
+    char                    err_msg[ERR_MSG_LENGTH];
+    char                   *out = malloc(QUERY_LOG_TEXT_BUF_SIZE + 100);
+    int                     fd  = mkstemp(path);
+
+    cr_assert(fd > -1);
+    query_log_writer_init(&w, &cfg, NULL, NULL);
+    cr_assert(w.splice == true);
+
+    /* Whole buffer, more than default pipe size, then a short one. */
+    b = query_log_writer_buf_get(&w);
+    test_query_log_writer_fill(b, QUERY_LOG_TEXT_BUF_SIZE);
+    cr_assert(query_log_writer_splice(&w, fd, b->buf, b->len, err_msg,
+                                      ERR_MSG_LENGTH) == 0);
+    b->buf[0] = 'y';
+    cr_assert(query_log_writer_splice(&w, fd, b->buf, 100, err_msg,
+                                      ERR_MSG_LENGTH) == 0);
+    cr_assert(w.splice == true);
+    cr_assert(w.pipe_fds[0] > -1);
+
+    cr_assert(pread(fd, out, QUERY_LOG_TEXT_BUF_SIZE + 100, 0) ==
+              QUERY_LOG_TEXT_BUF_SIZE + 100);
+    cr_assert(out[0] == 'x');
+    cr_assert(out[QUERY_LOG_TEXT_BUF_SIZE - 1] == '\n');
+    cr_assert(out[QUERY_LOG_TEXT_BUF_SIZE] == 'y');
+    cr_assert(memcmp(out + QUERY_LOG_TEXT_BUF_SIZE + 1, b->buf + 1, 99) == 0);
+
+    query_log_writer_clean(&w);
+    cr_assert(w.pipe_fds[0] == -1);
+
+    cfg.query_log_direct_io = true;
+    query_log_writer_init(&w, &cfg, NULL, NULL);
+    cr_assert(w.splice == false);
+    query_log_writer_clean(&w);
+
+    close(fd);
+    unlink(path);
+    free(out);
+}
+
+/** @}*/
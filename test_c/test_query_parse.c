@@ -33,6 +33,8 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <time.h>
 
@@ -319,6 +321,62 @@ ParameterizedTestParameters(query, test_query_parse)
             .query_q_type    = rip_ns_t_a,
             .query_q_class   = rip_ns_c_in,
         },
+        /** Positive, IXFR IN example.com with client SOA in authority section */
+        {
+            .ut_index = 23,
+            .buf            = { 0x1f, 0xf9, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+                                0x00, 0x00, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+                                0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00, 0xfb, 0x00, 0x01, 0xc0,
+                                0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00 },
+            .buf_len         = 63,
+            .end_code        = rip_ns_r_rip_unknown,
+            .query_label     = "example.com",
+            .query_label_len = 11,
+            .query_q_type    = rip_ns_t_ixfr,
+            .query_q_class   = rip_ns_c_in,
+        },
+        /** Negative, authority section is only allowed in IXFR request */
+        {
+            .ut_index = 24,
+            .buf            = { 0x1f, 0xf9, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+                                0x00, 0x00, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+                                0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0,
+                                0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00 },
+            .buf_len         = 63,
+            .end_code        = rip_ns_r_formerr,
+        },
+        /** Positive, NOTIFY SOA IN example.com with new SOA in answer section */
+        {
+            .ut_index = 25,
+            .buf            = { 0x1f, 0xf9, 0x20, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+                                0x00, 0x00, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+                                0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00, 0x06, 0x00, 0x01, 0xc0,
+                                0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x00 },
+            .buf_len         = 63,
+            .end_code        = rip_ns_r_rip_unknown,
+            .query_label     = "example.com",
+            .query_label_len = 11,
+            .query_q_type    = rip_ns_t_soa,
+            .query_q_class   = rip_ns_c_in,
+        },
+        /** Negative, UPDATE opcode is not implemented */
+        {
+            .ut_index = 26,
+            .buf            = { 0x1f, 0xf9, 0x28, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+                                0x00, 0x00, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+                                0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00, 0x06, 0x00, 0x01 },
+            .buf_len         = 29,
+            .end_code        = rip_ns_r_notimpl,
+        },
     };
 
     size_t nb_params = sizeof(params) / sizeof(struct test_params_query_parse);
@@ -355,6 +413,246 @@ ParameterizedTest(struct test_params_query_parse *param, query,
     cr_assert(q.query_label_len == param->query_label_len);
     cr_assert(q.query_q_type == param->query_q_type);
     cr_assert(q.query_q_class == param->query_q_class);
+    cr_assert(q.notify == (q.request_hdr->opcode == rip_ns_o_notify));
+}
+
+/**! @cond */
+static void
+test_query_parse_fast_check(uint8_t *buf, uint16_t buf_len, bool fast)
+{
+    config_t cfg;
+    query_t  qf;
+    query_t  qg;
+
+    config_init(&cfg);
+    query_init(&qf, &cfg, 1);
+    query_init(&qg, &cfg, 1);
+    query_reset(&qf);
+    query_reset(&qg);
+
+    qf.request_buffer     = buf;
+    qf.request_buffer_len = buf_len;
+    qf.request_hdr        = (struct rip_ns_header_s *)buf;
+    qg.request_buffer     = buf;
+    qg.request_buffer_len = buf_len;
+    qg.request_hdr        = (struct rip_ns_header_s *)buf;
+
+    cr_assert(query_parse_fast(&qf) == fast);
+    if (!fast) {
+        cr_assert(qf.end_code == rip_ns_r_rip_unknown);
+        cr_assert(qf.query_label_len == 0);
+        goto END;
+    }
+
+    /* Fast path result matches generic parser. */
+    query_parse(&qg);
+    cr_assert(qf.end_code == qg.end_code);
+    cr_assert_str_eq((char *)qf.query_label, (char *)qg.query_label);
+    cr_assert(qf.query_label_len == qg.query_label_len);
+    cr_assert(qf.query_question_len == qg.query_question_len);
+    cr_assert(qf.query_q_type == qg.query_q_type);
+    cr_assert(qf.query_q_class == qg.query_q_class);
+    cr_assert(qf.query_qname_len == qg.query_qname_len);
+    cr_assert(memcmp(qf.query_qname, qg.query_qname, qf.query_qname_len) == 0);
+    cr_assert(qf.query_qname_hash == qg.query_qname_hash);
+    cr_assert(qf.edns.edns_valid == qg.edns.edns_valid);
+    if (qf.edns.edns_valid) {
+        cr_assert(qf.edns.udp_resp_len == qg.edns.udp_resp_len);
+        cr_assert(qf.edns.dnssec == qg.edns.dnssec);
+        cr_assert(qf.edns.edns_raw_buf_len == qg.edns.edns_raw_buf_len);
+    }
+
+END:
+    qf.request_buffer = NULL;
+    qg.request_buffer = NULL;
+    query_clean(&qf);
+    query_clean(&qg);
+    config_clean(&cfg);
+}
+/**! @endcond */
+
+/** Unit test for @ref query_parse_fast, requests of common shape are parsed
+ * same as @ref query_parse would, others are left to it.
+ */
+Test(query, test_query_parse_fast)
+{
+    /* Header, www.ExAmple.com, type and class appended below. */
+    uint8_t hdr[]  = { 0x1f, 0xf9, 0x01, 0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+                       0x00, 0x00 };
+    uint8_t name[] = { 0x03, 'w', 'w', 'w', 0x07, 'E', 'x', 'A', 'm', 'p', 'l', 'e',
+                       0x03, 'c', 'o', 'm', 0x00 };
+    uint8_t opt[]  = { 0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x80, 0x00, 0x00,
+                       0x00 };
+    uint8_t buf[RIP_NS_PACKETSZ];
+    uint16_t len;
+
+#define TEST_QPF_BUILD(qtype, with_opt) do {                                 \
+        len = 0;                                                             \
+        memcpy(buf, hdr, sizeof(hdr));                                       \
+        buf[11] = with_opt ? 1 : 0;                                          \
+        len += sizeof(hdr);                                                  \
+        memcpy(buf + len, name, sizeof(name));                               \
+        len += sizeof(name);                                                 \
+        buf[len++] = 0; buf[len++] = qtype; buf[len++] = 0; buf[len++] = 1;  \
+        if (with_opt) {                                                      \
+            memcpy(buf + len, opt, sizeof(opt));                             \
+            len += sizeof(opt);                                              \
+        }                                                                    \
+    } while (0)
+
+    /* A without EDNS, AAAA with EDNS and DO bit. */
+    TEST_QPF_BUILD(rip_ns_t_a, false);
+    test_query_parse_fast_check(buf, len, true);
+    TEST_QPF_BUILD(rip_ns_t_aaaa, true);
+    test_query_parse_fast_check(buf, len, true);
+
+    /* Other type. */
+    TEST_QPF_BUILD(rip_ns_t_mx, false);
+    test_query_parse_fast_check(buf, len, false);
+
+    /* Trailing byte. */
+    TEST_QPF_BUILD(rip_ns_t_a, false);
+    test_query_parse_fast_check(buf, len + 1, false);
+
+    /* Truncated question. */
+    test_query_parse_fast_check(buf, len - 1, false);
+
+    /* EDNS with option. */
+    TEST_QPF_BUILD(rip_ns_t_a, true);
+    buf[len - 1] = 4;
+    memset(buf + len, 0, 4);
+    test_query_parse_fast_check(buf, len + 4, false);
+
+    /* EDNS version 1 is answered BADVERS by generic parser. */
+    TEST_QPF_BUILD(rip_ns_t_a, true);
+    buf[len - 5] = 1;
+    test_query_parse_fast_check(buf, len, false);
+
+    /* Compression pointer in question name. */
+    TEST_QPF_BUILD(rip_ns_t_a, false);
+    buf[sizeof(hdr)] = 0xc0;
+    test_query_parse_fast_check(buf, len, false);
+
+    /* Response flag set. */
+    TEST_QPF_BUILD(rip_ns_t_a, false);
+    buf[2] |= 0x80;
+    test_query_parse_fast_check(buf, len, false);
+#undef TEST_QPF_BUILD
+}
+
+/** Test EDNS DO bit and extended rcode do not leak into next query parsed
+ * in same query slot, neither on fast path nor on generic parser, and
+ * extended rcode byte of request is not taken for EDNS version.
+ */
+Test(query, test_query_parse_edns_reuse)
+{
+    /* www.example.com A, OPT with DO bit and no options. */
+    uint8_t  req[] = { 0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+                       0x00, 0x01, 0x03, 'w', 'w', 'w', 0x07, 'e', 'x', 'a', 'm', 'p',
+                       'l', 'e', 0x03, 'c', 'o', 'm', 0x00, 0x00, 0x01, 0x00, 0x01,
+                       0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x80, 0x00, 0x00,
+                       0x00 };
+    /* Client cookie option appended to OPT. */
+    uint8_t  cookie[] = { 0x00, 0x0a, 0x00, 0x08, 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint16_t opt      = sizeof(req) - 11;
+    config_t cfg;
+    query_t  q;
+
+#define TEST_QPR_PARSE(do_bit, ext_rcode, with_cookie) do {                           query_reset(&q);                                                              memcpy(q.request_buffer, req, sizeof(req));                                   q.request_buffer[opt + 5]  = ext_rcode;                                       q.request_buffer[opt + 7]  = do_bit ? 0x80 : 0x00;                            q.request_buffer[opt + 10] = with_cookie ? sizeof(cookie) : 0;                q.request_buffer_len       = sizeof(req);                                     if (with_cookie) {                                                                memcpy(q.request_buffer + sizeof(req), cookie, sizeof(cookie));               q.request_buffer_len += sizeof(cookie);                                   }                                                                             query_parse(&q);                                                          } while (0)
+
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+
+    /* DO=1, then DO=0 with an option, which generic parser parses. */
+    TEST_QPR_PARSE(true, 0, false);
+    cr_assert(q.edns.edns_valid && q.edns.dnssec);
+    TEST_QPR_PARSE(false, 0, true);
+    cr_assert(q.end_code == rip_ns_r_rip_unknown);
+    cr_assert(q.edns.edns_valid && q.edns.cookie.edns_cookie_valid);
+    cr_assert(q.edns.dnssec == false);
+
+    /* Generic parser sets DO bit either way, not only when it is set. */
+    q.edns.dnssec = true;
+    query_parse(&q);
+    cr_assert(q.edns.dnssec == false);
+
+    /* Extended rcode byte of request is not EDNS version. */
+    TEST_QPR_PARSE(false, 1, true);
+    cr_assert(q.end_code == rip_ns_r_rip_unknown);
+    cr_assert(q.edns.version == 0);
+
+    /* Extended rcode of BADVERS response is not kept for next query. */
+    q.request_buffer[opt + 6] = 1;
+    query_reset(&q);
+    query_parse(&q);
+    cr_assert(q.end_code == rip_ns_r_badvers);
+    cr_assert(query_response_pack(&q) == 0);
+    cr_assert(q.edns.extended_rcode == 1);
+    TEST_QPR_PARSE(false, 0, true);
+    cr_assert(q.edns.extended_rcode == 0);
+
+    query_clean(&q);
+    config_clean(&cfg);
+#undef TEST_QPR_PARSE
+}
+
+/** Unit test for @ref query_parse_fast_headers, vector check of headers
+ * agrees with @ref query_parse_fast_header for every lane.
+ */
+Test(query, test_query_parse_fast_headers)
+{
+    uint8_t        hdr[] = { 0x1f, 0xf9, 0x01, 0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+                             0x00, 0x01 };
+    uint8_t        bufs[64][32];
+    query_t        queries[64];
+    struct mmsghdr read_vector[64];
+    uint64_t       expect;
+    uint64_t       bits;
+
+    srandom(1);
+    for (int round = 0; round < 64; round++) {
+        memset(queries, 0, sizeof(queries));
+        memset(read_vector, 0, sizeof(read_vector));
+        expect = 0;
+        for (int i = 0; i < 64; i++) {
+            /* Lanes start out valid, most get a random bit of header flipped
+             * or a length too short for a question.
+             */
+            memset(bufs[i], 0xa5, sizeof(bufs[i]));
+            memcpy(bufs[i], hdr, sizeof(hdr));
+            if (random() % 4 != 0) {
+                bufs[i][random() % sizeof(hdr)] ^= 1 << (random() % 8);
+            }
+            read_vector[i].msg_len        = random() % 8 != 0 ? 17 + random() % 8 : random() % 17;
+            queries[i].request_hdr        = (rip_ns_header_t *)bufs[i];
+            queries[i].request_buffer_len = read_vector[i].msg_len;
+            expect |= (uint64_t)query_parse_fast_header(&queries[i]) << i;
+        }
+        bits = query_parse_fast_headers(queries, read_vector, 64);
+        cr_assert(bits == expect, "round %d: %016lx != %016lx", round, bits, expect);
+
+        /* Lanes past count are not checked. */
+        bits = query_parse_fast_headers(queries, read_vector, 5);
+        cr_assert(bits == (expect & 0x1f));
+    }
+}
+
+/** Test query type dispatch table. */
+Test(query, test_query_qtype_table) {
+    cr_assert(rip_ns_qtype_get(rip_ns_t_a).flags == RIP_NS_QTYPE_F_SUPPORTED);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_a).idx == RIP_NS_QTYPE_IDX_A);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_any).flags & RIP_NS_QTYPE_F_ANY);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_axfr).flags & RIP_NS_QTYPE_F_XFR);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_ixfr).flags & RIP_NS_QTYPE_F_XFR);
+    cr_assert(rip_ns_qtype_get(0).flags == 0);
+    cr_assert(rip_ns_qtype_get(0).idx == RIP_NS_QTYPE_IDX_INVALID);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_hinfo).flags == 0);
+    cr_assert(rip_ns_qtype_get(rip_ns_t_hinfo).idx == RIP_NS_QTYPE_IDX_UNSUPPORTED);
+    cr_assert(rip_ns_qtype_get(65535).idx == RIP_NS_QTYPE_IDX_UNSUPPORTED);
+    for (uint32_t type = 0; type <= UINT16_MAX; type++) {
+        cr_assert(rip_ns_rr_type_supported(type) ==
+                  ((rip_ns_qtype_get(type).flags & RIP_NS_QTYPE_F_SUPPORTED) != 0));
+    }
 }
 
 /** @}*/
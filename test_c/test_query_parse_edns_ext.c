@@ -103,4 +103,19 @@ ParameterizedTest(struct test_params_query_parse_edns_ext *param, query,
 
 }
 
+/** Unit test for parsing EDNS TCP keepalive option, it MUST be empty in
+ * request (RFC 7828).
+ */
+Test(query, test_query_parse_edns_ext_keepalive)
+{
+    query_t q     = {};
+    uint8_t buf[] = { 0x00, 0x0b, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x02, 0x00, 0x64 };
+
+    cr_assert(query_parse_edns_ext(&q, buf, &buf[3]) == 0);
+    cr_assert(q.edns.tcp_keepalive);
+
+    q.edns.tcp_keepalive = false;
+    cr_assert(query_parse_edns_ext(&q, &buf[4], &buf[9]) != 0);
+}
+
 /** @}*/
@@ -892,6 +892,11 @@ ParameterizedTest(struct test_params_query_parse_edns_ext_cs *param, query,
     }
     cr_assert(edns_cs.edns_cs_valid == param->cs.edns_cs_valid);
     cr_assert(edns_cs.family == param->cs.family);
+
+    /* Address is decoded on demand only. */
+    cr_assert(edns_cs.ip_decoded == false);
+    cr_assert(query_edns_cs_ip(&edns_cs) == &edns_cs.ip);
+    cr_assert(edns_cs.ip_decoded == true);
     if (param->cs.family == 1) {
         /* IPv4 */
         cr_assert(inet_pton(AF_INET, param->ip, &addr) == 1);
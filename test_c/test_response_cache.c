@@ -0,0 +1,458 @@
+/**
+ * @file test_response_cache.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup response_cache_ut Response Cache
+ *
+ * @brief Response cache unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "config.h"
+#include "query.h"
+#include "response_cache.h"
+#include "rip_ns_utils.h"
+#include "zone.h"
+
+/**! @cond */
+TestSuite(response_cache);
+
+static const char *test_response_cache_zone =
+    "example.com.      3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+    "example.com.      3600 IN NS  ns.example.com.\n"
+    "ns.example.com.   3600 IN A   192.0.2.1\n"
+    "www.example.com.    60 IN A   192.0.2.10\n";
+
+static void
+test_response_cache_query_arena(query_t *q, config_t *cfg, arena_t *arena,
+                                const char *name, uint16_t id)
+{
+    unsigned char *p = NULL;
+
+    if (arena != NULL) {
+        query_init_arena(q, arena);
+    } else {
+        query_init(q, cfg, 0);
+    }
+    query_reset(q);
+    memset(q->request_buffer, 0, sizeof(rip_ns_header_t));
+    q->request_hdr->id      = htons(id);
+    q->request_hdr->rd      = 1;
+    q->request_hdr->qdcount = htons(1);
+    p = q->request_buffer + sizeof(rip_ns_header_t);
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, p, RIP_NS_MAXCDNAME + 1) >= 0);
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    p += 1;
+    RIP_NS_PUT16(rip_ns_t_a, p);
+    RIP_NS_PUT16(rip_ns_c_in, p);
+    q->request_buffer_len = p - q->request_buffer;
+    query_parse(q);
+}
+
+static void
+test_response_cache_query(query_t *q, config_t *cfg, const char *name, uint16_t id)
+{
+    test_response_cache_query_arena(q, cfg, NULL, name, id);
+}
+/**! @endcond */
+
+/** Test response cache miss, put, hit, and invalidation by generation. */
+Test(response_cache, test_response_cache_get_put) {
+    char              err[256] = {'\0'};
+    config_t          cfg;
+    query_t           q;
+    response_cache_t  cache;
+    zone_db_t        *db = zone_db_create(test_response_cache_zone,
+                                          strlen(test_response_cache_zone), 1,
+                                          err, sizeof(err));
+    uint8_t           response[RESPONSE_CACHE_RESPONSE_MAX];
+    size_t            response_len;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    response_cache_init(&cache, 100);
+    cr_assert(cache.mask == 127);
+
+    /* Not cached before generation is set (zone database not loaded). */
+    test_response_cache_query(&q, &cfg, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache, &q));
+    cr_assert(q.response_cache_hash == 0);
+    query_clean(&q);
+
+    response_cache_generation_set(&cache, db->generation);
+
+    /* Miss, then resolve, pack and put. */
+    test_response_cache_query(&q, &cfg, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache, &q));
+    cr_assert(q.response_cache_hash != 0);
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache, &q);
+    response_len = q.response_buffer_len;
+    memcpy(response, q.response_hdr, response_len);
+    query_clean(&q);
+
+    /* Hit, with different ID and question case. */
+    test_response_cache_query(&q, &cfg, "WWW.example.COM", 2);
+    cr_assert(response_cache_get(&cache, &q));
+    cr_assert(q.response_cached);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.response_buffer_len == response_len);
+    cr_assert(q.response_hdr->id == htons(2));
+    cr_assert(memcmp((uint8_t *)q.response_hdr + sizeof(rip_ns_header_t),
+                     q.request_buffer + sizeof(rip_ns_header_t),
+                     q.query_question_len) == 0);
+    cr_assert(memcmp((uint8_t *)q.response_hdr + sizeof(rip_ns_header_t) + q.query_question_len,
+                     response + sizeof(rip_ns_header_t) + q.query_question_len,
+                     response_len - sizeof(rip_ns_header_t) - q.query_question_len) == 0);
+    query_clean(&q);
+
+    /* Different name misses. */
+    test_response_cache_query(&q, &cfg, "ns.example.com", 3);
+    cr_assert(!response_cache_get(&cache, &q));
+    query_clean(&q);
+
+    /* Same name in a view misses. */
+    test_response_cache_query(&q, &cfg, "www.example.com", 3);
+    q.view = 1;
+    cr_assert(!response_cache_get(&cache, &q));
+    query_clean(&q);
+
+    /* New generation invalidates entries. */
+    response_cache_generation_set(&cache, db->generation + 1);
+    test_response_cache_query(&q, &cfg, "www.example.com", 4);
+    cr_assert(!response_cache_get(&cache, &q));
+    query_clean(&q);
+
+    response_cache_clean(&cache);
+    cr_assert(cache.entries == NULL);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test response packed, and copied from cache, in place over request keeps
+ * request ID, RD bit and question as sent.
+ */
+Test(response_cache, test_response_cache_in_place) {
+    char              err[256] = {'\0'};
+    config_t          cfg;
+    arena_t           arena;
+    query_t           q;
+    response_cache_t  cache;
+    zone_db_t        *db = zone_db_create(test_response_cache_zone,
+                                          strlen(test_response_cache_zone), 1,
+                                          err, sizeof(err));
+    uint8_t           request[RIP_NS_PACKETSZ];
+    uint8_t           response[RESPONSE_CACHE_RESPONSE_MAX];
+    size_t            response_len;
+    size_t            question_end;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    cr_assert(arena_init(&arena, query_arena_size() * 2, 0) == 0);
+    response_cache_init(&cache, 100);
+    response_cache_generation_set(&cache, db->generation);
+
+    /* Miss, response is packed over request. */
+    test_response_cache_query_arena(&q, &cfg, &arena, "www.example.com", 1);
+    cr_assert(query_response_in_place(&q));
+    question_end = sizeof(rip_ns_header_t) + q.query_question_len;
+    memcpy(request, q.request_buffer, q.request_buffer_len);
+    cr_assert(!response_cache_get(&cache, &q));
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    cr_assert(q.response_hdr->id == htons(1));
+    cr_assert(q.response_hdr->rd == 1);
+    cr_assert(q.response_hdr->qr == 1);
+    cr_assert(ntohs(q.response_hdr->ancount) == 1);
+    cr_assert(memcmp(q.response_buffer + sizeof(rip_ns_header_t),
+                     request + sizeof(rip_ns_header_t), q.query_question_len) == 0);
+    response_cache_put(&cache, &q);
+    response_len = q.response_buffer_len;
+    memcpy(response, q.response_hdr, response_len);
+
+    /* Hit, question keeps its case. */
+    test_response_cache_query_arena(&q, &cfg, &arena, "WWW.example.COM", 2);
+    memcpy(request, q.request_buffer, q.request_buffer_len);
+    cr_assert(response_cache_get(&cache, &q));
+    cr_assert(q.response_buffer_len == response_len);
+    cr_assert(q.response_hdr->id == htons(2));
+    cr_assert(q.response_hdr->rd == 1);
+    cr_assert(memcmp(q.response_buffer + sizeof(rip_ns_header_t),
+                     request + sizeof(rip_ns_header_t), q.query_question_len) == 0);
+    cr_assert(memcmp(q.response_buffer + question_end, response + question_end,
+                     response_len - question_end) == 0);
+
+    response_cache_clean(&cache);
+    arena_clean(&arena);
+    zone_db_release(db);
+    config_clean(&cfg);
+}
+
+/** Test every hot_hits-th hit of an entry marks query hot and keeps its
+ * request as sent, before response is copied over it.
+ */
+Test(response_cache, test_response_cache_hot) {
+    char              err[256] = {'\0'};
+    config_t          cfg;
+    arena_t           arena;
+    query_t           q;
+    response_cache_t  cache;
+    zone_db_t        *db = zone_db_create(test_response_cache_zone,
+                                          strlen(test_response_cache_zone), 1,
+                                          err, sizeof(err));
+    uint8_t           request[RIP_NS_PACKETSZ];
+    size_t            request_len;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    cr_assert(arena_init(&arena, query_arena_size() * 8, 0) == 0);
+    response_cache_init(&cache, 100);
+    response_cache_generation_set(&cache, db->generation);
+    cache.hot_hits = 2;
+
+    test_response_cache_query_arena(&q, &cfg, &arena, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache, &q));
+    cr_assert(!q.response_hot);
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache, &q);
+
+    for (int i = 1; i <= 4; i++) {
+        test_response_cache_query_arena(&q, &cfg, &arena, "WWW.example.com", 100 + i);
+        memcpy(request, q.request_buffer, q.request_buffer_len);
+        request_len = q.request_buffer_len;
+        cr_assert(response_cache_get(&cache, &q));
+        cr_assert(q.response_hot == (i % 2 == 0));
+        if (q.response_hot) {
+            cr_assert(cache.hot_request_len == request_len);
+            cr_assert(memcmp(cache.hot_request, request, request_len) == 0);
+            cr_assert(q.response_hdr->qr == 1);
+        }
+    }
+
+    /* Disabled. */
+    cache.hot_hits = 0;
+    test_response_cache_query_arena(&q, &cfg, &arena, "www.example.com", 200);
+    cr_assert(response_cache_get(&cache, &q));
+    cr_assert(!q.response_hot);
+
+    response_cache_clean(&cache);
+    arena_clean(&arena);
+    zone_db_release(db);
+    config_clean(&cfg);
+}
+
+/** Test response put by one vectorloop into shared response cache is found
+ * by another, and added to its own cache. Entry being written, or of other
+ * generation, is not used.
+ */
+Test(response_cache, test_response_cache_shared) {
+    char                     err[256] = {'\0'};
+    config_t                 cfg;
+    query_t                  q;
+    response_cache_t         cache_a;
+    response_cache_t         cache_b;
+    response_cache_shared_t  shared;
+    zone_db_t               *db = zone_db_create(test_response_cache_zone,
+                                                 strlen(test_response_cache_zone), 1,
+                                                 err, sizeof(err));
+    uint32_t                 hash;
+    unsigned int             seq;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    response_cache_shared_init(&shared, 10);
+    cr_assert(shared.mask == 3);
+    response_cache_init(&cache_a, 16);
+    response_cache_init(&cache_b, 16);
+    response_cache_generation_set(&cache_a, db->generation);
+    response_cache_generation_set(&cache_b, db->generation);
+
+    /* Vectorloop A misses both, resolves and puts. */
+    test_response_cache_query(&q, &cfg, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache_a, &q));
+    cr_assert(!response_cache_shared_get(&shared, &cache_a, &q));
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache_a, &q);
+    response_cache_shared_put(&shared, &cache_a, &q);
+    hash = q.response_cache_hash;
+    query_clean(&q);
+
+    /* Vectorloop B finds it in shared cache, then in its own. */
+    test_response_cache_query(&q, &cfg, "WWW.example.com", 2);
+    cr_assert(!response_cache_get(&cache_b, &q));
+    cr_assert(response_cache_shared_get(&shared, &cache_b, &q));
+    cr_assert(q.response_cached);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.response_hdr->id == htons(2));
+    query_clean(&q);
+    test_response_cache_query(&q, &cfg, "www.example.com", 3);
+    cr_assert(response_cache_get(&cache_b, &q));
+    query_clean(&q);
+
+    /* Entry being written is skipped, once it is gone from B's own cache. */
+    response_cache_clean(&cache_b);
+    response_cache_init(&cache_b, 16);
+    response_cache_generation_set(&cache_b, db->generation);
+    for (int i = 0; i < RESPONSE_CACHE_SHARED_WAYS; i++) {
+        atomic_fetch_add(&shared.entries[(hash & shared.mask) *
+                                         RESPONSE_CACHE_SHARED_WAYS + i].seq, 1);
+    }
+    test_response_cache_query(&q, &cfg, "www.example.com", 4);
+    cr_assert(!response_cache_get(&cache_b, &q));
+    cr_assert(!response_cache_shared_get(&shared, &cache_b, &q));
+
+    /* Nor is it replaced. */
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    seq = atomic_load(&shared.entries[(hash & shared.mask) * RESPONSE_CACHE_SHARED_WAYS].seq);
+    response_cache_shared_put(&shared, &cache_b, &q);
+    cr_assert(atomic_load(&shared.entries[(hash & shared.mask) *
+                                          RESPONSE_CACHE_SHARED_WAYS].seq) == seq);
+    query_clean(&q);
+    for (int i = 0; i < RESPONSE_CACHE_SHARED_WAYS; i++) {
+        atomic_fetch_add(&shared.entries[(hash & shared.mask) *
+                                         RESPONSE_CACHE_SHARED_WAYS + i].seq, 1);
+    }
+
+    /* Other generation misses. */
+    response_cache_generation_set(&cache_b, db->generation + 1);
+    test_response_cache_query(&q, &cfg, "www.example.com", 5);
+    cr_assert(!response_cache_get(&cache_b, &q));
+    cr_assert(!response_cache_shared_get(&shared, &cache_b, &q));
+    query_clean(&q);
+
+    response_cache_clean(&cache_a);
+    response_cache_clean(&cache_b);
+    response_cache_shared_clean(&shared);
+    cr_assert(shared.entries == NULL);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test snapshot holds questions of cached responses of current generation,
+ * most hit first, and a question rebuilt from it is resolved into a new
+ * cache.
+ */
+Test(response_cache, test_response_cache_snapshot) {
+    char                       err[256] = {'\0'};
+    char                       path[]   = "/tmp/test_response_cache_snapshot";
+    config_t                   cfg;
+    query_t                    q;
+    response_cache_t           cache;
+    response_cache_snapshot_t  snap = {};
+    zone_db_t                 *db = zone_db_create(test_response_cache_zone,
+                                                   strlen(test_response_cache_zone), 1,
+                                                   err, sizeof(err));
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    response_cache_init(&cache, 16);
+    response_cache_generation_set(&cache, db->generation);
+
+    /* Cache two names, hit second one twice. */
+    test_response_cache_query(&q, &cfg, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache, &q));
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache, &q);
+    query_clean(&q);
+    test_response_cache_query(&q, &cfg, "ns.example.com", 2);
+    cr_assert(!response_cache_get(&cache, &q));
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache, &q);
+    query_clean(&q);
+    for (uint16_t id = 3; id < 5; id++) {
+        test_response_cache_query(&q, &cfg, "ns.example.com", id);
+        cr_assert(response_cache_get(&cache, &q));
+        query_clean(&q);
+    }
+
+    cr_assert(response_cache_snapshot_write(&cache, path, err, sizeof(err)) == 2, "%s", err);
+    cr_assert(response_cache_snapshot_open(&snap, path, err, sizeof(err)) == 0, "%s", err);
+    cr_assert(snap.count == 2);
+    cr_assert(snap.entries[0].hits == 2);
+    cr_assert(snap.entries[0].q_type == rip_ns_t_a);
+    cr_assert(snap.entries[0].q_class == rip_ns_c_in);
+
+    /* Question rebuilt from snapshot is resolved into a new cache. */
+    response_cache_clean(&cache);
+    response_cache_init(&cache, 16);
+    response_cache_generation_set(&cache, db->generation);
+    query_init(&q, &cfg, 0);
+    query_reset(&q);
+    cr_assert(response_cache_snapshot_query(&snap.entries[0], &q));
+    cr_assert(!response_cache_get(&cache, &q));
+    query_resolve(&q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(&q) == 0);
+    response_cache_put(&cache, &q);
+    query_clean(&q);
+    response_cache_snapshot_close(&snap);
+    cr_assert(snap.entries == NULL);
+    test_response_cache_query(&q, &cfg, "ns.example.com", 5);
+    cr_assert(response_cache_get(&cache, &q));
+    cr_assert(q.answer_section_count == 1);
+    query_clean(&q);
+
+    /* No snapshot file. */
+    unlink(path);
+    cr_assert(response_cache_snapshot_open(&snap, path, err, sizeof(err)) == 1);
+
+    response_cache_clean(&cache);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test disabled response cache. */
+Test(response_cache, test_response_cache_disabled) {
+    config_t         cfg;
+    query_t          q;
+    response_cache_t cache;
+
+    config_init(&cfg);
+    response_cache_init(&cache, 0);
+    response_cache_generation_set(&cache, 1);
+    cr_assert(cache.entries == NULL);
+    test_response_cache_query(&q, &cfg, "www.example.com", 1);
+    cr_assert(!response_cache_get(&cache, &q));
+    cr_assert(q.response_cache_hash == 0);
+    query_clean(&q);
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,178 @@
+/**
+ * @file test_rrl.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup rrl_ut Response Rate Limiting
+ *
+ * @brief Response rate limiting unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#include "rrl.h"
+
+/**! @cond */
+TestSuite(rrl);
+
+static void
+test_rrl_ipv4(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin->sin_family = AF_INET;
+    cr_assert(inet_pton(AF_INET, ip, &sin->sin_addr) == 1);
+}
+
+static void
+test_rrl_ipv6(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin6->sin6_family = AF_INET6;
+    cr_assert(inet_pton(AF_INET6, ip, &sin6->sin6_addr) == 1);
+}
+/**! @endcond */
+
+/** Test responses within limit are sent, responses over the limit are
+ * slipped and dropped, and limit refills over time.
+ */
+Test(rrl, test_rrl_check_limit) {
+    rrl_t                   rrl;
+    struct sockaddr_storage ip;
+    int                     slipped = 0;
+    int                     dropped = 0;
+
+    rrl_init(&rrl, 64, 10, 2, 24, 56);
+    test_rrl_ipv4(&ip, "192.0.2.1");
+
+    /* One second worth of responses is allowed in a burst. */
+    for (int i = 0; i < 10; i++) {
+        cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_send);
+    }
+    for (int i = 0; i < 10; i++) {
+        rrl_action_t action = rrl_check(&rrl, &ip, rrl_class_answer, 1000000);
+
+        cr_assert(action != rrl_action_send);
+        slipped += action == rrl_action_slip;
+        dropped += action == rrl_action_drop;
+    }
+    cr_assert(slipped == 5, "Expected 5 slipped, got %d", slipped);
+    cr_assert(dropped == 5, "Expected 5 dropped, got %d", dropped);
+
+    /* Other class of response and other network are accounted separately. */
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_nxdomain, 1000000) == rrl_action_send);
+    test_rrl_ipv4(&ip, "192.0.3.1");
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_send);
+
+    /* Address within same /24 shares the limit. */
+    test_rrl_ipv4(&ip, "192.0.2.200");
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) != rrl_action_send);
+
+    /* After 100 ms one more response is allowed. */
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1100000) == rrl_action_send);
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1100000) != rrl_action_send);
+
+    rrl_clean(&rrl);
+}
+
+/** Test slip setting of 0 drops all and 1 slips all responses over the limit. */
+Test(rrl, test_rrl_check_slip) {
+    rrl_t                   rrl;
+    struct sockaddr_storage ip;
+
+    test_rrl_ipv4(&ip, "192.0.2.1");
+
+    rrl_init(&rrl, 64, 1, 0, 24, 56);
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_error, 1000000) == rrl_action_send);
+    for (int i = 0; i < 4; i++) {
+        cr_assert(rrl_check(&rrl, &ip, rrl_class_error, 1000000) == rrl_action_drop);
+    }
+    rrl_clean(&rrl);
+
+    rrl_init(&rrl, 64, 1, 1, 24, 56);
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_error, 1000000) == rrl_action_send);
+    for (int i = 0; i < 4; i++) {
+        cr_assert(rrl_check(&rrl, &ip, rrl_class_error, 1000000) == rrl_action_slip);
+    }
+    rrl_clean(&rrl);
+}
+
+/** Test IPv6 clients are grouped by configured prefix length. */
+Test(rrl, test_rrl_check_ipv6_prefix) {
+    rrl_t                   rrl;
+    struct sockaddr_storage ip;
+
+    rrl_init(&rrl, 64, 1, 0, 24, 52);
+
+    test_rrl_ipv6(&ip, "2001:db8:0:10::1");
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_send);
+    /* Same /52. */
+    test_rrl_ipv6(&ip, "2001:db8:0:1f::2");
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_drop);
+    /* Different /52. */
+    test_rrl_ipv6(&ip, "2001:db8:0:1000::1");
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_send);
+
+    rrl_clean(&rrl);
+}
+
+/** Test table keeps working when more networks are limited than it has
+ * entries, replacing entries instead of allocating new ones.
+ */
+Test(rrl, test_rrl_check_table_full) {
+    rrl_t                   rrl;
+    struct sockaddr_storage ip;
+    char                    addr[INET_ADDRSTRLEN];
+
+    rrl_init(&rrl, 4, 1, 0, 32, 56);
+    cr_assert(rrl.mask == 0);
+
+    for (int i = 0; i < 100; i++) {
+        snprintf(addr, sizeof(addr), "198.51.100.%d", i);
+        test_rrl_ipv4(&ip, addr);
+        cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_send);
+    }
+    /* Most recently seen network is still being limited. */
+    cr_assert(rrl_check(&rrl, &ip, rrl_class_answer, 1000000) == rrl_action_drop);
+
+    rrl_clean(&rrl);
+}
+
+/** Test RRL is disabled when limit or table size is 0. */
+Test(rrl, test_rrl_init_disabled) {
+    rrl_t rrl;
+
+    rrl_init(&rrl, 64, 0, 2, 24, 56);
+    cr_assert(rrl.buckets == NULL);
+    rrl_init(&rrl, 0, 10, 2, 24, 56);
+    cr_assert(rrl.buckets == NULL);
+}
+
+/** @}*/
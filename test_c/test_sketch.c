@@ -0,0 +1,177 @@
+/**
+ * @file test_sketch.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup sketch_ut Streaming Sketches
+ *
+ * @brief Streaming sketches unit tests
+ *  @{
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <criterion/criterion.h>
+
+#include "sketch.h"
+
+/**! @cond */
+TestSuite(sketch);
+
+static uint64_t
+test_sketch_rand(uint64_t *state)
+{
+    *state += 0x9e3779b97f4a7c15ULL;
+    return sketch_mix(*state);
+}
+/**! @endcond */
+
+/** Test keys are counted exactly while sketch has room, with their data. */
+Test(sketch, test_sketch_topk_exact) {
+    sketch_topk_t t;
+    uint32_t      idx[16];
+    uint32_t      n;
+    char          data[8];
+
+    sketch_topk_init(&t, 16, sizeof(data));
+    for (uint64_t k = 1; k <= 10; k++) {
+        snprintf(data, sizeof(data), "key%u", (unsigned)k);
+        for (uint64_t c = 0; c < k; c++) {
+            sketch_topk_add(&t, k, data, strlen(data), 1);
+        }
+    }
+    cr_assert(t.used == 10);
+    n = sketch_topk_sorted(&t, idx, 3);
+    cr_assert(n == 3);
+    for (uint32_t i = 0; i < n; i++) {
+        cr_assert(t.entries[idx[i]].key == 10 - i);
+        cr_assert(t.entries[idx[i]].count == 10 - i);
+        cr_assert(t.entries[idx[i]].error == 0);
+    }
+    cr_assert(t.entries[idx[0]].data_len == 5);
+    cr_assert(memcmp(sketch_topk_data(&t, idx[0]), "key10", 5) == 0);
+
+    sketch_topk_reset(&t);
+    cr_assert(sketch_topk_sorted(&t, idx, 3) == 0);
+    sketch_topk_add(&t, 7, NULL, 0, 3);
+    cr_assert(sketch_topk_sorted(&t, idx, 3) == 1 && t.entries[idx[0]].count == 3);
+    sketch_topk_clean(&t);
+}
+
+/** Test heavy hitters of a stream far larger than sketch are found, their
+ * counts are never underestimated and error bounds hold.
+ */
+Test(sketch, test_sketch_topk_heavy_hitters) {
+    sketch_topk_t t;
+    sketch_topk_t a;
+    sketch_topk_t m;
+    uint32_t      idx[64];
+    uint64_t      state = 1;
+    uint64_t      truth[8] = { 0 };
+    uint32_t      n;
+
+    sketch_topk_init(&t, 64, 0);
+    sketch_topk_init(&a, 64, 0);
+    sketch_topk_init(&m, 64, 0);
+    for (int i = 0; i < 200000; i++) {
+        uint64_t r   = test_sketch_rand(&state);
+        uint64_t key = 1000 + (r >> 8) % 100000;
+
+        /* Keys 0 to 7 are each about 2% of stream, rest is noise. */
+        if ((r & 0xff) < 40) {
+            key = r % 8;
+            truth[key]++;
+        }
+        sketch_topk_add(&t, key, NULL, 0, 1);
+        sketch_topk_add(i % 2 ? &a : &m, key, NULL, 0, 1);
+    }
+
+    n = sketch_topk_sorted(&t, idx, 8);
+    cr_assert(n == 8);
+    for (uint32_t i = 0; i < n; i++) {
+        sketch_topk_entry_t *e = &t.entries[idx[i]];
+
+        cr_assert(e->key < 8, "key %llu", (unsigned long long)e->key);
+        cr_assert(e->count >= truth[e->key]);
+        cr_assert(e->count - e->error <= truth[e->key]);
+    }
+
+    /* Sketches of two halves of stream merge into sketch of whole stream. */
+    sketch_topk_merge(&m, &a);
+    n = sketch_topk_sorted(&m, idx, 8);
+    for (uint32_t i = 0; i < n; i++) {
+        sketch_topk_entry_t *e = &m.entries[idx[i]];
+
+        cr_assert(e->key < 8);
+        cr_assert(e->count >= truth[e->key]);
+        cr_assert(e->count - e->error <= truth[e->key]);
+    }
+
+    sketch_topk_clean(&t);
+    sketch_topk_clean(&a);
+    sketch_topk_clean(&m);
+}
+
+/** Test distinct key estimates are within a few standard errors, and merge
+ * estimates union.
+ */
+Test(sketch, test_sketch_hll) {
+    sketch_hll_t *h     = malloc(sizeof(sketch_hll_t));
+    sketch_hll_t *g     = malloc(sizeof(sketch_hll_t));
+    uint32_t      counts[] = { 0, 10, 1000, 50000, 1000000 };
+    uint64_t      state = 7;
+
+    for (int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double estimate;
+
+        sketch_hll_reset(h);
+        for (uint32_t i = 0; i < counts[c]; i++) {
+            uint64_t hash = test_sketch_rand(&state);
+
+            /* Repeated keys do not change estimate. */
+            sketch_hll_add(h, hash);
+            sketch_hll_add(h, hash);
+        }
+        estimate = sketch_hll_estimate(h);
+        cr_assert(fabs(estimate - counts[c]) <= 0.05 * counts[c] + 1,
+                  "%u estimated as %f", counts[c], estimate);
+    }
+
+    sketch_hll_reset(h);
+    sketch_hll_reset(g);
+    for (uint32_t i = 0; i < 20000; i++) {
+        sketch_hll_add(i < 12000 ? h : g, sketch_mix(i));
+        if (i >= 8000 && i < 12000) {
+            sketch_hll_add(g, sketch_mix(i));
+        }
+    }
+    sketch_hll_merge(h, g);
+    cr_assert(fabs(sketch_hll_estimate(h) - 20000) <= 1000);
+
+    free(h);
+    free(g);
+}
+
+/** @}*/
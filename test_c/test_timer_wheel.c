@@ -0,0 +1,149 @@
+/**
+ * @file test_timer_wheel.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup timer_wheel_ut Timer Wheel
+ *
+ * @brief Timer wheel unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include "timer_wheel.h"
+
+/**! @cond */
+TestSuite(timer_wheel);
+
+typedef struct test_timer_wheel_obj_s {
+    int                id;
+    timer_wheel_node_t timer;
+} test_timer_wheel_obj_t;
+
+static int
+test_timer_wheel_count(timer_wheel_node_t *node)
+{
+    int count = 0;
+
+    for (; node != NULL; node = node->next) {
+        count++;
+    }
+    return count;
+}
+/**! @endcond */
+
+/** Test timers expire on tick they are armed for, across wheel levels. */
+Test(timer_wheel, test_timer_wheel_expire) {
+    timer_wheel_t          tw;
+    test_timer_wheel_obj_t objs[5];
+    uint64_t               start     = 1000003;
+    uint64_t               expires[] = {start, start + 63, start + 64,
+                                        start + 10000, start + 600000};
+    timer_wheel_node_t    *node      = NULL;
+
+    timer_wheel_init(&tw, start);
+    for (int i = 0; i < 5; i++) {
+        objs[i] = (test_timer_wheel_obj_t) {.id = i};
+        timer_wheel_arm(&tw, &objs[i].timer, expires[i]);
+        cr_assert(timer_wheel_node_armed(&objs[i].timer));
+    }
+
+    for (int i = 0; i < 5; i++) {
+        /* Nothing expires before its time. */
+        cr_assert(timer_wheel_advance(&tw, expires[i] - 1) == NULL || i == 0);
+        node = timer_wheel_advance(&tw, expires[i]);
+        cr_assert(test_timer_wheel_count(node) == 1, "timer %d", i);
+        cr_assert(TIMER_WHEEL_ENTRY(node, test_timer_wheel_obj_t, timer)->id == i);
+        cr_assert(!timer_wheel_node_armed(node));
+    }
+    cr_assert(timer_wheel_advance(&tw, start + 10000000) == NULL);
+}
+
+/** Test re-arming and disarming timers. */
+Test(timer_wheel, test_timer_wheel_rearm_disarm) {
+    timer_wheel_t          tw;
+    test_timer_wheel_obj_t objs[3] = {{.id = 0}, {.id = 1}, {.id = 2}};
+    timer_wheel_node_t    *node    = NULL;
+
+    timer_wheel_init(&tw, 0);
+    for (int i = 0; i < 3; i++) {
+        timer_wheel_arm(&tw, &objs[i].timer, 100);
+    }
+
+    /* Middle of slot list. */
+    timer_wheel_disarm(&objs[1].timer);
+    cr_assert(!timer_wheel_node_armed(&objs[1].timer));
+    timer_wheel_disarm(&objs[1].timer);
+
+    /* Re-arm pushes expiry out. */
+    timer_wheel_arm(&tw, &objs[0].timer, 5000);
+
+    node = timer_wheel_advance(&tw, 100);
+    cr_assert(test_timer_wheel_count(node) == 1);
+    cr_assert(node == &objs[2].timer);
+
+    cr_assert(timer_wheel_advance(&tw, 4999) == NULL);
+    node = timer_wheel_advance(&tw, 5000);
+    cr_assert(node == &objs[0].timer);
+
+    /* Timer armed in the past fires on next advance. */
+    timer_wheel_arm(&tw, &objs[1].timer, 10);
+    node = timer_wheel_advance(&tw, 5001);
+    cr_assert(node == &objs[1].timer);
+
+    /* Timer beyond wheel span. */
+    timer_wheel_arm(&tw, &objs[2].timer, 5001 + 100000000);
+    cr_assert(timer_wheel_advance(&tw, 5001 + 99999999) == NULL);
+    node = timer_wheel_advance(&tw, 5001 + 100000000);
+    cr_assert(node == &objs[2].timer);
+}
+
+/** Test earliest expiry lookup. */
+Test(timer_wheel, test_timer_wheel_next_expiry) {
+    timer_wheel_t          tw;
+    test_timer_wheel_obj_t objs[2] = {};
+
+    timer_wheel_init(&tw, 100);
+    cr_assert(timer_wheel_next_expiry(&tw) == UINT64_MAX);
+
+    /* Timer in first level is exact, also across level 0 wrap. */
+    timer_wheel_arm(&tw, &objs[0].timer, 150);
+    cr_assert(timer_wheel_next_expiry(&tw) == 150);
+    timer_wheel_arm(&tw, &objs[0].timer, 130);
+    cr_assert(timer_wheel_next_expiry(&tw) == 130);
+
+    /* Timer in higher level reports next cascade. */
+    timer_wheel_arm(&tw, &objs[1].timer, 5000);
+    cr_assert(timer_wheel_next_expiry(&tw) == 130);
+    timer_wheel_disarm(&objs[0].timer);
+    cr_assert(timer_wheel_next_expiry(&tw) == 128);
+    cr_assert(timer_wheel_advance(&tw, 128) == NULL);
+    cr_assert(timer_wheel_next_expiry(&tw) > 128);
+    cr_assert(timer_wheel_next_expiry(&tw) <= 5000);
+
+    cr_assert(timer_wheel_advance(&tw, 5000) == &objs[1].timer);
+    cr_assert(timer_wheel_next_expiry(&tw) == UINT64_MAX);
+}
+
+/** @}*/
@@ -0,0 +1,216 @@
+/**
+ * @file test_topology.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup topology_ut CPU topology
+ *
+ * @brief CPU topology unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "topology.h"
+
+/**! @cond */
+TestSuite(topology);
+/**! @endcond */
+
+/** Write file under fake sysfs or procfs root, creating its directories.
+ *
+ * @param root Root directory.
+ * @param file File path relative to root.
+ * @param str  File content.
+ */
+static void
+test_topology_write(const char *root, const char *file, const char *str)
+{
+    char  path[PATH_MAX];
+    char *slash = NULL;
+    FILE *f     = NULL;
+
+    snprintf(path, sizeof(path), "%s/%s", root, file);
+    for (slash = strchr(path + strlen(root), '/'); slash != NULL;
+         slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0700);
+        *slash = '/';
+    }
+    f = fopen(path, "w");
+    cr_assert(f != NULL);
+    fprintf(f, "%s\n", str);
+    fclose(f);
+}
+
+/** Remove file or directory of fake root, for nftw(). */
+static int
+test_topology_rm(const char *path, const struct stat *sb, int flag, struct FTW *ftw)
+{
+    return remove(path);
+}
+
+/** Write fake sysfs of two packages, each of two cores with two SMT
+ * siblings, package 0 (NUMA node 0) has CPUs 0,1,4,5 and package 1 (node 1)
+ * CPUs 2,3,6,7, where CPUs n and n+4 are siblings. Network interface
+ * "eth0" is on node 1, its interrupts are delivered to CPUs 3 and 6.
+ *
+ * @param sysfs  Fake sysfs root.
+ * @param procfs Fake procfs root.
+ */
+static void
+test_topology_fake(const char *sysfs, const char *procfs)
+{
+    char file[128];
+    char val[16];
+
+    test_topology_write(sysfs, "devices/system/cpu/online", "0-7");
+    for (int cpu = 0; cpu < 8; cpu++) {
+        snprintf(file, sizeof(file), "devices/system/cpu/cpu%d/topology/"
+                 "physical_package_id", cpu);
+        snprintf(val, sizeof(val), "%d", (cpu / 2) % 2);
+        test_topology_write(sysfs, file, val);
+        snprintf(file, sizeof(file), "devices/system/cpu/cpu%d/topology/core_id", cpu);
+        snprintf(val, sizeof(val), "%d", cpu % 2);
+        test_topology_write(sysfs, file, val);
+    }
+    test_topology_write(sysfs, "devices/system/node/node0/cpulist", "0-1,4-5");
+    test_topology_write(sysfs, "devices/system/node/node1/cpulist", "2-3,6-7");
+    test_topology_write(sysfs, "class/net/eth0/device/numa_node", "1");
+    test_topology_write(sysfs, "class/net/eth0/device/msi_irqs/30", "msi");
+    test_topology_write(sysfs, "class/net/eth0/device/msi_irqs/31", "msi");
+    test_topology_write(procfs, "irq/30/smp_affinity_list", "3");
+    test_topology_write(procfs, "irq/31/effective_affinity_list", "6");
+    test_topology_write(procfs, "irq/31/smp_affinity_list", "0-7");
+}
+
+/** Test CPU list parsing. */
+Test(topology, test_topology_cpu_list_parse) {
+    unsigned char cpus[16];
+
+    cr_assert(topology_cpu_list_parse("0-3,8,10-11", cpus, 16) == 7);
+    cr_assert(cpus[0] && cpus[3] && !cpus[4] && cpus[8] && !cpus[9] && cpus[11]);
+
+    /* Overlapping ranges count CPUs once, CPUs past array are ignored. */
+    cr_assert(topology_cpu_list_parse("1-2,2,14-20", cpus, 16) == 4);
+    cr_assert(topology_cpu_list_parse("", cpus, 16) == 0);
+
+    cr_assert(topology_cpu_list_parse("1-", cpus, 16) == -1);
+    cr_assert(topology_cpu_list_parse("3-1", cpus, 16) == -1);
+    cr_assert(topology_cpu_list_parse("1,", cpus, 16) == -1);
+    cr_assert(topology_cpu_list_parse("a", cpus, 16) == -1);
+    cr_assert(topology_cpu_list_parse("1 2", cpus, 16) == -1);
+}
+
+/** Test topology is loaded from sysfs, and vectorloops are placed one per
+ * physical core, network interface NUMA node and interrupt CPUs first.
+ */
+Test(topology, test_topology_vl_place) {
+    char          root[]          = "/tmp/test_topology_XXXXXX";
+    char          sysfs[PATH_MAX];
+    char          procfs[PATH_MAX];
+    size_t        masks[6]        = {};
+    unsigned char housekeeping[8] = { 1, 0, 0, 0, 0, 0, 0, 0 };
+    topology_t    topo;
+
+    cr_assert(mkdtemp(root) != NULL);
+    snprintf(sysfs, sizeof(sysfs), "%s/sys", root);
+    snprintf(procfs, sizeof(procfs), "%s/proc", root);
+    test_topology_fake(sysfs, procfs);
+
+    cr_assert(topology_load(&topo, sysfs, 8) == 8);
+    cr_assert(topo.cpus[6].package == 1 && topo.cpus[6].core == 0 &&
+              topo.cpus[6].node == 1);
+    cr_assert(topo.cpus[5].package == 0 && topo.cpus[5].core == 1 &&
+              topo.cpus[5].node == 0);
+    cr_assert(topology_nic_load(&topo, sysfs, procfs, "eth0") == 2);
+    cr_assert(topo.nic_node == 1);
+    cr_assert(topo.cpus[3].nic_irq && topo.cpus[6].nic_irq && !topo.cpus[7].nic_irq);
+
+    /* Node 1 cores by their interrupt CPUs, then node 0 cores, then SMT
+     * siblings.
+     */
+    cr_assert(topology_vl_place(&topo, NULL, masks, 6) == 6);
+    cr_assert(masks[0] == 4 && masks[1] == 7 && masks[2] == 1 && masks[3] == 2);
+    cr_assert(masks[4] == 3 && masks[5] == 8);
+
+    /* Vectorloop 1 bound by hand to CPU 3, CPU 0 in housekeeping set, so
+     * cores of both are shared.
+     */
+    memset(masks, 0, sizeof(masks));
+    masks[1] = 4;
+    cr_assert(topology_vl_place(&topo, housekeeping, masks, 4) == 3);
+    cr_assert(masks[0] == 7 && masks[1] == 4 && masks[2] == 2 && masks[3] == 3);
+
+    /* More vectorloops than free CPUs are left unbound. */
+    memset(masks, 0, sizeof(masks));
+    topo.cpus[4].online = false;
+    topo.cpus[5].online = false;
+    cr_assert(topology_vl_place(&topo, housekeeping, masks, 6) == 5);
+    cr_assert(masks[5] == 0);
+
+    topology_release(&topo);
+    cr_assert(nftw(root, test_topology_rm, 16, FTW_DEPTH | FTW_PHYS) == 0);
+
+    /* Missing sysfs leaves topology unknown, all CPUs online. */
+    cr_assert(topology_load(&topo, root, 2) == 2);
+    cr_assert(topo.cpus[1].package == -1 && topo.cpus[1].node == -1);
+    cr_assert(topology_nic_load(&topo, root, root, "eth0") == 0);
+    cr_assert(topo.nic_node == -1);
+    topology_release(&topo);
+}
+
+/** Test vectorloops unbound, or on CPUs not isolated or not tickless, are
+ * warned about.
+ */
+Test(topology, test_topology_isolation_check) {
+    char    root[]   = "/tmp/test_topology_XXXXXX";
+    size_t  masks[3] = { 3, 4, 0 };
+    FILE   *out      = fopen("/dev/null", "w");
+
+    cr_assert(out != NULL);
+    cr_assert(mkdtemp(root) != NULL);
+
+    /* CPUs 2 and 3 isolated, only CPU 3 tickless, vectorloop 2 unbound. */
+    test_topology_write(root, "devices/system/cpu/isolated", "2-3");
+    test_topology_write(root, "devices/system/cpu/nohz_full", "3");
+    cr_assert(topology_isolation_check(root, masks, 3, 4, out) == 2);
+    cr_assert(topology_isolation_check(root, masks, 2, 4, out) == 1);
+
+    /* Kernels without tickless CPUs have "(null)" in nohz_full. */
+    test_topology_write(root, "devices/system/cpu/nohz_full", "(null)");
+    cr_assert(topology_isolation_check(root, masks, 2, 4, out) == 2);
+
+    cr_assert(nftw(root, test_topology_rm, 16, FTW_DEPTH | FTW_PHYS) == 0);
+    cr_assert(topology_isolation_check(root, masks, 2, 4, out) == 4);
+    fclose(out);
+}
+
+/** @}*/
@@ -0,0 +1,152 @@
+/**
+ * @file test_upgrade.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup upgrade_ut Zero downtime upgrade
+ *
+ * @brief Zero downtime upgrade unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "upgrade.h"
+
+/**! @cond */
+TestSuite(upgrade);
+
+/** Initialize upgrade state for count vectorloops. */
+static void
+test_upgrade_init(upgrade_t *u, size_t count)
+{
+    config_t cfg;
+
+    config_init(&cfg);
+    cfg.process_thread_count = count;
+    upgrade_init(u, &cfg);
+    config_clean(&cfg);
+}
+
+/** Check two file descriptors refer to same open socket. */
+static bool
+test_upgrade_same(int fd1, int fd2)
+{
+    struct stat st1, st2;
+
+    return fstat(fd1, &st1) == 0 && fstat(fd2, &st2) == 0 &&
+           st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+/**! @endcond */
+
+/** Test listener sockets sent over more than one message are received by
+ * vectorloop and kind they were registered with, sockets of vectorloops
+ * receiver does not have are closed, and ones not taken are closed once
+ * vectorloop is ready.
+ */
+Test(upgrade, test_upgrade_fds_send_recv) {
+    upgrade_t old, new;
+    int       sv[2];
+    int       fds[12];
+    int       fd;
+    char      err[256];
+
+    cr_assert(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == 0);
+    test_upgrade_init(&old, 12);
+    test_upgrade_init(&new, 2);
+
+    /* 12 vectorloops with all kinds of listeners, but last one has no DoT
+     * listeners, need two messages.
+     */
+    for (int vl_id = 0; vl_id < 12; vl_id++) {
+        fds[vl_id] = socket(AF_INET, SOCK_DGRAM, 0);
+        cr_assert(fds[vl_id] > -1);
+        for (int kind = 0; kind < UPGRADE_FD_KINDS; kind++) {
+            if (vl_id == 11 && (kind == UPGRADE_FD_DOT_IPV4 ||
+                                kind == UPGRADE_FD_DOT_IPV6)) {
+                continue;
+            }
+            upgrade_listener_set(&old, vl_id, kind, fds[vl_id]);
+        }
+    }
+    upgrade_listener_set(&old, 1, UPGRADE_FD_DOT_IPV6, -1);
+
+    cr_assert(upgrade_fds_send(&old, sv[0], err, sizeof(err)) == 0, "%s", err);
+    cr_assert(upgrade_fds_recv(&new, sv[1], err, sizeof(err)) == 0, "%s", err);
+    cr_assert(new.inherited_count == 12 * UPGRADE_FD_KINDS - 3);
+
+    fd = upgrade_fd_take(&new, 1, UPGRADE_FD_TCP_IPV6);
+    cr_assert(fd > -1 && fd != fds[1]);
+    cr_assert(test_upgrade_same(fd, fds[1]));
+    close(fd);
+    cr_assert(upgrade_fd_take(&new, 1, UPGRADE_FD_TCP_IPV6) == -1);
+    cr_assert(upgrade_fd_take(&new, 1, UPGRADE_FD_DOT_IPV6) == -1);
+
+    fd = upgrade_fd_take(&new, 0, UPGRADE_FD_UDP_IPV4);
+    cr_assert(test_upgrade_same(fd, fds[0]));
+    close(fd);
+    cr_assert(atomic_load(&new.inherited_taken) == 2);
+
+    /* Sockets vectorloop 0 did not take are closed. */
+    fd = new.inherited[UPGRADE_FD_UDP_IPV6];
+    cr_assert(fcntl(fd, F_GETFD) > -1);
+    upgrade_vl_ready(&new, 0);
+    cr_assert(fcntl(fd, F_GETFD) == -1);
+    cr_assert(upgrade_fd_take(&new, 0, UPGRADE_FD_UDP_IPV6) == -1);
+    cr_assert(atomic_load(&new.ready) == 1);
+
+    upgrade_clean(&new);
+    upgrade_clean(&old);
+    for (int i = 0; i < 12; i++) {
+        close(fds[i]);
+    }
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/** Test malformed message is rejected. */
+Test(upgrade, test_upgrade_fds_recv_malformed) {
+    upgrade_t u;
+    int       sv[2];
+    uint32_t  magic = UPGRADE_MSG_MAGIC;
+    char      err[256] = "";
+
+    cr_assert(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == 0);
+    test_upgrade_init(&u, 1);
+
+    cr_assert(write(sv[0], &magic, sizeof(magic)) == sizeof(magic));
+    cr_assert(upgrade_fds_recv(&u, sv[1], err, sizeof(err)) == -1);
+    cr_assert(strlen(err) > 0);
+    cr_assert(u.inherited_count == 0);
+
+    upgrade_clean(&u);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/** @}*/
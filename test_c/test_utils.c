@@ -31,7 +31,9 @@
 #include <criterion/criterion.h>
 #include <criterion/parameterized.h>
 
+#include <arpa/inet.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "utils.h"
 
@@ -58,7 +60,11 @@ struct test_params_utl_timespec_to_rfc3339nano {
 /** Unit test parameterized inputs for @ref utl_timespec_to_rfc3339nano. */
 ParameterizedTestParameters(utils, test_utl_timespec_to_rfc3339nano) {
     static struct test_params_utl_timespec_to_rfc3339nano params[] = {
-        { {.tv_sec = 123456789, .tv_nsec = 12345}, "1973-11-29T21:33:09.12345Z" }
+        { {.tv_sec = 123456789, .tv_nsec = 12345}, "1973-11-29T21:33:09.12345Z" },
+        { {.tv_sec = 0, .tv_nsec = 0}, "1970-01-01T00:00:00.0Z" },
+        { {.tv_sec = 1700000000, .tv_nsec = 999999999}, "2023-11-14T22:13:20.999999999Z" },
+        { {.tv_sec = 951782400, .tv_nsec = 1}, "2000-02-29T00:00:00.1Z" },
+        { {.tv_sec = 4107542399, .tv_nsec = 10}, "2100-02-28T23:59:59.10Z" }
     };
 
     size_t nb_params = sizeof(params) / sizeof(struct test_params_utl_timespec_to_rfc3339nano);
@@ -72,6 +78,41 @@ ParameterizedTest(struct test_params_utl_timespec_to_rfc3339nano *param, utils,
     utl_timespec_to_rfc3339nano(&param->ts, result);
     cr_assert_str_eq(result, param->result);
 }
+
+/** Unit test for @ref utl_time_fmt_rfc3339nano, cached and uncached second. */
+Test(utils, test_utl_time_fmt_rfc3339nano) {
+    utl_time_fmt_t  fmt;
+    struct timespec ts[] = { {.tv_sec = 123456789, .tv_nsec = 12345},
+                             {.tv_sec = 123456789, .tv_nsec = 999999999},
+                             {.tv_sec = 123456790, .tv_nsec = 0},
+                             {.tv_sec = 123456789, .tv_nsec = 7} };
+    char            result[TIME_RFC3339_STRLEN];
+    char            expect[TIME_RFC3339_STRLEN];
+
+    utl_time_fmt_init(&fmt);
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) {
+        utl_timespec_to_rfc3339nano(&ts[i], expect);
+        cr_assert(utl_time_fmt_rfc3339nano(&fmt, &ts[i], result) == (int)strlen(expect));
+        cr_assert_str_eq(result, expect);
+    }
+}
+
+/** Unit test for @ref utl_timespec_to_rfc3339nano against strftime(). */
+Test(utils, test_utl_timespec_to_rfc3339nano_strftime) {
+    struct timespec ts = { .tv_nsec = 5 };
+    struct tm       tm;
+    char            result[TIME_RFC3339_STRLEN];
+    char            expect[TIME_RFC3339_STRLEN];
+
+    srandom(1);
+    for (int i = 0; i < 100000; i++) {
+        ts.tv_sec = ((time_t)random() << 4 | (random() & 0xf)) % 253402300800LL;
+        gmtime_r(&ts.tv_sec, &tm);
+        strftime(expect, sizeof(expect), "%Y-%m-%dT%H:%M:%S.5Z", &tm);
+        cr_assert(utl_timespec_to_rfc3339nano(&ts, result) == (int)strlen(expect));
+        cr_assert_str_eq(result, expect);
+    }
+}
 /** @}*/
 
 /** \ingroup utils_ut 
@@ -108,6 +149,238 @@ ParameterizedTest(struct test_str_is_numeric *param, utils, test_str_is_numeric)
 }
 /** @}*/
 
+/** \ingroup utils_ut 
+ * \defgroup str_hex_to_bin_ut str_hex_to_bin
+ *
+ * @brief @ref str_hex_to_bin unit tests
+ *  @{
+ */
+/** Unit test for @ref str_hex_to_bin. */
+Test(utils, test_str_hex_to_bin) {
+    uint8_t bin[4];
+
+    cr_assert(str_hex_to_bin(bin, sizeof(bin), "0aF19b7c") == 0);
+    cr_assert(bin[0] == 0x0a && bin[1] == 0xf1 && bin[2] == 0x9b && bin[3] == 0x7c);
+    cr_assert(str_hex_to_bin(bin, sizeof(bin), "0aF19b7") != 0);
+    cr_assert(str_hex_to_bin(bin, sizeof(bin), "0aF19b7c0") != 0);
+    cr_assert(str_hex_to_bin(bin, sizeof(bin), "0aF19b7g") != 0);
+}
+/** @}*/
+
+/** \ingroup utils_ut 
+ * \defgroup str_to_lc_ut str_to_lc
+ *
+ * @brief @ref str_to_lc unit tests
+ *  @{
+ */
+/** Unit test for @ref str_to_lc, string longer than a vector register with
+ * characters just outside of upper case range and non ASCII bytes.
+ */
+Test(utils, test_str_to_lc) {
+    uint8_t str[]    = "@AZ[`az{\x80\xc1\xdaWWW.Example.COM\x3fMixedCaseTail";
+    uint8_t result[] = "@az[`az{\x80\xc1\xdawww.example.com\x3fmixedcasetail";
+
+    for (size_t len = 0; len <= sizeof(str) - 1; len++) {
+        uint8_t buf[sizeof(str)];
+
+        memcpy(buf, str, sizeof(str));
+        str_to_lc(buf, len);
+        cr_assert(memcmp(buf, result, len) == 0, "Mismatch converting %zu bytes", len);
+        cr_assert(memcmp(buf + len, str + len, sizeof(str) - len) == 0);
+    }
+}
+/** @}*/
+
+/** \ingroup utils_ut 
+ * \defgroup utl_madvise_hugepages_ut utl_madvise_hugepages
+ *
+ * @brief @ref utl_madvise_hugepages unit tests
+ *  @{
+ */
+/** Unit test for @ref utl_madvise_hugepages, only whole pages of range are
+ * advised.
+ */
+Test(utils, test_utl_madvise_hugepages) {
+    size_t         page = sysconf(_SC_PAGESIZE);
+    size_t         len  = 4 * 1024 * 1024;
+    unsigned char *buf  = aligned_alloc(2 * 1024 * 1024, len);
+    size_t         ret  = 0;
+
+    cr_assert(buf != NULL);
+    cr_assert(utl_madvise_hugepages(NULL, len) == 0);
+
+    /* No whole page in range. */
+    cr_assert(utl_madvise_hugepages(buf + 1, page - 1) == 0);
+
+    /* Range not supported by kernel is not advised at all. */
+    ret = utl_madvise_hugepages(buf, len);
+    cr_assert(ret == 0 || ret == len);
+    if (ret == len) {
+        cr_assert(utl_madvise_hugepages(buf + 1, len - 1) == len - page);
+    }
+    free(buf);
+}
+
+/** Test clock extrapolated from cycle counter stays close to system clock. */
+Test(utils, test_utl_clock) {
+    utl_clock_t     clk;
+    struct timespec sync_ts;
+    struct timespec ts;
+    struct timespec sys_ts;
+    struct timespec wait = { .tv_sec = 0, .tv_nsec = 20000000 };
+    int64_t         diff;
+
+    utl_clock_init(&clk);
+    cr_assert(clk.mult > 0);
+
+    utl_clock_sync(&clk, &sync_ts);
+    utl_clock_now(&clk, &ts);
+    cr_assert(utl_timespec_to_ns(&ts) >= utl_timespec_to_ns(&sync_ts));
+    cr_assert(ts.tv_nsec < 1000000000);
+
+    /* After 20ms clock is still within 1ms of system clock. */
+    nanosleep(&wait, NULL);
+    utl_clock_now(&clk, &ts);
+    clock_gettime(CLOCK_REALTIME, &sys_ts);
+    diff = (int64_t)(utl_timespec_to_ns(&sys_ts) - utl_timespec_to_ns(&ts));
+    cr_assert(diff > -1000000 && diff < 1000000, "clock off by %ld ns", (long)diff);
+}
+
+/** Unit test for @ref utl_net_parse and @ref utl_net_match, IPv4-mapped IPv6
+ * address matches IPv4 network.
+ */
+Test(utils, test_utl_net) {
+    utl_net_t               net;
+    struct sockaddr_storage ss  = {};
+    struct sockaddr_in     *sa4 = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6    *sa6 = (struct sockaddr_in6 *)&ss;
+
+    cr_assert(utl_net_parse(&net, "192.0.2.300") == -1);
+    cr_assert(utl_net_parse(&net, "192.0.2.0/33") == -1);
+    cr_assert(utl_net_parse(&net, "192.0.2.0/") == -1);
+    cr_assert(utl_net_parse(&net, "2001:db8::/129") == -1);
+
+    cr_assert(utl_net_parse(&net, "192.0.2.0/24") == 0);
+    cr_assert(net.prefix_len == 24);
+    sa4->sin_family = AF_INET;
+    inet_pton(AF_INET, "192.0.2.77", &sa4->sin_addr);
+    cr_assert(utl_net_match(&net, &ss));
+    inet_pton(AF_INET, "192.0.3.77", &sa4->sin_addr);
+    cr_assert(!utl_net_match(&net, &ss));
+
+    sa6->sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "::ffff:192.0.2.1", &sa6->sin6_addr);
+    cr_assert(utl_net_match(&net, &ss));
+
+    cr_assert(utl_net_parse(&net, "2001:db8::1") == 0);
+    cr_assert(net.prefix_len == 128);
+    cr_assert(!utl_net_match(&net, &ss));
+    inet_pton(AF_INET6, "2001:db8::1", &sa6->sin6_addr);
+    cr_assert(utl_net_match(&net, &ss));
+    inet_pton(AF_INET6, "2001:db8::2", &sa6->sin6_addr);
+    cr_assert(!utl_net_match(&net, &ss));
+}
+
+/** Unit test for @ref utl_sockaddr_unmap, IPv4-mapped IPv6 address becomes
+ * IPv4 address with same port, other addresses are left as they are.
+ */
+Test(utils, test_utl_sockaddr_unmap) {
+    struct sockaddr_storage ss  = {};
+    struct sockaddr_in     *sa4 = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6    *sa6 = (struct sockaddr_in6 *)&ss;
+    struct in_addr          a4;
+    struct in6_addr         a6;
+
+    sa6->sin6_family = AF_INET6;
+    sa6->sin6_port   = htons(5353);
+    inet_pton(AF_INET6, "::ffff:192.0.2.1", &sa6->sin6_addr);
+    utl_sockaddr_unmap(&ss);
+    inet_pton(AF_INET, "192.0.2.1", &a4);
+    cr_assert(sa4->sin_family == AF_INET);
+    cr_assert(sa4->sin_port == htons(5353));
+    cr_assert(sa4->sin_addr.s_addr == a4.s_addr);
+
+    /* Already IPv4, stays. */
+    utl_sockaddr_unmap(&ss);
+    cr_assert(sa4->sin_family == AF_INET);
+    cr_assert(sa4->sin_addr.s_addr == a4.s_addr);
+
+    memset(&ss, 0, sizeof(ss));
+    sa6->sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "2001:db8::1", &sa6->sin6_addr);
+    utl_sockaddr_unmap(&ss);
+    inet_pton(AF_INET6, "2001:db8::1", &a6);
+    cr_assert(sa6->sin6_family == AF_INET6);
+    cr_assert(memcmp(&sa6->sin6_addr, &a6, sizeof(a6)) == 0);
+}
 /** @}*/
 
+/** \ingroup utils_ut 
+ * \defgroup utl_to_str_ut utl_u32_to_dec, utl_ipv4_to_str and utl_ipv6_to_str
+ *
+ * @brief @ref utl_u32_to_dec, @ref utl_ipv4_to_str and @ref utl_ipv6_to_str
+ *        unit tests, output must be byte identical to sprintf() and inet_ntop().
+ *  @{
+ */
+/** Unit test for @ref utl_u32_to_dec. */
+Test(utils, test_utl_u32_to_dec) {
+    uint32_t values[] = { 0, 7, 9, 10, 99, 100, 999, 1000, 65535, 99999, 100000,
+                          999999999, 1000000000, 4294967295u };
+    char     buf[16];
+    char     expect[16];
+    size_t   len;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        len = utl_u32_to_dec(values[i], buf);
+        cr_assert(len == (size_t)sprintf(expect, "%u", values[i]));
+        cr_assert(memcmp(buf, expect, len) == 0, "%u", values[i]);
+    }
+    srandom(1);
+    for (int i = 0; i < 100000; i++) {
+        uint32_t v = (uint32_t)random() >> (random() % 31);
+
+        len = utl_u32_to_dec(v, buf);
+        cr_assert(len == (size_t)sprintf(expect, "%u", v));
+        cr_assert(memcmp(buf, expect, len) == 0, "%u", v);
+    }
+}
+
+/** Unit test for @ref utl_ipv4_to_str and @ref utl_ipv6_to_str. */
+Test(utils, test_utl_ip_to_str) {
+    const char *addrs[] = { "::", "::1", "::2", "1::", "1:0::", "1:0:0:2::", "::ffff:192.0.2.1",
+                            "::ffff:0.0.0.0", "::192.0.2.1", "::0.1.0.0", "::ffff:0:192.0.2.1",
+                            "64:ff9b::192.0.2.1", "2001:db8:0:1:1:1:1:1", "2001:0:0:1:0:0:0:1",
+                            "1:0:1:0:1:0:1:0", "fe80::1:0:0:0", "abcd:ef01:2345:6789:abcd:ef01:2345:6789",
+                            "::fffe:1.2.3.4", "0:0:0:0:1:ffff:1.2.3.4" };
+    uint8_t     addr[16];
+    char        buf[INET6_ADDRSTRLEN];
+    char        expect[INET6_ADDRSTRLEN];
+    size_t      len;
+
+    for (size_t i = 0; i < sizeof(addrs) / sizeof(addrs[0]); i++) {
+        cr_assert(inet_pton(AF_INET6, addrs[i], addr) == 1, "%s", addrs[i]);
+        inet_ntop(AF_INET6, addr, expect, sizeof(expect));
+        len = utl_ipv6_to_str(addr, buf);
+        cr_assert(len == strlen(expect) && memcmp(buf, expect, len) == 0, "%s", expect);
+    }
+    /* Random addresses with zero groups likely, to cover "::" placement. */
+    srandom(1);
+    for (int i = 0; i < 100000; i++) {
+        for (int j = 0; j < 16; j += 2) {
+            int r = random();
+
+            addr[j]     = (r & 3) == 0 ? (uint8_t)(r >> 8) : 0;
+            addr[j + 1] = (r & 12) == 0 ? (uint8_t)(r >> 16) : 0;
+        }
+        inet_ntop(AF_INET6, addr, expect, sizeof(expect));
+        len = utl_ipv6_to_str(addr, buf);
+        cr_assert(len == strlen(expect) && memcmp(buf, expect, len) == 0, "%s", expect);
 
+        inet_ntop(AF_INET, addr, expect, sizeof(expect));
+        len = utl_ipv4_to_str(addr, buf);
+        cr_assert(len == strlen(expect) && memcmp(buf, expect, len) == 0, "%s", expect);
+    }
+}
+/** @}*/
+
+/** @}*/
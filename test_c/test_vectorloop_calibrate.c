@@ -0,0 +1,86 @@
+/**
+ * @file test_vectorloop_calibrate.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlcalibrate_ut Vectorloop calibration
+ *
+ * @brief Vectorloop calibration unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <string.h>
+
+#include "config.h"
+#include "constants.h"
+#include "vectorloop_calibrate.h"
+
+/**! @cond */
+TestSuite(vlcalibrate);
+/**! @endcond */
+
+/** Test calibration measures every vector length, chooses settings within
+ * their bounds, and runs again with vectorloop it kept.
+ */
+Test(vlcalibrate, test_vl_calibrate_run) {
+    char                  err[256] = {};
+    char                  buf[256];
+    config_t              cfg;
+    vl_calibrate_result_t result;
+
+    /* Calibration vectorloop lives until tests exit, vectorloops are not
+     * freed.
+     */
+    static vl_calibrate_t cal;
+
+    config_init(&cfg);
+    cfg.loop_budget_tcp_reads = 16;
+    cr_assert(vl_calibrate_init(&cal, &cfg, err, sizeof(err)) == 0, "%s", err);
+
+    for (int run = 0; run < 2; run++) {
+        vl_calibrate_run(&cal, &result);
+        for (size_t i = 0; i < VL_CALIBRATE_VECTOR_LENS; i++) {
+            cr_assert(result.qps[i] > 0);
+            cr_assert(result.iteration_ns[i] > 0);
+        }
+        cr_assert(cal.replay.responses == cal.replay.queries);
+        cr_assert(result.udp_conn_vector_len >= 1);
+        cr_assert(result.udp_conn_vector_len <= VL_CALIBRATE_VECTOR_LEN_MAX);
+        cr_assert((result.udp_conn_vector_len & (result.udp_conn_vector_len - 1)) == 0);
+        cr_assert(result.epoll_num_events_udp >= EPOLL_NUM_EVENTS_MIN);
+        cr_assert(result.epoll_num_events_tcp >= EPOLL_NUM_EVENTS_MIN);
+        cr_assert(result.epoll_num_events_tcp <= 16);
+        cr_assert(result.loop_idle_spin <= VL_IDLE_SPIN_MAX);
+    }
+
+    vl_calibrate_apply(&result, &cfg);
+    cr_assert(cfg.udp_conn_vector_len == result.udp_conn_vector_len);
+    cr_assert(cfg.epoll_num_events_tcp == result.epoll_num_events_tcp);
+    cr_assert(cfg.loop_idle_spin == result.loop_idle_spin);
+    cr_assert(vl_calibrate_format(&result, buf, sizeof(buf)) > 0);
+    cr_assert(strncmp(buf, "udp_conn_vector_len=", 20) == 0);
+
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,153 @@
+/**
+ * @file test_vectorloop_coalesce.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlcoalesce_ut Vectorloop query coalescing
+ *
+ * @brief Vectorloop query coalescing unit tests
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <criterion/criterion.h>
+#include <string.h>
+
+#include "config.h"
+#include "constants.h"
+#include "response_cache.h"
+#include "rip_ns_utils.h"
+#include "vectorloop_calibrate.h"
+
+/**! @cond */
+TestSuite(vlcoalesce);
+
+/** Response cache hash vectorloop calculates for A query of name. */
+static uint32_t
+test_vl_coalesce_hash(response_cache_t *cache, query_t *q, const char *name)
+{
+    unsigned char *p = NULL;
+
+    query_reset(q);
+    memset(q->request_buffer, 0, sizeof(rip_ns_header_t));
+    q->request_hdr->qdcount = htons(1);
+    p = q->request_buffer + sizeof(rip_ns_header_t);
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, p, RIP_NS_MAXCDNAME + 1) >= 0);
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    p += 1;
+    RIP_NS_PUT16(rip_ns_t_a, p);
+    RIP_NS_PUT16(rip_ns_c_in, p);
+    q->request_buffer_len = p - q->request_buffer;
+    query_parse(q);
+    cr_assert(!response_cache_get(cache, q));
+
+    return q->response_cache_hash;
+}
+/**! @endcond */
+
+/** Test same question asked twice in one batch is resolved once, second
+ * response is copied from response cache with its own ID and question name
+ * case, and a different name in same batch table slot is resolved in full.
+ */
+Test(vlcoalesce, test_vl_query_coalesce) {
+    char             err[256] = {};
+    char             names[3][64];
+    unsigned char    qname[RIP_NS_MAXCDNAME + 1];
+    config_t         cfg;
+    query_t          q;
+    response_cache_t cache;
+    vl_replay_t      replay;
+    metrics_vl_t    *m;
+    uint32_t         hashes[64];
+    uint64_t         misses;
+    uint64_t         coalesced;
+    int              qname_len = 0;
+
+    /* Vectorloop lives until tests exit, vectorloops are not freed. */
+    static vl_calibrate_t cal;
+
+    config_init(&cfg);
+    cr_assert(vl_calibrate_init(&cal, &cfg, err, sizeof(err)) == 0, "%s", err);
+    m = cal.vl->metrics_vl;
+
+    /* Two names of calibration zone in same batch table slot, out of 64
+     * names there are such two for any hash that is not badly broken.
+     */
+    query_init(&q, &cfg, 0);
+    response_cache_init(&cache, 16);
+    response_cache_generation_set(&cache, 1);
+    names[0][0] = '\0';
+    for (unsigned int i = 0; i < 64 && names[0][0] == '\0'; i++) {
+        snprintf(names[2], sizeof(names[2]), "h%u.calibrate.test", i);
+        hashes[i] = test_vl_coalesce_hash(&cache, &q, names[2]);
+        for (unsigned int j = 0; j < i; j++) {
+            if (hashes[j] != hashes[i] &&
+                (hashes[j] & (VL_COALESCE_SLOTS - 1)) == (hashes[i] & (VL_COALESCE_SLOTS - 1))) {
+                snprintf(names[0], sizeof(names[0]), "h%u.calibrate.test", j);
+                snprintf(names[1], sizeof(names[1]), "H%u.Calibrate.TEST", j);
+                break;
+            }
+        }
+    }
+    cr_assert(names[0][0] != '\0');
+    query_clean(&q);
+    response_cache_clean(&cache);
+
+    /* Second client asks first client's question, with other case. */
+    vl_replay_init(&replay, cfg.udp_listener_port, 3);
+    for (uint32_t i = 0; i < 3; i++) {
+        cr_assert(vl_replay_query_add(&replay, i + 1, names[i], rip_ns_t_a) == 0);
+    }
+    vl_replay_capture(&replay, 3);
+    vl_replay_reset(&replay, 3);
+    misses    = m->dns.response_cache_misses;
+    coalesced = m->dns.response_cache_coalesced;
+    vl_replay_run(cal.vl, &replay);
+
+    cr_assert(replay.responses == 3);
+    cr_assert(replay.captured == 3);
+    cr_assert(m->dns.response_cache_misses - misses == 2);
+    cr_assert(m->dns.response_cache_coalesced - coalesced == 1);
+
+    for (size_t i = 0; i < 3; i++) {
+        rip_ns_header_t *hdr = (rip_ns_header_t *)(replay.capture + i * VL_REPLAY_CAPTURE_LEN);
+
+        cr_assert(ntohs(hdr->id) == i + 1);
+        cr_assert(hdr->rcode == rip_ns_r_noerror);
+        cr_assert(ntohs(hdr->ancount) == 1);
+    }
+
+    /* Coalesced response carries question as second client asked it. */
+    cr_assert(rip_ns_name_pton((const unsigned char *)names[1], qname, sizeof(qname)) >= 0);
+    while (qname[qname_len] != 0) {
+        qname_len += qname[qname_len] + 1;
+    }
+    cr_assert(memcmp(replay.capture + VL_REPLAY_CAPTURE_LEN + sizeof(rip_ns_header_t),
+                     qname, qname_len) == 0);
+
+    vl_replay_clean(&replay);
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,71 @@
+/**
+ * @file test_vectorloop_drain.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vldrain_ut Vectorloop drain
+ *
+ * @brief Vectorloop drain unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "vectorloop_drain.h"
+
+/**! @cond */
+TestSuite(vldrain);
+/**! @endcond */
+
+/** Test drain start wakes registered vectorloops up once, and vectorloops
+ * drained are counted.
+ */
+Test(vldrain, test_vl_drain_start) {
+    vl_drain_t d;
+    int        wake_fd = eventfd(0, EFD_NONBLOCK);
+    eventfd_t  value;
+
+    cr_assert(wake_fd > -1);
+    vl_drain_init(&d, 3);
+    vl_drain_register(&d, 1, wake_fd);
+    cr_assert(!vl_drain_started(&d));
+
+    vl_drain_start(&d);
+    cr_assert(vl_drain_started(&d));
+    cr_assert(eventfd_read(wake_fd, &value) == 0 && value == 1);
+
+    /* Started once. */
+    vl_drain_start(&d);
+    cr_assert(eventfd_read(wake_fd, &value) == -1);
+
+    cr_assert(vl_drain_count(&d) == 0);
+    vl_drain_done(&d);
+    vl_drain_done(&d);
+    cr_assert(vl_drain_count(&d) == 2);
+
+    vl_drain_clean(&d);
+    close(wake_fd);
+}
+
+/** @}*/
@@ -0,0 +1,141 @@
+/**
+ * @file test_vectorloop_handoff.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlhandoff_ut Vectorloop TCP connection handoff
+ *
+ * @brief Vectorloop TCP connection handoff unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "vectorloop_handoff.h"
+
+/**! @cond */
+TestSuite(vlhandoff);
+
+/** Initialize handoff state for vectorloops with roles given. */
+static void
+test_vl_handoff_init(vl_handoff_t *h, uint8_t *roles, size_t count)
+{
+    config_t cfg;
+    uint8_t *cfg_roles;
+
+    config_init(&cfg);
+    cfg_roles                = cfg.process_thread_roles;
+    cfg.process_thread_count = count;
+    cfg.process_thread_roles = roles;
+    vl_handoff_init(h, &cfg);
+    cfg.process_thread_roles = cfg_roles;
+    config_clean(&cfg);
+}
+/**! @endcond */
+
+/** Test target is least loaded TCP vectorloop with room for connections,
+ * and stale load is taken as 0.
+ */
+Test(vlhandoff, test_vl_handoff_target) {
+    vl_handoff_t h;
+    uint8_t      roles[4] = { VL_ROLES_ALL, VL_ROLES_ALL,
+                              VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6, VL_ROLE_TCP_IPV4 };
+    uint64_t     load     = 0;
+
+    test_vl_handoff_init(&h, roles, 4);
+
+    vl_handoff_publish(&h, 0, 1000, 10, 1000);
+    vl_handoff_publish(&h, 1, 300, 10, 1000);
+    vl_handoff_publish(&h, 2, 0, 0, 1000);
+    vl_handoff_publish(&h, 3, 200, 10, 1000);
+
+    /* Vectorloop 2 runs no TCP listeners. */
+    cr_assert(vl_handoff_target(&h, 0, 100, 1000, &load) == 3);
+    cr_assert(load == 200);
+    cr_assert(vl_handoff_target(&h, 3, 100, 1000, &load) == 1);
+    cr_assert(load == 300);
+
+    /* Vectorloop 3 has no room for more connections. */
+    vl_handoff_publish(&h, 3, 200, 100, 1000);
+    cr_assert(vl_handoff_target(&h, 0, 100, 1000, &load) == 1);
+
+    /* Vectorloop 1 load is stale, it is blocked waiting for events. */
+    vl_handoff_publish(&h, 0, 1000, 10, 1000 + 3 * VL_HANDOFF_PERIOD_MS);
+    cr_assert(vl_handoff_target(&h, 0, 100, 1000 + 3 * VL_HANDOFF_PERIOD_MS, &load) == 1);
+    cr_assert(load == 0);
+
+    /* Only TCP vectorloop other than self has no room. */
+    vl_handoff_publish(&h, 1, 300, 100, 1000);
+    cr_assert(vl_handoff_target(&h, 0, 100, 1000, &load) == -1);
+
+    vl_handoff_clean(&h);
+}
+
+/** Test connections sent are received by vectorloop they were sent to, and
+ * vectorloop is woken up.
+ */
+Test(vlhandoff, test_vl_handoff_send_recv) {
+    vl_handoff_t       h;
+    uint8_t            roles[3] = { VL_ROLES_ALL, VL_ROLES_ALL, VL_ROLES_ALL };
+    channel_conn_msg_t msg      = {};
+    channel_conn_msg_t msgs[4];
+    int                wake_fd  = eventfd(0, EFD_NONBLOCK);
+    eventfd_t          value;
+
+    cr_assert(wake_fd > -1);
+    test_vl_handoff_init(&h, roles, 3);
+    vl_handoff_register(&h, 2, wake_fd);
+
+    cr_assert(vl_handoff_recv(&h, 2, msgs, 4) == 0);
+    for (int i = 0; i < 3; i++) {
+        msg.fd = 10 + i;
+        cr_assert(vl_handoff_send(&h, 0, 2, &msg));
+        msg.fd = 20 + i;
+        cr_assert(vl_handoff_send(&h, 1, 2, &msg));
+    }
+    vl_handoff_wake(&h, 2);
+    cr_assert(eventfd_read(wake_fd, &value) == 0 && value == 1);
+
+    /* Nothing was sent to vectorloop 1. */
+    cr_assert(vl_handoff_recv(&h, 1, msgs, 4) == 0);
+
+    /* Receive array fills up, rest is received on next call. */
+    cr_assert(vl_handoff_recv(&h, 2, msgs, 4) == 4);
+    cr_assert(msgs[0].fd == 10 && msgs[2].fd == 12 && msgs[3].fd == 20);
+    cr_assert(vl_handoff_recv(&h, 2, msgs, 4) == 2);
+    cr_assert(msgs[0].fd == 21 && msgs[1].fd == 22);
+    cr_assert(vl_handoff_recv(&h, 2, msgs, 4) == 0);
+
+    /* Channel full, sender keeps connection. */
+    for (int i = 0; i < CHANNEL_CONN_QUEUE_LEN; i++) {
+        cr_assert(vl_handoff_send(&h, 0, 1, &msg));
+    }
+    cr_assert(!vl_handoff_send(&h, 0, 1, &msg));
+
+    vl_handoff_clean(&h);
+    close(wake_fd);
+}
+
+/** @}*/
@@ -0,0 +1,158 @@
+/**
+ * @file test_vectorloop_mirror.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlmirror_ut Vectorloop UDP query mirroring
+ *
+ * @brief Vectorloop UDP query mirroring unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vectorloop_mirror.h"
+
+/**! @cond */
+TestSuite(vlmirror);
+/**! @endcond */
+
+/** Open UDP socket bound to an ephemeral loopback port, standing in for
+ * shadow server.
+ *
+ * @param port Where to store port socket is bound to.
+ *
+ * @return     Returns socket.
+ */
+static int
+test_vl_mirror_shadow(uint16_t *port)
+{
+    struct sockaddr_in addr     = { .sin_family = AF_INET };
+    socklen_t          addr_len = sizeof(addr);
+    struct timeval     tv       = { .tv_sec = 1 };
+    int                fd       = socket(AF_INET, SOCK_DGRAM, 0);
+
+    cr_assert(fd >= 0);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    cr_assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    cr_assert(getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0);
+    cr_assert(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0);
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/** Test datagrams added are sent to shadow server, with received length and
+ * contents of request buffers, one in sample rate of them, and nothing is
+ * sent before flush.
+ */
+Test(vlmirror, test_vl_mirror_flush) {
+    vl_mirror_t     m;
+    struct mmsghdr  msgs[6]    = {};
+    struct iovec    iovs[6];
+    char            bufs[6][64];
+    char            recv_buf[64];
+    char            err[128];
+    uint16_t        port;
+    int             shadow     = test_vl_mirror_shadow(&port);
+
+    for (int i = 0; i < 6; i++) {
+        memset(bufs[i], 'a' + i, sizeof(bufs[i]));
+        iovs[i].iov_base           = bufs[i];
+        iovs[i].iov_len            = sizeof(bufs[i]);
+        msgs[i].msg_hdr.msg_iov    = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_len            = 10 + i;
+    }
+
+    /* All datagrams. */
+    cr_assert(vl_mirror_init(&m, "127.0.0.1", port, 1, err, sizeof(err)) == 0, "%s", err);
+    vl_mirror_add(&m, msgs, 3);
+    cr_assert(m.count == 3);
+    cr_assert(recv(shadow, recv_buf, sizeof(recv_buf), MSG_DONTWAIT) < 0);
+    cr_assert(vl_mirror_flush(&m) == 3);
+    cr_assert(m.count == 0 && m.sent == 3 && m.dropped == 0);
+    for (int i = 0; i < 3; i++) {
+        cr_assert(recv(shadow, recv_buf, sizeof(recv_buf), 0) == 10 + i);
+        cr_assert(recv_buf[0] == 'a' + i && recv_buf[9 + i] == 'a' + i);
+    }
+    vl_mirror_clean(&m);
+    cr_assert(m.fd == -1);
+
+    /* One in three datagrams, sampling continues across adds. */
+    cr_assert(vl_mirror_init(&m, "127.0.0.1", port, 3, err, sizeof(err)) == 0, "%s", err);
+    vl_mirror_add(&m, msgs, 4);
+    vl_mirror_add(&m, msgs + 4, 2);
+    cr_assert(m.count == 2);
+    cr_assert(vl_mirror_flush(&m) == 2);
+    cr_assert(recv(shadow, recv_buf, sizeof(recv_buf), 0) == 12);
+    cr_assert(recv_buf[0] == 'c');
+    cr_assert(recv(shadow, recv_buf, sizeof(recv_buf), 0) == 15);
+    cr_assert(recv_buf[0] == 'f');
+    vl_mirror_clean(&m);
+
+    close(shadow);
+}
+
+/** Test send vector that fills up is sent right away, and invalid address
+ * leaves mirror disabled.
+ */
+Test(vlmirror, test_vl_mirror_full) {
+    vl_mirror_t     m;
+    struct mmsghdr  msg        = {};
+    struct iovec    iov;
+    char            buf[16]    = "query";
+    char            recv_buf[16];
+    char            err[128];
+    uint16_t        port;
+    int             shadow     = test_vl_mirror_shadow(&port);
+    int             received   = 0;
+
+    iov.iov_base           = buf;
+    iov.iov_len            = sizeof(buf);
+    msg.msg_hdr.msg_iov    = &iov;
+    msg.msg_hdr.msg_iovlen = 1;
+    msg.msg_len            = 5;
+
+    cr_assert(vl_mirror_init(&m, "127.0.0.1", port, 1, err, sizeof(err)) == 0, "%s", err);
+    for (int i = 0; i < VL_MIRROR_VECTOR_LEN + 1; i++) {
+        vl_mirror_add(&m, &msg, 1);
+    }
+    cr_assert(m.count == 1);
+    cr_assert(m.sent + m.dropped == VL_MIRROR_VECTOR_LEN);
+    while (recv(shadow, recv_buf, sizeof(recv_buf), MSG_DONTWAIT) == 5) {
+        received++;
+    }
+    /* Shadow server receive buffer may not hold all of them. */
+    cr_assert(received > 0 && received <= m.sent);
+    vl_mirror_clean(&m);
+    close(shadow);
+
+    cr_assert(vl_mirror_init(&m, "shadow", 53, 1, err, sizeof(err)) == -1);
+    cr_assert(m.fd == -1);
+    cr_assert(strstr(err, "invalid shadow server address") != NULL);
+}
+
+/** @}*/
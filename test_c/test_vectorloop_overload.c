@@ -0,0 +1,131 @@
+/**
+ * @file test_vectorloop_overload.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vloverload_ut Vectorloop overload control
+ *
+ * @brief Vectorloop overload control unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include "vectorloop_overload.h"
+
+/**! @cond */
+TestSuite(vloverload);
+/**! @endcond */
+
+/** Test each overload signal raises overload level one level per period,
+ * up to highest level, and level is lowered one level per calm run of
+ * periods.
+ */
+Test(vloverload, test_vl_overload_update) {
+    vl_overload_t o;
+    uint64_t      now = 1000;
+
+    vl_overload_init(&o, 500, 2, now);
+    cr_assert(o.level == VL_OVERLOAD_NONE);
+
+    /* Period not over yet. */
+    vl_overload_drops(&o, 3);
+    cr_assert(!vl_overload_update(&o, now + VL_OVERLOAD_PERIOD_MS - 1));
+    cr_assert(o.level == VL_OVERLOAD_NONE);
+
+    /* Kernel drops. */
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_LOG);
+
+    /* Mean busy iteration time over limit, single long one is not. */
+    vl_overload_iteration(&o, 2000 * 1000);
+    for (int i = 0; i < 9; i++) {
+        vl_overload_iteration(&o, 100 * 1000);
+    }
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_LOG);
+    for (int i = 0; i < 10; i++) {
+        vl_overload_iteration(&o, 501 * 1000);
+    }
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_QTYPES);
+
+    /* Most reads full. */
+    vl_overload_read(&o, true);
+    vl_overload_read(&o, true);
+    vl_overload_read(&o, false);
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_CLIENTS);
+
+    /* Highest level. */
+    vl_overload_drops(&o, 1);
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_CLIENTS);
+
+    /* Calm periods lower level one by one, overloaded period starts calm
+     * run over.
+     */
+    for (int i = 0; i < VL_OVERLOAD_CALM_PERIODS - 1; i++) {
+        vl_overload_read(&o, true);
+        vl_overload_read(&o, false);
+        now += VL_OVERLOAD_PERIOD_MS;
+        cr_assert(vl_overload_update(&o, now));
+        cr_assert(o.level == VL_OVERLOAD_SHED_CLIENTS);
+    }
+    vl_overload_drops(&o, 1);
+    now += VL_OVERLOAD_PERIOD_MS;
+    cr_assert(vl_overload_update(&o, now));
+    cr_assert(o.level == VL_OVERLOAD_SHED_CLIENTS);
+
+    for (int level = VL_OVERLOAD_SHED_CLIENTS; level > VL_OVERLOAD_NONE; level--) {
+        for (int i = 0; i < VL_OVERLOAD_CALM_PERIODS; i++) {
+            cr_assert(o.level == level);
+            now += VL_OVERLOAD_PERIOD_MS;
+            cr_assert(vl_overload_update(&o, now));
+        }
+    }
+    cr_assert(o.level == VL_OVERLOAD_NONE);
+}
+
+/** Test every slip-th query shed by client is slipped. */
+Test(vloverload, test_vl_overload_slip) {
+    vl_overload_t o;
+    int           slipped = 0;
+
+    vl_overload_init(&o, 500, 3, 0);
+    for (int i = 0; i < 9; i++) {
+        slipped += vl_overload_slip(&o);
+    }
+    cr_assert(slipped == 3);
+
+    vl_overload_init(&o, 500, 0, 0);
+    for (int i = 0; i < 9; i++) {
+        cr_assert(!vl_overload_slip(&o));
+    }
+}
+
+/** @}*/
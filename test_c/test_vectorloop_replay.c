@@ -0,0 +1,247 @@
+/**
+ * @file test_vectorloop_replay.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlreplay_ut Vectorloop replay
+ *
+ * @brief Vectorloop replay unit tests
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <criterion/criterion.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "config.h"
+#include "vectorloop_replay.h"
+#include "vectorloop_xdp.h"
+
+/**! @cond */
+TestSuite(vlreplay);
+/**! @endcond */
+
+/** Write pcap record with IPv4 UDP datagram from client port to port, as
+ * Ethernet frame or raw IP packet.
+ *
+ * @param f     File to write to.
+ * @param raw   Whether to write raw IP packet instead of Ethernet frame.
+ * @param sport Client port.
+ * @param port  Destination port.
+ * @param id    Payload byte, payload is 12 of them.
+ */
+static void
+test_vl_replay_record_write(FILE *f, bool raw, uint16_t sport, uint16_t port, uint8_t id)
+{
+    unsigned char      frame[256]                                      = {};
+    unsigned char      macs[VL_XDP_MACS_LEN]                           = {};
+    unsigned char      control[CMSG_SPACE(sizeof(struct in_pktinfo))] = {};
+    unsigned char      payload[12];
+    uint32_t           rec[4]                                          = {};
+    struct sockaddr_in client                                          = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(port),
+    };
+    struct msghdr      msg                                             = {
+        .msg_name       = &client,
+        .msg_namelen    = sizeof(client),
+        .msg_control    = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct cmsghdr    *cmsg = CMSG_FIRSTHDR(&msg);
+    struct in_pktinfo *pi   = (struct in_pktinfo *)CMSG_DATA(cmsg);
+    int                len  = 0;
+    size_t             skip = raw ? VL_XDP_ETH_HLEN : 0;
+
+    /* Frame is built as a response from sport, to port. */
+    memset(payload, id, sizeof(payload));
+    inet_pton(AF_INET, "192.0.2.1", &client.sin_addr);
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type  = IP_PKTINFO;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in_pktinfo));
+    inet_pton(AF_INET, "198.51.100.1", &pi->ipi_spec_dst);
+    len = vl_xdp_frame_build(frame, sizeof(frame), sport, &msg, macs, payload, sizeof(payload));
+    cr_assert(len > 0);
+
+    rec[2] = len - skip;
+    rec[3] = len - skip;
+    cr_assert(fwrite(rec, sizeof(rec), 1, f) == 1);
+    cr_assert(fwrite(frame + skip, len - skip, 1, f) == 1);
+}
+
+/** Write pcap file with three queries to port 53 and a datagram to another
+ * port in between.
+ *
+ * @param path      Path template of file, see mkstemp().
+ * @param link_type Link type, 1 for Ethernet or 101 for raw IP.
+ */
+static void
+test_vl_replay_pcap_write(char *path, uint32_t link_type)
+{
+    uint32_t hdr[6] = { 0xa1b2c3d4, 2 | 4 << 16, 0, 0, 65535, link_type };
+    int      fd     = mkstemp(path);
+    FILE    *f      = fdopen(fd, "wb");
+
+    cr_assert(f != NULL);
+    cr_assert(fwrite(hdr, sizeof(hdr), 1, f) == 1);
+    test_vl_replay_record_write(f, link_type == 101, 40000, 53, 1);
+    test_vl_replay_record_write(f, link_type == 101, 40001, 54, 9);
+    test_vl_replay_record_write(f, link_type == 101, 40002, 53, 2);
+    test_vl_replay_record_write(f, link_type == 101, 40003, 53, 3);
+    fclose(f);
+}
+
+/** Test only UDP datagrams to replay port are loaded, for Ethernet and raw
+ * IP link types, and files that are not pcap files are rejected.
+ */
+Test(vlreplay, test_vl_replay_load) {
+    char        path[]   = "/tmp/test_vl_replay_XXXXXX";
+    char        err[256] = {};
+    vl_replay_t replay;
+    uint32_t    link_types[] = { 1, 101 };
+
+    for (size_t i = 0; i < sizeof(link_types) / sizeof(link_types[0]); i++) {
+        strcpy(path, "/tmp/test_vl_replay_XXXXXX");
+        test_vl_replay_pcap_write(path, link_types[i]);
+        cr_assert(vl_replay_load(&replay, path, 53, err, sizeof(err)) == 0, "%s", err);
+        cr_assert(replay.frame_count == 3);
+        cr_assert(replay.port == 53);
+        vl_replay_clean(&replay);
+        cr_assert(replay.frames == NULL);
+
+        /* No datagrams to port. */
+        cr_assert(vl_replay_load(&replay, path, 5353, err, sizeof(err)) == -1);
+        unlink(path);
+    }
+
+    cr_assert(vl_replay_load(&replay, "/nonexistent/test.pcap", 53, err, sizeof(err)) == -1);
+    cr_assert(vl_replay_load(&replay, "/proc/self/status", 53, err, sizeof(err)) == -1);
+}
+
+/** Test frames are read into read vector in a loop until requested number of
+ * queries was replayed, and responses in write vector are counted.
+ */
+Test(vlreplay, test_vl_replay_recv_send) {
+    char                path[]   = "/tmp/test_vl_replay_XXXXXX";
+    char                err[256] = {};
+    config_t            cfg;
+    arena_t             arena;
+    conn_udp_t         *conn_udp;
+    vl_replay_t         replay;
+    struct sockaddr_in *sin;
+
+    config_init(&cfg);
+    cfg.udp_conn_vector_len = 4;
+    cr_assert(arena_init(&arena, conn_udp_arena_size(&cfg), 0) == 0);
+    conn_udp = conn_udp_new(&cfg, AF_INET, &arena);
+
+    test_vl_replay_pcap_write(path, 1);
+    cr_assert(vl_replay_load(&replay, path, 53, err, sizeof(err)) == 0, "%s", err);
+    unlink(path);
+    vl_replay_reset(&replay, 6);
+
+    /* Frames wrap around, read is limited to vector length. */
+    cr_assert(vl_replay_recv(&replay, conn_udp, 8) == 4);
+    cr_assert(conn_udp->read_vector[0].msg_len == 12);
+    cr_assert(conn_udp->queries[0].request_buffer[0] == 1);
+    cr_assert(conn_udp->queries[1].request_buffer[0] == 2);
+    cr_assert(conn_udp->queries[2].request_buffer[0] == 3);
+    cr_assert(conn_udp->queries[3].request_buffer[0] == 1);
+    sin = (struct sockaddr_in *)conn_udp->read_vector[1].msg_hdr.msg_name;
+    cr_assert(sin->sin_family == AF_INET);
+    cr_assert(sin->sin_port == htons(40002));
+
+    /* Read is limited to queries left to replay, then replay is done. */
+    conn_udp->read_vector_count = 4;
+    conn_udp_vectors_reset(conn_udp);
+    cr_assert(vl_replay_recv(&replay, conn_udp, 4) == 2);
+    cr_assert(conn_udp->queries[0].request_buffer[0] == 2);
+    cr_assert(vl_replay_recv(&replay, conn_udp, 4) == -1);
+    cr_assert(errno == EAGAIN);
+    cr_assert(replay.queries == 6);
+
+    /* Responses are counted, a GSO message counts each of its segments. */
+    conn_udp->write_vector_count                 = 2;
+    conn_udp->write_vector_write_index           = 0;
+    conn_udp->write_vector[0].msg_hdr.msg_iovlen = 1;
+    conn_udp->write_vector[1].msg_hdr.msg_iov    = &conn_udp->write_iov[1];
+    conn_udp->write_vector[1].msg_hdr.msg_iovlen = 2;
+    conn_udp->write_iov[0].iov_len               = 30;
+    conn_udp->write_iov[1].iov_len               = 40;
+    conn_udp->write_iov[2].iov_len               = 50;
+    cr_assert(vl_replay_send(&replay, conn_udp) == 2);
+    cr_assert(replay.responses == 3);
+    cr_assert(replay.response_bytes == 120);
+
+    vl_replay_clean(&replay);
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** Test queries built in memory are read as datagrams from client they were
+ * added for, and are not added past frames_max or with invalid name.
+ */
+Test(vlreplay, test_vl_replay_query_add) {
+    config_t            cfg;
+    arena_t             arena;
+    conn_udp_t         *conn_udp;
+    vl_replay_t         replay;
+    struct sockaddr_in *sin;
+    unsigned char      *p;
+
+    config_init(&cfg);
+    cfg.udp_conn_vector_len = 4;
+    cr_assert(arena_init(&arena, conn_udp_arena_size(&cfg), 0) == 0);
+    conn_udp = conn_udp_new(&cfg, AF_INET, &arena);
+
+    vl_replay_init(&replay, 53, 2);
+    cr_assert(vl_replay_query_add(&replay, 0x010203, "www.example.com", 28) == 0);
+    cr_assert(vl_replay_query_add(&replay, 5, "a..b", 1) == -1);
+    cr_assert(vl_replay_query_add(&replay, 5, "example.com", 1) == 0);
+    cr_assert(vl_replay_query_add(&replay, 6, "example.com", 1) == -1);
+    cr_assert(replay.frame_count == 2);
+
+    vl_replay_reset(&replay, 2);
+    cr_assert(vl_replay_recv(&replay, conn_udp, 4) == 2);
+    cr_assert(conn_udp->read_vector[0].msg_len == 12 + 17 + 4);
+    sin = (struct sockaddr_in *)conn_udp->read_vector[0].msg_hdr.msg_name;
+    cr_assert(sin->sin_family == AF_INET);
+    cr_assert(sin->sin_addr.s_addr == htonl(0x0a010203));
+    cr_assert(sin->sin_port == htons(1024 + 0x0203));
+    p = conn_udp->queries[0].request_buffer;
+    cr_assert(p[0] == 0x02 && p[1] == 0x03);
+    cr_assert(p[4] == 0 && p[5] == 1);
+    cr_assert(memcmp(p + 12, "\3www\7example\3com\0\0\34\0\1", 21) == 0);
+    cr_assert(conn_udp->read_vector[1].msg_len == 12 + 13 + 4);
+
+    vl_replay_clean(&replay);
+    arena_clean(&arena);
+    config_clean(&cfg);
+}
+
+/** @}*/
@@ -0,0 +1,288 @@
+/**
+ * @file test_vectorloop_reuseport.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlreuseport_ut Vectorloop reuseport steering
+ *
+ * @brief Vectorloop reuseport steering unit tests
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+#include "vectorloop_reuseport.h"
+
+/**! @cond */
+TestSuite(vlreuseport);
+/**! @endcond */
+
+/** Write softirqs file with NET_RX counters given.
+ *
+ * @param path   Path of file to write.
+ * @param net_rx NET_RX line counters.
+ */
+static void
+test_vl_reuseport_softirqs_write(const char *path, const char *net_rx)
+{
+    FILE *f = fopen(path, "w");
+
+    cr_assert(f != NULL);
+    fprintf(f, "                    CPU0       CPU1       CPU2       CPU3\n"
+               "          HI:          1          0          0          0\n"
+               "      NET_TX:         10         11         12         13\n"
+               "      NET_RX:%s\n"
+               "       BLOCK:          5          5          5          5\n", net_rx);
+    fclose(f);
+}
+
+/** Test CPUs with network receive interrupts are found in softirqs file. */
+Test(vlreuseport, test_vl_reuseport_rx_cpus) {
+    char          path[]     = "/tmp/test_vl_reuseport_softirqs_XXXXXX";
+    unsigned char rx_cpus[4] = {};
+    int           fd         = mkstemp(path);
+
+    cr_assert(fd >= 0);
+    close(fd);
+
+    test_vl_reuseport_softirqs_write(path, "       100          0    1234567          0");
+    cr_assert(vl_reuseport_rx_cpus(path, rx_cpus, 4) == 4);
+    cr_assert(rx_cpus[0] == 1 && rx_cpus[1] == 0 && rx_cpus[2] == 1 && rx_cpus[3] == 0);
+
+    /* More CPUs in file than array holds. */
+    memset(rx_cpus, 0xff, sizeof(rx_cpus));
+    cr_assert(vl_reuseport_rx_cpus(path, rx_cpus, 2) == 4);
+    cr_assert(rx_cpus[0] == 1 && rx_cpus[1] == 0 && rx_cpus[2] == 0xff);
+
+    unlink(path);
+    cr_assert(vl_reuseport_rx_cpus(path, rx_cpus, 4) == -1);
+}
+
+/** Test steering configuration check warns about unbound vectorloops,
+ * vectorloops sharing a CPU and receive CPUs without a vectorloop.
+ */
+Test(vlreuseport, test_vl_reuseport_config_check) {
+    char     path[]   = "/tmp/test_vl_reuseport_softirqs_XXXXXX";
+    size_t   masks[3] = { 1, 2, 3 };
+    config_t cfg      = {
+        .process_thread_count = 3,
+        .process_thread_masks = masks,
+    };
+    FILE    *out      = fopen("/dev/null", "w");
+    int      fd       = mkstemp(path);
+
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(out != NULL);
+
+    /* Vectorloops on CPU 0, 1 and 2 which are the receive CPUs. */
+    test_vl_reuseport_softirqs_write(path, "         1          1          1          0");
+    cr_assert(vl_reuseport_config_check(&cfg, 4, path, out) == 0);
+
+    /* CPU 3 takes receive interrupts too. */
+    test_vl_reuseport_softirqs_write(path, "         1          1          1          1");
+    cr_assert(vl_reuseport_config_check(&cfg, 4, path, out) == 1);
+
+    /* Vectorloop 1 not bound, vectorloop 2 shares CPU 0 with vectorloop 0,
+     * so CPUs 1, 2 and 3 have no vectorloop.
+     */
+    masks[1] = 0;
+    masks[2] = 1;
+    cr_assert(vl_reuseport_config_check(&cfg, 4, path, out) == 5);
+
+    /* Vectorloop bound to CPU that does not exist. */
+    masks[1] = 9;
+    masks[2] = 2;
+    test_vl_reuseport_softirqs_write(path, "         1          1          0          0");
+    cr_assert(vl_reuseport_config_check(&cfg, 4, path, out) == 1);
+
+    fclose(out);
+    unlink(path);
+}
+
+/** Test datagrams are steered to socket joined at index of CPU they are
+ * processed on, loopback datagrams are processed on CPU that sent them.
+ */
+Test(vlreuseport, test_vl_reuseport_join) {
+    vl_reuseport_t     rp;
+    char               err_buf[256];
+    int                fds[2]   = { -1, -1 };
+    int                one      = 1;
+    unsigned int       cpus     = get_nprocs_conf();
+    int                cpu      = sched_getcpu();
+    cpu_set_t          cpu_set;
+    struct sockaddr_in addr     = {
+        .sin_family = AF_INET,
+        .sin_addr   = { htonl(INADDR_LOOPBACK) },
+    };
+    socklen_t          addr_len = sizeof(addr);
+    char               buf[8];
+
+    if (vl_reuseport_load(&rp, cpus, err_buf, sizeof(err_buf)) != 0) {
+        /* BPF not available in this environment. */
+        return;
+    }
+
+    /* Stay on one CPU while sending. */
+    cr_assert(cpu >= 0);
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    cr_assert(sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0);
+
+    for (int i = 0; i < 2; i++) {
+        fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        cr_assert(fds[i] >= 0);
+        cr_assert(setsockopt(fds[i], SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0);
+        cr_assert(bind(fds[i], (struct sockaddr *)&addr, addr_len) == 0);
+        if (i == 0) {
+            cr_assert(getsockname(fds[0], (struct sockaddr *)&addr, &addr_len) == 0);
+        }
+    }
+    cr_assert(vl_reuseport_join(&rp, VL_REUSEPORT_UDP_IPV4, fds[0], cpus) == -EINVAL);
+
+    /* Each socket in turn owns sending CPU and gets all datagrams. */
+    for (int owner = 0; owner < 2; owner++) {
+        cr_assert(vl_reuseport_join(&rp, VL_REUSEPORT_UDP_IPV4, fds[owner], cpu) == 0);
+        for (int i = 0; i < 16; i++) {
+            cr_assert(sendto(fds[1 - owner], "x", 1, 0, (struct sockaddr *)&addr,
+                             addr_len) == 1);
+        }
+        for (int i = 0; i < 16; i++) {
+            cr_assert(recv(fds[owner], buf, sizeof(buf), MSG_DONTWAIT) == 1);
+        }
+        cr_assert(recv(fds[owner], buf, sizeof(buf), MSG_DONTWAIT) == -1);
+        cr_assert(recv(fds[1 - owner], buf, sizeof(buf), MSG_DONTWAIT) == -1);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    vl_reuseport_clean(&rp);
+}
+
+/** Test client steering slots are ranks of vectorloops running group
+ * listeners.
+ */
+Test(vlreuseport, test_vl_reuseport_client_slot) {
+    uint8_t  roles[4] = { VL_ROLES_ALL, VL_ROLE_TCP_IPV4, VL_ROLE_UDP_IPV4,
+                          VL_ROLE_UDP_IPV4 | VL_ROLE_UDP_IPV6 };
+    config_t cfg      = {
+        .process_thread_count = 4,
+        .process_thread_roles = roles,
+    };
+
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_UDP_IPV4, 0) == 0);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_UDP_IPV4, 2) == 1);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_UDP_IPV4, 3) == 2);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_UDP_IPV4, 4) == 3);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_UDP_IPV6, 4) == 2);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_TCP_IPV4, 4) == 2);
+    cr_assert(vl_reuseport_client_slot(&cfg, VL_REUSEPORT_TCP_IPV6, 4) == 1);
+}
+
+/** Test datagrams are steered to socket joined at slot picked by hash of
+ * client address prefix, whatever source port they are sent from.
+ */
+Test(vlreuseport, test_vl_reuseport_join_client) {
+    vl_reuseport_t     rp;
+    char               err_buf[256];
+    uint8_t            roles[2] = { VL_ROLES_ALL, VL_ROLES_ALL };
+    config_t           cfg      = {
+        .process_thread_count = 2,
+        .process_thread_roles = roles,
+    };
+    int                fds[2]   = { -1, -1 };
+    int                one      = 1;
+    struct sockaddr_in addr     = {
+        .sin_family = AF_INET,
+        .sin_addr   = { htonl(INADDR_LOOPBACK) },
+    };
+    socklen_t          addr_len = sizeof(addr);
+    char               buf[8];
+
+    for (int prefix_len = 24; prefix_len <= 32; prefix_len += 8) {
+        if (vl_reuseport_load_client(&rp, &cfg, prefix_len, 56, err_buf,
+                                     sizeof(err_buf)) != 0) {
+            /* BPF not available in this environment. */
+            return;
+        }
+        cr_assert(rp.entries[VL_REUSEPORT_UDP_IPV4] == 2);
+
+        addr.sin_port = 0;
+        for (int i = 0; i < 2; i++) {
+            fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+            cr_assert(fds[i] >= 0);
+            cr_assert(setsockopt(fds[i], SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0);
+            cr_assert(bind(fds[i], (struct sockaddr *)&addr, addr_len) == 0);
+            if (i == 0) {
+                cr_assert(getsockname(fds[0], (struct sockaddr *)&addr, &addr_len) == 0);
+            }
+            cr_assert(vl_reuseport_join(&rp, VL_REUSEPORT_UDP_IPV4, fds[i], i) == 0);
+        }
+        cr_assert(vl_reuseport_join(&rp, VL_REUSEPORT_UDP_IPV4, fds[0], 2) == -EINVAL);
+
+        /* Clients 127.0.0.1-8, each from new source ports. */
+        for (uint32_t client = 1; client <= 8; client++) {
+            struct sockaddr_in src  = {
+                .sin_family = AF_INET,
+                .sin_addr   = { htonl(INADDR_LOOPBACK - 1 + client) },
+            };
+            uint64_t           key  = 0;
+            int                slot = 0;
+
+            memcpy(&key, &src.sin_addr, sizeof(src.sin_addr));
+            key &= htonl(~0u << (32 - prefix_len));
+            slot = (((key * 0x9e3779b97f4a7c15ull) >> 32) * 2) >> 32;
+
+            for (int i = 0; i < 4; i++) {
+                int sender = socket(AF_INET, SOCK_DGRAM, 0);
+
+                cr_assert(sender >= 0);
+                cr_assert(bind(sender, (struct sockaddr *)&src, sizeof(src)) == 0);
+                cr_assert(sendto(sender, "x", 1, 0, (struct sockaddr *)&addr,
+                                 addr_len) == 1);
+                close(sender);
+            }
+            for (int i = 0; i < 4; i++) {
+                cr_assert(recv(fds[slot], buf, sizeof(buf), MSG_DONTWAIT) == 1);
+            }
+            cr_assert(recv(fds[slot], buf, sizeof(buf), MSG_DONTWAIT) == -1);
+            cr_assert(recv(fds[1 - slot], buf, sizeof(buf), MSG_DONTWAIT) == -1);
+        }
+
+        close(fds[0]);
+        close(fds[1]);
+        vl_reuseport_clean(&rp);
+    }
+}
+
+/** @}*/
@@ -0,0 +1,162 @@
+/**
+ * @file test_vectorloop_slo.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlslo_ut Vectorloop latency SLO
+ *
+ * @brief Vectorloop latency SLO tracker unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <string.h>
+
+#include "vectorloop_slo.h"
+
+/**! @cond */
+TestSuite(vlslo);
+/**! @endcond */
+
+/** Record queries of given latency, spread over two histograms the way
+ * vectorloop spreads them over protocols.
+ *
+ * @param hists      Two histograms.
+ * @param count      Number of queries.
+ * @param latency_ns Latency of each query.
+ */
+static void
+test_vl_slo_record(histogram_t *hists, int count, uint64_t latency_ns)
+{
+    for (int i = 0; i < count; i++) {
+        histogram_record(&hists[i % 2], latency_ns);
+    }
+}
+
+/** Test quantile enters breach when its window latency is above objective
+ * and leaves it once back within, window with too few queries is not
+ * evaluated, and quantiles without objective are never breached.
+ */
+Test(vlslo, test_vl_slo_update) {
+    histogram_t hists[2];
+    vl_slo_t    s;
+    uint64_t    objective_us[VL_SLO_QUANTILES] = { 0, 1000, 10000 };
+    uint64_t    now = 5000;
+    uint8_t     changed;
+
+    memset(hists, 0, sizeof(hists));
+    cr_assert(vl_slo_enabled(objective_us));
+    cr_assert(!vl_slo_enabled((uint64_t[VL_SLO_QUANTILES]){ 0 }));
+
+    /* Queries recorded before init are not counted. */
+    test_vl_slo_record(hists, 1000, 50 * 1000 * 1000);
+    cr_assert(vl_slo_init(&s, objective_us, 1, hists, 2, now) == 0);
+
+    /* Period not over yet. */
+    test_vl_slo_record(hists, 980, 100 * 1000);
+    test_vl_slo_record(hists, 20, 5 * 1000 * 1000);
+    cr_assert(!vl_slo_update(&s, hists, 2, now + VL_SLO_PERIOD_MS - 1, &changed));
+    cr_assert(changed == 0);
+
+    /* p99 is above objective, p999 within, p50 has none. */
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(s.queries == 1000);
+    cr_assert(changed == (1 << VL_SLO_P99));
+    cr_assert(s.breached == (1 << VL_SLO_P99));
+    cr_assert(s.latency_ns[VL_SLO_P50] >= 100 * 1000);
+    cr_assert(s.latency_ns[VL_SLO_P50] < 1000 * 1000);
+    cr_assert(s.latency_ns[VL_SLO_P99] > 1000 * 1000);
+    cr_assert(s.latency_ns[VL_SLO_P999] > 1000 * 1000);
+    cr_assert(s.latency_ns[VL_SLO_P999] <= 10 * 1000 * 1000);
+
+    /* Still breached, nothing changed. */
+    test_vl_slo_record(hists, 980, 100 * 1000);
+    test_vl_slo_record(hists, 20, 5 * 1000 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(changed == 0);
+    cr_assert(s.breached == (1 << VL_SLO_P99));
+
+    /* Too few queries, breach state is kept. */
+    test_vl_slo_record(hists, VL_SLO_QUERIES_MIN - 1, 100);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(changed == 0);
+    cr_assert(s.breached == (1 << VL_SLO_P99));
+
+    /* Back within objective, p999 breached. */
+    test_vl_slo_record(hists, 997, 100 * 1000);
+    test_vl_slo_record(hists, 3, 20 * 1000 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(changed == ((1 << VL_SLO_P99) | (1 << VL_SLO_P999)));
+    cr_assert(s.breached == (1 << VL_SLO_P999));
+
+    vl_slo_clean(&s);
+    cr_assert(s.snapshots == NULL);
+}
+
+/** Test window spans configured number of periods, and slow queries leave
+ * it once period they were recorded in rolls out.
+ */
+Test(vlslo, test_vl_slo_window) {
+    histogram_t hists[2];
+    vl_slo_t    s;
+    uint64_t    objective_us[VL_SLO_QUANTILES] = { 1000, 0, 0 };
+    uint64_t    now = 0;
+    uint8_t     changed;
+
+    memset(hists, 0, sizeof(hists));
+    cr_assert(vl_slo_init(&s, objective_us, 3, hists, 2, now) == 0);
+
+    /* Slow period breaches median. */
+    test_vl_slo_record(hists, 200, 5 * 1000 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(changed == (1 << VL_SLO_P50));
+
+    /* Fast periods, slow one still holds median up until it rolls out. */
+    test_vl_slo_record(hists, 90, 100 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(s.queries == 290);
+    cr_assert(changed == 0);
+
+    test_vl_slo_record(hists, 90, 100 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(s.queries == 380);
+    cr_assert(changed == 0);
+    cr_assert(s.breached == (1 << VL_SLO_P50));
+
+    test_vl_slo_record(hists, 90, 100 * 1000);
+    now += VL_SLO_PERIOD_MS;
+    cr_assert(vl_slo_update(&s, hists, 2, now, &changed));
+    cr_assert(s.queries == 270);
+    cr_assert(changed == (1 << VL_SLO_P50));
+    cr_assert(s.breached == 0);
+
+    vl_slo_clean(&s);
+}
+
+/** @}*/
@@ -0,0 +1,121 @@
+/**
+ * @file test_vectorloop_uring.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vluring_ut Vectorloop io_uring
+ *
+ * @brief Vectorloop io_uring unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "vectorloop_uring.h"
+
+/**! @cond */
+TestSuite(vluring);
+/**! @endcond */
+
+/** Test sendmsg submissions, including linked ones, and their completions. */
+Test(vluring, test_vl_uring_submit) {
+    vl_uring_t           ring;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    int                  stream_fd[2];
+    int                  sock_fd[2];
+    char                 buf[16]    = {};
+    char                 big[4096]  = {};
+    struct iovec         iov[2]     = {
+        { .iov_base = "abc", .iov_len = 3 },
+        { .iov_base = "de",  .iov_len = 2 },
+    };
+    struct msghdr        stream_msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    struct iovec         msg_iov    = { .iov_base = "xyz", .iov_len = 3 };
+    struct msghdr        msg        = { .msg_iov = &msg_iov, .msg_iovlen = 1 };
+    struct iovec         big_iov    = { .iov_base = big, .iov_len = sizeof(big) };
+    struct msghdr        big_msg    = { .msg_iov = &big_iov, .msg_iovlen = 1 };
+    int                  res[3]     = {};
+    int                  count      = 0;
+    int                  sndbuf     = 4096;
+
+    if (vl_uring_init(&ring, 4) < 0) {
+        /* io_uring not available in this environment. */
+        return;
+    }
+    cr_assert(ring.sq_entries == 4);
+    cr_assert(vl_uring_sq_space(&ring) == 4);
+
+    /* Single sendmsg of a two element vector. */
+    cr_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, stream_fd) == 0);
+    sqe = vl_uring_get_sqe(&ring);
+    vl_uring_prep_sendmsg(sqe, stream_fd[1], &stream_msg, 0, 7);
+    cr_assert(vl_uring_sq_space(&ring) == 3);
+    cr_assert(vl_uring_submit_and_wait(&ring) == 1);
+    cr_assert(vl_uring_sq_space(&ring) == 4);
+    cqe = vl_uring_peek_cqe(&ring);
+    cr_assert(cqe != NULL);
+    cr_assert(cqe->user_data == 7);
+    cr_assert(cqe->res == 5);
+    vl_uring_cqe_seen(&ring);
+    cr_assert(vl_uring_peek_cqe(&ring) == NULL);
+    cr_assert(read(stream_fd[0], buf, sizeof(buf)) == 5);
+    cr_assert(memcmp(buf, "abcde", 5) == 0);
+
+    /* Linked sendmsg, once one fails with EAGAIN the rest are cancelled. */
+    cr_assert(socketpair(AF_UNIX, SOCK_DGRAM, 0, sock_fd) == 0);
+    setsockopt(sock_fd[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    while (send(sock_fd[0], big, sizeof(big), MSG_DONTWAIT) > 0) {
+        /* Fill socket buffer. */
+    }
+    for (int i = 0; i < 3; i++) {
+        sqe = vl_uring_get_sqe(&ring);
+        vl_uring_prep_sendmsg(sqe, sock_fd[0], i == 0 ? &big_msg : &msg, 0, i);
+        if (i < 2) {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+    }
+    cr_assert(vl_uring_submit_and_wait(&ring) == 3);
+    while ((cqe = vl_uring_peek_cqe(&ring)) != NULL) {
+        res[cqe->user_data] = cqe->res;
+        count++;
+        vl_uring_cqe_seen(&ring);
+    }
+    cr_assert(count == 3);
+    cr_assert(res[0] == -EAGAIN);
+    cr_assert(res[1] == -ECANCELED);
+    cr_assert(res[2] == -ECANCELED);
+
+    close(stream_fd[0]);
+    close(stream_fd[1]);
+    close(sock_fd[0]);
+    close(sock_fd[1]);
+    vl_uring_clean(&ring);
+    cr_assert(ring.ring_fd == -1);
+}
+
+/** @}*/
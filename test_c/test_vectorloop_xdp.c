@@ -0,0 +1,335 @@
+/**
+ * @file test_vectorloop_xdp.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup vlxdp_ut Vectorloop AF_XDP
+ *
+ * @brief Vectorloop AF_XDP unit tests
+ *  @{
+ */
+#include <arpa/inet.h>
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "vectorloop_xdp.h"
+
+/**! @cond */
+TestSuite(vlxdp);
+/**! @endcond */
+
+/** Verify Internet checksum of buffer (including checksum it holds) is valid.
+ *
+ * @param buf Buffer.
+ * @param len Length of buffer.
+ * @param sum Pseudo header checksum to start with, 0 if none.
+ *
+ * @return    Returns true if checksum is valid.
+ */
+static bool
+test_vl_xdp_csum_ok(const unsigned char *buf, size_t len, uint32_t sum)
+{
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (uint32_t)buf[i] << 8 | buf[i + 1];
+    }
+    if (len & 1) {
+        sum += (uint32_t)buf[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return sum == 0xffff;
+}
+
+/** Test IPv4 response frame is built, and parsing it back yields same
+ * addresses and payload.
+ */
+Test(vlxdp, test_vl_xdp_frame_ipv4) {
+    unsigned char       frame[256]                             = {};
+    unsigned char       macs[VL_XDP_MACS_LEN]                  = { 1, 2, 3, 4, 5, 6,
+                                                                   7, 8, 9, 10, 11, 12 };
+    unsigned char       macs_parsed[VL_XDP_MACS_LEN]           = {};
+    unsigned char       control[CMSG_SPACE(sizeof(struct in_pktinfo))] = {};
+    unsigned char       control_parsed[64]                     = {};
+    unsigned char       payload[5]                             = "abcde";
+    unsigned char       payload_parsed[16]                     = {};
+    struct sockaddr_in  client                                 = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(40000),
+    };
+    struct sockaddr_storage client_parsed                      = {};
+    struct msghdr       msg                                    = {
+        .msg_name       = &client,
+        .msg_namelen    = sizeof(client),
+        .msg_control    = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct msghdr       msg_parsed                             = {
+        .msg_name       = &client_parsed,
+        .msg_namelen    = sizeof(client_parsed),
+        .msg_control    = control_parsed,
+        .msg_controllen = sizeof(control_parsed),
+    };
+    struct cmsghdr     *cmsg = CMSG_FIRSTHDR(&msg);
+    struct in_pktinfo  *pi   = (struct in_pktinfo *)CMSG_DATA(cmsg);
+    struct sockaddr_in *sin  = (struct sockaddr_in *)&client_parsed;
+    int                 len  = 0;
+
+    inet_pton(AF_INET, "192.0.2.1", &client.sin_addr);
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type  = IP_PKTINFO;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in_pktinfo));
+    inet_pton(AF_INET, "198.51.100.53", &pi->ipi_spec_dst);
+
+    len = vl_xdp_frame_build(frame, sizeof(frame), 53, &msg, macs, payload, 5);
+    cr_assert(len == VL_XDP_ETH_HLEN + 20 + 8 + 5);
+
+    /* MAC addresses are swapped, response goes back to where request came from. */
+    cr_assert(memcmp(frame, macs + 6, 6) == 0);
+    cr_assert(memcmp(frame + 6, macs, 6) == 0);
+    cr_assert(frame[12] == 0x08 && frame[13] == 0x00);
+
+    /* IPv4 header and UDP checksums. */
+    cr_assert(test_vl_xdp_csum_ok(frame + VL_XDP_ETH_HLEN, 20, 0));
+    cr_assert(test_vl_xdp_csum_ok(frame + VL_XDP_ETH_HLEN + 20, 8 + 5,
+                                  IPPROTO_UDP + 8 + 5 +
+                                  (0xc000 + 0x0201) + (0xc633 + 0x6435)));
+
+    /* Response is sent from port 53, so parsing it as sent to port 40000. */
+    cr_assert(vl_xdp_frame_parse(frame, len, 53, &msg_parsed, payload_parsed,
+                                 sizeof(payload_parsed), macs_parsed) == -1);
+    msg_parsed.msg_namelen    = sizeof(client_parsed);
+    msg_parsed.msg_controllen = sizeof(control_parsed);
+    cr_assert(vl_xdp_frame_parse(frame, len, 40000, &msg_parsed, payload_parsed,
+                                 sizeof(payload_parsed), macs_parsed) == 5);
+    cr_assert(memcmp(payload_parsed, "abcde", 5) == 0);
+    cr_assert(memcmp(macs_parsed, frame, VL_XDP_MACS_LEN) == 0);
+
+    /* Client is response source, local address is response destination. */
+    cr_assert(msg_parsed.msg_namelen == sizeof(struct sockaddr_in));
+    cr_assert(sin->sin_family == AF_INET);
+    cr_assert(sin->sin_port == htons(53));
+    cr_assert(memcmp(&sin->sin_addr, &pi->ipi_spec_dst, 4) == 0);
+    cmsg = CMSG_FIRSTHDR(&msg_parsed);
+    cr_assert(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO);
+    cr_assert(memcmp(&((struct in_pktinfo *)CMSG_DATA(cmsg))->ipi_spec_dst,
+                     &client.sin_addr, 4) == 0);
+
+    /* Payload is truncated to buffer size. */
+    msg_parsed.msg_namelen    = sizeof(client_parsed);
+    msg_parsed.msg_controllen = sizeof(control_parsed);
+    cr_assert(vl_xdp_frame_parse(frame, len, 40000, &msg_parsed, payload_parsed,
+                                 3, macs_parsed) == 3);
+
+    /* Frame buffer too small. */
+    cr_assert(vl_xdp_frame_build(frame, 40, 53, &msg, macs, payload, 5) == -1);
+}
+
+/** Test IPv6 response frame is built, and parsing it back yields same
+ * addresses and payload.
+ */
+Test(vlxdp, test_vl_xdp_frame_ipv6) {
+    unsigned char        frame[256]                    = {};
+    unsigned char        macs[VL_XDP_MACS_LEN]         = {};
+    unsigned char        macs_parsed[VL_XDP_MACS_LEN]  = {};
+    unsigned char        control[CMSG_SPACE(sizeof(struct in6_pktinfo))] = {};
+    unsigned char        control_parsed[64]            = {};
+    unsigned char        payload[7]                    = "ripples";
+    unsigned char        payload_parsed[16]            = {};
+    struct sockaddr_in6  client                        = {
+        .sin6_family = AF_INET6,
+        .sin6_port   = htons(40001),
+    };
+    struct sockaddr_storage client_parsed              = {};
+    struct msghdr        msg                           = {
+        .msg_name       = &client,
+        .msg_namelen    = sizeof(client),
+        .msg_control    = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct msghdr        msg_parsed                    = {
+        .msg_name       = &client_parsed,
+        .msg_namelen    = sizeof(client_parsed),
+        .msg_control    = control_parsed,
+        .msg_controllen = sizeof(control_parsed),
+    };
+    struct cmsghdr      *cmsg = CMSG_FIRSTHDR(&msg);
+    struct in6_pktinfo  *pi6  = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&client_parsed;
+    uint32_t             sum  = IPPROTO_UDP + 8 + 7;
+    int                  len  = 0;
+
+    inet_pton(AF_INET6, "2001:db8::1", &client.sin6_addr);
+    cmsg->cmsg_level = IPPROTO_IPV6;
+    cmsg->cmsg_type  = IPV6_PKTINFO;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in6_pktinfo));
+    inet_pton(AF_INET6, "2001:db8::53", &pi6->ipi6_addr);
+
+    len = vl_xdp_frame_build(frame, sizeof(frame), 53, &msg, macs, payload, 7);
+    cr_assert(len == VL_XDP_ETH_HLEN + 40 + 8 + 7);
+    cr_assert(frame[12] == 0x86 && frame[13] == 0xdd);
+    cr_assert(frame[VL_XDP_ETH_HLEN] == 0x60);
+    cr_assert(frame[VL_XDP_ETH_HLEN + 6] == IPPROTO_UDP);
+
+    /* UDP checksum, pseudo header holds both addresses. */
+    for (int i = 0; i < 32; i += 2) {
+        sum += frame[VL_XDP_ETH_HLEN + 8 + i] << 8 | frame[VL_XDP_ETH_HLEN + 9 + i];
+    }
+    cr_assert(test_vl_xdp_csum_ok(frame + VL_XDP_ETH_HLEN + 40, 8 + 7, sum));
+
+    cr_assert(vl_xdp_frame_parse(frame, len, 40001, &msg_parsed, payload_parsed,
+                                 sizeof(payload_parsed), macs_parsed) == 7);
+    cr_assert(memcmp(payload_parsed, "ripples", 7) == 0);
+    cr_assert(msg_parsed.msg_namelen == sizeof(struct sockaddr_in6));
+    cr_assert(sin6->sin6_family == AF_INET6);
+    cr_assert(sin6->sin6_port == htons(53));
+    cr_assert(memcmp(&sin6->sin6_addr, &pi6->ipi6_addr, 16) == 0);
+    cmsg = CMSG_FIRSTHDR(&msg_parsed);
+    cr_assert(cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO);
+    cr_assert(memcmp(&((struct in6_pktinfo *)CMSG_DATA(cmsg))->ipi6_addr,
+                     &client.sin6_addr, 16) == 0);
+}
+
+/** Test in-kernel responder map entry leaves message ID out of request and
+ * response, zero pads key, and rejects requests and responses that do not
+ * fit.
+ */
+Test(vlxdp, test_vl_xdp_resp_entry_build) {
+    unsigned char       query[VL_XDP_RESP_QUERY_MAX + 3]       = { 0x12, 0x34, 0x01 };
+    unsigned char       response[VL_XDP_RESP_RESPONSE_MAX + 3] = { 0x12, 0x34, 0x81 };
+    vl_xdp_resp_key_t   key;
+    vl_xdp_resp_value_t value;
+
+    memset(&key, 0xff, sizeof(key));
+    memset(query + 3, 'q', sizeof(query) - 3);
+    memset(response + 3, 'r', sizeof(response) - 3);
+
+    cr_assert(sizeof(vl_xdp_resp_key_t) == 2 + VL_XDP_RESP_QUERY_MAX);
+    cr_assert(offsetof(vl_xdp_resp_value_t, response) == 16);
+
+    cr_assert(vl_xdp_resp_entry_build(&key, &value, 7, query, 30, response, 60, 1500));
+    cr_assert(key.len == 28);
+    cr_assert(key.query[0] == 0x01 && key.query[1] == 'q' && key.query[27] == 'q');
+    for (size_t i = 28; i < VL_XDP_RESP_QUERY_MAX; i++) {
+        cr_assert(key.query[i] == 0);
+    }
+    cr_assert(value.generation == 7);
+    cr_assert(value.len == 58);
+    cr_assert(value.response[0] == 0x81 && value.response[57] == 'r');
+
+    /* Largest request and response. */
+    cr_assert(vl_xdp_resp_entry_build(&key, &value, 7, query, VL_XDP_RESP_QUERY_MAX + 2,
+                                      response, VL_XDP_RESP_RESPONSE_MAX + 2, 1500));
+    cr_assert(key.len == VL_XDP_RESP_QUERY_MAX);
+
+    /* Too long, too short, or response does not fit MTU. */
+    cr_assert(!vl_xdp_resp_entry_build(&key, &value, 7, query, VL_XDP_RESP_QUERY_MAX + 3,
+                                       response, 60, 1500));
+    cr_assert(!vl_xdp_resp_entry_build(&key, &value, 7, query, 30, response,
+                                       VL_XDP_RESP_RESPONSE_MAX + 3, 1500));
+    cr_assert(!vl_xdp_resp_entry_build(&key, &value, 7, query, 11, response, 60, 1500));
+    cr_assert(!vl_xdp_resp_entry_build(&key, &value, 7, query, 30, response, 60, 87));
+    cr_assert(vl_xdp_resp_entry_build(&key, &value, 7, query, 30, response, 60, 88));
+}
+
+/** Test frames that are not UDP datagrams, or can not be parsed, are
+ * rejected.
+ */
+Test(vlxdp, test_vl_xdp_frame_parse_reject) {
+    unsigned char           frame[128]                      = {};
+    unsigned char           macs[VL_XDP_MACS_LEN]           = {};
+    unsigned char           control[CMSG_SPACE(sizeof(struct in_pktinfo))] = {};
+    unsigned char           control_parsed[64]              = {};
+    unsigned char           payload[16]                     = {};
+    struct sockaddr_in      client                          = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(40000),
+    };
+    struct sockaddr_storage client_parsed                   = {};
+    struct msghdr           msg                             = {
+        .msg_name       = &client,
+        .msg_namelen    = sizeof(client),
+        .msg_control    = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct msghdr           msg_parsed                      = {
+        .msg_name       = &client_parsed,
+        .msg_control    = control_parsed,
+    };
+    struct cmsghdr         *cmsg = CMSG_FIRSTHDR(&msg);
+    int                     len  = 0;
+
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type  = IP_PKTINFO;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct in_pktinfo));
+    len = vl_xdp_frame_build(frame, sizeof(frame), 53, &msg, macs, payload, 4);
+    cr_assert(len > 0);
+
+#define TEST_VL_XDP_PARSE(f, l) \
+    (msg_parsed.msg_namelen = sizeof(client_parsed), \
+     msg_parsed.msg_controllen = sizeof(control_parsed), \
+     vl_xdp_frame_parse((f), (l), 40000, &msg_parsed, payload, sizeof(payload), macs))
+
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == 4);
+
+    /* Short frame. */
+    cr_assert(TEST_VL_XDP_PARSE(frame, 20) == -1);
+
+    /* IPv4 length exceeds frame. */
+    cr_assert(TEST_VL_XDP_PARSE(frame, len - 1) == -1);
+
+    /* Not UDP. */
+    frame[VL_XDP_ETH_HLEN + 9] = IPPROTO_TCP;
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == -1);
+    frame[VL_XDP_ETH_HLEN + 9] = IPPROTO_UDP;
+
+    /* Fragment. */
+    frame[VL_XDP_ETH_HLEN + 6] = 0x20;
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == -1);
+    frame[VL_XDP_ETH_HLEN + 6] = 0x40;
+
+    /* IPv4 options. */
+    frame[VL_XDP_ETH_HLEN] = 0x46;
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == -1);
+    frame[VL_XDP_ETH_HLEN] = 0x45;
+
+    /* Not IP (ARP). */
+    frame[12] = 0x08;
+    frame[13] = 0x06;
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == -1);
+    frame[13] = 0x00;
+
+    /* Name buffer too small. */
+    msg_parsed.msg_namelen    = sizeof(struct sockaddr_in) - 1;
+    msg_parsed.msg_controllen = sizeof(control_parsed);
+    cr_assert(vl_xdp_frame_parse(frame, len, 40000, &msg_parsed, payload,
+                                 sizeof(payload), macs) == -1);
+
+    cr_assert(TEST_VL_XDP_PARSE(frame, len) == 4);
+#undef TEST_VL_XDP_PARSE
+}
+
+/** @}*/
@@ -0,0 +1,191 @@
+/**
+ * @file test_views.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup views_ut Views
+ *
+ * @brief Views unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "views.h"
+#include "zone.h"
+
+/**! @cond */
+TestSuite(views);
+
+static const char *test_views_zone_internal =
+    "example.com.      3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+    "www.example.com.    60 IN A   10.0.0.10\n";
+
+static const char *test_views_zone_lab =
+    "example.com.      3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+    "www.example.com.    60 IN A   172.16.0.10\n";
+
+static const char *test_views_file =
+    "; test view file\n"
+    "view internal  internal.zone\n"
+    "view LAB       lab.zone       ; lab network\n"
+    "\n"
+    "dst  10.0.0.53/32      internal\n"
+    "dst  2001:db8::53/128  internal\n"
+    "src  10.0.0.0/8        internal\n"
+    "src  10.9.0.0/16       lab\n"
+    "src  2001:db8:9::/48   lab\n";
+
+static zone_db_t *
+test_views_zone_load(const char *filepath, uint64_t generation, char *err, size_t err_len)
+{
+    const char *zone = NULL;
+
+    if (strcmp(filepath, "internal.zone") == 0) {
+        zone = test_views_zone_internal;
+    } else if (strcmp(filepath, "lab.zone") == 0) {
+        zone = test_views_zone_lab;
+    } else {
+        snprintf(err, err_len, "no such file");
+        return NULL;
+    }
+    return zone_db_create(zone, strlen(zone), generation, err, err_len);
+}
+
+static void
+test_views_addr(struct sockaddr_storage *ss, const char *ip)
+{
+    memset(ss, 0, sizeof(*ss));
+    if (strchr(ip, ':') == NULL) {
+        ss->ss_family = AF_INET;
+        cr_assert(inet_pton(AF_INET, ip, &((struct sockaddr_in *)ss)->sin_addr) == 1);
+    } else {
+        ss->ss_family = AF_INET6;
+        cr_assert(inet_pton(AF_INET6, ip, &((struct sockaddr_in6 *)ss)->sin6_addr) == 1);
+    }
+}
+
+static void
+test_views_check(views_t *views, const char *local, const char *client, uint16_t view)
+{
+    struct sockaddr_storage local_ip;
+    struct sockaddr_storage client_ip;
+    uint16_t                got;
+
+    test_views_addr(&local_ip, local);
+    test_views_addr(&client_ip, client);
+    got = views_select(views, &local_ip, &client_ip);
+    cr_assert(got == view, "%s from %s: view %u, expected %u", local, client, got, view);
+}
+
+static void
+test_views_create_fail(const char *file, const char *expected)
+{
+    char     err[256] = {'\0'};
+    views_t *views    = views_create(file, strlen(file), 1, &test_views_zone_load,
+                                     err, sizeof(err));
+
+    cr_assert(views == NULL, "%s", file);
+    cr_assert(strstr(err, expected) != NULL, "%s: %s", file, err);
+}
+/**! @endcond */
+
+/** Test view set creation, view labels and zone database generations. */
+Test(views, test_views_create) {
+    char     err[256] = {'\0'};
+    views_t *views    = views_create(test_views_file, strlen(test_views_file), 3,
+                                     &test_views_zone_load, err, sizeof(err));
+
+    cr_assert(views != NULL, "%s", err);
+    cr_assert(views->generation == 3);
+    cr_assert(views->count == 2);
+    cr_assert(memcmp(views->labels[0], "\x08internal", 9) == 0);
+    cr_assert(memcmp(views->labels[1], "\x03lab", 4) == 0);
+    cr_assert(views->zone_dbs[0]->generation == (3ULL << 32 | 1));
+    cr_assert(views->zone_dbs[1]->generation == (3ULL << 32 | 2));
+    cr_assert(views->dst != NULL);
+    cr_assert(views->src != NULL);
+    views_release(views);
+
+    /* No address directives, no tables are looked up. */
+    views = views_create("view lab lab.zone\n", 18, 1, &test_views_zone_load, err, sizeof(err));
+    cr_assert(views != NULL, "%s", err);
+    cr_assert(views->dst == NULL && views->src == NULL);
+    test_views_check(views, "10.0.0.53", "10.9.0.1", 0);
+    views_release(views);
+}
+
+/** Test view is selected by destination address first, then by source
+ * address, with longest prefix matching.
+ */
+Test(views, test_views_select) {
+    char     err[256] = {'\0'};
+    views_t *views    = views_create(test_views_file, strlen(test_views_file), 1,
+                                     &test_views_zone_load, err, sizeof(err));
+
+    cr_assert(views != NULL, "%s", err);
+
+    /* Destination address selects view regardless of source. */
+    test_views_check(views, "10.0.0.53", "192.0.2.1", 1);
+    test_views_check(views, "10.0.0.53", "10.9.0.1", 1);
+    test_views_check(views, "2001:db8::53", "2001:db8:9::1", 1);
+
+    /* Source address, longest prefix wins. */
+    test_views_check(views, "192.0.2.53", "10.1.2.3", 1);
+    test_views_check(views, "192.0.2.53", "10.9.2.3", 2);
+    test_views_check(views, "2001:db8::1", "2001:db8:9:1::1", 2);
+
+    /* IPv4 mapped IPv6 addresses are looked up as IPv4. */
+    test_views_check(views, "::ffff:10.0.0.53", "::ffff:192.0.2.1", 1);
+    test_views_check(views, "::ffff:192.0.2.53", "::ffff:10.9.0.1", 2);
+
+    /* Neither selects a view. */
+    test_views_check(views, "192.0.2.53", "192.0.2.1", 0);
+    test_views_check(views, "2001:db8::1", "2001:db8:8::1", 0);
+
+    views_release(views);
+}
+
+/** Test view file errors. */
+Test(views, test_views_create_errors) {
+    test_views_create_fail("view internal\n", "line 1: invalid format");
+    test_views_create_fail("view internal internal.zone extra\n", "line 1: invalid format");
+    test_views_create_fail("view in.ternal internal.zone\n", "line 1: invalid view");
+    test_views_create_fail("view lab lab.zone\nview LAB internal.zone\n",
+                           "line 2: duplicate view");
+    test_views_create_fail("view lab missing.zone\n", "no such file");
+    test_views_create_fail("dst 10.0.0.53/32 lab\nview lab lab.zone\n",
+                           "line 1: unknown view");
+    test_views_create_fail("view lab lab.zone\nsource 10.0.0.0/8 lab\n",
+                           "line 2: unknown directive");
+    test_views_create_fail("view lab lab.zone\n\nsrc 10.0.0.1/8 lab\n",
+                           "line 3: prefix \"10.0.0.1/8\" has host bits set");
+    test_views_create_fail("view lab lab.zone\nsrc 10.0.0.0/8 lab\nsrc 10.0.0.0/8 lab\n",
+                           "line 3: duplicate prefix");
+}
+
+/** @}*/
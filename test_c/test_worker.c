@@ -0,0 +1,114 @@
+/**
+ * @file test_worker.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup worker_ut Worker Threads
+ *
+ * @brief Worker thread pool unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "worker.h"
+
+/**! @cond */
+TestSuite(worker);
+
+#define TEST_WORKER_THREADS 2
+#define TEST_WORKER_JOBS    (TEST_WORKER_THREADS * (WORKER_QUEUE_LEN - 1))
+
+typedef struct test_worker_job_s {
+    worker_job_t job;
+    int          value;
+} test_worker_job_t;
+
+static void
+test_worker_job_run(worker_job_t *job)
+{
+    ((test_worker_job_t *)job)->value++;
+}
+
+/* Jobs are returned once each, run, and queues hold at most queue length
+ * minus one jobs per worker until they are collected.
+ */
+Test(worker, test_worker_pool) {
+    worker_pool_t      pool;
+    test_worker_job_t *jobs    = calloc(TEST_WORKER_JOBS + 1, sizeof(test_worker_job_t));
+    test_worker_job_t  extra   = {0};
+    worker_job_t      *job;
+    eventfd_t          val     = 0;
+    size_t             done    = 0;
+    int                wake_fd = eventfd(0, 0);
+
+    cr_assert(jobs != NULL);
+    cr_assert(wake_fd >= 0);
+    worker_pool_start(&pool, TEST_WORKER_THREADS, wake_fd);
+    cr_assert(pool.count == TEST_WORKER_THREADS);
+    cr_assert(worker_pool_done(&pool) == NULL);
+
+    for (size_t i = 0; i < TEST_WORKER_JOBS; i++) {
+        jobs[i].job = (worker_job_t) {
+            .run  = test_worker_job_run,
+            .type = WORKER_JOB_DNSSEC_SIGN,
+        };
+        cr_assert(worker_pool_submit(&pool, &jobs[i].job), "job %zu not queued", i);
+    }
+    extra.job.run = test_worker_job_run;
+    cr_assert(!worker_pool_submit(&pool, &extra.job), "queues should be full");
+
+    while (done < TEST_WORKER_JOBS) {
+        job = worker_pool_done(&pool);
+        if (job == NULL) {
+            /* Block until a worker is done with a batch. */
+            cr_assert(eventfd_read(wake_fd, &val) == 0);
+            continue;
+        }
+        cr_assert(((test_worker_job_t *)job)->value == 1);
+        ((test_worker_job_t *)job)->value++;
+        done++;
+    }
+    cr_assert(worker_pool_done(&pool) == NULL);
+    cr_assert(pool.in_flight == 0);
+    for (size_t i = 0; i < TEST_WORKER_JOBS; i++) {
+        cr_assert(jobs[i].value == 2, "job %zu returned %d times", i, jobs[i].value - 1);
+    }
+
+    /* Queues have room again. */
+    cr_assert(worker_pool_submit(&pool, &extra.job));
+    while ((job = worker_pool_done(&pool)) == NULL) {
+        eventfd_read(wake_fd, &val);
+    }
+    cr_assert(job == &extra.job);
+    cr_assert(extra.value == 1);
+
+    /* Worker threads are never stopped, as in application. */
+    free(jobs);
+}
+/**! @endcond */
+
+/** @}*/
@@ -0,0 +1,97 @@
+/**
+ * @file test_xor_filter.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup xor_filter_ut Xor Filter
+ *
+ * @brief Xor filter unit tests
+ *  @{
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <criterion/criterion.h>
+
+#include "xor_filter.h"
+
+/**! @cond */
+TestSuite(xor_filter);
+
+static uint64_t
+test_xor_filter_rand(uint64_t *state)
+{
+    *state += 0x9e3779b97f4a7c15ULL;
+    return xor_filter_mix(*state, 0x1234);
+}
+/**! @endcond */
+
+/** Test every key of set is in filter, and few keys not in set are. */
+Test(xor_filter, test_xor_filter_build) {
+    uint32_t      counts[] = {0, 1, 7, 1000, 100000};
+    uint64_t      state    = 1;
+    xor_filter_t  f;
+
+    for (int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint32_t  count = counts[c];
+        uint64_t *keys  = malloc(sizeof(uint64_t) * (count + 1));
+        uint64_t *copy  = malloc(sizeof(uint64_t) * (count + 1));
+        uint8_t  *fps   = malloc(xor_filter_size(count));
+        uint32_t  hits  = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            keys[i] = test_xor_filter_rand(&state);
+            copy[i] = keys[i];
+        }
+        cr_assert(xor_filter_build(&f, fps, keys, count) == 0, "%u", count);
+        for (uint32_t i = 0; i < count; i++) {
+            cr_assert(xor_filter_contain(&f, copy[i]), "%u %u", count, i);
+        }
+
+        /* False positive rate is about 1/256. */
+        for (uint32_t i = 0; i < 100000; i++) {
+            hits += xor_filter_contain(&f, test_xor_filter_rand(&state)) ? 1 : 0;
+        }
+        cr_assert(hits < 100000 / 128, "%u %u", count, hits);
+
+        free(keys);
+        free(copy);
+        free(fps);
+    }
+}
+
+/** Test duplicate keys do not fail filter build. */
+Test(xor_filter, test_xor_filter_duplicates) {
+    uint64_t     keys[] = {5, 3, 5, 5, 9, 3, 1};
+    uint8_t      fps[64];
+    xor_filter_t f;
+
+    cr_assert(xor_filter_size(7) <= sizeof(fps));
+    cr_assert(xor_filter_build(&f, fps, keys, 7) == 0);
+    cr_assert(xor_filter_contain(&f, 1));
+    cr_assert(xor_filter_contain(&f, 3));
+    cr_assert(xor_filter_contain(&f, 5));
+    cr_assert(xor_filter_contain(&f, 9));
+}
+
+/** @}*/
@@ -0,0 +1,1874 @@
+/**
+ * @file test_zone.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup zone_ut Zone Database
+ *
+ * @brief Zone database unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+#include <criterion/parameterized.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "query.h"
+#include "rip_ns_utils.h"
+#include "zone.h"
+#include "zone_xfr.h"
+
+/**! @cond */
+TestSuite(zone);
+
+static const char *test_zone_file =
+    "; test zone\n"
+    "example.com.         3600 IN SOA  ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+    "example.com.         3600 IN NS   ns.example.com.\n"
+    "ns.example.com.      3600 IN A    192.0.2.1\n"
+    "ns.example.com.      3600 IN AAAA 2001:db8::1\n"
+    "WWW.example.com.      60  IN A    192.0.2.10\n"
+    "www.example.com.      60  IN A    192.0.2.11 ; second address\n"
+    "alias.example.com.    60  IN CNAME www.example.com.\n"
+    "a.b.c.example.com.    60  IN TXT  \"hello world\" \"two\"\n"
+    "sub.example.com.    3600  IN NS   ns.sub.example.com.\n"
+    "ns.sub.example.com. 3600  IN A    192.0.2.53\n"
+    "example.com.        3600  IN MX   10 mail.example.com.\n"
+    "mail.example.com.   3600  IN A    192.0.2.25\n";
+
+static zone_db_t *
+test_zone_db_create(void)
+{
+    char err[256] = {'\0'};
+
+    zone_db_t *db = zone_db_create(test_zone_file, strlen(test_zone_file), 1,
+                                   err, sizeof(err));
+    cr_assert(db != NULL, "%s", err);
+    return db;
+}
+
+static zone_node_t *
+test_zone_lookup(zone_db_t *db, const char *name)
+{
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+    const unsigned char *p = wire;
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    return zone_db_lookup(db, wire, p - wire + 1);
+}
+
+static void
+test_zone_match(zone_db_t *db, const char *name, zone_match_t *match)
+{
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    zone_db_match(db, wire, rip_ns_name_lc(wire), match);
+}
+
+static void
+test_zone_resolve_do(query_t *q, zone_db_t *db, const char *name, uint16_t type,
+                     bool dnssec)
+{
+    config_t cfg;
+
+    config_init(&cfg);
+    query_init(q, &cfg, 0);
+    query_reset(q);
+    q->query_label_len = strlen(name);
+    memcpy(q->query_label, name, q->query_label_len + 1);
+    cr_assert(rip_ns_name_pton(q->query_label, q->query_qname, sizeof(q->query_qname)) >= 0);
+    q->query_qname_len  = rip_ns_name_lc(q->query_qname);
+    q->query_qname_hash = rip_ns_name_hash(q->query_qname, q->query_qname_len);
+    q->query_q_type = type;
+    q->query_q_class = rip_ns_c_in;
+    q->edns.edns_valid = dnssec;
+    q->edns.dnssec     = dnssec;
+    query_resolve(q, db, NULL, NULL, NULL);
+    config_clean(&cfg);
+}
+
+static void
+test_zone_resolve(query_t *q, zone_db_t *db, const char *name, uint16_t type)
+{
+    test_zone_resolve_do(q, db, name, type, false);
+}
+
+/* Parse, resolve and pack A query of name with EDNS, DO bit, and a client
+ * cookie option if asked for, in query slot q that is reused as vectorloop
+ * reuses it.
+ */
+static void
+test_zone_resolve_wire(query_t *q, zone_db_t *db, const char *name, bool dnssec,
+                       bool cookie)
+{
+    uint8_t  opt[] = { 0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+                       0x00 };
+    uint8_t  opt_cookie[] = { 0x00, 0x0a, 0x00, 0x08, 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t *p            = q->request_buffer + sizeof(rip_ns_header_t);
+
+    query_reset(q);
+    memset(q->request_buffer, 0, sizeof(rip_ns_header_t));
+    q->request_hdr->id      = htons(0x1234);
+    q->request_hdr->qdcount = htons(1);
+    q->request_hdr->arcount = htons(1);
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, p, RIP_NS_MAXCDNAME + 1) >= 0);
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    p += 1;
+    RIP_NS_PUT16(rip_ns_t_a, p);
+    RIP_NS_PUT16(rip_ns_c_in, p);
+    opt[7]  = dnssec ? 0x80 : 0x00;
+    opt[10] = cookie ? sizeof(opt_cookie) : 0;
+    memcpy(p, opt, sizeof(opt));
+    p += sizeof(opt);
+    if (cookie) {
+        memcpy(p, opt_cookie, sizeof(opt_cookie));
+        p += sizeof(opt_cookie);
+    }
+    q->request_buffer_len = p - q->request_buffer;
+
+    query_parse(q);
+    cr_assert(q->end_code == rip_ns_r_rip_unknown);
+    query_resolve(q, db, NULL, NULL, NULL);
+    cr_assert(query_response_pack(q) == 0);
+}
+
+/* Number of RRSIG records in answer and authority sections of query. */
+static int
+test_zone_rrsig_count(query_t *q)
+{
+    int count = 0;
+
+    for (int i = 0; i < q->answer_section_count; i++) {
+        count += q->answer_section[i]->type == rip_ns_t_rrsig;
+    }
+    for (int i = 0; i < q->authority_section_count; i++) {
+        count += q->authority_section[i]->type == rip_ns_t_rrsig;
+    }
+    return count;
+}
+/**! @endcond */
+
+/** Test zone database creation and node lookup. */
+Test(zone, test_zone_db_create_lookup) {
+    zone_db_t    *db = test_zone_db_create();
+    zone_node_t  *node;
+    zone_rrset_t *rrset;
+
+    cr_assert(db->generation == 1);
+
+    node = test_zone_lookup(db, "example.com");
+    cr_assert(node != NULL);
+    cr_assert(node->flags & ZONE_NODE_F_APEX);
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_soa) != NULL);
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_mx) != NULL);
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_a) == NULL);
+
+    /* Records of same owner, different case, are one RRset in file order. */
+    node = test_zone_lookup(db, "www.example.com");
+    cr_assert(node != NULL);
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_a);
+    cr_assert(rrset != NULL);
+    cr_assert(rrset->rr_count == 2);
+    cr_assert(rrset->rrs[0].rdata[3] == 10);
+    cr_assert(rrset->rrs[1].rdata[3] == 11);
+
+    node = test_zone_lookup(db, "sub.example.com");
+    cr_assert(node != NULL);
+    cr_assert(node->flags & ZONE_NODE_F_CUT);
+
+    /* Empty non-terminals exist, but have no data. */
+    node = test_zone_lookup(db, "b.c.example.com");
+    cr_assert(node != NULL);
+    cr_assert(node->rrset_count == 0);
+    cr_assert(test_zone_lookup(db, "c.example.com") != NULL);
+
+    node = test_zone_lookup(db, "a.b.c.example.com");
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_txt);
+    cr_assert(rrset != NULL);
+    cr_assert(rrset->rrs[0].rdata_len == 16);
+
+    cr_assert(test_zone_lookup(db, "nope.example.com") == NULL);
+
+    zone_db_release(db);
+}
+
+/** Test lookup by precomputed name hash, and that case folded names hash
+ * the same.
+ */
+Test(zone, test_zone_db_lookup_hash) {
+    zone_db_t    *db = test_zone_db_create();
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+    unsigned char wire_lc[RIP_NS_MAXCDNAME + 1];
+    uint16_t      len;
+    uint64_t      hash;
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)"WWW.Example.com", wire, sizeof(wire)) >= 0);
+    memcpy(wire_lc, wire, sizeof(wire));
+    len = rip_ns_name_lc(wire_lc);
+    cr_assert(len == 17);
+    cr_assert(rip_ns_name_hash(wire, len) != rip_ns_name_hash(wire_lc, len));
+    cr_assert(zone_db_lookup_hash(db, wire_lc, len, rip_ns_name_hash(wire_lc, len)) ==
+              test_zone_lookup(db, "www.example.com"));
+    cr_assert(zone_db_lookup_hash(db, wire_lc, len, rip_ns_name_hash(wire_lc, len)) != NULL);
+
+    /* Names differing only past first 8 bytes, or in length, hash apart. */
+    cr_assert(rip_ns_name_hash(wire_lc, len) != rip_ns_name_hash(wire_lc, len - 1));
+    hash = rip_ns_name_hash(wire_lc, len);
+    wire_lc[len - 2] = 'n';
+    cr_assert(rip_ns_name_hash(wire_lc, len) != hash);
+
+    /* Last partial word of name is hashed as zero extended bytes, whatever
+     * way it is loaded.
+     */
+    for (uint16_t l = 1; l <= 40; l++) {
+        const uint64_t p0 = 0xa0761d6478bd642fULL;
+        const uint64_t p1 = 0xe7037ed1a0b428dbULL;
+        const uint64_t p2 = 0x8ebc6af09c88c6e3ULL;
+        unsigned char  name[48];
+        __uint128_t    r;
+        uint64_t       h = p0 ^ l;
+        uint64_t       w;
+
+        for (size_t k = 0; k < sizeof(name); k++) {
+            name[k] = (unsigned char)(k * 37 + l);
+        }
+        for (uint16_t i = 0; i < l; i += 8) {
+            w = 0;
+            memcpy(&w, name + i, l - i < 8 ? l - i : 8);
+            r = (__uint128_t)(h ^ w) * p1;
+            h = (uint64_t)r ^ (uint64_t)(r >> 64);
+        }
+        r = (__uint128_t)(h ^ p2) * (p1 ^ l);
+        cr_assert(rip_ns_name_hash(name, l) == ((uint64_t)r ^ (uint64_t)(r >> 64)));
+    }
+
+    zone_db_release(db);
+}
+
+/** Test zone database creation errors. */
+Test(zone, test_zone_db_create_err) {
+    char err[256];
+    const char *bad[] = {
+        "example.com. 60 IN A 300.0.0.1\n",
+        "example.com. 60 CH A 192.0.2.1\n",
+        "example.com. 60 IN HINFO a b\n",
+        "example.com. sixty IN A 192.0.2.1\n",
+        "example.com. 60 IN TXT \"unterminated\n",
+        "example.com. 60 IN\n",
+    };
+
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        err[0] = '\0';
+        cr_assert(zone_db_create(bad[i], strlen(bad[i]), 1, err, sizeof(err)) == NULL);
+        cr_assert(strncmp(err, "line 1:", 7) == 0);
+    }
+}
+
+/** Test zone database built on worker threads is same as one built on a
+ * single thread, and errors carry line number in file.
+ */
+Test(zone, test_zone_db_create_workers) {
+    char           err[256] = {'\0'};
+    size_t         size     = 4 * 1024 * 1024;
+    char          *zone     = malloc(size);
+    size_t         len      = 0;
+    uint32_t       lines    = 2;
+    zone_db_t     *db1      = NULL;
+    zone_db_t     *db8      = NULL;
+    worker_pool_t  workers  = {};
+    int            wake_fd  = eventfd(0, EFD_CLOEXEC);
+
+    cr_assert(zone != NULL);
+    cr_assert(wake_fd >= 0);
+    worker_pool_start(&workers, 7, wake_fd);
+    len += snprintf(zone + len, size - len,
+                    "example.com. 3600 IN SOA ns.example.com. admin.example.com. "
+                    "1 7200 3600 1209600 300\n"
+                    "example.com. 3600 IN NS  ns.example.com.\n");
+    for (unsigned int i = 20000; i > 0; i--) {
+        len += snprintf(zone + len, size - len,
+                        "m%u.example.com. 60 IN MX 10 h%u.example.com.\n"
+                        "h%u.example.com. 60 IN A 192.0.%u.%u\n"
+                        "h%u.example.com. 60 IN A 198.51.100.%u\n",
+                        i, i, i, i / 256, i % 256, i, i % 256);
+        lines += 3;
+    }
+
+    db1 = zone_db_create_workers(zone, len, 1, NULL, err, sizeof(err));
+    cr_assert(db1 != NULL, "%s", err);
+    db8 = zone_db_create_workers(zone, len, 1, &workers, err, sizeof(err));
+    cr_assert(db8 != NULL, "%s", err);
+    cr_assert(db8->nodes_count == db1->nodes_count);
+    cr_assert(db8->rrsets_count == db1->rrsets_count);
+    cr_assert(db8->rrs_count == db1->rrs_count);
+    cr_assert(db8->wire_len == db1->wire_len);
+    for (uint32_t i = 0; i < db1->nodes_count; i++) {
+        zone_node_t *n1 = &db1->nodes[i];
+        zone_node_t *n8 = zone_db_lookup(db8, n1->name, n1->name_len);
+
+        cr_assert(n8 != NULL);
+        cr_assert(n8->rrset_count == n1->rrset_count);
+        for (uint16_t j = 0; j < n1->rrset_count; j++) {
+            zone_rrset_t *r1 = &n1->rrsets[j];
+            zone_rrset_t *r8 = &n8->rrsets[j];
+
+            cr_assert(r8->type == r1->type && r8->rr_count == r1->rr_count);
+            cr_assert(r8->wire_len == r1->wire_len);
+            cr_assert(memcmp(r8->wire, r1->wire, r1->wire_len) == 0);
+            cr_assert(r8->neg_wire_len == r1->neg_wire_len);
+            cr_assert(memcmp(r8->neg_wire, r1->neg_wire, r1->neg_wire_len) == 0);
+            for (uint16_t k = 0; k < r1->rr_count; k++) {
+                cr_assert(r8->rrs[k].rdata_len == r1->rrs[k].rdata_len);
+                cr_assert(memcmp(r8->rrs[k].rdata, r1->rrs[k].rdata,
+                                 r1->rrs[k].rdata_len) == 0);
+            }
+        }
+    }
+    zone_db_release(db1);
+    zone_db_release(db8);
+
+    /* Error near end of file, in last shard. */
+    len += snprintf(zone + len, size - len, "bad.example.com. 60 IN A 300.0.0.1\n");
+    cr_assert(zone_db_create_workers(zone, len, 1, &workers, err, sizeof(err)) == NULL);
+    cr_assert(strstr(err, "invalid A rdata") != NULL, "%s", err);
+    cr_assert(strtoul(err + strlen("line "), NULL, 10) == lines + 1, "%s", err);
+    free(zone);
+}
+
+/** Test applying zone delta to zone database. */
+Test(zone, test_zone_db_apply) {
+    const char *delta =
+        "www.example.com.      60  IN A    192.0.2.20\n"
+        "-a.b.c.example.com. ANY\n"
+        "new.example.com.      60  IN A    192.0.2.30\n"
+        "ns.example.com.     3600  IN A    192.0.2.2\n"
+        "-ns.example.com. AAAA\n";
+    const uint8_t  glue[] = {192, 0, 2, 2};
+    char           err[256] = {'\0'};
+    zone_db_t     *base = test_zone_db_create();
+    zone_db_t     *db   = zone_db_apply(base, delta, strlen(delta), 2, err, sizeof(err));
+    zone_node_t   *node;
+    zone_rrset_t  *rrset;
+
+    cr_assert(db != NULL, "%s", err);
+    cr_assert(db->generation == 2);
+    cr_assert(db->base == base);
+
+    /* Base is held by delta generation. */
+    zone_db_release(base);
+
+    node = test_zone_lookup(db, "www.example.com");
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_a);
+    cr_assert(rrset->rr_count == 1);
+    cr_assert(rrset->rrs[0].rdata[3] == 20);
+
+    node = test_zone_lookup(db, "new.example.com");
+    cr_assert(node != NULL);
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_a)->rrs[0].rdata[3] == 30);
+
+    /* Deleted node and empty non-terminals only it had are gone. */
+    cr_assert(test_zone_lookup(db, "a.b.c.example.com") == NULL);
+    cr_assert(test_zone_lookup(db, "b.c.example.com") == NULL);
+    cr_assert(test_zone_lookup(db, "c.example.com") == NULL);
+
+    node = test_zone_lookup(db, "ns.example.com");
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_aaaa) == NULL);
+    cr_assert(zone_node_rrset_get(db, node, rip_ns_t_a)->rrs[0].rdata[3] == 2);
+
+    /* Unchanged nodes share RRsets with base. */
+    node = test_zone_lookup(db, "mail.example.com");
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_a);
+    cr_assert(rrset < db->rrsets || rrset >= db->rrsets + db->rrsets_count);
+
+    /* Apex RRsets are compiled again since their additional section address
+     * changed.
+     */
+    node = test_zone_lookup(db, "example.com");
+    cr_assert(node->flags & ZONE_NODE_F_APEX);
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_ns);
+    cr_assert(rrset >= db->rrsets && rrset < db->rrsets + db->rrsets_count);
+    cr_assert(rrset->wire_arcount == 1);
+    cr_assert(memcmp(rrset->wire + rrset->wire_len - sizeof(glue), glue, sizeof(glue)) == 0);
+
+    zone_db_release(db);
+}
+
+/** Test zone delta errors. */
+Test(zone, test_zone_db_apply_err) {
+    char       err[256];
+    zone_db_t *base = test_zone_db_create();
+    const char *bad[] = {
+        "-www.example.com.\n",
+        "-www.example.com. HINFO\n",
+        "-www..example.com. A\n",
+        "www.example.com. 60 IN A 300.0.0.1\n",
+    };
+
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        err[0] = '\0';
+        cr_assert(zone_db_apply(base, bad[i], strlen(bad[i]), 2, err, sizeof(err)) == NULL);
+        cr_assert(strncmp(err, "line 1:", 7) == 0);
+    }
+    cr_assert(base->refs == 1);
+
+    /* Deletion lines are only valid in zone delta. */
+    cr_assert(zone_db_create(bad[1], strlen(bad[1]), 1, err, sizeof(err)) == NULL);
+    zone_db_release(base);
+}
+
+/** Test zone database built from, and updated with, resource records rather
+ * than zone file lines.
+ */
+Test(zone, test_zone_db_rrs) {
+    uint8_t      a1[]    = {192, 0, 2, 1};
+    uint8_t      a2[]    = {192, 0, 2, 2};
+    uint8_t      soa[]   = {0, 0, 0, 0, 0, 1, 0, 0, 0, 60, 0, 0, 0, 60,
+                            0, 0, 0, 60, 0, 0, 0, 60};
+    rr_record_t  rrs[]   = {
+        { .name = (unsigned char *)"example.org", .type = rip_ns_t_soa,
+          .class = rip_ns_c_in, .ttl = 60, .rdata_len = sizeof(soa), .rdata = soa },
+        { .name = (unsigned char *)"WWW.example.org", .type = rip_ns_t_a,
+          .class = rip_ns_c_in, .ttl = 60, .rdata_len = sizeof(a1), .rdata = a1 },
+        { .name = (unsigned char *)"old.example.org", .type = rip_ns_t_a,
+          .class = rip_ns_c_in, .ttl = 60, .rdata_len = sizeof(a1), .rdata = a1 },
+    };
+    rr_record_t  delta[] = {
+        { .name = (unsigned char *)"www.example.org", .type = rip_ns_t_a,
+          .class = rip_ns_c_in, .ttl = 30, .rdata_len = sizeof(a2), .rdata = a2 },
+        { .name = (unsigned char *)"old.example.org", .type = rip_ns_t_any,
+          .class = rip_ns_c_any },
+    };
+    char          err[256] = {'\0'};
+    zone_db_t    *base = zone_db_create_rrs(rrs, 3, 1, err, sizeof(err));
+    zone_db_t    *db   = NULL;
+    zone_node_t  *node = NULL;
+    zone_rrset_t *rrset;
+
+    cr_assert(base != NULL, "%s", err);
+    node = test_zone_lookup(base, "www.example.org");
+    cr_assert(node != NULL);
+    rrset = zone_node_rrset_get(base, node, rip_ns_t_a);
+    cr_assert(rrset->rrs[0].rdata[3] == 1);
+    cr_assert(strcmp((char *)rrset->rrs[0].name, "WWW.example.org") == 0);
+    cr_assert(test_zone_lookup(base, "example.org")->flags & ZONE_NODE_F_APEX);
+
+    db = zone_db_apply_rrs(base, delta, 2, 2, err, sizeof(err));
+    cr_assert(db != NULL, "%s", err);
+    rrset = zone_node_rrset_get(db, test_zone_lookup(db, "www.example.org"), rip_ns_t_a);
+    cr_assert(rrset->rr_count == 1 && rrset->rrs[0].rdata[3] == 2 && rrset->rrs[0].ttl == 30);
+    cr_assert(test_zone_lookup(db, "old.example.org") == NULL);
+    zone_db_release(base);
+    zone_db_release(db);
+
+    /* Deletion needs a base, records need a supported class and type. */
+    cr_assert(zone_db_create_rrs(delta, 2, 1, err, sizeof(err)) == NULL);
+    cr_assert(strcmp(err, "record 2: deletion without base") == 0);
+    rrs[1].type = rip_ns_t_hinfo;
+    cr_assert(zone_db_create_rrs(rrs, 3, 1, err, sizeof(err)) == NULL);
+    cr_assert(strncmp(err, "record 2:", 9) == 0);
+}
+
+/** Test zone image write and load, loaded zone database matches the one
+ * image was compiled from.
+ */
+Test(zone, test_zone_db_image) {
+    char           path[] = "/tmp/test_zone_image_XXXXXX";
+    char           err[256] = {'\0'};
+    zone_db_t     *db = test_zone_db_create();
+    zone_db_t     *img;
+    zone_db_t     *delta;
+    struct stat    st;
+    int            fd;
+    const char    *names[] = {"example.com", "www.example.com", "b.c.example.com",
+                              "a.b.c.example.com", "sub.example.com", "ns.sub.example.com"};
+    zone_match_t   match;
+
+    fd = mkstemp(path);
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(zone_db_image_write(db, path, err, sizeof(err)) == 0, "%s", err);
+
+    fd = open(path, O_RDONLY);
+    cr_assert(fd >= 0);
+    cr_assert(fstat(fd, &st) == 0);
+    img = zone_db_image_load(fd, st.st_size, 7, err, sizeof(err));
+    close(fd);
+    unlink(path);
+    cr_assert(img != NULL, "%s", err);
+    cr_assert(img->generation == 7);
+    cr_assert(img->nodes_count == db->nodes_count);
+    cr_assert(img->rrsets_count == db->rrsets_count);
+
+    /* Nodes are found by minimal perfect hash function of names. */
+    cr_assert(img->table == NULL);
+    cr_assert(test_zone_lookup(img, "missing.example.com.") == NULL);
+
+    /* Owner names repeated by records and ancestor names are stored once. */
+    cr_assert(img->names_len < db->names_len);
+    cr_assert(img->texts_len < db->texts_len);
+
+    for (int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        zone_node_t *n1 = test_zone_lookup(db, names[i]);
+        zone_node_t *n2 = test_zone_lookup(img, names[i]);
+
+        cr_assert(n2 != NULL, "%s", names[i]);
+        cr_assert(n1->flags == n2->flags && n1->rrset_count == n2->rrset_count, "%s", names[i]);
+        for (int j = 0; j < n1->rrset_count; j++) {
+            zone_rrset_t *r1 = &n1->rrsets[j];
+            zone_rrset_t *r2 = &n2->rrsets[j];
+
+            cr_assert(r1->type == r2->type && r1->rr_count == r2->rr_count);
+            cr_assert(r1->wire_len == r2->wire_len && r1->wire_arcount == r2->wire_arcount);
+            cr_assert(memcmp(r1->wire, r2->wire, r1->wire_len) == 0, "%s", names[i]);
+            cr_assert(r1->rrs[0].rdata_len == r2->rrs[0].rdata_len);
+            cr_assert(memcmp(r1->rrs[0].rdata, r2->rrs[0].rdata, r1->rrs[0].rdata_len) == 0);
+            cr_assert(strcmp((char *)r1->rrs[0].name, (char *)r2->rrs[0].name) == 0);
+        }
+    }
+    cr_assert(test_zone_lookup(img, "nope.example.com") == NULL);
+    cr_assert(img->tree_count == db->tree_count);
+    test_zone_match(img, "host.sub.example.com", &match);
+    cr_assert(match.cut == test_zone_lookup(img, "sub.example.com"));
+    cr_assert(match.apex == test_zone_lookup(img, "example.com"));
+
+    /* Zone image is valid base for zone delta. */
+    delta = zone_db_apply(img, "-www.example.com. ANY\n", 21, 8, err, sizeof(err));
+    cr_assert(delta != NULL, "%s", err);
+    zone_db_release(img);
+    cr_assert(test_zone_lookup(delta, "www.example.com") == NULL);
+    cr_assert(test_zone_lookup(delta, "mail.example.com") != NULL);
+    zone_db_release(delta);
+
+    /* Zone database with delta applied can not be written as image. */
+    delta = zone_db_apply(db, "", 0, 2, err, sizeof(err));
+    cr_assert(zone_db_image_write(delta, path, err, sizeof(err)) != 0);
+    zone_db_release(delta);
+    zone_db_release(db);
+}
+
+/** Test truncated and corrupt zone images are rejected. */
+Test(zone, test_zone_db_image_err) {
+    char        path[] = "/tmp/test_zone_image_XXXXXX";
+    char        err[256] = {'\0'};
+    zone_db_t  *db = test_zone_db_create();
+    struct stat st;
+    uint8_t    *buf;
+    int         fd;
+    /* Offsets of: version, table mask, first section offset, minimal
+     * perfect hash function seed, first node name offset.
+     */
+    size_t      corrupt[] = {8, 12, 32, 256, 0};
+
+    fd = mkstemp(path);
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(zone_db_image_write(db, path, err, sizeof(err)) == 0, "%s", err);
+    zone_db_release(db);
+
+    fd = open(path, O_RDWR);
+    cr_assert(fd >= 0);
+    cr_assert(fstat(fd, &st) == 0);
+    buf = malloc(st.st_size);
+    cr_assert(pread(fd, buf, st.st_size, 0) == st.st_size);
+    corrupt[4] = *(uint64_t *)(buf + 32) + 4;
+
+    /* Truncated image. */
+    cr_assert(zone_db_image_load(fd, 16, 1, err, sizeof(err)) == NULL);
+    cr_assert(zone_db_image_load(fd, st.st_size - 8, 1, err, sizeof(err)) == NULL);
+    cr_assert(strstr(err, "out of bounds") != NULL, "%s", err);
+
+    for (int i = 0; i < sizeof(corrupt) / sizeof(corrupt[0]); i++) {
+        uint8_t bad[4] = {0xff, 0xff, 0xff, 0x7f};
+
+        cr_assert(pwrite(fd, bad, sizeof(bad), corrupt[i]) == sizeof(bad));
+        err[0] = '\0';
+        cr_assert(zone_db_image_load(fd, st.st_size, 1, err, sizeof(err)) == NULL, "%zu", i);
+        cr_assert(err[0] != '\0');
+        cr_assert(pwrite(fd, buf + corrupt[i], sizeof(bad), corrupt[i]) == sizeof(bad));
+    }
+
+    /* Restored image loads again. */
+    db = zone_db_image_load(fd, st.st_size, 1, err, sizeof(err));
+    cr_assert(db != NULL, "%s", err);
+    zone_db_release(db);
+    close(fd);
+    unlink(path);
+    free(buf);
+}
+
+/** Test closest encloser search of reverse label tree. */
+Test(zone, test_zone_db_match) {
+    static const char *zone =
+        "example.com.  3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.  3600 IN NS  ns.example.com.\n"
+        "*.example.com.  60 IN A   192.0.2.1\n"
+        "sub.example.com. 3600 IN NS ns.sub.example.com.\n"
+        "ns.sub.example.com. 3600 IN A 192.0.2.53\n"
+        "child.sub.example.com. 3600 IN SOA ns.child.sub.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "averyveryverylonglabel-one.example.com. 60 IN A 192.0.2.2\n"
+        "averyveryverylonglabel-two.example.com. 60 IN A 192.0.2.3\n"
+        "averyveryverylonglabel.example.com. 60 IN A 192.0.2.4\n"
+        "a.b.example.com. 60 IN A 192.0.2.5\n"
+        "&.example.com. 60 IN A 192.0.2.6\n"
+        "example.net.  3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n";
+    char          err[256] = {'\0'};
+    zone_db_t    *db = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    zone_match_t  m;
+
+    cr_assert(db != NULL, "%s", err);
+    /* Every node is in tree, plus tree root, and in name filter. */
+    cr_assert(db->tree_count == db->nodes_count + 1);
+    cr_assert(db->tree[0].node == 0);
+    for (uint32_t i = 0; i < db->nodes_count; i++) {
+        cr_assert(xor_filter_contain(&db->filter, rip_ns_name_hash(db->nodes[i].name,
+                                                                   db->nodes[i].name_len)));
+    }
+
+    /* Exact match. */
+    test_zone_match(db, "A.B.example.com", &m);
+    cr_assert(m.node == test_zone_lookup(db, "a.b.example.com"));
+    cr_assert(m.encloser == m.node);
+    cr_assert(m.apex == test_zone_lookup(db, "example.com"));
+    cr_assert(m.cut == NULL && m.wildcard == NULL);
+
+    /* Labels longer than inline key, sharing a prefix. */
+    test_zone_match(db, "averyveryverylonglabel-two.example.com", &m);
+    cr_assert(m.node == test_zone_lookup(db, "averyveryverylonglabel-two.example.com"));
+    test_zone_match(db, "averyveryverylonglabel.example.com", &m);
+    cr_assert(m.node == test_zone_lookup(db, "averyveryverylonglabel.example.com"));
+    test_zone_match(db, "averyveryverylonglabel-six.example.com", &m);
+    cr_assert(m.node == NULL);
+    cr_assert(m.encloser == test_zone_lookup(db, "example.com"));
+
+    /* Name does not exist, closest encloser and wildcard, which is not
+     * first child of closest encloser.
+     */
+    test_zone_match(db, "x.y.example.com", &m);
+    cr_assert(m.node == NULL);
+    cr_assert(m.encloser == test_zone_lookup(db, "example.com"));
+    cr_assert(m.wildcard == test_zone_lookup(db, "*.example.com"));
+
+    /* Wildcard does not apply below existing name. */
+    test_zone_match(db, "x.b.example.com", &m);
+    cr_assert(m.encloser == test_zone_lookup(db, "b.example.com"));
+    cr_assert(m.wildcard == NULL);
+
+    /* Zone cut, and zone apex below zone cut. */
+    test_zone_match(db, "x.sub.example.com", &m);
+    cr_assert(m.cut == test_zone_lookup(db, "sub.example.com"));
+    cr_assert(m.apex == test_zone_lookup(db, "example.com"));
+    test_zone_match(db, "x.child.sub.example.com", &m);
+    cr_assert(m.cut == NULL);
+    cr_assert(m.apex == test_zone_lookup(db, "child.sub.example.com"));
+
+    /* Outside of any zone. */
+    test_zone_match(db, "example.org", &m);
+    cr_assert(m.node == NULL && m.encloser == NULL && m.apex == NULL);
+    test_zone_match(db, ".", &m);
+    cr_assert(m.node == NULL && m.apex == NULL);
+    test_zone_match(db, "example.net", &m);
+    cr_assert(m.node != NULL && m.apex == m.node);
+
+    zone_db_release(db);
+}
+
+/** Test query resolution against zone database. */
+Test(zone, test_zone_query_resolve) {
+    zone_db_t *db = test_zone_db_create();
+    query_t    q;
+
+    /* Answer. */
+    test_zone_resolve(&q, db, "www.EXAMPLE.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.authoritative);
+    cr_assert(q.answer_section_count == 2);
+    cr_assert(q.authority_section_count == 0);
+    query_clean(&q);
+
+    /* Answer with additional section addresses. */
+    test_zone_resolve(&q, db, "example.com", rip_ns_t_mx);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.additional_section_count == 1);
+    query_clean(&q);
+
+    /* CNAME chase. */
+    test_zone_resolve(&q, db, "alias.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 3);
+    cr_assert(q.answer_section[0]->type == rip_ns_t_cname);
+    query_clean(&q);
+
+    /* NODATA, including empty non-terminal. */
+    test_zone_resolve(&q, db, "www.example.com", rip_ns_t_aaaa);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 0);
+    cr_assert(q.authority_section_count == 1);
+    cr_assert(q.authority_section[0]->type == rip_ns_t_soa);
+    query_clean(&q);
+
+    test_zone_resolve(&q, db, "c.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    /* NXDOMAIN. */
+    test_zone_resolve(&q, db, "nope.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    /* Referral. */
+    test_zone_resolve(&q, db, "host.sub.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(!q.authoritative);
+    cr_assert(q.answer_section_count == 0);
+    cr_assert(q.authority_section_count == 1);
+    cr_assert(q.additional_section_count == 1);
+    query_clean(&q);
+
+    /* Minimal ANY response, single RRset of lowest type. */
+    test_zone_resolve(&q, db, "example.com", rip_ns_t_any);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_section[0]->type == rip_ns_t_ns);
+    cr_assert(q.additional_section_count == 2);
+    query_clean(&q);
+
+    test_zone_resolve(&q, db, "www.example.com", rip_ns_t_any);
+    cr_assert(q.answer_section_count == 2);
+    cr_assert(q.answer_section[0]->type == rip_ns_t_a);
+    query_clean(&q);
+
+    /* ANY for empty non-terminal is NODATA. */
+    test_zone_resolve(&q, db, "c.example.com", rip_ns_t_any);
+    cr_assert(q.answer_section_count == 0);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    /* Not authoritative. */
+    test_zone_resolve(&q, db, "example.net", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_refused);
+    query_clean(&q);
+
+    /* Zone database not loaded. */
+    test_zone_resolve(&q, NULL, "www.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_servfail);
+    query_clean(&q);
+
+    zone_db_release(db);
+}
+
+/** Test answers synthesized from wildcard. */
+Test(zone, test_zone_query_resolve_wildcard) {
+    static const char *zone =
+        "example.com.  3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.  3600 IN NS  ns.example.com.\n"
+        "ns.example.com. 3600 IN A 192.0.2.1\n"
+        "*.example.com.  60 IN A   192.0.2.2\n"
+        "*.example.com.  60 IN MX  10 ns.example.com.\n"
+        "www.example.com. 60 IN A  192.0.2.3\n"
+        "*.alias.example.com. 60 IN CNAME www.example.com.\n"
+        "sub.example.com. 3600 IN NS ns.example.com.\n";
+    char       err[256] = {'\0'};
+    zone_db_t *db = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    query_t    q;
+
+    cr_assert(db != NULL, "%s", err);
+
+    /* Answer, owned by query name. */
+    test_zone_resolve(&q, db, "host.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.authoritative);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_qname_count == 1);
+    cr_assert(q.answer_wildcard);
+    cr_assert(q.answer_section[0]->rdata[3] == 2);
+    cr_assert(q.response_rrset == NULL);
+    query_clean(&q);
+
+    /* Answer with additional section addresses, and several labels below
+     * closest encloser.
+     */
+    test_zone_resolve(&q, db, "a.b.example.com", rip_ns_t_mx);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_qname_count == 1);
+    cr_assert(q.additional_section_count == 1);
+    query_clean(&q);
+
+    /* NODATA. */
+    test_zone_resolve(&q, db, "host.example.com", rip_ns_t_aaaa);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 0);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    /* Existing name is not covered by wildcard. */
+    test_zone_resolve(&q, db, "www.example.com", rip_ns_t_a);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_section[0]->rdata[3] == 3);
+    cr_assert(q.answer_qname_count == 0);
+    cr_assert(!q.answer_wildcard);
+    query_clean(&q);
+
+    /* Closest encloser without wildcard child. */
+    test_zone_resolve(&q, db, "x.www.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    query_clean(&q);
+
+    /* Wildcard CNAME, only CNAME is owned by query name. */
+    test_zone_resolve(&q, db, "x.alias.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.answer_section_count == 2);
+    cr_assert(q.answer_section[0]->type == rip_ns_t_cname);
+    cr_assert(q.answer_qname_count == 1);
+    query_clean(&q);
+
+    /* Delegation takes precedence over wildcard. */
+    test_zone_resolve(&q, db, "host.sub.example.com", rip_ns_t_a);
+    cr_assert(!q.authoritative);
+    cr_assert(q.answer_section_count == 0);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    zone_db_release(db);
+}
+
+/** Test records synthesized from forward and reverse synthesis rules, and
+ * rules kept by zone image and deltas.
+ */
+Test(zone, test_zone_query_resolve_synth) {
+    static const char *zone =
+        "example.com.  3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.  3600 IN NS  ns.example.com.\n"
+        "ns.example.com. 3600 IN A 192.0.2.1\n"
+        "ip-192-0-2-5.pool.example.com. 60 IN A 198.51.100.5\n"
+        "2.0.192.in-addr.arpa. 3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "8.b.d.0.1.0.0.2.ip6.arpa. 3600 IN SOA ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "$SYNTH forward IP- pool.example.com. 192.0.2.0/25 300\n"
+        "$SYNTH reverse ip- pool.example.com. 192.0.2.0/25 300\n"
+        "$SYNTH forward v6- pool.example.com. 2001:db8::/64 600\n"
+        "$SYNTH reverse v6- pool.example.com. 2001:db8::/64 600\n";
+    static const char *ptr6 =
+        "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa";
+    static const char *names_miss[] = {
+        "ip-192-0-2-200.pool.example.com",      /* Outside block. */
+        "ip-192-0-2-05.pool.example.com",       /* Not canonical. */
+        "ip-192-0-2.pool.example.com",
+        "x.ip-192-0-2-7.pool.example.com",
+        "v6-2001-db8-0-0-0-0-0-1.pool.example.com",
+        "v6-2001-db8-1--1.pool.example.com",
+        "1.7.2.0.192.in-addr.arpa",
+        "07.2.0.192.in-addr.arpa",
+        "200.2.0.192.in-addr.arpa",
+    };
+    char       path[] = "/tmp/test_zone_synth_XXXXXX";
+    char       err[256] = {'\0'};
+    zone_db_t *db = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    zone_db_t *dbs[3];
+    query_t    q;
+    struct stat st;
+    int        fd;
+
+    cr_assert(db != NULL, "%s", err);
+    cr_assert(db->synths_count == 4);
+
+    /* Rules survive zone image and delta. */
+    fd = mkstemp(path);
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(zone_db_image_write(db, path, err, sizeof(err)) == 0, "%s", err);
+    fd = open(path, O_RDONLY);
+    cr_assert(fd >= 0 && fstat(fd, &st) == 0);
+    dbs[0] = db;
+    dbs[1] = zone_db_image_load(fd, st.st_size, 2, err, sizeof(err));
+    cr_assert(dbs[1] != NULL, "%s", err);
+    close(fd);
+    unlink(path);
+    dbs[2] = zone_db_apply(db, "www.example.com. 60 IN A 192.0.2.9\n", 35, 3, err, sizeof(err));
+    cr_assert(dbs[2] != NULL, "%s", err);
+
+    for (int i = 0; i < 3; i++) {
+        /* Forward, owned by query name. */
+        test_zone_resolve(&q, dbs[i], "ip-192-0-2-7.pool.example.com", rip_ns_t_a);
+        cr_assert(q.end_code == rip_ns_r_noerror);
+        cr_assert(q.authoritative);
+        cr_assert(q.answer_section_count == 1 && q.answer_qname_count == 1);
+        cr_assert(q.answer_section[0]->type == rip_ns_t_a);
+        cr_assert(q.answer_section[0]->ttl == 300);
+        cr_assert(memcmp(q.answer_section[0]->rdata, "\xc0\x00\x02\x07", 4) == 0);
+        query_clean(&q);
+
+        test_zone_resolve(&q, dbs[i], "v6-2001-db8--1.pool.example.com", rip_ns_t_aaaa);
+        cr_assert(q.answer_section_count == 1);
+        cr_assert(q.answer_section[0]->rdata_len == 16);
+        cr_assert(q.answer_section[0]->rdata[15] == 1);
+        query_clean(&q);
+
+        /* Synthesized name has no data of other types (NODATA). */
+        test_zone_resolve(&q, dbs[i], "ip-192-0-2-7.pool.example.com", rip_ns_t_txt);
+        cr_assert(q.end_code == rip_ns_r_noerror);
+        cr_assert(q.answer_section_count == 0);
+        cr_assert(q.authority_section_count == 1);
+        query_clean(&q);
+
+        /* Reverse, PTR to forward name. */
+        test_zone_resolve(&q, dbs[i], "7.2.0.192.in-addr.arpa", rip_ns_t_ptr);
+        cr_assert(q.answer_section_count == 1);
+        cr_assert(q.answer_section[0]->type == rip_ns_t_ptr);
+        cr_assert(q.answer_section[0]->rdata_len == 31);
+        cr_assert(memcmp(q.answer_section[0]->rdata, "\x0cip-192-0-2-7\x04pool\x07" "example\x03" "com",
+                         31) == 0);
+        query_clean(&q);
+
+        test_zone_resolve(&q, dbs[i], ptr6, rip_ns_t_ptr);
+        cr_assert(q.answer_section_count == 1);
+        cr_assert(memcmp(q.answer_section[0]->rdata, "\x0ev6-2001-db8--1", 15) == 0);
+        query_clean(&q);
+
+        /* Stored records take precedence. */
+        test_zone_resolve(&q, dbs[i], "ip-192-0-2-5.pool.example.com", rip_ns_t_a);
+        cr_assert(q.answer_section[0]->rdata[0] == 198);
+        query_clean(&q);
+
+        for (int j = 0; j < sizeof(names_miss) / sizeof(names_miss[0]); j++) {
+            test_zone_resolve(&q, dbs[i], names_miss[j], rip_ns_t_a);
+            cr_assert(q.end_code == rip_ns_r_nxdomain, "%s", names_miss[j]);
+            query_clean(&q);
+        }
+    }
+    zone_db_release(dbs[1]);
+    zone_db_release(dbs[2]);
+    zone_db_release(db);
+}
+
+/** Test invalid synthesis rules are rejected. */
+Test(zone, test_zone_db_synth_err) {
+    static const char *zones[] = {
+        "$SYNTH forward ip- pool.example.com. 192.0.2.0/24\n",
+        "$SYNTH sideways ip- pool.example.com. 192.0.2.0/24 300\n",
+        "$SYNTH forward ip_ pool.example.com. 192.0.2.0/24 300\n",
+        "$SYNTH forward averyveryverylonglabelprefix- pool.example.com. 192.0.2.0/24 300\n",
+        "$SYNTH forward ip- pool..example.com. 192.0.2.0/24 300\n",
+        "$SYNTH forward ip- pool.example.com. 192.0.2.0 300\n",
+        "$SYNTH forward ip- pool.example.com. 192.0.2.0/33 300\n",
+        "$SYNTH forward ip- pool.example.com. 192.0.2.1/24 300\n",
+        "$SYNTH forward ip- pool.example.com. 192.0.2.0/24 -1\n",
+    };
+    char       err[256];
+    zone_db_t *db;
+
+    for (int i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+        err[0] = '\0';
+        db = zone_db_create(zones[i], strlen(zones[i]), 1, err, sizeof(err));
+        cr_assert(db == NULL, "%d", i);
+        cr_assert(strstr(err, "line 1") != NULL, "%d %s", i, err);
+    }
+
+    /* Rules are not allowed in deltas. */
+    db = test_zone_db_create();
+    cr_assert(zone_db_apply(db, zones[0], strlen(zones[0]), 2, err, sizeof(err)) == NULL);
+    cr_assert(strstr(err, "zone delta") != NULL, "%s", err);
+    zone_db_release(db);
+}
+
+/** Test parsing of presigned zone records, and RRSIG records added to
+ * responses with DNSSEC OK bit set.
+ */
+Test(zone, test_zone_query_resolve_presigned) {
+    static const char *zone =
+        "example.com.      3600 IN SOA    ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.      3600 IN RRSIG  SOA 13 2 3600 20300101000000 20250101000000 4242 example.com. "
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\n"
+        "example.com.      3600 IN NS     ns.example.com.\n"
+        "example.com.      3600 IN DNSKEY 257 3 13 "
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJC UmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\n"
+        "ns.example.com.    3600 IN A      192.0.2.1\n"
+        "www.example.com.    60 IN A      192.0.2.10\n"
+        "www.example.com.    60 IN A      192.0.2.11\n"
+        "www.example.com.    60 IN RRSIG  A 13 3 60 20300101000000 1735689600 4242 Example.com. "
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\n"
+        "sub.example.com.  3600 IN NS     ns.sub.example.com.\n"
+        "sub.example.com.  3600 IN DS     4243 13 2 "
+        "000102030405060708090A0B0C0D0E0F 101112131415161718191a1b1c1d1e1f\n"
+        "ns.sub.example.com. 3600 IN A    192.0.2.53\n";
+    char                 err[256] = {'\0'};
+    zone_db_t           *db       = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    query_t              q;
+    const unsigned char *rdata;
+    uint16_t             type;
+    uint32_t             expiration;
+    uint32_t             inception;
+
+    cr_assert(db != NULL, "%s", err);
+
+    /* RRSIG record rdata, signer name case is kept. */
+    test_zone_resolve(&q, db, "www.example.com", rip_ns_t_rrsig);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_section[0]->rdata_len == 18 + 13 + 64);
+    rdata = q.answer_section[0]->rdata;
+    RIP_NS_GET16(type, rdata);
+    cr_assert(type == rip_ns_t_a);
+    cr_assert(rdata[0] == 13 && rdata[1] == 3);
+    rdata += 6;
+    RIP_NS_GET32(expiration, rdata);
+    RIP_NS_GET32(inception, rdata);
+    cr_assert(expiration == 1893456000);
+    cr_assert(inception == 1735689600);
+    cr_assert(memcmp(rdata + 2, "\7Example\3com", 13) == 0);
+    cr_assert(rdata[2 + 13 + 63] == 63);
+    query_clean(&q);
+
+    /* DNSKEY base64 may be split into several tokens. */
+    test_zone_resolve(&q, db, "example.com", rip_ns_t_dnskey);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.answer_section[0]->rdata_len == 4 + 64);
+    query_clean(&q);
+
+    /* RRSIG records are added only with DNSSEC OK bit set. */
+    test_zone_resolve(&q, db, "www.example.com", rip_ns_t_a);
+    cr_assert(q.answer_section_count == 2);
+    query_clean(&q);
+
+    test_zone_resolve_do(&q, db, "www.example.com", rip_ns_t_a, true);
+    cr_assert(q.answer_section_count == 3);
+    cr_assert(q.answer_section[2]->type == rip_ns_t_rrsig);
+    cr_assert(q.response_rrset == NULL);
+    query_clean(&q);
+
+    /* RRset without RRSIG records is answered as is. */
+    test_zone_resolve_do(&q, db, "ns.example.com", rip_ns_t_a, true);
+    cr_assert(q.answer_section_count == 1);
+    query_clean(&q);
+
+    /* SOA in authority section is followed by its RRSIG record. */
+    test_zone_resolve_do(&q, db, "nope.example.com", rip_ns_t_a, true);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(q.authority_section_count == 2);
+    cr_assert(q.authority_section[1]->type == rip_ns_t_rrsig);
+    query_clean(&q);
+
+    /* Referral carries DS RRset of delegation. */
+    test_zone_resolve(&q, db, "host.sub.example.com", rip_ns_t_a);
+    cr_assert(q.authority_section_count == 1);
+    query_clean(&q);
+
+    test_zone_resolve_do(&q, db, "host.sub.example.com", rip_ns_t_a, true);
+    cr_assert(!q.authoritative);
+    cr_assert(q.authority_section_count == 2);
+    cr_assert(q.authority_section[1]->type == rip_ns_t_ds);
+    cr_assert(q.authority_section[1]->rdata_len == 4 + 32);
+    cr_assert(q.authority_section[1]->rdata[4 + 26] == 0x1a);
+    query_clean(&q);
+
+    zone_db_release(db);
+}
+
+/** Test DNSSEC records are added only for query that set DO bit itself, not
+ * for DO=0 query with EDNS options parsed in query slot a DO=1 query used
+ * before.
+ */
+Test(zone, test_zone_query_resolve_presigned_reuse) {
+    static const char *zone =
+        "example.com.      3600 IN SOA    ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.      3600 IN RRSIG  SOA 13 2 3600 20300101000000 20250101000000 4242 example.com. "
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\n"
+        "example.com.      3600 IN NS     ns.example.com.\n"
+        "ns.example.com.   3600 IN A      192.0.2.1\n"
+        "www.example.com.    60 IN A      192.0.2.10\n"
+        "www.example.com.    60 IN RRSIG  A 13 3 60 20300101000000 20250101000000 4242 example.com. "
+        "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\n";
+    char       err[256] = {'\0'};
+    zone_db_t *db       = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    config_t   cfg;
+    query_t    q;
+
+    cr_assert(db != NULL, "%s", err);
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+
+    test_zone_resolve_wire(&q, db, "www.example.com", true, false);
+    cr_assert(q.edns.dnssec);
+    cr_assert(ntohs(q.response_hdr->ancount) == 2);
+    cr_assert(test_zone_rrsig_count(&q) == 1);
+
+    test_zone_resolve_wire(&q, db, "www.example.com", false, true);
+    cr_assert(!q.edns.dnssec);
+    cr_assert(ntohs(q.response_hdr->ancount) == 1);
+    cr_assert(test_zone_rrsig_count(&q) == 0);
+
+    /* Negative answer, SOA is followed by its RRSIG record only with DO. */
+    test_zone_resolve_wire(&q, db, "nope.example.com", true, false);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(test_zone_rrsig_count(&q) == 1);
+
+    test_zone_resolve_wire(&q, db, "nope.example.com", false, true);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(ntohs(q.response_hdr->nscount) == 1);
+    cr_assert(test_zone_rrsig_count(&q) == 0);
+
+    query_clean(&q);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test presigned zone record parse errors. */
+Test(zone, test_zone_db_create_presigned_err) {
+    const char *zones[] = {
+        "example.com. 3600 IN DS 1 13 2 0g\n",
+        "example.com. 3600 IN DS 1 13 2 012\n",
+        "example.com. 3600 IN DNSKEY 257 3 13 AA*A\n",
+        "example.com. 3600 IN RRSIG A 13 2 60 20300101000000 20250101000000 1 example.com.\n",
+        "example.com. 3600 IN RRSIG BOGUS 13 2 60 20300101000000 20250101000000 1 "
+        "example.com. AAAA\n",
+        "example.com. 3600 IN RRSIG A 13 2 60 2030010100000x 20250101000000 1 example.com. AAAA\n",
+        "example.com. 3600 IN NSEC a.example.com. A BOGUS\n",
+        "example.com. 3600 IN NSEC a.example.com. TYPE65536\n",
+        "example.com. 3600 IN NSEC3 1 0 12 aabbccd 0p9mhaveqvm6t7vbl5lop2u3t2rp3tom\n",
+        "example.com. 3600 IN NSEC3 1 0 12 aabbccdd 0p9mhaveqvm6t7vbl5lop2u3t2rp3tow\n",
+        "example.com. 3600 IN NSEC3 1 0 12 aabbccdd\n",
+        "example.com. 3600 IN NSEC3PARAM 1 0 12 aabbccdd A\n",
+    };
+    char err[256];
+
+    for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+        err[0] = '\0';
+        cr_assert(zone_db_create(zones[i], strlen(zones[i]), 1, err, sizeof(err)) == NULL,
+                  "zone %zu", i);
+        cr_assert(err[0] != '\0');
+    }
+}
+
+/** Test denial of existence chain of a NSEC signed zone, and NSEC records
+ * added to negative and wildcard responses with DNSSEC OK bit set.
+ */
+Test(zone, test_zone_query_resolve_nsec) {
+    static const char *zone =
+        "example.com.     3600 IN SOA  ns.example.com. admin.example.com. 1 7200 3600 1209600 300\n"
+        "example.com.     3600 IN NS   ns.example.com.\n"
+        "example.com.      300 IN NSEC a.example.com. NS SOA RRSIG NSEC\n"
+        "a.example.com.     60 IN A    192.0.2.1\n"
+        "a.example.com.    300 IN NSEC x.c.example.com. A RRSIG NSEC TYPE65534\n"
+        "x.c.example.com.   60 IN A    192.0.2.2\n"
+        "x.c.example.com.  300 IN NSEC *.w.example.com. A RRSIG NSEC\n"
+        "*.w.example.com.   60 IN A    192.0.2.3\n"
+        "*.w.example.com.  300 IN NSEC example.com. A RRSIG NSEC\n";
+    const char *owners[] = {"example.com", "a.example.com", "x.c.example.com", "*.w.example.com"};
+    char        err[256] = {'\0'};
+    zone_db_t  *db       = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    zone_node_t *apex;
+    rr_record_t *nsec[4];
+    query_t     q;
+
+    cr_assert(db != NULL, "%s", err);
+    apex = test_zone_lookup(db, "example.com");
+    cr_assert(zone_db_denial(db, apex) != NULL);
+    cr_assert(zone_db_denial(db, apex)->kind == ZONE_DENIAL_NSEC);
+    cr_assert(zone_db_denial(db, apex)->count == 4);
+    for (int i = 0; i < 4; i++) {
+        zone_node_t *node = test_zone_lookup(db, owners[i]);
+
+        nsec[i] = zone_node_rrset_get(db, node, rip_ns_t_nsec)->rrs;
+        /* Owner name matches its own NSEC record. */
+        cr_assert(zone_db_nsec_cover(db, apex, node->name, node->name_len) == node);
+    }
+
+    /* Next domain name followed by type bitmap windows 0 and 255. */
+    cr_assert(nsec[1]->rdata_len == 17 + 2 + 6 + 2 + 32);
+    cr_assert(nsec[1]->rdata[17] == 0 && nsec[1]->rdata[18] == 6);
+    cr_assert(nsec[1]->rdata[19] == 0x40 && nsec[1]->rdata[24] == 0x03);
+    cr_assert(nsec[1]->rdata[25] == 255 && nsec[1]->rdata[26] == 32);
+    cr_assert(nsec[1]->rdata[58] == 0x02);
+
+    /* Proof is added only with DNSSEC OK bit set. */
+    test_zone_resolve(&q, db, "b.example.com", rip_ns_t_a);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(q.authority_section_count == 1);
+    cr_assert(q.response_soa != NULL);
+    query_clean(&q);
+
+    /* NXDOMAIN, NSEC covering name and NSEC covering wildcard at closest
+     * encloser ("*" sorts before "a").
+     */
+    test_zone_resolve_do(&q, db, "b.example.com", rip_ns_t_a, true);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(q.authority_section_count == 3);
+    cr_assert(q.authority_section[0]->type == rip_ns_t_soa);
+    cr_assert(q.authority_section[1] == nsec[1]);
+    cr_assert(q.authority_section[2] == nsec[0]);
+    cr_assert(q.response_soa == NULL);
+    query_clean(&q);
+
+    /* NODATA, NSEC of name. */
+    test_zone_resolve_do(&q, db, "a.example.com", rip_ns_t_txt, true);
+    cr_assert(q.end_code == rip_ns_r_noerror);
+    cr_assert(q.authority_section_count == 2);
+    cr_assert(q.authority_section[1] == nsec[1]);
+    query_clean(&q);
+
+    /* NODATA of empty non-terminal, NSEC whose next name is below it. */
+    test_zone_resolve_do(&q, db, "c.example.com", rip_ns_t_a, true);
+    cr_assert(q.authority_section_count == 2);
+    cr_assert(q.authority_section[1] == nsec[1]);
+    query_clean(&q);
+
+    /* Wildcard answer, NSEC covering name. */
+    test_zone_resolve_do(&q, db, "foo.w.example.com", rip_ns_t_a, true);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.authority_section_count == 1);
+    cr_assert(q.authority_section[0] == nsec[3]);
+    query_clean(&q);
+
+    /* NXDOMAIN past last name is covered by last NSEC, closest encloser
+     * wildcard by apex NSEC.
+     */
+    test_zone_resolve_do(&q, db, "zz.example.com", rip_ns_t_a, true);
+    cr_assert(q.authority_section_count == 3);
+    cr_assert(q.authority_section[1] == nsec[3]);
+    cr_assert(q.authority_section[2] == nsec[0]);
+    query_clean(&q);
+
+    zone_db_release(db);
+}
+
+/** Test NSEC3 hash, NSEC3 chain of a zone, and NSEC3 records added to
+ * negative and wildcard responses with DNSSEC OK bit set. Hashes are of
+ * RFC 5155 appendix A zone (salt aabbccdd, 12 iterations).
+ */
+Test(zone, test_zone_query_resolve_nsec3) {
+    static const char *zone =
+        "example.     3600 IN SOA  ns1.example. admin.example. 1 7200 3600 1209600 300\n"
+        "example.     3600 IN NS   ns1.example.\n"
+        "example.        0 IN NSEC3PARAM 1 0 12 aabbccdd\n"
+        "ns1.example.   60 IN A    192.0.2.1\n"
+        "a.example.     60 IN A    192.0.2.2\n"
+        "*.w.example.   60 IN A    192.0.2.3\n"
+        "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom.example. 300 IN NSEC3 1 0 12 aabbccdd "
+        "2t7b4g4vsa5smi47k61mv5bv1a22bojr NS SOA NSEC3PARAM\n"
+        "2T7B4G4VSA5SMI47K61MV5BV1A22BOJR.example. 300 IN NSEC3 1 0 12 aabbccdd "
+        "35mthgpgcu1qg68fab165klnsnk3dpvl A\n"
+        "35mthgpgcu1qg68fab165klnsnk3dpvl.example. 300 IN NSEC3 1 0 12 aabbccdd "
+        "k8udemvp1j2f7eg6jebps17vp3n8i58h A\n"
+        "k8udemvp1j2f7eg6jebps17vp3n8i58h.example. 300 IN NSEC3 1 0 12 aabbccdd "
+        "r53bq7cc2uvmubfu5ocmm6pers9tk9en\n"
+        "r53bq7cc2uvmubfu5ocmm6pers9tk9en.example. 300 IN NSEC3 1 0 12 aabbccdd "
+        "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom A\n";
+    const char *hashes[] = {
+        "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom", "2t7b4g4vsa5smi47k61mv5bv1a22bojr",
+        "35mthgpgcu1qg68fab165klnsnk3dpvl", "k8udemvp1j2f7eg6jebps17vp3n8i58h",
+        "r53bq7cc2uvmubfu5ocmm6pers9tk9en",
+    };
+    const char          *names[] = {"example", "ns1.example", "a.example", "w.example",
+                                    "*.w.example"};
+    char                 err[256] = {'\0'};
+    zone_db_t           *db       = zone_db_create(zone, strlen(zone), 1, err, sizeof(err));
+    const zone_denial_t *denial;
+    zone_node_t         *apex;
+    rr_record_t         *nsec3[5];
+    uint8_t              hash[ZONE_NSEC3_HASH_LEN];
+    uint8_t              expected[ZONE_NSEC3_HASH_LEN];
+    zone_nsec3_cache_t   cache;
+    bool                 match;
+    query_t              q;
+
+    cr_assert(db != NULL, "%s", err);
+    apex   = test_zone_lookup(db, "example");
+    denial = zone_db_denial(db, apex);
+    cr_assert(denial != NULL);
+    cr_assert(denial->kind == ZONE_DENIAL_NSEC3);
+    cr_assert(denial->count == 5);
+    cr_assert(denial->iterations == 12 && denial->salt_len == 4);
+
+    for (int i = 0; i < 5; i++) {
+        zone_node_t *node = test_zone_lookup(db, names[i]);
+        zone_node_t *owner;
+        char         name[64];
+
+        cr_assert(node != NULL);
+        zone_nsec3_hash(denial, node->name, node->name_len, hash);
+        cr_assert(zone_base32hex_decode(hashes[i], 32, expected, sizeof(expected)) == 20);
+        cr_assert(memcmp(hash, expected, sizeof(hash)) == 0, "%s", names[i]);
+
+        snprintf(name, sizeof(name), "%s.example", hashes[i]);
+        owner    = test_zone_lookup(db, name);
+        nsec3[i] = zone_node_rrset_get(db, owner, rip_ns_t_nsec3)->rrs;
+        cr_assert(zone_db_nsec3_cover(db, apex, hash, &match) == owner);
+        cr_assert(match);
+    }
+
+    /* Hash below first and above last entry is covered by last entry. */
+    memset(hash, 0, sizeof(hash));
+    cr_assert(zone_db_nsec3_cover(db, apex, hash, &match)->rrsets->rrs == nsec3[4]);
+    cr_assert(!match);
+    memset(hash, 0xff, sizeof(hash));
+    cr_assert(zone_db_nsec3_cover(db, apex, hash, &match)->rrsets->rrs == nsec3[4]);
+    cr_assert(!match);
+
+    /* Next hashed owner name and type bitmap. */
+    cr_assert(nsec3[4]->rdata_len == 9 + 21 + 2 + 1);
+    cr_assert(nsec3[4]->rdata[9] == 20);
+
+    /* Cached hash equals computed one, and is served from cache. */
+    cr_assert(zone_nsec3_cache_init(&cache, 3) == 0);
+    cr_assert(cache.mask == 3);
+    zone_nsec3_hash_cached(&cache, db, denial, apex->name, apex->name_len, hash);
+    zone_nsec3_hash(denial, apex->name, apex->name_len, expected);
+    cr_assert(memcmp(hash, expected, sizeof(hash)) == 0);
+    memset(hash, 0, sizeof(hash));
+    zone_nsec3_hash_cached(&cache, db, denial, apex->name, apex->name_len, hash);
+    cr_assert(memcmp(hash, expected, sizeof(hash)) == 0);
+    zone_nsec3_cache_clean(&cache);
+    cr_assert(cache.entries == NULL);
+
+    /* NXDOMAIN, NSEC3 matching closest encloser, NSEC3 covering next closer
+     * name b.example (j7hv...), which also covers wildcard *.example (jhsv...).
+     */
+    test_zone_resolve_do(&q, db, "b.example", rip_ns_t_a, true);
+    cr_assert(q.end_code == rip_ns_r_nxdomain);
+    cr_assert(q.authority_section_count == 3);
+    cr_assert(q.authority_section[1] == nsec3[0]);
+    cr_assert(q.authority_section[2] == nsec3[2]);
+    query_clean(&q);
+
+    /* NODATA, NSEC3 matching name. */
+    test_zone_resolve_do(&q, db, "a.example", rip_ns_t_txt, true);
+    cr_assert(q.authority_section_count == 2);
+    cr_assert(q.authority_section[1] == nsec3[2]);
+    query_clean(&q);
+
+    /* Wildcard answer, NSEC3 covering next closer name x.w.example (b4um...). */
+    test_zone_resolve_do(&q, db, "x.w.example", rip_ns_t_a, true);
+    cr_assert(q.answer_section_count == 1);
+    cr_assert(q.authority_section_count == 1);
+    cr_assert(q.authority_section[0] == nsec3[2]);
+    query_clean(&q);
+
+    /* Wildcard NODATA, closest encloser proof and NSEC3 matching wildcard. */
+    test_zone_resolve_do(&q, db, "x.w.example", rip_ns_t_txt, true);
+    cr_assert(q.authority_section_count == 4);
+    cr_assert(q.authority_section[1] == nsec3[3]);
+    cr_assert(q.authority_section[2] == nsec3[2]);
+    cr_assert(q.authority_section[3] == nsec3[4]);
+    query_clean(&q);
+
+    zone_db_release(db);
+}
+
+/** Decode resource records in response into text, one record per line. */
+static void
+test_zone_response_text(query_t *q, char *text, size_t text_size)
+{
+    const unsigned char *msg   = (const unsigned char *)q->response_hdr;
+    const unsigned char *eom   = msg + q->response_buffer_len - 1;
+    const unsigned char *p     = msg + sizeof(rip_ns_header_t);
+    unsigned char        name[RIP_NS_MAXCDNAME + 1];
+    unsigned char        target[RIP_NS_MAXCDNAME + 1];
+    unsigned char        rname[RIP_NS_MAXCDNAME + 1];
+    char                 addr[INET6_ADDRSTRLEN];
+    uint16_t             name_len = 0;
+    uint16_t             count    = ntohs(q->response_hdr->ancount) +
+                                    ntohs(q->response_hdr->nscount) +
+                                    ntohs(q->response_hdr->arcount);
+    uint16_t             type;
+    uint16_t             class;
+    uint32_t             ttl;
+    uint16_t             rdlen;
+    int                  len      = 0;
+
+    text[0] = '\0';
+    cr_assert(ntohs(q->response_hdr->qdcount) == 1);
+    p += rip_rr_name_get(msg, eom, p, name, sizeof(name), &name_len) + RIP_NS_QFIXEDSZ;
+
+    for (uint16_t i = 0; i < count; i++) {
+        len = rip_rr_name_get(msg, eom, p, name, sizeof(name), &name_len);
+        cr_assert(len > 0);
+        p += len;
+        RIP_NS_GET16(type, p);
+        RIP_NS_GET16(class, p);
+        RIP_NS_GET32(ttl, p);
+        RIP_NS_GET16(rdlen, p);
+        target[0] = '\0';
+        rname[0] = '\0';
+        if (type == rip_ns_t_a || type == rip_ns_t_aaaa) {
+            inet_ntop(type == rip_ns_t_a ? AF_INET : AF_INET6, p, addr, sizeof(addr));
+            memcpy(target, addr, strlen(addr) + 1);
+        } else if (type == rip_ns_t_mx) {
+            cr_assert(rip_rr_name_get(msg, eom, p + 2, target, sizeof(target), &name_len) > 0);
+        } else if (type == rip_ns_t_ns || type == rip_ns_t_cname) {
+            cr_assert(rip_rr_name_get(msg, eom, p, target, sizeof(target), &name_len) > 0);
+        } else if (type == rip_ns_t_soa) {
+            len = rip_rr_name_get(msg, eom, p, target, sizeof(target), &name_len);
+            cr_assert(len > 0);
+            cr_assert(rip_rr_name_get(msg, eom, p + len, rname, sizeof(rname), &name_len) > 0);
+        }
+        p += rdlen;
+        len = strlen(text);
+        snprintf(text + len, text_size - len, "%s %u %u %u %s %s\n", name, ttl, class,
+                 type, target, rname);
+    }
+    cr_assert(p - 1 == eom);
+}
+
+/** Test response packing from precompiled RRset fragments. */
+Test(zone, test_zone_response_pack_template) {
+    zone_db_t  *db = test_zone_db_create();
+    config_t    cfg;
+    query_t     q;
+    char        text_template[1024];
+    char        text_generic[1024];
+    const char *names[] = {"www.Example.com", "example.com", "example.com",
+                           "ns.example.com"};
+    uint16_t    types[] = {rip_ns_t_a, rip_ns_t_mx, rip_ns_t_ns, rip_ns_t_aaaa};
+
+    config_init(&cfg);
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        unsigned char *p = NULL;
+
+        query_init(&q, &cfg, 0);
+        query_reset(&q);
+        memset(q.request_buffer, 0, sizeof(rip_ns_header_t));
+        q.request_hdr->id      = htons(0x1234);
+        q.request_hdr->rd      = 1;
+        q.request_hdr->qdcount = htons(1);
+        p = q.request_buffer + sizeof(rip_ns_header_t);
+        cr_assert(rip_ns_name_pton((const unsigned char *)names[i], p, RIP_NS_MAXCDNAME + 1) >= 0);
+        while (*p != 0) {
+            p += *p + 1;
+        }
+        p += 1;
+        RIP_NS_PUT16(types[i], p);
+        RIP_NS_PUT16(rip_ns_c_in, p);
+        q.request_buffer_len = p - q.request_buffer;
+
+        query_parse(&q);
+        query_resolve(&q, db, NULL, NULL, NULL);
+        cr_assert(q.end_code == rip_ns_r_noerror);
+        cr_assert(q.response_rrset != NULL, "%s", names[i]);
+        cr_assert(query_response_pack(&q) == 0);
+        cr_assert(q.response_hdr->id == htons(0x1234));
+        cr_assert(q.response_hdr->aa == 1);
+        cr_assert(ntohs(q.response_hdr->ancount) == q.answer_section_count);
+        cr_assert(ntohs(q.response_hdr->arcount) == q.additional_section_count);
+        /* Question is copied from request, preserving case. */
+        cr_assert(memcmp(q.request_buffer + sizeof(rip_ns_header_t),
+                         (unsigned char *)q.response_hdr + sizeof(rip_ns_header_t),
+                         q.query_question_len) == 0);
+        test_zone_response_text(&q, text_template, sizeof(text_template));
+
+        q.response_rrset = NULL;
+        cr_assert(query_response_pack(&q) == 0);
+        test_zone_response_text(&q, text_generic, sizeof(text_generic));
+        /* Owner names compressed against question take question case. */
+        cr_assert(strcasecmp(text_template, text_generic) == 0);
+
+        query_clean(&q);
+    }
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/**! @cond */
+/** Build request for name and type into query request buffer, and parse and
+ * resolve it. If udp_size is not 0 request has EDNS OPT RR with it as UDP
+ * payload size.
+ */
+static void
+test_zone_query_request(query_t *q, zone_db_t *db, const char *name, uint16_t type,
+                        uint16_t udp_size)
+{
+    unsigned char *p = q->request_buffer;
+
+    query_reset(q);
+    memset(p, 0, sizeof(rip_ns_header_t));
+    q->request_hdr->id      = htons(0x1234);
+    q->request_hdr->qdcount = htons(1);
+    q->request_hdr->arcount = htons(udp_size > 0 ? 1 : 0);
+    p += sizeof(rip_ns_header_t);
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, p, RIP_NS_MAXCDNAME + 1) >= 0);
+    while (*p != 0) {
+        p += *p + 1;
+    }
+    p += 1;
+    RIP_NS_PUT16(type, p);
+    RIP_NS_PUT16(rip_ns_c_in, p);
+    if (udp_size > 0) {
+        *p++ = 0;
+        RIP_NS_PUT16(rip_ns_t_opt, p);
+        RIP_NS_PUT16(udp_size, p);
+        RIP_NS_PUT32(0, p);
+        RIP_NS_PUT16(0, p);
+    }
+    q->request_buffer_len = p - q->request_buffer;
+
+    query_parse(q);
+    if (q->end_code == -1) {
+        query_resolve(q, db, NULL, NULL, NULL);
+    }
+}
+
+/** Build request for name and type, and parse, resolve and pack it, see
+ * @ref test_zone_query_request().
+ */
+static int
+test_zone_query_pack(query_t *q, zone_db_t *db, const char *name, uint16_t type,
+                     uint16_t udp_size)
+{
+    test_zone_query_request(q, db, name, type, udp_size);
+    cr_assert(q->end_code == rip_ns_r_noerror, "%s", name);
+    return query_response_pack(q);
+}
+/**! @endcond */
+
+/** Test negative responses packed from precompiled SOA negative response
+ * fragment, for query names at different depths below zone apex.
+ */
+Test(zone, test_zone_response_pack_negative) {
+    zone_db_t  *db = test_zone_db_create();
+    config_t    cfg;
+    query_t     q;
+    char        text_template[1024];
+    char        text_generic[1024];
+    const char *names[] = {"nope.Example.com", "www.example.com", "example.com",
+                           "a.very.deep.NAME.example.com", "b.c.example.com"};
+    uint16_t    types[] = {rip_ns_t_a, rip_ns_t_aaaa, rip_ns_t_txt, rip_ns_t_a,
+                           rip_ns_t_a};
+    int         codes[] = {rip_ns_r_nxdomain, rip_ns_r_noerror, rip_ns_r_noerror,
+                           rip_ns_r_nxdomain, rip_ns_r_noerror};
+
+    config_init(&cfg);
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        query_init(&q, &cfg, 0);
+        test_zone_query_request(&q, db, names[i], types[i], 0);
+        cr_assert(q.end_code == codes[i], "%s", names[i]);
+        cr_assert(q.response_soa != NULL, "%s", names[i]);
+        cr_assert(query_response_pack(&q) == 0);
+        cr_assert(q.response_hdr->id == htons(0x1234));
+        cr_assert(q.response_hdr->rcode == codes[i]);
+        cr_assert(ntohs(q.response_hdr->ancount) == 0);
+        cr_assert(ntohs(q.response_hdr->nscount) == 1);
+        test_zone_response_text(&q, text_template, sizeof(text_template));
+        /* Negative TTL is SOA minimum, lower than SOA TTL. Names compressed
+         * against question take question case.
+         */
+        cr_assert(strcasecmp(text_template, "example.com 300 1 6 ns.example.com "
+                         "admin.example.com\n") == 0, "%s", text_template);
+
+        q.response_soa = NULL;
+        cr_assert(query_response_pack(&q) == 0);
+        test_zone_response_text(&q, text_generic, sizeof(text_generic));
+        cr_assert(strcasecmp(text_template, text_generic) == 0, "%s", names[i]);
+
+        query_clean(&q);
+    }
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test response packing limited to response size. Additional section records
+ * are dropped before response is truncated, and TCP response buffer is
+ * increased from response buffer pool.
+ */
+Test(zone, test_zone_response_pack_size) {
+    char          zone[8192];
+    char          err[256]  = {'\0'};
+    char          txt[201];
+    unsigned char req[RIP_NS_PACKETSZ + 1];
+    size_t        len       = 0;
+    zone_db_t    *db        = NULL;
+    zone_node_t  *node      = NULL;
+    zone_rrset_t *rrset     = NULL;
+    config_t      cfg;
+    buf_pool_t    pool;
+    query_t       q;
+
+    /* Name with 10 MX records, each with an address record in additional
+     * section, and name with a TXT record longer than 512 bytes.
+     */
+    len += snprintf(zone + len, sizeof(zone) - len,
+                    "example.com. 3600 IN SOA ns.example.com. admin.example.com. 1 2 3 4 5\n");
+    for (int i = 0; i < 10; i++) {
+        len += snprintf(zone + len, sizeof(zone) - len,
+                        "example.com. 3600 IN MX 10 mx%02d.example.com.\n"
+                        "mx%02d.example.com. 3600 IN AAAA 2001:db8::%d\n", i, i, i + 1);
+    }
+    memset(txt, 'x', sizeof(txt) - 1);
+    txt[sizeof(txt) - 1] = '\0';
+    len += snprintf(zone + len, sizeof(zone) - len,
+                    "txt.example.com. 60 IN TXT \"%s\" \"%s\" \"%s\"\n", txt, txt, txt);
+    db = zone_db_create(zone, len, 1, err, sizeof(err));
+    cr_assert(db != NULL, "%s", err);
+
+    node = test_zone_lookup(db, "example.com");
+    cr_assert(node != NULL);
+    rrset = zone_node_rrset_get(db, node, rip_ns_t_mx);
+    cr_assert(rrset != NULL);
+    cr_assert(rrset->wire_len > rrset->wire_an_len);
+    cr_assert(rrset->wire_fits == (ZONE_RRSET_FITS_EDNS | ZONE_RRSET_FITS_UDP_MAXMSG));
+
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+
+    /* Without EDNS response is limited to 512 bytes, additional section
+     * records are dropped, from precompiled and record by record response.
+     */
+    cr_assert(test_zone_query_pack(&q, db, "example.com", rip_ns_t_mx, 0) == 1);
+    cr_assert(q.response_rrset != NULL);
+    for (int generic = 0; generic < 2; generic++) {
+        if (generic) {
+            q.response_rrset = NULL;
+            cr_assert(query_response_pack(&q) == 1);
+        }
+        cr_assert(q.response_hdr->tc == 0);
+        cr_assert(ntohs(q.response_hdr->ancount) == 10);
+        cr_assert(ntohs(q.response_hdr->arcount) < 10);
+        cr_assert(q.response_buffer_len <= RIP_NS_PACKETSZ);
+    }
+
+    /* With EDNS UDP payload size of 1232 full response fits. */
+    cr_assert(test_zone_query_pack(&q, db, "example.com", rip_ns_t_mx, 1232) == 0);
+    cr_assert(ntohs(q.response_hdr->arcount) == 11);
+    cr_assert(q.response_buffer_len > RIP_NS_PACKETSZ);
+
+    /* Answer does not fit, response is truncated to question and EDNS. */
+    cr_assert(test_zone_query_pack(&q, db, "txt.example.com", rip_ns_t_txt, 512) == -1);
+    cr_assert(q.response_hdr->tc == 1);
+    cr_assert(ntohs(q.response_hdr->ancount) == 0);
+    cr_assert(ntohs(q.response_hdr->arcount) == 1);
+    cr_assert(q.response_buffer_len == sizeof(rip_ns_header_t) + q.query_question_len +
+                                       1 + RIP_NS_RRFIXEDSZ);
+    query_clean(&q);
+
+    /* TCP response buffer is increased from pool, and returned to it. */
+    cfg.tcp_writebuff_size = 2 + RIP_NS_PACKETSZ;
+    buf_pool_init(&pool, RIP_NS_UDP_MAXMSG, RIP_NS_MAXMSG + 2, 4, MEM_TAG_TCP_BUFS);
+    query_init(&q, &cfg, 1);
+    q.request_buffer = req;
+    q.request_hdr    = (rip_ns_header_t *)req;
+    q.response_pool  = &pool;
+
+    cr_assert(test_zone_query_pack(&q, db, "txt.example.com", rip_ns_t_txt, 0) == 0);
+    cr_assert(q.response_hdr->tc == 0);
+    cr_assert(ntohs(q.response_hdr->ancount) == 1);
+    cr_assert(q.response_buffer_size == RIP_NS_UDP_MAXMSG);
+    cr_assert(q.response_buffer_len - 2 == (q.response_buffer[0] << 8 | q.response_buffer[1]));
+    cr_assert(q.response_buffer_len > 2 + RIP_NS_PACKETSZ);
+
+    query_tcp_response_buffer_release(&q);
+    cr_assert(q.response_buffer == q.response_buffer_own);
+    cr_assert(q.response_buffer_size == 2 + RIP_NS_PACKETSZ);
+    cr_assert(pool.classes[0].free_count == 1);
+
+    query_clean(&q);
+    buf_pool_clean(&pool);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test error responses with no records, packed from request header and
+ * question without packing names.
+ */
+Test(zone, test_zone_response_pack_error) {
+    zone_db_t     *db = test_zone_db_create();
+    unsigned char *opt;
+    uint16_t       gen;
+    config_t       cfg;
+    query_t        q;
+
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+
+    /* REFUSED for name outside of zones, with EDNS OPT RR from template. */
+    test_zone_query_request(&q, db, "www.Example.org", rip_ns_t_a, 1232);
+    cr_assert(q.end_code == rip_ns_r_refused);
+    gen = q.comp.gen;
+    cr_assert(query_response_pack(&q) == 0);
+    cr_assert(q.comp.gen == gen);
+    cr_assert(q.response_hdr->id == htons(0x1234));
+    cr_assert(q.response_hdr->qr == 1);
+    cr_assert(q.response_hdr->aa == 0);
+    cr_assert(q.response_hdr->rcode == rip_ns_r_refused);
+    cr_assert(ntohs(q.response_hdr->qdcount) == 1);
+    cr_assert(ntohs(q.response_hdr->ancount) == 0);
+    cr_assert(ntohs(q.response_hdr->nscount) == 0);
+    cr_assert(ntohs(q.response_hdr->arcount) == 1);
+    cr_assert(q.response_edns_offset == sizeof(rip_ns_header_t) + q.query_question_len);
+    cr_assert(q.response_buffer_len == q.response_edns_offset + 1 + RIP_NS_RRFIXEDSZ);
+    opt = (unsigned char *)q.response_hdr + q.response_edns_offset;
+    cr_assert(opt[0] == 0 && (opt[1] << 8 | opt[2]) == rip_ns_t_opt);
+    cr_assert((opt[3] << 8 | opt[4]) == 1232);
+    cr_assert(opt[9] == 0 && opt[10] == 0);
+
+    /* NOTIMPL for unsupported type, question is echoed. */
+    test_zone_query_request(&q, db, "www.example.com", 65000, 0);
+    cr_assert(q.end_code == rip_ns_r_notimpl);
+    cr_assert(query_response_pack(&q) == 0);
+    cr_assert(q.response_hdr->qr == 1);
+    cr_assert(q.response_hdr->rcode == rip_ns_r_notimpl);
+    cr_assert(ntohs(q.response_hdr->qdcount) == 1);
+    cr_assert(ntohs(q.response_hdr->arcount) == 0);
+    cr_assert(q.response_buffer_len == sizeof(rip_ns_header_t) + q.query_question_len);
+    opt = (unsigned char *)q.response_hdr + q.response_buffer_len - RIP_NS_QFIXEDSZ;
+    cr_assert((opt[0] << 8 | opt[1]) == 65000);
+
+    query_clean(&q);
+    config_clean(&cfg);
+    zone_db_release(db);
+}
+
+/** Test zone transfer resolution, and zone transfer messages sent from zone
+ * image, starting and ending with zone SOA record.
+ */
+Test(zone, test_zone_db_xfr) {
+    char           path[] = "/tmp/test_zone_image_XXXXXX";
+    char           err[256] = {'\0'};
+    zone_db_t     *db = test_zone_db_create();
+    zone_db_t     *img;
+    zone_xfr_stream_t *s;
+    struct stat    st;
+    config_t       cfg;
+    query_t        q;
+    int            fd;
+    int            sv[2];
+    uint8_t        buf[4096];
+    ssize_t        len = 0;
+    uint8_t       *p;
+    uint8_t       *ans;
+
+    /* One transfer of 13 records: SOA, 11 records including glue, SOA. */
+    cr_assert(zone_db_xfr_compile(db, err, sizeof(err)) == 0, "%s", err);
+    cr_assert(db->xfrs_count == 1 && db->xfr_msgs_count == 1);
+    cr_assert(db->xfrs[0].serial == 1);
+    cr_assert(db->xfr_msgs[0].ancount == 13);
+    ans = db->xfr_data + db->xfr_msgs[0].offset;
+    cr_assert(ans[0] == 0xc0 && ans[1] == 12 && (ans[2] << 8 | ans[3]) == rip_ns_t_soa);
+
+    /* Transfers are only served from zone image. */
+    cr_assert(zone_db_xfr_find(db, test_zone_lookup(db, "example.com")) == NULL);
+    fd = mkstemp(path);
+    cr_assert(fd >= 0);
+    close(fd);
+    cr_assert(zone_db_image_write(db, path, err, sizeof(err)) == 0, "%s", err);
+    zone_db_release(db);
+    fd = open(path, O_RDONLY);
+    cr_assert(fd >= 0);
+    cr_assert(fstat(fd, &st) == 0);
+    img = zone_db_image_load(fd, st.st_size, 1, err, sizeof(err));
+    close(fd);
+    unlink(path);
+    cr_assert(img != NULL, "%s", err);
+    cr_assert(img->image_fd >= 0);
+
+    /* AXFR over UDP is refused, IXFR over UDP answered with SOA. */
+    config_init(&cfg);
+    query_init(&q, &cfg, 0);
+    test_zone_query_request(&q, img, "example.com", rip_ns_t_axfr, 0);
+    cr_assert(q.end_code == rip_ns_r_refused && q.xfr == NULL);
+    test_zone_query_request(&q, img, "example.com", rip_ns_t_ixfr, 0);
+    cr_assert(q.end_code == rip_ns_r_noerror && q.answer_section_count == 1);
+
+    /* Over TCP, zone transfer is resolved for zone apex only. */
+    q.protocol = 1;
+    test_zone_query_request(&q, img, "www.example.com", rip_ns_t_axfr, 0);
+    cr_assert(q.end_code == rip_ns_r_notauth && q.xfr == NULL);
+    test_zone_query_request(&q, img, "example.com", rip_ns_t_axfr, 0);
+    cr_assert(q.end_code == rip_ns_r_noerror && q.xfr != NULL);
+
+    /* Stream transfer over socket. */
+    cr_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    s = zone_xfr_stream_new(img, q.xfr, (const uint8_t *)q.request_hdr,
+                            q.query_question_len);
+    cr_assert(s != NULL);
+    cr_assert(zone_xfr_stream_send(s, sv[0], SIZE_MAX) > 0);
+    cr_assert(zone_xfr_stream_done(s));
+    zone_xfr_stream_free(s);
+    close(sv[0]);
+    while (len < (ssize_t)sizeof(buf)) {
+        ssize_t ret = read(sv[1], buf + len, sizeof(buf) - len);
+        if (ret <= 0) {
+            break;
+        }
+        len += ret;
+    }
+    close(sv[1]);
+    cr_assert(len > 2 + (ssize_t)sizeof(rip_ns_header_t));
+    cr_assert((buf[0] << 8 | buf[1]) == len - 2);
+    p = buf + 2;
+    cr_assert((p[0] << 8 | p[1]) == 0x1234);
+    cr_assert(p[2] & 0x80 && p[2] & 0x04);
+    cr_assert((p[4] << 8 | p[5]) == 1 && (p[6] << 8 | p[7]) == 13);
+    ans = p + sizeof(rip_ns_header_t) + q.query_question_len;
+    cr_assert(ans[0] == 0xc0 && ans[1] == 12 && (ans[2] << 8 | ans[3]) == rip_ns_t_soa);
+
+    q.protocol = 0;
+    query_clean(&q);
+    config_clean(&cfg);
+    zone_db_release(img);
+}
+
+/** Test zone database prefault and mlock, locking may fail with limited
+ * RLIMIT_MEMLOCK, in which case database is left unlocked.
+ */
+Test(zone, test_zone_db_prefault_mlock) {
+    char       err[256] = {'\0'};
+    zone_db_t *db       = test_zone_db_create();
+    zone_db_t *delta    = zone_db_apply(db, "", 0, 2, err, sizeof(err));
+    size_t     locked;
+    int        ret;
+
+    cr_assert(delta != NULL, "%s", err);
+    cr_assert(zone_db_prefault(delta) >= sizeof(zone_node_t) * (db->nodes_count +
+                                                                delta->nodes_count));
+
+    ret = zone_db_mlock(delta, &locked);
+    if (ret == 0) {
+        cr_assert(delta->locked && db->locked);
+        cr_assert(locked >= db->names_len + delta->names_len);
+
+        /* Databases already locked are skipped. */
+        cr_assert(zone_db_mlock(delta, &locked) == 0 && locked == 0);
+    } else {
+        cr_assert(ret == -ENOMEM || ret == -EPERM || ret == -EAGAIN);
+        cr_assert(!delta->locked);
+    }
+    cr_assert(test_zone_lookup(delta, "www.example.com") != NULL);
+
+    zone_db_release(db);
+    zone_db_release(delta);
+}
+
+/** @}*/
@@ -0,0 +1,253 @@
+/**
+ * @file test_zone_catalog.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup zone_catalog_ut Zone Catalog
+ *
+ * @brief Zone catalog unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rip_ns_utils.h"
+#include "zone.h"
+#include "zone_catalog.h"
+
+/**! @cond */
+TestSuite(zone_catalog);
+
+/** Zone files test loader serves, every zone file is at version 1 except
+ * changed one.
+ */
+typedef struct test_zone_catalog_files_s {
+    const char *changed;
+    int         changed_version;
+    int         loads;
+} test_zone_catalog_files_t;
+
+static const char *test_zone_catalog_file =
+    "; test catalog\n"
+    "example.com        example.com.zone\n"
+    "sub.example.com.   sub.example.com.zone   ; nested zone\n"
+    "\n"
+    "EXAMPLE.net        example.net.zone\n";
+
+/* Zone file "<apex>.zone" holds zone of apex, "bad.zone" does not load. */
+static int
+test_zone_catalog_zone_load(void *ctx, const char *filepath, struct timespec *create_time,
+                            uint64_t generation, zone_db_t **db, char *err, size_t err_len)
+{
+    test_zone_catalog_files_t *files   = ctx;
+    int                        version = 1;
+    char                       apex[256];
+    char                       zone[1024];
+    int                        len;
+
+    if (strcmp(filepath, "bad.zone") == 0) {
+        snprintf(err, err_len, "no such file");
+        return -1;
+    }
+    if (files->changed != NULL && strcmp(filepath, files->changed) == 0) {
+        version = files->changed_version;
+    }
+    if (create_time->tv_sec == version) {
+        return 0;
+    }
+    snprintf(apex, sizeof(apex), "%.*s", (int)(strlen(filepath) - 5), filepath);
+    len = snprintf(zone, sizeof(zone),
+                   "%s. 3600 IN SOA ns.%s. admin.%s. 1 7200 3600 1209600 300\n"
+                   "www.%s. 60 IN A 10.0.0.%d\n", apex, apex, apex, apex, version);
+    *db = zone_db_create(zone, len, generation, err, err_len);
+    if (*db == NULL) {
+        return -1;
+    }
+    create_time->tv_sec = version;
+    files->loads++;
+    return 1;
+}
+
+static uint32_t
+test_zone_catalog_find(zone_catalog_t *catalog, const char *name)
+{
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    return zone_catalog_find(catalog, wire, rip_ns_name_lc(wire));
+}
+
+static void
+test_zone_catalog_create_fail(const char *file, const char *expected)
+{
+    test_zone_catalog_files_t files    = {};
+    char                      err[256] = {'\0'};
+    zone_catalog_t           *catalog  = zone_catalog_create(file, strlen(file), NULL, 1,
+                                                             &test_zone_catalog_zone_load,
+                                                             &files, err, sizeof(err));
+
+    cr_assert(catalog == NULL, "%s", file);
+    cr_assert(strstr(err, expected) != NULL, "%s: %s", file, err);
+}
+/**! @endcond */
+
+/** Test names are matched to zone of longest apex that is their ancestor,
+ * and zone databases get generations of their own.
+ */
+Test(zone_catalog, test_zone_catalog_find) {
+    test_zone_catalog_files_t files    = {};
+    char                      err[256] = {'\0'};
+    zone_catalog_t           *catalog;
+    zone_db_t                *db;
+
+    catalog = zone_catalog_create(test_zone_catalog_file, strlen(test_zone_catalog_file),
+                                  NULL, 3, &test_zone_catalog_zone_load, &files,
+                                  err, sizeof(err));
+    cr_assert(catalog != NULL, "%s", err);
+    cr_assert(err[0] == '\0', "%s", err);
+    cr_assert(catalog->index->zones_count == 3);
+    cr_assert(catalog->pages_count == 1);
+    cr_assert(catalog->loaded == 3);
+
+    cr_assert(test_zone_catalog_find(catalog, "example.com") == 1);
+    cr_assert(test_zone_catalog_find(catalog, "a.b.EXAMPLE.com") == 1);
+    cr_assert(test_zone_catalog_find(catalog, "sub.example.com") == 2);
+    cr_assert(test_zone_catalog_find(catalog, "www.sub.example.com") == 2);
+    cr_assert(test_zone_catalog_find(catalog, "example.net") == 3);
+    cr_assert(test_zone_catalog_find(catalog, "example.org") == 0);
+    cr_assert(test_zone_catalog_find(catalog, "com") == 0);
+    cr_assert(test_zone_catalog_find(catalog, ".") == 0);
+    cr_assert(test_zone_catalog_find(catalog, "a.b.c.d.e.f.g.example.net") == 3);
+
+    db = zone_catalog_db(catalog, 2);
+    cr_assert(db->generation == (ZONE_CATALOG_GENERATION_BIT | 3ULL << 32 | 1));
+    cr_assert(zone_db_lookup(db, (const unsigned char *)"\3www\3sub\7example\3com", 21) != NULL);
+    zone_catalog_release(catalog);
+}
+
+/** Test catalog generation derived on zone file change shares apex index,
+ * unchanged pages and unchanged zone databases.
+ */
+Test(zone_catalog, test_zone_catalog_refresh) {
+    test_zone_catalog_files_t files    = {};
+    char                      err[256] = {'\0'};
+    char                     *file     = malloc(600 * 32);
+    size_t                    len      = 0;
+    zone_catalog_t           *catalog;
+    zone_catalog_t           *next;
+
+    for (int i = 0; i < 600; i++) {
+        len += sprintf(file + len, "z%d.example z%d.example.zone\n", i, i);
+    }
+    catalog = zone_catalog_create(file, len, NULL, 1, &test_zone_catalog_zone_load,
+                                  &files, err, sizeof(err));
+    cr_assert(catalog != NULL, "%s", err);
+    cr_assert(catalog->pages_count == 3);
+    cr_assert(files.loads == 600);
+
+    /* Nothing changed, no new generation. */
+    cr_assert(zone_catalog_refresh(catalog, 2, &test_zone_catalog_zone_load, &files,
+                                   err, sizeof(err)) == NULL);
+    cr_assert(err[0] == '\0');
+
+    files.changed         = "z300.example.zone";
+    files.changed_version = 2;
+    next = zone_catalog_refresh(catalog, 2, &test_zone_catalog_zone_load, &files,
+                                err, sizeof(err));
+    cr_assert(next != NULL);
+    cr_assert(files.loads == 601);
+    cr_assert(next->loaded == 1);
+    cr_assert(next->generation == 2);
+    cr_assert(next->index == catalog->index);
+    cr_assert(next->index->refs == 2);
+    cr_assert(next->pages[0] == catalog->pages[0]);
+    cr_assert(next->pages[2] == catalog->pages[2]);
+    cr_assert(next->pages[1] != catalog->pages[1]);
+    cr_assert(next->pages[1]->dbs[43] == catalog->pages[1]->dbs[43]);
+    cr_assert(next->pages[1]->dbs[44] != catalog->pages[1]->dbs[44]);
+    cr_assert(test_zone_catalog_find(next, "www.z300.example") == 301);
+    cr_assert(zone_catalog_db(next, 301)->generation ==
+              (ZONE_CATALOG_GENERATION_BIT | 2ULL << 32 | 300));
+
+    /* Generations are released in either order. */
+    zone_catalog_release(catalog);
+    cr_assert(next->index->refs == 1);
+    cr_assert(next->pages[0]->refs == 1);
+    zone_catalog_release(next);
+    free(file);
+}
+
+/** Test catalog file change keeps zone databases of zones whose zone file
+ * did not change, and zones that do not load are reported and kept.
+ */
+Test(zone_catalog, test_zone_catalog_reload) {
+    test_zone_catalog_files_t files    = {};
+    char                      err[256] = {'\0'};
+    const char               *file     = "example.com example.com.zone\n"
+                                         "example.net example.net.zone\n"
+                                         "example.org bad.zone\n"
+                                         "example.info example.net.zone\n";
+    zone_catalog_t           *catalog;
+    zone_catalog_t           *next;
+
+    catalog = zone_catalog_create(test_zone_catalog_file, strlen(test_zone_catalog_file),
+                                  NULL, 1, &test_zone_catalog_zone_load, &files,
+                                  err, sizeof(err));
+    cr_assert(catalog != NULL, "%s", err);
+
+    next = zone_catalog_create(file, strlen(file), catalog, 2, &test_zone_catalog_zone_load,
+                               &files, err, sizeof(err));
+    cr_assert(next != NULL);
+    cr_assert(strstr(err, "zone \"example.org\" zone file \"bad.zone\" error: no such file, "
+                          "and 1 more zones") != NULL, "%s", err);
+    cr_assert(next->index != catalog->index);
+    cr_assert(next->loaded == 0);
+    cr_assert(zone_catalog_db(next, 1) == zone_catalog_db(catalog, 1));
+    cr_assert(zone_catalog_db(next, 2) == zone_catalog_db(catalog, 3));
+
+    /* Zones that did not load are answered from main zone database. */
+    cr_assert(zone_catalog_db(next, 3) == NULL);
+    cr_assert(test_zone_catalog_find(next, "www.example.org") == 0);
+    cr_assert(zone_catalog_db(next, 4) == NULL);
+    cr_assert(test_zone_catalog_find(next, "example.info") == 0);
+    zone_catalog_release(catalog);
+    zone_catalog_release(next);
+}
+
+/** Test catalog file errors. */
+Test(zone_catalog, test_zone_catalog_create_fail) {
+    test_zone_catalog_create_fail("", "no zones");
+    test_zone_catalog_create_fail("; only a comment\n", "no zones");
+    test_zone_catalog_create_fail("example.com\n", "line 1: invalid format");
+    test_zone_catalog_create_fail("example.com a.zone b.zone\n", "line 1: invalid format");
+    test_zone_catalog_create_fail("example..com example.com.zone\n",
+                                  "line 1: invalid zone apex");
+    test_zone_catalog_create_fail("example.com example.com.zone\n"
+                                  "EXAMPLE.com. other.zone\n",
+                                  "duplicate zone \"example.com\"");
+}
+
+/** @}*/
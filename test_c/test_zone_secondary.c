@@ -0,0 +1,272 @@
+/**
+ * @file test_zone_secondary.c
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \ingroup unit_tests 
+ * \defgroup zone_secondary_ut Secondary Zones
+ *
+ * @brief Secondary zones unit tests
+ *  @{
+ */
+#include <criterion/criterion.h>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "rip_ns_utils.h"
+#include "zone.h"
+#include "zone_secondary.h"
+
+/**! @cond */
+TestSuite(zone_secondary);
+
+typedef struct test_msg_s {
+    uint8_t  buf[4096];
+    uint8_t *ptr;
+    uint16_t ancount;
+} test_msg_t;
+
+static void
+test_msg_init(test_msg_t *m)
+{
+    rip_ns_header_t *header = (rip_ns_header_t *)m->buf;
+
+    memset(m->buf, 0, sizeof(rip_ns_header_t));
+    header->qr      = 1;
+    header->qdcount = htons(1);
+    m->ptr = m->buf + sizeof(rip_ns_header_t);
+    cr_assert(rip_ns_name_pton((const unsigned char *)"example.org", m->ptr, 64) >= 0);
+    m->ptr += rip_ns_name_lc(m->ptr);
+    RIP_NS_PUT16(rip_ns_t_axfr, m->ptr);
+    RIP_NS_PUT16(rip_ns_c_in, m->ptr);
+    m->ancount = 0;
+}
+
+static void
+test_msg_rr(test_msg_t *m, const char *name, uint16_t type, const uint8_t *rdata,
+            uint16_t rdata_len)
+{
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, m->ptr, 256) >= 0);
+    m->ptr += rip_ns_name_lc(m->ptr);
+    RIP_NS_PUT16(type, m->ptr);
+    RIP_NS_PUT16(rip_ns_c_in, m->ptr);
+    RIP_NS_PUT32(60, m->ptr);
+    RIP_NS_PUT16(rdata_len, m->ptr);
+    memcpy(m->ptr, rdata, rdata_len);
+    m->ptr += rdata_len;
+    m->ancount++;
+}
+
+static void
+test_msg_soa(test_msg_t *m, uint32_t serial)
+{
+    uint8_t  rdata[22] = {0};
+    uint8_t *p         = rdata + 2;
+
+    RIP_NS_PUT32(serial, p);
+    RIP_NS_PUT32(3600, p);
+    RIP_NS_PUT32(600, p);
+    test_msg_rr(m, "example.org", rip_ns_t_soa, rdata, sizeof(rdata));
+}
+
+static void
+test_msg_a(test_msg_t *m, const char *name, uint8_t last)
+{
+    uint8_t rdata[4] = {192, 0, 2, last};
+
+    test_msg_rr(m, name, rip_ns_t_a, rdata, sizeof(rdata));
+}
+
+static int
+test_msg_parse(zone_secondary_t *zs, zone_secondary_xfr_t *xfr, test_msg_t *m)
+{
+    char err[256] = {'\0'};
+    int  ret      = 0;
+
+    ((rip_ns_header_t *)m->buf)->ancount = htons(m->ancount);
+    ret = zone_secondary_xfr_parse(zs, xfr, m->buf, m->ptr - m->buf, err, sizeof(err));
+    cr_assert(ret >= 0, "%s", err);
+    return ret;
+}
+
+static void
+test_secondary_init(zone_secondary_t *zs)
+{
+    config_t cfg;
+    char     err[256] = {'\0'};
+
+    config_init(&cfg);
+    free(cfg.zone_secondary);
+    cfg.zone_secondary = strdup("example.org,Example.NET.");
+    cr_assert(utl_net_parse(&cfg.zone_primary, "192.0.2.53") == 0);
+    cr_assert(zone_secondary_init(zs, &cfg, NULL, err, sizeof(err)) == 0, "%s", err);
+    config_clean(&cfg);
+}
+
+static zone_rrset_t *
+test_rrset(zone_db_t *db, const char *name, uint16_t type)
+{
+    unsigned char wire[RIP_NS_MAXCDNAME + 1];
+    zone_node_t  *node;
+
+    cr_assert(rip_ns_name_pton((const unsigned char *)name, wire, sizeof(wire)) >= 0);
+    node = zone_db_lookup(db, wire, rip_ns_name_lc(wire));
+    return node != NULL ? zone_node_rrset_get(db, node, type) : NULL;
+}
+/**! @endcond */
+
+/** Test secondary zones state, zone names and NOTIFY source check. */
+Test(zone_secondary, test_zone_secondary_notify) {
+    zone_secondary_t        zs;
+    struct sockaddr_storage ss   = {};
+    struct sockaddr_in     *sin  = (struct sockaddr_in *)&ss;
+    unsigned char           name[] = "\7example\3net";
+
+    test_secondary_init(&zs);
+    cr_assert(zs.zones_count == 2);
+    cr_assert(strcmp(zs.zones[1].text, "example.net") == 0);
+    cr_assert(zs.zones[1].name_len == sizeof(name));
+
+    sin->sin_family = AF_INET;
+    inet_pton(AF_INET, "192.0.2.1", &sin->sin_addr);
+    cr_assert(!zone_secondary_notify(&zs, name, sizeof(name), &ss));
+    cr_assert(!atomic_load(&zs.zones[1].notified));
+    inet_pton(AF_INET, "192.0.2.53", &sin->sin_addr);
+    cr_assert(!zone_secondary_notify(&zs, (unsigned char *)"\3com", 5, &ss));
+    cr_assert(zone_secondary_notify(&zs, name, sizeof(name), &ss));
+    cr_assert(atomic_load(&zs.zones[1].notified));
+    cr_assert(!atomic_load(&zs.zones[0].notified));
+    zone_secondary_clean(&zs);
+}
+
+/** Test full and incremental transfer responses are parsed into updates, and
+ * applied to zone database.
+ */
+Test(zone_secondary, test_zone_secondary_xfr) {
+    zone_secondary_t      zs;
+    zone_secondary_xfr_t  xfr = {};
+    test_msg_t            m;
+    zone_db_t            *db  = NULL;
+    zone_db_t            *next = NULL;
+    uint64_t              generation = 0;
+    zone_rrset_t         *rrset;
+
+    test_secondary_init(&zs);
+
+    /* Full zone in two messages, record of another zone is skipped. */
+    xfr.update = zone_secondary_update_new(0, true);
+    test_msg_init(&m);
+    test_msg_soa(&m, 1);
+    test_msg_a(&m, "www.example.org", 1);
+    test_msg_a(&m, "old.example.org", 1);
+    cr_assert(test_msg_parse(&zs, &xfr, &m) == 0);
+    test_msg_init(&m);
+    test_msg_a(&m, "www.example.com", 1);
+    test_msg_soa(&m, 1);
+    cr_assert(test_msg_parse(&zs, &xfr, &m) == 1);
+    cr_assert(!xfr.incremental && !xfr.current);
+    cr_assert(xfr.update->serial == 1 && xfr.refresh == 3600 && xfr.retry == 600);
+    cr_assert(xfr.update->rrs_count == 3);
+    zone_secondary_update_push(&zs, xfr.update);
+
+    db = zone_secondary_db_update(&zs, NULL, NULL, &generation);
+    cr_assert(db != NULL);
+    cr_assert(generation == 1);
+    cr_assert(zs.zones[0].applied);
+    cr_assert(test_rrset(db, "old.example.org", rip_ns_t_a) != NULL);
+
+    /* Up to date. */
+    xfr = (zone_secondary_xfr_t) { .ixfr = true, .serial = 1 };
+    xfr.update = zone_secondary_update_new(0, true);
+    test_msg_init(&m);
+    test_msg_soa(&m, 1);
+    cr_assert(test_msg_parse(&zs, &xfr, &m) == 1);
+    cr_assert(xfr.current);
+    zone_secondary_update_free(xfr.update);
+
+    /* Incremental, two difference sequences. */
+    xfr = (zone_secondary_xfr_t) { .ixfr = true, .serial = 1 };
+    xfr.update = zone_secondary_update_new(0, true);
+    test_msg_init(&m);
+    test_msg_soa(&m, 3);
+    test_msg_soa(&m, 1);
+    test_msg_a(&m, "old.example.org", 1);
+    test_msg_soa(&m, 2);
+    test_msg_a(&m, "www.example.org", 2);
+    test_msg_soa(&m, 2);
+    test_msg_a(&m, "www.example.org", 1);
+    test_msg_soa(&m, 3);
+    test_msg_a(&m, "new.example.org", 3);
+    test_msg_soa(&m, 3);
+    cr_assert(test_msg_parse(&zs, &xfr, &m) == 1);
+    cr_assert(xfr.incremental);
+    cr_assert(xfr.update->rrs_count == 8);
+    cr_assert(xfr.update->rrs[0].class == rip_ns_c_none &&
+              xfr.update->rrs[0].type == rip_ns_t_soa);
+    cr_assert(xfr.update->rrs[1].class == rip_ns_c_none);
+    cr_assert(xfr.update->rrs[2].class == rip_ns_c_in);
+    xfr.update->full = false;
+    zone_secondary_update_push(&zs, xfr.update);
+
+    next = zone_secondary_db_update(&zs, db, NULL, &generation);
+    cr_assert(next != NULL && next->base == db);
+    zone_db_release(db);
+    db = next;
+    cr_assert(test_rrset(db, "old.example.org", rip_ns_t_a) == NULL);
+    rrset = test_rrset(db, "www.example.org", rip_ns_t_a);
+    cr_assert(rrset->rr_count == 1 && rrset->rrs[0].rdata[3] == 2);
+    cr_assert(test_rrset(db, "new.example.org", rip_ns_t_a) != NULL);
+    rrset = test_rrset(db, "example.org", rip_ns_t_soa);
+    cr_assert(rrset->rr_count == 1 && rrset->rrs[0].rdata[5] == 3);
+
+    /* Incremental update deleting record not in zone does not apply, zone is
+     * flagged for full transfer and further incremental updates skipped.
+     */
+    for (int i = 0; i < 2; i++) {
+        zone_secondary_update_t *update = zone_secondary_update_new(0, false);
+        uint8_t                  a[]    = {192, 0, 2, 9};
+
+        zone_secondary_update_add(update, "www.example.org", rip_ns_t_a, rip_ns_c_none,
+                                  60, a, sizeof(a));
+        zone_secondary_update_push(&zs, update);
+    }
+    cr_assert(zone_secondary_db_update(&zs, db, NULL, &generation) == NULL);
+    cr_assert(atomic_load(&zs.zones[0].failed));
+    cr_assert(zs.zones[0].broken);
+
+    /* Zone file layer changed, secondary zone is carried over onto it. */
+    next = zone_secondary_db_update(&zs, db,
+                                    zone_db_create("x.example.com. 60 IN A 192.0.2.1\n",
+                                                   32, 10, NULL, 0), &generation);
+    cr_assert(next != NULL);
+    cr_assert(test_rrset(next, "x.example.com", rip_ns_t_a) != NULL);
+    cr_assert(test_rrset(next, "new.example.org", rip_ns_t_a) != NULL);
+    zone_db_release(next);
+
+    zone_db_release(db);
+    zone_secondary_clean(&zs);
+}
+/** @}*/
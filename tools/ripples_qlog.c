@@ -0,0 +1,545 @@
+/**
+ * @file xor_filter.h
+ * @author Faruk Grozdanic
+ * @copyright Released under MIT license.
+ *
+ * Copyright (c) 2025 Faruk Grozdanic
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/** \defgroup qlog_tool Query Log Tool
+ *
+ * @brief Offline tool printing queries of a time window and/or question name
+ *        from rotated query log files.
+ *
+ *        With an index file next to query log file (see
+ *        @ref query_log_index and configuration setting "query_log_index")
+ *        only blocks whose receive time range overlaps window and whose
+ *        Bloom filter may contain question name are read and decoded,
+ *        compressed blocks being whole gzip members. Without index whole file
+ *        is decoded. Lines of decoded blocks are then matched one by one, so
+ *        output is exact either way.
+ *  @{
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "query_log_index.h"
+
+/** Size of chunks unindexed files are read in. */
+#define QLOG_READ_LEN (1 << 20)
+
+/** Structure holds tool settings and totals. */
+typedef struct qlog_cfg_s {
+    /** Oldest receive time of queries to print, nanoseconds since epoch. */
+    uint64_t from;
+
+    /** Newest receive time of queries to print, nanoseconds since epoch. */
+    uint64_t to;
+
+    /** Question name of queries to print, NULL for all. */
+    const char *qname;
+
+    /** Length of qname, without trailing dot. */
+    size_t qname_len;
+
+    /** Hash of qname, see @ref query_log_index_name_hash. */
+    uint64_t qname_hash;
+
+    /** Set to print totals to stderr. */
+    bool stats;
+
+    /** Number of blocks in index files read. */
+    uint64_t blocks;
+
+    /** Number of blocks decoded. */
+    uint64_t blocks_read;
+
+    /** Number of bytes decoded. */
+    uint64_t bytes_read;
+
+    /** Number of lines printed. */
+    uint64_t matched;
+} qlog_cfg_t;
+
+/** Parse time as RFC 3339 UTC time as written in query log
+ * ("2024-01-02T03:04:05.123456789Z", fraction optional), or as seconds since
+ * epoch.
+ *
+ * @param str String to parse, not NUL terminated.
+ * @param len Length of str.
+ * @param ns  Where to store time in nanoseconds since epoch.
+ *
+ * @return    Returns 0 on success, -1 if str is not a valid time.
+ */
+static int
+qlog_time_parse(const char *str, size_t len, uint64_t *ns)
+{
+    struct tm tm = {0};
+    char      buf[64];
+    char     *end;
+    uint64_t  frac   = 0;
+    int       digits = 0;
+
+    if (len == 0 || len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+
+    if (strspn(buf, "0123456789") == len) {
+        *ns = strtoull(buf, NULL, 10) * 1000000000ULL;
+        return 0;
+    }
+
+    end = strptime(buf, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (end == NULL) {
+        return -1;
+    }
+    if (*end == '.') {
+        for (end++; *end >= '0' && *end <= '9'; end++) {
+            if (digits < 9) {
+                frac = frac * 10 + (*end - '0');
+                digits++;
+            }
+        }
+        for (; digits < 9; digits++) {
+            frac *= 10;
+        }
+    }
+    if (strcmp(end, "Z") != 0) {
+        return -1;
+    }
+    *ns = (uint64_t)timegm(&tm) * 1000000000ULL + frac;
+    return 0;
+}
+
+/** Find value of a JSON string field in query log line.
+ *
+ * @param line    Query log line.
+ * @param len     Length of line.
+ * @param key     Field key with quotes and colon, I.E: "\"q_name\":\"".
+ * @param val_len Where to store length of value.
+ *
+ * @return        Returns pointer to value, NULL if line has no such field.
+ */
+static const char *
+qlog_field(const char *line, size_t len, const char *key, size_t *val_len)
+{
+    const char *val = memmem(line, len, key, strlen(key));
+    const char *end;
+
+    if (val == NULL) {
+        return NULL;
+    }
+    val += strlen(key);
+    end  = memchr(val, '"', line + len - val);
+    if (end == NULL) {
+        return NULL;
+    }
+    *val_len = end - val;
+    return val;
+}
+
+/** Check if query log line matches time window and question name.
+ *
+ * @param cfg  Tool settings.
+ * @param line Query log line, without new line.
+ * @param len  Length of line.
+ *
+ * @return     Returns true if line is to be printed.
+ */
+static bool
+qlog_line_match(qlog_cfg_t *cfg, const char *line, size_t len)
+{
+    const char *val;
+    size_t      val_len;
+    uint64_t    ns;
+
+    if (cfg->from > 0 || cfg->to < UINT64_MAX) {
+        val = qlog_field(line, len, "\"recv_time\":\"", &val_len);
+        if (val == NULL || qlog_time_parse(val, val_len, &ns) != 0 ||
+            ns < cfg->from || ns > cfg->to) {
+            return false;
+        }
+    }
+    if (cfg->qname != NULL) {
+        val = qlog_field(line, len, "\"q_name\":\"", &val_len);
+        if (val == NULL) {
+            return false;
+        }
+        if (val_len > 1 && val[val_len - 1] == '.') {
+            val_len--;
+        }
+        if (val_len != cfg->qname_len || strncasecmp(val, cfg->qname, val_len) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Print lines of text matching time window and question name. Text after
+ * last new line is not matched.
+ *
+ * @param cfg  Tool settings.
+ * @param text Query log text.
+ * @param len  Length of text.
+ *
+ * @return     Returns number of bytes up to and including last new line.
+ */
+static size_t
+qlog_text_match(qlog_cfg_t *cfg, const char *text, size_t len)
+{
+    const char *line = text;
+    const char *nl;
+
+    while ((nl = memchr(line, '\n', text + len - line)) != NULL) {
+        if (nl > line && qlog_line_match(cfg, line, nl - line)) {
+            fwrite(line, 1, nl - line + 1, stdout);
+            cfg->matched++;
+        }
+        line = nl + 1;
+    }
+    cfg->bytes_read += line - text;
+    return line - text;
+}
+
+/** Decode and match whole query log file, plain or gzip compressed.
+ *
+ * @param cfg  Tool settings.
+ * @param fd   Query log file descriptor, closed by this function.
+ * @param path Query log file path, for error messages.
+ *
+ * @return     Returns 0 on success, -1 on error.
+ */
+static int
+qlog_file_scan(qlog_cfg_t *cfg, int fd, const char *path)
+{
+    gzFile  gz  = gzdopen(fd, "rb");
+    char   *buf = malloc(QLOG_READ_LEN);
+    size_t  len = 0;
+    size_t  used;
+    int     n;
+
+    if (gz == NULL || buf == NULL) {
+        fprintf(stderr, "Could not read %s\n", path);
+        free(buf);
+        return -1;
+    }
+    while ((n = gzread(gz, buf + len, QLOG_READ_LEN - len)) > 0) {
+        len += n;
+        used = qlog_text_match(cfg, buf, len);
+        if (used == 0 && len == QLOG_READ_LEN) {
+            /* Line longer than buffer, skip it. */
+            used = len;
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+    gzclose(gz);
+    free(buf);
+    return n < 0 ? -1 : 0;
+}
+
+/** Read block of uncompressed query log file, whole lines of its queries.
+ *
+ * @param fd  Query log file descriptor.
+ * @param e   Index entry of block.
+ * @param len Where to store length of text read.
+ *
+ * @return    Returns text, to be freed by caller, NULL on error.
+ */
+static char *
+qlog_block_read(int fd, const query_log_index_entry_t *e, size_t *len)
+{
+    char    *buf = malloc(e->len);
+    ssize_t  n;
+
+    if (buf == NULL) {
+        return NULL;
+    }
+    n = pread(fd, buf, e->len, e->offset);
+    if (n < 0) {
+        free(buf);
+        return NULL;
+    }
+    *len = n;
+    return buf;
+}
+
+/** Read and decompress block of compressed query log file, a whole gzip
+ * member.
+ *
+ * @param fd  Query log file descriptor.
+ * @param e   Index entry of block.
+ * @param len Where to store length of text decompressed.
+ *
+ * @return    Returns text, to be freed by caller, NULL on error.
+ */
+static char *
+qlog_block_inflate(int fd, const query_log_index_entry_t *e, size_t *len)
+{
+    z_stream zs   = {0};
+    char    *in   = malloc(e->len);
+    size_t   size = e->len * 8 + QLOG_READ_LEN;
+    char    *out  = malloc(size);
+    char    *tmp;
+    int      ret  = Z_DATA_ERROR;
+
+    if (in == NULL || out == NULL || pread(fd, in, e->len, e->offset) != (ssize_t)e->len ||
+        inflateInit2(&zs, 15 + 16) != Z_OK) {
+        free(in);
+        free(out);
+        return NULL;
+    }
+    zs.next_in  = (Bytef *)in;
+    zs.avail_in = e->len;
+    while (1) {
+        zs.next_out  = (Bytef *)out + zs.total_out;
+        zs.avail_out = size - zs.total_out;
+        ret = inflate(&zs, Z_FINISH);
+        if (ret != Z_BUF_ERROR || zs.avail_out != 0) {
+            break;
+        }
+        size *= 2;
+        tmp   = realloc(out, size);
+        if (tmp == NULL) {
+            break;
+        }
+        out = tmp;
+    }
+    *len = zs.total_out;
+    inflateEnd(&zs);
+    free(in);
+    if (ret != Z_STREAM_END) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/** Read index file of query log file.
+ *
+ * @param path       Query log file path.
+ * @param count      Where to store number of entries.
+ * @param compressed Where to store if query log file is compressed.
+ *
+ * @return           Returns array of entries, to be freed by caller, or NULL
+ *                   if there is no usable index.
+ */
+static query_log_index_entry_t *
+qlog_index_read(const char *path, size_t *count, bool *compressed)
+{
+    char                      idx_path[4096];
+    query_log_index_header_t  hdr;
+    query_log_index_entry_t  *entries;
+    struct stat               st;
+    int                       fd;
+
+    snprintf(idx_path, sizeof(idx_path), "%s%s", path, QUERY_LOG_INDEX_SUFFIX);
+    fd = open(idx_path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        query_log_index_header_check(&hdr) != 0) {
+        fprintf(stderr, "Ignoring index %s, it is not a valid index\n", idx_path);
+        close(fd);
+        return NULL;
+    }
+
+    /* Last entry may be partly written, it is left out. */
+    *count      = (st.st_size - sizeof(hdr)) / sizeof(query_log_index_entry_t);
+    *compressed = (hdr.flags & QUERY_LOG_INDEX_F_COMPRESSED) != 0;
+    entries     = malloc(*count * sizeof(query_log_index_entry_t) + 1);
+    if (entries == NULL ||
+        read(fd, entries, *count * sizeof(query_log_index_entry_t)) !=
+            (ssize_t)(*count * sizeof(query_log_index_entry_t))) {
+        fprintf(stderr, "Could not read index %s\n", idx_path);
+        free(entries);
+        entries = NULL;
+    }
+    close(fd);
+    return entries;
+}
+
+/** Print queries of query log file matching time window and question name,
+ * decoding only blocks index says may have them.
+ *
+ * @param cfg  Tool settings.
+ * @param path Query log file path.
+ *
+ * @return     Returns 0 on success, -1 on error.
+ */
+static int
+qlog_file(qlog_cfg_t *cfg, const char *path)
+{
+    query_log_index_entry_t *entries;
+    query_log_index_entry_t *e;
+    size_t                   count;
+    size_t                   len;
+    bool                     compressed;
+    char                    *text;
+    int                      ret = 0;
+    int                      fd  = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "Could not open %s, %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    entries = qlog_index_read(path, &count, &compressed);
+    if (entries == NULL) {
+        return qlog_file_scan(cfg, fd, path);
+    }
+
+    cfg->blocks += count;
+    for (size_t i = 0; i < count; i++) {
+        e = &entries[i];
+        if (e->time_last < cfg->from || e->time_first > cfg->to ||
+            (cfg->qname != NULL && !query_log_index_contain(e, cfg->qname_hash))) {
+            continue;
+        }
+
+        text = compressed ? qlog_block_inflate(fd, e, &len) : qlog_block_read(fd, e, &len);
+        if (text == NULL) {
+            fprintf(stderr, "Could not read block at offset %llu of %s\n",
+                    (unsigned long long)e->offset, path);
+            ret = -1;
+            continue;
+        }
+        cfg->blocks_read++;
+        qlog_text_match(cfg, text, len);
+        free(text);
+    }
+    free(entries);
+    close(fd);
+    return ret;
+}
+
+/** Print usage. */
+static void
+qlog_usage(void)
+{
+    printf("Usage: ripples_qlog [options] <query log file>...\n\n"
+           "Print queries of a time window and/or question name from query log\n"
+           "files. Files with an index (written with --query_log_index) are only\n"
+           "decoded in blocks that may have matching queries.\n\n"
+           "  --from <time>          Oldest receive time, RFC 3339 UTC time\n"
+           "                         (2024-01-02T03:04:05.5Z) or seconds since epoch.\n"
+           "  --to <time>            Newest receive time, same format as --from.\n"
+           "  --qname <name>         Question name, case insensitive.\n"
+           "  --stats                Print number of blocks and bytes decoded to stderr.\n");
+}
+
+/** Parse command line options.
+ *
+ * @param cfg  Tool settings to set.
+ * @param argc Number of CLI arguments
+ * @param argv Array of CLI arguments.
+ */
+static void
+qlog_options(qlog_cfg_t *cfg, int argc, char *argv[])
+{
+    int c;
+    struct option options[] = {
+        {"from",  required_argument, 0, 'f'},
+        {"to",    required_argument, 0, 't'},
+        {"qname", required_argument, 0, 'q'},
+        {"stats", no_argument,       0, 's'},
+        {"help",  no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    *cfg = (qlog_cfg_t) {
+        .to = UINT64_MAX,
+    };
+
+    while ((c = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (c) {
+        case 'f':
+        case 't':
+            if (qlog_time_parse(optarg, strlen(optarg), c == 'f' ? &cfg->from : &cfg->to) != 0) {
+                fprintf(stderr, "Invalid time \"%s\"\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'q':
+            cfg->qname     = optarg;
+            cfg->qname_len = strlen(optarg);
+            if (cfg->qname_len > 1 && optarg[cfg->qname_len - 1] == '.') {
+                cfg->qname_len--;
+            }
+            cfg->qname_hash = query_log_index_name_hash(optarg, strlen(optarg));
+            break;
+        case 's': cfg->stats = true; break;
+        default:
+            qlog_usage();
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (optind >= argc || cfg->from > cfg->to) {
+        fprintf(stderr, "Invalid options, see --help\n");
+        exit(1);
+    }
+}
+
+/** Main function of query log tool.
+ *
+ * @param argc Number of CLI arguments
+ * @param argv Array of CLI arguments.
+ *
+ * @return     Returns 0 on success, 1 if any file could not be read.
+ */
+int
+main(int argc, char *argv[])
+{
+    qlog_cfg_t cfg;
+    int        ret = 0;
+
+    qlog_options(&cfg, argc, argv);
+
+    for (int i = optind; i < argc; i++) {
+        if (qlog_file(&cfg, argv[i]) != 0) {
+            ret = 1;
+        }
+    }
+    fflush(stdout);
+
+    if (cfg.stats) {
+        fprintf(stderr, "files: %d, index blocks: %llu, blocks decoded: %llu, "
+                "bytes decoded: %llu, queries: %llu\n", argc - optind,
+                (unsigned long long)cfg.blocks, (unsigned long long)cfg.blocks_read,
+                (unsigned long long)cfg.bytes_read, (unsigned long long)cfg.matched);
+    }
+    return ret;
+}
+
+/** @}*/